@@ -149,3 +149,85 @@ int main(void) {
   return 0;
 }"
   OME_HAVE_SNPRINTF)
+
+# Aligned allocation of tile buffers:
+check_cxx_source_compiles("
+#include <stdlib.h>
+int main(void) {
+  void *p = 0;
+  int r = posix_memalign(&p, 64, 128);
+  free(p);
+  return r;
+}"
+  OME_HAVE_POSIX_MEMALIGN)
+
+# Transparent huge page backing of large tile buffers:
+check_cxx_source_compiles("
+#include <sys/mman.h>
+int main(void) {
+  return madvise(0, 0, MADV_HUGEPAGE);
+}"
+  OME_HAVE_MADV_HUGEPAGE)
+
+# Access pattern advice for reading:
+check_cxx_source_compiles("
+#include <fcntl.h>
+int main(void) {
+  return posix_fadvise(0, 0, 0, POSIX_FADV_WILLNEED);
+}"
+  OME_HAVE_POSIX_FADVISE)
+
+check_cxx_source_compiles("
+#include <sys/mman.h>
+int main(void) {
+  return posix_madvise(0, 0, POSIX_MADV_WILLNEED);
+}"
+  OME_HAVE_POSIX_MADVISE)
+
+# Per-thread page fault counts for reading mapped files:
+check_cxx_source_compiles("
+#include <sys/resource.h>
+int main(void) {
+  struct rusage usage;
+  return getrusage(RUSAGE_THREAD, &usage);
+}"
+  OME_HAVE_RUSAGE_THREAD)
+
+# Direct I/O for writing image data:
+check_cxx_source_compiles("
+#include <fcntl.h>
+#include <unistd.h>
+int main(void) {
+  int fd = open(\"\", O_WRONLY | O_DIRECT);
+  return pwrite(fd, 0, 0, 0) < 0;
+}"
+  OME_HAVE_O_DIRECT)
+
+# NUMA node discovery and thread placement:
+check_cxx_source_compiles("
+#include <pthread.h>
+#include <sched.h>
+int main(void) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(sched_getcpu(), &set);
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}"
+  OME_HAVE_PTHREAD_SETAFFINITY_NP)
+
+# POSIX shared memory for the shared decoded tile cache; shm_open
+# is in librt with older C libraries:
+find_library(RT_LIBRARY rt)
+set(CMAKE_REQUIRED_LIBRARIES_SAVE ${CMAKE_REQUIRED_LIBRARIES})
+if(RT_LIBRARY)
+  set(CMAKE_REQUIRED_LIBRARIES ${CMAKE_REQUIRED_LIBRARIES} ${RT_LIBRARY})
+endif()
+check_cxx_source_compiles("
+#include <fcntl.h>
+#include <sys/mman.h>
+int main(void) {
+  int fd = shm_open(\"/ome-files\", O_RDWR | O_CREAT, 0600);
+  return fd < 0 || shm_unlink(\"/ome-files\") < 0;
+}"
+  OME_HAVE_SHM_OPEN)
+set(CMAKE_REQUIRED_LIBRARIES ${CMAKE_REQUIRED_LIBRARIES_SAVE})
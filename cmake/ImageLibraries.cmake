@@ -35,4 +35,109 @@
 # #L%
 
 find_package(TIFF 4.0.3 REQUIRED)
+
+include(CheckCXXSourceCompiles)
+
+# libtiff 4.5 and later permit error handlers to be set per handle
+set(CMAKE_REQUIRED_INCLUDES_SAVE ${CMAKE_REQUIRED_INCLUDES})
+set(CMAKE_REQUIRED_LIBRARIES_SAVE ${CMAKE_REQUIRED_LIBRARIES})
+set(CMAKE_REQUIRED_INCLUDES ${CMAKE_REQUIRED_INCLUDES} ${TIFF_INCLUDE_DIRS})
+set(CMAKE_REQUIRED_LIBRARIES ${CMAKE_REQUIRED_LIBRARIES} ${TIFF_LIBRARIES})
+check_cxx_source_compiles(
+"#include <tiffio.h>
+
+int main() {
+  TIFFOpenOptions *opts = TIFFOpenOptionsAlloc();
+  TIFFOpenOptionsSetErrorHandlerExtR(opts, 0, 0);
+  TIFF *tiff = TIFFOpenExt(\"test.tif\", \"r\", opts);
+  TIFFOpenOptionsFree(opts);
+  TIFFClose(tiff);
+}"
+OME_HAVE_TIFFOPENEXT)
+# libtiff 4.1 and later permit deferred and on-demand loading of the
+# strip and tile offset and byte count arrays
+check_cxx_source_compiles(
+"#include <tiffio.h>
+
+int main() {
+  TIFF *tiff = TIFFOpen(\"test.tif\", \"rO\");
+  toff_t offset = TIFFGetStrileOffset(tiff, 0);
+  TIFFClose(tiff);
+  return offset ? 0 : 1;
+}"
+OME_HAVE_TIFF_STRILE_ONDEMAND)
+set(CMAKE_REQUIRED_INCLUDES ${CMAKE_REQUIRED_INCLUDES_SAVE})
+set(CMAKE_REQUIRED_LIBRARIES ${CMAKE_REQUIRED_LIBRARIES_SAVE})
 find_package(PNG REQUIRED)
+
+# Optional io_uring support for batched reads on Linux
+find_path(LIBURING_INCLUDE_DIR liburing.h)
+find_library(LIBURING_LIBRARY uring)
+if(LIBURING_INCLUDE_DIR AND LIBURING_LIBRARY)
+  set(OME_HAVE_LIBURING ON)
+  message(STATUS "Looking for liburing - found")
+else()
+  message(STATUS "Looking for liburing - not found")
+endif()
+
+# Optional libjpeg for decoding JPEG tiles at reduced scale
+find_package(JPEG)
+if(JPEG_FOUND)
+  set(CMAKE_REQUIRED_INCLUDES_SAVE ${CMAKE_REQUIRED_INCLUDES})
+  set(CMAKE_REQUIRED_LIBRARIES_SAVE ${CMAKE_REQUIRED_LIBRARIES})
+  set(CMAKE_REQUIRED_INCLUDES ${CMAKE_REQUIRED_INCLUDES} ${JPEG_INCLUDE_DIR})
+  set(CMAKE_REQUIRED_LIBRARIES ${CMAKE_REQUIRED_LIBRARIES} ${JPEG_LIBRARIES})
+  check_cxx_source_compiles(
+"#include <cstddef>
+#include <cstdio>
+#include <jpeglib.h>
+
+int main() {
+  static unsigned char data[2] = {0xFF, 0xD8};
+  jpeg_decompress_struct cinfo;
+  jpeg_error_mgr jerr;
+  cinfo.err = jpeg_std_error(&jerr);
+  jpeg_create_decompress(&cinfo);
+  jpeg_mem_src(&cinfo, data, sizeof(data));
+  cinfo.scale_num = 1;
+  cinfo.scale_denom = 8;
+  jpeg_destroy_decompress(&cinfo);
+}"
+OME_HAVE_LIBJPEG)
+  set(CMAKE_REQUIRED_INCLUDES ${CMAKE_REQUIRED_INCLUDES_SAVE})
+  set(CMAKE_REQUIRED_LIBRARIES ${CMAKE_REQUIRED_LIBRARIES_SAVE})
+endif()
+
+# Optional CUDA tile decoding, using nvJPEG and nvCOMP
+if(cuda)
+  find_path(CUDA_RUNTIME_INCLUDE_DIR cuda_runtime_api.h
+            HINTS ENV CUDA_PATH PATH_SUFFIXES include)
+  find_library(CUDA_RUNTIME_LIBRARY cudart
+               HINTS ENV CUDA_PATH PATH_SUFFIXES lib64 lib)
+  if(CUDA_RUNTIME_INCLUDE_DIR AND CUDA_RUNTIME_LIBRARY)
+    set(OME_HAVE_CUDA ON)
+    message(STATUS "Looking for CUDA runtime - found")
+
+    find_path(NVJPEG_INCLUDE_DIR nvjpeg.h
+              HINTS ENV CUDA_PATH PATH_SUFFIXES include)
+    find_library(NVJPEG_LIBRARY nvjpeg
+                 HINTS ENV CUDA_PATH PATH_SUFFIXES lib64 lib)
+    if(NVJPEG_INCLUDE_DIR AND NVJPEG_LIBRARY)
+      set(OME_HAVE_NVJPEG ON)
+      message(STATUS "Looking for nvJPEG - found")
+    else()
+      message(STATUS "Looking for nvJPEG - not found")
+    endif()
+
+    find_path(NVCOMP_INCLUDE_DIR nvcomp/deflate.h)
+    find_library(NVCOMP_LIBRARY nvcomp)
+    if(NVCOMP_INCLUDE_DIR AND NVCOMP_LIBRARY)
+      set(OME_HAVE_NVCOMP ON)
+      message(STATUS "Looking for nvCOMP - found")
+    else()
+      message(STATUS "Looking for nvCOMP - not found")
+    endif()
+  else()
+    message(STATUS "Looking for CUDA runtime - not found")
+  endif()
+endif()
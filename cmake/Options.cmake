@@ -14,6 +14,10 @@ option(fatal-warnings "Compiler warnings are errors" OFF)
 # Unit tests.
 option(test "Enable unit tests (requires gtest)" ON)
 option(extended-tests "Enable extended tests (more comprehensive, longer run time)" ON)
+option(microbenchmarks "Build microbenchmarks of core data structures (requires test)" OFF)
+
+# Optional decoding of tiles into GPU device memory.
+option(cuda "Enable CUDA tile decoding with nvJPEG and nvCOMP (where available)" OFF)
 
 # The installation is relocatable; this affects path lookups (if OFF,
 # paths are assumed to be their configured absolute install location;
@@ -0,0 +1,261 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <cstring>
+#include <stdexcept>
+
+#include <boost/format.hpp>
+
+#include <ome/files/ByteSwap.h>
+
+#if defined(__AVX2__)
+# include <immintrin.h>
+#elif defined(__SSSE3__)
+# include <tmmintrin.h>
+#elif defined(__SSE2__)
+# include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+# include <arm_neon.h>
+#endif
+
+namespace ome
+{
+  namespace files
+  {
+
+    namespace
+    {
+
+      inline uint16_t
+      reverse(uint16_t v)
+      {
+        return static_cast<uint16_t>((v >> 8) | (v << 8));
+      }
+
+      inline uint32_t
+      reverse(uint32_t v)
+      {
+        return ((v >> 24) & 0x000000FFU) | ((v >> 8) & 0x0000FF00U) |
+          ((v << 8) & 0x00FF0000U) | ((v << 24) & 0xFF000000U);
+      }
+
+      inline uint64_t
+      reverse(uint64_t v)
+      {
+        return (static_cast<uint64_t>(reverse(static_cast<uint32_t>(v))) << 32) |
+          reverse(static_cast<uint32_t>(v >> 32));
+      }
+
+      // Swap the values not handled by the vector kernels.  The
+      // values may be unaligned, so are accessed with memcpy.
+      template<typename U>
+      void
+      swapScalar(const uint8_t       *src,
+                 uint8_t             *dest,
+                 dimension_size_type  count)
+      {
+        for (dimension_size_type i = 0; i < count; ++i)
+          {
+            U v;
+            std::memcpy(&v, src + (i * sizeof(U)), sizeof(U));
+            v = reverse(v);
+            std::memcpy(dest + (i * sizeof(U)), &v, sizeof(U));
+          }
+      }
+
+#if defined(__AVX2__) || defined(__SSSE3__)
+      // Shuffle masks reversing each unit within a 16 byte lane.
+      template<typename U>
+      struct ShuffleMask;
+
+      template<>
+      struct ShuffleMask<uint16_t>
+      {
+        static __m128i
+        get()
+        {
+          return _mm_set_epi8(14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1);
+        }
+      };
+
+      template<>
+      struct ShuffleMask<uint32_t>
+      {
+        static __m128i
+        get()
+        {
+          return _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+        }
+      };
+
+      template<>
+      struct ShuffleMask<uint64_t>
+      {
+        static __m128i
+        get()
+        {
+          return _mm_set_epi8(8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7);
+        }
+      };
+#endif
+
+      // Swap as many whole vectors as possible, returning the number
+      // of values swapped.
+      template<typename U>
+      dimension_size_type
+      swapVector(const uint8_t       *src,
+                 uint8_t             *dest,
+                 dimension_size_type  count)
+      {
+        dimension_size_type done = 0U;
+
+#if defined(__AVX2__)
+        const __m128i mask128 = ShuffleMask<U>::get();
+        const __m256i mask = _mm256_broadcastsi128_si256(mask128);
+        const dimension_size_type step = 32U / sizeof(U);
+        for (; done + step <= count; done += step)
+          {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + (done * sizeof(U))));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dest + (done * sizeof(U))),
+                                _mm256_shuffle_epi8(v, mask));
+          }
+#elif defined(__SSSE3__)
+        const __m128i mask = ShuffleMask<U>::get();
+        const dimension_size_type step = 16U / sizeof(U);
+        for (; done + step <= count; done += step)
+          {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + (done * sizeof(U))));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + (done * sizeof(U))),
+                             _mm_shuffle_epi8(v, mask));
+          }
+#elif defined(__SSE2__)
+        // Without a byte shuffle, reverse the 16-bit words within
+        // each unit, and then the bytes within each word.
+        const dimension_size_type step = 16U / sizeof(U);
+        for (; done + step <= count; done += step)
+          {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + (done * sizeof(U))));
+            switch (sizeof(U))
+              {
+              case 4:
+                v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xB1), 0xB1);
+                break;
+              case 8:
+                v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0x1B), 0x1B);
+                break;
+              default:
+                break;
+              }
+            v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + (done * sizeof(U))), v);
+          }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+        const dimension_size_type step = 16U / sizeof(U);
+        for (; done + step <= count; done += step)
+          {
+            uint8x16_t v = vld1q_u8(src + (done * sizeof(U)));
+            switch (sizeof(U))
+              {
+              case 2:
+                v = vrev16q_u8(v);
+                break;
+              case 4:
+                v = vrev32q_u8(v);
+                break;
+              default:
+                v = vrev64q_u8(v);
+                break;
+              }
+            vst1q_u8(dest + (done * sizeof(U)), v);
+          }
+#else
+        // No vector kernel; all values are swapped by swapScalar().
+        static_cast<void>(src);
+        static_cast<void>(dest);
+        static_cast<void>(count);
+#endif
+
+        return done;
+      }
+
+      template<typename U>
+      void
+      swap(const uint8_t       *src,
+           uint8_t             *dest,
+           dimension_size_type  count)
+      {
+        dimension_size_type done = swapVector<U>(src, dest, count);
+        swapScalar<U>(src + (done * sizeof(U)), dest + (done * sizeof(U)), count - done);
+      }
+
+    }
+
+    void
+    byteswapCopy(const void          *src,
+                 void                *dest,
+                 pixel_size_type      size,
+                 dimension_size_type  count)
+    {
+      const uint8_t *s = static_cast<const uint8_t *>(src);
+      uint8_t *d = static_cast<uint8_t *>(dest);
+
+      switch (size)
+        {
+        case 1:
+          if (s != d)
+            std::memcpy(d, s, count);
+          break;
+        case 2:
+          swap<uint16_t>(s, d, count);
+          break;
+        case 4:
+          swap<uint32_t>(s, d, count);
+          break;
+        case 8:
+          swap<uint64_t>(s, d, count);
+          break;
+        default:
+          {
+            boost::format fmt("Unsupported byteswap size %1%");
+            fmt % size;
+            throw std::logic_error(fmt.str());
+          }
+        }
+    }
+
+  }
+}
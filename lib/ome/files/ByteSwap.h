@@ -0,0 +1,145 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#ifndef OME_FILES_BYTESWAP_H
+#define OME_FILES_BYTESWAP_H
+
+#include <complex>
+#include <cstdint>
+
+#include <ome/files/Types.h>
+
+namespace ome
+{
+  namespace files
+  {
+
+    /**
+     * Reverse the byte order of an array of values.
+     *
+     * Each @c size byte unit of the source is byte-reversed into the
+     * corresponding unit of the destination.  The source and
+     * destination may be identical, to swap in place, but must not
+     * otherwise overlap.  SSE2, SSSE3, AVX2 or NEON instructions are
+     * used when enabled at compile time; otherwise a portable
+     * implementation is used.
+     *
+     * @param src the source data.
+     * @param dest the destination data.
+     * @param size the size of each value in bytes (1, 2, 4 or 8).
+     * @param count the number of values.
+     * @throws std::logic_error if the value size is not supported.
+     */
+    void
+    byteswapCopy(const void          *src,
+                 void                *dest,
+                 pixel_size_type      size,
+                 dimension_size_type  count);
+
+    namespace detail
+    {
+
+      /// Size and count of the byte-swappable units of a type.
+      template<typename T>
+      struct ByteswapUnits
+      {
+        /// Size of each unit in bytes.
+        static const pixel_size_type size = sizeof(T);
+        /// Number of units per value.
+        static const dimension_size_type count = 1U;
+      };
+
+      /// Complex values are swapped as their real and imaginary parts.
+      template<typename F>
+      struct ByteswapUnits<std::complex<F>>
+      {
+        /// Size of each unit in bytes.
+        static const pixel_size_type size = sizeof(F);
+        /// Number of units per value.
+        static const dimension_size_type count = 2U;
+      };
+
+    }
+
+    /**
+     * Reverse the byte order of an array of values, copying them.
+     *
+     * Complex values have the byte order of their real and imaginary
+     * parts reversed.
+     *
+     * @param src the source values.
+     * @param dest the destination values.
+     * @param count the number of values.
+     */
+    template<typename T>
+    inline void
+    byteswapCopy(const T             *src,
+                 T                   *dest,
+                 dimension_size_type  count)
+    {
+      byteswapCopy(static_cast<const void *>(src), static_cast<void *>(dest),
+                   detail::ByteswapUnits<T>::size,
+                   count * detail::ByteswapUnits<T>::count);
+    }
+
+    /**
+     * Reverse the byte order of an array of values in place.
+     *
+     * Complex values have the byte order of their real and imaginary
+     * parts reversed.
+     *
+     * @param data the values to swap.
+     * @param count the number of values.
+     */
+    template<typename T>
+    inline void
+    byteswap(T                   *data,
+             dimension_size_type  count)
+    {
+      byteswapCopy(data, data, count);
+    }
+
+  }
+}
+
+#endif // OME_FILES_BYTESWAP_H
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
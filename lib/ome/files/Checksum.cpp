@@ -0,0 +1,145 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <array>
+#include <cstring>
+
+#include <ome/files/Checksum.h>
+
+#if defined(__SSE4_2__)
+# include <nmmintrin.h>
+#elif defined(__ARM_FEATURE_CRC32)
+# include <arm_acle.h>
+#endif
+
+namespace ome
+{
+  namespace files
+  {
+
+    namespace
+    {
+
+#if !defined(__SSE4_2__) && !defined(__ARM_FEATURE_CRC32)
+      // Reflected CRC-32C polynomial.
+      const uint32_t polynomial = 0x82F63B78U;
+
+      // Tables for slicing-by-8; table[0] is the bytewise table.
+      typedef std::array<std::array<uint32_t, 256>, 8> crc_tables;
+
+      const crc_tables&
+      tables()
+      {
+        static const crc_tables t = []
+          {
+            crc_tables init;
+            for (uint32_t i = 0U; i < 256U; ++i)
+              {
+                uint32_t crc = i;
+                for (int bit = 0; bit < 8; ++bit)
+                  crc = (crc >> 1) ^ ((crc & 1U) ? polynomial : 0U);
+                init[0][i] = crc;
+              }
+            for (uint32_t i = 0U; i < 256U; ++i)
+              for (std::size_t t = 1U; t < init.size(); ++t)
+                init[t][i] = (init[t - 1][i] >> 8) ^ init[0][init[t - 1][i] & 0xFFU];
+            return init;
+          }();
+        return t;
+      }
+#endif
+
+    }
+
+    uint32_t
+    crc32c(const void  *data,
+           std::size_t  size,
+           uint32_t     crc)
+    {
+      const uint8_t *src = static_cast<const uint8_t *>(data);
+      crc = ~crc;
+
+#if defined(__SSE4_2__)
+# if defined(__x86_64__) || defined(_M_X64)
+      uint64_t crc64 = crc;
+      for (; size >= sizeof(uint64_t); size -= sizeof(uint64_t), src += sizeof(uint64_t))
+        {
+          uint64_t v;
+          std::memcpy(&v, src, sizeof(v));
+          crc64 = _mm_crc32_u64(crc64, v);
+        }
+      crc = static_cast<uint32_t>(crc64);
+# endif
+      for (; size >= sizeof(uint32_t); size -= sizeof(uint32_t), src += sizeof(uint32_t))
+        {
+          uint32_t v;
+          std::memcpy(&v, src, sizeof(v));
+          crc = _mm_crc32_u32(crc, v);
+        }
+      for (; size; --size, ++src)
+        crc = _mm_crc32_u8(crc, *src);
+#elif defined(__ARM_FEATURE_CRC32)
+      for (; size >= sizeof(uint64_t); size -= sizeof(uint64_t), src += sizeof(uint64_t))
+        {
+          uint64_t v;
+          std::memcpy(&v, src, sizeof(v));
+          crc = __crc32cd(crc, v);
+        }
+      for (; size; --size, ++src)
+        crc = __crc32cb(crc, *src);
+#else
+      const crc_tables& t(tables());
+      // Eight bytes at a time, independent of host byte order.
+      for (; size >= 8U; size -= 8U, src += 8U)
+        {
+          uint32_t lo = crc ^ (static_cast<uint32_t>(src[0]) |
+                               (static_cast<uint32_t>(src[1]) << 8) |
+                               (static_cast<uint32_t>(src[2]) << 16) |
+                               (static_cast<uint32_t>(src[3]) << 24));
+          crc = t[7][lo & 0xFFU] ^ t[6][(lo >> 8) & 0xFFU] ^
+            t[5][(lo >> 16) & 0xFFU] ^ t[4][lo >> 24] ^
+            t[3][src[4]] ^ t[2][src[5]] ^ t[1][src[6]] ^ t[0][src[7]];
+        }
+      for (; size; --size, ++src)
+        crc = (crc >> 8) ^ t[0][(crc ^ *src) & 0xFFU];
+#endif
+
+      return ~crc;
+    }
+
+  }
+}
@@ -0,0 +1,77 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#ifndef OME_FILES_CHECKSUM_H
+#define OME_FILES_CHECKSUM_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ome
+{
+  namespace files
+  {
+
+    /**
+     * Compute the CRC-32C (Castagnoli) checksum of a block of data.
+     *
+     * The checksum may be computed incrementally by passing the
+     * checksum of the preceding data as @p crc.  SSE4.2 or ARMv8 CRC
+     * instructions are used when enabled at compile time; otherwise
+     * a portable table-driven implementation is used.  All
+     * implementations give identical results.
+     *
+     * @param data the data to checksum.
+     * @param size the size of the data in bytes.
+     * @param crc the checksum of any preceding data, or zero.
+     * @returns the checksum.
+     */
+    uint32_t
+    crc32c(const void  *data,
+           std::size_t  size,
+           uint32_t     crc = 0U);
+
+  }
+}
+
+#endif // OME_FILES_CHECKSUM_H
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
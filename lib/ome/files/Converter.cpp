@@ -0,0 +1,650 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <boost/format.hpp>
+
+#include <ome/files/Converter.h>
+#include <ome/files/FormatException.h>
+#include <ome/files/MetadataTools.h>
+#include <ome/files/PixelProperties.h>
+#include <ome/files/VariantPixelBuffer.h>
+#include <ome/files/in/OMETIFFReader.h>
+#include <ome/files/out/OMETIFFWriter.h>
+#include <ome/files/tiff/Codec.h>
+#include <ome/files/tiff/IFD.h>
+
+#include <ome/xml/meta/OMEXMLMetadata.h>
+
+using ome::xml::model::enums::PixelType;
+
+namespace ome
+{
+  namespace files
+  {
+
+    namespace
+    {
+
+      // A unit of work passed between the pipeline stages.  A job
+      // is either a tile to read, convert and save, or a whole plane
+      // to copy.
+      struct Job
+      {
+        std::size_t         index;
+        dimension_size_type series;
+        dimension_size_type plane;
+        dimension_size_type x;
+        dimension_size_type y;
+        dimension_size_type w;
+        dimension_size_type h;
+        bool                copy;
+        VariantPixelBuffer  buf;
+      };
+
+      // A bounded queue connecting two pipeline stages.  pop()
+      // returns false once the queue is closed and empty, and both
+      // push() and pop() return false once the queue is aborted.
+      class JobQueue
+      {
+      public:
+        explicit
+        JobQueue(std::size_t capacity):
+          mutex(),
+          notFull(),
+          notEmpty(),
+          jobs(),
+          capacity(capacity),
+          producers(0U),
+          aborted(false)
+        {}
+
+        void
+        addProducer()
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          ++producers;
+        }
+
+        void
+        removeProducer()
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          if (--producers == 0U)
+            notEmpty.notify_all();
+        }
+
+        bool
+        push(std::shared_ptr<Job> job)
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          notFull.wait(lock, [&](){ return aborted || jobs.size() < capacity; });
+          if (aborted)
+            return false;
+          jobs.push_back(job);
+          notEmpty.notify_one();
+          return true;
+        }
+
+        bool
+        pop(std::shared_ptr<Job>& job)
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          notEmpty.wait(lock, [&](){ return aborted || !jobs.empty() || producers == 0U; });
+          if (aborted || jobs.empty())
+            return false;
+          job = jobs.front();
+          jobs.pop_front();
+          notFull.notify_one();
+          return true;
+        }
+
+        void
+        abort()
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          aborted = true;
+          jobs.clear();
+          notFull.notify_all();
+          notEmpty.notify_all();
+        }
+
+      private:
+        std::mutex                       mutex;
+        std::condition_variable          notFull;
+        std::condition_variable          notEmpty;
+        std::deque<std::shared_ptr<Job>> jobs;
+        std::size_t                      capacity;
+        unsigned int                     producers;
+        bool                             aborted;
+      };
+
+      unsigned int
+      threadCount(unsigned int threads)
+      {
+        return threads ? threads : std::max(1U, std::thread::hardware_concurrency());
+      }
+
+      // Get the codec name for a compression scheme.
+      boost::optional<std::string>
+      codecName(tiff::Compression scheme)
+      {
+        const std::vector<tiff::Codec>& codecs(tiff::getCodecs());
+        for (const auto& codec : codecs)
+          if (codec.scheme == scheme)
+            return codec.name;
+        return boost::none;
+      }
+
+    }
+
+    /// @copydoc Converter::Impl
+    class Converter::Impl
+    {
+    public:
+      /// Reader factory.
+      reader_factory factory;
+      /// Output pixel type.
+      boost::optional<PixelType> pixeltype;
+      /// Pixel type conversion.
+      PixelConversion conversion;
+      /// Output compression.
+      boost::optional<std::string> compression;
+      /// Output tile width.
+      boost::optional<dimension_size_type> tilewidth;
+      /// Output tile or strip height.
+      boost::optional<dimension_size_type> tileheight;
+      /// Number of resolutions.
+      dimension_size_type resolutions;
+      /// Number of reader threads.
+      unsigned int readthreads;
+      /// Number of conversion threads.
+      unsigned int convertthreads;
+      /// Number of encoding threads.
+      unsigned int encodethreads;
+      /// Maximum number of tiles in flight.
+      dimension_size_type depth;
+      /// Copy compressed tiles if possible.
+      bool rawcopy;
+
+      /// Constructor.
+      Impl():
+        factory([](){ return std::make_shared<in::OMETIFFReader>(); }),
+        pixeltype(),
+        conversion(),
+        compression(),
+        tilewidth(),
+        tileheight(),
+        resolutions(1U),
+        readthreads(1U),
+        convertthreads(1U),
+        encodethreads(1U),
+        depth(16U),
+        rawcopy(true)
+      {
+      }
+
+      /// Create and open a reader.
+      std::shared_ptr<FormatReader>
+      openReader(const boost::filesystem::path& input,
+                 std::shared_ptr<::ome::xml::meta::MetadataStore> store = std::shared_ptr<::ome::xml::meta::MetadataStore>())
+      {
+        std::shared_ptr<FormatReader> reader(factory());
+        if (!reader)
+          throw std::logic_error("Reader factory returned a null reader");
+        reader->setFlattenedResolutions(false);
+        if (store)
+          reader->setMetadataStore(store);
+        reader->setId(input);
+        return reader;
+      }
+
+      /**
+       * Check if the planes of the current series may be copied.
+       *
+       * This predicts the result of tiff::IFD::canCopyRawTiles()
+       * from the writer settings, so that the planes may be
+       * scheduled for copying before they are written.  A wrong
+       * prediction only costs performance, since
+       * FormatWriter::copyBytes() falls back to decoding.
+       */
+      bool
+      canCopy(const FormatReader&                         reader,
+              const boost::optional<std::string>&          writecompression,
+              const boost::optional<dimension_size_type>&  writewidth,
+              const boost::optional<dimension_size_type>&  writeheight) const
+      {
+        if (!rawcopy || pixeltype || resolutions > 1U || !reader.getImageCount())
+          return false;
+
+        std::shared_ptr<const tiff::IFD> ifd(reader.getPlaneIFD(0U));
+        if (!ifd)
+          return false;
+
+        tiff::Compression scheme = writecompression ?
+          tiff::getCodecScheme(*writecompression) : tiff::COMPRESSION_NONE;
+        if (ifd->getCompression() != scheme)
+          return false;
+
+        if (ifd->getTileType() == tiff::TILE)
+          {
+            if (!writewidth || !writeheight ||
+                ifd->getTileWidth() != *writewidth ||
+                ifd->getTileHeight() != *writeheight)
+              return false;
+          }
+        else if (writewidth || !writeheight ||
+                 ifd->getTileHeight() != *writeheight)
+          return false;
+
+        return (ifd->getPlanarConfiguration() == tiff::CONTIG) == reader.isInterleaved();
+      }
+    };
+
+    Converter::Converter():
+      impl(std::make_shared<Impl>())
+    {
+    }
+
+    Converter::~Converter()
+    {
+    }
+
+    void
+    Converter::setReaderFactory(const reader_factory& factory)
+    {
+      impl->factory = factory;
+    }
+
+    void
+    Converter::setPixelType(const boost::optional<PixelType>& type,
+                            const PixelConversion&            conversion)
+    {
+      impl->pixeltype = type;
+      impl->conversion = conversion;
+    }
+
+    void
+    Converter::setCompression(const boost::optional<std::string>& compression)
+    {
+      impl->compression = compression;
+    }
+
+    void
+    Converter::setTileSize(const boost::optional<dimension_size_type>& width,
+                           const boost::optional<dimension_size_type>& height)
+    {
+      impl->tilewidth = width;
+      impl->tileheight = height;
+    }
+
+    void
+    Converter::setResolutionCount(dimension_size_type count)
+    {
+      impl->resolutions = count ? count : 1U;
+    }
+
+    void
+    Converter::setReadThreads(unsigned int threads)
+    {
+      impl->readthreads = threads;
+    }
+
+    void
+    Converter::setConvertThreads(unsigned int threads)
+    {
+      impl->convertthreads = threads;
+    }
+
+    void
+    Converter::setEncodeThreads(unsigned int threads)
+    {
+      impl->encodethreads = threads;
+    }
+
+    void
+    Converter::setQueueDepth(dimension_size_type depth)
+    {
+      impl->depth = depth ? depth : 1U;
+    }
+
+    void
+    Converter::setRawCopy(bool copy)
+    {
+      impl->rawcopy = copy;
+    }
+
+    ConversionStatistics
+    Converter::convert(const boost::filesystem::path& input,
+                       const boost::filesystem::path& output)
+    {
+      auto start = std::chrono::steady_clock::now();
+
+      std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> meta(std::make_shared<::ome::xml::meta::OMEXMLMetadata>());
+      std::shared_ptr<FormatReader> reader(impl->openReader(input, meta));
+
+      const dimension_size_type seriesCount = reader->getSeriesCount();
+      if (meta->getImageCount() != seriesCount)
+        meta = createOMEXMLMetadata(*reader);
+
+      // Default the writer settings to those of the input.
+      boost::optional<std::string> compression(impl->compression);
+      boost::optional<dimension_size_type> tilewidth(impl->tilewidth);
+      boost::optional<dimension_size_type> tileheight(impl->tileheight);
+      if (seriesCount && reader->getImageCount())
+        {
+          std::shared_ptr<const tiff::IFD> ifd(reader->getPlaneIFD(0U));
+          if (ifd)
+            {
+              if (!compression && ifd->getCompression() != tiff::COMPRESSION_NONE)
+                compression = codecName(ifd->getCompression());
+              if (!tilewidth && !tileheight)
+                {
+                  if (ifd->getTileType() == tiff::TILE)
+                    tilewidth = ifd->getTileWidth();
+                  tileheight = ifd->getTileHeight();
+                }
+            }
+        }
+
+      // Plan the jobs, and update the metadata for the output pixel
+      // type.
+      std::vector<std::shared_ptr<Job>> jobs;
+      for (dimension_size_type s = 0U; s < seriesCount; ++s)
+        {
+          reader->setSeries(s);
+          const dimension_size_type sizeX = reader->getSizeX();
+          const dimension_size_type sizeY = reader->getSizeY();
+          const dimension_size_type planes = reader->getImageCount();
+
+          if (impl->pixeltype)
+            {
+              meta->setPixelsType(*impl->pixeltype, s);
+              meta->setPixelsSignificantBits(significantBitsPerPixel(*impl->pixeltype), s);
+            }
+
+          if (impl->canCopy(*reader, compression, tilewidth, tileheight))
+            {
+              for (dimension_size_type p = 0U; p < planes; ++p)
+                jobs.push_back(std::make_shared<Job>(Job{jobs.size(), s, p, 0U, 0U, sizeX, sizeY, true, VariantPixelBuffer()}));
+              continue;
+            }
+
+          dimension_size_type tileX = tilewidth ? *tilewidth : (tileheight ? sizeX : reader->getOptimalTileWidth());
+          dimension_size_type tileY = tileheight ? *tileheight : reader->getOptimalTileHeight();
+          tileX = std::max(dimension_size_type(1U), std::min(tileX, sizeX));
+          tileY = std::max(dimension_size_type(1U), std::min(tileY, sizeY));
+
+          for (dimension_size_type p = 0U; p < planes; ++p)
+            for (dimension_size_type y = 0U; y < sizeY; y += tileY)
+              for (dimension_size_type x = 0U; x < sizeX; x += tileX)
+                jobs.push_back(std::make_shared<Job>(Job{jobs.size(), s, p, x, y,
+                        std::min(tileX, sizeX - x), std::min(tileY, sizeY - y),
+                        false, VariantPixelBuffer()}));
+        }
+      reader->setSeries(0U);
+
+      out::OMETIFFWriter writer;
+      std::shared_ptr<::ome::xml::meta::MetadataRetrieve> retrieve(meta);
+      writer.setMetadataRetrieve(retrieve);
+      if (compression)
+        writer.setCompression(*compression);
+      writer.setTileSizeX(tilewidth);
+      writer.setTileSizeY(tileheight);
+      if (seriesCount)
+        writer.setInterleaved(reader->isInterleaved());
+      writer.setEncodeThreads(threadCount(impl->encodethreads));
+      writer.setResolutionCount(impl->resolutions);
+      writer.setId(output);
+
+      const bool converting(static_cast<bool>(impl->pixeltype));
+      const std::size_t depth(static_cast<std::size_t>(impl->depth));
+      JobQueue readQueue(depth);
+      JobQueue writeQueue(depth);
+
+      // Jobs are started in order, and no more than depth jobs may
+      // be started beyond the last job saved.  The earliest unsaved
+      // job has therefore always been started, so the writer can
+      // always make progress.
+      std::atomic<std::size_t> next(0U);
+      std::size_t saved = 0U;
+      std::mutex savedMutex;
+      std::condition_variable savedCond;
+
+      std::mutex errorMutex;
+      std::exception_ptr error;
+      std::atomic<bool> failed(false);
+
+      auto fail = [&]()
+        {
+          {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            if (!error)
+              error = std::current_exception();
+          }
+          failed = true;
+          readQueue.abort();
+          writeQueue.abort();
+          std::lock_guard<std::mutex> lock(savedMutex);
+          savedCond.notify_all();
+        };
+
+      JobQueue& readOutput(converting ? readQueue : writeQueue);
+      auto readTiles = [&](FormatReader& r)
+        {
+          for (;;)
+            {
+              const std::size_t i = next++;
+              if (i >= jobs.size())
+                break;
+
+              {
+                std::unique_lock<std::mutex> lock(savedMutex);
+                savedCond.wait(lock, [&](){ return failed || i < saved + depth; });
+              }
+              if (failed)
+                break;
+
+              std::shared_ptr<Job> job(jobs[i]);
+              if (!job->copy)
+                {
+                  r.setSeries(job->series);
+                  r.openBytes(job->plane, job->buf, job->x, job->y, job->w, job->h);
+                }
+              if (!readOutput.push(job))
+                break;
+            }
+        };
+
+      auto convertTiles = [&]()
+        {
+          try
+            {
+              std::shared_ptr<Job> job;
+              while (readQueue.pop(job))
+                {
+                  if (!job->copy)
+                    {
+                      VariantPixelBuffer converted;
+                      convertPixels(job->buf, converted, *impl->pixeltype, impl->conversion);
+                      job->buf = std::move(converted);
+                    }
+                  if (!writeQueue.push(job))
+                    break;
+                }
+            }
+          catch (...)
+            {
+              fail();
+            }
+          writeQueue.removeProducer();
+        };
+
+      ConversionStatistics stats;
+
+      // Save the jobs in order, holding any which arrive early.
+      auto writeTiles = [&]()
+        {
+          try
+            {
+              std::shared_ptr<FormatReader> copyReader;
+              std::map<std::size_t, std::shared_ptr<Job>> pending;
+              std::shared_ptr<Job> job;
+
+              while (saved < jobs.size() && writeQueue.pop(job))
+                {
+                  pending[job->index] = job;
+                  for (auto p = pending.find(saved); p != pending.end(); p = pending.find(saved))
+                    {
+                      Job& current(*p->second);
+                      writer.setSeries(current.series);
+                      if (current.copy)
+                        {
+                          if (!copyReader)
+                            copyReader = impl->openReader(input);
+                          copyReader->setSeries(current.series);
+                          if (writer.copyBytes(current.plane, *copyReader, current.plane))
+                            ++stats.copiedPlanes;
+                          ++stats.planes;
+                        }
+                      else
+                        {
+                          writer.saveBytes(current.plane, current.buf,
+                                           current.x, current.y, current.w, current.h);
+                          ++stats.tiles;
+                          stats.bytes += current.buf.num_elements() * bytesPerPixel(current.buf.pixelType());
+                          if (current.x + current.w == writer.getSizeX() &&
+                              current.y + current.h == writer.getSizeY())
+                            ++stats.planes;
+                        }
+                      pending.erase(p);
+                      jobs[saved].reset();
+
+                      std::lock_guard<std::mutex> lock(savedMutex);
+                      ++saved;
+                      savedCond.notify_all();
+                    }
+                }
+              if (copyReader)
+                copyReader->close();
+            }
+          catch (...)
+            {
+              fail();
+            }
+        };
+
+      const unsigned int readthreads = static_cast<unsigned int>
+        (std::max(std::size_t(1U), std::min(static_cast<std::size_t>(threadCount(impl->readthreads)), jobs.size())));
+      const unsigned int convertthreads = converting ? threadCount(impl->convertthreads) : 0U;
+
+      for (unsigned int t = 0U; t < readthreads; ++t)
+        readOutput.addProducer();
+      for (unsigned int t = 0U; t < convertthreads; ++t)
+        writeQueue.addProducer();
+
+      // The first reader thread uses the metadata reader; other
+      // threads open the input with their own reader.
+      std::vector<std::thread> threads;
+      for (unsigned int t = 0U; t < readthreads; ++t)
+        threads.emplace_back([&, t]()
+          {
+            try
+              {
+                if (t == 0U)
+                  readTiles(*reader);
+                else
+                  {
+                    std::shared_ptr<FormatReader> r(impl->openReader(input));
+                    readTiles(*r);
+                    r->close();
+                  }
+              }
+            catch (...)
+              {
+                fail();
+              }
+            readOutput.removeProducer();
+          });
+      for (unsigned int t = 0U; t < convertthreads; ++t)
+        threads.emplace_back(convertTiles);
+
+      writeTiles();
+
+      for (auto& thread : threads)
+        thread.join();
+
+      if (!error && saved != jobs.size())
+        {
+          boost::format fmt("Conversion incomplete: %1% of %2% tiles or planes written");
+          fmt % saved % jobs.size();
+          error = std::make_exception_ptr(FormatException(fmt.str()));
+        }
+
+      if (error)
+        {
+          try
+            {
+              writer.close();
+            }
+          catch (...)
+            {
+            }
+          reader->close();
+          std::rethrow_exception(error);
+        }
+
+      writer.close();
+      reader->close();
+
+      auto end = std::chrono::steady_clock::now();
+      stats.seconds = std::chrono::duration<double>(end - start).count();
+      return stats;
+    }
+
+  }
+}
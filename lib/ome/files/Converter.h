@@ -0,0 +1,260 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#ifndef OME_FILES_CONVERTER_H
+#define OME_FILES_CONVERTER_H
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#include <boost/filesystem/path.hpp>
+#include <boost/optional.hpp>
+
+#include <ome/files/FormatReader.h>
+#include <ome/files/PixelConversion.h>
+#include <ome/files/Types.h>
+
+#include <ome/xml/model/enums/PixelType.h>
+
+namespace ome
+{
+  namespace files
+  {
+
+    /**
+     * Conversion statistics.
+     */
+    struct ConversionStatistics
+    {
+      /// Number of planes written.
+      dimension_size_type planes;
+      /// Number of planes written by copying the compressed tiles.
+      dimension_size_type copiedPlanes;
+      /// Number of tiles read, converted and saved.
+      dimension_size_type tiles;
+      /// Number of bytes of decoded pixel data saved.
+      dimension_size_type bytes;
+      /// Elapsed time, in seconds.
+      double seconds;
+
+      /// Constructor.
+      ConversionStatistics():
+        planes(0U),
+        copiedPlanes(0U),
+        tiles(0U),
+        bytes(0U),
+        seconds(0.0)
+      {}
+    };
+
+    /**
+     * Image conversion to OME-TIFF.
+     *
+     * All series and planes of an image are read and written to a
+     * new OME-TIFF file, optionally converting the pixel type and
+     * writing a sub-resolution pyramid.  The conversion is pipelined
+     * so that its stages overlap:
+     *
+     * - a pool of reader threads, each with its own reader, reads
+     *   tiles;
+     * - a pool of conversion threads converts the pixel type of the
+     *   tiles, if required;
+     * - a single writer thread saves the tiles in order, while the
+     *   writer encodes tiles in a pool of encoding threads (see
+     *   FormatWriter::setEncodeThreads()) and downsamples the
+     *   pyramid in a background thread (see
+     *   out::OMETIFFWriter::setResolutionCount()).
+     *
+     * The stages are connected by bounded queues, and no more than
+     * the queue depth of tiles are in flight at any time, which
+     * bounds the memory used irrespective of the image size.
+     *
+     * If the pixel type is not converted, no pyramid is written, and
+     * the compression, tile size and planar configuration of a
+     * series match those of the input, its planes are copied
+     * without decoding and encoding the compressed tiles (see
+     * FormatWriter::copyBytes()).  Unless set explicitly, the
+     * compression and tile size default to those of the first plane
+     * of the input, so that a TIFF input is copied by default.
+     */
+    class Converter
+    {
+    public:
+      /// Function creating a reader.
+      typedef std::function<std::shared_ptr<FormatReader>()> reader_factory;
+
+      /// Constructor.
+      Converter();
+
+      /// Destructor.
+      virtual ~Converter();
+
+      /**
+       * Set the reader factory.
+       *
+       * A reader is created for each reader thread, in addition to
+       * the reader used to obtain the metadata.
+       *
+       * @param factory the factory to use; the default creates an
+       * in::OMETIFFReader.
+       */
+      void
+      setReaderFactory(const reader_factory& factory);
+
+      /**
+       * Set the output pixel type.
+       *
+       * @param type the pixel type, or none to keep the pixel type of
+       * the input (default).
+       * @param conversion the scaling and clamping to apply.
+       */
+      void
+      setPixelType(const boost::optional<::ome::xml::model::enums::PixelType>& type,
+                   const PixelConversion& conversion = PixelConversion());
+
+      /**
+       * Set the output compression.
+       *
+       * @param compression the codec name, or none to use the
+       * compression of the input.
+       */
+      void
+      setCompression(const boost::optional<std::string>& compression);
+
+      /**
+       * Set the output tile size.
+       *
+       * Tiles of this size are also the unit of reading.  If only
+       * the height is set, strips of this height are written.
+       *
+       * @param width the tile width, or none to use the tile size
+       * of the input.
+       * @param height the tile or strip height, or none to use the
+       * tile size of the input.
+       */
+      void
+      setTileSize(const boost::optional<dimension_size_type>& width,
+                  const boost::optional<dimension_size_type>& height);
+
+      /**
+       * Set the number of resolutions to write for each plane.
+       *
+       * @param count the number of resolutions, including the full
+       * resolution; 0 is treated as 1 (default).
+       */
+      void
+      setResolutionCount(dimension_size_type count);
+
+      /**
+       * Set the number of reader threads.
+       *
+       * @param threads the number of threads; 0 uses one per CPU
+       * (default 1).
+       */
+      void
+      setReadThreads(unsigned int threads);
+
+      /**
+       * Set the number of pixel type conversion threads.
+       *
+       * These are only used if the pixel type is converted.
+       *
+       * @param threads the number of threads; 0 uses one per CPU
+       * (default 1).
+       */
+      void
+      setConvertThreads(unsigned int threads);
+
+      /**
+       * Set the number of tile encoding threads.
+       *
+       * @param threads the number of threads; 0 uses one per CPU
+       * (default 1).
+       */
+      void
+      setEncodeThreads(unsigned int threads);
+
+      /**
+       * Set the queue depth.
+       *
+       * @param depth the maximum number of tiles in flight between
+       * reading and writing; 0 is treated as 1 (default 16).
+       */
+      void
+      setQueueDepth(dimension_size_type depth);
+
+      /**
+       * Set whether compressed tiles may be copied.
+       *
+       * @param copy @c true to copy compressed tiles where the
+       * layouts are compatible (default), or @c false to always
+       * decode and encode.
+       */
+      void
+      setRawCopy(bool copy);
+
+      /**
+       * Convert an image.
+       *
+       * @param input the image to read.
+       * @param output the OME-TIFF file to write.
+       * @returns the conversion statistics.
+       * @throws FormatException, tiff::Exception or std::logic_error
+       * if reading, converting or writing fails; the conversion is
+       * stopped at the first error.
+       */
+      ConversionStatistics
+      convert(const boost::filesystem::path& input,
+              const boost::filesystem::path& output);
+
+    protected:
+      class Impl;
+      /// Private implementation details.
+      std::shared_ptr<Impl> impl;
+    };
+
+  }
+}
+
+#endif // OME_FILES_CONVERTER_H
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
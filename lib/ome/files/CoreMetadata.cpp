@@ -101,5 +101,33 @@ namespace ome
     {
     }
 
+    bool
+    CoreMetadata::operator== (const CoreMetadata& rhs) const
+    {
+      return sizeX == rhs.sizeX &&
+        sizeY == rhs.sizeY &&
+        sizeZ == rhs.sizeZ &&
+        sizeC == rhs.sizeC &&
+        sizeT == rhs.sizeT &&
+        thumbSizeX == rhs.thumbSizeX &&
+        thumbSizeY == rhs.thumbSizeY &&
+        pixelType == rhs.pixelType &&
+        bitsPerPixel == rhs.bitsPerPixel &&
+        imageCount == rhs.imageCount &&
+        moduloZ == rhs.moduloZ &&
+        moduloT == rhs.moduloT &&
+        moduloC == rhs.moduloC &&
+        dimensionOrder == rhs.dimensionOrder &&
+        orderCertain == rhs.orderCertain &&
+        littleEndian == rhs.littleEndian &&
+        interleaved == rhs.interleaved &&
+        indexed == rhs.indexed &&
+        falseColor == rhs.falseColor &&
+        metadataComplete == rhs.metadataComplete &&
+        seriesMetadata == rhs.seriesMetadata &&
+        thumbnail == rhs.thumbnail &&
+        resolutionCount == rhs.resolutionCount;
+    }
+
   }
 }
@@ -167,6 +167,30 @@ namespace ome
       /// Destructor.
       virtual
       ~CoreMetadata();
+
+      /**
+       * Compare for equality.
+       *
+       * Only the fields of this class are compared; the fields of
+       * derived classes are not.
+       *
+       * @param rhs the CoreMetadata to compare.
+       * @returns @c true if all fields are equal, @c false otherwise.
+       */
+      bool
+      operator== (const CoreMetadata& rhs) const;
+
+      /**
+       * Compare for inequality.
+       *
+       * @param rhs the CoreMetadata to compare.
+       * @returns @c true if any field differs, @c false otherwise.
+       */
+      bool
+      operator!= (const CoreMetadata& rhs) const
+      {
+        return !(*this == rhs);
+      }
     };
 
     /**
@@ -0,0 +1,355 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <algorithm>
+#include <iterator>
+
+#include <ome/files/DecodedTileCache.h>
+#include <ome/files/LockStatistics.h>
+#include <ome/files/NUMA.h>
+
+namespace ome
+{
+  namespace files
+  {
+
+    namespace
+    {
+
+      /// Lock call sites.
+      LockSite insertSite("DecodedTileCache::insert");
+      LockSite findSite("DecodedTileCache::find");
+
+    }
+
+    DecodedTileCache::DecodedTileCache(dimension_size_type maxsize,
+                                       dimension_size_type partitions):
+      partitions(),
+      bytes(0U),
+      maxbytes(maxsize),
+      budgetmutex(),
+      budget(),
+      account()
+    {
+      for (dimension_size_type i = 0; i < std::max(partitions, static_cast<dimension_size_type>(1U)); ++i)
+        this->partitions.push_back(std::make_unique<Partition>());
+    }
+
+    DecodedTileCache::~DecodedTileCache()
+    {
+      // Wait for any reclaim in progress before the cache is
+      // destroyed.
+      std::atomic_store(&account, std::shared_ptr<MemoryBudget::Account>());
+    }
+
+    DecodedTileCache::Partition&
+    DecodedTileCache::localPartition()
+    {
+      if (partitions.size() == 1U)
+        return *partitions.front();
+      return *partitions[currentNUMANode() % partitions.size()];
+    }
+
+    void
+    DecodedTileCache::insert(const key_type&   key,
+                             const value_type& tilebuffer)
+    {
+      Partition& local(localPartition());
+      TimedLock<std::mutex> lock(local.mutex, insertSite);
+
+      std::map<key_type, Entry, std::less<>>::iterator i = local.cache.find(key);
+      if (i != local.cache.end())
+        {
+          local.bytes -= i->second.tilebuffer->size();
+          bytes -= i->second.tilebuffer->size();
+          local.lru.erase(i->second.pos);
+          local.cache.erase(i);
+        }
+
+      if (!tilebuffer || tilebuffer->size() > maxbytes)
+        return;
+
+      local.lru.push_back(key);
+      Entry entry = {tilebuffer, std::prev(local.lru.end())};
+      local.cache.insert(std::make_pair(key, entry));
+      local.bytes += tilebuffer->size();
+      bytes += tilebuffer->size();
+
+      // Other components may be asked to reclaim memory here, but
+      // this cache is not asked since the mutex is held.
+      std::shared_ptr<MemoryBudget::Account> acct(std::atomic_load(&account));
+      if (acct)
+        acct->setUsage(bytes);
+
+      evict(local);
+    }
+
+    DecodedTileCache::value_type
+    DecodedTileCache::find(const key_type& key)
+    {
+      return find(std::get<0>(key), std::get<1>(key), std::get<2>(key));
+    }
+
+    DecodedTileCache::value_type
+    DecodedTileCache::find(const std::string&  file,
+                           uint64_t            offset,
+                           dimension_size_type tile)
+    {
+      Partition& local(localPartition());
+      value_type found(find(local, file, offset, tile));
+
+      // Tiles decoded on other nodes are used in place, since this is
+      // still cheaper than decoding them again.
+      if (!found && partitions.size() > 1U)
+        for (auto& partition : partitions)
+          if (partition.get() != &local &&
+              (found = find(*partition, file, offset, tile)))
+            break;
+
+      return found;
+    }
+
+    DecodedTileCache::value_type
+    DecodedTileCache::find(Partition&          partition,
+                           const std::string&  file,
+                           uint64_t            offset,
+                           dimension_size_type tile)
+    {
+      TimedLock<std::mutex> lock(partition.mutex, findSite);
+
+      std::map<key_type, Entry, std::less<>>::iterator i = partition.cache.find(std::forward_as_tuple(file, offset, tile));
+      if (i != partition.cache.end())
+        {
+          partition.lru.splice(partition.lru.end(), partition.lru, i->second.pos);
+          return i->second.tilebuffer;
+        }
+      else
+        return value_type();
+    }
+
+    void
+    DecodedTileCache::openFile(const std::string& /* file */)
+    {
+    }
+
+    void
+    DecodedTileCache::erase(const std::string& file)
+    {
+      for (auto& partition : partitions)
+        {
+          std::lock_guard<std::mutex> lock(partition->mutex);
+
+          // Keys are ordered by file first, so all tiles for the file
+          // are contiguous.
+          std::map<key_type, Entry, std::less<>>::iterator i =
+            partition->cache.lower_bound(key_type(file, 0U, 0U));
+          while (i != partition->cache.end() && std::get<0>(i->first) == file)
+            {
+              partition->bytes -= i->second.tilebuffer->size();
+              bytes -= i->second.tilebuffer->size();
+              partition->lru.erase(i->second.pos);
+              i = partition->cache.erase(i);
+            }
+        }
+
+      std::shared_ptr<MemoryBudget::Account> acct(std::atomic_load(&account));
+      if (acct)
+        acct->setUsage(bytes);
+    }
+
+    void
+    DecodedTileCache::clear()
+    {
+      for (auto& partition : partitions)
+        {
+          std::lock_guard<std::mutex> lock(partition->mutex);
+
+          bytes -= partition->bytes;
+          partition->cache.clear();
+          partition->lru.clear();
+          partition->bytes = 0U;
+        }
+
+      std::shared_ptr<MemoryBudget::Account> acct(std::atomic_load(&account));
+      if (acct)
+        acct->setUsage(bytes);
+    }
+
+    dimension_size_type
+    DecodedTileCache::size() const
+    {
+      dimension_size_type count = 0U;
+      for (const auto& partition : partitions)
+        {
+          std::lock_guard<std::mutex> lock(partition->mutex);
+          count += partition->cache.size();
+        }
+      return count;
+    }
+
+    dimension_size_type
+    DecodedTileCache::byteSize() const
+    {
+      return bytes;
+    }
+
+    void
+    DecodedTileCache::setMaxByteSize(dimension_size_type maxsize)
+    {
+      maxbytes = maxsize;
+      for (auto& partition : partitions)
+        {
+          std::lock_guard<std::mutex> lock(partition->mutex);
+          while (exceeded() && !partition->lru.empty())
+            discard(*partition);
+        }
+    }
+
+    dimension_size_type
+    DecodedTileCache::getMaxByteSize() const
+    {
+      return maxbytes;
+    }
+
+    dimension_size_type
+    DecodedTileCache::getPartitionCount() const
+    {
+      return partitions.size();
+    }
+
+    void
+    DecodedTileCache::setMemoryBudget(const std::shared_ptr<MemoryBudget>& budget)
+    {
+      // Opened without a partition mutex held, since the budget may
+      // call reclaim() once the account exists.
+      std::shared_ptr<MemoryBudget::Account> newaccount;
+      if (budget)
+        newaccount = budget->open("decoded tile cache",
+                                  [this](dimension_size_type bytes)
+                                  { return reclaim(bytes); });
+
+      std::shared_ptr<MemoryBudget::Account> oldaccount;
+      {
+        std::lock_guard<std::mutex> lock(budgetmutex);
+        this->budget = budget;
+        oldaccount = std::atomic_exchange(&account, newaccount);
+        if (newaccount)
+          newaccount->setUsage(bytes);
+      }
+
+      Partition& local(localPartition());
+      std::lock_guard<std::mutex> lock(local.mutex);
+      evict(local);
+    }
+
+    std::shared_ptr<MemoryBudget>
+    DecodedTileCache::getMemoryBudget() const
+    {
+      std::lock_guard<std::mutex> lock(budgetmutex);
+
+      return budget;
+    }
+
+    void
+    DecodedTileCache::discard(Partition& partition)
+    {
+      std::map<key_type, Entry, std::less<>>::iterator i = partition.cache.find(partition.lru.front());
+      partition.bytes -= i->second.tilebuffer->size();
+      bytes -= i->second.tilebuffer->size();
+      partition.cache.erase(i);
+      partition.lru.pop_front();
+
+      std::shared_ptr<MemoryBudget::Account> acct(std::atomic_load(&account));
+      if (acct)
+        acct->setUsage(bytes);
+    }
+
+    bool
+    DecodedTileCache::exceeded() const
+    {
+      if (bytes > maxbytes)
+        return true;
+      std::shared_ptr<MemoryBudget::Account> acct(std::atomic_load(&account));
+      return acct && acct->exceeded();
+    }
+
+    void
+    DecodedTileCache::evict(Partition& local)
+    {
+      // While the limit or budget is exceeded, the most recently used
+      // local tile is retained so that the tile just inserted remains
+      // available.
+      while (exceeded() && local.lru.size() > 1U)
+        discard(local);
+
+      // Other partitions are never waited for, so the limit may be
+      // exceeded until the next insertion while they are in use.
+      for (auto& partition : partitions)
+        {
+          if (!exceeded())
+            break;
+          if (partition.get() == &local)
+            continue;
+          std::unique_lock<std::mutex> lock(partition->mutex, std::try_to_lock);
+          if (!lock.owns_lock())
+            continue;
+          while (exceeded() && !partition->lru.empty())
+            discard(*partition);
+        }
+    }
+
+    dimension_size_type
+    DecodedTileCache::reclaim(dimension_size_type bytes)
+    {
+      const dimension_size_type initial = this->bytes;
+      for (auto& partition : partitions)
+        {
+          // Never wait for the cache; it may be held by the caller.
+          std::unique_lock<std::mutex> lock(partition->mutex, std::try_to_lock);
+          if (!lock.owns_lock())
+            continue;
+
+          while (initial - std::min(initial, static_cast<dimension_size_type>(this->bytes)) < bytes &&
+                 !partition->lru.empty())
+            discard(*partition);
+        }
+      const dimension_size_type current = this->bytes;
+      return initial - std::min(initial, current);
+    }
+
+  }
+}
@@ -0,0 +1,366 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#ifndef OME_FILES_DECODEDTILECACHE_H
+#define OME_FILES_DECODEDTILECACHE_H
+
+#include <ome/files/MemoryBudget.h>
+#include <ome/files/Types.h>
+#include <ome/files/TileBuffer.h>
+
+#include <atomic>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace ome
+{
+  namespace files
+  {
+
+    /**
+     * Decoded tile cache.
+     *
+     * This is a collection of decoded TileBuffer objects, indexed
+     * by file, image and tile number, for reuse by readers.  When
+     * the total size of the cached tiles exceeds the size limit,
+     * the least recently used tiles are discarded.
+     *
+     * One cache may be shared between several readers, including
+     * readers of the same file, and is safe for concurrent use.
+     *
+     * The cache may also be attached to a MemoryBudget.  The cached
+     * tiles are then accounted to the budget, tiles are discarded
+     * while the budget is exceeded, and other components may ask
+     * the cache to discard tiles to reduce the total memory use.
+     *
+     * On NUMA systems, the cache may be split into partitions, one
+     * per node (see numaNodeCount()).  Tiles are inserted into the
+     * partition of the node of the inserting thread, which with
+     * first touch placement is the node holding the tile, and are
+     * found in the local partition before the other partitions.
+     * Each partition has a separate lock and least recently used
+     * list; the size limit applies to all partitions together.
+     *
+     * Subclasses may store the tiles elsewhere, such as
+     * SharedMemoryTileCache, by overriding the virtual methods.
+     */
+    class DecodedTileCache
+    {
+    public:
+      /// Cache key: file name, image (IFD) offset and tile index.
+      typedef std::tuple<std::string, uint64_t, dimension_size_type> key_type;
+      /// Tile buffer type.
+      typedef std::shared_ptr<const TileBuffer> value_type;
+
+      /**
+       * Constructor.
+       *
+       * @param maxsize the maximum total size of cached tiles (bytes).
+       * @param partitions the number of partitions; typically one,
+       * or numaNodeCount().
+       */
+      explicit
+      DecodedTileCache(dimension_size_type maxsize = 256U * 1024U * 1024U,
+                       dimension_size_type partitions = 1U);
+
+      /// Destructor.
+      virtual ~DecodedTileCache();
+
+      // To avoid unintentional and expensive copies, copying and
+      // assignment of caches is prevented.
+
+      /// @cond SKIP
+      DecodedTileCache (const DecodedTileCache&) = delete;
+
+      DecodedTileCache&
+      operator= (const DecodedTileCache&) = delete;
+      /// @endcond SKIP
+
+      /**
+       * Insert a tile into the cache.
+       *
+       * If the key is already present in the local partition, the
+       * existing tile is replaced.  Tiles larger than the maximum
+       * cache size are not cached.
+       *
+       * @param key the key of the tile buffer.
+       * @param tilebuffer the decoded tile pixel data; must not be
+       * null.
+       */
+      virtual
+      void
+      insert(const key_type&   key,
+             const value_type& tilebuffer);
+
+      /**
+       * Find a tile in the cache.
+       *
+       * If found, the tile is marked as most recently used.
+       *
+       * @param key the key of the tile buffer.
+       * @returns the tile buffer, or null if not found.
+       */
+      value_type
+      find(const key_type& key);
+
+      /**
+       * Find a tile in the cache.
+       *
+       * As find(const key_type&), but the file name is not copied
+       * into a key, so that a cache hit does not allocate.
+       *
+       * @param file the file name.
+       * @param offset the directory offset.
+       * @param tile the tile index.
+       * @returns the tile buffer, or null if not found.
+       */
+      virtual
+      value_type
+      find(const std::string&  file,
+           uint64_t            offset,
+           dimension_size_type tile);
+
+      /**
+       * Notify the cache that a file has been opened.
+       *
+       * Called when the cache is set for an open TIFF file, so that
+       * a cache may compute any state for the file once, rather
+       * than for each tile.  This does nothing by default.
+       *
+       * @param file the file name.
+       */
+      virtual
+      void
+      openFile(const std::string& file);
+
+      /**
+       * Remove all tiles for a file from the cache.
+       *
+       * @param file the file name.
+       */
+      virtual
+      void
+      erase(const std::string& file);
+
+      /**
+       * Clear the cache.
+       */
+      virtual
+      void
+      clear();
+
+      /**
+       * Get the number of cached tiles.
+       *
+       * @returns the tile count.
+       */
+      virtual
+      dimension_size_type
+      size() const;
+
+      /**
+       * Get the total size of the cached tiles.
+       *
+       * @returns the size (bytes).
+       */
+      virtual
+      dimension_size_type
+      byteSize() const;
+
+      /**
+       * Set the maximum total size of the cached tiles.
+       *
+       * Tiles will be discarded if the new size is exceeded.
+       *
+       * @param maxsize the maximum size (bytes).
+       */
+      virtual
+      void
+      setMaxByteSize(dimension_size_type maxsize);
+
+      /**
+       * Get the maximum total size of the cached tiles.
+       *
+       * @returns the maximum size (bytes).
+       */
+      virtual
+      dimension_size_type
+      getMaxByteSize() const;
+
+      /**
+       * Get the number of partitions.
+       *
+       * @returns the partition count.
+       */
+      dimension_size_type
+      getPartitionCount() const;
+
+      /**
+       * Set the memory budget.
+       *
+       * @param budget the budget to account cached tiles to, or null
+       * for none (the default).
+       */
+      void
+      setMemoryBudget(const std::shared_ptr<MemoryBudget>& budget);
+
+      /**
+       * Get the memory budget.
+       *
+       * @returns the budget, or null if none.
+       */
+      std::shared_ptr<MemoryBudget>
+      getMemoryBudget() const;
+
+    private:
+      /// Cache entry.
+      struct Entry
+      {
+        /// Tile buffer.
+        value_type tilebuffer;
+        /// Position in the LRU list.
+        std::list<key_type>::iterator pos;
+      };
+
+      /// Cache partition.
+      struct Partition
+      {
+        /// Mutex protecting the partition.
+        mutable std::mutex mutex;
+        /// Keys, least recently used first.
+        std::list<key_type> lru;
+        /// Mapping of key to tile buffer (permitting lookup without a key copy).
+        std::map<key_type, Entry, std::less<>> cache;
+        /// Size of tiles in this partition.
+        dimension_size_type bytes = 0U;
+      };
+
+      /**
+       * Get the partition of the calling thread.
+       *
+       * @returns the local partition.
+       */
+      Partition&
+      localPartition();
+
+      /**
+       * Find a tile in a partition.
+       *
+       * @param partition the partition to search.
+       * @param file the file name.
+       * @param offset the directory offset.
+       * @param tile the tile index.
+       * @returns the tile buffer, or null if not found.
+       */
+      value_type
+      find(Partition&          partition,
+           const std::string&  file,
+           uint64_t            offset,
+           dimension_size_type tile);
+
+      /**
+       * Discard the least recently used tile of a partition.
+       *
+       * @note Needs the partition mutex held by the caller.
+       *
+       * @param partition the partition.
+       */
+      void
+      discard(Partition& partition);
+
+      /**
+       * Check if tiles must be discarded.
+       *
+       * @returns @c true if the size limit or the budget is exceeded.
+       */
+      bool
+      exceeded() const;
+
+      /**
+       * Discard least recently used tiles until within the size limit.
+       *
+       * Tiles are discarded from the local partition first,
+       * retaining its most recently used tile, and then from the
+       * other partitions which are not in use.
+       *
+       * @note Needs the local partition mutex held by the caller.
+       *
+       * @param local the local partition.
+       */
+      void
+      evict(Partition& local);
+
+      /**
+       * Discard least recently used tiles on request of the budget.
+       *
+       * @param bytes the size to release (bytes).
+       * @returns the size released (bytes).
+       */
+      dimension_size_type
+      reclaim(dimension_size_type bytes);
+
+      /// Partitions; never resized.
+      std::vector<std::unique_ptr<Partition>> partitions;
+      /// Total size of cached tiles.
+      std::atomic<dimension_size_type> bytes;
+      /// Maximum total size of cached tiles.
+      std::atomic<dimension_size_type> maxbytes;
+      /// Mutex protecting budget and account changes.
+      mutable std::mutex budgetmutex;
+      /// Memory budget.
+      std::shared_ptr<MemoryBudget> budget;
+      /// Budget account; destroyed first, so reclaim() is never
+      /// called for a partly destroyed cache.  Accessed atomically.
+      std::shared_ptr<MemoryBudget::Account> account;
+    };
+
+  }
+}
+
+#endif // OME_FILES_DECODEDTILECACHE_H
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
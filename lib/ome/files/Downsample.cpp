@@ -0,0 +1,505 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <complex>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include <boost/format.hpp>
+
+#include <ome/files/Downsample.h>
+
+namespace ome
+{
+  namespace files
+  {
+
+    namespace
+    {
+
+      // Convert a mean to an integer pixel value, rounding to nearest.
+      template<typename T>
+      typename std::enable_if<std::is_integral<T>::value, T>::type
+      meanValue(double mean)
+      {
+        return static_cast<T>(std::floor(mean + 0.5));
+      }
+
+      // Convert a mean to a floating point pixel value.
+      template<typename T>
+      typename std::enable_if<!std::is_integral<T>::value, T>::type
+      meanValue(double mean)
+      {
+        return static_cast<T>(mean);
+      }
+
+      // Accumulate the mean of a block of pixels.
+      template<typename T>
+      struct Mean
+      {
+        double              sum;
+        dimension_size_type count;
+
+        Mean():
+          sum(0.0),
+          count(0U)
+        {}
+
+        void
+        add(const T& value)
+        {
+          sum += static_cast<double>(value);
+          ++count;
+        }
+
+        T
+        get() const
+        {
+          return meanValue<T>(sum / static_cast<double>(count));
+        }
+      };
+
+      // BIT pixels use the majority value, rounding up.
+      template<>
+      struct Mean<bool>
+      {
+        dimension_size_type set;
+        dimension_size_type count;
+
+        Mean():
+          set(0U),
+          count(0U)
+        {}
+
+        void
+        add(bool value)
+        {
+          if (value)
+            ++set;
+          ++count;
+        }
+
+        bool
+        get() const
+        {
+          return set * 2U >= count;
+        }
+      };
+
+      // Complex pixels average the real and imaginary parts.
+      template<typename F>
+      struct Mean<std::complex<F>>
+      {
+        std::complex<double> sum;
+        dimension_size_type  count;
+
+        Mean():
+          sum(),
+          count(0U)
+        {}
+
+        void
+        add(const std::complex<F>& value)
+        {
+          sum += std::complex<double>(value.real(), value.imag());
+          ++count;
+        }
+
+        std::complex<F>
+        get() const
+        {
+          std::complex<double> mean(sum / static_cast<double>(count));
+          return std::complex<F>(static_cast<F>(mean.real()),
+                                 static_cast<F>(mean.imag()));
+        }
+      };
+
+      // Split a pixel value into real and imaginary parts.
+      template<typename T>
+      inline void
+      sampleParts(const T& value,
+                  double&  real,
+                  double&  imag)
+      {
+        real = static_cast<double>(value);
+        imag = 0.0;
+      }
+
+      template<typename F>
+      inline void
+      sampleParts(const std::complex<F>& value,
+                  double&                real,
+                  double&                imag)
+      {
+        real = static_cast<double>(value.real());
+        imag = static_cast<double>(value.imag());
+      }
+
+      // Convert mean real and imaginary parts to a pixel value.
+      template<typename T>
+      struct PartsValue
+      {
+        static T
+        get(double real,
+            double /* imag */)
+        {
+          return meanValue<T>(real);
+        }
+      };
+
+      template<typename F>
+      struct PartsValue<std::complex<F>>
+      {
+        static std::complex<F>
+        get(double real,
+            double imag)
+        {
+          return std::complex<F>(static_cast<F>(real), static_cast<F>(imag));
+        }
+      };
+
+      struct DownsampleVisitor : public boost::static_visitor<>
+      {
+        VariantPixelBuffer& dest;
+        dimension_size_type x;
+        dimension_size_type y;
+
+        DownsampleVisitor(VariantPixelBuffer& dest,
+                          dimension_size_type x,
+                          dimension_size_type y):
+          dest(dest),
+          x(x),
+          y(y)
+        {}
+
+        template<typename T>
+        void
+        operator()(const T& src)
+        {
+          typedef typename T::element_type::value_type value_type;
+
+          T& destbuf = boost::get<T>(dest.vbuffer());
+
+          const VariantPixelBuffer::size_type *sshape = src->shape();
+          const VariantPixelBuffer::size_type *dshape = destbuf->shape();
+
+          const dimension_size_type sw = sshape[DIM_SPATIAL_X];
+          const dimension_size_type sh = sshape[DIM_SPATIAL_Y];
+          const dimension_size_type samples = sshape[DIM_SUBCHANNEL];
+
+          // Destination pixels with the upper-left pixel of their
+          // block within the source region.
+          const dimension_size_type dx0 = (x + 1U) / 2U;
+          const dimension_size_type dy0 = (y + 1U) / 2U;
+          const dimension_size_type dx1 = std::min((x + sw + 1U) / 2U,
+                                                   static_cast<dimension_size_type>(dshape[DIM_SPATIAL_X]));
+          const dimension_size_type dy1 = std::min((y + sh + 1U) / 2U,
+                                                   static_cast<dimension_size_type>(dshape[DIM_SPATIAL_Y]));
+
+          VariantPixelBuffer::indices_type sidx, didx;
+          std::fill(sidx.begin(), sidx.end(), 0);
+          std::fill(didx.begin(), didx.end(), 0);
+
+          for (dimension_size_type dy = dy0; dy < dy1; ++dy)
+            for (dimension_size_type dx = dx0; dx < dx1; ++dx)
+              for (dimension_size_type s = 0; s < samples; ++s)
+                {
+                  Mean<value_type> mean;
+
+                  for (dimension_size_type by = dy * 2U;
+                       by < std::min(dy * 2U + 2U, y + sh);
+                       ++by)
+                    for (dimension_size_type bx = dx * 2U;
+                         bx < std::min(dx * 2U + 2U, x + sw);
+                         ++bx)
+                      {
+                        sidx[DIM_SPATIAL_X] = static_cast<VariantPixelBuffer::indices_type::value_type>(bx - x);
+                        sidx[DIM_SPATIAL_Y] = static_cast<VariantPixelBuffer::indices_type::value_type>(by - y);
+                        sidx[DIM_SUBCHANNEL] = static_cast<VariantPixelBuffer::indices_type::value_type>(s);
+                        mean.add(src->at(sidx));
+                      }
+
+                  didx[DIM_SPATIAL_X] = static_cast<VariantPixelBuffer::indices_type::value_type>(dx);
+                  didx[DIM_SPATIAL_Y] = static_cast<VariantPixelBuffer::indices_type::value_type>(dy);
+                  didx[DIM_SUBCHANNEL] = static_cast<VariantPixelBuffer::indices_type::value_type>(s);
+                  destbuf->at(didx) = mean.get();
+                }
+        }
+      };
+
+    }
+
+    void
+    downsample(const VariantPixelBuffer& source,
+               dimension_size_type       x,
+               dimension_size_type       y,
+               VariantPixelBuffer&       dest)
+    {
+      if (source.pixelType() != dest.pixelType())
+        {
+          boost::format fmt("Downsampled pixel type %1% does not match source pixel type %2%");
+          fmt % dest.pixelType() % source.pixelType();
+          throw std::logic_error(fmt.str());
+        }
+
+      if (source.shape()[DIM_SUBCHANNEL] != dest.shape()[DIM_SUBCHANNEL])
+        {
+          boost::format fmt("Downsampled subchannel count %1% does not match source subchannel count %2%");
+          fmt % dest.shape()[DIM_SUBCHANNEL] % source.shape()[DIM_SUBCHANNEL];
+          throw std::logic_error(fmt.str());
+        }
+
+      DownsampleVisitor v(dest, x, y);
+      boost::apply_visitor(v, source.vbuffer());
+    }
+
+    class AreaDownsampler::Impl
+    {
+    public:
+      /// Source image width.
+      dimension_size_type sizeX;
+      /// Source image height.
+      dimension_size_type sizeY;
+      /// Destination image width.
+      dimension_size_type destSizeX;
+      /// Destination image height.
+      dimension_size_type destSizeY;
+      /// Pixel type (valid if sums is not empty).
+      ::ome::xml::model::enums::PixelType type;
+      /// Subchannel count (valid if sums is not empty).
+      dimension_size_type samples;
+      /// Destination pixel for each source column.
+      std::vector<dimension_size_type> columns;
+      /// Real and imaginary sums, by destination pixel and subchannel.
+      std::vector<double> sums;
+      /// Source pixel count by destination pixel.
+      std::vector<dimension_size_type> counts;
+
+      Impl(dimension_size_type sizeX,
+           dimension_size_type sizeY,
+           dimension_size_type destSizeX,
+           dimension_size_type destSizeY):
+        sizeX(sizeX),
+        sizeY(sizeY),
+        destSizeX(destSizeX),
+        destSizeY(destSizeY),
+        type(::ome::xml::model::enums::PixelType::UINT8),
+        samples(0U),
+        columns(sizeX),
+        sums(),
+        counts(destSizeX * destSizeY, 0U)
+      {
+        for (dimension_size_type sx = 0; sx < sizeX; ++sx)
+          columns[sx] = sx * destSizeX / sizeX;
+      }
+
+      struct AddVisitor : public boost::static_visitor<>
+      {
+        Impl&               impl;
+        dimension_size_type x;
+        dimension_size_type y;
+
+        AddVisitor(Impl&               impl,
+                   dimension_size_type x,
+                   dimension_size_type y):
+          impl(impl),
+          x(x),
+          y(y)
+        {}
+
+        template<typename T>
+        void
+        operator()(const T& src)
+        {
+          const VariantPixelBuffer::size_type *shape = src->shape();
+          const dimension_size_type w = shape[DIM_SPATIAL_X];
+          const dimension_size_type h = shape[DIM_SPATIAL_Y];
+          const dimension_size_type samples = impl.samples;
+
+          VariantPixelBuffer::indices_type idx;
+          std::fill(idx.begin(), idx.end(), 0);
+
+          for (dimension_size_type sy = 0; sy < h; ++sy)
+            {
+              const dimension_size_type dy = (y + sy) * impl.destSizeY / impl.sizeY;
+              idx[DIM_SPATIAL_Y] = static_cast<VariantPixelBuffer::indices_type::value_type>(sy);
+
+              for (dimension_size_type sx = 0; sx < w; ++sx)
+                {
+                  const dimension_size_type dpixel = dy * impl.destSizeX + impl.columns[x + sx];
+                  double *sum = &impl.sums[dpixel * samples * 2U];
+                  idx[DIM_SPATIAL_X] = static_cast<VariantPixelBuffer::indices_type::value_type>(sx);
+
+                  for (dimension_size_type s = 0; s < samples; ++s)
+                    {
+                      idx[DIM_SUBCHANNEL] = static_cast<VariantPixelBuffer::indices_type::value_type>(s);
+                      double real, imag;
+                      sampleParts(src->at(idx), real, imag);
+                      sum[s * 2U] += real;
+                      sum[s * 2U + 1U] += imag;
+                    }
+                  ++impl.counts[dpixel];
+                }
+            }
+        }
+      };
+
+      struct GetVisitor : public boost::static_visitor<>
+      {
+        const Impl& impl;
+
+        GetVisitor(const Impl& impl):
+          impl(impl)
+        {}
+
+        template<typename T>
+        void
+        operator()(T& dest)
+        {
+          typedef typename T::element_type::value_type value_type;
+
+          VariantPixelBuffer::indices_type idx;
+          std::fill(idx.begin(), idx.end(), 0);
+
+          for (dimension_size_type dy = 0; dy < impl.destSizeY; ++dy)
+            for (dimension_size_type dx = 0; dx < impl.destSizeX; ++dx)
+              {
+                const dimension_size_type dpixel = dy * impl.destSizeX + dx;
+                const double *sum = &impl.sums[dpixel * impl.samples * 2U];
+                const double count = impl.counts[dpixel] ?
+                  static_cast<double>(impl.counts[dpixel]) : 1.0;
+
+                idx[DIM_SPATIAL_X] = static_cast<VariantPixelBuffer::indices_type::value_type>(dx);
+                idx[DIM_SPATIAL_Y] = static_cast<VariantPixelBuffer::indices_type::value_type>(dy);
+                for (dimension_size_type s = 0; s < impl.samples; ++s)
+                  {
+                    idx[DIM_SUBCHANNEL] = static_cast<VariantPixelBuffer::indices_type::value_type>(s);
+                    dest->at(idx) = PartsValue<value_type>::get(sum[s * 2U] / count,
+                                                                sum[s * 2U + 1U] / count);
+                  }
+              }
+        }
+      };
+    };
+
+    AreaDownsampler::AreaDownsampler(dimension_size_type sizeX,
+                                     dimension_size_type sizeY,
+                                     dimension_size_type destSizeX,
+                                     dimension_size_type destSizeY):
+      impl()
+    {
+      if (!sizeX || !sizeY || !destSizeX || !destSizeY ||
+          destSizeX > sizeX || destSizeY > sizeY)
+        {
+          boost::format fmt("Invalid downsampling from %1%x%2% to %3%x%4%");
+          fmt % sizeX % sizeY % destSizeX % destSizeY;
+          throw std::logic_error(fmt.str());
+        }
+
+      impl = std::shared_ptr<Impl>(new Impl(sizeX, sizeY, destSizeX, destSizeY));
+    }
+
+    AreaDownsampler::~AreaDownsampler()
+    {
+    }
+
+    void
+    AreaDownsampler::add(const VariantPixelBuffer& source,
+                         dimension_size_type       x,
+                         dimension_size_type       y)
+    {
+      const VariantPixelBuffer::size_type *shape = source.shape();
+
+      if (x + shape[DIM_SPATIAL_X] > impl->sizeX ||
+          y + shape[DIM_SPATIAL_Y] > impl->sizeY)
+        {
+          boost::format fmt("Region %1%x%2% at %3%,%4% exceeds image size %5%x%6%");
+          fmt % shape[DIM_SPATIAL_X] % shape[DIM_SPATIAL_Y] % x % y % impl->sizeX % impl->sizeY;
+          throw std::logic_error(fmt.str());
+        }
+
+      if (impl->sums.empty())
+        {
+          impl->type = source.pixelType();
+          impl->samples = shape[DIM_SUBCHANNEL];
+          impl->sums.assign(impl->destSizeX * impl->destSizeY * impl->samples * 2U, 0.0);
+        }
+      else if (source.pixelType() != impl->type)
+        {
+          boost::format fmt("Region pixel type %1% does not match image pixel type %2%");
+          fmt % source.pixelType() % impl->type;
+          throw std::logic_error(fmt.str());
+        }
+      else if (shape[DIM_SUBCHANNEL] != impl->samples)
+        {
+          boost::format fmt("Region subchannel count %1% does not match image subchannel count %2%");
+          fmt % shape[DIM_SUBCHANNEL] % impl->samples;
+          throw std::logic_error(fmt.str());
+        }
+
+      Impl::AddVisitor v(*impl, x, y);
+      boost::apply_visitor(v, source.vbuffer());
+    }
+
+    void
+    AreaDownsampler::get(VariantPixelBuffer& dest) const
+    {
+      if (impl->sums.empty())
+        throw std::logic_error("No image regions have been added for downsampling");
+
+      std::array<VariantPixelBuffer::size_type, PixelBufferBase::dimensions> shape, dest_shape;
+      std::fill(shape.begin(), shape.end(), 1U);
+      shape[DIM_SPATIAL_X] = impl->destSizeX;
+      shape[DIM_SPATIAL_Y] = impl->destSizeY;
+      shape[DIM_SUBCHANNEL] = impl->samples;
+      const VariantPixelBuffer::size_type *dest_shape_ptr(dest.shape());
+      std::copy(dest_shape_ptr, dest_shape_ptr + PixelBufferBase::dimensions,
+                dest_shape.begin());
+
+      if (impl->type != dest.pixelType() || shape != dest_shape)
+        dest.setBuffer(shape, impl->type, dest.storage_order(), PIXEL_UNINITIALIZED);
+
+      Impl::GetVisitor v(*impl);
+      boost::apply_visitor(v, dest.vbuffer());
+    }
+
+  }
+}
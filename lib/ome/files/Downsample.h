@@ -0,0 +1,189 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#ifndef OME_FILES_DOWNSAMPLE_H
+#define OME_FILES_DOWNSAMPLE_H
+
+#include <memory>
+
+#include <ome/files/Types.h>
+#include <ome/files/VariantPixelBuffer.h>
+
+namespace ome
+{
+  namespace files
+  {
+
+    /**
+     * Get the size of a dimension after downsampling.
+     *
+     * The size is halved, rounding up, so that every source pixel
+     * contributes to a downsampled pixel.
+     *
+     * @param size the source size.
+     * @returns the downsampled size.
+     */
+    inline dimension_size_type
+    downsampledSize(dimension_size_type size)
+    {
+      return (size + 1U) / 2U;
+    }
+
+    /**
+     * Downsample a region of an image by a factor of two.
+     *
+     * The source buffer contains a region of a larger image, with
+     * its upper-left corner at @c x, @c y.  The destination buffer
+     * represents the whole image at half size (see
+     * downsampledSize()).  Each destination pixel is the mean of
+     * the 2×2 block of source pixels it covers; for BIT images,
+     * the majority value is used.  This permits an image to be
+     * downsampled incrementally as regions become available.
+     *
+     * A destination pixel is set by the region containing the
+     * upper-left pixel of its block.  If the block extends beyond
+     * that region, only the pixels within the region contribute to
+     * the mean, so regions aligned to even coordinates produce the
+     * same result as downsampling the whole image at once.
+     *
+     * Only the first Z, T, C and modulo plane of each buffer is
+     * used.
+     *
+     * @param source the source image region.
+     * @param x the @c X coordinate of the upper-left corner of the
+     * source region.
+     * @param y the @c Y coordinate of the upper-left corner of the
+     * source region.
+     * @param dest the destination image.
+     * @throws std::logic_error if the pixel types or number of
+     * subchannels of the source and destination differ.
+     */
+    void
+    downsample(const VariantPixelBuffer& source,
+               dimension_size_type       x,
+               dimension_size_type       y,
+               VariantPixelBuffer&       dest);
+
+    /**
+     * Incremental downsampling by area reduction.
+     *
+     * An image is reduced to an arbitrary smaller size by averaging
+     * all of the source pixels falling within each destination
+     * pixel; for BIT images the majority value is used.  Regions of
+     * the source image are added one at a time, in any order, so
+     * that a large image may be reduced without holding the whole
+     * image in memory.  Only running sums are retained, so the
+     * memory required is proportional to the destination size.
+     *
+     * Source pixel (@c x, @c y) contributes to destination pixel
+     * (<tt>x × destSizeX / sizeX</tt>, <tt>y × destSizeY /
+     * sizeY</tt>).
+     *
+     * Only the first Z, T, C and modulo plane of each region is
+     * used.
+     */
+    class AreaDownsampler
+    {
+    public:
+      /**
+       * Constructor.
+       *
+       * @param sizeX the width of the source image.
+       * @param sizeY the height of the source image.
+       * @param destSizeX the width of the destination image.
+       * @param destSizeY the height of the destination image.
+       * @throws std::logic_error if a size is zero or the
+       * destination is larger than the source.
+       */
+      AreaDownsampler(dimension_size_type sizeX,
+                      dimension_size_type sizeY,
+                      dimension_size_type destSizeX,
+                      dimension_size_type destSizeY);
+
+      /// Destructor.
+      ~AreaDownsampler();
+
+      /**
+       * Add a region of the source image.
+       *
+       * The pixel type and number of subchannels are taken from the
+       * first region added; all subsequent regions must match.
+       *
+       * @param source the source image region.
+       * @param x the @c X coordinate of the upper-left corner of the
+       * source region.
+       * @param y the @c Y coordinate of the upper-left corner of the
+       * source region.
+       * @throws std::logic_error if the region exceeds the source
+       * image bounds, or the pixel type or number of subchannels
+       * differ from earlier regions.
+       */
+      void
+      add(const VariantPixelBuffer& source,
+          dimension_size_type       x,
+          dimension_size_type       y);
+
+      /**
+       * Get the downsampled image.
+       *
+       * If the destination buffer is not of the correct size and
+       * pixel type, it will be reset to the correct size and type,
+       * retaining its storage order.  Destination pixels to which no
+       * source pixels have contributed are set to zero.
+       *
+       * @param dest the destination image.
+       * @throws std::logic_error if no regions have been added.
+       */
+      void
+      get(VariantPixelBuffer& dest) const;
+
+    private:
+      class Impl;
+      /// Private implementation details.
+      std::shared_ptr<Impl> impl;
+    };
+
+  }
+}
+
+#endif // OME_FILES_DOWNSAMPLE_H
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
@@ -0,0 +1,483 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <ome/files/Executor.h>
+
+namespace ome
+{
+  namespace files
+  {
+
+    namespace
+    {
+
+      // State shared by the workers of one runParallel() call.
+      // Tasks may start after the call has returned, so the state
+      // is shared with each task, which then finds no work left.
+      struct ParallelWork
+      {
+        ParallelWork(dimension_size_type                                                    workers,
+                     const std::function<void (dimension_size_type, dimension_size_type)>& work):
+          mutex(),
+          finished(),
+          work(work),
+          workers(workers),
+          next(0U),
+          done(0U),
+          error()
+        {
+        }
+
+        // Claim and run workers until none are left.
+        void
+        run()
+        {
+          while (true)
+            {
+              dimension_size_type worker;
+              {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (next >= workers)
+                  return;
+                worker = next++;
+              }
+
+              std::exception_ptr e;
+              try
+                {
+                  work(worker, workers);
+                }
+              catch (...)
+                {
+                  e = std::current_exception();
+                }
+
+              {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (e && !error)
+                  error = e;
+                ++done;
+              }
+              finished.notify_all();
+            }
+        }
+
+        std::mutex mutex;
+        std::condition_variable finished;
+        std::function<void (dimension_size_type, dimension_size_type)> work;
+        const dimension_size_type workers;
+        dimension_size_type next;
+        dimension_size_type done;
+        std::exception_ptr error;
+      };
+
+      std::mutex defaultMutex;
+      std::shared_ptr<Executor> defaultInstance;
+
+    }
+
+    CancellationToken::CancellationToken():
+      state(std::make_shared<std::atomic<bool>>(false))
+    {
+    }
+
+    void
+    CancellationToken::cancel() const
+    {
+      *state = true;
+    }
+
+    bool
+    CancellationToken::cancelled() const
+    {
+      return *state;
+    }
+
+    CancelledException::CancelledException(const std::string& what):
+      std::runtime_error(what)
+    {
+    }
+
+    CancelledException::~CancelledException()
+    {
+    }
+
+    Executor::Executor()
+    {
+    }
+
+    Executor::~Executor()
+    {
+    }
+
+    /// @copydoc ThreadPoolExecutor
+    class ThreadPoolExecutor::Impl
+    {
+    public:
+      /// A worker thread and its task queue.
+      struct Worker
+      {
+        /// Mutex protecting the tasks.
+        std::mutex mutex;
+        /// Tasks submitted by this worker.
+        std::deque<task_type> tasks;
+        /// The thread.
+        std::thread thread;
+      };
+
+      /// Mutex protecting the shared queues, pending and stop.
+      std::mutex mutex;
+      /// Signalled when a task is submitted or the pool is stopped.
+      std::condition_variable ready;
+      /// Shared task queues, by priority.
+      std::array<std::deque<task_type>, 3> queues;
+      /// Number of tasks in each shared queue.
+      std::array<std::atomic<dimension_size_type>, 3> queued;
+      /// Number of tasks in all queues.
+      std::atomic<dimension_size_type> pending;
+      /// Stop when no tasks are pending.
+      bool stop;
+      /// Workers.
+      std::vector<std::unique_ptr<Worker>> workers;
+      /// Worker thread initialisation function.
+      thread_init_type init;
+
+      /// The pool of the current thread, if a worker thread.
+      static thread_local Impl *currentPool;
+      /// The worker index of the current thread, if a worker thread.
+      static thread_local dimension_size_type currentWorker;
+
+      Impl(const thread_init_type& init):
+        mutex(),
+        ready(),
+        queues(),
+        pending(0U),
+        stop(false),
+        workers(),
+        init(init)
+      {
+        for (auto& count : queued)
+          count = 0U;
+      }
+
+      // Take a task from a shared queue.
+      bool
+      takeShared(Priority   priority,
+                 task_type& task)
+      {
+        if (!queued[priority])
+          return false;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        std::deque<task_type>& queue(queues[priority]);
+        if (queue.empty())
+          return false;
+        task = std::move(queue.front());
+        queue.pop_front();
+        --queued[priority];
+        return true;
+      }
+
+      // Take a task from a worker queue; the newest task from the
+      // worker's own queue, or the oldest when stealing.
+      bool
+      takeWorker(dimension_size_type worker,
+                 bool                newest,
+                 task_type&          task)
+      {
+        Worker& w(*workers[worker]);
+        std::lock_guard<std::mutex> lock(w.mutex);
+        if (w.tasks.empty())
+          return false;
+        if (newest)
+          {
+            task = std::move(w.tasks.back());
+            w.tasks.pop_back();
+          }
+        else
+          {
+            task = std::move(w.tasks.front());
+            w.tasks.pop_front();
+          }
+        return true;
+      }
+
+      // Take the next task for a worker.
+      bool
+      take(dimension_size_type worker,
+           task_type&          task)
+      {
+        bool found = (takeShared(PRIORITY_HIGH, task) ||
+                      takeWorker(worker, true, task) ||
+                      takeShared(PRIORITY_NORMAL, task));
+        for (dimension_size_type i = 1U; !found && i < workers.size(); ++i)
+          found = takeWorker((worker + i) % workers.size(), false, task);
+        if (!found)
+          found = takeShared(PRIORITY_LOW, task);
+        if (found)
+          --pending;
+        return found;
+      }
+
+      void
+      run(dimension_size_type worker)
+      {
+        currentPool = this;
+        currentWorker = worker;
+
+        if (init)
+          {
+            try
+              {
+                init(worker);
+              }
+            catch (...)
+              {
+                // The worker runs without its initialisation.
+              }
+          }
+
+        while (true)
+          {
+            task_type task;
+            if (take(worker, task))
+              {
+                try
+                  {
+                    task();
+                  }
+                catch (...)
+                  {
+                    // Tasks capture their own errors; an escaping
+                    // exception must not stop the worker.
+                  }
+                continue;
+              }
+
+            std::unique_lock<std::mutex> lock(mutex);
+            ready.wait(lock, [this]() { return stop || pending; });
+            if (stop && !pending)
+              return;
+          }
+      }
+
+      void
+      submit(const task_type& task,
+             Priority         priority)
+      {
+        // The pending count is increased first, so that it is never
+        // less than the number of queued tasks.
+        const bool local = currentPool == this && priority == PRIORITY_NORMAL;
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          if (!local)
+            {
+              queues[priority].push_back(task);
+              ++queued[priority];
+            }
+          ++pending;
+        }
+        if (local)
+          {
+            Worker& w(*workers[currentWorker]);
+            std::lock_guard<std::mutex> lock(w.mutex);
+            w.tasks.push_back(task);
+          }
+        ready.notify_one();
+      }
+    };
+
+    thread_local ThreadPoolExecutor::Impl *ThreadPoolExecutor::Impl::currentPool = nullptr;
+    thread_local dimension_size_type ThreadPoolExecutor::Impl::currentWorker = 0U;
+
+    ThreadPoolExecutor::ThreadPoolExecutor(dimension_size_type     threads,
+                                           const thread_init_type& init):
+      Executor(),
+      impl(std::make_shared<Impl>(init))
+    {
+      if (!threads)
+        threads = std::max(std::thread::hardware_concurrency(), 2U);
+
+      // All workers exist before any thread starts, since threads
+      // steal from each other.
+      impl->workers.reserve(threads);
+      for (dimension_size_type i = 0U; i < threads; ++i)
+        impl->workers.push_back(std::unique_ptr<Impl::Worker>(new Impl::Worker()));
+      try
+        {
+          for (dimension_size_type i = 0U; i < threads; ++i)
+            impl->workers[i]->thread = std::thread(&Impl::run, impl.get(), i);
+        }
+      catch (...)
+        {
+          {
+            std::lock_guard<std::mutex> lock(impl->mutex);
+            impl->stop = true;
+          }
+          impl->ready.notify_all();
+          for (auto& worker : impl->workers)
+            if (worker->thread.joinable())
+              worker->thread.join();
+          throw;
+        }
+    }
+
+    ThreadPoolExecutor::~ThreadPoolExecutor()
+    {
+      {
+        std::lock_guard<std::mutex> lock(impl->mutex);
+        impl->stop = true;
+      }
+      impl->ready.notify_all();
+      for (auto& worker : impl->workers)
+        if (worker->thread.joinable())
+          worker->thread.join();
+    }
+
+    void
+    ThreadPoolExecutor::submit(const task_type& task,
+                               Priority         priority)
+    {
+      impl->submit(task, priority);
+    }
+
+    dimension_size_type
+    ThreadPoolExecutor::concurrency() const
+    {
+      return impl->workers.size();
+    }
+
+    FunctionExecutor::FunctionExecutor(const function_type& function,
+                                       dimension_size_type  concurrency):
+      Executor(),
+      function(function),
+      tasks(std::max(concurrency, static_cast<dimension_size_type>(1U)))
+    {
+    }
+
+    FunctionExecutor::~FunctionExecutor()
+    {
+    }
+
+    void
+    FunctionExecutor::submit(const task_type& task,
+                             Priority         /* priority */)
+    {
+      function(task);
+    }
+
+    dimension_size_type
+    FunctionExecutor::concurrency() const
+    {
+      return tasks;
+    }
+
+    const FunctionExecutor::function_type&
+    FunctionExecutor::getFunction() const
+    {
+      return function;
+    }
+
+    std::shared_ptr<Executor>
+    defaultExecutor()
+    {
+      std::lock_guard<std::mutex> lock(defaultMutex);
+      if (!defaultInstance)
+        defaultInstance = std::make_shared<ThreadPoolExecutor>();
+      return defaultInstance;
+    }
+
+    void
+    setDefaultExecutor(const std::shared_ptr<Executor>& executor)
+    {
+      // The previous executor is released without the lock held,
+      // since destroying a thread pool waits for its tasks.
+      std::shared_ptr<Executor> previous;
+      {
+        std::lock_guard<std::mutex> lock(defaultMutex);
+        previous = defaultInstance;
+        defaultInstance = executor;
+      }
+    }
+
+    void
+    runParallel(const std::shared_ptr<Executor>&                                       executor,
+                dimension_size_type                                                    workers,
+                const std::function<void (dimension_size_type, dimension_size_type)>& work,
+                Executor::Priority                                                     priority)
+    {
+      if (!workers)
+        return;
+      if (workers == 1U)
+        {
+          work(0U, 1U);
+          return;
+        }
+
+      std::shared_ptr<Executor> e(executor ? executor : defaultExecutor());
+      std::shared_ptr<ParallelWork> state(std::make_shared<ParallelWork>(workers, work));
+      try
+        {
+          for (dimension_size_type t = 1U; t < workers; ++t)
+            e->submit([state]() { state->run(); }, priority);
+        }
+      catch (...)
+        {
+          // Fewer tasks than workers; the remaining workers are run
+          // on this thread.
+        }
+      state->run();
+
+      std::unique_lock<std::mutex> lock(state->mutex);
+      state->finished.wait(lock, [&state]() { return state->done == state->workers; });
+      if (state->error)
+        std::rethrow_exception(state->error);
+    }
+
+  }
+}
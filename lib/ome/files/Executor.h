@@ -0,0 +1,361 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+
+#ifndef OME_FILES_EXECUTOR_H
+#define OME_FILES_EXECUTOR_H
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include <ome/files/Types.h>
+
+namespace ome
+{
+  namespace files
+  {
+
+    /**
+     * Cancellation token for asynchronous work.
+     *
+     * Copies of a token share their state, so a token passed with
+     * one or more requests may be cancelled later from any thread.
+     * Tasks check their token when they start, and a task whose
+     * token is cancelled finishes without doing its work, so that
+     * requests which become obsolete while queued (for example,
+     * tiles no longer in view) are dropped rather than delaying
+     * later requests.  Work already started is not interrupted.
+     */
+    class CancellationToken
+    {
+    public:
+      /// Constructor (not cancelled).
+      CancellationToken();
+
+      /**
+       * Cancel the token.
+       *
+       * This is shared by all copies of the token, and may not be
+       * undone.
+       */
+      void
+      cancel() const;
+
+      /**
+       * Check if the token is cancelled.
+       *
+       * @returns @c true if cancelled, @c false otherwise.
+       */
+      bool
+      cancelled() const;
+
+    private:
+      /// Cancellation state shared by all copies.
+      std::shared_ptr<std::atomic<bool>> state;
+    };
+
+    /**
+     * Exception for cancelled work.
+     *
+     * Held by the future of an asynchronous request which was
+     * cancelled before it started.
+     */
+    class CancelledException : public std::runtime_error
+    {
+    public:
+      /**
+       * Constructor.
+       *
+       * @param what the message.
+       */
+      explicit
+      CancelledException(const std::string& what = "Operation cancelled");
+
+      /// Destructor.
+      virtual
+      ~CancelledException();
+    };
+
+    /**
+     * Executor for tasks run on worker threads.
+     *
+     * Readers, writers and TIFF files run their concurrent work
+     * (asynchronous reads and prefetching, parallel decoding and
+     * encoding, directory scanning and pyramid building) as tasks
+     * submitted to an executor, rather than creating threads of
+     * their own.  An application may share a single executor between
+     * all of these, so that the total number of threads is bounded,
+     * or provide an executor which forwards the tasks to its own
+     * scheduler.
+     *
+     * Work split over several workers with runParallel() is claimed
+     * by each task when it starts, and the submitting thread also
+     * runs the work itself, so the work completes even if the tasks
+     * are queued behind other work, or are never started.  Tasks may
+     * therefore submit further tasks and wait for them without
+     * deadlocking a bounded executor.
+     */
+    class Executor
+    {
+    public:
+      /// A task.
+      typedef std::function<void ()> task_type;
+
+      /// Task priority.
+      enum Priority
+        {
+          PRIORITY_LOW,    ///< Speculative work, such as prefetching.
+          PRIORITY_NORMAL, ///< Work needed by a caller.
+          PRIORITY_HIGH    ///< Work which other tasks are waiting for.
+        };
+
+      /// Constructor.
+      Executor();
+
+      /// Destructor.
+      virtual
+      ~Executor();
+
+      /// @cond SKIP
+      Executor (const Executor&) = delete;
+
+      Executor&
+      operator= (const Executor&) = delete;
+      /// @endcond SKIP
+
+      /**
+       * Submit a task.
+       *
+       * The task may be run on any thread, including the calling
+       * thread, and must be run exactly once.  Tasks must not throw;
+       * callers capture their own errors.
+       *
+       * @param task the task to run.
+       * @param priority the task priority.
+       */
+      virtual
+      void
+      submit(const task_type& task,
+             Priority         priority = PRIORITY_NORMAL) = 0;
+
+      /**
+       * Get the number of tasks which may run concurrently.
+       *
+       * This is a hint used to avoid splitting work into more tasks
+       * than may usefully run at once.
+       *
+       * @returns the number of tasks (at least 1).
+       */
+      virtual
+      dimension_size_type
+      concurrency() const = 0;
+    };
+
+    /**
+     * Work-stealing thread pool.
+     *
+     * Each worker thread has its own task queue.  Tasks submitted
+     * from a worker are added to its own queue and run last in,
+     * first out, which keeps nested work on the thread whose caches
+     * hold its data; idle workers steal the oldest tasks from the
+     * other workers.  Tasks submitted from other threads, and high
+     * or low priority tasks, are held in shared queues by priority.
+     * High priority tasks are run before any other task, and low
+     * priority tasks only when no other task is pending.
+     *
+     * Thread placement (affinity) and scheduling priority are
+     * platform-specific, so they are not set by the pool itself.  A
+     * thread initialisation function may be provided to set them on
+     * each worker thread when it starts; numaThreadInit() binds the
+     * workers to NUMA nodes.
+     *
+     * The destructor runs all pending tasks before the workers are
+     * stopped.
+     */
+    class ThreadPoolExecutor : public Executor
+    {
+    private:
+      class Impl;
+      /// Private implementation details.
+      std::shared_ptr<Impl> impl;
+
+    public:
+      /**
+       * Worker thread initialisation function.
+       *
+       * Called on each worker thread when it starts, with the index
+       * of the worker (from 0 to the thread count).
+       */
+      typedef std::function<void (dimension_size_type worker)> thread_init_type;
+
+      /**
+       * Constructor.
+       *
+       * @param threads the number of worker threads, or 0 for one
+       * per processor.
+       * @param init the worker thread initialisation function, if
+       * any.
+       */
+      explicit
+      ThreadPoolExecutor(dimension_size_type     threads = 0U,
+                         const thread_init_type& init = thread_init_type());
+
+      /// Destructor.
+      ~ThreadPoolExecutor();
+
+      // Documented in superclass.
+      void
+      submit(const task_type& task,
+             Priority         priority = PRIORITY_NORMAL) override;
+
+      // Documented in superclass.
+      dimension_size_type
+      concurrency() const override;
+    };
+
+    /**
+     * Executor forwarding tasks to a function.
+     *
+     * This adapts an existing scheduler, such as an event loop, which
+     * accepts tasks as functions.  Priorities are not forwarded.
+     */
+    class FunctionExecutor : public Executor
+    {
+    public:
+      /// Function to run a task.
+      typedef std::function<void (const task_type& task)> function_type;
+
+      /**
+       * Constructor.
+       *
+       * @param function the function to run each task.
+       * @param concurrency the number of tasks the scheduler may run
+       * concurrently.
+       */
+      explicit
+      FunctionExecutor(const function_type& function,
+                       dimension_size_type  concurrency = 1U);
+
+      /// Destructor.
+      ~FunctionExecutor();
+
+      // Documented in superclass.
+      void
+      submit(const task_type& task,
+             Priority         priority = PRIORITY_NORMAL) override;
+
+      // Documented in superclass.
+      dimension_size_type
+      concurrency() const override;
+
+      /**
+       * Get the function used to run each task.
+       *
+       * @returns the function.
+       */
+      const function_type&
+      getFunction() const;
+
+    private:
+      /// Function to run each task.
+      function_type function;
+      /// Concurrency hint.
+      dimension_size_type tasks;
+    };
+
+    /**
+     * Get the default executor.
+     *
+     * This is used by readers, writers and TIFF files with no
+     * executor set.  Unless replaced with setDefaultExecutor(), it is
+     * a ThreadPoolExecutor with one thread per processor (at least
+     * two), created when first used.
+     *
+     * @returns the default executor.
+     */
+    std::shared_ptr<Executor>
+    defaultExecutor();
+
+    /**
+     * Set the default executor.
+     *
+     * Objects which have already obtained the default executor
+     * continue to use the previous executor for their current work.
+     *
+     * @param executor the executor, or null to restore the default
+     * thread pool.
+     */
+    void
+    setDefaultExecutor(const std::shared_ptr<Executor>& executor);
+
+    /**
+     * Split work over several workers.
+     *
+     * @c work is called once for each worker index from 0 to
+     * @c workers, with the worker index and count.  The calling
+     * thread runs the first worker, and any workers which no task has
+     * started by the time it finishes, so the work completes however
+     * many tasks the executor runs.  This returns when all the
+     * workers have finished.
+     *
+     * @param executor the executor for the additional workers, or
+     * null to use the default executor.
+     * @param workers the number of workers.
+     * @param work the work to run for each worker.
+     * @param priority the priority of the additional workers.
+     * @throws the first exception thrown by @c work, after all the
+     * workers have finished.
+     */
+    void
+    runParallel(const std::shared_ptr<Executor>&                                       executor,
+                dimension_size_type                                                    workers,
+                const std::function<void (dimension_size_type, dimension_size_type)>& work,
+                Executor::Priority                                                     priority = Executor::PRIORITY_NORMAL);
+
+  }
+}
+
+#endif // OME_FILES_EXECUTOR_H
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
@@ -0,0 +1,1004 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+
+#ifndef OME_FILES_FLATMETADATAMAP_H
+#define OME_FILES_FLATMETADATAMAP_H
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <iterator>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <ome/files/MetadataMap.h>
+
+namespace ome
+{
+  namespace files
+  {
+
+    /**
+     * Metadata key-value map stored as a sorted vector.
+     *
+     * This is an alternative to MetadataMap for large tables of
+     * original metadata, with the same value types and accessors.
+     * Rather than allocating a tree node per entry, key-value pairs
+     * are stored contiguously, sorted by key.  Short keys use the
+     * small-string storage of @c std::string, and so need no separate
+     * allocation.  Lookups use a hash index of the keys, or a binary
+     * search if the index is not current.
+     *
+     * The hash index is rebuilt by bulk insertion, merge(), flatten(),
+     * construction from a MetadataMap, and reindex().  Inserting or
+     * erasing individual keys invalidates the index, since positions
+     * change; it is not rebuilt automatically, so that const access
+     * remains free of side effects and safe from multiple threads.
+     * Replacing the value of an existing key does not invalidate the
+     * index.  Bulk insertion, with insert(first, last), should be
+     * preferred when filling large maps: each individual insertion
+     * is linear in the size of the map.
+     *
+     * Unlike MetadataMap, the keys are not const when accessed
+     * through an iterator; they must not be modified, or the map
+     * ordering will be broken.
+     */
+    class FlatMetadataMap
+    {
+    public:
+      /// Key type.
+      typedef MetadataMap::key_type key_type;
+
+      /// Value type, allowing assignment of all storable types.
+      typedef MetadataMap::value_type value_type;
+
+      /// Sorted key-value pair storage.
+      typedef std::vector<std::pair<key_type, value_type>> map_type;
+
+      /// Size type.
+      typedef map_type::size_type size_type;
+
+      /// Iterator.
+      typedef map_type::iterator iterator;
+
+      /// Constant iterator.
+      typedef map_type::const_iterator const_iterator;
+
+      /// Reverse iterator.
+      typedef map_type::reverse_iterator reverse_iterator;
+
+      /// Constant reverse iterator.
+      typedef map_type::const_reverse_iterator const_reverse_iterator;
+
+    private:
+      /// Compare key-value pairs and keys by key.
+      struct key_less
+      {
+        /**
+         * Compare pairs.
+         *
+         * @param lhs the first pair.
+         * @param rhs the second pair.
+         * @returns @c true if the key of @p lhs is less than the key of @p rhs.
+         */
+        bool
+        operator()(const map_type::value_type& lhs,
+                   const map_type::value_type& rhs) const
+        {
+          return lhs.first < rhs.first;
+        }
+
+        /**
+         * Compare pair with key.
+         *
+         * @param lhs the pair.
+         * @param rhs the key.
+         * @returns @c true if the key of @p lhs is less than @p rhs.
+         */
+        bool
+        operator()(const map_type::value_type& lhs,
+                   const key_type&             rhs) const
+        {
+          return lhs.first < rhs;
+        }
+      };
+
+      /// Minimum size for which a hash index is built.
+      static const size_type min_index_size = 16U;
+
+      /// Sorted key-value pairs.
+      map_type entries;
+
+      /**
+       * Hash index; open addressing with linear probing, holding
+       * entry positions plus one (zero for an empty slot).  Empty if
+       * not current.
+       */
+      std::vector<size_type> index;
+
+    public:
+      /// Constructor.
+      FlatMetadataMap():
+        entries(),
+        index()
+      {}
+
+      /**
+       * Construct from a MetadataMap.
+       *
+       * @param map the map to copy.
+       */
+      explicit
+      FlatMetadataMap(const MetadataMap& map):
+        entries(map.begin(), map.end()),
+        index()
+      {
+        reindex();
+      }
+
+      /// Destructor.
+      ~FlatMetadataMap()
+      {}
+
+      /**
+       * Add a key-value pair to the map.
+       *
+       * @note If a key by the same already exists in the map, its
+       * value will be replaced.
+       *
+       * @param key the key name.
+       * @param value the abstract value.
+       */
+      void
+      set(const key_type&   key,
+          const value_type& value)
+      {
+        iterator i = find(key);
+        if (i != end())
+          i->second = value;
+        else
+          insertAt(key, value);
+      }
+
+      /**
+       * Add a key-value pair to the map.
+       *
+       * @note If a key by the same already exists in the map, its
+       * value will be replaced.
+       *
+       * @param key the key name.
+       * @param value the value.
+       */
+      template <typename T>
+      void
+      set(const key_type& key,
+          const T&        value)
+      {
+        value_type v = value;
+        set(key, v);
+      }
+
+      /**
+       * Append a value to a vector.
+       *
+       * @note If a key by the same already exists in the map and is
+       * of the wrong type or is not a vector, it will be removed and
+       * replaced.
+       *
+       * @param key the key name.
+       * @param value the value to append.
+       */
+      template <typename T>
+      void
+      append(const key_type& key,
+             const T&        value)
+      {
+        typedef typename std::vector<T> list_type;
+
+        try
+          {
+            list_type& list(get<list_type>(key));
+            list.push_back(value);
+          }
+        catch (const boost::bad_get&)
+          {
+            list_type new_list;
+            new_list.push_back(value);
+            set(key, new_list);
+          }
+      }
+
+      /**
+       * Get the value of a particular key from the map.
+       *
+       * If the key was not found, @p value will remain unmodified.
+       *
+       * @param key the key to find.
+       * @param value a reference to store a copy of the value.
+       * @returns @c true if the key was found, @c false otherwise.
+       */
+      bool
+      get(const key_type& key,
+          value_type&     value) const
+      {
+        const_iterator i = find(key);
+        if (i == end())
+          return false;
+
+        value = i->second;
+        return true;
+      }
+
+      /**
+       * Get the value of a particular key from the map.
+       *
+       * If the key was not found, or the type of @p value does not
+       * match the stored value type, @p value will remain unmodified.
+       *
+       * @param key the key to find.
+       * @param value a reference to store a copy of the value.
+       * @returns @c true if the key was found and the value was of
+       * the correct type, @c false otherwise.
+       */
+      template <typename T>
+      bool
+      get(const key_type& key,
+          T&              value) const
+      {
+        try
+          {
+            value = get<T>(key);
+            return true;
+          }
+        catch (const boost::bad_get&)
+          {
+            return false;
+          }
+      }
+
+      /**
+       * Get a reference to the value of a particular key from the map.
+       *
+       * @param key the key to find.
+       * @returns a reference to the stored value.
+       * @throws boost::bad_get on failure if the key was not found or
+       * if the type did not match the stored value type.
+       */
+      template <typename T>
+      T&
+      get(const key_type& key)
+      {
+        return boost::get<T>(get<value_type>(key));
+      }
+
+      /**
+       * Get a reference to the value of a particular key from the map.
+       *
+       * @param key the key to find.
+       * @returns a reference to the stored value.
+       * @throws boost::bad_get on failure if the key was not found or
+       * if the type did not match the stored value type.
+       */
+      template <typename T>
+      const T&
+      get(const key_type& key) const
+      {
+        return boost::get<T>(get<value_type>(key));
+      }
+
+      /**
+       * Find a key in the map.
+       *
+       * @param key the key to find.
+       * @returns an iterator to the key-value pair.
+       */
+      iterator
+      find(const key_type& key)
+      {
+        return entries.begin() + static_cast<map_type::difference_type>(position(key));
+      }
+
+      /**
+       * Find a key in the map.
+       *
+       * @param key the key to find.
+       * @returns an iterator to the key-value pair.
+       */
+      const_iterator
+      find(const key_type& key) const
+      {
+        return entries.begin() + static_cast<map_type::difference_type>(position(key));
+      }
+
+      /**
+       * Insert a value into the map.
+       *
+       * As for MetadataMap::insert(), this will not replace keys
+       * which already exist in the map.
+       *
+       * @param value the value to insert.
+       * @returns an iterator to the inserted key, or prexisting key
+       * if present, and @c true if the value was inserted, @c false
+       * otherwise.
+       */
+      std::pair<iterator, bool>
+      insert(map_type::value_type& value)
+      {
+        iterator i = find(value.first);
+        if (i != end())
+          return std::make_pair(i, false);
+        return std::make_pair(insertAt(value.first, value.second), true);
+      }
+
+      /**
+       * Insert a range of values into the map.
+       *
+       * This will not replace keys which already exist in the map;
+       * if the range contains duplicate keys, the first is inserted.
+       * The new values are sorted and merged with the existing
+       * values, and the hash index rebuilt, so the cost is that of
+       * sorting the range plus a single pass over the map.
+       *
+       * @param first the start of the range.
+       * @param last the end of the range.
+       */
+      template <typename InputIterator>
+      void
+      insert(InputIterator first,
+             InputIterator last)
+      {
+        const map_type::difference_type existing =
+          static_cast<map_type::difference_type>(entries.size());
+        entries.insert(entries.end(), first, last);
+        std::stable_sort(entries.begin() + existing, entries.end(), key_less());
+        std::inplace_merge(entries.begin(), entries.begin() + existing, entries.end(), key_less());
+        entries.erase(std::unique(entries.begin(), entries.end(),
+                                  [](const map_type::value_type& lhs,
+                                     const map_type::value_type& rhs)
+                                  {
+                                    return lhs.first == rhs.first;
+                                  }),
+                      entries.end());
+        reindex();
+      }
+
+      /**
+       * Erase a key from the map by name.
+       *
+       * @param key the key to erase.
+       */
+      void
+      erase(const key_type& key)
+      {
+        iterator i = find(key);
+        if (i != end())
+          erase(i);
+      }
+
+      /**
+       * Erase a key from the map by an iterator position.
+       *
+       * @param pos the iterator position to erase.
+       */
+      void
+      erase(iterator pos)
+      {
+        entries.erase(pos);
+        index.clear();
+      }
+
+      /**
+       * Get a list of keys in the map.
+       *
+       * @returns a sorted list of keys.
+       */
+      std::vector<key_type>
+      keys() const
+      {
+        std::vector<key_type> ret;
+        ret.reserve(entries.size());
+        for (const auto& e : entries)
+          ret.push_back(e.first);
+
+        return ret;
+      }
+
+      /**
+       * Merge a separate map into this map.
+       *
+       * @param map the map to merge (a MetadataMap or
+       * FlatMetadataMap).
+       * @param prefix a prefix to append to the keys of the map being
+       * merged.
+       */
+      template <typename Map>
+      void
+      merge(const Map&         map,
+            const std::string& prefix)
+      {
+        map_type merged;
+        merged.reserve(map.size());
+        for (const auto& m : map)
+          merged.push_back(map_type::value_type(prefix + m.first, m.second));
+        insert(merged.begin(), merged.end());
+      }
+
+      /**
+       * Create a flattened map.
+       *
+       * All vectors in the map will be flattened, which is the
+       * replacement of each vector by a key per element with with a
+       * @c \#n key suffix.  The result is the same as for
+       * MetadataMap::flatten(), but the flattened elements are
+       * appended and sorted once, rather than inserted individually.
+       *
+       * @returns the flattened map.
+       */
+      FlatMetadataMap
+      flatten() const;
+
+      /**
+       * Convert to a MetadataMap.
+       *
+       * @returns a MetadataMap containing the same keys and values.
+       */
+      MetadataMap
+      toMetadataMap() const
+      {
+        MetadataMap ret;
+        MetadataMap::map_type& map(ret.map());
+        for (const auto& e : entries)
+          map.insert(map.end(), MetadataMap::map_type::value_type(e.first, e.second));
+        return ret;
+      }
+
+      /**
+       * Rebuild the hash index.
+       *
+       * Call after inserting or erasing many individual keys, if
+       * many lookups will follow.
+       */
+      void
+      reindex()
+      {
+        index.clear();
+        if (entries.size() < min_index_size)
+          return;
+
+        size_type slots = 1U;
+        while (slots < entries.size() * 2U)
+          slots <<= 1;
+        index.assign(slots, 0U);
+
+        const size_type mask = slots - 1U;
+        for (size_type pos = 0U; pos < entries.size(); ++pos)
+          {
+            size_type slot = std::hash<key_type>()(entries[pos].first) & mask;
+            while (index[slot])
+              slot = (slot + 1U) & mask;
+            index[slot] = pos + 1U;
+          }
+      }
+
+      /**
+       * Check if the hash index is current.
+       *
+       * @returns @c true if lookups use the hash index, or @c false
+       * if they use a binary search.
+       */
+      bool
+      indexed() const
+      {
+        return !index.empty();
+      }
+
+      /**
+       * Reserve storage.
+       *
+       * @param size the number of entries to reserve storage for.
+       */
+      void
+      reserve(size_type size)
+      {
+        entries.reserve(size);
+      }
+
+      /**
+       * Get the underlying storage.
+       *
+       * The entries must remain sorted by key with unique keys;
+       * call reindex() after any modification.
+       *
+       * @returns a reference to the storage.
+       */
+      map_type&
+      map()
+      {
+        index.clear();
+        return entries;
+      }
+
+      /**
+       * Get the underlying storage.
+       *
+       * @returns a reference to the storage.
+       */
+      const map_type&
+      map() const
+      {
+        return entries;
+      }
+
+      /**
+       * Get an iterator to the beginning of the map.
+       *
+       * @returns an iterator.
+       */
+      iterator
+      begin()
+      {
+        return entries.begin();
+      }
+
+      /**
+       * Get a constant iterator to the beginning of the map.
+       *
+       * @returns a constant iterator.
+       */
+      const_iterator
+      begin() const
+      {
+        return entries.begin();
+      }
+
+      /**
+       * Get an iterator to the end of the map.
+       *
+       * @returns an iterator.
+       */
+      iterator
+      end()
+      {
+        return entries.end();
+      }
+
+      /**
+       * Get a constant iterator to the end of the map.
+       *
+       * @returns a constant iterator.
+       */
+      const_iterator
+      end() const
+      {
+        return entries.end();
+      }
+
+      /**
+       * Get a reverse iterator to the end of the map.
+       *
+       * @returns an iterator.
+       */
+      reverse_iterator
+      rbegin()
+      {
+        return entries.rbegin();
+      }
+
+      /**
+       * Get a constant reverse iterator to the end of the map.
+       *
+       * @returns an iterator.
+       */
+      const_reverse_iterator
+      rbegin() const
+      {
+        return entries.rbegin();
+      }
+
+      /**
+       * Get a reverse iterator to the beginning of the map.
+       *
+       * @returns an iterator.
+       */
+      reverse_iterator
+      rend()
+      {
+        return entries.rend();
+      }
+
+      /**
+       * Get a constant reverse iterator to the beginning of the map.
+       *
+       * @returns an iterator.
+       */
+      const_reverse_iterator
+      rend() const
+      {
+        return entries.rend();
+      }
+
+      /**
+       * Get or set a value by key index.
+       *
+       * Access the metadata map as an associative array.  This may be
+       * used to get or set a value, with the value being created if
+       * the key was not already present in the map.
+       *
+       * @param key the key to retrieve.
+       * @returns a reference to the value associated with the @p key.
+       */
+      value_type&
+      operator[] (const key_type& key)
+      {
+        iterator i = find(key);
+        if (i == end())
+          i = insertAt(key, value_type());
+        return i->second;
+      }
+
+      /**
+       * Compare maps for equality.
+       *
+       * @param rhs the map to compare.
+       * @returns @c true if equal to @p rhs, @c false otherwise.
+       */
+      bool
+      operator == (const FlatMetadataMap& rhs) const
+      {
+        return entries == rhs.entries;
+      }
+
+      /**
+       * Compare maps for non-equality.
+       *
+       * @param rhs the map to compare.
+       * @returns @c true if not equal to @p rhs, @c false otherwise.
+       */
+      bool
+      operator != (const FlatMetadataMap& rhs) const
+      {
+        return entries != rhs.entries;
+      }
+
+      /**
+       * Check if map is less than another map.
+       *
+       * @param rhs the map to compare.
+       * @returns @c true if less than @p rhs, @c false otherwise.
+       */
+      bool
+      operator < (const FlatMetadataMap& rhs) const
+      {
+        return entries < rhs.entries;
+      }
+
+      /**
+       * Check if map is less than or equal to another map.
+       *
+       * @param rhs the map to compare.
+       * @returns @c true if less than or equal to @p rhs, @c false
+       * otherwise.
+       */
+      bool
+      operator <= (const FlatMetadataMap& rhs) const
+      {
+        return entries <= rhs.entries;
+      }
+
+      /**
+       * Check if map is greater than another map.
+       *
+       * @param rhs the map to compare.
+       * @returns @c true if greater than @p rhs, @c false otherwise.
+       */
+      bool
+      operator > (const FlatMetadataMap& rhs) const
+      {
+        return entries > rhs.entries;
+      }
+
+      /**
+       * Check if map is greater than or equal to another map.
+       *
+       * @param rhs the map to compare.
+       * @returns @c true if greater than or equal to @p rhs, @c false
+       * otherwise.
+       */
+      bool
+      operator >= (const FlatMetadataMap& rhs) const
+      {
+        return entries >= rhs.entries;
+      }
+
+      /**
+       * Get the size of the map.
+       *
+       * Note that vectors are counted as a single item; child
+       * elements are not included.
+       *
+       * @returns the number of elements.
+       */
+      size_type
+      size() const
+      {
+        return entries.size();
+      }
+
+      /**
+       * Check if the map is empty.
+       *
+       * @returns @c true if empty, @c false otherwise.
+       */
+      bool
+      empty() const
+      {
+        return entries.empty();
+      }
+
+      /**
+       * Clear the map.
+       *
+       * All keys are cleared from the map.
+       */
+      void
+      clear()
+      {
+        entries.clear();
+        index.clear();
+      }
+
+    private:
+      /**
+       * Get the position of a key.
+       *
+       * @param key the key to find.
+       * @returns the position, or size() if not found.
+       */
+      size_type
+      position(const key_type& key) const
+      {
+        if (!index.empty())
+          {
+            const size_type mask = index.size() - 1U;
+            for (size_type slot = std::hash<key_type>()(key) & mask;
+                 index[slot];
+                 slot = (slot + 1U) & mask)
+              {
+                if (entries[index[slot] - 1U].first == key)
+                  return index[slot] - 1U;
+              }
+            return entries.size();
+          }
+
+        const_iterator i = std::lower_bound(entries.begin(), entries.end(), key, key_less());
+        if (i != entries.end() && i->first == key)
+          return static_cast<size_type>(i - entries.begin());
+        return entries.size();
+      }
+
+      /**
+       * Insert a key known not to be present.
+       *
+       * @param key the key to insert.
+       * @param value the value to insert.
+       * @returns an iterator to the inserted value.
+       */
+      iterator
+      insertAt(const key_type&   key,
+               const value_type& value)
+      {
+        iterator i = std::lower_bound(entries.begin(), entries.end(), key, key_less());
+        index.clear();
+        return entries.insert(i, map_type::value_type(key, value));
+      }
+    };
+
+    namespace detail
+    {
+
+      /**
+       * Visitor template for flattening of FlatMetadataMap vector values.
+       */
+      struct FlatMetadataMapFlattenVisitor : public boost::static_visitor<>
+      {
+        /// The storage to which to append the flattened elements.
+        FlatMetadataMap::map_type& entries;
+        /// The key of the value being flattened.
+        const FlatMetadataMap::key_type& key;
+
+        /**
+         * Constructor.
+         *
+         * @param entries the storage to which to append flattened elements.
+         * @param key the key being output.
+         */
+        FlatMetadataMapFlattenVisitor(FlatMetadataMap::map_type&       entries,
+                                      const FlatMetadataMap::key_type& key):
+          entries(entries),
+          key(key)
+        {}
+
+        /**
+         * Flatten a vector value of arbitrary type.
+         *
+         * Each value will be appended as a separate entry with a @c
+         * \#n suffix added to the key, where @c n is the index into
+         * the vector, indexed from 1.  The suffix will be left
+         * zero-padded to the width of the largest suffix.
+         *
+         * @param c the container values to output.
+         */
+        template <typename T>
+        void
+        operator() (const std::vector<T> & c) const
+        {
+          typename std::vector<T>::size_type idx = 1;
+          // Determine the optimal padding based on the maximum digit count.
+          int sf = static_cast<int>(std::log10(static_cast<float>(c.size()))) + 1;
+          for (typename std::vector<T>::const_iterator i = c.begin();
+               i != c.end();
+               ++i, ++idx)
+            {
+              std::ostringstream os;
+              os << key << " #" << std::setw(sf) << std::setfill('0') << std::right << idx;
+              entries.push_back(FlatMetadataMap::map_type::value_type(os.str(), *i));
+            }
+        }
+
+        /**
+         * Append a scalar value of arbitrary type.
+         *
+         * @param v the value to output.
+         */
+        template <typename T>
+        void
+        operator() (const T& v) const
+        {
+          entries.push_back(FlatMetadataMap::map_type::value_type(key, v));
+        }
+      };
+
+    }
+
+    /**
+     * Get a reference to the value of a particular key from the map.
+     *
+     * @param key the key to find.
+     * @returns a reference to the stored value.
+     * @throws boost::bad_get on failure if the key was not found.
+     */
+    template<>
+    inline FlatMetadataMap::value_type&
+    FlatMetadataMap::get<FlatMetadataMap::value_type>(const key_type& key)
+    {
+      iterator i = find(key);
+      if (i == end())
+        throw boost::bad_get();
+
+      return i->second;
+    }
+
+    /**
+     * Get a reference to the value of a particular key from the map.
+     *
+     * @param key the key to find.
+     * @returns a reference to the stored value.
+     * @throws boost::bad_get on failure if the key was not found.
+     */
+    template<>
+    inline const FlatMetadataMap::value_type&
+    FlatMetadataMap::get<FlatMetadataMap::value_type>(const key_type& key) const
+    {
+      const_iterator i = find(key);
+      if (i == end())
+        throw boost::bad_get();
+
+      return i->second;
+    }
+
+    inline
+    FlatMetadataMap
+    FlatMetadataMap::flatten() const
+    {
+      FlatMetadataMap newmap;
+      map_type& flat(newmap.entries);
+      flat.reserve(entries.size());
+      for (const auto& e : entries)
+        boost::apply_visitor(detail::FlatMetadataMapFlattenVisitor(flat, e.first), e.second);
+
+      // Suffixed keys may sort before following keys, and may
+      // duplicate existing keys.  As for MetadataMap::flatten(), the
+      // value set last wins.
+      if (!std::is_sorted(flat.begin(), flat.end(), key_less()))
+        std::stable_sort(flat.begin(), flat.end(), key_less());
+      size_type n = 0U;
+      for (size_type i = 0U; i < flat.size(); ++i)
+        {
+          if (n && flat[n - 1U].first == flat[i].first)
+            flat[n - 1U].second = std::move(flat[i].second);
+          else
+            {
+              if (n != i)
+                flat[n] = std::move(flat[i]);
+              ++n;
+            }
+        }
+      flat.erase(flat.begin() + static_cast<map_type::difference_type>(n), flat.end());
+
+      newmap.reindex();
+      return newmap;
+    }
+
+  }
+}
+
+namespace std
+{
+
+    /**
+     * Output FlatMetadataMap to output stream.
+     *
+     * @param os the output stream.
+     * @param map the FlatMetadataMap to output.
+     * @returns the output stream.
+     */
+    template<class charT, class traits>
+    inline basic_ostream<charT,traits>&
+    operator<< (basic_ostream<charT,traits>& os,
+                const ::ome::files::FlatMetadataMap& map)
+    {
+      for (const auto& m : map)
+        {
+          boost::apply_visitor(::ome::files::detail::MetadataMapOStreamVisitor(os, m.first), m.second);
+        }
+      return os;
+    }
+
+}
+
+#endif // OME_FILES_FLATMETADATAMAP_H
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
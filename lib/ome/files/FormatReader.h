@@ -39,20 +39,28 @@
 #define OME_FILES_FORMATREADER_H
 
 #include <array>
+#include <functional>
+#include <future>
 #include <memory>
 #include <string>
 #include <vector>
 #include <map>
+#include <stdexcept>
 
+#include <boost/format.hpp>
 #include <boost/optional.hpp>
 
 #include <ome/compat/memory.h>
 
 #include <ome/files/CoreMetadata.h>
+#include <ome/files/Executor.h>
 #include <ome/files/FileInfo.h>
 #include <ome/files/FormatHandler.h>
+#include <ome/files/IOStatistics.h>
 #include <ome/files/MetadataConfigurable.h>
 #include <ome/files/MetadataMap.h>
+#include <ome/files/PixelStatistics.h>
+#include <ome/files/PlaneRegion.h>
 #include <ome/files/Types.h>
 
 #include <ome/xml/meta/MetadataStore.h>
@@ -63,6 +71,14 @@ namespace ome
   {
 
     class VariantPixelBuffer;
+    struct PixelConversion;
+    class TileBuffer;
+    class MemoryBudget;
+
+    namespace tiff
+    {
+      class IFD;
+    }
 
     /**
      * Interface for all biological file format readers.
@@ -75,6 +91,40 @@ namespace ome
     public:
       using FormatHandler::isThisType;
 
+      /**
+       * Executor function for asynchronous tasks.
+       *
+       * Called with a task to run; the task may be run on any
+       * thread, and must be run exactly once.
+       */
+      typedef std::function<void (const std::function<void ()>& task)> executor_type;
+
+      /**
+       * A request to read a sub-image of an image plane.
+       *
+       * Used to read several sub-images in a single call with
+       * openBytesBatch().
+       */
+      struct ReadRequest
+      {
+        /// The plane index within the current series.
+        dimension_size_type plane;
+        /// The region of the plane to read.
+        PlaneRegion region;
+        /// The destination pixel buffer.
+        VariantPixelBuffer *buf;
+      };
+
+      /**
+       * Visitor for streamed sub-image reads.
+       *
+       * Called with a pixel buffer containing part of the
+       * sub-image, and the region of the plane it covers.  The
+       * buffer is only valid until the visitor returns.
+       */
+      typedef std::function<void (const VariantPixelBuffer& buf,
+                                  const PlaneRegion& region)> region_visitor_type;
+
       /// File grouping options.
       enum FileGroupOption
         {
@@ -564,6 +614,12 @@ namespace ome
        * w * h * bytesPerPixel * getRGBChannelCount(channel)
        * \endcode
        *
+       * The buffer is resized as needed.  If the buffer was
+       * constructed with caller-provided external storage, the
+       * sub-image is read directly into that storage, which is never
+       * reallocated; std::logic_error is thrown before reading if
+       * the storage is too small.
+       *
        * @param plane the plane index within the series.
        * @param buf the destination pixel buffer.
        * @param x the @c X coordinate of the upper-left corner of the sub-image.
@@ -582,20 +638,410 @@ namespace ome
                 dimension_size_type w,
                 dimension_size_type h) const = 0;
 
+      /**
+       * Obtain an image plane into a typed pixel buffer.
+       *
+       * @copydetails openBytes(dimension_size_type,std::shared_ptr<PixelBuffer<T>>&,dimension_size_type,dimension_size_type,dimension_size_type,dimension_size_type)const
+       */
+      template<typename T>
+      void
+      openBytes(dimension_size_type              plane,
+                std::shared_ptr<PixelBuffer<T>>& buf) const
+      {
+        openBytes(plane, buf, 0, 0, getSizeX(), getSizeY());
+      }
+
+      /**
+       * Obtain a sub-image of an image plane into a typed pixel
+       * buffer.
+       *
+       * As for openBytes(), but for callers which know the pixel
+       * type at compile time.  The buffer is used directly as the
+       * destination, without being copied to or from a buffer of
+       * another type, and is reused if it is of the required size
+       * and storage order; otherwise, or if null, it is replaced by
+       * a newly allocated buffer.
+       *
+       * @param plane the plane index within the series.
+       * @param buf the destination pixel buffer.
+       * @param x the @c X coordinate of the upper-left corner of the sub-image.
+       * @param y the @c Y coordinate of the upper-left corner of the sub-image.
+       * @param w the width of the sub-image.
+       * @param h the height of the sub-image.
+       * @throws FormatException if there was a problem parsing the metadata of the
+       *   file.
+       * @throws std::logic_error if the pixel type of the image
+       *   data (after any normalization) is not @c T.
+       */
+      template<typename T>
+      void
+      openBytes(dimension_size_type              plane,
+                std::shared_ptr<PixelBuffer<T>>& buf,
+                dimension_size_type              x,
+                dimension_size_type              y,
+                dimension_size_type              w,
+                dimension_size_type              h) const
+      {
+        VariantPixelBuffer vbuf(buf ? VariantPixelBuffer(buf) : VariantPixelBuffer());
+        openBytes(plane, vbuf, x, y, w, h);
+
+        std::shared_ptr<PixelBuffer<T>> *typed = boost::get<std::shared_ptr<PixelBuffer<T>>>(&vbuf.vbuffer());
+        if (!typed)
+          {
+            boost::format fmt("Pixel type %1% of plane %2% does not match the destination pixel buffer type");
+            fmt % vbuf.pixelType() % plane;
+            throw std::logic_error(fmt.str());
+          }
+        buf = *typed;
+      }
+
+      /**
+       * Obtain an image plane asynchronously.
+       *
+       * @copydetails openBytesAsync(dimension_size_type,VariantPixelBuffer&,dimension_size_type,dimension_size_type,dimension_size_type,dimension_size_type,Executor::Priority,const CancellationToken&)const
+       */
+      virtual
+      std::future<void>
+      openBytesAsync(dimension_size_type      plane,
+                     VariantPixelBuffer&      buf,
+                     Executor::Priority       priority = Executor::PRIORITY_NORMAL,
+                     const CancellationToken& token = CancellationToken()) const = 0;
+
+      /**
+       * Obtain a sub-image of an image plane asynchronously.
+       *
+       * As for openBytes(), but the read and decode are run using
+       * the executor (see setExecutor()), and the call returns
+       * without waiting for them.  The destination buffer must
+       * remain valid, and must not be accessed, until the returned
+       * future is ready.  Errors are reported by the future.  The
+       * current plane is set immediately.  Readers which can not
+       * read independently of the reader state will read
+       * synchronously, and return a ready future.
+       *
+       * Interactive reads may be given a high priority to run them
+       * ahead of other reads; prefetches (see prefetch()) run at low
+       * priority.  If @p token is cancelled before the read starts,
+       * the buffer is not accessed, and the future holds a
+       * CancelledException.
+       *
+       * @param plane the plane index within the series.
+       * @param buf the destination pixel buffer.
+       * @param x the @c X coordinate of the upper-left corner of the sub-image.
+       * @param y the @c Y coordinate of the upper-left corner of the sub-image.
+       * @param w the width of the sub-image.
+       * @param h the height of the sub-image.
+       * @param priority the priority of the read.
+       * @param token the cancellation token for the read.
+       * @returns a future which is ready when the read is complete.
+       */
+      virtual
+      std::future<void>
+      openBytesAsync(dimension_size_type      plane,
+                     VariantPixelBuffer&      buf,
+                     dimension_size_type      x,
+                     dimension_size_type      y,
+                     dimension_size_type      w,
+                     dimension_size_type      h,
+                     Executor::Priority       priority = Executor::PRIORITY_NORMAL,
+                     const CancellationToken& token = CancellationToken()) const = 0;
+
+      /**
+       * Obtain several sub-images of image planes.
+       *
+       * Each request is read into its destination pixel buffer, as
+       * for openBytes().  The requests may reference any planes of
+       * the current series, and their regions may overlap.  Readers
+       * which support it will order the reads by their position in
+       * the file and will read and decode data shared by several
+       * requests only once, which is more efficient than calling
+       * openBytes() for each request in turn.  The destination
+       * buffers must be distinct.  The current plane is not changed.
+       *
+       * @param requests the sub-images to read.
+       * @throws std::logic_error if any plane index is invalid.
+       * @throws FormatException if there was a problem parsing the
+       *   metadata of the file.
+       */
+      virtual
+      void
+      openBytesBatch(const std::vector<ReadRequest>& requests) const = 0;
+
+      /**
+       * Obtain a sub-image of an image plane incrementally.
+       *
+       * As for openBytes(), but rather than reading the whole
+       * sub-image into a single pixel buffer, it is read in parts
+       * which are passed in turn to the visitor.  For TIFF-based
+       * readers, each part is a tile or strip clipped to the
+       * sub-image, visited in order of position in the file;
+       * otherwise each part is a band of rows of the optimal tile
+       * height (see getOptimalTileHeight()).  Only a single part is
+       * held in memory at once, which permits the processing of
+       * sub-images too large to read in their entirety.  The parts
+       * do not overlap, and together cover the sub-image.
+       *
+       * @param plane the plane index within the series.
+       * @param visitor the visitor to call with each part.
+       * @param x the @c X coordinate of the upper-left corner of the sub-image.
+       * @param y the @c Y coordinate of the upper-left corner of the sub-image.
+       * @param w the width of the sub-image.
+       * @param h the height of the sub-image.
+       * @throws std::logic_error if the plane index or region is
+       *   invalid.
+       * @throws FormatException if there was a problem parsing the
+       *   metadata of the file.
+       */
+      virtual
+      void
+      openBytesStreamed(dimension_size_type        plane,
+                        const region_visitor_type& visitor,
+                        dimension_size_type        x,
+                        dimension_size_type        y,
+                        dimension_size_type        w,
+                        dimension_size_type        h) const = 0;
+
+      /**
+       * Obtain a sub-image of an image plane without using the
+       * reader state.
+       *
+       * As for openBytes(), but the series, resolution and plane are
+       * specified explicitly, and the current series, resolution
+       * and plane are neither used nor changed.  This may be called
+       * concurrently from several threads, and concurrently with
+       * calls which only query the reader state, such as
+       * getSizeX().  Readers which can not read independently of
+       * the reader state will serialise the reads and temporarily
+       * switch series; such readers must not be used concurrently
+       * with methods which change the reader state.  The reader
+       * must not be closed while reads are in progress.
+       *
+       * @param series the series index (the core index if resolutions
+       * are flattened).
+       * @param resolution the resolution index within the series
+       * (must be zero if resolutions are flattened).
+       * @param plane the plane index within the series.
+       * @param buf the destination pixel buffer.
+       * @param x the @c X coordinate of the upper-left corner of the sub-image.
+       * @param y the @c Y coordinate of the upper-left corner of the sub-image.
+       * @param w the width of the sub-image.
+       * @param h the height of the sub-image.
+       * @throws std::logic_error if the series, resolution, plane or
+       *   region is invalid.
+       * @throws FormatException if there was a problem parsing the
+       *   metadata of the file.
+       */
+      virtual
+      void
+      openBytesConcurrent(dimension_size_type series,
+                          dimension_size_type resolution,
+                          dimension_size_type plane,
+                          VariantPixelBuffer& buf,
+                          dimension_size_type x,
+                          dimension_size_type y,
+                          dimension_size_type w,
+                          dimension_size_type h) const = 0;
+
+      /**
+       * Prefetch a sub-image of an image plane.
+       *
+       * Start reading and decoding the sub-image of an image plane
+       * from the current series in the background, so that a
+       * subsequent openBytes() call for an overlapping region may be
+       * served from memory.  This returns without waiting for the
+       * data.  Prefetching is advisory: errors reading the data are
+       * not reported, and readers which do not cache decoded data
+       * will ignore the request.  The current plane is not changed.
+       *
+       * @param plane the plane index within the series.
+       * @param x the @c X coordinate of the upper-left corner of the sub-image.
+       * @param y the @c Y coordinate of the upper-left corner of the sub-image.
+       * @param w the width of the sub-image.
+       * @param h the height of the sub-image.
+       * @throws std::logic_error if the plane index is invalid.
+       */
+      virtual
+      void
+      prefetch(dimension_size_type plane,
+               dimension_size_type x,
+               dimension_size_type y,
+               dimension_size_type w,
+               dimension_size_type h) const = 0;
+
+      /**
+       * Cancel pending prefetches.
+       *
+       * Prefetches which have not yet started, including readahead
+       * (see setReadahead()), are dropped without reading or
+       * decoding their data; prefetches already running complete.
+       * This may be used to discard a backlog of prefetches which
+       * are no longer useful, for example after the view of an
+       * interactive application has moved.  Later prefetches are
+       * not affected.
+       */
+      virtual
+      void
+      cancelPrefetch() const = 0;
+
+      /**
+       * Advise the expected access pattern for a sub-image of an image plane.
+       *
+       * Readers may pass this on to the operating system or I/O
+       * source using the location of the stored data for the
+       * sub-image.  Sequential advice increases readahead when
+       * reading whole planes in order, and random advice reduces it
+       * when reading small regions at random positions; these may
+       * apply to the whole file containing the plane.  Advice that
+       * the sub-image will be needed starts reading the stored data
+       * in the background, without decoding it (see prefetch() to
+       * also decode it).  Advice for a set of planes or regions is
+       * given with one call for each.  This is advisory only, and
+       * readers which can't make use of it will ignore it.  The
+       * current plane is not changed.
+       *
+       * @param hint the expected access pattern.
+       * @param plane the plane index within the series.
+       * @param x the @c X coordinate of the upper-left corner of the sub-image.
+       * @param y the @c Y coordinate of the upper-left corner of the sub-image.
+       * @param w the width of the sub-image.
+       * @param h the height of the sub-image.
+       * @throws std::logic_error if the plane index is invalid.
+       */
+      virtual
+      void
+      adviseAccess(AccessHint          hint,
+                   dimension_size_type plane,
+                   dimension_size_type x,
+                   dimension_size_type y,
+                   dimension_size_type w,
+                   dimension_size_type h) const = 0;
+
       /**
        * Obtain a thumbnail of an image plane.
        *
        * Obtail and copy the thumbnail for the specified image plane
        * from the current series into a VariantPixelBuffer.
        *
+       * The thumbnail size is given by getThumbSizeX() and
+       * getThumbSizeY().  If the series has sub-resolutions, the
+       * smallest resolution no smaller than the thumbnail is used as
+       * the source.  The source plane is reduced one tile at a time
+       * by averaging, so the full plane is never held in memory.
+       *
        * @param plane the plane index within the series.
        * @param buf the destination pixel buffer.
+       * @throws std::logic_error if the plane index is invalid.
        */
       virtual
       void
       openThumbBytes(dimension_size_type plane,
                      VariantPixelBuffer& buf) const = 0;
 
+      /**
+       * Obtain a sub-image of an image plane at a reduced scale.
+       *
+       * The region is specified in full-resolution coordinates of
+       * the current series, along with the size to which it will be
+       * scaled.  If the series has sub-resolutions, the coarsest
+       * resolution at which the region is no smaller than the scaled
+       * size is used as the source, so that no more data is decoded
+       * than is needed.  The region is reduced one tile at a time by
+       * averaging.  The current resolution and plane are not
+       * changed.
+       *
+       * @param plane the plane index within the series.
+       * @param buf the destination pixel buffer.
+       * @param x the @c X coordinate of the upper-left corner of the sub-image.
+       * @param y the @c Y coordinate of the upper-left corner of the sub-image.
+       * @param w the width of the sub-image.
+       * @param h the height of the sub-image.
+       * @param scaledW the width of the scaled sub-image.
+       * @param scaledH the height of the scaled sub-image.
+       * @throws std::logic_error if the plane index or region is
+       * invalid, or if the scaled size is larger than the region.
+       */
+      virtual
+      void
+      openScaledBytes(dimension_size_type plane,
+                      VariantPixelBuffer& buf,
+                      dimension_size_type x,
+                      dimension_size_type y,
+                      dimension_size_type w,
+                      dimension_size_type h,
+                      dimension_size_type scaledW,
+                      dimension_size_type scaledH) const = 0;
+
+      /**
+       * Obtain a sub-image of an image plane converted to a different
+       * pixel type.
+       *
+       * As for openBytes(), but the pixel data are converted to the
+       * specified pixel type with optional scaling and clamping (see
+       * convertPixels()).  The sub-image is read one tile at a time,
+       * and each tile is converted directly into the destination
+       * buffer while it is still in cache, rather than reading the
+       * whole sub-image and converting it in a second pass.
+       *
+       * @param plane the plane index within the series.
+       * @param buf the destination pixel buffer.
+       * @param x the @c X coordinate of the upper-left corner of the sub-image.
+       * @param y the @c Y coordinate of the upper-left corner of the sub-image.
+       * @param w the width of the sub-image.
+       * @param h the height of the sub-image.
+       * @param type the destination pixel type.
+       * @param conversion the scaling and clamping to apply.
+       * @throws std::logic_error if the plane index or region is
+       * invalid, or when converting complex pixel data to a
+       * non-complex pixel type.
+       */
+      virtual
+      void
+      openConvertedBytes(dimension_size_type                 plane,
+                         VariantPixelBuffer&                 buf,
+                         dimension_size_type                 x,
+                         dimension_size_type                 y,
+                         dimension_size_type                 w,
+                         dimension_size_type                 h,
+                         ::ome::xml::model::enums::PixelType type,
+                         const PixelConversion&              conversion) const = 0;
+
+      /**
+       * Obtain a sub-image of all channels merged into a single
+       * image.
+       *
+       * The planes of every channel at the @c Z and @c T
+       * coordinates of @p plane are read concurrently (see
+       * openBytesAsync()), and merged into a single pixel buffer
+       * with one subchannel per channel, for example to combine
+       * separately stored red, green and blue channels into an RGB
+       * image.  The subchannels of the destination are interleaved,
+       * and are converted from the planes read using the
+       * interleaving kernels in a single pass.  Each channel must
+       * have a single subchannel (see getRGBChannelCount()).  The
+       * current plane is set to the last channel plane read.
+       *
+       * @param plane the plane index of any channel at the @c Z and
+       * @c T coordinates to read.
+       * @param buf the destination pixel buffer.
+       * @param x the @c X coordinate of the upper-left corner of the sub-image.
+       * @param y the @c Y coordinate of the upper-left corner of the sub-image.
+       * @param w the width of the sub-image.
+       * @param h the height of the sub-image.
+       * @throws std::logic_error if the plane index or region is
+       * invalid.
+       * @throws FormatException if any channel has more than one
+       * subchannel, or if there was a problem reading the pixel
+       * data.
+       */
+      virtual
+      void
+      openMergedBytes(dimension_size_type plane,
+                      VariantPixelBuffer& buf,
+                      dimension_size_type x,
+                      dimension_size_type y,
+                      dimension_size_type w,
+                      dimension_size_type h) const = 0;
+
       /**
        * Get the number of image series in this file.
        *
@@ -656,6 +1102,16 @@ namespace ome
       /**
        * Set float normalization.
        *
+       * If enabled, pixel data read with openBytes(),
+       * openBytesAsync(), openBytesBatch(), openBytesConcurrent() and
+       * openBytesStreamed() are returned as @c FLOAT.  Integer
+       * samples are scaled from the range of the significant bits
+       * (see getBitsPerPixel()) to [0, 1]; @c BIT and @c DOUBLE
+       * samples are converted without scaling.  @c FLOAT and complex
+       * pixel data are returned unchanged.  Planes are read and
+       * converted one tile at a time, as for openConvertedBytes(),
+       * which itself ignores this setting.
+       *
        * @param normalize @c true to enable normalization, or @c false
        * to disable.
        */
@@ -674,6 +1130,209 @@ namespace ome
       bool
       isNormalized() const = 0;
 
+      /**
+       * Set the number of threads to use for decoding pixel data.
+       *
+       * Readers which support parallel decoding will decode image
+       * tiles or strips using up to this number of threads in each
+       * openBytes() call.  Readers which do not support parallel
+       * decoding will ignore this setting.
+       *
+       * @param threads the maximum number of decoding threads; 0 is
+       * treated as 1.
+       */
+      virtual
+      void
+      setDecodeThreads(dimension_size_type threads) = 0;
+
+      /**
+       * Get the number of threads to use for decoding pixel data.
+       *
+       * @returns the maximum number of decoding threads (default 1).
+       */
+      virtual
+      dimension_size_type
+      getDecodeThreads() const = 0;
+
+      /**
+       * Set whether to verify tile checksums.
+       *
+       * Readers which support it will check the stored data of each
+       * tile against any checksum recorded when it was written (see
+       * FormatWriter::setRecordTileChecksums()), and throw an
+       * exception on a mismatch.  This must be set prior to calling
+       * setId().
+       *
+       * @param verify @c true to verify tile checksums, @c false
+       * otherwise (default).
+       */
+      virtual
+      void
+      setVerifyTileChecksums(bool verify) = 0;
+
+      /**
+       * Get whether to verify tile checksums.
+       *
+       * @returns @c true if tile checksums are verified, @c false
+       * otherwise.
+       */
+      virtual
+      bool
+      getVerifyTileChecksums() const = 0;
+
+      /**
+       * Set the I/O statistics.
+       *
+       * The bytes read, tiles decoded, tile cache use and time spent in each stage are
+       * accumulated in these statistics, which may be shared between
+       * several readers to accumulate totals.  This must be set
+       * prior to calling setId().
+       *
+       * @param statistics the statistics to use; if null, new
+       * statistics are created.
+       */
+      virtual
+      void
+      setStatistics(const std::shared_ptr<IOStatistics>& statistics) = 0;
+
+      /**
+       * Get the I/O statistics.
+       *
+       * @returns the statistics (never null).
+       */
+      virtual
+      const std::shared_ptr<IOStatistics>&
+      getStatistics() const = 0;
+
+      /**
+       * Enable or disable pixel statistics.
+       *
+       * If enabled, the minimum, maximum and histogram of each
+       * subchannel are accumulated whenever a whole plane is read
+       * with openBytes(), and cached for retrieval with
+       * getPixelStatistics().  Readers which support it accumulate
+       * the statistics while the pixel data is unpacked, rather than
+       * with a separate pass over the plane.  Disabled by default.
+       *
+       * @param enabled @c true to accumulate pixel statistics.
+       */
+      virtual
+      void
+      setPixelStatisticsEnabled(bool enabled) = 0;
+
+      /**
+       * Check if pixel statistics are enabled.
+       *
+       * @returns @c true if pixel statistics are accumulated.
+       */
+      virtual
+      bool
+      getPixelStatisticsEnabled() const = 0;
+
+      /**
+       * Get the pixel statistics of a plane in the current series.
+       *
+       * @param plane the plane index within the series.
+       * @returns the statistics, or null if the whole plane has not
+       * been read with pixel statistics enabled.
+       */
+      virtual
+      std::shared_ptr<const PixelStatistics>
+      getPixelStatistics(dimension_size_type plane) const = 0;
+
+      /**
+       * Enable or disable sequential readahead.
+       *
+       * If enabled, openBytes() detects sequential access and
+       * prefetches the data expected to be read next (see
+       * prefetch()).  Reading the same region of planes at a
+       * constant plane index stride, such as iterating over @c T
+       * with getIndex(), prefetches the same region of the next
+       * plane in the sequence.  Reading adjacent regions of a plane
+       * from left to right prefetches the next row of regions.
+       * Readers which do not cache decoded data will ignore the
+       * prefetch.  Disabled by default.
+       *
+       * @param readahead @c true to enable sequential readahead.
+       */
+      virtual
+      void
+      setReadahead(bool readahead) = 0;
+
+      /**
+       * Check if sequential readahead is enabled.
+       *
+       * @returns @c true if sequential readahead is enabled.
+       */
+      virtual
+      bool
+      getReadahead() const = 0;
+
+      /**
+       * Set the memory budget.
+       *
+       * The budget is shared with any caches and buffers which
+       * account against it, for example a DecodedTileCache.  While
+       * the budget is exceeded, prefetch requests (including
+       * sequential readahead) are discarded, so that optional
+       * background work does not add to memory pressure.  Pass a
+       * null budget to disable accounting (the default).
+       *
+       * @param budget the memory budget to use.
+       */
+      virtual
+      void
+      setMemoryBudget(const std::shared_ptr<MemoryBudget>& budget) = 0;
+
+      /**
+       * Get the memory budget.
+       *
+       * @returns the memory budget, or null if unset.
+       */
+      virtual
+      const std::shared_ptr<MemoryBudget>&
+      getMemoryBudget() const = 0;
+
+      /**
+       * Set the executor for asynchronous and parallel tasks.
+       *
+       * This is used to run openBytesAsync() and prefetch() tasks,
+       * and by TIFF-based readers for parallel decoding (see
+       * setDecodeThreads()).  The default is to use the executor
+       * shared by all readers and writers (see defaultExecutor()).
+       * One bounded thread pool or other scheduler may be shared by
+       * all readers and writers by setting the same executor on
+       * each.  Parallel decoding uses the executor set when the file
+       * was opened.
+       *
+       * @param executor the executor, or null to use the default.
+       */
+      virtual
+      void
+      setExecutor(const std::shared_ptr<Executor>& executor) = 0;
+
+      /**
+       * Set an executor function for asynchronous and parallel tasks.
+       *
+       * This is equivalent to setting a FunctionExecutor which runs
+       * tasks with @c executor, such as an event loop.
+       *
+       * @param executor the executor function, or an empty function
+       * to use the default.
+       */
+      virtual
+      void
+      setExecutor(const executor_type& executor) = 0;
+
+      /**
+       * Get the executor for asynchronous and parallel tasks.
+       *
+       * @returns the executor; null if using the default.
+       */
+      virtual
+      const std::shared_ptr<Executor>&
+      getExecutor() const = 0;
+
       /**
        * Specifies whether or not to save proprietary metadata
        * in the MetadataStore.
@@ -745,7 +1404,7 @@ namespace ome
        * @returns a list of filenames.
        */
       virtual
-      const std::vector<boost::filesystem::path>
+      const std::vector<boost::filesystem::path>&
       getUsedFiles(bool noPixels = false) const = 0;
 
       /**
@@ -756,7 +1415,7 @@ namespace ome
        * @returns a list of filenames.
        */
       virtual
-      const std::vector<boost::filesystem::path>
+      const std::vector<boost::filesystem::path>&
       getSeriesUsedFiles(bool noPixels = false) const = 0;
 
       /**
@@ -1267,6 +1926,67 @@ namespace ome
       virtual
       void
       setFlattenedResolutions(bool flatten) = 0;
+
+      /**
+       * Create a new reader for the currently open dataset.
+       *
+       * The new reader shares the parsed state of this reader, such
+       * as the core metadata, metadata store and plane tables,
+       * rather than parsing the dataset again, but opens its own
+       * files, and has its own current series, resolution and
+       * plane.  This is much cheaper than calling setId() on a new
+       * reader, and permits each thread to read using its own
+       * reader.  The shared state must not be modified while in
+       * use by several readers.  Any metadata skipped by a
+       * pixels-only open is filled before cloning.
+       *
+       * @returns the new reader.
+       * @throws std::logic_error if the reader is not initialized,
+       *   or the reader does not support cloning.
+       * @throws FormatException if the files could not be opened.
+       */
+      virtual
+      std::shared_ptr<FormatReader>
+      clone() const = 0;
+
+      /**
+       * Get the TIFF directory holding an image plane.
+       *
+       * This permits the compressed data of the plane to be copied
+       * to a TIFF writer without decoding it (see
+       * FormatWriter::copyBytes()).
+       *
+       * @param plane the plane index within the current series.
+       * @returns the IFD, or null if the plane is not stored as a
+       *   TIFF IFD.
+       * @throws std::logic_error if the plane index is invalid.
+       */
+      virtual
+      std::shared_ptr<const tiff::IFD>
+      getPlaneIFD(dimension_size_type plane) const = 0;
+
+      /**
+       * Obtain a single decoded tile of an image plane.
+       *
+       * The tile is shared with the decoded tile cache of TIFF
+       * readers where set (see in::MinimalTIFFReader::setTileCache()),
+       * so repeated access to the same tile does not decode it
+       * again, and no copy is made into a pixel buffer.  The tile geometry (region, sample and
+       * buffer layout) is described by the TileInfo of the plane
+       * IFD (see getPlaneIFD() and tiff::IFD::readTile()).
+       *
+       * @param plane the plane index within the current series.
+       * @param tile the tile index within the plane.
+       * @returns the decoded tile; this must not be modified.
+       * @throws std::logic_error if the plane index is invalid, or
+       *   if the plane is not stored as tiles or strips.
+       * @throws FormatException or tiff::Exception if the tile index
+       *   is invalid or the tile could not be read.
+       */
+      virtual
+      std::shared_ptr<const TileBuffer>
+      openTile(dimension_size_type plane,
+               dimension_size_type tile) const = 0;
     };
 
   }
@@ -361,6 +361,106 @@ namespace ome
 #  pragma GCC diagnostic pop
 #endif
 
+    DimensionIndexMapper::DimensionIndexMapper():
+      order(),
+      sizes{{0U, 0U, 0U}},
+      moduloSizes{{1U, 1U, 1U}},
+      strides{{0U, 0U, 0U}},
+      num(0U)
+    {
+    }
+
+    DimensionIndexMapper::DimensionIndexMapper(const std::string& order,
+                                               dimension_size_type zSize,
+                                               dimension_size_type cSize,
+                                               dimension_size_type tSize,
+                                               dimension_size_type num):
+      DimensionIndexMapper(order, zSize, cSize, tSize, 1U, 1U, 1U, num)
+    {
+    }
+
+    DimensionIndexMapper::DimensionIndexMapper(const std::string& order,
+                                               dimension_size_type zSize,
+                                               dimension_size_type cSize,
+                                               dimension_size_type tSize,
+                                               dimension_size_type moduloZSize,
+                                               dimension_size_type moduloCSize,
+                                               dimension_size_type moduloTSize,
+                                               dimension_size_type num):
+      order(order),
+      sizes{{zSize, cSize, tSize}},
+      moduloSizes{{moduloZSize, moduloCSize, moduloTSize}},
+      strides(),
+      num(num)
+    {
+      dimension_size_type iz, it, ic;
+      validate_dimensions(order, zSize, cSize, tSize, num, iz, ic, it);
+
+      if (!moduloZSize)
+        throw_exception('Z', "modulo size", moduloZSize);
+      if (!moduloCSize)
+        throw_exception('C', "modulo size", moduloCSize);
+      if (!moduloTSize)
+        throw_exception('T', "modulo size", moduloTSize);
+
+      // Stride of each dimension in rasterization order.
+      const dimension_size_type len0 = iz == 0 ? zSize : (ic == 0 ? cSize : tSize);
+      const dimension_size_type len1 = iz == 1 ? zSize : (ic == 1 ? cSize : tSize);
+      const dimension_size_type rstrides[3] = { 1U, len0, len0 * len1 };
+      strides[0] = rstrides[iz];
+      strides[1] = rstrides[ic];
+      strides[2] = rstrides[it];
+    }
+
+    dimension_size_type
+    DimensionIndexMapper::getIndex(dimension_size_type z,
+                                   dimension_size_type c,
+                                   dimension_size_type t) const
+    {
+      if (z >= sizes[0])
+        throw_exception('Z', "index", z, sizes[0]);
+      if (t >= sizes[2])
+        throw_exception('T', "index", t, sizes[2]);
+      if (c >= sizes[1])
+        throw_exception('C', "index", c, sizes[1]);
+
+      return (z * strides[0]) + (c * strides[1]) + (t * strides[2]);
+    }
+
+    std::array<dimension_size_type, 3>
+    DimensionIndexMapper::getZCTCoords(dimension_size_type index) const
+    {
+      if (index >= num)
+	{
+	  boost::format fmt("Invalid index: %1%");
+	  fmt % index;
+	  throw std::out_of_range(fmt.str());
+	}
+
+      std::array<dimension_size_type, 3> ret;
+      ret[0] = index / strides[0] % sizes[0]; // z
+      ret[1] = index / strides[1] % sizes[1]; // c
+      ret[2] = index / strides[2] % sizes[2]; // t
+
+      return ret;
+    }
+
+    std::array<dimension_size_type, 6>
+    DimensionIndexMapper::getZCTModuloCoords(dimension_size_type index) const
+    {
+      std::array<dimension_size_type, 3> coords(getZCTCoords(index));
+
+      std::array<dimension_size_type, 6> ret;
+      ret[0] = coords[0] / moduloSizes[0];
+      ret[1] = coords[1] / moduloSizes[1];
+      ret[2] = coords[2] / moduloSizes[2];
+      ret[3] = coords[0] % moduloSizes[0];
+      ret[4] = coords[1] % moduloSizes[1];
+      ret[5] = coords[2] % moduloSizes[2];
+
+      return ret;
+    }
+
     dimension_size_type
     getIndex(const std::string& order,
              dimension_size_type zSize,
@@ -371,24 +471,7 @@ namespace ome
              dimension_size_type c,
              dimension_size_type t)
     {
-      dimension_size_type iz, it, ic;
-      validate_dimensions(order, zSize, cSize, tSize, num, iz, ic, it);
-
-      if (z >= zSize)
-        throw_exception('Z', "index", z, zSize);
-      if (t >= tSize)
-        throw_exception('T', "index", t, tSize);
-      if (c >= cSize)
-        throw_exception('C', "index", c, cSize);
-
-      // assign rasterization order
-      dimension_size_type v0 = iz == 0 ? z : (ic == 0 ? c : t);
-      dimension_size_type v1 = iz == 1 ? z : (ic == 1 ? c : t);
-      dimension_size_type v2 = iz == 2 ? z : (ic == 2 ? c : t);
-      dimension_size_type len0 = iz == 0 ? zSize : (ic == 0 ? cSize : tSize);
-      dimension_size_type len1 = iz == 1 ? zSize : (ic == 1 ? cSize : tSize);
-
-      return v0 + (v1 * len0) + (v2 * len0 * len1);
+      return DimensionIndexMapper(order, zSize, cSize, tSize, num).getIndex(z, c, t);
     }
 
     dimension_size_type
@@ -407,15 +490,11 @@ namespace ome
              dimension_size_type moduloC,
              dimension_size_type moduloT)
     {
-      return getIndex(order,
-                      zSize,
-                      cSize,
-                      tSize,
-                      num,
-                      (z * moduloZSize) + moduloZ,
-                      (c * moduloCSize) + moduloC,
-                      (t * moduloTSize) + moduloT);
-
+      return DimensionIndexMapper(order,
+                                  zSize, cSize, tSize,
+                                  moduloZSize, moduloCSize, moduloTSize,
+                                  num).getIndex(z, c, t,
+                                                moduloZ, moduloC, moduloT);
     }
 
     std::array<dimension_size_type, 3>
@@ -433,22 +512,7 @@ namespace ome
 	  throw std::out_of_range(fmt.str());
 	}
 
-      dimension_size_type iz = 0, it = 0, ic = 0;
-      validate_dimensions(order, zSize, cSize, tSize, num, iz, ic, it);
-
-      // assign rasterization order
-      dimension_size_type len0 = iz == 0 ? zSize : (ic == 0 ? cSize : tSize);
-      dimension_size_type len1 = iz == 1 ? zSize : (ic == 1 ? cSize : tSize);
-      dimension_size_type v0 = index % len0;
-      dimension_size_type v1 = index / len0 % len1;
-      dimension_size_type v2 = index / len0 / len1;
-
-      std::array<dimension_size_type, 3> ret;
-      ret[0] = iz == 0 ? v0 : (iz == 1 ? v1 : v2); // z
-      ret[1] = ic == 0 ? v0 : (ic == 1 ? v1 : v2); // c
-      ret[2] = it == 0 ? v0 : (it == 1 ? v1 : v2); // t
-
-      return ret;
+      return DimensionIndexMapper(order, zSize, cSize, tSize, num).getZCTCoords(index);
     }
 
     std::array<dimension_size_type, 6>
@@ -462,23 +526,17 @@ namespace ome
                  dimension_size_type num,
                  dimension_size_type index)
     {
-      std::array<dimension_size_type, 3> coords
-        (getZCTCoords(order,
-                      zSize,
-                      cSize,
-                      tSize,
-                      num,
-                      index));
-
-      std::array<dimension_size_type, 6> ret;
-      ret[0] = coords[0] / moduloZSize;
-      ret[1] = coords[1] / moduloCSize;
-      ret[2] = coords[2] / moduloTSize;
-      ret[3] = coords[0] % moduloZSize;
-      ret[4] = coords[1] % moduloCSize;
-      ret[5] = coords[2] % moduloTSize;
+      if (index >= num)
+	{
+	  boost::format fmt("Invalid index: %1%");
+	  fmt % index;
+	  throw std::out_of_range(fmt.str());
+	}
 
-      return ret;
+      return DimensionIndexMapper(order,
+                                  zSize, cSize, tSize,
+                                  moduloZSize, moduloCSize, moduloTSize,
+                                  num).getZCTModuloCoords(index);
     }
 
   }
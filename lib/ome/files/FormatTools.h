@@ -40,6 +40,7 @@
 
 #include <array>
 #include <string>
+#include <vector>
 
 #include <ome/files/Types.h>
 
@@ -225,6 +226,379 @@ namespace ome
                  dimension_size_type num,
                  dimension_size_type index);
 
+    /**
+     * Mapping between rasterized plane indexes and ZCT coordinates.
+     *
+     * This performs the same conversions as ome::files::getIndex()
+     * and ome::files::getZCTCoords(), but the dimension order and
+     * sizes are parsed and validated once, on construction, leaving
+     * only arithmetic for each conversion.  Construct once per
+     * series and reuse for each plane.
+     *
+     * The @c Z, @c C and @c T sizes are real sizes.  Modulo
+     * coordinates are effective sizes, as for the equivalent
+     * functions.
+     */
+    class DimensionIndexMapper
+    {
+    public:
+      /**
+       * Constructor.
+       *
+       * The default mapper has no planes, and matches no dimensions.
+       */
+      DimensionIndexMapper();
+
+      /**
+       * Construct from dimension order and sizes.
+       *
+       * @param order dimension order.
+       * @param zSize total number of focal planes (real size).
+       * @param cSize total number of channels (real size).
+       * @param tSize total number of time points (real size).
+       * @param num total number of image planes (zSize * cSize * tSize),
+       *   specified as a consistency check.
+       * @throws std::logic_error if the order or image count are
+       * invalid, or std::out_of_range if a size is invalid.
+       */
+      DimensionIndexMapper(const std::string& order,
+                           dimension_size_type zSize,
+                           dimension_size_type cSize,
+                           dimension_size_type tSize,
+                           dimension_size_type num);
+
+      /**
+       * Construct from dimension order, sizes and modulo sizes.
+       *
+       * @param order dimension order.
+       * @param zSize total number of focal planes (real size).
+       * @param cSize total number of channels (real size).
+       * @param tSize total number of time points (real size).
+       * @param moduloZSize total number of ModuloZ planes (real size).
+       * @param moduloCSize total number of ModuloC channels (real size).
+       * @param moduloTSize total number of ModuloT time points (real size).
+       * @param num total number of image planes (zSize * cSize * tSize),
+       *   specified as a consistency check.
+       * @throws std::logic_error if the order or image count are
+       * invalid, or std::out_of_range if a size is invalid.
+       */
+      DimensionIndexMapper(const std::string& order,
+                           dimension_size_type zSize,
+                           dimension_size_type cSize,
+                           dimension_size_type tSize,
+                           dimension_size_type moduloZSize,
+                           dimension_size_type moduloCSize,
+                           dimension_size_type moduloTSize,
+                           dimension_size_type num);
+
+      /**
+       * Check if this mapper was constructed from the specified
+       * dimensions.
+       *
+       * Use to check if a cached mapper is still current.
+       *
+       * @param order dimension order.
+       * @param zSize total number of focal planes (real size).
+       * @param cSize total number of channels (real size).
+       * @param tSize total number of time points (real size).
+       * @param moduloZSize total number of ModuloZ planes (real size).
+       * @param moduloCSize total number of ModuloC channels (real size).
+       * @param moduloTSize total number of ModuloT time points (real size).
+       * @param num total number of image planes.
+       * @returns @c true if the dimensions match, @c false otherwise.
+       */
+      bool
+      matches(const std::string& order,
+              dimension_size_type zSize,
+              dimension_size_type cSize,
+              dimension_size_type tSize,
+              dimension_size_type moduloZSize,
+              dimension_size_type moduloCSize,
+              dimension_size_type moduloTSize,
+              dimension_size_type num) const
+      {
+        return num == this->num && num &&
+          zSize == sizes[0] && cSize == sizes[1] && tSize == sizes[2] &&
+          moduloZSize == moduloSizes[0] &&
+          moduloCSize == moduloSizes[1] &&
+          moduloTSize == moduloSizes[2] &&
+          order == this->order;
+      }
+
+      /**
+       * Get the dimension order.
+       *
+       * @returns the dimension order.
+       */
+      const std::string&
+      getDimensionOrder() const
+      {
+        return order;
+      }
+
+      /**
+       * Get the total number of image planes.
+       *
+       * @returns the image count.
+       */
+      dimension_size_type
+      getImageCount() const
+      {
+        return num;
+      }
+
+      /**
+       * Get the rasterized index corresponding to the given @c Z, @c C
+       * and @c T coordinates (real sizes).
+       *
+       * @param z the @c Z coordinate (real size).
+       * @param c the @c C coordinate (real size).
+       * @param t the @c T coordinate (real size).
+       * @returns the 1D index.
+       * @throws std::out_of_range if a coordinate is invalid.
+       */
+      dimension_size_type
+      getIndex(dimension_size_type z,
+               dimension_size_type c,
+               dimension_size_type t) const;
+
+      /**
+       * Get the rasterized index corresponding to the given @c Z, @c C,
+       * @c T, @c ModuloZ, @c ModuloC and @c ModuloT coordinates
+       * (effective sizes).
+       *
+       * @param z the @c Z coordinate (effective size).
+       * @param c the @c C coordinate (effective size).
+       * @param t the @c T coordinate (effective size).
+       * @param moduloZ the @c ModuloZ coordinate (effective size).
+       * @param moduloC the @c ModuloC coordinate (effective size).
+       * @param moduloT the @c ModuloT coordinate (effective size).
+       * @returns the 1D index.
+       * @throws std::out_of_range if a coordinate is invalid.
+       */
+      dimension_size_type
+      getIndex(dimension_size_type z,
+               dimension_size_type c,
+               dimension_size_type t,
+               dimension_size_type moduloZ,
+               dimension_size_type moduloC,
+               dimension_size_type moduloT) const
+      {
+        return getIndex((z * moduloSizes[0]) + moduloZ,
+                        (c * moduloSizes[1]) + moduloC,
+                        (t * moduloSizes[2]) + moduloT);
+      }
+
+      /**
+       * Get the @c Z, @c C and @c T coordinates (real sizes)
+       * corresponding to the given rasterized index value.
+       *
+       * @param index 1D (rasterized) index to convert to ZCT coordinates.
+       * @returns an array containing the ZCT coordinates (real sizes,
+       * in that order).
+       * @throws std::out_of_range if the index is invalid.
+       */
+      std::array<dimension_size_type, 3>
+      getZCTCoords(dimension_size_type index) const;
+
+      /**
+       * Get the @c Z, @c C, @c T, @c ModuloZ, @c ModuloC and @c
+       * ModuloT coordinates (effective sizes) corresponding to the
+       * given rasterized index value.
+       *
+       * @param index 1D (rasterized) index to convert to ZCTmZmCmT
+       * coordinates.
+       * @returns an array containing the ZCTmZmCmT coordinates
+       * (effective sizes, in that order).
+       * @throws std::out_of_range if the index is invalid.
+       */
+      std::array<dimension_size_type, 6>
+      getZCTModuloCoords(dimension_size_type index) const;
+
+    private:
+      /// Dimension order.
+      std::string order;
+      /// @c Z, @c C and @c T sizes.
+      std::array<dimension_size_type, 3> sizes;
+      /// @c ModuloZ, @c ModuloC and @c ModuloT sizes.
+      std::array<dimension_size_type, 3> moduloSizes;
+      /// @c Z, @c C and @c T index strides.
+      std::array<dimension_size_type, 3> strides;
+      /// Total number of image planes.
+      dimension_size_type num;
+    };
+
+    /**
+     * Mapping between rasterized plane indexes and ZCT coordinates
+     * for a dimension order fixed at compile time.
+     *
+     * This is equivalent to DimensionIndexMapper, but the order of
+     * the dimensions is a template parameter, so the conversions may
+     * be fully inlined.  Use the DimensionIndexMapperXYZCT and
+     * related typedefs, for code specialised for a particular
+     * dimension order.
+     *
+     * @tparam D0 the fastest-varying dimension after X and Y.
+     * @tparam D1 the second dimension after X and Y.
+     * @tparam D2 the slowest-varying dimension.
+     */
+    template<char D0, char D1, char D2>
+    class FixedDimensionIndexMapper
+    {
+      static_assert((D0 == 'Z' || D0 == 'C' || D0 == 'T') &&
+                    (D1 == 'Z' || D1 == 'C' || D1 == 'T') &&
+                    (D2 == 'Z' || D2 == 'C' || D2 == 'T') &&
+                    D0 != D1 && D0 != D2 && D1 != D2,
+                    "Dimensions must be a permutation of Z, C and T");
+
+    public:
+      /**
+       * Construct from dimension sizes.
+       *
+       * @param zSize total number of focal planes (real size).
+       * @param cSize total number of channels (real size).
+       * @param tSize total number of time points (real size).
+       * @param moduloZSize total number of ModuloZ planes (real size).
+       * @param moduloCSize total number of ModuloC channels (real size).
+       * @param moduloTSize total number of ModuloT time points (real size).
+       * @param num total number of image planes (zSize * cSize * tSize),
+       *   specified as a consistency check.
+       * @throws std::logic_error if the image count is invalid, or
+       * std::out_of_range if a size is invalid.
+       */
+      FixedDimensionIndexMapper(dimension_size_type zSize,
+                                dimension_size_type cSize,
+                                dimension_size_type tSize,
+                                dimension_size_type moduloZSize,
+                                dimension_size_type moduloCSize,
+                                dimension_size_type moduloTSize,
+                                dimension_size_type num):
+        mapper(std::string{'X', 'Y', D0, D1, D2},
+               zSize, cSize, tSize,
+               moduloZSize, moduloCSize, moduloTSize,
+               num),
+        sizes{{zSize, cSize, tSize}},
+        moduloSizes{{moduloZSize, moduloCSize, moduloTSize}}
+      {}
+
+      /**
+       * Construct from dimension sizes.
+       *
+       * @param zSize total number of focal planes (real size).
+       * @param cSize total number of channels (real size).
+       * @param tSize total number of time points (real size).
+       * @param num total number of image planes (zSize * cSize * tSize),
+       *   specified as a consistency check.
+       * @throws std::logic_error if the image count is invalid, or
+       * std::out_of_range if a size is invalid.
+       */
+      FixedDimensionIndexMapper(dimension_size_type zSize,
+                                dimension_size_type cSize,
+                                dimension_size_type tSize,
+                                dimension_size_type num):
+        FixedDimensionIndexMapper(zSize, cSize, tSize, 1U, 1U, 1U, num)
+      {}
+
+      /**
+       * Get the equivalent runtime mapper.
+       *
+       * @returns the mapper.
+       */
+      const DimensionIndexMapper&
+      getMapper() const
+      {
+        return mapper;
+      }
+
+      /// @copydoc DimensionIndexMapper::getIndex(dimension_size_type,dimension_size_type,dimension_size_type) const
+      dimension_size_type
+      getIndex(dimension_size_type z,
+               dimension_size_type c,
+               dimension_size_type t) const
+      {
+        if (z >= sizes[0] || c >= sizes[1] || t >= sizes[2])
+          return mapper.getIndex(z, c, t); // throws
+        const std::array<dimension_size_type, 3> v{{z, c, t}};
+        return v[axis(D0)] +
+          (sizes[axis(D0)] * (v[axis(D1)] + (sizes[axis(D1)] * v[axis(D2)])));
+      }
+
+      /// @copydoc DimensionIndexMapper::getIndex(dimension_size_type,dimension_size_type,dimension_size_type,dimension_size_type,dimension_size_type,dimension_size_type) const
+      dimension_size_type
+      getIndex(dimension_size_type z,
+               dimension_size_type c,
+               dimension_size_type t,
+               dimension_size_type moduloZ,
+               dimension_size_type moduloC,
+               dimension_size_type moduloT) const
+      {
+        return getIndex((z * moduloSizes[0]) + moduloZ,
+                        (c * moduloSizes[1]) + moduloC,
+                        (t * moduloSizes[2]) + moduloT);
+      }
+
+      /// @copydoc DimensionIndexMapper::getZCTCoords(dimension_size_type) const
+      std::array<dimension_size_type, 3>
+      getZCTCoords(dimension_size_type index) const
+      {
+        if (index >= mapper.getImageCount())
+          return mapper.getZCTCoords(index); // throws
+        std::array<dimension_size_type, 3> ret;
+        ret[axis(D0)] = index % sizes[axis(D0)];
+        index /= sizes[axis(D0)];
+        ret[axis(D1)] = index % sizes[axis(D1)];
+        ret[axis(D2)] = index / sizes[axis(D1)];
+        return ret;
+      }
+
+      /// @copydoc DimensionIndexMapper::getZCTModuloCoords(dimension_size_type) const
+      std::array<dimension_size_type, 6>
+      getZCTModuloCoords(dimension_size_type index) const
+      {
+        const std::array<dimension_size_type, 3> coords(getZCTCoords(index));
+        std::array<dimension_size_type, 6> ret;
+        for (std::array<dimension_size_type, 3>::size_type i = 0; i < 3; ++i)
+          {
+            ret[i] = coords[i] / moduloSizes[i];
+            ret[i + 3] = coords[i] % moduloSizes[i];
+          }
+        return ret;
+      }
+
+    private:
+      /**
+       * Get the array position of a dimension.
+       *
+       * @param dim the dimension.
+       * @returns the position in a ZCT array.
+       */
+      static constexpr std::array<dimension_size_type, 3>::size_type
+      axis(char dim)
+      {
+        return dim == 'Z' ? 0U : (dim == 'C' ? 1U : 2U);
+      }
+
+      /// Runtime mapper, for validation and errors.
+      DimensionIndexMapper mapper;
+      /// @c Z, @c C and @c T sizes.
+      std::array<dimension_size_type, 3> sizes;
+      /// @c ModuloZ, @c ModuloC and @c ModuloT sizes.
+      std::array<dimension_size_type, 3> moduloSizes;
+    };
+
+    /// Fixed mapper for XYZCT dimension order.
+    typedef FixedDimensionIndexMapper<'Z', 'C', 'T'> DimensionIndexMapperXYZCT;
+    /// Fixed mapper for XYZTC dimension order.
+    typedef FixedDimensionIndexMapper<'Z', 'T', 'C'> DimensionIndexMapperXYZTC;
+    /// Fixed mapper for XYCTZ dimension order.
+    typedef FixedDimensionIndexMapper<'C', 'T', 'Z'> DimensionIndexMapperXYCTZ;
+    /// Fixed mapper for XYCZT dimension order.
+    typedef FixedDimensionIndexMapper<'C', 'Z', 'T'> DimensionIndexMapperXYCZT;
+    /// Fixed mapper for XYTCZ dimension order.
+    typedef FixedDimensionIndexMapper<'T', 'C', 'Z'> DimensionIndexMapperXYTCZ;
+    /// Fixed mapper for XYTZC dimension order.
+    typedef FixedDimensionIndexMapper<'T', 'Z', 'C'> DimensionIndexMapperXYTZC;
+
   }
 }
 
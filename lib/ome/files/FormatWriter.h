@@ -50,8 +50,10 @@
 #include <ome/files/CoreMetadata.h>
 #include <ome/files/FileInfo.h>
 #include <ome/files/FormatHandler.h>
+#include <ome/files/IOStatistics.h>
 #include <ome/files/MetadataConfigurable.h>
 #include <ome/files/MetadataMap.h>
+#include <ome/files/PixelStatistics.h>
 #include <ome/files/Types.h>
 
 #include <ome/xml/meta/MetadataRetrieve.h>
@@ -61,6 +63,9 @@ namespace ome
   namespace files
   {
 
+    class Executor;
+    class FormatReader;
+    class MemoryBudget;
     class VariantPixelBuffer;
 
     /**
@@ -168,6 +173,127 @@ namespace ome
                 dimension_size_type w,
                 dimension_size_type h) = 0;
 
+      /**
+       * Save an image plane from a typed pixel buffer.
+       *
+       * @copydetails saveBytes(dimension_size_type,std::shared_ptr<PixelBuffer<T>>&,dimension_size_type,dimension_size_type,dimension_size_type,dimension_size_type)
+       */
+      template<typename T>
+      void
+      saveBytes(dimension_size_type              plane,
+                std::shared_ptr<PixelBuffer<T>>& buf)
+      {
+        VariantPixelBuffer vbuf(buf);
+        saveBytes(plane, vbuf);
+      }
+
+      /**
+       * Save a sub-image of an image plane from a typed pixel
+       * buffer.
+       *
+       * As for saveBytes(), but for callers which know the pixel
+       * type at compile time.  The buffer is used directly as the
+       * source, without being copied into a buffer of another type.
+       *
+       * @param plane the plane index within the series.
+       * @param buf the source pixel buffer.
+       * @param x the @c X coordinate of the upper-left corner of the sub-image.
+       * @param y the @c Y coordinate of the upper-left corner of the sub-image.
+       * @param w the width of the sub-image.
+       * @param h the height of the sub-image.
+       * @throws FormatException if any of the parameters are invalid,
+       *   including a pixel type other than that of the series.
+       */
+      template<typename T>
+      void
+      saveBytes(dimension_size_type              plane,
+                std::shared_ptr<PixelBuffer<T>>& buf,
+                dimension_size_type              x,
+                dimension_size_type              y,
+                dimension_size_type              w,
+                dimension_size_type              h)
+      {
+        VariantPixelBuffer vbuf(buf);
+        saveBytes(plane, vbuf, x, y, w, h);
+      }
+
+      /**
+       * Save a block of image planes.
+       *
+       * Write several planes from a single VariantPixelBuffer, for
+       * example a whole Z stack.  The @c Z, @c T and @c C extents of
+       * the buffer are the size of the block, and @p plane is the
+       * plane at the origin of the block; the other planes are
+       * written at the corresponding @c Z, @c C and @c T coordinates
+       * of the current series.  The planes are written in ascending
+       * plane order, and are otherwise as for saveBytes().  A
+       * writer may prepare later planes while earlier planes are
+       * being written.
+       *
+       * The @c X, @c Y and subchannel dimensions of the buffer must
+       * be stored contiguously, which is the case for all storage
+       * orders created by PixelBufferBase::make_storage_order().
+       * The modulo dimensions must have a size of one.
+       *
+       * @param plane the index of the first plane of the block.
+       * @param buf the source pixel buffer.
+       * @throws FormatException if any of the parameters are invalid.
+       */
+      virtual
+      void
+      savePlanes(dimension_size_type plane,
+                 VariantPixelBuffer& buf) = 0;
+
+      /**
+       * Save an image with several subchannels as separate channels.
+       *
+       * This is the inverse of FormatReader::openMergedBytes().
+       * Each subchannel of @p buf is written as the plane of the
+       * corresponding channel at the @c Z and @c T coordinates of
+       * @p plane, for example to split an RGB image into separately
+       * stored red, green and blue channels.  The subchannel count
+       * must equal getEffectiveSizeC(), and each channel must have
+       * a single subchannel.  Planar subchannels are written
+       * directly from @p buf; interleaved subchannels are
+       * deinterleaved in a single pass.  The channel planes are
+       * then written as a block of planes (see savePlanes()).
+       *
+       * @param plane the plane index of any channel at the @c Z and
+       * @c T coordinates to write.
+       * @param buf the source pixel buffer.
+       * @throws FormatException if any of the parameters are invalid.
+       */
+      virtual
+      void
+      saveSeparatedBytes(dimension_size_type plane,
+                         VariantPixelBuffer& buf) = 0;
+
+      /**
+       * Save an image plane copied from a reader.
+       *
+       * Write a plane of the current series of @p reader to the
+       * current series in the current file.  If both the reader and
+       * the writer store the plane as a TIFF IFD with the same
+       * compression, tile size, pixel type and planar
+       * configuration, the compressed tiles are copied without
+       * decoding and encoding them again (see
+       * tiff::IFD::canCopyRawTiles()).  Otherwise, the plane is
+       * read with openBytes() and written with saveBytes().
+       *
+       * @param plane the plane index within the series.
+       * @param reader the reader to copy from.
+       * @param sourcePlane the plane index within the current
+       *   series of the reader.
+       * @returns @c true if the compressed tiles were copied, or
+       *   @c false if the plane was decoded and encoded again.
+       * @throws FormatException if any of the parameters are invalid.
+       */
+      virtual
+      bool
+      copyBytes(dimension_size_type plane,
+                const FormatReader& reader,
+                dimension_size_type sourcePlane) = 0;
+
       /**
        * Set the active series.
        *
@@ -342,6 +468,58 @@ namespace ome
       const boost::optional<std::string>&
       getCompression() const = 0;
 
+      /**
+       * Set the compression level to use when writing.
+       *
+       * The level is specific to the compression type, for example
+       * the Deflate or Zstandard level, LZMA preset or JPEG quality.
+       * It is checked against the compression type when writing;
+       * compression types which do not support a level will fail.
+       *
+       * @param level the codec-specific compression level or
+       * quality.
+       */
+      virtual
+      void
+      setCompressionLevel(int level) = 0;
+
+      /**
+       * Get the compression level to use when writing.
+       *
+       * @returns the compression level; unset for the codec default.
+       */
+      virtual
+      const boost::optional<int>&
+      getCompressionLevel() const = 0;
+
+      /**
+       * Set predictor use when writing.
+       *
+       * If enabled, a predictor suitable for the pixel type is
+       * applied prior to compression, for example horizontal
+       * differencing for integer pixel types or floating point
+       * prediction for floating point pixel types.  This can
+       * substantially improve the compression ratio of smoothly
+       * varying image data.  It is checked against the compression
+       * type and pixel type when writing; combinations which do not
+       * support a predictor will fail.
+       *
+       * @param predictor @c true to enable a predictor, @c false to
+       * disable.
+       */
+      virtual
+      void
+      setPredictor(bool predictor) = 0;
+
+      /**
+       * Get predictor use when writing.
+       *
+       * @returns the predictor setting; @c false if unset.
+       */
+      virtual
+      const boost::optional<bool>&
+      getPredictor() const = 0;
+
       /**
        * Set subchannel interleaving.
        *
@@ -447,6 +625,331 @@ namespace ome
       virtual
       dimension_size_type
       getTileSizeY() const = 0;
+
+      /**
+       * Set the expected access profile.
+       *
+       * If set, and the tile size has not been set with
+       * setTileSizeX() and setTileSizeY(), writers which support
+       * tiles choose the tile or strip geometry best suited to
+       * reading the data with this access pattern, taking the pixel
+       * type, number of samples and compression into account.  If
+       * unset, a fixed default tile or strip size is used.  This
+       * must be set prior to calling setId().
+       *
+       * @param profile the expected access profile, or unset to use
+       * the default tile size.
+       */
+      virtual
+      void
+      setAccessProfile(const boost::optional<AccessProfile>& profile) = 0;
+
+      /**
+       * Get the expected access profile.
+       *
+       * @returns the expected access profile, or unset if not
+       * specified.
+       */
+      virtual
+      const boost::optional<AccessProfile>&
+      getAccessProfile() const = 0;
+
+      /**
+       * Set the number of threads to use for encoding pixel data.
+       *
+       * Writers which support parallel encoding will compress image
+       * tiles or strips using up to this number of threads.  Writers
+       * which do not support parallel encoding, or which are using
+       * a compression type which can not be encoded in parallel,
+       * will ignore this setting.
+       *
+       * @param threads the maximum number of encoding threads; 0 is
+       * treated as 1.
+       */
+      virtual
+      void
+      setEncodeThreads(dimension_size_type threads) = 0;
+
+      /**
+       * Get the number of threads to use for encoding pixel data.
+       *
+       * @returns the maximum number of encoding threads (default 1).
+       */
+      virtual
+      dimension_size_type
+      getEncodeThreads() const = 0;
+
+      /**
+       * Set the executor for parallel tasks.
+       *
+       * Writers which encode in parallel (see setEncodeThreads())
+       * or build sub-resolutions in the background run this work as
+       * tasks on the executor.  The default is to use the executor
+       * shared by all readers and writers (see defaultExecutor()).
+       * This must be set before calling setId().
+       *
+       * @param executor the executor, or null to use the default.
+       */
+      virtual
+      void
+      setExecutor(const std::shared_ptr<Executor>& executor) = 0;
+
+      /**
+       * Get the executor for parallel tasks.
+       *
+       * @returns the executor; null if using the default.
+       */
+      virtual
+      const std::shared_ptr<Executor>&
+      getExecutor() const = 0;
+
+      /**
+       * Set whether to elide empty tiles.
+       *
+       * Writers which support it will not store tiles which are
+       * entirely zero, which saves space and encoding time for
+       * images with large empty areas, such as plate and mosaic
+       * exports.  For TIFF writers, the resulting sparse files may
+       * not be readable by other software.  This must be set prior
+       * to calling setId().
+       *
+       * @param sparse @c true to elide empty tiles, @c false to
+       * store all tiles (default).
+       */
+      virtual
+      void
+      setSparseTiles(bool sparse) = 0;
+
+      /**
+       * Get whether to elide empty tiles.
+       *
+       * @returns @c true if empty tiles are elided, @c false otherwise.
+       */
+      virtual
+      bool
+      getSparseTiles() const = 0;
+
+      /**
+       * Set whether to pack samples.
+       *
+       * Writers which support it will store @c UINT16 samples with
+       * fewer significant bits (see getBitsPerPixel()) packed at
+       * this bit depth, without padding between samples, rather
+       * than as whole 16-bit samples.  For TIFF writers, depths of
+       * 10, 12 and 14 bits are packed, saving up to 37.5% of the
+       * uncompressed size; other depths are stored unpacked.  Packed
+       * samples may not be used with a predictor.  @c FLOAT samples
+       * with 16 significant bits are stored in half precision,
+       * halving the uncompressed size.  This must be set prior to
+       * calling setId().
+       *
+       * @param pack @c true to pack samples, @c false to store
+       * whole samples (default).
+       */
+      virtual
+      void
+      setPackSamples(bool pack) = 0;
+
+      /**
+       * Get whether to pack samples.
+       *
+       * @returns @c true if samples are packed, @c false otherwise.
+       */
+      virtual
+      bool
+      getPackSamples() const = 0;
+
+      /**
+       * Set whether to record tile statistics.
+       *
+       * Writers which support it will record the minimum, maximum
+       * and mean sample value of each tile as it is written, so that
+       * readers may skip tiles below a threshold without reading
+       * them.  For TIFF writers, the statistics are stored in a
+       * private tag.  This must be set prior to calling setId().
+       *
+       * @param record @c true to record tile statistics, @c false
+       * otherwise (default).
+       */
+      virtual
+      void
+      setRecordTileStatistics(bool record) = 0;
+
+      /**
+       * Get whether to record tile statistics.
+       *
+       * @returns @c true if tile statistics are recorded, @c false
+       * otherwise.
+       */
+      virtual
+      bool
+      getRecordTileStatistics() const = 0;
+
+      /**
+       * Set whether to record tile checksums.
+       *
+       * Writers which support it will record a checksum of the
+       * stored data of each tile as it is written, so that readers
+       * may verify it (see FormatReader::setVerifyTileChecksums()).
+       * For TIFF writers, CRC-32C checksums of the stored tiles are
+       * kept in a private tag; uncompressed tiles and compression
+       * schemes with a tile codec are supported, and saving with
+       * other schemes throws an exception.  This must be set prior
+       * to calling setId().
+       *
+       * @param record @c true to record tile checksums, @c false
+       * otherwise (default).
+       */
+      virtual
+      void
+      setRecordTileChecksums(bool record) = 0;
+
+      /**
+       * Get whether to record tile checksums.
+       *
+       * @returns @c true if tile checksums are recorded, @c false
+       * otherwise.
+       */
+      virtual
+      bool
+      getRecordTileChecksums() const = 0;
+
+      /**
+       * Set the I/O statistics.
+       *
+       * The bytes written, tiles encoded and time spent in each stage are
+       * accumulated in these statistics, which may be shared between
+       * several writers to accumulate totals.  This must be set
+       * prior to calling setId().
+       *
+       * @param statistics the statistics to use; if null, new
+       * statistics are created.
+       */
+      virtual
+      void
+      setStatistics(const std::shared_ptr<IOStatistics>& statistics) = 0;
+
+      /**
+       * Get the I/O statistics.
+       *
+       * @returns the statistics (never null).
+       */
+      virtual
+      const std::shared_ptr<IOStatistics>&
+      getStatistics() const = 0;
+
+      /**
+       * Enable or disable pixel statistics.
+       *
+       * If enabled, the minimum, maximum and histogram of each
+       * subchannel are accumulated for each channel as planes are
+       * saved.  Writers which support it accumulate the statistics
+       * while the samples are packed into tiles or strips, rather
+       * than with a separate pass over the pixel data, and store
+       * the minimum and maximum in the metadata when closed.
+       * Disabled by default.
+       *
+       * @param enabled @c true to accumulate pixel statistics.
+       */
+      virtual
+      void
+      setPixelStatisticsEnabled(bool enabled) = 0;
+
+      /**
+       * Check if pixel statistics are enabled.
+       *
+       * @returns @c true if pixel statistics are accumulated.
+       */
+      virtual
+      bool
+      getPixelStatisticsEnabled() const = 0;
+
+      /**
+       * Get the pixel statistics of a channel in the current series.
+       *
+       * The statistics cover all the planes of the channel saved
+       * until now.  They are discarded when the writer is closed.
+       *
+       * @param channel the channel index within the series.
+       * @returns the statistics, or null if no planes of the
+       * channel have been saved with pixel statistics enabled.
+       */
+      virtual
+      std::shared_ptr<const PixelStatistics>
+      getPixelStatistics(dimension_size_type channel) const = 0;
+
+      /**
+       * Set the memory limit for pixel data pending write.
+       *
+       * Writers which buffer partially written tiles or strips
+       * until they are complete will spill the least recently used
+       * tiles to a temporary scratch file if their total size
+       * exceeds this limit.  This permits writing very large images
+       * in arbitrary order without holding most of the image in
+       * memory.  Writers which do not buffer pixel data will ignore
+       * this setting.
+       *
+       * @param limit the memory limit (bytes), or 0 for no limit.
+       */
+      virtual
+      void
+      setWriteCacheLimit(dimension_size_type limit) = 0;
+
+      /**
+       * Get the memory limit for pixel data pending write.
+       *
+       * @returns the memory limit (bytes), or 0 if there is no
+       * limit (default).
+       */
+      virtual
+      dimension_size_type
+      getWriteCacheLimit() const = 0;
+
+      /**
+       * Set the directory for scratch files.
+       *
+       * @param dir the directory in which to create scratch files
+       * for pixel data spilled from memory; if empty, the system
+       * temporary directory is used (the default).
+       */
+      virtual
+      void
+      setWriteCacheDirectory(const boost::filesystem::path& dir) = 0;
+
+      /**
+       * Get the directory for scratch files.
+       *
+       * @returns the directory in which to create scratch files.
+       */
+      virtual
+      const boost::filesystem::path&
+      getWriteCacheDirectory() const = 0;
+
+      /**
+       * Set the memory budget.
+       *
+       * Writers account the pixel data they buffer to the budget.
+       * Partially written tiles or strips are spilled to the scratch
+       * file while the budget is exceeded, as for the write cache
+       * limit, and the buffers used to generate sub-resolutions are
+       * allocated from the budget.  Writers which do not buffer
+       * pixel data will ignore this setting.
+       *
+       * @param budget the memory budget, or null for none (the
+       * default).
+       */
+      virtual
+      void
+      setMemoryBudget(const std::shared_ptr<MemoryBudget>& budget) = 0;
+
+      /**
+       * Get the memory budget.
+       *
+       * @returns the memory budget, or null if none.
+       */
+      virtual
+      const std::shared_ptr<MemoryBudget>&
+      getMemoryBudget() const = 0;
     };
 
   }
@@ -0,0 +1,125 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+
+#include <ome/files/IOStatistics.h>
+
+namespace ome
+{
+  namespace files
+  {
+
+    const std::size_t IOStatistics::counter_count;
+    const std::size_t IOStatistics::stage_count;
+
+    IOStatistics::IOStatistics():
+      counters(),
+      times()
+    {
+      reset();
+    }
+
+    IOStatistics::~IOStatistics()
+    {
+    }
+
+    void
+    IOStatistics::reset()
+    {
+      for (auto& counter : counters)
+        counter.store(0U, std::memory_order_relaxed);
+      for (auto& time : times)
+        time.store(0, std::memory_order_relaxed);
+    }
+
+    const char *
+    IOStatistics::name(Counter counter)
+    {
+      static const char *names[counter_count] =
+        {
+          "bytes read",
+          "bytes written",
+          "tiles decoded",
+          "tiles encoded",
+          "tile cache hits",
+          "tile cache misses",
+          "directory switches",
+          "sparse tiles",
+          "directories written",
+          "checksums verified",
+          "minor page faults",
+          "major page faults"
+        };
+      return names[counter];
+    }
+
+    const char *
+    IOStatistics::name(Stage stage)
+    {
+      static const char *names[stage_count] =
+        {
+          "directory",
+          "read",
+          "decode",
+          "encode",
+          "write",
+          "transfer"
+        };
+      return names[stage];
+    }
+
+    std::ostream&
+    operator<< (std::ostream&       os,
+                const IOStatistics& statistics)
+    {
+      for (std::size_t i = 0U; i < IOStatistics::counter_count; ++i)
+        {
+          IOStatistics::Counter counter = static_cast<IOStatistics::Counter>(i);
+          os << IOStatistics::name(counter) << ": " << statistics.get(counter) << '\n';
+        }
+      for (std::size_t i = 0U; i < IOStatistics::stage_count; ++i)
+        {
+          IOStatistics::Stage stage = static_cast<IOStatistics::Stage>(i);
+          os << IOStatistics::name(stage) << " time: "
+             << std::chrono::duration<double, std::milli>(statistics.getTime(stage)).count()
+             << " ms\n";
+        }
+      return os;
+    }
+
+  }
+}
@@ -0,0 +1,276 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+
+#ifndef OME_FILES_IOSTATISTICS_H
+#define OME_FILES_IOSTATISTICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+namespace ome
+{
+  namespace files
+  {
+
+    /**
+     * I/O and codec statistics.
+     *
+     * Counts the bytes read and written, tiles decoded and encoded,
+     * decoded tile cache hits and misses and directory switches, and
+     * the time spent in each stage of reading and writing.  These are
+     * accumulated by the TIFF layer on behalf of readers and writers,
+     * to determine where the time is spent when reading or writing
+     * an image.
+     *
+     * Counters are updated atomically with relaxed ordering, so may
+     * be updated concurrently by several threads, and the overhead is
+     * small enough to leave enabled.  A single instance may be shared
+     * between several readers, writers or TIFF instances to
+     * accumulate totals.
+     */
+    class IOStatistics
+    {
+    public:
+      /// Counters.
+      enum Counter
+        {
+          BYTES_READ,        ///< Encoded tile and strip bytes read.
+          BYTES_WRITTEN,     ///< Encoded tile and strip bytes written.
+          TILES_DECODED,     ///< Tiles and strips decoded.
+          TILES_ENCODED,     ///< Tiles and strips encoded.
+          TILE_CACHE_HITS,   ///< Decoded tile cache hits.
+          TILE_CACHE_MISSES, ///< Decoded tile cache misses.
+          DIRECTORY_SWITCHES, ///< Changes of libtiff handle directory.
+          SPARSE_TILES,      ///< Empty tiles and strips elided or zero-filled.
+          DIRECTORIES_WRITTEN, ///< Directories written.
+          CHECKSUMS_VERIFIED, ///< Tile and strip checksums verified.
+          MINOR_PAGE_FAULTS, ///< Minor page faults copying from mapped files.
+          MAJOR_PAGE_FAULTS  ///< Major page faults copying from mapped files.
+        };
+
+      /// Number of counters.
+      static const std::size_t counter_count = MAJOR_PAGE_FAULTS + 1U;
+
+      /// Processing stages.
+      enum Stage
+        {
+          STAGE_DIRECTORY, ///< Reading, switching and writing directories.
+          STAGE_READ,      ///< Reading raw tile data, where separate from decoding.
+          STAGE_DECODE,    ///< Decoding, including reading if done by libtiff.
+          STAGE_ENCODE,    ///< Encoding, including writing if done by libtiff.
+          STAGE_WRITE,     ///< Writing raw tile data, where separate from encoding.
+          STAGE_TRANSFER   ///< Copying between tiles and pixel buffers.
+        };
+
+      /// Number of stages.
+      static const std::size_t stage_count = STAGE_TRANSFER + 1U;
+
+      /// Clock used for timing.
+      typedef std::chrono::steady_clock clock_type;
+
+      /// Duration type.
+      typedef std::chrono::nanoseconds duration_type;
+
+      /**
+       * Scoped stage timer.
+       *
+       * The time from construction to destruction is added to the
+       * stage.
+       */
+      class Timer
+      {
+      public:
+        /**
+         * Constructor.
+         *
+         * @param statistics the statistics to update.
+         * @param stage the stage to time.
+         */
+        Timer(IOStatistics& statistics,
+              Stage         stage):
+          statistics(statistics),
+          stage(stage),
+          start(clock_type::now())
+        {}
+
+        /// Destructor.
+        ~Timer()
+        {
+          statistics.addTime(stage, std::chrono::duration_cast<duration_type>(clock_type::now() - start));
+        }
+
+        /// @cond SKIP
+        Timer (const Timer&) = delete;
+
+        Timer&
+        operator= (const Timer&) = delete;
+        /// @endcond SKIP
+
+      private:
+        /// Statistics to update.
+        IOStatistics&         statistics;
+        /// Stage being timed.
+        Stage                 stage;
+        /// Start time.
+        clock_type::time_point start;
+      };
+
+      /// Constructor.
+      IOStatistics();
+
+      /// Destructor.
+      ~IOStatistics();
+
+      /// @cond SKIP
+      IOStatistics (const IOStatistics&) = delete;
+
+      IOStatistics&
+      operator= (const IOStatistics&) = delete;
+      /// @endcond SKIP
+
+      /**
+       * Increment a counter.
+       *
+       * @param counter the counter to increment.
+       * @param value the amount to add.
+       */
+      void
+      add(Counter  counter,
+          uint64_t value = 1U)
+      {
+        counters[counter].fetch_add(value, std::memory_order_relaxed);
+      }
+
+      /**
+       * Get a counter value.
+       *
+       * @param counter the counter to get.
+       * @returns the counter value.
+       */
+      uint64_t
+      get(Counter counter) const
+      {
+        return counters[counter].load(std::memory_order_relaxed);
+      }
+
+      /**
+       * Add time spent in a stage.
+       *
+       * @param stage the stage to update.
+       * @param time the time to add.
+       */
+      void
+      addTime(Stage         stage,
+              duration_type time)
+      {
+        times[stage].fetch_add(time.count(), std::memory_order_relaxed);
+      }
+
+      /**
+       * Get the time spent in a stage.
+       *
+       * Where several threads are used, this is the total time
+       * spent by all threads, and may exceed the elapsed time.
+       *
+       * @param stage the stage to get.
+       * @returns the total time.
+       */
+      duration_type
+      getTime(Stage stage) const
+      {
+        return duration_type(times[stage].load(std::memory_order_relaxed));
+      }
+
+      /**
+       * Reset all counters and times to zero.
+       */
+      void
+      reset();
+
+      /**
+       * Get the name of a counter.
+       *
+       * @param counter the counter.
+       * @returns the name.
+       */
+      static const char *
+      name(Counter counter);
+
+      /**
+       * Get the name of a stage.
+       *
+       * @param stage the stage.
+       * @returns the name.
+       */
+      static const char *
+      name(Stage stage);
+
+    private:
+      /// Counter values.
+      std::array<std::atomic<uint64_t>, counter_count> counters;
+      /// Stage times (nanoseconds).
+      std::array<std::atomic<duration_type::rep>, stage_count> times;
+    };
+
+    /**
+     * Output IOStatistics to output stream.
+     *
+     * All counters and stage times (in milliseconds) are output.
+     *
+     * @param os the output stream.
+     * @param statistics the statistics to output.
+     * @returns the output stream.
+     */
+    std::ostream&
+    operator<< (std::ostream&       os,
+                const IOStatistics& statistics);
+
+  }
+}
+
+#endif // OME_FILES_IOSTATISTICS_H
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
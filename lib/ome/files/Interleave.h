@@ -0,0 +1,210 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#ifndef OME_FILES_INTERLEAVE_H
+#define OME_FILES_INTERLEAVE_H
+
+#include <algorithm>
+
+#include <ome/files/Types.h>
+
+namespace ome
+{
+  namespace files
+  {
+
+    namespace detail
+    {
+
+      /**
+       * Interleave a fixed number of samples.
+       *
+       * The sample count is a compile-time constant so that the
+       * inner loop is fully unrolled, allowing the compiler to
+       * vectorize the loop using its interleaving store support.
+       *
+       * @param src the planar source data.
+       * @param stride the distance between source sample planes.
+       * @param count the number of pixels to interleave.
+       * @param dest the contiguous destination data.
+       */
+      template<typename T, dimension_size_type N>
+      inline void
+      interleave(const T             *src,
+                 dimension_size_type  stride,
+                 dimension_size_type  count,
+                 T                   *dest)
+      {
+        for (dimension_size_type i = 0; i < count; ++i)
+          for (dimension_size_type s = 0; s < N; ++s)
+            dest[(i * N) + s] = src[(s * stride) + i];
+      }
+
+      /**
+       * Deinterleave a fixed number of samples.
+       *
+       * @param src the contiguous source data.
+       * @param count the number of pixels to deinterleave.
+       * @param dest the planar destination data.
+       * @param stride the distance between destination sample planes.
+       */
+      template<typename T, dimension_size_type N>
+      inline void
+      deinterleave(const T             *src,
+                   dimension_size_type  count,
+                   T                   *dest,
+                   dimension_size_type  stride)
+      {
+        for (dimension_size_type i = 0; i < count; ++i)
+          for (dimension_size_type s = 0; s < N; ++s)
+            dest[(s * stride) + i] = src[(i * N) + s];
+      }
+
+    }
+
+    /**
+     * Interleave planar samples.
+     *
+     * Convert from planar (separate) sample layout, where each
+     * sample is stored in a separate plane, to contiguous (chunky)
+     * layout, where the samples for each pixel are adjacent.  Two,
+     * three and four samples, as used for greyscale with alpha, RGB
+     * and RGBA images, use specialised kernels; other sample counts
+     * use a generic loop.
+     *
+     * The source and destination must not overlap.
+     *
+     * @param src the planar source data.
+     * @param stride the distance between source sample planes, in
+     * elements.
+     * @param samples the number of samples per pixel.
+     * @param count the number of pixels to interleave.
+     * @param dest the contiguous destination data; this must have
+     * space for @c count × @c samples elements.
+     */
+    template<typename T>
+    inline void
+    interleave(const T             *src,
+               dimension_size_type  stride,
+               dimension_size_type  samples,
+               dimension_size_type  count,
+               T                   *dest)
+    {
+      switch(samples)
+        {
+        case 1:
+          std::copy(src, src + count, dest);
+          break;
+        case 2:
+          detail::interleave<T, 2>(src, stride, count, dest);
+          break;
+        case 3:
+          detail::interleave<T, 3>(src, stride, count, dest);
+          break;
+        case 4:
+          detail::interleave<T, 4>(src, stride, count, dest);
+          break;
+        default:
+          for (dimension_size_type s = 0; s < samples; ++s)
+            {
+              const T *plane = src + (s * stride);
+              for (dimension_size_type i = 0; i < count; ++i)
+                dest[(i * samples) + s] = plane[i];
+            }
+          break;
+        }
+    }
+
+    /**
+     * Deinterleave contiguous samples.
+     *
+     * Convert from contiguous (chunky) sample layout to planar
+     * (separate) sample layout.  This is the inverse of
+     * interleave().
+     *
+     * The source and destination must not overlap.
+     *
+     * @param src the contiguous source data.
+     * @param samples the number of samples per pixel.
+     * @param count the number of pixels to deinterleave.
+     * @param dest the planar destination data.
+     * @param stride the distance between destination sample planes,
+     * in elements.
+     */
+    template<typename T>
+    inline void
+    deinterleave(const T             *src,
+                 dimension_size_type  samples,
+                 dimension_size_type  count,
+                 T                   *dest,
+                 dimension_size_type  stride)
+    {
+      switch(samples)
+        {
+        case 1:
+          std::copy(src, src + count, dest);
+          break;
+        case 2:
+          detail::deinterleave<T, 2>(src, count, dest, stride);
+          break;
+        case 3:
+          detail::deinterleave<T, 3>(src, count, dest, stride);
+          break;
+        case 4:
+          detail::deinterleave<T, 4>(src, count, dest, stride);
+          break;
+        default:
+          for (dimension_size_type s = 0; s < samples; ++s)
+            {
+              T *plane = dest + (s * stride);
+              for (dimension_size_type i = 0; i < count; ++i)
+                plane[i] = src[(i * samples) + s];
+            }
+          break;
+        }
+    }
+
+  }
+}
+
+#endif // OME_FILES_INTERLEAVE_H
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
@@ -0,0 +1,249 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+
+#include <algorithm>
+#include <cmath>
+
+#include <ome/files/LockStatistics.h>
+
+namespace
+{
+
+  // Registered lock sites.
+  struct SiteRegistry
+  {
+    std::mutex                          mutex;
+    std::vector<ome::files::LockSite *> sites;
+  };
+
+  SiteRegistry&
+  siteRegistry()
+  {
+    static SiteRegistry registry;
+    return registry;
+  }
+
+}
+
+namespace ome
+{
+  namespace files
+  {
+
+    const std::size_t LockHistogram::bucket_count;
+
+    std::atomic<bool> LockSite::enabled(false);
+
+    LockHistogram::LockHistogram():
+      buckets(),
+      sum()
+    {
+      reset();
+    }
+
+    void
+    LockHistogram::add(duration_type time)
+    {
+      uint64_t ns = time.count() > 0 ? static_cast<uint64_t>(time.count()) : 0U;
+      std::size_t bucket = 0U;
+      while (ns > 1U && bucket < bucket_count - 1U)
+        {
+          ns >>= 1U;
+          ++bucket;
+        }
+      buckets[bucket].fetch_add(1U, std::memory_order_relaxed);
+      sum.fetch_add(time.count(), std::memory_order_relaxed);
+    }
+
+    uint64_t
+    LockHistogram::count() const
+    {
+      uint64_t total = 0U;
+      for (const auto& bucket : buckets)
+        total += bucket.load(std::memory_order_relaxed);
+      return total;
+    }
+
+    LockHistogram::duration_type
+    LockHistogram::total() const
+    {
+      return duration_type(sum.load(std::memory_order_relaxed));
+    }
+
+    uint64_t
+    LockHistogram::bucket(std::size_t bucket) const
+    {
+      return buckets.at(bucket).load(std::memory_order_relaxed);
+    }
+
+    LockHistogram::duration_type
+    LockHistogram::bucketLimit(std::size_t bucket)
+    {
+      if (bucket >= bucket_count - 1U)
+        return duration_type::max();
+      return duration_type(static_cast<duration_type::rep>(uint64_t(1U) << (bucket + 1U)));
+    }
+
+    LockHistogram::duration_type
+    LockHistogram::percentile(double percentile) const
+    {
+      std::array<uint64_t, bucket_count> counts;
+      uint64_t total = 0U;
+      for (std::size_t i = 0; i < bucket_count; ++i)
+        {
+          counts[i] = buckets[i].load(std::memory_order_relaxed);
+          total += counts[i];
+        }
+      if (!total)
+        return duration_type::zero();
+
+      double clamped = std::min(std::max(percentile, 0.0), 100.0);
+      uint64_t rank = std::max(static_cast<uint64_t>(std::ceil(clamped / 100.0 * static_cast<double>(total))),
+                               static_cast<uint64_t>(1U));
+      uint64_t seen = 0U;
+      for (std::size_t i = 0; i < bucket_count; ++i)
+        {
+          seen += counts[i];
+          if (seen >= rank)
+            return bucketLimit(i);
+        }
+      return bucketLimit(bucket_count - 1U);
+    }
+
+    void
+    LockHistogram::reset()
+    {
+      for (auto& bucket : buckets)
+        bucket.store(0U, std::memory_order_relaxed);
+      sum.store(0, std::memory_order_relaxed);
+    }
+
+    LockSite::LockSite(const char *name):
+      name(name),
+      waitTimes(),
+      holdTimes()
+    {
+      SiteRegistry& registry(siteRegistry());
+      std::lock_guard<std::mutex> lock(registry.mutex);
+      registry.sites.push_back(this);
+    }
+
+    LockSite::~LockSite()
+    {
+      SiteRegistry& registry(siteRegistry());
+      std::lock_guard<std::mutex> lock(registry.mutex);
+      registry.sites.erase(std::remove(registry.sites.begin(), registry.sites.end(), this),
+                           registry.sites.end());
+    }
+
+    const char *
+    LockSite::getName() const
+    {
+      return name;
+    }
+
+    LockHistogram&
+    LockSite::wait()
+    {
+      return waitTimes;
+    }
+
+    const LockHistogram&
+    LockSite::wait() const
+    {
+      return waitTimes;
+    }
+
+    LockHistogram&
+    LockSite::hold()
+    {
+      return holdTimes;
+    }
+
+    const LockHistogram&
+    LockSite::hold() const
+    {
+      return holdTimes;
+    }
+
+    void
+    LockSite::setEnabled(bool enabled)
+    {
+      LockSite::enabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    std::vector<const LockSite *>
+    LockSite::sites()
+    {
+      SiteRegistry& registry(siteRegistry());
+      std::lock_guard<std::mutex> lock(registry.mutex);
+      return std::vector<const LockSite *>(registry.sites.begin(), registry.sites.end());
+    }
+
+    void
+    LockSite::resetAll()
+    {
+      SiteRegistry& registry(siteRegistry());
+      std::lock_guard<std::mutex> lock(registry.mutex);
+      for (auto site : registry.sites)
+        {
+          site->wait().reset();
+          site->hold().reset();
+        }
+    }
+
+    std::ostream&
+    operator<< (std::ostream&   os,
+                const LockSite& site)
+    {
+      typedef std::chrono::duration<double, std::micro> us;
+
+      os << site.getName() << ": "
+         << "wait count " << site.wait().count()
+         << " total " << us(site.wait().total()).count() << " us"
+         << " p50 " << us(site.wait().percentile(50.0)).count() << " us"
+         << " p99 " << us(site.wait().percentile(99.0)).count() << " us; "
+         << "hold count " << site.hold().count()
+         << " total " << us(site.hold().total()).count() << " us"
+         << " p50 " << us(site.hold().percentile(50.0)).count() << " us"
+         << " p99 " << us(site.hold().percentile(99.0)).count() << " us";
+      return os;
+    }
+
+  }
+}
@@ -0,0 +1,384 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+
+#ifndef OME_FILES_LOCKSTATISTICS_H
+#define OME_FILES_LOCKSTATISTICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace ome
+{
+  namespace files
+  {
+
+    /**
+     * Histogram of lock wait or hold times.
+     *
+     * Times are counted in power of two nanosecond buckets, so that
+     * both uncontended (tens of nanoseconds) and heavily contended
+     * (milliseconds or more) acquisitions are represented.  Bucket
+     * @c i counts times less than 2<sup>i+1</sup> ns and at least
+     * 2<sup>i</sup> ns (bucket 0 includes zero); the last bucket
+     * counts all longer times.  Updates are atomic with relaxed
+     * ordering.
+     */
+    class LockHistogram
+    {
+    public:
+      /// Duration type.
+      typedef std::chrono::nanoseconds duration_type;
+
+      /// Number of buckets.
+      static const std::size_t bucket_count = 40U;
+
+      /// Constructor.
+      LockHistogram();
+
+      /// @cond SKIP
+      LockHistogram (const LockHistogram&) = delete;
+
+      LockHistogram&
+      operator= (const LockHistogram&) = delete;
+      /// @endcond SKIP
+
+      /**
+       * Add a time.
+       *
+       * @param time the time to add.
+       */
+      void
+      add(duration_type time);
+
+      /**
+       * Get the number of times added.
+       *
+       * @returns the count.
+       */
+      uint64_t
+      count() const;
+
+      /**
+       * Get the sum of all times added.
+       *
+       * @returns the total time.
+       */
+      duration_type
+      total() const;
+
+      /**
+       * Get the count for a bucket.
+       *
+       * @param bucket the bucket index.
+       * @returns the count.
+       */
+      uint64_t
+      bucket(std::size_t bucket) const;
+
+      /**
+       * Get the exclusive upper limit of a bucket.
+       *
+       * @param bucket the bucket index.
+       * @returns the upper limit.
+       */
+      static duration_type
+      bucketLimit(std::size_t bucket);
+
+      /**
+       * Estimate a percentile.
+       *
+       * This is the upper limit of the bucket containing the
+       * percentile, and so is accurate to within a factor of two.
+       *
+       * @param percentile the percentile (0–100).
+       * @returns the estimated time, or zero if no times have been
+       * added.
+       */
+      duration_type
+      percentile(double percentile) const;
+
+      /// Reset all counts to zero.
+      void
+      reset();
+
+    private:
+      /// Bucket counts.
+      std::array<std::atomic<uint64_t>, bucket_count> buckets;
+      /// Total time (nanoseconds).
+      std::atomic<duration_type::rep> sum;
+    };
+
+    /**
+     * Lock call site.
+     *
+     * Each site accumulates histograms of the time spent waiting to
+     * acquire, and the time spent holding, a lock at a particular
+     * place in the code.  Sites register themselves on construction,
+     * and are typically function-local statics, for example:
+     *
+     * @code
+     * static LockSite site("tiff::IFD::readImage");
+     * Sentry sentry(*tiff, site);
+     * @endcode
+     *
+     * Timing is disabled by default, in which case the cost per
+     * lock is a single relaxed atomic load.  When enabled with
+     * setEnabled(), each lock costs three additional clock reads.
+     */
+    class LockSite
+    {
+    public:
+      /// Clock used for timing.
+      typedef std::chrono::steady_clock clock_type;
+
+      /**
+       * Constructor.
+       *
+       * @param name the name of the site; this must remain valid
+       * for the lifetime of the site (typically a string literal).
+       */
+      explicit
+      LockSite(const char *name);
+
+      /// Destructor.
+      ~LockSite();
+
+      /// @cond SKIP
+      LockSite (const LockSite&) = delete;
+
+      LockSite&
+      operator= (const LockSite&) = delete;
+      /// @endcond SKIP
+
+      /**
+       * Get the site name.
+       *
+       * @returns the name.
+       */
+      const char *
+      getName() const;
+
+      /**
+       * Get the wait time histogram.
+       *
+       * @returns the time spent waiting to acquire the lock.
+       */
+      LockHistogram&
+      wait();
+
+      /**
+       * Get the wait time histogram.
+       *
+       * @returns the time spent waiting to acquire the lock.
+       */
+      const LockHistogram&
+      wait() const;
+
+      /**
+       * Get the hold time histogram.
+       *
+       * @returns the time spent holding the lock.
+       */
+      LockHistogram&
+      hold();
+
+      /**
+       * Get the hold time histogram.
+       *
+       * @returns the time spent holding the lock.
+       */
+      const LockHistogram&
+      hold() const;
+
+      /**
+       * Enable or disable lock timing for all sites.
+       *
+       * @param enabled @c true to enable, @c false to disable.
+       */
+      static void
+      setEnabled(bool enabled);
+
+      /**
+       * Check if lock timing is enabled.
+       *
+       * @returns @c true if enabled, @c false otherwise.
+       */
+      static bool
+      isEnabled()
+      {
+        return enabled.load(std::memory_order_relaxed);
+      }
+
+      /**
+       * Get all registered sites.
+       *
+       * @returns the sites, in order of registration.
+       */
+      static std::vector<const LockSite *>
+      sites();
+
+      /// Reset the histograms of all registered sites.
+      static void
+      resetAll();
+
+    private:
+      /// Site name.
+      const char *name;
+      /// Wait time histogram.
+      LockHistogram waitTimes;
+      /// Hold time histogram.
+      LockHistogram holdTimes;
+      /// Timing enabled for all sites.
+      static std::atomic<bool> enabled;
+    };
+
+    /**
+     * Timed scoped lock.
+     *
+     * This is equivalent to std::unique_lock, but records the wait
+     * and hold times at the specified site when lock timing is
+     * enabled.
+     *
+     * @tparam Mutex the mutex type.
+     */
+    template<typename Mutex>
+    class TimedLock
+    {
+    public:
+      /**
+       * Constructor.
+       *
+       * No mutex is associated with the lock.
+       */
+      TimedLock():
+        lock(),
+        site(nullptr),
+        acquired()
+      {}
+
+      /**
+       * Constructor.
+       *
+       * Lock the mutex.
+       *
+       * @param mutex the mutex to lock.
+       * @param site the site to record the lock times.
+       */
+      TimedLock(Mutex&    mutex,
+                LockSite& site):
+        lock(mutex, std::defer_lock),
+        site(LockSite::isEnabled() ? &site : nullptr),
+        acquired()
+      {
+        if (this->site)
+          {
+            LockSite::clock_type::time_point start(LockSite::clock_type::now());
+            lock.lock();
+            acquired = LockSite::clock_type::now();
+            this->site->wait().add(std::chrono::duration_cast<LockHistogram::duration_type>(acquired - start));
+          }
+        else
+          lock.lock();
+      }
+
+      /// Destructor.
+      ~TimedLock()
+      {
+        if (lock.owns_lock())
+          unlock();
+      }
+
+      /// @cond SKIP
+      TimedLock (const TimedLock&) = delete;
+
+      TimedLock&
+      operator= (const TimedLock&) = delete;
+      /// @endcond SKIP
+
+      /**
+       * Unlock the mutex.
+       *
+       * The mutex must be locked.
+       */
+      void
+      unlock()
+      {
+        lock.unlock();
+        if (site)
+          site->hold().add(std::chrono::duration_cast<LockHistogram::duration_type>(LockSite::clock_type::now() - acquired));
+      }
+
+    private:
+      /// The lock.
+      std::unique_lock<Mutex> lock;
+      /// Site to record times, or null if not timing.
+      LockSite *site;
+      /// Time of acquisition.
+      LockSite::clock_type::time_point acquired;
+    };
+
+    /**
+     * Output LockSite to output stream.
+     *
+     * The site name, and the count, total and 50th and 99th
+     * percentiles of the wait and hold times are output.
+     *
+     * @param os the output stream.
+     * @param site the site to output.
+     * @returns the output stream.
+     */
+    std::ostream&
+    operator<< (std::ostream&   os,
+                const LockSite& site);
+
+  }
+}
+
+#endif // OME_FILES_LOCKSTATISTICS_H
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
@@ -0,0 +1,174 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+
+#include <new>
+#include <stdexcept>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/format.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+
+#include <ome/files/MappedFileAllocator.h>
+
+namespace ome
+{
+  namespace files
+  {
+
+    MappedFileAllocator::MappedFileAllocator(const boost::filesystem::path& path,
+                                             Mode                           mode):
+      PixelAllocator(),
+      path(path),
+      mode(mode),
+      mutex(),
+      mappings()
+    {
+    }
+
+    MappedFileAllocator::~MappedFileAllocator()
+    {
+      // Storage is normally released before the allocator, since
+      // buffers retain the allocator; this only applies if
+      // deallocate() was not called.
+      for (auto& mapping : mappings)
+        {
+          mapping.second.file->close();
+          if (!mapping.second.path.empty())
+            {
+              boost::system::error_code ec;
+              boost::filesystem::remove(mapping.second.path, ec);
+            }
+        }
+    }
+
+    void *
+    MappedFileAllocator::allocate(std::size_t size,
+                                  std::size_t alignment)
+    {
+      if (alignment > static_cast<std::size_t>(boost::iostreams::mapped_file::alignment()))
+        throw std::bad_alloc();
+
+      std::lock_guard<std::mutex> lock(mutex);
+
+      boost::filesystem::path file(path);
+      if (mode == TARGET)
+        {
+          if (!mappings.empty())
+            {
+              boost::format fmt("Target file ‘%1%’ is already mapped");
+              fmt % path.string();
+              throw std::logic_error(fmt.str());
+            }
+        }
+      else
+        file = path / boost::filesystem::unique_path("ome-files-%%%%-%%%%-%%%%-%%%%.pixels");
+
+      // Creating the file with its new size zero-fills it, and
+      // leaves it sparse where supported.
+      boost::iostreams::mapped_file_params params(file.string());
+      params.flags = boost::iostreams::mapped_file::readwrite;
+      params.new_file_size = static_cast<boost::iostreams::stream_offset>(size);
+
+      Mapping mapping;
+      mapping.file = std::make_shared<boost::iostreams::mapped_file>(params);
+      if (mode == SCRATCH)
+        {
+          // The mapping remains valid after removal where the
+          // system permits removing open files; otherwise, remove
+          // the file on deallocation.
+          boost::system::error_code ec;
+          boost::filesystem::remove(file, ec);
+          if (ec)
+            mapping.path = file;
+        }
+
+      void *data = mapping.file->data();
+      mappings.insert(std::make_pair(data, mapping));
+      return data;
+    }
+
+    void
+    MappedFileAllocator::deallocate(void        *ptr,
+                                    std::size_t  /* size */,
+                                    std::size_t  /* alignment */)
+    {
+      Mapping mapping;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto found = mappings.find(ptr);
+        if (found == mappings.end())
+          return;
+        mapping = found->second;
+        mappings.erase(found);
+      }
+
+      // Unmapping a target file writes back any modified pages.
+      mapping.file->close();
+      if (!mapping.path.empty())
+        {
+          boost::system::error_code ec;
+          boost::filesystem::remove(mapping.path, ec);
+        }
+    }
+
+    bool
+    MappedFileAllocator::zeroInitialized() const
+    {
+      return true;
+    }
+
+    const boost::filesystem::path&
+    MappedFileAllocator::getPath() const
+    {
+      return path;
+    }
+
+    MappedFileAllocator::Mode
+    MappedFileAllocator::getMode() const
+    {
+      return mode;
+    }
+
+  }
+}
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
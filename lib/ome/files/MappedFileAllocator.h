@@ -0,0 +1,197 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+
+#ifndef OME_FILES_MAPPEDFILEALLOCATOR_H
+#define OME_FILES_MAPPEDFILEALLOCATOR_H
+
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include <boost/filesystem/path.hpp>
+
+#include <ome/files/PixelAllocator.h>
+
+namespace boost
+{
+  namespace iostreams
+  {
+    class mapped_file;
+  }
+}
+
+namespace ome
+{
+  namespace files
+  {
+
+    /**
+     * File-backed memory resource for pixel buffer storage.
+     *
+     * Pixel storage is allocated by memory-mapping a file, so that
+     * buffers larger than the available memory may be used, for
+     * example to read a whole stitched plane with
+     * FormatReader::openBytes() and save it with
+     * FormatWriter::saveBytes().  Pages are read from and written
+     * to the file by the operating system on demand, so only the
+     * pages in use need be resident; the remainder are written
+     * back to the file when memory is needed.
+     *
+     * Two modes of use are supported:
+     *
+     * - SCRATCH: each allocation creates a new file in a scratch
+     *   directory, which is removed when the storage is released
+     *   (and immediately where the system permits removing open
+     *   files, so that it is not left behind if the process
+     *   exits).
+     * - TARGET: each allocation maps a single named target file,
+     *   which is created (or truncated) with the size of the
+     *   storage.  The file is retained when the storage is
+     *   released, containing the raw pixel data in native byte
+     *   order and the storage order of the buffer.  Only one
+     *   allocation may exist at a time.
+     *
+     * New files are created sparse, where supported by the
+     * filesystem, and so storage is zero-filled (see
+     * zeroInitialized()).  Note that a buffer which is reallocated
+     * with the same allocator, for example by openBytes() with a
+     * different region size, releases its previous storage.
+     *
+     * This class is thread-safe.
+     */
+    class MappedFileAllocator : public PixelAllocator
+    {
+    public:
+      /// Mode of use.
+      enum Mode
+        {
+          SCRATCH, ///< Temporary files in a scratch directory.
+          TARGET   ///< A single named target file.
+        };
+
+      /**
+       * Constructor.
+       *
+       * @param path the scratch directory (SCRATCH), or the target
+       * file (TARGET).
+       * @param mode the mode of use.
+       */
+      explicit
+      MappedFileAllocator(const boost::filesystem::path& path,
+                          Mode                           mode = SCRATCH);
+
+      /// Destructor.
+      virtual
+      ~MappedFileAllocator();
+
+      /**
+       * Allocate storage.
+       *
+       * @param size the size of the storage, in bytes.
+       * @param alignment the required alignment of the storage, in
+       * bytes; this may not exceed the system page size.
+       * @returns a pointer to the mapped storage.
+       * @throws std::bad_alloc if the alignment is not supported,
+       * std::logic_error if an allocation already exists in TARGET
+       * mode, or another exception if the file can't be created or
+       * mapped.
+       */
+      void *
+      allocate(std::size_t size,
+               std::size_t alignment);
+
+      // Documented in superclass.
+      void
+      deallocate(void        *ptr,
+                 std::size_t  size,
+                 std::size_t  alignment);
+
+      /**
+       * Check if newly allocated storage is zero-filled.
+       *
+       * @returns @c true; storage is backed by a new file.
+       */
+      bool
+      zeroInitialized() const;
+
+      /**
+       * Get the scratch directory or target file.
+       *
+       * @returns the path.
+       */
+      const boost::filesystem::path&
+      getPath() const;
+
+      /**
+       * Get the mode of use.
+       *
+       * @returns the mode.
+       */
+      Mode
+      getMode() const;
+
+    private:
+      /// A mapped file.
+      struct Mapping
+      {
+        /// The mapping.
+        std::shared_ptr<boost::iostreams::mapped_file> file;
+        /// The file path (empty if already removed).
+        boost::filesystem::path path;
+      };
+
+      /// Scratch directory or target file.
+      boost::filesystem::path path;
+      /// Mode of use.
+      Mode mode;
+      /// Lock for the mappings.
+      std::mutex mutex;
+      /// Current mappings, by address.
+      std::map<void *, Mapping> mappings;
+    };
+
+  }
+}
+
+#endif // OME_FILES_MAPPEDFILEALLOCATOR_H
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
@@ -0,0 +1,262 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <limits>
+#include <stdexcept>
+
+#include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/format.hpp>
+
+#include <ome/files/Memo.h>
+
+namespace fs = boost::filesystem;
+
+namespace
+{
+
+  // Identifies a memo file.
+  const std::string memo_magic("OME-Files memo");
+
+}
+
+namespace ome
+{
+  namespace files
+  {
+
+    MemoWriter::MemoWriter(const std::string& format):
+      format(format),
+      sources(),
+      sourceCount(0U),
+      content()
+    {
+      content << std::setprecision(std::numeric_limits<double>::max_digits10);
+    }
+
+    void
+    MemoWriter::addSource(const boost::filesystem::path& file)
+    {
+      if (!fs::exists(file))
+        {
+          boost::format fmt("Memo source file %1% does not exist");
+          fmt % file.string();
+          throw std::runtime_error(fmt.str());
+        }
+
+      const std::string name(file.string());
+      sources << name.size() << '\n' << name << '\n'
+              << static_cast<uint64_t>(fs::file_size(file)) << '\n'
+              << static_cast<uint64_t>(fs::last_write_time(file)) << '\n';
+      ++sourceCount;
+    }
+
+    void
+    MemoWriter::write(uint64_t value)
+    {
+      content << value << '\n';
+    }
+
+    void
+    MemoWriter::writeBool(bool value)
+    {
+      content << (value ? 1 : 0) << '\n';
+    }
+
+    void
+    MemoWriter::write(double value)
+    {
+      content << value << '\n';
+    }
+
+    void
+    MemoWriter::write(const std::string& value)
+    {
+      content << value.size() << '\n' << value << '\n';
+    }
+
+    void
+    MemoWriter::save(const boost::filesystem::path& memo) const
+    {
+      const fs::path tmp(fs::unique_path(memo.string() + ".%%%%-%%%%-%%%%"));
+
+      {
+        fs::ofstream out(tmp, std::ios::out | std::ios::binary | std::ios::trunc);
+        out << memo_magic << '\n'
+            << format << '\n'
+            << sourceCount << '\n'
+            << sources.str()
+            << content.str();
+        out.close();
+        if (!out)
+          {
+            boost::system::error_code ec;
+            fs::remove(tmp, ec);
+            boost::format fmt("Failed to write memo %1%");
+            fmt % memo.string();
+            throw std::runtime_error(fmt.str());
+          }
+      }
+
+      fs::rename(tmp, memo);
+    }
+
+    MemoReader::MemoReader(const boost::filesystem::path& memo,
+                           const std::string&             format):
+      memo(memo),
+      content(),
+      sources()
+    {
+      fs::ifstream in(memo, std::ios::in | std::ios::binary);
+      if (!in)
+        {
+          boost::format fmt("Failed to open memo %1%");
+          fmt % memo.string();
+          throw std::runtime_error(fmt.str());
+        }
+      std::ostringstream data;
+      data << in.rdbuf();
+      content.str(data.str());
+
+      std::string magic, memoFormat;
+      std::getline(content, magic);
+      std::getline(content, memoFormat);
+      if (!content || magic != memo_magic || memoFormat != format)
+        {
+          boost::format fmt("Memo %1% is not of format %2%");
+          fmt % memo.string() % format;
+          throw std::runtime_error(fmt.str());
+        }
+
+      uint64_t sourceCount = readUInt();
+      for (uint64_t i = 0; i < sourceCount; ++i)
+        {
+          fs::path file(readString());
+          uint64_t size = readUInt();
+          uint64_t mtime = readUInt();
+
+          boost::system::error_code ec;
+          if (!fs::exists(file, ec) ||
+              static_cast<uint64_t>(fs::file_size(file, ec)) != size ||
+              static_cast<uint64_t>(fs::last_write_time(file, ec)) != mtime ||
+              ec)
+            {
+              boost::format fmt("Memo %1% is out of date: %2% has been modified");
+              fmt % memo.string() % file.string();
+              throw std::runtime_error(fmt.str());
+            }
+          sources.push_back(file);
+        }
+    }
+
+    const std::vector<boost::filesystem::path>&
+    MemoReader::getSources() const
+    {
+      return sources;
+    }
+
+    uint64_t
+    MemoReader::readUInt()
+    {
+      std::string line;
+      std::getline(content, line);
+      char *end = nullptr;
+      uint64_t value = std::strtoull(line.c_str(), &end, 10);
+      if (!content || line.empty() || *end != '\0')
+        {
+          boost::format fmt("Memo %1% is invalid: expected integer");
+          fmt % memo.string();
+          throw std::runtime_error(fmt.str());
+        }
+      return value;
+    }
+
+    bool
+    MemoReader::readBool()
+    {
+      return readUInt() != 0U;
+    }
+
+    double
+    MemoReader::readDouble()
+    {
+      std::string line;
+      std::getline(content, line);
+      char *end = nullptr;
+      double value = std::strtod(line.c_str(), &end);
+      if (!content || line.empty() || *end != '\0')
+        {
+          boost::format fmt("Memo %1% is invalid: expected floating point value");
+          fmt % memo.string();
+          throw std::runtime_error(fmt.str());
+        }
+      return value;
+    }
+
+    std::string
+    MemoReader::readString()
+    {
+      uint64_t size = readUInt();
+      std::string value(static_cast<std::string::size_type>(size), '\0');
+      if (size)
+        content.read(&value[0], static_cast<std::streamsize>(size));
+      if (!content || content.get() != '\n')
+        {
+          boost::format fmt("Memo %1% is invalid: truncated string");
+          fmt % memo.string();
+          throw std::runtime_error(fmt.str());
+        }
+      return value;
+    }
+
+    boost::filesystem::path
+    memoFile(const boost::filesystem::path& directory,
+             const boost::filesystem::path& file)
+    {
+      std::ostringstream name;
+      name << std::hex << std::setw(16) << std::setfill('0')
+           << std::hash<std::string>()(file.string())
+           << '-' << file.filename().string() << ".memo";
+      return directory / name.str();
+    }
+
+  }
+}
@@ -0,0 +1,263 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+
+#ifndef OME_FILES_MEMO_H
+#define OME_FILES_MEMO_H
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem/path.hpp>
+
+namespace ome
+{
+  namespace files
+  {
+
+    /**
+     * Reader memo file writer.
+     *
+     * A memo stores the state of an initialised reader, so that a
+     * later reader opening the same files may restore its state
+     * directly rather than parsing the metadata and reading every
+     * TIFF directory.  The memo records the size and modification
+     * time of each source file; it is valid only while none of the
+     * sources have changed (see MemoReader).
+     *
+     * Values are written in sequence, and must be read back in the
+     * same order and with the same types.  The layout of the values
+     * is defined by the reader; the format name and version should
+     * be changed if the layout changes.
+     */
+    class MemoWriter
+    {
+    public:
+      /**
+       * Constructor.
+       *
+       * @param format the name and version of the memo content.
+       */
+      explicit
+      MemoWriter(const std::string& format);
+
+      /// @cond SKIP
+      MemoWriter (const MemoWriter&) = delete;
+
+      MemoWriter&
+      operator= (const MemoWriter&) = delete;
+      /// @endcond SKIP
+
+      /**
+       * Add a source file.
+       *
+       * The current size and modification time of the file are
+       * recorded, to validate the memo when it is read.
+       *
+       * @param file the source file.
+       * @throws std::runtime_error if the file does not exist.
+       */
+      void
+      addSource(const boost::filesystem::path& file);
+
+      /**
+       * Write an unsigned integer value.
+       *
+       * @param value the value to write.
+       */
+      void
+      write(uint64_t value);
+
+      /**
+       * Write a boolean value.
+       *
+       * @param value the value to write.
+       */
+      void
+      writeBool(bool value);
+
+      /**
+       * Write a floating point value.
+       *
+       * @param value the value to write.
+       */
+      void
+      write(double value);
+
+      /**
+       * Write a string value.
+       *
+       * @param value the value to write.
+       */
+      void
+      write(const std::string& value);
+
+      /**
+       * Save the memo.
+       *
+       * The memo is written to a temporary file and renamed, so that
+       * concurrent readers never see a partially written memo.
+       *
+       * @param memo the memo file.
+       * @throws std::runtime_error if the memo could not be written.
+       */
+      void
+      save(const boost::filesystem::path& memo) const;
+
+    private:
+      /// Format name and version.
+      std::string format;
+      /// Source files with size and modification time.
+      std::ostringstream sources;
+      /// Number of source files.
+      uint64_t sourceCount;
+      /// Memo content.
+      std::ostringstream content;
+    };
+
+    /**
+     * Reader memo file reader.
+     *
+     * The memo is validated when it is opened; see MemoWriter.
+     */
+    class MemoReader
+    {
+    public:
+      /**
+       * Constructor.
+       *
+       * @param memo the memo file.
+       * @param format the expected name and version of the memo
+       * content.
+       * @throws std::runtime_error if the memo does not exist, is of
+       * a different format, or any of its source files have been
+       * modified or removed.
+       */
+      MemoReader(const boost::filesystem::path& memo,
+                 const std::string&             format);
+
+      /// @cond SKIP
+      MemoReader (const MemoReader&) = delete;
+
+      MemoReader&
+      operator= (const MemoReader&) = delete;
+      /// @endcond SKIP
+
+      /**
+       * Get the source files.
+       *
+       * @returns the source files.
+       */
+      const std::vector<boost::filesystem::path>&
+      getSources() const;
+
+      /**
+       * Read an unsigned integer value.
+       *
+       * @returns the value.
+       * @throws std::runtime_error if the memo is truncated or
+       * invalid.
+       */
+      uint64_t
+      readUInt();
+
+      /**
+       * Read a boolean value.
+       *
+       * @returns the value.
+       * @throws std::runtime_error if the memo is truncated or
+       * invalid.
+       */
+      bool
+      readBool();
+
+      /**
+       * Read a floating point value.
+       *
+       * @returns the value.
+       * @throws std::runtime_error if the memo is truncated or
+       * invalid.
+       */
+      double
+      readDouble();
+
+      /**
+       * Read a string value.
+       *
+       * @returns the value.
+       * @throws std::runtime_error if the memo is truncated or
+       * invalid.
+       */
+      std::string
+      readString();
+
+    private:
+      /// Memo file.
+      boost::filesystem::path memo;
+      /// Memo content.
+      std::istringstream content;
+      /// Source files.
+      std::vector<boost::filesystem::path> sources;
+    };
+
+    /**
+     * Get the memo file for a file in a memo directory.
+     *
+     * The name is derived from the complete path of the file, so
+     * that files with the same name in different directories do not
+     * share a memo.
+     *
+     * @param directory the memo directory.
+     * @param file the file to memoise (should be canonical).
+     * @returns the memo file.
+     */
+    boost::filesystem::path
+    memoFile(const boost::filesystem::path& directory,
+             const boost::filesystem::path& file);
+
+  }
+}
+
+#endif // OME_FILES_MEMO_H
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
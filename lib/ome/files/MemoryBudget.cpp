@@ -0,0 +1,374 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <algorithm>
+#include <condition_variable>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include <ome/files/MemoryBudget.h>
+#include <ome/files/PixelAllocator.h>
+
+namespace ome
+{
+  namespace files
+  {
+
+    /// @copydoc MemoryBudget
+    class MemoryBudget::Impl
+    {
+    public:
+      /// Mutex protecting the accounts and totals.
+      mutable std::mutex mutex;
+      /// Signalled when a reclaim call completes.
+      std::condition_variable reclaimed;
+      /// Maximum total use (bytes); 0 for no limit.
+      dimension_size_type limit;
+      /// Total use (bytes).
+      dimension_size_type usage;
+      /// Open accounts.
+      std::vector<Account *> accounts;
+
+      /**
+       * Constructor.
+       *
+       * @param limit the maximum total use (bytes).
+       */
+      Impl(dimension_size_type limit):
+        mutex(),
+        reclaimed(),
+        limit(limit),
+        usage(0U),
+        accounts()
+      {
+      }
+
+      /**
+       * Get the use in excess of the limit.
+       *
+       * @note Needs the mutex held by the caller.
+       * @returns the excess (bytes).
+       */
+      dimension_size_type
+      excess() const
+      {
+        return (limit && usage > limit) ? usage - limit : 0U;
+      }
+
+      /**
+       * Set the use of an account.
+       *
+       * @param account the account.
+       * @param bytes the new use (bytes).
+       * @returns @c true if the use increased beyond the limit.
+       */
+      bool
+      set(Account&            account,
+          dimension_size_type bytes)
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        const bool increased = bytes > account.usage;
+        usage = usage - account.usage + bytes;
+        account.usage = bytes;
+        return increased && excess();
+      }
+
+      /**
+       * Ask accounts to reclaim memory until within the limit.
+       *
+       * Accounts are asked in descending order of use.  An account
+       * may not be destroyed while it is being asked.
+       *
+       * @param exclude an account not to ask, or null.
+       * @returns the memory released (bytes).
+       */
+      dimension_size_type
+      reclaim(const Account *exclude)
+      {
+        struct Candidate
+        {
+          Account             *account;
+          reclaim_function     reclaim;
+          dimension_size_type  usage;
+        };
+
+        std::vector<Candidate> candidates;
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          if (!excess())
+            return 0U;
+          for (const auto account : accounts)
+            {
+              if (account != exclude && account->reclaim && account->usage)
+                {
+                  Candidate candidate = {account, account->reclaim, account->usage};
+                  candidates.push_back(candidate);
+                  ++account->reclaiming;
+                }
+            }
+        }
+        std::stable_sort(candidates.begin(), candidates.end(),
+                         [](const Candidate& lhs, const Candidate& rhs)
+                         { return lhs.usage > rhs.usage; });
+
+        dimension_size_type released = 0U;
+        for (const auto& candidate : candidates)
+          {
+            dimension_size_type bytes;
+            {
+              std::lock_guard<std::mutex> lock(mutex);
+              bytes = excess();
+            }
+            // Reclaiming is advisory; a failure to release memory
+            // leaves the budget exceeded.
+            if (bytes)
+              {
+                try
+                  {
+                    released += candidate.reclaim(bytes);
+                  }
+                catch (...)
+                  {
+                  }
+              }
+            {
+              std::lock_guard<std::mutex> lock(mutex);
+              --candidate.account->reclaiming;
+            }
+            reclaimed.notify_all();
+          }
+        return released;
+      }
+    };
+
+    namespace
+    {
+
+      // Allocator accounting pixel storage to a budget.
+      class BudgetAllocator : public PixelAllocator
+      {
+      public:
+        BudgetAllocator(const std::shared_ptr<MemoryBudget::Account>& account):
+          PixelAllocator(),
+          account(account)
+        {
+        }
+
+        ~BudgetAllocator()
+        {
+        }
+
+        void *
+        allocate(std::size_t size,
+                 std::size_t /* alignment */)
+        {
+          // The free store alignment is sufficient for all pixel
+          // types.
+          void *ptr = ::operator new(size);
+          account->increase(size);
+          return ptr;
+        }
+
+        void
+        deallocate(void        *ptr,
+                   std::size_t  size,
+                   std::size_t  /* alignment */)
+        {
+          account->decrease(size);
+          ::operator delete(ptr);
+        }
+
+      private:
+        std::shared_ptr<MemoryBudget::Account> account;
+      };
+
+    }
+
+    MemoryBudget::Account::Account(const std::shared_ptr<Impl>& budget,
+                                   const std::string&           component,
+                                   const reclaim_function&      reclaim):
+      budget(budget),
+      component(component),
+      reclaim(reclaim),
+      usage(0U),
+      reclaiming(0U)
+    {
+      std::lock_guard<std::mutex> lock(budget->mutex);
+      budget->accounts.push_back(this);
+    }
+
+    MemoryBudget::Account::~Account()
+    {
+      std::unique_lock<std::mutex> lock(budget->mutex);
+      budget->reclaimed.wait(lock, [this]{ return reclaiming == 0U; });
+      budget->usage -= usage;
+      budget->accounts.erase(std::remove(budget->accounts.begin(), budget->accounts.end(), this),
+                             budget->accounts.end());
+    }
+
+    const std::string&
+    MemoryBudget::Account::getComponent() const
+    {
+      return component;
+    }
+
+    dimension_size_type
+    MemoryBudget::Account::getUsage() const
+    {
+      std::lock_guard<std::mutex> lock(budget->mutex);
+      return usage;
+    }
+
+    void
+    MemoryBudget::Account::setUsage(dimension_size_type bytes)
+    {
+      if (budget->set(*this, bytes))
+        budget->reclaim(this);
+    }
+
+    void
+    MemoryBudget::Account::increase(dimension_size_type bytes)
+    {
+      bool over;
+      {
+        std::lock_guard<std::mutex> lock(budget->mutex);
+        usage += bytes;
+        budget->usage += bytes;
+        over = bytes && budget->excess();
+      }
+      if (over)
+        budget->reclaim(this);
+    }
+
+    void
+    MemoryBudget::Account::decrease(dimension_size_type bytes)
+    {
+      std::lock_guard<std::mutex> lock(budget->mutex);
+      bytes = std::min(bytes, usage);
+      usage -= bytes;
+      budget->usage -= bytes;
+    }
+
+    bool
+    MemoryBudget::Account::exceeded() const
+    {
+      std::lock_guard<std::mutex> lock(budget->mutex);
+      return budget->excess() != 0U;
+    }
+
+    MemoryBudget::MemoryBudget(dimension_size_type limit):
+      impl(std::make_shared<Impl>(limit))
+    {
+    }
+
+    MemoryBudget::~MemoryBudget()
+    {
+    }
+
+    std::shared_ptr<MemoryBudget::Account>
+    MemoryBudget::open(const std::string&      component,
+                       const reclaim_function& reclaim)
+    {
+      return std::shared_ptr<Account>(new Account(impl, component, reclaim));
+    }
+
+    std::shared_ptr<PixelAllocator>
+    MemoryBudget::allocator(const std::string& component)
+    {
+      return std::make_shared<BudgetAllocator>(open(component));
+    }
+
+    void
+    MemoryBudget::setLimit(dimension_size_type limit)
+    {
+      {
+        std::lock_guard<std::mutex> lock(impl->mutex);
+        impl->limit = limit;
+      }
+      impl->reclaim(nullptr);
+    }
+
+    dimension_size_type
+    MemoryBudget::getLimit() const
+    {
+      std::lock_guard<std::mutex> lock(impl->mutex);
+      return impl->limit;
+    }
+
+    dimension_size_type
+    MemoryBudget::getUsage() const
+    {
+      std::lock_guard<std::mutex> lock(impl->mutex);
+      return impl->usage;
+    }
+
+    std::map<std::string, dimension_size_type>
+    MemoryBudget::getComponentUsage() const
+    {
+      std::lock_guard<std::mutex> lock(impl->mutex);
+      std::map<std::string, dimension_size_type> usage;
+      for (const auto account : impl->accounts)
+        usage[account->component] += account->usage;
+      return usage;
+    }
+
+    dimension_size_type
+    MemoryBudget::available() const
+    {
+      std::lock_guard<std::mutex> lock(impl->mutex);
+      if (!impl->limit)
+        return std::numeric_limits<dimension_size_type>::max();
+      return impl->usage < impl->limit ? impl->limit - impl->usage : 0U;
+    }
+
+    bool
+    MemoryBudget::exceeded() const
+    {
+      std::lock_guard<std::mutex> lock(impl->mutex);
+      return impl->excess() != 0U;
+    }
+
+    dimension_size_type
+    MemoryBudget::reclaim()
+    {
+      return impl->reclaim(nullptr);
+    }
+
+  }
+}
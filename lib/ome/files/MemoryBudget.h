@@ -0,0 +1,314 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#ifndef OME_FILES_MEMORYBUDGET_H
+#define OME_FILES_MEMORYBUDGET_H
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+
+#include <ome/files/Types.h>
+
+namespace ome
+{
+  namespace files
+  {
+
+    class PixelAllocator;
+
+    /**
+     * Memory budget shared by several components.
+     *
+     * Caches and buffers held by readers, writers and tile caches
+     * may be attached to a single budget, so that their total memory
+     * use is limited by one setting.  Each component opens an
+     * Account, and reports its memory use through the account.  The
+     * budget keeps the total, and the use of each component for
+     * reporting with getComponentUsage().
+     *
+     * The limit is not a hard limit: memory is always accounted,
+     * even if the limit is exceeded.  When an account increases its
+     * use beyond the limit, other components which can release
+     * memory (for example by evicting cached tiles) are asked to
+     * reclaim the excess, largest first.  Components also check
+     * exceeded() to discard or spill their own cached data, and to
+     * skip optional work such as prefetching.
+     *
+     * This class is thread-safe.  Accounts may outlive the budget,
+     * in which case they are no longer limited.
+     */
+    class MemoryBudget
+    {
+    private:
+      class Impl;
+      /// Private implementation details.
+      std::shared_ptr<Impl> impl;
+
+    public:
+      /**
+       * Function to reclaim memory from a component.
+       *
+       * The argument is the number of bytes to release; the return
+       * value is the number of bytes released, which may be more or
+       * less than requested.  The function is called from whichever
+       * thread exceeded the limit, without any budget lock held, and
+       * must not block waiting for the component; if the component
+       * is busy, it should return zero.
+       */
+      typedef std::function<dimension_size_type (dimension_size_type bytes)> reclaim_function;
+
+      /**
+       * Memory use of one component.
+       *
+       * Accounts are created with open(), and the use is removed
+       * from the budget when the account is destroyed.
+       */
+      class Account
+      {
+      public:
+        /// Destructor.
+        ~Account();
+
+        /// @cond SKIP
+        Account (const Account&) = delete;
+
+        Account&
+        operator= (const Account&) = delete;
+        /// @endcond SKIP
+
+        /**
+         * Get the component name.
+         *
+         * @returns the name.
+         */
+        const std::string&
+        getComponent() const;
+
+        /**
+         * Get the memory use of the component.
+         *
+         * @returns the use (bytes).
+         */
+        dimension_size_type
+        getUsage() const;
+
+        /**
+         * Set the memory use of the component.
+         *
+         * If this increases the use and the budget is exceeded,
+         * other components are asked to reclaim the excess.
+         *
+         * @param bytes the use (bytes).
+         */
+        void
+        setUsage(dimension_size_type bytes);
+
+        /**
+         * Increase the memory use of the component.
+         *
+         * @param bytes the increase (bytes).
+         */
+        void
+        increase(dimension_size_type bytes);
+
+        /**
+         * Decrease the memory use of the component.
+         *
+         * @param bytes the decrease (bytes); limited to the current
+         * use.
+         */
+        void
+        decrease(dimension_size_type bytes);
+
+        /**
+         * Check if the budget is exceeded.
+         *
+         * @returns @c true if the total use exceeds the limit.
+         */
+        bool
+        exceeded() const;
+
+      private:
+        friend class MemoryBudget;
+        friend class MemoryBudget::Impl;
+
+        /**
+         * Constructor.
+         *
+         * @param budget the budget implementation.
+         * @param component the component name.
+         * @param reclaim the function to reclaim memory, if any.
+         */
+        Account(const std::shared_ptr<Impl>& budget,
+                const std::string&           component,
+                const reclaim_function&      reclaim);
+
+        /// The budget.
+        std::shared_ptr<Impl> budget;
+        /// Component name.
+        std::string component;
+        /// Function to reclaim memory.
+        reclaim_function reclaim;
+        /// Memory use (bytes).
+        dimension_size_type usage;
+        /// Number of reclaim calls in progress.
+        dimension_size_type reclaiming;
+      };
+
+      /**
+       * Constructor.
+       *
+       * @param limit the maximum total memory use (bytes), or 0 for
+       * no limit.
+       */
+      explicit
+      MemoryBudget(dimension_size_type limit = 0U);
+
+      /// Destructor.
+      virtual ~MemoryBudget();
+
+      /// @cond SKIP
+      MemoryBudget (const MemoryBudget&) = delete;
+
+      MemoryBudget&
+      operator= (const MemoryBudget&) = delete;
+      /// @endcond SKIP
+
+      /**
+       * Open an account for a component.
+       *
+       * Several accounts may use the same component name, for
+       * example the tile caches of several writers; their use is
+       * combined by getComponentUsage().
+       *
+       * @param component the component name.
+       * @param reclaim the function to reclaim memory from the
+       * component, or an empty function if it can't release memory
+       * on request.
+       * @returns the account.
+       */
+      std::shared_ptr<Account>
+      open(const std::string&      component,
+           const reclaim_function& reclaim = reclaim_function());
+
+      /**
+       * Get an allocator which accounts pixel buffer storage.
+       *
+       * Storage is allocated from the free store, as for the default
+       * allocator, and is accounted to a new account for the
+       * component until it is released.
+       *
+       * @param component the component name.
+       * @returns the allocator.
+       */
+      std::shared_ptr<PixelAllocator>
+      allocator(const std::string& component);
+
+      /**
+       * Set the maximum total memory use.
+       *
+       * If the new limit is exceeded, components are asked to
+       * reclaim the excess.
+       *
+       * @param limit the limit (bytes), or 0 for no limit.
+       */
+      void
+      setLimit(dimension_size_type limit);
+
+      /**
+       * Get the maximum total memory use.
+       *
+       * @returns the limit (bytes), or 0 if there is no limit.
+       */
+      dimension_size_type
+      getLimit() const;
+
+      /**
+       * Get the total memory use.
+       *
+       * @returns the use of all accounts (bytes).
+       */
+      dimension_size_type
+      getUsage() const;
+
+      /**
+       * Get the memory use of each component.
+       *
+       * @returns the use (bytes) of each component, by name.
+       */
+      std::map<std::string, dimension_size_type>
+      getComponentUsage() const;
+
+      /**
+       * Get the memory available before the limit is reached.
+       *
+       * @returns the available memory (bytes); zero if the limit is
+       * exceeded, or the largest representable size if there is no
+       * limit.
+       */
+      dimension_size_type
+      available() const;
+
+      /**
+       * Check if the budget is exceeded.
+       *
+       * @returns @c true if the total use exceeds the limit.
+       */
+      bool
+      exceeded() const;
+
+      /**
+       * Ask components to reclaim memory until within the limit.
+       *
+       * @returns the memory released (bytes).
+       */
+      dimension_size_type
+      reclaim();
+    };
+
+  }
+}
+
+#endif // OME_FILES_MEMORYBUDGET_H
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
@@ -57,6 +57,7 @@ namespace ome
       /// Amount of metadata to store.
       enum MetadataLevel
         {
+          METADATA_PIXELS,      ///< Store only core metadata; fill the metadata store on first access.
           METADATA_MINIMUM,     ///< Store a minimal amount of metadata.
           METADATA_NO_OVERLAYS, ///< Store all metadata except overlays.
           METADATA_ALL          ///< Store all metadata.
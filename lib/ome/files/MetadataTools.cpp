@@ -35,9 +35,13 @@
  * #L%
  */
 
+#include <atomic>
+#include <iterator>
 #include <string>
 
+#include <boost/filesystem/fstream.hpp>
 #include <boost/format.hpp>
+#include <boost/optional.hpp>
 
 #include <ome/files/FormatException.h>
 #include <ome/files/FormatTools.h>
@@ -101,6 +105,7 @@ using ome::xml::model::Pixels;
 using ome::xml::model::StructuredAnnotations;
 using ome::xml::model::XMLAnnotation;
 using ome::xml::model::primitives::Timestamp;
+using ome::xml::model::primitives::NonNegativeInteger;
 using ome::xml::model::primitives::PositiveInteger;
 
 namespace
@@ -109,6 +114,44 @@ namespace
   /// Use default creation date?
   bool defaultCreationDate = false;
 
+  /// OME-XML validation policy.
+  std::atomic<ome::files::OMEXMLValidation> omexmlValidation(ome::files::VALIDATE_STRICT);
+
+  /**
+   * Get parameters for parsing without schema validation.
+   *
+   * @returns the parse parameters.
+   */
+  ome::common::xml::dom::ParseParameters
+  unvalidatedParameters()
+  {
+    ome::common::xml::dom::ParseParameters params;
+    params.doSchema = false;
+    params.validationSchemaFullChecking = false;
+    return params;
+  }
+
+  /**
+   * Parse OME-XML text under a non-strict validation policy.
+   *
+   * The text is parsed exactly once.
+   *
+   * @param text the XML string.
+   * @param policy the validation policy.
+   * @returns the DOM document.
+   */
+  ome::common::xml::dom::Document
+  parseOMEXMLOnce(const std::string&           text,
+                  ome::files::OMEXMLValidation policy)
+  {
+    if (policy == ome::files::VALIDATE_IF_CHEAP &&
+        ome::files::schemaGrammarCached() &&
+        ome::files::validateXML(text, "OME-XML text"))
+      return ome::xml::createDocument(text, ome::common::xml::dom::ParseParameters(),
+                                      "OME-XML text");
+    return ome::xml::createDocument(text, unvalidatedParameters(), "OME-XML text");
+  }
+
   template<typename T>
   void parseNodeValue(::ome::common::xml::dom::Node& node,
                       T&                             value)
@@ -167,6 +210,286 @@ namespace
     std::string version;
   };
 
+  // Parse an attribute value, if present.
+  boost::optional<std::string>
+  getAttribute(const xercesc::Attributes& attrs,
+               const char                *name)
+  {
+    boost::optional<std::string> ret;
+    const XMLCh *value = attrs.getValue(ome::common::xml::String(name));
+    if (value)
+      ret = std::string(ome::common::xml::String(value));
+    return ret;
+  }
+
+  // Parse a numeric attribute value, if present.
+  template<typename T>
+  boost::optional<T>
+  getNumericAttribute(const xercesc::Attributes& attrs,
+                      const char                *name)
+  {
+    boost::optional<T> ret;
+    boost::optional<std::string> value(getAttribute(attrs, name));
+    if (value)
+      ret = T(boost::lexical_cast<typename T::value_type>(*value));
+    return ret;
+  }
+
+  /*
+   * Streaming parser for the subset of OME-XML needed to map planes
+   * to TIFF IFDs and well samples to Images.  Only the OME,
+   * BinaryOnly, Plate, Well, WellSample, Image, Pixels, Channel,
+   * TiffData and UUID elements are stored.  Parsing stops
+   * early if the document uses a different schema version or
+   * contains XMLAnnotations (which can carry Modulo and original
+   * metadata used by readers), since these require the complete
+   * model.
+   */
+  class TiffDataParser : public xercesc::DefaultHandler
+  {
+  public:
+    TiffDataParser():
+      xercesc::DefaultHandler(),
+      meta(std::make_shared<OMEXMLMetadata>()),
+      ns(std::string("http://www.openmicroscopy.org/Schemas/OME/") + OME_XML_MODEL_VERSION),
+      usable(true),
+      depth(0U),
+      imageCount(0U),
+      channelCount(0U),
+      tiffDataCount(0U),
+      plateCount(0U),
+      wellCount(0U),
+      wellSampleCount(0U),
+      inWellSample(false),
+      imageRefs(false),
+      inUUID(false),
+      uuid()
+    {}
+
+    virtual ~TiffDataParser() {}
+
+    void
+    startElement(const XMLCh* const         uri,
+                 const XMLCh* const         localname,
+                 const XMLCh* const         /* qname */,
+                 const xercesc::Attributes& attrs)
+    {
+      const std::string name(ome::common::xml::String(localname));
+
+      if (depth++ == 0U &&
+          (name != "OME" || std::string(ome::common::xml::String(uri)) != ns))
+        stop();
+
+      if (name == "XMLAnnotation")
+        stop();
+      else if (name == "OME")
+        {
+          boost::optional<std::string> value(getAttribute(attrs, "UUID"));
+          if (value)
+            meta->setUUID(*value);
+        }
+      else if (name == "BinaryOnly")
+        {
+          boost::optional<std::string> value(getAttribute(attrs, "MetadataFile"));
+          if (value)
+            meta->setBinaryOnlyMetadataFile(*value);
+          value = getAttribute(attrs, "UUID");
+          if (value)
+            meta->setBinaryOnlyUUID(*value);
+        }
+      else if (name == "Plate")
+        {
+          meta->setPlateID(getAttribute(attrs, "ID").get_value_or(std::string()), plateCount++);
+          wellCount = 0U;
+        }
+      else if (name == "Well" && plateCount)
+        {
+          startWell(attrs, plateCount - 1, wellCount++);
+          wellSampleCount = 0U;
+        }
+      else if (name == "WellSample" && plateCount && wellCount)
+        {
+          meta->setWellSampleID(getAttribute(attrs, "ID").get_value_or(std::string()),
+                                plateCount - 1, wellCount - 1, wellSampleCount++);
+          inWellSample = true;
+        }
+      else if (name == "ImageRef" && inWellSample)
+        {
+          boost::optional<std::string> value(getAttribute(attrs, "ID"));
+          if (value)
+            {
+              meta->setWellSampleImageRef(*value, plateCount - 1, wellCount - 1, wellSampleCount - 1);
+              imageRefs = true;
+            }
+        }
+      else if (name == "Image")
+        {
+          meta->setImageID(getAttribute(attrs, "ID").get_value_or(std::string()), imageCount++);
+          channelCount = tiffDataCount = 0U;
+        }
+      else if (name == "Pixels" && imageCount)
+        startPixels(attrs, imageCount - 1);
+      else if (name == "Channel" && imageCount)
+        startChannel(attrs, imageCount - 1, channelCount++);
+      else if (name == "TiffData" && imageCount)
+        startTiffData(attrs, imageCount - 1, tiffDataCount++);
+      else if (name == "UUID" && imageCount && tiffDataCount)
+        {
+          boost::optional<std::string> value(getAttribute(attrs, "FileName"));
+          if (value)
+            meta->setUUIDFileName(*value, imageCount - 1, tiffDataCount - 1);
+          inUUID = true;
+          uuid.clear();
+        }
+    }
+
+    void
+    endElement(const XMLCh* const /* uri */,
+               const XMLCh* const localname,
+               const XMLCh* const /* qname */)
+    {
+      --depth;
+      if (inWellSample && std::string(ome::common::xml::String(localname)) == "WellSample")
+        inWellSample = false;
+      if (inUUID)
+        {
+          meta->setUUIDValue(uuid, imageCount - 1, tiffDataCount - 1);
+          inUUID = false;
+        }
+    }
+
+    void
+    characters(const XMLCh* const chars,
+               const XMLSize_t    length)
+    {
+      if (inUUID)
+        {
+          std::basic_string<XMLCh> text(chars, length);
+          uuid += ome::common::xml::String(text.c_str());
+        }
+    }
+
+    std::shared_ptr<OMEXMLMetadata>
+    getMetadata() const
+    {
+      if (!usable)
+        return std::shared_ptr<OMEXMLMetadata>();
+      // Link well samples to their Images.
+      if (imageRefs)
+        meta->resolveReferences();
+      return meta;
+    }
+
+  private:
+    void
+    stop()
+    {
+      usable = false;
+      throw xercesc::SAXException(ome::common::xml::String("Complete metadata model required"));
+    }
+
+    void
+    startPixels(const xercesc::Attributes& attrs,
+                Metadata::index_type       image)
+    {
+      boost::optional<std::string> value(getAttribute(attrs, "ID"));
+      meta->setPixelsID(value.get_value_or(std::string()), image);
+      value = getAttribute(attrs, "DimensionOrder");
+      if (value)
+        meta->setPixelsDimensionOrder(ome::xml::model::enums::DimensionOrder(*value), image);
+      value = getAttribute(attrs, "Type");
+      if (value)
+        meta->setPixelsType(ome::xml::model::enums::PixelType(*value), image);
+
+      boost::optional<PositiveInteger> size(getNumericAttribute<PositiveInteger>(attrs, "SizeX"));
+      if (size)
+        meta->setPixelsSizeX(*size, image);
+      size = getNumericAttribute<PositiveInteger>(attrs, "SizeY");
+      if (size)
+        meta->setPixelsSizeY(*size, image);
+      size = getNumericAttribute<PositiveInteger>(attrs, "SizeZ");
+      if (size)
+        meta->setPixelsSizeZ(*size, image);
+      size = getNumericAttribute<PositiveInteger>(attrs, "SizeC");
+      if (size)
+        meta->setPixelsSizeC(*size, image);
+      size = getNumericAttribute<PositiveInteger>(attrs, "SizeT");
+      if (size)
+        meta->setPixelsSizeT(*size, image);
+      size = getNumericAttribute<PositiveInteger>(attrs, "SignificantBits");
+      if (size)
+        meta->setPixelsSignificantBits(*size, image);
+    }
+
+    void
+    startWell(const xercesc::Attributes& attrs,
+              Metadata::index_type       plate,
+              Metadata::index_type       well)
+    {
+      meta->setWellID(getAttribute(attrs, "ID").get_value_or(std::string()), plate, well);
+      boost::optional<NonNegativeInteger> value(getNumericAttribute<NonNegativeInteger>(attrs, "Row"));
+      if (value)
+        meta->setWellRow(*value, plate, well);
+      value = getNumericAttribute<NonNegativeInteger>(attrs, "Column");
+      if (value)
+        meta->setWellColumn(*value, plate, well);
+    }
+
+    void
+    startChannel(const xercesc::Attributes& attrs,
+                 Metadata::index_type       image,
+                 Metadata::index_type       channel)
+    {
+      boost::optional<std::string> value(getAttribute(attrs, "ID"));
+      meta->setChannelID(value.get_value_or(std::string()), image, channel);
+      value = getAttribute(attrs, "Name");
+      if (value)
+        meta->setChannelName(*value, image, channel);
+      boost::optional<PositiveInteger> samples(getNumericAttribute<PositiveInteger>(attrs, "SamplesPerPixel"));
+      if (samples)
+        meta->setChannelSamplesPerPixel(*samples, image, channel);
+    }
+
+    void
+    startTiffData(const xercesc::Attributes& attrs,
+                  Metadata::index_type       image,
+                  Metadata::index_type       tiffData)
+    {
+      // IFD is always set, using the schema default if absent, so
+      // that the TiffData element exists even without attributes.
+      meta->setTiffDataIFD(getNumericAttribute<NonNegativeInteger>(attrs, "IFD").get_value_or(NonNegativeInteger(0U)),
+                           image, tiffData);
+
+      boost::optional<NonNegativeInteger> value(getNumericAttribute<NonNegativeInteger>(attrs, "FirstZ"));
+      if (value)
+        meta->setTiffDataFirstZ(*value, image, tiffData);
+      value = getNumericAttribute<NonNegativeInteger>(attrs, "FirstT");
+      if (value)
+        meta->setTiffDataFirstT(*value, image, tiffData);
+      value = getNumericAttribute<NonNegativeInteger>(attrs, "FirstC");
+      if (value)
+        meta->setTiffDataFirstC(*value, image, tiffData);
+      value = getNumericAttribute<NonNegativeInteger>(attrs, "PlaneCount");
+      if (value)
+        meta->setTiffDataPlaneCount(*value, image, tiffData);
+    }
+
+    std::shared_ptr<OMEXMLMetadata> meta;
+    std::string ns;
+    bool usable;
+    Metadata::index_type depth;
+    Metadata::index_type imageCount;
+    Metadata::index_type channelCount;
+    Metadata::index_type tiffDataCount;
+    Metadata::index_type plateCount;
+    Metadata::index_type wellCount;
+    Metadata::index_type wellSampleCount;
+    bool inWellSample;
+    bool imageRefs;
+    bool inUUID;
+    std::string uuid;
+  };
+
 }
 
 namespace ome
@@ -275,16 +598,33 @@ namespace ome
       ome::common::xml::Platform xmlplat;
       ome::common::xsl::Platform xslplat;
       ome::common::xml::dom::Document doc;
-      try
+      OMEXMLValidation policy(omexmlValidation);
+      if (policy == VALIDATE_IF_CHEAP)
+        {
+          boost::filesystem::ifstream in(file, std::ios::in | std::ios::binary);
+          if (!in)
+            {
+              boost::format fmt("Failed to open OME-XML file %1%");
+              fmt % file.string();
+              throw std::runtime_error(fmt.str());
+            }
+          std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+          doc = parseOMEXMLOnce(text, policy);
+        }
+      else if (policy == VALIDATE_NEVER)
         {
-          doc = ome::xml::createDocument(file);
+          doc = ome::xml::createDocument(file, unvalidatedParameters());
         }
-      catch (const std::runtime_error&) // retry without strict validation
+      else
         {
-          ome::common::xml::dom::ParseParameters params;
-          params.doSchema = false;
-          params.validationSchemaFullChecking = false;
-          doc = ome::xml::createDocument(file, params);
+          try
+            {
+              doc = ome::xml::createDocument(file);
+            }
+          catch (const std::runtime_error&) // retry without strict validation
+            {
+              doc = ome::xml::createDocument(file, unvalidatedParameters());
+            }
         }
       return createOMEXMLMetadata(doc);
     }
@@ -296,21 +636,75 @@ namespace ome
       ome::common::xml::Platform xmlplat;
       ome::common::xsl::Platform xslplat;
       ome::common::xml::dom::Document doc;
-      try
+      OMEXMLValidation policy(omexmlValidation);
+      if (policy != VALIDATE_STRICT)
         {
-          doc = ome::xml::createDocument(text, ome::common::xml::dom::ParseParameters(),
-                                         "OME-XML text");
+          doc = parseOMEXMLOnce(text, policy);
         }
-      catch (const std::runtime_error&) // retry without strict validation
+      else
         {
-          ome::common::xml::dom::ParseParameters params;
-          params.doSchema = false;
-          params.validationSchemaFullChecking = false;
-          doc = ome::xml::createDocument(text, params, "Broken OME-XML text");
+          try
+            {
+              doc = ome::xml::createDocument(text, ome::common::xml::dom::ParseParameters(),
+                                             "OME-XML text");
+            }
+          catch (const std::runtime_error&) // retry without strict validation
+            {
+              doc = ome::xml::createDocument(text, unvalidatedParameters(), "Broken OME-XML text");
+            }
         }
       return createOMEXMLMetadata(doc);
     }
 
+    std::shared_ptr<::ome::xml::meta::OMEXMLMetadata>
+    createTiffDataMetadata(const std::string& text)
+    {
+      return createTiffDataMetadata(text.data(), text.size());
+    }
+
+    std::shared_ptr<::ome::xml::meta::OMEXMLMetadata>
+    createTiffDataMetadata(const char  *text,
+                           std::size_t size)
+    {
+      ome::common::xml::Platform xmlplat;
+
+      std::shared_ptr<xercesc::SAX2XMLReader> parser(xercesc::XMLReaderFactory::createXMLReader());
+      // No validation; the caller falls back to the complete model
+      // (which is validated) if the subset can't be used.
+      parser->setFeature(xercesc::XMLUni::fgSAX2CoreValidation, false);
+      parser->setFeature(xercesc::XMLUni::fgXercesSchemaFullChecking, false);
+      parser->setFeature(xercesc::XMLUni::fgXercesLoadSchema, false);
+      parser->setFeature(xercesc::XMLUni::fgXercesLoadExternalDTD, false);
+      parser->setFeature(xercesc::XMLUni::fgSAX2CoreNameSpaces, true);
+
+      xercesc::MemBufInputSource source(reinterpret_cast<const XMLByte *>(text),
+                                        static_cast<XMLSize_t>(size),
+                                        common::xml::String("OME-XML TiffData"));
+
+      TiffDataParser handler;
+      parser->setContentHandler(&handler);
+      parser->setErrorHandler(&handler);
+
+      try
+        {
+          parser->parse(source);
+        }
+      catch (const xercesc::SAXParseException&)
+        {
+          return std::shared_ptr<::ome::xml::meta::OMEXMLMetadata>();
+        }
+      catch (const xercesc::SAXException&)
+        {
+          // Early termination; the handler is no longer usable.
+        }
+      catch (...)
+        {
+          return std::shared_ptr<::ome::xml::meta::OMEXMLMetadata>();
+        }
+
+      return handler.getMetadata();
+    }
+
     std::shared_ptr<::ome::xml::meta::OMEXMLMetadata>
     createOMEXMLMetadata(std::istream& stream)
     {
@@ -318,17 +712,27 @@ namespace ome
       ome::common::xml::Platform xmlplat;
       ome::common::xsl::Platform xslplat;
       ome::common::xml::dom::Document doc;
-      try
+      OMEXMLValidation policy(omexmlValidation);
+      if (policy == VALIDATE_IF_CHEAP)
         {
-          doc = ome::xml::createDocument(stream, ome::common::xml::dom::ParseParameters(),
-                                                 "OME-XML stream");
+          std::string text((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+          doc = parseOMEXMLOnce(text, policy);
         }
-      catch (const std::runtime_error&) // retry without strict validation
+      else if (policy == VALIDATE_NEVER)
         {
-          ome::common::xml::dom::ParseParameters params;
-          params.doSchema = false;
-          params.validationSchemaFullChecking = false;
-          doc = ome::xml::createDocument(stream, params, "Broken OME-XML stream");
+          doc = ome::xml::createDocument(stream, unvalidatedParameters(), "OME-XML stream");
+        }
+      else
+        {
+          try
+            {
+              doc = ome::xml::createDocument(stream, ome::common::xml::dom::ParseParameters(),
+                                             "OME-XML stream");
+            }
+          catch (const std::runtime_error&) // retry without strict validation
+            {
+              doc = ome::xml::createDocument(stream, unvalidatedParameters(), "Broken OME-XML stream");
+            }
         }
       return createOMEXMLMetadata(doc);
     }
@@ -1185,6 +1589,18 @@ namespace ome
       return upgraded_xml;
     }
 
+    OMEXMLValidation
+    getOMEXMLValidation()
+    {
+      return omexmlValidation;
+    }
+
+    void
+    setOMEXMLValidation(OMEXMLValidation policy)
+    {
+      omexmlValidation = policy;
+    }
+
     bool
     defaultCreationDateEnabled()
     {
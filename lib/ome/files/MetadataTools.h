@@ -35,6 +35,7 @@
  * #L%
  */
 
+#include <cstddef>
 #include <string>
 
 #include <boost/filesystem/path.hpp>
@@ -116,6 +117,45 @@ namespace ome
              dimension_size_type idx3,
              dimension_size_type idx4);
 
+    /// OME-XML schema validation policy used when parsing OME-XML.
+    enum OMEXMLValidation
+      {
+        /// Validate; if invalid, parse again without validation.
+        VALIDATE_STRICT,
+        /// Validate only if the compiled schema grammar is cached.
+        VALIDATE_IF_CHEAP,
+        /// Never validate.
+        VALIDATE_NEVER
+      };
+
+    /**
+     * Get the OME-XML schema validation policy.
+     *
+     * @returns the validation policy.
+     */
+    OMEXMLValidation
+    getOMEXMLValidation();
+
+    /**
+     * Set the OME-XML schema validation policy.
+     *
+     * This policy is used by the createOMEXMLMetadata() functions
+     * which parse XML text, files and streams.  With @c
+     * VALIDATE_STRICT (the default), the document is parsed with
+     * validation, and then parsed again without validation if it was
+     * invalid.  With @c VALIDATE_IF_CHEAP, the document is first
+     * checked with the cached schema grammar (see
+     * schemaGrammarCached()), and then parsed once, with validation
+     * only if it is known to be valid; if the grammar is not yet
+     * cached, it is parsed once without validation.  With @c
+     * VALIDATE_NEVER, the document is parsed once without
+     * validation.
+     *
+     * @param policy the validation policy.
+     */
+    void
+    setOMEXMLValidation(OMEXMLValidation policy);
+
     /**
      * Create OME-XML metadata from DOM Document.
      *
@@ -152,6 +192,45 @@ namespace ome
     std::shared_ptr<::ome::xml::meta::OMEXMLMetadata>
     createOMEXMLMetadata(std::istream& stream);
 
+    /**
+     * Create partial OME-XML metadata from XML string.
+     *
+     * A streaming parser is used to store only the OME UUID,
+     * BinaryOnly, the Plate, Well and WellSample elements needed to
+     * map well samples to Images, and the Image, Pixels, Channel,
+     * TiffData and UUID elements needed to map image planes to TIFF
+     * IFDs.  No DOM document is created, and the document is not
+     * validated.
+     * This is much cheaper than createOMEXMLMetadata() for large
+     * documents, and is sufficient to set up a reader's core
+     * metadata.
+     *
+     * @param text the XML string.
+     * @returns the partial OME-XML metadata, or null if the document
+     * is not well formed, uses a different model version, or
+     * contains XMLAnnotations; use createOMEXMLMetadata() for the
+     * complete model in this case.
+     */
+    std::shared_ptr<::ome::xml::meta::OMEXMLMetadata>
+    createTiffDataMetadata(const std::string& text);
+
+    /**
+     * Create partial OME-XML metadata from XML text.
+     *
+     * As for createTiffDataMetadata(const std::string&), but the
+     * text is parsed in place, without copying, so that it may be
+     * used with text held in another buffer, such as a TIFF
+     * ImageDescription (see tiff::IFD::visitField()).
+     *
+     * @param text the XML text.
+     * @param size the size of the XML text.
+     * @returns the partial OME-XML metadata, or null if the complete
+     * model is required.
+     */
+    std::shared_ptr<::ome::xml::meta::OMEXMLMetadata>
+    createTiffDataMetadata(const char  *text,
+                           std::size_t size);
+
     /**
      * Create OME-XML metadata from reader core metadata.
      *
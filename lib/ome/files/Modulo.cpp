@@ -59,6 +59,20 @@ namespace ome
     {
     }
 
+    bool
+    Modulo::operator== (const Modulo& rhs) const
+    {
+      return parentDimension == rhs.parentDimension &&
+        start == rhs.start &&
+        step == rhs.step &&
+        end == rhs.end &&
+        parentType == rhs.parentType &&
+        type == rhs.type &&
+        typeDescription == rhs.typeDescription &&
+        unit == rhs.unit &&
+        labels == rhs.labels;
+    }
+
     Modulo::size_type
     Modulo::size() const
     {
@@ -108,6 +108,27 @@ namespace ome
        */
       std::string
       toXMLAnnotation() const;
+
+      /**
+       * Compare for equality.
+       *
+       * @param rhs the Modulo to compare.
+       * @returns @c true if all fields are equal, @c false otherwise.
+       */
+      bool
+      operator== (const Modulo& rhs) const;
+
+      /**
+       * Compare for inequality.
+       *
+       * @param rhs the Modulo to compare.
+       * @returns @c true if any field differs, @c false otherwise.
+       */
+      bool
+      operator!= (const Modulo& rhs) const
+      {
+        return !(*this == rhs);
+      }
     };
 
     /**
@@ -0,0 +1,199 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <ome/files/config-internal.h>
+#include <ome/files/NUMA.h>
+
+#ifdef OME_HAVE_PTHREAD_SETAFFINITY_NP
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace ome
+{
+  namespace files
+  {
+
+    namespace
+    {
+
+      // Processors of each NUMA node.
+      struct Topology
+      {
+        Topology():
+          nodecpus(),
+          cpunodes()
+        {
+#ifdef OME_HAVE_PTHREAD_SETAFFINITY_NP
+          // Node numbers may not be contiguous, so nodes are
+          // renumbered in order.  The search stops at the first gap
+          // after the last possible node.
+          for (unsigned int node = 0U, missing = 0U; missing < 64U; ++node)
+            {
+              std::ostringstream name;
+              name << "/sys/devices/system/node/node" << node << "/cpulist";
+              std::ifstream cpulist(name.str());
+              std::string list;
+              if (!cpulist || !std::getline(cpulist, list))
+                {
+                  ++missing;
+                  continue;
+                }
+              missing = 0U;
+
+              std::vector<unsigned int> cpus(parseCPUList(list));
+              if (cpus.empty())
+                continue;
+              for (const auto cpu : cpus)
+                {
+                  if (cpu >= cpunodes.size())
+                    cpunodes.resize(cpu + 1U, 0U);
+                  cpunodes[cpu] = static_cast<dimension_size_type>(nodecpus.size());
+                }
+              nodecpus.push_back(cpus);
+            }
+#endif // OME_HAVE_PTHREAD_SETAFFINITY_NP
+
+          if (nodecpus.empty())
+            nodecpus.resize(1U);
+        }
+
+        // Parse a list of processor ranges, for example "0-7,16-23".
+        static std::vector<unsigned int>
+        parseCPUList(const std::string& list)
+        {
+          std::vector<unsigned int> cpus;
+          std::istringstream is(list);
+          std::string range;
+          while (std::getline(is, range, ','))
+            {
+              if (range.empty())
+                continue;
+              std::string::size_type dash = range.find('-');
+              unsigned long first = std::strtoul(range.c_str(), nullptr, 10);
+              unsigned long last = dash == std::string::npos ?
+                first : std::strtoul(range.c_str() + dash + 1, nullptr, 10);
+              for (unsigned long cpu = first; cpu <= last; ++cpu)
+                cpus.push_back(static_cast<unsigned int>(cpu));
+            }
+          return cpus;
+        }
+
+        /// Processors of each node.
+        std::vector<std::vector<unsigned int>> nodecpus;
+        /// Node of each processor.
+        std::vector<dimension_size_type> cpunodes;
+      };
+
+      const Topology&
+      topology()
+      {
+        static const Topology topology;
+        return topology;
+      }
+
+    }
+
+    dimension_size_type
+    numaNodeCount()
+    {
+      return static_cast<dimension_size_type>(topology().nodecpus.size());
+    }
+
+    dimension_size_type
+    currentNUMANode()
+    {
+#ifdef OME_HAVE_PTHREAD_SETAFFINITY_NP
+      const Topology& t(topology());
+      if (t.nodecpus.size() > 1U)
+        {
+          int cpu = sched_getcpu();
+          if (cpu >= 0 && static_cast<std::size_t>(cpu) < t.cpunodes.size())
+            return t.cpunodes[static_cast<std::size_t>(cpu)];
+        }
+#endif // OME_HAVE_PTHREAD_SETAFFINITY_NP
+      return 0U;
+    }
+
+    bool
+    bindThreadToNUMANode(dimension_size_type node)
+    {
+#ifdef OME_HAVE_PTHREAD_SETAFFINITY_NP
+      const Topology& t(topology());
+      const std::vector<unsigned int>& cpus(t.nodecpus[node % t.nodecpus.size()]);
+      if (cpus.empty())
+        return false;
+
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      for (const auto cpu : cpus)
+        if (cpu < CPU_SETSIZE)
+          CPU_SET(cpu, &set);
+      return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else // ! OME_HAVE_PTHREAD_SETAFFINITY_NP
+      static_cast<void>(node);
+      return false;
+#endif // OME_HAVE_PTHREAD_SETAFFINITY_NP
+    }
+
+    ThreadPoolExecutor::thread_init_type
+    numaThreadInit()
+    {
+      return [](dimension_size_type worker)
+        {
+          // Placement is advisory, so a failure to bind is ignored.
+          if (numaNodeCount() > 1U)
+            bindThreadToNUMANode(worker % numaNodeCount());
+        };
+    }
+
+  }
+}
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
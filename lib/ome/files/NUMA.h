@@ -0,0 +1,115 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+
+#ifndef OME_FILES_NUMA_H
+#define OME_FILES_NUMA_H
+
+#include <ome/files/Executor.h>
+#include <ome/files/Types.h>
+
+namespace ome
+{
+  namespace files
+  {
+
+    /**
+     * Get the number of NUMA nodes.
+     *
+     * Nodes are numbered from zero to one less than this count.  On
+     * systems without NUMA support, or where the topology can not be
+     * determined, all processors are on a single node.
+     *
+     * @returns the node count; at least one.
+     */
+    dimension_size_type
+    numaNodeCount();
+
+    /**
+     * Get the NUMA node of the calling thread.
+     *
+     * This is the node of the processor the thread is currently
+     * running on.  Unless the thread is bound to a node with
+     * bindThreadToNUMANode(), it may move to another node at any
+     * time.
+     *
+     * @returns the node, less than numaNodeCount().
+     */
+    dimension_size_type
+    currentNUMANode();
+
+    /**
+     * Bind the calling thread to the processors of a NUMA node.
+     *
+     * With the default (first touch) memory policy, pages are placed
+     * on the node of the thread which first writes to them, so memory
+     * first written by a bound thread is local to its node.
+     *
+     * @param node the node; if not less than numaNodeCount(), the
+     * node modulo the node count is used.
+     * @returns @c true if the thread was bound, or @c false if thread
+     * placement is not supported.
+     */
+    bool
+    bindThreadToNUMANode(dimension_size_type node);
+
+    /**
+     * ThreadPoolExecutor thread initialisation binding each worker
+     * to a NUMA node.
+     *
+     * Workers are assigned to nodes in turn, so that each node has
+     * an equal share of the workers.  With this executor, parallel
+     * decoding places each part of the destination buffer on the
+     * node of the worker decoding it, and tiles cached in a
+     * partitioned DecodedTileCache are cached on the node which
+     * decoded them.
+     *
+     * @returns the initialisation function.
+     */
+    ThreadPoolExecutor::thread_init_type
+    numaThreadInit();
+
+  }
+}
+
+#endif // OME_FILES_NUMA_H
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
@@ -0,0 +1,479 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+
+#include <stdexcept>
+
+#include <boost/format.hpp>
+
+#include <ome/files/MetadataTools.h>
+#include <ome/files/OMEXMLIndex.h>
+
+namespace
+{
+
+  const std::string::size_type npos = std::string::npos;
+
+  /// Tag types.
+  enum TagType
+    {
+      START_TAG, ///< Start tag.
+      END_TAG,   ///< End tag.
+      EMPTY_TAG  ///< Empty element tag.
+    };
+
+  /// A scanned tag.
+  struct Tag
+  {
+    /// Tag type.
+    TagType type;
+    /// Offset of the start of the tag.
+    std::string::size_type begin;
+    /// Offset following the end of the tag.
+    std::string::size_type end;
+    /// Element local name.
+    std::string name;
+    /// ID attribute value (may be empty).
+    std::string id;
+  };
+
+  void
+  malformed(std::string::size_type pos)
+  {
+    boost::format fmt("Malformed OME-XML document at offset %1%");
+    fmt % pos;
+    throw std::runtime_error(fmt.str());
+  }
+
+  std::string::size_type
+  findEnd(const std::string&     text,
+          const char            *delimiter,
+          std::string::size_type pos)
+  {
+    std::string::size_type found = text.find(delimiter, pos);
+    if (found == npos)
+      malformed(pos);
+    return found + std::char_traits<char>::length(delimiter);
+  }
+
+  bool
+  isSpace(char c)
+  {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+  }
+
+  std::string
+  localName(const std::string& qname)
+  {
+    std::string::size_type colon = qname.rfind(':');
+    return colon == npos ? qname : qname.substr(colon + 1);
+  }
+
+  // Replace the predefined entities; IDs are not expected to
+  // contain character references.
+  std::string
+  unescape(const std::string& value)
+  {
+    static const char *entities[][2] =
+      {
+        {"&lt;", "<"},
+        {"&gt;", ">"},
+        {"&quot;", "\""},
+        {"&apos;", "'"},
+        {"&amp;", "&"}
+      };
+
+    std::string ret;
+    ret.reserve(value.size());
+    for (std::string::size_type i = 0; i < value.size();)
+      {
+        bool replaced = false;
+        if (value[i] == '&')
+          {
+            for (const auto& entity : entities)
+              {
+                if (value.compare(i, std::char_traits<char>::length(entity[0]), entity[0]) == 0)
+                  {
+                    ret += entity[1];
+                    i += std::char_traits<char>::length(entity[0]);
+                    replaced = true;
+                    break;
+                  }
+              }
+          }
+        if (!replaced)
+          ret += value[i++];
+      }
+    return ret;
+  }
+
+  /**
+   * Scan the next tag.
+   *
+   * Character data, comments, processing instructions, CDATA
+   * sections and document type declarations are skipped.
+   *
+   * @param text the document text.
+   * @param pos the offset to start scanning from; updated to follow
+   * the tag.
+   * @param tag the scanned tag.
+   * @returns @c true if a tag was found, or @c false at the end of
+   * the text.
+   * @throws std::runtime_error if the text is not well-formed.
+   */
+  bool
+  nextTag(const std::string&      text,
+          std::string::size_type& pos,
+          Tag&                    tag)
+  {
+    const std::string::size_type size = text.size();
+    std::string::size_type lt;
+
+    while (true)
+      {
+        lt = text.find('<', pos);
+        if (lt == npos)
+          {
+            pos = size;
+            return false;
+          }
+
+        if (text.compare(lt, 4, "<!--") == 0)
+          pos = findEnd(text, "-->", lt + 4);
+        else if (text.compare(lt, 9, "<![CDATA[") == 0)
+          pos = findEnd(text, "]]>", lt + 9);
+        else if (text.compare(lt, 2, "<?") == 0)
+          pos = findEnd(text, "?>", lt + 2);
+        else if (text.compare(lt, 2, "<!") == 0)
+          {
+            // Document type declaration, possibly with an internal
+            // subset.
+            std::string::size_type p = lt + 2;
+            unsigned int depth = 0;
+            for (; p < size; ++p)
+              {
+                if (text[p] == '[')
+                  ++depth;
+                else if (text[p] == ']' && depth)
+                  --depth;
+                else if (text[p] == '>' && !depth)
+                  break;
+              }
+            if (p >= size)
+              malformed(lt);
+            pos = p + 1;
+          }
+        else
+          break;
+      }
+
+    tag.begin = lt;
+    tag.id.clear();
+
+    std::string::size_type p = lt + 1;
+    bool endTag = false;
+    if (p < size && text[p] == '/')
+      {
+        endTag = true;
+        ++p;
+      }
+
+    std::string::size_type nameBegin = p;
+    while (p < size && !isSpace(text[p]) && text[p] != '/' && text[p] != '>')
+      ++p;
+    if (p == nameBegin || p >= size)
+      malformed(lt);
+    tag.name = localName(text.substr(nameBegin, p - nameBegin));
+
+    if (endTag)
+      {
+        while (p < size && isSpace(text[p]))
+          ++p;
+        if (p >= size || text[p] != '>')
+          malformed(lt);
+        tag.type = END_TAG;
+        tag.end = p + 1;
+        pos = tag.end;
+        return true;
+      }
+
+    while (true)
+      {
+        while (p < size && isSpace(text[p]))
+          ++p;
+        if (p >= size)
+          malformed(lt);
+
+        if (text[p] == '>')
+          {
+            tag.type = START_TAG;
+            tag.end = p + 1;
+            break;
+          }
+        if (text[p] == '/')
+          {
+            if (p + 1 >= size || text[p + 1] != '>')
+              malformed(lt);
+            tag.type = EMPTY_TAG;
+            tag.end = p + 2;
+            break;
+          }
+
+        std::string::size_type attrBegin = p;
+        while (p < size && !isSpace(text[p]) && text[p] != '=' && text[p] != '/' && text[p] != '>')
+          ++p;
+        const std::string attr(text.substr(attrBegin, p - attrBegin));
+        while (p < size && isSpace(text[p]))
+          ++p;
+        if (attr.empty() || p >= size || text[p] != '=')
+          malformed(lt);
+        ++p;
+        while (p < size && isSpace(text[p]))
+          ++p;
+        if (p >= size || (text[p] != '"' && text[p] != '\''))
+          malformed(lt);
+        std::string::size_type valueEnd = text.find(text[p], p + 1);
+        if (valueEnd == npos)
+          malformed(lt);
+        if (attr == "ID")
+          tag.id = unescape(text.substr(p + 1, valueEnd - p - 1));
+        p = valueEnd + 1;
+      }
+
+    pos = tag.end;
+    return true;
+  }
+
+}
+
+namespace ome
+{
+  namespace files
+  {
+
+    OMEXMLIndex::OMEXMLIndex(const std::string& text):
+      text(text),
+      rootBegin(npos),
+      rootStartEnd(npos),
+      rootEndBegin(npos),
+      rootEnd(npos),
+      elements(),
+      images(),
+      annotationsIndex(0),
+      annotationsStartEnd(npos),
+      annotationsEndBegin(npos),
+      annotations(),
+      mutex(),
+      cache()
+    {
+      std::string::size_type pos = 0;
+      dimension_size_type depth = 0;
+      bool hasAnnotations = false;
+      bool inAnnotations = false;
+      Tag tag;
+
+      while (nextTag(this->text, pos, tag))
+        {
+          if (depth == 0)
+            {
+              // Only a single root element is permitted.
+              if (rootBegin != npos || tag.type == END_TAG)
+                malformed(tag.begin);
+              rootBegin = tag.begin;
+              rootStartEnd = tag.end;
+              if (tag.type == EMPTY_TAG)
+                rootEndBegin = rootEnd = tag.end;
+              else
+                ++depth;
+              continue;
+            }
+
+          if (tag.type == END_TAG)
+            {
+              --depth;
+              if (depth == 0)
+                {
+                  rootEndBegin = tag.begin;
+                  rootEnd = tag.end;
+                }
+              else if (depth == 1)
+                {
+                  elements.back().end = tag.end;
+                  if (inAnnotations)
+                    {
+                      annotationsEndBegin = tag.begin;
+                      inAnnotations = false;
+                    }
+                }
+              else if (depth == 2 && inAnnotations)
+                {
+                  annotations.back().end = tag.end;
+                }
+              continue;
+            }
+
+          if (depth == 1)
+            {
+              Element element;
+              element.name = tag.name;
+              element.id = tag.id;
+              element.begin = tag.begin;
+              element.end = tag.end;
+              if (element.name == "Image")
+                images.push_back(elements.size());
+              else if (element.name == "StructuredAnnotations" && !hasAnnotations)
+                {
+                  hasAnnotations = true;
+                  annotationsIndex = elements.size();
+                  annotationsStartEnd = tag.end;
+                  inAnnotations = tag.type == START_TAG;
+                }
+              elements.push_back(element);
+            }
+          else if (depth == 2 && inAnnotations)
+            {
+              Element annotation;
+              annotation.name = tag.name;
+              annotation.id = tag.id;
+              annotation.begin = tag.begin;
+              annotation.end = tag.end;
+              annotations.push_back(annotation);
+            }
+          else if ((tag.name == "AnnotationRef" || tag.name == "ROIRef") && !tag.id.empty())
+            {
+              if (inAnnotations)
+                annotations.back().refs.insert(tag.id);
+              else
+                elements.back().refs.insert(tag.id);
+            }
+
+          if (tag.type == START_TAG)
+            ++depth;
+        }
+
+      if (rootBegin == npos || rootEnd == npos || depth != 0)
+        malformed(this->text.size());
+      if (!hasAnnotations)
+        annotationsIndex = elements.size();
+    }
+
+    dimension_size_type
+    OMEXMLIndex::getImageCount() const
+    {
+      return images.size();
+    }
+
+    const std::string&
+    OMEXMLIndex::getImageID(dimension_size_type image) const
+    {
+      return elements.at(images.at(image)).id;
+    }
+
+    std::string
+    OMEXMLIndex::getImageText(dimension_size_type image) const
+    {
+      const std::vector<Element>::size_type imageIndex = images.at(image);
+      const Element& imageElement(elements.at(imageIndex));
+
+      // Annotations referenced by the Image, its ROIs and the other
+      // top-level elements.
+      std::set<std::string> wanted(imageElement.refs);
+      for (const auto& element : elements)
+        {
+          if (element.name == "ROI")
+            {
+              if (imageElement.refs.count(element.id))
+                wanted.insert(element.refs.begin(), element.refs.end());
+            }
+          else if (element.name != "Image")
+            wanted.insert(element.refs.begin(), element.refs.end());
+        }
+      // Annotations referenced by the annotations.
+      bool changed = true;
+      while (changed)
+        {
+          changed = false;
+          for (const auto& annotation : annotations)
+            if (wanted.count(annotation.id))
+              for (const auto& ref : annotation.refs)
+                if (wanted.insert(ref).second)
+                  changed = true;
+        }
+
+      std::string doc(text, 0, rootStartEnd);
+      for (std::vector<Element>::size_type i = 0; i < elements.size(); ++i)
+        {
+          const Element& element(elements[i]);
+          if (element.name == "Image" && i != imageIndex)
+            continue;
+          if (element.name == "ROI" && !imageElement.refs.count(element.id))
+            continue;
+
+          if (i == annotationsIndex && annotationsStartEnd < element.end)
+            {
+              doc.append(text, element.begin, annotationsStartEnd - element.begin);
+              for (const auto& annotation : annotations)
+                if (wanted.count(annotation.id))
+                  doc.append(text, annotation.begin, annotation.end - annotation.begin);
+              doc.append(text, annotationsEndBegin, element.end - annotationsEndBegin);
+            }
+          else
+            {
+              doc.append(text, element.begin, element.end - element.begin);
+            }
+        }
+      doc.append(text, rootEndBegin, rootEnd - rootEndBegin);
+
+      return doc;
+    }
+
+    std::shared_ptr<::ome::xml::meta::OMEXMLMetadata>
+    OMEXMLIndex::getImageMetadata(dimension_size_type image) const
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+
+      auto cached = cache.find(image);
+      if (cached != cache.end())
+        return cached->second;
+
+      std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> meta(createOMEXMLMetadata(getImageText(image)));
+      cache.insert(std::make_pair(image, meta));
+      return meta;
+    }
+
+  }
+}
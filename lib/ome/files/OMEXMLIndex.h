@@ -0,0 +1,191 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+
+#ifndef OME_FILES_OMEXMLINDEX_H
+#define OME_FILES_OMEXMLINDEX_H
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <ome/files/Types.h>
+
+#include <ome/xml/meta/OMEXMLMetadata.h>
+
+namespace ome
+{
+  namespace files
+  {
+
+    /**
+     * Index of the top-level elements of an OME-XML document.
+     *
+     * The document text is scanned once, without building a DOM or
+     * any model objects, to record the byte range of each top-level
+     * element, each annotation, and the annotation and ROI
+     * references they contain.  OME-XML metadata for a single Image
+     * may then be created on demand, by parsing a reduced document
+     * containing only that Image, the ROIs and annotations it refers
+     * to, and the other top-level elements (instruments, plates,
+     * etc.).  For documents with many Images, such as plates, the
+     * cost of opening and the memory used then depend upon the
+     * Images used, rather than the size of the document.
+     *
+     * References to Images not present in the reduced document, for
+     * example from a Plate or Dataset, will remain unresolved.
+     *
+     * This class is thread-safe.
+     */
+    class OMEXMLIndex
+    {
+    public:
+      /**
+       * Constructor.
+       *
+       * @param text the OME-XML document text.
+       * @throws std::runtime_error if the document is not well-formed.
+       */
+      explicit
+      OMEXMLIndex(const std::string& text);
+
+      /// @cond SKIP
+      OMEXMLIndex (const OMEXMLIndex&) = delete;
+
+      OMEXMLIndex&
+      operator= (const OMEXMLIndex&) = delete;
+      /// @endcond SKIP
+
+      /**
+       * Get the number of Images.
+       *
+       * @returns the Image count.
+       */
+      dimension_size_type
+      getImageCount() const;
+
+      /**
+       * Get the ID of an Image.
+       *
+       * @param image the Image index.
+       * @returns the Image ID.
+       * @throws std::out_of_range if the index is invalid.
+       */
+      const std::string&
+      getImageID(dimension_size_type image) const;
+
+      /**
+       * Get a reduced OME-XML document for a single Image.
+       *
+       * @param image the Image index.
+       * @returns the document text.
+       * @throws std::out_of_range if the index is invalid.
+       */
+      std::string
+      getImageText(dimension_size_type image) const;
+
+      /**
+       * Get OME-XML metadata for a single Image.
+       *
+       * The reduced document for the Image is parsed on first
+       * access, and cached.  The metadata contains only this Image,
+       * at Image index 0.
+       *
+       * @param image the Image index.
+       * @returns the OME-XML metadata.
+       * @throws std::out_of_range if the index is invalid.
+       */
+      std::shared_ptr<::ome::xml::meta::OMEXMLMetadata>
+      getImageMetadata(dimension_size_type image) const;
+
+    private:
+      /// An indexed element.
+      struct Element
+      {
+        /// Local name.
+        std::string name;
+        /// ID attribute value (may be empty).
+        std::string id;
+        /// Offset of the start of the element.
+        std::string::size_type begin;
+        /// Offset following the end of the element.
+        std::string::size_type end;
+        /// IDs of the annotations and ROIs referenced.
+        std::set<std::string> refs;
+      };
+
+      /// The document text.
+      std::string text;
+      /// Offset of the start of the root element.
+      std::string::size_type rootBegin;
+      /// Offset following the root element start tag.
+      std::string::size_type rootStartEnd;
+      /// Offset of the start of the root element end tag.
+      std::string::size_type rootEndBegin;
+      /// Offset following the root element.
+      std::string::size_type rootEnd;
+      /// Top-level elements, in document order.
+      std::vector<Element> elements;
+      /// Indexes of the Image elements in elements.
+      std::vector<std::vector<Element>::size_type> images;
+      /// Index of the StructuredAnnotations element in elements (or elements.size()).
+      std::vector<Element>::size_type annotationsIndex;
+      /// Offset following the StructuredAnnotations start tag.
+      std::string::size_type annotationsStartEnd;
+      /// Offset of the start of the StructuredAnnotations end tag.
+      std::string::size_type annotationsEndBegin;
+      /// Annotations, in document order.
+      std::vector<Element> annotations;
+      /// Mutex protecting the cache.
+      mutable std::mutex mutex;
+      /// Parsed metadata for each Image.
+      mutable std::map<dimension_size_type, std::shared_ptr<::ome::xml::meta::OMEXMLMetadata>> cache;
+    };
+
+  }
+}
+
+#endif // OME_FILES_OMEXMLINDEX_H
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
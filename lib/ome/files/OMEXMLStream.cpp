@@ -0,0 +1,599 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <iomanip>
+#include <limits>
+#include <locale>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+
+#include <ome/files/OMEXMLStream.h>
+
+#include <ome/xml/meta/OMEXMLMetadataRoot.h>
+#include <ome/xml/model/Annotation.h>
+#include <ome/xml/model/Channel.h>
+#include <ome/xml/model/Image.h>
+#include <ome/xml/model/OriginalMetadataAnnotation.h>
+#include <ome/xml/model/Pixels.h>
+#include <ome/xml/model/Plane.h>
+#include <ome/xml/model/Plate.h>
+#include <ome/xml/model/StructuredAnnotations.h>
+#include <ome/xml/model/TiffData.h>
+#include <ome/xml/model/UUID.h>
+#include <ome/xml/model/Well.h>
+#include <ome/xml/model/WellSample.h>
+#include <ome/xml/model/XMLAnnotation.h>
+#include <ome/xml/model/primitives/Quantity.h>
+#include <ome/xml/version.h>
+
+using ome::xml::meta::OMEXMLMetadata;
+using ome::xml::meta::OMEXMLMetadataRoot;
+using ome::xml::model::Annotation;
+using ome::xml::model::Channel;
+using ome::xml::model::Image;
+using ome::xml::model::OriginalMetadataAnnotation;
+using ome::xml::model::Pixels;
+using ome::xml::model::Plane;
+using ome::xml::model::Plate;
+using ome::xml::model::StructuredAnnotations;
+using ome::xml::model::TiffData;
+using ome::xml::model::UUID;
+using ome::xml::model::Well;
+using ome::xml::model::WellSample;
+using ome::xml::model::XMLAnnotation;
+using ome::xml::model::primitives::Quantity;
+
+namespace
+{
+
+  // Get a linked model object, whether held by a shared or weak
+  // pointer.
+  template<typename T>
+  std::shared_ptr<T>
+  linked(const std::shared_ptr<T>& object)
+  {
+    return object;
+  }
+
+  template<typename T>
+  std::shared_ptr<T>
+  linked(const std::weak_ptr<T>& object)
+  {
+    return object.lock();
+  }
+
+  std::shared_ptr<OMEXMLMetadataRoot>
+  metadataRoot(OMEXMLMetadata& omexml)
+  {
+    return std::dynamic_pointer_cast<OMEXMLMetadataRoot>(omexml.getRoot());
+  }
+
+  // Writes elements and attributes to a stream.  Values are
+  // formatted in the classic locale, with floating point values at
+  // full precision so that they are read back unchanged.
+  class Serialiser
+  {
+  public:
+    explicit
+    Serialiser(std::ostream& stream):
+      stream(stream),
+      format()
+    {
+      format.imbue(std::locale::classic());
+      format << std::boolalpha
+             << std::setprecision(std::numeric_limits<double>::max_digits10);
+    }
+
+    // Write text with the special characters replaced by entities.
+    void
+    escaped(const std::string& text)
+    {
+      std::string::size_type begin = 0U;
+      for (std::string::size_type i = 0U; i < text.size(); ++i)
+        {
+          const char *entity = nullptr;
+          switch (text[i])
+            {
+            case '<':
+              entity = "&lt;";
+              break;
+            case '>':
+              entity = "&gt;";
+              break;
+            case '&':
+              entity = "&amp;";
+              break;
+            case '"':
+              entity = "&quot;";
+              break;
+            case '\'':
+              entity = "&apos;";
+              break;
+            default:
+              break;
+            }
+          if (entity)
+            {
+              stream.write(text.data() + begin, static_cast<std::streamsize>(i - begin));
+              stream << entity;
+              begin = i + 1U;
+            }
+        }
+      stream.write(text.data() + begin, static_cast<std::streamsize>(text.size() - begin));
+    }
+
+    // Format a value as text.
+    template<typename T>
+    std::string
+    str(const T& value)
+    {
+      format.str(std::string());
+      format << value;
+      return format.str();
+    }
+
+    const std::string&
+    str(const std::string& value)
+    {
+      return value;
+    }
+
+    // Write the start of a start tag.  Attributes may follow.
+    void
+    start(const char *name)
+    {
+      stream << '<' << name;
+    }
+
+    // Write the end of a start tag, or of an empty element tag if
+    // there is no content.  Returns true if there is content, in
+    // which case an end tag must follow it.
+    bool
+    content(bool content)
+    {
+      stream << (content ? ">" : "/>");
+      return content;
+    }
+
+    // Write an end tag.
+    void
+    end(const char *name)
+    {
+      stream << "</" << name << '>';
+    }
+
+    // Write an attribute.
+    template<typename T>
+    void
+    attribute(const std::string& name,
+              const T&           value)
+    {
+      stream << ' ' << name << "=\"";
+      escaped(str(value));
+      stream << '"';
+    }
+
+    // Write an optional attribute, if set.
+    template<typename T>
+    void
+    attribute(const std::string&        name,
+              const std::shared_ptr<T>& value)
+    {
+      if (value)
+        attribute(name, *value);
+    }
+
+    // Write a quantity as value and unit attributes.
+    template<typename Unit, typename Value>
+    void
+    attribute(const std::string&            name,
+              const Quantity<Unit, Value>&  value)
+    {
+      attribute(name, value.getValue());
+      attribute(name + "Unit", value.getUnit());
+    }
+
+    // Write an element containing text only.
+    template<typename T>
+    void
+    text(const char *name,
+         const T&    value)
+    {
+      stream << '<' << name << '>';
+      escaped(str(value));
+      end(name);
+    }
+
+    // Write an optional element containing text only, if set.
+    template<typename T>
+    void
+    text(const char                *name,
+         const std::shared_ptr<T>&  value)
+    {
+      if (value)
+        text(name, *value);
+    }
+
+    // Write a reference to a linked model object.
+    template<typename T>
+    void
+    reference(const char *name,
+              const T&    object)
+    {
+      auto target(linked(object));
+      if (target)
+        {
+          start(name);
+          attribute("ID", target->getID());
+          content(false);
+        }
+    }
+
+    // Write references to the annotations linked to a model object.
+    template<typename T>
+    void
+    annotationRefs(const T& object)
+    {
+      for (const auto& annotation : object.getLinkedAnnotationList())
+        reference("AnnotationRef", annotation);
+    }
+
+    // Write raw text, which must be well-formed XML content.
+    void
+    raw(const std::string& text)
+    {
+      stream << text;
+    }
+
+  private:
+    std::ostream&      stream;
+    std::ostringstream format;
+  };
+
+  void
+  writeChannel(Serialiser&    out,
+               const Channel& channel)
+  {
+    out.start("Channel");
+    out.attribute("ID", channel.getID());
+    out.attribute("Name", channel.getName());
+    out.attribute("SamplesPerPixel", channel.getSamplesPerPixel());
+    out.attribute("IlluminationType", channel.getIlluminationType());
+    out.attribute("PinholeSize", channel.getPinholeSize());
+    out.attribute("AcquisitionMode", channel.getAcquisitionMode());
+    out.attribute("ContrastMethod", channel.getContrastMethod());
+    out.attribute("ExcitationWavelength", channel.getExcitationWavelength());
+    out.attribute("EmissionWavelength", channel.getEmissionWavelength());
+    out.attribute("Fluor", channel.getFluor());
+    out.attribute("NDFilter", channel.getNDFilter());
+    out.attribute("PockelCellSetting", channel.getPockelCellSetting());
+    out.attribute("Color", channel.getColor());
+    if (out.content(!channel.getLinkedAnnotationList().empty()))
+      {
+        out.annotationRefs(channel);
+        out.end("Channel");
+      }
+  }
+
+  void
+  writeTiffData(Serialiser&     out,
+                const TiffData& tiffdata)
+  {
+    out.start("TiffData");
+    out.attribute("IFD", tiffdata.getIFD());
+    out.attribute("FirstZ", tiffdata.getFirstZ());
+    out.attribute("FirstT", tiffdata.getFirstT());
+    out.attribute("FirstC", tiffdata.getFirstC());
+    out.attribute("PlaneCount", tiffdata.getPlaneCount());
+    std::shared_ptr<UUID> uuid(tiffdata.getUUID());
+    if (out.content(static_cast<bool>(uuid)))
+      {
+        out.start("UUID");
+        out.attribute("FileName", uuid->getFileName());
+        out.content(true);
+        out.escaped(out.str(uuid->getValue()));
+        out.end("UUID");
+        out.end("TiffData");
+      }
+  }
+
+  void
+  writePlane(Serialiser&  out,
+             const Plane& plane)
+  {
+    out.start("Plane");
+    out.attribute("TheZ", plane.getTheZ());
+    out.attribute("TheT", plane.getTheT());
+    out.attribute("TheC", plane.getTheC());
+    out.attribute("DeltaT", plane.getDeltaT());
+    out.attribute("ExposureTime", plane.getExposureTime());
+    out.attribute("PositionX", plane.getPositionX());
+    out.attribute("PositionY", plane.getPositionY());
+    out.attribute("PositionZ", plane.getPositionZ());
+    auto hash(plane.getHashSHA1());
+    if (out.content(hash || !plane.getLinkedAnnotationList().empty()))
+      {
+        out.text("HashSHA1", hash);
+        out.annotationRefs(plane);
+        out.end("Plane");
+      }
+  }
+
+  void
+  writePixels(Serialiser&   out,
+              const Pixels& pixels)
+  {
+    out.start("Pixels");
+    out.attribute("ID", pixels.getID());
+    out.attribute("DimensionOrder", pixels.getDimensionOrder());
+    out.attribute("Type", pixels.getType());
+    out.attribute("SignificantBits", pixels.getSignificantBits());
+    out.attribute("Interleaved", pixels.getInterleaved());
+    out.attribute("BigEndian", pixels.getBigEndian());
+    out.attribute("SizeX", pixels.getSizeX());
+    out.attribute("SizeY", pixels.getSizeY());
+    out.attribute("SizeZ", pixels.getSizeZ());
+    out.attribute("SizeC", pixels.getSizeC());
+    out.attribute("SizeT", pixels.getSizeT());
+    out.attribute("PhysicalSizeX", pixels.getPhysicalSizeX());
+    out.attribute("PhysicalSizeY", pixels.getPhysicalSizeY());
+    out.attribute("PhysicalSizeZ", pixels.getPhysicalSizeZ());
+    out.attribute("TimeIncrement", pixels.getTimeIncrement());
+    if (out.content(!pixels.getChannelList().empty() ||
+                    !pixels.getTiffDataList().empty() ||
+                    !pixels.getPlaneList().empty()))
+      {
+        for (const auto& channel : pixels.getChannelList())
+          writeChannel(out, *channel);
+        for (const auto& tiffdata : pixels.getTiffDataList())
+          writeTiffData(out, *tiffdata);
+        for (const auto& plane : pixels.getPlaneList())
+          writePlane(out, *plane);
+        out.end("Pixels");
+      }
+  }
+
+  void
+  writeImage(Serialiser&  out,
+             const Image& image)
+  {
+    out.start("Image");
+    out.attribute("ID", image.getID());
+    out.attribute("Name", image.getName());
+    out.content(true);
+    out.text("AcquisitionDate", image.getAcquisitionDate());
+    out.text("Description", image.getDescription());
+    std::shared_ptr<Pixels> pixels(image.getPixels());
+    if (pixels)
+      writePixels(out, *pixels);
+    out.annotationRefs(image);
+    out.end("Image");
+  }
+
+  void
+  writeWellSample(Serialiser&       out,
+                  const WellSample& sample)
+  {
+    out.start("WellSample");
+    out.attribute("ID", sample.getID());
+    out.attribute("PositionX", sample.getPositionX());
+    out.attribute("PositionY", sample.getPositionY());
+    out.attribute("Timepoint", sample.getTimepoint());
+    out.attribute("Index", sample.getIndex());
+    std::shared_ptr<Image> image(linked(sample.getLinkedImage()));
+    if (out.content(image || !sample.getLinkedAnnotationList().empty()))
+      {
+        out.reference("ImageRef", image);
+        out.annotationRefs(sample);
+        out.end("WellSample");
+      }
+  }
+
+  void
+  writeWell(Serialiser& out,
+            const Well& well)
+  {
+    out.start("Well");
+    out.attribute("ID", well.getID());
+    out.attribute("Column", well.getColumn());
+    out.attribute("Row", well.getRow());
+    out.attribute("ExternalDescription", well.getExternalDescription());
+    out.attribute("ExternalIdentifier", well.getExternalIdentifier());
+    out.attribute("Type", well.getType());
+    out.attribute("Color", well.getColor());
+    if (out.content(!well.getWellSampleList().empty() ||
+                    !well.getLinkedAnnotationList().empty()))
+      {
+        for (const auto& sample : well.getWellSampleList())
+          writeWellSample(out, *sample);
+        out.annotationRefs(well);
+        out.end("Well");
+      }
+  }
+
+  void
+  writePlate(Serialiser&  out,
+             const Plate& plate)
+  {
+    out.start("Plate");
+    out.attribute("ID", plate.getID());
+    out.attribute("Name", plate.getName());
+    out.attribute("Status", plate.getStatus());
+    out.attribute("ExternalIdentifier", plate.getExternalIdentifier());
+    out.attribute("ColumnNamingConvention", plate.getColumnNamingConvention());
+    out.attribute("RowNamingConvention", plate.getRowNamingConvention());
+    out.attribute("WellOriginX", plate.getWellOriginX());
+    out.attribute("WellOriginY", plate.getWellOriginY());
+    out.attribute("Rows", plate.getRows());
+    out.attribute("Columns", plate.getColumns());
+    out.attribute("FieldIndex", plate.getFieldIndex());
+    out.content(true);
+    out.text("Description", plate.getDescription());
+    for (const auto& well : plate.getWellList())
+      writeWell(out, *well);
+    out.annotationRefs(plate);
+    out.end("Plate");
+  }
+
+  void
+  writeXMLAnnotation(Serialiser&          out,
+                     const XMLAnnotation& annotation)
+  {
+    out.start("XMLAnnotation");
+    out.attribute("ID", annotation.getID());
+    out.attribute("Namespace", annotation.getNamespace());
+    out.attribute("Annotator", annotation.getAnnotator());
+    out.content(true);
+    out.text("Description", annotation.getDescription());
+    out.annotationRefs(annotation);
+    out.start("Value");
+    out.content(true);
+    // The value of original metadata annotations is held as a key
+    // and value, rather than as XML text.
+    const OriginalMetadataAnnotation *original = dynamic_cast<const OriginalMetadataAnnotation *>(&annotation);
+    if (original)
+      {
+        const OriginalMetadataAnnotation::metadata_type kv(original->getMetadata());
+        out.start("OriginalMetadata");
+        out.content(true);
+        out.text("Key", kv.first);
+        out.text("Value", kv.second);
+        out.end("OriginalMetadata");
+      }
+    else
+      out.raw(annotation.getValue());
+    out.end("Value");
+    out.end("XMLAnnotation");
+  }
+
+}
+
+namespace ome
+{
+  namespace files
+  {
+
+    bool
+    canWriteOMEXML(::ome::xml::meta::OMEXMLMetadata& omexml)
+    {
+      std::shared_ptr<OMEXMLMetadataRoot> root(metadataRoot(omexml));
+      if (!root || root->getRights() || root->getBinaryOnly())
+        return false;
+
+      if (omexml.getProjectCount() || omexml.getDatasetCount() ||
+          omexml.getFolderCount() || omexml.getExperimentCount() ||
+          omexml.getScreenCount() || omexml.getExperimenterCount() ||
+          omexml.getExperimenterGroupCount() || omexml.getInstrumentCount() ||
+          omexml.getROICount())
+        return false;
+
+      if (omexml.getBooleanAnnotationCount() || omexml.getCommentAnnotationCount() ||
+          omexml.getDoubleAnnotationCount() || omexml.getFileAnnotationCount() ||
+          omexml.getListAnnotationCount() || omexml.getLongAnnotationCount() ||
+          omexml.getMapAnnotationCount() || omexml.getTagAnnotationCount() ||
+          omexml.getTermAnnotationCount() || omexml.getTimestampAnnotationCount())
+        return false;
+
+      for (const auto& plate : root->getPlateList())
+        if (!plate->getPlateAcquisitionList().empty())
+          return false;
+
+      for (const auto& image : root->getImageList())
+        {
+          if (image->getObjectiveSettings() || image->getImagingEnvironment() ||
+              image->getStageLabel())
+            return false;
+
+          std::shared_ptr<Pixels> pixels(image->getPixels());
+          if (!pixels)
+            continue;
+          if (!pixels->getBinDataList().empty() || pixels->getMetadataOnly())
+            return false;
+          for (const auto& channel : pixels->getChannelList())
+            if (channel->getLightSourceSettings() || channel->getDetectorSettings() ||
+                channel->getLightPath())
+              return false;
+        }
+
+      return true;
+    }
+
+    void
+    writeOMEXML(::ome::xml::meta::OMEXMLMetadata& omexml,
+                std::ostream&                     stream,
+                const std::string&                uuid)
+    {
+      if (!canWriteOMEXML(omexml))
+        throw std::logic_error("OME-XML metadata contains elements which may not be streamed");
+
+      std::shared_ptr<OMEXMLMetadataRoot> root(metadataRoot(omexml));
+      const std::string ns(std::string("http://www.openmicroscopy.org/Schemas/OME/") + OME_XML_MODEL_VERSION);
+
+      Serialiser out(stream);
+      out.raw("<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\"?>\n");
+      out.start("OME");
+      out.attribute("xmlns", ns);
+      out.attribute("xmlns:xsi", std::string("http://www.w3.org/2001/XMLSchema-instance"));
+      out.attribute("xsi:schemaLocation", ns + " " + ns + "/ome.xsd");
+      if (uuid.empty())
+        out.attribute("UUID", root->getUUID());
+      else
+        out.attribute("UUID", uuid);
+      out.attribute("Creator", root->getCreator());
+      out.content(true);
+
+      for (const auto& plate : root->getPlateList())
+        writePlate(out, *plate);
+      for (const auto& image : root->getImageList())
+        writeImage(out, *image);
+
+      std::shared_ptr<StructuredAnnotations> sa(root->getStructuredAnnotations());
+      if (sa && !sa->getXMLAnnotationList().empty())
+        {
+          out.start("StructuredAnnotations");
+          out.content(true);
+          for (const auto& annotation : sa->getXMLAnnotationList())
+            writeXMLAnnotation(out, *annotation);
+          out.end("StructuredAnnotations");
+        }
+
+      out.end("OME");
+    }
+
+  }
+}
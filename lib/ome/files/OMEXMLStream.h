@@ -0,0 +1,105 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#ifndef OME_FILES_OMEXMLSTREAM_H
+#define OME_FILES_OMEXMLSTREAM_H
+
+#include <ostream>
+#include <string>
+
+#include <ome/xml/meta/OMEXMLMetadata.h>
+
+namespace ome
+{
+  namespace files
+  {
+
+    /**
+     * Check if OME-XML metadata may be written by writeOMEXML().
+     *
+     * The streaming serialiser covers the metadata written for
+     * images stored as OME-TIFF: Images with their Pixels, Channels,
+     * TiffData and Planes, Plates with their Wells and WellSamples,
+     * and XML annotations (including original metadata).  Metadata
+     * containing any other elements, such as instruments, ROIs or
+     * other annotation types, must be serialised with getOMEXML().
+     *
+     * References must be resolved before checking.
+     *
+     * @param omexml the OME-XML metadata store.
+     * @returns @c true if the metadata may be streamed, @c false
+     * otherwise.
+     */
+    bool
+    canWriteOMEXML(::ome::xml::meta::OMEXMLMetadata& omexml);
+
+    /**
+     * Write an OME-XML document from OME-XML metadata to a stream.
+     *
+     * The document is written element by element directly from the
+     * metadata model, without building a DOM or holding the
+     * document text in memory.  For metadata with many Planes and
+     * TiffData elements, such as large plates, this is much faster
+     * than getOMEXML(), and uses no memory beyond the model itself.
+     * The metadata is not modified, so the same metadata may be
+     * written to several streams concurrently.  The document is
+     * not validated.
+     *
+     * References must be resolved before writing.
+     *
+     * @param omexml the OME-XML metadata store.
+     * @param stream the stream to write to.
+     * @param uuid the UUID of the root element; if empty, the UUID
+     * of the metadata is used.
+     * @throws std::logic_error if the metadata may not be streamed
+     * (see canWriteOMEXML()).
+     */
+    void
+    writeOMEXML(::ome::xml::meta::OMEXMLMetadata& omexml,
+                std::ostream&                     stream,
+                const std::string&                uuid = std::string());
+
+  }
+}
+
+#endif // OME_FILES_OMEXMLSTREAM_H
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
@@ -0,0 +1,189 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <exception>
+#include <stdexcept>
+#include <vector>
+
+#include <boost/format.hpp>
+
+#include <ome/files/Executor.h>
+#include <ome/files/FormatReader.h>
+#include <ome/files/OrthogonalSlice.h>
+#include <ome/files/PixelBufferView.h>
+#include <ome/files/PixelCopy.h>
+
+namespace ome
+{
+  namespace files
+  {
+
+    namespace
+    {
+
+      // Copy the slice of one plane into a row of the destination.
+      // For a YZ slice, the source is a single column, so its X and
+      // Y strides are exchanged to copy the column as a row.
+      struct SliceCopyVisitor : public boost::static_visitor<>
+      {
+        VariantPixelBuffer& dest;
+        dimension_size_type row;
+        bool                transpose;
+
+        SliceCopyVisitor(VariantPixelBuffer& dest,
+                         dimension_size_type row,
+                         bool                transpose):
+          dest(dest),
+          row(row),
+          transpose(transpose)
+        {}
+
+        template<typename T>
+        void
+        operator()(const T& src)
+        {
+          typedef typename T::element_type::value_type value_type;
+
+          PixelBufferView<const value_type> srcview(*src);
+          PixelBufferView<value_type> destview(*boost::get<T>(dest.vbuffer()));
+
+          region_strides_type srcstrides(srcview.strides());
+          if (transpose)
+            std::swap(srcstrides[DIM_SPATIAL_X], srcstrides[DIM_SPATIAL_Y]);
+
+          region_shape_type shape(destview.shape());
+          shape[DIM_SPATIAL_Y] = 1U;
+
+          PixelBufferBase::indices_type destorigin;
+          std::fill(destorigin.begin(), destorigin.end(), 0);
+          destorigin[DIM_SPATIAL_Y] = static_cast<PixelBufferBase::index>(row);
+
+          copyStrided(srcview.data(), srcstrides,
+                      destview.pointer(destorigin), destview.strides(),
+                      shape);
+        }
+      };
+
+    }
+
+    void
+    readOrthogonalSlice(const FormatReader& reader,
+                        SliceOrientation    orientation,
+                        dimension_size_type position,
+                        dimension_size_type c,
+                        dimension_size_type t,
+                        VariantPixelBuffer& dest,
+                        dimension_size_type threads)
+    {
+      const dimension_size_type sizeX = reader.getSizeX();
+      const dimension_size_type sizeY = reader.getSizeY();
+      const dimension_size_type sizeZ = reader.getSizeZ();
+
+      if (position >= (orientation == SLICE_XZ ? sizeY : sizeX))
+        {
+          boost::format fmt("%1% position %2% is invalid for size %3%");
+          fmt % (orientation == SLICE_XZ ? "Y" : "X") % position
+            % (orientation == SLICE_XZ ? sizeY : sizeX);
+          throw std::logic_error(fmt.str());
+        }
+
+      if (c >= reader.getEffectiveSizeC())
+        {
+          boost::format fmt("Channel %1% is invalid for channel count %2%");
+          fmt % c % reader.getEffectiveSizeC();
+          throw std::logic_error(fmt.str());
+        }
+
+      if (t >= reader.getSizeT())
+        {
+          boost::format fmt("T index %1% is invalid for size %2%");
+          fmt % t % reader.getSizeT();
+          throw std::logic_error(fmt.str());
+        }
+
+      std::array<VariantPixelBuffer::size_type, PixelBufferBase::dimensions> shape, dest_shape;
+      std::fill(shape.begin(), shape.end(), 1U);
+      shape[DIM_SPATIAL_X] = orientation == SLICE_XZ ? sizeX : sizeY;
+      shape[DIM_SPATIAL_Y] = sizeZ;
+      shape[DIM_SUBCHANNEL] = reader.getRGBChannelCount(c);
+      const VariantPixelBuffer::size_type *dest_shape_ptr(dest.shape());
+      std::copy(dest_shape_ptr, dest_shape_ptr + PixelBufferBase::dimensions,
+                dest_shape.begin());
+
+      if (reader.getPixelType() != dest.pixelType() || shape != dest_shape)
+        dest.setBuffer(shape, reader.getPixelType(), dest.storage_order(), PIXEL_UNINITIALIZED);
+
+      const dimension_size_type series = reader.hasFlattenedResolutions() ? reader.getCoreIndex() : reader.getSeries();
+      const dimension_size_type resolution = reader.hasFlattenedResolutions() ? 0U : reader.getResolution();
+
+      // Each worker reads whole planes, and each plane is stored in a
+      // separate row of the destination, so workers may store
+      // concurrently.
+      std::atomic<dimension_size_type> next(0U);
+      threads = std::min(std::max(threads, static_cast<dimension_size_type>(1U)), sizeZ);
+      runParallel(reader.getExecutor(), threads,
+                  [&](dimension_size_type, dimension_size_type)
+                  {
+                    VariantPixelBuffer buf;
+                    for (dimension_size_type z = next++; z < sizeZ; z = next++)
+                      {
+                        const dimension_size_type plane = reader.getIndex(z, c, t);
+                        if (orientation == SLICE_XZ)
+                          reader.openBytesConcurrent(series, resolution, plane, buf,
+                                                     0U, position, sizeX, 1U);
+                        else
+                          reader.openBytesConcurrent(series, resolution, plane, buf,
+                                                     position, 0U, 1U, sizeY);
+
+                        SliceCopyVisitor v(dest, z, orientation == SLICE_YZ);
+                        boost::apply_visitor(v, buf.vbuffer());
+                      }
+                  });
+    }
+
+  }
+}
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
@@ -0,0 +1,111 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+
+#ifndef OME_FILES_ORTHOGONALSLICE_H
+#define OME_FILES_ORTHOGONALSLICE_H
+
+#include <ome/files/Types.h>
+#include <ome/files/VariantPixelBuffer.h>
+
+namespace ome
+{
+  namespace files
+  {
+
+    class FormatReader;
+
+    /// Orthogonal slice orientations.
+    enum SliceOrientation
+      {
+        SLICE_XZ, ///< One row of each @c Z plane, at a single @c Y.
+        SLICE_YZ  ///< One column of each @c Z plane, at a single @c X.
+      };
+
+    /**
+     * Read an orthogonal slice through a Z-stack.
+     *
+     * For an XZ slice, row @p position of every @c Z plane of the
+     * current series and resolution of @p reader, with channel @p c
+     * and timepoint @p t, is read; for a YZ slice, column
+     * @p position of every plane is read.  Each plane is read with
+     * FormatReader::openBytesConcurrent() for the one row or
+     * column, so only the tile row or tile column containing it is
+     * decoded.  The planes are read in parallel using up to
+     * @p threads workers of the reader's executor.
+     *
+     * The slice of each plane is stored as a row of the
+     * destination, so the destination has the @c Z planes along
+     * @c Y, and along @c X the image width for an XZ slice or the
+     * image height for a YZ slice.  It has the pixel type of the
+     * image and the subchannels of the channel.  If the destination
+     * buffer is not of the correct size and pixel type, it will be
+     * reset to the correct size and type, retaining its storage
+     * order.
+     *
+     * @param reader the reader to use; it must not be used
+     * concurrently with methods which change its state.
+     * @param orientation the slice orientation.
+     * @param position the @c Y coordinate of an XZ slice, or the
+     * @c X coordinate of a YZ slice.
+     * @param c the channel to read.
+     * @param t the timepoint to read.
+     * @param dest the destination pixel buffer.
+     * @param threads the maximum number of threads to use; 0 is
+     * treated as 1.
+     * @throws std::logic_error if the position, channel or
+     * timepoint is invalid.
+     */
+    void
+    readOrthogonalSlice(const FormatReader& reader,
+                        SliceOrientation    orientation,
+                        dimension_size_type position,
+                        dimension_size_type c,
+                        dimension_size_type t,
+                        VariantPixelBuffer& dest,
+                        dimension_size_type threads = 1U);
+
+  }
+}
+
+#endif // OME_FILES_ORTHOGONALSLICE_H
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
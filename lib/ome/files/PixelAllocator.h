@@ -0,0 +1,152 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#ifndef OME_FILES_PIXELALLOCATOR_H
+#define OME_FILES_PIXELALLOCATOR_H
+
+#include <cstddef>
+
+namespace ome
+{
+  namespace files
+  {
+
+    /**
+     * Memory resource for pixel buffer storage.
+     *
+     * By default, PixelBuffer and VariantPixelBuffer allocate their
+     * storage from the free store.  An allocator may be supplied to
+     * allocate pixel storage from an alternative source, for example
+     * page-locked memory for device transfers, huge pages or a
+     * NUMA-local arena.  Storage obtained from an allocator is
+     * released back to the same allocator when the last buffer
+     * referencing it is destroyed; buffers hold a shared reference
+     * to the allocator, so it will outlive all storage allocated
+     * from it.
+     *
+     * Implementations must be safe to call from any thread which
+     * creates or destroys pixel buffers.
+     */
+    class PixelAllocator
+    {
+    public:
+      /// Constructor.
+      PixelAllocator();
+
+      /// Destructor.
+      virtual
+      ~PixelAllocator();
+
+      /**
+       * Allocate storage.
+       *
+       * @param size the size of the storage, in bytes; this is
+       * never zero.
+       * @param alignment the required alignment of the storage, in
+       * bytes.
+       * @returns a pointer to the allocated storage.
+       * @throws std::bad_alloc or another exception if the storage
+       * could not be allocated.  A null pointer may not be returned.
+       */
+      virtual
+      void *
+      allocate(std::size_t size,
+               std::size_t alignment) = 0;
+
+      /**
+       * Deallocate storage.
+       *
+       * @param ptr the storage to release, previously returned by
+       * allocate().
+       * @param size the size passed to allocate().
+       * @param alignment the alignment passed to allocate().
+       */
+      virtual
+      void
+      deallocate(void        *ptr,
+                 std::size_t  size,
+                 std::size_t  alignment) = 0;
+
+      /**
+       * Check if the storage is accessible on the host.
+       *
+       * Storage which is not host accessible, such as GPU device
+       * memory, must not be read or written by the CPU.  Buffers
+       * using such storage may only be filled by
+       * tiff::IFD::readImage() using a device tile codec (see
+       * tiff::registerDeviceTileCodec()), and must be transferred
+       * by the caller before any other use.
+       *
+       * @returns @c true if host accessible (the default),
+       * otherwise @c false.
+       */
+      virtual
+      bool
+      hostAccessible() const;
+
+      /**
+       * Check if newly allocated storage is zero-filled.
+       *
+       * If so, value-initialized buffers are not filled after
+       * allocation.  This avoids touching every page of storage
+       * which is populated on demand, such as a mapped file.
+       *
+       * @returns @c true if zero-filled, otherwise @c false (the
+       * default).
+       */
+      virtual
+      bool
+      zeroInitialized() const;
+
+      /// @cond SKIP
+      PixelAllocator (const PixelAllocator&) = delete;
+
+      PixelAllocator&
+      operator= (const PixelAllocator&) = delete;
+      /// @endcond SKIP
+    };
+
+  }
+}
+
+#endif // OME_FILES_PIXELALLOCATOR_H
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
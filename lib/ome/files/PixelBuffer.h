@@ -38,6 +38,7 @@
 #ifndef OME_FILES_PIXELBUFFER_H
 #define OME_FILES_PIXELBUFFER_H
 
+#include <algorithm>
 #include <array>
 #include <cstdint>
 #include <istream>
@@ -46,11 +47,14 @@
 #include <ostream>
 #include <stdexcept>
 #include <string>
+#include <utility>
 
 // Disable expensive bounds checking
 #define BOOST_DISABLE_ASSERTS 1
 #include <boost/multi_array.hpp>
 
+#include <ome/files/Interleave.h>
+#include <ome/files/PixelAllocator.h>
 #include <ome/files/PixelProperties.h>
 
 #include <ome/common/variant.h>
@@ -88,6 +92,21 @@ namespace ome
         DIM_MODULO_C   = 8  ///< Logical subdivision of the logical channel dimension (c).
       };
 
+    /**
+     * Initialization of internally allocated pixel storage.
+     *
+     * By default, internally allocated pixel data is
+     * value-initialized (zeroed).  When the caller is guaranteed to
+     * overwrite every pixel, for example when reading a complete
+     * plane or region from a file, the cost of zeroing the storage
+     * may be avoided by leaving it uninitialized.
+     */
+    enum PixelInitialization
+      {
+        PIXEL_VALUE_INITIALIZED, ///< Pixel values are value-initialized.
+        PIXEL_UNINITIALIZED      ///< Pixel values are left uninitialized.
+      };
+
     /**
      * Base class for all PixelBuffer types.
      *
@@ -284,6 +303,45 @@ namespace ome
         multiarray(std::shared_ptr<array_type>(new array_type(extents, storage)))
       {}
 
+      /**
+       * Construct from extents (internal storage), optionally
+       * uninitialized or using an allocator.
+       *
+       * Storage for the buffer will be allocated internally, from
+       * the allocator if specified.  If uninitialized storage is
+       * requested, the pixel values will be indeterminate until
+       * written, and the caller must write every pixel before
+       * reading any.
+       *
+       * @param extents the extent of each dimension.
+       * @param pixeltype the pixel type to store.
+       * @param endiantype the required endianness of the pixel type.
+       * @param storage the storage ordering.
+       * @param init the initialization of the pixel storage.
+       * @param allocator the allocator for the pixel storage, or
+       * null to use the default allocator.
+       * @throws std::logic_error if the allocator returns incorrectly
+       * aligned storage.
+       */
+      template<class ExtentList>
+      explicit
+      PixelBuffer(const ExtentList&                      extents,
+                  ::ome::xml::model::enums::PixelType    pixeltype,
+                  EndianType                             endiantype,
+                  const storage_order_type&              storage,
+                  PixelInitialization                    init,
+                  const std::shared_ptr<PixelAllocator>& allocator = std::shared_ptr<PixelAllocator>()):
+        PixelBufferBase(pixeltype, endiantype),
+        multiarray(),
+        ownedstorage()
+      {
+        if (init == PIXEL_UNINITIALIZED || allocator)
+          allocateStorage(array_ref_type(static_cast<value_type *>(nullptr), extents, storage),
+                          init, allocator);
+        else
+          multiarray = std::shared_ptr<array_type>(new array_type(extents, storage));
+      }
+
       /**
        * Construct from extents (external storage).
        *
@@ -329,6 +387,44 @@ namespace ome
         multiarray(std::shared_ptr<array_type>(new array_type(range, storage)))
       {}
 
+      /**
+       * Construct from ranges (internal storage), optionally
+       * uninitialized or using an allocator.
+       *
+       * Storage for the buffer will be allocated internally, from
+       * the allocator if specified.  If uninitialized storage is
+       * requested, the pixel values will be indeterminate until
+       * written, and the caller must write every pixel before
+       * reading any.
+       *
+       * @param range the range of each dimension.
+       * @param pixeltype the pixel type to store.
+       * @param endiantype the required endianness of the pixel type.
+       * @param storage the storage ordering.
+       * @param init the initialization of the pixel storage.
+       * @param allocator the allocator for the pixel storage, or
+       * null to use the default allocator.
+       * @throws std::logic_error if the allocator returns incorrectly
+       * aligned storage.
+       */
+      explicit
+      PixelBuffer(const range_type&                      range,
+                  ::ome::xml::model::enums::PixelType    pixeltype,
+                  EndianType                             endiantype,
+                  const storage_order_type&              storage,
+                  PixelInitialization                    init,
+                  const std::shared_ptr<PixelAllocator>& allocator = std::shared_ptr<PixelAllocator>()):
+        PixelBufferBase(pixeltype, endiantype),
+        multiarray(),
+        ownedstorage()
+      {
+        if (init == PIXEL_UNINITIALIZED || allocator)
+          allocateStorage(array_ref_type(static_cast<value_type *>(nullptr), range, storage),
+                          init, allocator);
+        else
+          multiarray = std::shared_ptr<array_type>(new array_type(range, storage));
+      }
+
       /**
        * Construct from ranges (external storage).
        *
@@ -364,7 +460,23 @@ namespace ome
       explicit
       PixelBuffer(const PixelBuffer& buffer):
         PixelBufferBase(buffer),
-        multiarray(buffer.multiarray)
+        multiarray(buffer.multiarray),
+        ownedstorage(buffer.ownedstorage)
+      {}
+
+      /**
+       * Move constructor.
+       *
+       * The pixel data is transferred without copying.  The
+       * moved-from buffer no longer references any pixel data, and
+       * may only be destroyed or move-assigned to.
+       *
+       * @param buffer the buffer to move.
+       */
+      PixelBuffer(PixelBuffer&& buffer):
+        PixelBufferBase(buffer),
+        multiarray(std::move(buffer.multiarray)),
+        ownedstorage(std::move(buffer.ownedstorage))
       {}
 
       /// Destructor.
@@ -448,13 +560,16 @@ namespace ome
        * Check if the buffer is internally managed.
        *
        * @returns @c true if the @c MultiArray data is managed
-       * internally (i.e. is a @c multi_array) or @c false if not
-       * managed (i.e. is a @c multi_array_ref).
+       * internally (i.e. is a @c multi_array, or a @c
+       * multi_array_ref over uninitialized or allocator-provided
+       * storage owned by this buffer) or @c false if not managed
+       * (i.e. is a @c multi_array_ref over external storage).
        */
       bool
       managed() const
       {
-        return (boost::get<std::shared_ptr<array_type>>(&multiarray) != nullptr);
+        return (boost::get<std::shared_ptr<array_type>>(&multiarray) != nullptr ||
+                ownedstorage);
       }
 
       /**
@@ -551,7 +666,9 @@ namespace ome
        *
        * The dimension extents must be compatible, but the storage
        * ordering does not.  The buffer contents will be assigned in
-       * the logical order rather than the storage order.
+       * the logical order rather than the storage order.  Conversion
+       * between contiguous and planar sample storage order uses
+       * optimised interleaving kernels.
        *
        * @param rhs the pixel buffer to assign.
        * @returns the assigned buffer.
@@ -559,7 +676,40 @@ namespace ome
       PixelBuffer&
       operator = (const PixelBuffer& rhs)
       {
-        array() = rhs.array();
+        if (!assignSamples(rhs.array()))
+          array() = rhs.array();
+        return *this;
+      }
+
+      /**
+       * Move a pixel buffer.
+       *
+       * If this buffer manages its own storage and has the same
+       * pixel and endian type as @p rhs, the pixel data, extents and
+       * storage order of @p rhs are transferred without copying,
+       * and @p rhs no longer references any pixel data.  Otherwise,
+       * for example if this buffer references external storage,
+       * this is equivalent to copy assignment, and the extents must
+       * be compatible.
+       *
+       * @param rhs the pixel buffer to move.
+       * @returns the assigned buffer.
+       */
+      PixelBuffer&
+      operator = (PixelBuffer&& rhs)
+      {
+        if (this != &rhs)
+          {
+            if ((managed() || !hasData()) &&
+                pixelType() == rhs.pixelType() &&
+                endianType() == rhs.endianType())
+              {
+                multiarray = std::move(rhs.multiarray);
+                ownedstorage = std::move(rhs.ownedstorage);
+              }
+            else
+              *this = static_cast<const PixelBuffer&>(rhs);
+          }
         return *this;
       }
 
@@ -568,7 +718,9 @@ namespace ome
        *
        * The dimension extents must be compatible, but the storage
        * ordering does not.  The buffer contents will be assigned in
-       * the logical order rather than the storage order.
+       * the logical order rather than the storage order.  Conversion
+       * between contiguous and planar sample storage order uses
+       * optimised interleaving kernels.
        *
        * @param rhs the pixel buffer to assign.
        * @returns the assigned buffer.
@@ -576,7 +728,8 @@ namespace ome
       PixelBuffer&
       operator = (const array_ref_type& rhs)
       {
-        array() = rhs;
+        if (!assignSamples(rhs))
+          array() = rhs;
         return *this;
       }
 
@@ -809,6 +962,72 @@ namespace ome
       }
 
     private:
+      /**
+       * Assign by interleaving or deinterleaving samples.
+       *
+       * If the storage orders differ only in the subchannel being
+       * stored either before (contiguous) or after (planar) the
+       * spatial dimensions, the samples are converted a plane at a
+       * time rather than by element-by-element array indexing.
+       *
+       * @param rhs the array to assign.
+       * @returns @c true if assigned, or @c false if the storage
+       * orders are not suitable and normal array assignment is
+       * required.
+       */
+      bool
+      assignSamples(const array_ref_type& rhs)
+      {
+        array_ref_type& lhs(array());
+        const storage_order_type& lorder(lhs.storage_order());
+        const storage_order_type& rorder(rhs.storage_order());
+
+        if (lorder == rorder ||
+            lhs.num_elements() == 0 ||
+            !std::equal(lhs.shape(), lhs.shape() + dimensions, rhs.shape()))
+          return false;
+
+        for (size_type d = 0; d < dimensions; ++d)
+          {
+            if (!lorder.ascending(d) || !rorder.ascending(d))
+              return false;
+            if (d > 2 && lorder.ordering(d) != rorder.ordering(d))
+              return false;
+          }
+
+        bool linterleaved = (lorder.ordering(0) == DIM_SUBCHANNEL &&
+                             lorder.ordering(1) == DIM_SPATIAL_X &&
+                             lorder.ordering(2) == DIM_SPATIAL_Y);
+        bool lplanar = (lorder.ordering(0) == DIM_SPATIAL_X &&
+                        lorder.ordering(1) == DIM_SPATIAL_Y &&
+                        lorder.ordering(2) == DIM_SUBCHANNEL);
+        bool rinterleaved = (rorder.ordering(0) == DIM_SUBCHANNEL &&
+                             rorder.ordering(1) == DIM_SPATIAL_X &&
+                             rorder.ordering(2) == DIM_SPATIAL_Y);
+        bool rplanar = (rorder.ordering(0) == DIM_SPATIAL_X &&
+                        rorder.ordering(1) == DIM_SPATIAL_Y &&
+                        rorder.ordering(2) == DIM_SUBCHANNEL);
+
+        if (!((linterleaved && rplanar) || (lplanar && rinterleaved)))
+          return false;
+
+        const size_type plane = lhs.shape()[DIM_SPATIAL_X] * lhs.shape()[DIM_SPATIAL_Y];
+        const size_type samples = lhs.shape()[DIM_SUBCHANNEL];
+        const size_type block = plane * samples;
+
+        for (size_type offset = 0;
+             offset < lhs.num_elements();
+             offset += block)
+          {
+            if (linterleaved)
+              interleave(rhs.data() + offset, plane, samples, plane, lhs.data() + offset);
+            else
+              deinterleave(rhs.data() + offset, samples, plane, lhs.data() + offset, plane);
+          }
+
+        return true;
+      }
+
       /**
        * Multi-dimensional pixel array.  This may be either a @c
        * multi_array containing the data directly, or a @c
@@ -826,6 +1045,82 @@ namespace ome
        */
       boost::variant<std::shared_ptr<array_type>,
                      std::shared_ptr<array_ref_type>> multiarray;
+
+      /**
+       * Internally allocated storage.  This is only set when
+       * uninitialized storage or an allocator was requested, in
+       * which case @c multiarray is a @c multi_array_ref referencing
+       * it.  The deleter releases the storage to the allocator.
+       */
+      std::shared_ptr<value_type> ownedstorage;
+
+    private:
+      /**
+       * Check if the buffer references any pixel data.
+       *
+       * @returns @c false if moved from, @c true otherwise.
+       */
+      bool
+      hasData() const
+      {
+        const std::shared_ptr<array_type> *a = boost::get<std::shared_ptr<array_type>>(&multiarray);
+        const std::shared_ptr<array_ref_type> *r = boost::get<std::shared_ptr<array_ref_type>>(&multiarray);
+        return (a && *a) || (r && *r);
+      }
+
+      /**
+       * Allocate storage.
+       *
+       * @param layout a view with the required extents and storage
+       * order, referencing no data.
+       * @param init the initialization of the pixel storage.
+       * @param allocator the allocator for the pixel storage, or
+       * null to use the default allocator.
+       * @throws std::logic_error if the allocator returns incorrectly
+       * aligned storage.
+       */
+      void
+      allocateStorage(const array_ref_type&                  layout,
+                      PixelInitialization                    init,
+                      const std::shared_ptr<PixelAllocator>& allocator)
+      {
+        // Raw allocation without construction; all pixel types are
+        // trivially copyable, and every value is either initialized
+        // here or written before use.
+        const std::size_t count = std::max(layout.num_elements(),
+                                           static_cast<std::size_t>(1U));
+        const std::size_t size = count * sizeof(value_type);
+        const std::size_t alignment = alignof(value_type);
+        value_type *data;
+        if (allocator)
+          {
+            data = static_cast<value_type *>(allocator->allocate(size, alignment));
+            std::shared_ptr<PixelAllocator> alloc(allocator);
+            ownedstorage = std::shared_ptr<value_type>(data, [alloc, size, alignment](value_type *ptr)
+                                                       { alloc->deallocate(ptr, size, alignment); });
+            if (reinterpret_cast<std::uintptr_t>(data) % alignment)
+              throw std::logic_error("PixelAllocator returned incorrectly aligned storage");
+          }
+        else
+          {
+            data = static_cast<value_type *>(::operator new(size));
+            ownedstorage = std::shared_ptr<value_type>(data, [](value_type *ptr) { ::operator delete(ptr); });
+          }
+
+        // Storage which is not host accessible, or is already
+        // zero-filled, is not initialized.
+        if (init == PIXEL_VALUE_INITIALIZED &&
+            (!allocator || (allocator->hostAccessible() && !allocator->zeroInitialized())))
+          std::fill(data, data + count, value_type());
+
+        std::array<size_type, dimensions> extents;
+        std::array<index, dimensions> bases;
+        std::copy(layout.shape(), layout.shape() + dimensions, extents.begin());
+        std::copy(layout.index_bases(), layout.index_bases() + dimensions, bases.begin());
+        std::shared_ptr<array_ref_type> ref(new array_ref_type(data, extents, layout.storage_order()));
+        ref->reindex(bases);
+        multiarray = ref;
+      }
     };
 
     namespace detail
@@ -0,0 +1,248 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#ifndef OME_FILES_PIXELBUFFERVIEW_H
+#define OME_FILES_PIXELBUFFERVIEW_H
+
+#include <algorithm>
+#include <array>
+#include <type_traits>
+
+#include <ome/files/PixelBuffer.h>
+
+namespace ome
+{
+  namespace files
+  {
+
+    /**
+     * Lightweight non-owning view of PixelBuffer pixel data.
+     *
+     * The view holds a pointer to the pixel data and the shape and
+     * strides of all dimensions, obtained once when the view is
+     * created.  Access through the view is a plain pointer
+     * computation, avoiding the variant dispatch and index checking
+     * of PixelBuffer::at() for every access, and so is suited to hot
+     * loops.  Rows (along @c X) and planes (@c X and @c Y) may be
+     * obtained as pointers; the stride() of @c X gives the distance
+     * between neighbouring pixels in a row.
+     *
+     * The view does not keep the PixelBuffer alive, and is
+     * invalidated if the buffer is destroyed or reallocated.  No
+     * bounds checking is performed.
+     *
+     * @tparam T the pixel type; use a @c const type for read-only
+     * access.
+     */
+    template<typename T>
+    class PixelBufferView
+    {
+    public:
+      /// Pixel value type.
+      typedef T value_type;
+
+      /// Size type.
+      typedef PixelBufferBase::size_type size_type;
+
+      /// Index type.
+      typedef PixelBufferBase::index index;
+
+      /// Type used to index all dimensions.
+      typedef PixelBufferBase::indices_type indices_type;
+
+      /// Shape of all dimensions.
+      typedef std::array<size_type, PixelBufferBase::dimensions> shape_type;
+
+      /// Strides of all dimensions.
+      typedef std::array<index, PixelBufferBase::dimensions> strides_type;
+
+      /**
+       * Construct a view of a PixelBuffer.
+       *
+       * @param buffer the buffer to view.
+       */
+      template<typename U>
+      explicit
+      PixelBufferView(PixelBuffer<U>& buffer):
+        origin(buffer.array().origin()),
+        extents(),
+        steps()
+      {
+        static_assert(std::is_same<typename std::remove_const<T>::type, U>::value,
+                      "View and buffer pixel types differ");
+        std::copy(buffer.shape(), buffer.shape() + PixelBufferBase::dimensions, extents.begin());
+        std::copy(buffer.strides(), buffer.strides() + PixelBufferBase::dimensions, steps.begin());
+      }
+
+      /**
+       * Construct a read-only view of a PixelBuffer.
+       *
+       * @param buffer the buffer to view.
+       */
+      template<typename U>
+      explicit
+      PixelBufferView(const PixelBuffer<U>& buffer):
+        origin(buffer.array().origin()),
+        extents(),
+        steps()
+      {
+        static_assert(std::is_same<T, const U>::value,
+                      "View of a const buffer must be of a const pixel type");
+        std::copy(buffer.shape(), buffer.shape() + PixelBufferBase::dimensions, extents.begin());
+        std::copy(buffer.strides(), buffer.strides() + PixelBufferBase::dimensions, steps.begin());
+      }
+
+      /**
+       * Get the pixel data origin.
+       *
+       * @returns a pointer to the pixel at index zero in all
+       * dimensions.
+       */
+      value_type *
+      data() const
+      {
+        return origin;
+      }
+
+      /**
+       * Get the shape of all dimensions.
+       *
+       * @returns the shape.
+       */
+      const shape_type&
+      shape() const
+      {
+        return extents;
+      }
+
+      /**
+       * Get the strides of all dimensions.
+       *
+       * @returns the strides, in elements.
+       */
+      const strides_type&
+      strides() const
+      {
+        return steps;
+      }
+
+      /**
+       * Get the stride of a dimension.
+       *
+       * @param dimension the dimension.
+       * @returns the stride, in elements.
+       */
+      index
+      stride(Dimensions dimension) const
+      {
+        return steps[dimension];
+      }
+
+      /**
+       * Get a pointer to a pixel.
+       *
+       * @param indices the multi-dimensional array index.
+       * @returns a pointer to the pixel.
+       */
+      value_type *
+      pointer(const indices_type& indices) const
+      {
+        index offset = 0;
+        for (uint16_t d = 0; d < PixelBufferBase::dimensions; ++d)
+          offset += indices[d] * steps[d];
+        return origin + offset;
+      }
+
+      /**
+       * Get a pixel value.
+       *
+       * @param indices the multi-dimensional array index.
+       * @returns a reference to the pixel value.
+       */
+      value_type&
+      operator()(const indices_type& indices) const
+      {
+        return *pointer(indices);
+      }
+
+      /**
+       * Get a pointer to the start of a row.
+       *
+       * The @c X index is ignored.
+       *
+       * @param indices the multi-dimensional array index.
+       * @returns a pointer to the first pixel of the row.
+       */
+      value_type *
+      row(const indices_type& indices) const
+      {
+        return pointer(indices) - (indices[DIM_SPATIAL_X] * steps[DIM_SPATIAL_X]);
+      }
+
+      /**
+       * Get a pointer to the start of a plane.
+       *
+       * The @c X and @c Y indexes are ignored.
+       *
+       * @param indices the multi-dimensional array index.
+       * @returns a pointer to the first pixel of the plane.
+       */
+      value_type *
+      plane(const indices_type& indices) const
+      {
+        return row(indices) - (indices[DIM_SPATIAL_Y] * steps[DIM_SPATIAL_Y]);
+      }
+
+    private:
+      /// Pixel at index zero in all dimensions.
+      value_type *origin;
+      /// Shape of all dimensions.
+      shape_type extents;
+      /// Strides of all dimensions.
+      strides_type steps;
+    };
+
+  }
+}
+
+#endif // OME_FILES_PIXELBUFFERVIEW_H
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
@@ -0,0 +1,371 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <complex>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
+#include <boost/format.hpp>
+
+#include <ome/files/PixelConversion.h>
+
+namespace ome
+{
+  namespace files
+  {
+
+    namespace
+    {
+
+      template<typename T>
+      struct is_complex : public std::false_type
+      {};
+
+      template<typename F>
+      struct is_complex<std::complex<F>> : public std::true_type
+      {};
+
+      // Conversion parameters for a specific pair of pixel types.
+      struct RunParameters
+      {
+        double scale;
+        double offset;
+        double minimum;
+        double maximum;
+        // Limits must be applied.
+        bool clamp;
+        // A plain cast is sufficient.
+        bool cast;
+      };
+
+      // Limit integer values to the range of the type.
+      template<typename D>
+      typename std::enable_if<std::numeric_limits<D>::is_integer>::type
+      typeLimits(double& minimum,
+                 double& maximum)
+      {
+        minimum = static_cast<double>(std::numeric_limits<D>::lowest());
+        maximum = static_cast<double>(std::numeric_limits<D>::max());
+      }
+
+      // Other values are unbounded.
+      template<typename D>
+      typename std::enable_if<!std::numeric_limits<D>::is_integer>::type
+      typeLimits(double& /* minimum */,
+                 double& /* maximum */)
+      {
+      }
+
+      // Check if all integer values are within limits.
+      template<typename S>
+      typename std::enable_if<std::numeric_limits<S>::is_integer, bool>::type
+      contained(double minimum,
+                double maximum)
+      {
+        return static_cast<double>(std::numeric_limits<S>::lowest()) >= minimum &&
+          static_cast<double>(std::numeric_limits<S>::max()) <= maximum;
+      }
+
+      // Non-integer values may be out of range or need rounding.
+      template<typename S>
+      typename std::enable_if<!std::numeric_limits<S>::is_integer, bool>::type
+      contained(double /* minimum */,
+                double /* maximum */)
+      {
+        return false;
+      }
+
+      template<typename S, typename D>
+      RunParameters
+      runParameters(const PixelConversion& conversion)
+      {
+        RunParameters p;
+        p.scale = conversion.scale;
+        p.offset = conversion.offset;
+        p.minimum = -std::numeric_limits<double>::infinity();
+        p.maximum = std::numeric_limits<double>::infinity();
+
+        typeLimits<D>(p.minimum, p.maximum);
+        if (conversion.minimum)
+          p.minimum = std::max(p.minimum, *conversion.minimum);
+        if (conversion.maximum)
+          p.maximum = std::min(p.maximum, *conversion.maximum);
+
+        p.clamp = !is_complex<D>::value &&
+          (p.minimum != -std::numeric_limits<double>::infinity() ||
+           p.maximum != std::numeric_limits<double>::infinity());
+
+        // Source values which are always within the limits, and
+        // which need no rounding, may be cast directly.
+        p.cast = p.scale == 1.0 && p.offset == 0.0 &&
+          (!p.clamp || contained<S>(p.minimum, p.maximum));
+
+        return p;
+      }
+
+      // Real to real.
+      template<typename S, typename D>
+      void
+      convertRun(const S             *src,
+                 D                   *dest,
+                 dimension_size_type  count,
+                 const RunParameters& p)
+      {
+        if (p.cast)
+          {
+            for (dimension_size_type i = 0; i < count; ++i)
+              dest[i] = static_cast<D>(src[i]);
+          }
+        else if (std::numeric_limits<D>::is_integer)
+          {
+            for (dimension_size_type i = 0; i < count; ++i)
+              {
+                double v = static_cast<double>(src[i]) * p.scale + p.offset;
+                v = v < p.minimum ? p.minimum : (v > p.maximum ? p.maximum : v);
+                dest[i] = static_cast<D>(std::floor(v + 0.5));
+              }
+          }
+        else if (p.clamp)
+          {
+            for (dimension_size_type i = 0; i < count; ++i)
+              {
+                double v = static_cast<double>(src[i]) * p.scale + p.offset;
+                dest[i] = static_cast<D>(v < p.minimum ? p.minimum : (v > p.maximum ? p.maximum : v));
+              }
+          }
+        else
+          {
+            for (dimension_size_type i = 0; i < count; ++i)
+              dest[i] = static_cast<D>(static_cast<double>(src[i]) * p.scale + p.offset);
+          }
+      }
+
+      // Real to complex.
+      template<typename S, typename G>
+      void
+      convertRun(const S             *src,
+                 std::complex<G>     *dest,
+                 dimension_size_type  count,
+                 const RunParameters& p)
+      {
+        for (dimension_size_type i = 0; i < count; ++i)
+          dest[i] = std::complex<G>(static_cast<G>(static_cast<double>(src[i]) * p.scale + p.offset));
+      }
+
+      // Complex to real; rejected by convertBuffer().
+      template<typename F, typename D>
+      void
+      convertRun(const std::complex<F> * /* src */,
+                 D                     * /* dest */,
+                 dimension_size_type     /* count */,
+                 const RunParameters&    /* p */)
+      {
+      }
+
+      // Complex to complex.
+      template<typename F, typename G>
+      void
+      convertRun(const std::complex<F> *src,
+                 std::complex<G>       *dest,
+                 dimension_size_type    count,
+                 const RunParameters&   p)
+      {
+        for (dimension_size_type i = 0; i < count; ++i)
+          dest[i] = std::complex<G>(static_cast<G>(static_cast<double>(src[i].real()) * p.scale + p.offset),
+                                    static_cast<G>(static_cast<double>(src[i].imag()) * p.scale));
+      }
+
+      template<typename S, typename D>
+      void
+      convertBuffer(const PixelBuffer<S>&  src,
+                    PixelBuffer<D>&        dest,
+                    dimension_size_type    x,
+                    dimension_size_type    y,
+                    const PixelConversion& conversion)
+      {
+        if (is_complex<S>::value && !is_complex<D>::value)
+          throw std::logic_error("Complex pixel data can not be converted to a non-complex pixel type");
+
+        const RunParameters p(runParameters<S, D>(conversion));
+
+        const PixelBufferBase::size_type *shape = src.shape();
+        const PixelBufferBase::index *sstrides = src.strides();
+        const PixelBufferBase::index *dstrides = dest.strides();
+        const PixelBufferBase::storage_order_type& sorder = src.storage_order();
+        const PixelBufferBase::storage_order_type& dorder = dest.storage_order();
+
+        for (PixelBufferBase::size_type d = 0; d < PixelBufferBase::dimensions; ++d)
+          if (!shape[d])
+            return;
+
+        // Merge the innermost dimensions which are contiguous in
+        // both buffers into a single run of samples.
+        dimension_size_type run = 1U;
+        PixelBufferBase::size_type merged = 0U;
+        while (merged < PixelBufferBase::dimensions)
+          {
+            const PixelBufferBase::size_type d = sorder.ordering(merged);
+            if (dorder.ordering(merged) != d ||
+                !sorder.ascending(d) || !dorder.ascending(d) ||
+                sstrides[d] != static_cast<PixelBufferBase::index>(run) ||
+                dstrides[d] != static_cast<PixelBufferBase::index>(run))
+              break;
+            run *= shape[d];
+            ++merged;
+          }
+
+        const S *sorigin = src.array().origin();
+        D *dorigin = dest.array().origin() +
+          static_cast<PixelBufferBase::index>(x) * dstrides[DIM_SPATIAL_X] +
+          static_cast<PixelBufferBase::index>(y) * dstrides[DIM_SPATIAL_Y];
+
+        std::array<PixelBufferBase::index, PixelBufferBase::dimensions> idx;
+        idx.fill(0);
+
+        while (true)
+          {
+            PixelBufferBase::index soffset = 0, doffset = 0;
+            for (PixelBufferBase::size_type k = merged; k < PixelBufferBase::dimensions; ++k)
+              {
+                const PixelBufferBase::size_type d = sorder.ordering(k);
+                soffset += idx[d] * sstrides[d];
+                doffset += idx[d] * dstrides[d];
+              }
+
+            convertRun(sorigin + soffset, dorigin + doffset, run, p);
+
+            PixelBufferBase::size_type k = merged;
+            for (; k < PixelBufferBase::dimensions; ++k)
+              {
+                const PixelBufferBase::size_type d = sorder.ordering(k);
+                if (++idx[d] < static_cast<PixelBufferBase::index>(shape[d]))
+                  break;
+                idx[d] = 0;
+              }
+            if (k == PixelBufferBase::dimensions)
+              break;
+          }
+      }
+
+      struct ConvertVisitor : public boost::static_visitor<>
+      {
+        dimension_size_type    x;
+        dimension_size_type    y;
+        const PixelConversion& conversion;
+
+        ConvertVisitor(dimension_size_type    x,
+                       dimension_size_type    y,
+                       const PixelConversion& conversion):
+          x(x),
+          y(y),
+          conversion(conversion)
+        {}
+
+        template<typename S, typename D>
+        void
+        operator()(const S& src,
+                   D&       dest) const
+        {
+          if (!src || !dest)
+            throw std::runtime_error("Null pixel type");
+          convertBuffer(*src, *dest, x, y, conversion);
+        }
+      };
+
+    }
+
+    void
+    convertPixels(const VariantPixelBuffer&           source,
+                  VariantPixelBuffer&                 dest,
+                  ::ome::xml::model::enums::PixelType type,
+                  const PixelConversion&              conversion)
+    {
+      std::array<VariantPixelBuffer::size_type, PixelBufferBase::dimensions> shape, dest_shape;
+      std::copy(source.shape(), source.shape() + PixelBufferBase::dimensions,
+                shape.begin());
+      std::copy(dest.shape(), dest.shape() + PixelBufferBase::dimensions,
+                dest_shape.begin());
+
+      if (type != dest.pixelType() ||
+          !(source.storage_order() == dest.storage_order()) ||
+          shape != dest_shape)
+        dest.setBuffer(shape, type, source.storage_order(), PIXEL_UNINITIALIZED);
+
+      convertPixels(source, dest, 0, 0, conversion);
+    }
+
+    void
+    convertPixels(const VariantPixelBuffer& source,
+                  VariantPixelBuffer&       dest,
+                  dimension_size_type       x,
+                  dimension_size_type       y,
+                  const PixelConversion&    conversion)
+    {
+      const VariantPixelBuffer::size_type *sshape = source.shape();
+      const VariantPixelBuffer::size_type *dshape = dest.shape();
+
+      for (PixelBufferBase::size_type d = 0; d < PixelBufferBase::dimensions; ++d)
+        {
+          if (d == DIM_SPATIAL_X || d == DIM_SPATIAL_Y)
+            continue;
+          if (sshape[d] != dshape[d])
+            {
+              boost::format fmt("Source dimension %1% size %2% does not match destination size %3%");
+              fmt % d % sshape[d] % dshape[d];
+              throw std::logic_error(fmt.str());
+            }
+        }
+
+      if (x + sshape[DIM_SPATIAL_X] > dshape[DIM_SPATIAL_X] ||
+          y + sshape[DIM_SPATIAL_Y] > dshape[DIM_SPATIAL_Y])
+        {
+          boost::format fmt("Region %1%x%2% at %3%,%4% exceeds destination size %5%x%6%");
+          fmt % sshape[DIM_SPATIAL_X] % sshape[DIM_SPATIAL_Y] % x % y
+            % dshape[DIM_SPATIAL_X] % dshape[DIM_SPATIAL_Y];
+          throw std::logic_error(fmt.str());
+        }
+
+      ConvertVisitor v(x, y, conversion);
+      boost::apply_visitor(v, source.vbuffer(), dest.vbuffer());
+    }
+
+  }
+}
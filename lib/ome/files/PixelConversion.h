@@ -0,0 +1,147 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#ifndef OME_FILES_PIXELCONVERSION_H
+#define OME_FILES_PIXELCONVERSION_H
+
+#include <boost/optional.hpp>
+
+#include <ome/files/Types.h>
+#include <ome/files/VariantPixelBuffer.h>
+
+namespace ome
+{
+  namespace files
+  {
+
+    /**
+     * Linear scaling and clamping applied during pixel type conversion.
+     *
+     * Each sample is converted as <tt>value × scale + offset</tt>,
+     * clamped to the range [@c minimum, @c maximum], and then
+     * rounded to the nearest value if the destination pixel type is
+     * an integer type.  If unset, the limits default to the range of
+     * the destination pixel type (for integer and BIT types) or are
+     * unbounded (for floating point and complex types).  For complex
+     * types, the scale is applied to both parts and the offset to the
+     * real part only, and no clamping is performed.
+     */
+    struct PixelConversion
+    {
+      /// Scale factor.
+      double scale;
+      /// Offset added after scaling.
+      double offset;
+      /// Lower limit, in destination units.
+      boost::optional<double> minimum;
+      /// Upper limit, in destination units.
+      boost::optional<double> maximum;
+
+      /**
+       * Constructor.
+       *
+       * @param scale the scale factor.
+       * @param offset the offset added after scaling.
+       */
+      PixelConversion(double scale = 1.0,
+                      double offset = 0.0):
+        scale(scale),
+        offset(offset),
+        minimum(),
+        maximum()
+      {}
+    };
+
+    /**
+     * Convert pixel data to a different pixel type.
+     *
+     * The destination buffer is reset to the shape and storage order
+     * of the source buffer, with the specified pixel type, unless it
+     * already matches.  Conversion between the common pixel types is
+     * performed with tight loops over contiguous runs of samples,
+     * which the compiler can vectorize; conversions which do not need
+     * scaling, clamping or rounding are plain casts.
+     *
+     * @param source the source pixel data.
+     * @param dest the destination pixel buffer.
+     * @param type the destination pixel type.
+     * @param conversion the scaling and clamping to apply.
+     * @throws std::logic_error if converting complex pixel data to a
+     * non-complex pixel type.
+     */
+    void
+    convertPixels(const VariantPixelBuffer&           source,
+                  VariantPixelBuffer&                 dest,
+                  ::ome::xml::model::enums::PixelType type,
+                  const PixelConversion&              conversion = PixelConversion());
+
+    /**
+     * Convert pixel data into a region of a larger buffer.
+     *
+     * As for convertPixels(const VariantPixelBuffer&,VariantPixelBuffer&,::ome::xml::model::enums::PixelType,const PixelConversion&),
+     * but the source is written to the existing destination buffer
+     * with its upper-left corner at @c x, @c y, converting to the
+     * pixel type of the destination.  The storage orders may differ.
+     *
+     * @param source the source pixel data.
+     * @param dest the destination pixel buffer.
+     * @param x the @c X coordinate of the upper-left corner of the
+     * destination region.
+     * @param y the @c Y coordinate of the upper-left corner of the
+     * destination region.
+     * @param conversion the scaling and clamping to apply.
+     * @throws std::logic_error if the source does not fit within the
+     * destination, the non-spatial dimensions differ, or when
+     * converting complex pixel data to a non-complex pixel type.
+     */
+    void
+    convertPixels(const VariantPixelBuffer& source,
+                  VariantPixelBuffer&       dest,
+                  dimension_size_type       x,
+                  dimension_size_type       y,
+                  const PixelConversion&    conversion = PixelConversion());
+
+  }
+}
+
+#endif // OME_FILES_PIXELCONVERSION_H
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
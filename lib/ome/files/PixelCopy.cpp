@@ -0,0 +1,105 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <ome/files/PixelCopy.h>
+
+namespace ome
+{
+  namespace files
+  {
+
+    namespace
+    {
+
+      // Copy a region into a destination buffer of the same type.
+      struct CopyRegionVisitor : public boost::static_visitor<>
+      {
+        const PixelBufferBase::indices_type& srcorigin;
+        VariantPixelBuffer&                  dest;
+        const PixelBufferBase::indices_type& destorigin;
+        const region_shape_type&             shape;
+
+        CopyRegionVisitor(const PixelBufferBase::indices_type& srcorigin,
+                          VariantPixelBuffer&                  dest,
+                          const PixelBufferBase::indices_type& destorigin,
+                          const region_shape_type&             shape):
+          srcorigin(srcorigin),
+          dest(dest),
+          destorigin(destorigin),
+          shape(shape)
+        {}
+
+        template<typename T>
+        void
+        operator()(const T& src)
+        {
+          T& destbuf = boost::get<T>(dest.vbuffer());
+          if (!src || !destbuf)
+            throw std::logic_error("Null pixel buffer");
+
+          copyRegion(*src, srcorigin, *destbuf, destorigin, shape);
+        }
+      };
+
+    }
+
+    void
+    copyRegion(const VariantPixelBuffer&            source,
+               const PixelBufferBase::indices_type& srcorigin,
+               VariantPixelBuffer&                  dest,
+               const PixelBufferBase::indices_type& destorigin,
+               const region_shape_type&             shape)
+    {
+      if (source.vbuffer().which() != dest.vbuffer().which())
+        {
+          boost::format fmt("Copy source pixel type %1% differs from destination pixel type %2%");
+          fmt % source.pixelType() % dest.pixelType();
+          throw std::logic_error(fmt.str());
+        }
+
+      CopyRegionVisitor v(srcorigin, dest, destorigin, shape);
+      boost::apply_visitor(v, source.vbuffer());
+    }
+
+  }
+}
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
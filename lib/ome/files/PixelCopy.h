@@ -0,0 +1,456 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#ifndef OME_FILES_PIXELCOPY_H
+#define OME_FILES_PIXELCOPY_H
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+
+#include <boost/format.hpp>
+
+#include <ome/files/PixelBuffer.h>
+#include <ome/files/PixelBufferView.h>
+#include <ome/files/VariantPixelBuffer.h>
+
+namespace ome
+{
+  namespace files
+  {
+
+    /// Shape of a region of all pixel buffer dimensions.
+    typedef std::array<PixelBufferBase::size_type, PixelBufferBase::dimensions> region_shape_type;
+
+    /// Strides of all pixel buffer dimensions, in elements.
+    typedef std::array<PixelBufferBase::index, PixelBufferBase::dimensions> region_strides_type;
+
+    namespace detail
+    {
+
+      /// A dimension of a region copy.
+      struct CopyDimension
+      {
+        /// Number of elements.
+        PixelBufferBase::size_type extent;
+        /// Source stride.
+        PixelBufferBase::index     src;
+        /// Destination stride.
+        PixelBufferBase::index     dest;
+      };
+
+      /// Dimensions of a region copy, innermost first.
+      typedef std::array<CopyDimension, PixelBufferBase::dimensions> copy_layout_type;
+
+      /**
+       * Compute the iteration layout of a region copy.
+       *
+       * Dimensions of unit extent are dropped, and the rest are
+       * ordered by increasing destination stride, so that the
+       * innermost loop writes the destination sequentially where
+       * possible.  Neighbouring dimensions which are contiguous in
+       * both source and destination are merged, so that a region
+       * spanning whole rows is copied as a single run.
+       *
+       * @param shape the shape of the region.
+       * @param srcstrides the source strides.
+       * @param deststrides the destination strides.
+       * @param layout the computed layout.
+       * @returns the number of dimensions in the layout.
+       */
+      inline uint16_t
+      makeCopyLayout(const region_shape_type&   shape,
+                     const region_strides_type& srcstrides,
+                     const region_strides_type& deststrides,
+                     copy_layout_type&          layout)
+      {
+        uint16_t n = 0U;
+        for (uint16_t d = 0U; d < PixelBufferBase::dimensions; ++d)
+          {
+            if (shape[d] > 1U)
+              layout[n++] = CopyDimension{shape[d], srcstrides[d], deststrides[d]};
+          }
+
+        std::sort(layout.begin(), layout.begin() + n,
+                  [](const CopyDimension& lhs, const CopyDimension& rhs)
+                  {
+                    const PixelBufferBase::index ld = std::abs(lhs.dest);
+                    const PixelBufferBase::index rd = std::abs(rhs.dest);
+                    return ld < rd || (ld == rd && std::abs(lhs.src) < std::abs(rhs.src));
+                  });
+
+        if (n == 0U)
+          return 0U;
+
+        uint16_t merged = 0U;
+        for (uint16_t d = 1U; d < n; ++d)
+          {
+            CopyDimension& inner = layout[merged];
+            const PixelBufferBase::index extent = static_cast<PixelBufferBase::index>(inner.extent);
+            if (layout[d].src == inner.src * extent &&
+                layout[d].dest == inner.dest * extent)
+              inner.extent *= layout[d].extent;
+            else
+              layout[++merged] = layout[d];
+          }
+        return merged + 1U;
+      }
+
+      /**
+       * Copy a single run of elements.
+       *
+       * Runs which are contiguous in both source and destination,
+       * in either direction, are moved as a block; all others are
+       * copied element by element in run order.
+       *
+       * @param src the first source element.
+       * @param srcstride the source stride.
+       * @param dest the first destination element.
+       * @param deststride the destination stride.
+       * @param count the number of elements.
+       */
+      template<typename T>
+      inline void
+      copyRun(const T                    *src,
+              PixelBufferBase::index     srcstride,
+              T                          *dest,
+              PixelBufferBase::index     deststride,
+              PixelBufferBase::size_type count)
+      {
+        if (std::is_trivially_copyable<T>::value &&
+            srcstride == deststride &&
+            (srcstride == 1 || srcstride == -1))
+          {
+            const PixelBufferBase::index last = static_cast<PixelBufferBase::index>(count) - 1;
+            if (srcstride == -1)
+              {
+                src -= last;
+                dest -= last;
+              }
+            std::memmove(static_cast<void *>(dest), static_cast<const void *>(src), count * sizeof(T));
+          }
+        else if (srcstride == 1)
+          {
+            for (PixelBufferBase::size_type i = 0U; i < count; ++i)
+              dest[static_cast<PixelBufferBase::index>(i) * deststride] = src[i];
+          }
+        else if (deststride == 1)
+          {
+            for (PixelBufferBase::size_type i = 0U; i < count; ++i)
+              dest[i] = src[static_cast<PixelBufferBase::index>(i) * srcstride];
+          }
+        else
+          {
+            for (PixelBufferBase::size_type i = 0U; i < count; ++i)
+              dest[static_cast<PixelBufferBase::index>(i) * deststride] =
+                src[static_cast<PixelBufferBase::index>(i) * srcstride];
+          }
+      }
+
+      /**
+       * Copy a region using a precomputed layout.
+       *
+       * The outer dimensions are iterated in order, and each run
+       * along the innermost dimension is copied with copyRun().
+       *
+       * @param src the first source element.
+       * @param dest the first destination element.
+       * @param layout the copy layout.
+       * @param n the number of dimensions in the layout.
+       */
+      template<typename T>
+      inline void
+      copyLayout(const T                 *src,
+                 T                       *dest,
+                 const copy_layout_type&  layout,
+                 uint16_t                 n)
+      {
+        if (n == 0U)
+          {
+            *dest = *src;
+            return;
+          }
+
+        const CopyDimension& run = layout[0];
+        std::array<PixelBufferBase::size_type, PixelBufferBase::dimensions> counter;
+        std::fill(counter.begin(), counter.end(), 0U);
+
+        while (true)
+          {
+            copyRun(src, run.src, dest, run.dest, run.extent);
+
+            uint16_t d = 1U;
+            for (; d < n; ++d)
+              {
+                src += layout[d].src;
+                dest += layout[d].dest;
+                if (++counter[d] < layout[d].extent)
+                  break;
+                const PixelBufferBase::index extent = static_cast<PixelBufferBase::index>(layout[d].extent);
+                src -= layout[d].src * extent;
+                dest -= layout[d].dest * extent;
+                counter[d] = 0U;
+              }
+            if (d == n)
+              break;
+          }
+      }
+
+      /**
+       * Get the lowest and highest element addresses of a region.
+       *
+       * @param base the first element.
+       * @param shape the shape of the region.
+       * @param strides the strides.
+       * @param low the lowest address.
+       * @param high the highest address.
+       */
+      template<typename T>
+      inline void
+      regionSpan(const T                    *base,
+                 const region_shape_type&   shape,
+                 const region_strides_type& strides,
+                 const T                    *&low,
+                 const T                    *&high)
+      {
+        low = high = base;
+        for (uint16_t d = 0U; d < PixelBufferBase::dimensions; ++d)
+          {
+            const PixelBufferBase::index span = strides[d] * (static_cast<PixelBufferBase::index>(shape[d]) - 1);
+            if (span < 0)
+              low += span;
+            else
+              high += span;
+          }
+      }
+
+    }
+
+    /**
+     * Copy a strided region of pixel data.
+     *
+     * This is the engine underlying copyRegion(), for use with
+     * pixel data not held in a PixelBuffer, such as a decoded TIFF
+     * tile.  The source and destination may have different strides,
+     * and hence different storage orders.  The dimensions are
+     * reordered and merged so that the innermost loop copies the
+     * longest possible runs, and runs which are contiguous in both
+     * source and destination are moved as a block.
+     *
+     * Overlapping source and destination regions are permitted.
+     * When the strides are the same, the copy is performed in
+     * address order, forwards or backwards, in the manner of
+     * @c memmove; otherwise the source is first copied to a
+     * temporary buffer.
+     *
+     * No bounds checking is performed.
+     *
+     * @param src the first source element.
+     * @param srcstrides the source strides.
+     * @param dest the first destination element.
+     * @param deststrides the destination strides.
+     * @param shape the shape of the region.
+     */
+    template<typename T>
+    void
+    copyStrided(const T                    *src,
+                const region_strides_type& srcstrides,
+                T                          *dest,
+                const region_strides_type& deststrides,
+                const region_shape_type&   shape)
+    {
+      PixelBufferBase::size_type count = 1U;
+      for (const auto extent : shape)
+        count *= extent;
+      if (count == 0U)
+        return;
+
+      detail::copy_layout_type layout;
+      uint16_t n = detail::makeCopyLayout(shape, srcstrides, deststrides, layout);
+
+      const T *srclow, *srchigh, *destlow, *desthigh;
+      detail::regionSpan(src, shape, srcstrides, srclow, srchigh);
+      detail::regionSpan(static_cast<const T *>(dest), shape, deststrides, destlow, desthigh);
+
+      if (srchigh < destlow || desthigh < srclow)
+        {
+          detail::copyLayout(src, dest, layout, n);
+          return;
+        }
+
+      // The regions overlap.  If each dimension has the same
+      // positive stride in source and destination, and the outer
+      // strides each step over the whole of the inner dimensions,
+      // iteration is in strictly increasing address order, and so
+      // the copy is safe forwards when the destination precedes the
+      // source, and backwards otherwise.
+      bool ordered = true;
+      for (uint16_t d = 0U; d < n && ordered; ++d)
+        {
+          const detail::CopyDimension& dim = layout[d];
+          if (dim.src != dim.dest || dim.src <= 0)
+            ordered = false;
+          else if (d > 0U &&
+                   dim.src < layout[d-1].src * static_cast<PixelBufferBase::index>(layout[d-1].extent))
+            ordered = false;
+        }
+
+      if (ordered)
+        {
+          if (dest > src)
+            {
+              // Start from the last element, and step backwards.
+              for (uint16_t d = 0U; d < n; ++d)
+                {
+                  const PixelBufferBase::index offset =
+                    layout[d].src * (static_cast<PixelBufferBase::index>(layout[d].extent) - 1);
+                  src += offset;
+                  dest += offset;
+                  layout[d].src = -layout[d].src;
+                  layout[d].dest = -layout[d].dest;
+                }
+            }
+          detail::copyLayout(src, dest, layout, n);
+          return;
+        }
+
+      // Copy the source into a temporary, and then into the
+      // destination.
+      std::unique_ptr<T[]> temp(new T[count]);
+      region_strides_type tempstrides;
+      PixelBufferBase::index stride = 1;
+      for (uint16_t d = 0U; d < PixelBufferBase::dimensions; ++d)
+        {
+          tempstrides[d] = stride;
+          stride *= static_cast<PixelBufferBase::index>(shape[d]);
+        }
+      n = detail::makeCopyLayout(shape, srcstrides, tempstrides, layout);
+      detail::copyLayout(src, temp.get(), layout, n);
+      n = detail::makeCopyLayout(shape, tempstrides, deststrides, layout);
+      detail::copyLayout(static_cast<const T *>(temp.get()), dest, layout, n);
+    }
+
+    /**
+     * Copy a region of a PixelBuffer into another PixelBuffer.
+     *
+     * The region of shape @p shape at @p srcorigin in @p source is
+     * copied to @p destorigin in @p dest.  The buffers may differ in
+     * shape and storage order, and may be the same buffer, in which
+     * case the regions may overlap.  This may be used to crop, pad,
+     * tile or stitch pixel data.  See copyStrided() for details of
+     * the copy.
+     *
+     * @param source the source buffer.
+     * @param srcorigin the origin of the region in the source.
+     * @param dest the destination buffer.
+     * @param destorigin the origin of the region in the destination.
+     * @param shape the shape of the region.
+     * @throws std::logic_error if the region is not contained within
+     * the source or destination buffer.
+     */
+    template<typename T>
+    void
+    copyRegion(const PixelBuffer<T>&                source,
+               const PixelBufferBase::indices_type& srcorigin,
+               PixelBuffer<T>&                      dest,
+               const PixelBufferBase::indices_type& destorigin,
+               const region_shape_type&             shape)
+    {
+      PixelBufferView<const T> srcview(source);
+      PixelBufferView<T> destview(dest);
+
+      for (uint16_t d = 0U; d < PixelBufferBase::dimensions; ++d)
+        {
+          if (srcorigin[d] < 0 ||
+              static_cast<PixelBufferBase::size_type>(srcorigin[d]) + shape[d] > srcview.shape()[d])
+            {
+              boost::format fmt("Copy region (origin %1%, size %2%) exceeds source size %3% in dimension %4%");
+              fmt % srcorigin[d] % shape[d] % srcview.shape()[d] % d;
+              throw std::logic_error(fmt.str());
+            }
+          if (destorigin[d] < 0 ||
+              static_cast<PixelBufferBase::size_type>(destorigin[d]) + shape[d] > destview.shape()[d])
+            {
+              boost::format fmt("Copy region (origin %1%, size %2%) exceeds destination size %3% in dimension %4%");
+              fmt % destorigin[d] % shape[d] % destview.shape()[d] % d;
+              throw std::logic_error(fmt.str());
+            }
+        }
+
+      copyStrided(srcview.pointer(srcorigin), srcview.strides(),
+                  destview.pointer(destorigin), destview.strides(),
+                  shape);
+    }
+
+    /**
+     * Copy a region of a VariantPixelBuffer into another
+     * VariantPixelBuffer.
+     *
+     * As for copyRegion(const PixelBuffer<T>&,const PixelBufferBase::indices_type&,PixelBuffer<T>&,const PixelBufferBase::indices_type&,const region_shape_type&),
+     * dispatched on the pixel type.  No pixel type conversion is
+     * performed.
+     *
+     * @param source the source buffer.
+     * @param srcorigin the origin of the region in the source.
+     * @param dest the destination buffer.
+     * @param destorigin the origin of the region in the destination.
+     * @param shape the shape of the region.
+     * @throws std::logic_error if the pixel types differ, or the
+     * region is not contained within the source or destination
+     * buffer.
+     */
+    void
+    copyRegion(const VariantPixelBuffer&            source,
+               const PixelBufferBase::indices_type& srcorigin,
+               VariantPixelBuffer&                  dest,
+               const PixelBufferBase::indices_type& destorigin,
+               const region_shape_type&             shape);
+
+  }
+}
+
+#endif // OME_FILES_PIXELCOPY_H
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
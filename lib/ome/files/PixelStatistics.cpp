@@ -0,0 +1,235 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+
+#include <algorithm>
+
+#include <ome/files/PixelStatistics.h>
+
+namespace ome
+{
+  namespace files
+  {
+
+    namespace
+    {
+
+      /// Accumulate a region of a pixel buffer.
+      struct AddVisitor : public boost::static_visitor<>
+      {
+        /// Statistics to update.
+        PixelStatistics&    stats;
+        /// Region X.
+        dimension_size_type x;
+        /// Region Y.
+        dimension_size_type y;
+        /// Region width.
+        dimension_size_type w;
+        /// Region height.
+        dimension_size_type h;
+        /// First subchannel.
+        dimension_size_type first;
+        /// Subchannel count.
+        dimension_size_type count;
+
+        AddVisitor(PixelStatistics&    stats,
+                   dimension_size_type x,
+                   dimension_size_type y,
+                   dimension_size_type w,
+                   dimension_size_type h,
+                   dimension_size_type first,
+                   dimension_size_type count):
+          stats(stats),
+          x(x),
+          y(y),
+          w(w),
+          h(h),
+          first(first),
+          count(count)
+        {}
+
+        template<typename T>
+        void
+        operator() (const T& buffer)
+        {
+          if (buffer)
+            stats.add(*buffer, x, y, w, h, first, count);
+        }
+      };
+
+    }
+
+    const std::size_t PixelStatistics::histogram_bins;
+
+    PixelStatistics::PixelStatistics():
+      mutex(),
+      samples(),
+      histogram(false)
+    {
+    }
+
+    PixelStatistics::~PixelStatistics()
+    {
+    }
+
+    void
+    PixelStatistics::add(const VariantPixelBuffer& buffer)
+    {
+      const VariantPixelBuffer::size_type *shape = buffer.shape();
+      add(buffer, 0U, 0U,
+          shape[DIM_SPATIAL_X], shape[DIM_SPATIAL_Y],
+          0U, shape[DIM_SUBCHANNEL]);
+    }
+
+    void
+    PixelStatistics::add(const VariantPixelBuffer& buffer,
+                         dimension_size_type       x,
+                         dimension_size_type       y,
+                         dimension_size_type       w,
+                         dimension_size_type       h,
+                         dimension_size_type       first,
+                         dimension_size_type       count)
+    {
+      AddVisitor v(*this, x, y, w, h, first, count);
+      boost::apply_visitor(v, buffer.vbuffer());
+    }
+
+    void
+    PixelStatistics::merge(const PixelStatistics& other)
+    {
+      if (&other == this)
+        return;
+
+      std::vector<Sample> values;
+      bool otherhistogram;
+      {
+        std::lock_guard<std::mutex> lock(other.mutex);
+        values = other.samples;
+        otherhistogram = other.histogram;
+      }
+
+      for (std::vector<Sample>::size_type s = 0; s < values.size(); ++s)
+        if (values[s].count)
+          merge(s, values[s], otherhistogram);
+    }
+
+    void
+    PixelStatistics::merge(dimension_size_type sample,
+                           const Sample&       value,
+                           bool                valuehistogram)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+
+      if (samples.empty())
+        histogram = valuehistogram;
+      else
+        histogram = histogram && valuehistogram;
+
+      if (sample >= samples.size())
+        samples.resize(sample + 1U);
+
+      Sample& current(samples[sample]);
+      if (!current.count)
+        {
+          current.minimum = value.minimum;
+          current.maximum = value.maximum;
+        }
+      else
+        {
+          current.minimum = std::min(current.minimum, value.minimum);
+          current.maximum = std::max(current.maximum, value.maximum);
+        }
+      current.count += value.count;
+      if (histogram)
+        for (std::size_t bin = 0; bin < histogram_bins; ++bin)
+          current.histogram[bin] += value.histogram[bin];
+    }
+
+    dimension_size_type
+    PixelStatistics::getSampleCount() const
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      return samples.size();
+    }
+
+    uint64_t
+    PixelStatistics::getCount(dimension_size_type sample) const
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      return sample < samples.size() ? samples[sample].count : 0U;
+    }
+
+    double
+    PixelStatistics::getMinimum(dimension_size_type sample) const
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      return sample < samples.size() ? samples[sample].minimum : 0.0;
+    }
+
+    double
+    PixelStatistics::getMaximum(dimension_size_type sample) const
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      return sample < samples.size() ? samples[sample].maximum : 0.0;
+    }
+
+    bool
+    PixelStatistics::hasHistogram() const
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      return histogram;
+    }
+
+    PixelStatistics::histogram_type
+    PixelStatistics::getHistogram(dimension_size_type sample) const
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (histogram && sample < samples.size())
+        return samples[sample].histogram;
+      return histogram_type();
+    }
+
+    void
+    PixelStatistics::reset()
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      samples.clear();
+      histogram = false;
+    }
+
+  }
+}
@@ -0,0 +1,494 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+
+#ifndef OME_FILES_PIXELSTATISTICS_H
+#define OME_FILES_PIXELSTATISTICS_H
+
+#include <array>
+#include <complex>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+#include <ome/files/PixelBufferView.h>
+#include <ome/files/Types.h>
+#include <ome/files/VariantPixelBuffer.h>
+
+namespace ome
+{
+  namespace files
+  {
+
+    /**
+     * Pixel value statistics.
+     *
+     * The minimum and maximum value and the number of values are
+     * accumulated for each subchannel, along with a histogram of
+     * 256 bins for 8- and 16-bit integer and bit pixel types.  For
+     * 8-bit types each value has its own bin; for 16-bit types each
+     * bin covers 256 consecutive values, starting from the type
+     * minimum.  Complex pixel types have no ordering, and are
+     * ignored.
+     *
+     * Statistics may be accumulated by the TIFF layer while pixel
+     * data is transferred between tiles and pixel buffers, so that
+     * the pixel data is not traversed a second time.  Regions are
+     * accumulated into local values and merged under a lock, so
+     * that several threads may accumulate disjoint regions of the
+     * same plane concurrently.
+     */
+    class PixelStatistics
+    {
+    public:
+      /// Number of histogram bins.
+      static const std::size_t histogram_bins = 256U;
+
+      /// Histogram type.
+      typedef std::array<uint64_t, histogram_bins> histogram_type;
+
+      /// Constructor.
+      PixelStatistics();
+
+      /// Destructor.
+      ~PixelStatistics();
+
+      /// @cond SKIP
+      PixelStatistics (const PixelStatistics&) = delete;
+
+      PixelStatistics&
+      operator= (const PixelStatistics&) = delete;
+      /// @endcond SKIP
+
+      /**
+       * Accumulate all values in a pixel buffer.
+       *
+       * @param buffer the buffer to accumulate.
+       */
+      void
+      add(const VariantPixelBuffer& buffer);
+
+      /**
+       * Accumulate a region of a pixel buffer.
+       *
+       * The region is relative to the buffer origin, and covers the
+       * specified range of subchannels for index zero of all other
+       * dimensions.  Values for buffer subchannel @c s are
+       * accumulated as statistics sample @c s.
+       *
+       * @param buffer the buffer to accumulate.
+       * @param x the @c X starting coordinate.
+       * @param y the @c Y starting coordinate.
+       * @param w the width of the region.
+       * @param h the height of the region.
+       * @param first the first subchannel.
+       * @param count the number of subchannels.
+       */
+      void
+      add(const VariantPixelBuffer& buffer,
+          dimension_size_type       x,
+          dimension_size_type       y,
+          dimension_size_type       w,
+          dimension_size_type       h,
+          dimension_size_type       first,
+          dimension_size_type       count);
+
+      /**
+       * Accumulate a region of a pixel buffer.
+       *
+       * @param buffer the buffer to accumulate.
+       * @param x the @c X starting coordinate.
+       * @param y the @c Y starting coordinate.
+       * @param w the width of the region.
+       * @param h the height of the region.
+       * @param first the first subchannel.
+       * @param count the number of subchannels.
+       */
+      template<typename T>
+      void
+      add(const PixelBuffer<T>& buffer,
+          dimension_size_type   x,
+          dimension_size_type   y,
+          dimension_size_type   w,
+          dimension_size_type   h,
+          dimension_size_type   first,
+          dimension_size_type   count);
+
+      /**
+       * Merge statistics.
+       *
+       * @param other the statistics to merge into these statistics.
+       */
+      void
+      merge(const PixelStatistics& other);
+
+      /**
+       * Get the number of samples.
+       *
+       * @returns the number of subchannels for which values have
+       * been accumulated.
+       */
+      dimension_size_type
+      getSampleCount() const;
+
+      /**
+       * Get the number of values accumulated for a sample.
+       *
+       * @param sample the sample (subchannel).
+       * @returns the number of values.
+       */
+      uint64_t
+      getCount(dimension_size_type sample) const;
+
+      /**
+       * Get the minimum value of a sample.
+       *
+       * @param sample the sample (subchannel).
+       * @returns the minimum value, or zero if no values have been
+       * accumulated.
+       */
+      double
+      getMinimum(dimension_size_type sample) const;
+
+      /**
+       * Get the maximum value of a sample.
+       *
+       * @param sample the sample (subchannel).
+       * @returns the maximum value, or zero if no values have been
+       * accumulated.
+       */
+      double
+      getMaximum(dimension_size_type sample) const;
+
+      /**
+       * Check if histograms are available.
+       *
+       * @returns @c true if histograms have been accumulated.
+       */
+      bool
+      hasHistogram() const;
+
+      /**
+       * Get the histogram of a sample.
+       *
+       * @param sample the sample (subchannel).
+       * @returns the histogram; all bins are zero if no histogram
+       * is available.
+       */
+      histogram_type
+      getHistogram(dimension_size_type sample) const;
+
+      /**
+       * Discard all accumulated values.
+       */
+      void
+      reset();
+
+    private:
+      /// Statistics for a single sample.
+      struct Sample
+      {
+        /// Number of values.
+        uint64_t       count;
+        /// Minimum value.
+        double         minimum;
+        /// Maximum value.
+        double         maximum;
+        /// Histogram.
+        histogram_type histogram;
+
+        /// Constructor.
+        Sample():
+          count(0U),
+          minimum(0.0),
+          maximum(0.0),
+          histogram()
+        {}
+      };
+
+      /**
+       * Merge values for a sample.
+       *
+       * @param sample the sample (subchannel).
+       * @param value the values to merge.
+       * @param histogram @c true if the histogram is valid.
+       */
+      void
+      merge(dimension_size_type sample,
+            const Sample&       value,
+            bool                histogram);
+
+      /// Lock for accumulated values.
+      mutable std::mutex  mutex;
+      /// Values for each sample.
+      std::vector<Sample> samples;
+      /// Histograms accumulated.
+      bool                histogram;
+    };
+
+    namespace detail
+    {
+
+      /**
+       * Pixel statistics type traits.
+       *
+       * Provides the histogram bin for a value of integer types of
+       * up to 16 bits.
+       */
+      template<typename T, typename Enable = void>
+      struct PixelStatisticsTraits
+      {
+        /// Histogram supported.
+        static const bool histogram = false;
+
+        /**
+         * Get the histogram bin of a value.
+         *
+         * @returns zero (unused).
+         */
+        static uint32_t
+        bin(T /* value */)
+        {
+          return 0U;
+        }
+      };
+
+      /// Pixel statistics type traits for small integer types.
+      template<typename T>
+      struct PixelStatisticsTraits<T, typename std::enable_if<std::is_integral<T>::value && sizeof(T) <= 2U>::type>
+      {
+        /// Histogram supported.
+        static const bool histogram = true;
+
+        /**
+         * Get the histogram bin of a value.
+         *
+         * @param value the value.
+         * @returns the bin.
+         */
+        static uint32_t
+        bin(T value)
+        {
+          return static_cast<uint32_t>(static_cast<int32_t>(value) -
+                                       static_cast<int32_t>(std::numeric_limits<T>::min())) >>
+            ((sizeof(T) - 1U) * 8U);
+        }
+      };
+
+      /**
+       * Accumulate the minimum and maximum of a row of values.
+       *
+       * The contiguous case is kept free of the histogram update,
+       * so that it may be vectorised.
+       *
+       * @param row the first value.
+       * @param stride the distance between values.
+       * @param n the number of values.
+       * @param minimum the minimum value to update.
+       * @param maximum the maximum value to update.
+       */
+      template<typename T>
+      inline void
+      rowRange(const T        *row,
+               std::ptrdiff_t  stride,
+               dimension_size_type n,
+               T&              minimum,
+               T&              maximum)
+      {
+        T lo = minimum;
+        T hi = maximum;
+        if (stride == 1)
+          {
+            for (dimension_size_type i = 0U; i < n; ++i)
+              {
+                const T v = row[i];
+                lo = v < lo ? v : lo;
+                hi = v > hi ? v : hi;
+              }
+          }
+        else
+          {
+            for (dimension_size_type i = 0U; i < n; ++i)
+              {
+                const T v = row[static_cast<std::ptrdiff_t>(i) * stride];
+                lo = v < lo ? v : lo;
+                hi = v > hi ? v : hi;
+              }
+          }
+        minimum = lo;
+        maximum = hi;
+      }
+
+      /**
+       * Accumulate the histogram of a row of values.
+       *
+       * @param row the first value.
+       * @param stride the distance between values.
+       * @param n the number of values.
+       * @param histogram the histogram to update.
+       */
+      template<typename T>
+      inline void
+      rowHistogram(const T                         *row,
+                   std::ptrdiff_t                   stride,
+                   dimension_size_type              n,
+                   PixelStatistics::histogram_type& histogram)
+      {
+        for (dimension_size_type i = 0U; i < n; ++i)
+          ++histogram[PixelStatisticsTraits<T>::bin(row[static_cast<std::ptrdiff_t>(i) * stride])];
+      }
+
+      /**
+       * Pixel statistics accumulation.
+       *
+       * Accumulates a region of a single subchannel.
+       */
+      template<typename T>
+      struct PixelStatisticsAccumulator
+      {
+        /**
+         * Accumulate a region.
+         *
+         * @param view the buffer view, indexed at the region origin.
+         * @param idx the indices of the region origin.
+         * @param w the width of the region.
+         * @param h the height of the region.
+         * @param count the number of values accumulated.
+         * @param minimum the minimum value.
+         * @param maximum the maximum value.
+         * @param histogram the histogram.
+         * @returns @c true if values were accumulated.
+         */
+        static bool
+        accumulate(const PixelBufferView<const T>&  view,
+                   PixelBufferBase::indices_type&   idx,
+                   dimension_size_type              w,
+                   dimension_size_type              h,
+                   uint64_t&                        count,
+                   double&                          minimum,
+                   double&                          maximum,
+                   PixelStatistics::histogram_type& histogram)
+        {
+          const std::ptrdiff_t stride = view.stride(DIM_SPATIAL_X);
+          const dimension_size_type y = idx[DIM_SPATIAL_Y];
+          T lo = *view.pointer(idx);
+          T hi = lo;
+          for (dimension_size_type row = y; row < y + h; ++row)
+            {
+              idx[DIM_SPATIAL_Y] = row;
+              const T *src = view.pointer(idx);
+              rowRange(src, stride, w, lo, hi);
+              if (PixelStatisticsTraits<T>::histogram)
+                rowHistogram(src, stride, w, histogram);
+            }
+          idx[DIM_SPATIAL_Y] = y;
+          count = w * h;
+          minimum = static_cast<double>(lo);
+          maximum = static_cast<double>(hi);
+          return true;
+        }
+      };
+
+      /// Pixel statistics accumulation for complex types (ignored).
+      template<typename T>
+      struct PixelStatisticsAccumulator<std::complex<T>>
+      {
+        /**
+         * Accumulate a region.
+         *
+         * @returns @c false.
+         */
+        static bool
+        accumulate(const PixelBufferView<const std::complex<T>>& /* view */,
+                   PixelBufferBase::indices_type&                /* idx */,
+                   dimension_size_type                           /* w */,
+                   dimension_size_type                           /* h */,
+                   uint64_t&                                     /* count */,
+                   double&                                       /* minimum */,
+                   double&                                       /* maximum */,
+                   PixelStatistics::histogram_type&              /* histogram */)
+        {
+          return false;
+        }
+      };
+
+    }
+
+    template<typename T>
+    void
+    PixelStatistics::add(const PixelBuffer<T>& buffer,
+                         dimension_size_type   x,
+                         dimension_size_type   y,
+                         dimension_size_type   w,
+                         dimension_size_type   h,
+                         dimension_size_type   first,
+                         dimension_size_type   count)
+    {
+      if (!w || !h)
+        return;
+
+      PixelBufferView<const T> view(buffer);
+      PixelBufferBase::indices_type idx;
+      idx.fill(0);
+      idx[DIM_SPATIAL_X] = static_cast<PixelBufferBase::index>(x);
+      idx[DIM_SPATIAL_Y] = static_cast<PixelBufferBase::index>(y);
+
+      for (dimension_size_type s = first; s < first + count; ++s)
+        {
+          idx[DIM_SUBCHANNEL] = static_cast<PixelBufferBase::index>(s);
+          Sample value;
+          if (detail::PixelStatisticsAccumulator<T>::accumulate(view, idx, w, h,
+                                                                value.count,
+                                                                value.minimum,
+                                                                value.maximum,
+                                                                value.histogram))
+            merge(s, value, detail::PixelStatisticsTraits<T>::histogram);
+        }
+    }
+
+  }
+}
+
+#endif // OME_FILES_PIXELSTATISTICS_H
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
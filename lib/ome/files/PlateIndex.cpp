@@ -0,0 +1,201 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+
+#include <functional>
+#include <string>
+#include <utility>
+
+#include <ome/files/PlateIndex.h>
+
+namespace ome
+{
+  namespace files
+  {
+
+    std::size_t
+    PlateIndex::KeyHash::operator() (const Key& key) const
+    {
+      std::hash<dimension_size_type> hash;
+      std::size_t value = hash(key.plate);
+      for (dimension_size_type part : {key.row, key.column, key.field})
+        value ^= hash(part) + 0x9e3779b9U + (value << 6) + (value >> 2);
+      return value;
+    }
+
+    PlateIndex::PlateIndex():
+      entries(),
+      keys(),
+      series()
+    {
+    }
+
+    PlateIndex::PlateIndex(const ::ome::xml::meta::MetadataRetrieve& meta):
+      entries(),
+      keys(),
+      series()
+    {
+      std::unordered_map<std::string, dimension_size_type> images;
+      const dimension_size_type imageCount = meta.getImageCount();
+      for (dimension_size_type i = 0; i < imageCount; ++i)
+        images.insert(std::make_pair(meta.getImageID(i), i));
+      series.resize(imageCount);
+
+      const dimension_size_type plateCount = meta.getPlateCount();
+      for (dimension_size_type p = 0; p < plateCount; ++p)
+        {
+          const dimension_size_type wellCount = meta.getWellCount(p);
+          for (dimension_size_type w = 0; w < wellCount; ++w)
+            {
+              Location location;
+              location.plate = p;
+              location.well = w;
+              try
+                {
+                  location.row = static_cast<dimension_size_type>(meta.getWellRow(p, w));
+                  location.column = static_cast<dimension_size_type>(meta.getWellColumn(p, w));
+                }
+              catch (const std::exception&)
+                {
+                  continue;
+                }
+
+              const dimension_size_type sampleCount = meta.getWellSampleCount(p, w);
+              for (dimension_size_type s = 0; s < sampleCount; ++s)
+                {
+                  std::string imageID;
+                  try
+                    {
+                      imageID = meta.getWellSampleImageRef(p, w, s);
+                    }
+                  catch (const std::exception&)
+                    {
+                      continue;
+                    }
+
+                  auto image = images.find(imageID);
+                  if (image == images.end())
+                    continue;
+
+                  location.field = s;
+                  add(location, image->second);
+                }
+            }
+        }
+    }
+
+    void
+    PlateIndex::add(const Location&     location,
+                    dimension_size_type series)
+    {
+      const Key key = {location.plate, location.row, location.column, location.field};
+      const Entry entry = {location, series};
+
+      std::vector<Entry>::size_type index;
+      auto found = keys.find(key);
+      if (found != keys.end())
+        {
+          // Replace the existing entry for this location.
+          index = found->second;
+          entries[index] = entry;
+        }
+      else
+        {
+          index = entries.size();
+          entries.push_back(entry);
+          keys.insert(std::make_pair(key, index));
+        }
+
+      if (series >= this->series.size())
+        this->series.resize(series + 1);
+      if (!this->series[series])
+        this->series[series] = index;
+    }
+
+    dimension_size_type
+    PlateIndex::size() const
+    {
+      return entries.size();
+    }
+
+    bool
+    PlateIndex::empty() const
+    {
+      return entries.empty();
+    }
+
+    boost::optional<dimension_size_type>
+    PlateIndex::findSeries(dimension_size_type plate,
+                           dimension_size_type row,
+                           dimension_size_type column,
+                           dimension_size_type field) const
+    {
+      boost::optional<dimension_size_type> ret;
+      const Key key = {plate, row, column, field};
+      auto found = keys.find(key);
+      if (found != keys.end())
+        ret = entries[found->second].series;
+      return ret;
+    }
+
+    boost::optional<PlateIndex::Location>
+    PlateIndex::findLocation(dimension_size_type series) const
+    {
+      boost::optional<Location> ret;
+      if (series < this->series.size() && this->series[series])
+        {
+          const Entry& entry(entries[*this->series[series]]);
+          if (entry.series == series)
+            ret = entry.location;
+        }
+      return ret;
+    }
+
+    const std::vector<PlateIndex::Entry>&
+    PlateIndex::getEntries() const
+    {
+      return entries;
+    }
+
+  }
+}
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
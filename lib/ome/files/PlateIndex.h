@@ -0,0 +1,237 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+
+#ifndef OME_FILES_PLATEINDEX_H
+#define OME_FILES_PLATEINDEX_H
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+#include <ome/files/Types.h>
+
+#include <ome/xml/meta/MetadataRetrieve.h>
+
+namespace ome
+{
+  namespace files
+  {
+
+    /**
+     * Index of the series for each well sample of a plate.
+     *
+     * High-content screening datasets may contain many thousands of
+     * Images, each being a single field of a well.  Finding the
+     * series for a given plate, well and field by searching the
+     * metadata has a cost proportional to the number of wells and
+     * samples; this index maps each plate, well row, well column and
+     * field to a series, and each series back to its location, in
+     * constant time.
+     *
+     * The field is the index of the WellSample within its Well.
+     * Well samples which do not reference an Image are not indexed.
+     * If an Image is referenced by more than one well sample, the
+     * first is used for the reverse lookup.
+     *
+     * Once constructed, lookups are thread-safe.
+     */
+    class PlateIndex
+    {
+    public:
+      /// The location of a series within a plate.
+      struct Location
+      {
+        /// Plate index.
+        dimension_size_type plate;
+        /// Well index within the plate.
+        dimension_size_type well;
+        /// Well row.
+        dimension_size_type row;
+        /// Well column.
+        dimension_size_type column;
+        /// Field (WellSample index) within the well.
+        dimension_size_type field;
+      };
+
+      /// An indexed series and its location.
+      struct Entry
+      {
+        /// The location.
+        Location location;
+        /// The series (Image index).
+        dimension_size_type series;
+      };
+
+      /**
+       * Constructor.
+       *
+       * Create an empty index; use add() to populate it.
+       */
+      PlateIndex();
+
+      /**
+       * Construct from metadata.
+       *
+       * All well samples of all plates are indexed.  Wells without
+       * a row and column, and well samples without an Image
+       * reference, are skipped.
+       *
+       * @param meta the metadata to index.
+       */
+      explicit
+      PlateIndex(const ::ome::xml::meta::MetadataRetrieve& meta);
+
+      /**
+       * Add a series to the index.
+       *
+       * @param location the location of the series.
+       * @param series the series.
+       */
+      void
+      add(const Location&     location,
+          dimension_size_type series);
+
+      /**
+       * Get the number of indexed well samples.
+       *
+       * @returns the number of entries.
+       */
+      dimension_size_type
+      size() const;
+
+      /**
+       * Check if the index is empty.
+       *
+       * @returns @c true if there are no entries, otherwise @c false.
+       */
+      bool
+      empty() const;
+
+      /**
+       * Find the series for a well sample.
+       *
+       * @param plate the plate index.
+       * @param row the well row.
+       * @param column the well column.
+       * @param field the field (WellSample index) within the well.
+       * @returns the series, or none if not present.
+       */
+      boost::optional<dimension_size_type>
+      findSeries(dimension_size_type plate,
+                 dimension_size_type row,
+                 dimension_size_type column,
+                 dimension_size_type field) const;
+
+      /**
+       * Find the location of a series.
+       *
+       * @param series the series.
+       * @returns the location, or none if the series is not
+       * part of a plate.
+       */
+      boost::optional<Location>
+      findLocation(dimension_size_type series) const;
+
+      /**
+       * Get all entries.
+       *
+       * @returns the entries, in the order added.
+       */
+      const std::vector<Entry>&
+      getEntries() const;
+
+    private:
+      /// Lookup key (plate, row, column and field).
+      struct Key
+      {
+        /// Plate index.
+        dimension_size_type plate;
+        /// Well row.
+        dimension_size_type row;
+        /// Well column.
+        dimension_size_type column;
+        /// Field within the well.
+        dimension_size_type field;
+
+        /**
+         * Compare keys for equality.
+         *
+         * @param rhs the key to compare with.
+         * @returns @c true if equal, otherwise @c false.
+         */
+        bool
+        operator== (const Key& rhs) const
+        {
+          return plate == rhs.plate && row == rhs.row &&
+            column == rhs.column && field == rhs.field;
+        }
+      };
+
+      /// Hash function for Key.
+      struct KeyHash
+      {
+        /**
+         * Hash a key.
+         *
+         * @param key the key to hash.
+         * @returns the hash value.
+         */
+        std::size_t
+        operator() (const Key& key) const;
+      };
+
+      /// All entries, in the order added.
+      std::vector<Entry> entries;
+      /// Entry index for each location.
+      std::unordered_map<Key, std::vector<Entry>::size_type, KeyHash> keys;
+      /// Entry index for each series (by series index).
+      std::vector<boost::optional<std::vector<Entry>::size_type>> series;
+    };
+
+  }
+}
+
+#endif // OME_FILES_PLATEINDEX_H
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
@@ -0,0 +1,369 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <complex>
+#include <exception>
+#include <stdexcept>
+#include <vector>
+
+#include <boost/format.hpp>
+
+#include <ome/files/Executor.h>
+#include <ome/files/FormatReader.h>
+#include <ome/files/PixelCopy.h>
+#include <ome/files/Projection.h>
+
+using ::ome::xml::model::enums::PixelType;
+
+namespace ome
+{
+  namespace files
+  {
+
+    namespace
+    {
+
+      typedef PixelProperties<PixelType::DOUBLE>::std_type double_pixel;
+
+      // Reduction kernels.  These are plain loops over contiguous
+      // data without branches, which compilers vectorise for each
+      // pixel type.
+      template<typename T>
+      struct Reduce
+      {
+        static void
+        maximum(const T             *src,
+                T                   *acc,
+                dimension_size_type  n)
+        {
+          for (dimension_size_type i = 0U; i < n; ++i)
+            acc[i] = src[i] > acc[i] ? src[i] : acc[i];
+        }
+
+        static void
+        minimum(const T             *src,
+                T                   *acc,
+                dimension_size_type  n)
+        {
+          for (dimension_size_type i = 0U; i < n; ++i)
+            acc[i] = src[i] < acc[i] ? src[i] : acc[i];
+        }
+
+        static void
+        sum(const T             *src,
+            double_pixel        *acc,
+            dimension_size_type  n)
+        {
+          for (dimension_size_type i = 0U; i < n; ++i)
+            acc[i] += static_cast<double_pixel>(src[i]);
+        }
+      };
+
+      // Complex values are not ordered, and are rejected before
+      // reading; these only exist to permit visitation.
+      template<typename F>
+      struct Reduce<std::complex<F>>
+      {
+        static void
+        maximum(const std::complex<F> *,
+                std::complex<F>       *,
+                dimension_size_type)
+        {
+          throw std::logic_error("Projection of complex pixel types is not supported");
+        }
+
+        static void
+        minimum(const std::complex<F> *,
+                std::complex<F>       *,
+                dimension_size_type)
+        {
+          throw std::logic_error("Projection of complex pixel types is not supported");
+        }
+
+        static void
+        sum(const std::complex<F> *,
+            double_pixel          *,
+            dimension_size_type)
+        {
+          throw std::logic_error("Projection of complex pixel types is not supported");
+        }
+      };
+
+      // Reduce a tile of one plane into the accumulator.  The
+      // accumulator has the shape and storage order of the tile, so
+      // the reduction is over the raw element arrays.
+      struct ReduceVisitor : public boost::static_visitor<>
+      {
+        ProjectionMethod    method;
+        VariantPixelBuffer& acc;
+
+        ReduceVisitor(ProjectionMethod    method,
+                      VariantPixelBuffer& acc):
+          method(method),
+          acc(acc)
+        {}
+
+        template<typename T>
+        void
+        operator()(const T& src)
+        {
+          typedef typename T::element_type::value_type value_type;
+
+          const dimension_size_type n = src->num_elements();
+          switch (method)
+            {
+            case PROJECTION_MAXIMUM:
+              Reduce<value_type>::maximum(src->data(), boost::get<T>(acc.vbuffer())->data(), n);
+              break;
+            case PROJECTION_MINIMUM:
+              Reduce<value_type>::minimum(src->data(), boost::get<T>(acc.vbuffer())->data(), n);
+              break;
+            case PROJECTION_SUM:
+            case PROJECTION_MEAN:
+              Reduce<value_type>::sum(src->data(), acc.data<double_pixel>(), n);
+              break;
+            }
+        }
+      };
+
+      // Projection of a region, split into tiles which are each
+      // projected by a single worker.
+      struct Projector
+      {
+        const FormatReader&              reader;
+        ProjectionMethod                 method;
+        dimension_size_type              series;
+        dimension_size_type              resolution;
+        std::vector<dimension_size_type> planes;
+        PlaneRegion                      region;
+        std::vector<PlaneRegion>         tiles;
+        VariantPixelBuffer&              dest;
+        std::atomic<dimension_size_type> next;
+
+        Projector(const FormatReader& reader,
+                  ProjectionMethod    method,
+                  const PlaneRegion&  region,
+                  VariantPixelBuffer& dest):
+          reader(reader),
+          method(method),
+          series(reader.hasFlattenedResolutions() ? reader.getCoreIndex() : reader.getSeries()),
+          resolution(reader.hasFlattenedResolutions() ? 0U : reader.getResolution()),
+          planes(),
+          region(region),
+          tiles(),
+          dest(dest),
+          next(0U)
+        {
+          const dimension_size_type tw = std::max(reader.getOptimalTileWidth(), static_cast<dimension_size_type>(1U));
+          const dimension_size_type th = std::max(reader.getOptimalTileHeight(), static_cast<dimension_size_type>(1U));
+
+          // Tiles are aligned to the reader tile grid, so that each
+          // is read without decoding neighbouring tiles.
+          for (dimension_size_type ty = (region.y / th) * th; ty < region.y + region.h; ty += th)
+            for (dimension_size_type tx = (region.x / tw) * tw; tx < region.x + region.w; tx += tw)
+              {
+                PlaneRegion tile = PlaneRegion(tx, ty, tw, th) & region;
+                if (tile.area())
+                  tiles.push_back(tile);
+              }
+        }
+
+        // Project tiles until none remain.
+        void
+        run(std::exception_ptr& error)
+        {
+          try
+            {
+              VariantPixelBuffer buf;
+              VariantPixelBuffer acc;
+
+              for (dimension_size_type i = next++; i < tiles.size(); i = next++)
+                {
+                  const PlaneRegion& tile(tiles[i]);
+
+                  for (dimension_size_type p = 0; p < planes.size(); ++p)
+                    {
+                      reader.openBytesConcurrent(series, resolution, planes[p], buf,
+                                                 tile.x, tile.y, tile.w, tile.h);
+
+                      if (p == 0U)
+                        {
+                          std::array<VariantPixelBuffer::size_type, PixelBufferBase::dimensions> shape;
+                          std::copy(buf.shape(), buf.shape() + PixelBufferBase::dimensions, shape.begin());
+                          if (method == PROJECTION_MAXIMUM || method == PROJECTION_MINIMUM)
+                            {
+                              acc.setBuffer(shape, buf.pixelType(), buf.storage_order(), PIXEL_UNINITIALIZED);
+                              acc = buf;
+                              continue;
+                            }
+                          // Zero-initialised for summation.
+                          acc.setBuffer(shape, PixelType::DOUBLE, buf.storage_order());
+                        }
+
+                      ReduceVisitor v(method, acc);
+                      boost::apply_visitor(v, buf.vbuffer());
+                    }
+
+                  if (method == PROJECTION_MEAN)
+                    {
+                      const double_pixel scale = 1.0 / static_cast<double_pixel>(planes.size());
+                      double_pixel *data = acc.data<double_pixel>();
+                      for (dimension_size_type e = 0; e < acc.num_elements(); ++e)
+                        data[e] *= scale;
+                    }
+
+                  // Each tile covers a separate part of the
+                  // destination, so workers may store concurrently.
+                  VariantPixelBuffer::indices_type aidx, didx;
+                  std::fill(aidx.begin(), aidx.end(), 0);
+                  std::fill(didx.begin(), didx.end(), 0);
+                  didx[DIM_SPATIAL_X] = static_cast<VariantPixelBuffer::indices_type::value_type>(tile.x - region.x);
+                  didx[DIM_SPATIAL_Y] = static_cast<VariantPixelBuffer::indices_type::value_type>(tile.y - region.y);
+                  region_shape_type shape;
+                  std::copy(acc.shape(), acc.shape() + PixelBufferBase::dimensions, shape.begin());
+                  copyRegion(acc, aidx, dest, didx, shape);
+                }
+            }
+          catch (...)
+            {
+              error = std::current_exception();
+              // Stop the other workers.
+              next = tiles.size();
+            }
+        }
+      };
+
+    }
+
+    void
+    project(const FormatReader& reader,
+            ProjectionAxis      axis,
+            ProjectionMethod    method,
+            dimension_size_type c,
+            dimension_size_type index,
+            const PlaneRegion&  region,
+            VariantPixelBuffer& dest,
+            dimension_size_type threads)
+    {
+      const PixelType type = reader.getPixelType();
+      if (type == PixelType::COMPLEXFLOAT || type == PixelType::DOUBLECOMPLEX)
+        {
+          boost::format fmt("Projection of pixel type %1% is not supported");
+          fmt % type;
+          throw std::logic_error(fmt.str());
+        }
+
+      if (c >= reader.getEffectiveSizeC())
+        {
+          boost::format fmt("Channel %1% is invalid for channel count %2%");
+          fmt % c % reader.getEffectiveSizeC();
+          throw std::logic_error(fmt.str());
+        }
+
+      const dimension_size_type other = axis == PROJECTION_Z ? reader.getSizeT() : reader.getSizeZ();
+      if (index >= other)
+        {
+          boost::format fmt("%1% index %2% is invalid for size %3%");
+          fmt % (axis == PROJECTION_Z ? "T" : "Z") % index % other;
+          throw std::logic_error(fmt.str());
+        }
+
+      if (!region.area() ||
+          region.x + region.w > reader.getSizeX() ||
+          region.y + region.h > reader.getSizeY())
+        {
+          boost::format fmt("Region %1%x%2% at %3%,%4% is invalid for image size %5%x%6%");
+          fmt % region.w % region.h % region.x % region.y % reader.getSizeX() % reader.getSizeY();
+          throw std::logic_error(fmt.str());
+        }
+
+      std::array<VariantPixelBuffer::size_type, PixelBufferBase::dimensions> shape, dest_shape;
+      std::fill(shape.begin(), shape.end(), 1U);
+      shape[DIM_SPATIAL_X] = region.w;
+      shape[DIM_SPATIAL_Y] = region.h;
+      shape[DIM_SUBCHANNEL] = reader.getRGBChannelCount(c);
+      const VariantPixelBuffer::size_type *dest_shape_ptr(dest.shape());
+      std::copy(dest_shape_ptr, dest_shape_ptr + PixelBufferBase::dimensions,
+                dest_shape.begin());
+
+      const PixelType desttype = (method == PROJECTION_MAXIMUM || method == PROJECTION_MINIMUM) ?
+        type : PixelType::DOUBLE;
+      if (desttype != dest.pixelType() || shape != dest_shape)
+        dest.setBuffer(shape, desttype, dest.storage_order(), PIXEL_UNINITIALIZED);
+
+      Projector projector(reader, method, region, dest);
+      const dimension_size_type count = axis == PROJECTION_Z ? reader.getSizeZ() : reader.getSizeT();
+      projector.planes.reserve(count);
+      for (dimension_size_type i = 0; i < count; ++i)
+        projector.planes.push_back(axis == PROJECTION_Z ?
+                                   reader.getIndex(i, c, index) :
+                                   reader.getIndex(index, c, i));
+
+      threads = std::min(std::max(threads, static_cast<dimension_size_type>(1U)),
+                         static_cast<dimension_size_type>(projector.tiles.size()));
+      std::vector<std::exception_ptr> errors(threads);
+      runParallel(reader.getExecutor(), threads,
+                  [&projector, &errors](dimension_size_type worker,
+                                        dimension_size_type)
+                  {
+                    projector.run(errors[worker]);
+                  });
+
+      for (const auto& error : errors)
+        if (error)
+          std::rethrow_exception(error);
+    }
+
+    void
+    project(const FormatReader& reader,
+            ProjectionAxis      axis,
+            ProjectionMethod    method,
+            dimension_size_type c,
+            dimension_size_type index,
+            VariantPixelBuffer& dest,
+            dimension_size_type threads)
+    {
+      project(reader, axis, method, c, index,
+              PlaneRegion(0, 0, reader.getSizeX(), reader.getSizeY()),
+              dest, threads);
+    }
+
+  }
+}
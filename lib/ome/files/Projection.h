@@ -0,0 +1,148 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#ifndef OME_FILES_PROJECTION_H
+#define OME_FILES_PROJECTION_H
+
+#include <ome/files/PlaneRegion.h>
+#include <ome/files/Types.h>
+#include <ome/files/VariantPixelBuffer.h>
+
+namespace ome
+{
+  namespace files
+  {
+
+    class FormatReader;
+
+    /// Intensity projection methods.
+    enum ProjectionMethod
+      {
+        PROJECTION_MAXIMUM, ///< Maximum intensity.
+        PROJECTION_MINIMUM, ///< Minimum intensity.
+        PROJECTION_SUM,     ///< Sum of intensities.
+        PROJECTION_MEAN     ///< Mean intensity.
+      };
+
+    /// Dimensions along which to project.
+    enum ProjectionAxis
+      {
+        PROJECTION_Z, ///< Project all @c Z planes at a single @c T.
+        PROJECTION_T  ///< Project all @c T planes at a single @c Z.
+      };
+
+    /**
+     * Project a region of all the planes along an axis.
+     *
+     * The planes of the current series and resolution of @p reader
+     * with channel @p c are read one tile at a time, using the
+     * optimal tile size of the reader, and each tile is reduced
+     * across all the planes along @p axis before the next tile is
+     * read.  The memory required is that of the destination plane
+     * plus two tiles per thread.  Tiles are read with
+     * FormatReader::openBytesConcurrent(), and are projected in
+     * parallel using up to @p threads workers of the reader's
+     * executor.
+     *
+     * For maximum and minimum projections, the destination has the
+     * pixel type of the image.  For sum and mean projections, it
+     * has the DOUBLE pixel type.  Complex pixel types are not
+     * supported.  If the destination buffer is not of the correct
+     * size and pixel type, it will be reset to the correct size and
+     * type, retaining its storage order.
+     *
+     * @param reader the reader to use; it must not be used
+     * concurrently with methods which change its state.
+     * @param axis the axis to project along.
+     * @param method the projection method.
+     * @param c the channel to project.
+     * @param index the @c T coordinate for @c Z projections, or the
+     * @c Z coordinate for @c T projections.
+     * @param region the region to project.
+     * @param dest the destination pixel buffer.
+     * @param threads the maximum number of threads to use; 0 is
+     * treated as 1.
+     * @throws std::logic_error if the channel, index or region is
+     * invalid, or the pixel type is complex.
+     */
+    void
+    project(const FormatReader& reader,
+            ProjectionAxis      axis,
+            ProjectionMethod    method,
+            dimension_size_type c,
+            dimension_size_type index,
+            const PlaneRegion&  region,
+            VariantPixelBuffer& dest,
+            dimension_size_type threads = 1U);
+
+    /**
+     * Project whole planes along an axis.
+     *
+     * As for project(const FormatReader&,ProjectionAxis,ProjectionMethod,dimension_size_type,dimension_size_type,const PlaneRegion&,VariantPixelBuffer&,dimension_size_type),
+     * for the whole plane.
+     *
+     * @param reader the reader to use.
+     * @param axis the axis to project along.
+     * @param method the projection method.
+     * @param c the channel to project.
+     * @param index the @c T coordinate for @c Z projections, or the
+     * @c Z coordinate for @c T projections.
+     * @param dest the destination pixel buffer.
+     * @param threads the maximum number of threads to use; 0 is
+     * treated as 1.
+     * @throws std::logic_error if the channel or index is invalid,
+     * or the pixel type is complex.
+     */
+    void
+    project(const FormatReader& reader,
+            ProjectionAxis      axis,
+            ProjectionMethod    method,
+            dimension_size_type c,
+            dimension_size_type index,
+            VariantPixelBuffer& dest,
+            dimension_size_type threads = 1U);
+
+  }
+}
+
+#endif // OME_FILES_PROJECTION_H
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
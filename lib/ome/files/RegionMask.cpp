@@ -0,0 +1,369 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+#include <boost/format.hpp>
+
+#include <ome/files/FormatReader.h>
+#include <ome/files/PixelCopy.h>
+#include <ome/files/RegionMask.h>
+
+namespace ome
+{
+  namespace files
+  {
+
+    namespace
+    {
+
+      // Integer pixel range [first, last) of a coordinate range,
+      // clipped to the non-negative plane.
+      std::pair<dimension_size_type, dimension_size_type>
+      pixelRange(double low,
+                 double high)
+      {
+        const double first = std::max(std::floor(low), 0.0);
+        const double last = std::max(std::ceil(high), first);
+        return std::make_pair(static_cast<dimension_size_type>(first),
+                              static_cast<dimension_size_type>(last));
+      }
+
+      // Clear the pixels of a tile which are not set in the mask.
+      struct MaskVisitor : public boost::static_visitor<>
+      {
+        const RegionMask&  mask;
+        const PlaneRegion& tile;
+        const PlaneRegion& origin;
+
+        MaskVisitor(const RegionMask&  mask,
+                    const PlaneRegion& tile,
+                    const PlaneRegion& origin):
+          mask(mask),
+          tile(tile),
+          origin(origin)
+        {}
+
+        template<typename T>
+        void
+        operator()(T& buf)
+        {
+          typedef typename T::element_type::value_type value_type;
+
+          const dimension_size_type subchannels = buf->shape()[DIM_SUBCHANNEL];
+          PixelBufferBase::indices_type idx;
+          std::fill(idx.begin(), idx.end(), 0);
+          for (dimension_size_type y = tile.y; y < tile.y + tile.h; ++y)
+            for (dimension_size_type x = tile.x; x < tile.x + tile.w; ++x)
+              {
+                if (mask.contains(x, y))
+                  continue;
+                idx[DIM_SPATIAL_X] = static_cast<PixelBufferBase::index>(x - origin.x);
+                idx[DIM_SPATIAL_Y] = static_cast<PixelBufferBase::index>(y - origin.y);
+                for (dimension_size_type s = 0; s < subchannels; ++s)
+                  {
+                    idx[DIM_SUBCHANNEL] = static_cast<PixelBufferBase::index>(s);
+                    buf->at(idx) = value_type();
+                  }
+              }
+        }
+      };
+
+      void
+      checkPlane(const FormatReader& reader,
+                 dimension_size_type plane)
+      {
+        if (plane >= reader.getImageCount())
+          {
+            boost::format fmt("Invalid plane %1% (series has %2% planes)");
+            fmt % plane % reader.getImageCount();
+            throw std::logic_error(fmt.str());
+          }
+      }
+
+    }
+
+    RegionMask::RegionMask():
+      bounds(),
+      bits()
+    {
+    }
+
+    RegionMask::RegionMask(const PlaneRegion& region):
+      bounds(region),
+      bits(region.area(), true)
+    {
+    }
+
+    RegionMask::RegionMask(const PlaneRegion&       bounds,
+                           const std::vector<bool>& bits):
+      bounds(bounds),
+      bits(bits)
+    {
+      if (bits.size() != bounds.area())
+        {
+          boost::format fmt("Mask size %1% does not match region %2%x%3%");
+          fmt % bits.size() % bounds.w % bounds.h;
+          throw std::logic_error(fmt.str());
+        }
+    }
+
+    RegionMask
+    RegionMask::fromEllipse(double x,
+                            double y,
+                            double radiusx,
+                            double radiusy)
+    {
+      if (!(radiusx > 0.0 && radiusy > 0.0))
+        return RegionMask();
+
+      const auto xr = pixelRange(x - radiusx, x + radiusx);
+      const auto yr = pixelRange(y - radiusy, y + radiusy);
+      PlaneRegion bounds(xr.first, yr.first, xr.second - xr.first, yr.second - yr.first);
+      std::vector<bool> bits(bounds.area(), false);
+
+      for (dimension_size_type py = 0; py < bounds.h; ++py)
+        {
+          const double dy = (static_cast<double>(bounds.y + py) + 0.5 - y) / radiusy;
+          for (dimension_size_type px = 0; px < bounds.w; ++px)
+            {
+              const double dx = (static_cast<double>(bounds.x + px) + 0.5 - x) / radiusx;
+              if (dx * dx + dy * dy <= 1.0)
+                bits[py * bounds.w + px] = true;
+            }
+        }
+
+      return RegionMask(bounds, bits);
+    }
+
+    RegionMask
+    RegionMask::fromPolygon(const std::vector<point_type>& points)
+    {
+      if (points.size() < 3U)
+        return RegionMask();
+
+      double minx = points.front().first, maxx = minx;
+      double miny = points.front().second, maxy = miny;
+      for (const auto& p : points)
+        {
+          minx = std::min(minx, p.first);
+          maxx = std::max(maxx, p.first);
+          miny = std::min(miny, p.second);
+          maxy = std::max(maxy, p.second);
+        }
+
+      const auto xr = pixelRange(minx, maxx);
+      const auto yr = pixelRange(miny, maxy);
+      PlaneRegion bounds(xr.first, yr.first, xr.second - xr.first, yr.second - yr.first);
+      std::vector<bool> bits(bounds.area(), false);
+
+      // Fill between pairs of edge crossings at each row centre.
+      std::vector<double> crossings;
+      for (dimension_size_type py = 0; py < bounds.h; ++py)
+        {
+          const double cy = static_cast<double>(bounds.y + py) + 0.5;
+          crossings.clear();
+          for (std::vector<point_type>::size_type i = 0; i < points.size(); ++i)
+            {
+              const point_type& a = points[i];
+              const point_type& b = points[(i + 1U) % points.size()];
+              if ((a.second <= cy) != (b.second <= cy))
+                crossings.push_back(a.first + (cy - a.second) * (b.first - a.first) / (b.second - a.second));
+            }
+          std::sort(crossings.begin(), crossings.end());
+
+          for (std::vector<double>::size_type i = 0; i + 1U < crossings.size(); i += 2U)
+            {
+              // Pixels with centres in [start, end).
+              const double first = std::max(std::ceil(crossings[i] - 0.5), static_cast<double>(bounds.x));
+              const double last = std::min(std::ceil(crossings[i + 1U] - 0.5),
+                                           static_cast<double>(bounds.x + bounds.w));
+              for (double px = first; px < last; px += 1.0)
+                bits[py * bounds.w + (static_cast<dimension_size_type>(px) - bounds.x)] = true;
+            }
+        }
+
+      return RegionMask(bounds, bits);
+    }
+
+    RegionMask
+    RegionMask::fromPolygon(const std::string& points)
+    {
+      std::vector<point_type> vertices;
+      std::istringstream is(points);
+      std::string pair;
+      while (is >> pair)
+        {
+          std::istringstream ps(pair);
+          point_type p;
+          char sep = '\0';
+          if (!(ps >> p.first >> sep >> p.second) || sep != ',' || !ps.eof())
+            {
+              boost::format fmt("Invalid polygon point ‘%1%’");
+              fmt % pair;
+              throw std::logic_error(fmt.str());
+            }
+          vertices.push_back(p);
+        }
+      return fromPolygon(vertices);
+    }
+
+    bool
+    RegionMask::contains(dimension_size_type x,
+                         dimension_size_type y) const
+    {
+      if (x < bounds.x || y < bounds.y ||
+          x >= bounds.x + bounds.w || y >= bounds.y + bounds.h)
+        return false;
+      return bits[(y - bounds.y) * bounds.w + (x - bounds.x)];
+    }
+
+    bool
+    RegionMask::intersects(const PlaneRegion& region) const
+    {
+      const PlaneRegion r = region & bounds;
+      for (dimension_size_type y = r.y; y < r.y + r.h; ++y)
+        {
+          const dimension_size_type row = (y - bounds.y) * bounds.w + (r.x - bounds.x);
+          for (dimension_size_type x = 0; x < r.w; ++x)
+            if (bits[row + x])
+              return true;
+        }
+      return false;
+    }
+
+    dimension_size_type
+    RegionMask::area() const
+    {
+      return static_cast<dimension_size_type>(std::count(bits.begin(), bits.end(), true));
+    }
+
+    std::vector<PlaneRegion>
+    getMaskTiles(const FormatReader& reader,
+                 const RegionMask&   mask)
+    {
+      std::vector<PlaneRegion> tiles;
+
+      const PlaneRegion region = mask.getBounds() & PlaneRegion(0, 0, reader.getSizeX(), reader.getSizeY());
+      if (!region.area())
+        return tiles;
+
+      const dimension_size_type tw = std::max(reader.getOptimalTileWidth(), static_cast<dimension_size_type>(1U));
+      const dimension_size_type th = std::max(reader.getOptimalTileHeight(), static_cast<dimension_size_type>(1U));
+
+      for (dimension_size_type ty = (region.y / th) * th; ty < region.y + region.h; ty += th)
+        for (dimension_size_type tx = (region.x / tw) * tw; tx < region.x + region.w; tx += tw)
+          {
+            PlaneRegion tile = PlaneRegion(tx, ty, tw, th) & region;
+            if (tile.area() && mask.intersects(tile))
+              tiles.push_back(tile);
+          }
+
+      return tiles;
+    }
+
+    std::vector<MaskedTile>
+    readMaskedTiles(const FormatReader& reader,
+                    dimension_size_type plane,
+                    const RegionMask&   mask)
+    {
+      checkPlane(reader, plane);
+
+      const std::vector<PlaneRegion> regions(getMaskTiles(reader, mask));
+      std::vector<MaskedTile> tiles(regions.size());
+      for (std::vector<PlaneRegion>::size_type i = 0; i < regions.size(); ++i)
+        {
+          const PlaneRegion& r(regions[i]);
+          tiles[i].region = r;
+          reader.openBytes(plane, tiles[i].buffer, r.x, r.y, r.w, r.h);
+        }
+
+      return tiles;
+    }
+
+    PlaneRegion
+    readMasked(const FormatReader& reader,
+               dimension_size_type plane,
+               const RegionMask&   mask,
+               VariantPixelBuffer& dest)
+    {
+      checkPlane(reader, plane);
+
+      const PlaneRegion region = mask.getBounds() & PlaneRegion(0, 0, reader.getSizeX(), reader.getSizeY());
+      if (!region.area())
+        {
+          boost::format fmt("Mask %1%x%2% at %3%,%4% does not intersect image size %5%x%6%");
+          fmt % mask.getBounds().w % mask.getBounds().h % mask.getBounds().x % mask.getBounds().y
+            % reader.getSizeX() % reader.getSizeY();
+          throw std::logic_error(fmt.str());
+        }
+
+      // Zero-initialised, so that unread tiles are clear.
+      std::array<VariantPixelBuffer::size_type, PixelBufferBase::dimensions> shape;
+      std::fill(shape.begin(), shape.end(), 1U);
+      shape[DIM_SPATIAL_X] = region.w;
+      shape[DIM_SPATIAL_Y] = region.h;
+      shape[DIM_SUBCHANNEL] = reader.getRGBChannelCount(reader.getZCTCoords(plane)[1]);
+      dest.setBuffer(shape, reader.getPixelType(), dest.storage_order());
+
+      VariantPixelBuffer buf;
+      for (const auto& tile : getMaskTiles(reader, mask))
+        {
+          reader.openBytes(plane, buf, tile.x, tile.y, tile.w, tile.h);
+
+          VariantPixelBuffer::indices_type sidx, didx;
+          std::fill(sidx.begin(), sidx.end(), 0);
+          std::fill(didx.begin(), didx.end(), 0);
+          didx[DIM_SPATIAL_X] = static_cast<VariantPixelBuffer::indices_type::value_type>(tile.x - region.x);
+          didx[DIM_SPATIAL_Y] = static_cast<VariantPixelBuffer::indices_type::value_type>(tile.y - region.y);
+          region_shape_type tshape;
+          std::copy(buf.shape(), buf.shape() + PixelBufferBase::dimensions, tshape.begin());
+          copyRegion(buf, sidx, dest, didx, tshape);
+
+          MaskVisitor v(mask, tile, region);
+          boost::apply_visitor(v, dest.vbuffer());
+        }
+
+      return region;
+    }
+
+  }
+}
@@ -0,0 +1,257 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#ifndef OME_FILES_REGIONMASK_H
+#define OME_FILES_REGIONMASK_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <ome/files/PlaneRegion.h>
+#include <ome/files/Types.h>
+#include <ome/files/VariantPixelBuffer.h>
+
+namespace ome
+{
+  namespace files
+  {
+
+    class FormatReader;
+
+    /**
+     * Binary mask of a region of a plane.
+     *
+     * The mask is a bitmap covering a bounding region of the plane,
+     * stored in row-major order.  It may be constructed directly
+     * from a bitmap, such as the BinData of an OME-XML @c Mask ROI
+     * shape, or by rasterising a rectangle, ellipse or polygon
+     * shape.  Shapes are rasterised by sampling pixel centres.
+     */
+    class RegionMask
+    {
+    public:
+      /// A point in plane coordinates.
+      typedef std::pair<double, double> point_type;
+
+      /// Constructor (empty mask).
+      RegionMask();
+
+      /**
+       * Construct from a region.
+       *
+       * All pixels in the region are set.
+       *
+       * @param region the masked region.
+       */
+      explicit
+      RegionMask(const PlaneRegion& region);
+
+      /**
+       * Construct from a bitmap.
+       *
+       * @param bounds the region covered by the bitmap.
+       * @param bits the bitmap, in row-major order.
+       * @throws std::logic_error if the bitmap size does not match
+       * the area of the bounds.
+       */
+      RegionMask(const PlaneRegion&       bounds,
+                 const std::vector<bool>& bits);
+
+      /**
+       * Rasterise an ellipse.
+       *
+       * @param x the centre @c X coordinate.
+       * @param y the centre @c Y coordinate.
+       * @param radiusx the @c X radius.
+       * @param radiusy the @c Y radius.
+       * @returns the mask.
+       */
+      static RegionMask
+      fromEllipse(double x,
+                  double y,
+                  double radiusx,
+                  double radiusy);
+
+      /**
+       * Rasterise a polygon.
+       *
+       * The polygon is closed, and filled using the even-odd rule.
+       * Parts of the polygon with negative coordinates are not
+       * included in the mask.
+       *
+       * @param points the polygon vertices.
+       * @returns the mask.
+       */
+      static RegionMask
+      fromPolygon(const std::vector<point_type>& points);
+
+      /**
+       * Rasterise a polygon from an OME-XML point list.
+       *
+       * @param points the points of a @c Polygon ROI shape, as
+       * whitespace-separated @c x,y pairs.
+       * @returns the mask.
+       * @throws std::logic_error if the point list is invalid.
+       */
+      static RegionMask
+      fromPolygon(const std::string& points);
+
+      /**
+       * Get the bounding region of the mask.
+       *
+       * @returns the bounds.
+       */
+      const PlaneRegion&
+      getBounds() const
+      {
+        return bounds;
+      }
+
+      /**
+       * Check if a pixel is set.
+       *
+       * @param x the @c X coordinate.
+       * @param y the @c Y coordinate.
+       * @returns @c true if set, @c false if unset or outside the
+       * bounds.
+       */
+      bool
+      contains(dimension_size_type x,
+               dimension_size_type y) const;
+
+      /**
+       * Check if any pixel within a region is set.
+       *
+       * @param region the region to check.
+       * @returns @c true if intersecting, @c false otherwise.
+       */
+      bool
+      intersects(const PlaneRegion& region) const;
+
+      /**
+       * Get the number of set pixels.
+       *
+       * @returns the area.
+       */
+      dimension_size_type
+      area() const;
+
+    private:
+      /// Bounding region.
+      PlaneRegion bounds;
+      /// Bitmap of the bounding region.
+      std::vector<bool> bits;
+    };
+
+    /// A tile read for a region mask.
+    struct MaskedTile
+    {
+      /// The region of the plane read.
+      PlaneRegion        region;
+      /// The pixel data of the region.
+      VariantPixelBuffer buffer;
+    };
+
+    /**
+     * Get the tiles intersecting a mask.
+     *
+     * The tiles are aligned to the optimal tile size of @p reader,
+     * and clipped to the bounds of the mask and the image.  Tiles
+     * within the bounds of the mask but containing no set pixels are
+     * excluded.
+     *
+     * @param reader the reader to use.
+     * @param mask the mask.
+     * @returns the tile regions, in row-major order.
+     */
+    std::vector<PlaneRegion>
+    getMaskTiles(const FormatReader& reader,
+                 const RegionMask&   mask);
+
+    /**
+     * Read the tiles intersecting a mask.
+     *
+     * Only the tiles returned by getMaskTiles() are read, so for a
+     * mask covering a small part of a large plane most of the plane
+     * is not decoded.  The pixel data of each tile is not masked.
+     *
+     * @param reader the reader to use.
+     * @param plane the plane index within the current series.
+     * @param mask the mask.
+     * @returns the tiles, in row-major order.
+     * @throws std::logic_error if the plane is invalid.
+     */
+    std::vector<MaskedTile>
+    readMaskedTiles(const FormatReader& reader,
+                    dimension_size_type plane,
+                    const RegionMask&   mask);
+
+    /**
+     * Read the pixels within a mask.
+     *
+     * The destination is the bounds of the mask clipped to the
+     * image.  Only the tiles intersecting the mask are read; pixels
+     * which are not set in the mask are zero.  If the destination
+     * buffer is not of the correct size and pixel type, it will be
+     * reset to the correct size and type, retaining its storage
+     * order.
+     *
+     * @param reader the reader to use.
+     * @param plane the plane index within the current series.
+     * @param mask the mask.
+     * @param dest the destination pixel buffer.
+     * @returns the region of the plane covered by @p dest.
+     * @throws std::logic_error if the plane is invalid, or the mask
+     * does not intersect the image.
+     */
+    PlaneRegion
+    readMasked(const FormatReader& reader,
+               dimension_size_type plane,
+               const RegionMask&   mask,
+               VariantPixelBuffer& dest);
+
+  }
+}
+
+#endif // OME_FILES_REGIONMASK_H
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
@@ -0,0 +1,822 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+
+#include <boost/format.hpp>
+
+#include <ome/files/config-internal.h>
+#include <ome/files/SharedMemoryTileCache.h>
+
+#ifdef OME_HAVE_SHM_OPEN
+# include <cerrno>
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif // OME_HAVE_SHM_OPEN
+
+namespace ome
+{
+  namespace files
+  {
+
+    namespace
+    {
+
+#ifdef OME_HAVE_SHM_OPEN
+      static_assert(ATOMIC_LLONG_LOCK_FREE == 2,
+                    "Shared memory tile cache requires lock-free 64-bit atomics");
+
+      /// Segment magic number ("OMETILE" and layout version 1).
+      const uint64_t segment_magic = 0x4F4D4554494C4501ULL;
+
+      /// Number of slots searched for each key.
+      const uint64_t probe_window = 8U;
+
+      /// Identity of a file.
+      struct FileIdentity
+      {
+        /// Device, or zero for names which are not files.
+        uint64_t device;
+        /// Inode, or a hash of the name for names which are not files.
+        uint64_t inode;
+        /// File size.
+        uint64_t size;
+        /// Modification time (ns).
+        uint64_t mtime;
+
+        bool
+        operator== (const FileIdentity& rhs) const
+        {
+          return device == rhs.device && inode == rhs.inode &&
+            size == rhs.size && mtime == rhs.mtime;
+        }
+      };
+
+      // Get the identity of a file.
+      FileIdentity
+      fileIdentity(const std::string& file)
+      {
+        FileIdentity id = {0U, 0U, 0U, 0U};
+        struct stat st;
+        if (::stat(file.c_str(), &st) == 0)
+          {
+            id.device = static_cast<uint64_t>(st.st_dev);
+            id.inode = static_cast<uint64_t>(st.st_ino);
+            id.size = static_cast<uint64_t>(st.st_size);
+#if defined(__APPLE__)
+            id.mtime = (static_cast<uint64_t>(st.st_mtimespec.tv_sec) * 1000000000U) +
+              static_cast<uint64_t>(st.st_mtimespec.tv_nsec);
+#else
+            id.mtime = (static_cast<uint64_t>(st.st_mtim.tv_sec) * 1000000000U) +
+              static_cast<uint64_t>(st.st_mtim.tv_nsec);
+#endif
+          }
+        else
+          id.inode = static_cast<uint64_t>(std::hash<std::string>()(file));
+        return id;
+      }
+
+      // Mix a value into a hash (splitmix64 finaliser).
+      uint64_t
+      mix(uint64_t hash,
+          uint64_t value)
+      {
+        uint64_t z = hash + value + 0x9E3779B97F4A7C15ULL;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+      }
+
+      /// Segment header.
+      struct SegmentHeader
+      {
+        /// Magic number; stored last by the creating process.
+        std::atomic<uint64_t> magic;
+        /// Number of slots.
+        uint64_t slotcount;
+        /// Maximum tile size per slot (bytes).
+        uint64_t slotsize;
+        /// Distance between slots (bytes).
+        uint64_t slotstride;
+        /// Access clock, for least recently used replacement.
+        std::atomic<uint64_t> clock;
+        /// Number of cached tiles.
+        std::atomic<uint64_t> count;
+        /// Total size of cached tiles (bytes).
+        std::atomic<uint64_t> bytes;
+      };
+
+      /// Slot header, followed by the tile data.
+      struct SlotHeader
+      {
+        /// Sequence number; odd while the slot is being written.
+        std::atomic<uint64_t> seq;
+        /// File device.
+        std::atomic<uint64_t> device;
+        /// File inode.
+        std::atomic<uint64_t> inode;
+        /// File size.
+        std::atomic<uint64_t> filesize;
+        /// File modification time.
+        std::atomic<uint64_t> mtime;
+        /// Directory offset.
+        std::atomic<uint64_t> offset;
+        /// Tile index.
+        std::atomic<uint64_t> tile;
+        /// Tile size (bytes), or zero if empty.
+        std::atomic<uint64_t> size;
+        /// Access time from the segment clock.
+        std::atomic<uint64_t> stamp;
+      };
+
+      // Round up to a multiple of the tile buffer alignment.
+      uint64_t
+      aligned(uint64_t size)
+      {
+        return (size + TileBuffer::alignment - 1U) / TileBuffer::alignment * TileBuffer::alignment;
+      }
+
+      const uint64_t header_size = aligned(sizeof(SegmentHeader));
+      const uint64_t slot_header_size = aligned(sizeof(SlotHeader));
+#endif // OME_HAVE_SHM_OPEN
+
+    }
+
+    /**
+     * Internal implementation details of SharedMemoryTileCache.
+     */
+    class SharedMemoryTileCache::Impl
+    {
+    public:
+      /// Segment name.
+      std::string name;
+#ifdef OME_HAVE_SHM_OPEN
+      /// Mapped segment.
+      void *segment;
+      /// Mapped size.
+      std::size_t length;
+      /// Segment header.
+      SegmentHeader *header;
+      /// Start of the first slot.
+      char *slots;
+      /// Identity of each file used, to avoid a stat per tile.
+      std::unordered_map<std::string, FileIdentity> identities;
+      /// Lock for identities.
+      std::mutex identityMutex;
+
+      /**
+       * Constructor.
+       *
+       * @param name the segment name.
+       * @param maxsize the total size of the slots (bytes).
+       * @param slotsize the maximum size of a cached tile (bytes).
+       */
+      Impl(const std::string&  name,
+           dimension_size_type maxsize,
+           dimension_size_type slotsize):
+        name(name),
+        segment(MAP_FAILED),
+        length(0U),
+        header(nullptr),
+        slots(nullptr),
+        identities(),
+        identityMutex()
+      {
+        if (!slotsize || maxsize < slotsize)
+          {
+            boost::format fmt("Invalid shared memory tile cache size %1% for slot size %2%");
+            fmt % maxsize % slotsize;
+            throw std::logic_error(fmt.str());
+          }
+
+        bool created = true;
+        int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (fd < 0 && errno == EEXIST)
+          {
+            created = false;
+            fd = ::shm_open(name.c_str(), O_RDWR, 0600);
+          }
+        if (fd < 0)
+          throw std::system_error(errno, std::generic_category(),
+                                  "Failed to open shared memory segment " + name);
+
+        try
+          {
+            if (created)
+              {
+                const uint64_t count = maxsize / slotsize;
+                const uint64_t stride = slot_header_size + aligned(slotsize);
+                length = static_cast<std::size_t>(header_size + (count * stride));
+                if (::ftruncate(fd, static_cast<off_t>(length)) < 0)
+                  throw std::system_error(errno, std::generic_category(),
+                                          "Failed to size shared memory segment " + name);
+                map(fd);
+
+                // The segment is zero filled, so all slots are empty.
+                header->slotcount = count;
+                header->slotsize = slotsize;
+                header->slotstride = stride;
+                header->magic.store(segment_magic, std::memory_order_release);
+              }
+            else
+              {
+                // Wait briefly for the creating process to size and
+                // initialise the segment.
+                for (unsigned int attempt = 0; ; ++attempt)
+                  {
+                    struct stat st;
+                    if (::fstat(fd, &st) < 0)
+                      throw std::system_error(errno, std::generic_category(),
+                                              "Failed to query shared memory segment " + name);
+                    if (static_cast<uint64_t>(st.st_size) >= header_size)
+                      {
+                        length = static_cast<std::size_t>(st.st_size);
+                        map(fd);
+                        if (header->magic.load(std::memory_order_acquire) == segment_magic)
+                          break;
+                        unmap();
+                      }
+                    if (attempt == 1000U)
+                      {
+                        boost::format fmt("Shared memory segment %1% is not a tile cache");
+                        fmt % name;
+                        throw std::runtime_error(fmt.str());
+                      }
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                  }
+
+                if (!header->slotcount || !header->slotsize ||
+                    header->slotstride < slot_header_size + header->slotsize ||
+                    header_size + (header->slotcount * header->slotstride) > length)
+                  {
+                    boost::format fmt("Shared memory segment %1% is truncated or invalid");
+                    fmt % name;
+                    throw std::runtime_error(fmt.str());
+                  }
+              }
+          }
+        catch (...)
+          {
+            unmap();
+            ::close(fd);
+            throw;
+          }
+
+        // The mapping remains valid once the descriptor is closed.
+        ::close(fd);
+      }
+
+      /// Destructor.
+      ~Impl()
+      {
+        unmap();
+      }
+
+      /**
+       * Map the segment.
+       *
+       * @param fd the segment file descriptor.
+       */
+      void
+      map(int fd)
+      {
+        segment = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (segment == MAP_FAILED)
+          throw std::system_error(errno, std::generic_category(),
+                                  "Failed to map shared memory segment " + name);
+        header = static_cast<SegmentHeader *>(segment);
+        slots = static_cast<char *>(segment) + header_size;
+      }
+
+      /// Unmap the segment, if mapped.
+      void
+      unmap()
+      {
+        if (segment != MAP_FAILED)
+          ::munmap(segment, length);
+        segment = MAP_FAILED;
+        header = nullptr;
+        slots = nullptr;
+      }
+
+      /**
+       * Get the identity of a file.
+       *
+       * The identity is found the first time the file is used, and
+       * kept until it is refreshed or forgotten.
+       *
+       * @param file the file name.
+       * @param refresh find the identity again, if the file was
+       * reopened.
+       * @returns the file identity.
+       */
+      FileIdentity
+      identity(const std::string& file,
+               bool               refresh = false)
+      {
+        {
+          std::lock_guard<std::mutex> lock(identityMutex);
+          auto i = identities.find(file);
+          if (i != identities.end() && !refresh)
+            return i->second;
+        }
+
+        const FileIdentity id(fileIdentity(file));
+        std::lock_guard<std::mutex> lock(identityMutex);
+        identities[file] = id;
+        return id;
+      }
+
+      /**
+       * Forget the identity of a file.
+       *
+       * @param file the file name.
+       * @returns the identity last found for the file.
+       */
+      FileIdentity
+      forget(const std::string& file)
+      {
+        {
+          std::lock_guard<std::mutex> lock(identityMutex);
+          auto i = identities.find(file);
+          if (i != identities.end())
+            {
+              const FileIdentity id(i->second);
+              identities.erase(i);
+              return id;
+            }
+        }
+        return fileIdentity(file);
+      }
+
+      /**
+       * Get a slot header.
+       *
+       * @param index the slot index.
+       * @returns the slot header.
+       */
+      SlotHeader&
+      slot(uint64_t index) const
+      {
+        return *reinterpret_cast<SlotHeader *>(slots + (index * header->slotstride));
+      }
+
+      /**
+       * Get the tile data of a slot.
+       *
+       * @param index the slot index.
+       * @returns the tile data.
+       */
+      uint8_t *
+      data(uint64_t index) const
+      {
+        return reinterpret_cast<uint8_t *>(slots + (index * header->slotstride) + slot_header_size);
+      }
+
+      /**
+       * Get the first slot of the probe window for a key.
+       *
+       * @param id the file identity.
+       * @param offset the directory offset.
+       * @param tile the tile index.
+       * @returns the slot index.
+       */
+      uint64_t
+      firstSlot(const FileIdentity& id,
+                uint64_t            offset,
+                uint64_t            tile) const
+      {
+        uint64_t hash = mix(mix(mix(mix(mix(0U, id.device), id.inode), id.size), id.mtime), offset);
+        return mix(hash, tile) % header->slotcount;
+      }
+
+      /**
+       * Check if a slot holds a key.
+       *
+       * @param s the slot.
+       * @param id the file identity.
+       * @param offset the directory offset.
+       * @param tile the tile index.
+       * @returns @c true if the slot holds the key.
+       */
+      static
+      bool
+      matches(const SlotHeader&   s,
+              const FileIdentity& id,
+              uint64_t            offset,
+              uint64_t            tile)
+      {
+        return s.size.load(std::memory_order_relaxed) &&
+          s.tile.load(std::memory_order_relaxed) == tile &&
+          s.offset.load(std::memory_order_relaxed) == offset &&
+          s.inode.load(std::memory_order_relaxed) == id.inode &&
+          s.device.load(std::memory_order_relaxed) == id.device &&
+          s.filesize.load(std::memory_order_relaxed) == id.size &&
+          s.mtime.load(std::memory_order_relaxed) == id.mtime;
+      }
+
+      /**
+       * Check if a slot holds a tile of a file.
+       *
+       * @param s the slot.
+       * @param id the file identity.
+       * @returns @c true if the slot holds a tile of the file.
+       */
+      static
+      bool
+      matches(const SlotHeader&   s,
+              const FileIdentity& id)
+      {
+        return s.size.load(std::memory_order_relaxed) &&
+          s.inode.load(std::memory_order_relaxed) == id.inode &&
+          s.device.load(std::memory_order_relaxed) == id.device &&
+          s.filesize.load(std::memory_order_relaxed) == id.size &&
+          s.mtime.load(std::memory_order_relaxed) == id.mtime;
+      }
+
+      /**
+       * Claim a slot for writing.
+       *
+       * @param s the slot.
+       * @param seq the expected sequence number, which must be even.
+       * @returns @c true if claimed, or @c false if the slot was
+       * changed by another process.
+       */
+      static
+      bool
+      claim(SlotHeader& s,
+            uint64_t    seq)
+      {
+        if (!s.seq.compare_exchange_strong(seq, seq + 1U, std::memory_order_acquire))
+          return false;
+        std::atomic_thread_fence(std::memory_order_release);
+        return true;
+      }
+
+      /**
+       * Empty a claimed slot and release it.
+       *
+       * @param s the slot.
+       * @param seq the sequence number before the slot was claimed.
+       */
+      void
+      release(SlotHeader& s,
+              uint64_t    seq)
+      {
+        const uint64_t size = s.size.load(std::memory_order_relaxed);
+        if (size)
+          {
+            s.size.store(0U, std::memory_order_relaxed);
+            header->count.fetch_sub(1U, std::memory_order_relaxed);
+            header->bytes.fetch_sub(size, std::memory_order_relaxed);
+          }
+        s.seq.store(seq + 2U, std::memory_order_release);
+      }
+#endif // OME_HAVE_SHM_OPEN
+    };
+
+    SharedMemoryTileCache::SharedMemoryTileCache(const std::string&  name,
+                                                 dimension_size_type maxsize,
+                                                 dimension_size_type slotsize):
+      DecodedTileCache(0U),
+      impl()
+    {
+#ifdef OME_HAVE_SHM_OPEN
+      impl = std::make_unique<Impl>(name, maxsize, slotsize);
+#else // ! OME_HAVE_SHM_OPEN
+      static_cast<void>(maxsize);
+      static_cast<void>(slotsize);
+      boost::format fmt("Failed to open shared memory segment %1%: shared memory is not supported on this platform");
+      fmt % name;
+      throw std::runtime_error(fmt.str());
+#endif // OME_HAVE_SHM_OPEN
+    }
+
+    SharedMemoryTileCache::~SharedMemoryTileCache()
+    {
+    }
+
+    bool
+    SharedMemoryTileCache::remove(const std::string& name)
+    {
+#ifdef OME_HAVE_SHM_OPEN
+      if (::shm_unlink(name.c_str()) == 0)
+        return true;
+      if (errno != ENOENT)
+        throw std::system_error(errno, std::generic_category(),
+                                "Failed to remove shared memory segment " + name);
+#else // ! OME_HAVE_SHM_OPEN
+      static_cast<void>(name);
+#endif // OME_HAVE_SHM_OPEN
+      return false;
+    }
+
+    const std::string&
+    SharedMemoryTileCache::getName() const
+    {
+      return impl->name;
+    }
+
+#ifdef OME_HAVE_SHM_OPEN
+    dimension_size_type
+    SharedMemoryTileCache::getSlotSize() const
+    {
+      return impl->header->slotsize;
+    }
+
+    dimension_size_type
+    SharedMemoryTileCache::getSlotCount() const
+    {
+      return impl->header->slotcount;
+    }
+
+    void
+    SharedMemoryTileCache::insert(const key_type&   key,
+                                  const value_type& tilebuffer)
+    {
+      SegmentHeader& header(*impl->header);
+      if (!tilebuffer || !tilebuffer->size() || tilebuffer->size() > header.slotsize)
+        return;
+
+      const FileIdentity id(impl->identity(std::get<0>(key)));
+      const uint64_t offset = std::get<1>(key);
+      const uint64_t tile = std::get<2>(key);
+      const uint64_t first = impl->firstSlot(id, offset, tile);
+      const uint64_t window = std::min(probe_window, static_cast<uint64_t>(header.slotcount));
+
+      // Replace the tile if already present, otherwise use an empty
+      // slot, otherwise the least recently used slot in the window.
+      uint64_t victim = header.slotcount;
+      uint64_t victimseq = 0U;
+      uint64_t oldest = std::numeric_limits<uint64_t>::max();
+      for (uint64_t i = 0; i < window; ++i)
+        {
+          const uint64_t index = (first + i) % header.slotcount;
+          SlotHeader& s(impl->slot(index));
+          const uint64_t seq = s.seq.load(std::memory_order_acquire);
+          if (seq & 1U)
+            continue;
+          if (Impl::matches(s, id, offset, tile))
+            {
+              victim = index;
+              victimseq = seq;
+              break;
+            }
+          const uint64_t stamp = s.size.load(std::memory_order_relaxed) ?
+            s.stamp.load(std::memory_order_relaxed) : 0U;
+          if (victim == header.slotcount || stamp < oldest)
+            {
+              victim = index;
+              victimseq = seq;
+              oldest = stamp;
+            }
+        }
+
+      // Another process is writing every slot, or claimed the victim
+      // first; the tile is not cached.
+      if (victim == header.slotcount)
+        return;
+      SlotHeader& s(impl->slot(victim));
+      if (!Impl::claim(s, victimseq))
+        return;
+
+      const uint64_t oldsize = s.size.load(std::memory_order_relaxed);
+      if (oldsize)
+        {
+          header.count.fetch_sub(1U, std::memory_order_relaxed);
+          header.bytes.fetch_sub(oldsize, std::memory_order_relaxed);
+        }
+
+      s.device.store(id.device, std::memory_order_relaxed);
+      s.inode.store(id.inode, std::memory_order_relaxed);
+      s.filesize.store(id.size, std::memory_order_relaxed);
+      s.mtime.store(id.mtime, std::memory_order_relaxed);
+      s.offset.store(offset, std::memory_order_relaxed);
+      s.tile.store(tile, std::memory_order_relaxed);
+      s.size.store(tilebuffer->size(), std::memory_order_relaxed);
+      s.stamp.store(header.clock.fetch_add(1U, std::memory_order_relaxed) + 1U,
+                    std::memory_order_relaxed);
+      std::memcpy(impl->data(victim), tilebuffer->data(), tilebuffer->size());
+      s.seq.store(victimseq + 2U, std::memory_order_release);
+
+      header.count.fetch_add(1U, std::memory_order_relaxed);
+      header.bytes.fetch_add(tilebuffer->size(), std::memory_order_relaxed);
+    }
+
+    SharedMemoryTileCache::value_type
+    SharedMemoryTileCache::find(const key_type& key)
+    {
+      return DecodedTileCache::find(key);
+    }
+
+    SharedMemoryTileCache::value_type
+    SharedMemoryTileCache::find(const std::string&  file,
+                                uint64_t            offset,
+                                dimension_size_type tile)
+    {
+      SegmentHeader& header(*impl->header);
+      const FileIdentity id(impl->identity(file));
+      const uint64_t first = impl->firstSlot(id, offset, tile);
+      const uint64_t window = std::min(probe_window, static_cast<uint64_t>(header.slotcount));
+
+      for (uint64_t i = 0; i < window; ++i)
+        {
+          const uint64_t index = (first + i) % header.slotcount;
+          SlotHeader& s(impl->slot(index));
+          const uint64_t seq = s.seq.load(std::memory_order_acquire);
+          if ((seq & 1U) || !Impl::matches(s, id, offset, tile))
+            continue;
+
+          const uint64_t size = s.size.load(std::memory_order_relaxed);
+          if (size > header.slotsize)
+            continue;
+
+          // The copy races with any writer which claims the slot
+          // meanwhile; such a copy is detected by the changed
+          // sequence number and discarded.
+          std::shared_ptr<TileBuffer> found(std::make_shared<TileBuffer>(size));
+          std::memcpy(found->data(), impl->data(index), static_cast<std::size_t>(size));
+          std::atomic_thread_fence(std::memory_order_acquire);
+          if (s.seq.load(std::memory_order_relaxed) != seq)
+            return value_type();
+
+          s.stamp.store(header.clock.fetch_add(1U, std::memory_order_relaxed) + 1U,
+                        std::memory_order_relaxed);
+          return found;
+        }
+
+      return value_type();
+    }
+
+    void
+    SharedMemoryTileCache::openFile(const std::string& file)
+    {
+      impl->identity(file, true);
+    }
+
+    void
+    SharedMemoryTileCache::erase(const std::string& file)
+    {
+      // The tiles cached under the identity last used are removed,
+      // and the identity is found again when the file is next used.
+      const FileIdentity id(impl->forget(file));
+      for (uint64_t index = 0; index < impl->header->slotcount; ++index)
+        {
+          SlotHeader& s(impl->slot(index));
+          const uint64_t seq = s.seq.load(std::memory_order_acquire);
+          if (!(seq & 1U) && Impl::matches(s, id) && Impl::claim(s, seq))
+            impl->release(s, seq);
+        }
+    }
+
+    void
+    SharedMemoryTileCache::clear()
+    {
+      for (uint64_t index = 0; index < impl->header->slotcount; ++index)
+        {
+          SlotHeader& s(impl->slot(index));
+          const uint64_t seq = s.seq.load(std::memory_order_acquire);
+          if (!(seq & 1U) && s.size.load(std::memory_order_relaxed) && Impl::claim(s, seq))
+            impl->release(s, seq);
+        }
+    }
+
+    dimension_size_type
+    SharedMemoryTileCache::size() const
+    {
+      return impl->header->count.load(std::memory_order_relaxed);
+    }
+
+    dimension_size_type
+    SharedMemoryTileCache::byteSize() const
+    {
+      return impl->header->bytes.load(std::memory_order_relaxed);
+    }
+
+    dimension_size_type
+    SharedMemoryTileCache::getMaxByteSize() const
+    {
+      return impl->header->slotcount * impl->header->slotsize;
+    }
+#else // ! OME_HAVE_SHM_OPEN
+    // Never constructed without shared memory support.
+
+    dimension_size_type
+    SharedMemoryTileCache::getSlotSize() const
+    {
+      return 0U;
+    }
+
+    dimension_size_type
+    SharedMemoryTileCache::getSlotCount() const
+    {
+      return 0U;
+    }
+
+    void
+    SharedMemoryTileCache::insert(const key_type&   /* key */,
+                                  const value_type& /* tilebuffer */)
+    {
+    }
+
+    SharedMemoryTileCache::value_type
+    SharedMemoryTileCache::find(const key_type& /* key */)
+    {
+      return value_type();
+    }
+
+    SharedMemoryTileCache::value_type
+    SharedMemoryTileCache::find(const std::string&  /* file */,
+                                uint64_t            /* offset */,
+                                dimension_size_type /* tile */)
+    {
+      return value_type();
+    }
+
+    void
+    SharedMemoryTileCache::openFile(const std::string& /* file */)
+    {
+    }
+
+    void
+    SharedMemoryTileCache::erase(const std::string& /* file */)
+    {
+    }
+
+    void
+    SharedMemoryTileCache::clear()
+    {
+    }
+
+    dimension_size_type
+    SharedMemoryTileCache::size() const
+    {
+      return 0U;
+    }
+
+    dimension_size_type
+    SharedMemoryTileCache::byteSize() const
+    {
+      return 0U;
+    }
+
+    dimension_size_type
+    SharedMemoryTileCache::getMaxByteSize() const
+    {
+      return 0U;
+    }
+#endif // OME_HAVE_SHM_OPEN
+
+    void
+    SharedMemoryTileCache::setMaxByteSize(dimension_size_type /* maxsize */)
+    {
+    }
+
+  }
+}
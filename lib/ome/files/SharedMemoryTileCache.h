@@ -0,0 +1,233 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#ifndef OME_FILES_SHAREDMEMORYTILECACHE_H
+#define OME_FILES_SHAREDMEMORYTILECACHE_H
+
+#include <ome/files/DecodedTileCache.h>
+
+#include <memory>
+#include <string>
+
+namespace ome
+{
+  namespace files
+  {
+
+    /**
+     * Decoded tile cache in POSIX shared memory.
+     *
+     * The decoded tiles are held in a named shared memory segment,
+     * so that several processes, such as the workers of a
+     * pre-forked server, share a single decoded copy of each tile;
+     * a tile decoded by any process is found by all of them.  Each
+     * process opens the segment by name, or it may be created
+     * before the workers are forked.
+     *
+     * The segment holds a fixed number of slots of a fixed size,
+     * set by the process which creates it; tiles larger than the
+     * slot size are not cached.  Tiles are placed by a hash of
+     * their key within a small window of slots, replacing the
+     * least recently used tile of the window when full.
+     *
+     * Lookup takes no lock: each slot has a sequence number which
+     * is odd while the slot is being written, and a found tile is
+     * copied into a new TileBuffer and discarded if the sequence
+     * number changed during the copy.  Insertion claims a slot
+     * with an atomic compare and exchange, and is skipped if
+     * another process is writing the slot.  A process terminating
+     * while writing a slot leaves the slot unused.
+     *
+     * Tiles are keyed by the identity of the file (device, inode,
+     * size and modification time) rather than its name, so that
+     * processes opening the same file by different paths share
+     * its tiles, and tiles of a replaced file are not reused.
+     * Names which are not files are keyed by name.  The identity
+     * is found when the file is opened, or on first use, and kept
+     * by each cache object until the file is erased, so that
+     * lookups do not stat the file.
+     *
+     * The cache is not accounted to a MemoryBudget, since the
+     * memory is not owned by any one process, and its size may not
+     * be changed once created.  Shared memory is not available on
+     * all platforms; construction will fail with an exception if
+     * unsupported.
+     */
+    class SharedMemoryTileCache : public DecodedTileCache
+    {
+    private:
+      class Impl;
+      /// Private implementation details.
+      std::unique_ptr<Impl> impl;
+
+    public:
+      /**
+       * Constructor.
+       *
+       * The named segment is opened if it exists, in which case the
+       * size and slot size are those of the existing segment, or is
+       * otherwise created.
+       *
+       * @param name the shared memory segment name; this should
+       * start with a @c / and contain no other @c / characters.
+       * @param maxsize the total size of the slots (bytes).
+       * @param slotsize the maximum size of a cached tile (bytes).
+       * @throws std::runtime_error if the segment could not be
+       * created or opened, or if it is not a tile cache.
+       */
+      SharedMemoryTileCache(const std::string&  name,
+                            dimension_size_type maxsize = 256U * 1024U * 1024U,
+                            dimension_size_type slotsize = 1024U * 1024U);
+
+      /// Destructor.  The segment is unmapped, but not removed.
+      virtual ~SharedMemoryTileCache();
+
+      /**
+       * Remove a shared memory segment.
+       *
+       * The segment name is removed, and the memory is released
+       * once no process has it open.  Caches opened subsequently
+       * with the name will create a new segment.
+       *
+       * @param name the shared memory segment name.
+       * @returns @c true if removed, or @c false if it did not exist.
+       */
+      static
+      bool
+      remove(const std::string& name);
+
+      /**
+       * Get the shared memory segment name.
+       *
+       * @returns the segment name.
+       */
+      const std::string&
+      getName() const;
+
+      /**
+       * Get the maximum size of a cached tile.
+       *
+       * @returns the slot size (bytes).
+       */
+      dimension_size_type
+      getSlotSize() const;
+
+      /**
+       * Get the number of slots.
+       *
+       * @returns the slot count.
+       */
+      dimension_size_type
+      getSlotCount() const;
+
+      // Documented in superclass.
+      void
+      insert(const key_type&   key,
+             const value_type& tilebuffer);
+
+      // Documented in superclass.
+      value_type
+      find(const key_type& key);
+
+      // Documented in superclass.
+      value_type
+      find(const std::string&  file,
+           uint64_t            offset,
+           dimension_size_type tile);
+
+      // Documented in superclass.
+      void
+      openFile(const std::string& file);
+
+      // Documented in superclass.
+      void
+      erase(const std::string& file);
+
+      // Documented in superclass.
+      void
+      clear();
+
+      /**
+       * Get the number of cached tiles.
+       *
+       * This is the number of tiles cached by all processes.
+       *
+       * @returns the tile count.
+       */
+      dimension_size_type
+      size() const;
+
+      /**
+       * Get the total size of the cached tiles.
+       *
+       * This is the size of the tiles cached by all processes.
+       *
+       * @returns the size (bytes).
+       */
+      dimension_size_type
+      byteSize() const;
+
+      /**
+       * Set the maximum total size of the cached tiles.
+       *
+       * The size of a shared memory cache is fixed when it is
+       * created, so this has no effect.
+       *
+       * @param maxsize the maximum size (bytes).
+       */
+      void
+      setMaxByteSize(dimension_size_type maxsize);
+
+      /**
+       * Get the maximum total size of the cached tiles.
+       *
+       * @returns the total size of the slots (bytes).
+       */
+      dimension_size_type
+      getMaxByteSize() const;
+    };
+
+  }
+}
+
+#endif // OME_FILES_SHAREDMEMORYTILECACHE_H
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
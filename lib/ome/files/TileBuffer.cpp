@@ -35,25 +35,112 @@
  * #L%
  */
 
+#include <algorithm>
+#include <cstdlib>
 #include <cstring>
+#include <map>
+#include <mutex>
+#include <new>
+#include <vector>
 
+#include <ome/files/config-internal.h>
 #include <ome/files/TileBuffer.h>
 
+#ifdef OME_HAVE_MADV_HUGEPAGE
+# include <sys/mman.h>
+#endif // OME_HAVE_MADV_HUGEPAGE
+
+#ifdef _MSC_VER
+# include <malloc.h>
+#endif // _MSC_VER
+
+namespace
+{
+
+  using ome::files::dimension_size_type;
+
+  // Transparent huge page size.
+  const dimension_size_type hugepage_size = 2U * 1024U * 1024U;
+
+  // Allocate an aligned buffer.
+  uint8_t *
+  allocateAligned(dimension_size_type size,
+                  dimension_size_type alignment)
+  {
+    if (!size)
+      size = 1U;
+#if defined(_MSC_VER)
+    void *ptr = _aligned_malloc(size, alignment);
+    if (!ptr)
+      throw std::bad_alloc();
+#elif defined(OME_HAVE_POSIX_MEMALIGN)
+    void *ptr = 0;
+    if (posix_memalign(&ptr, alignment, size))
+      throw std::bad_alloc();
+#else
+    // Over-allocate, and store the original pointer immediately
+    // before the aligned block.
+    void *raw = std::malloc(size + alignment + sizeof(void *));
+    if (!raw)
+      throw std::bad_alloc();
+    uintptr_t start = reinterpret_cast<uintptr_t>(raw) + sizeof(void *);
+    void *ptr = reinterpret_cast<void *>((start + alignment - 1U) & ~(static_cast<uintptr_t>(alignment) - 1U));
+    static_cast<void **>(ptr)[-1] = raw;
+#endif
+    return static_cast<uint8_t *>(ptr);
+  }
+
+  // Free a buffer allocated with allocateAligned().
+  void
+  freeAligned(uint8_t *ptr)
+  {
+#if defined(_MSC_VER)
+    _aligned_free(ptr);
+#elif defined(OME_HAVE_POSIX_MEMALIGN)
+    std::free(ptr);
+#else
+    if (ptr)
+      std::free(reinterpret_cast<void **>(ptr)[-1]);
+#endif
+  }
+
+}
+
 namespace ome
 {
   namespace files
   {
 
-    TileBuffer::TileBuffer(dimension_size_type size):
+    const dimension_size_type TileBuffer::alignment;
+    const dimension_size_type TileBuffer::direct_io_alignment;
+
+    TileBuffer::TileBuffer(dimension_size_type size,
+                           bool                hugepages,
+                           dimension_size_type align):
       bufsize(size),
-      buf(new uint8_t[size])
+      buf()
     {
+      if (hugepages && size >= hugepage_size)
+        {
+          // Round up to whole huge pages so that the advice covers
+          // the entire buffer, and apply it before the pages are
+          // first touched.
+          dimension_size_type allocsize = ((size + hugepage_size - 1U) / hugepage_size) * hugepage_size;
+          buf = allocateAligned(allocsize, hugepage_size);
+#ifdef OME_HAVE_MADV_HUGEPAGE
+          // Advisory only; failure leaves normal pages in use.
+          madvise(buf, allocsize, MADV_HUGEPAGE);
+#endif // OME_HAVE_MADV_HUGEPAGE
+        }
+      else
+        buf = allocateAligned(size, std::max(align, alignment));
+
       std::memset(buf, 0, size);
     }
 
     TileBuffer::~TileBuffer()
     {
-      delete[] buf;
+      freeAligned(buf);
     }
 
     dimension_size_type
@@ -74,5 +161,134 @@ namespace ome
       return buf;
     }
 
+    /**
+     * Internal implementation details of TileBufferPool.
+     */
+    class TileBufferPool::Impl
+    {
+    public:
+      /// Mutex protecting the retained buffers.
+      std::mutex mutex;
+      /// Retained buffers, indexed by size.
+      std::map<dimension_size_type, std::vector<TileBuffer *>> buffers;
+      /// Total size of retained buffers.
+      dimension_size_type bytes;
+      /// Maximum total size of retained buffers.
+      dimension_size_type maxbytes;
+
+      /**
+       * Constructor.
+       *
+       * @param maxsize the maximum total size of retained buffers.
+       */
+      Impl(dimension_size_type maxsize):
+        mutex(),
+        buffers(),
+        bytes(0U),
+        maxbytes(maxsize)
+      {
+      }
+
+      /// Destructor.
+      ~Impl()
+      {
+        clear();
+      }
+
+      /**
+       * Retain a released buffer, or free it if the pool is full.
+       *
+       * @param buffer the buffer to retain.
+       */
+      void
+      release(TileBuffer *buffer)
+      {
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          if (bytes + buffer->size() <= maxbytes)
+            {
+              buffers[buffer->size()].push_back(buffer);
+              bytes += buffer->size();
+              return;
+            }
+        }
+        delete buffer;
+      }
+
+      /// Free all retained buffers.
+      void
+      clear()
+      {
+        std::map<dimension_size_type, std::vector<TileBuffer *>> freed;
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          freed.swap(buffers);
+          bytes = 0U;
+        }
+        for (auto& size : freed)
+          for (auto buffer : size.second)
+            delete buffer;
+      }
+    };
+
+    TileBufferPool::TileBufferPool(dimension_size_type maxsize):
+      impl(std::make_shared<Impl>(maxsize))
+    {
+    }
+
+    TileBufferPool::~TileBufferPool()
+    {
+    }
+
+    std::shared_ptr<TileBuffer>
+    TileBufferPool::get(dimension_size_type size)
+    {
+      TileBuffer *buffer = 0;
+      {
+        std::lock_guard<std::mutex> lock(impl->mutex);
+        auto i = impl->buffers.find(size);
+        if (i != impl->buffers.end() && !i->second.empty())
+          {
+            buffer = i->second.back();
+            i->second.pop_back();
+            impl->bytes -= size;
+          }
+      }
+
+      if (buffer)
+        std::memset(buffer->data(), 0, size);
+      else
+        buffer = new TileBuffer(size);
+
+      // Return the buffer to the pool when released.  The pool is
+      // referenced weakly, so that buffers may outlive it.
+      std::weak_ptr<Impl> pool(impl);
+      return std::shared_ptr<TileBuffer>(buffer,
+                                         [pool](TileBuffer *released)
+                                         {
+                                           std::shared_ptr<Impl> p(pool.lock());
+                                           if (p)
+                                             p->release(released);
+                                           else
+                                             delete released;
+                                         });
+    }
+
+    dimension_size_type
+    TileBufferPool::size() const
+    {
+      std::lock_guard<std::mutex> lock(impl->mutex);
+      dimension_size_type count = 0U;
+      for (const auto& i : impl->buffers)
+        count += i.second.size();
+      return count;
+    }
+
+    void
+    TileBufferPool::clear()
+    {
+      impl->clear();
+    }
+
   }
 }
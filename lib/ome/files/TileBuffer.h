@@ -40,6 +40,8 @@
 
 #include <ome/files/Types.h>
 
+#include <memory>
+
 #include <ome/xml/model/enums/PixelType.h>
 
 namespace ome
@@ -50,18 +52,40 @@ namespace ome
     /**
      * Tile pixel data buffer.
      *
-     * Pixel data for a single tile.
+     * Pixel data for a single tile.  The buffer is aligned to
+     * TileBuffer::alignment bytes, suitable for vectorised access.
      */
     class TileBuffer
     {
     public:
+      /// Buffer alignment (bytes).
+      static const dimension_size_type alignment = 64U;
+
+      /// Buffer alignment for direct (unbuffered) I/O (bytes).
+      static const dimension_size_type direct_io_alignment = 4096U;
+
       /**
        * Constructor.
        *
+       * If huge pages are requested, buffers of at least the huge
+       * page size will be aligned to the huge page size and backed
+       * by transparent huge pages where supported by the system.
+       * This reduces TLB misses when processing multi-megabyte
+       * strips.  Smaller buffers are allocated normally.
+       *
+       * A larger alignment may be requested for buffers used for
+       * direct I/O, which requires the memory to be aligned to the
+       * block size of the storage; see direct_io_alignment.
+       *
        * @param size the buffer size (bytes).
+       * @param hugepages @c true to use huge pages for large buffers.
+       * @param align the minimum buffer alignment (bytes); this
+       * must be a power of two.
        */
       explicit
-      TileBuffer(dimension_size_type size);
+      TileBuffer(dimension_size_type size,
+                 bool                hugepages = false,
+                 dimension_size_type align = alignment);
 
       /// Destructor.
       virtual ~TileBuffer();
@@ -107,6 +131,76 @@ namespace ome
       uint8_t *buf;
     };
 
+    /**
+     * Tile buffer pool.
+     *
+     * Released tile buffers are retained by the pool, indexed by
+     * size, and reused for subsequent requests of the same size.
+     * This avoids repeated allocation and release of identical
+     * buffers, for example when writing images with many tiles.
+     * Buffers obtained from the pool are zeroed, as for a new
+     * TileBuffer.  The total size of retained buffers is bounded.
+     *
+     * Buffers are returned to the pool automatically when the last
+     * reference is released.  Buffers may outlive the pool, in
+     * which case they are freed normally.  This class is
+     * thread-safe.
+     */
+    class TileBufferPool
+    {
+    private:
+      class Impl;
+      /// Private implementation details.
+      std::shared_ptr<Impl> impl;
+
+    public:
+      /**
+       * Constructor.
+       *
+       * @param maxsize the maximum total size of retained buffers
+       * (bytes).
+       */
+      explicit
+      TileBufferPool(dimension_size_type maxsize = 64U * 1024U * 1024U);
+
+      /// Destructor.
+      virtual ~TileBufferPool();
+
+      /// @cond SKIP
+      TileBufferPool (const TileBufferPool&) = delete;
+
+      TileBufferPool&
+      operator= (const TileBufferPool&) = delete;
+      /// @endcond SKIP
+
+      /**
+       * Get a buffer.
+       *
+       * A retained buffer of the requested size will be reused if
+       * available, otherwise a new buffer will be allocated.
+       *
+       * @param size the buffer size (bytes).
+       * @returns a zeroed buffer, which will be returned to the pool
+       * when released.
+       */
+      std::shared_ptr<TileBuffer>
+      get(dimension_size_type size);
+
+      /**
+       * Get the number of retained buffers.
+       *
+       * @returns the buffer count.
+       */
+      dimension_size_type
+      size() const;
+
+      /**
+       * Free all retained buffers.
+       */
+      void
+      clear();
+    };
+
   }
 }
 
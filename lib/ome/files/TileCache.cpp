@@ -35,6 +35,10 @@
  * #L%
  */
 
+#include <stdexcept>
+
+#include <boost/filesystem/operations.hpp>
+
 #include <ome/files/TileCache.h>
 
 namespace ome
@@ -43,35 +47,109 @@ namespace ome
   {
 
     TileCache::TileCache():
-      cache()
+      cache(),
+      count(0U),
+      maxmemory(0U),
+      bytes(0U),
+      nspilled(0U),
+      pending(0U),
+      haspending(false),
+      hand(0U),
+      spilldir(),
+      scratchpath(),
+      scratch(),
+      scratchsize(0),
+      freeextents(),
+      budget(),
+      budgetaccount()
     {
     }
 
     TileCache::~TileCache()
     {
+      try
+        {
+          removeScratch();
+        }
+      catch (...)
+        {
+        }
     }
 
     bool
     TileCache::insert(key_type   tileindex,
                       value_type tilebuffer)
     {
-      std::pair<std::map<key_type, value_type>::iterator, bool> i =
-        cache.insert(std::pair<key_type, value_type>(tileindex, tilebuffer));
-      return i.second;
+      if (!tilebuffer)
+        return false;
+
+      settle();
+
+      if (tileindex >= cache.size())
+        cache.resize(tileindex + 1);
+
+      Slot& slot(cache[tileindex]);
+      if (slot.present)
+        return false;
+
+      slot.tilebuffer = tilebuffer;
+      slot.size = tilebuffer->size();
+      slot.present = true;
+      slot.referenced = true;
+      bytes += slot.size;
+      ++count;
+      account();
+
+      enforce(tileindex);
+      return true;
     }
 
     void
     TileCache::erase(key_type tileindex)
     {
-      cache.erase(tileindex);
+      settle();
+
+      if (tileindex < cache.size())
+        {
+          Slot& slot(cache[tileindex]);
+          if (slot.present)
+            {
+              if (slot.spilled)
+                {
+                  freeextents.push_back(extent_type(slot.offset, slot.size));
+                  --nspilled;
+                }
+              else
+                {
+                  bytes -= slot.size;
+                  account();
+                }
+              slot.tilebuffer.reset();
+              slot.size = 0U;
+              slot.present = false;
+              slot.spilled = false;
+              slot.referenced = false;
+              --count;
+            }
+        }
     }
 
     TileCache::value_type
     TileCache::find(key_type tileindex)
     {
-      std::map<key_type, value_type>::iterator i = cache.find(tileindex);
-      if (i != cache.end())
-        return i->second;
+      settle();
+
+      if (tileindex < cache.size())
+        {
+          Slot& slot(cache[tileindex]);
+          if (slot.spilled)
+            {
+              restore(slot);
+              enforce(tileindex);
+            }
+          slot.referenced = true;
+          return slot.tilebuffer;
+        }
       else
         return value_type();
     }
@@ -79,9 +157,13 @@ namespace ome
     const TileCache::value_type
     TileCache::find(key_type tileindex) const
     {
-      std::map<key_type, value_type>::const_iterator i = cache.find(tileindex);
-      if (i != cache.end())
-        return i->second;
+      if (tileindex < cache.size())
+        {
+          const Slot& slot(cache[tileindex]);
+          if (slot.spilled)
+            return read(slot);
+          return slot.tilebuffer;
+        }
       else
         return value_type();
     }
@@ -89,28 +171,267 @@ namespace ome
     dimension_size_type
     TileCache::size() const
     {
-      return cache.size();
+      return count;
     }
 
     void
     TileCache::clear()
     {
-      cache.clear();
+      // Retain the storage for reuse.
+      for (auto& slot : cache)
+        {
+          slot.tilebuffer.reset();
+          slot.size = 0U;
+          slot.present = false;
+          slot.spilled = false;
+          slot.referenced = false;
+        }
+      count = 0U;
+      bytes = 0U;
+      account();
+      nspilled = 0U;
+      haspending = false;
+      hand = 0U;
+      removeScratch();
     }
 
     TileCache::value_type&
     TileCache::operator[](key_type tileindex)
     {
-      std::map<key_type, value_type>::iterator i = cache.find(tileindex);
-      if (i != cache.end())
-        return i->second;
-      else
+      settle();
+
+      if (tileindex >= cache.size())
+        cache.resize(tileindex + 1);
+
+      Slot& slot(cache[tileindex]);
+      if (!slot.present)
+        {
+          slot.present = true;
+          ++count;
+        }
+      else if (slot.spilled)
+        restore(slot);
+      slot.referenced = true;
+
+      enforce(tileindex);
+
+      // The caller may assign a new buffer; account for it later.
+      pending = tileindex;
+      haspending = true;
+      return slot.tilebuffer;
+    }
+
+    void
+    TileCache::setMaxMemory(dimension_size_type maxmemory)
+    {
+      this->maxmemory = maxmemory;
+    }
+
+    dimension_size_type
+    TileCache::getMaxMemory() const
+    {
+      return maxmemory;
+    }
+
+    dimension_size_type
+    TileCache::memory() const
+    {
+      dimension_size_type total = bytes;
+      if (haspending && pending < cache.size())
+        {
+          const Slot& slot(cache[pending]);
+          if (slot.present && !slot.spilled)
+            total = total - slot.size + (slot.tilebuffer ? slot.tilebuffer->size() : 0U);
+        }
+      return total;
+    }
+
+    dimension_size_type
+    TileCache::spilled() const
+    {
+      return nspilled;
+    }
+
+    void
+    TileCache::setSpillDirectory(const boost::filesystem::path& dir)
+    {
+      spilldir = dir;
+    }
+
+    const boost::filesystem::path&
+    TileCache::getSpillDirectory() const
+    {
+      return spilldir;
+    }
+
+    void
+    TileCache::setMemoryBudget(const std::shared_ptr<MemoryBudget>& budget)
+    {
+      if (budget == this->budget)
+        return;
+
+      this->budget = budget;
+      budgetaccount.reset();
+      if (budget)
+        budgetaccount = budget->open("tile cache");
+      account();
+    }
+
+    const std::shared_ptr<MemoryBudget>&
+    TileCache::getMemoryBudget() const
+    {
+      return budget;
+    }
+
+    void
+    TileCache::account()
+    {
+      if (budgetaccount)
+        budgetaccount->setUsage(bytes);
+    }
+
+    void
+    TileCache::settle()
+    {
+      if (!haspending)
+        return;
+      haspending = false;
+
+      if (pending < cache.size())
+        {
+          Slot& slot(cache[pending]);
+          if (slot.present && !slot.spilled)
+            {
+              dimension_size_type size = slot.tilebuffer ? slot.tilebuffer->size() : 0U;
+              bytes = bytes - slot.size + size;
+              slot.size = size;
+              account();
+            }
+        }
+    }
+
+    void
+    TileCache::enforce(key_type keep)
+    {
+      if ((!maxmemory && !budgetaccount) || cache.empty())
+        return;
+
+      // Clock (second chance) replacement: recently used tiles are
+      // skipped once before being spilled.  Two passes are
+      // sufficient to find a tile if any may be spilled.
+      dimension_size_type steps = cache.size() * 2U;
+      while (((maxmemory && bytes > maxmemory) ||
+              (budgetaccount && bytes && budgetaccount->exceeded())) &&
+             steps > 0U)
+        {
+          if (hand >= cache.size())
+            hand = 0U;
+          Slot& slot(cache[hand]);
+          if (hand != keep && slot.present && !slot.spilled && slot.tilebuffer)
+            {
+              if (slot.referenced)
+                slot.referenced = false;
+              else
+                spill(slot);
+            }
+          ++hand;
+          --steps;
+        }
+    }
+
+    void
+    TileCache::spill(Slot& slot)
+    {
+      if (!scratch.is_open())
+        {
+          boost::filesystem::path dir(spilldir.empty() ?
+                                      boost::filesystem::temp_directory_path() :
+                                      spilldir);
+          scratchpath = dir / boost::filesystem::unique_path("ome-files-tiles-%%%%-%%%%-%%%%-%%%%.tmp");
+          scratch.open(scratchpath.string().c_str(),
+                       std::ios::in | std::ios::out | std::ios::trunc | std::ios::binary);
+          if (!scratch.is_open())
+            throw std::runtime_error(std::string("Failed to create tile scratch file ") + scratchpath.string());
+          scratchsize = 0;
+          freeextents.clear();
+        }
+
+      // Reuse a free extent of the same size if possible, since tile
+      // buffers are usually all the same size.
+      std::streamoff offset = scratchsize;
+      bool reused = false;
+      for (auto i = freeextents.begin(); i != freeextents.end(); ++i)
+        {
+          if (i->second == slot.size)
+            {
+              offset = i->first;
+              freeextents.erase(i);
+              reused = true;
+              break;
+            }
+        }
+
+      scratch.seekp(offset);
+      scratch.write(reinterpret_cast<const char *>(slot.tilebuffer->data()),
+                    static_cast<std::streamsize>(slot.size));
+      if (!scratch)
+        {
+          scratch.clear();
+          if (reused)
+            freeextents.push_back(extent_type(offset, slot.size));
+          throw std::runtime_error(std::string("Failed to write tile to scratch file ") + scratchpath.string());
+        }
+      if (!reused)
+        scratchsize += static_cast<std::streamoff>(slot.size);
+
+      slot.tilebuffer.reset();
+      slot.offset = offset;
+      slot.spilled = true;
+      slot.referenced = false;
+      bytes -= slot.size;
+      account();
+      ++nspilled;
+    }
+
+    TileCache::value_type
+    TileCache::read(const Slot& slot) const
+    {
+      value_type tilebuffer(std::make_shared<TileBuffer>(slot.size));
+      scratch.seekg(slot.offset);
+      scratch.read(reinterpret_cast<char *>(tilebuffer->data()),
+                   static_cast<std::streamsize>(slot.size));
+      if (!scratch)
+        {
+          scratch.clear();
+          throw std::runtime_error(std::string("Failed to read tile from scratch file ") + scratchpath.string());
+        }
+      return tilebuffer;
+    }
+
+    void
+    TileCache::restore(Slot& slot)
+    {
+      slot.tilebuffer = read(slot);
+      freeextents.push_back(extent_type(slot.offset, slot.size));
+      slot.spilled = false;
+      bytes += slot.size;
+      account();
+      --nspilled;
+    }
+
+    void
+    TileCache::removeScratch()
+    {
+      if (scratch.is_open())
+        scratch.close();
+      if (!scratchpath.empty())
         {
-          value_type value;
-          std::pair<std::map<key_type, value_type>::iterator, bool> i =
-            cache.insert(std::pair<key_type, value_type>(tileindex, value));
-          return i.first->second;
+          boost::system::error_code ec;
+          boost::filesystem::remove(scratchpath, ec);
+          scratchpath.clear();
         }
+      scratchsize = 0;
+      freeextents.clear();
     }
 
   }
@@ -38,11 +38,15 @@
 #ifndef OME_FILES_TILECACHE_H
 #define OME_FILES_TILECACHE_H
 
+#include <ome/files/MemoryBudget.h>
 #include <ome/files/Types.h>
 #include <ome/files/TileBuffer.h>
 
-#include <map>
+#include <fstream>
 #include <memory>
+#include <vector>
+
+#include <boost/filesystem/path.hpp>
 
 namespace ome
 {
@@ -53,7 +57,21 @@ namespace ome
      * Tile cache.
      *
      * This is a collection of TileBuffer objects indexed by tile
-     * number.
+     * number.  Tile numbers are dense, so the tiles are stored in a
+     * flat array indexed by tile number, giving constant-time
+     * lookup, insertion and removal without any per-tile
+     * allocation.  The storage grows to the largest tile index
+     * inserted, and is retained until the cache is destroyed.
+     *
+     * The memory used by the cached tile buffers may optionally be
+     * limited.  If the limit is exceeded, the least recently used
+     * tiles are spilled to a temporary scratch file, and are read
+     * back in when next accessed.  Note that the limit is enforced
+     * on the next access or insertion following the assignment of a
+     * tile buffer using operator[](), so may be exceeded by one tile
+     * buffer.  If the cache is attached to a MemoryBudget, the
+     * buffers held in memory are accounted to the budget, and tiles
+     * are also spilled while the budget is exceeded.
      */
     class TileCache
     {
@@ -154,9 +172,174 @@ namespace ome
       value_type&
       operator[](key_type tileindex);
 
+      /**
+       * Set the maximum memory use.
+       *
+       * @param maxmemory the maximum total size of the tile buffers
+       * held in memory (bytes), or 0 for no limit (the default).
+       */
+      void
+      setMaxMemory(dimension_size_type maxmemory);
+
+      /**
+       * Get the maximum memory use.
+       *
+       * @returns the maximum total size of the tile buffers held in
+       * memory (bytes), or 0 if there is no limit.
+       */
+      dimension_size_type
+      getMaxMemory() const;
+
+      /**
+       * Get the memory use.
+       *
+       * @returns the total size of the tile buffers held in memory
+       * (bytes).
+       */
+      dimension_size_type
+      memory() const;
+
+      /**
+       * Get the number of spilled tiles.
+       *
+       * @returns the number of tiles held in the scratch file.
+       */
+      dimension_size_type
+      spilled() const;
+
+      /**
+       * Set the scratch file directory.
+       *
+       * This takes effect when the scratch file is next created.
+       *
+       * @param dir the directory in which to create the scratch
+       * file; if empty, the system temporary directory is used (the
+       * default).
+       */
+      void
+      setSpillDirectory(const boost::filesystem::path& dir);
+
+      /**
+       * Get the scratch file directory.
+       *
+       * @returns the directory in which to create the scratch file.
+       */
+      const boost::filesystem::path&
+      getSpillDirectory() const;
+
+      /**
+       * Set the memory budget.
+       *
+       * @param budget the budget to account the tile buffers held in
+       * memory to, or null for none (the default).
+       */
+      void
+      setMemoryBudget(const std::shared_ptr<MemoryBudget>& budget);
+
+      /**
+       * Get the memory budget.
+       *
+       * @returns the budget, or null if none.
+       */
+      const std::shared_ptr<MemoryBudget>&
+      getMemoryBudget() const;
+
     private:
-      /// Mapping of tile number to tile buffer.
-      std::map<key_type, value_type> cache;
+      /// Cache slot.
+      struct Slot
+      {
+        /// Tile buffer (null if spilled).
+        value_type tilebuffer;
+        /// Size of the buffer held in memory or in the scratch file.
+        dimension_size_type size;
+        /// Offset of the buffer in the scratch file (if spilled).
+        std::streamoff offset;
+        /// Whether the slot is in use.
+        bool present;
+        /// Whether the buffer is held in the scratch file.
+        bool spilled;
+        /// Whether the slot was recently used.
+        bool referenced;
+      };
+
+      /// Scratch file extent (offset and size).
+      typedef std::pair<std::streamoff, dimension_size_type> extent_type;
+
+      /// Account for the buffer assigned by the last operator[]().
+      void
+      settle();
+
+      /**
+       * Spill tiles until within the memory limit.
+       *
+       * @param keep a tile which must not be spilled.
+       */
+      void
+      enforce(key_type keep);
+
+      /**
+       * Spill a tile to the scratch file.
+       *
+       * @param slot the slot to spill.
+       */
+      void
+      spill(Slot& slot);
+
+      /**
+       * Read a spilled tile from the scratch file.
+       *
+       * @param slot the slot to read.
+       * @returns the tile buffer.
+       */
+      value_type
+      read(const Slot& slot) const;
+
+      /**
+       * Read a spilled tile back into memory.
+       *
+       * @param slot the slot to restore.
+       */
+      void
+      restore(Slot& slot);
+
+      /// Close and remove the scratch file.
+      void
+      removeScratch();
+
+      /// Update the memory use accounted to the budget.
+      void
+      account();
+
+      /// Tile buffers indexed by tile number.
+      std::vector<Slot> cache;
+      /// Number of slots in use.
+      dimension_size_type count;
+      /// Maximum memory use (bytes); 0 for no limit.
+      dimension_size_type maxmemory;
+      /// Total size of the buffers held in memory (bytes).
+      dimension_size_type bytes;
+      /// Number of spilled tiles.
+      dimension_size_type nspilled;
+      /// Tile returned by the last operator[]() call.
+      key_type pending;
+      /// Whether pending is set.
+      bool haspending;
+      /// Next slot to consider for spilling.
+      key_type hand;
+      /// Scratch file directory.
+      boost::filesystem::path spilldir;
+      /// Scratch file path.
+      boost::filesystem::path scratchpath;
+      /// Scratch file.
+      mutable std::fstream scratch;
+      /// Scratch file size.
+      std::streamoff scratchsize;
+      /// Unused scratch file extents.
+      std::vector<extent_type> freeextents;
+      /// Memory budget.
+      std::shared_ptr<MemoryBudget> budget;
+      /// Budget account.
+      std::shared_ptr<MemoryBudget::Account> budgetaccount;
     };
 
   }
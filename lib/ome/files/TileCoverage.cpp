@@ -46,6 +46,7 @@
 
 #include <algorithm>
 #include <list>
+#include <vector>
 
 #include <ome/files/Types.h>
 #include <ome/files/TileCoverage.h>
@@ -125,11 +126,36 @@ namespace ome
       std::list<box> rtree;
 #endif // OME_HAVE_BOOST_GEOMETRY_INDEX_RTREE_HPP
 
+      /// Image width (if using a tile grid).
+      dimension_size_type imagewidth;
+      /// Image height (if using a tile grid).
+      dimension_size_type imageheight;
+      /// Tile width, or zero if not using a tile grid.
+      dimension_size_type tilewidth;
+      /// Tile height (if using a tile grid).
+      dimension_size_type tileheight;
+      /// Tile columns (if using a tile grid).
+      dimension_size_type ncols;
+      /// Covered rows, by image row and tile column.
+      std::vector<bool> gridrows;
+      /// Covered row count, by tile.
+      std::vector<dimension_size_type> gridcount;
+      /// Number of tiles with covered rows.
+      dimension_size_type gridtiles;
+
       /**
        * Constructor.
        */
       Impl():
-        rtree()
+        rtree(),
+        imagewidth(),
+        imageheight(),
+        tilewidth(),
+        tileheight(),
+        ncols(),
+        gridrows(),
+        gridcount(),
+        gridtiles()
       {
       }
 
@@ -191,6 +217,153 @@ namespace ome
 
         return results;
       }
+
+      /**
+       * Check if a region may be stored in the tile grid.
+       *
+       * The region must be within a single row of tiles, and span
+       * the full width of a single tile within the image.
+       *
+       * @param region the region to check.
+       * @param col the tile column to set.
+       * @returns @c true if the region may be stored in the grid.
+       */
+      bool
+      gridStrip(const PlaneRegion&   region,
+                dimension_size_type& col) const
+      {
+        if (!tilewidth || !region.w || !region.h ||
+            region.x % tilewidth ||
+            region.x >= imagewidth ||
+            region.y + region.h > imageheight ||
+            region.y / tileheight != (region.y + region.h - 1) / tileheight)
+          return false;
+
+        col = region.x / tilewidth;
+        return region.w == std::min(tilewidth, imagewidth - region.x);
+      }
+
+      /**
+       * Get the tile index for a position in the tile grid.
+       *
+       * @param col the tile column.
+       * @param y the image row.
+       * @returns the tile index.
+       */
+      dimension_size_type
+      gridTile(dimension_size_type col,
+               dimension_size_type y) const
+      {
+        return ((y / tileheight) * ncols) + col;
+      }
+
+      /**
+       * Covered area in the tile grid within a region.
+       *
+       * @param region the region to check.
+       * @returns the covered area.
+       */
+      dimension_size_type
+      gridCoverage(const PlaneRegion& region) const
+      {
+        if (!gridtiles)
+          return 0;
+
+        PlaneRegion clip = region & PlaneRegion(0, 0, imagewidth, imageheight);
+        if (!clip.valid() || !clip.w || !clip.h)
+          return 0;
+
+        dimension_size_type area = 0;
+        for (dimension_size_type col = clip.x / tilewidth;
+             col * tilewidth < clip.x + clip.w;
+             ++col)
+          {
+            PlaneRegion tile(col * tilewidth, 0, tilewidth, imageheight);
+            PlaneRegion part = clip & tile;
+            for (dimension_size_type y = part.y; y < part.y + part.h; ++y)
+              if (gridrows[(y * ncols) + col])
+                area += part.w;
+          }
+        return area;
+      }
+
+      /**
+       * Covered area in the R*Tree within a region.
+       *
+       * @param region the region to check.
+       * @returns the covered area.
+       */
+      dimension_size_type
+      treeCoverage(const PlaneRegion& region)
+      {
+        if (rtree.empty())
+          return 0;
+
+        box b(box_from_region(region));
+        std::vector<box> results = intersecting(b);
+
+        dimension_size_type area = 0;
+        for(const auto& i : results)
+          {
+            PlaneRegion test(region_from_box(i));
+            PlaneRegion intersection = region & test;
+
+            if (intersection.valid())
+              area += intersection.area();
+          }
+
+        return area;
+      }
+
+      /**
+       * Set or clear the covered rows of a region in the tile grid.
+       *
+       * @param region the region, which must be a grid strip.
+       * @param col the tile column.
+       * @param value @c true to set or @c false to clear.
+       */
+      void
+      setGridRows(const PlaneRegion&  region,
+                  dimension_size_type col,
+                  bool                value)
+      {
+        for (dimension_size_type y = region.y; y < region.y + region.h; ++y)
+          gridrows[(y * ncols) + col] = value;
+
+        dimension_size_type& count(gridcount[gridTile(col, region.y)]);
+        if (value)
+          {
+            if (!count)
+              ++gridtiles;
+            count += region.h;
+          }
+        else
+          {
+            count -= region.h;
+            if (!count)
+              --gridtiles;
+          }
+      }
+
+      /**
+       * Check if the rows of a region in the tile grid all have the
+       * same state.
+       *
+       * @param region the region, which must be a grid strip.
+       * @param col the tile column.
+       * @param value the state to check for.
+       * @returns @c true if all rows have this state.
+       */
+      bool
+      gridRowsAre(const PlaneRegion&  region,
+                  dimension_size_type col,
+                  bool                value) const
+      {
+        for (dimension_size_type y = region.y; y < region.y + region.h; ++y)
+          if (gridrows[(y * ncols) + col] != value)
+            return false;
+        return true;
+      }
     };
 
     TileCoverage::TileCoverage():
@@ -202,12 +375,48 @@ namespace ome
     {
     }
 
+    void
+    TileCoverage::setGrid(dimension_size_type imagewidth,
+                          dimension_size_type imageheight,
+                          dimension_size_type tilewidth,
+                          dimension_size_type tileheight)
+    {
+      clear();
+
+      if (!imagewidth || !imageheight || !tilewidth || !tileheight)
+        {
+          impl->tilewidth = 0;
+          return;
+        }
+
+      impl->imagewidth = imagewidth;
+      impl->imageheight = imageheight;
+      impl->tilewidth = tilewidth;
+      impl->tileheight = tileheight;
+      impl->ncols = (imagewidth + tilewidth - 1) / tilewidth;
+      dimension_size_type nrows = (imageheight + tileheight - 1) / tileheight;
+      impl->gridrows.assign(imageheight * impl->ncols, false);
+      impl->gridcount.assign(nrows * impl->ncols, 0);
+    }
+
     bool
     TileCoverage::insert(const PlaneRegion& region,
                          bool               coalesce)
     {
       bool inserted = false;
 
+      dimension_size_type col;
+      if (impl->gridStrip(region, col))
+        {
+          if (impl->gridRowsAre(region, col, false) &&
+              impl->treeCoverage(region) == 0)
+            {
+              impl->setGridRows(region, col, true);
+              inserted = true;
+            }
+          return inserted;
+        }
+
       if (coverage(region) == 0)
         {
           box b(box_from_region(region));
@@ -284,6 +493,14 @@ namespace ome
     bool
     TileCoverage::remove(const PlaneRegion& region)
     {
+      dimension_size_type col;
+      if (impl->gridStrip(region, col) &&
+          impl->gridRowsAre(region, col, true))
+        {
+          impl->setGridRows(region, col, false);
+          return true;
+        }
+
       box b(box_from_region(region));
 
 #ifdef OME_HAVE_BOOST_GEOMETRY_INDEX_RTREE_HPP
@@ -303,37 +520,39 @@ namespace ome
     dimension_size_type
     TileCoverage::size() const
     {
-      return impl->rtree.size();
+      return impl->rtree.size() + impl->gridtiles;
     }
 
     void
     TileCoverage::clear()
     {
       impl->rtree.clear();
+      if (impl->gridtiles)
+        {
+          std::fill(impl->gridrows.begin(), impl->gridrows.end(), false);
+          std::fill(impl->gridcount.begin(), impl->gridcount.end(), 0);
+          impl->gridtiles = 0;
+        }
     }
 
     dimension_size_type
     TileCoverage::coverage(const PlaneRegion& region) const
     {
-      box b(box_from_region(region));
-      std::vector<box> results = impl->intersecting(b);
-
-      dimension_size_type area = 0;
-      for(const auto& i : results)
-        {
-          PlaneRegion test(region_from_box(i));
-          PlaneRegion intersection = region & test;
-
-          if (intersection.valid())
-            area += intersection.area();
-        }
-
-      return area;
+      return impl->gridCoverage(region) + impl->treeCoverage(region);
     }
 
     bool
     TileCoverage::covered(const PlaneRegion& region) const
     {
+      // Fast path for a whole tile within the image.
+      dimension_size_type col;
+      if (impl->gridStrip(region, col) &&
+          region.y % impl->tileheight == 0 &&
+          region.h == std::min(impl->tileheight,
+                               impl->imageheight - region.y) &&
+          impl->gridcount[impl->gridTile(col, region.y)] == region.h)
+        return true;
+
       return (region.w * region.h) == coverage(region);
     }
 
@@ -56,6 +56,12 @@ namespace ome
      * used, for example, to prevent writing out incomplete tiles
      * and to output tiles in order when used with an accompanying
      * tile cache.
+     *
+     * If a tile grid is set with setGrid(), regions spanning the
+     * full width of a single tile (for example whole tiles, or rows
+     * of a tile) are instead recorded in a per-tile row bitmap, so
+     * that checking if a tile is covered is a constant-time
+     * operation.  Other regions are stored in the R*Tree.
      */
     class TileCoverage
     {
@@ -66,6 +72,24 @@ namespace ome
       /// Destructor.
       virtual ~TileCoverage();
 
+      /**
+       * Set the tile grid.
+       *
+       * This clears the coverage cache.  Regions outside the image
+       * are not recorded in the grid.
+       *
+       * @param imagewidth the image width.
+       * @param imageheight the image height.
+       * @param tilewidth the tile width.
+       * @param tileheight the tile height (may exceed the image
+       * height, e.g. for a single strip).
+       */
+      void
+      setGrid(dimension_size_type imagewidth,
+              dimension_size_type imageheight,
+              dimension_size_type tilewidth,
+              dimension_size_type tileheight);
+
       /**
        * Insert a region into the coverage cache.
        *
@@ -111,6 +135,9 @@ namespace ome
       /**
        * Get the number of separate regions in the coverage cache.
        *
+       * If a tile grid is set, each tile with covered rows in the
+       * grid counts as a single region.
+       *
        * @returns the number of separate regions.
        */
       dimension_size_type
@@ -0,0 +1,404 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+
+#ifndef OME_FILES_TILEDPLANEVIEW_H
+#define OME_FILES_TILEDPLANEVIEW_H
+
+#include <algorithm>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+#include <boost/format.hpp>
+
+#include <ome/files/FormatReader.h>
+#include <ome/files/PixelBuffer.h>
+#include <ome/files/Types.h>
+
+namespace ome
+{
+  namespace files
+  {
+
+    /**
+     * Lazily decoded view of an image plane.
+     *
+     * The plane is divided into tiles of the reader's optimal tile
+     * size (see FormatReader::getOptimalTileWidth() and
+     * FormatReader::getOptimalTileHeight()).  Each tile is read
+     * with FormatReader::openBytes() the first time a pixel or row
+     * within it is accessed, and retained for later accesses.
+     * Algorithms which visit a plane sparsely, such as region
+     * growing or sparse sampling, then decode only the tiles they
+     * visit rather than the whole plane.
+     *
+     * Pixels are indexed as for PixelBuffer::at(), with the @c X,
+     * @c Y and subchannel dimensions used; all other indices must
+     * be zero.  Decoded tiles are retained up to a size limit,
+     * after which the least recently used tiles are discarded and
+     * will be decoded again if accessed.  Readers which also cache
+     * decoded tiles (see DecodedTileCache) may then satisfy the
+     * repeated read without decoding.
+     *
+     * The reader must remain set to the series and resolution
+     * which were current when the view was created, and must not
+     * be used concurrently by other threads while the view decodes
+     * a tile.  The view itself is thread-safe.
+     *
+     * @tparam T the pixel type, which must match the pixel type of
+     * the plane.
+     */
+    template<typename T>
+    class TiledPlaneView
+    {
+    public:
+      /// Pixel value type.
+      typedef T value_type;
+      /// Type used to index all dimensions.
+      typedef PixelBufferBase::indices_type indices_type;
+      /// Decoded tile type.
+      typedef std::shared_ptr<const PixelBuffer<T>> tile_type;
+
+      /**
+       * Constructor.
+       *
+       * @param reader the reader, set to the series and resolution
+       * containing the plane.
+       * @param plane the plane index within the series.
+       * @param maxsize the maximum total size of the retained
+       * tiles (bytes); at least one tile is always retained.
+       * @throws std::logic_error if the plane index is invalid.
+       */
+      TiledPlaneView(const std::shared_ptr<const FormatReader>& reader,
+                     dimension_size_type                        plane,
+                     dimension_size_type                        maxsize = 64U * 1024U * 1024U):
+        reader(reader),
+        plane(plane),
+        series(reader->getSeries()),
+        resolution(reader->getResolution()),
+        sizeX(reader->getSizeX()),
+        sizeY(reader->getSizeY()),
+        tileWidth(std::max(std::min(reader->getOptimalTileWidth(), sizeX), dimension_size_type(1U))),
+        tileHeight(std::max(std::min(reader->getOptimalTileHeight(), sizeY), dimension_size_type(1U))),
+        tilesX((sizeX + tileWidth - 1U) / tileWidth),
+        maxTiles(),
+        mutex(),
+        tiles(),
+        lru(),
+        decoded(0U)
+      {
+        if (plane >= reader->getImageCount())
+          {
+            boost::format fmt("Invalid plane %1% (series has %2% planes)");
+            fmt % plane % reader->getImageCount();
+            throw std::logic_error(fmt.str());
+          }
+
+        const dimension_size_type tileSize = tileWidth * tileHeight * sizeof(value_type) *
+          reader->getRGBChannelCount(reader->getZCTCoords(plane)[1]);
+        maxTiles = std::max(maxsize / std::max(tileSize, dimension_size_type(1U)), dimension_size_type(1U));
+      }
+
+      /// @cond SKIP
+      TiledPlaneView (const TiledPlaneView&) = delete;
+
+      TiledPlaneView&
+      operator= (const TiledPlaneView&) = delete;
+      /// @endcond SKIP
+
+      /**
+       * Get the width of the plane.
+       *
+       * @returns the width (pixels).
+       */
+      dimension_size_type
+      getSizeX() const
+      {
+        return sizeX;
+      }
+
+      /**
+       * Get the height of the plane.
+       *
+       * @returns the height (pixels).
+       */
+      dimension_size_type
+      getSizeY() const
+      {
+        return sizeY;
+      }
+
+      /**
+       * Get the tile width.
+       *
+       * @returns the width of each tile (pixels).
+       */
+      dimension_size_type
+      getTileWidth() const
+      {
+        return tileWidth;
+      }
+
+      /**
+       * Get the tile height.
+       *
+       * @returns the height of each tile (pixels).
+       */
+      dimension_size_type
+      getTileHeight() const
+      {
+        return tileHeight;
+      }
+
+      /**
+       * Get the number of tiles decoded.
+       *
+       * This includes tiles decoded again after being discarded.
+       *
+       * @returns the number of tiles read from the reader.
+       */
+      dimension_size_type
+      getDecodedTileCount() const
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        return decoded;
+      }
+
+      /**
+       * Get the pixel value at an index.
+       *
+       * The tile containing the pixel is decoded if needed.
+       *
+       * @param indices the multi-dimensional array index.
+       * @returns the pixel value.
+       * @throws std::out_of_range if the @c X or @c Y index is
+       * outside the plane.
+       */
+      value_type
+      at(const indices_type& indices) const
+      {
+        const PixelBufferBase::index x = indices[DIM_SPATIAL_X];
+        const PixelBufferBase::index y = indices[DIM_SPATIAL_Y];
+        checkIndex(x, y);
+
+        tile_type t(tile(static_cast<dimension_size_type>(x), static_cast<dimension_size_type>(y)));
+        indices_type local(indices);
+        local[DIM_SPATIAL_X] = x % static_cast<PixelBufferBase::index>(tileWidth);
+        local[DIM_SPATIAL_Y] = y % static_cast<PixelBufferBase::index>(tileHeight);
+        return t->at(local);
+      }
+
+      /**
+       * Get the pixel value at a position.
+       *
+       * @param x the @c X coordinate.
+       * @param y the @c Y coordinate.
+       * @param subchannel the subchannel (sample) index.
+       * @returns the pixel value.
+       * @throws std::out_of_range if the position is outside the
+       * plane.
+       */
+      value_type
+      at(dimension_size_type x,
+         dimension_size_type y,
+         dimension_size_type subchannel = 0U) const
+      {
+        indices_type indices;
+        indices.fill(0);
+        indices[DIM_SPATIAL_X] = static_cast<PixelBufferBase::index>(x);
+        indices[DIM_SPATIAL_Y] = static_cast<PixelBufferBase::index>(y);
+        indices[DIM_SUBCHANNEL] = static_cast<PixelBufferBase::index>(subchannel);
+        return at(indices);
+      }
+
+      /**
+       * Copy part of a row.
+       *
+       * The tiles containing the row segment are decoded if needed.
+       *
+       * @param y the @c Y coordinate of the row.
+       * @param x the @c X coordinate of the first pixel.
+       * @param w the number of pixels.
+       * @param dest the destination for @p w pixel values.
+       * @param subchannel the subchannel (sample) index.
+       * @throws std::out_of_range if the row segment is outside the
+       * plane.
+       */
+      void
+      row(dimension_size_type  y,
+          dimension_size_type  x,
+          dimension_size_type  w,
+          value_type          *dest,
+          dimension_size_type  subchannel = 0U) const
+      {
+        if (!w)
+          return;
+        checkIndex(static_cast<PixelBufferBase::index>(x + w - 1U), static_cast<PixelBufferBase::index>(y));
+
+        indices_type local;
+        local.fill(0);
+        local[DIM_SPATIAL_Y] = static_cast<PixelBufferBase::index>(y % tileHeight);
+        local[DIM_SUBCHANNEL] = static_cast<PixelBufferBase::index>(subchannel);
+        for (dimension_size_type end = x + w; x < end;)
+          {
+            tile_type t(tile(x, y));
+            const dimension_size_type tileEnd = std::min(end, (x / tileWidth + 1U) * tileWidth);
+            for (; x < tileEnd; ++x, ++dest)
+              {
+                local[DIM_SPATIAL_X] = static_cast<PixelBufferBase::index>(x % tileWidth);
+                *dest = t->at(local);
+              }
+          }
+      }
+
+      /**
+       * Get the tile containing a pixel.
+       *
+       * The tile is decoded if needed.  Its origin is at the pixel
+       * (@c x rounded down to a multiple of getTileWidth(), @c y
+       * rounded down to a multiple of getTileHeight()); tiles at
+       * the right and bottom edges of the plane may be smaller
+       * than the tile size.
+       *
+       * @param x the @c X coordinate.
+       * @param y the @c Y coordinate.
+       * @returns the decoded tile.
+       * @throws std::out_of_range if the position is outside the
+       * plane.
+       * @throws std::logic_error if the reader series or resolution
+       * has changed, or the pixel type does not match.
+       */
+      tile_type
+      tile(dimension_size_type x,
+           dimension_size_type y) const
+      {
+        checkIndex(static_cast<PixelBufferBase::index>(x), static_cast<PixelBufferBase::index>(y));
+        const dimension_size_type tx = x / tileWidth;
+        const dimension_size_type ty = y / tileHeight;
+        const dimension_size_type index = ty * tilesX + tx;
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        auto found = tiles.find(index);
+        if (found != tiles.end())
+          {
+            lru.splice(lru.begin(), lru, found->second.second);
+            return found->second.first;
+          }
+
+        if (reader->getSeries() != series || reader->getResolution() != resolution)
+          throw std::logic_error("Reader series or resolution changed since the view was created");
+
+        const dimension_size_type x0 = tx * tileWidth;
+        const dimension_size_type y0 = ty * tileHeight;
+        std::shared_ptr<PixelBuffer<T>> buf;
+        reader->openBytes(plane, buf, x0, y0,
+                          std::min(tileWidth, sizeX - x0),
+                          std::min(tileHeight, sizeY - y0));
+        ++decoded;
+
+        while (tiles.size() >= maxTiles)
+          {
+            tiles.erase(lru.back());
+            lru.pop_back();
+          }
+        lru.push_front(index);
+        tile_type t(buf);
+        tiles.insert(std::make_pair(index, std::make_pair(t, lru.begin())));
+        return t;
+      }
+
+    private:
+      void
+      checkIndex(PixelBufferBase::index x,
+                 PixelBufferBase::index y) const
+      {
+        if (x < 0 || y < 0 ||
+            static_cast<dimension_size_type>(x) >= sizeX ||
+            static_cast<dimension_size_type>(y) >= sizeY)
+          {
+            boost::format fmt("Position (%1%, %2%) is outside the %3%×%4% plane");
+            fmt % x % y % sizeX % sizeY;
+            throw std::out_of_range(fmt.str());
+          }
+      }
+
+      /// The reader.
+      std::shared_ptr<const FormatReader> reader;
+      /// The plane index.
+      dimension_size_type plane;
+      /// The series of the plane.
+      dimension_size_type series;
+      /// The resolution of the plane.
+      dimension_size_type resolution;
+      /// Plane width.
+      dimension_size_type sizeX;
+      /// Plane height.
+      dimension_size_type sizeY;
+      /// Tile width.
+      dimension_size_type tileWidth;
+      /// Tile height.
+      dimension_size_type tileHeight;
+      /// Number of tiles in each row.
+      dimension_size_type tilesX;
+      /// Maximum number of retained tiles.
+      dimension_size_type maxTiles;
+      /// Lock for the tiles.
+      mutable std::mutex mutex;
+      /// Retained tiles, by tile index, with their position in lru.
+      mutable std::unordered_map<dimension_size_type,
+                                 std::pair<tile_type, std::list<dimension_size_type>::iterator>> tiles;
+      /// Tile indexes, most recently used first.
+      mutable std::list<dimension_size_type> lru;
+      /// Number of tiles decoded.
+      mutable dimension_size_type decoded;
+    };
+
+  }
+}
+
+#endif // OME_FILES_TILEDPLANEVIEW_H
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
@@ -0,0 +1,142 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+
+#include <mutex>
+
+#include <ome/files/TraceObserver.h>
+
+namespace
+{
+
+  // Registered observer.
+  struct ObserverRegistry
+  {
+    std::mutex                                  mutex;
+    std::shared_ptr<ome::files::TraceObserver> observer;
+  };
+
+  ObserverRegistry&
+  observerRegistry()
+  {
+    static ObserverRegistry registry;
+    return registry;
+  }
+
+}
+
+namespace ome
+{
+  namespace files
+  {
+
+    const std::size_t TraceObserver::event_count;
+
+    std::atomic<bool> TraceScope::enabled(false);
+
+    TraceObserver::TraceObserver()
+    {
+    }
+
+    TraceObserver::~TraceObserver()
+    {
+    }
+
+    const char *
+    TraceObserver::name(Event event)
+    {
+      static const char *names[event_count] =
+        {
+          "file open",
+          "directory read",
+          "tile read",
+          "tile decode",
+          "tile encode",
+          "OME-XML parse",
+          "OME-XML serialize"
+        };
+      return names[event];
+    }
+
+    void
+    setTraceObserver(const std::shared_ptr<TraceObserver>& observer)
+    {
+      ObserverRegistry& registry(observerRegistry());
+      std::lock_guard<std::mutex> lock(registry.mutex);
+      registry.observer = observer;
+      TraceScope::enabled.store(static_cast<bool>(observer), std::memory_order_relaxed);
+    }
+
+    std::shared_ptr<TraceObserver>
+    getTraceObserver()
+    {
+      ObserverRegistry& registry(observerRegistry());
+      std::lock_guard<std::mutex> lock(registry.mutex);
+      return registry.observer;
+    }
+
+    void
+    TraceScope::start(const boost::filesystem::path *file,
+                      uint64_t                       directory,
+                      uint64_t                       tile)
+    {
+      observer = getTraceObserver();
+      if (observer)
+        {
+          context.file = file;
+          context.directory = directory;
+          context.tile = tile;
+          observer->begin(event, context);
+        }
+    }
+
+    void
+    TraceScope::finish()
+    {
+      try
+        {
+          observer->end(event, context);
+        }
+      catch (...)
+        {
+          // Observers must not throw, but exceptions can not be
+          // allowed to escape the destructor.
+        }
+    }
+
+  }
+}
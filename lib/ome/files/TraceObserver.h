@@ -0,0 +1,251 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+
+#ifndef OME_FILES_TRACEOBSERVER_H
+#define OME_FILES_TRACEOBSERVER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include <boost/filesystem/path.hpp>
+
+namespace ome
+{
+  namespace files
+  {
+
+    /**
+     * Observer of I/O and decode events.
+     *
+     * This permits tracing systems to record the time spent in
+     * opening files, reading directories, reading, decoding and
+     * encoding tiles, and parsing and serializing OME-XML.  A begin
+     * and end callback is made for each event; the end callback is
+     * also made if the event fails with an exception.
+     *
+     * Callbacks may be made concurrently from several threads, and
+     * events on the same thread may be nested (for example, a tile
+     * read within a file open).  Callbacks must not throw.
+     *
+     * A single observer is registered for the whole library with
+     * setTraceObserver().  When no observer is registered, the cost
+     * of each event is a single relaxed atomic load.
+     */
+    class TraceObserver
+    {
+    public:
+      /// Traced events.
+      enum Event
+        {
+          FILE_OPEN,      ///< Opening a TIFF file.
+          DIRECTORY_READ, ///< Reading or switching to a TIFF directory.
+          TILE_READ,      ///< Reading raw tile or strip data.
+          TILE_DECODE,    ///< Decoding a tile or strip (including reading if done by libtiff).
+          TILE_ENCODE,    ///< Encoding a tile or strip (including writing if done by libtiff).
+          XML_PARSE,      ///< Parsing OME-XML metadata.
+          XML_SERIALIZE   ///< Serializing OME-XML metadata.
+        };
+
+      /// Number of events.
+      static const std::size_t event_count = XML_SERIALIZE + 1U;
+
+      /// Event context.
+      struct Context
+      {
+        /// File name, or null if not applicable or unknown.
+        const boost::filesystem::path *file;
+        /// TIFF directory offset, or zero if not applicable.
+        uint64_t directory;
+        /// Tile or strip index, or zero if not applicable.
+        uint64_t tile;
+      };
+
+      /// Constructor.
+      TraceObserver();
+
+      /// Destructor.
+      virtual
+      ~TraceObserver();
+
+      /// @cond SKIP
+      TraceObserver (const TraceObserver&) = delete;
+
+      TraceObserver&
+      operator= (const TraceObserver&) = delete;
+      /// @endcond SKIP
+
+      /**
+       * An event has begun.
+       *
+       * @param event the event.
+       * @param context the event context.
+       */
+      virtual
+      void
+      begin(Event          event,
+            const Context& context) = 0;
+
+      /**
+       * An event has ended.
+       *
+       * @param event the event.
+       * @param context the event context.
+       */
+      virtual
+      void
+      end(Event          event,
+          const Context& context) = 0;
+
+      /**
+       * Get the name of an event.
+       *
+       * @param event the event.
+       * @returns the name.
+       */
+      static const char *
+      name(Event event);
+    };
+
+    /**
+     * Set the trace observer.
+     *
+     * Events already begun will end using the observer in use when
+     * they began.
+     *
+     * @param observer the observer to use, or null to disable
+     * tracing.
+     */
+    void
+    setTraceObserver(const std::shared_ptr<TraceObserver>& observer);
+
+    /**
+     * Get the trace observer.
+     *
+     * @returns the observer, or null if tracing is disabled.
+     */
+    std::shared_ptr<TraceObserver>
+    getTraceObserver();
+
+    /**
+     * Scoped trace event.
+     *
+     * The begin callback is made on construction and the end
+     * callback on destruction, if an observer is registered.
+     */
+    class TraceScope
+    {
+    public:
+      /**
+       * Constructor.
+       *
+       * @param event the event.
+       * @param file the file name, or null if not applicable.
+       * @param directory the TIFF directory offset, or zero if not
+       * applicable.
+       * @param tile the tile or strip index, or zero if not
+       * applicable.
+       */
+      explicit
+      TraceScope(TraceObserver::Event           event,
+                 const boost::filesystem::path *file = nullptr,
+                 uint64_t                       directory = 0U,
+                 uint64_t                       tile = 0U):
+        observer(),
+        event(event),
+        context()
+      {
+        if (enabled.load(std::memory_order_relaxed))
+          start(file, directory, tile);
+      }
+
+      /// Destructor.
+      ~TraceScope()
+      {
+        if (observer)
+          finish();
+      }
+
+      /// @cond SKIP
+      TraceScope (const TraceScope&) = delete;
+
+      TraceScope&
+      operator= (const TraceScope&) = delete;
+      /// @endcond SKIP
+
+    private:
+      /**
+       * Begin the event with the registered observer, if any.
+       *
+       * @param file the file name.
+       * @param directory the TIFF directory offset.
+       * @param tile the tile or strip index.
+       */
+      void
+      start(const boost::filesystem::path *file,
+            uint64_t                       directory,
+            uint64_t                       tile);
+
+      /// End the event.
+      void
+      finish();
+
+      /// Observer for this event, or null if not traced.
+      std::shared_ptr<TraceObserver> observer;
+      /// Event.
+      TraceObserver::Event event;
+      /// Event context.
+      TraceObserver::Context context;
+      /// An observer is registered.
+      static std::atomic<bool> enabled;
+
+      friend void
+      setTraceObserver(const std::shared_ptr<TraceObserver>& observer);
+    };
+
+  }
+}
+
+#endif // OME_FILES_TRACEOBSERVER_H
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
@@ -71,6 +71,23 @@ namespace ome
         ENDIAN_NATIVE  ///< Native endian.
       };
 
+    /// Expected pattern of reading written image data.
+    enum AccessProfile
+      {
+        ACCESS_SEQUENTIAL,      ///< Whole planes, read in order.
+        ACCESS_RANDOM_VIEWPORT, ///< Screen-sized regions at random positions.
+        ACCESS_Z_COLUMN         ///< Small regions at the same position in many planes.
+      };
+
+    /// Advice about upcoming reading of image data.
+    enum AccessHint
+      {
+        HINT_NORMAL,     ///< No particular pattern (the default).
+        HINT_SEQUENTIAL, ///< Data will be read in order.
+        HINT_RANDOM,     ///< Data will be read at random positions.
+        HINT_WILLNEED    ///< Data will be read soon.
+      };
+
   }
 }
 
@@ -35,7 +35,12 @@
  * #L%
  */
 
+#include <cstdint>
+#include <stdexcept>
 #include <type_traits>
+#include <utility>
+
+#include <boost/format.hpp>
 
 #include <ome/files/VariantPixelBuffer.h>
 
@@ -316,12 +321,47 @@ namespace ome
   {
 
     VariantPixelBuffer::VariantPixelBuffer(const VariantPixelBuffer& buffer):
-      buffer()
+      buffer(),
+      external(buffer.external),
+      externalSize(buffer.externalSize),
+      allocator(buffer.allocator)
     {
       PBCopyVisitor v(this->buffer);
       boost::apply_visitor(v, buffer.buffer);
     }
 
+    VariantPixelBuffer::VariantPixelBuffer(VariantPixelBuffer&& buffer):
+      buffer(std::move(buffer.buffer)),
+      external(buffer.external),
+      externalSize(buffer.externalSize),
+      allocator(std::move(buffer.allocator))
+    {
+      buffer.external = nullptr;
+      buffer.externalSize = 0U;
+    }
+
+    void
+    VariantPixelBuffer::checkExternalAlignment(std::size_t alignment) const
+    {
+      if (reinterpret_cast<std::uintptr_t>(external) % alignment)
+        {
+          boost::format fmt("External pixel storage is not aligned to %1% bytes");
+          fmt % alignment;
+          throw std::logic_error(fmt.str());
+        }
+    }
+
+    void
+    VariantPixelBuffer::checkExternalSize(size_type size) const
+    {
+      if (size > externalSize)
+        {
+          boost::format fmt("External pixel storage too small: %1% bytes required, but only %2% bytes available");
+          fmt % size % externalSize;
+          throw std::logic_error(fmt.str());
+        }
+    }
+
     bool
     VariantPixelBuffer::valid() const
     {
@@ -413,6 +453,25 @@ namespace ome
       return *this;
     }
 
+    VariantPixelBuffer&
+    VariantPixelBuffer::operator = (VariantPixelBuffer&& rhs)
+    {
+      if (this != &rhs)
+        {
+          // The external storage must be reused, so copy into it.
+          if (external)
+            return *this = static_cast<const VariantPixelBuffer&>(rhs);
+
+          buffer = std::move(rhs.buffer);
+          external = rhs.external;
+          externalSize = rhs.externalSize;
+          allocator = std::move(rhs.allocator);
+          rhs.external = nullptr;
+          rhs.externalSize = 0U;
+        }
+      return *this;
+    }
+
     bool
     VariantPixelBuffer::operator == (const VariantPixelBuffer& rhs) const
     {
@@ -159,7 +159,10 @@ namespace ome
        */
       explicit
       VariantPixelBuffer():
-        buffer(createBuffer(boost::extents[1][1][1][1][1][1][1][1][1]))
+        buffer(createBuffer(boost::extents[1][1][1][1][1][1][1][1][1])),
+        external(nullptr),
+        externalSize(0U),
+        allocator()
       {
       }
 
@@ -172,13 +175,83 @@ namespace ome
        * @param storage the storage ordering, defaulting to C array
        * storage ordering.
        * @param pixeltype the pixel type to store.
+       * @param init the initialization of the pixel storage.
        */
       template<class ExtentList>
       explicit
       VariantPixelBuffer(const ExtentList&                   extents,
                          ::ome::xml::model::enums::PixelType pixeltype = ::ome::xml::model::enums::PixelType::UINT8,
-                         const storage_order_type&           storage = PixelBufferBase::default_storage_order()):
-        buffer(createBuffer(extents, pixeltype, storage))
+                         const storage_order_type&           storage = PixelBufferBase::default_storage_order(),
+                         PixelInitialization                 init = PIXEL_VALUE_INITIALIZED):
+        buffer(createBuffer(extents, pixeltype, storage, init)),
+        external(nullptr),
+        externalSize(0U),
+        allocator()
+      {
+      }
+
+      /**
+       * Construct from extents (external storage).
+       *
+       * Storage for the buffer must be pre-allocated by the caller,
+       * suitably aligned for the pixel type, and must exist for the
+       * lifetime of this object.  The buffer will never be
+       * reallocated: setBuffer() will reuse the external storage,
+       * so that a buffer of this type passed to
+       * FormatReader::openBytes() will be read into directly.
+       *
+       * @param pixeldata the externally-provided storage for pixel
+       * data.
+       * @param size the size of the external storage, in bytes.
+       * @param extents the extent of each dimension.
+       * @param pixeltype the pixel type to store.
+       * @param storage the storage ordering, defaulting to C array
+       * storage ordering.
+       * @throws std::logic_error if the external storage is too
+       * small or incorrectly aligned.
+       */
+      template<class ExtentList>
+      explicit
+      VariantPixelBuffer(void                                *pixeldata,
+                         size_type                            size,
+                         const ExtentList&                    extents,
+                         ::ome::xml::model::enums::PixelType  pixeltype = ::ome::xml::model::enums::PixelType::UINT8,
+                         const storage_order_type&            storage = PixelBufferBase::default_storage_order()):
+        buffer(),
+        external(pixeldata),
+        externalSize(size),
+        allocator()
+      {
+        setBuffer(extents, pixeltype, storage);
+      }
+
+      /**
+       * Construct from extents (allocator-provided storage).
+       *
+       * Storage for the buffer will be allocated from the
+       * allocator.  The allocator is retained, and will be used by
+       * all subsequent calls to setBuffer(), so that a buffer of
+       * this type passed to FormatReader::openBytes() will be read
+       * into storage obtained from the allocator.
+       *
+       * @param allocator the allocator for the pixel storage.
+       * @param extents the extent of each dimension.
+       * @param pixeltype the pixel type to store.
+       * @param storage the storage ordering, defaulting to C array
+       * storage ordering.
+       * @param init the initialization of the pixel storage.
+       */
+      template<class ExtentList>
+      explicit
+      VariantPixelBuffer(const std::shared_ptr<PixelAllocator>& allocator,
+                         const ExtentList&                      extents,
+                         ::ome::xml::model::enums::PixelType    pixeltype = ::ome::xml::model::enums::PixelType::UINT8,
+                         const storage_order_type&              storage = PixelBufferBase::default_storage_order(),
+                         PixelInitialization                    init = PIXEL_VALUE_INITIALIZED):
+        buffer(createBuffer(extents, pixeltype, storage, init, allocator)),
+        external(nullptr),
+        externalSize(0U),
+        allocator(allocator)
       {
       }
 
@@ -191,12 +264,17 @@ namespace ome
        * @param storage the storage ordering, defaulting to C array
        * storage ordering.
        * @param pixeltype the pixel type to store.
+       * @param init the initialization of the pixel storage.
        */
       explicit
       VariantPixelBuffer(const range_type&                   range,
                          ::ome::xml::model::enums::PixelType pixeltype = ::ome::xml::model::enums::PixelType::UINT8,
-                         const storage_order_type&           storage = PixelBufferBase::default_storage_order()):
-        buffer(createBuffer(range, pixeltype, storage))
+                         const storage_order_type&           storage = PixelBufferBase::default_storage_order(),
+                         PixelInitialization                 init = PIXEL_VALUE_INITIALIZED):
+        buffer(createBuffer(range, pixeltype, storage, init)),
+        external(nullptr),
+        externalSize(0U),
+        allocator()
       {
       }
 
@@ -211,6 +289,18 @@ namespace ome
       explicit
       VariantPixelBuffer(const VariantPixelBuffer& buffer);
 
+      /**
+       * Move constructor.
+       *
+       * The pixel data is transferred without copying, along with
+       * any external storage and allocator.  The moved-from buffer
+       * no longer references any pixel data; it may be destroyed,
+       * move-assigned to, or reinitialized with setBuffer().
+       *
+       * @param buffer the buffer to move.
+       */
+      VariantPixelBuffer(VariantPixelBuffer&& buffer);
+
       /**
        * Construct from existing pixel buffer.  Use for referencing external data.
        *
@@ -219,7 +309,10 @@ namespace ome
       template<typename T>
       explicit
       VariantPixelBuffer(std::shared_ptr<PixelBuffer<T>>& buffer):
-        buffer(buffer)
+        buffer(buffer),
+        external(nullptr),
+        externalSize(0U),
+        allocator()
       {
       }
 
@@ -260,15 +353,20 @@ namespace ome
        * @param storage the storage ordering, defaulting to C array
        * storage ordering.
        * @param pixeltype the pixel type to store.
+       * @param init the initialization of the pixel storage.
+       * @param allocator the allocator for the pixel storage, or
+       * null to use the default allocator.
        * @returns the new buffer contained in a variant.
        */
       template<class T, class ExtentList>
       static variant_buffer_type
-      makeBuffer(const ExtentList&                   extents,
-                 const storage_order_type&           storage,
-                 ::ome::xml::model::enums::PixelType pixeltype)
+      makeBuffer(const ExtentList&                      extents,
+                 const storage_order_type&              storage,
+                 ::ome::xml::model::enums::PixelType    pixeltype,
+                 PixelInitialization                    init,
+                 const std::shared_ptr<PixelAllocator>& allocator)
       {
-        return variant_buffer_type(std::shared_ptr<PixelBuffer<T>>(new PixelBuffer<T>(extents, pixeltype, ENDIAN_NATIVE, storage)));
+        return variant_buffer_type(std::shared_ptr<PixelBuffer<T>>(new PixelBuffer<T>(extents, pixeltype, ENDIAN_NATIVE, storage, init, allocator)));
       }
 
       /**
@@ -280,17 +378,64 @@ namespace ome
        * @param storage the storage ordering, defaulting to C array
        * storage ordering.
        * @param pixeltype the pixel type to store.
+       * @param init the initialization of the pixel storage.
+       * @param allocator the allocator for the pixel storage, or
+       * null to use the default allocator.
        * @returns the new buffer contained in a variant.
        */
       template<class T>
       static variant_buffer_type
-      makeBuffer(const range_type&                   range,
-                 const storage_order_type&           storage,
-                 ::ome::xml::model::enums::PixelType pixeltype)
+      makeBuffer(const range_type&                      range,
+                 const storage_order_type&              storage,
+                 ::ome::xml::model::enums::PixelType    pixeltype,
+                 PixelInitialization                    init,
+                 const std::shared_ptr<PixelAllocator>& allocator)
       {
-        return variant_buffer_type(std::shared_ptr<PixelBuffer<T>>(new PixelBuffer<T>(range, pixeltype, ENDIAN_NATIVE, storage)));
+        return variant_buffer_type(std::shared_ptr<PixelBuffer<T>>(new PixelBuffer<T>(range, pixeltype, ENDIAN_NATIVE, storage, init, allocator)));
       }
 
+      /**
+       * Create buffer from extents or ranges using the external
+       * storage (helper).
+       *
+       * @param extents the extent or range of each dimension.
+       * @param storage the storage ordering.
+       * @param pixeltype the pixel type to store.
+       * @returns the new buffer contained in a variant.
+       * @throws std::logic_error if the external storage is too
+       * small or incorrectly aligned.
+       */
+      template<class T, class ExtentList>
+      variant_buffer_type
+      makeExternalBuffer(const ExtentList&                   extents,
+                         const storage_order_type&           storage,
+                         ::ome::xml::model::enums::PixelType pixeltype) const
+      {
+        checkExternalAlignment(alignof(T));
+        std::shared_ptr<PixelBuffer<T>> buf(new PixelBuffer<T>(static_cast<T *>(external), extents,
+                                                               pixeltype, ENDIAN_NATIVE, storage));
+        checkExternalSize(buf->num_elements() * sizeof(T));
+        return variant_buffer_type(buf);
+      }
+
+      /**
+       * Check the alignment of the external storage.
+       *
+       * @param alignment the required alignment.
+       * @throws std::logic_error if incorrectly aligned.
+       */
+      void
+      checkExternalAlignment(std::size_t alignment) const;
+
+      /**
+       * Check the size of the external storage.
+       *
+       * @param size the required size, in bytes.
+       * @throws std::logic_error if too small.
+       */
+      void
+      checkExternalSize(size_type size) const;
+
       // No switch default to avoid -Wunreachable-code errors.
       // However, this then makes -Wswitch-default complain.  Disable
       // temporarily.
@@ -301,7 +446,7 @@ namespace ome
 
 #define OME_FILES_VARIANTPIXELBUFFER_CREATEEXTENTS_CASE(maR, maProperty, maType) \
           case ::ome::xml::model::enums::PixelType::maType:                      \
-            buf = makeBuffer<PixelProperties<::ome::xml::model::enums::PixelType::maType>::std_type>(extents, storage, pixeltype); \
+            buf = makeBuffer<PixelProperties<::ome::xml::model::enums::PixelType::maType>::std_type>(extents, storage, pixeltype, init, allocator); \
             break;
 
       /**
@@ -313,13 +458,18 @@ namespace ome
        * @param pixeltype the pixel type to store.
        * @param storage the storage ordering, defaulting to C array
        * storage ordering.
+       * @param init the initialization of the pixel storage.
+       * @param allocator the allocator for the pixel storage, or
+       * null to use the default allocator.
        * @returns the new buffer contained in a variant.
        */
       template<class ExtentList>
       static variant_buffer_type
-      createBuffer(const ExtentList&                   extents,
-                   ::ome::xml::model::enums::PixelType pixeltype = ::ome::xml::model::enums::PixelType::UINT8,
-                   const storage_order_type&           storage = PixelBufferBase::default_storage_order())
+      createBuffer(const ExtentList&                      extents,
+                   ::ome::xml::model::enums::PixelType    pixeltype = ::ome::xml::model::enums::PixelType::UINT8,
+                   const storage_order_type&              storage = PixelBufferBase::default_storage_order(),
+                   PixelInitialization                    init = PIXEL_VALUE_INITIALIZED,
+                   const std::shared_ptr<PixelAllocator>& allocator = std::shared_ptr<PixelAllocator>())
       {
         variant_buffer_type buf;
 
@@ -335,7 +485,7 @@ namespace ome
 
 #define OME_FILES_VARIANTPIXELBUFFER_CREATERANGE_CASE(maR, maProperty, maType) \
           case ::ome::xml::model::enums::PixelType::maType:                    \
-            buf = makeBuffer<PixelProperties<::ome::xml::model::enums::PixelType::maType>::std_type>(range, storage, pixeltype); \
+            buf = makeBuffer<PixelProperties<::ome::xml::model::enums::PixelType::maType>::std_type>(range, storage, pixeltype, init, allocator); \
             break;
 
       /**
@@ -347,12 +497,17 @@ namespace ome
        * @param pixeltype the pixel type to store.
        * @param storage the storage ordering, defaulting to C array
        * storage ordering.
+       * @param init the initialization of the pixel storage.
+       * @param allocator the allocator for the pixel storage, or
+       * null to use the default allocator.
        * @returns the new buffer contained in a variant.
        */
       static variant_buffer_type
-      createBuffer(const range_type&                   range,
-                   ::ome::xml::model::enums::PixelType pixeltype = ::ome::xml::model::enums::PixelType::UINT8,
-                   const storage_order_type&           storage = PixelBufferBase::default_storage_order())
+      createBuffer(const range_type&                      range,
+                   ::ome::xml::model::enums::PixelType    pixeltype = ::ome::xml::model::enums::PixelType::UINT8,
+                   const storage_order_type&              storage = PixelBufferBase::default_storage_order(),
+                   PixelInitialization                    init = PIXEL_VALUE_INITIALIZED,
+                   const std::shared_ptr<PixelAllocator>& allocator = std::shared_ptr<PixelAllocator>())
       {
         variant_buffer_type buf;
 
@@ -366,6 +521,40 @@ namespace ome
 
 #undef OME_FILES_VARIANTPIXELBUFFER_CREATERANGE_CASE
 
+#define OME_FILES_VARIANTPIXELBUFFER_CREATEEXTERNAL_CASE(maR, maProperty, maType) \
+          case ::ome::xml::model::enums::PixelType::maType:                       \
+            buf = makeExternalBuffer<PixelProperties<::ome::xml::model::enums::PixelType::maType>::std_type>(extents, storage, pixeltype); \
+            break;
+
+      /**
+       * Create buffer from extents or ranges using the external
+       * storage.
+       *
+       * @param extents the extent or range of each dimension.
+       * @param pixeltype the pixel type to store.
+       * @param storage the storage ordering.
+       * @returns the new buffer contained in a variant.
+       * @throws std::logic_error if the external storage is too
+       * small or incorrectly aligned.
+       */
+      template<class ExtentList>
+      variant_buffer_type
+      createExternalBuffer(const ExtentList&                   extents,
+                           ::ome::xml::model::enums::PixelType pixeltype,
+                           const storage_order_type&           storage) const
+      {
+        variant_buffer_type buf;
+
+        switch(pixeltype)
+          {
+            BOOST_PP_SEQ_FOR_EACH(OME_FILES_VARIANTPIXELBUFFER_CREATEEXTERNAL_CASE, _, OME_XML_MODEL_ENUMS_PIXELTYPE_VALUES);
+          }
+
+        return buf;
+      }
+
+#undef OME_FILES_VARIANTPIXELBUFFER_CREATEEXTERNAL_CASE
+
 #ifdef __GNUC__
 #  pragma GCC diagnostic pop
 #endif
@@ -374,38 +563,88 @@ namespace ome
       /**
        * Set the buffer from extents (helper).
        *
-       * Storage for the buffer will be allocated internally.
+       * Storage for the buffer will be allocated internally, from
+       * the allocator if one is set, unless the buffer was
+       * constructed with external storage, in which case the
+       * external storage will be reused.  External storage is never
+       * reinitialized.
        *
        * @param extents the extent of each dimension.
        * @param pixeltype the pixel type to store.
        * @param storage the storage ordering, defaulting to C array
        * storage ordering.
+       * @param init the initialization of the pixel storage; use
+       * PIXEL_UNINITIALIZED only if every pixel will be written
+       * before being read.
        */
       template<class ExtentList>
       void
       setBuffer(const ExtentList&                   extents,
                 ::ome::xml::model::enums::PixelType pixeltype = ::ome::xml::model::enums::PixelType::UINT8,
-                const storage_order_type&           storage = PixelBufferBase::default_storage_order())
+                const storage_order_type&           storage = PixelBufferBase::default_storage_order(),
+                PixelInitialization                 init = PIXEL_VALUE_INITIALIZED)
       {
-        buffer = createBuffer(extents, pixeltype, storage);
+        if (external)
+          buffer = createExternalBuffer(extents, pixeltype, storage);
+        else
+          buffer = createBuffer(extents, pixeltype, storage, init, allocator);
       }
 
       /**
-       * Set the buffer from ranges (internal storage).
+       * Set the buffer from ranges (helper).
        *
-       * Storage for the buffer will be allocated internally.
+       * Storage for the buffer will be allocated internally, from
+       * the allocator if one is set, unless the buffer was
+       * constructed with external storage, in which case the
+       * external storage will be reused.  External storage is never
+       * reinitialized.
        *
        * @param range the range of each dimension.
        * @param pixeltype the pixel type to store.
        * @param storage the storage ordering, defaulting to C array
        * storage ordering.
+       * @param init the initialization of the pixel storage; use
+       * PIXEL_UNINITIALIZED only if every pixel will be written
+       * before being read.
        */
       void
       setBuffer(const range_type&                   range,
                 ::ome::xml::model::enums::PixelType pixeltype = ::ome::xml::model::enums::PixelType::UINT8,
-                const storage_order_type&           storage = PixelBufferBase::default_storage_order())
+                const storage_order_type&           storage = PixelBufferBase::default_storage_order(),
+                PixelInitialization                 init = PIXEL_VALUE_INITIALIZED)
+      {
+        if (external)
+          buffer = createExternalBuffer(range, pixeltype, storage);
+        else
+          buffer = createBuffer(range, pixeltype, storage, init, allocator);
+      }
+
+      /**
+       * Get the allocator used for internal storage.
+       *
+       * @returns the allocator, or null if using the default
+       * allocator.
+       */
+      const std::shared_ptr<PixelAllocator>&
+      getAllocator() const
       {
-        buffer = createBuffer(range, pixeltype, storage);
+        return allocator;
+      }
+
+      /**
+       * Set the allocator used for internal storage.
+       *
+       * The allocator will be used by all subsequent calls to
+       * setBuffer(); the current storage is not reallocated.  It
+       * has no effect if the buffer uses external storage.
+       *
+       * @param allocator the allocator, or null to use the default
+       * allocator.
+       */
+      void
+      setAllocator(const std::shared_ptr<PixelAllocator>& allocator)
+      {
+        this->allocator = allocator;
       }
 
       /**
@@ -591,6 +830,22 @@ namespace ome
       VariantPixelBuffer&
       operator = (const VariantPixelBuffer& rhs);
 
+      /**
+       * Move a pixel buffer.
+       *
+       * The pixel data, pixel type, extents and storage order of @p
+       * rhs are transferred without copying, along with any external
+       * storage and allocator, and @p rhs no longer references any
+       * pixel data; the extents need not be compatible.  However, if
+       * this buffer was constructed with external storage, which is
+       * never replaced, this is equivalent to copy assignment.
+       *
+       * @param rhs the pixel buffer to move.
+       * @returns the assigned buffer.
+       */
+      VariantPixelBuffer&
+      operator = (VariantPixelBuffer&& rhs);
+
       /**
        * Compare a pixel buffer for equality.
        *
@@ -653,6 +908,12 @@ namespace ome
     protected:
       /// Pixel storage.
       variant_buffer_type buffer;
+      /// External storage for pixel data, or null if internal.
+      void *external;
+      /// Size of the external storage, in bytes.
+      size_type externalSize;
+      /// Allocator for internal storage, or null for the default.
+      std::shared_ptr<PixelAllocator> allocator;
     };
 
     namespace detail
@@ -875,7 +1136,7 @@ namespace ome
 
           /// @todo Only call setBuffer if the shape and pixel type
           /// differ, to allow user control over storage order.
-          dest.setBuffer(dest_shape, v->pixelType(), order);
+          dest.setBuffer(dest_shape, v->pixelType(), order, PIXEL_UNINITIALIZED);
 
           T& destbuf = boost::get<T>(dest.vbuffer());
 
@@ -35,7 +35,9 @@
  * #L%
  */
 
+#include <atomic>
 #include <cctype>
+#include <memory>
 
 #include <ome/files/XMLTools.h>
 
@@ -44,6 +46,18 @@
 #include <ome/common/xml/String.h>
 
 #include <ome/xml/Document.h>
+#include <ome/xml/OMEEntityResolver.h>
+#include <ome/xml/version.h>
+
+#include <xercesc/framework/MemBufInputSource.hpp>
+#include <xercesc/framework/XMLGrammarPoolImpl.hpp>
+#include <xercesc/sax/SAXException.hpp>
+#include <xercesc/sax/SAXParseException.hpp>
+#include <xercesc/sax2/DefaultHandler.hpp>
+#include <xercesc/sax2/SAX2XMLReader.hpp>
+#include <xercesc/sax2/XMLReaderFactory.hpp>
+#include <xercesc/util/XMLException.hpp>
+#include <xercesc/util/XMLUni.hpp>
 
 namespace xml = ome::common::xml;
 
@@ -53,6 +67,180 @@ namespace
   const std::string xsi_ns("http://www.w3.org/2001/XMLSchema-instance");
   const std::string xml_schema_path("http://www.w3.org/2001/XMLSchema");
 
+  /// Set once the schema grammar cache has been constructed.
+  std::atomic<bool> grammarCacheLoaded(false);
+
+  /**
+   * Count validation errors without terminating the parse.
+   */
+  class ValidationHandler : public xercesc::DefaultHandler
+  {
+  public:
+    /// Number of errors.
+    unsigned int errors;
+
+    /// Constructor.
+    ValidationHandler():
+      xercesc::DefaultHandler(),
+      errors(0U)
+    {
+    }
+
+    void
+    error(const xercesc::SAXParseException& /* e */)
+    {
+      ++errors;
+    }
+
+    void
+    fatalError(const xercesc::SAXParseException& e)
+    {
+      ++errors;
+      throw e;
+    }
+  };
+
+  /**
+   * Set the parser features common to loading and validation.
+   *
+   * @param parser the parser to configure.
+   */
+  void
+  setValidationFeatures(xercesc::SAX2XMLReader& parser)
+  {
+    parser.setFeature(xercesc::XMLUni::fgSAX2CoreNameSpaces, true);
+    parser.setFeature(xercesc::XMLUni::fgSAX2CoreValidation, true);
+    parser.setFeature(xercesc::XMLUni::fgXercesDynamic, true);
+    parser.setFeature(xercesc::XMLUni::fgXercesSchema, true);
+    parser.setFeature(xercesc::XMLUni::fgXercesSchemaFullChecking, false);
+    parser.setFeature(xercesc::XMLUni::fgXercesHandleMultipleImports, true);
+    parser.setFeature(xercesc::XMLUni::fgXercesLoadExternalDTD, false);
+  }
+
+  /**
+   * Process-wide cache of the compiled OME-XML schema grammar.
+   *
+   * The schema is loaded and compiled once, on first use, after
+   * which the grammar pool is locked.  A locked pool is read-only,
+   * and may be shared between parsers in any number of threads.
+   * Schemas for other namespaces (for example, older OME-XML model
+   * versions) are still loaded on demand by each parser, but are not
+   * added to the pool.
+   */
+  class GrammarCache
+  {
+  public:
+    /**
+     * Get the grammar cache.
+     *
+     * @returns the process-wide grammar cache.
+     */
+    static GrammarCache&
+    instance()
+    {
+      static GrammarCache cache;
+      return cache;
+    }
+
+    /**
+     * Check if the current OME-XML schema was loaded.
+     *
+     * @returns @c true if loaded, or @c false if loading failed.
+     */
+    bool
+    loaded() const
+    {
+      return schemaLoaded;
+    }
+
+    /**
+     * Validate an XML string using the cached grammar.
+     *
+     * @param s the string to validate.
+     * @param loc the file location or other descriptive text for the
+     * string.
+     * @returns @c true if valid, @c false if invalid.
+     */
+    bool
+    validate(const std::string& s,
+             const std::string& loc)
+    {
+      std::unique_ptr<xercesc::SAX2XMLReader> parser(xercesc::XMLReaderFactory::createXMLReader(xercesc::XMLPlatformUtils::fgMemoryManager,
+                                                                                                pool.get()));
+      setValidationFeatures(*parser);
+      parser->setFeature(xercesc::XMLUni::fgXercesUseCachedGrammarInParse, true);
+      parser->setFeature(xercesc::XMLUni::fgXercesCacheGrammarFromParse, false);
+
+      ome::xml::OMEEntityResolver resolver;
+      parser->setXMLEntityResolver(&resolver);
+      ValidationHandler handler;
+      parser->setErrorHandler(&handler);
+
+      xercesc::MemBufInputSource source(reinterpret_cast<const XMLByte *>(s.c_str()),
+                                        static_cast<XMLSize_t>(s.size()),
+                                        xml::String(loc));
+
+      try
+        {
+          parser->parse(source);
+        }
+      catch (const xercesc::SAXException&)
+        {
+          return false;
+        }
+      catch (const xercesc::XMLException&)
+        {
+          return false;
+        }
+
+      return handler.errors == 0U;
+    }
+
+  private:
+    /// Constructor; load the current OME-XML schema into the pool.
+    GrammarCache():
+      platform(),
+      pool(new xercesc::XMLGrammarPoolImpl(xercesc::XMLPlatformUtils::fgMemoryManager)),
+      schemaLoaded(false)
+    {
+      try
+        {
+          std::unique_ptr<xercesc::SAX2XMLReader> loader(xercesc::XMLReaderFactory::createXMLReader(xercesc::XMLPlatformUtils::fgMemoryManager,
+                                                                                                    pool.get()));
+          setValidationFeatures(*loader);
+
+          ome::xml::OMEEntityResolver resolver;
+          loader->setXMLEntityResolver(&resolver);
+          ValidationHandler handler;
+          loader->setErrorHandler(&handler);
+
+          xml::String schema("http://www.openmicroscopy.org/Schemas/OME/" OME_XML_MODEL_VERSION "/ome.xsd");
+          schemaLoaded = loader->loadGrammar(schema, xercesc::Grammar::SchemaGrammarType, true) != 0 &&
+            handler.errors == 0U;
+        }
+      catch (...)
+        {
+          schemaLoaded = false;
+        }
+      pool->lockPool();
+      grammarCacheLoaded = true;
+    }
+
+    /// @cond SKIP
+    GrammarCache(const GrammarCache&) = delete;
+
+    GrammarCache&
+    operator= (const GrammarCache&) = delete;
+    /// @endcond SKIP
+
+    /// Keep Xerces initialised for the lifetime of the pool.
+    xml::Platform platform;
+    /// The grammar pool.
+    std::unique_ptr<xercesc::XMLGrammarPool> pool;
+    /// Was the current schema loaded?
+    bool schemaLoaded;
+  };
+
 }
 
 namespace ome
@@ -128,14 +316,18 @@ namespace ome
 
     bool
     validateXML(const std::string& s,
-                const std::string& /* loc */)
+                const std::string& loc)
     {
       bool valid = true;
 
       try
         {
           ome::common::xml::Platform xmlplat;
-          ome::xml::createDocument(s);
+          GrammarCache& cache(GrammarCache::instance());
+          if (cache.loaded())
+            valid = cache.validate(s, loc);
+          else // Fall back to a full validating parse.
+            ome::xml::createDocument(s);
         }
       catch (const std::runtime_error&)
         {
@@ -145,5 +337,11 @@ namespace ome
       return valid;
     }
 
+    bool
+    schemaGrammarCached()
+    {
+      return grammarCacheLoaded && GrammarCache::instance().loaded();
+    }
+
   }
 }
@@ -97,6 +97,11 @@ namespace ome
     /**
      * Validate XML in an XML string.
      *
+     * The current OME-XML schema is compiled once per process, on
+     * first use, and the compiled grammar is shared read-only by all
+     * subsequent validations, in any thread.  The document is
+     * validated by a streaming parse; no DOM is constructed.
+     *
      * @param s the string to validate.
      * @param loc the file location or other descriptive text for the
      * string; used for error reporting only.
@@ -106,6 +111,17 @@ namespace ome
     validateXML(const std::string& s,
                 const std::string& loc = "XML");
 
+    /**
+     * Check if the compiled OME-XML schema grammar is cached.
+     *
+     * If cached, validateXML() is cheap; if not, the first
+     * validation will load and compile the schema.
+     *
+     * @returns @c true if cached, @c false otherwise.
+     */
+    bool
+    schemaGrammarCached();
+
   }
 }
 
@@ -35,11 +35,20 @@
  * #L%
  */
 
+#include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <cstring>
 #include <fstream>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <vector>
 
+#include <boost/filesystem/fstream.hpp>
 #include <boost/filesystem/operations.hpp>
 #include <boost/filesystem/path.hpp>
+#include <boost/optional.hpp>
 
 #include <ome/common/filesystem.h>
 #include <ome/common/mstream.h>
@@ -47,12 +56,22 @@
 
 #include <ome/compat/regex.h>
 
+#include <ome/files/ByteSwap.h>
+#include <ome/files/Downsample.h>
+#include <ome/files/FormatException.h>
 #include <ome/files/FormatTools.h>
+#include <ome/files/MemoryBudget.h>
 #include <ome/files/MetadataTools.h>
 #include <ome/files/PixelBuffer.h>
+#include <ome/files/PixelBufferView.h>
+#include <ome/files/PixelConversion.h>
 #include <ome/files/PixelProperties.h>
+#include <ome/files/PixelStatistics.h>
+#include <ome/files/TileBuffer.h>
 #include <ome/files/VariantPixelBuffer.h>
 #include <ome/files/detail/FormatReader.h>
+#include <ome/files/tiff/IFD.h>
+#include <ome/files/tiff/IOSource.h>
 
 #include <ome/xml/meta/DummyMetadata.h>
 #include <ome/xml/meta/FilterMetadata.h>
@@ -75,6 +94,199 @@ namespace ome
       {
         // Default thumbnail width and height.
         const dimension_size_type THUMBNAIL_DIMENSION = 128;
+
+        // Get the address and size of a plane within a buffer.
+        struct PlaneDataVisitor : public boost::static_visitor<>
+        {
+          const VariantPixelBuffer::indices_type& idx;
+          void *data;
+          VariantPixelBuffer::size_type size;
+
+          PlaneDataVisitor(const VariantPixelBuffer::indices_type& idx):
+            idx(idx),
+            data(nullptr),
+            size(0U)
+          {}
+
+          template<typename T>
+          void
+          operator() (std::shared_ptr<T>& buffer)
+          {
+            typedef typename T::value_type value_type;
+
+            PixelBufferView<value_type> view(*buffer);
+            data = view.plane(idx);
+            size = buffer->shape()[DIM_SPATIAL_X] * buffer->shape()[DIM_SPATIAL_Y] *
+              buffer->shape()[DIM_SUBCHANNEL] * sizeof(value_type);
+          }
+        };
+
+        // Describe used files, marking the file used to initialize
+        // the reader.  Files which can't be canonicalized (e.g. a
+        // missing file in a multi-file dataset) are not marked.
+        std::vector<FileInfo>
+        makeFileInfo(const std::vector<path>& files,
+                     const std::string& format,
+                     const boost::optional<path>& currentid)
+        {
+          boost::optional<path> current;
+          try
+            {
+              if (currentid)
+                current = ome::common::canonical(currentid.get());
+            }
+          catch (const std::exception&)
+            {
+            }
+
+          std::vector<FileInfo> infos;
+          infos.reserve(files.size());
+
+          for (const auto& file : files)
+            {
+              FileInfo info;
+              info.filename = file;
+              info.reader = format;
+              info.usedToInitialize = false;
+
+              try
+                {
+                  if (current)
+                    info.usedToInitialize = (ome::common::canonical(file) == current.get());
+                }
+              catch (const std::exception&)
+                {
+                }
+
+              infos.push_back(info);
+            }
+          return infos;
+        }
+
+        // Read a region of a plane at a reduced scale, returning
+        // false if the scale is not supported.
+        typedef std::function<bool (VariantPixelBuffer& buf,
+                                    dimension_size_type x,
+                                    dimension_size_type y,
+                                    dimension_size_type w,
+                                    dimension_size_type h,
+                                    dimension_size_type scale)> reduced_read_type;
+
+        // Read a region of a plane of the current resolution, one
+        // tile at a time, reducing it to the destination size by
+        // area averaging.  Tiles are aligned to the optimal tile
+        // grid so that each tile is decoded only once.
+        //
+        // Where the region is at least twice the destination size,
+        // the tiles are first read with reduced at the smallest of
+        // 1/8, 1/4 or 1/2 scale which is still no smaller than the
+        // destination, so that only the remainder of the reduction
+        // is by area averaging.  If reduced does not support the
+        // scale, the tiles are read at full scale.
+        void
+        reduceRegion(const FormatReader&      reader,
+                     dimension_size_type      plane,
+                     VariantPixelBuffer&      buf,
+                     dimension_size_type      x,
+                     dimension_size_type      y,
+                     dimension_size_type      w,
+                     dimension_size_type      h,
+                     dimension_size_type      destW,
+                     dimension_size_type      destH,
+                     const reduced_read_type& reduced)
+        {
+          const dimension_size_type tileW = std::max(reader.getOptimalTileWidth(),
+                                                     static_cast<dimension_size_type>(1U));
+          const dimension_size_type tileH = std::max(reader.getOptimalTileHeight(),
+                                                     static_cast<dimension_size_type>(1U));
+
+          // Read each tile at 1/scale, returning false if
+          // unsupported.
+          VariantPixelBuffer tile;
+          auto readTiles = [&](dimension_size_type scale) -> bool
+            {
+              AreaDownsampler area((w + scale - 1U) / scale, (h + scale - 1U) / scale,
+                                   destW, destH);
+              for (dimension_size_type ty = y; ty < y + h; ty = (ty / tileH + 1U) * tileH)
+                for (dimension_size_type tx = x; tx < x + w; tx = (tx / tileW + 1U) * tileW)
+                  {
+                    const dimension_size_type tw = std::min((tx / tileW + 1U) * tileW, x + w) - tx;
+                    const dimension_size_type th = std::min((ty / tileH + 1U) * tileH, y + h) - ty;
+                    if (scale == 1U)
+                      reader.openBytes(plane, tile, tx, ty, tw, th);
+                    else if (!reduced(tile, tx, ty, tw, th, scale))
+                      return false;
+                    area.add(tile, (tx - x) / scale, (ty - y) / scale);
+                  }
+
+              // Retain the reader storage order for the result.
+              const ome::xml::model::enums::DimensionOrder order(reader.getDimensionOrder());
+              const VariantPixelBuffer::storage_order_type storage_order
+                (PixelBufferBase::make_storage_order(order, reader.isInterleaved()));
+              if (!(storage_order == buf.storage_order()))
+                {
+                  std::array<VariantPixelBuffer::size_type, 9> shape;
+                  std::copy(buf.shape(), buf.shape() + PixelBufferBase::dimensions,
+                            shape.begin());
+                  buf.setBuffer(shape, tile.pixelType(), storage_order, PIXEL_UNINITIALIZED);
+                }
+
+              area.get(buf);
+              return true;
+            };
+
+          // The tile origins must all be multiples of the scale.
+          for (dimension_size_type scale = 8U; scale > 1U; scale /= 2U)
+            if (w >= destW * scale && h >= destH * scale &&
+                !(x % scale) && !(y % scale) &&
+                (!(tileW % scale) || (x + w) <= (x / tileW + 1U) * tileW) &&
+                (!(tileH % scale) || (y + h) <= (y / tileH + 1U) * tileH))
+              {
+                if (readTiles(scale))
+                  return;
+                break;
+              }
+
+          readTiles(1U);
+        }
+
+        bool
+        sameRegion(const PlaneRegion& a,
+                   const PlaneRegion& b)
+        {
+          return a.x == b.x && a.y == b.y && a.w == b.w && a.h == b.h;
+        }
+
+        // Get the conversion to normalise the pixel data of a series
+        // to FLOAT.  Integer samples are scaled from the range of
+        // their significant bits to [0, 1]; BIT and DOUBLE samples
+        // are converted without scaling.  FLOAT and complex pixel
+        // data are not converted.
+        boost::optional<PixelConversion>
+        normalization(const CoreMetadata& core)
+        {
+          const ome::xml::model::enums::PixelType type = core.pixelType;
+
+          if (type == ome::xml::model::enums::PixelType::FLOAT ||
+              isComplex(type))
+            return boost::none;
+
+          PixelConversion conversion;
+          if (isInteger(type) && type != ome::xml::model::enums::PixelType::BIT)
+            {
+              pixel_size_type bits = core.bitsPerPixel;
+              if (!bits || bits > bitsPerPixel(type))
+                bits = bitsPerPixel(type);
+
+              const double range = std::ldexp(1.0, static_cast<int>(bits)) - 1.0;
+              conversion.scale = 1.0 / range;
+              if (isSigned(type))
+                conversion.offset = std::ldexp(1.0, static_cast<int>(bits) - 1) / range;
+              conversion.minimum = 0.0;
+              conversion.maximum = 1.0;
+            }
+          return conversion;
+        }
       }
 
       FormatReader::FormatReader(const ReaderProperties& readerProperties):
@@ -86,6 +298,8 @@ namespace ome
         series(0),
         plane(0),
         core(),
+        seriesCoreIndexes(),
+        coreIndexSeries(),
         resolution(0),
         flattenedResolutions(true),
         suffixNecessary(true),
@@ -93,19 +307,38 @@ namespace ome
         companionFiles(false),
         datasetDescription("Single file"),
         normalizeData(false),
+        decodeThreads(1U),
+        verifyTileChecksums(false),
+        statistics(std::make_shared<IOStatistics>()),
+        pixelStatisticsEnabled(false),
+        pixelStatisticsMutex(),
+        pixelStatistics(),
         filterMetadata(false),
         saveOriginalMetadata(false),
         indexedAsRGB(false),
         group(true),
         domains(),
         metadataStore(std::make_shared<DummyMetadata>()),
-        metadataOptions()
+        metadataStorePending(false),
+        metadataOptions(),
+        executor(),
+        prefetches(),
+        prefetchToken(),
+        readahead(false),
+        lastRead(),
+        lastReadahead(),
+        memoryBudget(),
+        indexMappers(),
+        cachedSeriesUsedFiles(),
+        cachedUsedFiles(),
+        cachedAdvancedUsedFiles()
       {
         assertId(currentId, false);
       }
 
       FormatReader::~FormatReader()
       {
+        waitPrefetch();
       }
 
       const std::string&
@@ -161,6 +394,28 @@ namespace ome
         getMetadataStore()->createRoot();
       }
 
+      void
+      FormatReader::fillMetadataStore()
+      {
+        fillMetadata(*metadataStore, *this);
+      }
+
+      void
+      FormatReader::fillPendingMetadata() const
+      {
+        if (metadataStorePending)
+          {
+            // Clear first; fillMetadataStore() may access the store.
+            metadataStorePending = false;
+
+            FormatReader& self(const_cast<FormatReader&>(*this));
+            SaveSeries sentry(*this);
+            metadataStore->createRoot();
+            self.fillMetadataStore();
+            self.completeMetadataStore();
+          }
+      }
+
       bool
       FormatReader::isUsedFile(const boost::filesystem::path& file)
       {
@@ -210,6 +465,50 @@ namespace ome
       namespace
       {
 
+        // If the buffer is incorrectly sized, ordered or typed for a
+        // raw plane, reset to the correct buffer size, order and
+        // type.
+        void
+        resetPlaneBuffer(const FormatReader& reader,
+                         VariantPixelBuffer& dest,
+                         dimension_size_type w,
+                         dimension_size_type h,
+                         dimension_size_type samples)
+        {
+          std::array<VariantPixelBuffer::size_type, 9> shape, dest_shape;
+          shape[DIM_SPATIAL_X] = w;
+          shape[DIM_SPATIAL_Y] = h;
+          shape[DIM_SUBCHANNEL] = samples;
+          shape[DIM_SPATIAL_Z] = shape[DIM_TEMPORAL_T] = shape[DIM_CHANNEL] =
+            shape[DIM_MODULO_Z] = shape[DIM_MODULO_T] = shape[DIM_MODULO_C] = 1;
+          const VariantPixelBuffer::size_type *dest_shape_ptr(dest.shape());
+          std::copy(dest_shape_ptr, dest_shape_ptr + PixelBufferBase::dimensions,
+                    dest_shape.begin());
+
+          const ome::xml::model::enums::DimensionOrder order(reader.getDimensionOrder());
+          const bool interleaved(reader.isInterleaved());
+          const VariantPixelBuffer::storage_order_type storage_order
+            (PixelBufferBase::make_storage_order(order, interleaved));
+
+          const ome::xml::model::enums::PixelType type(reader.getPixelType());
+
+          if (type != dest.pixelType() ||
+              !(storage_order == dest.storage_order()) ||
+              shape != dest_shape)
+            dest.setBuffer(shape, type, storage_order, PIXEL_UNINITIALIZED);
+        }
+
+        // Check if raw plane data requires byte swapping.
+        bool
+        planeNeedsSwap(const FormatReader& reader)
+        {
+          EndianType endian = reader.isLittleEndian() ? ENDIAN_LITTLE : ENDIAN_BIG;
+          return ((endian == ome::files::ENDIAN_BIG &&
+                   boost::endian::order::big != boost::endian::order::native) ||
+                  (endian == ome::files::ENDIAN_LITTLE &&
+                   boost::endian::order::little != boost::endian::order::native));
+        }
+
         struct PlaneVisitor : public boost::static_visitor<>
         {
           std::istream&       source;
@@ -243,8 +542,6 @@ namespace ome
           void
           operator()(T& v)
           {
-            EndianType endian = reader.isLittleEndian() ? ENDIAN_LITTLE : ENDIAN_BIG;
-
             const uint32_t bpp(bytesPerPixel(reader.getPixelType()));
             const dimension_size_type sizeX(reader.getSizeX());
             const dimension_size_type sizeY(reader.getSizeY());
@@ -327,15 +624,112 @@ namespace ome
 
             // If the endianness of the data doesn't match the
             // endianness of the machine, byteswap the buffer.
-            if ((endian == ome::files::ENDIAN_BIG &&
-                 boost::endian::order::big != boost::endian::order::native) ||
-                (endian == ome::files::ENDIAN_LITTLE &&
-                 boost::endian::order::little != boost::endian::order::native))
+            if (planeNeedsSwap(reader))
+              byteswap(v->data(), v->num_elements());
+          }
+        };
+
+        // Read a plane from a positional source.  The scanline
+        // ranges of the region are computed up front, merging those
+        // which are contiguous in the source, and each range is
+        // copied or read into its place in the buffer, in order.
+        struct SourcePlaneVisitor : public boost::static_visitor<>
+        {
+          tiff::IOSource&     source;
+          uint64_t            offset;
+          FormatReader&       reader;
+          dimension_size_type x;
+          dimension_size_type y;
+          dimension_size_type w;
+          dimension_size_type h;
+          dimension_size_type samples;
+          dimension_size_type scanlinePad;
+
+          SourcePlaneVisitor(tiff::IOSource&     source,
+                             uint64_t            offset,
+                             FormatReader&       reader,
+                             dimension_size_type x,
+                             dimension_size_type y,
+                             dimension_size_type w,
+                             dimension_size_type h,
+                             dimension_size_type samples,
+                             dimension_size_type scanlinePad):
+            source(source),
+            offset(offset),
+            reader(reader),
+            x(x),
+            y(y),
+            w(w),
+            h(h),
+            samples(samples),
+            scanlinePad(scanlinePad)
+          {}
+
+          template<typename T>
+          void
+          operator()(T& v)
+          {
+            typedef typename T::element_type::value_type value_type;
+
+            const bool swap(planeNeedsSwap(reader));
+            const uint64_t bpp(bytesPerPixel(reader.getPixelType()));
+            const dimension_size_type sizeX(reader.getSizeX());
+            const dimension_size_type sizeY(reader.getSizeY());
+            const bool interleaved(reader.isInterleaved());
+
+            // Interleaved samples are stored within each scanline;
+            // otherwise each sample is stored as a separate plane.
+            const dimension_size_type rowSamples = interleaved ? samples : 1U;
+            const dimension_size_type samplePlanes = interleaved ? 1U : samples;
+            const uint64_t rowBytes = (sizeX + scanlinePad) * bpp * rowSamples;
+            const uint64_t planeBytes = rowBytes * sizeY;
+            const std::size_t runBytes = static_cast<std::size_t>(w * bpp * rowSamples);
+
+            thread_local std::vector<tiff::IOSource::range_type> ranges;
+            ranges.clear();
+            for (dimension_size_type plane = 0; plane < samplePlanes; ++plane)
+              for (dimension_size_type row = y; row < y + h; ++row)
+                {
+                  const uint64_t start = offset + (plane * planeBytes) + (row * rowBytes) + (x * bpp * rowSamples);
+                  if (!ranges.empty() && ranges.back().first + ranges.back().second == start)
+                    ranges.back().second += runBytes;
+                  else
+                    ranges.emplace_back(start, runBytes);
+                }
+
+            if (!ranges.empty() &&
+                ranges.back().first + ranges.back().second > source.size())
               {
-                typename T::element_type::value_type *data = v->data();
-                typename T::element_type::size_type num_elements = v->num_elements();
-                for (typename T::element_type::size_type i = 0; i < num_elements; ++i)
-                  byteswap(data[i]);
+                boost::format fmt("readPlane: Plane data exceeds size of %1%");
+                fmt % source.name();
+                throw std::runtime_error(fmt.str());
+              }
+
+            const char *mapped = source.data();
+            if (!mapped && ranges.size() > 1U)
+              source.prefetch(ranges);
+
+            char *dest = reinterpret_cast<char *>(v->data());
+            for (const auto& range : ranges)
+              {
+                const dimension_size_type count = range.second / sizeof(value_type);
+                if (mapped)
+                  {
+                    if (swap)
+                      byteswapCopy(mapped + range.first, dest,
+                                   ByteswapUnits<value_type>::size,
+                                   count * ByteswapUnits<value_type>::count);
+                    else
+                      std::memcpy(dest, mapped + range.first, range.second);
+                  }
+                else
+                  {
+                    if (source.read(range.first, dest, range.second) != range.second)
+                      throw std::runtime_error("readPlane: Error reading bytes from source");
+                    if (swap)
+                      byteswap(reinterpret_cast<value_type *>(dest), count);
+                  }
+                dest += range.second;
               }
           }
         };
@@ -352,33 +746,43 @@ namespace ome
                               dimension_size_type scanlinePad,
                               dimension_size_type samples)
       {
-        std::array<VariantPixelBuffer::size_type, 9> shape, dest_shape;
-        shape[DIM_SPATIAL_X] = w;
-        shape[DIM_SPATIAL_Y] = h;
-        shape[DIM_SUBCHANNEL] = samples;
-        shape[DIM_SPATIAL_Z] = shape[DIM_TEMPORAL_T] = shape[DIM_CHANNEL] =
-          shape[DIM_MODULO_Z] = shape[DIM_MODULO_T] = shape[DIM_MODULO_C] = 1;
-        const VariantPixelBuffer::size_type *dest_shape_ptr(dest.shape());
-        std::copy(dest_shape_ptr, dest_shape_ptr + PixelBufferBase::dimensions,
-                  dest_shape.begin());
+        resetPlaneBuffer(*this, dest, w, h, samples);
 
-        const ome::xml::model::enums::DimensionOrder order(getDimensionOrder());
-        const bool interleaved(isInterleaved());
-        const VariantPixelBuffer::storage_order_type storage_order
-          (PixelBufferBase::make_storage_order(order, interleaved));
+        // Fill the buffer according to its type.
+        PlaneVisitor v(source, *this,
+                       x, y, w, h, samples, scanlinePad);
+        boost::apply_visitor(v, dest.vbuffer());
+      }
 
-        const ome::xml::model::enums::PixelType type(getPixelType());
+      void
+      FormatReader::readPlane(tiff::IOSource&     source,
+                              uint64_t            offset,
+                              VariantPixelBuffer& dest,
+                              dimension_size_type x,
+                              dimension_size_type y,
+                              dimension_size_type w,
+                              dimension_size_type h,
+                              dimension_size_type samples)
+      {
+        return readPlane(source, offset, dest, x, y, w, h, 0, samples);
+      }
 
-        // If the buffer is incorrectly sized, ordered or typed, reset
-        // to the correct buffer size, order and type.
-        if (type != dest.pixelType() ||
-            !(storage_order == dest.storage_order()) ||
-            shape != dest_shape)
-          dest.setBuffer(shape, type, storage_order);
+      void
+      FormatReader::readPlane(tiff::IOSource&     source,
+                              uint64_t            offset,
+                              VariantPixelBuffer& dest,
+                              dimension_size_type x,
+                              dimension_size_type y,
+                              dimension_size_type w,
+                              dimension_size_type h,
+                              dimension_size_type scanlinePad,
+                              dimension_size_type samples)
+      {
+        resetPlaneBuffer(*this, dest, w, h, samples);
 
         // Fill the buffer according to its type.
-        PlaneVisitor v(source, *this,
-                       x, y, w, h, samples, scanlinePad);
+        SourcePlaneVisitor v(source, offset, *this,
+                             x, y, w, h, samples, scanlinePad);
         boost::apply_visitor(v, dest.vbuffer());
       }
 
@@ -467,10 +871,21 @@ namespace ome
         return isStreamThisTypeImpl(stream);
       }
 
+      const std::size_t FormatReader::detection_block_size;
+
       bool
-      FormatReader::isFilenameThisTypeImpl(const boost::filesystem::path& /* name */) const
+      FormatReader::isFilenameThisTypeImpl(const boost::filesystem::path& name) const
       {
-        return false;
+        // Check the start of the file with the stream implementation,
+        // to avoid opening the file fully.
+        std::vector<char> header(detection_block_size);
+        boost::filesystem::ifstream in(name, std::ios::in | std::ios::binary);
+        if (!in)
+          return false;
+        in.read(header.data(), static_cast<std::streamsize>(header.size()));
+
+        ome::common::imstream ims(header.data(), static_cast<std::size_t>(in.gcount()));
+        return isStreamThisTypeImpl(ims);
       }
 
       bool
@@ -738,105 +1153,881 @@ namespace ome
                               dimension_size_type y,
                               dimension_size_type w,
                               dimension_size_type h) const
+      {
+        if (normalizeData)
+          {
+            assertId(currentId, true);
+
+            // Each tile is converted into the destination as it is
+            // read.
+            boost::optional<PixelConversion> conversion(normalization(getCoreMetadata(getCoreIndex())));
+            if (conversion)
+              {
+                openConvertedBytes(plane, buf, x, y, w, h,
+                                   ome::xml::model::enums::PixelType::FLOAT, *conversion);
+                recordRead(plane, x, y, w, h);
+                return;
+              }
+          }
+
+        openRawBytes(plane, buf, x, y, w, h);
+        recordRead(plane, x, y, w, h);
+      }
+
+      void
+      FormatReader::openRawBytes(dimension_size_type plane,
+                                 VariantPixelBuffer& buf,
+                                 dimension_size_type x,
+                                 dimension_size_type y,
+                                 dimension_size_type w,
+                                 dimension_size_type h) const
       {
         setPlane(plane);
         openBytesImpl(plane, buf, x, y, w, h);
+
+        // Accumulate separately if the reader did not accumulate
+        // while reading.
+        std::shared_ptr<PixelStatistics> stats(newPixelStatistics(plane, x, y, w, h));
+        if (stats)
+          {
+            stats->add(buf);
+            cachePixelStatistics(plane, stats);
+          }
       }
 
-      void
-      FormatReader::openThumbBytes(dimension_size_type /* plane */,
-                                   VariantPixelBuffer& /* buf */) const
+      std::future<void>
+      FormatReader::openBytesAsync(dimension_size_type      plane,
+                                   VariantPixelBuffer&      buf,
+                                   Executor::Priority       priority,
+                                   const CancellationToken& token) const
       {
-        assertId(currentId, true);
-        /**
-         * @todo Implement openThumbBytes.  This requires implementing
-         * image rescaling/resampling.
-         */
-        throw std::runtime_error("Thumbnail rescaling is not currently implemented");
+        return openBytesAsync(plane, buf, 0, 0, getSizeX(), getSizeY(), priority, token);
       }
 
-      void
-      FormatReader::close(bool fileOnly)
+      std::future<void>
+      FormatReader::openBytesAsync(dimension_size_type      plane,
+                                   VariantPixelBuffer&      buf,
+                                   dimension_size_type      x,
+                                   dimension_size_type      y,
+                                   dimension_size_type      w,
+                                   dimension_size_type      h,
+                                   Executor::Priority       priority,
+                                   const CancellationToken& token) const
       {
-        if (in)
-          in = std::shared_ptr<std::istream>(); // set to null.
-        if (!fileOnly)
+        // Normalised data are converted while reading, synchronously.
+        const bool normalize = normalizeData &&
+          normalization(getCoreMetadata(getCoreIndex()));
+
+        setPlane(plane);
+
+        std::function<void ()> task;
+        if (!normalize)
+          task = openBytesTask(plane, buf, x, y, w, h);
+        if (task)
+          return runAsync(task, priority, token);
+
+        // Not supported; read synchronously.
+        std::promise<void> result;
+        try
           {
-            currentId = boost::none;
-            coreIndex = series = resolution = plane = 0;
-            core.clear();
+            if (token.cancelled())
+              throw CancelledException();
+            if (normalize)
+              openBytes(plane, buf, x, y, w, h);
+            else
+              openBytesImpl(plane, buf, x, y, w, h);
+            result.set_value();
+          }
+        catch (...)
+          {
+            result.set_exception(std::current_exception());
           }
+        return result.get_future();
       }
 
-      dimension_size_type
-      FormatReader::getSeriesCount() const
+      void
+      FormatReader::openBytesBatch(const std::vector<ReadRequest>& requests) const
       {
         assertId(currentId, true);
-        dimension_size_type size = core.size();
-        if (!hasFlattenedResolutions()) {
-          size = coreIndexToSeries(core.size() - 1) + 1;
-        }
-        return size;
+
+        for (const auto& request : requests)
+          {
+            if (request.plane >= getImageCount())
+              {
+                boost::format fmt("Invalid plane: %1%");
+                fmt % request.plane;
+                throw std::logic_error(fmt.str());
+              }
+            if (!request.buf)
+              throw std::logic_error("Null destination pixel buffer");
+          }
+
+        if (normalizeData && normalization(getCoreMetadata(getCoreIndex())))
+          {
+            for (const auto& request : requests)
+              openBytes(request.plane, *request.buf,
+                        request.region.x, request.region.y,
+                        request.region.w, request.region.h);
+            return;
+          }
+
+        openBytesBatchImpl(requests);
       }
 
       void
-      FormatReader::setSeries(dimension_size_type series) const
+      FormatReader::openBytesStreamed(dimension_size_type        plane,
+                                      const region_visitor_type& visitor,
+                                      dimension_size_type        x,
+                                      dimension_size_type        y,
+                                      dimension_size_type        w,
+                                      dimension_size_type        h) const
       {
-        this->coreIndex = seriesToCoreIndex(series);
-        this->series = series;
-        this->resolution = 0;
-        this->plane = 0;
+        // Validates the plane index.
+        std::shared_ptr<const tiff::IFD> ifd(getPlaneIFD(plane));
+
+        const dimension_size_type sizeX = getSizeX();
+        const dimension_size_type sizeY = getSizeY();
+
+        if (!w || !h || x > sizeX || w > sizeX - x || y > sizeY || h > sizeY - y)
+          {
+            boost::format fmt("Invalid region %1%x%2% at %3%,%4% for image size %5%x%6%");
+            fmt % w % h % x % y % sizeX % sizeY;
+            throw std::logic_error(fmt.str());
+          }
+
+        setPlane(plane);
+
+        // Normalise each region before it is visited.
+        boost::optional<PixelConversion> conversion;
+        if (normalizeData)
+          conversion = normalization(getCoreMetadata(getCoreIndex()));
+        VariantPixelBuffer normalized;
+        const region_visitor_type normalizedVisitor
+          ([&visitor, &conversion, &normalized](const VariantPixelBuffer& region,
+                                                const PlaneRegion&        area)
+           {
+             convertPixels(region, normalized,
+                           ome::xml::model::enums::PixelType::FLOAT, *conversion);
+             visitor(normalized, area);
+           });
+        const region_visitor_type& regionVisitor(conversion ? normalizedVisitor : visitor);
+
+        if (ifd)
+          {
+            ifd->streamImage(regionVisitor, x, y, w, h);
+            return;
+          }
+
+        const dimension_size_type rows = std::max(getOptimalTileHeight(),
+                                                  static_cast<dimension_size_type>(1U));
+        VariantPixelBuffer buf;
+        for (dimension_size_type band = y; band < y + h; band += rows)
+          {
+            PlaneRegion region(x, band, w, std::min(rows, y + h - band));
+            openBytesImpl(plane, buf, region.x, region.y, region.w, region.h);
+            regionVisitor(buf, region);
+          }
       }
 
-      dimension_size_type
-      FormatReader::getSeries() const
+      void
+      FormatReader::openBytesBatchImpl(const std::vector<ReadRequest>& requests) const
       {
-        return series;
+        std::vector<const ReadRequest *> ordered;
+        ordered.reserve(requests.size());
+        for (const auto& request : requests)
+          ordered.push_back(&request);
+        std::stable_sort(ordered.begin(), ordered.end(),
+                         [](const ReadRequest *lhs, const ReadRequest *rhs)
+                         { return lhs->plane < rhs->plane; });
+
+        for (const auto request : ordered)
+          openBytesImpl(request->plane, *request->buf,
+                        request->region.x, request->region.y,
+                        request->region.w, request->region.h);
       }
 
       void
-      FormatReader::setPlane(dimension_size_type plane) const
+      FormatReader::openBytesConcurrent(dimension_size_type series,
+                                        dimension_size_type resolution,
+                                        dimension_size_type plane,
+                                        VariantPixelBuffer& buf,
+                                        dimension_size_type x,
+                                        dimension_size_type y,
+                                        dimension_size_type w,
+                                        dimension_size_type h) const
       {
         assertId(currentId, true);
 
-        if (plane >= getImageCount())
+        const dimension_size_type index = concurrentCoreIndex(series, resolution);
+        const CoreMetadata& cmeta(getCoreMetadata(index));
+
+        if (plane >= cmeta.imageCount)
           {
             boost::format fmt("Invalid plane: %1%");
             fmt % plane;
             throw std::logic_error(fmt.str());
           }
+        if (x > cmeta.sizeX || w > cmeta.sizeX - x ||
+            y > cmeta.sizeY || h > cmeta.sizeY - y)
+          {
+            boost::format fmt("Invalid region %1%x%2% at %3%,%4% for image size %5%x%6%");
+            fmt % w % h % x % y % cmeta.sizeX % cmeta.sizeY;
+            throw std::logic_error(fmt.str());
+          }
 
-        this->plane = plane;
+        boost::optional<PixelConversion> conversion;
+        if (normalizeData)
+          conversion = normalization(cmeta);
+        if (conversion)
+          {
+            VariantPixelBuffer raw;
+            openBytesConcurrentImpl(index, plane, raw, x, y, w, h);
+            convertPixels(raw, buf, ome::xml::model::enums::PixelType::FLOAT, *conversion);
+            return;
+          }
+
+        openBytesConcurrentImpl(index, plane, buf, x, y, w, h);
+      }
+
+      void
+      FormatReader::openBytesConcurrentImpl(dimension_size_type coreIndex,
+                                            dimension_size_type plane,
+                                            VariantPixelBuffer& buf,
+                                            dimension_size_type x,
+                                            dimension_size_type y,
+                                            dimension_size_type w,
+                                            dimension_size_type h) const
+      {
+        std::lock_guard<std::mutex> lock(concurrentMutex);
+        SaveSeries sentry(*this);
+        setCoreIndex(coreIndex);
+        openBytesImpl(plane, buf, x, y, w, h);
       }
 
       dimension_size_type
-      FormatReader::getPlane() const
+      FormatReader::concurrentCoreIndex(dimension_size_type series,
+                                        dimension_size_type resolution) const
       {
-        assertId(currentId, true);
+        dimension_size_type index = 0;
+        dimension_size_type count = 1;
 
-        return plane;
-      }
+        if (hasFlattenedResolutions())
+          index = series;
+        else if (series < seriesCoreIndexes.size() &&
+                 coreIndexSeries.size() == core.size())
+          {
+            index = seriesCoreIndexes[series];
+            if (index < core.size() && core[index])
+              count = core[index]->resolutionCount;
+          }
+        else
+          {
+            boost::format fmt("Invalid series: %1%");
+            fmt % series;
+            throw std::logic_error(fmt.str());
+          }
 
-      void
-      FormatReader::setGroupFiles(bool group)
-      {
-        assertId(currentId, false);
-        this->group = group;
+        if (index >= core.size() || !core[index])
+          {
+            boost::format fmt("Invalid series: %1%");
+            fmt % series;
+            throw std::logic_error(fmt.str());
+          }
+        if (resolution >= count)
+          {
+            boost::format fmt("Invalid resolution: %1%");
+            fmt % resolution;
+            throw std::logic_error(fmt.str());
+          }
+
+        return index + resolution;
       }
 
-      bool
-      FormatReader::isGroupFiles() const
+      std::function<void ()>
+      FormatReader::openBytesTask(dimension_size_type /* plane */,
+                                  VariantPixelBuffer& /* buf */,
+                                  dimension_size_type /* x */,
+                                  dimension_size_type /* y */,
+                                  dimension_size_type /* w */,
+                                  dimension_size_type /* h */) const
       {
-        return group;
+        return std::function<void ()>();
       }
 
-      FormatReader::FileGroupOption
-      FormatReader::fileGroupOption(const std::string& /* id */)
+      std::future<void>
+      FormatReader::runAsync(const std::function<void ()>& task,
+                             Executor::Priority            priority,
+                             const CancellationToken&      token) const
       {
-        return CANNOT_GROUP;
+        std::shared_ptr<std::promise<void>> result(std::make_shared<std::promise<void>>());
+        std::future<void> future(result->get_future());
+
+        // A cancelled task is still run by the executor, but only to
+        // complete the future, so stale requests drain from the
+        // queues without doing any I/O or decoding.
+        std::function<void ()> wrapped([result, task, token]()
+                                       {
+                                         try
+                                           {
+                                             if (token.cancelled())
+                                               throw CancelledException();
+                                             task();
+                                             result->set_value();
+                                           }
+                                         catch (...)
+                                           {
+                                             result->set_exception(std::current_exception());
+                                           }
+                                       });
+        (executor ? executor : defaultExecutor())->submit(wrapped, priority);
+
+        return future;
       }
 
-      bool
+      void
+      FormatReader::prefetch(dimension_size_type plane,
+                             dimension_size_type x,
+                             dimension_size_type y,
+                             dimension_size_type w,
+                             dimension_size_type h) const
+      {
+        assertId(currentId, true);
+
+        if (plane >= getImageCount())
+          {
+            boost::format fmt("Invalid plane: %1%");
+            fmt % plane;
+            throw std::logic_error(fmt.str());
+          }
+
+        prefetchImpl(plane, x, y, w, h);
+      }
+
+      void
+      FormatReader::prefetchImpl(dimension_size_type /* plane */,
+                                 dimension_size_type /* x */,
+                                 dimension_size_type /* y */,
+                                 dimension_size_type /* w */,
+                                 dimension_size_type /* h */) const
+      {
+      }
+
+      void
+      FormatReader::recordRead(dimension_size_type plane,
+                               dimension_size_type x,
+                               dimension_size_type y,
+                               dimension_size_type w,
+                               dimension_size_type h) const
+      {
+        if (!readahead)
+          return;
+
+        SequentialRead read = {getCoreIndex(), plane, PlaneRegion(x, y, w, h), 0U};
+        boost::optional<SequentialRead> next;
+
+        if (lastRead && lastRead->coreIndex == read.coreIndex)
+          {
+            const SequentialRead& last(*lastRead);
+            if (plane > last.plane && sameRegion(read.region, last.region))
+              {
+                // The same region of successive planes.  A stride
+                // other than one must be seen twice before it is
+                // followed.
+                read.stride = plane - last.plane;
+                if ((read.stride == 1U || read.stride == last.stride) &&
+                    plane + read.stride < getImageCount())
+                  next = SequentialRead{read.coreIndex, plane + read.stride, read.region, read.stride};
+              }
+            else if (plane == last.plane &&
+                     y == last.region.y && h == last.region.h &&
+                     x == last.region.x + last.region.w &&
+                     y + h < getSizeY())
+              {
+                // Adjacent regions along a row; the whole of the next
+                // row is expected.
+                next = SequentialRead{read.coreIndex, plane,
+                                      PlaneRegion(0, y + h, getSizeX(),
+                                                  std::min(h, getSizeY() - (y + h))),
+                                      0U};
+              }
+          }
+
+        lastRead = read;
+
+        if (next &&
+            !(lastReadahead &&
+              lastReadahead->coreIndex == next->coreIndex &&
+              lastReadahead->plane == next->plane &&
+              sameRegion(lastReadahead->region, next->region)))
+          {
+            lastReadahead = next;
+            prefetchImpl(next->plane, next->region.x, next->region.y,
+                         next->region.w, next->region.h);
+          }
+      }
+
+      void
+      FormatReader::startPrefetch(const std::function<void ()>& task) const
+      {
+        // Limit on outstanding prefetch tasks; further requests are
+        // discarded until earlier requests complete.
+        static const std::size_t max_prefetches = 16U;
+
+        prefetches.erase(std::remove_if(prefetches.begin(), prefetches.end(),
+                                        [](const std::future<void>& f)
+                                        {
+                                          return f.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+                                        }),
+                         prefetches.end());
+        if (prefetches.size() >= max_prefetches)
+          return;
+
+        // Apply back-pressure while over the memory budget.
+        if (memoryBudget && memoryBudget->exceeded())
+          return;
+
+        // Prefetching is advisory, so any error held by the future is
+        // discarded.
+        prefetches.push_back(runAsync(task, Executor::PRIORITY_LOW, prefetchToken));
+      }
+
+      void
+      FormatReader::cancelPrefetch() const
+      {
+        // Prefetches started after this use a new token.
+        prefetchToken.cancel();
+        prefetchToken = CancellationToken();
+      }
+
+      void
+      FormatReader::waitPrefetch() const
+      {
+        for (auto& f : prefetches)
+          f.wait();
+        prefetches.clear();
+      }
+
+      void
+      FormatReader::adviseAccess(AccessHint          hint,
+                                 dimension_size_type plane,
+                                 dimension_size_type x,
+                                 dimension_size_type y,
+                                 dimension_size_type w,
+                                 dimension_size_type h) const
+      {
+        assertId(currentId, true);
+
+        if (plane >= getImageCount())
+          {
+            boost::format fmt("Invalid plane: %1%");
+            fmt % plane;
+            throw std::logic_error(fmt.str());
+          }
+
+        adviseAccessImpl(hint, plane, x, y, w, h);
+      }
+
+      void
+      FormatReader::adviseAccessImpl(AccessHint          /* hint */,
+                                     dimension_size_type /* plane */,
+                                     dimension_size_type /* x */,
+                                     dimension_size_type /* y */,
+                                     dimension_size_type /* w */,
+                                     dimension_size_type /* h */) const
+      {
+      }
+
+      void
+      FormatReader::openThumbBytes(dimension_size_type plane,
+                                   VariantPixelBuffer& buf) const
+      {
+        assertId(currentId, true);
+
+        const std::array<dimension_size_type, 2> thumbSize(getThumbSize());
+
+        SaveSeries sentry(*this);
+
+        // Read from the smallest sub-resolution which is at least as
+        // large as the thumbnail, if any.
+        if (!hasFlattenedResolutions())
+          {
+            dimension_size_type resolution = 0;
+            for (dimension_size_type r = 1; r < getResolutionCount(); ++r)
+              {
+                const CoreMetadata& rcore(getCoreMetadata(seriesToCoreIndex(getSeries()) + r));
+                if (rcore.sizeX >= thumbSize[0] && rcore.sizeY >= thumbSize[1])
+                  resolution = r;
+              }
+            if (resolution)
+              setResolution(resolution);
+          }
+
+        const dimension_size_type sizeX = getSizeX();
+        const dimension_size_type sizeY = getSizeY();
+
+        reduceRegion(*this, plane, buf, 0, 0, sizeX, sizeY,
+                     std::min(thumbSize[0], sizeX),
+                     std::min(thumbSize[1], sizeY),
+                     [this, plane](VariantPixelBuffer& tile,
+                                   dimension_size_type x,
+                                   dimension_size_type y,
+                                   dimension_size_type w,
+                                   dimension_size_type h,
+                                   dimension_size_type scale)
+                     { return openReducedBytesImpl(plane, tile, x, y, w, h, scale); });
+      }
+
+      void
+      FormatReader::openScaledBytes(dimension_size_type plane,
+                                    VariantPixelBuffer& buf,
+                                    dimension_size_type x,
+                                    dimension_size_type y,
+                                    dimension_size_type w,
+                                    dimension_size_type h,
+                                    dimension_size_type scaledW,
+                                    dimension_size_type scaledH) const
+      {
+        assertId(currentId, true);
+
+        const dimension_size_type sizeX = getSizeX();
+        const dimension_size_type sizeY = getSizeY();
+
+        if (!w || !h || x + w > sizeX || y + h > sizeY)
+          {
+            boost::format fmt("Invalid region %1%x%2% at %3%,%4% for image size %5%x%6%");
+            fmt % w % h % x % y % sizeX % sizeY;
+            throw std::logic_error(fmt.str());
+          }
+        if (!scaledW || !scaledH || scaledW > w || scaledH > h)
+          {
+            boost::format fmt("Invalid scaled size %1%x%2% for region size %3%x%4%");
+            fmt % scaledW % scaledH % w % h;
+            throw std::logic_error(fmt.str());
+          }
+
+        SaveSeries sentry(*this);
+
+        // Find the coarsest resolution at which the region is no
+        // smaller than the scaled size.  The region is expanded
+        // outward to whole pixels at that resolution.
+        dimension_size_type resolution = 0;
+        std::array<dimension_size_type, 4> region = {{x, y, w, h}};
+        if (!hasFlattenedResolutions())
+          {
+            const dimension_size_type base = seriesToCoreIndex(getSeries());
+            for (dimension_size_type r = 1; r < getResolutionCount(); ++r)
+              {
+                const CoreMetadata& rcore(getCoreMetadata(base + r));
+                const dimension_size_type rx0 = x * rcore.sizeX / sizeX;
+                const dimension_size_type ry0 = y * rcore.sizeY / sizeY;
+                const dimension_size_type rx1 = ((x + w) * rcore.sizeX + sizeX - 1U) / sizeX;
+                const dimension_size_type ry1 = ((y + h) * rcore.sizeY + sizeY - 1U) / sizeY;
+                if (rx1 - rx0 >= scaledW && ry1 - ry0 >= scaledH &&
+                    rcore.sizeX * rcore.sizeY <
+                    getCoreMetadata(base + resolution).sizeX * getCoreMetadata(base + resolution).sizeY)
+                  {
+                    resolution = r;
+                    region = {{rx0, ry0, rx1 - rx0, ry1 - ry0}};
+                  }
+              }
+            if (resolution)
+              setResolution(resolution);
+          }
+
+        if (region[2] == scaledW && region[3] == scaledH)
+          openBytes(plane, buf, region[0], region[1], region[2], region[3]);
+        else
+          reduceRegion(*this, plane, buf, region[0], region[1], region[2], region[3],
+                       scaledW, scaledH,
+                       [this, plane](VariantPixelBuffer& tile,
+                                     dimension_size_type tx,
+                                     dimension_size_type ty,
+                                     dimension_size_type tw,
+                                     dimension_size_type th,
+                                     dimension_size_type scale)
+                       { return openReducedBytesImpl(plane, tile, tx, ty, tw, th, scale); });
+      }
+
+      bool
+      FormatReader::openReducedBytesImpl(dimension_size_type /* plane */,
+                                         VariantPixelBuffer& /* buf */,
+                                         dimension_size_type /* x */,
+                                         dimension_size_type /* y */,
+                                         dimension_size_type /* w */,
+                                         dimension_size_type /* h */,
+                                         dimension_size_type /* scale */) const
+      {
+        return false;
+      }
+
+      void
+      FormatReader::openConvertedBytes(dimension_size_type                 plane,
+                                       VariantPixelBuffer&                 buf,
+                                       dimension_size_type                 x,
+                                       dimension_size_type                 y,
+                                       dimension_size_type                 w,
+                                       dimension_size_type                 h,
+                                       ::ome::xml::model::enums::PixelType type,
+                                       const PixelConversion&              conversion) const
+      {
+        assertId(currentId, true);
+
+        const dimension_size_type sizeX = getSizeX();
+        const dimension_size_type sizeY = getSizeY();
+
+        if (!w || !h || x + w > sizeX || y + h > sizeY)
+          {
+            boost::format fmt("Invalid region %1%x%2% at %3%,%4% for image size %5%x%6%");
+            fmt % w % h % x % y % sizeX % sizeY;
+            throw std::logic_error(fmt.str());
+          }
+
+        const dimension_size_type tileW = std::max(getOptimalTileWidth(),
+                                                   static_cast<dimension_size_type>(1U));
+        const dimension_size_type tileH = std::max(getOptimalTileHeight(),
+                                                   static_cast<dimension_size_type>(1U));
+
+        const ome::xml::model::enums::DimensionOrder order(getDimensionOrder());
+        const VariantPixelBuffer::storage_order_type storage_order
+          (PixelBufferBase::make_storage_order(order, isInterleaved()));
+
+        VariantPixelBuffer tile;
+        bool first = true;
+        for (dimension_size_type ty = y; ty < y + h; ty = (ty / tileH + 1U) * tileH)
+          for (dimension_size_type tx = x; tx < x + w; tx = (tx / tileW + 1U) * tileW)
+            {
+              openRawBytes(plane, tile, tx, ty,
+                           std::min((tx / tileW + 1U) * tileW, x + w) - tx,
+                           std::min((ty / tileH + 1U) * tileH, y + h) - ty);
+
+              // Size the destination from the first tile, which
+              // determines the subchannel count.
+              if (first)
+                {
+                  std::array<VariantPixelBuffer::size_type, 9> shape, dest_shape;
+                  std::copy(tile.shape(), tile.shape() + PixelBufferBase::dimensions,
+                            shape.begin());
+                  shape[DIM_SPATIAL_X] = w;
+                  shape[DIM_SPATIAL_Y] = h;
+                  std::copy(buf.shape(), buf.shape() + PixelBufferBase::dimensions,
+                            dest_shape.begin());
+                  if (type != buf.pixelType() ||
+                      !(storage_order == buf.storage_order()) ||
+                      shape != dest_shape)
+                    buf.setBuffer(shape, type, storage_order, PIXEL_UNINITIALIZED);
+                  first = false;
+                }
+
+              convertPixels(tile, buf, tx - x, ty - y, conversion);
+            }
+      }
+
+      void
+      FormatReader::openMergedBytes(dimension_size_type plane,
+                                    VariantPixelBuffer& buf,
+                                    dimension_size_type x,
+                                    dimension_size_type y,
+                                    dimension_size_type w,
+                                    dimension_size_type h) const
+      {
+        assertId(currentId, true);
+
+        if (plane >= getImageCount())
+          {
+            boost::format fmt("Invalid plane: %1%");
+            fmt % plane;
+            throw std::logic_error(fmt.str());
+          }
+
+        const dimension_size_type sizeX = getSizeX();
+        const dimension_size_type sizeY = getSizeY();
+
+        if (!w || !h || x > sizeX || w > sizeX - x || y > sizeY || h > sizeY - y)
+          {
+            boost::format fmt("Invalid region %1%x%2% at %3%,%4% for image size %5%x%6%");
+            fmt % w % h % x % y % sizeX % sizeY;
+            throw std::logic_error(fmt.str());
+          }
+
+        const dimension_size_type channels = getEffectiveSizeC();
+        for (dimension_size_type c = 0; c < channels; ++c)
+          if (getRGBChannelCount(c) != 1U)
+            {
+              boost::format fmt("Channel %1% has %2% subchannels; only channels with a single subchannel may be merged");
+              fmt % c % getRGBChannelCount(c);
+              throw FormatException(fmt.str());
+            }
+
+        const std::array<dimension_size_type, 3> zct(getZCTCoords(plane));
+        const ome::xml::model::enums::PixelType type
+          (normalizeData && normalization(getCoreMetadata(getCoreIndex())) ?
+           ome::xml::model::enums::PixelType::FLOAT : getPixelType());
+
+        // Read each channel into consecutive planes of a single
+        // buffer, so that the merged image is a reinterpretation of
+        // the same storage with planar subchannels.
+        std::array<VariantPixelBuffer::size_type, 9> shape;
+        shape[DIM_SPATIAL_X] = w;
+        shape[DIM_SPATIAL_Y] = h;
+        shape[DIM_CHANNEL] = channels;
+        shape[DIM_SPATIAL_Z] = shape[DIM_TEMPORAL_T] = shape[DIM_SUBCHANNEL] =
+          shape[DIM_MODULO_Z] = shape[DIM_MODULO_T] = shape[DIM_MODULO_C] = 1;
+        const PixelBufferBase::storage_order_type planar
+          (PixelBufferBase::make_storage_order(ome::xml::model::enums::DimensionOrder::XYZTC, false));
+        VariantPixelBuffer planes(shape, type, planar, PIXEL_UNINITIALIZED);
+
+        std::array<VariantPixelBuffer::size_type, 9> planeshape(shape);
+        planeshape[DIM_CHANNEL] = 1;
+
+        std::vector<std::shared_ptr<VariantPixelBuffer>> channelbufs;
+        std::vector<std::future<void>> reads;
+        channelbufs.reserve(channels);
+        reads.reserve(channels);
+
+        VariantPixelBuffer::indices_type idx;
+        idx.fill(0);
+        for (dimension_size_type c = 0; c < channels; ++c)
+          {
+            idx[DIM_CHANNEL] = static_cast<VariantPixelBuffer::indices_type::value_type>(c);
+            PlaneDataVisitor v(idx);
+            boost::apply_visitor(v, planes.vbuffer());
+            channelbufs.push_back(std::make_shared<VariantPixelBuffer>(v.data, v.size, planeshape,
+                                                                       type, planar));
+            try
+              {
+                reads.push_back(openBytesAsync(getIndex(zct[0], c, zct[2]),
+                                               *channelbufs.back(), x, y, w, h));
+              }
+            catch (...)
+              {
+                // Reads in progress use the channel buffers.
+                for (auto& read : reads)
+                  read.wait();
+                throw;
+              }
+          }
+
+        for (auto& read : reads)
+          read.wait();
+        for (auto& read : reads)
+          read.get();
+
+        std::array<VariantPixelBuffer::size_type, 9> merged_shape(planeshape), dest_shape;
+        merged_shape[DIM_SUBCHANNEL] = channels;
+        idx.fill(0);
+        PlaneDataVisitor v(idx);
+        boost::apply_visitor(v, planes.vbuffer());
+        VariantPixelBuffer merged(v.data, v.size * channels, merged_shape, type, planar);
+
+        const PixelBufferBase::storage_order_type interleaved
+          (PixelBufferBase::make_storage_order(ome::xml::model::enums::DimensionOrder::XYZTC, true));
+        std::copy(buf.shape(), buf.shape() + PixelBufferBase::dimensions,
+                  dest_shape.begin());
+        if (type != buf.pixelType() ||
+            !(interleaved == buf.storage_order()) ||
+            merged_shape != dest_shape)
+          buf.setBuffer(merged_shape, type, interleaved, PIXEL_UNINITIALIZED);
+
+        // Interleave the planar subchannels.
+        buf = merged;
+      }
+
+      void
+      FormatReader::close(bool fileOnly)
+      {
+        waitPrefetch();
+        if (in)
+          in = std::shared_ptr<std::istream>(); // set to null.
+        if (!fileOnly)
+          {
+            currentId = boost::none;
+            coreIndex = series = resolution = plane = 0;
+            core.clear();
+            seriesCoreIndexes.clear();
+            coreIndexSeries.clear();
+            indexMappers.clear();
+            for (auto& files : cachedSeriesUsedFiles)
+              files.clear();
+            for (auto& files : cachedUsedFiles)
+              files.clear();
+            for (auto& files : cachedAdvancedUsedFiles)
+              files.clear();
+            metadataStorePending = false;
+            lastRead = lastReadahead = boost::none;
+            std::lock_guard<std::mutex> lock(pixelStatisticsMutex);
+            pixelStatistics.clear();
+          }
+      }
+
+      dimension_size_type
+      FormatReader::getSeriesCount() const
+      {
+        assertId(currentId, true);
+        dimension_size_type size = core.size();
+        if (!hasFlattenedResolutions()) {
+          size = coreIndexToSeries(core.size() - 1) + 1;
+        }
+        return size;
+      }
+
+      void
+      FormatReader::setSeries(dimension_size_type series) const
+      {
+        this->coreIndex = seriesToCoreIndex(series);
+        this->series = series;
+        this->resolution = 0;
+        this->plane = 0;
+      }
+
+      dimension_size_type
+      FormatReader::getSeries() const
+      {
+        return series;
+      }
+
+      void
+      FormatReader::setPlane(dimension_size_type plane) const
+      {
+        assertId(currentId, true);
+
+        if (plane >= getImageCount())
+          {
+            boost::format fmt("Invalid plane: %1%");
+            fmt % plane;
+            throw std::logic_error(fmt.str());
+          }
+
+        this->plane = plane;
+      }
+
+      dimension_size_type
+      FormatReader::getPlane() const
+      {
+        assertId(currentId, true);
+
+        return plane;
+      }
+
+      void
+      FormatReader::setGroupFiles(bool group)
+      {
+        assertId(currentId, false);
+        this->group = group;
+      }
+
+      bool
+      FormatReader::isGroupFiles() const
+      {
+        return group;
+      }
+
+      FormatReader::FileGroupOption
+      FormatReader::fileGroupOption(const std::string& /* id */)
+      {
+        return CANNOT_GROUP;
+      }
+
+      bool
       FormatReader::isMetadataComplete() const
       {
         assertId(currentId, true);
@@ -856,6 +2047,140 @@ namespace ome
         return normalizeData;
       }
 
+      void
+      FormatReader::setDecodeThreads(dimension_size_type threads)
+      {
+        assertId(currentId, false);
+        decodeThreads = threads ? threads : 1U;
+      }
+
+      dimension_size_type
+      FormatReader::getDecodeThreads() const
+      {
+        return decodeThreads;
+      }
+
+      void
+      FormatReader::setVerifyTileChecksums(bool verify)
+      {
+        assertId(currentId, false);
+        verifyTileChecksums = verify;
+      }
+
+      bool
+      FormatReader::getVerifyTileChecksums() const
+      {
+        return verifyTileChecksums;
+      }
+
+      void
+      FormatReader::setStatistics(const std::shared_ptr<IOStatistics>& statistics)
+      {
+        assertId(currentId, false);
+        this->statistics = statistics ? statistics : std::make_shared<IOStatistics>();
+      }
+
+      const std::shared_ptr<IOStatistics>&
+      FormatReader::getStatistics() const
+      {
+        return statistics;
+      }
+
+      void
+      FormatReader::setPixelStatisticsEnabled(bool enabled)
+      {
+        pixelStatisticsEnabled = enabled;
+      }
+
+      bool
+      FormatReader::getPixelStatisticsEnabled() const
+      {
+        return pixelStatisticsEnabled;
+      }
+
+      std::shared_ptr<const PixelStatistics>
+      FormatReader::getPixelStatistics(dimension_size_type plane) const
+      {
+        assertId(currentId, true);
+
+        std::lock_guard<std::mutex> lock(pixelStatisticsMutex);
+        auto found = pixelStatistics.find(std::make_pair(getCoreIndex(), plane));
+        if (found != pixelStatistics.end())
+          return found->second;
+        return std::shared_ptr<const PixelStatistics>();
+      }
+
+      void
+      FormatReader::setReadahead(bool readahead)
+      {
+        this->readahead = readahead;
+        lastRead = lastReadahead = boost::none;
+      }
+
+      bool
+      FormatReader::getReadahead() const
+      {
+        return readahead;
+      }
+
+      void
+      FormatReader::setMemoryBudget(const std::shared_ptr<MemoryBudget>& budget)
+      {
+        memoryBudget = budget;
+      }
+
+      const std::shared_ptr<MemoryBudget>&
+      FormatReader::getMemoryBudget() const
+      {
+        return memoryBudget;
+      }
+
+      std::shared_ptr<PixelStatistics>
+      FormatReader::newPixelStatistics(dimension_size_type plane,
+                                       dimension_size_type x,
+                                       dimension_size_type y,
+                                       dimension_size_type w,
+                                       dimension_size_type h) const
+      {
+        if (!pixelStatisticsEnabled ||
+            x != 0 || y != 0 || w != getSizeX() || h != getSizeY())
+          return std::shared_ptr<PixelStatistics>();
+
+        std::lock_guard<std::mutex> lock(pixelStatisticsMutex);
+        if (pixelStatistics.find(std::make_pair(getCoreIndex(), plane)) != pixelStatistics.end())
+          return std::shared_ptr<PixelStatistics>();
+        return std::make_shared<PixelStatistics>();
+      }
+
+      void
+      FormatReader::cachePixelStatistics(dimension_size_type                     plane,
+                                         const std::shared_ptr<PixelStatistics>& stats) const
+      {
+        std::lock_guard<std::mutex> lock(pixelStatisticsMutex);
+        pixelStatistics[std::make_pair(getCoreIndex(), plane)] = stats;
+      }
+
+      void
+      FormatReader::setExecutor(const std::shared_ptr<Executor>& executor)
+      {
+        this->executor = executor;
+      }
+
+      void
+      FormatReader::setExecutor(const executor_type& executor)
+      {
+        if (executor)
+          this->executor = std::make_shared<FunctionExecutor>(executor);
+        else
+          this->executor.reset();
+      }
+
+      const std::shared_ptr<Executor>&
+      FormatReader::getExecutor() const
+      {
+        return executor;
+      }
+
       void
       FormatReader::setOriginalMetadataPopulated(bool populate)
       {
@@ -869,22 +2194,26 @@ namespace ome
         return saveOriginalMetadata;
       }
 
-      const std::vector<boost::filesystem::path>
+      const std::vector<boost::filesystem::path>&
       FormatReader::getUsedFiles(bool noPixels) const
       {
-        SaveSeries sentry(*this);
-        std::set<path> files;
-        for (dimension_size_type i = 0; i < getSeriesCount(); ++i)
-          {
-            setSeries(i);
-            for (const auto& file : getSeriesUsedFiles(noPixels))
-              files.insert(file);
-          }
-        return std::vector<path>(files.begin(), files.end());
+        assertId(currentId, true);
+        return cachedUsedFiles[noPixels ? 1 : 0];
       }
 
-      const std::vector<boost::filesystem::path>
+      const std::vector<boost::filesystem::path>&
       FormatReader::getSeriesUsedFiles(bool noPixels) const
+      {
+        static const std::vector<path> empty;
+
+        const std::vector<std::vector<path>>& files(cachedSeriesUsedFiles[noPixels ? 1 : 0]);
+        if (coreIndex < files.size())
+          return files[coreIndex];
+        return empty;
+      }
+
+      std::vector<boost::filesystem::path>
+      FormatReader::findSeriesUsedFiles(bool noPixels) const
       {
         std::vector<path> ret;
         if (!noPixels && currentId)
@@ -895,55 +2224,43 @@ namespace ome
       std::vector<FileInfo>
       FormatReader::getAdvancedUsedFiles(bool noPixels) const
       {
-        std::vector<path> files = getUsedFiles(noPixels);
-        std::vector<FileInfo> infos(files.size());
-
-        for (const auto& file : files)
-          {
-            FileInfo info;
-            info.filename = file;
-            info.reader = getFormat();
-            info.usedToInitialize = false;
-
-            const boost::optional<path> currentid = getCurrentFile();
-            if (currentid)
-              {
-                path current = ome::common::canonical(currentid.get());
-                path thisfile = ome::common::canonical(file);
-
-                info.usedToInitialize = (thisfile == current);
-              }
-
-            infos.push_back(info);
-          }
-        return infos;
+        assertId(currentId, true);
+        return cachedAdvancedUsedFiles[noPixels ? 1 : 0];
       }
 
       std::vector<FileInfo>
       FormatReader::getAdvancedSeriesUsedFiles(bool noPixels) const
       {
-        std::vector<path> files = getSeriesUsedFiles(noPixels);
-        std::vector<FileInfo> infos(files.size());
+        return makeFileInfo(getSeriesUsedFiles(noPixels), getFormat(), getCurrentFile());
+      }
 
-        for (const auto& file : files)
-          {
-            FileInfo info;
-            info.filename = file;
-            info.reader = getFormat();
-            info.usedToInitialize = false;
+      void
+      FormatReader::updateUsedFiles()
+      {
+        for (auto& files : cachedSeriesUsedFiles)
+          files.clear();
+        for (auto& files : cachedUsedFiles)
+          files.clear();
+        for (auto& files : cachedAdvancedUsedFiles)
+          files.clear();
 
-            const boost::optional<path> currentid = getCurrentFile();
-            if (currentid)
+        SaveSeries sentry(*this);
+        for (std::array<std::vector<path>, 2>::size_type i = 0; i < cachedUsedFiles.size(); ++i)
+          {
+            const bool noPixels(i != 0);
+            std::vector<std::vector<path>> found;
+            found.reserve(core.size());
+            std::set<path> files;
+            for (dimension_size_type c = 0; c < core.size(); ++c)
               {
-                path current = ome::common::canonical(currentid.get());
-                path thisfile = ome::common::canonical(file);
-
-                info.usedToInitialize = (thisfile == current);
+                setCoreIndex(c);
+                found.push_back(findSeriesUsedFiles(noPixels));
+                files.insert(found.back().begin(), found.back().end());
               }
-
-            infos.push_back(info);
+            cachedSeriesUsedFiles[i].swap(found);
+            cachedUsedFiles[i].assign(files.begin(), files.end());
+            cachedAdvancedUsedFiles[i] = makeFileInfo(cachedUsedFiles[i], getFormat(), getCurrentFile());
           }
-        return infos;
       }
 
       const boost::optional<boost::filesystem::path>&
@@ -957,13 +2274,7 @@ namespace ome
                              dimension_size_type c,
                              dimension_size_type t) const
       {
-        assertId(currentId, true);
-        return ome::files::getIndex(getDimensionOrder(),
-                                         getSizeZ(),
-                                         getEffectiveSizeC(),
-                                         getSizeT(),
-                                         getImageCount(),
-                                         z, c, t);
+        return getDimensionIndexMapper().getIndex(z, c, t);
       }
 
       dimension_size_type
@@ -974,49 +2285,53 @@ namespace ome
                              dimension_size_type moduloC,
                              dimension_size_type moduloT) const
       {
-        assertId(currentId, true);
-        return ome::files::getIndex(getDimensionOrder(),
-                                         getSizeZ(),
-                                         getEffectiveSizeC(),
-                                         getSizeT(),
-                                         getModuloZ().size(),
-                                         getModuloC().size(),
-                                         getModuloT().size(),
-                                         getImageCount(),
-                                         z, c, t,
-                                         moduloZ, moduloC, moduloT);
+        return getDimensionIndexMapper().getIndex(z, c, t,
+                                                  moduloZ, moduloC, moduloT);
       }
 
       std::array<dimension_size_type, 3>
       FormatReader::getZCTCoords(dimension_size_type index) const
       {
-        assertId(currentId, true);
-        return ome::files::getZCTCoords(getDimensionOrder(),
-                                             getSizeZ(),
-                                             getEffectiveSizeC(),
-                                             getSizeT(),
-                                             getImageCount(),
-                                             index);
+        return getDimensionIndexMapper().getZCTCoords(index);
       }
 
       std::array<dimension_size_type, 6>
       FormatReader::getZCTModuloCoords(dimension_size_type index) const
+      {
+        return getDimensionIndexMapper().getZCTModuloCoords(index);
+      }
+
+      const DimensionIndexMapper&
+      FormatReader::getDimensionIndexMapper() const
       {
         assertId(currentId, true);
-        return ome::files::getZCTCoords(getDimensionOrder(),
-                                             getSizeZ(),
-                                             getEffectiveSizeC(),
-                                             getSizeT(),
-                                             getModuloZ().size(),
-                                             getModuloC().size(),
-                                             getModuloT().size(),
-                                             getImageCount(),
-                                             index);
+
+        const dimension_size_type index = getCoreIndex();
+        if (indexMappers.size() <= index)
+          indexMappers.resize(index + 1U);
+
+        DimensionIndexMapper& mapper(indexMappers[index]);
+        const std::string& order(getDimensionOrder());
+        const dimension_size_type sizeZ = getSizeZ();
+        const dimension_size_type sizeC = getEffectiveSizeC();
+        const dimension_size_type sizeT = getSizeT();
+        const dimension_size_type moduloZ = getModuloZ().size();
+        const dimension_size_type moduloC = getModuloC().size();
+        const dimension_size_type moduloT = getModuloT().size();
+        const dimension_size_type num = getImageCount();
+
+        if (!mapper.matches(order, sizeZ, sizeC, sizeT,
+                            moduloZ, moduloC, moduloT, num))
+          mapper = DimensionIndexMapper(order, sizeZ, sizeC, sizeT,
+                                        moduloZ, moduloC, moduloT, num);
+
+        return mapper;
       }
 
       const MetadataMap::value_type&
       FormatReader::getMetadataValue(const std::string& field) const
       {
+        fillPendingMetadata();
         return metadata.get<MetadataMap::value_type>(field);
       }
 
@@ -1030,6 +2345,7 @@ namespace ome
       const MetadataMap&
       FormatReader::getGlobalMetadata() const
       {
+        fillPendingMetadata();
         return metadata;
       }
 
@@ -1037,6 +2353,7 @@ namespace ome
       FormatReader::getSeriesMetadata() const
       {
         assertId(currentId, true);
+        fillPendingMetadata();
         return getCoreMetadata(getCoreIndex()).seriesMetadata;
       }
 
@@ -1074,12 +2391,14 @@ namespace ome
       const std::shared_ptr<::ome::xml::meta::MetadataStore>&
       FormatReader::getMetadataStore() const
       {
+        fillPendingMetadata();
         return metadataStore;
       }
 
       std::shared_ptr<::ome::xml::meta::MetadataStore>&
       FormatReader::getMetadataStore()
       {
+        fillPendingMetadata();
         return metadataStore;
       }
 
@@ -1192,22 +2511,34 @@ namespace ome
             // Use corresponding coreIndex
             index = coreIndex - resolution;
           }
+        else if (coreIndexSeries.size() == core.size() && !core.empty())
+          {
+            if (series >= seriesCoreIndexes.size())
+              {
+                boost::format fmt("Invalid series: %1%");
+                fmt % series;
+                throw std::logic_error(fmt.str());
+              }
+            index = seriesCoreIndexes[series];
+          }
         else
           {
-            dimension_size_type idx = 0;
-            for (coremetadata_list_type::const_iterator i = core.begin();
-                 i != core.end();
-                 ++i, ++idx)
+            for (dimension_size_type idx = 0; idx < series; ++idx)
               {
-                if (series == idx)
-                  break;
+                if (index >= core.size())
+                  {
+                    boost::format fmt("Invalid series: %1%");
+                    fmt % series;
+                    throw std::logic_error(fmt.str());
+                  }
 
-                if (*i)
-                  index += (*i)->resolutionCount;
+                const coremetadata_list_type::value_type& v(core[index]);
+                if (v)
+                  index += v->resolutionCount;
                 else
                   {
                     boost::format fmt("Invalid series (null core[%1%]): %2%");
-                    fmt % idx % series;
+                    fmt % index % series;
                     throw std::logic_error(fmt.str());
                   }
 
@@ -1218,12 +2549,6 @@ namespace ome
                     throw std::logic_error(fmt.str());
                   }
               }
-            if (series != idx)
-              {
-                boost::format fmt("Invalid series: %1%");
-                fmt % series;
-                throw std::logic_error(fmt.str());
-              }
           }
 
         return index;
@@ -1251,6 +2576,10 @@ namespace ome
             // Use corresponding series
             series = this->series;
           }
+        else if (coreIndexSeries.size() == core.size())
+          {
+            series = coreIndexSeries[index];
+          }
         else
           {
             // Convert from non-flattened coreIndex to flattened series
@@ -1278,6 +2607,31 @@ namespace ome
         return series;
       }
 
+      void
+      FormatReader::updateSeriesIndex()
+      {
+        seriesCoreIndexes.clear();
+        coreIndexSeries.clear();
+
+        std::vector<dimension_size_type> starts;
+        std::vector<dimension_size_type> series;
+        series.reserve(core.size());
+
+        for (coremetadata_list_type::size_type i = 0; i < core.size();)
+          {
+            const coremetadata_list_type::value_type& v(core[i]);
+            // Leave invalid metadata to be reported by the fallback.
+            if (!v || !v->resolutionCount || v->resolutionCount > core.size() - i)
+              return;
+            series.insert(series.end(), v->resolutionCount, starts.size());
+            starts.push_back(i);
+            i += v->resolutionCount;
+          }
+
+        seriesCoreIndexes.swap(starts);
+        coreIndexSeries.swap(series);
+      }
+
       dimension_size_type
       FormatReader::getResolutionCount() const
       {
@@ -1324,6 +2678,87 @@ namespace ome
         flattenedResolutions = flatten;
       }
 
+      std::shared_ptr<::ome::files::FormatReader>
+      FormatReader::clone() const
+      {
+        assertId(currentId, true);
+
+        std::shared_ptr<FormatReader> reader(newClone());
+        if (!reader)
+          throw std::logic_error("Reader does not support cloning");
+
+        // The metadata store is shared, so must be complete.
+        fillPendingMetadata();
+
+        reader->copyState(*this);
+        return reader;
+      }
+
+      std::shared_ptr<const tiff::IFD>
+      FormatReader::getPlaneIFD(dimension_size_type plane) const
+      {
+        assertId(currentId, true);
+
+        if (plane >= getImageCount())
+          {
+            boost::format fmt("Invalid plane: %1%");
+            fmt % plane;
+            throw std::logic_error(fmt.str());
+          }
+
+        return std::shared_ptr<const tiff::IFD>();
+      }
+
+      std::shared_ptr<const TileBuffer>
+      FormatReader::openTile(dimension_size_type plane,
+                             dimension_size_type tile) const
+      {
+        std::shared_ptr<const tiff::IFD> ifd(getPlaneIFD(plane));
+        if (!ifd)
+          {
+            boost::format fmt("Plane %1% is not stored as tiles or strips");
+            fmt % plane;
+            throw std::logic_error(fmt.str());
+          }
+
+        return ifd->readTile(tile);
+      }
+
+      std::shared_ptr<FormatReader>
+      FormatReader::newClone() const
+      {
+        return std::shared_ptr<FormatReader>();
+      }
+
+      void
+      FormatReader::copyState(const FormatReader& source)
+      {
+        currentId = source.currentId;
+        metadata = source.metadata;
+        core = source.core;
+        seriesCoreIndexes = source.seriesCoreIndexes;
+        coreIndexSeries = source.coreIndexSeries;
+        flattenedResolutions = source.flattenedResolutions;
+        normalizeData = source.normalizeData;
+        decodeThreads = source.decodeThreads;
+        verifyTileChecksums = source.verifyTileChecksums;
+        statistics = source.statistics;
+        pixelStatisticsEnabled = source.pixelStatisticsEnabled;
+        readahead = source.readahead;
+        memoryBudget = source.memoryBudget;
+        filterMetadata = source.filterMetadata;
+        saveOriginalMetadata = source.saveOriginalMetadata;
+        indexedAsRGB = source.indexedAsRGB;
+        group = source.group;
+        metadataStore = source.metadataStore;
+        metadataOptions = source.metadataOptions;
+        executor = source.executor;
+        indexMappers = source.indexMappers;
+        cachedSeriesUsedFiles = source.cachedSeriesUsedFiles;
+        cachedUsedFiles = source.cachedUsedFiles;
+        cachedAdvancedUsedFiles = source.cachedAdvancedUsedFiles;
+      }
+
       dimension_size_type
       FormatReader::getCoreIndex() const
       {
@@ -1361,69 +2796,100 @@ namespace ome
         //    LOGGER.debug("{} initializing {}", getFormat(), id);
         if (!currentId || canonicalpath != currentId.get())
           {
-            initFile(canonicalpath);
-
-            const std::shared_ptr<::ome::xml::meta::OMEXMLMetadata>& store =
-              std::dynamic_pointer_cast<::ome::xml::meta::OMEXMLMetadata>(getMetadataStore());
-            if(store)
+            if (metadataOptions.getMetadataLevel() == MetadataOptions::METADATA_PIXELS)
               {
-                if(saveOriginalMetadata)
+                // Initialise with a dummy store, so that only the
+                // core metadata is read; the real store is filled on
+                // first access.
+                std::shared_ptr<::ome::xml::meta::MetadataStore> store(metadataStore);
+                metadataStore = std::make_shared<DummyMetadata>();
+                try
                   {
-                    MetadataMap allMetadata(metadata);
-
-                    setSeries(0);
-                    {
-                      SaveSeries(*this);
-                      for (dimension_size_type series = 0;
-                           series < getSeriesCount();
-                           ++series)
-                        {
-                          boost::format fmt("Series %1%");
-                          fmt % series;
-                          std::string name(fmt.str());
-
-                          try
-                            {
-                              std::string imageName = store->getImageName(series);
-                              if (!imageName.empty() && ome::common::trim(imageName).size() != 0)
-                                name = imageName;
-                            }
-                          catch (const std::exception&)
-                            {
-                            }
-                          setSeries(series);
-                          const MetadataMap& sm(getSeriesMetadata());
-                          for (MetadataMap::const_iterator i = sm.begin();
-                               i != sm.end();
-                               ++i)
-                            allMetadata.set(name + " " + i->first, i->second);
-                        }
-                    }
-
-                    fillOriginalMetadata(*store, allMetadata);
+                    initFile(canonicalpath);
+                  }
+                catch (...)
+                  {
+                    metadataStore = store;
+                    throw;
                   }
+                metadataStore = store;
+                updateSeriesIndex();
+                updateUsedFiles();
+                metadataStorePending = !std::dynamic_pointer_cast<DummyMetadata>(store);
+              }
+            else
+              {
+                initFile(canonicalpath);
+                updateSeriesIndex();
+                updateUsedFiles();
+                completeMetadataStore();
+              }
+          }
+      }
+
+      void
+      FormatReader::completeMetadataStore()
+      {
+        const std::shared_ptr<::ome::xml::meta::OMEXMLMetadata>& store =
+          std::dynamic_pointer_cast<::ome::xml::meta::OMEXMLMetadata>(getMetadataStore());
+        if(store)
+          {
+            if(saveOriginalMetadata)
+              {
+                MetadataMap allMetadata(metadata);
 
                 setSeries(0);
                 {
                   SaveSeries(*this);
-
                   for (dimension_size_type series = 0;
                        series < getSeriesCount();
                        ++series)
                     {
-                      setSeries(series);
+                      boost::format fmt("Series %1%");
+                      fmt % series;
+                      std::string name(fmt.str());
 
-                      if (getModuloZ().size() > 0 || getModuloC().size() > 0 ||
-                          getModuloT().size() > 0)
+                      try
                         {
-                          /**
-                           * @todo Implement addModuloAlong.  Requires bits of MetadataTools OMEXMLServiceImpl.
-                           */
-                          // addModuloAlong(store, core.get(series), series);
+                          std::string imageName = store->getImageName(series);
+                          if (!imageName.empty() && ome::common::trim(imageName).size() != 0)
+                            name = imageName;
                         }
+                      catch (const std::exception&)
+                        {
+                        }
+                      setSeries(series);
+                      const MetadataMap& sm(getSeriesMetadata());
+                      for (MetadataMap::const_iterator i = sm.begin();
+                           i != sm.end();
+                           ++i)
+                        allMetadata.set(name + " " + i->first, i->second);
                     }
                 }
+
+                fillOriginalMetadata(*store, allMetadata);
               }
+
+            setSeries(0);
+            {
+              SaveSeries(*this);
+
+              for (dimension_size_type series = 0;
+                   series < getSeriesCount();
+                   ++series)
+                {
+                  setSeries(series);
+
+                  if (getModuloZ().size() > 0 || getModuloC().size() > 0 ||
+                      getModuloT().size() > 0)
+                    {
+                      /**
+                       * @todo Implement addModuloAlong.  Requires bits of MetadataTools OMEXMLServiceImpl.
+                       */
+                      // addModuloAlong(store, core.get(series), series);
+                    }
+                }
+            }
           }
       }
 
@@ -38,17 +38,29 @@
 #ifndef OME_FILES_DETAIL_FORMATREADER_H
 #define OME_FILES_DETAIL_FORMATREADER_H
 
+#include <array>
+#include <functional>
+#include <future>
 #include <string>
 #include <vector>
 #include <map>
+#include <mutex>
 
+#include <ome/files/Executor.h>
 #include <ome/files/FormatReader.h>
+#include <ome/files/FormatTools.h>
 #include <ome/files/FormatHandler.h>
 
 namespace ome
 {
   namespace files
   {
+
+    namespace tiff
+    {
+      class IOSource;
+    }
+
     /**
      * Implementation details.
      *
@@ -150,6 +162,17 @@ namespace ome
         /// Core metadata values.
         coremetadata_list_type core;
 
+        /**
+         * The first core index of each series (non-flattened).
+         *
+         * Computed by updateSeriesIndex(); the series and core index
+         * tables are only used while their size matches @c core.
+         */
+        std::vector<dimension_size_type> seriesCoreIndexes;
+
+        /// The series of each core index (non-flattened).
+        std::vector<dimension_size_type> coreIndexSeries;
+
         /**
          * The number of the current resolution.
          *
@@ -183,6 +206,25 @@ namespace ome
         /// Whether or not to normalize float data.
         bool normalizeData;
 
+        /// Maximum number of threads to use for decoding.
+        dimension_size_type decodeThreads;
+
+        /// Verify tile checksums.
+        bool verifyTileChecksums;
+
+        /// I/O statistics.
+        std::shared_ptr<IOStatistics> statistics;
+
+        /// Accumulate pixel statistics.
+        bool pixelStatisticsEnabled;
+
+        /// Lock for cached pixel statistics.
+        mutable std::mutex pixelStatisticsMutex;
+
+        /// Cached pixel statistics, by core index and plane.
+        mutable std::map<std::pair<dimension_size_type, dimension_size_type>,
+                         std::shared_ptr<const PixelStatistics>> pixelStatistics;
+
         /// Whether or not to filter out invalid metadata.
         bool filterMetadata;
 
@@ -204,9 +246,71 @@ namespace ome
          */
         std::shared_ptr<::ome::xml::meta::MetadataStore> metadataStore;
 
+        /**
+         * Metadata store and original metadata not yet filled.
+         *
+         * Set after a pixels-only open (METADATA_PIXELS); the skipped
+         * metadata is filled on first access.
+         */
+        mutable bool metadataStorePending;
+
         /// Metadata parsing options.
         MetadataOptions metadataOptions;
 
+        /// Executor for asynchronous tasks (null for the default).
+        std::shared_ptr<Executor> executor;
+
+        /// Pending background prefetches.
+        mutable std::vector<std::future<void>> prefetches;
+
+        /// Cancellation token for pending background prefetches.
+        mutable CancellationToken prefetchToken;
+
+        /// Prefetch the next plane or row on sequential access.
+        bool readahead;
+
+        /// A region read with openBytes(), for detecting sequential access.
+        struct SequentialRead
+        {
+          /// Core index.
+          dimension_size_type coreIndex;
+          /// Plane index.
+          dimension_size_type plane;
+          /// Region of the plane.
+          PlaneRegion region;
+          /// Plane index difference from the preceding read.
+          dimension_size_type stride;
+        };
+
+        /// The most recent read with openBytes().
+        mutable boost::optional<SequentialRead> lastRead;
+
+        /// The most recent readahead prefetch.
+        mutable boost::optional<SequentialRead> lastReadahead;
+
+        /// Memory budget (null if unset).
+        std::shared_ptr<MemoryBudget> memoryBudget;
+
+        /// Serialise openBytesConcurrent() reads which switch series.
+        mutable std::mutex concurrentMutex;
+
+        /// Plane index mappers, by core index.
+        mutable std::vector<DimensionIndexMapper> indexMappers;
+
+        /**
+         * Files used by each core index, indexed by the @c noPixels
+         * flag.
+         *
+         * Computed by updateUsedFiles().
+         */
+        std::array<std::vector<std::vector<boost::filesystem::path>>, 2> cachedSeriesUsedFiles;
+
+        /// Files used by the dataset, indexed by the @c noPixels flag.
+        std::array<std::vector<boost::filesystem::path>, 2> cachedUsedFiles;
+
+        /// Advanced files used by the dataset, indexed by the @c noPixels flag.
+        std::array<std::vector<FileInfo>, 2> cachedAdvancedUsedFiles;
+
         /// Constructor.
         FormatReader(const ReaderProperties&);
 
@@ -241,6 +345,41 @@ namespace ome
         void
         initFile(const boost::filesystem::path& id);
 
+        /**
+         * Fill the metadata store after a pixels-only open.
+         *
+         * Called on first access to the metadata store or original
+         * metadata when the file was opened with
+         * MetadataOptions::METADATA_PIXELS.  During initFile() the
+         * metadata store was a DummyMetadata; this must fill the
+         * real metadata store, and the original metadata, as
+         * initFile() would otherwise have done.  The default
+         * implementation fills the store from the core metadata with
+         * fillMetadata(); readers which fill the store from other
+         * sources must override it.
+         */
+        virtual
+        void
+        fillMetadataStore();
+
+        /**
+         * Copy original metadata and modulo annotations to the
+         * metadata store.
+         *
+         * Run after the metadata store has been filled, if it is an
+         * OMEXMLMetadata store.
+         */
+        void
+        completeMetadataStore();
+
+        /**
+         * Fill any metadata skipped by a pixels-only open.
+         *
+         * Does nothing unless metadataStorePending is set.
+         */
+        void
+        fillPendingMetadata() const;
+
         /**
          * Check if a file is in the used files list.
          *
@@ -301,6 +440,75 @@ namespace ome
                   dimension_size_type scanlinePad,
                   dimension_size_type samples);
 
+        /**
+         * Read a raw plane from a positional source.
+         *
+         * Note that the pixel buffer must be of the correct size to
+         * store the pixel data.
+         *
+         * As for readPlane(std::istream&,VariantPixelBuffer&,dimension_size_type,dimension_size_type,dimension_size_type,dimension_size_type,dimension_size_type),
+         * but reading the plane starting at @p offset in @p source.
+         *
+         * @param source the source to read the plane from.
+         * @param offset the offset of the start of the plane.
+         * @param dest the pixel buffer in which to store the plane.
+         * @param x the left edge of the plane.
+         * @param y the top edge of the plane.
+         * @param w the width of the plane.
+         * @param h the height of the plane.
+         * @param samples the number of samples per pixel.
+         */
+        virtual
+        void
+        readPlane(tiff::IOSource&     source,
+                  uint64_t            offset,
+                  VariantPixelBuffer& dest,
+                  dimension_size_type x,
+                  dimension_size_type y,
+                  dimension_size_type w,
+                  dimension_size_type h,
+                  dimension_size_type samples);
+
+        /**
+         * Read a raw plane with scanline padding from a positional
+         * source.
+         *
+         * Note that the pixel buffer must be of the correct size to
+         * store the pixel data.
+         *
+         * The scanlines of the region are read as byte ranges, with
+         * ranges which are contiguous in the source merged, so that
+         * a region spanning the full width of an unpadded plane is
+         * read as a single range.  If the source is memory mapped,
+         * the ranges are copied directly from the mapping;
+         * otherwise they are passed to IOSource::prefetch() and read
+         * into the buffer in place.  Any byte swapping is applied to
+         * each range as it is copied.
+         *
+         * @param source the source to read the plane from.
+         * @param offset the offset of the start of the plane.
+         * @param dest the pixel buffer in which to store the plane.
+         * @param x the left edge of the plane.
+         * @param y the top edge of the plane.
+         * @param w the width of the plane.
+         * @param h the height of the plane.
+         * @param scanlinePad the scanline padding.
+         * @param samples the number of samples per pixel.
+         * @throws std::runtime_error if the plane extends beyond the
+         * end of the source, or on read failure.
+         */
+        virtual
+        void
+        readPlane(tiff::IOSource&     source,
+                  uint64_t            offset,
+                  VariantPixelBuffer& dest,
+                  dimension_size_type x,
+                  dimension_size_type y,
+                  dimension_size_type w,
+                  dimension_size_type h,
+                  dimension_size_type scanlinePad,
+                  dimension_size_type samples);
+
         /**
          * Create a configured FilterMetadata instance.
          *
@@ -313,6 +521,47 @@ namespace ome
         std::shared_ptr<::ome::xml::meta::MetadataStore>
         makeFilterMetadata();
 
+        /**
+         * Compute the series and core index tables.
+         *
+         * This allows seriesToCoreIndex() and coreIndexToSeries() to
+         * be constant-time.  Called by setId() once the core metadata
+         * is complete; readers which replace the core metadata after
+         * setId() should call it again.  If the core metadata is
+         * invalid, the tables are left empty, and the conversions
+         * fall back to searching the core metadata.
+         */
+        void
+        updateSeriesIndex();
+
+        /**
+         * Compute the used file lists.
+         *
+         * The files used by each core index are found once with
+         * findSeriesUsedFiles(), so that getUsedFiles(),
+         * getSeriesUsedFiles() and getAdvancedUsedFiles() need not
+         * rebuild them on every call.  Called by setId() after
+         * updateSeriesIndex(); readers which reinitialize themselves
+         * after setId() should call it again.
+         */
+        void
+        updateUsedFiles();
+
+        /**
+         * Find the files used by the active series.
+         *
+         * Readers using more than the current file should override
+         * this method rather than getSeriesUsedFiles(), which returns
+         * the result cached by updateUsedFiles().
+         *
+         * @param noPixels exclude pixel data files if @c true, or include
+         * them if @c false.
+         * @returns a list of filenames.
+         */
+        virtual
+        std::vector<boost::filesystem::path>
+        findSeriesUsedFiles(bool noPixels) const;
+
         /**
          * Get CoreMetadata by core index.
          *
@@ -399,6 +648,12 @@ namespace ome
         isThisType(std::istream& stream) const;
 
       protected:
+        /**
+         * Maximum number of bytes read from the start of a file by
+         * the default isFilenameThisTypeImpl().
+         */
+        static const std::size_t detection_block_size = 4096U;
+
         /**
          * isThisType file implementation for readers.
          *
@@ -408,6 +663,12 @@ namespace ome
          * specified file using their preferred method and check its
          * validity.
          *
+         * The default implementation reads the first
+         * detection_block_size bytes of the file and checks them with
+         * isStreamThisTypeImpl(), so readers which can identify files
+         * from their initial content need only implement the stream
+         * check.
+         *
          * @param name the file to open for checking.
          * @returns @c true if the file is valid, @c false otherwise.
          */
@@ -556,6 +817,8 @@ namespace ome
         bool
         isInterleaved(dimension_size_type subC) const;
 
+        using files::FormatReader::openBytes;
+
         // Documented in superclass.
         void
         openBytes(dimension_size_type plane,
@@ -583,12 +846,310 @@ namespace ome
                       dimension_size_type w,
                       dimension_size_type h) const = 0;
 
+      public:
+        // Documented in superclass.
+        void
+        openBytesBatch(const std::vector<ReadRequest>& requests) const;
+
+        // Documented in superclass.
+        void
+        openBytesStreamed(dimension_size_type        plane,
+                          const region_visitor_type& visitor,
+                          dimension_size_type        x,
+                          dimension_size_type        y,
+                          dimension_size_type        w,
+                          dimension_size_type        h) const;
+
+      protected:
+        /**
+         * Read several sub-images of image planes.
+         *
+         * The default implementation calls openBytesImpl() for each
+         * request in turn, ordered by plane.  The plane indexes will
+         * have been validated.
+         *
+         * @param requests the sub-images to read.
+         */
+        virtual
+        void
+        openBytesBatchImpl(const std::vector<ReadRequest>& requests) const;
+
+      public:
+        // Documented in superclass.
+        void
+        openBytesConcurrent(dimension_size_type series,
+                            dimension_size_type resolution,
+                            dimension_size_type plane,
+                            VariantPixelBuffer& buf,
+                            dimension_size_type x,
+                            dimension_size_type y,
+                            dimension_size_type w,
+                            dimension_size_type h) const;
+
+      protected:
+        /**
+         * Read a sub-image of an image plane without using the reader
+         * state.
+         *
+         * The core index, plane and region will have been validated.
+         * Implementations must not use or change the current series,
+         * resolution or plane.  The default implementation
+         * serialises the reads, switches to the core index, and
+         * calls openBytesImpl(), restoring the reader state
+         * afterward.
+         *
+         * @param coreIndex the core index of the series and resolution.
+         * @param plane the plane index within the series.
+         * @param buf the destination pixel buffer.
+         * @param x the @c X coordinate of the upper-left corner of the sub-image.
+         * @param y the @c Y coordinate of the upper-left corner of the sub-image.
+         * @param w the width of the sub-image.
+         * @param h the height of the sub-image.
+         */
+        virtual
+        void
+        openBytesConcurrentImpl(dimension_size_type coreIndex,
+                                dimension_size_type plane,
+                                VariantPixelBuffer& buf,
+                                dimension_size_type x,
+                                dimension_size_type y,
+                                dimension_size_type w,
+                                dimension_size_type h) const;
+
+        /**
+         * Get the core index of a series and resolution.
+         *
+         * Unlike seriesToCoreIndex(), this does not use the current
+         * series, and so is safe to call concurrently.
+         *
+         * @param series the series index.
+         * @param resolution the resolution index within the series.
+         * @returns the core index.
+         * @throws std::logic_error if the series or resolution is
+         *   invalid.
+         */
+        dimension_size_type
+        concurrentCoreIndex(dimension_size_type series,
+                            dimension_size_type resolution) const;
+
+      public:
+        // Documented in superclass.
+        std::future<void>
+        openBytesAsync(dimension_size_type      plane,
+                       VariantPixelBuffer&      buf,
+                       Executor::Priority       priority = Executor::PRIORITY_NORMAL,
+                       const CancellationToken& token = CancellationToken()) const;
+
+        // Documented in superclass.
+        std::future<void>
+        openBytesAsync(dimension_size_type      plane,
+                       VariantPixelBuffer&      buf,
+                       dimension_size_type      x,
+                       dimension_size_type      y,
+                       dimension_size_type      w,
+                       dimension_size_type      h,
+                       Executor::Priority       priority = Executor::PRIORITY_NORMAL,
+                       const CancellationToken& token = CancellationToken()) const;
+
+      protected:
+        /**
+         * Create a task to read a sub-image of an image plane.
+         *
+         * The task must not use the reader state, since the reader
+         * may be used concurrently by the caller; it should hold
+         * references to everything it needs, other than the
+         * destination buffer.  The default implementation returns an
+         * empty task, in which case openBytesAsync() reads
+         * synchronously using openBytesImpl().  The plane index will
+         * have been validated.
+         *
+         * @param plane the plane index within the series.
+         * @param buf the destination pixel buffer.
+         * @param x the @c X coordinate of the upper-left corner of the sub-image.
+         * @param y the @c Y coordinate of the upper-left corner of the sub-image.
+         * @param w the width of the sub-image.
+         * @param h the height of the sub-image.
+         * @returns the task, or an empty function if not supported.
+         */
+        virtual
+        std::function<void ()>
+        openBytesTask(dimension_size_type plane,
+                      VariantPixelBuffer& buf,
+                      dimension_size_type x,
+                      dimension_size_type y,
+                      dimension_size_type w,
+                      dimension_size_type h) const;
+
+        /**
+         * Run a task using the executor.
+         *
+         * If @p token is cancelled before the task starts, the task
+         * is not run, and the future holds a CancelledException.
+         *
+         * @param task the task to run.
+         * @param priority the task priority.
+         * @param token the cancellation token for the task.
+         * @returns a future which is ready when the task is complete,
+         * holding any exception thrown by the task.
+         */
+        std::future<void>
+        runAsync(const std::function<void ()>& task,
+                 Executor::Priority            priority = Executor::PRIORITY_NORMAL,
+                 const CancellationToken&      token = CancellationToken()) const;
+
+      public:
+        // Documented in superclass.
+        void
+        prefetch(dimension_size_type plane,
+                 dimension_size_type x,
+                 dimension_size_type y,
+                 dimension_size_type w,
+                 dimension_size_type h) const;
+
+        // Documented in superclass.
+        void
+        cancelPrefetch() const;
+
+      protected:
+        /**
+         * Prefetch a sub-image of an image plane.
+         *
+         * The default implementation does nothing.  Readers which
+         * cache decoded data should override this to read the region
+         * using startPrefetch().  The plane index will have been
+         * validated.
+         *
+         * @copydetails ome::files::FormatReader::prefetch()
+         */
+        virtual
+        void
+        prefetchImpl(dimension_size_type plane,
+                     dimension_size_type x,
+                     dimension_size_type y,
+                     dimension_size_type w,
+                     dimension_size_type h) const;
+
+        /**
+         * Run a prefetch task in the background using the executor.
+         *
+         * The task must not use the reader state, since the reader
+         * may be used concurrently by the caller; it should hold
+         * references to everything it needs.  Exceptions thrown by
+         * the task are ignored.  If too many tasks are pending, the
+         * task will be discarded.  Pending tasks are waited for by
+         * close(), and dropped by cancelPrefetch() if not started.
+         *
+         * @param task the task to run.
+         */
+        void
+        startPrefetch(const std::function<void ()>& task) const;
+
+        /**
+         * Wait for all pending prefetch tasks to complete.
+         */
+        void
+        waitPrefetch() const;
+
+      public:
+        // Documented in superclass.
+        void
+        adviseAccess(AccessHint          hint,
+                     dimension_size_type plane,
+                     dimension_size_type x,
+                     dimension_size_type y,
+                     dimension_size_type w,
+                     dimension_size_type h) const;
+
+      protected:
+        /**
+         * Advise the expected access pattern for a sub-image of an image plane.
+         *
+         * The default implementation does nothing.  The plane index
+         * will have been validated.
+         *
+         * @copydetails ome::files::FormatReader::adviseAccess()
+         */
+        virtual
+        void
+        adviseAccessImpl(AccessHint          hint,
+                         dimension_size_type plane,
+                         dimension_size_type x,
+                         dimension_size_type y,
+                         dimension_size_type w,
+                         dimension_size_type h) const;
+
       public:
         // Documented in superclass.
         void
         openThumbBytes(dimension_size_type plane,
                        VariantPixelBuffer& buf) const;
 
+        // Documented in superclass.
+        void
+        openScaledBytes(dimension_size_type plane,
+                        VariantPixelBuffer& buf,
+                        dimension_size_type x,
+                        dimension_size_type y,
+                        dimension_size_type w,
+                        dimension_size_type h,
+                        dimension_size_type scaledW,
+                        dimension_size_type scaledH) const;
+
+      protected:
+        /**
+         * Read a sub-image of an image plane at a reduced scale.
+         *
+         * Used by openThumbBytes() and openScaledBytes() to read the
+         * tiles of the region at 1/2, 1/4 or 1/8 scale, where the
+         * reader can do so more cheaply than reading at full scale,
+         * such as by decoding JPEG data at reduced scale.  The
+         * region is in the coordinates of the current resolution,
+         * and its origin is a multiple of @p scale.  The destination
+         * buffer must be resized to ⌈w/scale⌉×⌈h/scale⌉.  The default
+         * implementation returns @c false.
+         *
+         * @param plane the plane index within the series.
+         * @param buf the destination pixel buffer.
+         * @param x the @c X coordinate of the upper-left corner of the sub-image.
+         * @param y the @c Y coordinate of the upper-left corner of the sub-image.
+         * @param w the width of the sub-image.
+         * @param h the height of the sub-image.
+         * @param scale the scale denominator.
+         * @returns @c true if the sub-image was read, or @c false if
+         * reading at this scale is not supported, in which case the
+         * sub-image is read at full scale and downsampled.
+         */
+        virtual
+        bool
+        openReducedBytesImpl(dimension_size_type plane,
+                             VariantPixelBuffer& buf,
+                             dimension_size_type x,
+                             dimension_size_type y,
+                             dimension_size_type w,
+                             dimension_size_type h,
+                             dimension_size_type scale) const;
+
+      public:
+        // Documented in superclass.
+        void
+        openConvertedBytes(dimension_size_type                 plane,
+                           VariantPixelBuffer&                 buf,
+                           dimension_size_type                 x,
+                           dimension_size_type                 y,
+                           dimension_size_type                 w,
+                           dimension_size_type                 h,
+                           ::ome::xml::model::enums::PixelType type,
+                           const PixelConversion&              conversion) const;
+
+        // Documented in superclass.
+        void
+        openMergedBytes(dimension_size_type plane,
+                        VariantPixelBuffer& buf,
+                        dimension_size_type x,
+                        dimension_size_type y,
+                        dimension_size_type w,
+                        dimension_size_type h) const;
+
         // Documented in superclass.
         void
         close(bool fileOnly = false);
@@ -637,6 +1198,144 @@ namespace ome
         bool
         isNormalized() const;
 
+        // Documented in superclass.
+        void
+        setDecodeThreads(dimension_size_type threads);
+
+        // Documented in superclass.
+        dimension_size_type
+        getDecodeThreads() const;
+
+        // Documented in superclass.
+        void
+        setVerifyTileChecksums(bool verify);
+
+        // Documented in superclass.
+        bool
+        getVerifyTileChecksums() const;
+
+        // Documented in superclass.
+        void
+        setStatistics(const std::shared_ptr<IOStatistics>& statistics);
+
+        // Documented in superclass.
+        const std::shared_ptr<IOStatistics>&
+        getStatistics() const;
+
+        // Documented in superclass.
+        void
+        setPixelStatisticsEnabled(bool enabled);
+
+        // Documented in superclass.
+        bool
+        getPixelStatisticsEnabled() const;
+
+        // Documented in superclass.
+        std::shared_ptr<const PixelStatistics>
+        getPixelStatistics(dimension_size_type plane) const;
+
+        // Documented in superclass.
+        void
+        setReadahead(bool readahead);
+
+        // Documented in superclass.
+        bool
+        getReadahead() const;
+
+        // Documented in superclass.
+        void
+        setMemoryBudget(const std::shared_ptr<MemoryBudget>& budget);
+
+        // Documented in superclass.
+        const std::shared_ptr<MemoryBudget>&
+        getMemoryBudget() const;
+
+      protected:
+        /**
+         * Get new pixel statistics to accumulate while reading.
+         *
+         * Statistics are only accumulated if enabled, for reads of a
+         * whole plane, and if not already cached for the plane.
+         *
+         * @param plane the plane index within the current series.
+         * @param x the @c X coordinate of the upper-left corner of the sub-image.
+         * @param y the @c Y coordinate of the upper-left corner of the sub-image.
+         * @param w the width of the sub-image.
+         * @param h the height of the sub-image.
+         * @returns the statistics to accumulate, or null if not
+         * required.
+         */
+        std::shared_ptr<PixelStatistics>
+        newPixelStatistics(dimension_size_type plane,
+                           dimension_size_type x,
+                           dimension_size_type y,
+                           dimension_size_type w,
+                           dimension_size_type h) const;
+
+        /**
+         * Cache the pixel statistics of a plane.
+         *
+         * @param plane the plane index within the current series.
+         * @param stats the statistics of the whole plane.
+         */
+        void
+        cachePixelStatistics(dimension_size_type                     plane,
+                             const std::shared_ptr<PixelStatistics>& stats) const;
+
+        /**
+         * Obtain a sub-image of an image plane without normalization.
+         *
+         * This is openBytes() as if normalization was disabled.
+         *
+         * @param plane the plane index within the series.
+         * @param buf the destination pixel buffer.
+         * @param x the @c X coordinate of the upper-left corner of the sub-image.
+         * @param y the @c Y coordinate of the upper-left corner of the sub-image.
+         * @param w the width of the sub-image.
+         * @param h the height of the sub-image.
+         */
+        void
+        openRawBytes(dimension_size_type plane,
+                     VariantPixelBuffer& buf,
+                     dimension_size_type x,
+                     dimension_size_type y,
+                     dimension_size_type w,
+                     dimension_size_type h) const;
+
+        /**
+         * Record a read for sequential access detection.
+         *
+         * If readahead is enabled and the read continues a
+         * sequence, the next plane or row of the sequence is
+         * prefetched with prefetchImpl().
+         *
+         * @param plane the plane index within the series.
+         * @param x the @c X coordinate of the upper-left corner of the sub-image.
+         * @param y the @c Y coordinate of the upper-left corner of the sub-image.
+         * @param w the width of the sub-image.
+         * @param h the height of the sub-image.
+         */
+        void
+        recordRead(dimension_size_type plane,
+                   dimension_size_type x,
+                   dimension_size_type y,
+                   dimension_size_type w,
+                   dimension_size_type h) const;
+
+      public:
+
+        // Documented in superclass.
+        void
+        setExecutor(const std::shared_ptr<Executor>& executor);
+
+        // Documented in superclass.
+        void
+        setExecutor(const executor_type& executor);
+
+        // Documented in superclass.
+        const std::shared_ptr<Executor>&
+        getExecutor() const;
+
         // Documented in superclass.
         void
         setOriginalMetadataPopulated(bool populate);
@@ -646,11 +1345,11 @@ namespace ome
         isOriginalMetadataPopulated() const;
 
         // Documented in superclass.
-        const std::vector<boost::filesystem::path>
+        const std::vector<boost::filesystem::path>&
         getUsedFiles(bool noPixels = false) const;
 
         // Documented in superclass.
-        const std::vector<boost::filesystem::path>
+        const std::vector<boost::filesystem::path>&
         getSeriesUsedFiles(bool noPixels = false) const;
 
         // Documented in superclass.
@@ -688,6 +1387,18 @@ namespace ome
         std::array<dimension_size_type, 6>
         getZCTModuloCoords(dimension_size_type index) const;
 
+        /**
+         * Get the plane index mapper for the current series.
+         *
+         * The mapper is cached for each series, and rebuilt only if
+         * the dimension order, sizes or modulo sizes change.
+         *
+         * @returns the mapper.
+         * @throws std::logic_error if the dimensions are invalid.
+         */
+        const DimensionIndexMapper&
+        getDimensionIndexMapper() const;
+
         // Documented in superclass.
         const std::vector<std::shared_ptr<::ome::files::CoreMetadata>>&
         getCoreMetadataList() const;
@@ -792,6 +1503,49 @@ namespace ome
         void
         setFlattenedResolutions(bool flatten);
 
+        // Documented in superclass.
+        std::shared_ptr<::ome::files::FormatReader>
+        clone() const;
+
+        // Documented in superclass.
+        std::shared_ptr<const tiff::IFD>
+        getPlaneIFD(dimension_size_type plane) const;
+
+        // Documented in superclass.
+        std::shared_ptr<const TileBuffer>
+        openTile(dimension_size_type plane,
+                 dimension_size_type tile) const;
+
+      protected:
+        /**
+         * Create an uninitialized reader of the same type for clone().
+         *
+         * The default implementation returns null, in which case
+         * cloning is not supported.
+         *
+         * @returns the new reader, or null if not supported.
+         */
+        virtual
+        std::shared_ptr<FormatReader>
+        newClone() const;
+
+        /**
+         * Copy the parsed state of another reader for clone().
+         *
+         * This reader is uninitialized, and @p source is an
+         * initialized reader of the same type.  The default
+         * implementation shares the core metadata, metadata store
+         * and the other state common to all readers.  Readers must
+         * override this to copy their own state and open their own
+         * files, calling the superclass method first.
+         *
+         * @param source the reader to copy.
+         */
+        virtual
+        void
+        copyState(const FormatReader& source);
+
+      public:
         // Documented in superclass.
         void
         setId(const boost::filesystem::path& id);
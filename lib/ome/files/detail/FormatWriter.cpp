@@ -35,6 +35,7 @@
  * #L%
  */
 
+#include <algorithm>
 #include <cmath>
 #include <fstream>
 
@@ -47,9 +48,13 @@
 
 #include <ome/compat/regex.h>
 
+#include <ome/files/FormatException.h>
+#include <ome/files/FormatReader.h>
 #include <ome/files/FormatTools.h>
 #include <ome/files/PixelBuffer.h>
+#include <ome/files/PixelBufferView.h>
 #include <ome/files/PixelProperties.h>
+#include <ome/files/PixelStatistics.h>
 #include <ome/files/VariantPixelBuffer.h>
 #include <ome/files/detail/FormatWriter.h>
 
@@ -75,6 +80,32 @@ namespace ome
       {
         // Default thumbnail width and height.
         const dimension_size_type THUMBNAIL_DIMENSION = 128;
+
+        // Get the address and size of a plane within a buffer.
+        struct PlaneDataVisitor : public boost::static_visitor<>
+        {
+          const VariantPixelBuffer::indices_type& idx;
+          void *data;
+          VariantPixelBuffer::size_type size;
+
+          PlaneDataVisitor(const VariantPixelBuffer::indices_type& idx):
+            idx(idx),
+            data(nullptr),
+            size(0U)
+          {}
+
+          template<typename T>
+          void
+          operator() (std::shared_ptr<T>& buffer)
+          {
+            typedef typename T::value_type value_type;
+
+            PixelBufferView<value_type> view(*buffer);
+            data = view.plane(idx);
+            size = buffer->shape()[DIM_SPATIAL_X] * buffer->shape()[DIM_SPATIAL_Y] *
+              buffer->shape()[DIM_SUBCHANNEL] * sizeof(value_type);
+          }
+        };
       }
 
       FormatWriter::FormatWriter(const WriterProperties& writerProperties):
@@ -84,12 +115,29 @@ namespace ome
         series(0),
         plane(0),
         compression(boost::none),
+        compressionLevel(boost::none),
+        predictor(boost::none),
         interleaved(boost::none),
         sequential(false),
         framesPerSecond(0),
         tile_size_x(boost::none),
         tile_size_y(boost::none),
-        metadataRetrieve(std::make_shared<DummyMetadata>())
+        accessProfile(boost::none),
+        encodeThreads(1U),
+        executor(),
+        sparseTiles(false),
+        packSamples(false),
+        recordTileStatistics(false),
+        recordTileChecksums(false),
+        statistics(std::make_shared<IOStatistics>()),
+        pixelStatisticsEnabled(false),
+        pixelStatisticsMutex(),
+        pixelStatistics(),
+        writeCacheLimit(0U),
+        writeCacheDirectory(),
+        memoryBudget(),
+        metadataRetrieve(std::make_shared<DummyMetadata>()),
+        indexMappers()
       {
         assertId(currentId, false);
       }
@@ -135,9 +183,14 @@ namespace ome
         series = 0;
         plane = 0;
         compression = boost::none;
+        compressionLevel = boost::none;
+        predictor = boost::none;
         sequential = false;
         framesPerSecond = 0;
         metadataRetrieve.reset();
+        indexMappers.clear();
+        std::lock_guard<std::mutex> lock(pixelStatisticsMutex);
+        pixelStatistics.clear();
       }
 
       bool
@@ -175,6 +228,159 @@ namespace ome
         saveBytes(plane, buf, 0, 0, width, height);
       }
 
+      void
+      FormatWriter::savePlanes(dimension_size_type plane,
+                               VariantPixelBuffer& buf)
+      {
+        assertId(currentId, true);
+
+        for (auto& blockplane : getBlockPlanes(plane, buf))
+          saveBytes(blockplane.first, *blockplane.second);
+      }
+
+      void
+      FormatWriter::saveSeparatedBytes(dimension_size_type plane,
+                                       VariantPixelBuffer& buf)
+      {
+        assertId(currentId, true);
+
+        const VariantPixelBuffer::size_type *shape = buf.shape();
+        const dimension_size_type channels = getEffectiveSizeC();
+
+        if (shape[DIM_SUBCHANNEL] != channels ||
+            shape[DIM_SPATIAL_Z] != 1U || shape[DIM_TEMPORAL_T] != 1U || shape[DIM_CHANNEL] != 1U ||
+            shape[DIM_MODULO_Z] != 1U || shape[DIM_MODULO_T] != 1U || shape[DIM_MODULO_C] != 1U)
+          {
+            boost::format fmt("Buffer with %1% subchannels can not be separated into %2% channels");
+            fmt % shape[DIM_SUBCHANNEL] % channels;
+            throw FormatException(fmt.str());
+          }
+
+        std::array<VariantPixelBuffer::size_type, 9> planarshape;
+        std::copy(shape, shape + PixelBufferBase::dimensions, planarshape.begin());
+        const PixelBufferBase::storage_order_type planar
+          (PixelBufferBase::make_storage_order(ome::xml::model::enums::DimensionOrder::XYZTC, false));
+
+        // Subchannels stored after the spatial dimensions are already
+        // separate planes; otherwise deinterleave them once.
+        const PixelBufferBase::storage_order_type& order(buf.storage_order());
+        VariantPixelBuffer *source = &buf;
+        VariantPixelBuffer deinterleaved;
+        if (channels > 1U &&
+            !(order.ordering(0) == DIM_SPATIAL_X && order.ordering(1) == DIM_SPATIAL_Y &&
+              order.ordering(2) == DIM_SUBCHANNEL &&
+              order.ascending(DIM_SPATIAL_X) && order.ascending(DIM_SPATIAL_Y) &&
+              order.ascending(DIM_SUBCHANNEL)))
+          {
+            deinterleaved.setBuffer(planarshape, buf.pixelType(), planar, PIXEL_UNINITIALIZED);
+            deinterleaved = buf;
+            source = &deinterleaved;
+          }
+
+        // Reinterpret the planar subchannels as a block of channel
+        // planes, each with a single subchannel.
+        VariantPixelBuffer::indices_type idx;
+        idx.fill(0);
+        PlaneDataVisitor v(idx);
+        boost::apply_visitor(v, source->vbuffer());
+
+        std::array<VariantPixelBuffer::size_type, 9> blockshape(planarshape);
+        blockshape[DIM_CHANNEL] = channels;
+        blockshape[DIM_SUBCHANNEL] = 1U;
+        VariantPixelBuffer block(v.data, v.size, blockshape, buf.pixelType(), planar);
+
+        const std::array<dimension_size_type, 3> zct(getZCTCoords(plane));
+        savePlanes(getIndex(zct[0], 0, zct[2]), block);
+      }
+
+      std::vector<FormatWriter::block_plane>
+      FormatWriter::getBlockPlanes(dimension_size_type plane,
+                                   VariantPixelBuffer& buf) const
+      {
+        const VariantPixelBuffer::size_type *shape = buf.shape();
+        const PixelBufferBase::storage_order_type& order(buf.storage_order());
+
+        if (shape[DIM_MODULO_Z] != 1U || shape[DIM_MODULO_T] != 1U || shape[DIM_MODULO_C] != 1U)
+          throw FormatException("Block of planes may not have modulo dimensions");
+
+        // The X, Y and subchannel dimensions must be the innermost
+        // dimensions, with the subchannel dimension first or last.
+        bool interleaved = order.ordering(0) == DIM_SUBCHANNEL;
+        if (!(interleaved ?
+              (order.ordering(1) == DIM_SPATIAL_X && order.ordering(2) == DIM_SPATIAL_Y) :
+              (order.ordering(0) == DIM_SPATIAL_X && order.ordering(1) == DIM_SPATIAL_Y &&
+               order.ordering(2) == DIM_SUBCHANNEL)) ||
+            !order.ascending(DIM_SPATIAL_X) || !order.ascending(DIM_SPATIAL_Y) ||
+            !order.ascending(DIM_SUBCHANNEL))
+          throw FormatException("Block of planes does not store each plane contiguously");
+
+        if (shape[DIM_SUBCHANNEL] == 1U)
+          {
+            const boost::optional<bool> writerInterleaved(getInterleaved());
+            interleaved = writerInterleaved && *writerInterleaved;
+          }
+
+        std::array<dimension_size_type, 3> start(getZCTCoords(plane));
+        if (start[0] + shape[DIM_SPATIAL_Z] > getSizeZ() ||
+            start[1] + shape[DIM_CHANNEL] > getEffectiveSizeC() ||
+            start[2] + shape[DIM_TEMPORAL_T] > getSizeT())
+          {
+            boost::format fmt("Block of %1%z×%2%c×%3%t planes at plane %4% exceeds image size %5%z×%6%c×%7%t");
+            fmt % shape[DIM_SPATIAL_Z] % shape[DIM_CHANNEL] % shape[DIM_TEMPORAL_T] % plane;
+            fmt % getSizeZ() % getEffectiveSizeC() % getSizeT();
+            throw FormatException(fmt.str());
+          }
+
+        std::array<VariantPixelBuffer::size_type, 9> planeshape;
+        planeshape[DIM_SPATIAL_X] = shape[DIM_SPATIAL_X];
+        planeshape[DIM_SPATIAL_Y] = shape[DIM_SPATIAL_Y];
+        planeshape[DIM_SUBCHANNEL] = shape[DIM_SUBCHANNEL];
+        planeshape[DIM_SPATIAL_Z] = planeshape[DIM_TEMPORAL_T] = planeshape[DIM_CHANNEL] =
+          planeshape[DIM_MODULO_Z] = planeshape[DIM_MODULO_T] = planeshape[DIM_MODULO_C] = 1;
+        PixelBufferBase::storage_order_type planeorder
+          (PixelBufferBase::make_storage_order(ome::xml::model::enums::DimensionOrder::XYZTC, interleaved));
+
+        std::vector<block_plane> planes;
+        planes.reserve(shape[DIM_SPATIAL_Z] * shape[DIM_CHANNEL] * shape[DIM_TEMPORAL_T]);
+
+        VariantPixelBuffer::indices_type idx;
+        idx.fill(0);
+        for (dimension_size_type c = 0; c < shape[DIM_CHANNEL]; ++c)
+          for (dimension_size_type t = 0; t < shape[DIM_TEMPORAL_T]; ++t)
+            for (dimension_size_type z = 0; z < shape[DIM_SPATIAL_Z]; ++z)
+              {
+                idx[DIM_SPATIAL_Z] = static_cast<VariantPixelBuffer::indices_type::value_type>(z);
+                idx[DIM_TEMPORAL_T] = static_cast<VariantPixelBuffer::indices_type::value_type>(t);
+                idx[DIM_CHANNEL] = static_cast<VariantPixelBuffer::indices_type::value_type>(c);
+
+                PlaneDataVisitor v(idx);
+                boost::apply_visitor(v, buf.vbuffer());
+
+                planes.push_back(block_plane(getIndex(start[0] + z, start[1] + c, start[2] + t),
+                                             std::make_shared<VariantPixelBuffer>(v.data, v.size, planeshape,
+                                                                                  buf.pixelType(), planeorder)));
+              }
+
+        std::sort(planes.begin(), planes.end(),
+                  [](const block_plane& lhs, const block_plane& rhs)
+                  { return lhs.first < rhs.first; });
+
+        return planes;
+      }
+
+      bool
+      FormatWriter::copyBytes(dimension_size_type plane,
+                              const ::ome::files::FormatReader& reader,
+                              dimension_size_type sourcePlane)
+      {
+        assertId(currentId, true);
+
+        VariantPixelBuffer buf;
+        reader.openBytes(sourcePlane, buf);
+        saveBytes(plane, buf);
+        return false;
+      }
+
       void
       FormatWriter::setSeries(dimension_size_type series) const
       {
@@ -309,6 +515,30 @@ namespace ome
         return this->compression;
       }
 
+      void
+      FormatWriter::setCompressionLevel(int level)
+      {
+        this->compressionLevel = level;
+      }
+
+      const boost::optional<int>&
+      FormatWriter::getCompressionLevel() const
+      {
+        return this->compressionLevel;
+      }
+
+      void
+      FormatWriter::setPredictor(bool predictor)
+      {
+        this->predictor = predictor;
+      }
+
+      const boost::optional<bool>&
+      FormatWriter::getPredictor() const
+      {
+        return this->predictor;
+      }
+
       void
       FormatWriter::setInterleaved(bool interleaved)
       {
@@ -478,25 +708,35 @@ namespace ome
                              dimension_size_type c,
                              dimension_size_type t) const
       {
-        assertId(currentId, true);
-        return ome::files::getIndex(getDimensionOrder(),
-                                         getSizeZ(),
-                                         getEffectiveSizeC(),
-                                         getSizeT(),
-                                         getImageCount(),
-                                         z, c, t);
+        return getDimensionIndexMapper().getIndex(z, c, t);
       }
 
       std::array<dimension_size_type, 3>
       FormatWriter::getZCTCoords(dimension_size_type index) const
+      {
+        return getDimensionIndexMapper().getZCTCoords(index);
+      }
+
+      const DimensionIndexMapper&
+      FormatWriter::getDimensionIndexMapper() const
       {
         assertId(currentId, true);
-        return ome::files::getZCTCoords(getDimensionOrder(),
-                                             getSizeZ(),
-                                             getEffectiveSizeC(),
-                                             getSizeT(),
-                                             getImageCount(),
-                                             index);
+
+        const dimension_size_type index = getSeries();
+        if (indexMappers.size() <= index)
+          indexMappers.resize(index + 1U);
+
+        DimensionIndexMapper& mapper(indexMappers[index]);
+        const std::string& order(getDimensionOrder());
+        const dimension_size_type sizeZ = getSizeZ();
+        const dimension_size_type sizeC = getEffectiveSizeC();
+        const dimension_size_type sizeT = getSizeT();
+        const dimension_size_type num = getImageCount();
+
+        if (!mapper.matches(order, sizeZ, sizeC, sizeT, 1U, 1U, 1U, num))
+          mapper = DimensionIndexMapper(order, sizeZ, sizeC, sizeT, num);
+
+        return mapper;
       }
 
       const std::string&
@@ -598,6 +838,185 @@ namespace ome
         return *tile_size_y;
       }
 
+      void
+      FormatWriter::setAccessProfile(const boost::optional<AccessProfile>& profile)
+      {
+        assertId(currentId, false);
+        accessProfile = profile;
+      }
+
+      const boost::optional<AccessProfile>&
+      FormatWriter::getAccessProfile() const
+      {
+        return accessProfile;
+      }
+
+      void
+      FormatWriter::setEncodeThreads(dimension_size_type threads)
+      {
+        assertId(currentId, false);
+        encodeThreads = threads ? threads : 1U;
+      }
+
+      dimension_size_type
+      FormatWriter::getEncodeThreads() const
+      {
+        return encodeThreads;
+      }
+
+      void
+      FormatWriter::setExecutor(const std::shared_ptr<Executor>& executor)
+      {
+        assertId(currentId, false);
+        this->executor = executor;
+      }
+
+      const std::shared_ptr<Executor>&
+      FormatWriter::getExecutor() const
+      {
+        return executor;
+      }
+
+      void
+      FormatWriter::setSparseTiles(bool sparse)
+      {
+        assertId(currentId, false);
+        sparseTiles = sparse;
+      }
+
+      bool
+      FormatWriter::getSparseTiles() const
+      {
+        return sparseTiles;
+      }
+
+      void
+      FormatWriter::setPackSamples(bool pack)
+      {
+        assertId(currentId, false);
+        packSamples = pack;
+      }
+
+      bool
+      FormatWriter::getPackSamples() const
+      {
+        return packSamples;
+      }
+
+      void
+      FormatWriter::setRecordTileStatistics(bool record)
+      {
+        assertId(currentId, false);
+        recordTileStatistics = record;
+      }
+
+      bool
+      FormatWriter::getRecordTileStatistics() const
+      {
+        return recordTileStatistics;
+      }
+
+      void
+      FormatWriter::setRecordTileChecksums(bool record)
+      {
+        assertId(currentId, false);
+        recordTileChecksums = record;
+      }
+
+      bool
+      FormatWriter::getRecordTileChecksums() const
+      {
+        return recordTileChecksums;
+      }
+
+      void
+      FormatWriter::setStatistics(const std::shared_ptr<IOStatistics>& statistics)
+      {
+        assertId(currentId, false);
+        this->statistics = statistics ? statistics : std::make_shared<IOStatistics>();
+      }
+
+      const std::shared_ptr<IOStatistics>&
+      FormatWriter::getStatistics() const
+      {
+        return statistics;
+      }
+
+      void
+      FormatWriter::setPixelStatisticsEnabled(bool enabled)
+      {
+        pixelStatisticsEnabled = enabled;
+      }
+
+      bool
+      FormatWriter::getPixelStatisticsEnabled() const
+      {
+        return pixelStatisticsEnabled;
+      }
+
+      std::shared_ptr<const PixelStatistics>
+      FormatWriter::getPixelStatistics(dimension_size_type channel) const
+      {
+        std::lock_guard<std::mutex> lock(pixelStatisticsMutex);
+        auto found = pixelStatistics.find(std::make_pair(getSeries(), channel));
+        if (found != pixelStatistics.end())
+          return found->second;
+        return std::shared_ptr<const PixelStatistics>();
+      }
+
+      std::shared_ptr<PixelStatistics>
+      FormatWriter::planePixelStatistics(dimension_size_type plane)
+      {
+        if (!pixelStatisticsEnabled)
+          return std::shared_ptr<PixelStatistics>();
+
+        const dimension_size_type channel = getZCTCoords(plane)[1];
+        std::lock_guard<std::mutex> lock(pixelStatisticsMutex);
+        std::shared_ptr<PixelStatistics>& stats(pixelStatistics[std::make_pair(getSeries(), channel)]);
+        if (!stats)
+          stats = std::make_shared<PixelStatistics>();
+        return stats;
+      }
+
+      void
+      FormatWriter::setWriteCacheLimit(dimension_size_type limit)
+      {
+        assertId(currentId, false);
+        writeCacheLimit = limit;
+      }
+
+      dimension_size_type
+      FormatWriter::getWriteCacheLimit() const
+      {
+        return writeCacheLimit;
+      }
+
+      void
+      FormatWriter::setWriteCacheDirectory(const boost::filesystem::path& dir)
+      {
+        assertId(currentId, false);
+        writeCacheDirectory = dir;
+      }
+
+      const boost::filesystem::path&
+      FormatWriter::getWriteCacheDirectory() const
+      {
+        return writeCacheDirectory;
+      }
+
+      void
+      FormatWriter::setMemoryBudget(const std::shared_ptr<MemoryBudget>& budget)
+      {
+        assertId(currentId, false);
+        memoryBudget = budget;
+      }
+
+      const std::shared_ptr<MemoryBudget>&
+      FormatWriter::getMemoryBudget() const
+      {
+        return memoryBudget;
+      }
+
     }
   }
 }
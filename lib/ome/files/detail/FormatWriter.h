@@ -38,10 +38,16 @@
 #ifndef OME_FILES_DETAIL_FORMATWRITER_H
 #define OME_FILES_DETAIL_FORMATWRITER_H
 
+#include <ome/files/Executor.h>
 #include <ome/files/FormatWriter.h>
+#include <ome/files/FormatTools.h>
 #include <ome/files/FormatHandler.h>
 
 #include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
 
 namespace ome
 {
@@ -127,6 +133,12 @@ namespace ome
         /// The compression type to use.
         boost::optional<std::string> compression;
 
+        /// The compression level to use.
+        boost::optional<int> compressionLevel;
+
+        /// Predictor enabled.
+        boost::optional<bool> predictor;
+
         /// Subchannel interleaving enabled.
         boost::optional<bool> interleaved;
 
@@ -142,15 +154,84 @@ namespace ome
         /// Tile size Y.
         boost::optional<dimension_size_type> tile_size_y;
 
+        /// Expected access profile.
+        boost::optional<AccessProfile> accessProfile;
+
+        /// Maximum number of threads to use for encoding.
+        dimension_size_type encodeThreads;
+
+        /// Executor for parallel tasks (null for the default).
+        std::shared_ptr<Executor> executor;
+
+        /// Elide empty tiles.
+        bool sparseTiles;
+
+        /// Pack samples.
+        bool packSamples;
+
+        /// Record tile statistics.
+        bool recordTileStatistics;
+
+        /// Record tile checksums.
+        bool recordTileChecksums;
+
+        /// I/O statistics.
+        std::shared_ptr<IOStatistics> statistics;
+
+        /// Accumulate pixel statistics.
+        bool pixelStatisticsEnabled;
+
+        /// Lock for pixel statistics.
+        mutable std::mutex pixelStatisticsMutex;
+
+        /// Pixel statistics, by series and channel.
+        std::map<std::pair<dimension_size_type, dimension_size_type>,
+                 std::shared_ptr<PixelStatistics>> pixelStatistics;
+
+        /// Memory limit for pixel data pending write (bytes).
+        dimension_size_type writeCacheLimit;
+
+        /// Directory for scratch files.
+        boost::filesystem::path writeCacheDirectory;
+
+        /// Memory budget.
+        std::shared_ptr<MemoryBudget> memoryBudget;
+
         /**
          * Current metadata store. Should never be accessed directly as the
          * semantics of getMetadataRetrieve() prevent "null" access.
          */
         std::shared_ptr<::ome::xml::meta::MetadataRetrieve> metadataRetrieve;
 
+        /// Plane index mappers, by series.
+        mutable std::vector<DimensionIndexMapper> indexMappers;
+
         /// Constructor.
         FormatWriter(const WriterProperties&);
 
+        /// A plane of a block of planes, and its plane index.
+        typedef std::pair<dimension_size_type, std::shared_ptr<VariantPixelBuffer>> block_plane;
+
+        /**
+         * Split a block of planes into individual planes.
+         *
+         * The pixel data of each plane references the storage of
+         * @p buf without copying, so is only valid for the lifetime
+         * of @p buf.  Planes with a single subchannel use the
+         * storage order for the interleaving set with
+         * setInterleaved(), since the order is not significant for
+         * their storage.
+         *
+         * @param plane the index of the first plane of the block.
+         * @param buf the block of planes.
+         * @returns the planes of the block, in ascending plane order.
+         * @throws FormatException if the block is invalid.
+         * @see files::FormatWriter::savePlanes().
+         */
+        std::vector<block_plane>
+        getBlockPlanes(dimension_size_type plane,
+                       VariantPixelBuffer& buf) const;
+
         /// @cond SKIP
         FormatWriter (const FormatWriter&) = delete;
 
@@ -192,6 +273,22 @@ namespace ome
         saveBytes(dimension_size_type plane,
                   VariantPixelBuffer& buf);
 
+        // Documented in superclass.
+        void
+        savePlanes(dimension_size_type plane,
+                   VariantPixelBuffer& buf);
+
+        // Documented in superclass.
+        void
+        saveSeparatedBytes(dimension_size_type plane,
+                           VariantPixelBuffer& buf);
+
+        // Documented in superclass.
+        bool
+        copyBytes(dimension_size_type plane,
+                  const ::ome::files::FormatReader& reader,
+                  dimension_size_type sourcePlane);
+
         // Documented in superclass.
         void
         setSeries(dimension_size_type series) const;
@@ -367,6 +464,18 @@ namespace ome
         std::array<dimension_size_type, 3>
         getZCTCoords(dimension_size_type index) const;
 
+        /**
+         * Get the plane index mapper for the current series.
+         *
+         * The mapper is cached for each series, and rebuilt only if
+         * the dimension order or sizes change.
+         *
+         * @returns the mapper.
+         * @throws std::logic_error if the dimensions are invalid.
+         */
+        const DimensionIndexMapper&
+        getDimensionIndexMapper() const;
+
         // Documented in superclass.
         void
         setFramesPerSecond(frame_rate_type rate);
@@ -407,6 +516,22 @@ namespace ome
         const boost::optional<std::string>&
         getCompression() const;
 
+        // Documented in superclass.
+        void
+        setCompressionLevel(int level);
+
+        // Documented in superclass.
+        const boost::optional<int>&
+        getCompressionLevel() const;
+
+        // Documented in superclass.
+        void
+        setPredictor(bool predictor);
+
+        // Documented in superclass.
+        const boost::optional<bool>&
+        getPredictor() const;
+
         // Documented in superclass.
         void
         setInterleaved(bool interleaved);
@@ -466,6 +591,119 @@ namespace ome
         // Documented in superclass.
         dimension_size_type
         getTileSizeY() const;
+
+        // Documented in superclass.
+        void
+        setAccessProfile(const boost::optional<AccessProfile>& profile);
+
+        // Documented in superclass.
+        const boost::optional<AccessProfile>&
+        getAccessProfile() const;
+
+        // Documented in superclass.
+        void
+        setEncodeThreads(dimension_size_type threads);
+
+        // Documented in superclass.
+        dimension_size_type
+        getEncodeThreads() const;
+
+        // Documented in superclass.
+        void
+        setExecutor(const std::shared_ptr<Executor>& executor);
+
+        // Documented in superclass.
+        const std::shared_ptr<Executor>&
+        getExecutor() const;
+
+        // Documented in superclass.
+        void
+        setSparseTiles(bool sparse);
+
+        // Documented in superclass.
+        bool
+        getSparseTiles() const;
+
+        // Documented in superclass.
+        void
+        setPackSamples(bool pack);
+
+        // Documented in superclass.
+        bool
+        getPackSamples() const;
+
+        // Documented in superclass.
+        void
+        setRecordTileStatistics(bool record);
+
+        // Documented in superclass.
+        bool
+        getRecordTileStatistics() const;
+
+        // Documented in superclass.
+        void
+        setRecordTileChecksums(bool record);
+
+        // Documented in superclass.
+        bool
+        getRecordTileChecksums() const;
+
+        // Documented in superclass.
+        void
+        setStatistics(const std::shared_ptr<IOStatistics>& statistics);
+
+        // Documented in superclass.
+        const std::shared_ptr<IOStatistics>&
+        getStatistics() const;
+
+        // Documented in superclass.
+        void
+        setPixelStatisticsEnabled(bool enabled);
+
+        // Documented in superclass.
+        bool
+        getPixelStatisticsEnabled() const;
+
+        // Documented in superclass.
+        std::shared_ptr<const PixelStatistics>
+        getPixelStatistics(dimension_size_type channel) const;
+
+      protected:
+        /**
+         * Get the pixel statistics to accumulate for a plane.
+         *
+         * @param plane the plane index within the current series.
+         * @returns the statistics of the channel containing the
+         * plane, or null if pixel statistics are disabled.
+         */
+        std::shared_ptr<PixelStatistics>
+        planePixelStatistics(dimension_size_type plane);
+
+      public:
+
+        // Documented in superclass.
+        void
+        setWriteCacheLimit(dimension_size_type limit);
+
+        // Documented in superclass.
+        dimension_size_type
+        getWriteCacheLimit() const;
+
+        // Documented in superclass.
+        void
+        setWriteCacheDirectory(const boost::filesystem::path& dir);
+
+        // Documented in superclass.
+        const boost::filesystem::path&
+        getWriteCacheDirectory() const;
+
+        // Documented in superclass.
+        void
+        setMemoryBudget(const std::shared_ptr<MemoryBudget>& budget);
+
+        // Documented in superclass.
+        const std::shared_ptr<MemoryBudget>&
+        getMemoryBudget() const;
       };
 
     }
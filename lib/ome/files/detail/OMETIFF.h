@@ -38,6 +38,12 @@
 #ifndef OME_FILES_DETAIL_OMETIFF_H
 #define OME_FILES_DETAIL_OMETIFF_H
 
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include <vector>
+
 #include <boost/filesystem/path.hpp>
 
 #include <ome/files/Types.h>
@@ -49,6 +55,100 @@ namespace ome
     namespace detail
     {
 
+      /**
+       * Table of the files within an OME-TIFF file set.
+       *
+       * Planes refer to files by index into this table, rather than
+       * each holding a copy of the path.  Each file is added once.
+       */
+      class OMETIFFFileTable
+      {
+      public:
+        /// File index type.
+        typedef uint32_t index_type;
+
+        /// Constructor.
+        OMETIFFFileTable():
+          files(),
+          indexes()
+        {
+        }
+
+        /**
+         * Add a file to the table.
+         *
+         * @param file the file to add.
+         * @returns the index of the file, which will be the existing
+         * index if the file was previously added.
+         * @throws std::length_error if the table is full.
+         */
+        index_type
+        add(const boost::filesystem::path& file)
+        {
+          std::map<boost::filesystem::path, index_type>::const_iterator i = indexes.find(file);
+          if (i != indexes.end())
+            return i->second;
+
+          if (files.size() >= std::numeric_limits<index_type>::max())
+            throw std::length_error("Too many files in OME-TIFF file set");
+
+          const index_type index = static_cast<index_type>(files.size());
+          files.push_back(file);
+          indexes.insert(std::make_pair(file, index));
+          return index;
+        }
+
+        /**
+         * Get a file by index.
+         *
+         * @param index the file index.
+         * @returns the file, or an empty path if the index does not
+         * refer to a file.
+         */
+        const boost::filesystem::path&
+        get(index_type index) const
+        {
+          static const boost::filesystem::path none;
+          return index < files.size() ? files[index] : none;
+        }
+
+        /**
+         * Get all files.
+         *
+         * @returns the files, in the order added.
+         */
+        const std::vector<boost::filesystem::path>&
+        getFiles() const
+        {
+          return files;
+        }
+
+        /**
+         * Get the number of files.
+         *
+         * @returns the file count.
+         */
+        std::vector<boost::filesystem::path>::size_type
+        size() const
+        {
+          return files.size();
+        }
+
+        /// Remove all files.
+        void
+        clear()
+        {
+          files.clear();
+          indexes.clear();
+        }
+
+      private:
+        /// Files, by index.
+        std::vector<boost::filesystem::path> files;
+        /// Indexes, by file.
+        std::map<boost::filesystem::path, index_type> indexes;
+      };
+
       /**
        * Metadata for a single plane within an OME-TIFF file set.
        */
@@ -63,43 +163,59 @@ namespace ome
             ABSENT   ///< File is missing.
           };
 
-        /// File containing this plane.
-        boost::filesystem::path id;
-        /// IFD index.
-        dimension_size_type ifd;
+        /// Index of no file.
+        static constexpr OMETIFFFileTable::index_type no_file =
+          std::numeric_limits<OMETIFFFileTable::index_type>::max();
+
+        /// File containing this plane (index into an OMETIFFFileTable).
+        OMETIFFFileTable::index_type file;
         /// Certainty flag, for dealing with unspecified NumPlanes.
         bool certain;
         /// File status.
         Status status;
+        /// IFD index.
+        dimension_size_type ifd;
 
         /**
          * Default constructor.
          *
-         * File and IFD are default constructed; order is uncertain;
-         * status is unknown.
+         * File is unset and IFD is default constructed; order is
+         * uncertain; status is unknown.
          */
         OMETIFFPlane():
-          id(),
-          ifd(),
+          file(no_file),
           certain(false),
-          status(UNKNOWN)
+          status(UNKNOWN),
+          ifd()
         {
         }
 
         /**
-         * Construct with filename.
+         * Construct with file.
          *
-         * @param id the TIFF file containing this plane.
+         * @param file the index of the TIFF file containing this plane.
          *
          * IFD is default constructed; order is uncertain; status is
          * unknown.
          */
-        OMETIFFPlane(const boost::filesystem::path& id):
-          id(id),
-          ifd(),
+        explicit
+        OMETIFFPlane(OMETIFFFileTable::index_type file):
+          file(file),
           certain(false),
-          status(UNKNOWN)
+          status(UNKNOWN),
+          ifd()
+        {
+        }
+
+        /**
+         * Check if a file is set.
+         *
+         * @returns @c true if set, @c false otherwise.
+         */
+        bool
+        hasFile() const
         {
+          return file != no_file;
         }
       };
 
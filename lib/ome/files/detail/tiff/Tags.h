@@ -40,6 +40,8 @@
 
 #define TIFFTAG_IMAGEJ_META_DATA_BYTE_COUNTS 50838 /* ImageJMetaDataByteCounts */
 #define TIFFTAG_IMAGEJ_META_DATA             50839 /* ImageJMetaData */
+#define TIFFTAG_OME_TILE_STATISTICS          65420 /* OMETileStatistics */
+#define TIFFTAG_OME_TILE_CHECKSUMS           65421 /* OMETileChecksums */
 
 #endif // OME_FILES_DETAIL_TIFF_TAGS_H
 
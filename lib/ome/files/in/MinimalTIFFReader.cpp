@@ -43,6 +43,7 @@
 #include <ome/files/FormatException.h>
 #include <ome/files/FormatTools.h>
 #include <ome/files/MetadataTools.h>
+#include <ome/files/PixelStatistics.h>
 #include <ome/files/in/MinimalTIFFReader.h>
 #include <ome/files/tiff/IFD.h>
 #include <ome/files/tiff/TIFF.h>
@@ -73,6 +74,7 @@ namespace ome
           // "bigTIFF" (2nd generation TIFF, TIFF with 8-byte offsets
           // and big TIFF respectively).
           p.suffixes = {"tif", "tiff", "tf2", "tf8", "btf"};
+          p.metadata_levels.insert(MetadataOptions::METADATA_PIXELS);
           p.metadata_levels.insert(MetadataOptions::METADATA_MINIMUM);
           p.metadata_levels.insert(MetadataOptions::METADATA_NO_OVERLAYS);
           p.metadata_levels.insert(MetadataOptions::METADATA_ALL);
@@ -89,7 +91,10 @@ namespace ome
       MinimalTIFFReader::MinimalTIFFReader():
         ::ome::files::detail::FormatReader(props),
         tiff(),
-        seriesIFDRange()
+        seriesIFDRange(),
+        sourceFactory(),
+        tileCache(),
+        live(false)
       {
         domains.push_back(getDomain(GRAPHICS_DOMAIN));
       }
@@ -97,11 +102,53 @@ namespace ome
       MinimalTIFFReader::MinimalTIFFReader(const ReaderProperties& readerProperties):
         ::ome::files::detail::FormatReader(readerProperties),
         tiff(),
-        seriesIFDRange()
+        seriesIFDRange(),
+        sourceFactory(),
+        tileCache(),
+        live(false)
       {
         domains.push_back(getDomain(GRAPHICS_DOMAIN));
       }
 
+      void
+      MinimalTIFFReader::setIOSourceFactory(const tiff::IOSourceFactory& factory)
+      {
+        assertId(currentId, false);
+        sourceFactory = factory;
+      }
+
+      const tiff::IOSourceFactory&
+      MinimalTIFFReader::getIOSourceFactory() const
+      {
+        return sourceFactory;
+      }
+
+      void
+      MinimalTIFFReader::setTileCache(const std::shared_ptr<DecodedTileCache>& cache)
+      {
+        assertId(currentId, false);
+        tileCache = cache;
+      }
+
+      const std::shared_ptr<DecodedTileCache>&
+      MinimalTIFFReader::getTileCache() const
+      {
+        return tileCache;
+      }
+
+      void
+      MinimalTIFFReader::setLive(bool live)
+      {
+        assertId(currentId, false);
+        this->live = live;
+      }
+
+      bool
+      MinimalTIFFReader::getLive() const
+      {
+        return live;
+      }
+
       MinimalTIFFReader::~MinimalTIFFReader()
       {
         try
@@ -116,13 +163,32 @@ namespace ome
       bool
       MinimalTIFFReader::isFilenameThisTypeImpl(const boost::filesystem::path& name) const
       {
-        return static_cast<bool>(TIFF::open(name, "r"));
+        // Only the header is checked; the file is not opened with
+        // libtiff until setId().
+        return tiff::isTIFFHeader(name, sourceFactory);
+      }
+
+      bool
+      MinimalTIFFReader::isStreamThisTypeImpl(std::istream& stream) const
+      {
+        uint8_t header[tiff::header_size];
+        stream.read(reinterpret_cast<char *>(header), sizeof(header));
+        return tiff::isTIFFHeader(header, static_cast<std::size_t>(stream.gcount()));
       }
 
       const std::shared_ptr<const tiff::IFD>
       MinimalTIFFReader::ifdAtIndex(dimension_size_type plane) const
       {
-        dimension_size_type ifdidx = tiff::ifdIndex(seriesIFDRange, getSeries(), plane);
+        return ifdAtCoreIndex(getCoreIndex(), plane);
+      }
+
+      const std::shared_ptr<const tiff::IFD>
+      MinimalTIFFReader::ifdAtCoreIndex(dimension_size_type coreIndex,
+                                        dimension_size_type plane) const
+      {
+        // There are no sub-resolutions, so the core index is the
+        // series.
+        dimension_size_type ifdidx = tiff::ifdIndex(seriesIFDRange, coreIndex, plane);
         const std::shared_ptr<const IFD>& ifd(tiff->getDirectoryByIndex(static_cast<tiff::directory_index_type>(ifdidx)));
 
         return ifd;
@@ -137,12 +203,51 @@ namespace ome
         ::ome::files::detail::FormatReader::close(fileOnly);
       }
 
+      std::shared_ptr<::ome::files::detail::FormatReader>
+      MinimalTIFFReader::newClone() const
+      {
+        return std::make_shared<MinimalTIFFReader>();
+      }
+
+      void
+      MinimalTIFFReader::copyState(const ::ome::files::detail::FormatReader& source)
+      {
+        ::ome::files::detail::FormatReader::copyState(source);
+
+        const MinimalTIFFReader& reader(dynamic_cast<const MinimalTIFFReader&>(source));
+        seriesIFDRange = reader.seriesIFDRange;
+        sourceFactory = reader.sourceFactory;
+        tileCache = reader.tileCache;
+        live = reader.live;
+
+        tiff = TIFF::open(*currentId, live ? "rm" : "r", sourceFactory);
+
+        if (!tiff)
+          {
+            boost::format fmt("Failed to open ‘%1%’");
+            fmt % currentId->string();
+            throw FormatException(fmt.str());
+          }
+        tiff->setDecodeThreads(getDecodeThreads());
+        tiff->setExecutor(getExecutor());
+        tiff->setVerifyTileChecksums(getVerifyTileChecksums());
+        tiff->setStatistics(getStatistics());
+        tiff->setTileCache(tileCache);
+
+        // All directories were found by readIFDs(); reuse their
+        // offsets rather than reading every directory again.
+        reader.tiff->directoryCount();
+        tiff->setDirectoryOffsets(reader.tiff->getDirectoryOffsets(), true);
+      }
+
       void
       MinimalTIFFReader::initFile(const boost::filesystem::path& id)
       {
         ::ome::files::detail::FormatReader::initFile(id);
 
-        tiff = TIFF::open(id, "r");
+        // Live files are not mapped since the mapping would not
+        // include directories appended after opening.
+        tiff = TIFF::open(id, live ? "rm" : "r", sourceFactory);
 
         if (!tiff)
           {
@@ -150,6 +255,11 @@ namespace ome
             fmt % id.string();
             throw FormatException(fmt.str());
           }
+        tiff->setDecodeThreads(getDecodeThreads());
+        tiff->setExecutor(getExecutor());
+        tiff->setVerifyTileChecksums(getVerifyTileChecksums());
+        tiff->setStatistics(getStatistics());
+        tiff->setTileCache(tileCache);
 
         readIFDs();
 
@@ -180,30 +290,125 @@ namespace ome
       {
         core.clear();
 
-        std::shared_ptr<const tiff::IFD> prev_ifd;
         std::shared_ptr<CoreMetadata> prev_core;
 
+        // The minimal TIFF reader makes the assumption that if the
+        // pixel data is of the same format as the pixel data in the
+        // preceding IFD, then this is a following timepoint in a
+        // series.  Otherwise, a new series is started.
+        auto extendSeries = [&]()
+          {
+            ++prev_core->sizeT;
+            prev_core->imageCount = prev_core->sizeT;
+            ++(seriesIFDRange.back().end);
+          };
+
+        auto startSeries = [&](dimension_size_type current_ifd,
+                               const tiff::IFD&    ifd)
+          {
+            prev_core = makeCoreMetadata(ifd);
+            core.push_back(prev_core);
+
+            tiff::IFDRange range;
+            range.filename = *currentId;
+            range.begin = current_ifd;
+            range.end = current_ifd + 1;
+
+            seriesIFDRange.push_back(range);
+          };
+
+        std::shared_ptr<const tiff::IFD> prev_ifd;
+
+        // Summarize the IFDs without reading them with libtiff where
+        // possible.  IFDs are then only read to make the core
+        // metadata for each series, and to compare IFDs which could
+        // not be summarized.
+        const std::vector<tiff::DirectorySummary> summaries(tiff->scanDirectories(getDecodeThreads()));
+        if (!summaries.empty())
+          {
+            for (dimension_size_type current_ifd = 0U;
+                 current_ifd < summaries.size();
+                 ++current_ifd)
+              {
+                const tiff::DirectorySummary& summary(summaries[current_ifd]);
+                std::shared_ptr<const tiff::IFD> ifd;
+                bool same = false;
+
+                if (prev_core)
+                  {
+                    const tiff::DirectorySummary& prev(summaries[current_ifd - 1U]);
+                    if (prev.valid && summary.valid)
+                      {
+                        same = prev.sameFormat(summary);
+                      }
+                    else
+                      {
+                        if (!prev_ifd)
+                          prev_ifd = tiff->getDirectoryByOffset(prev.offset);
+                        ifd = tiff->getDirectoryByOffset(summary.offset);
+                        same = compare_ifd(*prev_ifd, *ifd);
+                      }
+                  }
+
+                if (same)
+                  {
+                    extendSeries();
+                  }
+                else
+                  {
+                    if (!ifd)
+                      ifd = tiff->getDirectoryByOffset(summary.offset);
+                    startSeries(current_ifd, *ifd);
+                  }
+                prev_ifd = ifd;
+              }
+            return;
+          }
+
         dimension_size_type current_ifd = 0U;
 
         for (TIFF::const_iterator i = tiff->begin();
              i != tiff->end();
              ++i, ++current_ifd)
           {
-            // The minimal TIFF reader makes the assumption that if
-            // the pixel data is of the same format as the pixel data
-            // in the preceding IFD, then this is a following
-            // timepoint in a series.  Otherwise, a new series is
-            // started.
             if (prev_core && prev_ifd && compare_ifd(*prev_ifd, **i))
+              extendSeries();
+            else
+              startSeries(current_ifd, **i);
+            prev_ifd = *i;
+          }
+      }
+
+      dimension_size_type
+      MinimalTIFFReader::refresh()
+      {
+        assertId(currentId, true);
+
+        if (!live)
+          throw std::logic_error("Refresh requires live reading to be enabled");
+
+        dimension_size_type current_ifd = seriesIFDRange.empty() ? 0U : seriesIFDRange.back().end;
+        const dimension_size_type first_new = current_ifd;
+        const dimension_size_type count = tiff->refreshDirectories();
+
+        std::shared_ptr<const tiff::IFD> prev_ifd;
+        if (current_ifd > 0U)
+          prev_ifd = tiff->getDirectoryByIndex(static_cast<tiff::directory_index_type>(current_ifd - 1U));
+
+        // Map the new IFDs using the same rules as readIFDs().
+        for (; current_ifd < count; ++current_ifd)
+          {
+            std::shared_ptr<const tiff::IFD> ifd(tiff->getDirectoryByIndex(static_cast<tiff::directory_index_type>(current_ifd)));
+            if (prev_ifd && !core.empty() && compare_ifd(*prev_ifd, *ifd))
               {
+                std::shared_ptr<CoreMetadata>& prev_core(core.back());
                 ++prev_core->sizeT;
                 prev_core->imageCount = prev_core->sizeT;
                 ++(seriesIFDRange.back().end);
               }
             else
               {
-                prev_core = makeCoreMetadata(**i);
-                core.push_back(prev_core);
+                core.push_back(makeCoreMetadata(*ifd));
 
                 tiff::IFDRange range;
                 range.filename = *currentId;
@@ -212,8 +417,19 @@ namespace ome
 
                 seriesIFDRange.push_back(range);
               }
-            prev_ifd = *i;
+            prev_ifd = ifd;
+          }
+
+        if (count > first_new)
+          {
+            updateSeriesIndex();
+            updateUsedFiles();
+            // A pending store is filled in full on first access.
+            if (!metadataStorePending)
+              fillMetadataStore();
           }
+
+        return count - first_new;
       }
 
       void
@@ -236,6 +452,21 @@ namespace ome
           }
       }
 
+      std::shared_ptr<const tiff::IFD>
+      MinimalTIFFReader::getPlaneIFD(dimension_size_type plane) const
+      {
+        assertId(currentId, true);
+
+        if (plane >= getImageCount())
+          {
+            boost::format fmt("Invalid plane: %1%");
+            fmt % plane;
+            throw std::logic_error(fmt.str());
+          }
+
+        return ifdAtIndex(plane);
+      }
+
       void
       MinimalTIFFReader::openBytesImpl(dimension_size_type plane,
                                        VariantPixelBuffer& buf,
@@ -248,7 +479,111 @@ namespace ome
 
         const std::shared_ptr<const IFD>& ifd(ifdAtIndex(plane));
 
-        ifd->readImage(buf, x, y, w, h);
+        // Accumulate pixel statistics while the tiles are unpacked.
+        std::shared_ptr<PixelStatistics> stats(newPixelStatistics(plane, x, y, w, h));
+        if (stats)
+          {
+            ifd->readImage(buf, x, y, w, h, *stats);
+            cachePixelStatistics(plane, stats);
+          }
+        else
+          ifd->readImage(buf, x, y, w, h);
+      }
+
+      std::function<void ()>
+      MinimalTIFFReader::openBytesTask(dimension_size_type plane,
+                                       VariantPixelBuffer& buf,
+                                       dimension_size_type x,
+                                       dimension_size_type y,
+                                       dimension_size_type w,
+                                       dimension_size_type h) const
+      {
+        std::shared_ptr<const IFD> ifd(ifdAtIndex(plane));
+        VariantPixelBuffer *dest = &buf;
+
+        return [ifd, dest, x, y, w, h]()
+          {
+            ifd->readImage(*dest, x, y, w, h);
+          };
+      }
+
+      void
+      MinimalTIFFReader::openBytesBatchImpl(const std::vector<ReadRequest>& requests) const
+      {
+        assertId(currentId, true);
+
+        std::vector<IFD::ReadRequest> ifdrequests;
+        ifdrequests.reserve(requests.size());
+        for (const auto& request : requests)
+          {
+            IFD::ReadRequest ifdrequest;
+            ifdrequest.ifd = ifdAtIndex(request.plane);
+            ifdrequest.region = request.region;
+            ifdrequest.buf = request.buf;
+            ifdrequests.push_back(ifdrequest);
+          }
+
+        IFD::readImages(ifdrequests);
+      }
+
+      void
+      MinimalTIFFReader::openBytesConcurrentImpl(dimension_size_type coreIndex,
+                                                 dimension_size_type plane,
+                                                 VariantPixelBuffer& buf,
+                                                 dimension_size_type x,
+                                                 dimension_size_type y,
+                                                 dimension_size_type w,
+                                                 dimension_size_type h) const
+      {
+        ifdAtCoreIndex(coreIndex, plane)->readImage(buf, x, y, w, h);
+      }
+
+      void
+      MinimalTIFFReader::prefetchImpl(dimension_size_type plane,
+                                      dimension_size_type x,
+                                      dimension_size_type y,
+                                      dimension_size_type w,
+                                      dimension_size_type h) const
+      {
+        std::shared_ptr<const IFD> ifd(ifdAtIndex(plane));
+
+        // Decoded tiles are only retained with a tile cache.
+        if (!ifd->getTIFF()->getTileCache())
+          return;
+
+        startPrefetch([ifd, x, y, w, h]()
+                      {
+                        VariantPixelBuffer buf;
+                        ifd->readImage(buf, x, y, w, h);
+                      });
+      }
+
+      void
+      MinimalTIFFReader::adviseAccessImpl(AccessHint          hint,
+                                          dimension_size_type plane,
+                                          dimension_size_type x,
+                                          dimension_size_type y,
+                                          dimension_size_type w,
+                                          dimension_size_type h) const
+      {
+        ifdAtIndex(plane)->adviseAccess(hint, x, y, w, h);
+      }
+
+      bool
+      MinimalTIFFReader::openReducedBytesImpl(dimension_size_type plane,
+                                              VariantPixelBuffer& buf,
+                                              dimension_size_type x,
+                                              dimension_size_type y,
+                                              dimension_size_type w,
+                                              dimension_size_type h,
+                                              dimension_size_type scale) const
+      {
+        const std::shared_ptr<const IFD>& ifd(ifdAtIndex(plane));
+        if (!ifd->supportsReducedRead(scale))
+          return false;
+
+        ifd->readImageReduced(buf, x, y, w, h, scale);
+        return true;
       }
 
       std::shared_ptr<ome::files::tiff::TIFF>
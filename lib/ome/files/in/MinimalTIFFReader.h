@@ -38,8 +38,10 @@
 #ifndef OME_FILES_IN_MINIMALTIFFREADER_H
 #define OME_FILES_IN_MINIMALTIFFREADER_H
 
+#include <ome/files/DecodedTileCache.h>
 #include <ome/files/detail/FormatReader.h>
 
+#include <ome/files/tiff/IOSource.h>
 #include <ome/files/tiff/Util.h>
 
 #include <vector>
@@ -75,6 +77,15 @@ namespace ome
         /// Mapping between series index and start and end IFD as a half-open range.
         tiff::SeriesIFDRange seriesIFDRange;
 
+        /// I/O source factory.
+        tiff::IOSourceFactory sourceFactory;
+
+        /// Decoded tile cache.
+        std::shared_ptr<DecodedTileCache> tileCache;
+
+        /// Follow a file which is still being written.
+        bool live;
+
       public:
         /// Constructor.
         MinimalTIFFReader();
@@ -90,7 +101,102 @@ namespace ome
         virtual
         ~MinimalTIFFReader();
 
+        /**
+         * Set the I/O source factory.
+         *
+         * If set, TIFF files will be read from the sources created
+         * by the factory rather than opened directly.  This must be
+         * set before calling setId().
+         *
+         * @param factory the source factory, or an empty function to
+         * open files directly.
+         */
+        void
+        setIOSourceFactory(const tiff::IOSourceFactory& factory);
+
+        /**
+         * Get the I/O source factory.
+         *
+         * @returns the source factory.
+         */
+        const tiff::IOSourceFactory&
+        getIOSourceFactory() const;
+
+        /**
+         * Set the decoded tile cache.
+         *
+         * If set, decoded tiles will be retained in and reused from
+         * this cache.  The cache may be shared between several
+         * readers, including readers of the same file.  This must be
+         * set before calling setId().
+         *
+         * @param cache the tile cache, or null to disable caching.
+         */
+        void
+        setTileCache(const std::shared_ptr<DecodedTileCache>& cache);
+
+        /**
+         * Get the decoded tile cache.
+         *
+         * @returns the tile cache, or null if not caching.
+         */
+        const std::shared_ptr<DecodedTileCache>&
+        getTileCache() const;
+
+        /**
+         * Set live reading.
+         *
+         * If enabled, the file is expected to still be in the process
+         * of being written.  The file will not be memory mapped, so
+         * that directories appended by the writer may be found by
+         * calling refresh().  This must be set before calling
+         * setId().
+         *
+         * @param live @c true to enable live reading, @c false to
+         * disable.
+         */
+        void
+        setLive(bool live);
+
+        /**
+         * Get live reading.
+         *
+         * @returns @c true if live reading is enabled, @c false
+         * otherwise.
+         */
+        bool
+        getLive() const;
+
+        /**
+         * Find planes written since the file was opened or last
+         * refreshed.
+         *
+         * New IFDs linked into the directory chain by the writer are
+         * mapped to planes in the same way as when the file was
+         * opened: an IFD with the same format as its predecessor
+         * extends the last series with a further timepoint, otherwise
+         * a new series is started.  The metadata store is updated to
+         * reflect the new planes.
+         *
+         * The plane mapping is inferred from the IFDs alone, since
+         * any complete metadata is only written by the writer when it
+         * is closed.
+         *
+         * @returns the number of new planes.
+         * @throws std::logic_error if live reading is not enabled.
+         */
+        dimension_size_type
+        refresh();
+
       protected:
+        // Documented in superclass.
+        std::shared_ptr<::ome::files::detail::FormatReader>
+        newClone() const;
+
+        // Documented in superclass.
+        void
+        copyState(const ::ome::files::detail::FormatReader& source);
+
         // Documented in superclass.
         void
         initFile(const boost::filesystem::path& id);
@@ -106,8 +212,12 @@ namespace ome
         bool
         isFilenameThisTypeImpl(const boost::filesystem::path& name) const;
 
+        // Documented in superclass.
+        bool
+        isStreamThisTypeImpl(std::istream& stream) const;
+
         /**
-         * Get the IFD index for a plane in the current series.
+         * Get the IFD for a plane in the current series.
          *
          * @param plane the plane index within the series.
          * @returns the IFD index.
@@ -116,6 +226,21 @@ namespace ome
         const std::shared_ptr<const tiff::IFD>
         ifdAtIndex(dimension_size_type plane) const;
 
+        /**
+         * Get the IFD for a plane in the specified series.
+         *
+         * This does not use the reader state.
+         *
+         * @param coreIndex the core index of the series.
+         * @param plane the plane index within the series.
+         * @returns the IFD.
+         * @throws FormatException if out of range.
+         */
+        virtual
+        const std::shared_ptr<const tiff::IFD>
+        ifdAtCoreIndex(dimension_size_type coreIndex,
+                       dimension_size_type plane) const;
+
       public:
         // Documented in superclass.
         void
@@ -126,6 +251,10 @@ namespace ome
         getLookupTable(dimension_size_type plane,
                        VariantPixelBuffer& buf) const;
 
+        // Documented in superclass.
+        std::shared_ptr<const tiff::IFD>
+        getPlaneIFD(dimension_size_type plane) const;
+
       protected:
         // Documented in superclass.
         void
@@ -136,6 +265,56 @@ namespace ome
                       dimension_size_type w,
                       dimension_size_type h) const;
 
+        // Documented in superclass.
+        std::function<void ()>
+        openBytesTask(dimension_size_type plane,
+                      VariantPixelBuffer& buf,
+                      dimension_size_type x,
+                      dimension_size_type y,
+                      dimension_size_type w,
+                      dimension_size_type h) const;
+
+        // Documented in superclass.
+        void
+        openBytesBatchImpl(const std::vector<ReadRequest>& requests) const;
+
+        // Documented in superclass.
+        void
+        openBytesConcurrentImpl(dimension_size_type coreIndex,
+                                dimension_size_type plane,
+                                VariantPixelBuffer& buf,
+                                dimension_size_type x,
+                                dimension_size_type y,
+                                dimension_size_type w,
+                                dimension_size_type h) const;
+
+        // Documented in superclass.
+        void
+        prefetchImpl(dimension_size_type plane,
+                     dimension_size_type x,
+                     dimension_size_type y,
+                     dimension_size_type w,
+                     dimension_size_type h) const;
+
+        // Documented in superclass.
+        void
+        adviseAccessImpl(AccessHint          hint,
+                         dimension_size_type plane,
+                         dimension_size_type x,
+                         dimension_size_type y,
+                         dimension_size_type w,
+                         dimension_size_type h) const;
+
+        // Documented in superclass.
+        bool
+        openReducedBytesImpl(dimension_size_type plane,
+                             VariantPixelBuffer& buf,
+                             dimension_size_type x,
+                             dimension_size_type y,
+                             dimension_size_type w,
+                             dimension_size_type h,
+                             dimension_size_type scale) const;
+
       public:
         /**
          * Get open TIFF file.
@@ -36,28 +36,45 @@
  */
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <cstddef>
+#include <exception>
 #include <iterator>
+#include <limits>
 #include <map>
+#include <mutex>
 #include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
 
+#include <boost/filesystem/fstream.hpp>
 #include <boost/filesystem/path.hpp>
 #include <boost/filesystem/operations.hpp>
 #include <boost/range/size.hpp>
 
 #include <ome/common/filesystem.h>
 
+#include <ome/files/Executor.h>
 #include <ome/files/FormatException.h>
 #include <ome/files/FormatTools.h>
+#include <ome/files/Memo.h>
 #include <ome/files/MetadataTools.h>
+#include <ome/files/PixelStatistics.h>
+#include <ome/files/TraceObserver.h>
 #include <ome/files/detail/OMETIFF.h>
 #include <ome/files/in/OMETIFFReader.h>
 #include <ome/files/tiff/IFD.h>
 #include <ome/files/tiff/TIFF.h>
 #include <ome/files/tiff/Tags.h>
 #include <ome/files/tiff/Field.h>
+#include <ome/files/tiff/Util.h>
 
 #include <ome/xml/meta/OMEXMLMetadata.h>
 #include <ome/xml/meta/BaseMetadata.h>
+#include <ome/xml/meta/DummyMetadata.h>
 #include <ome/xml/meta/Convert.h>
 
 namespace fs = boost::filesystem;
@@ -107,6 +124,7 @@ namespace ome
                         "ome.tf2",
                         "ome.tf8",
                         "ome.btf"};
+          p.metadata_levels.insert(MetadataOptions::METADATA_PIXELS);
           p.metadata_levels.insert(MetadataOptions::METADATA_MINIMUM);
           p.metadata_levels.insert(MetadataOptions::METADATA_NO_OVERLAYS);
           p.metadata_levels.insert(MetadataOptions::METADATA_ALL);
@@ -118,6 +136,94 @@ namespace ome
 
         const std::vector<path> companion_suffixes{"companion.ome"};
 
+        /**
+         * Maximum number of files opened concurrently by setId().
+         * Opening is dominated by storage latency rather than CPU
+         * time, so this is independent of the number of decoding
+         * threads.
+         */
+        const dimension_size_type max_open_threads = 16U;
+
+        // Properties of the IFD of a plane, read during setId() to
+        // check against the metadata of its series.
+        struct PlaneIFDInfo
+        {
+          /// IFD index.
+          dimension_size_type ifd;
+          /// Image width.
+          uint32_t width;
+          /// Image height.
+          uint32_t height;
+          /// Pixel type.
+          ome::xml::model::enums::PixelType pixeltype;
+          /// Photometric interpretation.
+          tiff::PhotometricInterpretation photometric;
+          /// Planar configuration.
+          tiff::PlanarConfiguration planarconfig;
+          /// A colormap is present.
+          bool colormap;
+          /// Samples per pixel.
+          dimension_size_type samples;
+          /// Tile width.
+          dimension_size_type tileWidth;
+          /// Tile height.
+          dimension_size_type tileHeight;
+          /// Failure to find or read the IFD, if any.
+          std::exception_ptr error;
+
+          PlaneIFDInfo():
+            ifd(0U),
+            width(0U),
+            height(0U),
+            pixeltype(ome::xml::model::enums::PixelType::UINT8),
+            photometric(tiff::MIN_IS_BLACK),
+            planarconfig(tiff::CONTIG),
+            colormap(false),
+            samples(1U),
+            tileWidth(0U),
+            tileHeight(0U),
+            error()
+          {}
+
+          // Read the properties from the IFD.
+          void
+          read(const tiff::IFD& dir)
+          {
+            width = dir.getImageWidth();
+            height = dir.getImageHeight();
+            pixeltype = dir.getPixelType();
+            photometric = dir.getPhotometricInterpretation();
+            planarconfig = dir.getPlanarConfiguration();
+            samples = dir.getSamplesPerPixel();
+            const tiff::TileInfo tinfo(dir.getTileInfo());
+            tileWidth = tinfo.tileWidth();
+            tileHeight = tinfo.tileHeight();
+
+            colormap = false;
+            if (photometric == tiff::PALETTE)
+              {
+                try
+                  {
+                    std::array<std::vector<uint16_t>, 3> cmap;
+                    colormap = dir.getField(ome::files::tiff::COLORMAP).tryGet(cmap);
+                  }
+                catch (const tiff::Exception&)
+                  {
+                  }
+              }
+          }
+        };
+
+        // Check if debug records would be logged.  Opening a record
+        // evaluates the logging filters under lock, which is costly
+        // relative to the work done for each plane, so loops over
+        // planes check this once up front.
+        bool
+        debugEnabled(ome::common::Logger& logger)
+        {
+          return static_cast<bool>(logger.open_record(ome::logging::keywords::severity = ome::logging::trivial::debug));
+        }
+
         std::string
         getImageDescription(const TIFF& tiff)
         {
@@ -139,6 +245,77 @@ namespace ome
             }
         }
 
+        // Parse OME-XML text from the specified file.
+        std::shared_ptr<::ome::xml::meta::OMEXMLMetadata>
+        parseOMEXML(const std::string& omexml,
+                    const path&        file)
+        {
+          TraceScope trace(TraceObserver::XML_PARSE, &file);
+          return createOMEXMLMetadata(omexml);
+        }
+
+        // Parse the OME-XML in the ImageDescription of the first IFD.
+        // Unless the complete model is required, the TiffData subset
+        // is parsed in place from the text held by libtiff, and the
+        // text is only copied if the subset can not be used.
+        std::shared_ptr<::ome::xml::meta::OMEXMLMetadata>
+        parseImageDescription(const TIFF& tiff,
+                              const path& file,
+                              bool        complete,
+                              bool        check,
+                              bool&       parsedComplete)
+        {
+          std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> meta;
+          std::string omexml;
+          bool found = false;
+
+          try
+            {
+              std::shared_ptr<tiff::IFD> ifd (tiff.getDirectoryByIndex(0));
+              if (!ifd)
+                throw tiff::Exception("No TIFF IFDs found");
+
+              found = ifd->visitField
+                (ome::files::tiff::IMAGEDESCRIPTION,
+                 [&](const char *text, std::size_t size)
+                 {
+                   if (check)
+                     {
+                       // Basic sanity check before parsing.
+                       std::size_t last = size;
+                       while (last && std::isspace(static_cast<unsigned char>(text[last - 1])))
+                         --last;
+                       if (!last || text[0] != '<' || text[last - 1] != '>')
+                         {
+                           boost::format fmt("Badly formed or invalid XML document in ‘%1%’");
+                           fmt % file.string();
+                           throw FormatException(fmt.str());
+                         }
+                     }
+
+                   if (!complete)
+                     {
+                       TraceScope trace(TraceObserver::XML_PARSE, &file);
+                       meta = createTiffDataMetadata(text, size);
+                     }
+                   if (!meta)
+                     omexml.assign(text, size);
+                 });
+            }
+          catch (const tiff::Exception&)
+            {
+              found = false;
+            }
+
+          if (!found)
+            throw FormatException("No TIFF ImageDescription found");
+
+          parsedComplete = !meta;
+          if (!meta)
+            meta = parseOMEXML(omexml, file);
+          return meta;
+        }
+
         typedef ome::files::detail::OMETIFFPlane OMETIFFPlane;
 
         /// OME-TIFF-specific core metadata.
@@ -149,7 +326,7 @@ namespace ome
           std::vector<dimension_size_type> tileWidth;
           /// Tile width.
           std::vector<dimension_size_type> tileHeight;
-          /// Per-plane data.
+          /// Per-plane data (moved to seriesPlanes once initialised).
           std::vector<OMETIFFPlane> tiffPlanes;
 
           OMETIFFMetadata():
@@ -166,8 +343,202 @@ namespace ome
             tiffPlanes(copy.tiffPlanes)
           {}
 
+          /**
+           * Check if the core metadata and tile sizes are identical.
+           *
+           * The per-plane data is not compared.
+           *
+           * @param rhs the metadata to compare.
+           * @returns @c true if identical, @c false otherwise.
+           */
+          bool
+          sameAs(const OMETIFFMetadata& rhs) const
+          {
+            return static_cast<const CoreMetadata&>(*this) == rhs &&
+              tileWidth == rhs.tileWidth &&
+              tileHeight == rhs.tileHeight;
+          }
         };
 
+        // Memo format name and version; change the version if the
+        // memo layout changes.
+        const std::string memo_format("OMETIFFReader 2");
+
+        void
+        writeMemoSizes(MemoWriter&                             memo,
+                       const std::vector<dimension_size_type>& sizes)
+        {
+          memo.write(static_cast<uint64_t>(sizes.size()));
+          for (const auto& size : sizes)
+            memo.write(static_cast<uint64_t>(size));
+        }
+
+        std::vector<dimension_size_type>
+        readMemoSizes(MemoReader& memo)
+        {
+          std::vector<dimension_size_type> sizes(static_cast<std::vector<dimension_size_type>::size_type>(memo.readUInt()));
+          for (auto& size : sizes)
+            size = static_cast<dimension_size_type>(memo.readUInt());
+          return sizes;
+        }
+
+        void
+        writeMemoModulo(MemoWriter&   memo,
+                        const Modulo& modulo)
+        {
+          memo.write(modulo.parentDimension);
+          memo.write(modulo.start);
+          memo.write(modulo.step);
+          memo.write(modulo.end);
+          memo.write(modulo.parentType);
+          memo.write(modulo.type);
+          memo.write(modulo.typeDescription);
+          memo.write(modulo.unit);
+          memo.write(static_cast<uint64_t>(modulo.labels.size()));
+          for (const auto& label : modulo.labels)
+            memo.write(label);
+        }
+
+        void
+        readMemoModulo(MemoReader& memo,
+                       Modulo&     modulo)
+        {
+          modulo.parentDimension = memo.readString();
+          modulo.start = memo.readDouble();
+          modulo.step = memo.readDouble();
+          modulo.end = memo.readDouble();
+          modulo.parentType = memo.readString();
+          modulo.type = memo.readString();
+          modulo.typeDescription = memo.readString();
+          modulo.unit = memo.readString();
+          modulo.labels.resize(static_cast<std::vector<std::string>::size_type>(memo.readUInt()));
+          for (auto& label : modulo.labels)
+            label = memo.readString();
+        }
+
+        // Only string values are stored, which covers the original
+        // metadata stored in OME-TIFF files; returns false if any
+        // other value types are present.
+        bool
+        writeMemoMetadata(MemoWriter&        memo,
+                          const MetadataMap& map)
+        {
+          memo.write(static_cast<uint64_t>(map.size()));
+          for (const auto& entry : map)
+            {
+              const std::string *value = boost::get<std::string>(&entry.second);
+              if (!value)
+                return false;
+              memo.write(entry.first);
+              memo.write(*value);
+            }
+          return true;
+        }
+
+        void
+        readMemoMetadata(MemoReader&  memo,
+                         MetadataMap& map)
+        {
+          map.clear();
+          uint64_t count = memo.readUInt();
+          for (uint64_t i = 0; i < count; ++i)
+            {
+              std::string key(memo.readString());
+              map.set(key, memo.readString());
+            }
+        }
+
+        void
+        writeMemoCore(MemoWriter&                      memo,
+                      const OMETIFFMetadata&           core,
+                      const std::vector<OMETIFFPlane>& tiffPlanes,
+                      const detail::OMETIFFFileTable&  fileTable)
+        {
+          memo.write(static_cast<uint64_t>(core.sizeX));
+          memo.write(static_cast<uint64_t>(core.sizeY));
+          memo.write(static_cast<uint64_t>(core.sizeZ));
+          writeMemoSizes(memo, core.sizeC);
+          memo.write(static_cast<uint64_t>(core.sizeT));
+          memo.write(static_cast<uint64_t>(core.thumbSizeX));
+          memo.write(static_cast<uint64_t>(core.thumbSizeY));
+          {
+            std::ostringstream type;
+            type << core.pixelType;
+            memo.write(type.str());
+          }
+          memo.write(static_cast<uint64_t>(core.bitsPerPixel));
+          memo.write(static_cast<uint64_t>(core.imageCount));
+          writeMemoModulo(memo, core.moduloZ);
+          writeMemoModulo(memo, core.moduloT);
+          writeMemoModulo(memo, core.moduloC);
+          {
+            std::ostringstream order;
+            order << core.dimensionOrder;
+            memo.write(order.str());
+          }
+          memo.writeBool(core.orderCertain);
+          memo.writeBool(core.littleEndian);
+          memo.writeBool(core.interleaved);
+          memo.writeBool(core.indexed);
+          memo.writeBool(core.falseColor);
+          memo.writeBool(core.metadataComplete);
+          memo.writeBool(core.thumbnail);
+          memo.write(static_cast<uint64_t>(core.resolutionCount));
+          writeMemoSizes(memo, core.tileWidth);
+          writeMemoSizes(memo, core.tileHeight);
+          memo.write(static_cast<uint64_t>(tiffPlanes.size()));
+          for (const auto& plane : tiffPlanes)
+            {
+              memo.write(fileTable.get(plane.file).string());
+              memo.write(static_cast<uint64_t>(plane.ifd));
+              memo.writeBool(plane.certain);
+              memo.write(static_cast<uint64_t>(plane.status));
+            }
+        }
+
+        void
+        readMemoCore(MemoReader&               memo,
+                     OMETIFFMetadata&          core,
+                     detail::OMETIFFFileTable& fileTable)
+        {
+          core.sizeX = static_cast<dimension_size_type>(memo.readUInt());
+          core.sizeY = static_cast<dimension_size_type>(memo.readUInt());
+          core.sizeZ = static_cast<dimension_size_type>(memo.readUInt());
+          core.sizeC = readMemoSizes(memo);
+          core.sizeT = static_cast<dimension_size_type>(memo.readUInt());
+          core.thumbSizeX = static_cast<dimension_size_type>(memo.readUInt());
+          core.thumbSizeY = static_cast<dimension_size_type>(memo.readUInt());
+          core.pixelType = PixelType(memo.readString());
+          core.bitsPerPixel = static_cast<pixel_size_type>(memo.readUInt());
+          core.imageCount = static_cast<dimension_size_type>(memo.readUInt());
+          readMemoModulo(memo, core.moduloZ);
+          readMemoModulo(memo, core.moduloT);
+          readMemoModulo(memo, core.moduloC);
+          core.dimensionOrder = DimensionOrder(memo.readString());
+          core.orderCertain = memo.readBool();
+          core.littleEndian = memo.readBool();
+          core.interleaved = memo.readBool();
+          core.indexed = memo.readBool();
+          core.falseColor = memo.readBool();
+          core.metadataComplete = memo.readBool();
+          core.thumbnail = memo.readBool();
+          core.resolutionCount = static_cast<dimension_size_type>(memo.readUInt());
+          core.tileWidth = readMemoSizes(memo);
+          core.tileHeight = readMemoSizes(memo);
+          core.tiffPlanes.resize(static_cast<std::vector<OMETIFFPlane>::size_type>(memo.readUInt()));
+          for (auto& plane : core.tiffPlanes)
+            {
+              const path file(memo.readString());
+              plane.file = file.empty() ? OMETIFFPlane::no_file : fileTable.add(file);
+              plane.ifd = static_cast<dimension_size_type>(memo.readUInt());
+              plane.certain = memo.readBool();
+              uint64_t status = memo.readUInt();
+              if (status > OMETIFFPlane::ABSENT)
+                throw std::runtime_error("Invalid plane status in memo");
+              plane.status = static_cast<OMETIFFPlane::Status>(status);
+            }
+        }
+
       }
 
       OMETIFFReader::OMETIFFReader():
@@ -179,8 +550,21 @@ namespace ome
         metadataFile(),
         usedFiles(),
         hasSPW(false),
+        plateIndex(),
         cachedMetadata(),
-        cachedMetadataFile()
+        cachedMetadataFile(),
+        cachedMetadataComplete(false),
+        sourceFactory(),
+        sourceFiles(),
+        tileCache(),
+        memoDirectory(),
+        directoryOffsets(),
+        maxOpenFiles(128U),
+        openFiles(),
+        recentFile(0U),
+        recentTIFF(),
+        fileValidation(false),
+        metadataIndex()
       {
         this->suffixNecessary = false;
         this->suffixSufficient = false;
@@ -200,6 +584,72 @@ namespace ome
           }
       }
 
+      void
+      OMETIFFReader::setIOSourceFactory(const tiff::IOSourceFactory& factory)
+      {
+        assertId(currentId, false);
+        sourceFactory = factory;
+      }
+
+      const tiff::IOSourceFactory&
+      OMETIFFReader::getIOSourceFactory() const
+      {
+        return sourceFactory;
+      }
+
+      void
+      OMETIFFReader::setTileCache(const std::shared_ptr<DecodedTileCache>& cache)
+      {
+        assertId(currentId, false);
+        tileCache = cache;
+      }
+
+      const std::shared_ptr<DecodedTileCache>&
+      OMETIFFReader::getTileCache() const
+      {
+        return tileCache;
+      }
+
+      void
+      OMETIFFReader::setMemoDirectory(const boost::filesystem::path& directory)
+      {
+        assertId(currentId, false);
+        memoDirectory = directory;
+      }
+
+      const boost::filesystem::path&
+      OMETIFFReader::getMemoDirectory() const
+      {
+        return memoDirectory;
+      }
+
+      void
+      OMETIFFReader::setMaxOpenFiles(dimension_size_type files)
+      {
+        std::lock_guard<std::mutex> lock(tiffsMutex);
+        maxOpenFiles = files;
+        evictTIFFs();
+      }
+
+      dimension_size_type
+      OMETIFFReader::getMaxOpenFiles() const
+      {
+        return maxOpenFiles;
+      }
+
+      void
+      OMETIFFReader::setFileValidation(bool validate)
+      {
+        assertId(currentId, false);
+        fileValidation = validate;
+      }
+
+      bool
+      OMETIFFReader::getFileValidation() const
+      {
+        return fileValidation;
+      }
+
       void
       OMETIFFReader::close(bool fileOnly)
       {
@@ -209,15 +659,74 @@ namespace ome
             invalidFiles.clear();
             cachedMetadataFile.clear();
             cachedMetadata.reset();
+            cachedMetadataComplete = false;
             hasSPW = false;
+            plateIndex.reset();
             usedFiles.clear();
             metadataFile.clear();
+            directoryOffsets.clear();
+            metadataIndex.reset();
+            seriesPlanes.clear();
+            seriesFiles.clear();
+            fileTable.clear();
+            sourceFiles.clear();
           }
-        tiffs.clear(); // Closes all open TIFFs.
+        {
+          std::lock_guard<std::mutex> lock(tiffsMutex);
+          recentTIFF.reset();
+          openFiles.clear();
+          tiffs.clear(); // Closes all open TIFFs.
+        }
 
         detail::FormatReader::close(fileOnly);
       }
 
+      std::shared_ptr<::ome::xml::meta::OMEXMLMetadata>
+      OMETIFFReader::getImageMetadata(dimension_size_type image) const
+      {
+        assertId(currentId, true);
+
+        if (!metadataIndex)
+          {
+            const path source(metadataFile.empty() ? *currentId : metadataFile);
+            std::string omexml;
+            if (checkSuffix(source, companion_suffixes))
+              omexml = readFile(source);
+            else
+              {
+                std::shared_ptr<tiff::TIFF> tiff = TIFF::open(source, "r", sourceFactory);
+                if (!tiff)
+                  {
+                    boost::format fmt("Failed to open ‘%1%’");
+                    fmt % source.string();
+                    throw FormatException(fmt.str());
+                  }
+                omexml = getImageDescription(*tiff);
+              }
+
+            try
+              {
+                metadataIndex = std::make_shared<OMEXMLIndex>(omexml);
+              }
+            catch (const std::runtime_error& e)
+              {
+                boost::format fmt("Failed to index OME-XML in ‘%1%’: %2%");
+                fmt % source.string() % e.what();
+                throw FormatException(fmt.str());
+              }
+          }
+
+        return metadataIndex->getImageMetadata(image);
+      }
+
+      std::shared_ptr<const PlateIndex>
+      OMETIFFReader::getPlateIndex() const
+      {
+        assertId(currentId, true);
+
+        return plateIndex;
+      }
+
       bool
       OMETIFFReader::isSingleFile(const boost::filesystem::path& id) const
       {
@@ -226,7 +735,7 @@ namespace ome
 
         try
           {
-            std::shared_ptr<::ome::xml::meta::Metadata> test_meta(cacheMetadata(id));
+            std::shared_ptr<::ome::xml::meta::Metadata> test_meta(cacheMetadata(id, false));
 
             dimension_size_type nImages = 0U;
             for (dimension_size_type i = 0U;
@@ -242,7 +751,7 @@ namespace ome
                 nImages += static_cast<dimension_size_type>(z) * static_cast<dimension_size_type>(t) * nChannels;
               }
 
-            std::shared_ptr<tiff::TIFF> tiff = TIFF::open(id, "r");
+            std::shared_ptr<tiff::TIFF> tiff = TIFF::open(id, "r", sourceFactory);
 
             if (!tiff)
               {
@@ -251,9 +760,21 @@ namespace ome
                 throw FormatException(fmt.str());
               }
 
-            dimension_size_type nIFD = tiff->directoryCount();
+            if (!nImages ||
+                nImages - 1 > std::numeric_limits<ome::files::tiff::directory_index_type>::max())
+              return false;
 
-            return nImages > 0 && nImages <= nIFD;
+            // Only check that the last plane's IFD exists, to avoid
+            // reading every directory in the file.
+            try
+              {
+                tiff->getDirectoryByIndex(static_cast<ome::files::tiff::directory_index_type>(nImages - 1));
+              }
+            catch (const ome::files::tiff::Exception&)
+              {
+                return false;
+              }
+            return true;
           }
         catch (const std::exception&)
           {
@@ -274,10 +795,15 @@ namespace ome
       bool
       OMETIFFReader::isFilenameThisTypeImpl(const boost::filesystem::path& name) const
       {
+        // Reject non-TIFF files without opening them or reading
+        // the metadata.
+        if (!tiff::isTIFFHeader(name, sourceFactory))
+          return false;
+
         bool valid = true;
         try
           {
-            std::shared_ptr<::ome::xml::meta::Metadata> test_meta(cacheMetadata(name));
+            std::shared_ptr<::ome::xml::meta::Metadata> test_meta(cacheMetadata(name, false));
             std::string metadataFile = test_meta->getBinaryOnlyMetadataFile();
             if (!metadataFile.empty())
               {
@@ -289,7 +815,7 @@ namespace ome
                   }
                 else
                   {
-                    test_meta = cacheMetadata(metadataFile);
+                    test_meta = cacheMetadata(metadataFile, false);
                   }
               }
             if (valid)
@@ -326,15 +852,22 @@ namespace ome
 
       const std::shared_ptr<const tiff::IFD>
       OMETIFFReader::ifdAtIndex(dimension_size_type plane) const
+      {
+        return ifdAtCoreIndex(getCoreIndex(), plane);
+      }
+
+      const std::shared_ptr<const tiff::IFD>
+      OMETIFFReader::ifdAtCoreIndex(dimension_size_type coreIndex,
+                                    dimension_size_type plane) const
       {
         std::shared_ptr<const IFD> ifd;
 
-        const OMETIFFMetadata& ometa(dynamic_cast<const OMETIFFMetadata&>(getCoreMetadata(getCoreIndex())));
+        const std::vector<OMETIFFPlane>& tiffPlanes(seriesPlanes.at(coreIndex));
 
-        if (plane < ometa.tiffPlanes.size())
+        if (plane < tiffPlanes.size())
           {
-            const OMETIFFPlane& tiffplane(ometa.tiffPlanes.at(plane));
-            const std::shared_ptr<const TIFF> tiff(getTIFF(tiffplane.id));
+            const OMETIFFPlane& tiffplane(tiffPlanes.at(plane));
+            const std::shared_ptr<const TIFF> tiff(getTIFF(tiffplane.file));
             if (tiff)
               ifd = std::shared_ptr<const IFD>(tiff->getDirectoryByIndex(tiffplane.ifd));
           }
@@ -356,11 +889,9 @@ namespace ome
         return getDomainCollection(hasSPW ? HCS_ONLY_DOMAINS : NON_GRAPHICS_DOMAINS);
       }
 
-      const std::vector<boost::filesystem::path>
-      OMETIFFReader::getSeriesUsedFiles(bool noPixels) const
+      std::vector<boost::filesystem::path>
+      OMETIFFReader::findSeriesUsedFiles(bool noPixels) const
       {
-        assertId(currentId, true);
-
         std::set<boost::filesystem::path> fileSet;
 
         if (!noPixels)
@@ -368,13 +899,8 @@ namespace ome
             if (!metadataFile.empty())
               fileSet.insert(metadataFile);
 
-            const OMETIFFMetadata& ometa(dynamic_cast<const OMETIFFMetadata&>(getCoreMetadata(getCoreIndex())));
-
-            for(const auto& plane : ometa.tiffPlanes)
-              {
-                if (!plane.id.empty())
-                  fileSet.insert(plane.id);
-              }
+            for (const auto file : seriesFiles.at(getCoreIndex()))
+              fileSet.insert(fileTable.get(file));
           }
 
         return std::vector<boost::filesystem::path>(fileSet.begin(), fileSet.end());
@@ -417,6 +943,49 @@ namespace ome
         return ometa.tileHeight.at(channel);
       }
 
+      std::shared_ptr<detail::FormatReader>
+      OMETIFFReader::newClone() const
+      {
+        return std::make_shared<OMETIFFReader>();
+      }
+
+      void
+      OMETIFFReader::copyState(const detail::FormatReader& source)
+      {
+        detail::FormatReader::copyState(source);
+
+        const OMETIFFReader& reader(dynamic_cast<const OMETIFFReader&>(source));
+        files = reader.files;
+        invalidFiles = reader.invalidFiles;
+        metadataFile = reader.metadataFile;
+        usedFiles = reader.usedFiles;
+        hasSPW = reader.hasSPW;
+        plateIndex = reader.plateIndex;
+        cachedMetadata = reader.cachedMetadata;
+        cachedMetadataFile = reader.cachedMetadataFile;
+        cachedMetadataComplete = reader.cachedMetadataComplete;
+        sourceFactory = reader.sourceFactory;
+        tileCache = reader.tileCache;
+        memoDirectory = reader.memoDirectory;
+        maxOpenFiles = reader.maxOpenFiles;
+        fileValidation = reader.fileValidation;
+        metadataIndex = reader.metadataIndex;
+        seriesPlanes = reader.seriesPlanes;
+        fileTable = reader.fileTable;
+        seriesFiles = reader.seriesFiles;
+
+        // TIFFs are opened on demand, reusing the directory offsets
+        // found by the source reader.
+        std::lock_guard<std::mutex> lock(reader.tiffsMutex);
+        directoryOffsets = reader.directoryOffsets;
+        for (const auto& file : reader.tiffs)
+          {
+            tiffs.insert(std::make_pair(file.first, std::shared_ptr<tiff::TIFF>()));
+            if (file.second && directoryOffsets.find(file.first) == directoryOffsets.end())
+              directoryOffsets[file.first] = std::make_pair(file.second->getDirectoryOffsets(), false);
+          }
+      }
+
       void
       OMETIFFReader::initFile(const boost::filesystem::path& id)
       {
@@ -429,10 +998,17 @@ namespace ome
             // This is a companion file.  Read the metadata, get the
             // TIFF for the TiffData for the first image, and then
             // recurse with this file as the id.
-            std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> meta(createOMEXMLMetadata(*currentId));
+            std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> meta(parseOMEXML(readFile(*currentId), *currentId));
             path firstTIFF(path(meta->getUUIDFileName(0, 0)));
             close(false); // To force clearing of currentId.
-            initFile(canonical(firstTIFF, dir));
+            initFile(resolveFile(firstTIFF, dir));
+            return;
+          }
+
+        // Restore the reader state from a memo, if available.
+        if (readMemo())
+          {
+            shareCoreMetadata();
             return;
           }
 
@@ -440,16 +1016,23 @@ namespace ome
         addTIFF(*currentId);
         const std::shared_ptr<const TIFF> tiff(getTIFF(*currentId));
 
+        // The complete OME-XML metadata model is only needed if the
+        // caller provided a metadata store to fill.  Otherwise, only
+        // the subset needed to map planes to IFDs and set up the core
+        // metadata is parsed, avoiding building the DOM and model
+        // objects for large headers.
+        bool complete = !std::dynamic_pointer_cast<ome::xml::meta::DummyMetadata>(getMetadataStore());
+
         // Get the OME-XML from the first TIFF, and create OME-XML
         // metadata from it.
-        std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> meta = cacheMetadata(*currentId);
+        std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> meta = cacheMetadata(*currentId, complete);
 
         // Is there an associated binary-only metadata file?
         try
           {
-            metadataFile = canonical(path(meta->getBinaryOnlyMetadataFile()), dir);
-            if (!metadataFile.empty() && boost::filesystem::exists(metadataFile))
-              meta = readMetadata(metadataFile);
+            metadataFile = resolveFile(path(meta->getBinaryOnlyMetadataFile()), dir);
+            if (!metadataFile.empty() && fileExists(metadataFile))
+              meta = readMetadata(metadataFile, complete);
           }
         catch (const std::exception&)
           {
@@ -466,6 +1049,20 @@ namespace ome
           {
           }
 
+        // Index the series of each well sample.
+        if (hasSPW)
+          {
+            try
+              {
+                plateIndex = std::make_shared<PlateIndex>(*meta);
+              }
+            catch (const std::exception& e)
+              {
+                BOOST_LOG_SEV(logger, ome::logging::trivial::warning)
+                  << "Failed to index plate metadata: " << e.what();
+              }
+          }
+
         // Clean up any invalid metadata.
         cleanMetadata(*meta);
 
@@ -503,16 +1100,36 @@ namespace ome
         // UUID → file mapping and used files.
         findUsedFiles(*meta, *currentId, dir, currentUUID);
 
+        // Per-plane debug records are skipped entirely unless debug
+        // logging is enabled.
+        const bool logPlanes(debugEnabled(logger));
+
+        // Validate the used files concurrently, rather than opening
+        // each in turn as its TiffData elements are processed.
+        std::map<path, bool> validFiles;
+        if (fileValidation)
+          {
+            std::vector<char> valid(usedFiles.size(), 0);
+            forEachTIFF(usedFiles,
+                        [&valid](std::size_t i, const std::shared_ptr<const TIFF>& tiff)
+                        { valid[i] = static_cast<bool>(tiff); });
+            for (std::vector<path>::size_type i = 0; i < usedFiles.size(); ++i)
+              validFiles.insert(std::make_pair(usedFiles[i], static_cast<bool>(valid[i])));
+          }
+
         // Process TiffData elements.
         for (index_type series = 0; series < seriesCount; ++series)
           {
             std::shared_ptr<OMETIFFMetadata> coreMeta(std::dynamic_pointer_cast<OMETIFFMetadata>(core.at(series)));
             assert(coreMeta); // Should never be null.
 
-            BOOST_LOG_SEV(logger, ome::logging::trivial::debug)
-              << "Image[" << series << "] {";
-            BOOST_LOG_SEV(logger, ome::logging::trivial::debug)
-              << "  id = " << meta->getImageID(series);
+            if (logPlanes)
+              {
+                BOOST_LOG_SEV(logger, ome::logging::trivial::debug)
+                  << "Image[" << series << "] {";
+                BOOST_LOG_SEV(logger, ome::logging::trivial::debug)
+                  << "  id = " << meta->getImageID(series);
+              }
 
             DimensionOrder order(meta->getPixelsDimensionOrder(series));
 
@@ -560,8 +1177,9 @@ namespace ome
 
             for (index_type td = 0; td < tiffDataCount; ++td)
               {
-                BOOST_LOG_SEV(logger, ome::logging::trivial::debug)
-                  << "  TiffData[" << td << "] {";
+                if (logPlanes)
+                  BOOST_LOG_SEV(logger, ome::logging::trivial::debug)
+                    << "  TiffData[" << td << "] {";
 
                 boost::optional<NonNegativeInteger> tdIFD;
                 NonNegativeInteger numPlanes = 0;
@@ -637,8 +1255,8 @@ namespace ome
                 else
                   {
                     // All the other cases will already have a canonical path.
-                    if (fs::exists(dir / *filename))
-                      filename = canonical(dir / *filename, dir);
+                    if (fileExists(dir / *filename))
+                      filename = resolveFile(dir / *filename, dir);
                     else
                       {
                         invalid_file_map::const_iterator invalid = invalidFiles.find(*filename);
@@ -661,7 +1279,7 @@ namespace ome
                 addTIFF(*filename);
 
                 bool exists = true;
-                if (!fs::exists(*filename))
+                if (!fileExists(*filename))
                   {
                     // If an absolute filename, try using a relative
                     // name.  Old versions of the Java OMETiffWriter
@@ -669,7 +1287,7 @@ namespace ome
                     // causes problems if the file is moved to a
                     // different directory.
                     path relative(dir / (*filename).filename());
-                    if (fs::exists(relative))
+                    if (fileExists(relative))
                       {
                         filename = relative;
                       }
@@ -679,8 +1297,14 @@ namespace ome
                         exists = usedFiles.size() == 1;
                       }
                   }
-                if (exists) // check it's really a valid TIFF
-                  exists = validTIFF(*filename);
+                if (exists && fileValidation) // check it's really a valid TIFF
+                  {
+                    // Files found invalid are checked again, to
+                    // report the failure.
+                    std::map<path, bool>::const_iterator v(validFiles.find(*filename));
+                    exists = (v != validFiles.end() && v->second) || validTIFF(*filename);
+                  }
+                const detail::OMETIFFFileTable::index_type file(fileTable.add(*filename));
 
                 // Fill plane index → IFD mapping
                 for (dimension_size_type q = 0;
@@ -689,15 +1313,16 @@ namespace ome
                   {
                     dimension_size_type no = index + q;
                     OMETIFFPlane& plane(coreMeta->tiffPlanes.at(no));
-                    plane.id = *filename;
+                    plane.file = file;
                     plane.ifd = static_cast<dimension_size_type>(*tdIFD) + q;
                     plane.certain = true;
                     plane.status = exists ? OMETIFFPlane::PRESENT : OMETIFFPlane::ABSENT;
 
-                    BOOST_LOG_SEV(logger, ome::logging::trivial::debug)
-                      << "    Plane[" << no
-                      << "]: file=" << plane.id.string()
-                      << ", IFD=" << plane.ifd;
+                    if (logPlanes)
+                      BOOST_LOG_SEV(logger, ome::logging::trivial::debug)
+                        << "    Plane[" << no
+                        << "]: file=" << filename->string()
+                        << ", IFD=" << plane.ifd;
                   }
                 if (numPlanes == 0)
                   {
@@ -710,17 +1335,19 @@ namespace ome
                         if (plane.certain)
                           break;
                         OMETIFFPlane& previousPlane(coreMeta->tiffPlanes.at(no - 1));
-                        plane.id = *filename;
+                        plane.file = file;
                         plane.ifd = previousPlane.ifd + 1;
                         plane.status = exists ? OMETIFFPlane::PRESENT : OMETIFFPlane::ABSENT;
 
-                        BOOST_LOG_SEV(logger, ome::logging::trivial::debug)
-                          << "    Plane[" << no
-                          << "]: FILLED";
+                        if (logPlanes)
+                          BOOST_LOG_SEV(logger, ome::logging::trivial::debug)
+                            << "    Plane[" << no
+                            << "]: FILLED";
                       }
                   }
-                BOOST_LOG_SEV(logger, ome::logging::trivial::debug)
-                  << "  }";
+                if (logPlanes)
+                  BOOST_LOG_SEV(logger, ome::logging::trivial::debug)
+                    << "  }";
               }
 
             // Clear any unset planes.
@@ -730,12 +1357,13 @@ namespace ome
               {
                 if (plane->status != OMETIFFPlane::UNKNOWN)
                   continue;
-                plane->id.clear();
+                plane->file = OMETIFFPlane::no_file;
                 plane->ifd = 0;
 
-                BOOST_LOG_SEV(logger, ome::logging::trivial::debug)
-                  << "    Plane[" << plane - coreMeta->tiffPlanes.begin()
-                  << "]: CLEARED";
+                if (logPlanes)
+                  BOOST_LOG_SEV(logger, ome::logging::trivial::debug)
+                    << "    Plane[" << plane - coreMeta->tiffPlanes.begin()
+                    << "]: CLEARED";
               }
 
             if (!core.at(series))
@@ -748,12 +1376,13 @@ namespace ome
               {
                 OMETIFFPlane& plane(coreMeta->tiffPlanes.at(no));
 
-                BOOST_LOG_SEV(logger, ome::logging::trivial::debug)
-                  << "  Verify Plane[" << no
-                  << "]: file=" << plane.id.string()
-                  << ", IFD=" << plane.ifd;
+                if (logPlanes)
+                  BOOST_LOG_SEV(logger, ome::logging::trivial::debug)
+                    << "  Verify Plane[" << no
+                    << "]: file=" << fileTable.get(plane.file).string()
+                    << ", IFD=" << plane.ifd;
 
-                if (plane.id.empty())
+                if (!plane.hasFile())
                   {
                     BOOST_LOG_SEV(logger, ome::logging::trivial::warning)
                       << "Image ID: " << meta->getImageID(series)
@@ -767,27 +1396,110 @@ namespace ome
                     for (dimension_size_type p = 0; p < nIFD; ++p)
                       {
                         OMETIFFPlane& plane(coreMeta->tiffPlanes.at(p));
-                        plane.id = *currentId;
+                        plane.file = fileTable.add(*currentId);
                         plane.ifd = p;
                       }
                     break;
                   }
               }
 
-            BOOST_LOG_SEV(logger, ome::logging::trivial::debug)
-              << "}";
+            if (logPlanes)
+              BOOST_LOG_SEV(logger, ome::logging::trivial::debug)
+                << "}";
+          }
+
+        // The IFDs of the first plane and of the first plane of each
+        // channel of every series are checked against the metadata.
+        // Their properties are read concurrently for each file, and
+        // then checked in series order.
+        std::vector<std::vector<PlaneIFDInfo>> planeIFDs(seriesCount);
+        {
+          std::map<path, std::vector<PlaneIFDInfo *>> requests;
+          for (index_type series = 0; series < seriesCount; ++series)
+            {
+              std::shared_ptr<OMETIFFMetadata> coreMeta(std::dynamic_pointer_cast<OMETIFFMetadata>(core.at(series)));
+              if (!coreMeta)
+                continue;
+
+              std::vector<PlaneIFDInfo>& infos(planeIFDs.at(series));
+              infos.resize(coreMeta->sizeC.size() + 1U);
+              for (std::vector<PlaneIFDInfo>::size_type i = 0; i < infos.size(); ++i)
+                {
+                  try
+                    {
+                      dimension_size_type planeIndex = 0U;
+                      if (i)
+                        {
+                          dimension_size_type sizeZ = meta->getPixelsSizeZ(series);
+                          dimension_size_type sizeT = meta->getPixelsSizeT(series);
+                          planeIndex = ome::files::getIndex(meta->getPixelsDimensionOrder(series),
+                                                            sizeZ,
+                                                            coreMeta->sizeC.size(),
+                                                            sizeT,
+                                                            sizeZ * coreMeta->sizeC.size() * sizeT,
+                                                            0,
+                                                            i - 1U,
+                                                            0);
+                        }
+                      const OMETIFFPlane& plane(coreMeta->tiffPlanes.at(planeIndex));
+                      infos[i].ifd = plane.ifd;
+                      requests[fileTable.get(plane.file)].push_back(&infos[i]);
+                    }
+                  catch (...)
+                    {
+                      infos[i].error = std::current_exception();
+                    }
+                }
+            }
+
+          std::vector<path> files;
+          for (const auto& request : requests)
+            files.push_back(request.first);
+          forEachTIFF(files,
+                      [&files, &requests](std::size_t i, const std::shared_ptr<const TIFF>& tiff)
+                      {
+                        for (auto info : requests.at(files[i]))
+                          {
+                            try
+                              {
+                                if (!tiff)
+                                  {
+                                    boost::format fmt("Failed to open ‘%1%’");
+                                    fmt % files[i].string();
+                                    throw FormatException(fmt.str());
+                                  }
+                                info->read(*tiff->getDirectoryByIndex(info->ifd));
+                              }
+                            catch (...)
+                              {
+                                info->error = std::current_exception();
+                              }
+                          }
+                      });
+        }
+
+        for (index_type series = 0; series < seriesCount; ++series)
+          {
+            std::shared_ptr<OMETIFFMetadata> coreMeta(std::dynamic_pointer_cast<OMETIFFMetadata>(core.at(series)));
+            if (!coreMeta)
+              continue;
+
+            PositiveInteger effSizeC = coreMeta->sizeC.size();
+            PositiveInteger sizeT = meta->getPixelsSizeT(series);
+            PositiveInteger sizeZ = meta->getPixelsSizeZ(series);
+            PositiveInteger num = effSizeC * sizeT * sizeZ;
 
             // Fill CoreMetadata.
             try
               {
-                const OMETIFFPlane& plane(coreMeta->tiffPlanes.at(0));
-                const std::shared_ptr<const tiff::TIFF> ptiff(getTIFF(plane.id));
-                const std::shared_ptr<const tiff::IFD> pifd(ptiff->getDirectoryByIndex(plane.ifd));
+                const PlaneIFDInfo& pifd(planeIFDs.at(series).at(0));
+                if (pifd.error)
+                  std::rethrow_exception(pifd.error);
 
-                uint32_t tiffWidth = pifd->getImageWidth();
-                uint32_t tiffHeight = pifd->getImageHeight();
-                ome::xml::model::enums::PixelType tiffPixelType = pifd->getPixelType();
-                tiff::PhotometricInterpretation photometric = pifd->getPhotometricInterpretation();
+                uint32_t tiffWidth = pifd.width;
+                uint32_t tiffHeight = pifd.height;
+                ome::xml::model::enums::PixelType tiffPixelType = pifd.pixeltype;
+                tiff::PhotometricInterpretation photometric = pifd.photometric;
 
                 coreMeta->sizeX = meta->getPixelsSizeX(series);
                 coreMeta->sizeY = meta->getPixelsSizeY(series);
@@ -807,21 +1519,9 @@ namespace ome
 
                 // This doesn't match the reality, but since subchannels are
                 // addressed as planes this is needed.
-                coreMeta->interleaved = (pifd->getPlanarConfiguration() == tiff::CONTIG);
+                coreMeta->interleaved = (pifd.planarconfig == tiff::CONTIG);
 
-                coreMeta->indexed = false;
-                if (photometric == tiff::PALETTE)
-                  {
-                    try
-                      {
-                        std::array<std::vector<uint16_t>, 3> cmap;
-                        pifd->getField(ome::files::tiff::COLORMAP).get(cmap);
-                        coreMeta->indexed = true;
-                      }
-                    catch (const tiff::Exception&)
-                      {
-                      }
-                  }
+                coreMeta->indexed = photometric == tiff::PALETTE && pifd.colormap;
                 coreMeta->metadataComplete = true;
                 coreMeta->bitsPerPixel = bitsPerPixel(coreMeta->pixelType);
                 try
@@ -847,21 +1547,10 @@ namespace ome
                 // Check channel sizes and correct if wrong.
                 for (dimension_size_type channel = 0; channel < coreMeta->sizeC.size(); ++channel)
                   {
-                    dimension_size_type planeIndex =
-                      ome::files::getIndex(coreMeta->dimensionOrder,
-                                                coreMeta->sizeZ,
-                                                coreMeta->sizeC.size(),
-                                                coreMeta->sizeT,
-                                                coreMeta->imageCount,
-                                                0,
-                                                channel,
-                                                0);
-
-                    const OMETIFFPlane& plane(coreMeta->tiffPlanes.at(planeIndex));
-                    const std::shared_ptr<const tiff::TIFF> ctiff(getTIFF(plane.id));
-                    const std::shared_ptr<const tiff::IFD> cifd(ctiff->getDirectoryByIndex(plane.ifd));
-                    const tiff::TileInfo tinfo(cifd->getTileInfo());
-                    const dimension_size_type tiffSamples = cifd->getSamplesPerPixel();
+                    const PlaneIFDInfo& cifd(planeIFDs.at(series).at(channel + 1U));
+                    if (cifd.error)
+                      std::rethrow_exception(cifd.error);
+                    const dimension_size_type tiffSamples = cifd.samples;
 
                     if (coreMeta->sizeC.at(channel) != tiffSamples)
                       {
@@ -872,8 +1561,8 @@ namespace ome
                         coreMeta->sizeC.at(channel) = tiffSamples;
                       }
 
-                    coreMeta->tileWidth.push_back(tinfo.tileWidth());
-                    coreMeta->tileHeight.push_back(tinfo.tileHeight());
+                    coreMeta->tileWidth.push_back(cifd.tileWidth);
+                    coreMeta->tileHeight.push_back(cifd.tileHeight);
                   }
 
                 if (coreMeta->sizeX != tiffWidth)
@@ -1051,6 +1740,71 @@ namespace ome
             // The metadata store doesn't support getImageCount so we
             // can't meaningfully set anything.
           }
+
+        shareCoreMetadata();
+        writeMemo();
+      }
+
+      void
+      OMETIFFReader::shareCoreMetadata()
+      {
+        seriesPlanes.clear();
+        seriesPlanes.resize(core.size());
+        seriesFiles.clear();
+        seriesFiles.resize(core.size());
+
+        // Candidates for sharing, grouped by dimension sizes.
+        typedef std::array<dimension_size_type, 5> size_key;
+        std::map<size_key, std::vector<std::shared_ptr<OMETIFFMetadata>>> shared;
+
+        for (coremetadata_list_type::size_type i = 0; i < core.size(); ++i)
+          {
+            std::shared_ptr<OMETIFFMetadata> coreMeta(std::dynamic_pointer_cast<OMETIFFMetadata>(core[i]));
+            if (!coreMeta)
+              continue;
+
+            seriesPlanes[i].swap(coreMeta->tiffPlanes);
+
+            std::vector<detail::OMETIFFFileTable::index_type>& files(seriesFiles[i]);
+            for (const auto& plane : seriesPlanes[i])
+              if (plane.hasFile())
+                files.push_back(plane.file);
+            std::sort(files.begin(), files.end());
+            files.erase(std::unique(files.begin(), files.end()), files.end());
+
+            const size_key key{{coreMeta->sizeX, coreMeta->sizeY, coreMeta->sizeZ,
+                  coreMeta->sizeT, coreMeta->imageCount}};
+            std::vector<std::shared_ptr<OMETIFFMetadata>>& candidates(shared[key]);
+
+            bool found = false;
+            for (const auto& candidate : candidates)
+              {
+                if (candidate->sameAs(*coreMeta))
+                  {
+                    core[i] = candidate;
+                    found = true;
+                    break;
+                  }
+              }
+            if (!found)
+              candidates.push_back(coreMeta);
+          }
+      }
+
+      void
+      OMETIFFReader::fillMetadataStore()
+      {
+        const path id(*currentId);
+        // Keep the IFD offsets found so far, to avoid rescanning.
+        offset_map offsets(directoryOffsets);
+        for (const auto& tiff : tiffs)
+          if (tiff.second && offsets.find(tiff.first) == offsets.end())
+            offsets[tiff.first] = std::make_pair(tiff.second->getDirectoryOffsets(), false);
+        close();
+        directoryOffsets = offsets;
+        initFile(id);
+        updateSeriesIndex();
+        updateUsedFiles();
       }
 
       void
@@ -1086,12 +1840,12 @@ namespace ome
                     try
                       {
                         uuidFilename = meta.getUUIDFileName(series, td);
-                        uuidFilename = canonical(uuidFilename, currentDir);
+                        uuidFilename = resolveFile(uuidFilename, currentDir);
                       }
                     catch (const std::exception&)
                       {
                       }
-                    if (fs::exists(uuidFilename))
+                    if (fileExists(uuidFilename))
                       {
                         filename = uuidFilename;
                       }
@@ -1386,6 +2140,21 @@ namespace ome
           }
       }
 
+      std::shared_ptr<const tiff::IFD>
+      OMETIFFReader::getPlaneIFD(dimension_size_type plane) const
+      {
+        assertId(currentId, true);
+
+        if (plane >= getImageCount())
+          {
+            boost::format fmt("Invalid plane: %1%");
+            fmt % plane;
+            throw std::logic_error(fmt.str());
+          }
+
+        return ifdAtIndex(plane);
+      }
+
       void
       OMETIFFReader::openBytesImpl(dimension_size_type plane,
                                    VariantPixelBuffer& buf,
@@ -1398,18 +2167,124 @@ namespace ome
 
         const std::shared_ptr<const IFD>& ifd(ifdAtIndex(plane));
 
-        ifd->readImage(buf, x, y, w, h);
+        // Accumulate pixel statistics while the tiles are unpacked.
+        std::shared_ptr<PixelStatistics> stats(newPixelStatistics(plane, x, y, w, h));
+        if (stats)
+          {
+            ifd->readImage(buf, x, y, w, h, *stats);
+            cachePixelStatistics(plane, stats);
+          }
+        else
+          ifd->readImage(buf, x, y, w, h);
+      }
+
+      std::function<void ()>
+      OMETIFFReader::openBytesTask(dimension_size_type plane,
+                                   VariantPixelBuffer& buf,
+                                   dimension_size_type x,
+                                   dimension_size_type y,
+                                   dimension_size_type w,
+                                   dimension_size_type h) const
+      {
+        std::shared_ptr<const IFD> ifd(ifdAtIndex(plane));
+        VariantPixelBuffer *dest = &buf;
+
+        return [ifd, dest, x, y, w, h]()
+          {
+            ifd->readImage(*dest, x, y, w, h);
+          };
+      }
+
+      void
+      OMETIFFReader::openBytesBatchImpl(const std::vector<ReadRequest>& requests) const
+      {
+        assertId(currentId, true);
+
+        std::vector<IFD::ReadRequest> ifdrequests;
+        ifdrequests.reserve(requests.size());
+        for (const auto& request : requests)
+          {
+            IFD::ReadRequest ifdrequest;
+            ifdrequest.ifd = ifdAtIndex(request.plane);
+            ifdrequest.region = request.region;
+            ifdrequest.buf = request.buf;
+            ifdrequests.push_back(ifdrequest);
+          }
+
+        IFD::readImages(ifdrequests);
+      }
+
+      void
+      OMETIFFReader::openBytesConcurrentImpl(dimension_size_type coreIndex,
+                                             dimension_size_type plane,
+                                             VariantPixelBuffer& buf,
+                                             dimension_size_type x,
+                                             dimension_size_type y,
+                                             dimension_size_type w,
+                                             dimension_size_type h) const
+      {
+        ifdAtCoreIndex(coreIndex, plane)->readImage(buf, x, y, w, h);
+      }
+
+      void
+      OMETIFFReader::prefetchImpl(dimension_size_type plane,
+                                  dimension_size_type x,
+                                  dimension_size_type y,
+                                  dimension_size_type w,
+                                  dimension_size_type h) const
+      {
+        std::shared_ptr<const IFD> ifd(ifdAtIndex(plane));
+
+        // Decoded tiles are only retained with a tile cache.
+        if (!ifd->getTIFF()->getTileCache())
+          return;
+
+        startPrefetch([ifd, x, y, w, h]()
+                      {
+                        VariantPixelBuffer buf;
+                        ifd->readImage(buf, x, y, w, h);
+                      });
+      }
+
+      void
+      OMETIFFReader::adviseAccessImpl(AccessHint          hint,
+                                      dimension_size_type plane,
+                                      dimension_size_type x,
+                                      dimension_size_type y,
+                                      dimension_size_type w,
+                                      dimension_size_type h) const
+      {
+        ifdAtIndex(plane)->adviseAccess(hint, x, y, w, h);
+      }
+
+      bool
+      OMETIFFReader::openReducedBytesImpl(dimension_size_type plane,
+                                          VariantPixelBuffer& buf,
+                                          dimension_size_type x,
+                                          dimension_size_type y,
+                                          dimension_size_type w,
+                                          dimension_size_type h,
+                                          dimension_size_type scale) const
+      {
+        const std::shared_ptr<const IFD>& ifd(ifdAtIndex(plane));
+        if (!ifd->supportsReducedRead(scale))
+          return false;
+
+        ifd->readImageReduced(buf, x, y, w, h, scale);
+        return true;
       }
 
       void
       OMETIFFReader::addTIFF(const boost::filesystem::path& tiff)
       {
+        std::lock_guard<std::mutex> lock(tiffsMutex);
         tiffs.insert(std::make_pair(tiff, std::shared_ptr<tiff::TIFF>()));
       }
 
       const std::shared_ptr<const ome::files::tiff::TIFF>
       OMETIFFReader::getTIFF(const boost::filesystem::path& tiff) const
       {
+        std::lock_guard<std::mutex> lock(tiffsMutex);
         tiff_map::iterator i = tiffs.find(tiff);
 
         if (i == tiffs.end())
@@ -1425,14 +2300,26 @@ namespace ome
         // is uninitialised; true is invalid.  Used to prevent
         // repeated initialisation when the file is broken or
         // nonexistent.
-        if (!i->second)
+        if (i->second)
           {
-            try
+            // Mark as most recently used.
+            if (openFiles.empty() || openFiles.front() != i->first)
               {
-                i->second = tiff::TIFF::open(i->first, "r");
+                recentTIFF.reset();
+                openFiles.remove(i->first);
+                openFiles.push_front(i->first);
               }
-            catch (const ome::files::tiff::Exception&)
+          }
+        else
+          {
+            offset_map::const_iterator offsets = directoryOffsets.find(i->first);
+            i->second = openTIFF(i->first,
+                                 offsets != directoryOffsets.end() ? &offsets->second : nullptr);
+            if (i->second)
               {
+                recentTIFF.reset();
+                openFiles.push_front(i->first);
+                evictTIFFs();
               }
           }
 
@@ -1448,6 +2335,138 @@ namespace ome
         return i->second;
       }
 
+      const std::shared_ptr<const ome::files::tiff::TIFF>
+      OMETIFFReader::getTIFF(detail::OMETIFFFileTable::index_type file) const
+      {
+        {
+          std::lock_guard<std::mutex> lock(tiffsMutex);
+          if (recentTIFF && recentFile == file)
+            return recentTIFF;
+        }
+
+        const boost::filesystem::path& path(fileTable.get(file));
+        const std::shared_ptr<const ome::files::tiff::TIFF> tiff(getTIFF(path));
+
+        // The file is now first in openFiles, unless a concurrent
+        // read has since used another file.
+        std::lock_guard<std::mutex> lock(tiffsMutex);
+        if (!openFiles.empty() && openFiles.front() == path)
+          {
+            recentFile = file;
+            recentTIFF = tiff;
+          }
+        return tiff;
+      }
+
+      std::shared_ptr<ome::files::tiff::TIFF>
+      OMETIFFReader::openTIFF(const boost::filesystem::path&  tiff,
+                              const offset_map::mapped_type  *offsets) const
+      {
+        std::shared_ptr<ome::files::tiff::TIFF> ret;
+        try
+          {
+            ret = tiff::TIFF::open(tiff, "r", sourceFactory);
+            if (ret)
+              {
+                ret->setDecodeThreads(getDecodeThreads());
+                ret->setExecutor(getExecutor());
+                ret->setVerifyTileChecksums(getVerifyTileChecksums());
+                ret->setStatistics(getStatistics());
+                ret->setTileCache(tileCache);
+
+                if (offsets)
+                  {
+                    try
+                      {
+                        ret->setDirectoryOffsets(offsets->first, offsets->second);
+                      }
+                    catch (const ome::files::tiff::Exception&)
+                      {
+                        // Discover directories instead.
+                      }
+                  }
+              }
+          }
+        catch (const ome::files::tiff::Exception&)
+          {
+            ret.reset();
+          }
+        return ret;
+      }
+
+      void
+      OMETIFFReader::forEachTIFF(const std::vector<boost::filesystem::path>&                                                   files,
+                                 const std::function<void (std::size_t, const std::shared_ptr<const ome::files::tiff::TIFF>&)>& work) const
+      {
+        {
+          std::lock_guard<std::mutex> lock(tiffsMutex);
+          for (const auto& file : files)
+            tiffs.insert(std::make_pair(file, std::shared_ptr<tiff::TIFF>()));
+        }
+
+        const dimension_size_type threads =
+          std::max(std::min(max_open_threads, static_cast<dimension_size_type>(files.size())),
+                   static_cast<dimension_size_type>(1U));
+
+        std::atomic<std::size_t> next(0U);
+        std::mutex errormutex;
+        std::exception_ptr error;
+        runParallel(getExecutor(), threads,
+                    [&](dimension_size_type, dimension_size_type)
+                    {
+                      for (std::size_t i = next++; i < files.size(); i = next++)
+                        {
+                          try
+                            {
+                              // Reuse the TIFF if open, otherwise open
+                              // it without holding the lock, so that
+                              // the files are opened concurrently.
+                              std::shared_ptr<ome::files::tiff::TIFF> tiff;
+                              offset_map::mapped_type offsets;
+                              bool known = false;
+                              {
+                                std::lock_guard<std::mutex> lock(tiffsMutex);
+                                tiff = tiffs.find(files[i])->second;
+                                offset_map::const_iterator o = directoryOffsets.find(files[i]);
+                                if (!tiff && o != directoryOffsets.end())
+                                  {
+                                    offsets = o->second;
+                                    known = true;
+                                  }
+                              }
+
+                              if (!tiff)
+                                {
+                                  tiff = openTIFF(files[i], known ? &offsets : nullptr);
+
+                                  // Cache the TIFF unless opened
+                                  // concurrently.
+                                  std::lock_guard<std::mutex> lock(tiffsMutex);
+                                  tiff_map::iterator cached = tiffs.find(files[i]);
+                                  if (tiff && !cached->second)
+                                    {
+                                      cached->second = tiff;
+                                      recentTIFF.reset();
+                                      openFiles.push_front(files[i]);
+                                      evictTIFFs();
+                                    }
+                                }
+
+                              work(i, tiff);
+                            }
+                          catch (...)
+                            {
+                              std::lock_guard<std::mutex> lock(errormutex);
+                              if (!error)
+                                error = std::current_exception();
+                            }
+                        }
+                    });
+
+        if (error)
+          std::rethrow_exception(error);
+      }
+
       bool
       OMETIFFReader::validTIFF(const boost::filesystem::path& tiff) const
       {
@@ -1455,50 +2474,366 @@ namespace ome
         return static_cast<bool>(valid);
       }
 
+      bool
+      OMETIFFReader::fileExists(const boost::filesystem::path& file) const
+      {
+        if (sourceFactory)
+          {
+            std::map<path, bool>::const_iterator i(sourceFiles.find(file));
+            if (i != sourceFiles.end())
+              return i->second;
+
+            bool exists = false;
+            try
+              {
+                exists = static_cast<bool>(sourceFactory(file)) || fs::exists(file);
+              }
+            catch (const std::exception&)
+              {
+              }
+            sourceFiles.insert(std::make_pair(file, exists));
+            return exists;
+          }
+
+        return fs::exists(file);
+      }
+
+      boost::filesystem::path
+      OMETIFFReader::resolveFile(const boost::filesystem::path& file,
+                                 const boost::filesystem::path& dir) const
+      {
+        if (sourceFactory)
+          return file.empty() ? file : fs::absolute(file, dir);
+
+        return canonical(file, dir);
+      }
+
+      std::string
+      OMETIFFReader::readFile(const boost::filesystem::path& file) const
+      {
+        std::string content;
+        try
+          {
+            std::shared_ptr<tiff::IOSource> source;
+            if (sourceFactory)
+              source = sourceFactory(file);
+            if (source)
+              {
+                content.resize(static_cast<std::string::size_type>(source->size()));
+                std::size_t pos = 0U;
+                while (pos < content.size())
+                  {
+                    std::size_t count = source->read(pos, &content[pos], content.size() - pos);
+                    if (!count)
+                      break;
+                    pos += count;
+                  }
+                content.resize(pos);
+                return content;
+              }
+          }
+        catch (const std::exception& e)
+          {
+            boost::format fmt("Failed to read ‘%1%’: %2%");
+            fmt % file.string() % e.what();
+            throw FormatException(fmt.str());
+          }
+
+        boost::filesystem::ifstream in(file, std::ios::in | std::ios::binary);
+        if (!in)
+          {
+            boost::format fmt("Failed to open ‘%1%’");
+            fmt % file.string();
+            throw FormatException(fmt.str());
+          }
+        content.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        return content;
+      }
+
       void
       OMETIFFReader::closeTIFF(const boost::filesystem::path& tiff)
       {
+        std::lock_guard<std::mutex> lock(tiffsMutex);
         tiff_map::iterator i = tiffs.find(tiff);
         if (i->second)
           {
             i->second->close();
             i->second = std::shared_ptr<ome::files::tiff::TIFF>();
+            recentTIFF.reset();
+            openFiles.remove(tiff);
+          }
+      }
+
+      void
+      OMETIFFReader::evictTIFFs() const
+      {
+        while (maxOpenFiles && openFiles.size() > maxOpenFiles)
+          {
+            tiff_map::iterator i = tiffs.find(openFiles.back());
+            openFiles.pop_back();
+            if (i == tiffs.end() || !i->second)
+              continue;
+
+            // Retain the offsets discovered so far for reopening.  The
+            // TIFF is not closed explicitly, since it may still be in
+            // use by the caller; it is closed when released.
+            offset_map::iterator offsets = directoryOffsets.find(i->first);
+            if (offsets == directoryOffsets.end() || !offsets->second.second)
+              directoryOffsets[i->first] = std::make_pair(i->second->getDirectoryOffsets(), false);
+            if (recentTIFF == i->second)
+              recentTIFF.reset();
+            i->second = std::shared_ptr<ome::files::tiff::TIFF>();
+          }
+      }
+
+      bool
+      OMETIFFReader::readMemo()
+      {
+        if (memoDirectory.empty() ||
+            !std::dynamic_pointer_cast<ome::xml::meta::DummyMetadata>(getMetadataStore()))
+          return false;
+
+        try
+          {
+            MemoReader memo(memoFile(memoDirectory, *currentId), memo_format);
+
+            bool memoSPW = memo.readBool();
+            std::shared_ptr<PlateIndex> memoPlateIndex;
+            if (memo.readBool())
+              {
+                memoPlateIndex = std::make_shared<PlateIndex>();
+                uint64_t entries = memo.readUInt();
+                for (uint64_t i = 0; i < entries; ++i)
+                  {
+                    PlateIndex::Location location;
+                    location.plate = static_cast<dimension_size_type>(memo.readUInt());
+                    location.well = static_cast<dimension_size_type>(memo.readUInt());
+                    location.row = static_cast<dimension_size_type>(memo.readUInt());
+                    location.column = static_cast<dimension_size_type>(memo.readUInt());
+                    location.field = static_cast<dimension_size_type>(memo.readUInt());
+                    memoPlateIndex->add(location, static_cast<dimension_size_type>(memo.readUInt()));
+                  }
+              }
+            path memoMetadataFile(memo.readString());
+
+            std::vector<path> memoUsedFiles(static_cast<std::vector<path>::size_type>(memo.readUInt()));
+            for (auto& file : memoUsedFiles)
+              file = memo.readString();
+
+            uuid_file_map memoFiles;
+            uint64_t count = memo.readUInt();
+            for (uint64_t i = 0; i < count; ++i)
+              {
+                std::string uuid(memo.readString());
+                memoFiles.insert(uuid_file_map::value_type(uuid, path(memo.readString())));
+              }
+
+            invalid_file_map memoInvalidFiles;
+            count = memo.readUInt();
+            for (uint64_t i = 0; i < count; ++i)
+              {
+                path invalid(memo.readString());
+                memoInvalidFiles.insert(invalid_file_map::value_type(invalid, path(memo.readString())));
+              }
+
+            offset_map memoOffsets;
+            std::vector<path> memoTIFFs(static_cast<std::vector<path>::size_type>(memo.readUInt()));
+            for (auto& file : memoTIFFs)
+              {
+                file = memo.readString();
+                std::vector<tiff::offset_type> offsets(static_cast<std::vector<tiff::offset_type>::size_type>(memo.readUInt()));
+                for (auto& offset : offsets)
+                  offset = static_cast<tiff::offset_type>(memo.readUInt());
+                if (!offsets.empty())
+                  memoOffsets.insert(offset_map::value_type(file, std::make_pair(offsets, true)));
+              }
+
+            MetadataMap memoMetadata;
+            readMemoMetadata(memo, memoMetadata);
+
+            detail::OMETIFFFileTable memoFileTable;
+            coremetadata_list_type memoCore(static_cast<coremetadata_list_type::size_type>(memo.readUInt()));
+            for (auto& series : memoCore)
+              {
+                std::shared_ptr<OMETIFFMetadata> coreMeta(std::make_shared<OMETIFFMetadata>());
+                readMemoCore(memo, *coreMeta, memoFileTable);
+                readMemoMetadata(memo, coreMeta->seriesMetadata);
+                series = coreMeta;
+              }
+
+            // The memo is complete and valid; restore the state.
+            hasSPW = memoSPW;
+            plateIndex = memoPlateIndex;
+            metadataFile = memoMetadataFile;
+            usedFiles = memoUsedFiles;
+            files = memoFiles;
+            invalidFiles = memoInvalidFiles;
+            directoryOffsets = memoOffsets;
+            for (const auto& file : memoTIFFs)
+              addTIFF(file);
+            metadata = memoMetadata;
+            core = memoCore;
+            fileTable = memoFileTable;
+
+            BOOST_LOG_SEV(logger, ome::logging::trivial::debug)
+              << "Restored reader state from memo for " << (*currentId).string();
+            return true;
+          }
+        catch (const std::exception& e)
+          {
+            BOOST_LOG_SEV(logger, ome::logging::trivial::debug)
+              << "Not using memo: " << e.what();
+          }
+
+        return false;
+      }
+
+      void
+      OMETIFFReader::writeMemo()
+      {
+        if (memoDirectory.empty() ||
+            !std::dynamic_pointer_cast<ome::xml::meta::DummyMetadata>(getMetadataStore()))
+          return;
+
+        try
+          {
+            MemoWriter memo(memo_format);
+
+            memo.addSource(*currentId);
+            if (!metadataFile.empty())
+              memo.addSource(metadataFile);
+            for (const auto& file : tiffs)
+              if (file.first != *currentId)
+                memo.addSource(file.first);
+
+            memo.writeBool(hasSPW);
+            memo.writeBool(static_cast<bool>(plateIndex));
+            if (plateIndex)
+              {
+                const std::vector<PlateIndex::Entry>& entries(plateIndex->getEntries());
+                memo.write(static_cast<uint64_t>(entries.size()));
+                for (const auto& entry : entries)
+                  {
+                    memo.write(static_cast<uint64_t>(entry.location.plate));
+                    memo.write(static_cast<uint64_t>(entry.location.well));
+                    memo.write(static_cast<uint64_t>(entry.location.row));
+                    memo.write(static_cast<uint64_t>(entry.location.column));
+                    memo.write(static_cast<uint64_t>(entry.location.field));
+                    memo.write(static_cast<uint64_t>(entry.series));
+                  }
+              }
+            memo.write(metadataFile.string());
+
+            memo.write(static_cast<uint64_t>(usedFiles.size()));
+            for (const auto& file : usedFiles)
+              memo.write(file.string());
+
+            memo.write(static_cast<uint64_t>(files.size()));
+            for (const auto& file : files)
+              {
+                memo.write(file.first);
+                memo.write(file.second.string());
+              }
+
+            memo.write(static_cast<uint64_t>(invalidFiles.size()));
+            for (const auto& file : invalidFiles)
+              {
+                memo.write(file.first.string());
+                memo.write(file.second.string());
+              }
+
+            // Directory offsets are only stored for TIFFs which have
+            // been opened or whose offsets are already known; the
+            // remainder will discover their directories when opened.
+            memo.write(static_cast<uint64_t>(tiffs.size()));
+            for (const auto& file : tiffs)
+              {
+                memo.write(file.first.string());
+                std::vector<tiff::offset_type> offsets;
+                offset_map::const_iterator known = directoryOffsets.find(file.first);
+                if (file.second)
+                  {
+                    file.second->directoryCount(); // Discover all directories.
+                    offsets = file.second->getDirectoryOffsets();
+                  }
+                else if (known != directoryOffsets.end() && known->second.second)
+                  {
+                    offsets = known->second.first;
+                  }
+                memo.write(static_cast<uint64_t>(offsets.size()));
+                for (const auto& offset : offsets)
+                  memo.write(static_cast<uint64_t>(offset));
+              }
+
+            if (!writeMemoMetadata(memo, metadata))
+              {
+                BOOST_LOG_SEV(logger, ome::logging::trivial::debug)
+                  << "Not saving memo: global metadata contains non-string values";
+                return;
+              }
+
+            memo.write(static_cast<uint64_t>(core.size()));
+            for (coremetadata_list_type::size_type series = 0; series < core.size(); ++series)
+              {
+                std::shared_ptr<const OMETIFFMetadata> coreMeta(std::dynamic_pointer_cast<const OMETIFFMetadata>(core[series]));
+                if (!coreMeta)
+                  return;
+                writeMemoCore(memo, *coreMeta, seriesPlanes.at(series), fileTable);
+                if (!writeMemoMetadata(memo, coreMeta->seriesMetadata))
+                  {
+                    BOOST_LOG_SEV(logger, ome::logging::trivial::debug)
+                      << "Not saving memo: series metadata contains non-string values";
+                    return;
+                  }
+              }
+
+            fs::create_directories(memoDirectory);
+            memo.save(memoFile(memoDirectory, *currentId));
+          }
+        catch (const std::exception& e)
+          {
+            BOOST_LOG_SEV(logger, ome::logging::trivial::warning)
+              << "Failed to save memo: " << e.what();
           }
       }
 
       std::shared_ptr<::ome::xml::meta::OMEXMLMetadata>
       OMETIFFReader::readMetadata(const ome::files::tiff::TIFF& tiff)
       {
-        return createOMEXMLMetadata(getImageDescription(tiff));
+        return parseOMEXML(getImageDescription(tiff), tiff.getFilename());
       }
 
       std::shared_ptr<::ome::xml::meta::OMEXMLMetadata>
-      OMETIFFReader::readMetadata(const boost::filesystem::path& id)
+      OMETIFFReader::readMetadata(const boost::filesystem::path& id,
+                                  bool                           complete)
       {
         if (!checkSuffix(id, companion_suffixes))
           {
             addTIFF(id);
             const std::shared_ptr<const TIFF> tiff(getTIFF(id));
-            return createOMEXMLMetadata(getImageDescription(*tiff));
+            bool parsedComplete;
+            return parseImageDescription(*tiff, id, complete, false, parsedComplete);
           }
         else
           {
-            return createOMEXMLMetadata(id);
+            return parseOMEXML(readFile(id), id);
           }
       }
 
       std::shared_ptr<::ome::xml::meta::OMEXMLMetadata>
-      OMETIFFReader::cacheMetadata(const boost::filesystem::path& id) const
+      OMETIFFReader::cacheMetadata(const boost::filesystem::path& id,
+                                   bool                           complete) const
       {
         std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> meta;
         path dir(id.parent_path());
-        if(canonical(id, dir) == cachedMetadataFile && cachedMetadata)
+        if(resolveFile(id, dir) == cachedMetadataFile && cachedMetadata &&
+           (cachedMetadataComplete || !complete))
           {
             meta = cachedMetadata; // reuse cached metadata
           }
         else
           {
-            std::shared_ptr<tiff::TIFF> tiff = TIFF::open(id, "r");
+            std::shared_ptr<tiff::TIFF> tiff = TIFF::open(id, "r", sourceFactory);
 
             if (!tiff)
               {
@@ -1507,25 +2842,13 @@ namespace ome
                 throw FormatException(fmt.str());
               }
 
-            std::string omexml(getImageDescription(*tiff));
-
-            // Basic sanity check before parsing.
-            std::string::size_type lpos = omexml.find_last_not_of(" \r\n\t\f\v");
-            if (omexml.size() == 0 ||
-                omexml[0] != '<' ||
-                lpos == std::string::npos ||
-                omexml[lpos] != '>')
-              {
-                boost::format fmt("Badly formed or invalid XML document in ‘%1%’");
-                fmt % id.string();
-                throw FormatException(fmt.str());
-              }
-
-            meta = createOMEXMLMetadata(omexml);
+            bool parsedComplete = false;
+            meta = parseImageDescription(*tiff, id, complete, true, parsedComplete);
 
             // Don't overwrite state for open readers
             cachedMetadata = meta;
-            cachedMetadataFile = canonical(id, dir);
+            cachedMetadataFile = resolveFile(id, dir);
+            cachedMetadataComplete = parsedComplete;
           }
 
         return meta;
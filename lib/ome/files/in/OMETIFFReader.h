@@ -38,6 +38,14 @@
 #ifndef OME_FILES_IN_OMETIFFREADER_H
 #define OME_FILES_IN_OMETIFFREADER_H
 
+#include <functional>
+#include <list>
+#include <map>
+#include <mutex>
+
+#include <ome/files/OMEXMLIndex.h>
+#include <ome/files/PlateIndex.h>
+#include <ome/files/detail/OMETIFF.h>
 #include <ome/files/in/MinimalTIFFReader.h>
 #include <ome/files/tiff/TIFF.h>
 
@@ -102,6 +110,9 @@ namespace ome
         /// Has screen-plate-well metadata.
         bool hasSPW;
 
+        /// Index of series by plate, well and field (if hasSPW).
+        std::shared_ptr<const PlateIndex> plateIndex;
+
         /// Cached metadata (for re-using parsed metadata).
         mutable std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> cachedMetadata;
 
@@ -111,6 +122,79 @@ namespace ome
          */
         mutable boost::filesystem::path cachedMetadataFile;
 
+        /**
+         * Cached metadata is complete (or only contains the subset
+         * needed to map planes to IFDs).
+         */
+        mutable bool cachedMetadataComplete;
+
+        /// I/O source factory.
+        tiff::IOSourceFactory sourceFactory;
+
+        /// Files found to exist (or not) using the I/O source factory.
+        mutable std::map<boost::filesystem::path, bool> sourceFiles;
+
+        /// Decoded tile cache.
+        std::shared_ptr<DecodedTileCache> tileCache;
+
+        /// Memo directory (memos are not used if empty).
+        boost::filesystem::path memoDirectory;
+
+        /**
+         * Map filename to directory offsets, and whether the offsets
+         * are complete.
+         */
+        typedef std::map<boost::filesystem::path,
+                         std::pair<std::vector<ome::files::tiff::offset_type>, bool>> offset_map;
+
+        /**
+         * Directory offsets restored from a memo or saved when
+         * closing a TIFF, to set when opening each TIFF.
+         */
+        mutable offset_map directoryOffsets;
+
+        /// Maximum number of open TIFF files (0 for no limit).
+        dimension_size_type maxOpenFiles;
+
+        /// Open TIFF files, most recently used first.
+        mutable std::list<boost::filesystem::path> openFiles;
+
+        /**
+         * Lock for the open TIFF files, since TIFFs may be opened by
+         * concurrent reads.
+         */
+        mutable std::mutex tiffsMutex;
+
+        /// File index of recentTIFF.
+        mutable detail::OMETIFFFileTable::index_type recentFile;
+
+        /**
+         * The most recently used TIFF, if first in openFiles, or
+         * null.  Repeated reads from this file skip the lookup.
+         */
+        mutable std::shared_ptr<const ome::files::tiff::TIFF> recentTIFF;
+
+        /// Validate all TIFF files in the dataset during setId().
+        bool fileValidation;
+
+        /// Index of the OME-XML document, for per-Image metadata.
+        mutable std::shared_ptr<const OMEXMLIndex> metadataIndex;
+
+        /**
+         * Per-plane data for each series (by core index).
+         *
+         * This is held separately from the core metadata, so that
+         * series with identical core metadata may share a single
+         * CoreMetadata record.
+         */
+        std::vector<std::vector<detail::OMETIFFPlane>> seriesPlanes;
+
+        /// Files referenced by the planes of all series.
+        detail::OMETIFFFileTable fileTable;
+
+        /// Sorted file table indexes used by each series (by core index).
+        std::vector<std::vector<detail::OMETIFFFileTable::index_type>> seriesFiles;
+
       public:
         /// Constructor.
         OMETIFFReader();
@@ -119,6 +203,166 @@ namespace ome
         virtual
         ~OMETIFFReader();
 
+        /**
+         * Set the I/O source factory.
+         *
+         * If set, TIFF files will be read from the sources created
+         * by the factory rather than opened directly.  This must be
+         * set before calling setId().
+         *
+         * @param factory the source factory, or an empty function to
+         * open files directly.
+         */
+        void
+        setIOSourceFactory(const tiff::IOSourceFactory& factory);
+
+        /**
+         * Get the I/O source factory.
+         *
+         * @returns the source factory.
+         */
+        const tiff::IOSourceFactory&
+        getIOSourceFactory() const;
+
+        /**
+         * Set the decoded tile cache.
+         *
+         * If set, decoded tiles will be retained in and reused from
+         * this cache.  The cache may be shared between several
+         * readers, including readers of the same file.  This must be
+         * set before calling setId().
+         *
+         * @param cache the tile cache, or null to disable caching.
+         */
+        void
+        setTileCache(const std::shared_ptr<DecodedTileCache>& cache);
+
+        /**
+         * Get the decoded tile cache.
+         *
+         * @returns the tile cache, or null if not caching.
+         */
+        const std::shared_ptr<DecodedTileCache>&
+        getTileCache() const;
+
+        /**
+         * Set the memo directory.
+         *
+         * If set, the state of the initialised reader (core metadata,
+         * plane to file and IFD mapping, and TIFF directory offsets)
+         * is saved to a memo file in this directory by setId().  When
+         * the same file is opened again, the state is restored from
+         * the memo without parsing the OME-XML metadata or reading the
+         * TIFF directories, providing that none of the files in the
+         * dataset have been modified.  The directory will be created
+         * if it does not exist.
+         *
+         * Memos are only used if a metadata store has not been set
+         * with setMetadataStore(), since the memo does not contain the
+         * complete OME-XML metadata.  This must be set before calling
+         * setId().
+         *
+         * @param directory the memo directory, or an empty path to
+         * disable memos.
+         */
+        void
+        setMemoDirectory(const boost::filesystem::path& directory);
+
+        /**
+         * Get the memo directory.
+         *
+         * @returns the memo directory, or an empty path if memos are
+         * disabled.
+         */
+        const boost::filesystem::path&
+        getMemoDirectory() const;
+
+        /**
+         * Set the maximum number of open TIFF files.
+         *
+         * For datasets split across many files, only the most
+         * recently used TIFF files are kept open; the least recently
+         * used file is closed when this limit is exceeded.  The
+         * directory offsets of closed files are retained, so
+         * reopening a file does not require its directories to be
+         * discovered again.  Files in use elsewhere (e.g. by an IFD)
+         * remain open until released.
+         *
+         * @param files the maximum number of open files, or 0 for no
+         * limit.
+         */
+        void
+        setMaxOpenFiles(dimension_size_type files);
+
+        /**
+         * Get the maximum number of open TIFF files.
+         *
+         * @returns the maximum number of open files, or 0 if
+         * unlimited.
+         */
+        dimension_size_type
+        getMaxOpenFiles() const;
+
+        /**
+         * Set file validation.
+         *
+         * If enabled, every TIFF file referenced by the OME-XML
+         * metadata is opened during setId() to check that it is a
+         * valid TIFF, and planes in invalid files are treated as
+         * absent.  If disabled (the default), files other than those
+         * needed to set up the core metadata are only checked for
+         * existence, and are not opened until used.
+         *
+         * This must be set before calling setId().
+         *
+         * @param validate @c true to validate all files, or @c false
+         * to only check for existence.
+         */
+        void
+        setFileValidation(bool validate);
+
+        /**
+         * Get file validation.
+         *
+         * @returns @c true if all files are validated, or @c false if
+         * only checked for existence.
+         */
+        bool
+        getFileValidation() const;
+
+        /**
+         * Get the OME-XML metadata for a single Image.
+         *
+         * The OME-XML document is indexed on first use, and the
+         * metadata for each Image is parsed only when it is first
+         * requested (see OMEXMLIndex).  Combined with a pixels-only
+         * open (MetadataOptions::METADATA_PIXELS), this permits
+         * access to the metadata of individual Images without
+         * building the model for every Image in the document.
+         *
+         * @param image the Image index.
+         * @returns the OME-XML metadata, containing only the
+         * requested Image (at Image index 0).
+         * @throws FormatException if the OME-XML can't be read.
+         * @throws std::out_of_range if the Image index is invalid.
+         */
+        std::shared_ptr<::ome::xml::meta::OMEXMLMetadata>
+        getImageMetadata(dimension_size_type image) const;
+
+        /**
+         * Get the plate index.
+         *
+         * For screen-plate-well datasets, the index is built during
+         * setId() (or restored from a memo), and maps each plate,
+         * well and field to its series, and each series back to its
+         * plate, well and field, in constant time.
+         *
+         * @returns the plate index, or null if the dataset does not
+         * contain screen-plate-well metadata.
+         */
+        std::shared_ptr<const PlateIndex>
+        getPlateIndex() const;
+
         // Documented in superclass.
         bool
         isSingleFile(const boost::filesystem::path& id) const;
@@ -138,6 +382,10 @@ namespace ome
         getLookupTable(dimension_size_type plane,
                        VariantPixelBuffer& buf) const;
 
+        // Documented in superclass.
+        std::shared_ptr<const tiff::IFD>
+        getPlaneIFD(dimension_size_type plane) const;
+
         // Documented in superclass.
         void
         openBytesImpl(dimension_size_type plane,
@@ -147,16 +395,80 @@ namespace ome
                       dimension_size_type w,
                       dimension_size_type h) const;
 
+        // Documented in superclass.
+        std::function<void ()>
+        openBytesTask(dimension_size_type plane,
+                      VariantPixelBuffer& buf,
+                      dimension_size_type x,
+                      dimension_size_type y,
+                      dimension_size_type w,
+                      dimension_size_type h) const;
+
+        // Documented in superclass.
+        void
+        openBytesBatchImpl(const std::vector<ReadRequest>& requests) const;
+
+        // Documented in superclass.
+        void
+        prefetchImpl(dimension_size_type plane,
+                     dimension_size_type x,
+                     dimension_size_type y,
+                     dimension_size_type w,
+                     dimension_size_type h) const;
+
+        // Documented in superclass.
+        void
+        adviseAccessImpl(AccessHint          hint,
+                         dimension_size_type plane,
+                         dimension_size_type x,
+                         dimension_size_type y,
+                         dimension_size_type w,
+                         dimension_size_type h) const;
+
+        // Documented in superclass.
+        bool
+        openReducedBytesImpl(dimension_size_type plane,
+                             VariantPixelBuffer& buf,
+                             dimension_size_type x,
+                             dimension_size_type y,
+                             dimension_size_type w,
+                             dimension_size_type h,
+                             dimension_size_type scale) const;
+
+        // Documented in superclass.
+        void
+        openBytesConcurrentImpl(dimension_size_type coreIndex,
+                                dimension_size_type plane,
+                                VariantPixelBuffer& buf,
+                                dimension_size_type x,
+                                dimension_size_type y,
+                                dimension_size_type w,
+                                dimension_size_type h) const;
+
         /**
-         * Get the IFD index for a plane in the current series.
+         * Get the IFD for a plane in the current series.
          *
          * @param plane the plane index within the series.
-         * @returns the IFD index.
+         * @returns the IFD.
          * @throws FormatException if out of range.
          */
         const std::shared_ptr<const tiff::IFD>
         ifdAtIndex(dimension_size_type plane) const;
 
+        /**
+         * Get the IFD for a plane in the specified series.
+         *
+         * This does not use the reader state.
+         *
+         * @param coreIndex the core index of the series.
+         * @param plane the plane index within the series.
+         * @returns the IFD.
+         * @throws FormatException if out of range.
+         */
+        const std::shared_ptr<const tiff::IFD>
+        ifdAtCoreIndex(dimension_size_type coreIndex,
+                       dimension_size_type plane) const;
+
         /**
          * Add a TIFF file to the internal TIFF map.
          *
@@ -179,6 +491,20 @@ namespace ome
         const std::shared_ptr<const ome::files::tiff::TIFF>
         getTIFF(const boost::filesystem::path& tiff) const;
 
+        /**
+         * Get an open TIFF file by file table index.
+         *
+         * As getTIFF(const boost::filesystem::path&), but repeated
+         * calls for the most recently used file do not look up or
+         * copy the filename.
+         *
+         * @param file the index of the TIFF file in the file table.
+         * @returns the open TIFF.
+         * @throws FormatException if invalid.
+         */
+        const std::shared_ptr<const ome::files::tiff::TIFF>
+        getTIFF(detail::OMETIFFFileTable::index_type file) const;
+
         /**
          * Check if a cached TIFF is valid (can be opened).
          *
@@ -188,6 +514,47 @@ namespace ome
         bool
         validTIFF(const boost::filesystem::path& tiff) const;
 
+        /**
+         * Check if a file exists.
+         *
+         * If an I/O source factory is set, the file exists if the
+         * factory creates a source for it; the result is cached
+         * until the reader is closed.  Otherwise, or if the factory
+         * returns null, the local filesystem is checked.
+         *
+         * @param file the file to check.
+         * @returns @c true if the file exists, @c false otherwise.
+         */
+        bool
+        fileExists(const boost::filesystem::path& file) const;
+
+        /**
+         * Resolve a filename relative to a directory.
+         *
+         * If an I/O source factory is set, the file may not exist in
+         * the local filesystem, so is made absolute without being
+         * canonicalised.
+         *
+         * @param file the file to resolve.
+         * @param dir the directory relative filenames are relative to.
+         * @returns the resolved filename.
+         */
+        boost::filesystem::path
+        resolveFile(const boost::filesystem::path& file,
+                    const boost::filesystem::path& dir) const;
+
+        /**
+         * Read the content of a file.
+         *
+         * The file is read using the I/O source factory, if set.
+         *
+         * @param file the file to read.
+         * @returns the file content.
+         * @throws FormatException if the file could not be read.
+         */
+        std::string
+        readFile(const boost::filesystem::path& file) const;
+
         /**
          * Close an open TIFF file from the internal TIFF map.
          *
@@ -198,6 +565,71 @@ namespace ome
         void
         closeTIFF(const boost::filesystem::path& tiff);
 
+        /**
+         * Close the least recently used TIFF files.
+         *
+         * Files are closed until no more than the maximum number of
+         * open files remain open.  The caller must hold the TIFF
+         * lock.
+         */
+        void
+        evictTIFFs() const;
+
+        /**
+         * Open a TIFF file without caching it.
+         *
+         * The reader settings are applied to the opened TIFF.  The
+         * TIFF lock is not required.
+         *
+         * @param tiff the TIFF file to open.
+         * @param offsets the known directory offsets of the file, or
+         * null if not known.
+         * @returns the open TIFF, or null if it could not be opened.
+         */
+        std::shared_ptr<ome::files::tiff::TIFF>
+        openTIFF(const boost::filesystem::path&  tiff,
+                 const offset_map::mapped_type  *offsets) const;
+
+        /**
+         * Open TIFF files concurrently.
+         *
+         * The time to open each file is dominated by storage
+         * latency rather than CPU time, so several files are opened
+         * at once.  Files already open are reused.  Newly opened
+         * files are cached as for getTIFF(), subject to the maximum
+         * number of open files.  @p work is called concurrently for
+         * each file, with the file index and the TIFF, or null if
+         * the file could not be opened.
+         *
+         * @param files the TIFF files to open.
+         * @param work the work to run for each file.
+         * @throws the first exception thrown by @p work, once all
+         * the files have been processed.
+         */
+        void
+        forEachTIFF(const std::vector<boost::filesystem::path>&                                                   files,
+                    const std::function<void (std::size_t, const std::shared_ptr<const ome::files::tiff::TIFF>&)>& work) const;
+
+        /**
+         * Restore the reader state from a memo.
+         *
+         * @returns @c true if the state was restored, or @c false if
+         * memos are disabled, or the memo is missing, invalid or out
+         * of date.
+         */
+        bool
+        readMemo();
+
+        /**
+         * Save the reader state to a memo.
+         *
+         * Failure to save the memo is not an error; the memo will not
+         * be saved if memos are disabled, or if the state can not be
+         * represented by a memo.
+         */
+        void
+        writeMemo();
+
         /**
          * Read metadata into metadata store from an open TIFF.
          *
@@ -212,10 +644,14 @@ namespace ome
          * XML file.
          *
          * @param id the file from which to read the metadata.
+         * @param complete @c true to parse the complete metadata
+         * model, or @c false if only the TiffData subset is required
+         * (see createTiffDataMetadata()).
          * @returns the parsed metadata as a metadata store.
          */
         std::shared_ptr<::ome::xml::meta::OMEXMLMetadata>
-        readMetadata(const boost::filesystem::path& id);
+        readMetadata(const boost::filesystem::path& id,
+                     bool                           complete = true);
 
         /**
          * Read and cache metadata.
@@ -226,11 +662,19 @@ namespace ome
          * initialised.  If the metadata was previously read and
          * cached, the cached copy will be returned.
          *
+         * If @p complete is @c false, only the subset of the metadata
+         * needed to map planes to IFDs will be parsed, if possible
+         * (see createTiffDataMetadata()); a cached subset will not be
+         * reused if the complete metadata is required.
+         *
          * @param id the file from which to read the metadata.
+         * @param complete @c true to parse the complete metadata
+         * model, or @c false if only the TiffData subset is required.
          * @returns the parsed metadata as a metadata store.
          */
         std::shared_ptr<::ome::xml::meta::OMEXMLMetadata>
-        cacheMetadata(const boost::filesystem::path& id) const;
+        cacheMetadata(const boost::filesystem::path& id,
+                      bool                           complete = true) const;
 
         public:
         // Documented in superclass.
@@ -240,10 +684,6 @@ namespace ome
         const std::vector<std::string>&
         getDomains() const;
 
-        // Documented in superclass.
-        const std::vector<boost::filesystem::path>
-        getSeriesUsedFiles(bool noPixels) const;
-
         // Documented in superclass.
         FormatReader::FileGroupOption
         fileGroupOption(const std::string& id);
@@ -256,10 +696,33 @@ namespace ome
         dimension_size_type
         getOptimalTileHeight(dimension_size_type channel) const;
 
+        // Documented in superclass.
+        std::shared_ptr<detail::FormatReader>
+        newClone() const;
+
+        // Documented in superclass.
+        void
+        copyState(const detail::FormatReader& source);
+
         // Documented in superclass.
         void
         initFile(const boost::filesystem::path& id);
 
+        /**
+         * Fill the metadata store after a pixels-only open.
+         *
+         * The metadata store is filled as the TiffData elements are
+         * processed, so the file is initialised again with the real
+         * metadata store, parsing the complete OME-XML metadata.
+         */
+        void
+        fillMetadataStore();
+
+      protected:
+        // Documented in superclass.
+        std::vector<boost::filesystem::path>
+        findSeriesUsedFiles(bool noPixels) const;
+
       private:
         /**
          * Get UUID to file associations and used files.
@@ -300,6 +763,21 @@ namespace ome
         void
         cleanMetadata(ome::xml::meta::OMEXMLMetadata& meta);
 
+        /**
+         * Share identical core metadata between series.
+         *
+         * Moves the per-plane data of each series into @c
+         * seriesPlanes, records the files used by each series in @c
+         * seriesFiles, and then replaces the core metadata of each
+         * series with that of an earlier series, where identical.
+         * For large screens, where every field has the same
+         * geometry, this reduces the core metadata to a single
+         * record.  The core metadata must not be modified after this
+         * is called.
+         */
+        void
+        shareCoreMetadata();
+
         /**
          * Get the samples per pixel from the first IFD for a series.
          *
@@ -35,6 +35,7 @@
  * #L%
  */
 
+#include <boost/format.hpp>
 #include <boost/range/size.hpp>
 
 #include <ome/files/FormatException.h>
@@ -64,6 +65,7 @@ namespace ome
         {
           ReaderProperties p("TIFF", "Tagged Image File Format");
           p.suffixes = {"tif", "tiff", "tf2", "tf8", "btf"};
+          p.metadata_levels.insert(MetadataOptions::METADATA_PIXELS);
           p.metadata_levels.insert(MetadataOptions::METADATA_MINIMUM);
           p.metadata_levels.insert(MetadataOptions::METADATA_NO_OVERLAYS);
           p.metadata_levels.insert(MetadataOptions::METADATA_ALL);
@@ -78,7 +80,9 @@ namespace ome
       }
 
       TIFFReader::TIFFReader():
-        MinimalTIFFReader(props)
+        MinimalTIFFReader(props),
+        ijmeta(),
+        contiguousStack(false)
       {
       }
 
@@ -97,10 +101,27 @@ namespace ome
       TIFFReader::close(bool fileOnly)
       {
         ijmeta = boost::none;
+        contiguousStack = false;
 
         MinimalTIFFReader::close(fileOnly);
       }
 
+      std::shared_ptr<::ome::files::detail::FormatReader>
+      TIFFReader::newClone() const
+      {
+        return std::make_shared<TIFFReader>();
+      }
+
+      void
+      TIFFReader::copyState(const ::ome::files::detail::FormatReader& source)
+      {
+        MinimalTIFFReader::copyState(source);
+
+        const TIFFReader& reader(dynamic_cast<const TIFFReader&>(source));
+        ijmeta = reader.ijmeta;
+        contiguousStack = reader.contiguousStack;
+      }
+
       void
       TIFFReader::readIFDs()
       {
@@ -109,59 +130,83 @@ namespace ome
         if (ifd0)
           {
             bool imagej_metadata = true;
+            bool contiguous = false;
 
             try
               {
-                tiff::ImageJMetadata ijmeta(*ifd0);
-
-                std::shared_ptr<CoreMetadata> ijm(tiff::makeCoreMetadata(*ifd0));
-
-                ijm->sizeZ = ijmeta.slices;
-                ijm->sizeT = ijmeta.frames;
-                ijm->sizeC.clear();
-                for (dimension_size_type c = 0; c < ijmeta.channels; ++c)
-                  ijm->sizeC.push_back(1U);
-
-                core.clear();
-                core.push_back(ijm);
+                tiff::ImageJMetadata meta(*ifd0);
 
                 dimension_size_type images = 0;
                 for (TIFF::const_iterator i = tiff->begin();
                      i != tiff->end();
                      ++i, ++images)
                   {
-                    if (imagej_metadata)
+                    // Verify metadata is consistent
+
+                    std::string desc;
+                    (*i)->getField(ome::files::tiff::IMAGEDESCRIPTION).get(desc);
+                    std::map<std::string,std::string> imap(tiff::ImageJMetadata::parse_imagedescription(desc));
+
+                    if (imap != meta.map)
                       {
-                        // Verify metadata is consistent
-
-                        std::string desc;
-                        (*i)->getField(ome::files::tiff::IMAGEDESCRIPTION).get(desc);
-                        std::map<std::string,std::string> imap(tiff::ImageJMetadata::parse_imagedescription(desc));
-
-                        if (imap != ijmeta.map)
-                          {
-                            std::cerr << "ImageJ TIFF metadata is inconsistent; treating as a plain TIFF";
-                            imagej_metadata = false;
-                            break;
-                          }
+                        std::cerr << "ImageJ TIFF metadata is inconsistent; treating as a plain TIFF";
+                        imagej_metadata = false;
+                        break;
                       }
                   }
 
-                if (images != ijmeta.images)
+                if (imagej_metadata && images != meta.images)
                   {
-                    std::cerr << "ImageJ TIFF metadata is inconsistent with TIFF image count; treating as a plain TIFF";
-                    imagej_metadata = false;
+                    // Stacks over 4 GiB have a single IFD, with the
+                    // remaining planes following the first.
+                    if (meta.isContiguousStack(*ifd0, images))
+                      contiguous = true;
+                    else
+                      {
+                        std::cerr << "ImageJ TIFF metadata is inconsistent with TIFF image count; treating as a plain TIFF";
+                        imagej_metadata = false;
+                      }
+                  }
+
+                if (imagej_metadata)
+                  {
+                    std::shared_ptr<CoreMetadata> ijm(tiff::makeCoreMetadata(*ifd0));
+
+                    if (meta.channels * meta.slices * meta.frames == meta.images)
+                      {
+                        ijm->sizeZ = meta.slices;
+                        ijm->sizeT = meta.frames;
+                        ijm->sizeC.assign(meta.channels, ifd0->getSamplesPerPixel());
+                      }
+                    else
+                      {
+                        // Dimensions not specified; treat as a Z stack.
+                        ijm->sizeZ = meta.images;
+                        ijm->sizeT = 1U;
+                      }
+                    ijm->imageCount = meta.images;
+
+                    core.clear();
+                    core.push_back(ijm);
+
+                    tiff::IFDRange range;
+                    range.filename = *currentId;
+                    range.begin = 0U;
+                    range.end = contiguous ? 1U : images;
+
+                    seriesIFDRange.clear();
+                    seriesIFDRange.push_back(range);
+
+                    ijmeta = meta;
+                    contiguousStack = contiguous;
                   }
               }
             catch (const std::exception& e)
               {
                 // Catch all TIFF exceptions and parse failures.
-                imagej_metadata = false;
                 core.clear();
+                seriesIFDRange.clear();
               }
-
-            if (imagej_metadata)
-              this->ijmeta = ijmeta;
           }
 
         // If a plain TIFF, read metadata from IFDs.
@@ -169,6 +214,132 @@ namespace ome
           MinimalTIFFReader::readIFDs();
       }
 
+      const std::shared_ptr<const tiff::IFD>
+      TIFFReader::ifdAtCoreIndex(dimension_size_type coreIndex,
+                                 dimension_size_type plane) const
+      {
+        if (!contiguousStack)
+          return MinimalTIFFReader::ifdAtCoreIndex(coreIndex, plane);
+
+        // All planes share the layout of the first IFD.
+        if (plane >= getCoreMetadata(coreIndex).imageCount)
+          {
+            boost::format fmt("Invalid plane number ‘%1%’ for series ‘%2%’");
+            fmt % plane % coreIndex;
+            throw FormatException(fmt.str());
+          }
+
+        return MinimalTIFFReader::ifdAtCoreIndex(coreIndex, 0U);
+      }
+
+      std::shared_ptr<const tiff::IFD>
+      TIFFReader::getPlaneIFD(dimension_size_type plane) const
+      {
+        assertId(currentId, true);
+
+        if (plane >= getImageCount())
+          {
+            boost::format fmt("Invalid plane: %1%");
+            fmt % plane;
+            throw std::logic_error(fmt.str());
+          }
+
+        // Only the first plane of a contiguous stack has an IFD.
+        if (contiguousStack)
+          return std::shared_ptr<const tiff::IFD>();
+
+        return ifdAtIndex(plane);
+      }
+
+      void
+      TIFFReader::openBytesImpl(dimension_size_type plane,
+                                VariantPixelBuffer& buf,
+                                dimension_size_type x,
+                                dimension_size_type y,
+                                dimension_size_type w,
+                                dimension_size_type h) const
+      {
+        if (!contiguousStack)
+          {
+            MinimalTIFFReader::openBytesImpl(plane, buf, x, y, w, h);
+            return;
+          }
+
+        assertId(currentId, true);
+
+        ifdAtIndex(plane)->readContiguousPlane(buf, plane, x, y, w, h);
+      }
+
+      std::function<void ()>
+      TIFFReader::openBytesTask(dimension_size_type plane,
+                                VariantPixelBuffer& buf,
+                                dimension_size_type x,
+                                dimension_size_type y,
+                                dimension_size_type w,
+                                dimension_size_type h) const
+      {
+        if (!contiguousStack)
+          return MinimalTIFFReader::openBytesTask(plane, buf, x, y, w, h);
+
+        std::shared_ptr<const IFD> ifd(ifdAtIndex(plane));
+        VariantPixelBuffer *dest = &buf;
+
+        return [ifd, dest, plane, x, y, w, h]()
+          {
+            ifd->readContiguousPlane(*dest, plane, x, y, w, h);
+          };
+      }
+
+      void
+      TIFFReader::openBytesBatchImpl(const std::vector<ReadRequest>& requests) const
+      {
+        if (!contiguousStack)
+          {
+            MinimalTIFFReader::openBytesBatchImpl(requests);
+            return;
+          }
+
+        assertId(currentId, true);
+
+        // Planes are read directly, so there are no shared tiles to
+        // decode once; read in request order.
+        for (const auto& request : requests)
+          ifdAtIndex(request.plane)->readContiguousPlane(*request.buf, request.plane,
+                                                         request.region.x, request.region.y,
+                                                         request.region.w, request.region.h);
+      }
+
+      void
+      TIFFReader::openBytesConcurrentImpl(dimension_size_type coreIndex,
+                                          dimension_size_type plane,
+                                          VariantPixelBuffer& buf,
+                                          dimension_size_type x,
+                                          dimension_size_type y,
+                                          dimension_size_type w,
+                                          dimension_size_type h) const
+      {
+        if (!contiguousStack)
+          {
+            MinimalTIFFReader::openBytesConcurrentImpl(coreIndex, plane, buf, x, y, w, h);
+            return;
+          }
+
+        ifdAtCoreIndex(coreIndex, plane)->readContiguousPlane(buf, plane, x, y, w, h);
+      }
+
+      void
+      TIFFReader::prefetchImpl(dimension_size_type plane,
+                               dimension_size_type x,
+                               dimension_size_type y,
+                               dimension_size_type w,
+                               dimension_size_type h) const
+      {
+        // Contiguous planes are not decoded, so there is nothing to
+        // cache.
+        if (!contiguousStack)
+          MinimalTIFFReader::prefetchImpl(plane, x, y, w, h);
+      }
+
     }
   }
 }
@@ -56,6 +56,8 @@ namespace ome
       protected:
         /// ImageJ metadata.
         boost::optional<tiff::ImageJMetadata> ijmeta;
+        /// ImageJ planes are stored contiguously after the first IFD.
+        bool contiguousStack;
 
       public:
         /// Constructor.
@@ -66,14 +68,72 @@ namespace ome
         ~TIFFReader();
 
       protected:
+        // Documented in superclass.
+        std::shared_ptr<::ome::files::detail::FormatReader>
+        newClone() const;
+
+        // Documented in superclass.
+        void
+        copyState(const ::ome::files::detail::FormatReader& source);
+
         // Documented in superclass.
         void
         readIFDs();
 
+        // Documented in superclass.
+        const std::shared_ptr<const tiff::IFD>
+        ifdAtCoreIndex(dimension_size_type coreIndex,
+                       dimension_size_type plane) const;
+
       public:
         // Documented in superclass.
         void
         close(bool fileOnly = false);
+
+        // Documented in superclass.
+        std::shared_ptr<const tiff::IFD>
+        getPlaneIFD(dimension_size_type plane) const;
+
+      protected:
+        // Documented in superclass.
+        void
+        openBytesImpl(dimension_size_type plane,
+                      VariantPixelBuffer& buf,
+                      dimension_size_type x,
+                      dimension_size_type y,
+                      dimension_size_type w,
+                      dimension_size_type h) const;
+
+        // Documented in superclass.
+        std::function<void ()>
+        openBytesTask(dimension_size_type plane,
+                      VariantPixelBuffer& buf,
+                      dimension_size_type x,
+                      dimension_size_type y,
+                      dimension_size_type w,
+                      dimension_size_type h) const;
+
+        // Documented in superclass.
+        void
+        openBytesBatchImpl(const std::vector<ReadRequest>& requests) const;
+
+        // Documented in superclass.
+        void
+        openBytesConcurrentImpl(dimension_size_type coreIndex,
+                                dimension_size_type plane,
+                                VariantPixelBuffer& buf,
+                                dimension_size_type x,
+                                dimension_size_type y,
+                                dimension_size_type w,
+                                dimension_size_type h) const;
+
+        // Documented in superclass.
+        void
+        prefetchImpl(dimension_size_type plane,
+                     dimension_size_type x,
+                     dimension_size_type y,
+                     dimension_size_type w,
+                     dimension_size_type h) const;
       };
 
     }
@@ -41,9 +41,12 @@
 #include <boost/range/size.hpp>
 
 #include <ome/files/FormatException.h>
+#include <ome/files/FormatReader.h>
 #include <ome/files/FormatTools.h>
 #include <ome/files/MetadataTools.h>
+#include <ome/files/PixelStatistics.h>
 #include <ome/files/out/MinimalTIFFWriter.h>
+#include <ome/files/tiff/BitPack.h>
 #include <ome/files/tiff/Codec.h>
 #include <ome/files/tiff/IFD.h>
 #include <ome/files/tiff/TIFF.h>
@@ -146,6 +149,15 @@ namespace ome
 
 
         tiff = TIFF::open(id, flags);
+        tiff->setEncodeThreads(getEncodeThreads());
+        tiff->setExecutor(getExecutor());
+        tiff->setSparseTiles(getSparseTiles());
+        tiff->setRecordTileStatistics(getRecordTileStatistics());
+        tiff->setRecordTileChecksums(getRecordTileChecksums());
+        tiff->setStatistics(getStatistics());
+        tiff->setWriteCacheLimit(getWriteCacheLimit());
+        tiff->setWriteCacheDirectory(getWriteCacheDirectory());
+        tiff->setMemoryBudget(getMemoryBudget());
         ifd = tiff->getCurrentDirectory();
         setupIFD();
 
@@ -304,6 +316,24 @@ namespace ome
                 ifd->setTileHeight(1U);
               }
           }
+        else if(this->accessProfile)
+          {
+            // Choose the geometry for the expected access pattern.
+            dimension_size_type channel = getZCTCoords(getPlane())[1];
+            const boost::optional<bool> interleaved(getInterleaved());
+            const boost::optional<std::string> compression(getCompression());
+            tiff::TileGeometry geometry
+              (tiff::chooseTileGeometry(*this->accessProfile,
+                                        static_cast<uint32_t>(getSizeX()),
+                                        static_cast<uint32_t>(getSizeY()),
+                                        getPixelType(),
+                                        static_cast<uint16_t>(getRGBChannelCount(channel)),
+                                        interleaved && *interleaved ? tiff::CONTIG : tiff::SEPARATE,
+                                        compression ? tiff::getCodecScheme(*compression) : tiff::COMPRESSION_NONE));
+            ifd->setTileType(geometry.type);
+            ifd->setTileWidth(geometry.width);
+            ifd->setTileHeight(geometry.height);
+          }
         else if(getSizeX() < 2048)
           {
             // Default to strips, mainly for compatibility with
@@ -328,7 +358,20 @@ namespace ome
         dimension_size_type channel = coords[1];
 
         ifd->setPixelType(getPixelType());
-        ifd->setBitsPerSample(bitsPerPixel(getPixelType()));
+        // Packing depends upon the significant bits, which are
+        // optional.
+        pixel_size_type significant = 0U;
+        if (getPackSamples())
+          {
+            try
+              {
+                significant = getBitsPerPixel();
+              }
+            catch (const std::exception&)
+              {
+              }
+          }
+        ifd->setBitsPerSample(tiff::storedBitsPerSample(getPixelType(), significant, getPackSamples()));
         ifd->setSamplesPerPixel(getRGBChannelCount(channel));
 
         const boost::optional<bool> interleaved(getInterleaved());
@@ -348,6 +391,28 @@ namespace ome
         const boost::optional<std::string> compression(getCompression());
         if(compression)
           ifd->setCompression(tiff::getCodecScheme(*compression));
+
+        const boost::optional<int> level(getCompressionLevel());
+        if(level)
+          ifd->setCompressionLevel(*level);
+
+        // Subsample JPEG-compressed RGB as YCbCr.
+        tiff::setupJPEGYCbCr(*ifd);
+
+        const boost::optional<bool> predictor(getPredictor());
+        if(predictor && *predictor)
+          {
+            tiff::Predictor pixelpredictor(tiff::getPixelTypePredictor(getPixelType()));
+            if (pixelpredictor == tiff::NONE)
+              {
+                boost::format fmt("Pixel type %1% does not support a predictor");
+                fmt % getPixelType();
+                throw FormatException(fmt.str());
+              }
+            if (tiff::isPackedSampleDepth(ifd->getBitsPerSample()))
+              throw FormatException("Packed samples may not use a predictor");
+            ifd->setPredictor(pixelpredictor);
+          }
       }
 
       void
@@ -372,7 +437,41 @@ namespace ome
             throw FormatException(fmt.str());
           }
 
-        ifd->writeImage(buf, x, y, w, h);
+        std::shared_ptr<PixelStatistics> stats(planePixelStatistics(plane));
+        if (stats)
+          ifd->writeImage(buf, x, y, w, h, *stats);
+        else
+          ifd->writeImage(buf, x, y, w, h);
+      }
+
+      bool
+      MinimalTIFFWriter::copyBytes(dimension_size_type plane,
+                                   const ::ome::files::FormatReader& reader,
+                                   dimension_size_type sourcePlane)
+      {
+        assertId(currentId, true);
+
+        std::shared_ptr<const tiff::IFD> source(reader.getPlaneIFD(sourcePlane));
+
+        setPlane(plane);
+
+        // Pixel statistics require the pixel data to be decoded.
+        if (!source || pixelStatisticsEnabled || recordTileStatistics ||
+            !ifd->canCopyRawTiles(*source))
+          return detail::FormatWriter::copyBytes(plane, reader, sourcePlane);
+
+        dimension_size_type expectedIndex =
+          tiff::ifdIndex(seriesIFDRange, getSeries(), plane);
+
+        if (ifdIndex != expectedIndex)
+          {
+            boost::format fmt("IFD index mismatch: actual is %1% but %2% expected");
+            fmt % ifdIndex % expectedIndex;
+            throw FormatException(fmt.str());
+          }
+
+        ifd->copyRawTiles(*source);
+        return true;
       }
 
       void
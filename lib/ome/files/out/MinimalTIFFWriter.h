@@ -149,6 +149,12 @@ namespace ome
                   dimension_size_type w,
                   dimension_size_type h);
 
+        // Documented in superclass.
+        bool
+        copyBytes(dimension_size_type plane,
+                  const ::ome::files::FormatReader& reader,
+                  dimension_size_type sourcePlane);
+
         /**
          * Set use of BigTIFF support.
          *
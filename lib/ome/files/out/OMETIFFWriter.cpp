@@ -35,8 +35,20 @@
  * #L%
  */
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
-
+#include <cctype>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include <boost/filesystem/fstream.hpp>
 #include <boost/filesystem/path.hpp>
 #include <boost/filesystem/operations.hpp>
 #include <boost/format.hpp>
@@ -47,13 +59,26 @@
 #include <boost/uuid/uuid_io.hpp>
 #include <boost/uuid/uuid_generators.hpp>
 
+#include <ome/files/config-internal.h>
+#include <ome/files/Downsample.h>
+#include <ome/files/Executor.h>
 #include <ome/files/FormatException.h>
+#include <ome/files/FormatReader.h>
 #include <ome/files/FormatTools.h>
+#include <ome/files/MemoryBudget.h>
 #include <ome/files/MetadataTools.h>
+#include <ome/files/OMEXMLStream.h>
+#include <ome/files/PixelStatistics.h>
+#include <ome/files/TileBuffer.h>
+#include <ome/files/TraceObserver.h>
+#include <ome/files/VariantPixelBuffer.h>
 #include <ome/files/out/OMETIFFWriter.h>
+#include <ome/files/tiff/BitPack.h>
 #include <ome/files/tiff/Codec.h>
+#include <ome/files/tiff/DirectoryLayout.h>
 #include <ome/files/tiff/Field.h>
 #include <ome/files/tiff/IFD.h>
+#include <ome/files/tiff/ImageLayout.h>
 #include <ome/files/tiff/Tags.h>
 #include <ome/files/tiff/TIFF.h>
 #include <ome/files/tiff/Util.h>
@@ -65,6 +90,11 @@
 
 #include <tiffio.h>
 
+#ifdef OME_HAVE_O_DIRECT
+# include <fcntl.h>
+# include <unistd.h>
+#endif // OME_HAVE_O_DIRECT
+
 using boost::filesystem::path;
 
 using ome::files::getOMEXML;
@@ -121,6 +151,78 @@ namespace ome
 
         const std::string default_description("OME-TIFF");
 
+        // Get the companion file name for a TIFF file, replacing
+        // the OME-TIFF suffix.
+        path
+        companionFile(const path& id)
+        {
+          std::string name(id.filename().string());
+          for (const auto& suffix : props.suffixes)
+            {
+              std::string ext("." + suffix.string());
+              if (name.size() > ext.size() &&
+                  name.compare(name.size() - ext.size(), ext.size(), ext) == 0)
+                {
+                  name.erase(name.size() - ext.size());
+                  break;
+                }
+            }
+          return id.parent_path() / (name + "." + companion_suffixes.front().string());
+        }
+
+        // Find the root UUID attribute value of serialized OME-XML.
+        // Returns the offset of the UUID, or npos if not found.
+        std::string::size_type
+        findRootUUID(const std::string& xml,
+                     const std::string& uuid)
+        {
+          const std::string prefix("UUID=\"urn:uuid:");
+          std::string::size_type pos = xml.find(prefix + uuid + "\"");
+          return pos == std::string::npos ? pos : pos + prefix.size();
+        }
+
+        /**
+         * Maximum number of files finalised concurrently on close.
+         * Finalisation is dominated by I/O rather than CPU time, so
+         * this is independent of the number of encoding threads.
+         */
+        const std::size_t max_finalise_threads = 8U;
+
+        // Run tasks on up to the specified number of workers of an
+        // executor.  The first exception thrown by any task is
+        // rethrown once all workers have finished.
+        void
+        runTasks(const std::shared_ptr<Executor>&            executor,
+                 const std::vector<std::function<void()>>& tasks,
+                 std::size_t                               threads)
+        {
+          threads = std::max(std::min(threads, tasks.size()), static_cast<std::size_t>(1U));
+
+          std::atomic<std::size_t> next(0U);
+          std::mutex errormutex;
+          std::exception_ptr error;
+          runParallel(executor, threads,
+                      [&](dimension_size_type, dimension_size_type)
+                      {
+                        for (std::size_t i = next++; i < tasks.size(); i = next++)
+                          {
+                            try
+                              {
+                                tasks[i]();
+                              }
+                            catch (...)
+                              {
+                                std::lock_guard<std::mutex> lock(errormutex);
+                                if (!error)
+                                  error = std::current_exception();
+                              }
+                          }
+                      });
+
+          if (error)
+            std::rethrow_exception(error);
+        }
+
         /**
          * @todo Move these stream helpers to a proper location,
          * i.e. to replicate the equivalent Java helpers.
@@ -403,10 +505,648 @@ namespace ome
 
       }
 
+      /**
+       * Sub-resolution pyramid for a single plane.
+       *
+       * Regions of the full-resolution plane are queued as they are
+       * saved, and downsampled into the first sub-resolution by a
+       * background thread.  Once the plane is complete, each further
+       * sub-resolution is downsampled from the previous one.
+       */
+      class OMETIFFWriter::Pyramid
+      {
+      public:
+        /// Pyramid levels, in descending order of size.
+        typedef std::vector<std::shared_ptr<VariantPixelBuffer>> level_list;
+
+        /**
+         * Constructor.
+         *
+         * @param count the number of sub-resolutions.
+         * @param sizeX the full-resolution image width.
+         * @param sizeY the full-resolution image height.
+         * @param samples the number of samples per pixel.
+         * @param pixeltype the pixel type.
+         * @param order the storage order of the sub-resolutions.
+         * @param allocator the allocator for the sub-resolutions and
+         * queued regions, or null for the default.
+         */
+        Pyramid(dimension_size_type                         count,
+                dimension_size_type                         sizeX,
+                dimension_size_type                         sizeY,
+                dimension_size_type                         samples,
+                PixelType                                   pixeltype,
+                const PixelBufferBase::storage_order_type& order,
+                const std::shared_ptr<PixelAllocator>&     allocator):
+          allocator(allocator),
+          levels(),
+          pending(),
+          mutex(),
+          cond(),
+          done(false),
+          error(),
+          worker()
+        {
+          std::array<VariantPixelBuffer::size_type, 9> shape;
+          shape[DIM_SUBCHANNEL] = samples;
+          shape[DIM_SPATIAL_Z] = shape[DIM_TEMPORAL_T] = shape[DIM_CHANNEL] =
+            shape[DIM_MODULO_Z] = shape[DIM_MODULO_T] = shape[DIM_MODULO_C] = 1;
+
+          for (dimension_size_type i = 0; i < count; ++i)
+            {
+              sizeX = downsampledSize(sizeX);
+              sizeY = downsampledSize(sizeY);
+              shape[DIM_SPATIAL_X] = sizeX;
+              shape[DIM_SPATIAL_Y] = sizeY;
+              levels.push_back(std::make_shared<VariantPixelBuffer>(allocator, shape, pixeltype, order));
+            }
+
+          worker = std::thread(&Pyramid::run, this);
+        }
+
+        /// Destructor.
+        ~Pyramid()
+        {
+          {
+            std::lock_guard<std::mutex> lock(mutex);
+            done = true;
+          }
+          cond.notify_all();
+          if (worker.joinable())
+            worker.join();
+        }
+
+        /**
+         * Queue a full-resolution region for downsampling.
+         *
+         * The region is copied, so the caller may reuse the buffer.
+         * If too many regions are pending, this blocks until the
+         * background thread has caught up.
+         *
+         * @param buf the region pixel data.
+         * @param x the @c X coordinate of the upper-left corner of the region.
+         * @param y the @c Y coordinate of the upper-left corner of the region.
+         */
+        void
+        add(const VariantPixelBuffer& buf,
+            dimension_size_type       x,
+            dimension_size_type       y)
+        {
+          std::array<VariantPixelBuffer::size_type, 9> shape;
+          std::copy(buf.shape(), buf.shape() + PixelBufferBase::dimensions,
+                    shape.begin());
+          std::shared_ptr<VariantPixelBuffer> copy
+            (std::make_shared<VariantPixelBuffer>(allocator, shape, buf.pixelType(), buf.storage_order(),
+                                                  PIXEL_UNINITIALIZED));
+          *copy = buf;
+
+          {
+            std::unique_lock<std::mutex> lock(mutex);
+            cond.wait(lock, [this]{ return error || pending.size() < max_pending; });
+            if (error)
+              std::rethrow_exception(error);
+            pending.push_back(Region{copy, x, y});
+          }
+          cond.notify_all();
+        }
+
+        /**
+         * Complete downsampling.
+         *
+         * Waits for all pending regions to be downsampled, and for
+         * the remaining sub-resolutions to be generated.
+         *
+         * @returns the sub-resolutions.
+         */
+        const level_list&
+        finish()
+        {
+          {
+            std::lock_guard<std::mutex> lock(mutex);
+            done = true;
+          }
+          cond.notify_all();
+          if (worker.joinable())
+            worker.join();
+          if (error)
+            std::rethrow_exception(error);
+          return levels;
+        }
+
+      private:
+        /// A queued full-resolution region.
+        struct Region
+        {
+          /// Region pixel data.
+          std::shared_ptr<VariantPixelBuffer> buf;
+          /// @c X coordinate of the region.
+          dimension_size_type x;
+          /// @c Y coordinate of the region.
+          dimension_size_type y;
+        };
+
+        /// Maximum number of regions pending downsampling.
+        static const std::deque<Region>::size_type max_pending = 8U;
+
+        /// Background downsampling thread.
+        void
+        run()
+        {
+          try
+            {
+              while (true)
+                {
+                  Region region;
+                  {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    cond.wait(lock, [this]{ return done || !pending.empty(); });
+                    if (pending.empty())
+                      break;
+                    region = pending.front();
+                    pending.pop_front();
+                  }
+                  cond.notify_all();
+
+                  downsample(*region.buf, region.x, region.y, *levels.front());
+                }
+
+              for (level_list::size_type i = 1; i < levels.size(); ++i)
+                downsample(*levels[i - 1], 0, 0, *levels[i]);
+            }
+          catch (...)
+            {
+              std::lock_guard<std::mutex> lock(mutex);
+              error = std::current_exception();
+              pending.clear();
+            }
+          cond.notify_all();
+        }
+
+        /// Allocator for pixel data.
+        std::shared_ptr<PixelAllocator> allocator;
+        /// Sub-resolutions.
+        level_list levels;
+        /// Regions pending downsampling.
+        std::deque<Region> pending;
+        /// Lock for pending, done and error.
+        std::mutex mutex;
+        /// Signalled when pending, done or error change.
+        std::condition_variable cond;
+        /// No further regions will be added.
+        bool done;
+        /// Error from the background thread.
+        std::exception_ptr error;
+        /// Background thread.
+        std::thread worker;
+      };
+
+      /**
+       * Staging queue for asynchronous writes.
+       *
+       * Saved regions are queued, and written by a background thread
+       * in the order they were saved, using the synchronous
+       * saveBytes() of the writer.  Buffers copied into the queue
+       * are kept for reuse once written.
+       */
+      class OMETIFFWriter::AsyncWriter
+      {
+      public:
+        /**
+         * Constructor.
+         *
+         * @param writer the writer to save the staged regions.
+         * @param size the maximum number of regions pending writing.
+         * @param allocator the allocator for staging buffers, or null
+         * for the default.
+         */
+        AsyncWriter(OMETIFFWriter&                          writer,
+                    dimension_size_type                     size,
+                    const std::shared_ptr<PixelAllocator>& allocator):
+          writer(writer),
+          size(size),
+          allocator(allocator),
+          pending(),
+          spare(),
+          planeCount(0U),
+          sizeX(0U),
+          sizeY(0U),
+          mutex(),
+          cond(),
+          busy(false),
+          done(false),
+          error(),
+          worker()
+        {
+          worker = std::thread(&AsyncWriter::run, this);
+        }
+
+        /// Destructor.
+        ~AsyncWriter()
+        {
+          finish();
+        }
+
+        /**
+         * Check if called from the background thread.
+         *
+         * @returns @c true if called from the background thread.
+         */
+        bool
+        onWorker() const
+        {
+          return std::this_thread::get_id() == worker.get_id();
+        }
+
+        /**
+         * Set the series of the regions to queue.
+         *
+         * The plane count and image size of the series are kept, so
+         * that regions are checked without reading the writer state,
+         * which the background thread may change on rollover.  This
+         * must be called while no regions are queued.
+         *
+         * @param series the current series.
+         */
+        void
+        stage(dimension_size_type series)
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          planeCount = writer.seriesState.at(series).planes.size();
+          sizeX = writer.metadataRetrieve->getPixelsSizeX(series);
+          sizeY = writer.metadataRetrieve->getPixelsSizeY(series);
+        }
+
+        /**
+         * Get the image size of the series of the regions to queue.
+         *
+         * @returns the image width and height.
+         */
+        std::pair<dimension_size_type, dimension_size_type>
+        imageSize()
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          return std::make_pair(sizeX, sizeY);
+        }
+
+        /**
+         * Queue a copy of a region for writing.
+         *
+         * The region is copied, so the caller may reuse the buffer.
+         *
+         * @param plane the plane index within the current series.
+         * @param buf the region pixel data.
+         * @param x the @c X coordinate of the upper-left corner of the region.
+         * @param y the @c Y coordinate of the upper-left corner of the region.
+         * @param w the width of the region.
+         * @param h the height of the region.
+         */
+        void
+        add(dimension_size_type       plane,
+            const VariantPixelBuffer& buf,
+            dimension_size_type       x,
+            dimension_size_type       y,
+            dimension_size_type       w,
+            dimension_size_type       h)
+        {
+          checkPlane(plane);
+
+          std::shared_ptr<VariantPixelBuffer> copy;
+          {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (error)
+              std::rethrow_exception(error);
+            for (auto i = spare.begin(); i != spare.end(); ++i)
+              {
+                if (std::equal(buf.shape(), buf.shape() + PixelBufferBase::dimensions, (*i)->shape()) &&
+                    buf.pixelType() == (*i)->pixelType() &&
+                    buf.storage_order() == (*i)->storage_order())
+                  {
+                    copy = *i;
+                    spare.erase(i);
+                    break;
+                  }
+              }
+          }
+
+          if (!copy)
+            {
+              std::array<VariantPixelBuffer::size_type, 9> shape;
+              std::copy(buf.shape(), buf.shape() + PixelBufferBase::dimensions,
+                        shape.begin());
+              copy = std::make_shared<VariantPixelBuffer>(allocator, shape, buf.pixelType(), buf.storage_order(),
+                                                          PIXEL_UNINITIALIZED);
+            }
+          *copy = buf;
+
+          push(Frame{plane, copy, x, y, w, h, true});
+        }
+
+        /**
+         * Queue a region for writing, adopting its buffer.
+         *
+         * Only buffers owning their storage are adopted; a buffer
+         * over external storage, such as a camera ring buffer, is
+         * copied, since the caller may reuse the storage.
+         *
+         * @param plane the plane index within the current series.
+         * @param buf the region pixel data.
+         * @param x the @c X coordinate of the upper-left corner of the region.
+         * @param y the @c Y coordinate of the upper-left corner of the region.
+         * @param w the width of the region.
+         * @param h the height of the region.
+         */
+        void
+        adopt(dimension_size_type   plane,
+              VariantPixelBuffer&& buf,
+              dimension_size_type   x,
+              dimension_size_type   y,
+              dimension_size_type   w,
+              dimension_size_type   h)
+        {
+          if (!buf.managed())
+            {
+              add(plane, buf, x, y, w, h);
+              return;
+            }
+
+          checkPlane(plane);
+
+          // The adopted buffer may share memory with the caller, so
+          // it is not reused.
+          push(Frame{plane, std::make_shared<VariantPixelBuffer>(std::move(buf)), x, y, w, h, false});
+        }
+
+        /**
+         * Wait for all queued regions to be written.
+         *
+         * This does nothing if called from the background thread,
+         * for example when the writer changes file on rollover.
+         */
+        void
+        flush()
+        {
+          if (onWorker())
+            return;
+
+          std::unique_lock<std::mutex> lock(mutex);
+          cond.wait(lock, [this]{ return error || (pending.empty() && !busy); });
+          if (error)
+            std::rethrow_exception(error);
+        }
+
+        /**
+         * Write all queued regions and stop the background thread.
+         *
+         * @returns the first error raised while writing, if any.
+         */
+        std::exception_ptr
+        finish()
+        {
+          {
+            std::lock_guard<std::mutex> lock(mutex);
+            done = true;
+          }
+          cond.notify_all();
+          if (worker.joinable())
+            worker.join();
+          return error;
+        }
+
+      private:
+        /// A queued region.
+        struct Frame
+        {
+          /// Plane index within the current series.
+          dimension_size_type plane;
+          /// Region pixel data.
+          std::shared_ptr<VariantPixelBuffer> buf;
+          /// @c X coordinate of the region.
+          dimension_size_type x;
+          /// @c Y coordinate of the region.
+          dimension_size_type y;
+          /// Width of the region.
+          dimension_size_type w;
+          /// Height of the region.
+          dimension_size_type h;
+          /// Reuse the buffer once written.
+          bool reuse;
+        };
+
+        /**
+         * Check the plane of a region to queue.
+         *
+         * Only the plane is checked here, against the series set by
+         * stage(); the region is checked when it is written.
+         *
+         * @param plane the plane index within the current series.
+         */
+        void
+        checkPlane(dimension_size_type plane)
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          if (plane >= planeCount)
+            {
+              boost::format fmt("Invalid plane: %1%");
+              fmt % plane;
+              throw std::logic_error(fmt.str());
+            }
+        }
+
+        /**
+         * Queue a region, blocking while the queue is full.
+         *
+         * @param frame the region to queue.
+         */
+        void
+        push(Frame&& frame)
+        {
+          {
+            std::unique_lock<std::mutex> lock(mutex);
+            cond.wait(lock, [this]{ return error || pending.size() < size; });
+            if (error)
+              std::rethrow_exception(error);
+            pending.push_back(std::move(frame));
+          }
+          cond.notify_all();
+        }
+
+        /// Background writing thread.
+        void
+        run()
+        {
+          try
+            {
+              while (true)
+                {
+                  Frame frame;
+                  {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    cond.wait(lock, [this]{ return done || !pending.empty(); });
+                    if (pending.empty())
+                      break;
+                    frame = std::move(pending.front());
+                    pending.pop_front();
+                    busy = true;
+                  }
+                  cond.notify_all();
+
+                  writer.saveBytes(frame.plane, *frame.buf, frame.x, frame.y, frame.w, frame.h);
+
+                  {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    busy = false;
+                    if (frame.reuse && spare.size() < size)
+                      spare.push_back(frame.buf);
+                  }
+                  cond.notify_all();
+                }
+            }
+          catch (...)
+            {
+              std::lock_guard<std::mutex> lock(mutex);
+              error = std::current_exception();
+              pending.clear();
+              busy = false;
+            }
+          cond.notify_all();
+        }
+
+        /// Writer saving the staged regions.
+        OMETIFFWriter& writer;
+        /// Maximum number of regions pending writing.
+        dimension_size_type size;
+        /// Allocator for staging buffers.
+        std::shared_ptr<PixelAllocator> allocator;
+        /// Regions pending writing.
+        std::deque<Frame> pending;
+        /// Written staging buffers for reuse.
+        std::vector<std::shared_ptr<VariantPixelBuffer>> spare;
+        /// Number of planes in the series of the regions to queue.
+        dimension_size_type planeCount;
+        /// Image width of the series of the regions to queue.
+        dimension_size_type sizeX;
+        /// Image height of the series of the regions to queue.
+        dimension_size_type sizeY;
+        /// Lock for pending, spare, the series snapshot, busy, done and error.
+        std::mutex mutex;
+        /// Signalled when pending, busy, done or error change.
+        std::condition_variable cond;
+        /// A region is being written.
+        bool busy;
+        /// No further regions will be added.
+        bool done;
+        /// Error from the background thread.
+        std::exception_ptr error;
+        /// Background thread.
+        std::thread worker;
+      };
+
+      /**
+       * File opened for direct I/O.
+       *
+       * Writes bypass the page cache.  The file offset, buffer and
+       * size of each write must be aligned to the alignment.
+       */
+      class OMETIFFWriter::DirectFile
+      {
+      public:
+        /**
+         * Constructor.
+         *
+         * @param filename the file to open for writing.
+         * @param alignment the alignment of each write (bytes).
+         */
+        DirectFile(const boost::filesystem::path& filename,
+                   dimension_size_type            alignment):
+          filename(filename),
+          alignment(alignment),
+          fd(-1)
+        {
+#ifdef OME_HAVE_O_DIRECT
+          fd = ::open(filename.string().c_str(), O_WRONLY | O_DIRECT);
+#endif // OME_HAVE_O_DIRECT
+        }
+
+        /// Destructor.
+        ~DirectFile()
+        {
+#ifdef OME_HAVE_O_DIRECT
+          if (fd >= 0)
+            ::close(fd);
+#endif // OME_HAVE_O_DIRECT
+        }
+
+        /**
+         * Check if the file was opened for direct I/O.
+         *
+         * Direct I/O is unavailable if not supported by the system,
+         * or by the filesystem containing the file.
+         *
+         * @returns @c true if open, or @c false otherwise.
+         */
+        bool
+        isOpen() const
+        {
+          return fd >= 0;
+        }
+
+        /**
+         * Write aligned data.
+         *
+         * This may be called concurrently from several threads.
+         *
+         * @param offset the file offset.
+         * @param data the data to write.
+         * @param size the size of the data.
+         * @throws FormatException if the data could not be written.
+         */
+        void
+        write(uint64_t       offset,
+              const uint8_t *data,
+              std::size_t    size)
+        {
+#ifdef OME_HAVE_O_DIRECT
+          while (size)
+            {
+              ssize_t count = ::pwrite(fd, data, size, static_cast<off_t>(offset));
+              if (count < 0 && errno == EINTR)
+                continue;
+              if (count <= 0)
+                {
+                  boost::format fmt("Failed to write %1% bytes at offset %2% of %3%: %4%");
+                  fmt % size % offset % filename.string() % std::strerror(errno);
+                  throw FormatException(fmt.str());
+                }
+              data += count;
+              offset += static_cast<uint64_t>(count);
+              size -= static_cast<std::size_t>(count);
+            }
+#else // ! OME_HAVE_O_DIRECT
+          static_cast<void>(offset);
+          static_cast<void>(data);
+          static_cast<void>(size);
+          throw FormatException("Direct I/O is not supported");
+#endif // OME_HAVE_O_DIRECT
+        }
+
+        /// The filename.
+        const boost::filesystem::path filename;
+        /// The alignment of each write (bytes).
+        const dimension_size_type alignment;
+
+      private:
+        /// The file descriptor.
+        int fd;
+      };
+
       OMETIFFWriter::TIFFState::TIFFState(std::shared_ptr<ome::files::tiff::TIFF>& tiff):
         uuid(boost::uuids::to_string(boost::uuids::random_generator()())),
         tiff(tiff),
-        ifdCount(0U)
+        ifdCount(0U),
+        pyramid(),
+        mapping(),
+        direct(),
+        appended(false)
       {
       }
 
@@ -424,7 +1164,26 @@ namespace ome
         seriesState(),
         originalMetadataRetrieve(),
         omeMeta(),
-        bigTIFF(boost::none)
+        bigTIFF(boost::none),
+        resolutionCount(1U),
+        metadataStorage(METADATA_EVERY_FILE),
+        firstFile(),
+        preallocated(false),
+        directIO(false),
+        clusteredDirectories(false),
+        append(false),
+        update(false),
+        maxFileSize(0U),
+        rolloverBase(),
+        rolloverCount(0U),
+        parent(nullptr),
+        joinMutex(),
+        fileWriterIds(),
+        openFileWriters(0U),
+        ifdTemplate(),
+        ifdTemplateKey(),
+        asyncQueueSize(0U),
+        asyncWriter()
       {
       }
 
@@ -452,12 +1211,20 @@ namespace ome
           {
           }
 
+        // Staged frames are written to the current file first.
+        flush();
+
         if (currentId && *currentId == canonicalpath)
           return;
 
+        // Files created by rollover are named after this file.
+        rolloverBase = canonicalpath;
+        rolloverCount = 0U;
+
         if (seriesState.empty()) // First call to setId.
           {
             baseDir = (canonicalpath.parent_path());
+            firstFile = canonicalpath;
 
             // Create OME-XML metadata.
             originalMetadataRetrieve = metadataRetrieve;
@@ -505,28 +1272,149 @@ namespace ome
           }
 
         if (flags.empty())
-          {
-            flags += 'w';
-
-            // Get expected size of pixel data.
-            std::shared_ptr<const ::ome::xml::meta::MetadataRetrieve> mr(getMetadataRetrieve());
-            storage_size_type pixelSize = significantPixelSize(*mr);
+          flags += 'w';
 
-            if (enableBigTIFF(bigTIFF, pixelSize, canonicalpath, logger))
-              flags += '8';
+        if (asyncQueueSize && !asyncWriter)
+          {
+            asyncWriter = std::make_shared<AsyncWriter>(*this, asyncQueueSize,
+                                                        getMemoryBudget() ?
+                                                        getMemoryBudget()->allocator("staging") :
+                                                        std::shared_ptr<PixelAllocator>());
+            asyncWriter->stage(series);
           }
 
-        tiff_map::iterator i = tiffs.find(canonicalpath);
+        if (maxFileSize && preallocated)
+          throw FormatException("File rollover may not be combined with preallocated image data");
+        if (maxFileSize && append)
+          throw FormatException("File rollover may not be combined with appending");
+        if (update && (preallocated || append || maxFileSize))
+          throw FormatException("Updating may not be combined with preallocation, appending or file rollover");
+
+        tiff_map::iterator i;
+        {
+          std::lock_guard<std::mutex> lock(joinMutex);
+          if (fileWriterIds.find(canonicalpath) != fileWriterIds.end())
+            {
+              boost::format fmt("File %1% is written by a file writer");
+              fmt % canonicalpath;
+              throw FormatException(fmt.str());
+            }
+          i = tiffs.find(canonicalpath);
+        }
         if (i == tiffs.end())
           {
+            if (preallocated && !tiffs.empty())
+              throw FormatException("Preallocated image data may only be written to a single file");
+            if (directIO && !preallocated)
+              throw FormatException("Direct I/O requires preallocated image data");
+
+            // An existing file is updated in place; only the tiles
+            // touched by saveBytes() are rewritten, and the
+            // metadata is left untouched.
+            if (update)
+              {
+                if (!tiffs.empty())
+                  throw FormatException("Updating requires a single file");
+                if (!boost::filesystem::exists(canonicalpath))
+                  {
+                    boost::format fmt("Can't update %1%: File does not exist");
+                    fmt % canonicalpath;
+                    throw FormatException(fmt.str());
+                  }
+                std::string updateUUID;
+                dimension_size_type updateIFDs = 0U;
+                loadAppendedPlanes(canonicalpath, updateUUID, updateIFDs);
+
+                detail::FormatWriter::setId(canonicalpath);
+                std::shared_ptr<ome::files::tiff::TIFF> tiff(ome::files::tiff::TIFF::open(canonicalpath, "r+"));
+                tiff->setStatistics(getStatistics());
+                tiff->setWriteCacheLimit(getWriteCacheLimit());
+                tiff->setWriteCacheDirectory(getWriteCacheDirectory());
+                tiff->setMemoryBudget(getMemoryBudget());
+                {
+                  std::lock_guard<std::mutex> lock(joinMutex);
+                  std::pair<tiff_map::iterator,bool> result =
+                    tiffs.insert(tiff_map::value_type(*currentId, TIFFState(tiff)));
+                  if (result.second) // should always be true
+                    currentTIFF = result.first;
+                }
+                currentTIFF->second.uuid = updateUUID;
+                currentTIFF->second.ifdCount = updateIFDs;
+                detail::FormatWriter::setId(id);
+                return;
+              }
+
+            // An existing file is appended to, linking new IFDs to
+            // the end of its IFD chain.
+            const bool appending = append && boost::filesystem::exists(canonicalpath);
+            std::string appendUUID;
+            dimension_size_type appendIFDs = 0U;
+            dimension_size_type appendSeries = 0U;
+            dimension_size_type appendPlane = 0U;
+            if (appending)
+              {
+                if (preallocated)
+                  throw FormatException("Appending may not be combined with preallocated image data");
+                if (!tiffs.empty())
+                  throw FormatException("Appending requires a single file");
+                loadAppendedPlanes(canonicalpath, appendUUID, appendIFDs);
+
+                // Continue with the first plane not present.
+                bool found = false;
+                for (dimension_size_type series = 0U; series < seriesState.size() && !found; ++series)
+                  for (dimension_size_type plane = 0U; plane < seriesState[series].planes.size() && !found; ++plane)
+                    if (seriesState[series].planes[plane].status != detail::OMETIFFPlane::PRESENT)
+                      {
+                        appendSeries = series;
+                        appendPlane = plane;
+                        found = true;
+                      }
+                if (!found)
+                  {
+                    boost::format fmt("All planes are already present in %1%");
+                    fmt % canonicalpath;
+                    throw FormatException(fmt.str());
+                  }
+              }
+
+            // BigTIFF is decided for each file, from its expected size.
+            std::string fileflags(flags);
+            if (appending)
+              fileflags = "a";
+            else if (enableBigTIFF(bigTIFF, expectedFileSize(), canonicalpath, logger))
+              fileflags += '8';
+
             detail::FormatWriter::setId(canonicalpath);
-            std::shared_ptr<ome::files::tiff::TIFF> tiff(ome::files::tiff::TIFF::open(canonicalpath, flags));
-            std::pair<tiff_map::iterator,bool> result =
-              tiffs.insert(tiff_map::value_type(*currentId, TIFFState(tiff)));
-            if (result.second) // should always be true
-              currentTIFF = result.first;
+            std::shared_ptr<ome::files::tiff::TIFF> tiff(ome::files::tiff::TIFF::open(canonicalpath, fileflags));
+            tiff->setEncodeThreads(getEncodeThreads());
+            tiff->setExecutor(getExecutor());
+            tiff->setSparseTiles(getSparseTiles());
+            tiff->setRecordTileStatistics(getRecordTileStatistics());
+            tiff->setRecordTileChecksums(getRecordTileChecksums());
+            tiff->setStatistics(getStatistics());
+            tiff->setWriteCacheLimit(getWriteCacheLimit());
+            tiff->setWriteCacheDirectory(getWriteCacheDirectory());
+            tiff->setMemoryBudget(getMemoryBudget());
+            {
+              std::lock_guard<std::mutex> lock(joinMutex);
+              std::pair<tiff_map::iterator,bool> result =
+                tiffs.insert(tiff_map::value_type(*currentId, TIFFState(tiff)));
+              if (result.second) // should always be true
+                currentTIFF = result.first;
+            }
             detail::FormatWriter::setId(id);
+            if (appending)
+              {
+                TIFFState& state(currentTIFF->second);
+                state.uuid = appendUUID;
+                state.ifdCount = appendIFDs;
+                state.appended = true;
+                detail::FormatWriter::setSeries(appendSeries);
+                detail::FormatWriter::setPlane(appendPlane);
+              }
             setupIFD();
+            if (preallocated)
+              preallocate();
           }
         else
           {
@@ -540,30 +1428,64 @@ namespace ome
       {
         try
           {
+            // Write any staged frames.
+            if (asyncWriter)
+              {
+                std::exception_ptr error(asyncWriter->finish());
+                asyncWriter.reset();
+                if (error)
+                  std::rethrow_exception(error);
+              }
+
             if (currentId)
               {
                 // Flush last IFD if unwritten.
                 if(currentTIFF != tiffs.end())
                   {
-                    nextIFD();
+                    // Preallocated IFDs were written on setId; only
+                    // the mapped pixel data remains to be flushed.
+                    if (currentTIFF->second.mapping)
+                      {
+                        currentTIFF->second.direct.reset();
+                        currentTIFF->second.mapping->close();
+                        currentTIFF->second.mapping.reset();
+                      }
+                    // Updated tiles were flushed as they were saved.
+                    else if (!update)
+                      nextIFD();
                     currentTIFF = tiffs.end();
                   }
 
-                // Remove any BinData and old TiffData elements.
-                removeBinData(*omeMeta);
-                removeTiffData(*omeMeta);
-                // Create UUID and TiffData elements for each series.
-                fillMetadata();
-
-                for (auto& tiff : tiffs)
+                if (update)
                   {
-                    // Get OME-XML for this TIFF file.
-                    std::string xml = getOMEXML(tiff.first);
-                    // Make sure file is closed before we modify it outside libtiff.
-                    tiff.second.tiff->close();
-
-                    // Save OME-XML in the TIFF.
-                    saveComment(tiff.first, xml);
+                    // The existing metadata is left unchanged.
+                  }
+                else if (parent)
+                  {
+                    // The metadata is saved by the parent writer.
+                    OMETIFFWriter *joined = parent;
+                    parent = nullptr;
+                    joined->joinFileWriter(*this);
+                  }
+                else
+                  {
+                    {
+                      std::lock_guard<std::mutex> lock(joinMutex);
+                      if (openFileWriters)
+                        {
+                          boost::format fmt("%1% file writers have not been closed");
+                          fmt % openFileWriters;
+                          throw FormatException(fmt.str());
+                        }
+                    }
+
+                    // Remove any BinData and old TiffData elements.
+                    removeBinData(*omeMeta);
+                    removeTiffData(*omeMeta);
+                    // Create UUID and TiffData elements for each series.
+                    fillMetadata();
+
+                    saveMetadata();
                   }
               }
 
@@ -576,9 +1498,25 @@ namespace ome
             currentTIFF = tiffs.end();
             flags.clear();
             seriesState.clear();
+            planeFiles.clear();
             originalMetadataRetrieve.reset();
             omeMeta.reset();
             bigTIFF = boost::none;
+            resolutionCount = 1U;
+            firstFile.clear();
+            preallocated = false;
+            directIO = false;
+            clusteredDirectories = false;
+            append = false;
+            update = false;
+            maxFileSize = 0U;
+            rolloverBase.clear();
+            rolloverCount = 0U;
+            parent = nullptr;
+            fileWriterIds.clear();
+            openFileWriters = 0U;
+            ifdTemplate.reset();
+            asyncQueueSize = 0U;
 
             ome::files::detail::FormatWriter::close(fileOnly);
           }
@@ -593,37 +1531,63 @@ namespace ome
       void
       OMETIFFWriter::setSeries(dimension_size_type series) const
       {
+        if (asyncWriter)
+          asyncWriter->flush();
+
         const dimension_size_type currentSeries = getSeries();
         detail::FormatWriter::setSeries(series);
 
-        if (currentSeries != series)
+        if (currentSeries != series && !preallocated && !update)
           {
             nextIFD();
-            setupIFD();
+            // Only the TIFF files are modified by rollover, which
+            // are mutable.
+            if (rolloverRequired())
+              const_cast<OMETIFFWriter *>(this)->rollover();
+            else
+              setupIFD();
           }
+
+        if (staging())
+          asyncWriter->stage(series);
       }
 
       void
       OMETIFFWriter::setPlane(dimension_size_type plane) const
       {
+        if (asyncWriter)
+          asyncWriter->flush();
+
         const dimension_size_type currentPlane = getPlane();
         detail::FormatWriter::setPlane(plane);
 
-        if (currentPlane != plane)
+        if (currentPlane != plane && !preallocated && !update)
           {
             nextIFD();
-            setupIFD();
+            // Only the TIFF files are modified by rollover, which
+            // are mutable.
+            if (rolloverRequired())
+              const_cast<OMETIFFWriter *>(this)->rollover();
+            else
+              setupIFD();
           }
       }
 
       dimension_size_type
       OMETIFFWriter::getTileSizeX() const
       {
+        if (asyncWriter)
+          asyncWriter->flush();
+
         // Get current IFD.  Also requires unset size (fallback) or
         // nonzero set size.
         if (currentId && (!this->tile_size_x ||
                           (this->tile_size_x && *this->tile_size_x)))
           {
+            if (preallocated)
+              return seriesState.at(getSeries()).layouts.at(getPlane())->getTileInfo().tileWidth();
+            if (update)
+              return updateIFD(getPlane())->getTileWidth();
             std::shared_ptr<tiff::IFD> ifd (currentTIFF->second.tiff->getCurrentDirectory());
             return ifd->getTileWidth();
           }
@@ -634,11 +1598,18 @@ namespace ome
       dimension_size_type
       OMETIFFWriter::getTileSizeY() const
       {
+        if (asyncWriter)
+          asyncWriter->flush();
+
         // Get current IFD.  Also requires unset size (fallback) or
         // nonzero set size.
         if (currentId && (!this->tile_size_y ||
                           (this->tile_size_y && *this->tile_size_y)))
           {
+            if (preallocated)
+              return seriesState.at(getSeries()).layouts.at(getPlane())->getTileInfo().tileHeight();
+            if (update)
+              return updateIFD(getPlane())->getTileHeight();
             std::shared_ptr<tiff::IFD> ifd (currentTIFF->second.tiff->getCurrentDirectory());
             return ifd->getTileWidth();
           }
@@ -646,27 +1617,302 @@ namespace ome
           return detail::FormatWriter::getTileSizeY();
       }
 
+      bool
+      OMETIFFWriter::staging() const
+      {
+        return asyncWriter && !asyncWriter->onWorker();
+      }
+
+      std::shared_ptr<tiff::IFD>
+      OMETIFFWriter::updateIFD(dimension_size_type plane) const
+      {
+        const SeriesState& seriesMeta(seriesState.at(getSeries()));
+        if (plane >= seriesMeta.planes.size())
+          {
+            boost::format fmt("Invalid plane: %1%");
+            fmt % plane;
+            throw std::logic_error(fmt.str());
+          }
+
+        const detail::OMETIFFPlane& planeMeta(seriesMeta.planes[plane]);
+        if (planeMeta.status != detail::OMETIFFPlane::PRESENT)
+          {
+            boost::format fmt("Can't update %1%: Plane %2% of series %3% is not present");
+            fmt % currentTIFF->first % plane % getSeries();
+            throw FormatException(fmt.str());
+          }
+
+        return currentTIFF->second.tiff->getDirectoryByIndex(static_cast<tiff::directory_index_type>(planeMeta.ifd));
+      }
+
       void
       OMETIFFWriter::nextIFD() const
       {
         currentTIFF->second.tiff->writeCurrentDirectory();
         ++currentTIFF->second.ifdCount;
+
+        // libtiff writes the directories following an IFD with
+        // SubIFDs as its SubIFDs, so these are not counted.
+        if (currentTIFF->second.pyramid)
+          writeSubResolutions(currentTIFF->second);
+      }
+
+      bool
+      OMETIFFWriter::rolloverRequired() const
+      {
+        return maxFileSize &&
+          currentTIFF != tiffs.end() &&
+          currentTIFF->second.ifdCount &&
+          currentTIFF->second.tiff->getFileSize() >= maxFileSize;
       }
 
       void
-      OMETIFFWriter::setupIFD() const
+      OMETIFFWriter::rollover()
       {
-        // Get current IFD.
-        std::shared_ptr<tiff::IFD> ifd (currentTIFF->second.tiff->getCurrentDirectory());
+        // Insert the number before a compound ".ome.tif" extension,
+        // or otherwise before the last extension.
+        const std::string name(rolloverBase.filename().string());
+        std::string lower(name);
+        std::transform(lower.begin(), lower.end(), lower.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        std::string::size_type dot = lower.find(".ome.");
+        if (dot == std::string::npos)
+          dot = lower.rfind('.');
+        if (dot == std::string::npos || dot == 0U)
+          dot = name.size();
+
+        path next;
+        do
+          {
+            std::string rolled(name);
+            rolled.insert(dot, "_" + std::to_string(++rolloverCount));
+            next = rolloverBase.parent_path() / rolled;
+          }
+        while (tiffs.find(next) != tiffs.end());
+
+        BOOST_LOG_SEV(logger, ome::logging::trivial::debug)
+          << "Continuing in " << next << " after " << currentTIFF->first
+          << " reached " << currentTIFF->second.tiff->getFileSize() << " bytes";
+
+        // setId() names later files after the file it is passed, so
+        // the base name and count are restored.
+        const path base(rolloverBase);
+        const dimension_size_type count(rolloverCount);
+        changeOutputFile(next);
+        rolloverBase = base;
+        rolloverCount = count;
+      }
 
-        ifd->setImageWidth(getSizeX());
-        ifd->setImageHeight(getSizeY());
+      storage_size_type
+      OMETIFFWriter::expectedFileSize() const
+      {
+        std::shared_ptr<const ::ome::xml::meta::MetadataRetrieve> mr(getMetadataRetrieve());
+        storage_size_type pixelSize = significantPixelSize(*mr);
 
-        // Default strip or tile size.  We base this upon a default
+        // A file holds at most one plane beyond the maximum size.
+        if (maxFileSize)
+          {
+            storage_size_type largest = 0U;
+            for (dimension_size_type series = 0U; series < seriesState.size(); ++series)
+              if (!seriesState[series].planes.empty())
+                largest = std::max(largest,
+                                   significantPixelSize(*mr, series) / seriesState[series].planes.size());
+            pixelSize = std::min(pixelSize, maxFileSize + largest);
+          }
+
+        return pixelSize;
+      }
+
+      void
+      OMETIFFWriter::writeSubResolutions(TIFFState& state) const
+      {
+        std::shared_ptr<Pyramid> pyramid(state.pyramid);
+        state.pyramid.reset();
+
+        for (const auto& level : pyramid->finish())
+          {
+            std::shared_ptr<tiff::IFD> ifd (state.tiff->getCurrentDirectory());
+            setupIFD(*ifd, level->shape()[DIM_SPATIAL_X], level->shape()[DIM_SPATIAL_Y]);
+            ifd->getField(ome::files::tiff::SUBFILETYPE).set(FILETYPE_REDUCEDIMAGE);
+            ifd->writeImage(*level);
+            state.tiff->writeCurrentDirectory();
+          }
+      }
+
+      void
+      OMETIFFWriter::preallocate()
+      {
+        const boost::optional<std::string> compression(getCompression());
+        if (compression && tiff::getCodecScheme(*compression) != COMPRESSION_NONE)
+          throw FormatException("Preallocated image data may not be compressed");
+
+        const boost::optional<bool> predictor(getPredictor());
+        if (predictor && *predictor)
+          throw FormatException("Preallocated image data may not use a predictor");
+
+        if (resolutionCount > 1U)
+          throw FormatException("Preallocated image data may not have sub-resolutions");
+
+        if (getPackSamples())
+          throw FormatException("Preallocated image data may not use packed samples");
+
+        TIFFState& state(currentTIFF->second);
+
+        // Tiles and strips written with direct I/O must not share a
+        // page with other data, which is written through the page
+        // cache.
+        const dimension_size_type alignment = directIO ?
+          std::max(TileBuffer::direct_io_alignment,
+                   static_cast<dimension_size_type>(boost::iostreams::mapped_file::alignment())) : 0U;
+
+        for (dimension_size_type series = 0U; series < seriesState.size(); ++series)
+          {
+            detail::FormatWriter::setSeries(series);
+
+            if (bitsPerPixel(getPixelType()) % 8U)
+              {
+                boost::format fmt("Preallocated image data may not use pixel type %1%");
+                fmt % getPixelType();
+                throw FormatException(fmt.str());
+              }
+
+            SeriesState& seriesMeta(seriesState.at(series));
+            seriesMeta.layouts.clear();
+            for (dimension_size_type plane = 0U; plane < seriesMeta.planes.size(); ++plane)
+              {
+                detail::FormatWriter::setPlane(plane);
+
+                // The first IFD was set up by setId().
+                if (state.ifdCount)
+                  setupIFD();
+
+                std::shared_ptr<tiff::IFD> ifd (state.tiff->getCurrentDirectory());
+                seriesMeta.layouts.push_back(ifd->reserveImage(alignment));
+
+                // Set plane metadata.
+                detail::OMETIFFPlane& planeMeta(seriesMeta.planes.at(plane));
+                planeMeta.file = planeFiles.add(currentTIFF->first);
+                planeMeta.ifd = state.ifdCount;
+                planeMeta.certain = true;
+                planeMeta.status = detail::OMETIFFPlane::PRESENT; // Plane reserved.
+
+                nextIFD();
+              }
+          }
+
+        detail::FormatWriter::setSeries(0U);
+
+        state.mapping = std::make_shared<boost::iostreams::mapped_file>
+          (currentTIFF->first.string(), boost::iostreams::mapped_file::readwrite);
+
+        if (directIO)
+          {
+            std::shared_ptr<DirectFile> direct(std::make_shared<DirectFile>(currentTIFF->first, alignment));
+            if (direct->isOpen())
+              state.direct = direct;
+            else
+              BOOST_LOG_SEV(logger, ome::logging::trivial::warning)
+                << "Direct I/O is not supported for " << currentTIFF->first.string()
+                << "; writing image data with buffered I/O";
+          }
+      }
+
+      void
+      OMETIFFWriter::joinFileWriter(OMETIFFWriter& writer)
+      {
+        std::lock_guard<std::mutex> lock(joinMutex);
+        --openFileWriters;
+
+        for (dimension_size_type series = 0U; series < writer.seriesState.size(); ++series)
+          {
+            const SeriesState& source(writer.seriesState.at(series));
+            SeriesState& dest(seriesState.at(series));
+            for (dimension_size_type plane = 0U; plane < source.planes.size(); ++plane)
+              {
+                const detail::OMETIFFPlane& sourceMeta(source.planes.at(plane));
+                if (sourceMeta.status != detail::OMETIFFPlane::PRESENT)
+                  continue;
+
+                detail::OMETIFFPlane& planeMeta(dest.planes.at(plane));
+                if (planeMeta.status == detail::OMETIFFPlane::PRESENT)
+                  {
+                    boost::format fmt("Plane %1% of series %2% saved in more than one file");
+                    fmt % plane % series;
+                    throw FormatException(fmt.str());
+                  }
+
+                planeMeta = sourceMeta;
+                planeMeta.file = planeFiles.add(writer.planeFiles.get(sourceMeta.file));
+              }
+          }
+
+        // The TIFF files are closed when the metadata is saved.
+        tiffs.insert(writer.tiffs.begin(), writer.tiffs.end());
+        writer.tiffs.clear();
+        writer.currentTIFF = writer.tiffs.end();
+      }
+
+      void
+      OMETIFFWriter::setupIFD() const
+      {
+        // Get current IFD.
+        std::shared_ptr<tiff::IFD> ifd (currentTIFF->second.tiff->getCurrentDirectory());
+
+        // Every plane of a series has the same structure, other than
+        // the samples per pixel of its channel.  The tags are set up
+        // and validated for the first plane, and then applied to the
+        // following planes as a template until the series or writer
+        // options change.
+        dimension_size_type channel = getZCTCoords(getPlane())[1];
+        ifd_template_key key(getSeries(), getRGBChannelCount(channel),
+                             tile_size_x, tile_size_y, interleaved,
+                             compression, compressionLevel, predictor);
+        if (ifdTemplate && ifdTemplateKey == key)
+          ifd->applyTemplate(*ifdTemplate);
+        else
+          {
+            setupIFD(*ifd, getSizeX(), getSizeY());
+            ifdTemplate = std::make_shared<const tiff::IFDTemplate>(ifd->getTemplate());
+            ifdTemplateKey = key;
+          }
+
+        if (currentTIFF->second.ifdCount == 0)
+          ifd->getField(ome::files::tiff::IMAGEDESCRIPTION).set(default_description);
+
+        if (resolutionCount > 1U)
+          {
+            // Placeholder offsets, filled in by libtiff as each
+            // SubIFD is written.
+            std::vector<uint64_t> subifds(resolutionCount - 1U, 0U);
+            ifd->getField(ome::files::tiff::SUBIFD).set(subifds);
+
+            PixelBufferBase::storage_order_type order
+              (PixelBufferBase::make_storage_order(DimensionOrder::XYZTC,
+                                                   ifd->getPlanarConfiguration() == tiff::CONTIG));
+            currentTIFF->second.pyramid =
+              std::make_shared<Pyramid>(resolutionCount - 1U,
+                                        getSizeX(), getSizeY(),
+                                        ifd->getSamplesPerPixel(),
+                                        getPixelType(), order,
+                                        getMemoryBudget() ?
+                                        getMemoryBudget()->allocator("pyramid") :
+                                        std::shared_ptr<PixelAllocator>());
+          }
+      }
+
+      void
+      OMETIFFWriter::setupIFD(tiff::IFD&          ifd,
+                              dimension_size_type sizeX,
+                              dimension_size_type sizeY) const
+      {
+        ifd.setImageWidth(sizeX);
+        ifd.setImageHeight(sizeY);
+
+        // Default strip or tile size.  We base this upon a default
         // chunk size of 64KiB for greyscale images, which will
         // increase to 192KiB for 3 sample RGB images.  We use strips
         // up to a width of 2048 after which tiles are used.
-        if(getSizeX() == 0)
+        if(sizeX == 0)
           {
             throw FormatException("Can't set strip or tile size: SizeX is 0");
           }
@@ -677,15 +1923,15 @@ namespace ome
             // compatibility with Bio-Formats.
             if(*this->tile_size_y)
               {
-                ifd->setTileType(tiff::STRIP);
-                ifd->setTileWidth(getSizeX());
-                ifd->setTileHeight(*this->tile_size_y);
+                ifd.setTileType(tiff::STRIP);
+                ifd.setTileWidth(sizeX);
+                ifd.setTileHeight(*this->tile_size_y);
               }
             else
               {
-                ifd->setTileType(tiff::STRIP);
-                ifd->setTileWidth(getSizeX());
-                ifd->setTileHeight(1U);
+                ifd.setTileType(tiff::STRIP);
+                ifd.setTileWidth(sizeX);
+                ifd.setTileHeight(1U);
               }
           }
         else if(this->tile_size_x && this->tile_size_y)
@@ -695,64 +1941,157 @@ namespace ome
             // compatibility with Bio-Formats.
             if(*this->tile_size_x && *this->tile_size_y)
               {
-                ifd->setTileType(tiff::TILE);
-                ifd->setTileWidth(*this->tile_size_x);
-                ifd->setTileHeight(*this->tile_size_y);
+                ifd.setTileType(tiff::TILE);
+                ifd.setTileWidth(*this->tile_size_x);
+                ifd.setTileHeight(*this->tile_size_y);
               }
             else
               {
-                ifd->setTileType(tiff::STRIP);
-                ifd->setTileWidth(getSizeX());
-                ifd->setTileHeight(1U);
+                ifd.setTileType(tiff::STRIP);
+                ifd.setTileWidth(sizeX);
+                ifd.setTileHeight(1U);
               }
           }
-        else if(getSizeX() < 2048)
+        else if(this->accessProfile)
+          {
+            // Choose the geometry for the expected access pattern.
+            dimension_size_type channel = getZCTCoords(getPlane())[1];
+            const boost::optional<bool> interleaved(getInterleaved());
+            const boost::optional<std::string> compression(getCompression());
+            tiff::TileGeometry geometry
+              (tiff::chooseTileGeometry(*this->accessProfile,
+                                        static_cast<uint32_t>(sizeX),
+                                        static_cast<uint32_t>(sizeY),
+                                        getPixelType(),
+                                        static_cast<uint16_t>(getRGBChannelCount(channel)),
+                                        interleaved && *interleaved ? tiff::CONTIG : tiff::SEPARATE,
+                                        compression ? tiff::getCodecScheme(*compression) : tiff::COMPRESSION_NONE));
+            ifd.setTileType(geometry.type);
+            ifd.setTileWidth(geometry.width);
+            ifd.setTileHeight(geometry.height);
+          }
+        else if(sizeX < 2048)
           {
             // Default to strips, mainly for compatibility with
             // readers which don't support tiles.
-            ifd->setTileType(tiff::STRIP);
-            ifd->setTileWidth(getSizeX());
-            uint32_t height = 65536U / getSizeX();
+            ifd.setTileType(tiff::STRIP);
+            ifd.setTileWidth(sizeX);
+            uint32_t height = 65536U / sizeX;
             if (height == 0)
               height = 1;
-            ifd->setTileHeight(height);
+            ifd.setTileHeight(height);
           }
         else
           {
             // Default to tiles.
-            ifd->setTileType(tiff::TILE);
-            ifd->setTileWidth(256U);
-            ifd->setTileHeight(256U);
+            ifd.setTileType(tiff::TILE);
+            ifd.setTileWidth(256U);
+            ifd.setTileHeight(256U);
           }
 
         std::array<dimension_size_type, 3> coords = getZCTCoords(getPlane());
 
         dimension_size_type channel = coords[1];
 
-        ifd->setPixelType(getPixelType());
-        ifd->setBitsPerSample(bitsPerPixel(getPixelType()));
-        ifd->setSamplesPerPixel(getRGBChannelCount(channel));
+        ifd.setPixelType(getPixelType());
+        // Packing depends upon the significant bits, which are
+        // optional.
+        pixel_size_type significant = 0U;
+        if (getPackSamples())
+          {
+            try
+              {
+                significant = getBitsPerPixel();
+              }
+            catch (const std::exception&)
+              {
+              }
+          }
+        ifd.setBitsPerSample(tiff::storedBitsPerSample(getPixelType(), significant, getPackSamples()));
+        ifd.setSamplesPerPixel(getRGBChannelCount(channel));
 
         const boost::optional<bool> interleaved(getInterleaved());
         if (interleaved && *interleaved)
-          ifd->setPlanarConfiguration(tiff::CONTIG);
+          ifd.setPlanarConfiguration(tiff::CONTIG);
         else
-          ifd->setPlanarConfiguration(tiff::SEPARATE);
+          ifd.setPlanarConfiguration(tiff::SEPARATE);
 
         // This isn't necessarily always true; we might want to use a
         // photometric interpretation other than RGB with three
         // subchannels.
         if (isRGB(channel) && getRGBChannelCount(channel) == 3)
-          ifd->setPhotometricInterpretation(tiff::RGB);
+          ifd.setPhotometricInterpretation(tiff::RGB);
         else
-          ifd->setPhotometricInterpretation(tiff::MIN_IS_BLACK);
+          ifd.setPhotometricInterpretation(tiff::MIN_IS_BLACK);
 
         const boost::optional<std::string> compression(getCompression());
         if(compression)
-          ifd->setCompression(tiff::getCodecScheme(*compression));
+          ifd.setCompression(tiff::getCodecScheme(*compression));
 
-        if (currentTIFF->second.ifdCount == 0)
-          ifd->getField(ome::files::tiff::IMAGEDESCRIPTION).set(default_description);
+        const boost::optional<int> level(getCompressionLevel());
+        if(level)
+          ifd.setCompressionLevel(*level);
+
+        // Subsample JPEG-compressed RGB as YCbCr.
+        tiff::setupJPEGYCbCr(ifd);
+
+        const boost::optional<bool> predictor(getPredictor());
+        if(predictor && *predictor)
+          {
+            tiff::Predictor pixelpredictor(tiff::getPixelTypePredictor(getPixelType()));
+            if (pixelpredictor == tiff::NONE)
+              {
+                boost::format fmt("Pixel type %1% does not support a predictor");
+                fmt % getPixelType();
+                throw FormatException(fmt.str());
+              }
+            if (tiff::isPackedSampleDepth(ifd.getBitsPerSample()))
+              throw FormatException("Packed samples may not use a predictor");
+            ifd.setPredictor(pixelpredictor);
+          }
+
+      }
+
+      void
+      OMETIFFWriter::saveBytes(dimension_size_type plane,
+                               VariantPixelBuffer& buf)
+      {
+        // The current file may be changed by the background thread,
+        // so the image size is taken from the staged series.
+        if (staging())
+          {
+            const std::pair<dimension_size_type, dimension_size_type> size(asyncWriter->imageSize());
+            saveBytes(plane, buf, 0U, 0U, size.first, size.second);
+          }
+        else
+          detail::FormatWriter::saveBytes(plane, buf);
+      }
+
+      void
+      OMETIFFWriter::saveBytes(dimension_size_type   plane,
+                               VariantPixelBuffer&& buf)
+      {
+        if (staging())
+          {
+            const std::pair<dimension_size_type, dimension_size_type> size(asyncWriter->imageSize());
+            saveBytes(plane, std::move(buf), 0U, 0U, size.first, size.second);
+          }
+        else
+          detail::FormatWriter::saveBytes(plane, buf);
+      }
+
+      void
+      OMETIFFWriter::saveBytes(dimension_size_type   plane,
+                               VariantPixelBuffer&& buf,
+                               dimension_size_type   x,
+                               dimension_size_type   y,
+                               dimension_size_type   w,
+                               dimension_size_type   h)
+      {
+        if (staging())
+          asyncWriter->adopt(plane, std::move(buf), x, y, w, h);
+        else
+          saveBytes(plane, buf, x, y, w, h);
       }
 
       void
@@ -763,23 +2102,188 @@ namespace ome
                                dimension_size_type w,
                                dimension_size_type h)
       {
+        // The region is copied and written by the background thread.
+        if (staging())
+          {
+            asyncWriter->add(plane, buf, x, y, w, h);
+            return;
+          }
+
+        assertId(currentId, true);
+
+        if (preallocated)
+          {
+            // No writer state is modified, so that planes and
+            // regions may be saved concurrently.
+            const SeriesState& seriesMeta(seriesState.at(getSeries()));
+            if (plane >= seriesMeta.layouts.size())
+              {
+                boost::format fmt("Invalid plane: %1%");
+                fmt % plane;
+                throw std::logic_error(fmt.str());
+              }
+
+            std::shared_ptr<PixelStatistics> stats(planePixelStatistics(plane));
+            if (stats)
+              stats->add(buf);
+
+            boost::iostreams::mapped_file& mapping(*currentTIFF->second.mapping);
+            const std::shared_ptr<DirectFile>& direct(currentTIFF->second.direct);
+            if (direct)
+              seriesMeta.layouts[plane]->writeImage(mapping.data(), mapping.size(),
+                                                    [&direct](uint64_t offset, const uint8_t *data, std::size_t size)
+                                                    { direct->write(offset, data, size); },
+                                                    direct->alignment, buf, x, y, w, h);
+            else
+              seriesMeta.layouts[plane]->writeImage(mapping.data(), mapping.size(), buf, x, y, w, h);
+            return;
+          }
+
+        if (update)
+          {
+            setPlane(plane);
+            std::shared_ptr<tiff::IFD> ifd(updateIFD(plane));
+
+            // Sub-resolutions would no longer match the updated
+            // image.
+            std::vector<uint64_t> subifds;
+            try
+              {
+                ifd->getField(ome::files::tiff::SUBIFD).get(subifds);
+              }
+            catch (const tiff::Exception&)
+              {
+              }
+            if (!subifds.empty())
+              {
+                boost::format fmt("Can't update %1%: Images with sub-resolutions are not supported");
+                fmt % currentTIFF->first;
+                throw FormatException(fmt.str());
+              }
+
+            ifd->updateImage(buf, x, y, w, h);
+            return;
+          }
+
+        setPlane(plane);
+
+        // Get current IFD.
+        std::shared_ptr<tiff::IFD> ifd (currentTIFF->second.tiff->getCurrentDirectory());
+
+        // Get plane metadata.
+        detail::OMETIFFPlane& planeMeta(seriesState.at(getSeries()).planes.at(plane));
+
+        // Accumulate pixel statistics while the tiles are packed.
+        std::shared_ptr<PixelStatistics> stats(planePixelStatistics(plane));
+        if (stats)
+          ifd->writeImage(buf, x, y, w, h, *stats);
+        else
+          ifd->writeImage(buf, x, y, w, h);
+
+        if (currentTIFF->second.pyramid)
+          currentTIFF->second.pyramid->add(buf, x, y);
+
+        // Set plane metadata.
+        std::lock_guard<std::mutex> lock(joinMutex);
+        planeMeta.file = planeFiles.add(currentTIFF->first);
+        planeMeta.ifd = currentTIFF->second.ifdCount;
+        planeMeta.certain = true;
+        planeMeta.status = detail::OMETIFFPlane::PRESENT; // Plane now written.
+      }
+
+      void
+      OMETIFFWriter::savePlanes(dimension_size_type plane,
+                                VariantPixelBuffer& buf)
+      {
+        // The block is split using the current file state.
+        flush();
+
+        assertId(currentId, true);
+
+        std::vector<block_plane> planes(getBlockPlanes(plane, buf));
+        if (planes.empty())
+          return;
+
+        // Planes in the storage order of the IFDs are written
+        // directly from the block, as are staged planes, which are
+        // copied.
+        const boost::optional<bool> interleaved(getInterleaved());
+        PixelBufferBase::storage_order_type order
+          (PixelBufferBase::make_storage_order(DimensionOrder::XYZTC,
+                                               interleaved && *interleaved));
+        if (preallocated || update || staging() ||
+            planes.front().second->storage_order() == order)
+          {
+            for (auto& blockplane : planes)
+              saveBytes(blockplane.first, *blockplane.second);
+            return;
+          }
+
+        // Otherwise, each plane is converted to the storage order of
+        // the IFDs.  Two buffers are used, so that the next plane is
+        // converted while the current plane is encoded and written.
+        std::array<VariantPixelBuffer::size_type, 9> shape;
+        std::copy(planes.front().second->shape(),
+                  planes.front().second->shape() + PixelBufferBase::dimensions,
+                  shape.begin());
+        std::array<std::shared_ptr<VariantPixelBuffer>, 2> converted;
+        for (auto& convertedplane : converted)
+          convertedplane = std::make_shared<VariantPixelBuffer>(shape, buf.pixelType(), order,
+                                                                PIXEL_UNINITIALIZED);
+
+        *converted[0] = *planes.front().second;
+        for (std::vector<block_plane>::size_type i = 0; i < planes.size(); ++i)
+          {
+            runParallel(getExecutor(), i + 1 < planes.size() ? 2U : 1U,
+                        [this, &converted, &planes, i](dimension_size_type worker,
+                                                       dimension_size_type)
+                        {
+                          if (worker == 0U)
+                            saveBytes(planes[i].first, *converted[i % 2]);
+                          else
+                            *converted[(i + 1) % 2] = *planes[i + 1].second;
+                        });
+          }
+      }
+
+      bool
+      OMETIFFWriter::copyBytes(dimension_size_type plane,
+                               const ::ome::files::FormatReader& reader,
+                               dimension_size_type sourcePlane)
+      {
+        // Raw tiles are copied into the current IFD.
+        flush();
+
         assertId(currentId, true);
 
+        // Preallocated planes are copied by saveBytes(), as are
+        // planes for which pixel or tile statistics are required.
+        if (preallocated || update || pixelStatisticsEnabled || recordTileStatistics)
+          return detail::FormatWriter::copyBytes(plane, reader, sourcePlane);
+
+        std::shared_ptr<const tiff::IFD> source(reader.getPlaneIFD(sourcePlane));
+
         setPlane(plane);
 
         // Get current IFD.
         std::shared_ptr<tiff::IFD> ifd (currentTIFF->second.tiff->getCurrentDirectory());
 
+        // Sub-resolutions are generated from the decoded pixel data.
+        if (!source || currentTIFF->second.pyramid || !ifd->canCopyRawTiles(*source))
+          return detail::FormatWriter::copyBytes(plane, reader, sourcePlane);
+
         // Get plane metadata.
         detail::OMETIFFPlane& planeMeta(seriesState.at(getSeries()).planes.at(plane));
 
-        ifd->writeImage(buf, x, y, w, h);
+        ifd->copyRawTiles(*source);
 
         // Set plane metadata.
-        planeMeta.id = currentTIFF->first;
+        std::lock_guard<std::mutex> lock(joinMutex);
+        planeMeta.file = planeFiles.add(currentTIFF->first);
         planeMeta.ifd = currentTIFF->second.ifdCount;
         planeMeta.certain = true;
         planeMeta.status = detail::OMETIFFPlane::PRESENT; // Plane now written.
+        return true;
       }
 
       void
@@ -823,10 +2327,11 @@ namespace ome
                   ome::files::getZCTCoords(dimOrder, sizeZ, effC, sizeT, imageCount, plane);
                 const detail::OMETIFFPlane& planeState(seriesState.at(series).planes.at(plane));
 
-                tiff_map::const_iterator t = tiffs.find(planeState.id);
+                const path& planeFile(planeFiles.get(planeState.file));
+                tiff_map::const_iterator t = tiffs.find(planeFile);
                 if (t != tiffs.end())
                   {
-                    path relative(make_relative(baseDir, planeState.id));
+                    path relative(make_relative(baseDir, planeFile));
                     std::string uuid("urn:uuid:");
                     uuid += t->second.uuid;
                     omeMeta->setUUIDFileName(relative.generic_string(), series, plane);
@@ -843,11 +2348,36 @@ namespace ome
                   {
                     boost::format fmt
                       ("Inconsistent writer state: TIFF file %1% not registered with a UUID");
-                    fmt % planeState.id;
+                    fmt % planeFile;
                     throw FormatException(fmt.str());
                   }
               }
           }
+
+        // The model has no elements for pixel statistics, so the
+        // minimum and maximum of each channel are stored as
+        // original metadata annotations.
+        MetadataMap statsMeta;
+        {
+          std::lock_guard<std::mutex> lock(pixelStatisticsMutex);
+          for (const auto& channelStats : pixelStatistics)
+            {
+              const PixelStatistics& stats(*channelStats.second);
+              for (dimension_size_type s = 0U; s < stats.getSampleCount(); ++s)
+                {
+                  if (!stats.getCount(s))
+                    continue;
+
+                  boost::format fmt("Image %1% Channel %2% Sample %3% ");
+                  fmt % channelStats.first.first % channelStats.first.second % s;
+                  const std::string prefix(fmt.str());
+                  statsMeta.set(prefix + "Minimum", stats.getMinimum(s));
+                  statsMeta.set(prefix + "Maximum", stats.getMaximum(s));
+                }
+            }
+        }
+        if (!statsMeta.empty())
+          fillOriginalMetadata(*omeMeta, statsMeta);
       }
 
       std::string
@@ -868,13 +2398,321 @@ namespace ome
         uuid += t->second.uuid;
         omeMeta->setUUID(uuid);
 
+        TraceScope trace(TraceObserver::XML_SERIALIZE, &id);
         return files::getOMEXML(*omeMeta, true);
       }
 
+      std::string
+      OMETIFFWriter::getBinaryOnlyOMEXML(const boost::filesystem::path& id,
+                                         const boost::filesystem::path& metadataFile,
+                                         const std::string&             metadataUUID)
+      {
+        tiff_map::const_iterator t = tiffs.find(id);
+
+        if (t == tiffs.end())
+          {
+            boost::format fmt
+              ("Inconsistent writer state: TIFF file %1% not registered with a UUID");
+            fmt % id;
+            throw FormatException(fmt.str());
+          }
+
+        // The reader resolves the metadata file relative to the
+        // directory of the TIFF.
+        path relative(make_relative(id.parent_path(), metadataFile));
+
+        OMEXMLMetadata meta;
+        meta.setUUID("urn:uuid:" + t->second.uuid);
+        meta.setBinaryOnlyMetadataFile(relative.generic_string());
+        meta.setBinaryOnlyUUID("urn:uuid:" + metadataUUID);
+
+        TraceScope trace(TraceObserver::XML_SERIALIZE, &id);
+        return files::getOMEXML(meta, true);
+      }
+
+      OMETIFFWriter::comment_writer
+      OMETIFFWriter::streamComment(const boost::filesystem::path& id,
+                                   const std::string&             uuid) const
+      {
+        return [this, &id, uuid](std::ostream& out)
+          {
+            TraceScope trace(TraceObserver::XML_SERIALIZE, &id);
+            writeOMEXML(*omeMeta, out, "urn:uuid:" + uuid);
+          };
+      }
+
+      void
+      OMETIFFWriter::saveMetadata()
+      {
+        if (tiffs.empty())
+          return;
+
+        tiff_map::iterator first = tiffs.find(firstFile);
+        if (first == tiffs.end())
+          first = tiffs.begin();
+
+        // Each file is closed and has its metadata saved by a
+        // separate task, so that files may be finalised concurrently.
+        std::vector<std::function<void()>> tasks;
+        tasks.reserve(tiffs.size());
+
+        // If possible, stream the OME-XML directly into each file
+        // from the metadata model, rather than serialising through
+        // a DOM.  Each file is written with its own root UUID
+        // without modifying the metadata, so files may be written
+        // concurrently.
+        omeMeta->resolveReferences();
+        const bool streamed = canWriteOMEXML(*omeMeta);
+
+        if (metadataStorage == METADATA_EVERY_FILE && streamed)
+          {
+            for (auto& tiff : tiffs)
+              {
+                const path& id(tiff.first);
+                TIFFState& state(tiff.second);
+                tasks.push_back([this, &id, &state]()
+                                {
+                                  state.tiff->close();
+                                  saveComment(id, streamComment(id, state.uuid));
+                                });
+              }
+            runTasks(getExecutor(), tasks, max_finalise_threads);
+            return;
+          }
+
+        if (metadataStorage == METADATA_EVERY_FILE)
+          {
+            // Serialize once, and only substitute the root UUID for
+            // each file.
+            std::shared_ptr<const std::string> xml(std::make_shared<std::string>(getOMEXML(first->first)));
+            std::string::size_type uuidpos = findRootUUID(*xml, first->second.uuid);
+            for (auto& tiff : tiffs)
+              {
+                std::shared_ptr<const std::string> filexml(xml);
+                std::string::size_type fileuuidpos = uuidpos;
+                if (uuidpos == std::string::npos ||
+                    tiff.second.uuid.size() != first->second.uuid.size())
+                  {
+                    filexml = std::make_shared<std::string>(getOMEXML(tiff.first));
+                    fileuuidpos = std::string::npos;
+                  }
+                const path& id(tiff.first);
+                TIFFState& state(tiff.second);
+                tasks.push_back([this, &id, &state, filexml, fileuuidpos]()
+                                {
+                                  // Make sure file is closed before we modify it outside libtiff.
+                                  state.tiff->close();
+
+                                  // Save OME-XML in the TIFF.
+                                  saveComment(id, *filexml, fileuuidpos, state.uuid);
+                                });
+              }
+            runTasks(getExecutor(), tasks, max_finalise_threads);
+            return;
+          }
+
+        // Save the full metadata once.
+        path metadataFile;
+        std::string metadataUUID;
+        if (metadataStorage == METADATA_FIRST_FILE)
+          {
+            metadataFile = first->first;
+            metadataUUID = first->second.uuid;
+            const path& id(first->first);
+            TIFFState& state(first->second);
+            if (streamed)
+              tasks.push_back([this, &id, &state]()
+                              {
+                                state.tiff->close();
+                                saveComment(id, streamComment(id, state.uuid));
+                              });
+            else
+              {
+                std::shared_ptr<const std::string> xml(std::make_shared<std::string>(getOMEXML(first->first)));
+                tasks.push_back([this, &id, &state, xml]()
+                                {
+                                  state.tiff->close();
+                                  saveComment(id, *xml);
+                                });
+              }
+          }
+        else
+          {
+            metadataFile = companionFile(first->first);
+            metadataUUID = boost::uuids::to_string(boost::uuids::random_generator()());
+            omeMeta->setUUID("urn:uuid:" + metadataUUID);
+            boost::filesystem::ofstream out(metadataFile, std::ios::out | std::ios::binary | std::ios::trunc);
+            {
+              TraceScope trace(TraceObserver::XML_SERIALIZE, &metadataFile);
+              if (streamed)
+                writeOMEXML(*omeMeta, out);
+              else
+                out << files::getOMEXML(*omeMeta, true);
+            }
+            out.close();
+            if (!out)
+              {
+                boost::format fmt("Failed to write companion metadata file %1%");
+                fmt % metadataFile;
+                throw FormatException(fmt.str());
+              }
+          }
+
+        // Refer to the full metadata from the other files.
+        for (auto& tiff : tiffs)
+          {
+            if (metadataStorage == METADATA_FIRST_FILE && tiff.first == first->first)
+              continue;
+            std::shared_ptr<const std::string> xml(std::make_shared<std::string>(getBinaryOnlyOMEXML(tiff.first, metadataFile, metadataUUID)));
+            const path& id(tiff.first);
+            TIFFState& state(tiff.second);
+            tasks.push_back([this, &id, &state, xml]()
+                            {
+                              state.tiff->close();
+                              saveComment(id, *xml);
+                            });
+          }
+        runTasks(getExecutor(), tasks, max_finalise_threads);
+      }
+
+      void
+      OMETIFFWriter::loadAppendedPlanes(const boost::filesystem::path& id,
+                                        std::string&                   uuid,
+                                        dimension_size_type&           ifdCount)
+      {
+        // Errors name the operation and file.
+        const std::string action((update ? "update " : "append to ") + id.string());
+
+        std::string omexml;
+        {
+          std::shared_ptr<tiff::TIFF> tiff(tiff::TIFF::open(id, "r"));
+          ifdCount = tiff->directoryCount();
+          std::shared_ptr<tiff::IFD> ifd(tiff->getDirectoryByIndex(0));
+          try
+            {
+              ifd->getField(ome::files::tiff::IMAGEDESCRIPTION).get(omexml);
+            }
+          catch (const tiff::Exception&)
+            {
+            }
+          tiff->close();
+        }
+
+        std::shared_ptr<OMEXMLMetadata> existing;
+        try
+          {
+            existing = createOMEXMLMetadata(omexml);
+          }
+        catch (const std::exception&)
+          {
+          }
+        if (!existing || !existing->getImageCount())
+          {
+            boost::format fmt("Can't %1%: No OME-XML image metadata found");
+            fmt % action;
+            throw FormatException(fmt.str());
+          }
+
+        uuid = existing->getUUID();
+        const std::string prefix("urn:uuid:");
+        const std::string fileUUID(uuid);
+        if (uuid.compare(0, prefix.size(), prefix) == 0)
+          uuid.erase(0, prefix.size());
+
+        const dimension_size_type seriesCount = metadataRetrieve->getImageCount();
+        if (existing->getImageCount() != seriesCount)
+          {
+            boost::format fmt("Can't %1%: File contains %2% images, but %3% are being written");
+            fmt % action % existing->getImageCount() % seriesCount;
+            throw FormatException(fmt.str());
+          }
+
+        for (dimension_size_type series = 0U; series < seriesCount; ++series)
+          {
+            if (existing->getPixelsSizeX(series) != metadataRetrieve->getPixelsSizeX(series) ||
+                existing->getPixelsSizeY(series) != metadataRetrieve->getPixelsSizeY(series) ||
+                existing->getPixelsType(series) != metadataRetrieve->getPixelsType(series))
+              {
+                boost::format fmt("Can't %1%: Image %2% size or pixel type differs");
+                fmt % action % series;
+                throw FormatException(fmt.str());
+              }
+
+            DimensionOrder dimOrder = metadataRetrieve->getPixelsDimensionOrder(series);
+            dimension_size_type sizeZ = metadataRetrieve->getPixelsSizeZ(series);
+            dimension_size_type sizeT = metadataRetrieve->getPixelsSizeT(series);
+            dimension_size_type effC = metadataRetrieve->getChannelCount(series);
+            dimension_size_type imageCount = sizeZ * sizeT * effC;
+            SeriesState& seriesMeta(seriesState.at(series));
+
+            dimension_size_type tiffDataCount = existing->getTiffDataCount(series);
+            for (dimension_size_type td = 0U; td < tiffDataCount; ++td)
+              {
+                if (existing->getUUIDValue(series, td) != fileUUID)
+                  {
+                    boost::format fmt("Can't %1%: Appending to multi-file datasets is not supported");
+                    fmt % action;
+                    throw FormatException(fmt.str());
+                  }
+
+                // Each plane is stored as a separate TiffData by
+                // this writer.
+                if (static_cast<dimension_size_type>(existing->getTiffDataPlaneCount(series, td)) != 1U)
+                  {
+                    boost::format fmt("Can't %1%: TiffData elements with a PlaneCount other than 1 are not supported");
+                    fmt % action;
+                    throw FormatException(fmt.str());
+                  }
+
+                dimension_size_type z = existing->getTiffDataFirstZ(series, td);
+                dimension_size_type t = existing->getTiffDataFirstT(series, td);
+                dimension_size_type c = existing->getTiffDataFirstC(series, td);
+                dimension_size_type ifd = existing->getTiffDataIFD(series, td);
+                if (z >= sizeZ || t >= sizeT || c >= effC || ifd >= ifdCount)
+                  {
+                    boost::format fmt("Can't %1%: Plane Z=%2% T=%3% C=%4% in IFD %5% of image %6% is outside the image being written");
+                    fmt % action % z % t % c % ifd % series;
+                    throw FormatException(fmt.str());
+                  }
+
+                dimension_size_type plane = getIndex(dimOrder, sizeZ, effC, sizeT, imageCount, z, c, t);
+                detail::OMETIFFPlane& planeMeta(seriesMeta.planes.at(plane));
+                planeMeta.file = planeFiles.add(id);
+                planeMeta.ifd = ifd;
+                planeMeta.certain = true;
+                planeMeta.status = detail::OMETIFFPlane::PRESENT;
+              }
+          }
+      }
+
       void
       OMETIFFWriter::saveComment(const boost::filesystem::path& id,
-                                 const std::string&             xml)
+                                 const std::string&             xml,
+                                 std::string::size_type         uuidpos,
+                                 const std::string&             uuid) const
       {
+        saveComment(id,
+                    [&xml, uuidpos, &uuid](std::ostream& out)
+                    {
+                      if (uuidpos == std::string::npos)
+                        out << xml;
+                      else
+                        {
+                          out.write(xml.data(), static_cast<std::streamsize>(uuidpos));
+                          out << uuid;
+                          out.write(xml.data() + uuidpos + uuid.size(),
+                                    static_cast<std::streamsize>(xml.size() - uuidpos - uuid.size()));
+                        }
+                    });
+      }
+
+      void
+      OMETIFFWriter::saveComment(const boost::filesystem::path& id,
+                                 const comment_writer&          write) const
+      {
+        tiff_map::const_iterator t = tiffs.find(id);
+        const bool appended = t != tiffs.end() && t->second.appended;
+
         // Open TIFF as a raw stream.
         boost::iostreams::stream<boost::iostreams::file_descriptor> in(id);
         in.imbue(std::locale::classic());
@@ -928,7 +2766,9 @@ namespace ome
         // Append XML text with a NUL terminator at end of file, noting the offset.
         in.seekp(0, std::ios::end);
         uint64_t descOffset = in.tellp();
-        in << xml << '\0';
+        write(in);
+        const uint64_t descSize = static_cast<uint64_t>(in.tellp()) - descOffset;
+        in << '\0';
 
         // Get number of directory entries for IFD 0.
         uint64_t entries = bigOffsets ? read_raw_uint64(in, ifd0Offset, endian) : read_raw_uint16(in, ifd0Offset, endian);
@@ -954,19 +2794,21 @@ namespace ome
               throw FormatException(fmt.str());
             }
 
+            // An appended file holds the OME-XML saved previously,
+            // which is left in place.
             uint64_t count = bigOffsets ? read_raw_uint64(in, tagOff + 4, endian) : read_raw_uint32(in, tagOff + 4, endian);
-            if (count != default_description.size() + 1)
+            if (count != default_description.size() + 1 && !appended)
               throw FormatException("TIFF ImageDescription size is incorrect");
 
             // Overwrite count and offset for the ImageDescription text.
             if (bigOffsets)
               {
-                write_raw_uint64(in, tagOff + 4, endian, xml.size() + 1);
+                write_raw_uint64(in, tagOff + 4, endian, descSize + 1);
                 write_raw_uint64(in, tagOff + 12, endian, descOffset);
               }
             else
               {
-                write_raw_uint32(in, tagOff + 4, endian, xml.size() + 1);
+                write_raw_uint32(in, tagOff + 4, endian, descSize + 1);
                 write_raw_uint32(in, tagOff + 8, endian, descOffset);
               }
           }
@@ -977,6 +2819,9 @@ namespace ome
           throw FormatException("Error writing TIFF ImageDescription tag");
 
         in.close();
+
+        if (clusteredDirectories)
+          tiff::clusterDirectories(id);
       }
 
       void
@@ -991,6 +2836,236 @@ namespace ome
         return bigTIFF;
       }
 
+      void
+      OMETIFFWriter::setResolutionCount(dimension_size_type count)
+      {
+        assertId(currentId, false);
+        resolutionCount = count ? count : 1U;
+      }
+
+      dimension_size_type
+      OMETIFFWriter::getResolutionCount() const
+      {
+        return resolutionCount;
+      }
+
+      void
+      OMETIFFWriter::setMetadataStorage(MetadataStorage storage)
+      {
+        assertId(currentId, false);
+        metadataStorage = storage;
+      }
+
+      OMETIFFWriter::MetadataStorage
+      OMETIFFWriter::getMetadataStorage() const
+      {
+        return metadataStorage;
+      }
+
+      void
+      OMETIFFWriter::setPreallocated(bool preallocate)
+      {
+        assertId(currentId, false);
+        preallocated = preallocate;
+      }
+
+      bool
+      OMETIFFWriter::getPreallocated() const
+      {
+        return preallocated;
+      }
+
+      void
+      OMETIFFWriter::setAppend(bool append)
+      {
+        assertId(currentId, false);
+        this->append = append;
+      }
+
+      bool
+      OMETIFFWriter::getAppend() const
+      {
+        return append;
+      }
+
+      void
+      OMETIFFWriter::setUpdate(bool update)
+      {
+        assertId(currentId, false);
+        this->update = update;
+      }
+
+      bool
+      OMETIFFWriter::getUpdate() const
+      {
+        return update;
+      }
+
+      void
+      OMETIFFWriter::flush()
+      {
+        if (asyncWriter)
+          asyncWriter->flush();
+      }
+
+      void
+      OMETIFFWriter::setAsyncQueueSize(dimension_size_type frames)
+      {
+        assertId(currentId, false);
+        asyncQueueSize = frames;
+      }
+
+      dimension_size_type
+      OMETIFFWriter::getAsyncQueueSize() const
+      {
+        return asyncQueueSize;
+      }
+
+      void
+      OMETIFFWriter::setDirectIO(bool direct)
+      {
+        assertId(currentId, false);
+        directIO = direct;
+      }
+
+      bool
+      OMETIFFWriter::getDirectIO() const
+      {
+        return directIO;
+      }
+
+      void
+      OMETIFFWriter::setClusteredDirectories(bool cluster)
+      {
+        assertId(currentId, false);
+        clusteredDirectories = cluster;
+      }
+
+      bool
+      OMETIFFWriter::getClusteredDirectories() const
+      {
+        return clusteredDirectories;
+      }
+
+      void
+      OMETIFFWriter::setMaxFileSize(storage_size_type size)
+      {
+        assertId(currentId, false);
+        maxFileSize = size;
+      }
+
+      storage_size_type
+      OMETIFFWriter::getMaxFileSize() const
+      {
+        return maxFileSize;
+      }
+
+      std::shared_ptr<OMETIFFWriter>
+      OMETIFFWriter::createFileWriter(const boost::filesystem::path& id,
+                                      dimension_size_type            series)
+      {
+        assertId(currentId, true);
+
+        if (series >= getSeriesCount())
+          {
+            boost::format fmt("Invalid series: %1%");
+            fmt % series;
+            throw std::logic_error(fmt.str());
+          }
+
+        if (preallocated)
+          throw FormatException("File writers may not be used with preallocated image data");
+        if (update)
+          throw FormatException("File writers may not be used when updating");
+
+        // Attempt to canonicalize the path.
+        path canonicalpath = id;
+        try
+          {
+            canonicalpath = ome::common::canonical(id);
+          }
+        catch (const std::exception&)
+          {
+          }
+
+        {
+          std::lock_guard<std::mutex> lock(joinMutex);
+          if (tiffs.find(canonicalpath) != tiffs.end() ||
+              !fileWriterIds.insert(canonicalpath).second)
+            {
+              boost::format fmt("File %1% is already being written");
+              fmt % canonicalpath;
+              throw FormatException(fmt.str());
+            }
+          ++openFileWriters;
+        }
+
+        std::shared_ptr<OMETIFFWriter> writer(std::make_shared<OMETIFFWriter>());
+        try
+          {
+            // Share the metadata and writer options.
+            writer->metadataRetrieve = omeMeta;
+            writer->originalMetadataRetrieve = originalMetadataRetrieve;
+            writer->omeMeta = omeMeta;
+            writer->baseDir = baseDir;
+            writer->firstFile = firstFile;
+            writer->flags = flags;
+            writer->compression = compression;
+            writer->compressionLevel = compressionLevel;
+            writer->predictor = predictor;
+            writer->interleaved = interleaved;
+            writer->sequential = sequential;
+            writer->framesPerSecond = framesPerSecond;
+            writer->tile_size_x = tile_size_x;
+            writer->tile_size_y = tile_size_y;
+            writer->accessProfile = accessProfile;
+            writer->encodeThreads = encodeThreads;
+            writer->executor = executor;
+            writer->sparseTiles = sparseTiles;
+            writer->packSamples = packSamples;
+            writer->recordTileStatistics = recordTileStatistics;
+            writer->recordTileChecksums = recordTileChecksums;
+            writer->statistics = statistics;
+            writer->writeCacheLimit = writeCacheLimit;
+            writer->writeCacheDirectory = writeCacheDirectory;
+            writer->memoryBudget = memoryBudget;
+            writer->bigTIFF = bigTIFF;
+            writer->resolutionCount = resolutionCount;
+            writer->metadataStorage = metadataStorage;
+            writer->maxFileSize = maxFileSize;
+            writer->asyncQueueSize = asyncQueueSize;
+
+            // No planes written yet.
+            writer->seriesState.resize(seriesState.size());
+            for (dimension_size_type s = 0U; s < seriesState.size(); ++s)
+              {
+                writer->seriesState[s].planes.resize(seriesState[s].planes.size());
+                for (auto& planeMeta : writer->seriesState[s].planes)
+                  {
+                    planeMeta.certain = true;
+                    planeMeta.status = detail::OMETIFFPlane::ABSENT;
+                  }
+              }
+
+            writer->series = series;
+            writer->plane = 0U;
+            writer->parent = this;
+            writer->setId(canonicalpath);
+          }
+        catch (...)
+          {
+            // Close the file without saving any metadata.
+            writer->parent = nullptr;
+            writer->currentId = boost::none;
+            std::lock_guard<std::mutex> lock(joinMutex);
+            fileWriterIds.erase(canonicalpath);
+            --openFileWriters;
+            throw;
+          }
+
+        return writer;
+      }
+
     }
   }
 }
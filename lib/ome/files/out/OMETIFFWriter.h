@@ -38,7 +38,15 @@
 #ifndef OME_FILES_OUT_OMETIFFWRITER_H
 #define OME_FILES_OUT_OMETIFFWRITER_H
 
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <set>
+#include <tuple>
+
 #include <boost/filesystem/path.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
 
 #include <ome/files/detail/FormatWriter.h>
 #include <ome/files/detail/OMETIFF.h>
@@ -56,6 +64,8 @@ namespace ome
 
       class TIFF;
       class IFD;
+      class ImageLayout;
+      struct IFDTemplate;
 
     }
 
@@ -67,6 +77,21 @@ namespace ome
        */
       class OMETIFFWriter : public ::ome::files::detail::FormatWriter
       {
+      public:
+        /// Storage of OME-XML metadata in multi-file datasets.
+        enum MetadataStorage
+          {
+            /// Full metadata in every TIFF file.
+            METADATA_EVERY_FILE,
+            /// Full metadata in the first TIFF file only; the others
+            /// refer to it with BinaryOnly metadata.
+            METADATA_FIRST_FILE,
+            /// Full metadata in a companion (.companion.ome) file;
+            /// every TIFF file refers to it with BinaryOnly
+            /// metadata.
+            METADATA_COMPANION_FILE
+          };
+
       protected:
         /// Message logger.
         ome::common::Logger logger;
@@ -74,6 +99,15 @@ namespace ome
         /// Map filename to UUID.
         typedef std::map<boost::filesystem::path, std::string> file_uuid_map;
 
+        /// Sub-resolution pyramid for the current plane.
+        class Pyramid;
+
+        /// File opened for direct I/O.
+        class DirectFile;
+
+        /// Staging queue for asynchronous writes.
+        class AsyncWriter;
+
         // In the Java reader, this is uuids + ifdCounts
         /// State of TIFF file.
         struct TIFFState
@@ -84,6 +118,14 @@ namespace ome
           std::shared_ptr<ome::files::tiff::TIFF> tiff;
           /// Number of IFDs written.
           dimension_size_type ifdCount;
+          /// Sub-resolutions for the current IFD, if any.
+          std::shared_ptr<Pyramid> pyramid;
+          /// Writable mapping of the file, if preallocated.
+          std::shared_ptr<boost::iostreams::mapped_file> mapping;
+          /// Direct I/O file, if preallocated with direct I/O.
+          std::shared_ptr<DirectFile> direct;
+          /// The file existed and is being appended to.
+          bool appended;
 
           /**
            * Constructor.
@@ -105,6 +147,8 @@ namespace ome
         {
           /// Current state of each plane in an image series.
           std::vector<detail::OMETIFFPlane> planes;
+          /// Layout of each plane, if preallocated.
+          std::vector<std::shared_ptr<const tiff::ImageLayout>> layouts;
         };
 
         /// Vector of SeriesState objects.
@@ -120,6 +164,9 @@ namespace ome
         /// Open TIFF files
         mutable tiff_map tiffs;
 
+        /// Files referenced by written planes.
+        detail::OMETIFFFileTable planeFiles;
+
         /// Current TIFF file.
         tiff_map::iterator currentTIFF;
 
@@ -147,6 +194,74 @@ namespace ome
         /// Write a Big TIFF
         boost::optional<bool> bigTIFF;
 
+        /// Number of resolutions to write for each plane.
+        dimension_size_type resolutionCount;
+
+        /// Storage of OME-XML metadata.
+        MetadataStorage metadataStorage;
+
+        /// First TIFF file of the dataset.
+        boost::filesystem::path firstFile;
+
+        /// Preallocate the image data on setId().
+        bool preallocated;
+
+        /// Write preallocated image data with direct I/O.
+        bool directIO;
+
+        /// Cluster the directories at the start of each file on close().
+        bool clusteredDirectories;
+
+        /// Append to an existing file on setId().
+        bool append;
+
+        /// Update the image data of an existing file on setId().
+        bool update;
+
+        /// Size at which to continue writing in a new file (0 for no limit).
+        storage_size_type maxFileSize;
+
+        /// File named on the last setId() other than by rollover.
+        boost::filesystem::path rolloverBase;
+
+        /// Number of files created by rollover from rolloverBase.
+        dimension_size_type rolloverCount;
+
+        /// Writer which created this file writer, if any.
+        OMETIFFWriter *parent;
+
+        /// Lock for the files and plane state joined by file writers.
+        std::mutex joinMutex;
+
+        /// Files written by file writers.
+        std::set<boost::filesystem::path> fileWriterIds;
+
+        /// Number of file writers which have not been closed.
+        dimension_size_type openFileWriters;
+
+        /// Writer state determining the structure of an IFD.
+        typedef std::tuple<dimension_size_type,                  // series
+                           dimension_size_type,                  // samples per pixel
+                           boost::optional<dimension_size_type>, // tile width
+                           boost::optional<dimension_size_type>, // tile height
+                           boost::optional<bool>,                // interleaved
+                           boost::optional<std::string>,         // compression
+                           boost::optional<int>,                 // compression level
+                           boost::optional<bool>>                // predictor
+        ifd_template_key;
+
+        /// IFD structure of the last plane set up.
+        mutable std::shared_ptr<const tiff::IFDTemplate> ifdTemplate;
+
+        /// Writer state for which ifdTemplate was set up.
+        mutable ifd_template_key ifdTemplateKey;
+
+        /// Number of frames staged for asynchronous writing (0 to write synchronously).
+        dimension_size_type asyncQueueSize;
+
+        /// Staging queue, if writing asynchronously.
+        std::shared_ptr<AsyncWriter> asyncWriter;
+
       public:
         /// Constructor.
         OMETIFFWriter();
@@ -182,6 +297,26 @@ namespace ome
         getTileSizeY() const;
 
       protected:
+        /**
+         * Get the existing IFD of a plane being updated.
+         *
+         * @param plane the plane index in the current series.
+         * @returns the IFD containing the plane.
+         * @throws FormatException if the plane is not present in the
+         * file.
+         */
+        std::shared_ptr<tiff::IFD>
+        updateIFD(dimension_size_type plane) const;
+
+        /**
+         * Check if saved regions are staged for asynchronous writing.
+         *
+         * @returns @c true if writing asynchronously, other than
+         * from the background thread.
+         */
+        bool
+        staging() const;
+
         /// Flush current IFD and create new IFD.
         void
         nextIFD() const;
@@ -190,7 +325,90 @@ namespace ome
         void
         setupIFD() const;
 
+        /**
+         * Set IFD parameters for an image of the current series.
+         *
+         * @param ifd the IFD to set up.
+         * @param sizeX the image width.
+         * @param sizeY the image height.
+         */
+        void
+        setupIFD(tiff::IFD&          ifd,
+                 dimension_size_type sizeX,
+                 dimension_size_type sizeY) const;
+
+        /**
+         * Write the sub-resolutions of the last IFD as SubIFDs.
+         *
+         * @param state the TIFF state for the last IFD.
+         */
+        void
+        writeSubResolutions(TIFFState& state) const;
+
+        /**
+         * Reserve the image data for every plane of every series.
+         *
+         * An IFD is written for each plane with its image data
+         * reserved, and the file is then mapped for writing the
+         * pixel data.
+         *
+         * @throws FormatException if the writer options are not
+         * compatible with preallocation.
+         */
+        void
+        preallocate();
+
+        /**
+         * Check if the next plane should be written to a new file.
+         *
+         * @returns @c true if a maximum file size is set and the
+         * current file, with at least one plane written, has reached
+         * it.
+         */
+        bool
+        rolloverRequired() const;
+
+        /**
+         * Continue writing in a new file.
+         *
+         * The file is named after the last file set with setId(),
+         * with a numbered suffix before the extension, for example
+         * @c image_1.ome.tif following @c image.ome.tif, and its
+         * first IFD is set up for the current plane.
+         */
+        void
+        rollover();
+
+        /**
+         * Get the expected size of the pixel data of a file.
+         *
+         * @returns the total pixel data size, or with a maximum file
+         * size, the smaller of this and the maximum file size plus
+         * the largest plane.
+         */
+        storage_size_type
+        expectedFileSize() const;
+
+        /**
+         * Join the files and plane state of a closed file writer.
+         *
+         * The TIFF files of the file writer are transferred to this
+         * writer, to have their metadata saved on close(), and the
+         * state of each plane it saved is set.
+         *
+         * @param writer the file writer to join.
+         * @throws FormatException if a plane was also saved by this
+         * writer or another file writer.
+         */
+        void
+        joinFileWriter(OMETIFFWriter& writer);
+
       public:
+        // Documented in superclass.
+        void
+        saveBytes(dimension_size_type plane,
+                  VariantPixelBuffer& buf);
+
         // Documented in superclass.
         void
         saveBytes(dimension_size_type plane,
@@ -200,6 +418,88 @@ namespace ome
                   dimension_size_type w,
                   dimension_size_type h);
 
+        /**
+         * Save an image plane, adopting the pixel buffer.
+         *
+         * As for saveBytes(), but if writing asynchronously, the
+         * buffer is moved into the staging queue rather than
+         * copied.  Only a buffer owning its storage is adopted; a
+         * buffer over external storage, such as a camera ring
+         * buffer, is copied as for saveBytes().  The caller must not
+         * modify adopted pixel data afterward, including through any
+         * other buffer sharing it.
+         *
+         * @param plane the plane index within the series.
+         * @param buf the source pixel buffer.
+         * @throws FormatException if any of the parameters are invalid.
+         */
+        void
+        saveBytes(dimension_size_type   plane,
+                  VariantPixelBuffer&& buf);
+
+        /**
+         * Save a sub-image of an image plane, adopting the pixel
+         * buffer.
+         *
+         * As for saveBytes(), but if writing asynchronously, the
+         * buffer is moved into the staging queue rather than
+         * copied.  Only a buffer owning its storage is adopted; a
+         * buffer over external storage, such as a camera ring
+         * buffer, is copied as for saveBytes().  The caller must not
+         * modify adopted pixel data afterward, including through any
+         * other buffer sharing it.
+         *
+         * @param plane the plane index within the series.
+         * @param buf the source pixel buffer.
+         * @param x the @c X coordinate of the upper-left corner of the sub-image.
+         * @param y the @c Y coordinate of the upper-left corner of the sub-image.
+         * @param w the width of the sub-image.
+         * @param h the height of the sub-image.
+         * @throws FormatException if any of the parameters are invalid.
+         */
+        void
+        saveBytes(dimension_size_type   plane,
+                  VariantPixelBuffer&& buf,
+                  dimension_size_type   x,
+                  dimension_size_type   y,
+                  dimension_size_type   w,
+                  dimension_size_type   h);
+
+        /**
+         * Wait for all staged frames to be written.
+         *
+         * If writing asynchronously, this blocks until the staging
+         * queue is empty and the last frame has been written.  It
+         * does nothing if writing synchronously.
+         *
+         * @throws the first error raised while writing a staged
+         * frame, if any.
+         */
+        void
+        flush();
+
+        /**
+         * Save a block of image planes.
+         *
+         * If the planes of the block are not in the storage order of
+         * the IFDs (the subchannels are interleaved differently),
+         * each plane is converted on a separate thread while the
+         * previous plane is encoded and written.
+         *
+         * @param plane the index of the first plane of the block.
+         * @param buf the source pixel buffer.
+         * @throws FormatException if any of the parameters are invalid.
+         */
+        void
+        savePlanes(dimension_size_type plane,
+                   VariantPixelBuffer& buf);
+
+        // Documented in superclass.
+        bool
+        copyBytes(dimension_size_type plane,
+                  const ::ome::files::FormatReader& reader,
+                  dimension_size_type sourcePlane);
+
       private:
         /**
          * Fill MetadataStore with cached metadata.
@@ -218,15 +518,102 @@ namespace ome
         std::string
         getOMEXML(const boost::filesystem::path& id);
 
+        /**
+         * Get BinaryOnly OME-XML for embedding into the specified TIFF
+         * file.
+         *
+         * @param id the TIFF in which to embed the OME-XML.
+         * @param metadataFile the file containing the full metadata.
+         * @param metadataUUID the UUID of the metadata file.
+         * @returns the OME-XML text for embedding.
+         */
+        std::string
+        getBinaryOnlyOMEXML(const boost::filesystem::path& id,
+                            const boost::filesystem::path& metadataFile,
+                            const std::string&             metadataUUID);
+
+        /**
+         * Save the OME-XML metadata for all TIFF files.
+         *
+         * The metadata is stored as specified by the metadata storage
+         * setting.  The TIFF files are closed, and the metadata
+         * saved, concurrently for several files.
+         */
+        void
+        saveMetadata();
+
+        /**
+         * Load the planes present in an existing file for appending.
+         *
+         * The OME-XML metadata in the first IFD of the file is
+         * checked against the metadata being written, and the planes
+         * referenced by its TiffData elements are marked as present.
+         *
+         * @param id the file to append to.
+         * @param uuid the UUID of the file, set on return.
+         * @param ifdCount the number of IFDs in the file, set on
+         * return.
+         * @throws FormatException if the file was not written as a
+         * single-file OME-TIFF, or its images differ from the
+         * metadata being written.
+         */
+        void
+        loadAppendedPlanes(const boost::filesystem::path& id,
+                           std::string&                   uuid,
+                           dimension_size_type&           ifdCount);
+
         /**
          * Save OME-XML text in the first IFD of the specified TIFF file.
          *
+         * The text may be saved with a UUID substituted for the UUID
+         * at the specified offset, so that the same text may be
+         * shared between several files.  This may be called
+         * concurrently for different files.
+         *
          * @param id the TIFF in which to embed the OME-XML.
          * @param xml the OME-XML text to embed.
+         * @param uuidpos the offset of the UUID to replace, or npos
+         * to save the text unmodified.
+         * @param uuid the replacement UUID, of the same length as
+         * the UUID replaced.
          */
         void
         saveComment(const boost::filesystem::path& id,
-                    const std::string&             xml);
+                    const std::string&             xml,
+                    std::string::size_type         uuidpos = std::string::npos,
+                    const std::string&             uuid = std::string()) const;
+
+        /// Function writing OME-XML text to a stream.
+        typedef std::function<void (std::ostream&)> comment_writer;
+
+        /**
+         * Save OME-XML text in the first IFD of the specified TIFF file.
+         *
+         * The text is written directly into the file by the
+         * specified function, so that it need not be held in
+         * memory.  This may be called concurrently for different
+         * files.
+         *
+         * @param id the TIFF in which to embed the OME-XML.
+         * @param write the function writing the OME-XML text.
+         */
+        void
+        saveComment(const boost::filesystem::path& id,
+                    const comment_writer&          write) const;
+
+        /**
+         * Get a function streaming OME-XML from the metadata model.
+         *
+         * The OME-XML is written with writeOMEXML(), without
+         * modifying the metadata.
+         *
+         * @param id the TIFF in which to embed the OME-XML.
+         * @param uuid the UUID of the TIFF.
+         * @returns the function writing the OME-XML text.
+         */
+        comment_writer
+        streamComment(const boost::filesystem::path& id,
+                      const std::string&             uuid) const;
 
         // Java getUUID unimplemented; see uuid member of TIFFState.
 
@@ -247,6 +634,350 @@ namespace ome
          */
         boost::optional<bool>
         getBigTIFF() const;
+
+        /**
+         * Set the number of resolutions to write for each plane.
+         *
+         * If greater than one, each plane is followed by a pyramid
+         * of sub-resolution images stored as SubIFDs of the plane
+         * IFD, each half the size of the previous resolution.  The
+         * sub-resolutions are downsampled in a background thread as
+         * regions of the full-resolution plane are saved, and are
+         * written when the plane is complete.  This permits viewers
+         * to display an image at any zoom level without reading the
+         * full-resolution plane.
+         *
+         * This must be called before setId().
+         *
+         * @param count the number of resolutions, including the full
+         * resolution; 0 is treated as 1.
+         */
+        void
+        setResolutionCount(dimension_size_type count);
+
+        /**
+         * Get the number of resolutions to write for each plane.
+         *
+         * @returns the number of resolutions, including the full
+         * resolution (default 1).
+         */
+        dimension_size_type
+        getResolutionCount() const;
+
+        /**
+         * Set the storage of OME-XML metadata.
+         *
+         * By default, the full OME-XML metadata is stored in every
+         * TIFF file, so that any file may be opened independently.
+         * For datasets with many files or large metadata, this is a
+         * significant cost on close(), so the full metadata may
+         * instead be stored in the first TIFF file or in a companion
+         * file, with the other files referring to it with small
+         * BinaryOnly metadata.  The companion file name is that of
+         * the first TIFF file with the suffix replaced by
+         * "companion.ome".
+         *
+         * This must be called before setId().
+         *
+         * @param storage the metadata storage.
+         */
+        void
+        setMetadataStorage(MetadataStorage storage);
+
+        /**
+         * Get the storage of OME-XML metadata.
+         *
+         * @returns the metadata storage (default METADATA_EVERY_FILE).
+         */
+        MetadataStorage
+        getMetadataStorage() const;
+
+        /**
+         * Set preallocation of the image data.
+         *
+         * If enabled, setId() writes an IFD for every plane of
+         * every series, with space reserved for its uncompressed
+         * image data, and maps the file for writing.  saveBytes()
+         * then copies the pixel data directly into the file, with
+         * no further use of libtiff, so it may be called
+         * concurrently from several threads for different planes,
+         * or disjoint regions of the same plane, of the current
+         * series.  Planes may be saved in any order; any part of a
+         * plane which is not saved is zero.
+         *
+         * Preallocation requires a single file, no compression or
+         * predictor, a single resolution and samples of whole
+         * bytes.
+         *
+         * This must be called before setId().
+         *
+         * @param preallocate @c true to preallocate, or @c false to
+         * write each IFD as its planes are saved.
+         */
+        void
+        setPreallocated(bool preallocate);
+
+        /**
+         * Get preallocation of the image data.
+         *
+         * @returns @c true if preallocating (default @c false).
+         */
+        bool
+        getPreallocated() const;
+
+        /**
+         * Set appending to an existing file.
+         *
+         * If enabled, and the file passed to setId() exists, it is
+         * opened for appending rather than replaced.  The planes
+         * already present in the file are found from its OME-XML
+         * metadata, and new IFDs are linked to the end of its IFD
+         * chain, so that no existing image data is rewritten.
+         * Writing continues with the first plane, in series and
+         * plane order, which is not present; the metadata set with
+         * setMetadataRetrieve() may describe more planes than the
+         * file contains, for example additional timepoints.  On
+         * close(), the updated OME-XML is appended to the file and
+         * the ImageDescription of the first IFD repointed to it.
+         *
+         * Appending requires a single-file OME-TIFF with the OME-XML
+         * metadata stored in the file, with the same number of
+         * images, and the same image size and pixel type for each
+         * image, as the metadata being written.  It may not be
+         * combined with preallocation.  If the file does not exist,
+         * it is created as usual.
+         *
+         * This must be called before setId().
+         *
+         * @param append @c true to append to an existing file, or
+         * @c false to replace it.
+         */
+        void
+        setAppend(bool append);
+
+        /**
+         * Get appending to an existing file.
+         *
+         * @returns @c true if appending (default @c false).
+         */
+        bool
+        getAppend() const;
+
+        /**
+         * Set updating the image data of an existing file.
+         *
+         * If enabled, the file passed to setId() must exist, and is
+         * opened for modification rather than replaced.  The planes
+         * present in the file are found from its OME-XML metadata,
+         * as for setAppend().  saveBytes() then rewrites only the
+         * tiles or strips touched by each region saved, merging the
+         * region with their existing content.  Each is written over
+         * its old data if the newly compressed tile fits, or
+         * appended to the end of the file, with its offset
+         * repointed, otherwise.  All other tiles, the IFDs and the
+         * OME-XML metadata are left unchanged, and no metadata is
+         * written on close().  This permits editing a small region
+         * of a large image, such as a label mask, without rewriting
+         * the whole file.
+         *
+         * Updating requires a single-file OME-TIFF with the OME-XML
+         * metadata stored in the file, with the same number of
+         * images, and the same image size and pixel type for each
+         * image, as the metadata set with setMetadataRetrieve().
+         * Images with sub-resolutions, tile checksums or tile
+         * statistics may not be updated, since these would no
+         * longer match the image data.  Updating may not be combined
+         * with preallocation, appending, file rollover or file
+         * writers.
+         *
+         * This must be called before setId().
+         *
+         * @param update @c true to update an existing file, or
+         * @c false to replace it.
+         */
+        void
+        setUpdate(bool update);
+
+        /**
+         * Get updating the image data of an existing file.
+         *
+         * @returns @c true if updating (default @c false).
+         */
+        bool
+        getUpdate() const;
+
+        /**
+         * Set the number of frames staged for asynchronous writing.
+         *
+         * If nonzero, saveBytes() copies the region into a staging
+         * queue of this many frames and returns at once, and a
+         * background thread packs, compresses and writes the queued
+         * regions in the order they were saved.  Two frames
+         * double-buffer the writes, and more absorb longer storage
+         * stalls at the cost of memory.  If the queue is full,
+         * saveBytes() blocks until a frame has been written.
+         * Staging buffers are reused once written, and are taken
+         * from the memory budget, if set.
+         *
+         * An error while writing a staged frame is raised by the
+         * next call to saveBytes(), flush() or close(), and further
+         * frames are discarded.  The plane to save is given to
+         * saveBytes(); setId(), setSeries(), setPlane(),
+         * savePlanes(), copyBytes(), getTileSizeX() and
+         * getTileSizeY() first wait for the staged frames to be
+         * written, as does close().
+         *
+         * This must be called before setId().
+         *
+         * @param frames the staging queue size, or 0 to write
+         * synchronously.
+         */
+        void
+        setAsyncQueueSize(dimension_size_type frames);
+
+        /**
+         * Get the number of frames staged for asynchronous writing.
+         *
+         * @returns the staging queue size, or 0 if writing
+         * synchronously (the default).
+         */
+        dimension_size_type
+        getAsyncQueueSize() const;
+
+        /**
+         * Set direct I/O for writing the image data.
+         *
+         * If enabled, preallocated image data is written with
+         * direct I/O (@c O_DIRECT), bypassing the page cache, so that
+         * writing large volumes of data does not evict other cached
+         * data.  Each tile or strip is padded to start at a multiple
+         * of TileBuffer::direct_io_alignment bytes, and every tile or
+         * strip wholly within the region passed to saveBytes() is
+         * written from an aligned buffer.  Tiles or strips which are
+         * only partly saved by a single call, the IFDs and the
+         * OME-XML metadata are written with normal buffered I/O.
+         *
+         * Direct I/O requires preallocation (see
+         * setPreallocated()).  If direct I/O is not supported by the
+         * system or filesystem, the image data is written with
+         * buffered I/O.
+         *
+         * This must be called before setId().
+         *
+         * @param direct @c true to use direct I/O, or @c false to
+         * use buffered I/O.
+         */
+        void
+        setDirectIO(bool direct);
+
+        /**
+         * Get direct I/O for writing the image data.
+         *
+         * @returns @c true if using direct I/O (default @c false).
+         */
+        bool
+        getDirectIO() const;
+
+        /**
+         * Set clustering of the directories at the start of each file.
+         *
+         * By default, each IFD is written after the image data it
+         * describes, and the OME-XML metadata is appended to the
+         * end of the file on close(), so a reader must make many
+         * small reads across the whole file to find the
+         * directories.  For files read from remote (cloud) storage,
+         * where each read is a separate request, this dominates the
+         * cost of opening the file.
+         *
+         * If enabled, each TIFF file is rewritten on close() so that
+         * the header is followed by all the IFDs with their tile or
+         * strip offset and byte count arrays, and then the OME-XML
+         * metadata, with the image data following (see
+         * tiff::clusterDirectories()).  A reader may then fetch all
+         * the directory metadata with one or two large reads.  This
+         * requires space for a temporary copy of each file.
+         *
+         * This must be called before setId().
+         *
+         * @param cluster @c true to cluster the directories, or
+         * @c false to leave them after the image data.
+         */
+        void
+        setClusteredDirectories(bool cluster);
+
+        /**
+         * Get clustering of the directories at the start of each file.
+         *
+         * @returns @c true if clustering (default @c false).
+         */
+        bool
+        getClusteredDirectories() const;
+
+        /**
+         * Set the maximum size of each TIFF file.
+         *
+         * If set, a new file is started for the next plane once the
+         * current file reaches this size, as if changeOutputFile()
+         * had been called.  The new files are named after the file
+         * passed to setId() or changeOutputFile(), with a numbered
+         * suffix before the extension (@c image.ome.tif,
+         * @c image_1.ome.tif, @c image_2.ome.tif, ...).  The UUID and
+         * TiffData elements referencing each file are filled in on
+         * close(), as for files set by the caller.  Every file holds
+         * at least one plane, so a file exceeds the maximum size by
+         * up to one plane and its IFD; BigTIFF is enabled for each
+         * file from this bound rather than from the size of the
+         * whole dataset (see setBigTIFF()).
+         *
+         * File writers (see createFileWriter()) also roll over,
+         * numbering new files after their own file.  Rollover may
+         * not be combined with preallocation or appending.
+         *
+         * This must be called before setId().
+         *
+         * @param size the maximum file size (bytes), or 0 for no
+         * limit.
+         */
+        void
+        setMaxFileSize(storage_size_type size);
+
+        /**
+         * Get the maximum size of each TIFF file.
+         *
+         * @returns the maximum file size (bytes), or 0 for no limit
+         * (the default).
+         */
+        storage_size_type
+        getMaxFileSize() const;
+
+        /**
+         * Create a writer for another file of this dataset.
+         *
+         * The file writer has its own TIFF file and IFD sequence,
+         * and shares the metadata and writer options of this
+         * writer.  It is positioned at the first plane of the
+         * specified series, and planes are saved with setSeries(),
+         * setPlane() and saveBytes() as for this writer.  Since no
+         * state is shared while saving, each file writer may be used
+         * concurrently from a different thread, for example to
+         * write each well of a plate to a separate file.
+         *
+         * On close(), the file writer writes its last IFD and joins
+         * its file and plane state to this writer, which saves the
+         * metadata for all files when it is closed.  Every file
+         * writer must be closed before this writer is closed.
+         *
+         * @param id the file to write.
+         * @param series the first series to write.
+         * @returns the file writer.
+         * @throws std::logic_error if setId() has not been called or
+         * the series is invalid.
+         * @throws FormatException if the image data is preallocated,
+         * or the file is already being written.
+         */
+        std::shared_ptr<OMETIFFWriter>
+        createFileWriter(const boost::filesystem::path& id,
+                         dimension_size_type            series);
       };
 
     }
@@ -0,0 +1,658 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2014 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <set>
+#include <sstream>
+
+#include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/format.hpp>
+
+#include <ome/files/FormatException.h>
+#include <ome/files/MetadataTools.h>
+#include <ome/files/PixelBufferView.h>
+#include <ome/files/PixelCopy.h>
+#include <ome/files/PixelProperties.h>
+#include <ome/files/TileBuffer.h>
+#include <ome/files/VariantPixelBuffer.h>
+#include <ome/files/out/OMEZarrWriter.h>
+
+#include <ome/common/endian.h>
+
+#include <ome/xml/meta/OMEXMLMetadata.h>
+
+using boost::filesystem::path;
+
+using ome::files::detail::WriterProperties;
+using ome::xml::model::enums::PixelType;
+using ome::xml::meta::OMEXMLMetadata;
+
+namespace ome
+{
+  namespace files
+  {
+    namespace out
+    {
+
+      namespace
+      {
+
+        WriterProperties
+        zarr_properties()
+        {
+          WriterProperties p("OME-Zarr",
+                             "OME Next Generation File Format (Zarr)");
+
+          p.suffixes = {"zarr"};
+          p.stacks = true;
+
+          // Uncompressed by default, or zlib.
+          const std::set<std::string> codecset{"default", "zlib"};
+          p.compression_types = codecset;
+          const PixelType::value_map_type& pv = PixelType::values();
+          for (PixelType::value_map_type::const_iterator i = pv.begin();
+               i != pv.end();
+               ++i)
+            p.pixel_compression_types.insert(WriterProperties::pixel_compression_type_map::value_type(i->first, codecset));
+
+          return p;
+        }
+
+        const WriterProperties props(zarr_properties());
+
+        // Default chunk width and height.
+        const dimension_size_type DEFAULT_CHUNK_SIZE = 1024U;
+
+        // Default zlib compression level (as for zlib itself).
+        const int DEFAULT_ZLIB_LEVEL = 6;
+
+        // Zarr data type of a pixel type, in native byte order.
+        std::string
+        zarrDataType(PixelType type)
+        {
+          const char order = (boost::endian::order::native == boost::endian::order::little) ? '<' : '>';
+
+          std::string dtype;
+          switch(type)
+            {
+            case PixelType::INT8:
+              dtype = "|i1";
+              break;
+            case PixelType::INT16:
+              dtype = "<i2";
+              break;
+            case PixelType::INT32:
+              dtype = "<i4";
+              break;
+            case PixelType::UINT8:
+              dtype = "|u1";
+              break;
+            case PixelType::UINT16:
+              dtype = "<u2";
+              break;
+            case PixelType::UINT32:
+              dtype = "<u4";
+              break;
+            case PixelType::FLOAT:
+              dtype = "<f4";
+              break;
+            case PixelType::DOUBLE:
+              dtype = "<f8";
+              break;
+            case PixelType::COMPLEXFLOAT:
+              dtype = "<c8";
+              break;
+            case PixelType::COMPLEXDOUBLE:
+              dtype = "<c16";
+              break;
+            case PixelType::BIT:
+              dtype = "|b1";
+              break;
+            default:
+              {
+                boost::format fmt("Unsupported pixel type %1%");
+                fmt % type;
+                throw FormatException(fmt.str());
+              }
+              break;
+            }
+
+          if (dtype[0] == '<')
+            dtype[0] = order;
+          return dtype;
+        }
+
+        // Zarr fill value for a pixel type.
+        const char *
+        zarrFillValue(PixelType type)
+        {
+          switch(type)
+            {
+            case PixelType::BIT:
+              return "false";
+            case PixelType::COMPLEXFLOAT:
+            case PixelType::COMPLEXDOUBLE:
+              return "null";
+            default:
+              return "0";
+            }
+        }
+
+        // Replace a file with new content.  The content is written
+        // to a temporary file which is then renamed, so that
+        // concurrent readers and writers never see a partial file.
+        void
+        replaceFile(const path& file,
+                    const char *data,
+                    std::size_t size)
+        {
+          path temp(file);
+          temp += boost::filesystem::unique_path(".%%%%-%%%%-%%%%.partial");
+
+          {
+            boost::filesystem::ofstream out(temp, std::ios::binary | std::ios::trunc);
+            out.write(data, static_cast<std::streamsize>(size));
+            out.close();
+            if (!out)
+              {
+                boost::format fmt("Failed to write %1%");
+                fmt % temp.string();
+                throw FormatException(fmt.str());
+              }
+          }
+
+          boost::filesystem::rename(temp, file);
+        }
+
+        void
+        replaceFile(const path&        file,
+                    const std::string& content)
+        {
+          replaceFile(file, content.data(), content.size());
+        }
+
+        // Group metadata.
+        const std::string zgroup("{\n  \"zarr_format\" : 2\n}\n");
+
+        // Copy a region of a buffer into a chunk.
+        struct ChunkVisitor : public boost::static_visitor<>
+        {
+          uint8_t             *chunk;
+          dimension_size_type  chunkX;
+          dimension_size_type  bufX;
+          dimension_size_type  bufY;
+          dimension_size_type  sample;
+          dimension_size_type  chunkOffsetX;
+          dimension_size_type  chunkOffsetY;
+          dimension_size_type  w;
+          dimension_size_type  h;
+
+          ChunkVisitor(uint8_t             *chunk,
+                       dimension_size_type  chunkX,
+                       dimension_size_type  bufX,
+                       dimension_size_type  bufY,
+                       dimension_size_type  sample,
+                       dimension_size_type  chunkOffsetX,
+                       dimension_size_type  chunkOffsetY,
+                       dimension_size_type  w,
+                       dimension_size_type  h):
+            chunk(chunk),
+            chunkX(chunkX),
+            bufX(bufX),
+            bufY(bufY),
+            sample(sample),
+            chunkOffsetX(chunkOffsetX),
+            chunkOffsetY(chunkOffsetY),
+            w(w),
+            h(h)
+          {}
+
+          template<typename T>
+          void
+          operator()(const T& v)
+          {
+            typedef typename T::element_type::value_type value_type;
+
+            PixelBufferView<const value_type> view(*v);
+
+            PixelBufferBase::indices_type idx;
+            idx.fill(0);
+            idx[DIM_SPATIAL_X] = static_cast<PixelBufferBase::index>(bufX);
+            idx[DIM_SPATIAL_Y] = static_cast<PixelBufferBase::index>(bufY);
+            idx[DIM_SUBCHANNEL] = static_cast<PixelBufferBase::index>(sample);
+
+            region_strides_type strides;
+            strides.fill(0);
+            strides[DIM_SPATIAL_X] = 1;
+            strides[DIM_SPATIAL_Y] = static_cast<PixelBufferBase::index>(chunkX);
+
+            region_shape_type shape;
+            shape.fill(1U);
+            shape[DIM_SPATIAL_X] = w;
+            shape[DIM_SPATIAL_Y] = h;
+
+            value_type *dest = reinterpret_cast<value_type *>(chunk) +
+              (chunkOffsetY * chunkX) + chunkOffsetX;
+            copyStrided(view.pointer(idx), view.strides(), dest, strides, shape);
+          }
+        };
+
+      }
+
+      OMEZarrWriter::OMEZarrWriter():
+        ::ome::files::detail::FormatWriter(props),
+        logger(ome::common::createLogger("OMEZarrWriter")),
+        layouts(),
+        chunkLocks()
+      {
+      }
+
+      OMEZarrWriter::~OMEZarrWriter()
+      {
+        try
+          {
+            close();
+          }
+        catch (...)
+          {
+          }
+      }
+
+      void
+      OMEZarrWriter::setId(const boost::filesystem::path& id)
+      {
+        // Chunks are compressed with the Deflate tile codec, since
+        // the Zarr zlib compressor uses the same stream format.
+        std::shared_ptr<const tiff::TileCodec> codec;
+        int level = DEFAULT_ZLIB_LEVEL;
+        const boost::optional<std::string> compression(getCompression());
+        if (compression && *compression == "zlib")
+          {
+            codec = tiff::getTileCodec(tiff::COMPRESSION_DEFLATE);
+            if (!codec)
+              throw FormatException("No tile codec is registered for Deflate compression");
+
+            const boost::optional<int> clevel(getCompressionLevel());
+            if (clevel)
+              {
+                if (*clevel < 0 || *clevel > 9)
+                  {
+                    boost::format fmt("Compression level %1% invalid for zlib compression: valid levels are 0–9");
+                    fmt % *clevel;
+                    throw FormatException(fmt.str());
+                  }
+                level = *clevel;
+              }
+          }
+
+        FormatWriter::setId(id);
+
+        // Compute the array layout of each series.
+        layouts.clear();
+        const dimension_size_type seriesCount = getSeriesCount();
+        for (dimension_size_type s = 0U; s < seriesCount; ++s)
+          {
+            this->series = s;
+
+            SeriesLayout layout;
+            layout.path = *currentId / std::to_string(s) / "0";
+            layout.type = getPixelType();
+            layout.bytes = bytesPerPixel(layout.type);
+            layout.sizeX = getSizeX();
+            layout.sizeY = getSizeY();
+            layout.sizeZ = getSizeZ();
+            layout.sizeT = getSizeT();
+            layout.planes = getImageCount();
+            layout.sizeC = 0U;
+            for (dimension_size_type c = 0U; c < getEffectiveSizeC(); ++c)
+              {
+                const dimension_size_type samples = getRGBChannelCount(c);
+                layout.channelStart.push_back(layout.sizeC);
+                layout.channelSamples.push_back(samples);
+                layout.sizeC += samples;
+              }
+            layout.chunkX = (this->tile_size_x && *this->tile_size_x) ?
+              *this->tile_size_x : std::min(layout.sizeX, DEFAULT_CHUNK_SIZE);
+            layout.chunkY = (this->tile_size_y && *this->tile_size_y) ?
+              *this->tile_size_y : std::min(layout.sizeY, DEFAULT_CHUNK_SIZE);
+            layout.mapper = getDimensionIndexMapper();
+            layout.codec = codec;
+            layout.level = level;
+
+            layouts.push_back(layout);
+          }
+        this->series = 0U;
+        this->plane = 0U;
+
+        writeMetadata();
+      }
+
+      void
+      OMEZarrWriter::close(bool fileOnly)
+      {
+        layouts.clear();
+        detail::FormatWriter::close(fileOnly);
+      }
+
+      void
+      OMEZarrWriter::setSeries(dimension_size_type series) const
+      {
+        assertId(currentId, true);
+
+        if (series >= getSeriesCount())
+          {
+            boost::format fmt("Invalid series: %1%");
+            fmt % series;
+            throw std::logic_error(fmt.str());
+          }
+
+        this->series = series;
+        this->plane = 0U;
+      }
+
+      void
+      OMEZarrWriter::setPlane(dimension_size_type plane) const
+      {
+        assertId(currentId, true);
+
+        if (plane >= getImageCount())
+          {
+            boost::format fmt("Invalid plane: %1%");
+            fmt % plane;
+            throw std::logic_error(fmt.str());
+          }
+
+        this->plane = plane;
+      }
+
+      dimension_size_type
+      OMEZarrWriter::getTileSizeX() const
+      {
+        if (currentId && getSeries() < layouts.size())
+          return layouts[getSeries()].chunkX;
+        return detail::FormatWriter::getTileSizeX();
+      }
+
+      dimension_size_type
+      OMEZarrWriter::getTileSizeY() const
+      {
+        if (currentId && getSeries() < layouts.size())
+          return layouts[getSeries()].chunkY;
+        return detail::FormatWriter::getTileSizeY();
+      }
+
+      void
+      OMEZarrWriter::saveBytes(dimension_size_type plane,
+                               VariantPixelBuffer& buf,
+                               dimension_size_type x,
+                               dimension_size_type y,
+                               dimension_size_type w,
+                               dimension_size_type h)
+      {
+        assertId(currentId, true);
+
+        setPlane(plane);
+        saveRegion(getSeries(), plane, buf, x, y, w, h);
+      }
+
+      void
+      OMEZarrWriter::saveRegion(dimension_size_type       series,
+                                dimension_size_type       plane,
+                                const VariantPixelBuffer& buf,
+                                dimension_size_type       x,
+                                dimension_size_type       y,
+                                dimension_size_type       w,
+                                dimension_size_type       h) const
+      {
+        assertId(currentId, true);
+
+        if (series >= layouts.size())
+          {
+            boost::format fmt("Invalid series: %1%");
+            fmt % series;
+            throw FormatException(fmt.str());
+          }
+        const SeriesLayout& layout(layouts[series]);
+
+        if (plane >= layout.planes)
+          {
+            boost::format fmt("Invalid plane: %1%");
+            fmt % plane;
+            throw FormatException(fmt.str());
+          }
+
+        if (w == 0U || h == 0U ||
+            x + w > layout.sizeX || y + h > layout.sizeY)
+          {
+            boost::format fmt("Invalid region (%1%,%2%) %3%×%4% for image size %5%×%6%");
+            fmt % x % y % w % h % layout.sizeX % layout.sizeY;
+            throw FormatException(fmt.str());
+          }
+
+        const std::array<dimension_size_type, 3> coords(layout.mapper.getZCTCoords(plane));
+        const dimension_size_type samples = layout.channelSamples.at(coords[1]);
+
+        if (buf.pixelType() != layout.type ||
+            buf.shape()[DIM_SPATIAL_X] != w ||
+            buf.shape()[DIM_SPATIAL_Y] != h ||
+            buf.shape()[DIM_SUBCHANNEL] != samples)
+          {
+            boost::format fmt("Buffer of type %1% and size %2%×%3%×%4% does not match region of type %5% and size %6%×%7%×%8%");
+            fmt % buf.pixelType() % buf.shape()[DIM_SPATIAL_X] % buf.shape()[DIM_SPATIAL_Y] % buf.shape()[DIM_SUBCHANNEL];
+            fmt % layout.type % w % h % samples;
+            throw FormatException(fmt.str());
+          }
+
+        const dimension_size_type chunkBytes = layout.chunkX * layout.chunkY * layout.bytes;
+
+        tiff::TileCodecParameters params;
+        params.scheme = tiff::COMPRESSION_DEFLATE;
+        params.pixeltype = layout.type;
+        params.width = layout.chunkX;
+        params.height = layout.chunkY;
+        params.samples = 1U;
+        params.level = layout.level;
+        std::vector<char> encoded;
+
+        for (dimension_size_type cy = y / layout.chunkY; cy * layout.chunkY < y + h; ++cy)
+          for (dimension_size_type cx = x / layout.chunkX; cx * layout.chunkX < x + w; ++cx)
+            {
+              // Chunk extent within the image, and its intersection
+              // with the region.
+              const dimension_size_type chunkX0 = cx * layout.chunkX;
+              const dimension_size_type chunkY0 = cy * layout.chunkY;
+              const dimension_size_type chunkX1 = std::min(chunkX0 + layout.chunkX, layout.sizeX);
+              const dimension_size_type chunkY1 = std::min(chunkY0 + layout.chunkY, layout.sizeY);
+              const dimension_size_type x0 = std::max(chunkX0, x);
+              const dimension_size_type y0 = std::max(chunkY0, y);
+              const dimension_size_type x1 = std::min(chunkX1, x + w);
+              const dimension_size_type y1 = std::min(chunkY1, y + h);
+              const bool whole = (x0 == chunkX0 && y0 == chunkY0 &&
+                                  x1 == chunkX1 && y1 == chunkY1);
+
+              for (dimension_size_type s = 0U; s < samples; ++s)
+                {
+                  const path file(chunkPath(layout, coords[2],
+                                            layout.channelStart[coords[1]] + s,
+                                            coords[0], cy, cx));
+
+                  TileBuffer chunk(chunkBytes);
+
+                  // Partially written chunks are merged with any
+                  // existing content, under a lock.
+                  std::unique_lock<std::mutex> lock;
+                  if (!whole)
+                    lock = std::unique_lock<std::mutex>
+                      (chunkLocks[std::hash<std::string>()(file.string()) % chunkLocks.size()]);
+
+                  bool existing = false;
+                  if (!whole && boost::filesystem::exists(file))
+                    {
+                      boost::filesystem::ifstream in(file, std::ios::binary);
+                      bool complete;
+                      if (layout.codec)
+                        {
+                          encoded.assign(std::istreambuf_iterator<char>(in),
+                                         std::istreambuf_iterator<char>());
+                          complete = in.is_open() && !in.bad() &&
+                            layout.codec->decode(params, encoded.data(), encoded.size(),
+                                                 chunk.data(), chunkBytes) == chunkBytes;
+                        }
+                      else
+                        {
+                          in.read(reinterpret_cast<char *>(chunk.data()),
+                                  static_cast<std::streamsize>(chunkBytes));
+                          complete = in && in.gcount() == static_cast<std::streamsize>(chunkBytes);
+                        }
+                      if (!complete)
+                        {
+                          boost::format fmt("Failed to read existing chunk %1%");
+                          fmt % file.string();
+                          throw FormatException(fmt.str());
+                        }
+                      existing = true;
+                    }
+                  if (!existing)
+                    std::memset(chunk.data(), 0, chunkBytes);
+
+                  ChunkVisitor v(chunk.data(), layout.chunkX,
+                                 x0 - x, y0 - y, s,
+                                 x0 - chunkX0, y0 - chunkY0,
+                                 x1 - x0, y1 - y0);
+                  boost::apply_visitor(v, buf.vbuffer());
+
+                  boost::filesystem::create_directories(file.parent_path());
+                  if (layout.codec)
+                    {
+                      layout.codec->encode(params, chunk.data(), chunkBytes, encoded);
+                      replaceFile(file, encoded.data(), encoded.size());
+                    }
+                  else
+                    replaceFile(file, reinterpret_cast<const char *>(chunk.data()), chunkBytes);
+                }
+            }
+      }
+
+      boost::filesystem::path
+      OMEZarrWriter::chunkPath(const SeriesLayout& layout,
+                               dimension_size_type t,
+                               dimension_size_type c,
+                               dimension_size_type z,
+                               dimension_size_type cy,
+                               dimension_size_type cx) const
+      {
+        return layout.path / std::to_string(t) / std::to_string(c) /
+          std::to_string(z) / std::to_string(cy) / std::to_string(cx);
+      }
+
+      void
+      OMEZarrWriter::writeMetadata()
+      {
+        const path& root(*currentId);
+
+        boost::filesystem::create_directories(root / "OME");
+        replaceFile(root / ".zgroup", zgroup);
+        replaceFile(root / ".zattrs", "{\n  \"bioformats2raw.layout\" : 3\n}\n");
+        replaceFile(root / "OME" / ".zgroup", zgroup);
+
+        std::ostringstream series;
+        series << "{\n  \"series\" : [";
+        for (dimension_size_type s = 0U; s < layouts.size(); ++s)
+          series << (s ? ", " : " ") << '"' << s << '"';
+        series << " ]\n}\n";
+        replaceFile(root / "OME" / ".zattrs", series.str());
+
+        std::shared_ptr<OMEXMLMetadata> omexml(getOMEXMLMetadata(metadataRetrieve));
+        replaceFile(root / "OME" / "METADATA.ome.xml", getOMEXML(*omexml, true));
+
+        for (dimension_size_type s = 0U; s < layouts.size(); ++s)
+          {
+            const SeriesLayout& layout(layouts[s]);
+            const path group(layout.path.parent_path());
+
+            boost::filesystem::create_directories(layout.path);
+            replaceFile(group / ".zgroup", zgroup);
+
+            std::ostringstream attrs;
+            attrs << "{\n"
+                  << "  \"multiscales\" : [ {\n"
+                  << "    \"version\" : \"0.4\",\n"
+                  << "    \"axes\" : [\n"
+                  << "      { \"name\" : \"t\", \"type\" : \"time\" },\n"
+                  << "      { \"name\" : \"c\", \"type\" : \"channel\" },\n"
+                  << "      { \"name\" : \"z\", \"type\" : \"space\" },\n"
+                  << "      { \"name\" : \"y\", \"type\" : \"space\" },\n"
+                  << "      { \"name\" : \"x\", \"type\" : \"space\" }\n"
+                  << "    ],\n"
+                  << "    \"datasets\" : [ {\n"
+                  << "      \"path\" : \"0\",\n"
+                  << "      \"coordinateTransformations\" : [ { \"type\" : \"scale\", \"scale\" : [ 1.0, 1.0, 1.0, 1.0, 1.0 ] } ]\n"
+                  << "    } ]\n"
+                  << "  } ]\n"
+                  << "}\n";
+            replaceFile(group / ".zattrs", attrs.str());
+
+            std::ostringstream compressor;
+            if (layout.codec)
+              compressor << "{ \"id\" : \"zlib\", \"level\" : " << layout.level << " }";
+            else
+              compressor << "null";
+
+            std::ostringstream zarray;
+            zarray << "{\n"
+                   << "  \"zarr_format\" : 2,\n"
+                   << "  \"shape\" : [ " << layout.sizeT << ", " << layout.sizeC << ", " << layout.sizeZ
+                   << ", " << layout.sizeY << ", " << layout.sizeX << " ],\n"
+                   << "  \"chunks\" : [ 1, 1, 1, " << layout.chunkY << ", " << layout.chunkX << " ],\n"
+                   << "  \"dtype\" : \"" << zarrDataType(layout.type) << "\",\n"
+                   << "  \"compressor\" : " << compressor.str() << ",\n"
+                   << "  \"fill_value\" : " << zarrFillValue(layout.type) << ",\n"
+                   << "  \"order\" : \"C\",\n"
+                   << "  \"filters\" : null,\n"
+                   << "  \"dimension_separator\" : \"/\"\n"
+                   << "}\n";
+            replaceFile(layout.path / ".zarray", zarray.str());
+          }
+      }
+
+    }
+  }
+}
@@ -0,0 +1,266 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2014 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#ifndef OME_FILES_OUT_OMEZARRWRITER_H
+#define OME_FILES_OUT_OMEZARRWRITER_H
+
+#include <array>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem/path.hpp>
+
+#include <ome/files/FormatTools.h>
+#include <ome/files/detail/FormatWriter.h>
+#include <ome/files/tiff/Codec.h>
+
+#include <ome/common/log.h>
+
+namespace ome
+{
+  namespace files
+  {
+    namespace out
+    {
+
+      /**
+       * Chunked array store writer with OME-XML metadata.
+       *
+       * Each series is written as a chunked N-dimensional array in
+       * an OME-Zarr (NGFF) layout, as used by bioformats2raw.  The
+       * store is a directory containing a group for each series,
+       * with the full resolution array at @c series/0 in @c TCZYX
+       * order, and the OME-XML metadata for all series at
+       * @c OME/METADATA.ome.xml.  Samples of RGB channels are stored
+       * as separate channels.  Chunks span a single plane, with the
+       * chunk size set by setTileSizeX() and setTileSizeY(), and are
+       * stored in native byte order, each as a separate file.
+       * Chunks are stored uncompressed by default, or compressed
+       * with the Zarr @c zlib compressor if the compression is set
+       * to @c zlib; the compression level (0–9, default 6) is set
+       * with setCompressionLevel().  Chunks are compressed with the
+       * tile codec registered for TIFF Deflate compression (see
+       * tiff::registerTileCodec()), which produces the same zlib
+       * stream.
+       *
+       * Since chunks are independent files, planes and series may be
+       * written in any order, and saveRegion() may be called
+       * concurrently from multiple threads.  Several processes, for
+       * example on separate cluster nodes, may also write to the
+       * same store, if each uses the same metadata and writes
+       * regions covering whole chunks which are disjoint from those
+       * written by the others.  Within a single writer, regions
+       * which partially cover a chunk are merged with the existing
+       * chunk content.
+       */
+      class OMEZarrWriter : public ::ome::files::detail::FormatWriter
+      {
+      protected:
+        /// Message logger.
+        ome::common::Logger logger;
+
+        /// Array layout of a series.
+        struct SeriesLayout
+        {
+          /// Array path.
+          boost::filesystem::path path;
+          /// Pixel type.
+          ome::xml::model::enums::PixelType type;
+          /// Size of each pixel in bytes.
+          pixel_size_type bytes;
+          /// Image width.
+          dimension_size_type sizeX;
+          /// Image height.
+          dimension_size_type sizeY;
+          /// Image depth.
+          dimension_size_type sizeZ;
+          /// Image time points.
+          dimension_size_type sizeT;
+          /// Total channels, counting each sample separately.
+          dimension_size_type sizeC;
+          /// Number of planes.
+          dimension_size_type planes;
+          /// Chunk width.
+          dimension_size_type chunkX;
+          /// Chunk height.
+          dimension_size_type chunkY;
+          /// Array channel of the first sample of each channel.
+          std::vector<dimension_size_type> channelStart;
+          /// Samples per pixel of each channel.
+          std::vector<dimension_size_type> channelSamples;
+          /// Mapping between plane index and ZCT coordinates.
+          DimensionIndexMapper mapper;
+          /// Chunk codec, or null if chunks are uncompressed.
+          std::shared_ptr<const tiff::TileCodec> codec;
+          /// Chunk compression level.
+          int level;
+        };
+
+      private:
+        /// Layout of each series.
+        std::vector<SeriesLayout> layouts;
+
+        /// Locks for read-modify-write of partially written chunks.
+        mutable std::array<std::mutex, 32> chunkLocks;
+
+      public:
+        /// Constructor.
+        OMEZarrWriter();
+
+        /// Destructor.
+        virtual
+        ~OMEZarrWriter();
+
+        // Documented in superclass.
+        void
+        setId(const boost::filesystem::path& id);
+
+        // Documented in superclass.
+        void
+        close(bool fileOnly = false);
+
+        /**
+         * Set the current series.
+         *
+         * Series may be set in any order.
+         *
+         * @param series the series to use.
+         * @throws std::logic_error if the series is invalid.
+         */
+        void
+        setSeries(dimension_size_type series) const;
+
+        /**
+         * Set the current plane.
+         *
+         * Planes may be set in any order.
+         *
+         * @param plane the plane to use.
+         * @throws std::logic_error if the plane is invalid.
+         */
+        void
+        setPlane(dimension_size_type plane) const;
+
+        // Documented in superclass.
+        dimension_size_type
+        getTileSizeX() const;
+
+        // Documented in superclass.
+        dimension_size_type
+        getTileSizeY() const;
+
+        using FormatWriter::saveBytes;
+
+        // Documented in superclass.
+        void
+        saveBytes(dimension_size_type plane,
+                  VariantPixelBuffer& buf,
+                  dimension_size_type x,
+                  dimension_size_type y,
+                  dimension_size_type w,
+                  dimension_size_type h);
+
+        /**
+         * Save a region of a plane of a series.
+         *
+         * This is equivalent to saveBytes(), but does not use or
+         * change the current series and plane.  It is safe to call
+         * concurrently from multiple threads.  Concurrent calls
+         * which write to the same chunk are serialized; regions
+         * covering whole chunks are written without reading the
+         * existing chunk.
+         *
+         * @param series the series to save to.
+         * @param plane the plane to save to.
+         * @param buf the pixel data to save, with the region width,
+         * height and samples of the channel.
+         * @param x the @c X coordinate of the upper-left corner of
+         * the region.
+         * @param y the @c Y coordinate of the upper-left corner of
+         * the region.
+         * @param w the width of the region.
+         * @param h the height of the region.
+         * @throws FormatException if the series, plane or region is
+         * invalid, or the buffer does not match the region.
+         */
+        void
+        saveRegion(dimension_size_type       series,
+                   dimension_size_type       plane,
+                   const VariantPixelBuffer& buf,
+                   dimension_size_type       x,
+                   dimension_size_type       y,
+                   dimension_size_type       w,
+                   dimension_size_type       h) const;
+
+      protected:
+        /**
+         * Get the path of a chunk.
+         *
+         * @param layout the series layout.
+         * @param t the @c T coordinate.
+         * @param c the array channel.
+         * @param z the @c Z coordinate.
+         * @param cy the chunk row.
+         * @param cx the chunk column.
+         * @returns the chunk path.
+         */
+        boost::filesystem::path
+        chunkPath(const SeriesLayout& layout,
+                  dimension_size_type t,
+                  dimension_size_type c,
+                  dimension_size_type z,
+                  dimension_size_type cy,
+                  dimension_size_type cx) const;
+
+        /// Write the group and array metadata and OME-XML.
+        void
+        writeMetadata();
+      };
+
+    }
+  }
+}
+
+#endif // OME_FILES_OUT_OMEZARRWRITER_H
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
@@ -0,0 +1,292 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <algorithm>
+#include <array>
+
+#include <ome/files/tiff/BitPack.h>
+
+namespace
+{
+
+  using ::ome::files::dimension_size_type;
+
+  typedef std::array<bool, 8> unpacked_byte;
+  typedef std::array<unpacked_byte, 256> unpack_table;
+
+  // Lookup table of the unpacked samples for each byte value.
+  unpack_table
+  makeUnpackTable()
+  {
+    unpack_table table;
+    for (dimension_size_type value = 0; value < table.size(); ++value)
+      for (dimension_size_type bit = 0; bit < 8U; ++bit)
+        table[value][bit] = ((value >> (7U - bit)) & 1U) != 0U;
+    return table;
+  }
+
+  const unpack_table&
+  unpackTable()
+  {
+    static const unpack_table table(makeUnpackTable());
+    return table;
+  }
+
+  // Unpack groups of eight samples of Bits bits, which occupy Bits
+  // bytes.  Each group is assembled into a 64-bit big-endian word,
+  // holding all eight samples for 10 bits or the first four for 12
+  // and 14 bits, and the samples are extracted with constant shifts.
+  // The fixed trip count of the inner loops allows the compiler to
+  // unroll and vectorize them.  Returns the number of samples
+  // unpacked.
+  template<unsigned Bits>
+  dimension_size_type
+  unpackGroups(const uint8_t       *src,
+               uint16_t            *dest,
+               dimension_size_type  count)
+  {
+    const uint16_t mask = static_cast<uint16_t>((1U << Bits) - 1U);
+    // Samples and bytes per half group; a half group spans a whole
+    // number of bytes, and fits in a 64-bit word.
+    const unsigned half = 4U;
+    const unsigned halfbytes = Bits / 2U;
+
+    const dimension_size_type groups = count / 8U;
+    for (dimension_size_type g = 0; g < groups; ++g)
+      {
+        for (unsigned h = 0; h < 2U; ++h)
+          {
+            const uint8_t *in = src + (g * Bits) + (h * halfbytes);
+            uint64_t word = 0U;
+            for (unsigned b = 0; b < halfbytes; ++b)
+              word = (word << 8U) | in[b];
+            uint16_t *out = dest + (g * 8U) + (h * half);
+            for (unsigned i = 0; i < half; ++i)
+              out[i] = static_cast<uint16_t>((word >> (Bits * (half - 1U - i))) & mask);
+          }
+      }
+    return groups * 8U;
+  }
+
+  // Pack groups of eight samples; the inverse of unpackGroups().
+  template<unsigned Bits>
+  dimension_size_type
+  packGroups(const uint16_t      *src,
+             dimension_size_type  count,
+             uint8_t             *dest)
+  {
+    const uint64_t mask = (1U << Bits) - 1U;
+    const unsigned half = 4U;
+    const unsigned halfbytes = Bits / 2U;
+
+    const dimension_size_type groups = count / 8U;
+    for (dimension_size_type g = 0; g < groups; ++g)
+      {
+        for (unsigned h = 0; h < 2U; ++h)
+          {
+            const uint16_t *in = src + (g * 8U) + (h * half);
+            uint64_t word = 0U;
+            for (unsigned i = 0; i < half; ++i)
+              word = (word << Bits) | (in[i] & mask);
+            uint8_t *out = dest + (g * Bits) + (h * halfbytes);
+            for (unsigned b = 0; b < halfbytes; ++b)
+              out[b] = static_cast<uint8_t>(word >> (8U * (halfbytes - 1U - b)));
+          }
+      }
+    return groups * 8U;
+  }
+
+}
+
+namespace ome
+{
+  namespace files
+  {
+    namespace tiff
+    {
+
+      void
+      unpackBits(const uint8_t       *src,
+                 dimension_size_type  srcbit,
+                 bool                *dest,
+                 dimension_size_type  count)
+      {
+        const uint8_t *byte = src + (srcbit / 8U);
+        dimension_size_type bit = srcbit % 8U;
+
+        // Leading bits up to the first byte boundary.
+        for (; bit != 0U && count != 0U; --count)
+          {
+            *dest++ = ((*byte >> (7U - bit)) & 1U) != 0U;
+            if (++bit == 8U)
+              {
+                bit = 0U;
+                ++byte;
+              }
+          }
+
+        // Whole bytes.
+        const unpack_table& table(unpackTable());
+        for (; count >= 8U; count -= 8U)
+          {
+            const unpacked_byte& samples(table[*byte++]);
+            dest = std::copy(samples.begin(), samples.end(), dest);
+          }
+
+        // Trailing bits.
+        for (bit = 0U; bit < count; ++bit)
+          *dest++ = ((*byte >> (7U - bit)) & 1U) != 0U;
+      }
+
+      void
+      packBits(const bool          *src,
+               dimension_size_type  count,
+               uint8_t             *dest,
+               dimension_size_type  destbit)
+      {
+        uint8_t *byte = dest + (destbit / 8U);
+        dimension_size_type bit = destbit % 8U;
+
+        // Leading bits up to the first byte boundary.
+        for (; bit != 0U && count != 0U; --count)
+          {
+            *byte |= static_cast<uint8_t>((*src++ ? 1U : 0U) << (7U - bit));
+            if (++bit == 8U)
+              {
+                bit = 0U;
+                ++byte;
+              }
+          }
+
+        // Whole bytes.
+        for (; count >= 8U; count -= 8U, src += 8)
+          *byte++ |= static_cast<uint8_t>((src[0] << 7U) | (src[1] << 6U) |
+                                          (src[2] << 5U) | (src[3] << 4U) |
+                                          (src[4] << 3U) | (src[5] << 2U) |
+                                          (src[6] << 1U) | src[7]);
+
+        // Trailing bits.
+        for (bit = 0U; bit < count; ++bit)
+          *byte |= static_cast<uint8_t>((src[bit] ? 1U : 0U) << (7U - bit));
+      }
+
+      bool
+      isPackedSampleDepth(uint16_t bits)
+      {
+        return bits == 10U || bits == 12U || bits == 14U;
+      }
+
+      dimension_size_type
+      packedSampleSize(dimension_size_type count,
+                       uint16_t            bits)
+      {
+        return ((count * bits) + 7U) / 8U;
+      }
+
+      void
+      unpackSamples(const uint8_t       *src,
+                    uint16_t            *dest,
+                    dimension_size_type  count,
+                    uint16_t             bits)
+      {
+        dimension_size_type done = 0U;
+        switch (bits)
+          {
+          case 10U:
+            done = unpackGroups<10U>(src, dest, count);
+            break;
+          case 12U:
+            done = unpackGroups<12U>(src, dest, count);
+            break;
+          case 14U:
+            done = unpackGroups<14U>(src, dest, count);
+            break;
+          default:
+            break;
+          }
+
+        // Trailing samples, and any unsupported depth, one bit at a
+        // time.
+        for (dimension_size_type i = done; i < count; ++i)
+          {
+            uint16_t value = 0U;
+            for (dimension_size_type bit = i * bits; bit < (i + 1U) * bits; ++bit)
+              value = static_cast<uint16_t>((value << 1U) |
+                                            ((src[bit / 8U] >> (7U - (bit % 8U))) & 1U));
+            dest[i] = value;
+          }
+      }
+
+      void
+      packSamples(const uint16_t      *src,
+                  dimension_size_type  count,
+                  uint8_t             *dest,
+                  uint16_t             bits)
+      {
+        dimension_size_type done = 0U;
+        switch (bits)
+          {
+          case 10U:
+            done = packGroups<10U>(src, count, dest);
+            break;
+          case 12U:
+            done = packGroups<12U>(src, count, dest);
+            break;
+          case 14U:
+            done = packGroups<14U>(src, count, dest);
+            break;
+          default:
+            break;
+          }
+
+        // Trailing samples, and any unsupported depth, one bit at a
+        // time.  Whole groups end on a byte boundary, so the
+        // remaining bytes are cleared first.
+        const dimension_size_type first = (done * bits) / 8U;
+        std::fill(dest + first, dest + packedSampleSize(count, bits), uint8_t(0U));
+        for (dimension_size_type i = done; i < count; ++i)
+          for (dimension_size_type b = 0U; b < bits; ++b)
+            {
+              dimension_size_type bit = (i * bits) + b;
+              if ((src[i] >> (bits - 1U - b)) & 1U)
+                dest[bit / 8U] |= static_cast<uint8_t>(1U << (7U - (bit % 8U)));
+            }
+      }
+
+    }
+  }
+}
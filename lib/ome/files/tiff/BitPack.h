@@ -0,0 +1,164 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#ifndef OME_FILES_TIFF_BITPACK_H
+#define OME_FILES_TIFF_BITPACK_H
+
+#include <cstdint>
+
+#include <ome/files/Types.h>
+
+namespace ome
+{
+  namespace files
+  {
+    namespace tiff
+    {
+
+      /**
+       * Unpack bits into boolean samples.
+       *
+       * Bits are stored most significant bit first, as for TIFF
+       * bilevel and 1-bit images.  Whole bytes are unpacked using a
+       * lookup table, rather than one bit at a time.
+       *
+       * @param src the packed source data.
+       * @param srcbit the offset of the first bit to unpack, in bits.
+       * @param dest the destination samples.
+       * @param count the number of samples to unpack.
+       */
+      void
+      unpackBits(const uint8_t       *src,
+                 dimension_size_type  srcbit,
+                 bool                *dest,
+                 dimension_size_type  count);
+
+      /**
+       * Pack boolean samples into bits.
+       *
+       * Bits are stored most significant bit first, as for TIFF
+       * bilevel and 1-bit images.  Bits are combined with the
+       * existing destination data using bitwise OR, so the
+       * destination must be zeroed before the first write.  Whole
+       * bytes are packed at once, rather than one bit at a time.
+       *
+       * @param src the source samples.
+       * @param count the number of samples to pack.
+       * @param dest the packed destination data.
+       * @param destbit the offset of the first bit to pack, in bits.
+       */
+      void
+      packBits(const bool          *src,
+               dimension_size_type  count,
+               uint8_t             *dest,
+               dimension_size_type  destbit);
+
+      /**
+       * Check if a sample bit depth is stored packed.
+       *
+       * Unsigned integer samples of 10, 12 or 14 bits are stored
+       * packed, without padding between samples, and are unpacked
+       * into 16-bit samples.
+       *
+       * @param bits the bits per sample.
+       * @returns @c true if packed, @c false otherwise.
+       */
+      bool
+      isPackedSampleDepth(uint16_t bits);
+
+      /**
+       * Get the size of packed samples.
+       *
+       * @param count the number of samples.
+       * @param bits the bits per sample.
+       * @returns the size in bytes, including any padding bits to
+       * complete the last byte.
+       */
+      dimension_size_type
+      packedSampleSize(dimension_size_type count,
+                       uint16_t            bits);
+
+      /**
+       * Unpack packed samples into 16-bit samples.
+       *
+       * Samples are stored most significant bit first, as for TIFF
+       * images with a BitsPerSample which is not a whole number of
+       * bytes.  Groups of eight samples, which span a whole number of
+       * bytes, are unpacked at once with fixed shifts and masks, so
+       * that the compiler may vectorize the loop.
+       *
+       * @param src the packed source data.
+       * @param dest the destination samples.
+       * @param count the number of samples to unpack.
+       * @param bits the bits per sample (see isPackedSampleDepth()).
+       */
+      void
+      unpackSamples(const uint8_t       *src,
+                    uint16_t            *dest,
+                    dimension_size_type  count,
+                    uint16_t             bits);
+
+      /**
+       * Pack 16-bit samples into packed samples.
+       *
+       * Samples are stored most significant bit first, as for
+       * unpackSamples().  Bits above the bit depth are discarded.
+       * Whole bytes are written, including the last byte, which is
+       * padded with zero bits.
+       *
+       * @param src the source samples.
+       * @param count the number of samples to pack.
+       * @param dest the packed destination data.
+       * @param bits the bits per sample (see isPackedSampleDepth()).
+       */
+      void
+      packSamples(const uint16_t      *src,
+                  dimension_size_type  count,
+                  uint8_t             *dest,
+                  uint16_t             bits);
+
+    }
+  }
+}
+
+#endif // OME_FILES_TIFF_BITPACK_H
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
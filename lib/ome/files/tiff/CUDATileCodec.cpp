@@ -0,0 +1,606 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include <boost/format.hpp>
+
+#include <ome/files/config-internal.h>
+#include <ome/files/PixelProperties.h>
+#include <ome/files/tiff/CUDATileCodec.h>
+#include <ome/files/tiff/Codec.h>
+#include <ome/files/tiff/Exception.h>
+
+#ifdef OME_HAVE_CUDA
+# include <cuda_runtime_api.h>
+#endif // OME_HAVE_CUDA
+#ifdef OME_HAVE_NVJPEG
+# include <nvjpeg.h>
+#endif // OME_HAVE_NVJPEG
+#ifdef OME_HAVE_NVCOMP
+# include <nvcomp/deflate.h>
+#endif // OME_HAVE_NVCOMP
+
+namespace ome
+{
+  namespace files
+  {
+    namespace tiff
+    {
+
+#ifdef OME_HAVE_CUDA
+      namespace
+      {
+
+        // Throw an exception on a CUDA error.
+        void
+        checkCUDA(cudaError_t  status,
+                  const char  *what)
+        {
+          if (status != cudaSuccess)
+            {
+              boost::format fmt("CUDA failed to %1%: %2%");
+              fmt % what % cudaGetErrorString(status);
+              throw Exception(fmt.str());
+            }
+        }
+
+        // Size of a pixel of a tile in bytes.
+        std::size_t
+        tilePixelBytes(const TileCodecParameters& params)
+        {
+          return static_cast<std::size_t>(params.samples * bytesPerPixel(params.pixeltype));
+        }
+
+        // Device memory, reused between batches and grown as
+        // needed.
+        class DeviceMemory
+        {
+        public:
+          DeviceMemory():
+            ptr(nullptr),
+            size(0U)
+          {}
+
+          ~DeviceMemory()
+          {
+            if (ptr)
+              cudaFree(ptr);
+          }
+
+          char *
+          reserve(std::size_t required)
+          {
+            if (required > size)
+              {
+                if (ptr)
+                  cudaFree(ptr);
+                ptr = nullptr;
+                size = 0U;
+                checkCUDA(cudaMalloc(&ptr, required), "allocate device memory");
+                size = required;
+              }
+            return static_cast<char *>(ptr);
+          }
+
+        private:
+          void        *ptr;
+          std::size_t  size;
+        };
+
+        // Page-locked host memory for transfers, reused between
+        // batches and grown as needed.
+        class PinnedMemory
+        {
+        public:
+          PinnedMemory():
+            ptr(nullptr),
+            size(0U)
+          {}
+
+          ~PinnedMemory()
+          {
+            if (ptr)
+              cudaFreeHost(ptr);
+          }
+
+          char *
+          reserve(std::size_t required)
+          {
+            if (required > size)
+              {
+                if (ptr)
+                  cudaFreeHost(ptr);
+                ptr = nullptr;
+                size = 0U;
+                checkCUDA(cudaMallocHost(&ptr, required), "allocate page-locked memory");
+                size = required;
+              }
+            return static_cast<char *>(ptr);
+          }
+
+        private:
+          void        *ptr;
+          std::size_t  size;
+        };
+
+        // Base for CUDA device tile codecs.  Each codec has its own
+        // stream and scratch memory; batches are decoded one at a
+        // time.
+        class CUDATileCodec : public DeviceTileCodec
+        {
+        public:
+          explicit
+          CUDATileCodec(int device):
+            device(device),
+            mutex(),
+            stream(),
+            scratch()
+          {
+            checkCUDA(cudaSetDevice(device), "set device");
+            checkCUDA(cudaStreamCreateWithFlags(&stream, cudaStreamNonBlocking), "create stream");
+          }
+
+          virtual
+          ~CUDATileCodec()
+          {
+            cudaStreamDestroy(stream);
+          }
+
+        protected:
+          // Check if the part of a tile to store is the whole tile.
+          static bool
+          wholeTile(const DeviceTileRequest& request)
+          {
+            return !request.x && !request.y &&
+              request.w == request.params.width &&
+              request.h == request.params.height;
+          }
+
+          // Zero-fill the destination of a tile which is not
+          // present.
+          void
+          zeroTile(const DeviceTileRequest& request) const
+          {
+            checkCUDA(cudaMemset2DAsync(request.dest, request.destpitch, 0,
+                                        request.w * tilePixelBytes(request.params), request.h,
+                                        stream),
+                      "zero-fill tile");
+          }
+
+          // Store the part of a tile decoded into scratch memory
+          // with the specified pitch.
+          void
+          storeTile(const DeviceTileRequest& request,
+                    const char              *decoded,
+                    std::size_t              pitch) const
+          {
+            const std::size_t pixelbytes = tilePixelBytes(request.params);
+            checkCUDA(cudaMemcpy2DAsync(request.dest, request.destpitch,
+                                        decoded + (request.y * pitch) + (request.x * pixelbytes), pitch,
+                                        request.w * pixelbytes, request.h,
+                                        cudaMemcpyDeviceToDevice, stream),
+                      "store tile");
+          }
+
+          /// The CUDA device.
+          int                  device;
+          /// Serialises batches.
+          mutable std::mutex   mutex;
+          /// Stream for all transfers and decoding.
+          cudaStream_t         stream;
+          /// Scratch memory for tiles not decoded in place.
+          mutable DeviceMemory scratch;
+        };
+
+#ifdef OME_HAVE_NVJPEG
+        // Throw an exception on an nvJPEG error.
+        void
+        checkNVJPEG(nvjpegStatus_t  status,
+                    const char     *what)
+        {
+          if (status != NVJPEG_STATUS_SUCCESS)
+            {
+              boost::format fmt("nvJPEG failed to %1%: error %2%");
+              fmt % what % static_cast<int>(status);
+              throw Exception(fmt.str());
+            }
+        }
+
+        // JPEG codec using nvJPEG batched decoding.  Whole tiles
+        // are decoded in place; partial tiles are decoded into
+        // scratch memory and the part within the region stored.
+        class NVJPEGTileCodec : public CUDATileCodec
+        {
+        public:
+          explicit
+          NVJPEGTileCodec(int device):
+            CUDATileCodec(device),
+            handle(),
+            state()
+          {
+            checkNVJPEG(nvjpegCreateSimple(&handle), "create handle");
+            checkNVJPEG(nvjpegJpegStateCreate(handle, &state), "create decoder state");
+          }
+
+          ~NVJPEGTileCodec()
+          {
+            nvjpegJpegStateDestroy(state);
+            nvjpegDestroy(handle);
+          }
+
+          void
+          decodeBatch(const std::vector<DeviceTileRequest>& requests) const
+          {
+            if (requests.empty())
+              return;
+
+            const TileCodecParameters& first(requests.front().params);
+            if (first.pixeltype != ::ome::xml::model::enums::PixelType::UINT8)
+              throw Exception("nvJPEG only supports decoding 8-bit samples");
+            if (first.samples != 1U && first.samples != 3U)
+              {
+                boost::format fmt("nvJPEG does not support decoding %1% samples per pixel");
+                fmt % first.samples;
+                throw Exception(fmt.str());
+              }
+            const nvjpegOutputFormat_t format = first.samples == 1U ?
+              NVJPEG_OUTPUT_Y : NVJPEG_OUTPUT_RGBI;
+            const std::size_t pixelbytes = tilePixelBytes(first);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            checkCUDA(cudaSetDevice(device), "set device");
+
+            std::size_t scratchsize = 0U;
+            for (const auto& request : requests)
+              if (request.src && !wholeTile(request))
+                scratchsize += request.params.width * request.params.height * pixelbytes;
+            char *staged = scratch.reserve(scratchsize);
+
+            std::vector<const unsigned char *> data;
+            std::vector<std::size_t> lengths;
+            std::vector<nvjpegImage_t> images;
+            std::vector<std::pair<const DeviceTileRequest *, const char *>> partial;
+            for (const auto& request : requests)
+              {
+                if (!request.src)
+                  {
+                    zeroTile(request);
+                    continue;
+                  }
+
+                nvjpegImage_t image;
+                std::memset(&image, 0, sizeof(image));
+                if (wholeTile(request))
+                  {
+                    image.channel[0] = static_cast<unsigned char *>(request.dest);
+                    image.pitch[0] = request.destpitch;
+                  }
+                else
+                  {
+                    image.channel[0] = reinterpret_cast<unsigned char *>(staged);
+                    image.pitch[0] = request.params.width * pixelbytes;
+                    partial.push_back(std::make_pair(&request, staged));
+                    staged += request.params.width * request.params.height * pixelbytes;
+                  }
+                data.push_back(static_cast<const unsigned char *>(request.src));
+                lengths.push_back(request.size);
+                images.push_back(image);
+              }
+
+            if (!data.empty())
+              {
+                checkNVJPEG(nvjpegDecodeBatchedInitialize(handle, state, static_cast<int>(data.size()),
+                                                          1, format),
+                            "initialize batched decode");
+                checkNVJPEG(nvjpegDecodeBatched(handle, state, data.data(), lengths.data(),
+                                                images.data(), stream),
+                            "decode JPEG tiles");
+              }
+
+            for (const auto& part : partial)
+              storeTile(*part.first, part.second, part.first->params.width * pixelbytes);
+
+            checkCUDA(cudaStreamSynchronize(stream), "decode JPEG tiles");
+          }
+
+        private:
+          nvjpegHandle_t     handle;
+          nvjpegJpegState_t  state;
+        };
+#endif // OME_HAVE_NVJPEG
+
+#ifdef OME_HAVE_NVCOMP
+        // Deflate codec using nvCOMP batched decompression.  The
+        // zlib header of each tile is skipped, since nvCOMP
+        // decompresses raw Deflate streams.  The compressed data
+        // of the batch is transferred in a single copy.  Tiles are
+        // decompressed into scratch memory, other than whole tiles
+        // whose rows are contiguous in the destination, and the
+        // part within the region stored.
+        class NVCOMPDeflateTileCodec : public CUDATileCodec
+        {
+        public:
+          explicit
+          NVCOMPDeflateTileCodec(int device):
+            CUDATileCodec(device),
+            pinned(),
+            upload(),
+            temp()
+          {
+          }
+
+          void
+          decodeBatch(const std::vector<DeviceTileRequest>& requests) const
+          {
+            std::lock_guard<std::mutex> lock(mutex);
+            checkCUDA(cudaSetDevice(device), "set device");
+
+            // Compressed data, then the per-tile arguments, are
+            // packed into page-locked memory for a single transfer.
+            std::vector<const DeviceTileRequest *> batch;
+            std::size_t compressed = 0U;
+            std::size_t scratchsize = 0U;
+            std::size_t maxtile = 0U;
+            for (const auto& request : requests)
+              {
+                if (!request.src)
+                  {
+                    zeroTile(request);
+                    continue;
+                  }
+                if (request.size < 2U ||
+                    (static_cast<const unsigned char *>(request.src)[0] & 0x0FU) != 8U)
+                  throw Exception("Invalid zlib header in Deflate tile");
+
+                const std::size_t tilesize = request.params.width * request.params.height *
+                  tilePixelBytes(request.params);
+                batch.push_back(&request);
+                compressed += align(request.size - 2U);
+                if (!inPlace(request))
+                  scratchsize += tilesize;
+                maxtile = std::max(maxtile, tilesize);
+              }
+
+            if (!batch.empty())
+              {
+                // Layout of the page-locked and device memory: the
+                // compressed data, followed by the source and
+                // destination pointers, source and destination
+                // sizes (all transferred to the device), and the
+                // decompressed sizes and statuses (transferred
+                // back).
+                const std::size_t count = batch.size();
+                const std::size_t uploadsize = compressed +
+                  (count * ((2U * sizeof(void *)) + (2U * sizeof(std::size_t))));
+                const std::size_t totalsize = uploadsize +
+                  (count * (sizeof(std::size_t) + sizeof(nvcompStatus_t)));
+                char *host = pinned.reserve(totalsize);
+                char *dev = upload.reserve(totalsize);
+                char *staged = scratch.reserve(scratchsize);
+
+                const void **srcptrs = reinterpret_cast<const void **>(host + compressed);
+                void **destptrs = reinterpret_cast<void **>(host + compressed + (count * sizeof(void *)));
+                std::size_t *srcbytes = reinterpret_cast<std::size_t *>(destptrs + count);
+                std::size_t *destbytes = srcbytes + count;
+                std::size_t *actual = destbytes + count;
+                nvcompStatus_t *statuses = reinterpret_cast<nvcompStatus_t *>(actual + count);
+
+                const void *const *devsrcptrs = reinterpret_cast<const void *const *>(dev + compressed);
+                void *const *devdestptrs = reinterpret_cast<void *const *>(dev + compressed + (count * sizeof(void *)));
+                std::size_t *devsrcbytes = reinterpret_cast<std::size_t *>(dev + compressed + (count * 2U * sizeof(void *)));
+                std::size_t *devdestbytes = devsrcbytes + count;
+                std::size_t *devactual = devdestbytes + count;
+                nvcompStatus_t *devstatuses = reinterpret_cast<nvcompStatus_t *>(devactual + count);
+
+                std::size_t offset = 0U;
+                std::vector<std::pair<const DeviceTileRequest *, const char *>> partial;
+                for (std::size_t i = 0; i < count; ++i)
+                  {
+                    const DeviceTileRequest& request(*batch[i]);
+                    const std::size_t size = request.size - 2U;
+                    std::memcpy(host + offset, static_cast<const char *>(request.src) + 2U, size);
+                    srcptrs[i] = dev + offset;
+                    srcbytes[i] = size;
+                    destbytes[i] = request.params.width * request.params.height * tilePixelBytes(request.params);
+                    if (inPlace(request))
+                      destptrs[i] = request.dest;
+                    else
+                      {
+                        destptrs[i] = staged;
+                        partial.push_back(std::make_pair(&request, staged));
+                        staged += destbytes[i];
+                      }
+                    offset += align(size);
+                  }
+
+                checkCUDA(cudaMemcpyAsync(dev, host, uploadsize, cudaMemcpyHostToDevice, stream),
+                          "transfer compressed tiles");
+
+                std::size_t tempsize = 0U;
+                if (nvcompBatchedDeflateDecompressGetTempSize(count, maxtile, &tempsize) != nvcompSuccess)
+                  throw Exception("nvCOMP failed to get temporary size for Deflate decompression");
+
+                if (nvcompBatchedDeflateDecompressAsync(devsrcptrs, devsrcbytes, devdestbytes, devactual,
+                                                        count, temp.reserve(std::max(tempsize, static_cast<std::size_t>(1U))),
+                                                        tempsize, devdestptrs, devstatuses,
+                                                        stream) != nvcompSuccess)
+                  throw Exception("nvCOMP failed to decompress Deflate tiles");
+
+                for (const auto& part : partial)
+                  storeTile(*part.first, part.second,
+                            part.first->params.width * tilePixelBytes(part.first->params));
+
+                // Check that every tile was decompressed.
+                checkCUDA(cudaMemcpyAsync(actual, devactual, totalsize - uploadsize,
+                                          cudaMemcpyDeviceToHost, stream),
+                          "transfer decompression status");
+                checkCUDA(cudaStreamSynchronize(stream), "decompress Deflate tiles");
+
+                for (std::size_t i = 0; i < count; ++i)
+                  {
+                    const DeviceTileRequest& request(*batch[i]);
+                    const std::size_t expected = (request.y + request.h) * request.params.width *
+                      tilePixelBytes(request.params);
+                    if (statuses[i] != nvcompSuccess || actual[i] < expected)
+                      throw Exception("nvCOMP failed to decompress Deflate tile fully");
+                  }
+              }
+            else
+              checkCUDA(cudaStreamSynchronize(stream), "zero-fill tiles");
+          }
+
+        private:
+          // Round up to the alignment of the argument arrays.
+          static std::size_t
+          align(std::size_t size)
+          {
+            return (size + 7U) & ~static_cast<std::size_t>(7U);
+          }
+
+          // Check if a tile may be decompressed in place: the whole
+          // tile is stored, with contiguous rows.
+          static bool
+          inPlace(const DeviceTileRequest& request)
+          {
+            return wholeTile(request) &&
+              request.destpitch == request.params.width * tilePixelBytes(request.params);
+          }
+
+          mutable PinnedMemory pinned;
+          mutable DeviceMemory upload;
+          mutable DeviceMemory temp;
+        };
+#endif // OME_HAVE_NVCOMP
+
+      }
+#endif // OME_HAVE_CUDA
+
+      CUDAAllocator::CUDAAllocator(int device):
+        PixelAllocator(),
+        device(device)
+      {
+      }
+
+      CUDAAllocator::~CUDAAllocator()
+      {
+      }
+
+      void *
+      CUDAAllocator::allocate(std::size_t size,
+                              std::size_t /* alignment */)
+      {
+#ifdef OME_HAVE_CUDA
+        // Device allocations are aligned to at least 256 bytes.
+        checkCUDA(cudaSetDevice(device), "set device");
+        void *ptr = nullptr;
+        if (cudaMalloc(&ptr, size) != cudaSuccess || !ptr)
+          throw std::bad_alloc();
+        return ptr;
+#else // ! OME_HAVE_CUDA
+        static_cast<void>(size);
+        throw Exception("Device memory allocation requires CUDA support");
+#endif // OME_HAVE_CUDA
+      }
+
+      void
+      CUDAAllocator::deallocate(void        *ptr,
+                                std::size_t  /* size */,
+                                std::size_t  /* alignment */)
+      {
+#ifdef OME_HAVE_CUDA
+        cudaSetDevice(device);
+        cudaFree(ptr);
+#else // ! OME_HAVE_CUDA
+        static_cast<void>(ptr);
+#endif // OME_HAVE_CUDA
+      }
+
+      bool
+      CUDAAllocator::hostAccessible() const
+      {
+        return false;
+      }
+
+      int
+      CUDAAllocator::getDevice() const
+      {
+        return device;
+      }
+
+      dimension_size_type
+      registerCUDATileCodecs(int device)
+      {
+        dimension_size_type registered = 0U;
+
+#ifdef OME_HAVE_CUDA
+        int count = 0;
+        if (cudaGetDeviceCount(&count) != cudaSuccess || device < 0 || device >= count)
+          return registered;
+
+# ifdef OME_HAVE_NVJPEG
+        registerDeviceTileCodec(COMPRESSION_JPEG, std::make_shared<NVJPEGTileCodec>(device));
+        ++registered;
+# endif // OME_HAVE_NVJPEG
+
+# ifdef OME_HAVE_NVCOMP
+        std::shared_ptr<DeviceTileCodec> deflate(std::make_shared<NVCOMPDeflateTileCodec>(device));
+        registerDeviceTileCodec(COMPRESSION_ADOBE_DEFLATE, deflate);
+        registerDeviceTileCodec(COMPRESSION_DEFLATE, deflate);
+        registered += 2U;
+# endif // OME_HAVE_NVCOMP
+#else // ! OME_HAVE_CUDA
+        static_cast<void>(device);
+#endif // OME_HAVE_CUDA
+
+        return registered;
+      }
+
+    }
+  }
+}
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
@@ -0,0 +1,137 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#ifndef OME_FILES_TIFF_CUDATILECODEC_H
+#define OME_FILES_TIFF_CUDATILECODEC_H
+
+#include <cstddef>
+
+#include <ome/files/PixelAllocator.h>
+#include <ome/files/Types.h>
+
+namespace ome
+{
+  namespace files
+  {
+    namespace tiff
+    {
+
+      /**
+       * Allocator for pixel storage in CUDA device memory.
+       *
+       * Pixel buffers using this allocator are not host accessible.
+       * They may be filled by IFD::readImage() using the device tile
+       * codecs registered by registerCUDATileCodecs(), and the
+       * storage passed directly to CUDA kernels or other device
+       * consumers, without a copy through host memory.
+       *
+       * Where built without CUDA support, allocation always fails.
+       */
+      class CUDAAllocator : public PixelAllocator
+      {
+      public:
+        /**
+         * Constructor.
+         *
+         * @param device the CUDA device to allocate on.
+         */
+        explicit
+        CUDAAllocator(int device = 0);
+
+        /// Destructor.
+        virtual
+        ~CUDAAllocator();
+
+        // Documented in superclass.
+        void *
+        allocate(std::size_t size,
+                 std::size_t alignment);
+
+        // Documented in superclass.
+        void
+        deallocate(void        *ptr,
+                   std::size_t  size,
+                   std::size_t  alignment);
+
+        // Documented in superclass.
+        bool
+        hostAccessible() const;
+
+        /**
+         * Get the CUDA device.
+         *
+         * @returns the device number.
+         */
+        int
+        getDevice() const;
+
+      private:
+        /// The CUDA device.
+        int device;
+      };
+
+      /**
+       * Register CUDA device tile codecs.
+       *
+       * Where built with the respective libraries, JPEG tiles are
+       * decoded with nvJPEG, and Deflate and Adobe Deflate tiles
+       * with nvCOMP.  Each batch of tiles read by IFD::readImage()
+       * is decoded with a single batched decode; only the
+       * compressed data is transferred to the device.  nvJPEG
+       * supports 8-bit samples only.
+       *
+       * @param device the CUDA device to decode on; destination
+       * buffers must be allocated on the same device (see
+       * CUDAAllocator).
+       * @returns the number of compression schemes registered;
+       * zero if built without CUDA support or if the device is not
+       * available.
+       */
+      dimension_size_type
+      registerCUDATileCodecs(int device = 0);
+
+    }
+  }
+}
+
+#endif // OME_FILES_TIFF_CUDATILECODEC_H
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
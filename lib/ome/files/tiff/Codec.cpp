@@ -37,8 +37,18 @@
 
 #include <map>
 #include <memory>
+#include <mutex>
+
+#include <boost/format.hpp>
+#include <boost/iostreams/copy.hpp>
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+#include <boost/iostreams/read.hpp>
+#include <boost/iostreams/filtering_streambuf.hpp>
 
 #include <ome/files/tiff/Codec.h>
+#include <ome/files/tiff/Exception.h>
 
 #include <tiffio.h>
 
@@ -51,156 +61,463 @@ namespace ome
     namespace tiff
     {
 
-      const std::vector<Codec>&
-      getCodecs()
+      namespace
       {
-        static std::vector<Codec> ret;
 
-        if(ret.empty())
+        // Deflate codec using zlib.
+        class ZlibTileCodec : public TileCodec
+        {
+        public:
+          void
+          encode(const TileCodecParameters& params,
+                 const void                *src,
+                 std::size_t                size,
+                 std::vector<char>&         dest) const
           {
-            std::shared_ptr<TIFFCodec> codecs(TIFFGetConfiguredCODECs(), _TIFFfree);
-            if (codecs)
+            dest.clear();
+
+            try
               {
-                for (const TIFFCodec *c = &*codecs; c->name != nullptr; ++c)
+                boost::iostreams::filtering_streambuf<boost::iostreams::output> out;
+                out.push(boost::iostreams::zlib_compressor
+                         (boost::iostreams::zlib_params(params.level < 0 ?
+                                                        boost::iostreams::zlib::default_compression :
+                                                        params.level)));
+                out.push(boost::iostreams::back_inserter(dest));
+
+                boost::iostreams::array_source in(static_cast<const char *>(src), size);
+                boost::iostreams::copy(in, out);
+              }
+            catch (const std::exception& e)
+              {
+                boost::format fmt("Failed to encode Deflate tile: %1%");
+                fmt % e.what();
+                throw Exception(fmt.str());
+              }
+          }
+
+          std::size_t
+          decode(const TileCodecParameters& /* params */,
+                 const void                *src,
+                 std::size_t                size,
+                 void                      *dest,
+                 std::size_t                destsize) const
+          {
+            try
+              {
+                boost::iostreams::filtering_streambuf<boost::iostreams::input> in;
+                in.push(boost::iostreams::zlib_decompressor());
+                in.push(boost::iostreams::array_source(static_cast<const char *>(src), size));
+
+                char *out = static_cast<char *>(dest);
+                std::size_t decoded = 0U;
+                while (decoded < destsize)
                   {
-                    Codec nc;
-                    nc.name = c->name;
-                    nc.scheme = static_cast<Compression>(c->scheme);
-                    ret.push_back(nc);
+                    std::streamsize count = boost::iostreams::read(in, out + decoded,
+                                                                   static_cast<std::streamsize>(destsize - decoded));
+                    if (count <= 0)
+                      break;
+                    decoded += static_cast<std::size_t>(count);
                   }
+                return decoded;
+              }
+            catch (const std::exception& e)
+              {
+                boost::format fmt("Failed to decode Deflate tile: %1%");
+                fmt % e.what();
+                throw Exception(fmt.str());
               }
           }
+        };
 
-        return ret;
-      }
+        // Registered tile codecs.
+        struct TileCodecRegistry
+        {
+          std::mutex                                              mutex;
+          std::map<Compression, std::shared_ptr<TileCodec>>       codecs;
+          std::map<Compression, std::shared_ptr<DeviceTileCodec>> devicecodecs;
 
-      const std::vector<std::string>&
-      getCodecNames()
-      {
-        static std::vector<std::string> ret;
+          TileCodecRegistry():
+            mutex(),
+            codecs(),
+            devicecodecs()
+          {
+            std::shared_ptr<TileCodec> zlib(std::make_shared<ZlibTileCodec>());
+            codecs[COMPRESSION_ADOBE_DEFLATE] = zlib;
+            codecs[COMPRESSION_DEFLATE] = zlib;
+          }
+        };
+
+        TileCodecRegistry&
+        tileCodecRegistry()
+        {
+          static TileCodecRegistry registry;
+          return registry;
+        }
 
-        if(ret.empty())
+        // Codec names usable with a pixel type.
+        std::vector<std::string>
+        pixelTypeCodecNames(const std::vector<Codec>& codecs,
+                            PixelType                 pixeltype)
+        {
+          std::vector<std::string> ptcodecs;
+          for (std::vector<Codec>::const_iterator i = codecs.begin();
+               i != codecs.end();
+               ++i)
+            {
+              switch(i->scheme)
+                {
+                  // Don't expose directly since it's not a real
+                  // codec and the API uses an optional here to
+                  // signify no compression.
+                case COMPRESSION_NONE:
+                  break;
+
+                  // Bilevel codecs
+                case COMPRESSION_CCITTRLE:
+                case COMPRESSION_CCITT_T4:
+                case COMPRESSION_CCITT_T6:
+                case COMPRESSION_CCITTRLEW:
+                case COMPRESSION_PACKBITS:
+                case COMPRESSION_T85:
+                case COMPRESSION_T43:
+                case COMPRESSION_JBIG: // also for other pixel types
+                                       // but there are better
+                                       // choices for other types
+                  if (pixeltype == PixelType::BIT)
+                    ptcodecs.push_back(i->name);
+                  break;
+
+                  // Codecs which work with all pixel types.
+                case COMPRESSION_LZW:
+                case COMPRESSION_ADOBE_DEFLATE:
+                case COMPRESSION_DEFLATE:
+                case COMPRESSION_LZMA:
+                case COMPRESSION_JP2000:
+                  ptcodecs.push_back(i->name);
+                  break;
+
+                  // JPEG compression of 8-bit data (12-bit not
+                  // supported by default, and this interface does
+                  // not cater for samples per pixel or bits per
+                  // sample when querying)
+                case COMPRESSION_JPEG:
+                  if (pixeltype == PixelType::UINT8)
+                    ptcodecs.push_back(i->name);
+                  break;
+
+                  // Compatibility codecs for decompression only.
+                case COMPRESSION_OJPEG:
+                  break;
+
+                  // Codecs incompatible with all pixel types (ignore).
+                case COMPRESSION_NEXT: // 2-bit
+                case COMPRESSION_THUNDERSCAN: // 4-bit
+                case COMPRESSION_PIXARFILM: // Pixar-specific
+                case COMPRESSION_PIXARLOG: // Pixar-specific
+                case COMPRESSION_SGILOG: // SGI-specific
+                case COMPRESSION_SGILOG24: // SGI-specific
+                case COMPRESSION_DCS: // Kodac-specific 10/12-bit
+                case COMPRESSION_IT8CTPAD: // Prepress image data
+                case COMPRESSION_IT8LW: // Prepress image data
+                case COMPRESSION_IT8MP: // Prepress image data
+                case COMPRESSION_IT8BL: // Prepress image data
+                  break;
+
+                  // Allow by default so we support codecs we don't
+                  // know about (but use with incompatible pixel
+                  // types at own risk).
+                default:
+                  ptcodecs.push_back(i->name);
+                  break;
+                }
+            }
+          return ptcodecs;
+        }
+
+        // Codec capability tables.  These are built once, on first
+        // use, and are immutable thereafter, so may be queried from
+        // any thread without locking.
+        struct CodecTables
+        {
+          std::vector<Codec>                            codecs;
+          std::vector<std::string>                      names;
+          std::map<PixelType, std::vector<std::string>> pixeltypes;
+          std::map<std::string, Compression>            schemes;
+
+          CodecTables():
+            codecs(),
+            names(),
+            pixeltypes(),
+            schemes()
           {
-            const std::vector<Codec>& codecs = getCodecs();
+            std::shared_ptr<TIFFCodec> tcodecs(TIFFGetConfiguredCODECs(), _TIFFfree);
+            if (tcodecs)
+              {
+                for (const TIFFCodec *c = &*tcodecs; c->name != nullptr; ++c)
+                  {
+                    Codec nc;
+                    nc.name = c->name;
+                    nc.scheme = static_cast<Compression>(c->scheme);
+                    codecs.push_back(nc);
+                  }
+              }
+
             for (std::vector<Codec>::const_iterator i = codecs.begin();
                  i != codecs.end();
                  ++i)
-              ret.push_back(i->name);
+              {
+                names.push_back(i->name);
+                schemes.insert(std::make_pair(i->name, i->scheme));
+              }
+
+            for (const auto& pixeltype : PixelType::values())
+              pixeltypes.insert(std::make_pair(PixelType(pixeltype.first),
+                                               pixelTypeCodecNames(codecs, pixeltype.first)));
           }
+        };
+
+        const CodecTables&
+        codecTables()
+        {
+          // Initialisation of a local static is thread-safe.
+          static const CodecTables tables;
+          return tables;
+        }
+
+      }
+
+      const std::vector<Codec>&
+      getCodecs()
+      {
+        return codecTables().codecs;
+      }
 
-        return ret;
+      const std::vector<std::string>&
+      getCodecNames()
+      {
+        return codecTables().names;
       }
 
       const std::vector<std::string>&
       getCodecNames(PixelType pixeltype)
       {
-        static std::map<PixelType, std::vector<std::string>> pixeltypes;
+        static const std::vector<std::string> none;
+
+        const CodecTables& tables(codecTables());
+        std::map<PixelType, std::vector<std::string>>::const_iterator found = tables.pixeltypes.find(pixeltype);
+        return found != tables.pixeltypes.end() ? found->second : none;
+      }
 
-        std::map<PixelType, std::vector<std::string>>::const_iterator found = pixeltypes.find(pixeltype);
-        if(found == pixeltypes.end())
+      Compression
+      getCodecScheme(const std::string& name)
+      {
+        const CodecTables& tables(codecTables());
+        std::map<std::string, Compression>::const_iterator found = tables.schemes.find(name);
+        return found != tables.schemes.end() ?
+          found->second : static_cast<Compression>(COMPRESSION_NONE);
+      }
+
+      bool
+      getCodecLevelRange(Compression  scheme,
+                         int&         minimum,
+                         int&         maximum)
+      {
+        bool supported = getCodecLevelTag(scheme) != 0;
+
+        if (supported)
           {
-            std::vector<std::string> ptcodecs;
-            const std::vector<Codec>& codecs = getCodecs();
-            for (std::vector<Codec>::const_iterator i = codecs.begin();
-                 i != codecs.end();
-                 ++i)
+            switch(scheme)
               {
-                switch(i->scheme)
-                  {
-                    // Don't expose directly since it's not a real
-                    // codec and the API uses an optional here to
-                    // signify no compression.
-                  case COMPRESSION_NONE:
-                    break;
-
-                    // Bilevel codecs
-                  case COMPRESSION_CCITTRLE:
-                  case COMPRESSION_CCITT_T4:
-                  case COMPRESSION_CCITT_T6:
-                  case COMPRESSION_CCITTRLEW:
-                  case COMPRESSION_PACKBITS:
-                  case COMPRESSION_T85:
-                  case COMPRESSION_T43:
-                  case COMPRESSION_JBIG: // also for other pixel types
-                                         // but there are better
-                                         // choices for other types
-                    if (pixeltype == PixelType::BIT)
-                      ptcodecs.push_back(i->name);
-                    break;
-
-                    // Codecs which work with all pixel types.
-                  case COMPRESSION_LZW:
-                  case COMPRESSION_ADOBE_DEFLATE:
-                  case COMPRESSION_DEFLATE:
-                  case COMPRESSION_LZMA:
-                  case COMPRESSION_JP2000:
-                    ptcodecs.push_back(i->name);
-                    break;
-
-                    // JPEG compression of 8-bit data (12-bit not
-                    // supported by default, and this interface does
-                    // not cater for samples per pixel or bits per
-                    // sample when querying)
-                  case COMPRESSION_JPEG:
-                    if (pixeltype == PixelType::UINT8)
-                      ptcodecs.push_back(i->name);
-                    break;
-
-                    // Compatibility codecs for decompression only.
-                  case COMPRESSION_OJPEG:
-                    break;
-
-                    // Codecs incompatible with all pixel types (ignore).
-                  case COMPRESSION_NEXT: // 2-bit
-                  case COMPRESSION_THUNDERSCAN: // 4-bit
-                  case COMPRESSION_PIXARFILM: // Pixar-specific
-                  case COMPRESSION_PIXARLOG: // Pixar-specific
-                  case COMPRESSION_SGILOG: // SGI-specific
-                  case COMPRESSION_SGILOG24: // SGI-specific
-                  case COMPRESSION_DCS: // Kodac-specific 10/12-bit
-                  case COMPRESSION_IT8CTPAD: // Prepress image data
-                  case COMPRESSION_IT8LW: // Prepress image data
-                  case COMPRESSION_IT8MP: // Prepress image data
-                  case COMPRESSION_IT8BL: // Prepress image data
-                    break;
-
-                    // Allow by default so we support codecs we don't
-                    // know about (but use with incompatible pixel
-                    // types at own risk).
-                  default:
-                    ptcodecs.push_back(i->name);
-                    break;
-                  }
+              case COMPRESSION_ADOBE_DEFLATE:
+              case COMPRESSION_DEFLATE:
+                minimum = 1;
+                maximum = 9;
+                break;
+              case COMPRESSION_LZMA:
+                minimum = 0;
+                maximum = 9;
+                break;
+              case COMPRESSION_JPEG:
+                minimum = 1;
+                maximum = 100;
+                break;
+#ifdef COMPRESSION_ZSTD
+              case COMPRESSION_ZSTD:
+                minimum = 1;
+                maximum = 22;
+                break;
+#endif
+#ifdef COMPRESSION_WEBP
+              case COMPRESSION_WEBP:
+                minimum = 1;
+                maximum = 100;
+                break;
+#endif
+              default:
+                supported = false;
+                break;
               }
+          }
 
-            std::pair<std::map<PixelType, std::vector<std::string>>::iterator, bool> inserted = pixeltypes.insert(std::make_pair(pixeltype, ptcodecs));
-            found = inserted.first;
+        return supported;
+      }
+
+      tag_type
+      getCodecLevelTag(Compression scheme)
+      {
+        tag_type tag = 0;
+
+        switch(scheme)
+          {
+#ifdef TIFFTAG_ZIPQUALITY
+          case COMPRESSION_ADOBE_DEFLATE:
+          case COMPRESSION_DEFLATE:
+            tag = TIFFTAG_ZIPQUALITY;
+            break;
+#endif
+#ifdef TIFFTAG_LZMAPRESET
+          case COMPRESSION_LZMA:
+            tag = TIFFTAG_LZMAPRESET;
+            break;
+#endif
+#ifdef TIFFTAG_JPEGQUALITY
+          case COMPRESSION_JPEG:
+            tag = TIFFTAG_JPEGQUALITY;
+            break;
+#endif
+#if defined(COMPRESSION_ZSTD) && defined(TIFFTAG_ZSTD_LEVEL)
+          case COMPRESSION_ZSTD:
+            tag = TIFFTAG_ZSTD_LEVEL;
+            break;
+#endif
+#if defined(COMPRESSION_WEBP) && defined(TIFFTAG_WEBP_LEVEL)
+          case COMPRESSION_WEBP:
+            tag = TIFFTAG_WEBP_LEVEL;
+            break;
+#endif
+          default:
+            break;
           }
 
-        return found->second;
+        return tag;
       }
 
-      Compression
-      getCodecScheme(const std::string& name)
+      bool
+      codecSupportsPredictor(Compression scheme)
       {
-        static std::map<std::string, Codec> cmap;
+        bool supported = false;
 
-        if(cmap.empty())
+        switch(scheme)
           {
-            const std::vector<Codec>& codecs = getCodecs();
-            for (std::vector<Codec>::const_iterator i = codecs.begin();
-                 i != codecs.end();
-                 ++i)
-              cmap.insert(std::make_pair(i->name, *i));
+          case COMPRESSION_LZW:
+          case COMPRESSION_ADOBE_DEFLATE:
+          case COMPRESSION_DEFLATE:
+          case COMPRESSION_LZMA:
+#ifdef COMPRESSION_ZSTD
+          case COMPRESSION_ZSTD:
+#endif
+            supported = true;
+            break;
+          default:
+            break;
+          }
+
+        return supported;
+      }
+
+      Predictor
+      getPixelTypePredictor(PixelType pixeltype)
+      {
+        Predictor predictor = NONE;
+
+        switch(pixeltype)
+          {
+          case PixelType::INT8:
+          case PixelType::INT16:
+          case PixelType::INT32:
+          case PixelType::UINT8:
+          case PixelType::UINT16:
+          case PixelType::UINT32:
+            predictor = HORIZONTAL;
+            break;
+          case PixelType::FLOAT:
+          case PixelType::DOUBLE:
+            predictor = FLOATING_POINT;
+            break;
+          default:
+            break;
           }
 
-        Compression ret = static_cast<Compression>(COMPRESSION_NONE);
-        std::map<std::string, Codec>::const_iterator found = cmap.find(name);
+        return predictor;
+      }
+
+      TileCodec::TileCodec()
+      {
+      }
 
-        if (found != cmap.end())
-          ret = found->second.scheme;
+      TileCodec::~TileCodec()
+      {
+      }
+
+      void
+      registerTileCodec(Compression                       scheme,
+                        const std::shared_ptr<TileCodec>& codec)
+      {
+        TileCodecRegistry& registry(tileCodecRegistry());
+        std::lock_guard<std::mutex> lock(registry.mutex);
+
+        if (codec)
+          registry.codecs[scheme] = codec;
+        else
+          registry.codecs.erase(scheme);
+      }
+
+      std::shared_ptr<TileCodec>
+      getTileCodec(Compression scheme)
+      {
+        TileCodecRegistry& registry(tileCodecRegistry());
+        std::lock_guard<std::mutex> lock(registry.mutex);
+
+        std::shared_ptr<TileCodec> codec;
+        auto found = registry.codecs.find(scheme);
+        if (found != registry.codecs.end())
+          codec = found->second;
+        return codec;
+      }
+
+      DeviceTileCodec::DeviceTileCodec()
+      {
+      }
+
+      DeviceTileCodec::~DeviceTileCodec()
+      {
+      }
+
+      void
+      registerDeviceTileCodec(Compression                             scheme,
+                              const std::shared_ptr<DeviceTileCodec>& codec)
+      {
+        TileCodecRegistry& registry(tileCodecRegistry());
+        std::lock_guard<std::mutex> lock(registry.mutex);
+
+        if (codec)
+          registry.devicecodecs[scheme] = codec;
+        else
+          registry.devicecodecs.erase(scheme);
+      }
+
+      std::shared_ptr<DeviceTileCodec>
+      getDeviceTileCodec(Compression scheme)
+      {
+        TileCodecRegistry& registry(tileCodecRegistry());
+        std::lock_guard<std::mutex> lock(registry.mutex);
 
-        return ret;
+        std::shared_ptr<DeviceTileCodec> codec;
+        auto found = registry.devicecodecs.find(scheme);
+        if (found != registry.devicecodecs.end())
+          codec = found->second;
+        return codec;
       }
     }
   }
@@ -38,9 +38,12 @@
 #ifndef OME_FILES_TIFF_CODEC_H
 #define OME_FILES_TIFF_CODEC_H
 
+#include <cstddef>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include <ome/files/Types.h>
 #include <ome/files/tiff/Types.h>
 
 #include <ome/xml/model/enums/PixelType.h>
@@ -98,6 +101,286 @@ namespace ome
        */
       Compression
       getCodecScheme(const std::string& name);
+
+      /**
+       * Get the range of compression levels supported by a codec.
+       *
+       * The level is the codec-specific compression level or
+       * quality, for example the Deflate level (1–9), the Zstandard
+       * level (1–22), the LZMA preset (0–9) or the JPEG quality
+       * (1–100).
+       *
+       * @param scheme the compression scheme.
+       * @param minimum the minimum level (set on success).
+       * @param maximum the maximum level (set on success).
+       * @returns @c true if the codec supports setting the level, or
+       * @c false if not supported by the codec or the TIFF library.
+       */
+      bool
+      getCodecLevelRange(Compression  scheme,
+                         int&         minimum,
+                         int&         maximum);
+
+      /**
+       * Get the TIFF pseudo-tag used to set the compression level of
+       * a codec.
+       *
+       * @param scheme the compression scheme.
+       * @returns the tag, or @c 0 if the codec does not support
+       * setting the level.
+       */
+      tag_type
+      getCodecLevelTag(Compression scheme);
+
+      /**
+       * Check if a codec supports a predictor.
+       *
+       * @param scheme the compression scheme.
+       * @returns @c true if the PREDICTOR tag is used by the codec,
+       * @c false otherwise.
+       */
+      bool
+      codecSupportsPredictor(Compression scheme);
+
+      /**
+       * Get the predictor suitable for a given pixel type.
+       *
+       * Horizontal differencing is used for integer types and
+       * floating point prediction for real floating point types.
+       * Bit and complex pixel types do not support prediction.
+       *
+       * @param pixeltype the pixel type to compress.
+       * @returns the predictor, or @c NONE if prediction is not
+       * supported for the pixel type.
+       */
+      Predictor
+      getPixelTypePredictor(ome::xml::model::enums::PixelType pixeltype);
+
+      /// Description of a tile or strip to be encoded or decoded.
+      struct TileCodecParameters
+      {
+        /// Compression scheme.
+        Compression                       scheme;
+        /// Pixel type.
+        ome::xml::model::enums::PixelType pixeltype;
+        /// Tile width (pixels).
+        dimension_size_type               width;
+        /// Tile height (rows).
+        dimension_size_type               height;
+        /// Samples per pixel (1 for separate planar configuration).
+        dimension_size_type               samples;
+        /// Compression level (-1 for the codec default).
+        int                               level;
+      };
+
+      /**
+       * Tile codec.
+       *
+       * A tile codec compresses and decompresses the raw data of a
+       * single tile or strip, independently of the TIFF library.
+       * Codecs registered with registerTileCodec() are used by IFD
+       * in place of the TIFF library's own codec for the same
+       * compression scheme, which permits tiles to be encoded and
+       * decoded in parallel, or using alternative implementations
+       * such as libdeflate, zlib-ng or hardware encoders.
+       *
+       * Registered codecs are only used where the raw tile data
+       * needs no further processing by the TIFF library, i.e. no
+       * predictor, byte swapping or bit reversal.  The TIFF library
+       * must still support the compression scheme, since it is
+       * responsible for the image directory; only the tile data is
+       * processed by the codec.
+       *
+       * Codecs may be used by several threads concurrently, and
+       * must therefore be thread-safe.
+       */
+      class TileCodec
+      {
+      public:
+        /// Constructor.
+        TileCodec();
+
+        /// Destructor.
+        virtual
+        ~TileCodec();
+
+      private:
+        /// @cond SKIP
+        TileCodec (const TileCodec&) = delete;
+
+        TileCodec&
+        operator= (const TileCodec&) = delete;
+        /// @endcond SKIP
+
+      public:
+        /**
+         * Encode a tile.
+         *
+         * @param params the tile parameters.
+         * @param src the uncompressed tile data.
+         * @param size the size of the uncompressed tile data (bytes).
+         * @param dest the destination for the compressed data; any
+         * existing content is replaced.
+         * @throws on encoding failure.
+         */
+        virtual
+        void
+        encode(const TileCodecParameters& params,
+               const void                *src,
+               std::size_t                size,
+               std::vector<char>&         dest) const = 0;
+
+        /**
+         * Decode a tile.
+         *
+         * At most @c destsize bytes are decoded; any remaining data
+         * is discarded.  Fewer bytes may be decoded if the encoded
+         * data is smaller, for example for the last strip of an
+         * image.
+         *
+         * @param params the tile parameters.
+         * @param src the compressed tile data.
+         * @param size the size of the compressed tile data (bytes).
+         * @param dest the destination for the decoded data.
+         * @param destsize the size of the destination (bytes).
+         * @returns the number of bytes decoded.
+         * @throws on decoding failure.
+         */
+        virtual
+        std::size_t
+        decode(const TileCodecParameters& params,
+               const void                *src,
+               std::size_t                size,
+               void                      *dest,
+               std::size_t                destsize) const = 0;
+      };
+
+      /**
+       * Register a tile codec for a compression scheme.
+       *
+       * This replaces any codec previously registered for the
+       * scheme.  By default, a zlib codec is registered for Deflate
+       * and Adobe Deflate compression.  Registering a null codec
+       * reverts to the TIFF library's own codec for the scheme.
+       *
+       * Registration affects subsequent reads and writes only.
+       *
+       * @param scheme the compression scheme.
+       * @param codec the codec to use, or null to use the TIFF
+       * library.
+       */
+      void
+      registerTileCodec(Compression                       scheme,
+                        const std::shared_ptr<TileCodec>& codec);
+
+      /**
+       * Get the tile codec registered for a compression scheme.
+       *
+       * @param scheme the compression scheme.
+       * @returns the codec, or null if no codec is registered.
+       */
+      std::shared_ptr<TileCodec>
+      getTileCodec(Compression scheme);
+
+      /// A tile or strip to decode into device memory.
+      struct DeviceTileRequest
+      {
+        /// Tile parameters.
+        TileCodecParameters params;
+        /// Compressed tile data (host memory), or null if the tile
+        /// is not present and must be zero-filled.
+        const void         *src;
+        /// Size of the compressed tile data (bytes).
+        std::size_t         size;
+        /// Left edge of the part of the tile to store (pixels).
+        dimension_size_type x;
+        /// Top edge of the part of the tile to store (rows).
+        dimension_size_type y;
+        /// Width of the part of the tile to store (pixels).
+        dimension_size_type w;
+        /// Height of the part of the tile to store (rows).
+        dimension_size_type h;
+        /// Destination of the first pixel of the part (device
+        /// memory).
+        void               *dest;
+        /// Distance between destination rows (bytes).
+        std::size_t         destpitch;
+      };
+
+      /**
+       * Device tile codec.
+       *
+       * A device tile codec decodes batches of tiles or strips on a
+       * GPU or other accelerator, directly into pixel buffers in
+       * device memory (see PixelAllocator::hostAccessible()).  Only
+       * the compressed data is transferred to the device.  Codecs
+       * registered with registerDeviceTileCodec() are used by
+       * IFD::readImage() when the destination buffer is not host
+       * accessible; they are not used for reads into host memory.
+       *
+       * As for TileCodec, the raw tile data is plainly encoded.
+       * For JPEG, any JPEGTables are merged into the data of each
+       * tile, so that each is a complete JPEG stream.
+       *
+       * Codecs may be used by several threads concurrently, and
+       * must therefore be thread-safe.
+       */
+      class DeviceTileCodec
+      {
+      public:
+        /// Constructor.
+        DeviceTileCodec();
+
+        /// Destructor.
+        virtual
+        ~DeviceTileCodec();
+
+      private:
+        /// @cond SKIP
+        DeviceTileCodec (const DeviceTileCodec&) = delete;
+
+        DeviceTileCodec&
+        operator= (const DeviceTileCodec&) = delete;
+        /// @endcond SKIP
+
+      public:
+        /**
+         * Decode a batch of tiles.
+         *
+         * The part of each tile described by the request is stored
+         * at its destination.  Decoding is complete on return.
+         *
+         * @param requests the tiles to decode.
+         * @throws on decoding failure.
+         */
+        virtual
+        void
+        decodeBatch(const std::vector<DeviceTileRequest>& requests) const = 0;
+      };
+
+      /**
+       * Register a device tile codec for a compression scheme.
+       *
+       * This replaces any device codec previously registered for the
+       * scheme.  No device codecs are registered by default.
+       * Registering a null codec removes the codec for the scheme.
+       *
+       * @param scheme the compression scheme.
+       * @param codec the codec to use, or null.
+       */
+      void
+      registerDeviceTileCodec(Compression                             scheme,
+                              const std::shared_ptr<DeviceTileCodec>& codec);
+
+      /**
+       * Get the device tile codec registered for a compression
+       * scheme.
+       *
+       * @param scheme the compression scheme.
+       * @returns the codec, or null if no codec is registered.
+       */
+      std::shared_ptr<DeviceTileCodec>
+      getDeviceTileCodec(Compression scheme);
     }
   }
 }
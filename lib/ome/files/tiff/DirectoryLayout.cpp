@@ -0,0 +1,635 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+
+#include <array>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <vector>
+
+#include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/format.hpp>
+
+#include <ome/files/tiff/DirectoryLayout.h>
+#include <ome/files/tiff/Exception.h>
+
+using boost::filesystem::path;
+
+namespace
+{
+
+  using ome::files::tiff::Exception;
+
+  // Tags referring to other directories or to data elsewhere in
+  // the file.
+  const uint16_t tag_image_description = 270U;
+  const uint16_t tag_strip_offsets = 273U;
+  const uint16_t tag_strip_byte_counts = 279U;
+  const uint16_t tag_tile_offsets = 324U;
+  const uint16_t tag_tile_byte_counts = 325U;
+  const uint16_t tag_subifd = 330U;
+  const uint16_t tag_jpeg_interchange_format = 513U;
+  const uint16_t tag_exif_ifd = 34665U;
+  const uint16_t tag_gps_ifd = 34853U;
+  const uint16_t tag_interoperability_ifd = 40965U;
+
+  const uint16_t type_ascii = 2U;
+
+  // Size of a single value of a field type, or zero if unknown.
+  uint64_t
+  typeSize(uint16_t type)
+  {
+    switch(type)
+      {
+      case 1U: // BYTE
+      case 2U: // ASCII
+      case 6U: // SBYTE
+      case 7U: // UNDEFINED
+        return 1U;
+      case 3U: // SHORT
+      case 8U: // SSHORT
+        return 2U;
+      case 4U: // LONG
+      case 9U: // SLONG
+      case 11U: // FLOAT
+      case 13U: // IFD
+        return 4U;
+      case 5U: // RATIONAL
+      case 10U: // SRATIONAL
+      case 12U: // DOUBLE
+      case 16U: // LONG8
+      case 17U: // SLONG8
+      case 18U: // IFD8
+        return 8U;
+      default:
+        return 0U;
+      }
+  }
+
+  uint64_t
+  decode(const uint8_t *data,
+         uint64_t       size,
+         bool           bigEndian)
+  {
+    uint64_t value = 0U;
+    for (uint64_t i = 0; i < size; ++i)
+      value |= static_cast<uint64_t>(data[bigEndian ? i : size - 1 - i]) << (8U * (size - 1 - i));
+    return value;
+  }
+
+  void
+  encode(uint8_t  *data,
+         uint64_t  size,
+         bool      bigEndian,
+         uint64_t  value)
+  {
+    for (uint64_t i = 0; i < size; ++i)
+      data[bigEndian ? size - 1 - i : i] = static_cast<uint8_t>(value >> (8U * i));
+  }
+
+  uint64_t
+  align(uint64_t offset)
+  {
+    return (offset + 7U) & ~uint64_t(7U);
+  }
+
+  /// A directory entry.
+  struct Entry
+  {
+    /// Tag number.
+    uint16_t tag;
+    /// Field type.
+    uint16_t type;
+    /// Number of values.
+    uint64_t count;
+    /// Value data.
+    std::vector<uint8_t> value;
+    /// New offset of the value data, if not inline.
+    uint64_t offset;
+  };
+
+  /// A directory.
+  struct Directory
+  {
+    /// Directory entries.
+    std::vector<Entry> entries;
+    /// Index of the next directory (or npos).
+    std::size_t next;
+    /// Indexes of the SubIFD chains.
+    std::vector<std::size_t> subifds;
+    /// New offset of the directory.
+    uint64_t offset;
+  };
+
+  /// Copy of a tile or strip to its new location.
+  struct Strile
+  {
+    /// Original offset.
+    uint64_t from;
+    /// New offset.
+    uint64_t to;
+    /// Size in bytes.
+    uint64_t size;
+  };
+
+  const std::size_t npos = static_cast<std::size_t>(-1);
+
+  class DirectoryParser
+  {
+  public:
+    DirectoryParser(const path& file):
+      file(file),
+      in(file, std::ios::in | std::ios::binary),
+      bigEndian(false),
+      bigTIFF(false),
+      directories(),
+      seen(),
+      nextOffset(0U)
+    {
+      if (!in)
+        fail("Failed to open");
+
+      std::array<uint8_t, 16> header;
+      read(0U, header.data(), 8U);
+      if (header[0] == 'I' && header[1] == 'I')
+        bigEndian = false;
+      else if (header[0] == 'M' && header[1] == 'M')
+        bigEndian = true;
+      else
+        fail("Invalid endian header");
+
+      uint64_t first;
+      const uint64_t version = decode(&header[2], 2U, bigEndian);
+      if (version == 42U)
+        first = decode(&header[4], 4U, bigEndian);
+      else if (version == 43U)
+        {
+          bigTIFF = true;
+          read(8U, &header[8], 8U);
+          if (decode(&header[4], 2U, bigEndian) != 8U)
+            fail("Unsupported BigTIFF offset size");
+          first = decode(&header[8], 8U, bigEndian);
+        }
+      else
+        fail("Invalid version");
+
+      if (!first)
+        fail("No directories");
+      parseChain(first);
+    }
+
+    void
+    fail(const std::string& message) const
+    {
+      boost::format fmt("%1%: %2%");
+      fmt % file.string() % message;
+      throw Exception(fmt.str());
+    }
+
+    void
+    read(uint64_t  offset,
+         void     *buffer,
+         uint64_t  size)
+    {
+      in.seekg(static_cast<std::streamoff>(offset));
+      in.read(static_cast<char *>(buffer), static_cast<std::streamsize>(size));
+      if (!in)
+        {
+          boost::format fmt("Failed to read %1% bytes at offset %2%");
+          fmt % size % offset;
+          fail(fmt.str());
+        }
+    }
+
+    uint64_t
+    offsetSize() const
+    {
+      return bigTIFF ? 8U : 4U;
+    }
+
+    // Parse a chain of directories, returning the index of the first.
+    std::size_t
+    parseChain(uint64_t offset)
+    {
+      std::size_t first = npos;
+      std::size_t previous = npos;
+      while (offset)
+        {
+          std::size_t current;
+          std::map<uint64_t, std::size_t>::const_iterator found = seen.find(offset);
+          if (found != seen.end())
+            current = found->second; // Already linked (e.g. chained SubIFDs).
+          else
+            current = parseDirectory(offset);
+
+          if (previous == npos)
+            first = current;
+          else
+            directories[previous].next = current;
+
+          if (found != seen.end())
+            break;
+
+          previous = current;
+          offset = nextOffset;
+        }
+      return first;
+    }
+
+    // Parse a single directory, and any SubIFDs, setting nextOffset
+    // to the offset of the following directory.
+    std::size_t
+    parseDirectory(uint64_t offset)
+    {
+      const std::size_t index = directories.size();
+      seen.insert(std::make_pair(offset, index));
+      directories.push_back(Directory());
+      directories.back().next = npos;
+      directories.back().offset = 0U;
+
+      const uint64_t countSize = bigTIFF ? 8U : 2U;
+      const uint64_t entrySize = bigTIFF ? 20U : 12U;
+
+      std::array<uint8_t, 8> raw;
+      read(offset, raw.data(), countSize);
+      const uint64_t count = decode(raw.data(), countSize, bigEndian);
+
+      std::vector<uint8_t> block(static_cast<std::vector<uint8_t>::size_type>(count * entrySize + offsetSize()));
+      read(offset + countSize, block.data(), block.size());
+
+      std::vector<Entry> entries(static_cast<std::vector<Entry>::size_type>(count));
+      for (uint64_t i = 0; i < count; ++i)
+        {
+          const uint8_t *e = &block[static_cast<std::vector<uint8_t>::size_type>(i * entrySize)];
+          Entry& entry(entries[static_cast<std::vector<Entry>::size_type>(i)]);
+          entry.tag = static_cast<uint16_t>(decode(e, 2U, bigEndian));
+          entry.type = static_cast<uint16_t>(decode(e + 2, 2U, bigEndian));
+          entry.count = decode(e + 4, offsetSize(), bigEndian);
+          entry.offset = 0U;
+
+          switch(entry.tag)
+            {
+            case tag_jpeg_interchange_format:
+            case tag_exif_ifd:
+            case tag_gps_ifd:
+            case tag_interoperability_ifd:
+              {
+                boost::format fmt("Unsupported tag %1%");
+                fmt % entry.tag;
+                fail(fmt.str());
+              }
+              break;
+            default:
+              break;
+            }
+
+          const uint64_t size = typeSize(entry.type);
+          if (!size)
+            {
+              boost::format fmt("Unsupported type %1% for tag %2%");
+              fmt % entry.type % entry.tag;
+              fail(fmt.str());
+            }
+          if (entry.count > std::numeric_limits<uint64_t>::max() / size)
+            fail("Invalid value count");
+
+          entry.value.resize(static_cast<std::vector<uint8_t>::size_type>(entry.count * size));
+          const uint8_t *valueField = e + 4 + offsetSize();
+          if (entry.value.size() <= offsetSize())
+            std::copy(valueField, valueField + entry.value.size(), entry.value.begin());
+          else
+            read(decode(valueField, offsetSize(), bigEndian), entry.value.data(), entry.value.size());
+        }
+      const uint64_t next = decode(&block[static_cast<std::vector<uint8_t>::size_type>(count * entrySize)],
+                                   offsetSize(), bigEndian);
+
+      directories[index].entries.swap(entries);
+
+      for (const auto& entry : directories[index].entries)
+        {
+          if (entry.tag != tag_subifd)
+            continue;
+          const uint64_t size = typeSize(entry.type);
+          for (uint64_t i = 0; i < entry.count; ++i)
+            {
+              const uint64_t sub = decode(&entry.value[static_cast<std::vector<uint8_t>::size_type>(i * size)],
+                                          size, bigEndian);
+              const std::size_t subindex = parseChain(sub);
+              directories[index].subifds.push_back(subindex);
+            }
+        }
+
+      nextOffset = next;
+      return index;
+    }
+
+    /// The file.
+    path file;
+    /// The file stream.
+    boost::filesystem::ifstream in;
+    /// Big endian byte order.
+    bool bigEndian;
+    /// BigTIFF format.
+    bool bigTIFF;
+    /// All directories, in file order.
+    std::vector<Directory> directories;
+    /// Directories parsed, by original offset.
+    std::map<uint64_t, std::size_t> seen;
+    /// Offset of the directory following the last parsed.
+    uint64_t nextOffset;
+  };
+
+  // Get the values of an integer entry.
+  std::vector<uint64_t>
+  getValues(const Entry& entry,
+            bool         bigEndian)
+  {
+    const uint64_t size = typeSize(entry.type);
+    std::vector<uint64_t> values(static_cast<std::vector<uint64_t>::size_type>(entry.count));
+    for (uint64_t i = 0; i < entry.count; ++i)
+      values[static_cast<std::vector<uint64_t>::size_type>(i)] =
+        decode(&entry.value[static_cast<std::vector<uint8_t>::size_type>(i * size)], size, bigEndian);
+    return values;
+  }
+
+  // Set the values of an integer entry.
+  bool
+  setValues(Entry&                       entry,
+            bool                         bigEndian,
+            const std::vector<uint64_t>& values)
+  {
+    const uint64_t size = typeSize(entry.type);
+    const uint64_t max = size >= 8U ? std::numeric_limits<uint64_t>::max() : (uint64_t(1U) << (8U * size)) - 1U;
+    for (uint64_t i = 0; i < entry.count; ++i)
+      {
+        const uint64_t value = values[static_cast<std::vector<uint64_t>::size_type>(i)];
+        if (value > max)
+          return false;
+        encode(&entry.value[static_cast<std::vector<uint8_t>::size_type>(i * size)], size, bigEndian, value);
+      }
+    return true;
+  }
+
+  Entry *
+  findEntry(Directory& directory,
+            uint16_t   tag)
+  {
+    for (auto& entry : directory.entries)
+      if (entry.tag == tag)
+        return &entry;
+    return nullptr;
+  }
+
+}
+
+namespace ome
+{
+  namespace files
+  {
+    namespace tiff
+    {
+
+      uint64_t
+      clusterDirectories(const boost::filesystem::path& file)
+      {
+        DirectoryParser parser(file);
+        std::vector<Directory>& directories(parser.directories);
+        const bool bigEndian = parser.bigEndian;
+        const uint64_t offsetSize = parser.offsetSize();
+        const uint64_t countSize = parser.bigTIFF ? 8U : 2U;
+        const uint64_t entrySize = parser.bigTIFF ? 20U : 12U;
+
+        // Place each directory followed by its values, and then the
+        // ImageDescription text, which may be large.
+        uint64_t pos = parser.bigTIFF ? 16U : 8U;
+        for (auto& directory : directories)
+          {
+            pos = align(pos);
+            directory.offset = pos;
+            pos += countSize + directory.entries.size() * entrySize + offsetSize;
+            for (auto& entry : directory.entries)
+              {
+                if (entry.value.size() <= offsetSize ||
+                    (entry.tag == tag_image_description && entry.type == type_ascii))
+                  continue;
+                pos = align(pos);
+                entry.offset = pos;
+                pos += entry.value.size();
+              }
+          }
+        for (auto& directory : directories)
+          for (auto& entry : directory.entries)
+            {
+              if (entry.value.size() <= offsetSize ||
+                  !(entry.tag == tag_image_description && entry.type == type_ascii))
+                continue;
+              entry.offset = pos;
+              pos += entry.value.size();
+            }
+        const uint64_t metadataSize = pos;
+
+        // Place the tile and strip data, in directory order.  Data
+        // shared by several tiles or strips remains shared.
+        std::vector<Strile> striles;
+        std::map<std::pair<uint64_t, uint64_t>, uint64_t> placed;
+        const std::array<std::pair<uint16_t, uint16_t>, 2> strileTags
+          {{std::make_pair(tag_strip_offsets, tag_strip_byte_counts),
+            std::make_pair(tag_tile_offsets, tag_tile_byte_counts)}};
+        for (auto& directory : directories)
+          {
+            for (const auto& tags : strileTags)
+              {
+                Entry *offsetEntry = findEntry(directory, tags.first);
+                Entry *countEntry = findEntry(directory, tags.second);
+                if (!offsetEntry)
+                  continue;
+                if (!countEntry || countEntry->count != offsetEntry->count)
+                  parser.fail("Mismatched tile or strip offsets and byte counts");
+
+                std::vector<uint64_t> offsets(getValues(*offsetEntry, bigEndian));
+                const std::vector<uint64_t> counts(getValues(*countEntry, bigEndian));
+                for (std::vector<uint64_t>::size_type i = 0; i < offsets.size(); ++i)
+                  {
+                    if (!offsets[i] || !counts[i])
+                      continue; // Absent tile or strip.
+
+                    const std::pair<uint64_t, uint64_t> key(offsets[i], counts[i]);
+                    auto found = placed.find(key);
+                    if (found != placed.end())
+                      {
+                        offsets[i] = found->second;
+                        continue;
+                      }
+
+                    pos = align(pos);
+                    const Strile strile = {offsets[i], pos, counts[i]};
+                    striles.push_back(strile);
+                    placed.insert(std::make_pair(key, pos));
+                    offsets[i] = pos;
+                    pos += counts[i];
+                  }
+                if (!setValues(*offsetEntry, bigEndian, offsets))
+                  parser.fail("Tile or strip offsets exceed the range of the offset type");
+              }
+          }
+
+        // Link SubIFDs.
+        for (auto& directory : directories)
+          {
+            Entry *subifd = findEntry(directory, tag_subifd);
+            if (!subifd)
+              continue;
+            std::vector<uint64_t> offsets;
+            for (const auto& sub : directory.subifds)
+              offsets.push_back(directories[sub].offset);
+            if (offsets.size() != subifd->count || !setValues(*subifd, bigEndian, offsets))
+              parser.fail("Invalid SubIFD offsets");
+          }
+
+        // Assemble the header, directories and values.
+        std::vector<uint8_t> metadata(static_cast<std::vector<uint8_t>::size_type>(metadataSize), 0U);
+        metadata[0] = metadata[1] = bigEndian ? 'M' : 'I';
+        if (parser.bigTIFF)
+          {
+            encode(&metadata[2], 2U, bigEndian, 43U);
+            encode(&metadata[4], 2U, bigEndian, 8U);
+            encode(&metadata[8], 8U, bigEndian, directories.front().offset);
+          }
+        else
+          {
+            encode(&metadata[2], 2U, bigEndian, 42U);
+            encode(&metadata[4], 4U, bigEndian, directories.front().offset);
+          }
+
+        for (const auto& directory : directories)
+          {
+            uint8_t *d = &metadata[static_cast<std::vector<uint8_t>::size_type>(directory.offset)];
+            encode(d, countSize, bigEndian, directory.entries.size());
+            d += countSize;
+            for (const auto& entry : directory.entries)
+              {
+                encode(d, 2U, bigEndian, entry.tag);
+                encode(d + 2, 2U, bigEndian, entry.type);
+                encode(d + 4, offsetSize, bigEndian, entry.count);
+                uint8_t *valueField = d + 4 + offsetSize;
+                if (entry.value.size() <= offsetSize)
+                  std::copy(entry.value.begin(), entry.value.end(), valueField);
+                else
+                  {
+                    encode(valueField, offsetSize, bigEndian, entry.offset);
+                    std::copy(entry.value.begin(), entry.value.end(),
+                              &metadata[static_cast<std::vector<uint8_t>::size_type>(entry.offset)]);
+                  }
+                d += entrySize;
+              }
+            encode(d, offsetSize, bigEndian,
+                   directory.next == npos ? 0U : directories[directory.next].offset);
+          }
+
+        if (!parser.bigTIFF && pos > std::numeric_limits<uint32_t>::max())
+          parser.fail("Clustered layout exceeds the size of a classic TIFF");
+
+        // Write the new file, and replace the original.
+        const path temp(file.parent_path() /
+                        boost::filesystem::unique_path(file.filename().string() + ".%%%%-%%%%-%%%%.tmp"));
+        try
+          {
+            boost::filesystem::ofstream out(temp, std::ios::out | std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<const char *>(metadata.data()), static_cast<std::streamsize>(metadata.size()));
+
+            std::vector<char> buffer(1024U * 1024U);
+            uint64_t outpos = metadataSize;
+            for (const auto& strile : striles)
+              {
+                for (; outpos < strile.to; ++outpos)
+                  out.put('\0');
+                parser.in.seekg(static_cast<std::streamoff>(strile.from));
+                for (uint64_t remaining = strile.size; remaining && out;)
+                  {
+                    const std::streamsize chunk =
+                      static_cast<std::streamsize>(std::min<uint64_t>(remaining, buffer.size()));
+                    parser.in.read(buffer.data(), chunk);
+                    if (!parser.in)
+                      {
+                        boost::format fmt("Failed to read tile or strip data at offset %1%");
+                        fmt % strile.from;
+                        parser.fail(fmt.str());
+                      }
+                    out.write(buffer.data(), chunk);
+                    remaining -= static_cast<uint64_t>(chunk);
+                  }
+                outpos += strile.size;
+              }
+
+            out.close();
+            if (!out)
+              {
+                boost::format fmt("Failed to write %1%");
+                fmt % temp.string();
+                throw Exception(fmt.str());
+              }
+
+            parser.in.close();
+            boost::filesystem::rename(temp, file);
+          }
+        catch (const boost::filesystem::filesystem_error& e)
+          {
+            boost::system::error_code ec;
+            boost::filesystem::remove(temp, ec);
+            throw Exception(e.what());
+          }
+        catch (...)
+          {
+            boost::system::error_code ec;
+            boost::filesystem::remove(temp, ec);
+            throw;
+          }
+
+        return metadataSize;
+      }
+
+    }
+  }
+}
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
@@ -0,0 +1,101 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+
+#ifndef OME_FILES_TIFF_DIRECTORYLAYOUT_H
+#define OME_FILES_TIFF_DIRECTORYLAYOUT_H
+
+#include <cstdint>
+
+#include <boost/filesystem/path.hpp>
+
+namespace ome
+{
+  namespace files
+  {
+    namespace tiff
+    {
+
+      /**
+       * Cluster all directories at the start of a TIFF file.
+       *
+       * libtiff writes each IFD after the image data it describes,
+       * and the OME-XML ImageDescription is appended once the file
+       * is complete, so a reader must make many small reads
+       * scattered across the whole file to discover its
+       * directories.  This is costly for remote (cloud) storage,
+       * where every read is a separate request.
+       *
+       * The file is rewritten so that the header is followed by
+       * every IFD (including SubIFDs), together with all tag
+       * values which are not stored inline in the IFD entries,
+       * such as the tile or strip offset and byte count arrays.
+       * Large ASCII values, such as the OME-XML ImageDescription,
+       * follow the directories.  The tile and strip data follow in
+       * directory order.  All the directory metadata may then be
+       * fetched with one or two large reads (see RangeSource).
+       *
+       * The file is written to a temporary file in the same
+       * directory, which then replaces the original.  It must not
+       * be open for writing by libtiff.
+       *
+       * Only the tile and strip data of each directory are
+       * retained; unreferenced space, such as the old directories
+       * and ImageDescription text, is discarded.  EXIF, GPS and
+       * JPEG interchange format data, which are not written by
+       * this library, are not supported.
+       *
+       * @param file the TIFF file to rewrite.
+       * @returns the size of the clustered directory metadata, in
+       * bytes from the start of the file.
+       * @throws an Exception if the file is not a valid TIFF or
+       * contains unsupported tags, or on failure to write.
+       */
+      uint64_t
+      clusterDirectories(const boost::filesystem::path& file);
+
+    }
+  }
+}
+
+#endif // OME_FILES_TIFF_DIRECTORYLAYOUT_H
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
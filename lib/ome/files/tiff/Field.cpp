@@ -131,7 +131,8 @@ namespace ome
         {
           if (!fieldinfo)
             {
-              Sentry sentry;
+              std::shared_ptr<TIFF> tiff(getIFD()->getTIFF());
+              Sentry sentry(*tiff);
 
               fieldinfo = TIFFFindField(getTIFF(), tag, TIFF_ANY);
               // The returned tag is sometimes incorrect (all libtiff versions)
@@ -201,7 +202,8 @@ namespace ome
       {
         std::string ret("Unknown");
 
-        Sentry sentry;
+        std::shared_ptr<TIFF> tiff(impl->getIFD()->getTIFF());
+        Sentry sentry(*tiff);
 
         const ::TIFFField *field = impl->getFieldInfo();
         if (field)
@@ -223,7 +225,8 @@ namespace ome
       {
         Type ret = TYPE_UNDEFINED;
 
-        Sentry sentry;
+        std::shared_ptr<TIFF> tiff(impl->getIFD()->getTIFF());
+        Sentry sentry(*tiff);
 
         const ::TIFFField *field = impl->getFieldInfo();
         if (field)
@@ -237,7 +240,8 @@ namespace ome
       {
         bool ret = false;
 
-        Sentry sentry;
+        std::shared_ptr<TIFF> tiff(impl->getIFD()->getTIFF());
+        Sentry sentry(*tiff);
 
         const ::TIFFField *field = impl->getFieldInfo();
         if (field)
@@ -251,7 +255,8 @@ namespace ome
       {
         int ret = 1;
 
-        Sentry sentry;
+        std::shared_ptr<TIFF> tiff(impl->getIFD()->getTIFF());
+        Sentry sentry(*tiff);
 
         const ::TIFFField *field = impl->getFieldInfo();
         if (field)
@@ -265,7 +270,8 @@ namespace ome
       {
         int ret = 1;
 
-        Sentry sentry;
+        std::shared_ptr<TIFF> tiff(impl->getIFD()->getTIFF());
+        Sentry sentry(*tiff);
 
         const ::TIFFField *field = impl->getFieldInfo();
         if (field)
@@ -286,6 +292,12 @@ namespace ome
         return impl->getIFD();
       }
 
+      bool
+      FieldBase::isSet() const
+      {
+        return impl->getIFD()->hasRawField(impl->tag);
+      }
+
       namespace
       {
 
@@ -423,7 +435,9 @@ namespace ome
         {
           // Special case:
           if (tag == TIFFTAG_IMAGEJ_META_DATA_BYTE_COUNTS ||
-              tag == TIFFTAG_IMAGEJ_META_DATA)
+              tag == TIFFTAG_IMAGEJ_META_DATA ||
+              tag == TIFFTAG_OME_TILE_STATISTICS ||
+              tag == TIFFTAG_OME_TILE_CHECKSUMS)
             {
               readcount = TIFF_VARIABLE2;
             }
@@ -143,6 +143,15 @@ namespace ome
         std::shared_ptr<IFD>
         getIFD() const;
 
+        /**
+         * Check if the field is set.
+         *
+         * @returns @c true if set, @c false otherwise.
+         * @see IFD::hasRawField().
+         */
+        bool
+        isSet() const;
+
       protected:
         class Impl;
         /// Private implementation details.
@@ -191,6 +200,26 @@ namespace ome
         void
         get(value_type& value) const;
 
+        /**
+         * Get the value for this field, if set.
+         *
+         * As for get(), but an unset field is not an error.  Use
+         * this when probing for optional tags, to avoid the cost of
+         * throwing an exception for each missing tag.
+         *
+         * @param value the variable in which the field value will be
+         * stored; unchanged if the field is not set.
+         * @returns @c true if the field is set, @c false otherwise.
+         */
+        bool
+        tryGet(value_type& value) const
+        {
+          if (!isSet())
+            return false;
+          get(value);
+          return true;
+        }
+
         /**
          * Set the value for this field.
          *
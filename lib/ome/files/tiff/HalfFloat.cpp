@@ -0,0 +1,198 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <cstring>
+
+#include <ome/files/tiff/HalfFloat.h>
+
+#if defined(__F16C__)
+# include <immintrin.h>
+#elif (defined(__ARM_NEON) || defined(__ARM_NEON__)) && defined(__aarch64__)
+# include <arm_neon.h>
+#endif
+
+namespace
+{
+
+  using ::ome::files::dimension_size_type;
+
+  // Convert a single half precision value.  Subnormals are
+  // normalized by shifting the mantissa up to the implicit bit.
+  inline float
+  halfToFloatScalar(uint16_t h)
+  {
+    uint32_t sign = static_cast<uint32_t>(h & 0x8000U) << 16U;
+    uint32_t exponent = (h >> 10U) & 0x1FU;
+    uint32_t mantissa = h & 0x3FFU;
+    uint32_t bits;
+
+    if (exponent == 0U)
+      {
+        if (mantissa == 0U)
+          bits = sign;
+        else
+          {
+            exponent = 127U - 15U + 1U;
+            while (!(mantissa & 0x400U))
+              {
+                mantissa <<= 1U;
+                --exponent;
+              }
+            bits = sign | (exponent << 23U) | ((mantissa & 0x3FFU) << 13U);
+          }
+      }
+    else if (exponent == 0x1FU)
+      // Infinity and NaN; NaNs are made quiet, as by F16C and NEON.
+      bits = sign | 0x7F800000U | (mantissa ? 0x400000U : 0U) | (mantissa << 13U);
+    else
+      bits = sign | ((exponent + 127U - 15U) << 23U) | (mantissa << 13U);
+
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+
+  // Convert a single value to half precision, rounding to nearest
+  // with ties to even.
+  inline uint16_t
+  floatToHalfScalar(float value)
+  {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = (bits >> 16U) & 0x8000U;
+    uint32_t magnitude = bits & 0x7FFFFFFFU;
+
+    // Infinity and NaN; NaNs are kept quiet.
+    if (magnitude >= 0x7F800000U)
+      return static_cast<uint16_t>(sign | 0x7C00U |
+                                   (magnitude > 0x7F800000U ?
+                                    (0x200U | ((magnitude >> 13U) & 0x3FFU)) : 0U));
+
+    // At least 65520, the midpoint between the largest half
+    // precision value and 65536, rounds to infinity.
+    if (magnitude >= 0x477FF000U)
+      return static_cast<uint16_t>(sign | 0x7C00U);
+
+    // Below the smallest normal value; at most 2^-25 rounds to zero.
+    if (magnitude < 0x38800000U)
+      {
+        if (magnitude <= 0x33000000U)
+          return static_cast<uint16_t>(sign);
+        uint32_t exponent = magnitude >> 23U;
+        uint32_t mantissa = (magnitude & 0x7FFFFFU) | 0x800000U;
+        uint32_t shift = 126U - exponent;
+        uint32_t half = mantissa >> shift;
+        uint32_t rest = mantissa & ((1U << shift) - 1U);
+        uint32_t midpoint = 1U << (shift - 1U);
+        if (rest > midpoint || (rest == midpoint && (half & 1U)))
+          ++half;
+        return static_cast<uint16_t>(sign | half);
+      }
+
+    // Rebias the exponent; a mantissa carry increments the exponent.
+    uint32_t half = (magnitude - ((127U - 15U) << 23U)) >> 13U;
+    uint32_t rest = magnitude & 0x1FFFU;
+    if (rest > 0x1000U || (rest == 0x1000U && (half & 1U)))
+      ++half;
+    return static_cast<uint16_t>(sign | half);
+  }
+
+}
+
+namespace ome
+{
+  namespace files
+  {
+    namespace tiff
+    {
+
+      void
+      halfToFloat(const uint16_t      *src,
+                  float               *dest,
+                  dimension_size_type  count)
+      {
+        dimension_size_type done = 0U;
+
+#if defined(__F16C__)
+        for (; done + 8U <= count; done += 8U)
+          {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + done));
+            _mm256_storeu_ps(dest + done, _mm256_cvtph_ps(v));
+          }
+#elif (defined(__ARM_NEON) || defined(__ARM_NEON__)) && defined(__aarch64__)
+        for (; done + 4U <= count; done += 4U)
+          {
+            float16x4_t v = vreinterpret_f16_u16(vld1_u16(src + done));
+            vst1q_f32(dest + done, vcvt_f32_f16(v));
+          }
+#endif
+
+        for (; done < count; ++done)
+          dest[done] = halfToFloatScalar(src[done]);
+      }
+
+      void
+      floatToHalf(const float         *src,
+                  uint16_t            *dest,
+                  dimension_size_type  count)
+      {
+        dimension_size_type done = 0U;
+
+#if defined(__F16C__)
+        for (; done + 8U <= count; done += 8U)
+          {
+            __m256 v = _mm256_loadu_ps(src + done);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + done),
+                             _mm256_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT));
+          }
+#elif (defined(__ARM_NEON) || defined(__ARM_NEON__)) && defined(__aarch64__)
+        // Rounding uses the current mode, which is to nearest with
+        // ties to even by default.
+        for (; done + 4U <= count; done += 4U)
+          {
+            float16x4_t v = vcvt_f16_f32(vld1q_f32(src + done));
+            vst1_u16(dest + done, vreinterpret_u16_f16(v));
+          }
+#endif
+
+        for (; done < count; ++done)
+          dest[done] = floatToHalfScalar(src[done]);
+      }
+
+    }
+  }
+}
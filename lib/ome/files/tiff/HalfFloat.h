@@ -0,0 +1,100 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#ifndef OME_FILES_TIFF_HALFFLOAT_H
+#define OME_FILES_TIFF_HALFFLOAT_H
+
+#include <cstdint>
+
+#include <ome/files/Types.h>
+
+namespace ome
+{
+  namespace files
+  {
+    namespace tiff
+    {
+
+      /**
+       * Convert half precision samples to single precision.
+       *
+       * IEEE floating point TIFF samples of 16 bits are stored in
+       * half precision, and are converted to and from FLOAT samples
+       * as each tile is transferred, since the OME data model has no
+       * half precision pixel type.
+       *
+       * The conversion is exact for all values, including
+       * subnormals, infinities and NaNs.  The F16C or NEON half
+       * precision conversion instructions are used where available.
+       *
+       * @param src the half precision source samples.
+       * @param dest the single precision destination samples.
+       * @param count the number of samples to convert.
+       */
+      void
+      halfToFloat(const uint16_t      *src,
+                  float               *dest,
+                  dimension_size_type  count);
+
+      /**
+       * Convert single precision samples to half precision.
+       *
+       * Values are rounded to the nearest half precision value, with
+       * ties to even.  Values too large to represent become
+       * infinities, and NaNs remain NaNs.  The F16C or NEON half
+       * precision conversion instructions are used where available.
+       *
+       * @param src the single precision source samples.
+       * @param dest the half precision destination samples.
+       * @param count the number of samples to convert.
+       */
+      void
+      floatToHalf(const float         *src,
+                  uint16_t            *dest,
+                  dimension_size_type  count);
+
+    }
+  }
+}
+
+#endif // OME_FILES_TIFF_HALFFLOAT_H
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
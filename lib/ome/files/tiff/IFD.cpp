@@ -39,40 +39,941 @@
 #include <cmath>
 #include <cstdarg>
 #include <cassert>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <vector>
 
-#include <boost/format.hpp>
+#include <fcntl.h> // For O_RDONLY on Unix and Windows
 
+#include <boost/format.hpp>
+#include <boost/optional.hpp>
+
+#include <ome/files/config-internal.h>
+#include <ome/files/Checksum.h>
+#include <ome/files/DecodedTileCache.h>
+#include <ome/files/Executor.h>
+#include <ome/files/IOStatistics.h>
+#include <ome/files/LockStatistics.h>
+#include <ome/files/PixelAllocator.h>
+#include <ome/files/PixelBufferView.h>
+#include <ome/files/PixelCopy.h>
+#include <ome/files/PixelStatistics.h>
 #include <ome/files/PlaneRegion.h>
 #include <ome/files/TileBuffer.h>
 #include <ome/files/TileCache.h>
+#include <ome/files/TraceObserver.h>
+#include <ome/files/tiff/BitPack.h>
+#include <ome/files/tiff/Codec.h>
 #include <ome/files/tiff/IFD.h>
+#include <ome/files/tiff/ImageLayout.h>
 #include <ome/files/tiff/Tags.h>
 #include <ome/files/tiff/Field.h>
+#include <ome/files/tiff/HalfFloat.h>
+#include <ome/files/tiff/IOSource.h>
 #include <ome/files/tiff/TIFF.h>
 #include <ome/files/tiff/Sentry.h>
+#include <ome/files/tiff/StrileReader.h>
 #include <ome/files/tiff/Exception.h>
 
 #include <ome/common/string.h>
 
 #include <tiffio.h>
 
+#ifdef OME_HAVE_LIBJPEG
+# include <csetjmp>
+# include <cstdio>
+# include <jpeglib.h>
+#endif
+
 using ome::xml::model::enums::PixelType;
 
 namespace
 {
 
   using namespace ::ome::files::tiff;
+  using ::ome::files::copyStrided;
+  using ::ome::files::DecodedTileCache;
   using ::ome::files::dimension_size_type;
+  using ::ome::files::IOStatistics;
+  using ::ome::files::LockSite;
   using ::ome::files::PixelBuffer;
+  using ::ome::files::PixelBufferView;
   using ::ome::files::PixelProperties;
+  using ::ome::files::PixelStatistics;
   using ::ome::files::PlaneRegion;
+  using ::ome::files::region_shape_type;
+  using ::ome::files::region_strides_type;
+  using ::ome::files::runParallel;
   using ::ome::files::TileBuffer;
+  using ::ome::files::TileBufferPool;
   using ::ome::files::TileCache;
   using ::ome::files::TileCoverage;
+  using ::ome::files::TraceObserver;
+  using ::ome::files::TraceScope;
+  using ::ome::files::VariantPixelBuffer;
+
+  // Lock call sites.
+  LockSite prefetchSite("tiff::IFD::prefetch");
+  LockSite readImageSite("tiff::IFD::readImage");
+  LockSite writeImageSite("tiff::IFD::writeImage");
+  LockSite copyRawTilesSite("tiff::IFD::copyRawTiles");
+  LockSite reserveImageSite("tiff::IFD::reserveImage");
+  LockSite applyTemplateSite("tiff::IFD::applyTemplate");
+
+  // Get the TIFF SampleFormat for an OME data model PixelType.
+  SampleFormat
+  pixelTypeSampleFormat(PixelType type)
+  {
+    SampleFormat fmt = UNSIGNED_INT;
+
+    switch(type)
+      {
+      case PixelType::BIT:
+      case PixelType::UINT8:
+      case PixelType::UINT16:
+      case PixelType::UINT32:
+        fmt = UNSIGNED_INT;
+        break;
+
+      case PixelType::INT8:
+      case PixelType::INT16:
+      case PixelType::INT32:
+        fmt = SIGNED_INT;
+        break;
+
+      case PixelType::FLOAT:
+      case PixelType::DOUBLE:
+        fmt = FLOAT;
+        break;
+
+      case PixelType::COMPLEXFLOAT:
+      case PixelType::COMPLEXDOUBLE:
+        fmt = COMPLEX_FLOAT;
+        break;
+
+      default:
+        {
+          boost::format fmt("Unsupported OME data model PixelType %1%");
+          fmt % type;
+          throw Exception(fmt.str());
+        }
+        break;
+      }
+
+    return fmt;
+  }
+
+  // Get a scratch tile buffer of the specified size for the calling
+  // thread.  Buffers are retained and reused by subsequent reads,
+  // so that repeated region reads do not allocate a new buffer for
+  // each call.  A small number of buffer sizes are retained, to
+  // avoid thrashing when reading from several images with different
+  // tile sizes; the least recently used size is discarded first.
+  // Large strip buffers are backed by huge pages where possible.
+  // The buffer contents are undefined.
+  TileBuffer&
+  scratchTileBuffer(dimension_size_type size)
+  {
+    static const std::size_t max_scratch_buffers = 4U;
+    thread_local std::vector<std::unique_ptr<TileBuffer>> scratch;
+
+    for (auto i = scratch.begin(); i != scratch.end(); ++i)
+      {
+        if ((*i)->size() == size)
+          {
+            // Move to the back (most recently used).
+            std::rotate(i, i + 1, scratch.end());
+            return *scratch.back();
+          }
+      }
+
+    if (scratch.size() >= max_scratch_buffers)
+      scratch.erase(scratch.begin());
+    scratch.emplace_back(new TileBuffer(size, true));
+    return *scratch.back();
+  }
+
+  // Largest tile or strip coalesced into a run; larger tiles and
+  // strips gain nothing from coalescing, and are read separately.
+  const std::size_t max_run_strile_size = 64U * 1024U;
+
+  // Largest run of coalesced tiles or strips.
+  const std::size_t max_run_size = 4U * 1024U * 1024U;
+
+  // Raw data of a run of tiles or strips stored adjacently in an I/O
+  // source, read with a single request.  Images with few rows per
+  // strip, down to one, may have many thousands of small strips
+  // which are usually written in order; reading each run at once
+  // avoids a request per strip.  The source is null if no run is
+  // held.
+  struct StrileRun
+  {
+    const IOSource    *source;
+    uint64_t           offset;
+    std::vector<char>  data;
+  };
+
+  // Get the strile run for the calling thread.  The buffer is
+  // retained and reused by subsequent reads.
+  StrileRun&
+  strileRun()
+  {
+    thread_local StrileRun run{nullptr, 0U, std::vector<char>()};
+    return run;
+  }
+
+  // Check if the first size bytes of a tile buffer are all zero.
+  // Tile buffers are aligned, so the bulk of the buffer is checked a
+  // word at a time, using an OR reduction over blocks which the
+  // compiler can vectorise, stopping at the first non-zero block.
+  bool
+  allZero(const TileBuffer&   tilebuf,
+          dimension_size_type size)
+  {
+    const uint8_t *data = tilebuf.data();
+    const dimension_size_type words = size / sizeof(uint64_t);
+    const dimension_size_type block = 64U;
+
+    for (dimension_size_type start = 0; start < words; start += block)
+      {
+        const dimension_size_type end = std::min(start + block, words);
+        uint64_t acc = 0U;
+        for (dimension_size_type i = start; i < end; ++i)
+          {
+            uint64_t word;
+            std::memcpy(&word, data + (i * sizeof(uint64_t)), sizeof(word));
+            acc |= word;
+          }
+        if (acc)
+          return false;
+      }
+
+    for (dimension_size_type i = words * sizeof(uint64_t); i < size; ++i)
+      if (data[i])
+        return false;
+
+    return true;
+  }
+
+  // Size of the encoded statistics of a single tile: the minimum,
+  // maximum and mean as little-endian IEEE 754 doubles.
+  const std::size_t tileStatisticsSize = 3U * sizeof(uint64_t);
+
+  // Encode a double as little-endian IEEE 754.
+  void
+  encodeDouble(double   value,
+               uint8_t *dest)
+  {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    for (std::size_t i = 0; i < sizeof(bits); ++i)
+      dest[i] = static_cast<uint8_t>(bits >> (i * 8U));
+  }
+
+  // Decode a little-endian IEEE 754 double.
+  double
+  decodeDouble(const uint8_t *src)
+  {
+    uint64_t bits = 0U;
+    for (std::size_t i = 0; i < sizeof(bits); ++i)
+      bits |= static_cast<uint64_t>(src[i]) << (i * 8U);
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+
+  // Summarise the valid area of a tile buffer.  Rows are stride
+  // samples apart, of which the first width samples are within the
+  // image.
+  typedef TileStatistics (*tile_summary_function)(const TileBuffer&   tilebuf,
+                                                  dimension_size_type stride,
+                                                  dimension_size_type width,
+                                                  dimension_size_type height);
+
+  template<typename T>
+  TileStatistics
+  summariseTile(const TileBuffer&   tilebuf,
+                dimension_size_type stride,
+                dimension_size_type width,
+                dimension_size_type height)
+  {
+    const T *data = reinterpret_cast<const T *>(tilebuf.data());
+    T lo = data[0];
+    T hi = data[0];
+    double sum = 0.0;
+    for (dimension_size_type row = 0; row < height; ++row)
+      {
+        const T *src = data + (row * stride);
+        ::ome::files::detail::rowRange(src, 1U, width, lo, hi);
+        for (dimension_size_type i = 0; i < width; ++i)
+          sum += static_cast<double>(src[i]);
+      }
+    return TileStatistics{static_cast<double>(lo),
+                          static_cast<double>(hi),
+                          sum / static_cast<double>(width * height)};
+  }
+
+  // Tile summaries are not recorded for bit or complex pixel types.
+  template<typename T>
+  struct TileSummary
+  {
+    static tile_summary_function
+    function()
+    {
+      return &summariseTile<T>;
+    }
+  };
+
+  template<>
+  struct TileSummary<bool>
+  {
+    static tile_summary_function
+    function()
+    {
+      return nullptr;
+    }
+  };
+
+  template<typename T>
+  struct TileSummary<std::complex<T>>
+  {
+    static tile_summary_function
+    function()
+    {
+      return nullptr;
+    }
+  };
+
+  // Get the byte ranges of a set of tiles or strips into ranges,
+  // reusing its storage.  One range is set for each tile; the range
+  // is empty if the tile is invalid or not yet written.
+  void
+  strileRanges(const IFD&                         ifd,
+               TileType                           type,
+               const TileRange&                   tiles,
+               std::vector<IOSource::range_type>& ranges)
+  {
+    const std::shared_ptr<::ome::files::tiff::TIFF>& tiff(ifd.getTIFF());
+    ::TIFF *tiffraw = reinterpret_cast<::TIFF *>(tiff->getWrapped());
+    ranges.assign(tiles.size(), IOSource::range_type(0U, 0U));
+
+    // Use the cached ranges without locking if possible.
+    std::shared_ptr<const StrileReader> striles(ifd.getStrileReader());
+    if (striles && striles->getTileType() == type)
+      {
+        for (dimension_size_type i = 0; i < tiles.size(); ++i)
+          ranges[i] = striles->getRange(tiles[i]);
+        return;
+      }
+
+    Sentry sentry(*tiff, prefetchSite);
+
+    ifd.makeCurrent();
+
+    tstrile_t ntiles = type == TILE ? TIFFNumberOfTiles(tiffraw) : TIFFNumberOfStrips(tiffraw);
+
+#ifdef OME_HAVE_TIFF_STRILE_ONDEMAND
+    for (dimension_size_type i = 0; i < tiles.size(); ++i)
+      {
+        if (tiles[i] >= ntiles)
+          continue;
+        uint64_t offset = TIFFGetStrileOffset(tiffraw, static_cast<uint32_t>(tiles[i]));
+        uint64_t count = TIFFGetStrileByteCount(tiffraw, static_cast<uint32_t>(tiles[i]));
+        if (offset && count)
+          ranges[i] = IOSource::range_type(offset, static_cast<std::size_t>(count));
+      }
+#else // ! OME_HAVE_TIFF_STRILE_ONDEMAND
+    toff_t *offsets = nullptr;
+    toff_t *counts = nullptr;
+    if (TIFFGetField(tiffraw, type == TILE ? TIFFTAG_TILEOFFSETS : TIFFTAG_STRIPOFFSETS, &offsets) &&
+        TIFFGetField(tiffraw, type == TILE ? TIFFTAG_TILEBYTECOUNTS : TIFFTAG_STRIPBYTECOUNTS, &counts) &&
+        offsets && counts)
+      {
+        for (dimension_size_type i = 0; i < tiles.size(); ++i)
+          {
+            const dimension_size_type tile = tiles[i];
+            if (tile < ntiles && offsets[tile] && counts[tile])
+              ranges[i] = IOSource::range_type(offsets[tile], static_cast<std::size_t>(counts[tile]));
+          }
+      }
+#endif // OME_HAVE_TIFF_STRILE_ONDEMAND
+  }
+
+  // Get the byte ranges of a set of tiles or strips.  One range is
+  // returned for each tile; the range is empty if the tile is
+  // invalid or not yet written.
+  std::vector<IOSource::range_type>
+  strileRanges(const IFD&       ifd,
+               TileType         type,
+               const TileRange& tiles)
+  {
+    std::vector<IOSource::range_type> ranges;
+    strileRanges(ifd, type, tiles, ranges);
+    return ranges;
+  }
+
+  // Get the stored (encoded) size of a tile or strip, or zero if
+  // not present.
+  uint64_t
+  strileByteCount(::TIFF   *tiffraw,
+                  TileType  type,
+                  tstrile_t tile)
+  {
+#ifdef OME_HAVE_TIFF_STRILE_ONDEMAND
+    static_cast<void>(type);
+    return TIFFGetStrileByteCount(tiffraw, tile);
+#else // ! OME_HAVE_TIFF_STRILE_ONDEMAND
+    toff_t *counts = nullptr;
+    if (TIFFGetField(tiffraw, type == TILE ? TIFFTAG_TILEBYTECOUNTS : TIFFTAG_STRIPBYTECOUNTS, &counts) &&
+        counts)
+      return counts[tile];
+    return 0U;
+#endif // OME_HAVE_TIFF_STRILE_ONDEMAND
+  }
+
+  // Get the offset of a tile or strip, or zero if not present.
+  uint64_t
+  strileOffset(::TIFF   *tiffraw,
+               TileType  type,
+               tstrile_t tile)
+  {
+#ifdef OME_HAVE_TIFF_STRILE_ONDEMAND
+    static_cast<void>(type);
+    return TIFFGetStrileOffset(tiffraw, tile);
+#else // ! OME_HAVE_TIFF_STRILE_ONDEMAND
+    toff_t *offsets = nullptr;
+    if (TIFFGetField(tiffraw, type == TILE ? TIFFTAG_TILEOFFSETS : TIFFTAG_STRIPOFFSETS, &offsets) &&
+        offsets)
+      return offsets[tile];
+    return 0U;
+#endif // OME_HAVE_TIFF_STRILE_ONDEMAND
+  }
+
+  // Check if the current directory of a libtiff handle contains
+  // JPEG-compressed YCbCr data.
+  bool
+  isJPEGYCbCr(::TIFF *tiffraw)
+  {
+    uint16_t compression = COMPRESSION_NONE;
+    uint16_t photometric = PHOTOMETRIC_MINISBLACK;
+    return (TIFFGetField(tiffraw, TIFFTAG_COMPRESSION, &compression) &&
+            compression == COMPRESSION_JPEG &&
+            TIFFGetField(tiffraw, TIFFTAG_PHOTOMETRIC, &photometric) &&
+            photometric == PHOTOMETRIC_YCBCR);
+  }
+
+  // Make libjpeg convert between YCbCr and RGB for JPEG-compressed
+  // YCbCr data, so that callers only see RGB samples and the
+  // chrominance upsampling uses the libjpeg fast path.  The colour
+  // mode is a codec pseudo-tag which is not stored in the file, and
+  // is reset every time libtiff reads a directory.
+  void
+  setJPEGColorMode(::TIFF *tiffraw)
+  {
+    if (!isJPEGYCbCr(tiffraw))
+      return;
+
+    int colormode = JPEGCOLORMODE_RAW;
+    if (TIFFGetField(tiffraw, TIFFTAG_JPEGCOLORMODE, &colormode) &&
+        colormode == JPEGCOLORMODE_RGB)
+      return;
+
+    TIFFSetField(tiffraw, TIFFTAG_JPEGCOLORMODE, JPEGCOLORMODE_RGB);
+  }
+
+  // Find the registered tile codec to use in place of the libtiff
+  // codec for the current directory of a libtiff handle.  The raw
+  // tile data is only equivalent to the data libtiff would encode or
+  // decode if it would not apply a predictor, byte swapping or bit
+  // reversal, so no codec is used if any of these are needed.  Packed
+  // samples and YCbCr colour conversion are also left to libtiff,
+  // since tile codecs expect whole byte RGB samples.
+  std::shared_ptr<TileCodec>
+  findTileCodec(Compression compression,
+                ::TIFF     *tiffraw)
+  {
+    std::shared_ptr<TileCodec> codec(getTileCodec(compression));
+    if (codec)
+      {
+        uint16_t predictor = PREDICTOR_NONE;
+        uint16_t fillorder = FILLORDER_MSB2LSB;
+        uint16_t bits = 8U;
+        if (TIFFIsByteSwapped(tiffraw) ||
+            (TIFFGetFieldDefaulted(tiffraw, TIFFTAG_BITSPERSAMPLE, &bits) &&
+             isPackedSampleDepth(bits)) ||
+            isJPEGYCbCr(tiffraw) ||
+            (codecSupportsPredictor(compression) &&
+             TIFFGetFieldDefaulted(tiffraw, TIFFTAG_PREDICTOR, &predictor) &&
+             predictor != PREDICTOR_NONE) ||
+            (TIFFGetFieldDefaulted(tiffraw, TIFFTAG_FILLORDER, &fillorder) &&
+             fillorder != FILLORDER_MSB2LSB))
+          codec.reset();
+      }
+    return codec;
+  }
+
+  // Check the raw data of a tile or strip against its recorded
+  // checksum.  Tiles without a checksum are not checked.
+  void
+  verifyTileChecksum(const std::vector<uint32_t>& checksums,
+                     const IFD&                   ifd,
+                     tstrile_t                    tile,
+                     const void                  *data,
+                     std::size_t                  size,
+                     IOStatistics&                statistics)
+  {
+    if (tile >= checksums.size() || !checksums[tile])
+      return;
+
+    if (::ome::files::crc32c(data, size) != checksums[tile])
+      {
+        boost::format fmt("Checksum mismatch for tile %1% of directory at offset %2%");
+        fmt % tile % ifd.getOffset();
+        throw Exception(fmt.str());
+      }
+    statistics.add(IOStatistics::CHECKSUMS_VERIFIED);
+  }
+
+  // Merge the JPEGTables stream of an IFD into the abbreviated JPEG
+  // stream of a tile or strip, to form a complete JPEG stream.  The
+  // end of image marker of the tables and the start of image marker
+  // of the tile are dropped.
+  void
+  mergeJPEGTables(const std::vector<char>& tables,
+                  std::vector<char>&       raw)
+  {
+    if (tables.size() < 4U || raw.size() < 2U)
+      return;
+
+    raw.erase(raw.begin(), raw.begin() + 2);
+    raw.insert(raw.begin(), tables.begin(), tables.end() - 2);
+  }
+
+  // Check if the storage of a pixel buffer is host accessible.
+  bool
+  hostAccessible(const VariantPixelBuffer& buf)
+  {
+    const std::shared_ptr<PixelAllocator>& allocator(buf.getAllocator());
+    return !allocator || allocator->hostAccessible();
+  }
+
+#ifdef OME_HAVE_LIBJPEG
+  // libjpeg error manager which returns control to the decoder on
+  // error, rather than exiting the process.
+  struct JPEGErrorManager
+  {
+    jpeg_error_mgr pub;
+    std::jmp_buf   jump;
+    char           message[JMSG_LENGTH_MAX];
+  };
+
+  void
+  jpegErrorExit(j_common_ptr cinfo)
+  {
+    JPEGErrorManager *err = reinterpret_cast<JPEGErrorManager *>(cinfo->err);
+    (*cinfo->err->format_message)(cinfo, err->message);
+    std::longjmp(err->jump, 1);
+  }
+
+  // Warnings about corrupt data are not fatal, and are not printed.
+  void
+  jpegOutputMessage(j_common_ptr /* cinfo */)
+  {
+  }
+
+  // Decode a complete JPEG stream at 1/scale of its full size, with
+  // the inverse DCT producing the reduced samples directly.  Three
+  // component streams are converted to RGB if ycbcr is set, and are
+  // otherwise stored unconverted, as libtiff does.  The decoded
+  // samples are stored interleaved in dest.
+  //
+  // Returns null on success, or the libjpeg error message.
+  const char *
+  decodeJPEGScaled(const std::vector<char>& src,
+                   unsigned int             scale,
+                   bool                     ycbcr,
+                   JPEGErrorManager&        err,
+                   std::vector<uint8_t>&    dest,
+                   dimension_size_type&     width,
+                   dimension_size_type&     height,
+                   dimension_size_type&     components)
+  {
+    jpeg_decompress_struct cinfo;
+    cinfo.err = jpeg_std_error(&err.pub);
+    err.pub.error_exit = jpegErrorExit;
+    err.pub.output_message = jpegOutputMessage;
+    if (setjmp(err.jump))
+      {
+        jpeg_destroy_decompress(&cinfo);
+        return err.message;
+      }
+
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo,
+                 const_cast<unsigned char *>(reinterpret_cast<const unsigned char *>(src.data())),
+                 static_cast<unsigned long>(src.size()));
+    jpeg_read_header(&cinfo, TRUE);
+    if (cinfo.num_components == 3)
+      {
+        cinfo.jpeg_color_space = ycbcr ? JCS_YCbCr : JCS_RGB;
+        cinfo.out_color_space = JCS_RGB;
+      }
+    cinfo.scale_num = 1;
+    cinfo.scale_denom = scale;
+    jpeg_start_decompress(&cinfo);
+
+    width = cinfo.output_width;
+    height = cinfo.output_height;
+    components = static_cast<dimension_size_type>(cinfo.output_components);
+    const std::size_t rowbytes = static_cast<std::size_t>(width * components);
+    dest.resize(rowbytes * static_cast<std::size_t>(height));
+    while (cinfo.output_scanline < cinfo.output_height)
+      {
+        JSAMPROW row = dest.data() + (cinfo.output_scanline * rowbytes);
+        jpeg_read_scanlines(&cinfo, &row, 1);
+      }
+
+    jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+    return nullptr;
+  }
+#endif // OME_HAVE_LIBJPEG
+
+  // Get the tile codec parameters for a tile or strip.
+  TileCodecParameters
+  tileCodecParameters(const IFD&         ifd,
+                      const PlaneRegion& region)
+  {
+    TileCodecParameters params;
+    params.scheme = ifd.getCompression();
+    params.pixeltype = ifd.getPixelType();
+    params.width = region.w;
+    params.height = region.h;
+    params.samples = ifd.getPlanarConfiguration() == SEPARATE ? 1U : ifd.getSamplesPerPixel();
+    params.level = ifd.getCompressionLevel();
+    return params;
+  }
+
+  // Hint the byte ranges of a set of tiles or strips to the I/O
+  // source prior to reading them.  This permits sources with a high
+  // per-request latency to fetch the data for a whole region with a
+  // small number of merged requests, rather than one request per
+  // tile.  The TIFF lock is not held while the source fetches.
+  void
+  prefetchTiles(const IFD&       ifd,
+                TileType         type,
+                const TileRange& tiles)
+  {
+    const std::shared_ptr<IOSource>& source(ifd.getTIFF()->getSource());
+    if (!source || tiles.size() < 2U)
+      return;
+
+    // Reused by the calling thread, so that repeated reads do not
+    // allocate.
+    thread_local std::vector<IOSource::range_type> ranges;
+    strileRanges(ifd, type, tiles, ranges);
+    ranges.erase(std::remove_if(ranges.begin(), ranges.end(),
+                                [](const IOSource::range_type& range)
+                                { return range.second == 0U; }),
+                 ranges.end());
+
+    source->prefetch(ranges);
+  }
+
+  // Sort a set of tiles or strips by their offset in the file, so
+  // that they may be read sequentially.  Tiles without a known
+  // offset retain their relative order, after the tiles with a
+  // known offset.
+  void
+  sortTilesByOffset(const IFD&                        ifd,
+                    TileType                          type,
+                    std::vector<dimension_size_type>& tiles)
+  {
+    std::vector<IOSource::range_type> ranges(strileRanges(ifd, type, tiles));
+
+    std::vector<std::pair<uint64_t, dimension_size_type>> ordered;
+    ordered.reserve(tiles.size());
+    for (std::vector<dimension_size_type>::size_type i = 0; i < tiles.size(); ++i)
+      ordered.push_back(std::make_pair(ranges[i].second ? ranges[i].first : std::numeric_limits<uint64_t>::max(),
+                                       tiles[i]));
+    std::stable_sort(ordered.begin(), ordered.end(),
+                     [](const std::pair<uint64_t, dimension_size_type>& lhs,
+                        const std::pair<uint64_t, dimension_size_type>& rhs)
+                     { return lhs.first < rhs.first; });
+
+    for (std::vector<dimension_size_type>::size_type i = 0; i < tiles.size(); ++i)
+      tiles[i] = ordered[i].second;
+  }
+
+  // Check if samples are stored in half precision, and converted to
+  // and from FLOAT samples as each tile is transferred.
+  bool
+  halfFloatSamples(const IFD& ifd)
+  {
+    return ifd.getBitsPerSample() == 16U && ifd.getPixelType() == PixelType::FLOAT;
+  }
+
+  // Find the offset of the image data if it is uncompressed and
+  // stored as contiguous strips in native bit order, so that any row
+  // may be read directly from the I/O source without libtiff;
+  // otherwise zero.  Only the last strip may be longer than its rows
+  // require.  swapped is set if the samples need byte swapping.
+  // Needs wrapping in a sentry by the caller.
+  uint64_t
+  findContiguousData(const IFD& ifd,
+                     bool&      swapped)
+  {
+    const std::shared_ptr<::ome::files::tiff::TIFF>& tiff(ifd.getTIFF());
+    ::TIFF *tiffraw = reinterpret_cast<::TIFF *>(tiff->getWrapped());
+    const std::shared_ptr<IOSource>& source(tiff->getSource());
+    if (!source)
+      return 0U;
+
+    ifd.makeCurrent();
+
+    uint16_t fillorder = FILLORDER_MSB2LSB;
+    TIFFGetFieldDefaulted(tiffraw, TIFFTAG_FILLORDER, &fillorder);
+    if (TIFFGetMode(tiffraw) != O_RDONLY ||
+        TIFFIsTiled(tiffraw) ||
+        fillorder != FILLORDER_MSB2LSB ||
+        ifd.getCompression() != COMPRESSION_NONE ||
+        ifd.getBitsPerSample() % 8U ||
+        halfFloatSamples(ifd))
+      return 0U;
+
+    uint16_t samples = ifd.getSamplesPerPixel();
+    bool separate = ifd.getPlanarConfiguration() == SEPARATE;
+    uint64_t height = ifd.getImageHeight();
+    uint64_t rowbytes = static_cast<uint64_t>(ifd.getImageWidth()) *
+      (separate ? 1U : samples) * (ifd.getBitsPerSample() / 8U);
+    uint64_t rowsperstrip = std::min(static_cast<uint64_t>(ifd.getTileInfo().tileHeight()), height);
+    if (!rowbytes || !rowsperstrip)
+      return 0U;
+    uint64_t stripsperplane = (height + rowsperstrip - 1U) / rowsperstrip;
+    uint64_t planes = separate ? samples : 1U;
+
+    tstrile_t nstrips = TIFFNumberOfStrips(tiffraw);
+    if (nstrips != stripsperplane * planes)
+      return 0U;
+
+    uint64_t start = strileOffset(tiffraw, STRIP, 0);
+    uint64_t next = start;
+    for (tstrile_t strip = 0; strip < nstrips; ++strip)
+      {
+        uint64_t row = (strip % stripsperplane) * rowsperstrip;
+        uint64_t expected = std::min(rowsperstrip, height - row) * rowbytes;
+        uint64_t count = strileByteCount(tiffraw, STRIP, strip);
+        if (strileOffset(tiffraw, STRIP, strip) != next ||
+            count < expected ||
+            (count != expected && strip + 1U != nstrips))
+          return 0U;
+        next += count;
+      }
+
+    if (!start || next > source->size())
+      return 0U;
+
+    swapped = TIFFIsByteSwapped(tiffraw) && ifd.getBitsPerSample() > 8U;
+
+    return start;
+  }
+
+  // Size of a whole image plane of contiguous uncompressed image
+  // data, including all samples.
+  uint64_t
+  contiguousPlaneSize(const IFD& ifd)
+  {
+    return static_cast<uint64_t>(ifd.getImageWidth()) * ifd.getImageHeight() *
+      ifd.getSamplesPerPixel() * (ifd.getBitsPerSample() / 8U);
+  }
+
+  // Swap the byte order of samples in place.
+  void
+  swapSamples(char        *data,
+              std::size_t  size,
+              uint16_t     bits)
+  {
+    switch (bits)
+      {
+      case 16U:
+        TIFFSwabArrayOfShort(reinterpret_cast<uint16_t *>(data), static_cast<tmsize_t>(size / 2U));
+        break;
+      case 32U:
+        TIFFSwabArrayOfLong(reinterpret_cast<uint32_t *>(data), static_cast<tmsize_t>(size / 4U));
+        break;
+      case 64U:
+        TIFFSwabArrayOfLong8(reinterpret_cast<uint64_t *>(data), static_cast<tmsize_t>(size / 8U));
+        break;
+      default:
+        break;
+      }
+  }
+
+  // Get the address of a pixel in a pixel buffer.
+  struct PixelAddressVisitor : public boost::static_visitor<char *>
+  {
+    const VariantPixelBuffer::indices_type& idx;
+
+    PixelAddressVisitor(const VariantPixelBuffer::indices_type& idx):
+      idx(idx)
+    {}
+
+    template<typename T>
+    char *
+    operator()(std::shared_ptr<T>& buffer) const
+    {
+      return reinterpret_cast<char *>(&buffer->at(idx));
+    }
+  };
+
+  // Read a region of contiguous uncompressed image data directly
+  // from the I/O source into the destination buffer, which must have
+  // the storage order set by prepareBuffer().  This does not use
+  // libtiff, so does not need a sentry, and may be run concurrently.
+  // If swap is set, samples are byte swapped after reading.  If
+  // sample is set, only this sample is read from separate planes.
+  void
+  readContiguous(const IFD&                                  ifd,
+                 uint64_t                                    offset,
+                 bool                                        swap,
+                 VariantPixelBuffer&                         dest,
+                 const PlaneRegion&                          region,
+                 const boost::optional<dimension_size_type>& sample = boost::none)
+  {
+    const std::shared_ptr<::ome::files::tiff::TIFF>& tiff(ifd.getTIFF());
+    const std::shared_ptr<IOSource>& source(tiff->getSource());
+    IOStatistics& statistics(*tiff->getStatistics());
+
+    uint16_t samples = ifd.getSamplesPerPixel();
+    bool separate = ifd.getPlanarConfiguration() == SEPARATE;
+    uint64_t pixelbytes = (separate ? 1U : samples) * (ifd.getBitsPerSample() / 8U);
+    uint64_t rowbytes = ifd.getImageWidth() * pixelbytes;
+    uint64_t planebytes = ifd.getImageHeight() * rowbytes;
+
+    // Whole rows are stored contiguously in the destination buffer.
+    bool fullrows = region.x == 0U && region.w == ifd.getImageWidth();
+
+    VariantPixelBuffer::indices_type idx;
+    idx[DIM_SPATIAL_X] = idx[DIM_SPATIAL_Z] = idx[DIM_TEMPORAL_T] =
+      idx[DIM_CHANNEL] = idx[DIM_MODULO_Z] = idx[DIM_MODULO_T] = idx[DIM_MODULO_C] = 0;
+
+    dimension_size_type first = sample ? *sample : 0U;
+    dimension_size_type last = separate ? (sample ? *sample + 1U : samples) : 1U;
+
+    IOStatistics::Timer timer(statistics, IOStatistics::STAGE_READ);
+    for (dimension_size_type plane = first; plane < last; ++plane)
+      {
+        idx[DIM_SUBCHANNEL] = sample ? 0U : plane;
+        uint64_t planeoffset = offset + (separate ? plane * planebytes : 0U);
+
+        for (dimension_size_type row = 0; row < region.h; row += fullrows ? region.h : 1U)
+          {
+            idx[DIM_SPATIAL_Y] = row;
+            char *destptr = boost::apply_visitor(PixelAddressVisitor(idx), dest.vbuffer());
+            std::size_t size = static_cast<std::size_t>(fullrows ? region.h * rowbytes : region.w * pixelbytes);
+            uint64_t pos = planeoffset + ((region.y + row) * rowbytes) + (region.x * pixelbytes);
+
+            if (source->read(pos, destptr, size) != size)
+              {
+                boost::format fmt("Failed to read contiguous image data from %1%");
+                fmt % tiff->getFilename().string();
+                throw Exception(fmt.str());
+              }
+            statistics.add(IOStatistics::BYTES_READ, size);
+            if (swap)
+              swapSamples(destptr, size, ifd.getBitsPerSample());
+          }
+      }
+  }
+
+  // Expand a row of indices through a single lookup table channel.
+  // Separate loops for each destination stride allow the compiler
+  // to vectorize the gather for contiguous (planar) destinations.
+  template<typename I>
+  void
+  expandLookup(const I             *src,
+               dimension_size_type  count,
+               const uint16_t      *table,
+               uint16_t            *dest,
+               std::ptrdiff_t       stride)
+  {
+    if (stride == 1)
+      {
+        for (dimension_size_type x = 0U; x < count; ++x)
+          dest[x] = table[src[x]];
+      }
+    else
+      {
+        for (dimension_size_type x = 0U; x < count; ++x)
+          dest[x * stride] = table[src[x]];
+      }
+  }
 
   // VariantPixelBuffer tile transfer
   // ────────────────────────────────
   //
+  // Native path strings of type std::string are used directly.
+  inline const std::string&
+  nativeFilename(const std::string&             native,
+                 const boost::filesystem::path& /* path */,
+                 std::string&                   /* copy */)
+  {
+    return native;
+  }
+
+  // Other native path strings are converted into copy.
+  template<typename Native>
+  inline const std::string&
+  nativeFilename(const Native&                  /* native */,
+                 const boost::filesystem::path& path,
+                 std::string&                   copy)
+  {
+    copy = path.string();
+    return copy;
+  }
+
+  // Get a path as a string for tile cache keys.  Where the native
+  // string type is std::string, this refers to the path itself, so
+  // that no copy is made; otherwise the converted path is stored in
+  // copy.
+  inline const std::string&
+  cacheFilename(const boost::filesystem::path& path,
+                std::string&                   copy)
+  {
+    return nativeFilename(path.native(), path, copy);
+  }
+
+  // Strides of a decoded tile or strip, in which samples are
+  // interleaved and rows span the full tile width.
+  inline region_strides_type
+  tileStrides(const PlaneRegion& rfull,
+              uint16_t           samples)
+  {
+    region_strides_type strides;
+    std::fill(strides.begin(), strides.end(), 0);
+    strides[ome::files::DIM_SUBCHANNEL] = 1;
+    strides[ome::files::DIM_SPATIAL_X] = samples;
+    strides[ome::files::DIM_SPATIAL_Y] = static_cast<region_strides_type::value_type>(rfull.w * samples);
+    return strides;
+  }
+
+  // Shape of a clipped region of a tile or strip.
+  inline region_shape_type
+  tileShape(const PlaneRegion& rclip,
+            uint16_t           samples)
+  {
+    region_shape_type shape;
+    std::fill(shape.begin(), shape.end(), 1U);
+    shape[ome::files::DIM_SUBCHANNEL] = samples;
+    shape[ome::files::DIM_SPATIAL_X] = rclip.w;
+    shape[ome::files::DIM_SPATIAL_Y] = rclip.h;
+    return shape;
+  }
+
   // ReadVisitor: Transfer a set of tiles to a destination pixel buffer.
   // WriteVisitor: Transfer source pixel buffer data to a set of tiles.
   //
@@ -123,24 +1024,94 @@ namespace
     const IFD&                              ifd;
     const TileInfo&                         tileinfo;
     const PlaneRegion&                      region;
-    const std::vector<dimension_size_type>& tiles;
-    TileBuffer                              tilebuf;
+    TileRange                               tiles;
+    std::shared_ptr<DecodedTileCache>       tilecache;
+    // Filename for tile cache keys; a reference into the TIFF
+    // filename where possible, to avoid a copy per read.
+    std::string                             filenamecopy;
+    const std::string&                      filename;
+    bool                                    decodeonly;
+    boost::optional<dimension_size_type>    subchannel;
+    std::shared_ptr<IOStatistics>           statistics;
+    const boost::filesystem::path&          file;
+    // If set, indices are expanded through this lookup table into
+    // a UINT16 destination buffer with three subchannels.
+    std::shared_ptr<const VariantPixelBuffer> lookup;
+    // Size of each index in bytes (if using a lookup table).
+    dimension_size_type                     indexbytes;
+    // If set, raw tile data is read from the I/O source with this
+    // reader rather than with libtiff.
+    std::shared_ptr<const StrileReader>     striles;
+    // Set if the destination buffer has the storage order of the
+    // decoded tiles.  If unset, samples are scattered using the
+    // destination buffer strides.
+    bool                                    native;
+    // If set, statistics are accumulated for each region of the
+    // destination buffer as it is transferred.
+    PixelStatistics                        *pixelstats;
+    // If set, raw tile data read separately from decoding is
+    // verified against these checksums.
+    std::shared_ptr<const std::vector<uint32_t>> checksums;
+    // Bits per sample if samples are packed, otherwise zero.
+    // Packed samples are unpacked into 16-bit samples as each tile
+    // is decoded.
+    uint16_t                                packedbits;
+    // Set if samples are stored in half precision.  Samples are
+    // converted to FLOAT samples as each tile is decoded.
+    bool                                    halffloat;
+    // Set if the destination buffer is not host accessible, in
+    // which case it is filled by a device tile codec.
+    bool                                    device;
+
+    // If subchannel is set, only this subchannel is transferred to
+    // the destination buffer, which has a single subchannel.
+    ReadVisitor(const IFD&                                  ifd,
+                const TileInfo&                             tileinfo,
+                const PlaneRegion&                          region,
+                const TileRange&                            tiles,
+                const boost::optional<dimension_size_type>& subchannel = boost::none):
+      ReadVisitor(ifd, tileinfo, region, tiles, ifd.getTIFF()->getTileCache(), false, subchannel)
+    {}
 
-    ReadVisitor(const IFD&                              ifd,
-                const TileInfo&                         tileinfo,
-                const PlaneRegion&                      region,
-                const std::vector<dimension_size_type>& tiles):
+    // Use the specified tile cache rather than the TIFF tile cache.
+    // If decodeonly is set, tiles are decoded into the cache
+    // without being transferred to the destination buffer.
+    ReadVisitor(const IFD&                                  ifd,
+                const TileInfo&                             tileinfo,
+                const PlaneRegion&                          region,
+                const TileRange&                            tiles,
+                const std::shared_ptr<DecodedTileCache>&    tilecache,
+                bool                                        decodeonly = false,
+                const boost::optional<dimension_size_type>& subchannel = boost::none):
       ifd(ifd),
       tileinfo(tileinfo),
       region(region),
       tiles(tiles),
-      tilebuf(tileinfo.bufferSize())
+      tilecache(tilecache),
+      filenamecopy(),
+      filename(tilecache ? cacheFilename(ifd.getTIFF()->getFilename(), filenamecopy) : filenamecopy),
+      decodeonly(decodeonly),
+      subchannel(subchannel),
+      statistics(ifd.getTIFF()->getStatistics()),
+      file(ifd.getTIFF()->getFilename()),
+      lookup(),
+      indexbytes(0U),
+      striles(),
+      native(true),
+      pixelstats(nullptr),
+      checksums(ifd.getTIFF()->getVerifyTileChecksums() ?
+                ifd.getTileChecksums() : std::shared_ptr<const std::vector<uint32_t>>()),
+      packedbits(isPackedSampleDepth(ifd.getBitsPerSample()) ? ifd.getBitsPerSample() : 0U),
+      halffloat(halfFloatSamples(ifd)),
+      device(false)
     {}
 
     ~ReadVisitor()
     {
     }
 
+    // Transfer a block from the decoded tile to the destination
+    // buffer, in any storage order.
     template<typename T>
     void
     transfer(std::shared_ptr<T>&       buffer,
@@ -150,45 +1121,16 @@ namespace
              PlaneRegion&              rclip,
              uint16_t                  copysamples)
     {
-      if (rclip.w == rfull.w &&
-          rclip.x == region.x &&
-          rclip.w == region.w)
-        {
-          // Transfer contiguous block since the tile spans the
-          // whole region width for both source and destination
-          // buffers.
-
-          destidx[ome::files::DIM_SPATIAL_X] = rclip.x - region.x;
-          destidx[ome::files::DIM_SPATIAL_Y] = rclip.y - region.y;
-
-          typename T::value_type *dest = &buffer->at(destidx);
-          const typename T::value_type *src = reinterpret_cast<const typename T::value_type *>(tilebuf.data());
-          std::copy(src,
-                    src + (rclip.w * rclip.h * copysamples),
-                    dest);
-        }
-      else
-        {
-          // Transfer discontiguous block.
+      destidx[ome::files::DIM_SPATIAL_X] = rclip.x - region.x;
+      destidx[ome::files::DIM_SPATIAL_Y] = rclip.y - region.y;
 
-          dimension_size_type xoffset = (rclip.x - rfull.x) * copysamples;
+      PixelBufferView<typename T::value_type> view(*buffer);
+      const typename T::value_type *src = reinterpret_cast<const typename T::value_type *>(tilebuf.data()) +
+        ((rclip.y - rfull.y) * rfull.w * copysamples) + ((rclip.x - rfull.x) * copysamples);
 
-          for (dimension_size_type row = rclip.y;
-               row != rclip.y + rclip.h;
-               ++row)
-            {
-              dimension_size_type yoffset = (row - rfull.y) * (rfull.w * copysamples);
-
-              destidx[ome::files::DIM_SPATIAL_X] = rclip.x - region.x;
-              destidx[ome::files::DIM_SPATIAL_Y] = row - region.y;
-
-              typename T::value_type *dest = &buffer->at(destidx);
-              const typename T::value_type *src = reinterpret_cast<const typename T::value_type *>(tilebuf.data());
-              std::copy(src + yoffset + xoffset,
-                        src + yoffset + xoffset + (rclip.w * copysamples),
-                        dest);
-            }
-        }
+      copyStrided(src, tileStrides(rfull, copysamples),
+                  view.pointer(destidx), view.strides(),
+                  tileShape(rclip, copysamples));
     }
 
     // Special case for BIT
@@ -200,12 +1142,19 @@ namespace
              PlaneRegion&                                                             rclip,
              uint16_t                                                                 copysamples)
     {
+      if (!native)
+        {
+          transferStrided(buffer, destidx, tilebuf, rfull, rclip, copysamples);
+          return;
+        }
+
       // Unpack bits from buffer.
 
       typedef PixelBuffer<PixelProperties<PixelType::BIT>::std_type> T;
 
       dimension_size_type xoffset = (rclip.x - rfull.x) * copysamples;
 
+      PixelBufferView<T::value_type> view(*buffer);
       for (dimension_size_type row = rclip.y;
            row != rclip.y + rclip.h;
            ++row)
@@ -216,46 +1165,978 @@ namespace
           destidx[ome::files::DIM_SPATIAL_X] = rclip.x - region.x;
           destidx[ome::files::DIM_SPATIAL_Y] = row - region.y;
 
-          T::value_type *dest = &buffer->at(destidx);
+          T::value_type *dest = view.pointer(destidx);
           const uint8_t *src = reinterpret_cast<const uint8_t *>(tilebuf.data());
 
-          for (dimension_size_type sampleoffset = 0U;
-               sampleoffset < (rclip.w * copysamples);
-               ++sampleoffset)
-            {
-              dimension_size_type src_bit = yoffset + xoffset + sampleoffset;
-              const uint8_t *src_byte = src + (src_bit / 8U);
-              const uint8_t bit_offset = 7U - (src_bit % 8U);
-              const uint8_t mask = static_cast<uint8_t>(1U << bit_offset);
-              assert(src_byte >= src && src_byte < src + tilebuf.size());
-              *(dest+sampleoffset) = static_cast<T::value_type>(*src_byte & mask);
-            }
+          assert(((yoffset + xoffset + (rclip.w * copysamples) + 7U) / 8U) <= tilebuf.size());
+          unpackBits(src, yoffset + xoffset, dest, rclip.w * copysamples);
         }
     }
 
-    template<typename T>
-    dimension_size_type
-    expected_read(const std::shared_ptr<T>& /* buffer */,
-                  const PlaneRegion&        rclip,
-                  uint16_t                  copysamples) const
-    {
-      return rclip.w * rclip.h * copysamples * sizeof(typename T::value_type);
+    // Transfer a block to a destination buffer with a storage order
+    // differing from the decoded tile, scattering each sample using
+    // the destination strides while the tile rows are unpacked;
+    // special case for BIT.
+    void
+    transferStrided(std::shared_ptr<PixelBuffer<PixelProperties<PixelType::BIT>::std_type>>& buffer,
+                    PixelBuffer<PixelProperties<PixelType::BIT>::std_type>::indices_type&    destidx,
+                    const TileBuffer&                                                        tilebuf,
+                    PlaneRegion&                                                             rfull,
+                    PlaneRegion&                                                             rclip,
+                    uint16_t                                                                 copysamples)
+    {
+      // Unpack bits from buffer.
+
+      typedef PixelBuffer<PixelProperties<PixelType::BIT>::std_type> T;
+
+      const std::ptrdiff_t xstride = buffer->strides()[ome::files::DIM_SPATIAL_X];
+      const std::ptrdiff_t sstride = buffer->strides()[ome::files::DIM_SUBCHANNEL];
+      const uint8_t *src = reinterpret_cast<const uint8_t *>(tilebuf.data());
+      dimension_size_type xoffset = (rclip.x - rfull.x) * copysamples;
+
+      PixelBufferView<T::value_type> view(*buffer);
+      for (dimension_size_type row = rclip.y;
+           row != rclip.y + rclip.h;
+           ++row)
+        {
+          dimension_size_type yoffset = (row - rfull.y) * (rfull.w * copysamples);
+
+          destidx[ome::files::DIM_SPATIAL_X] = rclip.x - region.x;
+          destidx[ome::files::DIM_SPATIAL_Y] = row - region.y;
+
+          T::value_type *dest = view.pointer(destidx);
+          for (dimension_size_type x = 0U; x < rclip.w; ++x)
+            for (uint16_t s = 0U; s < copysamples; ++s)
+              {
+                dimension_size_type src_bit = yoffset + xoffset + (x * copysamples) + s;
+                const uint8_t *src_byte = src + (src_bit / 8U);
+                const uint8_t bit_offset = 7U - (src_bit % 8U);
+                const uint8_t mask = static_cast<uint8_t>(1U << bit_offset);
+                assert(src_byte >= src && src_byte < src + tilebuf.size());
+                dest[(x * xstride) + (s * sstride)] = static_cast<T::value_type>(*src_byte & mask);
+              }
+        }
+    }
+
+    // Transfer a single subchannel from a tile containing
+    // contiguous samples.
+    template<typename T>
+    void
+    transferSample(std::shared_ptr<T>&       buffer,
+                   typename T::indices_type& destidx,
+                   const TileBuffer&         tilebuf,
+                   PlaneRegion&              rfull,
+                   PlaneRegion&              rclip,
+                   uint16_t                  samples,
+                   dimension_size_type       sample)
+    {
+      const typename T::value_type *src = reinterpret_cast<const typename T::value_type *>(tilebuf.data());
+
+      PixelBufferView<typename T::value_type> view(*buffer);
+      for (dimension_size_type row = rclip.y;
+           row != rclip.y + rclip.h;
+           ++row)
+        {
+          dimension_size_type yoffset = (row - rfull.y) * (rfull.w * samples);
+          dimension_size_type xoffset = (rclip.x - rfull.x) * samples;
+
+          destidx[ome::files::DIM_SPATIAL_X] = rclip.x - region.x;
+          destidx[ome::files::DIM_SPATIAL_Y] = row - region.y;
+
+          typename T::value_type *dest = view.pointer(destidx);
+          const typename T::value_type *srcrow = src + yoffset + xoffset + sample;
+          for (dimension_size_type x = 0; x < rclip.w; ++x)
+            dest[x] = srcrow[x * samples];
+        }
+    }
+
+    // Special case for BIT
+    void
+    transferSample(std::shared_ptr<PixelBuffer<PixelProperties<PixelType::BIT>::std_type>>& buffer,
+                   PixelBuffer<PixelProperties<PixelType::BIT>::std_type>::indices_type&    destidx,
+                   const TileBuffer&                                                        tilebuf,
+                   PlaneRegion&                                                             rfull,
+                   PlaneRegion&                                                             rclip,
+                   uint16_t                                                                 samples,
+                   dimension_size_type                                                      sample)
+    {
+      // Unpack bits from buffer.
+
+      typedef PixelBuffer<PixelProperties<PixelType::BIT>::std_type> T;
+
+      dimension_size_type xoffset = (rclip.x - rfull.x) * samples;
+
+      PixelBufferView<T::value_type> view(*buffer);
+      for (dimension_size_type row = rclip.y;
+           row != rclip.y + rclip.h;
+           ++row)
+        {
+          dimension_size_type yoffset = (row - rfull.y) * (rfull.w * samples);
+
+          destidx[ome::files::DIM_SPATIAL_X] = rclip.x - region.x;
+          destidx[ome::files::DIM_SPATIAL_Y] = row - region.y;
+
+          T::value_type *dest = view.pointer(destidx);
+          const uint8_t *src = reinterpret_cast<const uint8_t *>(tilebuf.data());
+
+          for (dimension_size_type x = 0U; x < rclip.w; ++x)
+            {
+              dimension_size_type src_bit = yoffset + xoffset + (x * samples) + sample;
+              const uint8_t *src_byte = src + (src_bit / 8U);
+              const uint8_t bit_offset = 7U - (src_bit % 8U);
+              const uint8_t mask = static_cast<uint8_t>(1U << bit_offset);
+              assert(src_byte >= src && src_byte < src + tilebuf.size());
+              dest[x] = static_cast<T::value_type>(*src_byte & mask);
+            }
+        }
+    }
+
+    // Expand indices through the lookup table.  Only UINT16
+    // destination buffers are supported.
+    template<typename T>
+    void
+    transferLookup(std::shared_ptr<T>&       /* buffer */,
+                   typename T::indices_type& /* destidx */,
+                   const TileBuffer&         /* tilebuf */,
+                   PlaneRegion&              /* rfull */,
+                   PlaneRegion&              /* rclip */)
+    {
+      throw Exception("Lookup table expansion requires a UINT16 destination buffer");
+    }
+
+    void
+    transferLookup(std::shared_ptr<PixelBuffer<PixelProperties<PixelType::UINT16>::std_type>>& buffer,
+                   PixelBuffer<PixelProperties<PixelType::UINT16>::std_type>::indices_type&    destidx,
+                   const TileBuffer&                                                           tilebuf,
+                   PlaneRegion&                                                                rfull,
+                   PlaneRegion&                                                                rclip)
+    {
+      typedef PixelBuffer<PixelProperties<PixelType::UINT16>::std_type> T;
+
+      const std::shared_ptr<T>& lut(boost::get<std::shared_ptr<T>>(lookup->vbuffer()));
+      T::indices_type lutidx;
+      lutidx[ome::files::DIM_SPATIAL_X] = lutidx[ome::files::DIM_SPATIAL_Y] =
+        lutidx[ome::files::DIM_SPATIAL_Z] = lutidx[ome::files::DIM_TEMPORAL_T] =
+        lutidx[ome::files::DIM_CHANNEL] = lutidx[ome::files::DIM_MODULO_Z] =
+        lutidx[ome::files::DIM_MODULO_T] = lutidx[ome::files::DIM_MODULO_C] = 0;
+      std::array<const T::value_type *, 3> table;
+      for (dimension_size_type s = 0U; s < table.size(); ++s)
+        {
+          lutidx[ome::files::DIM_SUBCHANNEL] = s;
+          table[s] = &lut->at(lutidx);
+        }
+
+      const std::ptrdiff_t stride = buffer->strides()[ome::files::DIM_SPATIAL_X];
+      PixelBufferView<T::value_type> view(*buffer);
+      for (dimension_size_type row = rclip.y;
+           row != rclip.y + rclip.h;
+           ++row)
+        {
+          dimension_size_type offset = ((row - rfull.y) * rfull.w) + (rclip.x - rfull.x);
+
+          destidx[ome::files::DIM_SPATIAL_X] = rclip.x - region.x;
+          destidx[ome::files::DIM_SPATIAL_Y] = row - region.y;
+
+          for (dimension_size_type s = 0U; s < table.size(); ++s)
+            {
+              destidx[ome::files::DIM_SUBCHANNEL] = s;
+              T::value_type *dest = view.pointer(destidx);
+              if (indexbytes == 1U)
+                expandLookup(reinterpret_cast<const uint8_t *>(tilebuf.data()) + offset,
+                             rclip.w, table[s], dest, stride);
+              else
+                expandLookup(reinterpret_cast<const uint16_t *>(tilebuf.data()) + offset,
+                             rclip.w, table[s], dest, stride);
+            }
+        }
+      destidx[ome::files::DIM_SUBCHANNEL] = 0;
+    }
+
+    // Transfer a decoded tile to the destination buffer.
+    template<typename T>
+    void
+    transferTile(std::shared_ptr<T>&       buffer,
+                 typename T::indices_type& destidx,
+                 const TileBuffer&         tilebuf,
+                 PlaneRegion&              rfull,
+                 PlaneRegion&              rclip,
+                 uint16_t                  samples,
+                 uint16_t                  copysamples,
+                 bool                      extract)
+    {
+      IOStatistics::Timer timer(*statistics, IOStatistics::STAGE_TRANSFER);
+      const dimension_size_type first = destidx[ome::files::DIM_SUBCHANNEL];
+      if (lookup)
+        {
+          transferLookup(buffer, destidx, tilebuf, rfull, rclip);
+          accumulate(buffer, rclip, 0U, 3U);
+        }
+      else if (extract)
+        {
+          transferSample(buffer, destidx, tilebuf, rfull, rclip, samples, *subchannel);
+          accumulate(buffer, rclip, first, 1U);
+        }
+      else
+        {
+          transfer(buffer, destidx, tilebuf, rfull, rclip, copysamples);
+          accumulate(buffer, rclip, first, copysamples);
+        }
+    }
+
+    // Accumulate pixel statistics for a region of the destination
+    // buffer immediately after it is transferred, while it is
+    // still in cache.
+    template<typename T>
+    void
+    accumulate(std::shared_ptr<T>&  buffer,
+               const PlaneRegion&   rclip,
+               dimension_size_type  first,
+               dimension_size_type  count)
+    {
+      if (pixelstats)
+        pixelstats->add(*buffer, rclip.x - region.x, rclip.y - region.y,
+                        rclip.w, rclip.h, first, count);
+    }
+
+    template<typename T>
+    dimension_size_type
+    expected_read(const std::shared_ptr<T>& /* buffer */,
+                  const PlaneRegion&        rclip,
+                  uint16_t                  copysamples) const
+    {
+      return rclip.w * rclip.h * copysamples * sizeof(typename T::value_type);
+    }
+
+    // Special case for BIT
+    dimension_size_type
+    expected_read(const std::shared_ptr<PixelBuffer<PixelProperties<PixelType::BIT>::std_type>>& /* buffer */,
+                  const PlaneRegion&                                                             rclip,
+                  uint16_t                                                                       copysamples) const
+    {
+      dimension_size_type expectedread = rclip.w;
+
+      if (expectedread % 8)
+        ++expectedread;
+      expectedread *= rclip.h * copysamples;
+      expectedread /= 8;
+
+      return expectedread;
+    }
+
+    // Check if a tile may be decoded directly into the destination
+    // buffer.  This is the case when the tile spans the whole region
+    // width and the clip region starts at the tile origin, so that
+    // the leading rows of the decoded tile are laid out exactly as
+    // the corresponding rows of the destination buffer.  Tiles must
+    // be wholly contained; strips may be truncated since libtiff
+    // supports decoding the leading rows of a strip.
+    template<typename T>
+    bool
+    direct_read(const std::shared_ptr<T>& /* buffer */,
+                const PlaneRegion&        rfull,
+                const PlaneRegion&        rclip,
+                TileType                  type) const
+    {
+      return (!packedbits && !halffloat &&
+              rclip.x == rfull.x &&
+              rclip.y == rfull.y &&
+              rclip.w == rfull.w &&
+              (type == STRIP || rclip.h == rfull.h) &&
+              rclip.x == region.x &&
+              rclip.w == region.w);
+    }
+
+    // Special case for BIT
+    bool
+    direct_read(const std::shared_ptr<PixelBuffer<PixelProperties<PixelType::BIT>::std_type>>& /* buffer */,
+                const PlaneRegion&                                                             /* rfull */,
+                const PlaneRegion&                                                             /* rclip */,
+                TileType                                                                       /* type */) const
+    {
+      // Packed bits always require unpacking.
+      return false;
+    }
+
+    // Get the byte range of a tile or strip, from the strile reader
+    // if set, otherwise from libtiff.
+    // Needs wrapping in a sentry by the caller if not using a
+    // strile reader.
+    IOSource::range_type
+    strileRange(::TIFF    *tiffraw,
+                TileType   type,
+                tstrile_t  tile) const
+    {
+      if (striles)
+        return striles->getRange(tile);
+      return IOSource::range_type(strileOffset(tiffraw, type, tile),
+                                  static_cast<std::size_t>(strileByteCount(tiffraw, type, tile)));
+    }
+
+    // Check if a tile or strip is sparse, i.e. not stored in the
+    // file, with a zero byte count.  Sparse tiles read as zero.
+    // Needs wrapping in a sentry by the caller if not using a
+    // strile reader.
+    bool
+    sparse(::TIFF    *tiffraw,
+           TileType   type,
+           tstrile_t  tile) const
+    {
+      return !strileRange(tiffraw, type, tile).second;
+    }
+
+    // Get the raw data of a tile or strip from the strile run of the
+    // calling thread, or null if not held in the run.
+    const char *
+    strileRunData(const IOSource::range_type& range) const
+    {
+      const StrileRun& run(strileRun());
+      if (run.source != striles->getSource().get() ||
+          range.first < run.offset ||
+          range.first + range.second > run.offset + run.data.size())
+        return nullptr;
+      return run.data.data() + (range.first - run.offset);
+    }
+
+    // Read the raw data of the tiles or strips from tiles[first]
+    // which are stored adjacently, up to tiles[last], into the strile
+    // run of the calling thread with a single request.  Nothing is
+    // read if tiles[first] is already held in the run, or if there
+    // is nothing to coalesce, in which case each is read separately
+    // by readEncoded().
+    void
+    readStrileRun(dimension_size_type first,
+                  dimension_size_type last)
+    {
+      const IOSource::range_type start(striles->getRange(tiles[first]));
+      if (!start.second || strileRunData(start))
+        return;
+
+      StrileRun& run(strileRun());
+      run.source = nullptr;
+      if (start.second > max_run_strile_size)
+        return;
+
+      uint64_t end = start.first + start.second;
+      for (dimension_size_type i = first + 1U; i < last; ++i)
+        {
+          const IOSource::range_type next(striles->getRange(tiles[i]));
+          if (next.first != end || !next.second ||
+              next.second > max_run_strile_size ||
+              end + next.second - start.first > max_run_size)
+            break;
+          end += next.second;
+        }
+      if (end == start.first + start.second)
+        return;
+
+      const std::shared_ptr<IOSource>& source(striles->getSource());
+      run.data.resize(static_cast<std::size_t>(end - start.first));
+      IOStatistics::Timer timer(*statistics, IOStatistics::STAGE_READ);
+      TraceScope trace(TraceObserver::TILE_READ, &file, ifd.getOffset(),
+                       static_cast<tstrile_t>(tiles[first]));
+      // If the run is short, leave each to be read separately, which
+      // will report the error.
+      if (source->read(start.first, run.data.data(), run.data.size()) == run.data.size())
+        {
+          run.source = source.get();
+          run.offset = start.first;
+        }
+    }
+
+    // Read and decode up to size bytes of a tile or strip.  The raw
+    // data is decoded by the tile codec if specified, or else by
+    // libtiff.
+    // Needs wrapping in a sentry by the caller.
+    tmsize_t
+    readEncoded(::TIFF          *tiffraw,
+                const TileCodec *codec,
+                tstrile_t        tile,
+                TileType         type,
+                void            *dest,
+                tmsize_t         size)
+    {
+      IOSource::range_type range(strileRange(tiffraw, type, tile));
+      uint64_t rawsize = range.second;
+      statistics->add(IOStatistics::TILES_DECODED);
+      statistics->add(IOStatistics::BYTES_READ, rawsize);
+
+      if (!codec || !rawsize)
+        {
+          // libtiff does not expose the raw data it decodes, so
+          // verify a separate raw read.
+          if (checksums && rawsize)
+            {
+              thread_local std::vector<char> raw;
+              raw.resize(static_cast<std::size_t>(rawsize));
+              tmsize_t bytesread;
+              {
+                IOStatistics::Timer timer(*statistics, IOStatistics::STAGE_READ);
+                TraceScope trace(TraceObserver::TILE_READ, &file, ifd.getOffset(), tile);
+                bytesread = type == TILE ?
+                  TIFFReadRawTile(tiffraw, tile, raw.data(), static_cast<tmsize_t>(raw.size())) :
+                  TIFFReadRawStrip(tiffraw, tile, raw.data(), static_cast<tmsize_t>(raw.size()));
+              }
+              if (bytesread < 0)
+                return bytesread;
+              verifyTileChecksum(*checksums, ifd, tile, raw.data(),
+                                 static_cast<std::size_t>(bytesread), *statistics);
+            }
+
+          IOStatistics::Timer timer(*statistics, IOStatistics::STAGE_DECODE);
+          TraceScope trace(TraceObserver::TILE_DECODE, &file, ifd.getOffset(), tile);
+          return type == TILE ?
+            TIFFReadEncodedTile(tiffraw, tile, dest, size) :
+            TIFFReadEncodedStrip(tiffraw, tile, dest, size);
+        }
+
+      thread_local std::vector<char> raw;
+      const char *rawdata = striles ? strileRunData(range) : nullptr;
+      tmsize_t bytesread;
+      if (rawdata)
+        bytesread = static_cast<tmsize_t>(rawsize);
+      else
+        {
+          raw.resize(static_cast<std::size_t>(rawsize));
+          IOStatistics::Timer timer(*statistics, IOStatistics::STAGE_READ);
+          TraceScope trace(TraceObserver::TILE_READ, &file, ifd.getOffset(), tile);
+          if (striles)
+            bytesread = static_cast<tmsize_t>(striles->read(tile, raw));
+          else
+            bytesread = type == TILE ?
+              TIFFReadRawTile(tiffraw, tile, raw.data(), static_cast<tmsize_t>(raw.size())) :
+              TIFFReadRawStrip(tiffraw, tile, raw.data(), static_cast<tmsize_t>(raw.size()));
+          rawdata = raw.data();
+        }
+      if (bytesread < 0)
+        return bytesread;
+
+      if (checksums)
+        verifyTileChecksum(*checksums, ifd, tile, rawdata,
+                           static_cast<std::size_t>(bytesread), *statistics);
+
+      IOStatistics::Timer timer(*statistics, IOStatistics::STAGE_DECODE);
+      TraceScope trace(TraceObserver::TILE_DECODE, &file, ifd.getOffset(), tile);
+      return static_cast<tmsize_t>(codec->decode(tileCodecParameters(ifd, tileinfo.tileRegion(tile)),
+                                                 rawdata, static_cast<std::size_t>(bytesread),
+                                                 dest, static_cast<std::size_t>(size)));
+    }
+
+    // Decode a whole tile or strip into a tile buffer.
+    // Needs wrapping in a sentry by the caller.
+    template<typename T>
+    void
+    decode(std::shared_ptr<T>& buffer,
+           ::TIFF             *tiffraw,
+           const TileCodec    *codec,
+           const Sentry&       sentry,
+           TileBuffer&         tilebuf,
+           tstrile_t           tile,
+           TileType            type,
+           const PlaneRegion&  rclip,
+           uint16_t            copysamples)
+    {
+      if (sparse(tiffraw, type, tile))
+        {
+          // Zero-fill without reading or decoding.
+          statistics->add(IOStatistics::SPARSE_TILES);
+          std::memset(tilebuf.data(), 0, static_cast<std::size_t>(tilebuf.size()));
+          return;
+        }
+
+      if (packedbits)
+        {
+          decodePacked(tiffraw, codec, sentry, tilebuf, tile, type, rclip, copysamples);
+          return;
+        }
+
+      if (halffloat)
+        {
+          decodeHalf(tiffraw, codec, sentry, tilebuf, tile, type, rclip, copysamples);
+          return;
+        }
+
+      if (type == TILE)
+        {
+          tmsize_t bytesread = readEncoded(tiffraw, codec, tile, type, tilebuf.data(), static_cast<tsize_t>(tilebuf.size()));
+          if (bytesread < 0)
+            sentry.error("Failed to read encoded tile");
+          else if (static_cast<dimension_size_type>(bytesread) != tilebuf.size())
+            sentry.error("Failed to read encoded tile fully");
+        }
+      else
+        {
+          tmsize_t bytesread = readEncoded(tiffraw, codec, tile, type, tilebuf.data(), static_cast<tsize_t>(tilebuf.size()));
+          // The strip contains indices when using a lookup table.
+          dimension_size_type expectedread = lookup ?
+            rclip.w * rclip.h * indexbytes :
+            expected_read(buffer, rclip, copysamples);
+          if (bytesread < 0)
+            sentry.error("Failed to read encoded strip");
+          else if (static_cast<dimension_size_type>(bytesread) < expectedread)
+            sentry.error("Failed to read encoded strip fully");
+        }
+    }
+
+    // Decode a whole tile or strip of packed samples into a scratch
+    // buffer, and unpack each row into the tile buffer.  Each row of
+    // packed samples starts on a byte boundary.
+    // Needs wrapping in a sentry by the caller.
+    void
+    decodePacked(::TIFF             *tiffraw,
+                 const TileCodec    *codec,
+                 const Sentry&       sentry,
+                 TileBuffer&         tilebuf,
+                 tstrile_t           tile,
+                 TileType            type,
+                 const PlaneRegion&  rclip,
+                 uint16_t            copysamples)
+    {
+      PlaneRegion rfull = tileinfo.tileRegion(tile);
+      const dimension_size_type rowsamples = rfull.w * copysamples;
+      const dimension_size_type rowbytes = packedSampleSize(rowsamples, packedbits);
+
+      TileBuffer& packed(scratchTileBuffer(tileinfo.bufferSize()));
+      tmsize_t bytesread = readEncoded(tiffraw, codec, tile, type, packed.data(), static_cast<tsize_t>(packed.size()));
+      // Strips need only contain the rows up to the end of the clip
+      // region.
+      dimension_size_type expectedread = type == TILE ?
+        packed.size() : (rclip.y - rfull.y + rclip.h) * rowbytes;
+      if (bytesread < 0)
+        sentry.error(type == TILE ? "Failed to read encoded tile" : "Failed to read encoded strip");
+      else if (static_cast<dimension_size_type>(bytesread) < expectedread)
+        sentry.error(type == TILE ? "Failed to read encoded tile fully" : "Failed to read encoded strip fully");
+
+      IOStatistics::Timer timer(*statistics, IOStatistics::STAGE_TRANSFER);
+      const dimension_size_type rows = std::min(static_cast<dimension_size_type>(bytesread) / rowbytes,
+                                                tilebuf.size() / (rowsamples * sizeof(uint16_t)));
+      const uint8_t *src = packed.data();
+      uint16_t *dest = reinterpret_cast<uint16_t *>(tilebuf.data());
+      for (dimension_size_type row = 0; row < rows; ++row)
+        unpackSamples(src + (row * rowbytes), dest + (row * rowsamples), rowsamples, packedbits);
+    }
+
+    // Decode a whole tile or strip of half precision samples into a
+    // scratch buffer, and convert the decoded rows into FLOAT
+    // samples in the tile buffer.
+    // Needs wrapping in a sentry by the caller.
+    void
+    decodeHalf(::TIFF             *tiffraw,
+               const TileCodec    *codec,
+               const Sentry&       sentry,
+               TileBuffer&         tilebuf,
+               tstrile_t           tile,
+               TileType            type,
+               const PlaneRegion&  rclip,
+               uint16_t            copysamples)
+    {
+      PlaneRegion rfull = tileinfo.tileRegion(tile);
+      const dimension_size_type rowsamples = rfull.w * copysamples;
+      const dimension_size_type rowbytes = rowsamples * sizeof(uint16_t);
+
+      TileBuffer& half(scratchTileBuffer(tileinfo.bufferSize()));
+      tmsize_t bytesread = readEncoded(tiffraw, codec, tile, type, half.data(), static_cast<tsize_t>(half.size()));
+      // Strips need only contain the rows up to the end of the clip
+      // region.
+      dimension_size_type expectedread = type == TILE ?
+        half.size() : (rclip.y - rfull.y + rclip.h) * rowbytes;
+      if (bytesread < 0)
+        sentry.error(type == TILE ? "Failed to read encoded tile" : "Failed to read encoded strip");
+      else if (static_cast<dimension_size_type>(bytesread) < expectedread)
+        sentry.error(type == TILE ? "Failed to read encoded tile fully" : "Failed to read encoded strip fully");
+
+      IOStatistics::Timer timer(*statistics, IOStatistics::STAGE_TRANSFER);
+      const dimension_size_type count = std::min(static_cast<dimension_size_type>(bytesread) / rowbytes,
+                                                 tilebuf.size() / (rowsamples * sizeof(float))) * rowsamples;
+      halfToFloat(reinterpret_cast<const uint16_t *>(half.data()),
+                  reinterpret_cast<float *>(tilebuf.data()), count);
+    }
+
+    // Read only the rows of a strip within the clip region, rather
+    // than decoding the whole strip, into a scratch buffer sized for
+    // these rows.  Uncompressed strips are read directly from the
+    // I/O source over the byte range of the rows; strips decoded by
+    // libtiff are decoded up to the last row in the clip region.
+    // rpart is set to the part of the strip held in the returned
+    // buffer.  Returns null if the whole strip must be decoded.
+    // Needs wrapping in a sentry by the caller.
+    TileBuffer *
+    readPartialStrip(::TIFF             *tiffraw,
+                     const TileCodec    *codec,
+                     const Sentry&       sentry,
+                     tstrile_t           tile,
+                     const PlaneRegion&  rfull,
+                     const PlaneRegion&  rclip,
+                     uint16_t            copysamples,
+                     PlaneRegion&        rpart)
+    {
+      uint16_t bits = ifd.getBitsPerSample();
+      // Packed bits are unpacked from the start of the strip, and
+      // half precision samples must be converted.
+      if (bits % 8U || halffloat || rclip.h == rfull.h)
+        return nullptr;
+
+      dimension_size_type rowbytes = rfull.w * copysamples * (bits / 8U);
+      dimension_size_type first = rclip.y - rfull.y;
+
+      const std::shared_ptr<IOSource>& source(ifd.getTIFF()->getSource());
+      if (source && ifd.getCompression() == COMPRESSION_NONE &&
+          (striles ? striles->isPlainEncoding() :
+           !TIFFIsByteSwapped(tiffraw) && !TIFFIsBitReversed(tiffraw)))
+        {
+          IOSource::range_type range(strileRange(tiffraw, STRIP, tile));
+          uint64_t offset = range.first;
+          uint64_t count = range.second;
+          dimension_size_type size = rclip.h * rowbytes;
+          if (offset && (first * rowbytes) + size <= count)
+            {
+              TileBuffer& partbuf(scratchTileBuffer(size));
+              statistics->add(IOStatistics::TILES_DECODED);
+              statistics->add(IOStatistics::BYTES_READ, size);
+
+              std::size_t bytesread;
+              {
+                IOStatistics::Timer timer(*statistics, IOStatistics::STAGE_READ);
+                TraceScope trace(TraceObserver::TILE_READ, &file, ifd.getOffset(), tile);
+                bytesread = source->read(offset + (first * rowbytes), partbuf.data(), size);
+              }
+              if (bytesread != size)
+                sentry.error("Failed to read strip rows fully");
+
+              rpart = PlaneRegion(rfull.x, rclip.y, rfull.w, rclip.h);
+              return &partbuf;
+            }
+        }
+
+      if (!codec)
+        {
+          dimension_size_type size = (first + rclip.h) * rowbytes;
+          TileBuffer& partbuf(scratchTileBuffer(size));
+          tmsize_t bytesread = readEncoded(tiffraw, codec, tile, STRIP, partbuf.data(), static_cast<tsize_t>(size));
+          if (bytesread < 0)
+            sentry.error("Failed to read encoded strip");
+          else if (static_cast<dimension_size_type>(bytesread) != size)
+            sentry.error("Failed to read encoded strip fully");
+
+          rpart = PlaneRegion(rfull.x, rfull.y, rfull.w, first + rclip.h);
+          return &partbuf;
+        }
+
+      return nullptr;
+    }
+
+    // Read and transfer a single tile.
+    // Needs wrapping in a sentry by the caller.
+    template<typename T>
+    void
+    readTile(std::shared_ptr<T>& buffer,
+             ::TIFF             *tiffraw,
+             const TileCodec    *codec,
+             const Sentry&       sentry,
+             tstrile_t           tile,
+             TileType            type,
+             uint16_t            samples,
+             PlanarConfiguration planarconfig)
+    {
+      PlaneRegion rfull = tileinfo.tileRegion(tile);
+      PlaneRegion rclip = tileinfo.tileRegion(tile, region);
+      dimension_size_type sample = tileinfo.tileSample(tile);
+
+      uint16_t copysamples = samples;
+      dimension_size_type dest_subchannel = 0;
+      if (planarconfig == SEPARATE)
+        {
+          copysamples = 1;
+          dest_subchannel = subchannel ? 0 : sample;
+        }
+
+      // Extract a single sample from contiguous samples.
+      bool extract = subchannel && planarconfig == CONTIG && samples > 1;
+
+      typename T::indices_type destidx;
+      destidx[ome::files::DIM_SPATIAL_X] = 0;
+      destidx[ome::files::DIM_SPATIAL_Y] = 0;
+      destidx[ome::files::DIM_SUBCHANNEL] = dest_subchannel;
+      destidx[ome::files::DIM_SPATIAL_Z] = destidx[ome::files::DIM_TEMPORAL_T] =
+        destidx[ome::files::DIM_CHANNEL] = destidx[ome::files::DIM_MODULO_Z] =
+        destidx[ome::files::DIM_MODULO_T] = destidx[ome::files::DIM_MODULO_C] = 0;
+
+      // Sparse tiles are zero-filled by decode().
+      bool empty = sparse(tiffraw, type, tile);
+
+      if (!tilecache && !empty && !extract && !lookup && native &&
+          direct_read(buffer, rfull, rclip, type))
+        {
+          // Decode only the rows within the clip region straight into
+          // the destination buffer, avoiding the intermediate copy.
+          destidx[ome::files::DIM_SPATIAL_X] = rclip.x - region.x;
+          destidx[ome::files::DIM_SPATIAL_Y] = rclip.y - region.y;
+
+          typename T::value_type *dest = &buffer->at(destidx);
+          dimension_size_type expectedread = expected_read(buffer, rclip, copysamples);
+
+          tmsize_t bytesread = readEncoded(tiffraw, codec, tile, type, dest, static_cast<tsize_t>(expectedread));
+
+          if (bytesread < 0)
+            sentry.error(type == TILE ? "Failed to read encoded tile" : "Failed to read encoded strip");
+          else if (static_cast<dimension_size_type>(bytesread) != expectedread)
+            sentry.error(type == TILE ? "Failed to read encoded tile fully" : "Failed to read encoded strip fully");
+          accumulate(buffer, rclip, dest_subchannel, copysamples);
+          return;
+        }
+
+      if (tilecache)
+        {
+          // Reuse a previously decoded tile if cached, otherwise
+          // decode into a new buffer and add it to the cache.  The
+          // key is only constructed on a miss, so that a hit does
+          // not copy the filename.
+          DecodedTileCache::value_type cached(tilecache->find(filename, ifd.getOffset(), tile));
+          if (!cached)
+            {
+              statistics->add(IOStatistics::TILE_CACHE_MISSES);
+              std::shared_ptr<TileBuffer> decoded(std::make_shared<TileBuffer>(tileinfo.decodedBufferSize()));
+              decode(buffer, tiffraw, codec, sentry, *decoded, tile, type, rclip, copysamples);
+              tilecache->insert(DecodedTileCache::key_type(filename, ifd.getOffset(), tile), decoded);
+              cached = decoded;
+            }
+          else
+            statistics->add(IOStatistics::TILE_CACHE_HITS);
+          if (decodeonly)
+            return;
+          transferTile(buffer, destidx, *cached, rfull, rclip, samples, copysamples, extract);
+          return;
+        }
+
+      if (type == STRIP && !empty)
+        {
+          PlaneRegion rpart;
+          TileBuffer *partbuf = readPartialStrip(tiffraw, codec, sentry, tile, rfull, rclip,
+                                                 copysamples, rpart);
+          if (partbuf)
+            {
+              transferTile(buffer, destidx, *partbuf, rpart, rclip, samples, copysamples, extract);
+              return;
+            }
+        }
+
+      TileBuffer& tilebuf(scratchTileBuffer(tileinfo.decodedBufferSize()));
+      decode(buffer, tiffraw, codec, sentry, tilebuf, tile, type, rclip, copysamples);
+      transferTile(buffer, destidx, tilebuf, rfull, rclip, samples, copysamples, extract);
+    }
+
+    // The tiles read by a worker: a contiguous range, so that each
+    // worker fills a separate band of the destination buffer.  The
+    // destination is allocated uninitialised, so with first touch
+    // placement each band is on the NUMA node of its worker.
+    std::pair<dimension_size_type, dimension_size_type>
+    workerTiles(dimension_size_type worker,
+                dimension_size_type workers) const
+    {
+      return std::make_pair(tiles.size() * worker / workers,
+                            tiles.size() * (worker + 1U) / workers);
+    }
+
+    // Read the tiles of a worker (see workerTiles()) using a
+    // separate libtiff handle.  Tiles cover disjoint regions of the
+    // destination buffer, so several workers may run concurrently.
+    template<typename T>
+    void
+    readTiles(std::shared_ptr<T>&  buffer,
+              dimension_size_type  worker,
+              dimension_size_type  workers,
+              TileType             type,
+              uint16_t             samples,
+              PlanarConfiguration  planarconfig,
+              std::exception_ptr&  error)
+    {
+      const std::shared_ptr<::ome::files::tiff::TIFF>& tiff(ifd.getTIFF());
+
+      try
+        {
+          auto handle = tiff->acquireReadHandle(ifd.getOffset());
+          ::TIFF *tiffraw = reinterpret_cast<::TIFF *>(handle);
+
+          try
+            {
+              // The handle is exclusive to this thread, so only
+              // capture errors.
+              Sentry sentry;
+
+              if (static_cast<offset_type>(TIFFCurrentDirOffset(tiffraw)) != ifd.getOffset())
+                {
+                  statistics->add(IOStatistics::DIRECTORY_SWITCHES);
+                  IOStatistics::Timer timer(*statistics, IOStatistics::STAGE_DIRECTORY);
+                  TraceScope trace(TraceObserver::DIRECTORY_READ, &file, ifd.getOffset());
+                  if (!TIFFSetSubDirectory(tiffraw, ifd.getOffset()))
+                    sentry.error();
+                }
+              setJPEGColorMode(tiffraw);
+
+              std::shared_ptr<TileCodec> codec(findTileCodec(ifd.getCompression(), tiffraw));
+              const auto range(workerTiles(worker, workers));
+              for (dimension_size_type i = range.first; i < range.second; ++i)
+                readTile(buffer, tiffraw, codec.get(), sentry,
+                         static_cast<tstrile_t>(tiles[i]),
+                         type, samples, planarconfig);
+            }
+          catch (...)
+            {
+              tiff->releaseReadHandle(handle);
+              throw;
+            }
+
+          tiff->releaseReadHandle(handle);
+        }
+      catch (...)
+        {
+          error = std::current_exception();
+        }
+    }
+
+    // Decode the tiles of a worker (see workerTiles()) from raw data
+    // read with the strile reader.  No libtiff handle or
+    // lock is used, so several workers may run concurrently, and
+    // concurrently with reads of other regions.
+    template<typename T>
+    void
+    decodeTiles(std::shared_ptr<T>&  buffer,
+                const TileCodec     *codec,
+                dimension_size_type  worker,
+                dimension_size_type  workers,
+                TileType             type,
+                uint16_t             samples,
+                PlanarConfiguration  planarconfig,
+                std::exception_ptr&  error)
+    {
+      StrileRun& run(strileRun());
+      try
+        {
+          // No lock is needed, so only capture errors.
+          Sentry sentry;
+
+          const auto range(workerTiles(worker, workers));
+          for (dimension_size_type i = range.first; i < range.second; ++i)
+            {
+              // Tiles held in the cache need no raw data, so are
+              // not coalesced.
+              if (!tilecache)
+                readStrileRun(i, range.second);
+              readTile(buffer, nullptr, codec, sentry,
+                       static_cast<tstrile_t>(tiles[i]),
+                       type, samples, planarconfig);
+            }
+        }
+      catch (...)
+        {
+          error = std::current_exception();
+        }
+      // The source may change before the next read.
+      run.source = nullptr;
+    }
+
+    // Read into a destination buffer which is not host accessible,
+    // such as GPU device memory.  The raw data of every tile is read
+    // with the strile reader and passed to the device tile codec as
+    // a single batch, which stores each tile directly into the
+    // destination; only the compressed data is transferred to the
+    // device.  Nothing is transferred or converted on the host, so
+    // the stored data must need no further processing.
+    template<typename T>
+    void
+    readDevice(std::shared_ptr<T>& buffer,
+               PlanarConfiguration planarconfig)
+    {
+      const Compression compression = ifd.getCompression();
+      std::shared_ptr<DeviceTileCodec> codec(getDeviceTileCodec(compression));
+      striles = ifd.getStrileReader();
+      if (!codec || !striles || !striles->isPlainEncoding() ||
+          ifd.getBitsPerSample() % 8U || halffloat || lookup || subchannel ||
+          tilecache || !native || pixelstats)
+        {
+          boost::format fmt("Directory at offset %1% of %2% may not be read into device memory: "
+                            "a device tile codec for the compression scheme and plainly encoded "
+                            "whole byte samples in the native storage order are required");
+          fmt % ifd.getOffset() % file.string();
+          throw Exception(fmt.str());
+        }
+
+      // Cache the tile codec parameters.
+      ifd.getPixelType();
+
+      const std::vector<char>& tables(striles->getJPEGTables());
+      PixelBufferView<typename T::value_type> view(*buffer);
+      const std::size_t destpitch = static_cast<std::size_t>(view.stride(ome::files::DIM_SPATIAL_Y)) *
+        sizeof(typename T::value_type);
+
+      typename T::indices_type destidx;
+      std::fill(destidx.begin(), destidx.end(), 0);
+
+      std::vector<std::vector<char>> raw(tiles.size());
+      std::vector<DeviceTileRequest> requests;
+      requests.reserve(tiles.size());
+      {
+        IOStatistics::Timer timer(*statistics, IOStatistics::STAGE_READ);
+        for (dimension_size_type i = 0; i < tiles.size(); ++i)
+          {
+            const tstrile_t tile = static_cast<tstrile_t>(tiles[i]);
+            PlaneRegion rfull = tileinfo.tileRegion(tile);
+            PlaneRegion rclip = tileinfo.tileRegion(tile, region);
+
+            DeviceTileRequest request;
+            request.params = tileCodecParameters(ifd, rfull);
+            request.src = nullptr;
+            request.size = 0U;
+            if (striles->getRange(tile).second)
+              {
+                TraceScope trace(TraceObserver::TILE_READ, &file, ifd.getOffset(), tile);
+                std::size_t bytesread = striles->read(tile, raw[i]);
+                statistics->add(IOStatistics::TILES_DECODED);
+                statistics->add(IOStatistics::BYTES_READ, bytesread);
+                if (checksums)
+                  verifyTileChecksum(*checksums, ifd, tile, raw[i].data(), bytesread, *statistics);
+                if (compression == COMPRESSION_JPEG && !tables.empty())
+                  mergeJPEGTables(tables, raw[i]);
+                request.src = raw[i].data();
+                request.size = raw[i].size();
+              }
+            else
+              statistics->add(IOStatistics::SPARSE_TILES);
+
+            request.x = rclip.x - rfull.x;
+            request.y = rclip.y - rfull.y;
+            request.w = rclip.w;
+            request.h = rclip.h;
+
+            destidx[ome::files::DIM_SPATIAL_X] = rclip.x - region.x;
+            destidx[ome::files::DIM_SPATIAL_Y] = rclip.y - region.y;
+            destidx[ome::files::DIM_SUBCHANNEL] = planarconfig == SEPARATE ? tileinfo.tileSample(tile) : 0U;
+            request.dest = view.pointer(destidx);
+            request.destpitch = destpitch;
+            requests.push_back(request);
+          }
+      }
+
+      IOStatistics::Timer timer(*statistics, IOStatistics::STAGE_DECODE);
+      TraceScope trace(TraceObserver::TILE_DECODE, &file, ifd.getOffset());
+      codec->decodeBatch(requests);
     }
 
-    // Special case for BIT
-    dimension_size_type
-    expected_read(const std::shared_ptr<PixelBuffer<PixelProperties<PixelType::BIT>::std_type>>& /* buffer */,
-                  const PlaneRegion&                                                             rclip,
-                  uint16_t                                                                       copysamples) const
+    // Run work(worker, workers, error) on each of threads workers using
+    // the TIFF executor, the first on the calling thread, and
+    // rethrow the first error.
+    template<typename Work>
+    void
+    runWorkers(dimension_size_type threads,
+               const Work&         work)
     {
-      dimension_size_type expectedread = rclip.w;
-
-      if (expectedread % 8)
-        ++expectedread;
-      expectedread *= rclip.h * copysamples;
-      expectedread /= 8;
-
-      return expectedread;
+      runParallel(ifd.getTIFF()->getExecutor(), std::max(threads, static_cast<dimension_size_type>(1U)),
+                  [&work](dimension_size_type worker, dimension_size_type workers)
+                  {
+                    std::exception_ptr error;
+                    work(worker, workers, error);
+                    if (error)
+                      std::rethrow_exception(error);
+                  });
     }
 
     template<typename T>
@@ -269,50 +2150,85 @@ namespace
       uint16_t samples = ifd.getSamplesPerPixel();
       PlanarConfiguration planarconfig = ifd.getPlanarConfiguration();
 
-      Sentry sentry;
-
-      for(const auto i : tiles)
+      if (device)
         {
-          tstrile_t tile = static_cast<tstrile_t>(i);
-          PlaneRegion rfull = tileinfo.tileRegion(tile);
-          PlaneRegion rclip = tileinfo.tileRegion(tile, region);
-          dimension_size_type sample = tileinfo.tileSample(tile);
+          readDevice(buffer, planarconfig);
+          return;
+        }
 
-          uint16_t copysamples = samples;
-          dimension_size_type dest_subchannel = 0;
-          if (planarconfig == SEPARATE)
-            {
-              copysamples = 1;
-              dest_subchannel = sample;
-            }
+      dimension_size_type threads = std::min(tiff->getDecodeThreads(),
+                                             static_cast<dimension_size_type>(tiles.size()));
 
-          if (type == TILE)
-            {
-              tmsize_t bytesread = TIFFReadEncodedTile(tiffraw, tile, tilebuf.data(), static_cast<tsize_t>(tilebuf.size()));
-              if (bytesread < 0)
-                sentry.error("Failed to read encoded tile");
-              else if (static_cast<dimension_size_type>(bytesread) != tilebuf.size())
-                sentry.error("Failed to read encoded tile fully");
-            }
-          else
+      // If the raw data of every tile is present and may be decoded
+      // by a tile codec, read it directly from the I/O source and
+      // decode without libtiff, so that no lock is held.
+      std::shared_ptr<TileCodec> rawcodec;
+      striles = ifd.getStrileReader();
+      if (striles && striles->isPlainEncoding() && !packedbits && !halffloat)
+        {
+          rawcodec = getTileCodec(ifd.getCompression());
+          for (const auto i : tiles)
             {
-              tmsize_t bytesread = TIFFReadEncodedStrip(tiffraw, tile, tilebuf.data(), static_cast<tsize_t>(tilebuf.size()));
-              dimension_size_type expectedread = expected_read(buffer, rclip, copysamples);
-              if (bytesread < 0)
-                sentry.error("Failed to read encoded strip");
-              else if (static_cast<dimension_size_type>(bytesread) < expectedread)
-                sentry.error("Failed to read encoded strip fully");
+              if (!rawcodec)
+                break;
+              if (!striles->getRange(i).second)
+                rawcodec.reset();
             }
+        }
+      if (!rawcodec)
+        striles.reset();
+      else
+        {
+          // Cache the tile codec parameters prior to starting workers.
+          ifd.getPixelType();
+
+          const TileCodec *codec = rawcodec.get();
+          runWorkers(threads,
+                     [&](dimension_size_type worker,
+                         dimension_size_type workers,
+                         std::exception_ptr& error)
+                     {
+                       decodeTiles(buffer, codec, worker, workers, type, samples, planarconfig, error);
+                     });
+          return;
+        }
+      bool readonly;
+      bool current;
+      {
+        Sentry sentry(*tiff, readImageSite);
+        readonly = TIFFGetMode(tiffraw) == O_RDONLY;
+        current = static_cast<offset_type>(TIFFCurrentDirOffset(tiffraw)) == ifd.getOffset();
+      }
 
-          typename T::indices_type destidx;
-          destidx[ome::files::DIM_SPATIAL_X] = 0;
-          destidx[ome::files::DIM_SPATIAL_Y] = 0;
-          destidx[ome::files::DIM_SUBCHANNEL] = dest_subchannel;
-          destidx[ome::files::DIM_SPATIAL_Z] = destidx[ome::files::DIM_TEMPORAL_T] =
-            destidx[ome::files::DIM_CHANNEL] = destidx[ome::files::DIM_MODULO_Z] =
-            destidx[ome::files::DIM_MODULO_T] = destidx[ome::files::DIM_MODULO_C] = 0;
+      // Cache the tile codec parameters prior to starting workers.
+      ifd.getCompression();
+      ifd.getPixelType();
 
-          transfer(buffer, destidx, tilebuf, rfull, rclip, copysamples);
+      if (readonly && (threads > 1U || !current))
+        {
+          // Decode in parallel, with each worker using a separate
+          // libtiff handle.  This is also used for serial decoding
+          // when the main handle is on a different directory, since
+          // the retained read handles may already have this
+          // directory loaded; this avoids re-reading directories when
+          // alternating between IFDs.
+          runWorkers(threads,
+                     [&](dimension_size_type worker,
+                         dimension_size_type workers,
+                         std::exception_ptr& error)
+                     {
+                       readTiles(buffer, worker, workers, type, samples, planarconfig, error);
+                     });
+        }
+      else
+        {
+          Sentry sentry(*tiff, readImageSite);
+
+          std::shared_ptr<TileCodec> codec(findTileCodec(ifd.getCompression(), tiffraw));
+          for(const auto i : tiles)
+            readTile(buffer, tiffraw, codec.get(), sentry,
+                     static_cast<tstrile_t>(i),
+                     type, samples, planarconfig);
         }
     }
   };
@@ -322,25 +2238,170 @@ namespace
     IFD&                                    ifd;
     std::vector<TileCoverage>&              tilecoverage;
     TileCache&                              tilecache;
+    TileBufferPool&                         tilepool;
+    std::vector<bool>&                      written;
     const TileInfo&                         tileinfo;
     const PlaneRegion&                      region;
-    const std::vector<dimension_size_type>& tiles;
-
-    WriteVisitor(IFD&                                    ifd,
-                 std::vector<TileCoverage>&              tilecoverage,
-                 TileCache&                              tilecache,
-                 const TileInfo&                         tileinfo,
-                 const PlaneRegion&                      region,
-                 const std::vector<dimension_size_type>& tiles):
+    TileRange                               tiles;
+    boost::optional<dimension_size_type>    subchannel;
+    std::shared_ptr<IOStatistics>           statistics;
+    const boost::filesystem::path&          file;
+    // Set if the source buffer has the storage order of the encoded
+    // tiles.  If unset, samples are gathered using the source buffer
+    // strides.
+    bool                                    native;
+    // If set, statistics are accumulated for each region of the
+    // source buffer as it is transferred.
+    PixelStatistics                        *pixelstats;
+    // If set, the statistics of each tile are recorded as it is
+    // flushed.
+    tile_summary_function                   summarise;
+    // Bits per sample if samples are packed, otherwise zero.  Tiles
+    // are cached as 16-bit samples, and packed as they are flushed.
+    uint16_t                                packedbits;
+    // Set if samples are stored in half precision.  Tiles are
+    // cached as FLOAT samples, and converted as they are flushed.
+    bool                                    halffloat;
+    // Set if existing tiles are being rewritten.  Every tile is
+    // encoded by libtiff, which places it over its old data if it
+    // fits, and empty tiles are written rather than skipped.
+    bool                                    update;
+
+    // If subchannel is set, the source buffer contains only this
+    // subchannel, which is written into the tiles alongside any
+    // other subchannels written separately.
+    WriteVisitor(IFD&                                        ifd,
+                 std::vector<TileCoverage>&                  tilecoverage,
+                 TileCache&                                  tilecache,
+                 TileBufferPool&                             tilepool,
+                 std::vector<bool>&                          written,
+                 const TileInfo&                             tileinfo,
+                 const PlaneRegion&                          region,
+                 const TileRange&                            tiles,
+                 const boost::optional<dimension_size_type>& subchannel = boost::none):
       ifd(ifd),
       tilecoverage(tilecoverage),
       tilecache(tilecache),
+      tilepool(tilepool),
+      written(written),
       tileinfo(tileinfo),
       region(region),
-      tiles(tiles)
+      tiles(tiles),
+      subchannel(subchannel),
+      statistics(ifd.getTIFF()->getStatistics()),
+      file(ifd.getTIFF()->getFilename()),
+      native(true),
+      pixelstats(nullptr),
+      summarise(nullptr),
+      packedbits(isPackedSampleDepth(ifd.getBitsPerSample()) ? ifd.getBitsPerSample() : 0U),
+      halffloat(halfFloatSamples(ifd)),
+      update(false)
     {}
 
-    // Flush covered tiles.
+    // Check if a tile is fully covered.  Contiguous tiles contain
+    // all samples, so must be covered for every sample, since
+    // samples may be written separately.
+    bool
+    covered(tstrile_t           tile,
+            const PlaneRegion&  validarea,
+            PlanarConfiguration planarconfig) const
+    {
+      if (planarconfig == SEPARATE)
+        return tilecoverage.at(tileinfo.tileSample(tile)).covered(validarea);
+
+      for (const auto& coverage : tilecoverage)
+        if (!coverage.covered(validarea))
+          return false;
+      return true;
+    }
+
+    // Encode tiles using a tile codec.  If checksums is not empty,
+    // the checksum of each encoded tile is computed while it is
+    // still in cache.
+    void
+    encodeTiles(const TileCodec&                        codec,
+                const std::vector<tstrile_t>&           indices,
+                const std::vector<TileCodecParameters>& params,
+                const std::vector<const TileBuffer *>&  buffers,
+                const std::vector<dimension_size_type>& sizes,
+                std::vector<std::vector<char>>&         encoded,
+                std::vector<uint32_t>&                  checksums,
+                dimension_size_type                     start,
+                dimension_size_type                     step,
+                std::exception_ptr&                     error) const
+    {
+      try
+        {
+          for (dimension_size_type i = start;
+               i < buffers.size();
+               i += step)
+            {
+              TraceScope trace(TraceObserver::TILE_ENCODE, &file, ifd.getOffset(), indices.at(i));
+              codec.encode(params.at(i), buffers.at(i)->data(),
+                           static_cast<std::size_t>(sizes.at(i)), encoded.at(i));
+              if (!checksums.empty())
+                checksums.at(i) = ::ome::files::crc32c(encoded.at(i).data(), encoded.at(i).size());
+            }
+        }
+      catch (...)
+        {
+          error = std::current_exception();
+        }
+    }
+
+    // Pack a tile of 16-bit samples into a new buffer for encoding.
+    // Each row of packed samples starts on a byte boundary.
+    TileCache::value_type
+    pack(const TileBuffer&   tilebuf,
+         dimension_size_type rowsamples)
+    {
+      IOStatistics::Timer timer(*statistics, IOStatistics::STAGE_TRANSFER);
+
+      TileCache::value_type packed(tilepool.get(tileinfo.bufferSize()));
+      const dimension_size_type rowbytes = packedSampleSize(rowsamples, packedbits);
+      const dimension_size_type rows = std::min(tilebuf.size() / (rowsamples * sizeof(uint16_t)),
+                                                packed->size() / rowbytes);
+      const uint16_t *src = reinterpret_cast<const uint16_t *>(tilebuf.data());
+      uint8_t *dest = packed->data();
+      for (dimension_size_type row = 0; row < rows; ++row)
+        packSamples(src + (row * rowsamples), rowsamples, dest + (row * rowbytes), packedbits);
+      return packed;
+    }
+
+    // Convert a tile of FLOAT samples into a new buffer of half
+    // precision samples for encoding.
+    TileCache::value_type
+    convertHalf(const TileBuffer& tilebuf)
+    {
+      IOStatistics::Timer timer(*statistics, IOStatistics::STAGE_TRANSFER);
+
+      TileCache::value_type half(tilepool.get(tileinfo.bufferSize()));
+      const dimension_size_type count = std::min(tilebuf.size() / sizeof(float),
+                                                 half->size() / sizeof(uint16_t));
+      floatToHalf(reinterpret_cast<const float *>(tilebuf.data()),
+                  reinterpret_cast<uint16_t *>(half->data()), count);
+      return half;
+    }
+
+    // Mark a tile as written, and release its buffer.
+    void
+    markWritten(tstrile_t tile)
+    {
+      tilecache.erase(tile);
+      written.at(tile) = true;
+
+      // The current tile is the first tile not yet written.
+      dimension_size_type current = ifd.getCurrentTile();
+      while (current < written.size() && written[current])
+        ++current;
+      ifd.setCurrentTile(current);
+    }
+
+    // Flush covered tiles.  Only the tiles modified by this write
+    // may have become covered, so only these need checking.  Each
+    // is written as soon as it is covered, irrespective of the
+    // order of the tiles in the file, so that the cache only holds
+    // partially covered tiles.
     void
     flush()
     {
@@ -348,43 +2409,207 @@ namespace
       ::TIFF *tiffraw = reinterpret_cast<::TIFF *>(tiff->getWrapped());
       TileType type = tileinfo.tileType();
       PlaneRegion rimage(0, 0, ifd.getImageWidth(), ifd.getImageHeight());
-      tstrile_t tile = static_cast<tstrile_t>(ifd.getCurrentTile());
+      PlanarConfiguration planarconfig = ifd.getPlanarConfiguration();
+
+      Sentry sentry(*tiff, writeImageSite);
 
-      Sentry sentry;
-      while(tile < tileinfo.tileCount())
+      // Find the covered tiles which may be written.
+      std::vector<tstrile_t> indices;
+      std::vector<TileCache::value_type> retained;
+      std::vector<const TileBuffer *> buffers;
+      std::vector<dimension_size_type> sizes;
+      for (const auto i : tiles)
         {
-          dimension_size_type tile_subchannel = tileinfo.tileSample(tile);
+          tstrile_t pending = static_cast<tstrile_t>(i);
+          if (written.at(pending))
+            continue;
 
-          PlaneRegion validarea = tileinfo.tileRegion(tile) & rimage;
+          PlaneRegion validarea = tileinfo.tileRegion(pending) & rimage;
           if (!validarea.area())
-            break;
+            continue;
+
+          if (!covered(pending, validarea, planarconfig))
+            continue;
+
+          // Retain the buffer, since finding further tiles may
+          // spill it from the cache.
+          TileCache::value_type tilebuf(tilecache.find(pending));
+          assert(tilebuf);
+
+          const dimension_size_type copysamples =
+            planarconfig == SEPARATE ? 1U : ifd.getSamplesPerPixel();
+
+          // Statistics are recorded for empty tiles too, so that
+          // readers need not treat unwritten tiles specially.
+          if (summarise)
+            tiff->addTileStatistics(pending,
+                                    summarise(*tilebuf,
+                                              tileinfo.tileRegion(pending).w * copysamples,
+                                              validarea.w * copysamples,
+                                              validarea.h));
+
+          if (packedbits)
+            tilebuf = pack(*tilebuf, tileinfo.tileRegion(pending).w * copysamples);
+          else if (halffloat)
+            tilebuf = convertHalf(*tilebuf);
+
+          // Only the rows within the image are stored for strips;
+          // the strip buffer is sized for at most the image height.
+          dimension_size_type size = tilebuf->size();
+          if (type == STRIP)
+            size = (size / std::min(tileinfo.tileRegion(pending).h, rimage.h)) * validarea.h;
+
+          // Empty tiles are left unwritten, with a zero offset and
+          // byte count.
+          if (!update && tiff->getSparseTiles() && allZero(*tilebuf, size))
+            {
+              statistics->add(IOStatistics::SPARSE_TILES);
+              markWritten(pending);
+              continue;
+            }
 
-          if (!tilecoverage.at(tile_subchannel).covered(validarea))
-            break;
+          indices.push_back(pending);
+          retained.push_back(tilebuf);
+          buffers.push_back(tilebuf.get());
+          sizes.push_back(size);
+        }
+
+      dimension_size_type threads = std::min(tiff->getEncodeThreads(),
+                                             static_cast<dimension_size_type>(buffers.size()));
+      // Raw writes continue from the last write rather than
+      // reusing the space of an existing tile, so updated tiles are
+      // always encoded by libtiff.
+      std::shared_ptr<TileCodec> codec;
+      if (!buffers.empty() && !update)
+        codec = findTileCodec(ifd.getCompression(), tiffraw);
+
+      if (codec)
+        {
+          // Compress using the tile codec, in parallel if permitted,
+          // then write the compressed data.
+          std::vector<TileCodecParameters> params;
+          params.reserve(indices.size());
+          for (const auto tile : indices)
+            {
+              PlaneRegion validarea = tileinfo.tileRegion(tile) & rimage;
+              PlaneRegion encodedarea(tileinfo.tileRegion(tile));
+              if (type == STRIP)
+                encodedarea.h = validarea.h;
+              params.push_back(tileCodecParameters(ifd, encodedarea));
+            }
+
+          threads = std::max(threads, static_cast<dimension_size_type>(1U));
+          std::vector<std::vector<char>> encoded(buffers.size());
+          std::vector<uint32_t> checksums(tiff->getRecordTileChecksums() ? buffers.size() : 0U);
+          auto encodestart = IOStatistics::clock_type::now();
+          std::exception_ptr error;
+          try
+            {
+              runParallel(tiff->getExecutor(), threads,
+                          [&](dimension_size_type start, dimension_size_type step)
+                          {
+                            std::exception_ptr e;
+                            encodeTiles(*codec, indices, params, buffers, sizes, encoded, checksums,
+                                        start, step, e);
+                            if (e)
+                              std::rethrow_exception(e);
+                          });
+            }
+          catch (...)
+            {
+              error = std::current_exception();
+            }
+          // Elapsed rather than per-thread time, since the workers
+          // encode concurrently.
+          statistics->addTime(IOStatistics::STAGE_ENCODE,
+                              std::chrono::duration_cast<IOStatistics::duration_type>
+                              (IOStatistics::clock_type::now() - encodestart));
+          if (error)
+            std::rethrow_exception(error);
+
+          IOStatistics::Timer timer(*statistics, IOStatistics::STAGE_WRITE);
+
+          for (std::vector<tstrile_t>::size_type i = 0; i < indices.size(); ++i)
+            {
+              tstrile_t tile = indices[i];
+              const std::vector<char>& data(encoded[i]);
+              // libtiff does not modify the data for raw writes.
+              void *raw = const_cast<char *>(data.data());
+              tsize_t rawsize = static_cast<tsize_t>(data.size());
+              if (type == TILE)
+                {
+                  tsize_t byteswritten = TIFFWriteRawTile(tiffraw, tile, raw, rawsize);
+                  if (byteswritten < 0)
+                    sentry.error("Failed to write raw tile");
+                  else if (byteswritten != rawsize)
+                    sentry.error("Failed to write raw tile fully");
+                }
+              else
+                {
+                  tsize_t byteswritten = TIFFWriteRawStrip(tiffraw, tile, raw, rawsize);
+                  if (byteswritten < 0)
+                    sentry.error("Failed to write raw strip");
+                  else if (byteswritten != rawsize)
+                    sentry.error("Failed to write raw strip fully");
+                }
+              if (!checksums.empty())
+                tiff->addTileChecksum(tile, checksums[i]);
+              statistics->add(IOStatistics::TILES_ENCODED);
+              statistics->add(IOStatistics::BYTES_WRITTEN, static_cast<uint64_t>(rawsize));
+              markWritten(tile);
+            }
+          return;
+        }
 
-          assert(tilecache.find(tile));
-          TileBuffer& tilebuf = *tilecache.find(tile);
+      // Uncompressed tiles are stored as passed to libtiff, after
+      // any byte swapping (done in place), so their checksums are
+      // computed from the buffer once written.  Tiles compressed by
+      // libtiff, and updated tiles, can not be checksummed.
+      const bool checksum = tiff->getRecordTileChecksums() && !indices.empty();
+      if (checksum && update)
+        throw Exception("Tile checksums can not be recorded when updating an image");
+      if (checksum && ifd.getCompression() != COMPRESSION_NONE)
+        {
+          boost::format fmt("Tile checksums can not be recorded for compression %1%, which has no tile codec");
+          fmt % static_cast<int>(ifd.getCompression());
+          throw Exception(fmt.str());
+        }
+
+      IOStatistics::Timer timer(*statistics, IOStatistics::STAGE_ENCODE);
+      for (std::vector<tstrile_t>::size_type i = 0; i < indices.size(); ++i)
+        {
+          tstrile_t tile = indices[i];
+          const TileBuffer *pending = buffers[i];
+          void *data = const_cast<void *>(pending->data());
+          TraceScope trace(TraceObserver::TILE_ENCODE, &file, ifd.getOffset(), tile);
           if (type == TILE)
             {
-              tsize_t byteswritten = TIFFWriteEncodedTile(tiffraw, tile, tilebuf.data(), static_cast<tsize_t>(tilebuf.size()));
+              tsize_t byteswritten = TIFFWriteEncodedTile(tiffraw, tile, data, static_cast<tsize_t>(pending->size()));
               if (byteswritten < 0)
                 sentry.error("Failed to write encoded tile");
-              else if (static_cast<dimension_size_type>(byteswritten) != tilebuf.size())
+              else if (static_cast<dimension_size_type>(byteswritten) != pending->size())
                 sentry.error("Failed to write encoded tile fully");
             }
           else
             {
-              tsize_t byteswritten = TIFFWriteEncodedStrip(tiffraw, tile, tilebuf.data(), static_cast<tsize_t>(tilebuf.size()));
+              tsize_t byteswritten = TIFFWriteEncodedStrip(tiffraw, tile, data, static_cast<tsize_t>(pending->size()));
               if (byteswritten < 0)
                 sentry.error("Failed to write encoded strip");
-              else if (static_cast<dimension_size_type>(byteswritten) != tilebuf.size())
+              else if (static_cast<dimension_size_type>(byteswritten) != pending->size())
                 sentry.error("Failed to write encoded strip fully");
             }
-          tilecache.erase(tile);
-          ifd.setCurrentTile(++tile);
+          const uint64_t stored = strileByteCount(tiffraw, type, tile);
+          if (checksum)
+            tiff->addTileChecksum(tile, ::ome::files::crc32c(pending->data(),
+                                                             static_cast<std::size_t>(std::min(stored, static_cast<uint64_t>(pending->size())))));
+          statistics->add(IOStatistics::TILES_ENCODED);
+          statistics->add(IOStatistics::BYTES_WRITTEN, stored);
+          markWritten(tile);
         }
     }
 
+    // Transfer a block from the source buffer, in any storage
+    // order, to the tile to be encoded.
     template<typename T>
     void
     transfer(const std::shared_ptr<T>& buffer,
@@ -394,95 +2619,205 @@ namespace
              PlaneRegion&              rclip,
              uint16_t                  copysamples)
     {
-      if (rclip.w == rfull.w &&
-          rclip.x == region.x &&
-          rclip.w == region.w)
+      srcidx[ome::files::DIM_SPATIAL_X] = rclip.x - region.x;
+      srcidx[ome::files::DIM_SPATIAL_Y] = rclip.y - region.y;
+
+      PixelBufferView<const typename T::value_type> view(*buffer);
+      typename T::value_type *dest = reinterpret_cast<typename T::value_type *>(tilebuf.data()) +
+        ((rclip.y - rfull.y) * rfull.w * copysamples) + ((rclip.x - rfull.x) * copysamples);
+
+      assert((((rclip.y - rfull.y + rclip.h - 1U) * rfull.w) + (rclip.x - rfull.x + rclip.w)) * copysamples *
+             sizeof(typename T::value_type) <= tilebuf.size());
+      copyStrided(view.pointer(srcidx), view.strides(),
+                  dest, tileStrides(rfull, copysamples),
+                  tileShape(rclip, copysamples));
+    }
+
+    // Special case for BIT
+    void
+    transfer(const std::shared_ptr<PixelBuffer<PixelProperties<PixelType::BIT>::std_type>>& buffer,
+             PixelBuffer<PixelProperties<PixelType::BIT>::std_type>::indices_type&          srcidx,
+             TileBuffer&                                                                    tilebuf,
+             PlaneRegion&                                                                   rfull,
+             PlaneRegion&                                                                   rclip,
+             uint16_t                                                                       copysamples)
+    {
+      if (!native)
+        {
+          transferStrided(buffer, srcidx, tilebuf, rfull, rclip, copysamples);
+          return;
+        }
+
+      // Pack bits into buffer.
+
+      typedef PixelBuffer<PixelProperties<PixelType::BIT>::std_type> T;
+
+      dimension_size_type xoffset = (rclip.x - rfull.x) * copysamples;
+
+      PixelBufferView<const T::value_type> view(*buffer);
+      for (dimension_size_type row = rclip.y;
+           row != rclip.y + rclip.h;
+           ++row)
         {
-          // Transfer contiguous block since the tile spans the
-          // whole region width for both source and destination
-          // buffers.
+          const dimension_size_type full_row_width = rfull.w * copysamples;
+          dimension_size_type yoffset = (row - rfull.y) * full_row_width;
 
           srcidx[ome::files::DIM_SPATIAL_X] = rclip.x - region.x;
-          srcidx[ome::files::DIM_SPATIAL_Y] = rclip.y - region.y;
+          srcidx[ome::files::DIM_SPATIAL_Y] = row - region.y;
 
-          typename T::value_type *dest = reinterpret_cast<typename T::value_type *>(tilebuf.data());
-          const typename T::value_type *src = &buffer->at(srcidx);
+          uint8_t *dest = reinterpret_cast<uint8_t *>(tilebuf.data());
+          const T::value_type *src = view.pointer(srcidx);
 
-          assert(dest + (rclip.w * rclip.h * copysamples) <= dest + tilebuf.size());
-          std::copy(src,
-                    src + (rclip.w * rclip.h * copysamples),
-                    dest);
+          assert(((yoffset + xoffset + (rclip.w * copysamples) + 7U) / 8U) <= tilebuf.size());
+          // Bits are not cleared since the tile will only be written once.
+          packBits(src, rclip.w * copysamples, dest, yoffset + xoffset);
         }
-      else
+    }
+
+    // Transfer a block from a source buffer with a storage order
+    // differing from the encoded tile, gathering each sample using
+    // the source strides while the tile rows are filled; special
+    // case for BIT.
+    void
+    transferStrided(const std::shared_ptr<PixelBuffer<PixelProperties<PixelType::BIT>::std_type>>& buffer,
+                    PixelBuffer<PixelProperties<PixelType::BIT>::std_type>::indices_type&          srcidx,
+                    TileBuffer&                                                                    tilebuf,
+                    PlaneRegion&                                                                   rfull,
+                    PlaneRegion&                                                                   rclip,
+                    uint16_t                                                                       copysamples)
+    {
+      // Pack bits into buffer.
+
+      typedef PixelBuffer<PixelProperties<PixelType::BIT>::std_type> T;
+
+      const std::ptrdiff_t xstride = buffer->strides()[ome::files::DIM_SPATIAL_X];
+      const std::ptrdiff_t sstride = buffer->strides()[ome::files::DIM_SUBCHANNEL];
+      dimension_size_type xoffset = (rclip.x - rfull.x) * copysamples;
+
+      PixelBufferView<const T::value_type> view(*buffer);
+      for (dimension_size_type row = rclip.y;
+           row != rclip.y + rclip.h;
+           ++row)
         {
-          // Transfer discontiguous block.
+          dimension_size_type yoffset = (row - rfull.y) * (rfull.w * copysamples);
 
-          dimension_size_type xoffset = (rclip.x - rfull.x) * copysamples;
+          srcidx[ome::files::DIM_SPATIAL_X] = rclip.x - region.x;
+          srcidx[ome::files::DIM_SPATIAL_Y] = row - region.y;
 
-          for (dimension_size_type row = rclip.y;
-               row < rclip.y + rclip.h;
-               ++row)
-            {
-              dimension_size_type yoffset = (row - rfull.y) * (rfull.w * copysamples);
+          uint8_t *dest = reinterpret_cast<uint8_t *>(tilebuf.data());
+          const T::value_type *src = view.pointer(srcidx);
+
+          for (dimension_size_type x = 0; x < rclip.w; ++x)
+            for (uint16_t s = 0U; s < copysamples; ++s)
+              {
+                dimension_size_type dest_bit = yoffset + xoffset + (x * copysamples) + s;
+                uint8_t *dest_byte = dest + (dest_bit / 8);
+                const uint8_t bit_offset = 7 - (dest_bit % 8);
+
+                assert(dest_byte >= dest && dest_byte < dest + tilebuf.size());
+                // Don't clear the bit since the sample will only be written once.
+                *dest_byte |= static_cast<uint8_t>(src[(x * xstride) + (s * sstride)] << bit_offset);
+              }
+        }
+    }
+
+    // Transfer a single subchannel into a tile containing
+    // contiguous samples.
+    template<typename T>
+    void
+    transferSample(const std::shared_ptr<T>& buffer,
+                   typename T::indices_type& srcidx,
+                   TileBuffer&               tilebuf,
+                   PlaneRegion&              rfull,
+                   PlaneRegion&              rclip,
+                   uint16_t                  samples,
+                   dimension_size_type       sample)
+    {
+      const std::ptrdiff_t xstride = buffer->strides()[ome::files::DIM_SPATIAL_X];
+      typename T::value_type *dest = reinterpret_cast<typename T::value_type *>(tilebuf.data());
+
+      PixelBufferView<const typename T::value_type> view(*buffer);
+      for (dimension_size_type row = rclip.y;
+           row < rclip.y + rclip.h;
+           ++row)
+        {
+          dimension_size_type yoffset = (row - rfull.y) * (rfull.w * samples);
+          dimension_size_type xoffset = (rclip.x - rfull.x) * samples;
 
-              srcidx[ome::files::DIM_SPATIAL_X] = rclip.x - region.x;
-              srcidx[ome::files::DIM_SPATIAL_Y] = row - region.y;
+          srcidx[ome::files::DIM_SPATIAL_X] = rclip.x - region.x;
+          srcidx[ome::files::DIM_SPATIAL_Y] = row - region.y;
 
-              typename T::value_type *dest = reinterpret_cast<typename T::value_type *>(tilebuf.data());
-              const typename T::value_type *src = &buffer->at(srcidx);
+          const typename T::value_type *src = view.pointer(srcidx);
+          typename T::value_type *destrow = dest + yoffset + xoffset + sample;
 
-              assert(dest + yoffset + xoffset + (rclip.w * copysamples) <= dest + tilebuf.size());
-              std::copy(src,
-                        src + (rclip.w * copysamples),
-                        dest + yoffset + xoffset);
-            }
+          assert(destrow + ((rclip.w - 1) * samples) < dest + tilebuf.size());
+          if (native)
+            for (dimension_size_type x = 0; x < rclip.w; ++x)
+              destrow[x * samples] = src[x];
+          else
+            for (dimension_size_type x = 0; x < rclip.w; ++x)
+              destrow[x * samples] = src[x * xstride];
         }
     }
 
     // Special case for BIT
     void
-    transfer(const std::shared_ptr<PixelBuffer<PixelProperties<PixelType::BIT>::std_type>>& buffer,
-             PixelBuffer<PixelProperties<PixelType::BIT>::std_type>::indices_type&          srcidx,
-             TileBuffer&                                                                    tilebuf,
-             PlaneRegion&                                                                   rfull,
-             PlaneRegion&                                                                   rclip,
-             uint16_t                                                                       copysamples)
+    transferSample(const std::shared_ptr<PixelBuffer<PixelProperties<PixelType::BIT>::std_type>>& buffer,
+                   PixelBuffer<PixelProperties<PixelType::BIT>::std_type>::indices_type&          srcidx,
+                   TileBuffer&                                                                    tilebuf,
+                   PlaneRegion&                                                                   rfull,
+                   PlaneRegion&                                                                   rclip,
+                   uint16_t                                                                       samples,
+                   dimension_size_type                                                            sample)
     {
       // Pack bits into buffer.
 
       typedef PixelBuffer<PixelProperties<PixelType::BIT>::std_type> T;
 
-      dimension_size_type xoffset = (rclip.x - rfull.x) * copysamples;
+      const std::ptrdiff_t xstride = buffer->strides()[ome::files::DIM_SPATIAL_X];
+      dimension_size_type xoffset = (rclip.x - rfull.x) * samples;
 
+      PixelBufferView<const T::value_type> view(*buffer);
       for (dimension_size_type row = rclip.y;
            row != rclip.y + rclip.h;
            ++row)
         {
-          const dimension_size_type full_row_width = rfull.w * copysamples;
-          dimension_size_type yoffset = (row - rfull.y) * full_row_width;
+          dimension_size_type yoffset = (row - rfull.y) * (rfull.w * samples);
 
           srcidx[ome::files::DIM_SPATIAL_X] = rclip.x - region.x;
           srcidx[ome::files::DIM_SPATIAL_Y] = row - region.y;
 
           uint8_t *dest = reinterpret_cast<uint8_t *>(tilebuf.data());
-          const T::value_type *src = &buffer->at(srcidx);
+          const T::value_type *src = view.pointer(srcidx);
 
-          for (dimension_size_type sampleoffset = 0;
-               sampleoffset < (rclip.w * copysamples);
-               ++sampleoffset)
+          for (dimension_size_type x = 0; x < rclip.w; ++x)
             {
-              const T::value_type *srcsample = src + sampleoffset;
-              dimension_size_type dest_bit = yoffset + xoffset + sampleoffset;
+              dimension_size_type dest_bit = yoffset + xoffset + (x * samples) + sample;
               uint8_t *dest_byte = dest + (dest_bit / 8);
               const uint8_t bit_offset = 7 - (dest_bit % 8);
 
               assert(dest_byte >= dest && dest_byte < dest + tilebuf.size());
-              // Don't clear the bit since the tile will only be written once.
-              *dest_byte |= static_cast<uint8_t>(*srcsample << bit_offset);
+              // Don't clear the bit since the sample will only be written once.
+              *dest_byte |= static_cast<uint8_t>(src[x * xstride] << bit_offset);
             }
         }
     }
 
+    // Accumulate pixel statistics for a region of the source
+    // buffer immediately after it is transferred, while it is
+    // still in cache.
+    template<typename T>
+    void
+    accumulate(const std::shared_ptr<T>& buffer,
+               const PlaneRegion&        rclip,
+               dimension_size_type       first,
+               dimension_size_type       count)
+    {
+      if (pixelstats)
+        pixelstats->add(*buffer, rclip.x - region.x, rclip.y - region.y,
+                        rclip.w, rclip.h, first, count);
+    }
+
     template<typename T>
     void
     operator()(const std::shared_ptr<T>& buffer)
@@ -490,12 +2825,32 @@ namespace
       uint16_t samples = ifd.getSamplesPerPixel();
       PlanarConfiguration planarconfig = ifd.getPlanarConfiguration();
 
-      if (tilecoverage.size() != (planarconfig == CONTIG ? 1 : samples))
-        tilecoverage.resize(planarconfig == CONTIG ? 1 : samples);
+      if (ifd.getTIFF()->getRecordTileStatistics() && !update)
+        summarise = TileSummary<typename T::value_type>::function();
+
+      // Coverage is tracked per sample, for both planar
+      // configurations, so that samples may be written separately.
+      // Whole tiles and tile rows are tracked in the coverage tile
+      // grid.
+      if (tilecoverage.size() != samples)
+        {
+          tilecoverage.resize(samples);
+          for (auto& coverage : tilecoverage)
+            coverage.setGrid(ifd.getImageWidth(), ifd.getImageHeight(),
+                             tileinfo.tileWidth(), tileinfo.tileHeight());
+        }
+      if (written.size() < tileinfo.tileCount())
+        written.resize(tileinfo.tileCount(), false);
 
       for(const auto i : tiles)
         {
           tstrile_t tile = static_cast<tstrile_t>(i);
+
+          // Tiles are written once only; any later changes to a
+          // written tile are discarded.
+          if (written.at(tile))
+            continue;
+
           PlaneRegion rfull = tileinfo.tileRegion(tile);
           PlaneRegion rclip = tileinfo.tileRegion(tile, region);
           dimension_size_type sample = tileinfo.tileSample(tile);
@@ -508,23 +2863,38 @@ namespace
               dest_subchannel = sample;
             }
 
-          // Note boost::make_shared makes arguments const, so can't use
-          // here.
-          if (!tilecache.find(tile))
-            tilecache.insert(tile, std::shared_ptr<TileBuffer>(new TileBuffer(tileinfo.bufferSize())));
-          assert(tilecache.find(tile));
-          TileBuffer& tilebuf = *tilecache.find(tile);
+          // Buffers are recycled through the pool when flushed, so
+          // that writing does not allocate a new buffer per tile.
+          TileCache::value_type& cached(tilecache[tile]);
+          if (!cached)
+            cached = tilepool.get(tileinfo.decodedBufferSize());
+          TileBuffer& tilebuf = *cached;
 
           typename T::indices_type srcidx;
           srcidx[ome::files::DIM_SPATIAL_X] = 0;
           srcidx[ome::files::DIM_SPATIAL_Y] = 0;
-          srcidx[ome::files::DIM_SUBCHANNEL] = dest_subchannel;
+          srcidx[ome::files::DIM_SUBCHANNEL] = subchannel ? 0 : dest_subchannel;
           srcidx[ome::files::DIM_SPATIAL_Z] = srcidx[ome::files::DIM_TEMPORAL_T] =
             srcidx[ome::files::DIM_CHANNEL] = srcidx[ome::files::DIM_MODULO_Z] =
             srcidx[ome::files::DIM_MODULO_T] = srcidx[ome::files::DIM_MODULO_C] = 0;
 
-          transfer(buffer, srcidx, tilebuf, rfull, rclip, copysamples);
-          tilecoverage.at(dest_subchannel).insert(rclip);
+          IOStatistics::Timer timer(*statistics, IOStatistics::STAGE_TRANSFER);
+          if (subchannel && planarconfig == CONTIG && samples > 1)
+            {
+              transferSample(buffer, srcidx, tilebuf, rfull, rclip, samples, *subchannel);
+              accumulate(buffer, rclip, 0U, 1U);
+              tilecoverage.at(*subchannel).insert(rclip);
+            }
+          else
+            {
+              transfer(buffer, srcidx, tilebuf, rfull, rclip, copysamples);
+              accumulate(buffer, rclip, subchannel ? 0U : dest_subchannel, copysamples);
+              if (planarconfig == SEPARATE)
+                tilecoverage.at(dest_subchannel).insert(rclip);
+              else
+                for (auto& coverage : tilecoverage)
+                  coverage.insert(rclip);
+            }
         }
 
       // Flush covered tiles
@@ -564,6 +2934,92 @@ namespace ome
           }
         };
 
+        // The storage order of the decoded tiles of the IFD, which
+        // the transfer kernels write without rearranging samples.
+        //
+        // If single is set, the order is that of a single
+        // subchannel, as for detail::CopySubchannelVisitor.
+        PixelBufferBase::storage_order_type
+        nativeStorageOrder(const IFD& ifd,
+                           bool       single = false)
+        {
+          PlanarConfiguration planarconfig = ifd.getPlanarConfiguration();
+          return PixelBufferBase::make_storage_order(ome::xml::model::enums::DimensionOrder::XYZTC, (single || planarconfig == SEPARATE) ? false : true);
+        }
+
+        // Check if a destination pixel buffer prepared for the IFD
+        // has the memory layout of the decoded tiles, so that rows
+        // may be copied or decoded directly.  Only the spatial and
+        // subchannel strides matter since all other dimensions have
+        // a size of one.
+        bool
+        nativeLayout(const IFD&                ifd,
+                     const VariantPixelBuffer& dest)
+        {
+          const boost::multi_array_types::index *strides(dest.strides());
+          const VariantPixelBuffer::size_type *shape(dest.shape());
+          bool separate = ifd.getPlanarConfiguration() == SEPARATE;
+          boost::multi_array_types::index samples = static_cast<boost::multi_array_types::index>(shape[DIM_SUBCHANNEL]);
+          boost::multi_array_types::index xstride = separate ? 1 : samples;
+
+          return (strides[DIM_SPATIAL_X] == xstride &&
+                  (shape[DIM_SPATIAL_Y] == 1U ||
+                   strides[DIM_SPATIAL_Y] == xstride * static_cast<boost::multi_array_types::index>(shape[DIM_SPATIAL_X])) &&
+                  (samples == 1 ||
+                   strides[DIM_SUBCHANNEL] == (separate ? static_cast<boost::multi_array_types::index>(shape[DIM_SPATIAL_X] * shape[DIM_SPATIAL_Y]) : 1)));
+        }
+
+        // Resize a destination pixel buffer to hold a region of the
+        // specified size, if it is not of the correct size, pixel
+        // type and storage order.
+        //
+        // If single is set, the buffer will hold a single
+        // subchannel.
+        void
+        prepareBuffer(const IFD&                                 ifd,
+                      VariantPixelBuffer&                        dest,
+                      dimension_size_type                        w,
+                      dimension_size_type                        h,
+                      const PixelBufferBase::storage_order_type& order,
+                      bool                                       single = false)
+        {
+          PixelType type = ifd.getPixelType();
+          uint16_t subC = single ? 1U : ifd.getSamplesPerPixel();
+
+          std::array<VariantPixelBuffer::size_type, 9> shape, dest_shape;
+          shape[DIM_SPATIAL_X] = w;
+          shape[DIM_SPATIAL_Y] = h;
+          shape[DIM_SUBCHANNEL] = subC;
+          shape[DIM_SPATIAL_Z] = shape[DIM_TEMPORAL_T] = shape[DIM_CHANNEL] =
+            shape[DIM_MODULO_Z] = shape[DIM_MODULO_T] = shape[DIM_MODULO_C] = 1;
+
+          const VariantPixelBuffer::size_type *dest_shape_ptr(dest.shape());
+          std::copy(dest_shape_ptr, dest_shape_ptr + PixelBufferBase::dimensions,
+                    dest_shape.begin());
+
+          if (type != dest.pixelType() ||
+              shape != dest_shape ||
+              !(order == dest.storage_order()))
+            dest.setBuffer(shape, type, order, PIXEL_UNINITIALIZED);
+        }
+
+        // Resize a destination pixel buffer to hold a region of the
+        // specified size, if it is not of the correct size, pixel
+        // type and storage order for the IFD.
+        //
+        // If single is set, the buffer will hold a single
+        // subchannel, using the same storage order as
+        // detail::CopySubchannelVisitor.
+        void
+        prepareBuffer(const IFD&          ifd,
+                      VariantPixelBuffer& dest,
+                      dimension_size_type w,
+                      dimension_size_type h,
+                      bool                single = false)
+        {
+          prepareBuffer(ifd, dest, w, h, nativeStorageOrder(ifd, single), single);
+        }
+
       }
 
       /**
@@ -580,6 +3036,10 @@ namespace ome
         std::vector<TileCoverage> coverage;
         /// Tile cache (used when writing).
         TileCache tilecache;
+        /// Tile buffer pool (used when writing).
+        TileBufferPool tilepool;
+        /// Tiles already written (used when writing).
+        std::vector<bool> written;
         /// Tile type.
         boost::optional<TileType> tiletype;
         /// Image width.
@@ -602,7 +3062,25 @@ namespace ome
         boost::optional<PhotometricInterpretation> photometric;
         /// Compression scheme.
         boost::optional<Compression> compression;
-        /// Current tile (for writing).
+        /// Compression level (-1 for the codec default).
+        int compressionlevel;
+        /// Predictor.
+        Predictor predictor;
+        /// Tile information (cached in read-only mode).
+        boost::optional<TileInfo> tileinfo;
+        /// Lookup table (cached in read-only mode).
+        std::shared_ptr<const VariantPixelBuffer> lookuptable;
+        /// Tile statistics (cached in read-only mode).
+        std::shared_ptr<const std::vector<TileStatistics>> tilestatistics;
+        /// Tile checksums (cached in read-only mode).
+        std::shared_ptr<const std::vector<uint32_t>> tilechecksums;
+        /// Raw tile data reader (cached in read-only mode).
+        std::shared_ptr<const StrileReader> striles;
+        /// Offset of contiguous uncompressed image data, or zero if not contiguous.
+        boost::optional<uint64_t> contiguous;
+        /// Contiguous image data needs byte swapping.
+        bool swapped;
+        /// First tile not yet written (for writing).
         tstrile_t ctile;
 
         /**
@@ -617,6 +3095,8 @@ namespace ome
           offset(offset),
           coverage(),
           tilecache(),
+          tilepool(),
+          written(),
           imagewidth(),
           imageheight(),
           tilewidth(),
@@ -624,6 +3104,15 @@ namespace ome
           pixeltype(),
           samples(),
           planarconfig(),
+          compressionlevel(-1),
+          predictor(NONE),
+          tileinfo(),
+          lookuptable(),
+          tilestatistics(),
+          tilechecksums(),
+          striles(),
+          contiguous(),
+          swapped(false),
           ctile(0)
         {
         }
@@ -666,7 +3155,7 @@ namespace ome
       {
         ::TIFF *tiffraw = reinterpret_cast<::TIFF *>(tiff->getWrapped());
 
-        Sentry sentry;
+        Sentry sentry(*tiff);
 
         if (!TIFFSetDirectory(tiffraw, index))
           sentry.error();
@@ -682,7 +3171,95 @@ namespace ome
       {
         // Note boost::make_shared makes arguments const, so can't use
         // here.
-        return std::shared_ptr<IFD>(new IFDConcrete(tiff, offset));
+        std::shared_ptr<IFD> ifd(new IFDConcrete(tiff, offset));
+
+        ::TIFF *tiffraw = reinterpret_cast<::TIFF *>(tiff->getWrapped());
+        bool readonly;
+        {
+          Sentry sentry(*tiff);
+          readonly = TIFFGetMode(tiffraw) == O_RDONLY;
+        }
+        if (readonly)
+          ifd->loadCoreTags();
+
+        return ifd;
+      }
+
+      void
+      IFD::loadCoreTags()
+      {
+        Sentry sentry(*getTIFF());
+
+        // Each tag is cached on first access by its accessor.  Tags
+        // which are missing or invalid are left uncached, so that
+        // the accessor will throw when used, as before.
+        try
+          {
+            getImageWidth();
+            getImageHeight();
+          }
+        catch (const Exception&)
+          {
+          }
+
+        try
+          {
+            impl->tileinfo = getTileInfo();
+          }
+        catch (const Exception&)
+          {
+          }
+
+        try
+          {
+            getPixelType();
+          }
+        catch (const Exception&)
+          {
+          }
+
+        try
+          {
+            getPhotometricInterpretation();
+          }
+        catch (const Exception&)
+          {
+          }
+
+        try
+          {
+            getCompression();
+          }
+        catch (const Exception&)
+          {
+          }
+
+        // Also used by readImage(), so cache to avoid concurrent
+        // readers racing to cache them.
+        try
+          {
+            getSamplesPerPixel();
+          }
+        catch (const Exception&)
+          {
+          }
+
+        try
+          {
+            getPlanarConfiguration();
+          }
+        catch (const Exception&)
+          {
+          }
+
+        // Used by readImage() to read uncompressed data directly.
+        try
+          {
+            impl->contiguous = findContiguousData(*this, impl->swapped);
+          }
+        catch (const Exception&)
+          {
+          }
       }
 
       std::shared_ptr<IFD>
@@ -699,13 +3276,19 @@ namespace ome
         std::shared_ptr<TIFF>& tiff = getTIFF();
         ::TIFF *tiffraw = reinterpret_cast<::TIFF *>(tiff->getWrapped());
 
-        Sentry sentry;
+        static LockSite site("tiff::IFD::makeCurrent");
+        Sentry sentry(*tiff, site);
 
         if (static_cast<offset_type>(TIFFCurrentDirOffset(tiffraw)) != impl->offset)
           {
+            IOStatistics& statistics(*tiff->getStatistics());
+            statistics.add(IOStatistics::DIRECTORY_SWITCHES);
+            IOStatistics::Timer timer(statistics, IOStatistics::STAGE_DIRECTORY);
+            TraceScope trace(TraceObserver::DIRECTORY_READ, &tiff->getFilename(), impl->offset);
             if (!TIFFSetSubDirectory(tiffraw, impl->offset))
               sentry.error();
           }
+        setJPEGColorMode(tiffraw);
       }
 
       std::shared_ptr<TIFF>&
@@ -727,7 +3310,8 @@ namespace ome
         std::shared_ptr<TIFF>& tiff = getTIFF();
         ::TIFF *tiffraw = reinterpret_cast<::TIFF *>(tiff->getWrapped());
 
-        Sentry sentry;
+        static LockSite site("tiff::IFD::getField");
+        Sentry sentry(*tiff, site);
 
         makeCurrent();
 
@@ -756,7 +3340,8 @@ namespace ome
         std::shared_ptr<TIFF>& tiff = getTIFF();
         ::TIFF *tiffraw = reinterpret_cast<::TIFF *>(tiff->getWrapped());
 
-        Sentry sentry;
+        static LockSite site("tiff::IFD::getFieldDefaulted");
+        Sentry sentry(*tiff, site);
 
         makeCurrent();
 
@@ -778,6 +3363,62 @@ namespace ome
           }
       }
 
+      bool
+      IFD::hasRawField(tag_type tag) const
+      {
+        if (!tag)
+          return false;
+
+        std::shared_ptr<TIFF>& tiff = getTIFF();
+        ::TIFF *tiffraw = reinterpret_cast<::TIFF *>(tiff->getWrapped());
+
+        static LockSite site("tiff::IFD::hasField");
+        Sentry sentry(*tiff, site);
+
+        makeCurrent();
+
+        // libtiff has no public query for whether a tag is set, so
+        // get the field into scratch storage.  The arguments are not
+        // used for an unset tag; for a set tag, each receives at most
+        // a single value or pointer, and no tag takes more than six.
+        std::array<uint64_t, 6> scratch;
+        return TIFFGetField(tiffraw, tag,
+                            &scratch[0], &scratch[1], &scratch[2],
+                            &scratch[3], &scratch[4], &scratch[5]) != 0;
+      }
+
+      bool
+      IFD::visitField(StringTag1               tag,
+                      const text_visitor_type& visitor) const
+      {
+        std::shared_ptr<TIFF>& tiff = getTIFF();
+
+        // Held until the visitor returns, so that the directory, and
+        // hence the text, remain current.
+        static LockSite site("tiff::IFD::visitField");
+        Sentry sentry(*tiff, site);
+
+        const Field<StringTag1> field(getField(tag));
+        if (!field.isSet())
+          return false;
+
+        const int rc = field.readCount();
+        if (rc == TIFF_VARIABLE || rc == TIFF_VARIABLE2)
+          {
+            char *text = nullptr;
+            getRawField(field.tagNumber(), &text);
+            visitor(text, text ? std::strlen(text) : 0U);
+          }
+        else
+          {
+            // Fixed-size fields are small, so copy.
+            std::string text;
+            field.get(text);
+            visitor(text.data(), text.size());
+          }
+        return true;
+      }
+
       void
       IFD::setRawField(tag_type tag,
                        ...)
@@ -785,7 +3426,8 @@ namespace ome
         std::shared_ptr<TIFF>& tiff = getTIFF();
         ::TIFF *tiffraw = reinterpret_cast<::TIFF *>(tiff->getWrapped());
 
-        Sentry sentry;
+        static LockSite site("tiff::IFD::setField");
+        Sentry sentry(*tiff, site);
 
         makeCurrent();
 
@@ -808,15 +3450,11 @@ namespace ome
       {
         if (!impl->tiletype)
           {
-            uint32_t w, h;
-            try
-              {
-                getField(TILEWIDTH).get(w);
-                getField(TILELENGTH).get(h);
-                impl->tiletype = TILE;
-              }
-            catch (const Exception&)
+            if (hasField(TILEWIDTH) && hasField(TILELENGTH))
+              impl->tiletype = TILE;
+            else
               {
+                uint32_t h;
                 getField(ROWSPERSTRIP).get(h);
                 impl->tiletype = STRIP;
               }
@@ -846,12 +3484,16 @@ namespace ome
       TileInfo
       IFD::getTileInfo()
       {
+        if (impl->tileinfo)
+          return impl->tileinfo.get();
         return TileInfo(this->shared_from_this());
       }
 
       const TileInfo
       IFD::getTileInfo() const
       {
+        if (impl->tileinfo)
+          return impl->tileinfo.get();
         return TileInfo(const_cast<IFD *>(this)->shared_from_this());
       }
 
@@ -1005,7 +3647,7 @@ namespace ome
                     pt = PixelType::BIT;
                   else if (bits == 8)
                     pt = PixelType::UINT8;
-                  else if (bits == 16)
+                  else if (bits == 16 || isPackedSampleDepth(bits))
                     pt = PixelType::UINT16;
                   else if (bits == 32)
                     pt = PixelType::UINT32;
@@ -1035,7 +3677,8 @@ namespace ome
                 break;
               case FLOAT:
                 {
-                  if (bits == 32)
+                  // Half precision samples are converted to FLOAT.
+                  if (bits == 16 || bits == 32)
                     pt = PixelType::FLOAT;
                   else if (bits == 64)
                     pt = PixelType::DOUBLE;
@@ -1069,6 +3712,7 @@ namespace ome
                 }
                 break;
               }
+            impl->pixeltype = pt;
           }
         return pt;
       }
@@ -1076,43 +3720,7 @@ namespace ome
       void
       IFD::setPixelType(::ome::xml::model::enums::PixelType type)
       {
-        SampleFormat fmt = UNSIGNED_INT;
-
-        switch(type)
-          {
-          case PixelType::BIT:
-          case PixelType::UINT8:
-          case PixelType::UINT16:
-          case PixelType::UINT32:
-            fmt = UNSIGNED_INT;
-            break;
-
-          case PixelType::INT8:
-          case PixelType::INT16:
-          case PixelType::INT32:
-            fmt = SIGNED_INT;
-            break;
-
-          case PixelType::FLOAT:
-          case PixelType::DOUBLE:
-            fmt = FLOAT;
-            break;
-
-          case PixelType::COMPLEXFLOAT:
-          case PixelType::COMPLEXDOUBLE:
-            fmt = COMPLEX_FLOAT;
-            break;
-
-          default:
-            {
-              boost::format fmt("Unsupported OME data model PixelType %1%");
-              fmt % type;
-              throw Exception(fmt.str());
-            }
-            break;
-          }
-
-        getField(SAMPLEFORMAT).set(fmt);
+        getField(SAMPLEFORMAT).set(pixelTypeSampleFormat(type));
         impl->pixeltype = type;
       }
 
@@ -1194,6 +3802,8 @@ namespace ome
       {
         getField(PHOTOMETRIC).set(photometric);
         impl->photometric = photometric;
+        // Update the JPEG colour mode.
+        makeCurrent();
       }
 
       Compression
@@ -1213,6 +3823,149 @@ namespace ome
       {
         getField(COMPRESSION).set(compression);
         impl->compression = compression;
+        impl->compressionlevel = -1;
+        // Update the JPEG colour mode.
+        makeCurrent();
+      }
+
+      int
+      IFD::getCompressionLevel() const
+      {
+        return impl->compressionlevel;
+      }
+
+      void
+      IFD::setCompressionLevel(int level)
+      {
+        Compression compression = getCompression();
+        int minimum, maximum;
+        if (!getCodecLevelRange(compression, minimum, maximum))
+          {
+            boost::format fmt("Compression scheme %1% does not support setting the compression level");
+            fmt % compression;
+            throw Exception(fmt.str());
+          }
+        if (level < minimum || level > maximum)
+          {
+            boost::format fmt("Compression level %1% invalid for compression scheme %2%: valid levels are %3%–%4%");
+            fmt % level % compression % minimum % maximum;
+            throw Exception(fmt.str());
+          }
+
+        setRawField(getCodecLevelTag(compression), level);
+        impl->compressionlevel = level;
+      }
+
+      void
+      IFD::setPredictor(Predictor predictor)
+      {
+        if (predictor != NONE)
+          {
+            Compression compression = getCompression();
+            if (!codecSupportsPredictor(compression))
+              {
+                boost::format fmt("Compression scheme %1% does not support a predictor");
+                fmt % compression;
+                throw Exception(fmt.str());
+              }
+
+            PixelType pixeltype = getPixelType();
+            if (getPixelTypePredictor(pixeltype) != predictor &&
+                !(predictor == HORIZONTAL && getPixelTypePredictor(pixeltype) == FLOATING_POINT))
+              {
+                boost::format fmt("Predictor %1% invalid for pixel type %2%");
+                fmt % predictor % pixeltype;
+                throw Exception(fmt.str());
+              }
+          }
+
+        getField(PREDICTOR).set(predictor);
+        impl->predictor = predictor;
+      }
+
+      IFDTemplate
+      IFD::getTemplate() const
+      {
+        IFDTemplate tmpl;
+        tmpl.imageWidth = getImageWidth();
+        tmpl.imageHeight = getImageHeight();
+        tmpl.tileType = getTileType();
+        tmpl.tileWidth = getTileWidth();
+        tmpl.tileHeight = getTileHeight();
+        tmpl.pixelType = getPixelType();
+        tmpl.bitsPerSample = getBitsPerSample();
+        tmpl.samplesPerPixel = getSamplesPerPixel();
+        tmpl.planarConfiguration = getPlanarConfiguration();
+        tmpl.photometricInterpretation = getPhotometricInterpretation();
+        tmpl.ycbcrSubsampling = {{1U, 1U}};
+        if (tmpl.photometricInterpretation == YCBCR)
+          getField(YCBCRSUBSAMPLING).get(tmpl.ycbcrSubsampling);
+        tmpl.compression = getCompression();
+        tmpl.compressionLevel = getCompressionLevel();
+        tmpl.predictor = impl->predictor;
+        return tmpl;
+      }
+
+      void
+      IFD::applyTemplate(const IFDTemplate& tmpl)
+      {
+        std::shared_ptr<TIFF>& tiff = getTIFF();
+        ::TIFF *tiffraw = reinterpret_cast<::TIFF *>(tiff->getWrapped());
+
+        Sentry sentry(*tiff, applyTemplateSite);
+
+        makeCurrent();
+
+        // Tags are set in the same order as the individual setters
+        // would be used, since the compression scheme must be set
+        // before its level and predictor.
+        if (!TIFFSetField(tiffraw, TIFFTAG_IMAGEWIDTH, tmpl.imageWidth) ||
+            !TIFFSetField(tiffraw, TIFFTAG_IMAGELENGTH, tmpl.imageHeight))
+          sentry.error();
+        if (tmpl.tileType == TILE)
+          {
+            if (!TIFFSetField(tiffraw, TIFFTAG_TILEWIDTH, tmpl.tileWidth) ||
+                !TIFFSetField(tiffraw, TIFFTAG_TILELENGTH, tmpl.tileHeight))
+              sentry.error();
+          }
+        else if (!TIFFSetField(tiffraw, TIFFTAG_ROWSPERSTRIP, tmpl.tileHeight))
+          sentry.error();
+        if (!TIFFSetField(tiffraw, TIFFTAG_SAMPLEFORMAT, static_cast<int>(pixelTypeSampleFormat(tmpl.pixelType))) ||
+            !TIFFSetField(tiffraw, TIFFTAG_BITSPERSAMPLE, static_cast<int>(tmpl.bitsPerSample)) ||
+            !TIFFSetField(tiffraw, TIFFTAG_SAMPLESPERPIXEL, static_cast<int>(tmpl.samplesPerPixel)) ||
+            !TIFFSetField(tiffraw, TIFFTAG_PLANARCONFIG, static_cast<int>(tmpl.planarConfiguration)) ||
+            !TIFFSetField(tiffraw, TIFFTAG_PHOTOMETRIC, static_cast<int>(tmpl.photometricInterpretation)) ||
+            !TIFFSetField(tiffraw, TIFFTAG_COMPRESSION, static_cast<int>(tmpl.compression)))
+          sentry.error();
+        if (tmpl.photometricInterpretation == YCBCR &&
+            !TIFFSetField(tiffraw, TIFFTAG_YCBCRSUBSAMPLING,
+                          static_cast<int>(tmpl.ycbcrSubsampling[0]),
+                          static_cast<int>(tmpl.ycbcrSubsampling[1])))
+          sentry.error();
+        if (tmpl.compressionLevel != -1 &&
+            !TIFFSetField(tiffraw, getCodecLevelTag(tmpl.compression), tmpl.compressionLevel))
+          sentry.error();
+        setJPEGColorMode(tiffraw);
+        if (tmpl.predictor != NONE &&
+            !TIFFSetField(tiffraw, TIFFTAG_PREDICTOR, static_cast<int>(tmpl.predictor)))
+          sentry.error();
+
+        impl->tiletype = tmpl.tileType;
+        impl->imagewidth = tmpl.imageWidth;
+        impl->imageheight = tmpl.imageHeight;
+        if (tmpl.tileType == TILE)
+          impl->tilewidth = tmpl.tileWidth;
+        else
+          impl->tilewidth = boost::none;
+        impl->tileheight = tmpl.tileHeight;
+        impl->pixeltype = tmpl.pixelType;
+        impl->bits = tmpl.bitsPerSample;
+        impl->samples = tmpl.samplesPerPixel;
+        impl->planarconfig = tmpl.planarConfiguration;
+        impl->photometric = tmpl.photometricInterpretation;
+        impl->compression = tmpl.compression;
+        impl->compressionlevel = tmpl.compressionLevel;
+        impl->predictor = tmpl.predictor;
       }
 
       void
@@ -1228,6 +3981,22 @@ namespace ome
         readImage(buf, 0, 0, getImageWidth(), getImageHeight(), subC);
       }
 
+      uint64_t
+      IFD::contiguousDataOffset(const PlaneRegion& region) const
+      {
+        if (!region.w || !region.h ||
+            region.x + region.w > getImageWidth() ||
+            region.y + region.h > getImageHeight())
+          return 0U;
+
+        if (!impl->contiguous)
+          {
+            Sentry sentry(*getTIFF(), readImageSite);
+            impl->contiguous = findContiguousData(*this, impl->swapped);
+          }
+        return impl->contiguous.get();
+      }
+
       void
       IFD::readImage(VariantPixelBuffer& dest,
                      dimension_size_type x,
@@ -1235,14 +4004,404 @@ namespace ome
                      dimension_size_type w,
                      dimension_size_type h) const
       {
-        PixelType type = getPixelType();
-        PlanarConfiguration planarconfig = getPlanarConfiguration();
-        uint16_t subC = getSamplesPerPixel();
+        readImage(dest, x, y, w, h, nativeStorageOrder(*this));
+      }
+
+      void
+      IFD::readImage(VariantPixelBuffer&                        dest,
+                     dimension_size_type                        x,
+                     dimension_size_type                        y,
+                     dimension_size_type                        w,
+                     dimension_size_type                        h,
+                     const PixelBufferBase::storage_order_type& order) const
+      {
+        readRegion(dest, PlaneRegion(x, y, w, h), order, nullptr);
+      }
+
+      void
+      IFD::readImage(VariantPixelBuffer& dest,
+                     dimension_size_type x,
+                     dimension_size_type y,
+                     dimension_size_type w,
+                     dimension_size_type h,
+                     PixelStatistics&    stats) const
+      {
+        readRegion(dest, PlaneRegion(x, y, w, h), nativeStorageOrder(*this), &stats);
+      }
+
+      void
+      IFD::readRegion(VariantPixelBuffer&                        dest,
+                      const PlaneRegion&                         region,
+                      const PixelBufferBase::storage_order_type& order,
+                      PixelStatistics                           *stats) const
+      {
+        prepareBuffer(*this, dest, region.w, region.h, order);
+
+        // Samples must be rearranged unless the buffer layout
+        // matches the stored data.
+        bool native = nativeLayout(*this, dest);
+        // Device memory is filled by a device tile codec.
+        bool device = !hostAccessible(dest);
+
+        uint64_t offset = native && !device ? contiguousDataOffset(region) : 0U;
+        if (offset)
+          {
+            // Read in a single block, so accumulated afterwards.
+            readContiguous(*this, offset, impl->swapped, dest, region);
+            if (stats)
+              stats->add(dest);
+            return;
+          }
+
+        TileInfo info = getTileInfo();
+
+        const TileRange tiles(info.tileRange(region));
+
+        prefetchTiles(*this, info.tileType(), tiles);
+
+        ReadVisitor v(*this, info, region, tiles);
+        v.native = native;
+        v.device = device;
+        v.pixelstats = stats;
+        boost::apply_visitor(v, dest.vbuffer());
+      }
+
+      void
+      IFD::adviseAccess(AccessHint          hint,
+                        dimension_size_type x,
+                        dimension_size_type y,
+                        dimension_size_type w,
+                        dimension_size_type h) const
+      {
+        PlaneRegion region(x, y, w, h);
+        TileInfo info = getTileInfo();
+        const TileRange tiles(info.tileRange(region));
+
+        std::vector<IOSource::range_type> ranges(strileRanges(*this, info.tileType(), tiles));
+        ranges.erase(std::remove_if(ranges.begin(), ranges.end(),
+                                    [](const IOSource::range_type& range)
+                                    { return range.second == 0U; }),
+                     ranges.end());
+
+        // An empty range list would apply to the whole file.
+        if (hint == HINT_WILLNEED && ranges.empty())
+          return;
+
+        getTIFF()->adviseAccess(hint, ranges);
+      }
+
+      void
+      IFD::readImage(VariantPixelBuffer& dest,
+                     dimension_size_type x,
+                     dimension_size_type y,
+                     dimension_size_type w,
+                     dimension_size_type h,
+                     dimension_size_type subC) const
+      {
+        uint16_t samples = getSamplesPerPixel();
+        if (subC >= samples)
+          {
+            boost::format fmt("Subchannel %1% invalid for TIFF image with %2% samples");
+            fmt % subC % samples;
+            throw Exception(fmt.str());
+          }
+
+        prepareBuffer(*this, dest, w, h, true);
+
+        PlaneRegion region(x, y, w, h);
+
+        // Samples are not stored separately for contiguous samples.
+        bool device = !hostAccessible(dest);
+        uint64_t offset = (getPlanarConfiguration() == SEPARATE || samples == 1U) && !device ?
+          contiguousDataOffset(region) : 0U;
+        if (offset)
+          {
+            readContiguous(*this, offset, impl->swapped, dest, region, subC);
+            return;
+          }
+
+        TileInfo info = getTileInfo();
+        // Separate planes only need the tiles for this sample.
+        const TileRange tiles(info.tileRange(region, subC));
+
+        prefetchTiles(*this, info.tileType(), tiles);
+
+        // Transfer the desired subchannel into the destination
+        // buffer, without a temporary buffer for all subchannels.
+        ReadVisitor v(*this, info, region, tiles, subC);
+        v.device = device;
+        boost::apply_visitor(v, dest.vbuffer());
+      }
+
+      bool
+      IFD::supportsReducedRead(dimension_size_type scale) const
+      {
+#ifdef OME_HAVE_LIBJPEG
+        if (scale != 2U && scale != 4U && scale != 8U)
+          return false;
+        if (getCompression() != COMPRESSION_JPEG ||
+            getPixelType() != PixelType::UINT8 ||
+            getBitsPerSample() != 8U)
+          return false;
+
+        uint16_t samples = getSamplesPerPixel();
+        PhotometricInterpretation photometric = getPhotometricInterpretation();
+        return ((samples == 1U && photometric == MIN_IS_BLACK) ||
+                (samples == 3U && photometric == RGB) ||
+                (samples == 3U && photometric == YCBCR &&
+                 getPlanarConfiguration() == CONTIG));
+#else // ! OME_HAVE_LIBJPEG
+        static_cast<void>(scale);
+        return false;
+#endif // OME_HAVE_LIBJPEG
+      }
+
+      void
+      IFD::readImageReduced(VariantPixelBuffer& dest,
+                            dimension_size_type x,
+                            dimension_size_type y,
+                            dimension_size_type w,
+                            dimension_size_type h,
+                            dimension_size_type scale) const
+      {
+        if (!supportsReducedRead(scale))
+          {
+            boost::format fmt("Reading at 1/%1% scale is not supported for directory at offset %2%");
+            fmt % scale % getOffset();
+            throw Exception(fmt.str());
+          }
+
+        const dimension_size_type width = getImageWidth();
+        const dimension_size_type height = getImageHeight();
+        if (!w || !h || x > width || w > width - x || y > height || h > height - y ||
+            x % scale || y % scale)
+          {
+            boost::format fmt("Invalid region %1%x%2% at %3%,%4% for image size %5%x%6% at 1/%7% scale");
+            fmt % w % h % x % y % width % height % scale;
+            throw Exception(fmt.str());
+          }
+
+#ifdef OME_HAVE_LIBJPEG
+        const dimension_size_type scaledx = x / scale;
+        const dimension_size_type scaledy = y / scale;
+        const dimension_size_type scaledw = (w + scale - 1U) / scale;
+        const dimension_size_type scaledh = (h + scale - 1U) / scale;
+        prepareBuffer(*this, dest, scaledw, scaledh);
+
+        std::shared_ptr<TIFF>& tiff = getTIFF();
+        ::TIFF *tiffraw = reinterpret_cast<::TIFF *>(tiff->getWrapped());
+        IOStatistics& statistics(*tiff->getStatistics());
+        const boost::filesystem::path& file(tiff->getFilename());
+
+        const bool separate = getPlanarConfiguration() == SEPARATE;
+        const bool ycbcr = getPhotometricInterpretation() == YCBCR;
+        const dimension_size_type components = separate ? 1U : getSamplesPerPixel();
+
+        PlaneRegion region(x, y, w, h);
+        TileInfo info = getTileInfo();
+        TileType type = info.tileType();
+        const TileRange tiles(info.tileRange(region));
+
+        prefetchTiles(*this, type, tiles);
+
+        // Read without locking if possible.
+        std::shared_ptr<const StrileReader> striles(getStrileReader());
+        if (striles && striles->getTileType() != type)
+          striles.reset();
+
+        std::vector<char> tables;
+        if (striles)
+          tables = striles->getJPEGTables();
+        else
+          {
+            Sentry sentry(*tiff, readImageSite);
+            makeCurrent();
+
+            uint32_t tablesize = 0U;
+            void *tablesdata = nullptr;
+            if (TIFFGetField(tiffraw, TIFFTAG_JPEGTABLES, &tablesize, &tablesdata) &&
+                tablesdata && tablesize)
+              tables.assign(static_cast<const char *>(tablesdata),
+                            static_cast<const char *>(tablesdata) + tablesize);
+          }
+
+        std::shared_ptr<const std::vector<uint32_t>> checksums;
+        if (tiff->getVerifyTileChecksums())
+          checksums = getTileChecksums();
+
+        typedef PixelBuffer<PixelProperties<PixelType::UINT8>::std_type> buffer_type;
+        PixelBufferView<buffer_type::value_type> view(*boost::get<std::shared_ptr<buffer_type>>(dest.vbuffer()));
+        buffer_type::indices_type destidx;
+        std::fill(destidx.begin(), destidx.end(), 0);
+
+        std::vector<char> raw;
+        std::vector<uint8_t> decoded;
+        JPEGErrorManager err;
+        for (const auto tile : tiles)
+          {
+            PlaneRegion rfull = info.tileRegion(tile);
+            PlaneRegion rclip = info.tileRegion(tile, region);
+
+            // JPEG tiles and strips are whole numbers of 8×8 blocks,
+            // so the scaled tiles abut exactly.
+            if (rfull.x % scale || rfull.y % scale)
+              {
+                boost::format fmt("Tile %1% of directory at offset %2% is not aligned for reading at 1/%3% scale");
+                fmt % tile % getOffset() % scale;
+                throw Exception(fmt.str());
+              }
+
+            // The part of the scaled region within this tile.
+            const dimension_size_type sx0 = rclip.x / scale;
+            const dimension_size_type sy0 = rclip.y / scale;
+            const dimension_size_type sx1 = (rclip.x + rclip.w + scale - 1U) / scale;
+            const dimension_size_type sy1 = (rclip.y + rclip.h + scale - 1U) / scale;
+            const std::size_t rowbytes = static_cast<std::size_t>((sx1 - sx0) * components);
+
+            destidx[ome::files::DIM_SPATIAL_X] = sx0 - scaledx;
+            destidx[ome::files::DIM_SUBCHANNEL] = separate ? info.tileSample(tile) : 0U;
+
+            bool sparse = false;
+            {
+              IOStatistics::Timer timer(statistics, IOStatistics::STAGE_READ);
+              TraceScope trace(TraceObserver::TILE_READ, &file, getOffset(), tile);
+              if (striles)
+                {
+                  if (striles->getRange(tile).second)
+                    striles->read(tile, raw);
+                  else
+                    sparse = true;
+                }
+              else
+                {
+                  Sentry sentry(*tiff, readImageSite);
+                  makeCurrent();
+
+                  uint64_t size = strileByteCount(tiffraw, type, static_cast<tstrile_t>(tile));
+                  if (size)
+                    {
+                      raw.resize(static_cast<std::size_t>(size));
+                      tmsize_t bytesread = type == TILE ?
+                        TIFFReadRawTile(tiffraw, static_cast<uint32_t>(tile), raw.data(), static_cast<tmsize_t>(raw.size())) :
+                        TIFFReadRawStrip(tiffraw, static_cast<uint32_t>(tile), raw.data(), static_cast<tmsize_t>(raw.size()));
+                      if (bytesread < 0)
+                        sentry.error(type == TILE ? "Failed to read raw tile" : "Failed to read raw strip");
+                      raw.resize(static_cast<std::size_t>(bytesread));
+                    }
+                  else
+                    sparse = true;
+                }
+            }
+
+            if (sparse)
+              {
+                statistics.add(IOStatistics::SPARSE_TILES);
+                for (dimension_size_type row = sy0; row < sy1; ++row)
+                  {
+                    destidx[ome::files::DIM_SPATIAL_Y] = row - scaledy;
+                    std::memset(view.pointer(destidx), 0, rowbytes);
+                  }
+                continue;
+              }
+
+            statistics.add(IOStatistics::BYTES_READ, raw.size());
+            if (checksums)
+              verifyTileChecksum(*checksums, *this, static_cast<tstrile_t>(tile),
+                                 raw.data(), raw.size(), statistics);
+            if (!tables.empty())
+              mergeJPEGTables(tables, raw);
+
+            dimension_size_type decodedw = 0U;
+            dimension_size_type decodedh = 0U;
+            dimension_size_type decodedc = 0U;
+            {
+              IOStatistics::Timer timer(statistics, IOStatistics::STAGE_DECODE);
+              TraceScope trace(TraceObserver::TILE_DECODE, &file, getOffset(), tile);
+              const char *message = decodeJPEGScaled(raw, static_cast<unsigned int>(scale), ycbcr, err,
+                                                     decoded, decodedw, decodedh, decodedc);
+              if (message)
+                {
+                  boost::format fmt("Failed to decode tile %1% of directory at offset %2% at 1/%3% scale: %4%");
+                  fmt % tile % getOffset() % scale % message;
+                  throw Exception(fmt.str());
+                }
+            }
+            statistics.add(IOStatistics::TILES_DECODED);
+
+            const dimension_size_type tilex = rfull.x / scale;
+            const dimension_size_type tiley = rfull.y / scale;
+            if (decodedc != components || sx1 - tilex > decodedw || sy1 - tiley > decodedh)
+              {
+                boost::format fmt("Decoded tile %1% of directory at offset %2% has an unexpected size");
+                fmt % tile % getOffset();
+                throw Exception(fmt.str());
+              }
+
+            for (dimension_size_type row = sy0; row < sy1; ++row)
+              {
+                destidx[ome::files::DIM_SPATIAL_Y] = row - scaledy;
+                std::memcpy(view.pointer(destidx),
+                            decoded.data() + (((row - tiley) * decodedw) + (sx0 - tilex)) * components,
+                            rowbytes);
+              }
+          }
+#endif // OME_HAVE_LIBJPEG
+      }
+
+      void
+      IFD::streamImage(const region_visitor_type& visitor,
+                       dimension_size_type        x,
+                       dimension_size_type        y,
+                       dimension_size_type        w,
+                       dimension_size_type        h) const
+      {
+        const dimension_size_type width = getImageWidth();
+        const dimension_size_type height = getImageHeight();
+        if (!w || !h || x > width || w > width - x || y > height || h > height - y)
+          {
+            boost::format fmt("Invalid region %1%x%2% at %3%,%4% for image size %5%x%6%");
+            fmt % w % h % x % y % width % height;
+            throw Exception(fmt.str());
+          }
+
+        PlaneRegion region(x, y, w, h);
+        TileInfo info = getTileInfo();
+
+        // The tiles of the first sample cover each tile region once;
+        // readImage() reads the tiles of any other samples.
+        const TileRange range(info.tileRange(region, 0U));
+        std::vector<dimension_size_type> tiles(range.begin(), range.end());
+        sortTilesByOffset(*this, info.tileType(), tiles);
+
+        VariantPixelBuffer buf;
+        for (const auto tile : tiles)
+          {
+            PlaneRegion rclip = info.tileRegion(tile, region);
+            readImage(buf, rclip.x, rclip.y, rclip.w, rclip.h);
+            visitor(buf, rclip);
+          }
+      }
+
+      void
+      IFD::readImageRGB(VariantPixelBuffer& dest,
+                        dimension_size_type x,
+                        dimension_size_type y,
+                        dimension_size_type w,
+                        dimension_size_type h,
+                        bool                interleaved) const
+      {
+        uint16_t bits = getBitsPerSample();
+        if (getPhotometricInterpretation() != PALETTE ||
+            getSamplesPerPixel() != 1U ||
+            (bits != 8U && bits != 16U))
+          throw Exception("Lookup table expansion requires an 8- or 16-bit palette color image with a single sample");
+
+        std::shared_ptr<const VariantPixelBuffer> lut(getLookupTable());
 
         std::array<VariantPixelBuffer::size_type, 9> shape, dest_shape;
         shape[DIM_SPATIAL_X] = w;
         shape[DIM_SPATIAL_Y] = h;
-        shape[DIM_SUBCHANNEL] = subC;
+        shape[DIM_SUBCHANNEL] = 3U;
         shape[DIM_SPATIAL_Z] = shape[DIM_TEMPORAL_T] = shape[DIM_CHANNEL] =
           shape[DIM_MODULO_Z] = shape[DIM_MODULO_T] = shape[DIM_MODULO_C] = 1;
 
@@ -1250,41 +4409,226 @@ namespace ome
         std::copy(dest_shape_ptr, dest_shape_ptr + PixelBufferBase::dimensions,
                   dest_shape.begin());
 
-        PixelBufferBase::storage_order_type order(PixelBufferBase::make_storage_order(ome::xml::model::enums::DimensionOrder::XYZTC, planarconfig == SEPARATE ? false : true));
+        PixelBufferBase::storage_order_type order(PixelBufferBase::make_storage_order(ome::xml::model::enums::DimensionOrder::XYZTC, interleaved));
 
-        if (type != dest.pixelType() ||
+        if (dest.pixelType() != PixelType::UINT16 ||
             shape != dest_shape ||
             !(order == dest.storage_order()))
-          dest.setBuffer(shape, type, order);
+          dest.setBuffer(shape, PixelType::UINT16, order, PIXEL_UNINITIALIZED);
 
         TileInfo info = getTileInfo();
 
         PlaneRegion region(x, y, w, h);
-        std::vector<dimension_size_type> tiles(info.tileCoverage(region));
+        const TileRange tiles(info.tileRange(region));
+
+        prefetchTiles(*this, info.tileType(), tiles);
 
         ReadVisitor v(*this, info, region, tiles);
+        v.lookup = lut;
+        v.indexbytes = bits / 8U;
+        v.device = !hostAccessible(dest);
         boost::apply_visitor(v, dest.vbuffer());
       }
 
+      dimension_size_type
+      IFD::getContiguousPlaneCount() const
+      {
+        uint64_t offset = contiguousDataOffset(PlaneRegion(0, 0, getImageWidth(), getImageHeight()));
+        if (!offset)
+          return 0U;
+
+        uint64_t size = getTIFF()->getSource()->size();
+        uint64_t planesize = contiguousPlaneSize(*this);
+        return (size > offset && planesize) ? (size - offset) / planesize : 0U;
+      }
+
       void
-      IFD::readImage(VariantPixelBuffer& dest,
-                     dimension_size_type x,
-                     dimension_size_type y,
-                     dimension_size_type w,
-                     dimension_size_type h,
-                     dimension_size_type subC) const
+      IFD::readContiguousPlane(VariantPixelBuffer& dest,
+                               dimension_size_type plane,
+                               dimension_size_type x,
+                               dimension_size_type y,
+                               dimension_size_type w,
+                               dimension_size_type h) const
       {
-        // Copy the desired subchannel into the destination buffer.
-        VariantPixelBuffer tmp;
-        readImage(tmp, x, y, w, h);
+        PlaneRegion region(x, y, w, h);
+        if (!w || !h ||
+            x + w > getImageWidth() ||
+            y + h > getImageHeight())
+          {
+            boost::format fmt("Region (%1%,%2%) %3%×%4% invalid for %5%×%6% TIFF image");
+            fmt % x % y % w % h % getImageWidth() % getImageHeight();
+            throw Exception(fmt.str());
+          }
+
+        dimension_size_type planes = getContiguousPlaneCount();
+        if (plane >= planes)
+          {
+            boost::format fmt("Contiguous plane %1% invalid for TIFF image with %2% contiguous planes");
+            fmt % plane % planes;
+            throw Exception(fmt.str());
+          }
+
+        prepareBuffer(*this, dest, w, h);
 
-        detail::CopySubchannelVisitor v(dest, subC);
-        boost::apply_visitor(v, tmp.vbuffer());
+        uint64_t offset = contiguousDataOffset(region) + (plane * contiguousPlaneSize(*this));
+        readContiguous(*this, offset, impl->swapped, dest, region);
       }
 
       void
-      IFD::readLookupTable(VariantPixelBuffer& buf) const
+      IFD::readImages(const std::vector<ReadRequest>& requests)
+      {
+        // Group the requests by IFD, ordered by TIFF and IFD offset.
+        std::vector<const ReadRequest *> ordered;
+        ordered.reserve(requests.size());
+        for (const auto& request : requests)
+          ordered.push_back(&request);
+
+        auto same_ifd = [](const ReadRequest *lhs, const ReadRequest *rhs)
+          {
+            return (lhs->ifd->getTIFF() == rhs->ifd->getTIFF() &&
+                    lhs->ifd->getOffset() == rhs->ifd->getOffset());
+          };
+
+        std::stable_sort(ordered.begin(), ordered.end(),
+                         [](const ReadRequest *lhs, const ReadRequest *rhs)
+                         {
+                           const TIFF *ltiff = lhs->ifd->getTIFF().get();
+                           const TIFF *rtiff = rhs->ifd->getTIFF().get();
+                           if (ltiff != rtiff)
+                             return std::less<const TIFF *>()(ltiff, rtiff);
+                           return lhs->ifd->getOffset() < rhs->ifd->getOffset();
+                         });
+
+        for (auto group = ordered.begin(); group != ordered.end();)
+          {
+            auto group_end = group + 1;
+            while (group_end != ordered.end() && same_ifd(*group, *group_end))
+              ++group_end;
+
+            const IFD& ifd(*(*group)->ifd);
+
+            if (group_end - group == 1)
+              {
+                // Nothing to share with other requests.
+                const PlaneRegion& region((*group)->region);
+                ifd.readImage(*(*group)->buf, region.x, region.y, region.w, region.h);
+                group = group_end;
+                continue;
+              }
+
+            TileInfo info = ifd.getTileInfo();
+
+            // Union of the tiles covering all regions in the group.
+            std::vector<dimension_size_type> tiles;
+            for (auto request = group; request != group_end; ++request)
+              {
+                const PlaneRegion& region((*request)->region);
+                prepareBuffer(ifd, *(*request)->buf, region.w, region.h);
+                const TileRange coverage(info.tileRange(region));
+                tiles.insert(tiles.end(), coverage.begin(), coverage.end());
+              }
+            std::sort(tiles.begin(), tiles.end());
+            tiles.erase(std::unique(tiles.begin(), tiles.end()), tiles.end());
+            sortTilesByOffset(ifd, info.tileType(), tiles);
+
+            prefetchTiles(ifd, info.tileType(), tiles);
+
+            // Decode each tile once.  Use the TIFF tile cache if it
+            // is large enough to hold all the tiles, otherwise a
+            // temporary cache for this group.
+            dimension_size_type needed = std::max(tiles.size() * info.decodedBufferSize(),
+                                                  static_cast<dimension_size_type>(1U));
+            std::shared_ptr<DecodedTileCache> cache(ifd.getTIFF()->getTileCache());
+            if (!cache || cache->getMaxByteSize() < needed)
+              cache = std::make_shared<DecodedTileCache>(needed);
+
+            PlaneRegion full(0, 0, ifd.getImageWidth(), ifd.getImageHeight());
+            ReadVisitor decoder(ifd, info, full, tiles, cache, true);
+            boost::apply_visitor(decoder, (*group)->buf->vbuffer());
+
+            // Transfer the decoded tiles to each destination.
+            for (auto request = group; request != group_end; ++request)
+              {
+                const PlaneRegion& region((*request)->region);
+                ReadVisitor v(ifd, info, region, info.tileRange(region), cache);
+                boost::apply_visitor(v, (*request)->buf->vbuffer());
+              }
+
+            group = group_end;
+          }
+      }
+
+      std::shared_ptr<const TileBuffer>
+      IFD::readTile(dimension_size_type tile) const
+      {
+        TileInfo info = getTileInfo();
+        if (tile >= info.tileCount())
+          {
+            boost::format fmt("Invalid tile %1% (of %2%)");
+            fmt % tile % info.tileCount();
+            throw Exception(fmt.str());
+          }
+
+        // Decode into the TIFF tile cache if it can hold the tile,
+        // otherwise into a temporary cache for this tile alone.
+        std::shared_ptr<DecodedTileCache> cache(getTIFF()->getTileCache());
+        if (!cache || cache->getMaxByteSize() < info.decodedBufferSize())
+          cache = std::make_shared<DecodedTileCache>(info.decodedBufferSize());
+
+        // The buffer is only used to select the pixel type.
+        VariantPixelBuffer buf;
+        prepareBuffer(*this, buf, 1U, 1U);
+
+        std::vector<dimension_size_type> tiles(1, tile);
+        PlaneRegion full(0, 0, getImageWidth(), getImageHeight());
+        ReadVisitor decoder(*this, info, full, tiles, cache, true);
+        boost::apply_visitor(decoder, buf.vbuffer());
+
+        DecodedTileCache::value_type decoded
+          (cache->find(DecodedTileCache::key_type(getTIFF()->getFilename().string(),
+                                                  getOffset(), tile)));
+        if (!decoded)
+          throw Exception("Failed to decode tile");
+        return decoded;
+      }
+
+      std::shared_ptr<const StrileReader>
+      IFD::getStrileReader() const
+      {
+        // Only the first call locks; thereafter the reader is shared
+        // without locking.
+        std::shared_ptr<const StrileReader> striles(std::atomic_load(&impl->striles));
+        if (striles)
+          return striles;
+
+        const std::shared_ptr<TIFF>& tiff(getTIFF());
+        if (!tiff->getSource())
+          return striles;
+
+        ::TIFF *tiffraw = reinterpret_cast<::TIFF *>(tiff->getWrapped());
+
+        Sentry sentry(*tiff, readImageSite);
+
+        striles = std::atomic_load(&impl->striles);
+        if (!striles && TIFFGetMode(tiffraw) == O_RDONLY)
+          {
+            striles = std::make_shared<StrileReader>(*this);
+            std::atomic_store(&impl->striles, striles);
+          }
+        return striles;
+      }
+
+      std::shared_ptr<const VariantPixelBuffer>
+      IFD::getLookupTable() const
       {
+        ::TIFF *tiffraw = reinterpret_cast<::TIFF *>(getTIFF()->getWrapped());
+
+        // Shared IFDs may be used concurrently, so serialise caching.
+        Sentry sentry(*getTIFF());
+
+        if (impl->lookuptable)
+          return impl->lookuptable;
+
         std::array<std::vector<uint16_t>, 3> cmap;
         getField(tiff::COLORMAP).get(cmap);
 
@@ -1297,10 +4641,10 @@ namespace ome
 
         ::ome::files::PixelBufferBase::storage_order_type order_planar(::ome::files::PixelBufferBase::make_storage_order(::ome::xml::model::enums::DimensionOrder::XYZTC, false));
 
-        buf.setBuffer(shape, PixelType::UINT16, order_planar);
+        std::shared_ptr<VariantPixelBuffer> buf(std::make_shared<VariantPixelBuffer>(shape, PixelType::UINT16, order_planar, PIXEL_UNINITIALIZED));
 
         std::shared_ptr<PixelBuffer<PixelProperties<PixelType::UINT16>::std_type>> uint16_buffer
-          (boost::get<std::shared_ptr<PixelBuffer<PixelProperties<PixelType::UINT16>::std_type>>>(buf.vbuffer()));
+          (boost::get<std::shared_ptr<PixelBuffer<PixelProperties<PixelType::UINT16>::std_type>>>(buf->vbuffer()));
         assert(uint16_buffer);
 
         for (VariantPixelBuffer::size_type s = 0U; s < shape[DIM_SUBCHANNEL]; ++s)
@@ -1319,6 +4663,121 @@ namespace ome
                       &uint16_buffer->at(coord));
           }
 
+        // The colormap may still be changed when writing.
+        if (TIFFGetMode(tiffraw) == O_RDONLY)
+          impl->lookuptable = buf;
+
+        return buf;
+      }
+
+      void
+      IFD::readLookupTable(VariantPixelBuffer& buf) const
+      {
+        std::shared_ptr<const VariantPixelBuffer> lut(getLookupTable());
+
+        std::array<VariantPixelBuffer::size_type, 9> shape;
+        std::copy(lut->shape(), lut->shape() + shape.size(), shape.begin());
+
+        buf.setBuffer(shape, lut->pixelType(), lut->storage_order(), PIXEL_UNINITIALIZED);
+        buf = *lut;
+      }
+
+      std::shared_ptr<const std::vector<TileStatistics>>
+      IFD::getTileStatistics() const
+      {
+        ::TIFF *tiffraw = reinterpret_cast<::TIFF *>(getTIFF()->getWrapped());
+
+        // Shared IFDs may be used concurrently, so serialise caching.
+        Sentry sentry(*getTIFF());
+
+        if (impl->tilestatistics)
+          return impl->tilestatistics;
+
+        std::shared_ptr<std::vector<TileStatistics>> stats(std::make_shared<std::vector<TileStatistics>>());
+
+        std::vector<uint8_t> raw;
+        try
+          {
+            getField(OME_TILE_STATISTICS).get(raw);
+          }
+        catch (const Exception&)
+          {
+            // No statistics recorded.
+            raw.clear();
+          }
+
+        stats->reserve(raw.size() / tileStatisticsSize);
+        for (std::size_t i = 0; i + tileStatisticsSize <= raw.size(); i += tileStatisticsSize)
+          stats->push_back(TileStatistics{decodeDouble(&raw[i]),
+                                          decodeDouble(&raw[i + 8U]),
+                                          decodeDouble(&raw[i + 16U])});
+
+        if (TIFFGetMode(tiffraw) == O_RDONLY)
+          impl->tilestatistics = stats;
+
+        return stats;
+      }
+
+      void
+      IFD::setTileStatistics(const std::vector<TileStatistics>& stats)
+      {
+        std::vector<uint8_t> raw(stats.size() * tileStatisticsSize);
+        for (std::size_t i = 0; i < stats.size(); ++i)
+          {
+            uint8_t *dest = &raw[i * tileStatisticsSize];
+            encodeDouble(stats[i].minimum, dest);
+            encodeDouble(stats[i].maximum, dest + 8U);
+            encodeDouble(stats[i].mean, dest + 16U);
+          }
+        getField(OME_TILE_STATISTICS).set(raw);
+      }
+
+      std::shared_ptr<const std::vector<uint32_t>>
+      IFD::getTileChecksums() const
+      {
+        ::TIFF *tiffraw = reinterpret_cast<::TIFF *>(getTIFF()->getWrapped());
+
+        // Shared IFDs may be used concurrently, so serialise caching.
+        Sentry sentry(*getTIFF());
+
+        if (impl->tilechecksums)
+          return impl->tilechecksums;
+
+        std::shared_ptr<std::vector<uint32_t>> checksums(std::make_shared<std::vector<uint32_t>>());
+
+        std::vector<uint8_t> raw;
+        try
+          {
+            getField(OME_TILE_CHECKSUMS).get(raw);
+          }
+        catch (const Exception&)
+          {
+            // No checksums recorded.
+            raw.clear();
+          }
+
+        checksums->reserve(raw.size() / sizeof(uint32_t));
+        for (std::size_t i = 0; i + sizeof(uint32_t) <= raw.size(); i += sizeof(uint32_t))
+          checksums->push_back(static_cast<uint32_t>(raw[i]) |
+                               (static_cast<uint32_t>(raw[i + 1U]) << 8) |
+                               (static_cast<uint32_t>(raw[i + 2U]) << 16) |
+                               (static_cast<uint32_t>(raw[i + 3U]) << 24));
+
+        if (TIFFGetMode(tiffraw) == O_RDONLY)
+          impl->tilechecksums = checksums;
+
+        return checksums;
+      }
+
+      void
+      IFD::setTileChecksums(const std::vector<uint32_t>& checksums)
+      {
+        // Little-endian, irrespective of the file byte order.
+        std::vector<uint8_t> raw(checksums.size() * sizeof(uint32_t));
+        for (std::size_t i = 0; i < checksums.size(); ++i)
+          for (std::size_t b = 0; b < sizeof(uint32_t); ++b)
+            raw[(i * sizeof(uint32_t)) + b] = static_cast<uint8_t>(checksums[i] >> (b * 8U));
+        getField(OME_TILE_CHECKSUMS).set(raw);
       }
 
       void
@@ -1340,14 +4799,33 @@ namespace ome
                       dimension_size_type       y,
                       dimension_size_type       w,
                       dimension_size_type       h)
+      {
+        writeRegion(source, PlaneRegion(x, y, w, h), nullptr);
+      }
+
+      void
+      IFD::writeImage(const VariantPixelBuffer& source,
+                      dimension_size_type       x,
+                      dimension_size_type       y,
+                      dimension_size_type       w,
+                      dimension_size_type       h,
+                      PixelStatistics&          stats)
+      {
+        writeRegion(source, PlaneRegion(x, y, w, h), &stats);
+      }
+
+      void
+      IFD::writeRegion(const VariantPixelBuffer& source,
+                       const PlaneRegion&        region,
+                       PixelStatistics          *stats,
+                       bool                      update)
       {
         PixelType type = getPixelType();
-        PlanarConfiguration planarconfig = getPlanarConfiguration();
         uint16_t subC = getSamplesPerPixel();
 
         std::array<VariantPixelBuffer::size_type, 9> shape, source_shape;
-        shape[DIM_SPATIAL_X] = w;
-        shape[DIM_SPATIAL_Y] = h;
+        shape[DIM_SPATIAL_X] = region.w;
+        shape[DIM_SPATIAL_Y] = region.h;
         shape[DIM_SUBCHANNEL] = subC;
         shape[DIM_SPATIAL_Z] = shape[DIM_TEMPORAL_T] = shape[DIM_CHANNEL] =
           shape[DIM_MODULO_Z] = shape[DIM_MODULO_T] = shape[DIM_MODULO_C] = 1;
@@ -1356,9 +4834,6 @@ namespace ome
         std::copy(source_shape_ptr, source_shape_ptr + PixelBufferBase::dimensions,
                   source_shape.begin());
 
-        PixelBufferBase::storage_order_type order(PixelBufferBase::make_storage_order(ome::xml::model::enums::DimensionOrder::XYZTC, planarconfig == SEPARATE ? false : true));
-        PixelBufferBase::storage_order_type source_order(source.storage_order());
-
         if (type != source.pixelType())
           {
             boost::format fmt("VariantPixelBuffer %1% pixel type is incompatible with TIFF %2% sample format and bit depth");
@@ -1388,37 +4863,410 @@ namespace ome
               }
           }
 
-        if (!(order == source_order))
+        TileInfo info = getTileInfo();
+
+        const TileRange tiles(info.tileRange(region));
+
+        impl->tilecache.setMaxMemory(getTIFF()->getWriteCacheLimit());
+        impl->tilecache.setSpillDirectory(getTIFF()->getWriteCacheDirectory());
+        impl->tilecache.setMemoryBudget(getTIFF()->getMemoryBudget());
+
+        // Any storage order is accepted; samples are gathered into
+        // the tiles unless the buffer layout matches the stored data.
+        WriteVisitor v(*this, impl->coverage, impl->tilecache, impl->tilepool, impl->written, info, region, tiles);
+        v.native = nativeLayout(*this, source);
+        v.pixelstats = stats;
+        v.update = update;
+        boost::apply_visitor(v, source.vbuffer());
+      }
+
+      void
+      IFD::updateImage(const VariantPixelBuffer& source,
+                       dimension_size_type       x,
+                       dimension_size_type       y,
+                       dimension_size_type       w,
+                       dimension_size_type       h)
+      {
+        std::shared_ptr<TIFF>& tiff = getTIFF();
+        ::TIFF *tiffraw = reinterpret_cast<::TIFF *>(tiff->getWrapped());
+
+        if (TIFFGetMode(tiffraw) == O_RDONLY || !impl->offset)
+          throw Exception("Only IFDs present in a TIFF opened for update may be updated");
+
+        if (!getTileChecksums()->empty() || !getTileStatistics()->empty())
+          throw Exception("Images with recorded tile checksums or statistics may not be updated");
+
+        const dimension_size_type width = getImageWidth();
+        const dimension_size_type height = getImageHeight();
+        if (x + w > width || y + h > height)
+          {
+            boost::format fmt("Region (%1%,%2%) %3%×%4% exceeds TIFF image size %5%×%6%");
+            fmt % x % y % w % h % width % height;
+            throw Exception(fmt.str());
+          }
+
+        if (getPixelType() != source.pixelType())
+          {
+            boost::format fmt("VariantPixelBuffer %1% pixel type is incompatible with TIFF %2% sample format and bit depth");
+            fmt % source.pixelType() % getPixelType();
+            throw Exception(fmt.str());
+          }
+
+        const VariantPixelBuffer::size_type *source_shape(source.shape());
+        if (source_shape[DIM_SPATIAL_X] != w ||
+            source_shape[DIM_SPATIAL_Y] != h ||
+            source_shape[DIM_SUBCHANNEL] != getSamplesPerPixel() ||
+            source.num_elements() != w * h * getSamplesPerPixel())
+          {
+            boost::format fmt("VariantPixelBuffer dimensions (%1%×%2%, %3% samples) incompatible with TIFF region size (%4%×%5%, %6% samples)");
+            fmt % source_shape[DIM_SPATIAL_X] % source_shape[DIM_SPATIAL_Y] % source_shape[DIM_SUBCHANNEL];
+            fmt % w % h % getSamplesPerPixel();
+            throw Exception(fmt.str());
+          }
+
+        if (!w || !h)
+          return;
+
+        // Expand the region to whole tiles, so that every tile
+        // rewritten is fully covered by the existing data merged
+        // with the source.
+        TileInfo info = getTileInfo();
+        const dimension_size_type tw = info.tileWidth();
+        const dimension_size_type th = info.tileHeight();
+        PlaneRegion aligned(x - (x % tw), y - (y % th), 0, 0);
+        aligned.w = std::min(((x + w + tw - 1U) / tw) * tw, width) - aligned.x;
+        aligned.h = std::min(((y + h + th - 1U) / th) * th, height) - aligned.y;
+
+        VariantPixelBuffer merged;
+        readImage(merged, aligned.x, aligned.y, aligned.w, aligned.h);
+
+        PixelBufferBase::indices_type srcorigin, destorigin;
+        region_shape_type shape;
+        std::fill(srcorigin.begin(), srcorigin.end(), 0);
+        std::fill(destorigin.begin(), destorigin.end(), 0);
+        std::copy(source_shape, source_shape + PixelBufferBase::dimensions, shape.begin());
+        destorigin[DIM_SPATIAL_X] = static_cast<PixelBufferBase::index>(x - aligned.x);
+        destorigin[DIM_SPATIAL_Y] = static_cast<PixelBufferBase::index>(y - aligned.y);
+        copyRegion(source, srcorigin, merged, destorigin, shape);
+
+        // Tiles may be rewritten by each update, irrespective of
+        // earlier writes.
+        impl->written.clear();
+        impl->coverage.clear();
+        impl->ctile = 0;
+
+        makeCurrent();
+        writeRegion(merged, aligned, nullptr, true);
+
+        // Flush before the directory may be changed, which would
+        // discard the new tile offsets.  Since only the tile
+        // offsets and byte counts were changed, libtiff rewrites
+        // just these arrays rather than the whole directory.
+        Sentry sentry(*tiff, writeImageSite);
+        if (!TIFFFlush(tiffraw))
+          sentry.error("Failed to flush updated tiles");
+      }
+
+      void
+      IFD::writeImage(const VariantPixelBuffer& source,
+                      dimension_size_type       x,
+                      dimension_size_type       y,
+                      dimension_size_type       w,
+                      dimension_size_type       h,
+                      dimension_size_type       subC)
+      {
+        PixelType type = getPixelType();
+        uint16_t samples = getSamplesPerPixel();
+
+        if (subC >= samples)
+          {
+            boost::format fmt("Subchannel %1% invalid for TIFF image with %2% samples");
+            fmt % subC % samples;
+            throw Exception(fmt.str());
+          }
+
+        std::array<VariantPixelBuffer::size_type, 9> shape, source_shape;
+        shape[DIM_SPATIAL_X] = w;
+        shape[DIM_SPATIAL_Y] = h;
+        shape[DIM_SUBCHANNEL] = 1;
+        shape[DIM_SPATIAL_Z] = shape[DIM_TEMPORAL_T] = shape[DIM_CHANNEL] =
+          shape[DIM_MODULO_Z] = shape[DIM_MODULO_T] = shape[DIM_MODULO_C] = 1;
+
+        const VariantPixelBuffer::size_type *source_shape_ptr(source.shape());
+        std::copy(source_shape_ptr, source_shape_ptr + PixelBufferBase::dimensions,
+                  source_shape.begin());
+
+        if (type != source.pixelType())
+          {
+            boost::format fmt("VariantPixelBuffer %1% pixel type is incompatible with TIFF %2% sample format and bit depth");
+            fmt % source.pixelType() % type;
+            throw Exception(fmt.str());
+          }
+
+        // Any storage order is accepted for a single subchannel.
+        if (shape != source_shape)
           {
-            boost::format fmt("VariantPixelBuffer storage order (%1%%2%%3%%4%%5%%6%%7%%8%%9%) incompatible with %10% TIFF planar configuration (%11%%12%%13%%14%%15%%16%%17%%18%%19%");
-            fmt % source_order.ordering(0) % source_order.ordering(1) % source_order.ordering(2);
-            fmt % source_order.ordering(3) % source_order.ordering(4) % source_order.ordering(5);
-            fmt % source_order.ordering(6) % source_order.ordering(7) % source_order.ordering(8);
-            fmt % (planarconfig == SEPARATE ? "separate" : "contiguous");
-            fmt % order.ordering(0) % order.ordering(1) % order.ordering(2);
-            fmt % order.ordering(3) % order.ordering(4) % order.ordering(5);
-            fmt % order.ordering(6) % order.ordering(7) % order.ordering(8);
+            boost::format fmt("VariantPixelBuffer dimensions (%1%×%2%, %3% samples) incompatible with TIFF subchannel size (%4%×%5%, %6% samples)");
+            fmt % source_shape[DIM_SPATIAL_X] % source_shape[DIM_SPATIAL_Y] % source_shape[DIM_SUBCHANNEL];
+            fmt % shape[DIM_SPATIAL_X] % shape[DIM_SPATIAL_Y] % shape[DIM_SUBCHANNEL];
             throw Exception(fmt.str());
           }
 
         TileInfo info = getTileInfo();
 
         PlaneRegion region(x, y, w, h);
-        std::vector<dimension_size_type> tiles(info.tileCoverage(region));
+        // Separate planes only need the tiles for this sample.
+        const TileRange tiles(info.tileRange(region, subC));
 
-        WriteVisitor v(*this, impl->coverage, impl->tilecache, info, region, tiles);
+        impl->tilecache.setMaxMemory(getTIFF()->getWriteCacheLimit());
+        impl->tilecache.setSpillDirectory(getTIFF()->getWriteCacheDirectory());
+        impl->tilecache.setMemoryBudget(getTIFF()->getMemoryBudget());
+
+        WriteVisitor v(*this, impl->coverage, impl->tilecache, impl->tilepool, impl->written, info, region, tiles, subC);
+        v.native = nativeLayout(*this, source);
         boost::apply_visitor(v, source.vbuffer());
       }
 
+      bool
+      IFD::canCopyRawTiles(const IFD& source) const
+      {
+        Compression compression = getCompression();
+        if (compression != source.getCompression() ||
+            compression == COMPRESSION_JPEG ||
+            compression == COMPRESSION_OJPEG)
+          return false;
+
+        TileInfo info = getTileInfo();
+        TileInfo sourceinfo = source.getTileInfo();
+        if (getImageWidth() != source.getImageWidth() ||
+            getImageHeight() != source.getImageHeight() ||
+            info.tileType() != sourceinfo.tileType() ||
+            info.tileWidth() != sourceinfo.tileWidth() ||
+            info.tileHeight() != sourceinfo.tileHeight() ||
+            info.tileCount() != sourceinfo.tileCount() ||
+            getPixelType() != source.getPixelType() ||
+            getBitsPerSample() != source.getBitsPerSample() ||
+            getSamplesPerPixel() != source.getSamplesPerPixel() ||
+            getPlanarConfiguration() != source.getPlanarConfiguration() ||
+            getPhotometricInterpretation() != source.getPhotometricInterpretation())
+          return false;
+
+        // Tiles are only copied into an IFD with no data written.
+        for (const auto tile : impl->written)
+          if (tile)
+            return false;
+        if (impl->tilecache.size())
+          return false;
+
+        if (codecSupportsPredictor(compression))
+          {
+            uint16_t predictor = PREDICTOR_NONE;
+            uint16_t sourcepredictor = PREDICTOR_NONE;
+            getRawFieldDefaulted(TIFFTAG_PREDICTOR, &predictor);
+            source.getRawFieldDefaulted(TIFFTAG_PREDICTOR, &sourcepredictor);
+            if (predictor != sourcepredictor)
+              return false;
+          }
+
+        uint16_t fillorder = FILLORDER_MSB2LSB;
+        uint16_t sourcefillorder = FILLORDER_MSB2LSB;
+        getRawFieldDefaulted(TIFFTAG_FILLORDER, &fillorder);
+        source.getRawFieldDefaulted(TIFFTAG_FILLORDER, &sourcefillorder);
+        if (fillorder != sourcefillorder)
+          return false;
+
+        // Samples larger than a byte are stored in file byte order.
+        if (getBitsPerSample() > 8)
+          {
+            ::TIFF *tiffraw = reinterpret_cast<::TIFF *>(getTIFF()->getWrapped());
+            ::TIFF *sourceraw = reinterpret_cast<::TIFF *>(source.getTIFF()->getWrapped());
+            if (!TIFFIsByteSwapped(tiffraw) != !TIFFIsByteSwapped(sourceraw))
+              return false;
+          }
+
+        return true;
+      }
+
       void
-      IFD::writeImage(const VariantPixelBuffer& /* source*/,
-                      dimension_size_type       /* x*/,
-                      dimension_size_type       /* y*/,
-                      dimension_size_type       /* w*/,
-                      dimension_size_type       /* h*/,
-                      dimension_size_type       /* subC */)
+      IFD::copyRawTiles(const IFD& source)
+      {
+        if (!canCopyRawTiles(source))
+          throw Exception("Compressed tiles are not compatible with the destination image");
+
+        std::shared_ptr<TIFF>& tiff = getTIFF();
+        ::TIFF *tiffraw = reinterpret_cast<::TIFF *>(tiff->getWrapped());
+        std::shared_ptr<TIFF>& sourcetiff = source.getTIFF();
+        ::TIFF *sourceraw = reinterpret_cast<::TIFF *>(sourcetiff->getWrapped());
+        IOStatistics& statistics(*tiff->getStatistics());
+        IOStatistics& sourcestatistics(*sourcetiff->getStatistics());
+
+        TileInfo info = getTileInfo();
+        TileType type = info.tileType();
+        tstrile_t count = static_cast<tstrile_t>(info.tileCount());
+
+        // Read without locking the source if possible.
+        std::shared_ptr<const StrileReader> striles(source.getStrileReader());
+        if (striles && striles->getTileType() != type)
+          striles.reset();
+
+        std::shared_ptr<const std::vector<uint32_t>> checksums;
+        if (sourcetiff->getVerifyTileChecksums())
+          checksums = source.getTileChecksums();
+
+        std::vector<char> raw;
+        for (tstrile_t tile = 0; tile < count; ++tile)
+          {
+            {
+              IOStatistics::Timer timer(sourcestatistics, IOStatistics::STAGE_READ);
+              if (striles)
+                {
+                  if (!striles->getRange(tile).second)
+                    continue;
+                  striles->read(tile, raw);
+                }
+              else
+                {
+                  Sentry sentry(*sourcetiff, copyRawTilesSite);
+                  source.makeCurrent();
+
+                  uint64_t size = strileByteCount(sourceraw, type, tile);
+                  if (!size)
+                    continue;
+                  raw.resize(static_cast<std::size_t>(size));
+                  tmsize_t bytesread = type == TILE ?
+                    TIFFReadRawTile(sourceraw, tile, raw.data(), static_cast<tmsize_t>(raw.size())) :
+                    TIFFReadRawStrip(sourceraw, tile, raw.data(), static_cast<tmsize_t>(raw.size()));
+                  if (bytesread < 0)
+                    sentry.error(type == TILE ? "Failed to read raw tile" : "Failed to read raw strip");
+                  raw.resize(static_cast<std::size_t>(bytesread));
+                }
+              sourcestatistics.add(IOStatistics::BYTES_READ, raw.size());
+            }
+
+            if (checksums)
+              verifyTileChecksum(*checksums, source, tile, raw.data(), raw.size(),
+                                 sourcestatistics);
+
+            {
+              IOStatistics::Timer timer(statistics, IOStatistics::STAGE_WRITE);
+              Sentry sentry(*tiff, copyRawTilesSite);
+
+              tsize_t rawsize = static_cast<tsize_t>(raw.size());
+              if (type == TILE)
+                {
+                  tsize_t byteswritten = TIFFWriteRawTile(tiffraw, tile, raw.data(), rawsize);
+                  if (byteswritten < 0)
+                    sentry.error("Failed to write raw tile");
+                  else if (byteswritten != rawsize)
+                    sentry.error("Failed to write raw tile fully");
+                }
+              else
+                {
+                  tsize_t byteswritten = TIFFWriteRawStrip(tiffraw, tile, raw.data(), rawsize);
+                  if (byteswritten < 0)
+                    sentry.error("Failed to write raw strip");
+                  else if (byteswritten != rawsize)
+                    sentry.error("Failed to write raw strip fully");
+                }
+              if (tiff->getRecordTileChecksums())
+                tiff->addTileChecksum(tile, ::ome::files::crc32c(raw.data(), raw.size()));
+              statistics.add(IOStatistics::BYTES_WRITTEN, static_cast<uint64_t>(rawsize));
+            }
+          }
+
+        // Tiles missing from the source are also marked as written,
+        // so that any later writes to this IFD are discarded.
+        impl->written.assign(count, true);
+        setCurrentTile(count);
+      }
+
+      std::shared_ptr<const ImageLayout>
+      IFD::reserveImage(dimension_size_type alignment)
       {
-        throw Exception("Writing subchannels separately is not yet implemented (requires TileCache and WriteVisitor to handle writing and caching of interleaved and non-interleaved subchannels; currently it handles writing all subchannels in one call only and can not combine separate subchannels from separate calls");
+        if (getCompression() != COMPRESSION_NONE)
+          throw Exception("Image data may only be reserved for uncompressed images");
+        if (getBitsPerSample() % 8U)
+          throw Exception("Image data may only be reserved for samples of whole bytes");
+        if (halfFloatSamples(*this))
+          throw Exception("Image data may not be reserved for half precision samples");
+
+        // Space is only reserved in an IFD with no data written.
+        for (const auto tile : impl->written)
+          if (tile)
+            throw Exception("Image data may only be reserved for an image with no data written");
+        if (impl->tilecache.size())
+          throw Exception("Image data may only be reserved for an image with no data written");
+
+        std::shared_ptr<TIFF>& tiff = getTIFF();
+        ::TIFF *tiffraw = reinterpret_cast<::TIFF *>(tiff->getWrapped());
+        IOStatistics& statistics(*tiff->getStatistics());
+
+        TileInfo info = getTileInfo();
+        TileType type = info.tileType();
+        tstrile_t count = static_cast<tstrile_t>(info.tileCount());
+        PlaneRegion rimage(0, 0, getImageWidth(), getImageHeight());
+
+        std::vector<IOSource::range_type> ranges(count);
+        std::vector<char> zero(std::max(info.bufferSize(), alignment), 0);
+
+        {
+          IOStatistics::Timer timer(statistics, IOStatistics::STAGE_WRITE);
+          Sentry sentry(*tiff, reserveImageSite);
+
+          if (TIFFIsByteSwapped(tiffraw))
+            throw Exception("Image data may only be reserved for images with native byte order");
+
+          // Pad the end of the file to the alignment.  libtiff places
+          // each new tile or strip, and the directory, at the end of
+          // the file.
+          thandle_t client = TIFFClientdata(tiffraw);
+          TIFFSeekProc seekproc = TIFFGetSeekProc(tiffraw);
+          TIFFWriteProc writeproc = TIFFGetWriteProc(tiffraw);
+          auto pad = [&]()
+            {
+              if (!alignment)
+                return true;
+              toff_t end = seekproc(client, 0, SEEK_END);
+              tsize_t padding = static_cast<tsize_t>((alignment - (end % alignment)) % alignment);
+              return !padding || writeproc(client, zero.data(), padding) == padding;
+            };
+
+          for (tstrile_t tile = 0; tile < count; ++tile)
+            {
+              if (!pad())
+                sentry.error("Failed to pad image data");
+
+              tsize_t size = static_cast<tsize_t>(info.bufferSize());
+              if (type == STRIP)
+                {
+                  // As when flushing, the last strip only contains
+                  // the rows within the image.
+                  PlaneRegion rfull = info.tileRegion(tile);
+                  PlaneRegion validarea = rfull & rimage;
+                  size = static_cast<tsize_t>((info.bufferSize() / std::min(rfull.h, rimage.h)) * validarea.h);
+                }
+
+              tsize_t byteswritten = type == TILE ?
+                TIFFWriteRawTile(tiffraw, tile, zero.data(), size) :
+                TIFFWriteRawStrip(tiffraw, tile, zero.data(), size);
+              if (byteswritten < 0)
+                sentry.error(type == TILE ? "Failed to write raw tile" : "Failed to write raw strip");
+              else if (byteswritten != size)
+                sentry.error(type == TILE ? "Failed to write raw tile fully" : "Failed to write raw strip fully");
+
+              ranges[tile] = IOSource::range_type(strileOffset(tiffraw, type, tile),
+                                                  static_cast<std::size_t>(size));
+              statistics.add(IOStatistics::BYTES_WRITTEN, static_cast<uint64_t>(size));
+            }
+
+          if (!pad())
+            sentry.error("Failed to pad image data");
+        }
+
+        impl->written.assign(count, true);
+        setCurrentTile(count);
+
+        return std::make_shared<ImageLayout>(*this, ranges);
       }
 
       std::shared_ptr<IFD>
@@ -1429,7 +5277,7 @@ namespace ome
         std::shared_ptr<TIFF>& tiff = getTIFF();
         ::TIFF *tiffraw = reinterpret_cast<::TIFF *>(tiff->getWrapped());
 
-        Sentry sentry;
+        Sentry sentry(*tiff);
 
         makeCurrent();
 
@@ -1448,7 +5296,7 @@ namespace ome
         std::shared_ptr<TIFF>& tiff = getTIFF();
         ::TIFF *tiffraw = reinterpret_cast<::TIFF *>(tiff->getWrapped());
 
-        Sentry sentry;
+        Sentry sentry(*tiff);
 
         makeCurrent();
 
@@ -38,11 +38,16 @@
 #ifndef OME_FILES_TIFF_IFD_H
 #define OME_FILES_TIFF_IFD_H
 
+#include <array>
+#include <functional>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <ome/files/CoreMetadata.h>
+#include <ome/files/PlaneRegion.h>
 #include <ome/files/TileCoverage.h>
+#include <ome/files/tiff/Tags.h>
 #include <ome/files/tiff/TileInfo.h>
 #include <ome/files/tiff/Types.h>
 #include <ome/files/VariantPixelBuffer.h>
@@ -53,15 +58,64 @@ namespace ome
 {
   namespace files
   {
+
+    class PixelStatistics;
+    class TileBuffer;
+
     namespace tiff
     {
 
+      class ImageLayout;
+
       class TIFF;
+      class StrileReader;
 
       /// Forward declaration of Field<Tag>.
       template<typename Tag>
       class Field;
 
+      /**
+       * Image structure tags for an IFD.
+       *
+       * When writing many planes of the same shape, the structure
+       * of each IFD is identical.  A template captured from the
+       * first IFD with IFD::getTemplate() may be applied to each
+       * following IFD with IFD::applyTemplate(), which sets all of
+       * the tags at once rather than validating and setting each
+       * one in turn.
+       */
+      struct IFDTemplate
+      {
+        /// Image width.
+        uint32_t imageWidth;
+        /// Image height.
+        uint32_t imageHeight;
+        /// Tile type.
+        TileType tileType;
+        /// Tile width (unused for strips).
+        uint32_t tileWidth;
+        /// Tile height or rows per strip.
+        uint32_t tileHeight;
+        /// Pixel type.
+        ::ome::xml::model::enums::PixelType pixelType;
+        /// Bits per sample.
+        uint16_t bitsPerSample;
+        /// Samples per pixel.
+        uint16_t samplesPerPixel;
+        /// Planar configuration.
+        PlanarConfiguration planarConfiguration;
+        /// Photometric interpretation.
+        PhotometricInterpretation photometricInterpretation;
+        /// Compression scheme.
+        Compression compression;
+        /// Compression level (-1 for the codec default).
+        int compressionLevel;
+        /// Predictor.
+        Predictor predictor;
+        /// YCbCr chrominance subsampling (horizontal, vertical; YCbCr only).
+        std::array<uint16_t, 2> ycbcrSubsampling;
+      };
+
       /**
        * Image File Directory (IFD).
        *
@@ -74,6 +128,58 @@ namespace ome
         /// Private implementation details.
         std::shared_ptr<Impl> impl;
 
+        /**
+         * Get the offset of contiguous uncompressed image data.
+         *
+         * @param region the region to read.
+         * @returns the offset, or zero if the image data is not
+         * contiguous, or may not be read directly for this region.
+         */
+        uint64_t
+        contiguousDataOffset(const PlaneRegion& region) const;
+
+        /**
+         * Read a region of an image plane into a pixel buffer.
+         *
+         * @param dest the destination pixel buffer.
+         * @param region the region to read.
+         * @param order the storage order of the destination pixel buffer.
+         * @param stats pixel statistics to accumulate, or null.
+         */
+        void
+        readRegion(VariantPixelBuffer&                        dest,
+                   const PlaneRegion&                         region,
+                   const PixelBufferBase::storage_order_type& order,
+                   PixelStatistics                           *stats) const;
+
+        /**
+         * Write a region of an image plane from a pixel buffer.
+         *
+         * @param source the source pixel buffer.
+         * @param region the region to write.
+         * @param stats pixel statistics to accumulate, or null.
+         * @param update @c true if rewriting existing tiles, in which
+         * case every tile must be fully covered by @p region, and
+         * no tile summaries or checksums are recorded.
+         */
+        void
+        writeRegion(const VariantPixelBuffer& source,
+                    const PlaneRegion&        region,
+                    PixelStatistics          *stats,
+                    bool                      update = false);
+
+      public:
+        /// A request to read a region of an image plane.
+        struct ReadRequest
+        {
+          /// The IFD to read.
+          std::shared_ptr<const IFD> ifd;
+          /// The region of the image to read.
+          PlaneRegion region;
+          /// The destination pixel buffer.
+          VariantPixelBuffer *buf;
+        };
+
       protected:
         /**
          * Constructor (not public).
@@ -91,6 +197,18 @@ namespace ome
          */
         IFD(std::shared_ptr<TIFF>& tiff);
 
+        /**
+         * Load and cache the core image tags.
+         *
+         * Used when opening an IFD from a read-only TIFF.  The image
+         * and tile dimensions, pixel type, sample layout and
+         * compression are immutable in this case.  They are loaded
+         * once here, so that later queries are served from memory
+         * without taking the TIFF lock.
+         */
+        void
+        loadCoreTags();
+
         /// @cond SKIP
         IFD (const IFD&) = delete;
 
@@ -146,7 +264,10 @@ namespace ome
         /**
          * Make this IFD the current directory.
          *
-         * Internally this is simply a call to TIFFSetDirectory.
+         * Internally this is simply a call to TIFFSetDirectory.  For
+         * JPEG-compressed YCbCr data, libjpeg is also set to convert
+         * to and from RGB, since libtiff resets this every time a
+         * directory is read.
          */
         void
         makeCurrent() const;
@@ -190,6 +311,22 @@ namespace ome
         getRawFieldDefaulted(tag_type tag,
                              ...) const;
 
+        /**
+         * Check if a field is set, by its tag number.
+         *
+         * Unlike getRawField(), this does not throw if the field is
+         * not set, so it is cheap to use when probing for optional
+         * tags.
+         *
+         * @note This should not be used except internally.  Use
+         * hasField(TagCategory) instead.
+         *
+         * @param tag the tag number.
+         * @returns @c true if the field is set, @c false otherwise.
+         */
+        bool
+        hasRawField(tag_type tag) const;
+
         /**
          * Set a field by its tag number.
          *
@@ -230,6 +367,43 @@ namespace ome
           return Field<TagCategory>(const_cast<IFD *>(this)->shared_from_this(), tag);
         }
 
+        /// Visitor for the text of a field.
+        typedef std::function<void (const char *text, std::size_t size)> text_visitor_type;
+
+        /**
+         * Visit the text of a string field without copying it.
+         *
+         * The visitor is passed the text held by libtiff for the
+         * field (without its terminating null), which avoids copying
+         * large fields such as an ImageDescription containing
+         * OME-XML.  The TIFF is locked, and this directory kept
+         * current, while the visitor runs, so the visitor must not
+         * use other directories of the same TIFF, and should return
+         * promptly if the TIFF is used by other threads.  The text is
+         * not valid after the visitor returns.
+         *
+         * @param tag the field identifier.
+         * @param visitor the visitor to call with the text.
+         * @returns @c true if the field is set and was visited, or
+         * @c false if the field is not set.
+         */
+        bool
+        visitField(StringTag1               tag,
+                   const text_visitor_type& visitor) const;
+
+        /**
+         * Check if a field is set.
+         *
+         * @param tag the field identifier.
+         * @returns @c true if the field is set, @c false otherwise.
+         */
+        template<typename TagCategory>
+        bool
+        hasField(TagCategory tag) const
+        {
+          return getField(tag).isSet();
+        }
+
         /**
          * Get the tile type.
          *
@@ -249,7 +423,10 @@ namespace ome
         /**
          * Get the current tile being written.
          *
-         * This is the tile currently being modified pending flush.
+         * This is the first tile not yet written.  Tiles are written
+         * as soon as they are fully covered by writeImage(), in any
+         * order, so tiles following the current tile may already
+         * have been written.
          *
          * @returns the current tile.
          */
@@ -259,7 +436,7 @@ namespace ome
         /**
          * Set the current tile being written.
          *
-         * This is the tile currently being modified pending flush.
+         * This is the first tile not yet written.
          *
          * @note This should not be set by hand; it will be updated by
          * the code writing out tile data called internally by
@@ -291,6 +468,8 @@ namespace ome
         /**
          * Get tile coverage cache.
          *
+         * Coverage is tracked separately for each sample.
+         *
          * @returns the TileCoverage cache for this IFD.
          */
         std::vector<TileCoverage>&
@@ -473,6 +652,71 @@ namespace ome
         void
         setCompression(Compression compression);
 
+        /**
+         * Get compression level.
+         *
+         * This is the level set with setCompressionLevel(); the
+         * level is not stored in the file, so is not available when
+         * reading.
+         *
+         * @returns the compression level, or @c -1 if unset (the
+         * codec default).
+         */
+        int
+        getCompressionLevel() const;
+
+        /**
+         * Set compression level.
+         *
+         * The compression scheme must be set first, since changing
+         * the scheme resets the level to the codec default.
+         *
+         * @param level the codec-specific compression level or
+         * quality.
+         * @throws Exception if the compression scheme does not
+         * support setting the level, or the level is out of range.
+         * @see getCodecLevelRange().
+         */
+        void
+        setCompressionLevel(int level);
+
+        /**
+         * Set predictor.
+         *
+         * The compression scheme and pixel type must be set first.
+         *
+         * @param predictor the predictor to apply prior to encoding.
+         * @throws Exception if the compression scheme or pixel type
+         * do not support the predictor.
+         * @see codecSupportsPredictor() and getPixelTypePredictor().
+         */
+        void
+        setPredictor(Predictor predictor);
+
+        /**
+         * Get the image structure tags as a template.
+         *
+         * @returns the image structure of this IFD.
+         * @throws Exception if a required tag is not set.
+         */
+        IFDTemplate
+        getTemplate() const;
+
+        /**
+         * Set the image structure tags from a template.
+         *
+         * This is equivalent to setting each tag in turn, but the
+         * TIFF is locked and made current only once.  The template
+         * is not validated, so should be obtained from
+         * getTemplate() on an IFD set up with the individual
+         * setters.
+         *
+         * @param tmpl the image structure to apply.
+         * @throws Exception if libtiff rejects any of the tags.
+         */
+        void
+        applyTemplate(const IFDTemplate& tmpl);
+
         /**
          * Read a whole image plane into a pixel buffer.
          *
@@ -497,6 +741,10 @@ namespace ome
          * or has a different storage order, it will be resized using
          * the correct pixel type and storage order.
          *
+         * If the TIFF is open read-only and TIFF::getDecodeThreads()
+         * is greater than 1, the tiles or strips covering the region
+         * will be decoded in parallel.
+         *
          * @param dest the destination pixel buffer.
          * @param x the @c X coordinate of the upper-left corner of the sub-image.
          * @param y the @c Y coordinate of the upper-left corner of the sub-image.
@@ -510,8 +758,69 @@ namespace ome
                   dimension_size_type w,
                   dimension_size_type h) const;
 
+        /**
+         * Read a region of an image plane into a pixel buffer with a
+         * specified storage order.
+         *
+         * This is as for
+         * readImage(VariantPixelBuffer&,dimension_size_type,dimension_size_type,dimension_size_type,dimension_size_type) const,
+         * but the destination pixel buffer is resized to use the
+         * requested storage order rather than the storage order of
+         * the stored samples.  Where the orders differ, the samples
+         * are written in the requested order as the tiles or strips
+         * are unpacked, avoiding a separate reordering copy.  Use
+         * PixelBufferBase::make_storage_order() to request
+         * interleaved or planar samples.
+         *
+         * @param dest the destination pixel buffer.
+         * @param x the @c X coordinate of the upper-left corner of the sub-image.
+         * @param y the @c Y coordinate of the upper-left corner of the sub-image.
+         * @param w the width of the sub-image.
+         * @param h the height of the sub-image.
+         * @param order the storage order of the destination pixel buffer.
+         */
+        void
+        readImage(VariantPixelBuffer&                        dest,
+                  dimension_size_type                        x,
+                  dimension_size_type                        y,
+                  dimension_size_type                        w,
+                  dimension_size_type                        h,
+                  const PixelBufferBase::storage_order_type& order) const;
+
+        /**
+         * Read a region of an image plane into a pixel buffer,
+         * accumulating pixel statistics.
+         *
+         * This is as for
+         * readImage(VariantPixelBuffer&,dimension_size_type,dimension_size_type,dimension_size_type,dimension_size_type) const,
+         * but the minimum, maximum and histogram of each subchannel
+         * of the region are accumulated into @c stats as each tile
+         * or strip is transferred to the destination buffer, while
+         * the pixel data is still in cache.
+         *
+         * @param dest the destination pixel buffer.
+         * @param x the @c X coordinate of the upper-left corner of the sub-image.
+         * @param y the @c Y coordinate of the upper-left corner of the sub-image.
+         * @param w the width of the sub-image.
+         * @param h the height of the sub-image.
+         * @param stats the pixel statistics to accumulate.
+         */
+        void
+        readImage(VariantPixelBuffer& dest,
+                  dimension_size_type x,
+                  dimension_size_type y,
+                  dimension_size_type w,
+                  dimension_size_type h,
+                  PixelStatistics&    stats) const;
+
         /**
          * @copydoc IFD::readImage(VariantPixelBuffer&,dimension_size_type,dimension_size_type,dimension_size_type,dimension_size_type) const
+         *
+         * Only the requested subchannel is read into the destination
+         * buffer, which will have a single subchannel.  For separate
+         * planes, only the tiles or strips of the requested sample
+         * are decoded.
+         *
          * @param subC the subchannel to read.
          */
         void
@@ -522,14 +831,317 @@ namespace ome
                   dimension_size_type h,
                   dimension_size_type subC) const;
 
+        /**
+         * Check if the image can be read at a reduced scale.
+         *
+         * JPEG-compressed 8-bit greyscale, RGB and YCbCr images may
+         * be decoded directly at 1/2, 1/4 or 1/8 scale, which avoids
+         * most of the inverse DCT work and all of the full
+         * resolution samples.  This requires libjpeg support.
+         *
+         * @param scale the scale denominator.
+         * @returns @c true if readImageReduced() supports @p scale.
+         */
+        bool
+        supportsReducedRead(dimension_size_type scale) const;
+
+        /**
+         * Read a region of an image plane at a reduced scale.
+         *
+         * Each tile or strip covering the region is decoded at
+         * 1/scale of its full size, and the result is close to, but
+         * not identical to, the area average of the full resolution
+         * samples.  The origin of the region must be a multiple of
+         * @p scale.  The destination pixel buffer will be resized to
+         * ⌈w/scale⌉×⌈h/scale⌉ if required, as for readImage().
+         *
+         * @param dest the destination pixel buffer.
+         * @param x the @c X coordinate of the upper-left corner of the sub-image.
+         * @param y the @c Y coordinate of the upper-left corner of the sub-image.
+         * @param w the width of the sub-image.
+         * @param h the height of the sub-image.
+         * @param scale the scale denominator.
+         * @throws an Exception if the scale is not supported, if the
+         * region is invalid, or if the image data could not be read.
+         */
+        void
+        readImageReduced(VariantPixelBuffer& dest,
+                         dimension_size_type x,
+                         dimension_size_type y,
+                         dimension_size_type w,
+                         dimension_size_type h,
+                         dimension_size_type scale) const;
+
+        /**
+         * Advise the expected access pattern for a region of the image.
+         *
+         * The byte ranges of the tiles or strips covering the region
+         * are passed to TIFF::adviseAccess().  This is advisory only.
+         *
+         * @param hint the expected access pattern.
+         * @param x the @c X coordinate of the upper-left corner of the region.
+         * @param y the @c Y coordinate of the upper-left corner of the region.
+         * @param w the width of the region.
+         * @param h the height of the region.
+         */
+        void
+        adviseAccess(AccessHint          hint,
+                     dimension_size_type x,
+                     dimension_size_type y,
+                     dimension_size_type w,
+                     dimension_size_type h) const;
+
+        /**
+         * Visitor for streamed image reads.
+         *
+         * Called with a pixel buffer containing part of the image,
+         * and the region of the image it covers.  The buffer is
+         * reused for the next part once the visitor returns.
+         */
+        typedef std::function<void (const VariantPixelBuffer& buf,
+                                    const PlaneRegion& region)> region_visitor_type;
+
+        /**
+         * Read a region of an image plane incrementally.
+         *
+         * Rather than reading the whole region into a single pixel
+         * buffer, each tile or strip covering the region is read in
+         * turn, clipped to the region, and passed to the visitor.
+         * The tiles are visited in order of their offset in the
+         * file.  For separate planes, all the samples of a tile
+         * region are read together.  Only a single tile or strip is
+         * held in memory at once, so this permits processing of
+         * regions too large to read in their entirety.
+         *
+         * @param visitor the visitor to call with each part.
+         * @param x the @c X coordinate of the upper-left corner of the sub-image.
+         * @param y the @c Y coordinate of the upper-left corner of the sub-image.
+         * @param w the width of the sub-image.
+         * @param h the height of the sub-image.
+         * @throws Exception if the region is invalid or could not be
+         * read; exceptions thrown by the visitor are propagated.
+         */
+        void
+        streamImage(const region_visitor_type& visitor,
+                    dimension_size_type        x,
+                    dimension_size_type        y,
+                    dimension_size_type        w,
+                    dimension_size_type        h) const;
+
+        /**
+         * Read a region of an indexed color image plane into a pixel
+         * buffer, expanded to RGB using the lookup table.
+         *
+         * The image must be an 8- or 16-bit palette color image with
+         * a single sample.  Each tile or strip is expanded through
+         * the lookup table as it is transferred to the destination
+         * buffer, so the indices are never stored separately.  The
+         * destination buffer will have pixel type UINT16 and three
+         * subchannels (RGB); it will be resized if required, as for
+         * readImage().
+         *
+         * @param dest the destination pixel buffer.
+         * @param x the @c X coordinate of the upper-left corner of the sub-image.
+         * @param y the @c Y coordinate of the upper-left corner of the sub-image.
+         * @param w the width of the sub-image.
+         * @param h the height of the sub-image.
+         * @param interleaved @c true to interleave the RGB samples, or
+         * @c false for separate RGB planes.
+         * @throws an Exception if the image is not an indexed color
+         * image, or if the lookup table could not be read.
+         */
+        void
+        readImageRGB(VariantPixelBuffer& dest,
+                     dimension_size_type x,
+                     dimension_size_type y,
+                     dimension_size_type w,
+                     dimension_size_type h,
+                     bool                interleaved = true) const;
+
+        /**
+         * Get the number of image planes stored contiguously.
+         *
+         * Uncompressed image data may be followed directly by further
+         * planes of the same size and layout which have no IFD of
+         * their own; ImageJ stores stacks larger than 4 GiB in this
+         * way.  This counts the complete planes, including the image
+         * of this IFD, between the start of the image data and the
+         * end of the file.
+         *
+         * @returns the number of planes, or zero if the image data is
+         * not uncompressed and contiguous, or if there is no I/O
+         * source to read it from.
+         */
+        dimension_size_type
+        getContiguousPlaneCount() const;
+
+        /**
+         * Read a region of a contiguously stored image plane into a
+         * pixel buffer.
+         *
+         * Plane zero is the image of this IFD; following planes are
+         * stored directly after it, as counted by
+         * getContiguousPlaneCount().  The destination buffer is
+         * resized as for readImage().  The image data is read
+         * directly from the I/O source without libtiff.
+         *
+         * @param dest the destination pixel buffer.
+         * @param plane the plane index.
+         * @param x the @c X coordinate of the upper-left corner of the sub-image.
+         * @param y the @c Y coordinate of the upper-left corner of the sub-image.
+         * @param w the width of the sub-image.
+         * @param h the height of the sub-image.
+         * @throws an Exception if the image data is not contiguous,
+         * or the plane or region is out of range.
+         */
+        void
+        readContiguousPlane(VariantPixelBuffer& dest,
+                            dimension_size_type plane,
+                            dimension_size_type x,
+                            dimension_size_type y,
+                            dimension_size_type w,
+                            dimension_size_type h) const;
+
+        /**
+         * Read regions of several image planes into pixel buffers.
+         *
+         * Each request is read as for readImage(), with the
+         * destination pixel buffer being resized as required.
+         * Requests are grouped by IFD, and the IFDs are read in
+         * order of their offset in the file.  For each IFD, the
+         * union of the tiles or strips covering the requested
+         * regions is decoded once, in order of their offset in the
+         * file, and the decoded tiles are then transferred to each
+         * destination buffer which they overlap.  This avoids
+         * repeatedly decoding tiles shared between overlapping
+         * regions, and avoids seeking back and forth in the file.
+         *
+         * The destination buffers must be distinct.
+         *
+         * @param requests the regions to read.
+         */
+        static
+        void
+        readImages(const std::vector<ReadRequest>& requests);
+
+        /**
+         * Read a single decoded tile or strip.
+         *
+         * The tile is returned from the TIFF tile cache if it was
+         * previously decoded, otherwise it is decoded and added to
+         * the cache (if any).  The buffer holds the decoded samples
+         * of the whole tile, without transfer to a pixel buffer; its
+         * layout is described by getTileInfo(): the tile region is
+         * given by TileInfo::tileRegion(), and the samples are
+         * interleaved for contiguous planar configuration, or are
+         * the single sample given by TileInfo::tileSample() for
+         * separate planar configuration.  For strips, only the rows
+         * within the image are valid.
+         *
+         * The returned buffer is shared with the cache, and must not
+         * be modified.
+         *
+         * @param tile the tile index.
+         * @returns the decoded tile.
+         * @throws Exception if the tile index is invalid or the tile
+         * could not be read.
+         */
+        std::shared_ptr<const TileBuffer>
+        readTile(dimension_size_type tile) const;
+
+        /**
+         * Get a reader for the raw tile and strip data.
+         *
+         * The reader is created once, and the same reader is
+         * returned to all callers.  It permits the raw data of the
+         * tiles or strips of this IFD to be read concurrently without
+         * libtiff or the TIFF lock.  readImage() uses it to decode
+         * tiles with a registered TileCodec without holding the lock.
+         *
+         * @returns the reader, or null if the TIFF is not open
+         * read-only or has no I/O source.
+         */
+        std::shared_ptr<const StrileReader>
+        getStrileReader() const;
+
+        /**
+         * Get the lookup table.
+         *
+         * When reading, the lookup table is read from the COLORMAP
+         * tag once only, and the same buffer is returned to all
+         * callers.  The X dimension is the value index and the
+         * sub-channel dimension is the color sample (RGB).
+         *
+         * @returns the lookup table.
+         * @throws an Exception if the lookup table could not be read.
+         */
+        std::shared_ptr<const VariantPixelBuffer>
+        getLookupTable() const;
+
         /**
          * Read a lookup table into a pixel buffer.
          *
+         * The lookup table is copied from getLookupTable().
+         *
          * @param buf the destination pixel buffer.
          */
         void
         readLookupTable(VariantPixelBuffer& buf) const;
 
+        /**
+         * Get the tile statistics.
+         *
+         * The statistics are recorded when writing with
+         * TIFF::setRecordTileStatistics(), and are read from a
+         * private tag once only when reading.  The minimum, maximum
+         * and mean of tiles or strips without statistics are NaN.
+         *
+         * @returns the statistics of each tile or strip, indexed by
+         * tile or strip number; empty if no statistics were recorded.
+         */
+        std::shared_ptr<const std::vector<TileStatistics>>
+        getTileStatistics() const;
+
+        /**
+         * Set the tile statistics.
+         *
+         * The statistics are stored in a private tag.  Used by
+         * TIFF::writeCurrentDirectory() for statistics recorded while
+         * writing.
+         *
+         * @param stats the statistics of each tile or strip.
+         */
+        void
+        setTileStatistics(const std::vector<TileStatistics>& stats);
+
+        /**
+         * Get the tile checksums.
+         *
+         * The checksums are recorded when writing with
+         * TIFF::setRecordTileChecksums(), and are read from a private
+         * tag once only when reading.  Each is the CRC-32C checksum
+         * of the compressed data of the tile or strip.  Tiles or
+         * strips without a checksum have a value of zero, and are
+         * not verified.
+         *
+         * @returns the checksum of each tile or strip, indexed by
+         * tile or strip number; empty if no checksums were recorded.
+         */
+        std::shared_ptr<const std::vector<uint32_t>>
+        getTileChecksums() const;
+
+        /**
+         * Set the tile checksums.
+         *
+         * The checksums are stored in a private tag.  Used by
+         * TIFF::writeCurrentDirectory() for checksums recorded while
+         * writing.
+         *
+         * @param checksums the checksum of each tile or strip.
+         */
+        void
+        setTileChecksums(const std::vector<uint32_t>& checksums);
+
         /**
          * Write a whole image plane from a pixel buffer.
          *
@@ -550,8 +1162,12 @@ namespace ome
          * Write a whole image plane from a pixel buffer.
          *
          * The source pixel buffer must match the size of the region
-         * being written, and must also the same pixel type and
-         * storage ordering as the TIFF image.
+         * being written, and must also the same pixel type as the
+         * TIFF image.  Any storage order is accepted.  If the
+         * storage ordering of the source differs from the TIFF
+         * planar configuration, the samples will be interleaved or
+         * deinterleaved as the tiles are filled, without copying the
+         * source into a temporary buffer.
          *
          * @param source the source pixel buffer.
          * @param x the @c X coordinate of the upper-left corner of the sub-image.
@@ -567,7 +1183,47 @@ namespace ome
                    dimension_size_type       h);
 
         /**
-         * @copydoc IFD::writeImage(const VariantPixelBuffer&,dimension_size_type,dimension_size_type,dimension_size_type,dimension_size_type)
+         * Write a region of an image plane from a pixel buffer,
+         * accumulating pixel statistics.
+         *
+         * This is as for
+         * writeImage(const VariantPixelBuffer&,dimension_size_type,dimension_size_type,dimension_size_type,dimension_size_type),
+         * but the minimum, maximum and histogram of each subchannel
+         * of the region are accumulated into @c stats as the samples
+         * are gathered into each tile or strip.
+         *
+         * @param source the source pixel buffer.
+         * @param x the @c X coordinate of the upper-left corner of the sub-image.
+         * @param y the @c Y coordinate of the upper-left corner of the sub-image.
+         * @param w the width of the sub-image.
+         * @param h the height of the sub-image.
+         * @param stats the pixel statistics to accumulate.
+         */
+        void
+        writeImage(const VariantPixelBuffer& source,
+                   dimension_size_type       x,
+                   dimension_size_type       y,
+                   dimension_size_type       w,
+                   dimension_size_type       h,
+                   PixelStatistics&          stats);
+
+        /**
+         * Write a region of a single subchannel from a pixel buffer.
+         *
+         * The source pixel buffer must match the size of the region
+         * being written, with a single subchannel, and must have
+         * the same pixel type as the TIFF image.  The subchannels
+         * of a tile may be written by separate calls, in any order;
+         * a tile is written when all of its samples are covered.
+         * This permits writing each subchannel of an image with
+         * contiguous samples without first interleaving them in a
+         * temporary buffer.
+         *
+         * @param source the source pixel buffer.
+         * @param x the @c X coordinate of the upper-left corner of the sub-image.
+         * @param y the @c Y coordinate of the upper-left corner of the sub-image.
+         * @param w the width of the sub-image.
+         * @param h the height of the sub-image.
          * @param subC the subchannel to write.
          */
         void
@@ -578,6 +1234,106 @@ namespace ome
                    dimension_size_type       h,
                    dimension_size_type       subC);
 
+        /**
+         * Update a region of an existing image plane from a pixel
+         * buffer.
+         *
+         * The IFD must already be present in a TIFF opened for
+         * update (mode @c r+).  Only the tiles or strips
+         * intersecting the region are rewritten.  The existing
+         * content of each is read and merged with the source
+         * region, and the tile is encoded again.  libtiff writes the
+         * tile over its old data if it fits, or appends it to the
+         * end of the file otherwise.  Only the tile offsets and byte
+         * counts of the IFD are then rewritten in place.  All other
+         * tiles and tags are left untouched.
+         *
+         * The source pixel buffer must match the size of the region
+         * being written, with all samples, and must have the same
+         * pixel type as the TIFF image.  Any storage order is
+         * accepted.  Images with recorded tile checksums or tile
+         * statistics may not be updated, since these would no longer
+         * match the updated tiles.
+         *
+         * @param source the source pixel buffer.
+         * @param x the @c X coordinate of the upper-left corner of the sub-image.
+         * @param y the @c Y coordinate of the upper-left corner of the sub-image.
+         * @param w the width of the sub-image.
+         * @param h the height of the sub-image.
+         * @throws Exception if the IFD is not present in the file,
+         * may not be updated, or the region or pixel buffer is
+         * invalid.
+         */
+        void
+        updateImage(const VariantPixelBuffer& source,
+                    dimension_size_type       x,
+                    dimension_size_type       y,
+                    dimension_size_type       w,
+                    dimension_size_type       h);
+
+        /**
+         * Check if the compressed tiles of another IFD may be copied.
+         *
+         * The tiles may be copied if the encoded data would be
+         * identical, which requires the image size, tile type and
+         * size, pixel type, samples, planar configuration,
+         * photometric interpretation, compression, predictor, fill
+         * order and, for samples larger than a byte, byte order to
+         * match.  JPEG compression is excluded, since the tiles
+         * depend upon tables stored in the directory.  No image data
+         * may have been written to this IFD.
+         *
+         * @param source the IFD to copy from.
+         * @returns @c true if copyRawTiles() may be used, or @c false
+         * if the image must be decoded and encoded again.
+         */
+        bool
+        canCopyRawTiles(const IFD& source) const;
+
+        /**
+         * Copy the compressed tiles of another IFD.
+         *
+         * The encoded data for each tile or strip is read from the
+         * source and written to this IFD without decoding and
+         * encoding it again.  Tiles which are missing from the
+         * source are not written.
+         *
+         * @param source the IFD to copy from.
+         * @throws Exception if the tiles may not be copied (see
+         * canCopyRawTiles()), or could not be read or written.
+         */
+        void
+        copyRawTiles(const IFD& source);
+
+        /**
+         * Reserve space in the file for the image data.
+         *
+         * Every tile or strip is written immediately as zeros, so
+         * that its position in the file is fixed.  The returned
+         * layout may then be used to write the pixel data directly
+         * into a writable mapping of the file, concurrently and
+         * without further use of this IFD.  All tiles are marked as
+         * written, so that any later writes to this IFD are
+         * discarded.
+         *
+         * If an alignment is specified, the file is padded with
+         * zeros so that every tile or strip, and the data following
+         * the last tile or strip, start at a multiple of the
+         * alignment.  Each tile or strip may then be written with
+         * direct I/O, rounded up to a whole number of aligned
+         * blocks, without overwriting other data.
+         *
+         * @param alignment the alignment of each tile or strip
+         * (bytes), or 0 for no alignment.
+         * @returns the layout of the reserved image data.
+         * @throws Exception if the image is compressed, has samples
+         * which are not a whole number of bytes, uses a byte order
+         * other than the native byte order, already has data
+         * written, or could not be written.
+         */
+        std::shared_ptr<const ImageLayout>
+        reserveImage(dimension_size_type alignment = 0U);
+
         /**
          * Get next directory.
          *
@@ -0,0 +1,251 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include <boost/iostreams/device/mapped_file.hpp>
+
+#include <ome/files/config-internal.h>
+#include <ome/files/tiff/IOSource.h>
+
+#ifdef OME_HAVE_POSIX_MADVISE
+# include <sys/mman.h>
+#endif // OME_HAVE_POSIX_MADVISE
+
+#ifdef OME_HAVE_RUSAGE_THREAD
+# include <sys/resource.h>
+#endif // OME_HAVE_RUSAGE_THREAD
+
+namespace ome
+{
+  namespace files
+  {
+    namespace tiff
+    {
+
+      IOSource::IOSource()
+      {
+      }
+
+      IOSource::~IOSource()
+      {
+      }
+
+      std::future<std::size_t>
+      IOSource::readAsync(uint64_t    offset,
+                          void       *buffer,
+                          std::size_t size)
+      {
+        return std::async(std::launch::deferred,
+                          [this, offset, buffer, size]()
+                          {
+                            return read(offset, buffer, size);
+                          });
+      }
+
+      void
+      IOSource::prefetch(const std::vector<range_type>& /* ranges */)
+      {
+      }
+
+      void
+      IOSource::advise(AccessHint                     hint,
+                       const std::vector<range_type>& ranges)
+      {
+        if (hint == HINT_WILLNEED && !ranges.empty())
+          prefetch(ranges);
+      }
+
+      const char *
+      IOSource::data() const
+      {
+        return nullptr;
+      }
+
+      void
+      IOSource::setStatistics(const std::shared_ptr<IOStatistics>& /* statistics */)
+      {
+      }
+
+      /**
+       * Internal implementation details of MappedFileSource.
+       */
+      class MappedFileSource::Impl
+      {
+      public:
+        /// The filename.
+        boost::filesystem::path filename;
+        /// The file mapping.
+        boost::iostreams::mapped_file_source map;
+        /// Statistics to update (accessed atomically).
+        std::shared_ptr<IOStatistics> statistics;
+
+        /**
+         * Constructor.
+         *
+         * @param filename the file to map.
+         */
+        Impl(const boost::filesystem::path& filename):
+          filename(filename),
+          map(filename),
+          statistics()
+        {
+          if (!map.is_open())
+            throw std::runtime_error("Failed to map file " + filename.string());
+        }
+      };
+
+      MappedFileSource::MappedFileSource(const boost::filesystem::path& filename):
+        IOSource(),
+        impl(new Impl(filename))
+      {
+      }
+
+      MappedFileSource::~MappedFileSource()
+      {
+      }
+
+      std::string
+      MappedFileSource::name() const
+      {
+        return impl->filename.string();
+      }
+
+      uint64_t
+      MappedFileSource::size() const
+      {
+        return static_cast<uint64_t>(impl->map.size());
+      }
+
+      std::size_t
+      MappedFileSource::read(uint64_t    offset,
+                             void       *buffer,
+                             std::size_t size)
+      {
+        uint64_t mapsize = this->size();
+        if (offset >= mapsize)
+          return 0U;
+        std::size_t count = static_cast<std::size_t>(std::min(static_cast<uint64_t>(size), mapsize - offset));
+
+#ifdef OME_HAVE_RUSAGE_THREAD
+        // The faults taken by this thread during the copy are those
+        // touching the mapping.
+        std::shared_ptr<IOStatistics> statistics(std::atomic_load(&impl->statistics));
+        struct rusage before;
+        if (statistics && getrusage(RUSAGE_THREAD, &before))
+          statistics.reset();
+#endif // OME_HAVE_RUSAGE_THREAD
+
+        std::memcpy(buffer, impl->map.data() + offset, count);
+
+#ifdef OME_HAVE_RUSAGE_THREAD
+        struct rusage after;
+        if (statistics && !getrusage(RUSAGE_THREAD, &after))
+          {
+            statistics->add(IOStatistics::MINOR_PAGE_FAULTS,
+                            static_cast<uint64_t>(after.ru_minflt - before.ru_minflt));
+            statistics->add(IOStatistics::MAJOR_PAGE_FAULTS,
+                            static_cast<uint64_t>(after.ru_majflt - before.ru_majflt));
+          }
+#endif // OME_HAVE_RUSAGE_THREAD
+
+        return count;
+      }
+
+      void
+      MappedFileSource::advise(AccessHint                     hint,
+                               const std::vector<range_type>& ranges)
+      {
+#ifdef OME_HAVE_POSIX_MADVISE
+        int advice = POSIX_MADV_NORMAL;
+        switch (hint)
+          {
+          case HINT_NORMAL:
+            advice = POSIX_MADV_NORMAL;
+            break;
+          case HINT_SEQUENTIAL:
+            advice = POSIX_MADV_SEQUENTIAL;
+            break;
+          case HINT_RANDOM:
+            advice = POSIX_MADV_RANDOM;
+            break;
+          case HINT_WILLNEED:
+            advice = POSIX_MADV_WILLNEED;
+            break;
+          }
+
+        char *base = const_cast<char *>(impl->map.data());
+        uint64_t mapsize = size();
+        if (ranges.empty() || hint != HINT_WILLNEED)
+          {
+            // Advisory only; failure is ignored.
+            posix_madvise(base, static_cast<std::size_t>(mapsize), advice);
+            return;
+          }
+
+        // The advised address must be page aligned.
+        const uint64_t page = static_cast<uint64_t>(boost::iostreams::mapped_file_source::alignment());
+        for (const auto& range : ranges)
+          {
+            if (range.first >= mapsize || !range.second)
+              continue;
+            uint64_t begin = (range.first / page) * page;
+            uint64_t end = std::min(range.first + range.second, mapsize);
+            posix_madvise(base + begin, static_cast<std::size_t>(end - begin), advice);
+          }
+#else // ! OME_HAVE_POSIX_MADVISE
+        IOSource::advise(hint, ranges);
+#endif // OME_HAVE_POSIX_MADVISE
+      }
+
+      const char *
+      MappedFileSource::data() const
+      {
+        return impl->map.data();
+      }
+
+      void
+      MappedFileSource::setStatistics(const std::shared_ptr<IOStatistics>& statistics)
+      {
+        std::atomic_store(&impl->statistics, statistics);
+      }
+
+    }
+  }
+}
@@ -0,0 +1,293 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#ifndef OME_FILES_TIFF_IOSOURCE_H
+#define OME_FILES_TIFF_IOSOURCE_H
+
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/filesystem/path.hpp>
+
+#include <ome/files/IOStatistics.h>
+#include <ome/files/Types.h>
+
+namespace ome
+{
+  namespace files
+  {
+    namespace tiff
+    {
+
+      /**
+       * Source of TIFF data for reading.
+       *
+       * An IOSource provides random access to the content of a TIFF
+       * file.  It may be used in place of a filename when opening a
+       * TIFF for reading, to read from storage other than a local
+       * file, or to add caching or coalescing of reads.  Each libtiff
+       * handle opened on a source keeps its own position, and
+       * several handles may be reading from the same source
+       * concurrently, so implementations must be thread safe.
+       */
+      class IOSource
+      {
+      public:
+        /// A byte range, as an offset and size.
+        typedef std::pair<uint64_t, std::size_t> range_type;
+
+      public:
+        /// Constructor.
+        IOSource();
+
+        /// Destructor.
+        virtual
+        ~IOSource();
+
+        /// @cond SKIP
+        IOSource (const IOSource&) = delete;
+
+        IOSource&
+        operator= (const IOSource&) = delete;
+        /// @endcond SKIP
+
+        /**
+         * Get the name of the source.
+         *
+         * This is used for diagnostic messages only.
+         *
+         * @returns the name.
+         */
+        virtual
+        std::string
+        name() const = 0;
+
+        /**
+         * Get the size of the source.
+         *
+         * @returns the size in bytes.
+         */
+        virtual
+        uint64_t
+        size() const = 0;
+
+        /**
+         * Read data at an offset.
+         *
+         * This must be safe to call concurrently from multiple
+         * threads.
+         *
+         * @param offset the offset to read from.
+         * @param buffer the buffer to read into.
+         * @param size the number of bytes to read.
+         * @returns the number of bytes read, which will be less than
+         * @c size only at the end of the source.
+         * @throws std::exception on failure.
+         */
+        virtual
+        std::size_t
+        read(uint64_t    offset,
+             void       *buffer,
+             std::size_t size) = 0;
+
+        /**
+         * Read data at an offset asynchronously.
+         *
+         * The default implementation defers to read() when the
+         * result is requested.  Sources with native support for
+         * asynchronous requests may override this.
+         *
+         * @param offset the offset to read from.
+         * @param buffer the buffer to read into; this must remain
+         * valid until the result is available.
+         * @param size the number of bytes to read.
+         * @returns the number of bytes read.
+         */
+        virtual
+        std::future<std::size_t>
+        readAsync(uint64_t    offset,
+                  void       *buffer,
+                  std::size_t size);
+
+        /**
+         * Hint that data will shortly be read.
+         *
+         * Sources with a high per-request latency may use this to
+         * fetch the ranges ahead of the reads, for example by
+         * merging neighbouring ranges into fewer larger requests and
+         * issuing them concurrently.  This is advisory only; failure
+         * to fetch is not reported here, but by the subsequent
+         * read().  The default implementation does nothing.
+         *
+         * @param ranges the byte ranges which will be read.
+         */
+        virtual
+        void
+        prefetch(const std::vector<range_type>& ranges);
+
+        /**
+         * Advise the source of the expected access pattern.
+         *
+         * Sources may use this to adjust readahead or caching.
+         * Sequential and random advice apply to subsequent reads of
+         * the whole source; advice that data will be needed applies
+         * to the specified ranges only.  This is advisory only.  The
+         * default implementation passes ranges which will be needed
+         * to prefetch(), and ignores other advice.
+         *
+         * @param hint the expected access pattern.
+         * @param ranges the byte ranges to which the advice applies;
+         * if empty, the whole source.
+         */
+        virtual
+        void
+        advise(AccessHint                     hint,
+               const std::vector<range_type>& ranges);
+
+        /**
+         * Get the source content as contiguous memory, if available.
+         *
+         * Sources which are memory resident, or memory mapped, may
+         * return the content here, which allows libtiff to read data
+         * directly from it without copying.  The default
+         * implementation returns null.
+         *
+         * @returns the content, or null if not available.
+         */
+        virtual
+        const char *
+        data() const;
+
+        /**
+         * Set the statistics to update when reading.
+         *
+         * Sources may use this to report costs incurred by reads
+         * which are not otherwise visible to the caller, such as
+         * page faults.  A TIFF sets its own statistics on its
+         * source, so where a source is shared by several TIFF
+         * instances, the statistics last set are updated.  The
+         * default implementation does nothing.
+         *
+         * @param statistics the statistics to update, or null to
+         * stop updating statistics.
+         */
+        virtual
+        void
+        setStatistics(const std::shared_ptr<IOStatistics>& statistics);
+      };
+
+      /**
+       * Memory mapped file source.
+       *
+       * The whole file is mapped read-only.  Where supported, the
+       * page faults taken while copying data in read() are counted
+       * in the statistics set with setStatistics().
+       */
+      class MappedFileSource : public IOSource
+      {
+      private:
+        class Impl;
+        /// Private implementation details.
+        std::unique_ptr<Impl> impl;
+
+      public:
+        /**
+         * Constructor.
+         *
+         * @param filename the file to map.
+         * @throws std::exception if the file could not be mapped.
+         */
+        explicit
+        MappedFileSource(const boost::filesystem::path& filename);
+
+        /// Destructor.
+        virtual
+        ~MappedFileSource();
+
+        // Documented in superclass.
+        std::string
+        name() const;
+
+        // Documented in superclass.
+        uint64_t
+        size() const;
+
+        // Documented in superclass.
+        std::size_t
+        read(uint64_t    offset,
+             void       *buffer,
+             std::size_t size);
+
+        // Documented in superclass.
+        void
+        advise(AccessHint                     hint,
+               const std::vector<range_type>& ranges);
+
+        // Documented in superclass.
+        const char *
+        data() const;
+
+        // Documented in superclass.
+        void
+        setStatistics(const std::shared_ptr<IOStatistics>& statistics);
+      };
+
+      /**
+       * Factory to create an IOSource for a filename.
+       *
+       * Readers may use this to open TIFFs by name from an
+       * alternative source.  If null is returned, the file will be
+       * opened directly.
+       */
+      typedef std::function<std::shared_ptr<IOSource>(const boost::filesystem::path& filename)> IOSourceFactory;
+
+    }
+  }
+}
+
+#endif // OME_FILES_TIFF_IOSOURCE_H
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
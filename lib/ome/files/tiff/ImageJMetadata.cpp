@@ -62,14 +62,42 @@ namespace ome
 	const int LUTS =         0x6c757473;  // "luts" (channel LUTs)
       }
 
-      ImageJMetadata::ImageJMetadata(const IFD& ifd)
+      ImageJMetadata::ImageJMetadata(const IFD& ifd):
+        map(),
+        counts(),
+        data(),
+        images(1U),
+        slices(1U),
+        frames(1U),
+        channels(1U),
+        unit(),
+        spacing(1.0),
+        finterval(0.0),
+        xorigin(0U),
+        yorigin(0U),
+        mode(),
+        loop(false)
       {
-        ifd.getField(IMAGEJ_META_DATA_BYTE_COUNTS).get(counts);
-        ifd.getField(IMAGEJ_META_DATA).get(data);
         std::string desc;
         ifd.getField(IMAGEDESCRIPTION).get(desc);
         map = parse_imagedescription(desc);
 
+        // ImageJ only writes the metadata tags if there are labels,
+        // display ranges or lookup tables to store, so the
+        // ImageDescription is sufficient to identify ImageJ images.
+        try
+          {
+            ifd.getField(IMAGEJ_META_DATA_BYTE_COUNTS).get(counts);
+            ifd.getField(IMAGEJ_META_DATA).get(data);
+          }
+        catch (const Exception&)
+          {
+            counts.clear();
+            data.clear();
+            if (map.find("ImageJ") == map.end())
+              throw;
+          }
+
         parse_value("images", images);
         parse_value("channels", channels);
         parse_value("slices", slices);
@@ -83,6 +111,14 @@ namespace ome
         parse_value("loop", loop);
       }
 
+      bool
+      ImageJMetadata::isContiguousStack(const IFD&          ifd,
+                                        dimension_size_type ifdcount) const
+      {
+        return (ifdcount < images &&
+                ifd.getContiguousPlaneCount() >= images);
+      }
+
       std::map<std::string,std::string>
       ImageJMetadata::parse_imagedescription(const std::string& description)
       {
@@ -61,9 +61,9 @@ namespace ome
       {
         /// Map of key-value pairs from ImageDescription field.
         std::map<std::string, std::string> map;
-        /// Content of ImageJMetaDataByteCounts field.
+        /// Content of ImageJMetaDataByteCounts field (empty if not present).
         std::vector<uint32_t> counts;
-        /// Content of ImageJMetaData field.
+        /// Content of ImageJMetaData field (empty if not present).
         std::vector<uint8_t> data;
         /// Total number of images.
         dimension_size_type images;
@@ -96,6 +96,25 @@ namespace ome
          */
         ImageJMetadata(const IFD& ifd);
 
+        /**
+         * Check if the images are stored as a contiguous stack.
+         *
+         * ImageJ stores stacks larger than 4 GiB as uncompressed
+         * planes laid end to end after the image data of the first
+         * IFD, without IFDs for the following planes.  The stack is
+         * contiguous if there are fewer IFDs than images, and all
+         * the images fit in the file following the first IFD's
+         * image data.
+         *
+         * @param ifd the first IFD.
+         * @param ifdcount the number of IFDs in the TIFF.
+         * @returns @c true if the images are stored contiguously,
+         * otherwise @c false.
+         */
+        bool
+        isContiguousStack(const IFD&          ifd,
+                          dimension_size_type ifdcount) const;
+
         /**
          * Parse the TIFF ImageDescription field content.
          *
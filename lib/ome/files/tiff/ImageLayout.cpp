@@ -0,0 +1,365 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#include <boost/format.hpp>
+
+#include <ome/files/PixelBufferView.h>
+#include <ome/files/PlaneRegion.h>
+#include <ome/files/TileBuffer.h>
+#include <ome/files/tiff/Exception.h>
+#include <ome/files/tiff/IFD.h>
+#include <ome/files/tiff/ImageLayout.h>
+
+#include <tiffio.h>
+
+using ome::xml::model::enums::PixelType;
+
+namespace ome
+{
+  namespace files
+  {
+    namespace tiff
+    {
+
+      namespace
+      {
+
+        // Get a zeroed, aligned scratch buffer of at least the
+        // specified size for the calling thread, for assembling
+        // tiles or strips for direct writes.
+        TileBuffer&
+        directTileBuffer(dimension_size_type size,
+                         dimension_size_type alignment)
+        {
+          thread_local std::unique_ptr<TileBuffer> scratch;
+
+          if (!scratch || scratch->size() < size)
+            scratch.reset(new TileBuffer(size, false, alignment));
+          else
+            std::memset(scratch->data(), 0, size);
+          return *scratch;
+        }
+
+        // Copy the rows of a region into the tiles or strips of the
+        // mapped file.  Whole tiles or strips are written directly
+        // if a direct write function is provided.
+        struct LayoutWriteVisitor : public boost::static_visitor<>
+        {
+          char                                     *file;
+          uint64_t                                  filesize;
+          const ImageLayout::direct_write_type&     direct;
+          dimension_size_type                       alignment;
+          const TileInfo&                           tileinfo;
+          const std::vector<IOSource::range_type>&  ranges;
+          PlanarConfiguration                       planarconfig;
+          uint16_t                                  samples;
+          const PlaneRegion&                        image;
+          const PlaneRegion&                        region;
+          const TileRange&                          tiles;
+
+          LayoutWriteVisitor(char                                     *file,
+                             uint64_t                                  filesize,
+                             const ImageLayout::direct_write_type&     direct,
+                             dimension_size_type                       alignment,
+                             const TileInfo&                           tileinfo,
+                             const std::vector<IOSource::range_type>&  ranges,
+                             PlanarConfiguration                       planarconfig,
+                             uint16_t                                  samples,
+                             const PlaneRegion&                        image,
+                             const PlaneRegion&                        region,
+                             const TileRange&                          tiles):
+            file(file),
+            filesize(filesize),
+            direct(direct),
+            alignment(alignment),
+            tileinfo(tileinfo),
+            ranges(ranges),
+            planarconfig(planarconfig),
+            samples(samples),
+            image(image),
+            region(region),
+            tiles(tiles)
+          {
+          }
+
+          template<typename T>
+          void
+          operator()(const std::shared_ptr<T>& buffer)
+          {
+            typedef typename T::value_type value_type;
+
+            const uint16_t copysamples = planarconfig == SEPARATE ? 1U : samples;
+            PixelBufferView<const value_type> view(*buffer);
+
+            typename T::indices_type srcidx;
+            srcidx[DIM_SPATIAL_X] = srcidx[DIM_SPATIAL_Y] = srcidx[DIM_SUBCHANNEL] =
+              srcidx[DIM_SPATIAL_Z] = srcidx[DIM_TEMPORAL_T] = srcidx[DIM_CHANNEL] =
+              srcidx[DIM_MODULO_Z] = srcidx[DIM_MODULO_T] = srcidx[DIM_MODULO_C] = 0;
+
+            for (const auto tile : tiles)
+              {
+                PlaneRegion rfull = tileinfo.tileRegion(tile);
+                PlaneRegion rclip = tileinfo.tileRegion(tile, region);
+                if (!rclip.area())
+                  continue;
+
+                const IOSource::range_type& range(ranges.at(tile));
+                const uint64_t rangeend = std::min(range.first + range.second, filesize);
+                const std::size_t rowsize = rclip.w * copysamples * sizeof(value_type);
+
+                srcidx[DIM_SUBCHANNEL] = planarconfig == SEPARATE ? tileinfo.tileSample(tile) : 0U;
+                srcidx[DIM_SPATIAL_X] = rclip.x - region.x;
+
+                // Write whole tiles or strips directly.  Any part of
+                // the tile outside the image is written as zeros.
+                if (direct && alignment && !(range.first % alignment) &&
+                    rclip.area() == (rfull & image).area())
+                  {
+                    const std::size_t writesize = ((range.second + alignment - 1U) / alignment) * alignment;
+                    if (range.first + writesize > filesize)
+                      {
+                        boost::format fmt("Tile or strip %1% lies outside the reserved image data");
+                        fmt % tile;
+                        throw Exception(fmt.str());
+                      }
+
+                    TileBuffer& buf(directTileBuffer(writesize, alignment));
+                    for (dimension_size_type row = rclip.y;
+                         row < rclip.y + rclip.h;
+                         ++row)
+                      {
+                        const std::size_t offset = (row - rfull.y) * rfull.w * copysamples * sizeof(value_type);
+                        srcidx[DIM_SPATIAL_Y] = row - region.y;
+                        std::memcpy(buf.data() + offset, view.pointer(srcidx), rowsize);
+                      }
+                    direct(range.first, buf.data(), writesize);
+                    continue;
+                  }
+
+                for (dimension_size_type row = rclip.y;
+                     row < rclip.y + rclip.h;
+                     ++row)
+                  {
+                    const uint64_t offset = range.first +
+                      (((row - rfull.y) * rfull.w + (rclip.x - rfull.x)) *
+                       copysamples * sizeof(value_type));
+                    if (offset + rowsize > rangeend)
+                      {
+                        boost::format fmt("Row %1% of tile or strip %2% lies outside the reserved image data");
+                        fmt % row % tile;
+                        throw Exception(fmt.str());
+                      }
+
+                    srcidx[DIM_SPATIAL_Y] = row - region.y;
+                    std::memcpy(file + offset, view.pointer(srcidx), rowsize);
+                  }
+              }
+          }
+        };
+
+      }
+
+      /**
+       * Internal implementation details of ImageLayout.
+       */
+      class ImageLayout::Impl
+      {
+      public:
+        /// Tiling metadata.
+        TileInfo tileinfo;
+        /// Image width.
+        uint32_t width;
+        /// Image height.
+        uint32_t height;
+        /// Pixel type.
+        PixelType pixeltype;
+        /// Samples per pixel.
+        uint16_t samples;
+        /// Planar configuration.
+        PlanarConfiguration planarconfig;
+        /// Tile or strip byte ranges.
+        std::vector<IOSource::range_type> ranges;
+
+        /// Constructor.
+        Impl(const IFD& ifd):
+          tileinfo(ifd.getTileInfo()),
+          width(ifd.getImageWidth()),
+          height(ifd.getImageHeight()),
+          pixeltype(ifd.getPixelType()),
+          samples(ifd.getSamplesPerPixel()),
+          planarconfig(ifd.getPlanarConfiguration()),
+          ranges()
+        {
+        }
+      };
+
+      ImageLayout::ImageLayout(const IFD&                               ifd,
+                               const std::vector<IOSource::range_type>& ranges):
+        impl(std::make_shared<Impl>(ifd))
+      {
+        if (ifd.getCompression() != COMPRESSION_NONE)
+          throw Exception("Image layout is only defined for uncompressed images");
+        if (ifd.getBitsPerSample() % 8U)
+          throw Exception("Image layout is only defined for samples of whole bytes");
+        if (ranges.size() != impl->tileinfo.tileCount())
+          {
+            boost::format fmt("Image layout has %1% ranges for %2% tiles or strips");
+            fmt % ranges.size() % impl->tileinfo.tileCount();
+            throw Exception(fmt.str());
+          }
+        impl->ranges = ranges;
+      }
+
+      ImageLayout::~ImageLayout()
+      {
+      }
+
+      const TileInfo&
+      ImageLayout::getTileInfo() const
+      {
+        return impl->tileinfo;
+      }
+
+      IOSource::range_type
+      ImageLayout::getRange(dimension_size_type strile) const
+      {
+        if (strile >= impl->ranges.size())
+          return IOSource::range_type(0U, 0U);
+        return impl->ranges[strile];
+      }
+
+      uint64_t
+      ImageLayout::getEnd() const
+      {
+        uint64_t end = 0U;
+        for (const auto& range : impl->ranges)
+          end = std::max(end, range.first + range.second);
+        return end;
+      }
+
+      void
+      ImageLayout::writeImage(char                      *file,
+                              uint64_t                   filesize,
+                              const VariantPixelBuffer&  source,
+                              dimension_size_type        x,
+                              dimension_size_type        y,
+                              dimension_size_type        w,
+                              dimension_size_type        h) const
+      {
+        writeImage(file, filesize, direct_write_type(), 0U, source, x, y, w, h);
+      }
+
+      void
+      ImageLayout::writeImage(char                      *file,
+                              uint64_t                   filesize,
+                              const direct_write_type&   direct,
+                              dimension_size_type        alignment,
+                              const VariantPixelBuffer&  source,
+                              dimension_size_type        x,
+                              dimension_size_type        y,
+                              dimension_size_type        w,
+                              dimension_size_type        h) const
+      {
+        const dimension_size_type width = impl->width;
+        const dimension_size_type height = impl->height;
+        if (!w || !h || x > width || w > width - x || y > height || h > height - y)
+          {
+            boost::format fmt("Invalid region %1%x%2% at %3%,%4% for image size %5%x%6%");
+            fmt % w % h % x % y % width % height;
+            throw Exception(fmt.str());
+          }
+
+        std::array<VariantPixelBuffer::size_type, 9> shape, source_shape;
+        shape[DIM_SPATIAL_X] = w;
+        shape[DIM_SPATIAL_Y] = h;
+        shape[DIM_SUBCHANNEL] = impl->samples;
+        shape[DIM_SPATIAL_Z] = shape[DIM_TEMPORAL_T] = shape[DIM_CHANNEL] =
+          shape[DIM_MODULO_Z] = shape[DIM_MODULO_T] = shape[DIM_MODULO_C] = 1;
+
+        const VariantPixelBuffer::size_type *source_shape_ptr(source.shape());
+        std::copy(source_shape_ptr, source_shape_ptr + PixelBufferBase::dimensions,
+                  source_shape.begin());
+
+        PixelBufferBase::storage_order_type order(PixelBufferBase::make_storage_order(ome::xml::model::enums::DimensionOrder::XYZTC, impl->planarconfig == SEPARATE ? false : true));
+
+        if (impl->pixeltype != source.pixelType())
+          {
+            boost::format fmt("VariantPixelBuffer %1% pixel type is incompatible with TIFF %2% sample format and bit depth");
+            fmt % source.pixelType() % impl->pixeltype;
+            throw Exception(fmt.str());
+          }
+
+        if (shape != source_shape)
+          {
+            boost::format fmt("VariantPixelBuffer dimensions (%1%×%2%, %3% samples) incompatible with TIFF image size (%4%×%5%, %6% samples)");
+            fmt % source_shape[DIM_SPATIAL_X] % source_shape[DIM_SPATIAL_Y] % source_shape[DIM_SUBCHANNEL];
+            fmt % shape[DIM_SPATIAL_X] % shape[DIM_SPATIAL_Y] % shape[DIM_SUBCHANNEL];
+            throw Exception(fmt.str());
+          }
+
+        if (!(order == source.storage_order()))
+          {
+            // Convert to the storage order required by the planar
+            // configuration.
+            VariantPixelBuffer converted(shape, impl->pixeltype, order, PIXEL_UNINITIALIZED);
+            converted = source;
+            writeImage(file, filesize, direct, alignment, converted, x, y, w, h);
+            return;
+          }
+
+        PlaneRegion image(0U, 0U, width, height);
+        PlaneRegion region(x, y, w, h);
+        const TileRange tiles(impl->tileinfo.tileRange(region));
+
+        LayoutWriteVisitor v(file, filesize, direct, alignment, impl->tileinfo, impl->ranges,
+                             impl->planarconfig, impl->samples, image, region, tiles);
+        boost::apply_visitor(v, source.vbuffer());
+      }
+
+    }
+  }
+}
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
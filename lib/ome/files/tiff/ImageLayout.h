@@ -0,0 +1,221 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#ifndef OME_FILES_TIFF_IMAGELAYOUT_H
+#define OME_FILES_TIFF_IMAGELAYOUT_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <ome/files/Types.h>
+#include <ome/files/VariantPixelBuffer.h>
+#include <ome/files/tiff/IOSource.h>
+#include <ome/files/tiff/TileInfo.h>
+#include <ome/files/tiff/Types.h>
+
+namespace ome
+{
+  namespace files
+  {
+    namespace tiff
+    {
+
+      class IFD;
+
+      /**
+       * Layout of the reserved, uncompressed image data of an IFD.
+       *
+       * The image geometry and the byte range of every tile or
+       * strip are recorded on construction.  Thereafter, pixel data
+       * is copied directly into a writable mapping of the file,
+       * needing no libtiff state and no lock.  Regions which do not
+       * overlap may be written concurrently from several threads.
+       *
+       * Layouts are created by IFD::reserveImage().
+       *
+       * This class is thread-safe.
+       */
+      class ImageLayout
+      {
+      public:
+        /**
+         * Positional write of aligned data.
+         *
+         * Called with the file offset, the data and its size.  The
+         * offset, data and size are aligned to the alignment given
+         * to writeImage().
+         */
+        typedef std::function<void (uint64_t       offset,
+                                    const uint8_t *data,
+                                    std::size_t    size)> direct_write_type;
+
+      private:
+        class Impl;
+        /// Private implementation details.
+        std::shared_ptr<Impl> impl;
+
+      public:
+        /**
+         * Constructor.
+         *
+         * @param ifd the IFD containing the image.
+         * @param ranges the byte range of each tile or strip.
+         * @throws an Exception if the image is compressed, has
+         * samples which are not a whole number of bytes, or the
+         * number of ranges does not match the number of tiles or
+         * strips.
+         */
+        ImageLayout(const IFD&                               ifd,
+                    const std::vector<IOSource::range_type>& ranges);
+
+        /// Destructor.
+        ~ImageLayout();
+
+      private:
+        /// @cond SKIP
+        ImageLayout (const ImageLayout&) = delete;
+
+        ImageLayout&
+        operator= (const ImageLayout&) = delete;
+        /// @endcond SKIP
+
+      public:
+        /**
+         * Get tiling metadata.
+         *
+         * @returns the tiling metadata of the image.
+         */
+        const TileInfo&
+        getTileInfo() const;
+
+        /**
+         * Get the byte range of a tile or strip.
+         *
+         * @param strile the tile or strip index.
+         * @returns the offset and size of the reserved data, or an
+         * empty range if the index is invalid.
+         */
+        IOSource::range_type
+        getRange(dimension_size_type strile) const;
+
+        /**
+         * Get the end of the reserved image data.
+         *
+         * @returns the offset of the byte following the last tile
+         * or strip.
+         */
+        uint64_t
+        getEnd() const;
+
+        /**
+         * Write a region of the image.
+         *
+         * Each row of the region is copied to its position within
+         * the tiles or strips it intersects.  The source buffer
+         * requirements are the same as for IFD::writeImage().
+         *
+         * @param file the start of a writable mapping of the file.
+         * @param filesize the size of the mapping.
+         * @param source the source pixel data.
+         * @param x the @c X coordinate of the region.
+         * @param y the @c Y coordinate of the region.
+         * @param w the width of the region.
+         * @param h the height of the region.
+         * @throws an Exception if the source is incompatible with
+         * the image, or the region is invalid or lies outside the
+         * mapping.
+         */
+        void
+        writeImage(char                      *file,
+                   uint64_t                   filesize,
+                   const VariantPixelBuffer&  source,
+                   dimension_size_type        x,
+                   dimension_size_type        y,
+                   dimension_size_type        w,
+                   dimension_size_type        h) const;
+
+        /**
+         * Write a region of the image, writing whole tiles or strips directly.
+         *
+         * Each tile or strip which lies wholly within the region is
+         * assembled in an aligned buffer, rounded up to a whole
+         * number of aligned blocks, and written with @p direct, for
+         * example using direct I/O to bypass the page cache.  This
+         * requires the tiles or strips to have been reserved with
+         * the same alignment (see IFD::reserveImage()).  Tiles or
+         * strips which are partly within the region, or which are
+         * not aligned, are copied into the mapping as for
+         * writeImage().
+         *
+         * @param file the start of a writable mapping of the file.
+         * @param filesize the size of the mapping.
+         * @param direct the function to write whole tiles or strips.
+         * @param alignment the alignment of each direct write (bytes).
+         * @param source the source pixel data.
+         * @param x the @c X coordinate of the region.
+         * @param y the @c Y coordinate of the region.
+         * @param w the width of the region.
+         * @param h the height of the region.
+         * @throws an Exception if the source is incompatible with
+         * the image, or the region is invalid or lies outside the
+         * mapping.
+         */
+        void
+        writeImage(char                      *file,
+                   uint64_t                   filesize,
+                   const direct_write_type&   direct,
+                   dimension_size_type        alignment,
+                   const VariantPixelBuffer&  source,
+                   dimension_size_type        x,
+                   dimension_size_type        y,
+                   dimension_size_type        w,
+                   dimension_size_type        h) const;
+      };
+
+    }
+  }
+}
+
+#endif // OME_FILES_TIFF_IMAGELAYOUT_H
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
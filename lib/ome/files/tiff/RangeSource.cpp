@@ -0,0 +1,452 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <future>
+#include <iterator>
+#include <list>
+#include <mutex>
+#include <stdexcept>
+#include <system_error>
+#include <unordered_map>
+
+#include <ome/files/tiff/RangeSource.h>
+
+namespace ome
+{
+  namespace files
+  {
+    namespace tiff
+    {
+
+      /**
+       * Internal implementation details of RangeSource.
+       */
+      class RangeSource::Impl
+      {
+      public:
+        /// Cached block data.
+        typedef std::shared_ptr<const std::vector<char>> block_ptr;
+        /// Pending block fetch.
+        typedef std::shared_ptr<std::promise<block_ptr>> promise_ptr;
+
+        /// Cache entry.
+        struct Entry
+        {
+          /// Block data.
+          block_ptr data;
+          /// Position in the LRU list.
+          std::list<uint64_t>::iterator pos;
+        };
+
+        /// The source name.
+        std::string name;
+        /// The source size.
+        uint64_t size;
+        /// The range fetch function.
+        fetch_type fetch;
+        /// Block size.
+        std::size_t blocksize;
+        /// Maximum cache size.
+        std::size_t cachesize;
+        /// Maximum concurrent fetches.
+        std::size_t concurrency;
+        /// Maximum merged request size, in blocks.
+        std::size_t maxrequestblocks;
+        /// Mutex protecting the cache and pending fetches.
+        std::mutex mutex;
+        /// Block indices, least recently used first.
+        std::list<uint64_t> lru;
+        /// Cached blocks.
+        std::unordered_map<uint64_t, Entry> blocks;
+        /// Blocks being fetched.
+        std::unordered_map<uint64_t, std::shared_future<block_ptr>> pending;
+        /// Size of the cached blocks.
+        std::size_t cached;
+        /// Number of fetch requests made.
+        std::atomic<uint64_t> fetches;
+
+        /**
+         * Constructor.
+         *
+         * @param name the source name.
+         * @param size the source size.
+         * @param fetch the range fetch function.
+         * @param blocksize the block size.
+         * @param cachesize the maximum cache size.
+         * @param concurrency the maximum concurrent fetches.
+         * @param maxrequest the maximum merged request size.
+         */
+        Impl(const std::string& name,
+             uint64_t           size,
+             const fetch_type&  fetch,
+             std::size_t        blocksize,
+             std::size_t        cachesize,
+             std::size_t        concurrency,
+             std::size_t        maxrequest):
+          name(name),
+          size(size),
+          fetch(fetch),
+          blocksize(blocksize ? blocksize : 1U),
+          cachesize(cachesize),
+          concurrency(concurrency ? concurrency : 1U),
+          maxrequestblocks(std::max(maxrequest / this->blocksize, static_cast<std::size_t>(1U))),
+          mutex(),
+          lru(),
+          blocks(),
+          pending(),
+          cached(0U),
+          fetches(0U)
+        {
+          if (!fetch)
+            throw std::logic_error("RangeSource requires a fetch function");
+        }
+
+        /**
+         * Get the size of a block.
+         *
+         * @param index the block index.
+         * @returns the block size; this is smaller than the block
+         * size for the last block only.
+         */
+        std::size_t
+        blockSize(uint64_t index) const
+        {
+          return static_cast<std::size_t>(std::min(static_cast<uint64_t>(blocksize),
+                                                   size - (index * blocksize)));
+        }
+
+        /**
+         * Find a cached block, and mark it as recently used.
+         *
+         * @note Needs the mutex held by the caller.
+         *
+         * @param index the block index.
+         * @returns the block, or null if not cached.
+         */
+        block_ptr
+        findCached(uint64_t index)
+        {
+          auto i = blocks.find(index);
+          if (i == blocks.end())
+            return block_ptr();
+          lru.splice(lru.end(), lru, i->second.pos);
+          return i->second.data;
+        }
+
+        /**
+         * Add a block to the cache, evicting the least recently
+         * used blocks if the cache size is exceeded.
+         *
+         * @note Needs the mutex held by the caller.
+         *
+         * @param index the block index.
+         * @param data the block data.
+         */
+        void
+        insert(uint64_t         index,
+               const block_ptr& data)
+        {
+          if (blocks.find(index) != blocks.end())
+            return;
+
+          lru.push_back(index);
+          blocks.insert(std::make_pair(index, Entry{data, std::prev(lru.end())}));
+          cached += data->size();
+
+          while (cached > cachesize && lru.size() > 1U)
+            {
+              auto e = blocks.find(lru.front());
+              cached -= e->second.data->size();
+              blocks.erase(e);
+              lru.pop_front();
+            }
+        }
+
+        /**
+         * Register a pending fetch for a block.
+         *
+         * @note Needs the mutex held by the caller.
+         *
+         * @param index the block index.
+         * @returns the promise to fulfil when fetched.
+         */
+        promise_ptr
+        reserve(uint64_t index)
+        {
+          promise_ptr promise(std::make_shared<std::promise<block_ptr>>());
+          pending.insert(std::make_pair(index, promise->get_future().share()));
+          return promise;
+        }
+
+        /**
+         * Fetch a contiguous run of blocks with a single request.
+         *
+         * All blocks must have been registered with reserve().
+         * Failure is reported through the promises.
+         *
+         * @param first the index of the first block.
+         * @param promises the promises for each block in the run.
+         */
+        void
+        fetchRun(uint64_t                        first,
+                 const std::vector<promise_ptr>& promises)
+        {
+          std::vector<block_ptr> data;
+          try
+            {
+              std::size_t total = 0U;
+              for (uint64_t i = 0U; i < promises.size(); ++i)
+                total += blockSize(first + i);
+
+              std::vector<char> buffer(total);
+              ++fetches;
+              std::size_t count = fetch(first * blocksize, buffer.data(), total);
+              if (count != total)
+                throw std::runtime_error("Short read from " + name);
+
+              std::size_t pos = 0U;
+              for (uint64_t i = 0U; i < promises.size(); ++i)
+                {
+                  std::size_t bsize = blockSize(first + i);
+                  data.push_back(std::make_shared<const std::vector<char>>(buffer.begin() + pos,
+                                                                           buffer.begin() + pos + bsize));
+                  pos += bsize;
+                }
+            }
+          catch (...)
+            {
+              std::exception_ptr error = std::current_exception();
+              {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (uint64_t i = 0U; i < promises.size(); ++i)
+                  pending.erase(first + i);
+              }
+              for (const auto& promise : promises)
+                promise->set_exception(error);
+              return;
+            }
+
+          {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (uint64_t i = 0U; i < promises.size(); ++i)
+              {
+                insert(first + i, data.at(i));
+                pending.erase(first + i);
+              }
+          }
+          for (uint64_t i = 0U; i < promises.size(); ++i)
+            promises.at(i)->set_value(data.at(i));
+        }
+
+        /**
+         * Get a block, fetching it if not cached.
+         *
+         * @param index the block index.
+         * @returns the block.
+         */
+        block_ptr
+        getBlock(uint64_t index)
+        {
+          std::shared_future<block_ptr> wait;
+          promise_ptr promise;
+          {
+            std::lock_guard<std::mutex> lock(mutex);
+            block_ptr data = findCached(index);
+            if (data)
+              return data;
+
+            auto p = pending.find(index);
+            if (p == pending.end())
+              {
+                promise = reserve(index);
+                p = pending.find(index);
+              }
+            wait = p->second;
+          }
+
+          if (promise)
+            fetchRun(index, std::vector<promise_ptr>(1U, promise));
+
+          return wait.get();
+        }
+      };
+
+      RangeSource::RangeSource(const std::string& name,
+                               uint64_t           size,
+                               const fetch_type&  fetch,
+                               std::size_t        blocksize,
+                               std::size_t        cachesize,
+                               std::size_t        concurrency,
+                               std::size_t        maxrequest):
+        IOSource(),
+        impl(std::make_shared<Impl>(name, size, fetch, blocksize,
+                                    cachesize, concurrency, maxrequest))
+      {
+      }
+
+      RangeSource::~RangeSource()
+      {
+      }
+
+      std::string
+      RangeSource::name() const
+      {
+        return impl->name;
+      }
+
+      uint64_t
+      RangeSource::size() const
+      {
+        return impl->size;
+      }
+
+      std::size_t
+      RangeSource::read(uint64_t    offset,
+                        void       *buffer,
+                        std::size_t size)
+      {
+        if (offset >= impl->size)
+          return 0U;
+
+        std::size_t count = static_cast<std::size_t>(std::min(static_cast<uint64_t>(size),
+                                                              impl->size - offset));
+        char *dest = static_cast<char *>(buffer);
+        uint64_t pos = offset;
+        std::size_t remaining = count;
+        while (remaining)
+          {
+            uint64_t index = pos / impl->blocksize;
+            Impl::block_ptr block(impl->getBlock(index));
+            std::size_t blockoffset = static_cast<std::size_t>(pos - (index * impl->blocksize));
+            std::size_t n = std::min(block->size() - blockoffset, remaining);
+            std::memcpy(dest, block->data() + blockoffset, n);
+            dest += n;
+            pos += n;
+            remaining -= n;
+          }
+        return count;
+      }
+
+      void
+      RangeSource::prefetch(const std::vector<range_type>& ranges)
+      {
+        // Blocks covering the ranges, in file order.
+        std::vector<uint64_t> indices;
+        for (const auto& range : ranges)
+          {
+            if (!range.second || range.first >= impl->size)
+              continue;
+            uint64_t end = std::min(range.first + range.second, impl->size);
+            for (uint64_t i = range.first / impl->blocksize;
+                 i <= (end - 1U) / impl->blocksize;
+                 ++i)
+              indices.push_back(i);
+          }
+        std::sort(indices.begin(), indices.end());
+        indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+
+        // Don't fetch more than the cache can hold, or the earliest
+        // blocks would be evicted before they are read.
+        std::size_t maxblocks = std::max(impl->cachesize / impl->blocksize,
+                                         static_cast<std::size_t>(1U));
+        if (indices.size() > maxblocks)
+          indices.resize(maxblocks);
+
+        // Merge neighbouring uncached blocks into runs.
+        std::vector<std::pair<uint64_t, std::vector<Impl::promise_ptr>>> runs;
+        {
+          std::lock_guard<std::mutex> lock(impl->mutex);
+          for (const auto index : indices)
+            {
+              if (impl->blocks.find(index) != impl->blocks.end() ||
+                  impl->pending.find(index) != impl->pending.end())
+                continue;
+
+              Impl::promise_ptr promise(impl->reserve(index));
+              if (!runs.empty() &&
+                  runs.back().first + runs.back().second.size() == index &&
+                  runs.back().second.size() < impl->maxrequestblocks)
+                runs.back().second.push_back(promise);
+              else
+                runs.push_back(std::make_pair(index, std::vector<Impl::promise_ptr>(1U, promise)));
+            }
+        }
+
+        // Issue the requests concurrently.
+        for (std::size_t batch = 0U; batch < runs.size(); batch += impl->concurrency)
+          {
+            std::size_t batchend = std::min(batch + impl->concurrency, runs.size());
+            std::vector<std::future<void>> requests;
+            for (std::size_t r = batch + 1U; r < batchend; ++r)
+              {
+                try
+                  {
+                    requests.push_back(std::async(std::launch::async,
+                                                  &Impl::fetchRun, impl.get(),
+                                                  runs[r].first, std::cref(runs[r].second)));
+                  }
+                catch (const std::system_error&)
+                  {
+                    // Thread creation failed; fetch on this thread.
+                    impl->fetchRun(runs[r].first, runs[r].second);
+                  }
+              }
+            impl->fetchRun(runs[batch].first, runs[batch].second);
+            for (auto& request : requests)
+              request.wait();
+          }
+      }
+
+      uint64_t
+      RangeSource::getFetchCount() const
+      {
+        return impl->fetches;
+      }
+
+      std::size_t
+      RangeSource::getCacheSize() const
+      {
+        std::lock_guard<std::mutex> lock(impl->mutex);
+        return impl->cached;
+      }
+
+    }
+  }
+}
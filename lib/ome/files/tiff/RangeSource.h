@@ -0,0 +1,161 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#ifndef OME_FILES_TIFF_RANGESOURCE_H
+#define OME_FILES_TIFF_RANGESOURCE_H
+
+#include <functional>
+#include <memory>
+
+#include <ome/files/tiff/IOSource.h>
+
+namespace ome
+{
+  namespace files
+  {
+    namespace tiff
+    {
+
+      /**
+       * Block-cached I/O source for remote byte-range access.
+       *
+       * Data is fetched from a remote store, such as an HTTP(S) or
+       * S3 object, using a caller-provided range fetch function
+       * which would typically issue a ranged GET request.  Fetched
+       * data is retained in fixed-size blocks in a least recently
+       * used cache, bounded in size.
+       *
+       * prefetch() merges the blocks for neighbouring ranges (such
+       * as the tiles covering a single IFD::readImage() region)
+       * into a small number of large requests, which are issued
+       * concurrently.  Reads of a block which is being fetched wait
+       * for the pending fetch rather than fetching it again.
+       *
+       * This class is thread-safe.
+       */
+      class RangeSource : public IOSource
+      {
+      public:
+        /**
+         * Range fetch function.
+         *
+         * Read @c size bytes at @c offset into @c buffer, returning
+         * the number of bytes read.  This will be called
+         * concurrently from multiple threads.  Failure should be
+         * reported by throwing an exception.
+         */
+        typedef std::function<std::size_t (uint64_t    offset,
+                                           void       *buffer,
+                                           std::size_t size)> fetch_type;
+
+      private:
+        class Impl;
+        /// Private implementation details.
+        std::shared_ptr<Impl> impl;
+
+      public:
+        /**
+         * Constructor.
+         *
+         * @param name the source name (for example, the URL).
+         * @param size the total size of the source, in bytes.
+         * @param fetch the range fetch function.
+         * @param blocksize the cache block size, in bytes.
+         * @param cachesize the maximum cache size, in bytes.
+         * @param concurrency the maximum number of concurrent
+         * fetches made by prefetch().
+         * @param maxrequest the maximum size of a single merged
+         * request, in bytes.
+         */
+        RangeSource(const std::string& name,
+                    uint64_t           size,
+                    const fetch_type&  fetch,
+                    std::size_t        blocksize = 1024U * 1024U,
+                    std::size_t        cachesize = 64U * 1024U * 1024U,
+                    std::size_t        concurrency = 8U,
+                    std::size_t        maxrequest = 16U * 1024U * 1024U);
+
+        /// Destructor.
+        virtual
+        ~RangeSource();
+
+        // Documented in superclass.
+        std::string
+        name() const;
+
+        // Documented in superclass.
+        uint64_t
+        size() const;
+
+        // Documented in superclass.
+        std::size_t
+        read(uint64_t    offset,
+             void       *buffer,
+             std::size_t size);
+
+        // Documented in superclass.
+        void
+        prefetch(const std::vector<range_type>& ranges);
+
+        /**
+         * Get the number of fetch requests made.
+         *
+         * @returns the request count.
+         */
+        uint64_t
+        getFetchCount() const;
+
+        /**
+         * Get the current cache size.
+         *
+         * @returns the size of the cached blocks, in bytes.
+         */
+        std::size_t
+        getCacheSize() const;
+      };
+
+    }
+  }
+}
+
+#endif // OME_FILES_TIFF_RANGESOURCE_H
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
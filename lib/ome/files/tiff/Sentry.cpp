@@ -43,9 +43,11 @@
 # include "stdarg.h"
 #endif
 #include <cstdlib>
+#include <mutex>
 
 #include <ome/files/tiff/Sentry.h>
 #include <ome/files/tiff/Exception.h>
+#include <ome/files/tiff/TIFF.h>
 
 #include <tiffio.h>
 
@@ -59,35 +61,27 @@ namespace ome
       namespace
       {
 
-        /// Saved libtiff global error handler.
-        TIFFErrorHandler oldErrorHandler;
-
-        /// Sentry currently holding the tiff_lock mutex.
-        Sentry *currentSentry = 0;
-
-        /**
-         * Set the libtiff error handler.
-         *
-         * @param sentry the current Sentry.
-         * @param handler the handler function to set.
-         * @returns the old handler to allow later restoration.
-         */
-        TIFFErrorHandler
-        setHandler(Sentry           *sentry,
-                   TIFFErrorHandler  handler)
+#ifndef OME_HAVE_TIFFOPENEXT
+        /// libtiff error handler in use prior to installing ours.
+        TIFFErrorHandler oldErrorHandler = 0;
+
+        /// Flag for one-time error handler installation.
+        std::once_flag handlerFlag;
+#endif // ! OME_HAVE_TIFFOPENEXT
+
+        /// Innermost Sentry active on the current thread.
+        thread_local Sentry *currentSentry = 0;
+
+        /// Lock site for sentries not specifying a site.
+        LockSite&
+        defaultSite()
         {
-          if (sentry)
-            currentSentry = sentry;
-          TIFFErrorHandler old = TIFFSetErrorHandler(handler);
-          if (!sentry)
-            currentSentry = sentry;
-          return old;
+          static LockSite site("tiff::Sentry");
+          return site;
         }
 
       }
 
-      std::recursive_mutex Sentry::tiff_mutex;
-
       // Visual Studio 12 and earlier don't have va_copy.
 #if _MSC_VER &&_MSC_VER < 1800
 #  define va_copy(dest, src) (dest = src)
@@ -100,11 +94,14 @@ namespace ome
 #  pragma GCC diagnostic ignored "-Wformat-nonliteral"
 #endif
 
-      void
-      Sentry::errorHandler(const char *module,
+      bool
+      Sentry::captureError(const char *module,
                            const char *fmt,
                            va_list     ap)
       {
+        if (!currentSentry)
+          return false;
+
         try
           {
             va_list ap2;
@@ -136,30 +133,83 @@ namespace ome
 
             free(dest);
 
-            if (currentSentry)
-              currentSentry->setMessage(message);
+            currentSentry->setMessage(message);
           }
         catch (...)
           {
             // We can't throw exceptions through C, so stop here.
             // Nothing here should ever throw, but best to be careful.
           }
+
+        return true;
       }
 
 #ifdef __GNUC__
 #  pragma GCC diagnostic pop
 #endif
 
+      void
+      Sentry::errorHandler(const char *module,
+                           const char *fmt,
+                           va_list     ap)
+      {
+#ifndef OME_HAVE_TIFFOPENEXT
+        // Not called within a Sentry; defer to the original handler,
+        // if any.
+        if (!captureError(module, fmt, ap) && oldErrorHandler)
+          oldErrorHandler(module, fmt, ap);
+#else // OME_HAVE_TIFFOPENEXT
+        captureError(module, fmt, ap);
+#endif // ! OME_HAVE_TIFFOPENEXT
+      }
+
+      void
+      Sentry::installHandler()
+      {
+#ifndef OME_HAVE_TIFFOPENEXT
+        std::call_once(handlerFlag,
+                       [](){ oldErrorHandler = TIFFSetErrorHandler(&Sentry::errorHandler); });
+#endif // ! OME_HAVE_TIFFOPENEXT
+      }
+
       Sentry::Sentry():
-        lock(tiff_mutex),
+        lock(),
+        previous(currentSentry),
+        message()
+      {
+        installHandler();
+        currentSentry = this;
+      }
+
+      Sentry::Sentry(const TIFF& tiff):
+        Sentry(tiff.getMutex(), defaultSite())
+      {
+      }
+
+      Sentry::Sentry(const TIFF& tiff,
+                     LockSite&   site):
+        Sentry(tiff.getMutex(), site)
+      {
+      }
+
+      Sentry::Sentry(std::recursive_mutex& mutex):
+        Sentry(mutex, defaultSite())
+      {
+      }
+
+      Sentry::Sentry(std::recursive_mutex& mutex,
+                     LockSite&             site):
+        lock(mutex, site),
+        previous(currentSentry),
         message()
       {
-        oldErrorHandler = setHandler(this, &Sentry::errorHandler);
+        installHandler();
+        currentSentry = this;
       }
 
       Sentry::~Sentry()
       {
-        setHandler(0, oldErrorHandler);
+        currentSentry = previous;
       }
 
       void
@@ -44,6 +44,7 @@
 #include <mutex>
 #include <string>
 
+#include <ome/files/LockStatistics.h>
 
 namespace ome
 {
@@ -52,19 +53,33 @@ namespace ome
     namespace tiff
     {
 
+      class TIFF;
+
       /**
-       * Sentry for saving and restoring libtiff state.
+       * Sentry for serialising libtiff access and capturing errors.
+       *
+       * When constructed with a TIFF, this exclusively locks the
+       * mutex belonging to that TIFF, so that calls into libtiff
+       * using the same handle are serialised.  Calls using different
+       * handles are not serialised, permitting unrelated files to be
+       * used concurrently.  The lock is recursive, so nested sentries
+       * on the same TIFF (for example, in an IFD method calling
+       * other IFD methods) are permitted.
        *
-       * This acts primarily to save the state of the global error and
-       * warning handlers, which are configured to work with the
-       * currently active TIFF/IFD.  The original state is restored
-       * when destroyed.  Note that this exclusively locks all TIFF
-       * and IFD methods calling into libtiff, so will potentially
-       * block other threads.
+       * This class also captures any libtiff errors which occur.
+       * Where supported by libtiff, an error handler is set for each
+       * handle when it is opened; otherwise a global error handler
+       * is installed once only.  In both cases, errors are recorded
+       * in the innermost Sentry active on the calling thread, so
+       * errors occurring concurrently in different threads will not
+       * be mixed up, and no handler state is modified when a Sentry
+       * is created or destroyed.  The latest error will be available
+       * using getMessage().
        *
-       * This class also hooks into the global libtiff error handling
-       * to capture any errors which occur.  The latest error will be
-       * available using getMessage().
+       * The time spent waiting for and holding the lock may be
+       * recorded by specifying a LockSite for the call site; sites
+       * which do not specify a LockSite are recorded as
+       * "tiff::Sentry".  See LockSite::setEnabled().
        *
        * This class should be used at block scope so that instances
        * will only exist transiently until the block ends.
@@ -72,12 +87,69 @@ namespace ome
       class Sentry
       {
       public:
-        /// Constructor.
+        /**
+         * Constructor.
+         *
+         * Capture errors only; no lock is acquired.  This is
+         * intended for use where no TIFF handle exists yet, for
+         * example when opening a file.
+         */
         Sentry();
 
+        /**
+         * Constructor.
+         *
+         * Capture errors and lock the specified TIFF.
+         *
+         * @param tiff the TIFF to lock.
+         */
+        explicit
+        Sentry(const TIFF& tiff);
+
+        /**
+         * Constructor.
+         *
+         * Capture errors and lock the specified TIFF, recording the
+         * lock times at the specified site.
+         *
+         * @param tiff the TIFF to lock.
+         * @param site the lock call site.
+         */
+        Sentry(const TIFF& tiff,
+               LockSite&   site);
+
+        /**
+         * Constructor.
+         *
+         * Capture errors and lock the specified mutex.
+         *
+         * @param mutex the mutex to lock.
+         */
+        explicit
+        Sentry(std::recursive_mutex& mutex);
+
+        /**
+         * Constructor.
+         *
+         * Capture errors and lock the specified mutex, recording the
+         * lock times at the specified site.
+         *
+         * @param mutex the mutex to lock.
+         * @param site the lock call site.
+         */
+        Sentry(std::recursive_mutex& mutex,
+               LockSite&             site);
+
         /// Destructor.
         ~Sentry();
 
+        /// @cond SKIP
+        Sentry (const Sentry&) = delete;
+
+        Sentry&
+        operator= (const Sentry&) = delete;
+        /// @endcond SKIP
+
       private:
         /**
          * Set the latest error message.
@@ -125,21 +197,44 @@ namespace ome
         error() const;
 
       private:
-        /// Mutex to lock libtiff access.
-        static std::recursive_mutex tiff_mutex;
+        /// Acquired lock on the TIFF mutex (if any).
+        TimedLock<std::recursive_mutex> lock;
 
-        /// Acquired lock on tiff_lock.
-        std::lock_guard<std::recursive_mutex> lock;
+        /// Sentry previously active on this thread.
+        Sentry *previous;
 
         /// Last error message.
         std::string message;
 
+      public:
         /**
-         * libtiff error handler.
+         * Capture an error for the calling thread.
          *
          * The error message received will be converted to a string
-         * and saved in the current Sentry for later retrieval with
-         * getMessage().
+         * and saved in the innermost Sentry active on the calling
+         * thread for later retrieval with getMessage().  This is
+         * used by the libtiff error handlers, and is not intended to
+         * be called directly.
+         *
+         * @param module the module or file emitting the error.
+         * @param fmt the format string for the error.
+         * @param ap additional parameters.
+         * @returns @c true if the error was captured, or @c false if
+         * no Sentry is active on the calling thread.
+         */
+        static bool
+        captureError(const char *module,
+                     const char *fmt,
+                     va_list     ap);
+
+      private:
+        /**
+         * libtiff global error handler.
+         *
+         * This is only used when libtiff does not support per-handle
+         * error handlers.  Errors are captured using captureError().
+         * If no Sentry is active, the error is passed to the handler
+         * which was installed prior to this one.
          *
          * @param module the module or file emitting the error.
          * @param fmt the format string for the error.
@@ -150,6 +245,9 @@ namespace ome
                      const char *fmt,
                      va_list     ap);
 
+        /// Install errorHandler() as the libtiff error handler.
+        static void
+        installHandler();
       };
 
     }
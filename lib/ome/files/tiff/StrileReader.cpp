@@ -0,0 +1,241 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <fcntl.h> // For O_RDONLY on Unix and Windows
+
+#include <boost/format.hpp>
+
+#include <ome/files/config-internal.h>
+#include <ome/files/LockStatistics.h>
+#include <ome/files/tiff/Codec.h>
+#include <ome/files/tiff/Exception.h>
+#include <ome/files/tiff/IFD.h>
+#include <ome/files/tiff/Sentry.h>
+#include <ome/files/tiff/StrileReader.h>
+#include <ome/files/tiff/TIFF.h>
+
+#include <tiffio.h>
+
+namespace ome
+{
+  namespace files
+  {
+    namespace tiff
+    {
+
+      namespace
+      {
+
+        // Lock call sites.
+        LockSite strileReaderSite("tiff::StrileReader");
+
+      }
+
+      /**
+       * Internal implementation details of StrileReader.
+       */
+      class StrileReader::Impl
+      {
+      public:
+        /// The I/O source.
+        std::shared_ptr<IOSource> source;
+        /// Tile type.
+        TileType type;
+        /// Tile or strip offsets.
+        std::vector<uint64_t> offsets;
+        /// Tile or strip byte counts.
+        std::vector<uint64_t> counts;
+        /// Raw data is plainly encoded.
+        bool plain;
+        /// JPEG tables.
+        std::vector<char> jpegtables;
+
+        /// Constructor.
+        Impl():
+          source(),
+          type(STRIP),
+          offsets(),
+          counts(),
+          plain(false),
+          jpegtables()
+        {
+        }
+      };
+
+      StrileReader::StrileReader(const IFD& ifd):
+        impl(std::make_shared<Impl>())
+      {
+        const std::shared_ptr<TIFF>& tiff(ifd.getTIFF());
+        impl->source = tiff->getSource();
+        if (!impl->source)
+          throw Exception("Raw tile data may only be read from a TIFF with an I/O source");
+
+        ::TIFF *tiffraw = reinterpret_cast<::TIFF *>(tiff->getWrapped());
+
+        Sentry sentry(*tiff, strileReaderSite);
+
+        if (TIFFGetMode(tiffraw) != O_RDONLY)
+          throw Exception("Raw tile data may only be read from a TIFF open read-only");
+
+        ifd.makeCurrent();
+
+        impl->type = TIFFIsTiled(tiffraw) ? TILE : STRIP;
+        tstrile_t nstriles = impl->type == TILE ? TIFFNumberOfTiles(tiffraw) : TIFFNumberOfStrips(tiffraw);
+        impl->offsets.assign(nstriles, 0U);
+        impl->counts.assign(nstriles, 0U);
+
+#ifdef OME_HAVE_TIFF_STRILE_ONDEMAND
+        for (tstrile_t i = 0; i < nstriles; ++i)
+          {
+            impl->offsets[i] = TIFFGetStrileOffset(tiffraw, i);
+            impl->counts[i] = TIFFGetStrileByteCount(tiffraw, i);
+          }
+#else // ! OME_HAVE_TIFF_STRILE_ONDEMAND
+        toff_t *offsets = nullptr;
+        toff_t *counts = nullptr;
+        if (TIFFGetField(tiffraw, impl->type == TILE ? TIFFTAG_TILEOFFSETS : TIFFTAG_STRIPOFFSETS, &offsets) &&
+            TIFFGetField(tiffraw, impl->type == TILE ? TIFFTAG_TILEBYTECOUNTS : TIFFTAG_STRIPBYTECOUNTS, &counts) &&
+            offsets && counts)
+          {
+            impl->offsets.assign(offsets, offsets + nstriles);
+            impl->counts.assign(counts, counts + nstriles);
+          }
+#endif // OME_HAVE_TIFF_STRILE_ONDEMAND
+
+        // As for the registered tile codecs, the raw data is only
+        // usable directly if libtiff would not apply a predictor,
+        // byte swapping or bit reversal.
+        Compression compression = ifd.getCompression();
+        uint16_t predictor = PREDICTOR_NONE;
+        uint16_t fillorder = FILLORDER_MSB2LSB;
+        impl->plain = !(TIFFIsByteSwapped(tiffraw) ||
+                        (codecSupportsPredictor(compression) &&
+                         TIFFGetFieldDefaulted(tiffraw, TIFFTAG_PREDICTOR, &predictor) &&
+                         predictor != PREDICTOR_NONE) ||
+                        (TIFFGetFieldDefaulted(tiffraw, TIFFTAG_FILLORDER, &fillorder) &&
+                         fillorder != FILLORDER_MSB2LSB));
+
+        uint32_t tablesize = 0U;
+        void *tables = nullptr;
+        if (compression == COMPRESSION_JPEG &&
+            TIFFGetField(tiffraw, TIFFTAG_JPEGTABLES, &tablesize, &tables) &&
+            tables && tablesize)
+          impl->jpegtables.assign(static_cast<const char *>(tables),
+                                  static_cast<const char *>(tables) + tablesize);
+      }
+
+      StrileReader::~StrileReader()
+      {
+      }
+
+      const std::shared_ptr<IOSource>&
+      StrileReader::getSource() const
+      {
+        return impl->source;
+      }
+
+      TileType
+      StrileReader::getTileType() const
+      {
+        return impl->type;
+      }
+
+      dimension_size_type
+      StrileReader::getStrileCount() const
+      {
+        return impl->offsets.size();
+      }
+
+      bool
+      StrileReader::isPlainEncoding() const
+      {
+        return impl->plain;
+      }
+
+      const std::vector<char>&
+      StrileReader::getJPEGTables() const
+      {
+        return impl->jpegtables;
+      }
+
+      IOSource::range_type
+      StrileReader::getRange(dimension_size_type strile) const
+      {
+        if (strile >= impl->offsets.size() ||
+            !impl->offsets[strile] ||
+            !impl->counts[strile])
+          return IOSource::range_type(0U, 0U);
+        return IOSource::range_type(impl->offsets[strile],
+                                    static_cast<std::size_t>(impl->counts[strile]));
+      }
+
+      std::vector<IOSource::range_type>
+      StrileReader::getRanges(const std::vector<dimension_size_type>& striles) const
+      {
+        std::vector<IOSource::range_type> ranges;
+        ranges.reserve(striles.size());
+        for (const auto strile : striles)
+          ranges.push_back(getRange(strile));
+        return ranges;
+      }
+
+      std::size_t
+      StrileReader::read(dimension_size_type strile,
+                         std::vector<char>&  dest) const
+      {
+        IOSource::range_type range(getRange(strile));
+        if (!range.second)
+          {
+            boost::format fmt("Tile or strip %1% not present in %2%");
+            fmt % strile % impl->source->name();
+            throw Exception(fmt.str());
+          }
+
+        dest.resize(range.second);
+        std::size_t bytesread = impl->source->read(range.first, dest.data(), range.second);
+        if (bytesread != range.second)
+          {
+            boost::format fmt("Failed to read tile or strip %1% fully from %2%");
+            fmt % strile % impl->source->name();
+            throw Exception(fmt.str());
+          }
+        return bytesread;
+      }
+
+    }
+  }
+}
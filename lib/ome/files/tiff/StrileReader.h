@@ -0,0 +1,196 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#ifndef OME_FILES_TIFF_STRILEREADER_H
+#define OME_FILES_TIFF_STRILEREADER_H
+
+#include <memory>
+#include <vector>
+
+#include <ome/files/Types.h>
+#include <ome/files/tiff/IOSource.h>
+#include <ome/files/tiff/Types.h>
+
+namespace ome
+{
+  namespace files
+  {
+    namespace tiff
+    {
+
+      class IFD;
+
+      /**
+       * Reader for the raw (encoded) data of tiles and strips.
+       *
+       * The offsets and byte counts of every tile or strip of an
+       * IFD are read once on construction, with the TIFF lock held.
+       * Thereafter, the raw data of any tile or strip is read with
+       * positional reads from the I/O source of the TIFF, needing no
+       * libtiff state and no lock.  Decoding the raw data is left to
+       * the caller, typically using a TileCodec on the calling
+       * thread or a pool of worker threads.
+       *
+       * This class is thread-safe.
+       */
+      class StrileReader
+      {
+      private:
+        class Impl;
+        /// Private implementation details.
+        std::shared_ptr<Impl> impl;
+
+      public:
+        /**
+         * Constructor.
+         *
+         * @param ifd the IFD containing the tiles or strips.
+         * @throws an Exception if the TIFF has no I/O source, or is
+         * not open read-only.
+         */
+        explicit
+        StrileReader(const IFD& ifd);
+
+        /// Destructor.
+        ~StrileReader();
+
+      private:
+        /// @cond SKIP
+        StrileReader (const StrileReader&) = delete;
+
+        StrileReader&
+        operator= (const StrileReader&) = delete;
+        /// @endcond SKIP
+
+      public:
+        /**
+         * Get the I/O source the raw data is read from.
+         *
+         * @returns the I/O source.
+         */
+        const std::shared_ptr<IOSource>&
+        getSource() const;
+
+        /**
+         * Get the tile type.
+         *
+         * @returns TILE or STRIP.
+         */
+        TileType
+        getTileType() const;
+
+        /**
+         * Get the number of tiles or strips.
+         *
+         * @returns the count.
+         */
+        dimension_size_type
+        getStrileCount() const;
+
+        /**
+         * Check if the raw data is plainly encoded.
+         *
+         * Plainly encoded data is the output of the codec for the
+         * compression scheme alone, with no predictor, byte swapping
+         * or bit reversal to be undone by the TIFF library.  Only
+         * plainly encoded data may be decoded by a TileCodec.
+         *
+         * @returns @c true if plainly encoded, otherwise @c false.
+         */
+        bool
+        isPlainEncoding() const;
+
+        /**
+         * Get the JPEG tables.
+         *
+         * For JPEG compression, the quantization and Huffman tables
+         * may be stored once for the IFD rather than in each tile or
+         * strip.  These must be merged with the raw data of each
+         * tile or strip to form a complete JPEG stream.
+         *
+         * @returns the JPEGTables stream (including the start and
+         * end of image markers), or an empty vector if not present.
+         */
+        const std::vector<char>&
+        getJPEGTables() const;
+
+        /**
+         * Get the byte range of a tile or strip.
+         *
+         * @param strile the tile or strip index.
+         * @returns the offset and size of the raw data, or an empty
+         * range if the index is invalid or the tile or strip is not
+         * present.
+         */
+        IOSource::range_type
+        getRange(dimension_size_type strile) const;
+
+        /**
+         * Get the byte ranges of several tiles or strips.
+         *
+         * @param striles the tile or strip indices.
+         * @returns one range for each index, as for getRange().
+         */
+        std::vector<IOSource::range_type>
+        getRanges(const std::vector<dimension_size_type>& striles) const;
+
+        /**
+         * Read the raw data of a tile or strip.
+         *
+         * @param strile the tile or strip index.
+         * @param dest the destination for the raw data; it will be
+         * resized to the size of the raw data.
+         * @returns the number of bytes read.
+         * @throws an Exception if the tile or strip is not present,
+         * or could not be read fully.
+         */
+        std::size_t
+        read(dimension_size_type strile,
+             std::vector<char>&  dest) const;
+      };
+
+    }
+  }
+}
+
+#endif // OME_FILES_TIFF_STRILEREADER_H
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
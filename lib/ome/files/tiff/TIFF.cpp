@@ -38,6 +38,15 @@
 #include <algorithm>
 #include <cmath>
 #include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
 #include <vector>
 
 #include <fcntl.h> // For O_RDONLY on Unix and Windows
@@ -45,10 +54,20 @@
 // Include before boost headers to ensure the MPL limits get defined.
 #include <ome/common/config.h>
 
+#include <ome/files/config-internal.h>
+
+#include <boost/format.hpp>
+#include <boost/optional.hpp>
 #include <boost/range/size.hpp>
 
+#include <ome/files/DecodedTileCache.h>
+#include <ome/files/Executor.h>
+#include <ome/files/LockStatistics.h>
+#include <ome/files/MemoryBudget.h>
+#include <ome/files/TraceObserver.h>
 #include <ome/files/Version.h>
 #include <ome/files/tiff/Field.h>
+#include <ome/files/tiff/IOSource.h>
 #include <ome/files/tiff/Tags.h>
 #include <ome/files/tiff/TIFF.h>
 #include <ome/files/tiff/IFD.h>
@@ -60,6 +79,10 @@
 
 #include <tiffio.h>
 
+#ifdef OME_HAVE_POSIX_FADVISE
+# include <sys/types.h>
+#endif // OME_HAVE_POSIX_FADVISE
+
 namespace ome
 {
   namespace files
@@ -86,6 +109,18 @@ namespace ome
       namespace
       {
 
+        /**
+         * Number of idle read handles retained in addition to one per
+         * decoding thread.  Each retains its current directory, so
+         * this is also the number of directories which may be
+         * alternated between without re-reading them.
+         */
+        const std::size_t max_idle_directories = 8U;
+
+        /// Lock call sites.
+        LockSite directorySite("tiff::TIFF::getDirectory");
+        LockSite readHandlesSite("tiff::TIFF::readHandles");
+
         class TIFFConcrete : public TIFF
         {
         public:
@@ -95,12 +130,728 @@ namespace ome
           {
           }
 
+          TIFFConcrete(const std::shared_ptr<IOSource>& source,
+                       const std::string&               mode):
+            TIFF(source, mode)
+          {
+          }
+
           virtual
           ~TIFFConcrete()
           {
           }
         };
 
+#ifdef OME_HAVE_TIFFOPENEXT
+        /**
+         * libtiff per-handle error handler.
+         *
+         * Errors are captured by the Sentry active on the calling
+         * thread.  If no Sentry is active, the error is passed on to
+         * the libtiff global error handler.
+         *
+         * @param tiff the TIFF handle (unused).
+         * @param data user data (unused).
+         * @param module the module or file emitting the error.
+         * @param fmt the format string for the error.
+         * @param ap additional parameters.
+         * @returns 1 if the error was handled, or 0 if not.
+         */
+        int
+        errorHandler(::TIFF      * /* tiff */,
+                     void        * /* data */,
+                     const char  *module,
+                     const char  *fmt,
+                     va_list      ap)
+        {
+          return Sentry::captureError(module, fmt, ap) ? 1 : 0;
+        }
+#endif // OME_HAVE_TIFFOPENEXT
+
+        /**
+         * libtiff client state for reading from an IOSource.
+         *
+         * Each libtiff handle has its own position, but all handles
+         * for the same file share a single source.
+         */
+        struct SourceClient
+        {
+          /// The data source.
+          std::shared_ptr<IOSource> source;
+          /// The current position.
+          toff_t pos;
+        };
+
+        tmsize_t
+        sourceRead(thandle_t handle,
+                   void      *buf,
+                   tmsize_t   size)
+        {
+          SourceClient *client = reinterpret_cast<SourceClient *>(handle);
+          if (size < 0)
+            return 0;
+          try
+            {
+              std::size_t count = client->source->read(static_cast<uint64_t>(client->pos), buf,
+                                                       static_cast<std::size_t>(size));
+              client->pos += static_cast<toff_t>(count);
+              return static_cast<tmsize_t>(count);
+            }
+          catch (const std::exception&)
+            {
+              return -1;
+            }
+        }
+
+        tmsize_t
+        sourceWrite(thandle_t /* handle */,
+                    void    * /* buf */,
+                    tmsize_t  /* size */)
+        {
+          // Read-only.
+          return -1;
+        }
+
+        toff_t
+        sourceSeek(thandle_t handle,
+                   toff_t    offset,
+                   int       whence)
+        {
+          SourceClient *client = reinterpret_cast<SourceClient *>(handle);
+          switch(whence)
+            {
+            case SEEK_SET:
+              client->pos = offset;
+              break;
+            case SEEK_CUR:
+              client->pos += offset;
+              break;
+            case SEEK_END:
+              client->pos = static_cast<toff_t>(client->source->size()) + offset;
+              break;
+            default:
+              return static_cast<toff_t>(-1);
+            }
+          return client->pos;
+        }
+
+        int
+        sourceClose(thandle_t handle)
+        {
+          delete reinterpret_cast<SourceClient *>(handle);
+          return 0;
+        }
+
+        toff_t
+        sourceSize(thandle_t handle)
+        {
+          SourceClient *client = reinterpret_cast<SourceClient *>(handle);
+          return static_cast<toff_t>(client->source->size());
+        }
+
+        int
+        sourceMap(thandle_t handle,
+                  void    **base,
+                  toff_t   *size)
+        {
+          // If the source is memory resident, libtiff reads directly
+          // from it; the data is not modified when the file is open
+          // read-only.
+          SourceClient *client = reinterpret_cast<SourceClient *>(handle);
+          const char *data = client->source->data();
+          if (!data)
+            return 0;
+          *base = const_cast<char *>(data);
+          *size = static_cast<toff_t>(client->source->size());
+          return 1;
+        }
+
+        void
+        sourceUnmap(thandle_t /* handle */,
+                    void    * /* base */,
+                    toff_t    /* size */)
+        {
+          // The source is shared and is released when the last handle
+          // using it is closed.
+        }
+
+        /**
+         * Map a file for reading.
+         *
+         * Files are only mapped when opened read-only, and when
+         * memory mapping has not been disabled with the @c m mode
+         * flag.
+         *
+         * @param filename the filename to map.
+         * @param mode the file open mode.
+         * @returns the mapped source, or null if the file is not to
+         * be mapped, or could not be mapped.
+         */
+        std::shared_ptr<IOSource>
+        mapFile(const boost::filesystem::path& filename,
+                const std::string&             mode)
+        {
+          std::shared_ptr<IOSource> source;
+
+          if (!mode.empty() && mode[0] == 'r' &&
+              mode.find('+') == std::string::npos &&
+              mode.find('m') == std::string::npos)
+            {
+              try
+                {
+                  source = std::make_shared<MappedFileSource>(filename);
+                  if (!source->size())
+                    source.reset();
+                }
+              catch (const std::exception&)
+                {
+                  // Fall back to unmapped I/O.
+                  source.reset();
+                }
+            }
+
+          return source;
+        }
+
+        /**
+         * Open a libtiff handle.
+         *
+         * If a source is provided, the handle will read from the
+         * source using TIFFClientOpen(), rather than opening the
+         * file.
+         *
+         * @note Needs wrapping in a sentry by the caller.
+         *
+         * @param filename the filename to open, or the source name.
+         * @param openmode the file open mode.
+         * @param source the source to use for reading, or null.
+         * @returns the handle, or null on failure.
+         */
+        ::TIFF *
+        openHandle(const boost::filesystem::path&   filename,
+                   const std::string&               openmode,
+                   const std::shared_ptr<IOSource>& source)
+        {
+          ::TIFF *tiff;
+
+          std::string mode(openmode);
+#ifdef OME_HAVE_TIFF_STRILE_ONDEMAND
+          // When reading, load strip and tile offsets and byte counts
+          // on demand, rather than reading the whole arrays for each
+          // directory read.  This greatly reduces the cost of reading
+          // directories of very large tiled images.  Skip if the
+          // caller has requested deferred or on-demand loading
+          // explicitly, or when updating, since the arrays are then
+          // rewritten.
+          if (!mode.empty() && mode[0] == 'r' &&
+              mode.find_first_of("DO+") == std::string::npos)
+            mode += 'O';
+#endif // OME_HAVE_TIFF_STRILE_ONDEMAND
+
+#ifdef OME_HAVE_TIFFOPENEXT
+          // Set error handler for this handle to avoid use of the
+          // global error handler.
+          TIFFOpenOptions *opts = TIFFOpenOptionsAlloc();
+          TIFFOpenOptionsSetErrorHandlerExtR(opts, &errorHandler, 0);
+#endif // OME_HAVE_TIFFOPENEXT
+
+          if (source)
+            {
+              // Owned by the handle, and deleted by sourceClose().
+              SourceClient *client = new SourceClient{source, 0U};
+#ifdef OME_HAVE_TIFFOPENEXT
+              tiff = TIFFClientOpenExt(filename.string().c_str(), mode.c_str(),
+                                       reinterpret_cast<thandle_t>(client),
+                                       &sourceRead, &sourceWrite, &sourceSeek,
+                                       &sourceClose, &sourceSize,
+                                       &sourceMap, &sourceUnmap, opts);
+#else // ! OME_HAVE_TIFFOPENEXT
+              tiff = TIFFClientOpen(filename.string().c_str(), mode.c_str(),
+                                    reinterpret_cast<thandle_t>(client),
+                                    &sourceRead, &sourceWrite, &sourceSeek,
+                                    &sourceClose, &sourceSize,
+                                    &sourceMap, &sourceUnmap);
+#endif // OME_HAVE_TIFFOPENEXT
+              // libtiff only closes the client if opened successfully.
+              if (!tiff)
+                delete client;
+            }
+          else
+            {
+#ifdef OME_HAVE_TIFFOPENEXT
+#  ifdef _MSC_VER
+              tiff = TIFFOpenWExt(filename.wstring().c_str(), mode.c_str(), opts);
+#  else
+              tiff = TIFFOpenExt(filename.string().c_str(), mode.c_str(), opts);
+#  endif
+#else // ! OME_HAVE_TIFFOPENEXT
+#  ifdef _MSC_VER
+              tiff = TIFFOpenW(filename.wstring().c_str(), mode.c_str());
+#  else
+              tiff = TIFFOpen(filename.string().c_str(), mode.c_str());
+#  endif
+#endif // OME_HAVE_TIFFOPENEXT
+            }
+
+#ifdef OME_HAVE_TIFFOPENEXT
+          TIFFOpenOptionsFree(opts);
+#endif // OME_HAVE_TIFFOPENEXT
+
+          return tiff;
+        }
+
+        /**
+         * Advise the system of the access pattern for a libtiff handle.
+         *
+         * Sequential and random advice apply to the open file
+         * description of the handle, so must be given for each
+         * handle.  Advice that data will be needed starts reading
+         * into the page cache shared by all handles.  Handles which
+         * read from a source rather than a file are ignored.
+         *
+         * @param tiff the handle to advise.
+         * @param hint the expected access pattern.
+         * @param ranges the byte ranges to which the advice applies,
+         * or empty for the whole file.
+         */
+        void
+        adviseHandle(::TIFF                                  *tiff,
+                     AccessHint                               hint,
+                     const std::vector<IOSource::range_type>& ranges)
+        {
+#ifdef OME_HAVE_POSIX_FADVISE
+          int fd = TIFFFileno(tiff);
+          if (fd < 0)
+            return;
+
+          int advice = POSIX_FADV_NORMAL;
+          switch (hint)
+            {
+            case HINT_NORMAL:
+              advice = POSIX_FADV_NORMAL;
+              break;
+            case HINT_SEQUENTIAL:
+              advice = POSIX_FADV_SEQUENTIAL;
+              break;
+            case HINT_RANDOM:
+              advice = POSIX_FADV_RANDOM;
+              break;
+            case HINT_WILLNEED:
+              advice = POSIX_FADV_WILLNEED;
+              break;
+            }
+
+          // Advisory only; failure is ignored.
+          if (ranges.empty() || hint != HINT_WILLNEED)
+            posix_fadvise(fd, 0, 0, advice);
+          else
+            {
+              for (const auto& range : ranges)
+                posix_fadvise(fd,
+                              static_cast<off_t>(range.first),
+                              static_cast<off_t>(range.second),
+                              advice);
+            }
+#else // ! OME_HAVE_POSIX_FADVISE
+          static_cast<void>(tiff);
+          static_cast<void>(hint);
+          static_cast<void>(ranges);
+#endif // OME_HAVE_POSIX_FADVISE
+        }
+
+        /**
+         * Register ImageJ and OME private tags with libtiff.
+         *
+         * @note Needs wrapping in a sentry by the caller.
+         *
+         * @param tiff the handle to register the tags with.
+         * @returns @c true on success, @c false on failure.
+         */
+        bool
+        mergePrivateTags(::TIFF *tiff)
+        {
+          // This is optional, used for quieting libtiff messages about
+          // unknown tags by registering them.  This doesn't work
+          // completely since some warnings will be issued reading the
+          // first directory, before we can register them.  This is
+          // deprecated in libtiff4, so guard against future removal.
+          //
+          // These static strings are to provide a writable string to
+          // comply with the TIFFFieldInfo interface which can't be
+          // assigned const string literals.  They must outlive the
+          // registered field info.
+          static std::string ijbc("ImageJMetadataByteCounts");
+          static std::string ij("ImageJMetadata");
+          static std::string omets("OMETileStatistics");
+          static std::string omecs("OMETileChecksums");
+          static const std::array<TIFFFieldInfo, 4> PrivateFieldInfo
+            {{
+                {
+                  TIFFTAG_IMAGEJ_META_DATA_BYTE_COUNTS,
+                  TIFF_VARIABLE2, TIFF_VARIABLE2, TIFF_LONG, FIELD_CUSTOM,
+                  true, true, const_cast<char *>(ijbc.c_str())
+                },
+                {
+                  TIFFTAG_IMAGEJ_META_DATA,
+                  TIFF_VARIABLE2, TIFF_VARIABLE2, TIFF_BYTE, FIELD_CUSTOM,
+                  true, true, const_cast<char *>(ij.c_str())
+                },
+                {
+                  TIFFTAG_OME_TILE_STATISTICS,
+                  TIFF_VARIABLE2, TIFF_VARIABLE2, TIFF_BYTE, FIELD_CUSTOM,
+                  true, true, const_cast<char *>(omets.c_str())
+                },
+                {
+                  TIFFTAG_OME_TILE_CHECKSUMS,
+                  TIFF_VARIABLE2, TIFF_VARIABLE2, TIFF_BYTE, FIELD_CUSTOM,
+                  true, true, const_cast<char *>(omecs.c_str())
+                }
+            }};
+
+          return TIFFMergeFieldInfo(tiff, PrivateFieldInfo.data(), PrivateFieldInfo.size()) == 0;
+        }
+
+        /**
+         * Byte order and offset size of a TIFF, for parsing
+         * directories without libtiff.
+         */
+        struct RawLayout
+        {
+          /// Little endian byte order.
+          bool little;
+          /// BigTIFF (8-byte offsets).
+          bool big;
+
+          /**
+           * Get an unsigned integer in the file byte order.
+           *
+           * @param data the data to read.
+           * @param bytes the integer size.
+           * @returns the value.
+           */
+          uint64_t
+          get(const uint8_t *data,
+              std::size_t    bytes) const
+          {
+            uint64_t value = 0U;
+            for (std::size_t i = 0; i < bytes; ++i)
+              {
+                uint64_t byte = data[little ? bytes - 1U - i : i];
+                value = (value << 8) | byte;
+              }
+            return value;
+          }
+
+          /// Size of the directory entry count.
+          std::size_t
+          countSize() const
+          {
+            return big ? 8U : 2U;
+          }
+
+          /// Size of a directory entry.
+          std::size_t
+          entrySize() const
+          {
+            return big ? 20U : 12U;
+          }
+
+          /// Size of an offset (and entry count and value fields).
+          std::size_t
+          offsetSize() const
+          {
+            return big ? 8U : 4U;
+          }
+        };
+
+        // Directories with more entries are left to libtiff (this
+        // matches the libtiff directory sanity check).
+        const uint64_t max_raw_entries = 4096U;
+
+        /**
+         * Read raw data from a source.
+         *
+         * @param source the source to read.
+         * @param offset the offset to read from.
+         * @param buf the buffer to read into.
+         * @param size the number of bytes to read.
+         * @returns @c true if all the data was read, @c false otherwise.
+         */
+        bool
+        readRaw(IOSource&   source,
+                uint64_t    offset,
+                void       *buf,
+                std::size_t size)
+        {
+          try
+            {
+              return source.read(offset, buf, size) == size;
+            }
+          catch (const std::exception&)
+            {
+              return false;
+            }
+        }
+
+        /**
+         * Get a single unsigned integer value from a directory entry.
+         *
+         * @param layout the file layout.
+         * @param entry the directory entry.
+         * @param value the value to set.
+         * @returns @c true on success, @c false if the entry is not a
+         * single SHORT, LONG or LONG8 value.
+         */
+        bool
+        rawValue(const RawLayout& layout,
+                 const uint8_t   *entry,
+                 uint64_t&        value)
+        {
+          const uint64_t type = layout.get(entry + 2U, 2U);
+          const uint64_t count = layout.get(entry + 4U, layout.offsetSize());
+          const uint8_t *field = entry + 4U + layout.offsetSize();
+
+          if (count != 1U)
+            return false;
+
+          switch(type)
+            {
+            case TYPE_SHORT:
+              value = layout.get(field, 2U);
+              break;
+            case TYPE_LONG:
+              value = layout.get(field, 4U);
+              break;
+            case TYPE_LONG8:
+              if (!layout.big)
+                return false;
+              value = layout.get(field, 8U);
+              break;
+            default:
+              return false;
+            }
+          return true;
+        }
+
+        /**
+         * Get a per-sample SHORT value from a directory entry.
+         *
+         * As for libtiff, the values for all samples must be equal.
+         *
+         * @param source the source to read out of line values from.
+         * @param layout the file layout.
+         * @param entry the directory entry.
+         * @param scratch scratch space for out of line values.
+         * @param value the value to set.
+         * @returns @c true on success, @c false if the entry is not
+         * SHORT, could not be read, or the sample values differ.
+         */
+        bool
+        rawPerSampleValue(IOSource&             source,
+                          const RawLayout&      layout,
+                          const uint8_t        *entry,
+                          std::vector<uint8_t>& scratch,
+                          uint16_t&             value)
+        {
+          const uint64_t type = layout.get(entry + 2U, 2U);
+          const uint64_t count = layout.get(entry + 4U, layout.offsetSize());
+          const uint8_t *values = entry + 4U + layout.offsetSize();
+
+          if (type != TYPE_SHORT || count == 0U ||
+              count > std::numeric_limits<uint16_t>::max())
+            return false;
+
+          const std::size_t size = static_cast<std::size_t>(count) * 2U;
+          if (size > layout.offsetSize())
+            {
+              scratch.resize(size);
+              if (!readRaw(source, layout.get(values, layout.offsetSize()), scratch.data(), size))
+                return false;
+              values = scratch.data();
+            }
+
+          value = static_cast<uint16_t>(layout.get(values, 2U));
+          for (std::size_t i = 2U; i < size; i += 2U)
+            if (layout.get(values + i, 2U) != value)
+              return false;
+          return true;
+        }
+
+        /**
+         * Summarize a directory by parsing its entries.
+         *
+         * If the directory can't be parsed, or libtiff might not use
+         * the stored values, the summary is marked invalid.
+         *
+         * @param source the source to read.
+         * @param layout the file layout.
+         * @param offset the directory offset.
+         * @param scratch scratch space for the directory entries.
+         * @param values scratch space for out of line values.
+         * @returns the summary.
+         */
+        DirectorySummary
+        summarizeDirectory(IOSource&             source,
+                           const RawLayout&      layout,
+                           offset_type           offset,
+                           std::vector<uint8_t>& scratch,
+                           std::vector<uint8_t>& values)
+        {
+          DirectorySummary summary;
+          summary.offset = offset;
+
+          uint8_t countbuf[8];
+          if (!readRaw(source, offset, countbuf, layout.countSize()))
+            return summary;
+          const uint64_t count = layout.get(countbuf, layout.countSize());
+          if (count == 0U || count > max_raw_entries)
+            return summary;
+
+          scratch.resize(static_cast<std::size_t>(count) * layout.entrySize());
+          if (!readRaw(source, offset + layout.countSize(), scratch.data(), scratch.size()))
+            return summary;
+
+          bool haveWidth = false;
+          bool haveHeight = false;
+          bool haveBits = false;
+          bool haveSamples = false;
+          bool havePhotometric = false;
+
+          for (std::size_t e = 0; e < scratch.size(); e += layout.entrySize())
+            {
+              const uint8_t *entry = &scratch[e];
+              uint64_t value = 0U;
+              bool ok = true;
+
+              switch(layout.get(entry, 2U))
+                {
+                case TIFFTAG_IMAGEWIDTH:
+                  ok = haveWidth = rawValue(layout, entry, value) && value <= std::numeric_limits<uint32_t>::max();
+                  summary.width = static_cast<uint32_t>(value);
+                  break;
+                case TIFFTAG_IMAGELENGTH:
+                  ok = haveHeight = rawValue(layout, entry, value) && value <= std::numeric_limits<uint32_t>::max();
+                  summary.height = static_cast<uint32_t>(value);
+                  break;
+                case TIFFTAG_BITSPERSAMPLE:
+                  ok = haveBits = rawPerSampleValue(source, layout, entry, values, summary.bitsPerSample);
+                  break;
+                case TIFFTAG_COMPRESSION:
+                  // Old-style JPEG may change the photometric
+                  // interpretation and sampling.
+                  ok = rawValue(layout, entry, value) && value != COMPRESSION_OJPEG;
+                  break;
+                case TIFFTAG_PHOTOMETRIC:
+                  ok = havePhotometric = rawValue(layout, entry, value) && value <= std::numeric_limits<uint16_t>::max();
+                  summary.photometricInterpretation = static_cast<uint16_t>(value);
+                  break;
+                case TIFFTAG_SAMPLESPERPIXEL:
+                  ok = haveSamples = rawValue(layout, entry, value) && value > 0U && value <= std::numeric_limits<uint16_t>::max();
+                  summary.samplesPerPixel = static_cast<uint16_t>(value);
+                  break;
+                case TIFFTAG_PLANARCONFIG:
+                  ok = rawValue(layout, entry, value) && value <= std::numeric_limits<uint16_t>::max();
+                  summary.planarConfiguration = static_cast<uint16_t>(value);
+                  break;
+                case TIFFTAG_SAMPLEFORMAT:
+                  ok = rawPerSampleValue(source, layout, entry, values, summary.sampleFormat);
+                  break;
+                default:
+                  break;
+                }
+
+              if (!ok)
+                return summary;
+            }
+
+          // libtiff guesses a missing photometric interpretation, and
+          // may assume bits and samples other than the defaults for
+          // colour images.
+          const bool grey = (summary.photometricInterpretation == MIN_IS_WHITE ||
+                             summary.photometricInterpretation == MIN_IS_BLACK);
+          if (!haveWidth || !haveHeight || !havePhotometric ||
+              (!haveBits && !grey) ||
+              (!haveSamples && !grey && summary.photometricInterpretation != PALETTE))
+            return summary;
+
+          summary.valid = true;
+          return summary;
+        }
+
+        /// Byte swap a raw TIFF value.
+        void
+        swabRaw(uint16_t& value)
+        {
+          TIFFSwabShort(&value);
+        }
+
+        /// Byte swap a raw TIFF value.
+        void
+        swabRaw(uint32_t& value)
+        {
+          TIFFSwabLong(&value);
+        }
+
+        /// Byte swap a raw TIFF value.
+        void
+        swabRaw(uint64_t& value)
+        {
+          TIFFSwabLong8(&value);
+        }
+
+        /**
+         * Read a raw value from a libtiff handle.
+         *
+         * @param tiff the handle to read from.
+         * @param pos the file position to read.
+         * @returns the value, in native byte order.
+         * @throws an Exception on failure.
+         */
+        template<typename T>
+        T
+        readRaw(::TIFF  *tiff,
+                uint64_t pos)
+        {
+          T value;
+          thandle_t client = TIFFClientdata(tiff);
+          if (TIFFGetSeekProc(tiff)(client, static_cast<toff_t>(pos), SEEK_SET) != pos ||
+              TIFFGetReadProc(tiff)(client, &value, sizeof(T)) != static_cast<tmsize_t>(sizeof(T)))
+            {
+              boost::format fmt("Failed to read directory link at offset %1%");
+              fmt % pos;
+              throw Exception(fmt.str());
+            }
+          if (TIFFIsByteSwapped(tiff))
+            swabRaw(value);
+          return value;
+        }
+
+        /**
+         * Write a raw value to a libtiff handle.
+         *
+         * @param tiff the handle to write to.
+         * @param pos the file position to write.
+         * @param value the value, in native byte order.
+         * @throws an Exception on failure.
+         */
+        template<typename T>
+        void
+        writeRaw(::TIFF  *tiff,
+                 uint64_t pos,
+                 T        value)
+        {
+          if (TIFFIsByteSwapped(tiff))
+            swabRaw(value);
+          thandle_t client = TIFFClientdata(tiff);
+          if (TIFFGetSeekProc(tiff)(client, static_cast<toff_t>(pos), SEEK_SET) != pos ||
+              TIFFGetWriteProc(tiff)(client, &value, sizeof(T)) != static_cast<tmsize_t>(sizeof(T)))
+            {
+              boost::format fmt("Failed to write directory link at offset %1%");
+              fmt % pos;
+              throw Exception(fmt.str());
+            }
+        }
+
       }
 
       /**
@@ -111,31 +862,130 @@ namespace ome
       public:
         /// The libtiff file handle.
         ::TIFF *tiff;
-        /// Directory offsets
+        /// Directory offsets discovered so far.
         std::vector<offset_type> offsets;
+        /// All directory offsets have been discovered.
+        bool offsetsComplete;
+        /**
+         * Opened directories, by offset (used when reading).  These
+         * refer to the TIFF without owning it, to avoid a reference
+         * cycle; handles returned to callers own the TIFF.
+         */
+        std::map<offset_type, std::shared_ptr<IFD>> directories;
+        /// Mutex serialising libtiff access to this handle.
+        std::recursive_mutex mutex;
+        /// The filename or source name (used to open additional read handles).
+        boost::filesystem::path filename;
+        /// The file open mode (used to open additional read handles).
+        std::string mode;
+        /// Maximum number of threads to use for decoding.
+        dimension_size_type decodeThreads;
+        /// Maximum number of threads to use for encoding.
+        dimension_size_type encodeThreads;
+        /// Executor for parallel decoding and encoding (null for the default).
+        std::shared_ptr<Executor> executor;
+        /// Elide empty tiles when writing.
+        bool sparseTiles;
+        /// Record tile statistics when writing.
+        bool recordTileStatistics;
+        /// Tile statistics for the directory being written.
+        std::vector<TileStatistics> pendingTileStatistics;
+        /// Record tile checksums when writing.
+        bool recordTileChecksums;
+        /// Verify tile checksums when reading.
+        bool verifyTileChecksums;
+        /// Tile checksums for the directory being written.
+        std::vector<uint32_t> pendingTileChecksums;
+        /// Memory limit for tiles pending write (bytes).
+        dimension_size_type writeCacheLimit;
+        /// Directory for tile scratch files.
+        boost::filesystem::path writeCacheDirectory;
+        /// Memory budget for tiles pending write.
+        std::shared_ptr<MemoryBudget> memoryBudget;
+        /// Idle additional read handles.
+        std::vector<::TIFF *> readHandles;
+        /// Mutex protecting readHandles and accessHint.
+        std::mutex readHandlesMutex;
+        /// Access pattern advice for read handles, if set.
+        boost::optional<AccessHint> accessHint;
+        /// Data source shared by all read handles (if not a file).
+        std::shared_ptr<IOSource> source;
+        /// Decoded tile cache.
+        std::shared_ptr<DecodedTileCache> tileCache;
+        /// I/O statistics.
+        std::shared_ptr<IOStatistics> statistics;
+        /// Offsets of the directories written to the IFD chain, in order.
+        std::vector<offset_type> written;
+        /// Record written directories (the file is being created).
+        bool recordWritten;
+        /**
+         * The first directory links to the last directory written,
+         * rather than to the second directory.
+         */
+        bool shortcut;
 
         /**
          * The constructor.
          *
-         * Opens the TIFF using TIFFOpen().
+         * Opens the TIFF using TIFFOpen(), or with TIFFClientOpen()
+         * reading from the source if provided.
          *
-         * @param filename the filename to open.
+         * @param filename the filename to open, or the source name.
          * @param mode the file open mode.
+         * @param source the source to read from, or null to open the
+         * file.
          */
-        Impl(const boost::filesystem::path& filename,
-             const std::string&             mode):
+        Impl(const boost::filesystem::path&   filename,
+             const std::string&               mode,
+             const std::shared_ptr<IOSource>& source):
           tiff(),
-          offsets()
+          offsets(),
+          offsetsComplete(false),
+          directories(),
+          mutex(),
+          filename(filename),
+          mode(mode),
+          decodeThreads(1U),
+          encodeThreads(1U),
+          executor(),
+          sparseTiles(false),
+          recordTileStatistics(false),
+          pendingTileStatistics(),
+          recordTileChecksums(false),
+          verifyTileChecksums(false),
+          pendingTileChecksums(),
+          writeCacheLimit(0U),
+          writeCacheDirectory(),
+          memoryBudget(),
+          readHandles(),
+          readHandlesMutex(),
+          accessHint(),
+          source(source),
+          tileCache(),
+          statistics(std::make_shared<IOStatistics>()),
+          written(),
+          recordWritten(mode.find('w') != std::string::npos),
+          shortcut(false)
         {
           Sentry sentry;
 
-#ifdef _MSC_VER
-          tiff = TIFFOpenW(filename.wstring().c_str(), mode.c_str());
-#else
-          tiff = TIFFOpen(filename.string().c_str(), mode.c_str());
-#endif
+          tiff = openHandle(filename, mode, source);
           if (!tiff)
             sentry.error();
+
+          if (source)
+            source->setStatistics(statistics);
+
+          // When reading, cache directory offsets.  Only the first
+          // directory (already read when opening) is recorded here;
+          // the remainder are discovered on demand, so that opening
+          // files with very many directories is fast.  When writing,
+          // we don't have any offsets until we write a directory, so
+          // ignore caching entirely.
+          if(TIFFGetMode(tiff) == O_RDONLY)
+            offsets.push_back(static_cast<offset_type>(TIFFCurrentDirOffset(tiff)));
+          else
+            offsetsComplete = true;
         }
 
         /**
@@ -167,60 +1017,284 @@ namespace ome
         /// @endcond SKIP
 
         /**
-         * Close the libtiff file handle.
+         * Discover directory offsets.
          *
-         * If open, the file handle will be closed with TIFFClose.
+         * Directories are read in order from the last discovered
+         * directory, until at least the specified number of offsets
+         * are known or the last directory has been read.
+         *
+         * @param count the number of offsets required.
          */
         void
-        close()
+        discoverDirectories(std::size_t count)
         {
-          if (tiff)
+          Sentry sentry(mutex, directorySite);
+
+          if (offsetsComplete || offsets.size() >= count)
+            return;
+
+          IOStatistics::Timer timer(*statistics, IOStatistics::STAGE_DIRECTORY);
+          TraceScope trace(TraceObserver::DIRECTORY_READ, &filename);
+
+          if (offsets.empty() ||
+              (static_cast<offset_type>(TIFFCurrentDirOffset(tiff)) != offsets.back() &&
+               !TIFFSetSubDirectory(tiff, offsets.back())))
             {
-              Sentry sentry;
+              offsetsComplete = true;
+              return;
+            }
 
-              TIFFClose(tiff);
-              if (!sentry.getMessage().empty())
-                sentry.error();
-              tiff = 0;
+          while (offsets.size() < count)
+            {
+              if (TIFFReadDirectory(tiff) != 1)
+                {
+                  offsetsComplete = true;
+                  break;
+                }
+              offsets.push_back(static_cast<offset_type>(TIFFCurrentDirOffset(tiff)));
             }
         }
-      };
-
-      // Note boost::make_shared can't be used here.
-      TIFF::TIFF(const boost::filesystem::path& filename,
-                 const std::string&             mode):
-        impl(std::shared_ptr<Impl>(new Impl(filename, mode)))
-      {
-        registerImageJTags();
 
-        // When reading, cache all directory offsets.  When writing,
-        // we don't have any offsets until we write a directory, so
-        // ignore caching entirely.
-        if(TIFFGetMode(impl->tiff) == O_RDONLY)
-          {
-            do
-              {
-                offset_type offset = static_cast<offset_type>(TIFFCurrentDirOffset(impl->tiff));
-                impl->offsets.push_back(offset);
-              }
-            while (TIFFReadDirectory(impl->tiff) == 1);
-          }
-      }
+        /**
+         * Get the file position of the next directory link of a
+         * directory.
+         *
+         * @param ifd the directory offset.
+         * @returns the position of the link.
+         */
+        uint64_t
+        nextLinkPosition(uint64_t ifd)
+        {
+          return TIFFIsBigTIFF(tiff) ?
+            ifd + 8U + (20U * readRaw<uint64_t>(tiff, ifd)) :
+            ifd + 2U + (12U * readRaw<uint16_t>(tiff, ifd));
+        }
 
-      TIFF::~TIFF()
-      {
-      }
+        /**
+         * Read a directory link.
+         *
+         * @param pos the file position of the link.
+         * @returns the linked directory offset, or zero if none.
+         */
+        uint64_t
+        readLink(uint64_t pos)
+        {
+          return TIFFIsBigTIFF(tiff) ?
+            readRaw<uint64_t>(tiff, pos) :
+            readRaw<uint32_t>(tiff, pos);
+        }
 
-      TIFF::wrapped_type *
-      TIFF::getWrapped() const
-      {
-        return reinterpret_cast<wrapped_type *>(impl->tiff);
-      }
+        /**
+         * Write a directory link.
+         *
+         * @param pos the file position of the link.
+         * @param offset the directory offset to link to.
+         */
+        void
+        writeLink(uint64_t pos,
+                  uint64_t offset)
+        {
+          if (TIFFIsBigTIFF(tiff))
+            writeRaw<uint64_t>(tiff, pos, offset);
+          else
+            writeRaw<uint32_t>(tiff, pos, static_cast<uint32_t>(offset));
+        }
+
+        /**
+         * Record the offset of the directory just written.
+         *
+         * libtiff older than 4.5 links each new directory by
+         * searching the IFD chain from the first directory, as does
+         * any libtiff once the write handle has switched directory,
+         * making writing many directories quadratic.  To keep the
+         * search short, the first directory is linked directly to
+         * the last directory written, so the search always ends at
+         * the second directory it reads.  libtiff links the new
+         * directory to the last, so only the link from the first
+         * directory differs from the final chain; this is restored
+         * by linkDirectories().
+         *
+         * Directories written as SubIFDs are not linked into the
+         * chain, and are not recorded.
+         */
+        void
+        recordDirectory()
+        {
+          if (!recordWritten)
+            return;
+
+          thandle_t client = TIFFClientdata(tiff);
+          TIFFSeekProc seekproc = TIFFGetSeekProc(tiff);
+          const toff_t current = seekproc(client, 0, SEEK_CUR);
+
+          const uint64_t link = written.empty() ?
+            (TIFFIsBigTIFF(tiff) ? 8U : 4U) :
+            nextLinkPosition(written.back());
+          const uint64_t offset = readLink(link);
+          if (offset)
+            {
+              written.push_back(static_cast<offset_type>(offset));
+              if (written.size() > 2U)
+                {
+                  writeLink(nextLinkPosition(written.front()), offset);
+                  shortcut = true;
+                }
+            }
+
+          seekproc(client, current, SEEK_SET);
+        }
+
+        /**
+         * Restore the link from the first directory to the second.
+         *
+         * This must be done before the chain is read, or the file
+         * is closed.
+         */
+        void
+        linkDirectories()
+        {
+          if (!shortcut)
+            return;
+
+          thandle_t client = TIFFClientdata(tiff);
+          TIFFSeekProc seekproc = TIFFGetSeekProc(tiff);
+          const toff_t current = seekproc(client, 0, SEEK_CUR);
+
+          writeLink(nextLinkPosition(written.front()), written.at(1));
+          shortcut = false;
+
+          seekproc(client, current, SEEK_SET);
+        }
+
+        /**
+         * Close the libtiff file handle.
+         *
+         * If open, the file handle will be closed with TIFFClose.
+         */
+        void
+        close()
+        {
+          {
+            TimedLock<std::mutex> lock(readHandlesMutex, readHandlesSite);
+            for (auto handle : readHandles)
+              {
+                Sentry sentry;
+                TIFFClose(handle);
+              }
+            readHandles.clear();
+          }
+
+          if (tiff)
+            {
+              Sentry sentry(mutex);
+
+              // Close even if the chain could not be restored.
+              std::exception_ptr linkError;
+              try
+                {
+                  linkDirectories();
+                }
+              catch (const Exception&)
+                {
+                  linkError = std::current_exception();
+                }
+
+              directories.clear();
+              TIFFClose(tiff);
+              tiff = 0;
+              if (linkError)
+                std::rethrow_exception(linkError);
+              if (!sentry.getMessage().empty())
+                sentry.error();
+            }
+        }
+      };
+
+      // Note boost::make_shared can't be used here.
+      TIFF::TIFF(const boost::filesystem::path& filename,
+                 const std::string&             mode):
+        impl(std::shared_ptr<Impl>(new Impl(filename, mode, mapFile(filename, mode))))
+      {
+        registerPrivateTags();
+      }
+
+      TIFF::TIFF(const std::shared_ptr<IOSource>& source,
+                 const std::string&               mode):
+        impl(std::shared_ptr<Impl>(new Impl(source->name(), mode, source)))
+      {
+        registerPrivateTags();
+      }
+
+      TIFF::~TIFF()
+      {
+      }
+
+      TIFF::wrapped_type *
+      TIFF::getWrapped() const
+      {
+        return reinterpret_cast<wrapped_type *>(impl->tiff);
+      }
+
+      const std::shared_ptr<IOSource>&
+      TIFF::getSource() const
+      {
+        return impl->source;
+      }
+
+      const boost::filesystem::path&
+      TIFF::getFilename() const
+      {
+        return impl->filename;
+      }
+
+      offset_type
+      TIFF::getFileSize() const
+      {
+        Sentry sentry(*this);
+
+        return static_cast<offset_type>(TIFFGetSizeProc(impl->tiff)(TIFFClientdata(impl->tiff)));
+      }
+
+      void
+      TIFF::setTileCache(const std::shared_ptr<DecodedTileCache>& cache)
+      {
+        impl->tileCache = cache;
+        if (cache)
+          cache->openFile(getFilename().string());
+      }
+
+      const std::shared_ptr<DecodedTileCache>&
+      TIFF::getTileCache() const
+      {
+        return impl->tileCache;
+      }
+
+      void
+      TIFF::setStatistics(const std::shared_ptr<IOStatistics>& statistics)
+      {
+        impl->statistics = statistics ? statistics : std::make_shared<IOStatistics>();
+        if (impl->source)
+          impl->source->setStatistics(impl->statistics);
+      }
+
+      const std::shared_ptr<IOStatistics>&
+      TIFF::getStatistics() const
+      {
+        return impl->statistics;
+      }
+
+      std::recursive_mutex&
+      TIFF::getMutex() const
+      {
+        return impl->mutex;
+      }
 
       std::shared_ptr<TIFF>
       TIFF::open(const boost::filesystem::path& filename,
                  const std::string& mode)
       {
+        TraceScope trace(TraceObserver::FILE_OPEN, &filename);
+
         std::shared_ptr<TIFF> ret;
         try
           {
@@ -235,6 +1309,55 @@ namespace ome
         return ret;
       }
 
+      std::shared_ptr<TIFF>
+      TIFF::open(const std::shared_ptr<IOSource>& source,
+                 const std::string&               mode)
+      {
+        if (!source)
+          throw Exception("Null I/O source");
+        if (mode.empty() || mode[0] != 'r' ||
+            mode.find('+') != std::string::npos)
+          throw Exception("I/O sources may only be opened for reading");
+
+        TraceScope trace(TraceObserver::FILE_OPEN);
+
+        std::shared_ptr<TIFF> ret;
+        try
+          {
+            // Note boost::make_shared can't be used here.
+            ret = std::shared_ptr<TIFF>(new TIFFConcrete(source, mode));
+          }
+        catch (const std::exception& e)
+          {
+            // All exception types are propagated as an Exception.
+            throw Exception(e.what());
+          }
+        return ret;
+      }
+
+      std::shared_ptr<TIFF>
+      TIFF::open(const boost::filesystem::path& filename,
+                 const std::string&             mode,
+                 const IOSourceFactory&         factory)
+      {
+        if (factory && !mode.empty() && mode[0] == 'r' &&
+            mode.find('+') == std::string::npos)
+          {
+            std::shared_ptr<IOSource> source;
+            try
+              {
+                source = factory(filename);
+              }
+            catch (const std::exception& e)
+              {
+                throw Exception(e.what());
+              }
+            if (source)
+              return open(source, mode);
+          }
+        return open(filename, mode);
+      }
+
       void
       TIFF::close()
       {
@@ -249,7 +1372,10 @@ namespace ome
       directory_index_type
       TIFF::directoryCount() const
       {
-        return impl->offsets.size();
+        Sentry sentry(*this);
+
+        impl->discoverDirectories(std::numeric_limits<std::size_t>::max());
+        return static_cast<directory_index_type>(impl->offsets.size());
       }
 
       std::shared_ptr<IFD>
@@ -258,6 +1384,9 @@ namespace ome
         offset_type offset;
         try
           {
+            Sentry sentry(*this, directorySite);
+
+            impl->discoverDirectories(static_cast<std::size_t>(index) + 1U);
             offset = impl->offsets.at(index);
           }
         catch (const std::out_of_range& e)
@@ -271,12 +1400,199 @@ namespace ome
       std::shared_ptr<IFD>
       TIFF::getDirectoryByOffset(offset_type offset) const
       {
-        Sentry sentry;
+        Sentry sentry(*this, directorySite);
 
         std::shared_ptr<TIFF> t(std::const_pointer_cast<TIFF>(shared_from_this()));
-        std::shared_ptr<IFD> ifd = IFD::openOffset(t, offset);
-        ifd->makeCurrent(); // Validate offset.
-        return ifd;
+
+        // When writing, IFDs are mutable, so are not shared.
+        if (TIFFGetMode(impl->tiff) != O_RDONLY)
+          {
+            impl->linkDirectories();
+            std::shared_ptr<IFD> ifd = IFD::openOffset(t, offset);
+            ifd->makeCurrent(); // Validate offset.
+            return ifd;
+          }
+
+        // When reading, each directory is opened and its core tags
+        // cached once only, and is then shared by all callers.
+        auto i = impl->directories.find(offset);
+        if (i == impl->directories.end())
+          {
+            std::shared_ptr<TIFF> unowned(std::shared_ptr<TIFF>(), t.get());
+            std::shared_ptr<IFD> ifd = IFD::openOffset(unowned, offset);
+            ifd->makeCurrent(); // Validate offset.
+            i = impl->directories.insert(std::make_pair(offset, ifd)).first;
+          }
+
+        // The returned handle keeps this TIFF, and hence the shared
+        // IFD, alive.
+        return std::shared_ptr<IFD>(t, i->second.get());
+      }
+
+      std::vector<offset_type>
+      TIFF::getDirectoryOffsets() const
+      {
+        Sentry sentry(*this, directorySite);
+
+        return impl->offsets;
+      }
+
+      void
+      TIFF::setDirectoryOffsets(const std::vector<offset_type>& offsets,
+                                bool                            complete)
+      {
+        Sentry sentry(*this, directorySite);
+
+        if (TIFFGetMode(impl->tiff) != O_RDONLY)
+          throw Exception("Directory offsets may only be set when reading");
+        if (offsets.empty() || impl->offsets.empty() ||
+            offsets.front() != impl->offsets.front())
+          {
+            boost::format fmt("Directory offsets do not match first directory of %1%");
+            fmt % impl->filename.string();
+            throw Exception(fmt.str());
+          }
+
+        impl->offsets = offsets;
+        impl->offsetsComplete = complete;
+      }
+
+      directory_index_type
+      TIFF::refreshDirectories()
+      {
+        Sentry sentry(*this, directorySite);
+
+        if (TIFFGetMode(impl->tiff) != O_RDONLY)
+          throw Exception("Directories may only be refreshed when reading");
+
+        if (impl->offsetsComplete && !impl->offsets.empty())
+          {
+            // libtiff caches the offset of the next directory when a
+            // directory is read, so the last directory is read again
+            // to find any directory linked to it since.
+            if (!TIFFSetSubDirectory(impl->tiff, impl->offsets.back()))
+              {
+                boost::format fmt("Failed to reread last directory of %1%");
+                fmt % impl->filename.string();
+                throw Exception(fmt.str());
+              }
+            impl->offsetsComplete = false;
+          }
+
+        impl->discoverDirectories(std::numeric_limits<std::size_t>::max());
+        return static_cast<directory_index_type>(impl->offsets.size());
+      }
+
+      std::vector<DirectorySummary>
+      TIFF::scanDirectories(dimension_size_type threads) const
+      {
+        std::vector<DirectorySummary> summaries;
+        std::vector<offset_type> offsets;
+        RawLayout layout;
+        std::shared_ptr<IOSource> source;
+
+        IOStatistics::Timer timer(*impl->statistics, IOStatistics::STAGE_DIRECTORY);
+        TraceScope trace(TraceObserver::DIRECTORY_READ, &impl->filename);
+
+        {
+          Sentry sentry(*this, directorySite);
+
+          source = impl->source;
+          if (!source || TIFFGetMode(impl->tiff) != O_RDONLY || impl->offsets.empty())
+            return summaries;
+
+          uint8_t header[4];
+          if (!readRaw(*source, 0U, header, sizeof(header)))
+            return summaries;
+          if (header[0] == 'I' && header[1] == 'I')
+            layout.little = true;
+          else if (header[0] == 'M' && header[1] == 'M')
+            layout.little = false;
+          else
+            return summaries;
+          layout.big = layout.get(header + 2U, 2U) == 43U;
+
+          if (impl->offsetsComplete)
+            {
+              offsets = impl->offsets;
+            }
+          else
+            {
+              // Follow the directory chain, reading only the entry
+              // count and next offset.  Anything libtiff might treat
+              // differently (loops, truncation, empty or oversized
+              // directories) abandons the scan.
+              const uint64_t size = source->size();
+              std::set<offset_type> seen;
+              offset_type next = impl->offsets.front();
+              uint8_t buf[8];
+
+              while (next)
+                {
+                  if (next >= size || !seen.insert(next).second ||
+                      offsets.size() >= std::numeric_limits<directory_index_type>::max())
+                    return summaries;
+                  offsets.push_back(next);
+
+                  if (!readRaw(*source, next, buf, layout.countSize()))
+                    return summaries;
+                  const uint64_t count = layout.get(buf, layout.countSize());
+                  if (count == 0U || count > max_raw_entries)
+                    return summaries;
+
+                  if (!readRaw(*source, next + layout.countSize() + count * layout.entrySize(),
+                               buf, layout.offsetSize()))
+                    return summaries;
+                  next = layout.get(buf, layout.offsetSize());
+                }
+
+              // The directories already read by libtiff must match.
+              if (offsets.size() < impl->offsets.size() ||
+                  !std::equal(impl->offsets.begin(), impl->offsets.end(), offsets.begin()))
+                return summaries;
+
+              impl->offsets = offsets;
+              impl->offsetsComplete = true;
+            }
+        }
+
+        // Parse the directory entries; each thread summarizes a
+        // contiguous range of directories.
+        summaries.resize(offsets.size());
+        const std::size_t count = offsets.size();
+        const std::size_t nthreads =
+          std::max(std::size_t(1U),
+                   std::min(static_cast<std::size_t>(threads), count / 256U));
+        const std::size_t chunk = (count + nthreads - 1U) / nthreads;
+
+        auto summarize = [&](std::size_t begin, std::size_t end, std::exception_ptr& error)
+          {
+            try
+              {
+                std::vector<uint8_t> scratch;
+                std::vector<uint8_t> values;
+                for (std::size_t i = begin; i < end; ++i)
+                  summaries[i] = summarizeDirectory(*source, layout, offsets[i], scratch, values);
+              }
+            catch (...)
+              {
+                error = std::current_exception();
+              }
+          };
+
+        runParallel(impl->executor, nthreads,
+                    [&](dimension_size_type worker, dimension_size_type)
+                    {
+                      const std::size_t t = static_cast<std::size_t>(worker);
+                      std::exception_ptr error;
+                      summarize(std::min(count, t * chunk),
+                                std::min(count, (t + 1U) * chunk),
+                                error);
+                      if (error)
+                        std::rethrow_exception(error);
+                    });
+
+        return summaries;
       }
 
       std::shared_ptr<IFD>
@@ -289,13 +1605,34 @@ namespace ome
       void
       TIFF::writeCurrentDirectory()
       {
-        Sentry sentry;
+        static LockSite site("tiff::TIFF::writeCurrentDirectory");
+        Sentry sentry(*this, site);
 
         static const std::string software("OME Files (C++) " OME_FILES_VERSION_MAJOR_S "." OME_FILES_VERSION_MINOR_S "." OME_FILES_VERSION_PATCH_S);
-        getCurrentDirectory()->getField(SOFTWARE).set(software);
+        std::shared_ptr<IFD> ifd(getCurrentDirectory());
+        ifd->getField(SOFTWARE).set(software);
+
+        if (!impl->pendingTileStatistics.empty())
+          {
+            ifd->setTileStatistics(impl->pendingTileStatistics);
+            impl->pendingTileStatistics.clear();
+          }
+
+        if (!impl->pendingTileChecksums.empty())
+          {
+            ifd->setTileChecksums(impl->pendingTileChecksums);
+            impl->pendingTileChecksums.clear();
+          }
 
+        // libtiff links the directory by searching the IFD chain
+        // unless it has a record of the last directory written (4.5
+        // and later, until the handle switches directory); the
+        // recorded chain keeps the search short in either case.
+        IOStatistics::Timer timer(*impl->statistics, IOStatistics::STAGE_DIRECTORY);
         if (!TIFFWriteDirectory(impl->tiff))
           sentry.error("Failed to write current directory");
+        impl->recordDirectory();
+        impl->statistics->add(IOStatistics::DIRECTORIES_WRITTEN);
       }
 
       TIFF::iterator
@@ -325,41 +1662,262 @@ namespace ome
       }
 
       void
-      TIFF::registerImageJTags()
-      {
-        // This is optional, used for quieting libtiff messages about
-        // unknown tags by registering them.  This doesn't work
-        // completely since some warnings will be issued reading the
-        // first directory, before we can register them.  This is
-        // deprecated in libtiff4, so guard against future removal.
-        //
-        // These static strings are to provide a writable string to
-        // comply with the TIFFFieldInfo interface which can't be
-        // assigned const string literals.  They must outlive the
-        // registered field info.
-        static std::string ijbc("ImageJMetadataByteCounts");
-        static std::string ij("ImageJMetadata");
-        static const std::array<TIFFFieldInfo, 2> ImageJFieldInfo
-          {{
-              {
-                TIFFTAG_IMAGEJ_META_DATA_BYTE_COUNTS,
-                TIFF_VARIABLE2, TIFF_VARIABLE2, TIFF_LONG, FIELD_CUSTOM,
-                true, true, const_cast<char *>(ijbc.c_str())
-              },
-              {
-                TIFFTAG_IMAGEJ_META_DATA,
-                TIFF_VARIABLE2, TIFF_VARIABLE2, TIFF_BYTE, FIELD_CUSTOM,
-                true, true, const_cast<char *>(ij.c_str())
-              }
-          }};
-
+      TIFF::registerPrivateTags()
+      {
         ::TIFF *tiffraw = reinterpret_cast<::TIFF *>(getWrapped());
 
+        Sentry sentry(*this);
+
+        if (!mergePrivateTags(tiffraw))
+          sentry.error();
+      }
+
+      void
+      TIFF::setDecodeThreads(dimension_size_type threads)
+      {
+        impl->decodeThreads = threads ? threads : 1U;
+      }
+
+      dimension_size_type
+      TIFF::getDecodeThreads() const
+      {
+        return impl->decodeThreads;
+      }
+
+      void
+      TIFF::setEncodeThreads(dimension_size_type threads)
+      {
+        impl->encodeThreads = threads ? threads : 1U;
+      }
+
+      dimension_size_type
+      TIFF::getEncodeThreads() const
+      {
+        return impl->encodeThreads;
+      }
+
+      void
+      TIFF::setExecutor(const std::shared_ptr<Executor>& executor)
+      {
+        impl->executor = executor;
+      }
+
+      const std::shared_ptr<Executor>&
+      TIFF::getExecutor() const
+      {
+        return impl->executor;
+      }
+
+      void
+      TIFF::setSparseTiles(bool sparse)
+      {
+        impl->sparseTiles = sparse;
+      }
+
+      bool
+      TIFF::getSparseTiles() const
+      {
+        return impl->sparseTiles;
+      }
+
+      void
+      TIFF::setRecordTileStatistics(bool record)
+      {
+        impl->recordTileStatistics = record;
+      }
+
+      bool
+      TIFF::getRecordTileStatistics() const
+      {
+        return impl->recordTileStatistics;
+      }
+
+      void
+      TIFF::addTileStatistics(dimension_size_type   tile,
+                              const TileStatistics& stats)
+      {
+        std::vector<TileStatistics>& pending(impl->pendingTileStatistics);
+        if (tile >= pending.size())
+          {
+            const double nan = std::numeric_limits<double>::quiet_NaN();
+            pending.resize(tile + 1U, TileStatistics{nan, nan, nan});
+          }
+        pending[tile] = stats;
+      }
+
+      void
+      TIFF::setRecordTileChecksums(bool record)
+      {
+        impl->recordTileChecksums = record;
+      }
+
+      bool
+      TIFF::getRecordTileChecksums() const
+      {
+        return impl->recordTileChecksums;
+      }
+
+      void
+      TIFF::setVerifyTileChecksums(bool verify)
+      {
+        impl->verifyTileChecksums = verify;
+      }
+
+      bool
+      TIFF::getVerifyTileChecksums() const
+      {
+        return impl->verifyTileChecksums;
+      }
+
+      void
+      TIFF::addTileChecksum(dimension_size_type tile,
+                            uint32_t            checksum)
+      {
+        std::vector<uint32_t>& pending(impl->pendingTileChecksums);
+        if (tile >= pending.size())
+          pending.resize(tile + 1U, 0U);
+        pending[tile] = checksum;
+      }
+
+      void
+      TIFF::setWriteCacheLimit(dimension_size_type limit)
+      {
+        impl->writeCacheLimit = limit;
+      }
+
+      dimension_size_type
+      TIFF::getWriteCacheLimit() const
+      {
+        return impl->writeCacheLimit;
+      }
+
+      void
+      TIFF::setWriteCacheDirectory(const boost::filesystem::path& dir)
+      {
+        impl->writeCacheDirectory = dir;
+      }
+
+      const boost::filesystem::path&
+      TIFF::getWriteCacheDirectory() const
+      {
+        return impl->writeCacheDirectory;
+      }
+
+      void
+      TIFF::setMemoryBudget(const std::shared_ptr<MemoryBudget>& budget)
+      {
+        impl->memoryBudget = budget;
+      }
+
+      const std::shared_ptr<MemoryBudget>&
+      TIFF::getMemoryBudget() const
+      {
+        return impl->memoryBudget;
+      }
+
+      void
+      TIFF::adviseAccess(AccessHint                               hint,
+                         const std::vector<IOSource::range_type>& ranges) const
+      {
+        if (impl->source)
+          {
+            impl->source->advise(hint, ranges);
+            return;
+          }
+
+        {
+          Sentry sentry(*this);
+
+          if (!impl->tiff || TIFFGetMode(impl->tiff) != O_RDONLY)
+            return;
+          adviseHandle(impl->tiff, hint, ranges);
+        }
+
+        // Sequential and random advice is also given to each
+        // additional read handle when it is acquired.
+        if (hint != HINT_WILLNEED)
+          {
+            TimedLock<std::mutex> lock(impl->readHandlesMutex, readHandlesSite);
+            impl->accessHint = hint;
+          }
+      }
+
+      TIFF::wrapped_type *
+      TIFF::acquireReadHandle(offset_type offset) const
+      {
+        {
+          Sentry sentry(*this);
+
+          if (!impl->tiff || TIFFGetMode(impl->tiff) != O_RDONLY)
+            throw Exception("Additional read handles are only available for TIFFs open read-only");
+        }
+
+        {
+          TimedLock<std::mutex> lock(impl->readHandlesMutex, readHandlesSite);
+          if (!impl->readHandles.empty())
+            {
+              // Prefer the most recently used handle on the requested
+              // directory, falling back to the least recently used
+              // handle, which is least likely to be wanted again.
+              auto found = impl->readHandles.begin();
+              if (offset)
+                {
+                  for (auto i = impl->readHandles.rbegin(); i != impl->readHandles.rend(); ++i)
+                    {
+                      if (static_cast<offset_type>(TIFFCurrentDirOffset(*i)) == offset)
+                        {
+                          found = std::next(i).base();
+                          break;
+                        }
+                    }
+                }
+              ::TIFF *handle = *found;
+              impl->readHandles.erase(found);
+              if (impl->accessHint)
+                adviseHandle(handle, *impl->accessHint, std::vector<IOSource::range_type>());
+              return reinterpret_cast<wrapped_type *>(handle);
+            }
+        }
+
         Sentry sentry;
 
-        int e = TIFFMergeFieldInfo(tiffraw, ImageJFieldInfo.data(), ImageJFieldInfo.size());
-        if (e)
+        // Use the same mode so that strip chopping and other
+        // options match the main handle.
+        ::TIFF *handle = openHandle(impl->filename, impl->mode, impl->source);
+        if (!handle)
           sentry.error();
+        mergePrivateTags(handle);
+
+        {
+          TimedLock<std::mutex> lock(impl->readHandlesMutex, readHandlesSite);
+          if (impl->accessHint)
+            adviseHandle(handle, *impl->accessHint, std::vector<IOSource::range_type>());
+        }
+
+        return reinterpret_cast<wrapped_type *>(handle);
+      }
+
+      void
+      TIFF::releaseReadHandle(wrapped_type *handle) const
+      {
+        if (handle)
+          {
+            ::TIFF *discard = nullptr;
+            {
+              TimedLock<std::mutex> lock(impl->readHandlesMutex, readHandlesSite);
+              impl->readHandles.push_back(reinterpret_cast<::TIFF *>(handle));
+              if (impl->readHandles.size() > impl->decodeThreads + max_idle_directories)
+                {
+                  discard = impl->readHandles.front();
+                  impl->readHandles.erase(impl->readHandles.begin());
+                }
+            }
+            if (discard)
+              {
+                Sentry sentry;
+                TIFFClose(discard);
+              }
+          }
       }
 
     }
@@ -40,17 +40,26 @@
 
 #include <cstdint>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 #include <boost/filesystem/path.hpp>
 #include <boost/iterator/iterator_facade.hpp>
 
+#include <ome/files/IOStatistics.h>
+#include <ome/files/tiff/IOSource.h>
 #include <ome/files/tiff/Types.h>
 
 namespace ome
 {
   namespace files
   {
+
+    class DecodedTileCache;
+    class Executor;
+    class MemoryBudget;
+
     /**
      * TIFF file format (libtiff wrapper).
      */
@@ -145,6 +154,74 @@ namespace ome
         }
       };
 
+      /**
+       * Summary of the tags of a directory.
+       *
+       * Only the tags needed to group directories into series are
+       * included.  Values are as stored in the directory entries,
+       * with the TIFF default used for absent optional tags.
+       */
+      struct DirectorySummary
+      {
+        /// Directory offset.
+        offset_type offset;
+        /// Image width.
+        uint32_t width;
+        /// Image height.
+        uint32_t height;
+        /// Bits per sample.
+        uint16_t bitsPerSample;
+        /// Samples per pixel.
+        uint16_t samplesPerPixel;
+        /// Sample format.
+        uint16_t sampleFormat;
+        /// Planar configuration.
+        uint16_t planarConfiguration;
+        /// Photometric interpretation.
+        uint16_t photometricInterpretation;
+        /**
+         * @c true if the values are those libtiff will use, or @c
+         * false if the directory could not be summarized (e.g. a
+         * required tag is missing or has an unexpected type, or
+         * libtiff may adjust the values), and must be read in full.
+         */
+        bool valid;
+
+        /// Constructor.
+        DirectorySummary():
+          offset(0U),
+          width(0U),
+          height(0U),
+          bitsPerSample(1U),
+          samplesPerPixel(1U),
+          sampleFormat(1U),
+          planarConfiguration(1U),
+          photometricInterpretation(0U),
+          valid(false)
+        {}
+
+        /**
+         * Compare for equal dimensions, pixel type, samples and
+         * photometric interpretation.
+         *
+         * @param rhs the summary to compare with.
+         * @returns @c true if both summaries are valid and the
+         * images have the same format, @c false otherwise.
+         */
+        bool
+        sameFormat(const DirectorySummary& rhs) const
+        {
+          return (valid && rhs.valid &&
+                  width == rhs.width &&
+                  height == rhs.height &&
+                  bitsPerSample == rhs.bitsPerSample &&
+                  sampleFormat == rhs.sampleFormat &&
+                  samplesPerPixel == rhs.samplesPerPixel &&
+                  planarConfiguration == rhs.planarConfiguration &&
+                  photometricInterpretation == rhs.photometricInterpretation);
+        }
+      };
+
       /**
        * Tagged Image File Format (TIFF).
        *
@@ -173,6 +250,16 @@ namespace ome
         TIFF(const boost::filesystem::path& filename,
              const std::string&             mode);
 
+        /**
+         * Constructor (non-public).
+         *
+         * @param source the source to read.
+         * @param mode the file open mode (must be @c r to read).
+         * @throws an Exception on failure.
+         */
+        TIFF(const std::shared_ptr<IOSource>& source,
+             const std::string&               mode);
+
         /// @cond SKIP
         TIFF (const TIFF&) = delete;
 
@@ -188,17 +275,60 @@ namespace ome
          * Open a TIFF file for reading or writing.
          *
          * @note There are additional open flags, documented in
-         * TIFFOpen(3).
+         * TIFFOpen(3).  Where supported by libtiff, files opened for
+         * reading load strip and tile offsets on demand (the @c O
+         * flag), unless the @c D or @c O flags are specified
+         * explicitly.  Files opened for reading are memory mapped,
+         * with the mapping shared between all libtiff handles for the
+         * file, unless mapping is disabled with the @c m flag, or the
+         * file is opened for update.  Tile and strip data are then
+         * read directly from the page cache without read(2) calls.
+         *
+         * @param filename the file to open.
+         * @param mode the file open mode (@c r to read, @c r+ to
+         * update existing images with IFD::updateImage(), @c w to
+         * write or @c a to append).
+         * @returns the the open TIFF.
+         * @throws an Exception on failure.
+         */
+        static std::shared_ptr<TIFF>
+        open(const boost::filesystem::path& filename,
+             const std::string&             mode);
+
+        /**
+         * Open a TIFF for reading from an I/O source.
+         *
+         * All libtiff handles for this TIFF, including those used
+         * for parallel decoding, will read from the same source.
+         *
+         * @param source the source to read.
+         * @param mode the file open mode (must be @c r to read, with
+         * optional additional flags).
+         * @returns the the open TIFF.
+         * @throws an Exception on failure.
+         */
+        static std::shared_ptr<TIFF>
+        open(const std::shared_ptr<IOSource>& source,
+             const std::string&               mode);
+
+        /**
+         * Open a TIFF file, using an I/O source factory for reading.
+         *
+         * When reading, and the factory is set and provides a
+         * source for the filename, the TIFF will be read from the
+         * source.  Otherwise the file will be opened directly.
          *
          * @param filename the file to open.
          * @param mode the file open mode (@c r to read, @c w to write
          * or @c a to append).
+         * @param factory the source factory.
          * @returns the the open TIFF.
          * @throws an Exception on failure.
          */
         static std::shared_ptr<TIFF>
         open(const boost::filesystem::path& filename,
-             const std::string&             mode);
+             const std::string&             mode,
+             const IOSourceFactory&         factory);
 
         /**
          * Close the TIFF file.
@@ -221,6 +351,12 @@ namespace ome
         /**
          * Get the total number of IFDs.
          *
+         * When reading, directories are discovered on demand by
+         * getDirectoryByIndex(), so that opening a file with many
+         * directories does not require reading every directory.
+         * Calling this method requires all remaining directories to
+         * be read, so should be avoided where not needed.
+         *
          * @returns the IFD count.
          */
         directory_index_type
@@ -229,6 +365,10 @@ namespace ome
         /**
          * Get an IFD by its index.
          *
+         * When reading, IFDs are shared; repeated requests for the
+         * same directory return the same IFD, with its tags already
+         * cached.
+         *
          * @param index the directory index.
          * @returns the IFD.
          * @throws an Exception if the index is invalid or could not
@@ -240,6 +380,10 @@ namespace ome
         /**
          * Get an IFD by its offset in the file.
          *
+         * When reading, IFDs are shared; repeated requests for the
+         * same directory return the same IFD, with its tags already
+         * cached.
+         *
          * @param offset the directory offset.
          * @returns the IFD.
          * @throws an Exception if the offset is invalid or could not
@@ -248,6 +392,90 @@ namespace ome
         std::shared_ptr<IFD>
         getDirectoryByOffset(offset_type offset) const;
 
+        /**
+         * Get the directory offsets discovered so far.
+         *
+         * Call directoryCount() first if the offsets of all
+         * directories are required.
+         *
+         * @returns the directory offsets, in order.
+         */
+        std::vector<offset_type>
+        getDirectoryOffsets() const;
+
+        /**
+         * Set the offsets of all directories.
+         *
+         * This permits the offsets from a previously indexed file to
+         * be reused, avoiding the need to discover the directories by
+         * reading every directory in turn.  The offsets are not
+         * validated until the directories are used.
+         *
+         * If @p complete is @c false, the offsets are those of the
+         * first directories only, for example as obtained from
+         * getDirectoryOffsets() before all directories were
+         * discovered; any remaining directories will be discovered on
+         * demand, starting from the last offset.
+         *
+         * @param offsets the directory offsets, in order.
+         * @param complete @c true if these are the offsets of all
+         * directories, or @c false if more directories may follow.
+         * @throws an Exception if the file is not open for reading,
+         * or the first offset is not the offset of the first
+         * directory.
+         */
+        void
+        setDirectoryOffsets(const std::vector<offset_type>& offsets,
+                            bool                            complete = true);
+
+        /**
+         * Discover directories added since the last directory was
+         * found.
+         *
+         * This permits a file which is still being written to be
+         * followed as its directory chain grows.  The last known
+         * directory is read again to find the offset of any
+         * directory linked to it since, and the chain is then
+         * followed to its new end.  Directories are only visible
+         * once linked into the chain; the writer writes the image
+         * data and entries of a directory before linking it.
+         *
+         * Growth of the file is only seen if it is not memory
+         * mapped; open the file with the @c m mode flag.
+         *
+         * @returns the new directory count.
+         * @throws an Exception if the file is not open for reading,
+         * or the last directory can not be read again.
+         */
+        directory_index_type
+        refreshDirectories();
+
+        /**
+         * Summarize all directories.
+         *
+         * The directory chain is followed by reading only the entry
+         * count and next directory offset of each directory, unless
+         * all offsets are already known.  The entries of each
+         * directory are then parsed directly, without reading the
+         * directory with libtiff, optionally using several threads.
+         * This is much faster than iterating over every IFD for files
+         * with very many directories.  The offsets found are cached
+         * as if set with setDirectoryOffsets().
+         *
+         * Scanning is only possible when reading through an I/O
+         * source (including memory mapped files).  If the file can't
+         * be scanned, or the directory chain is invalid, an empty
+         * list is returned and the caller should iterate over the IFDs
+         * instead.
+         *
+         * @param threads the maximum number of threads to use for
+         * parsing directory entries.
+         * @returns the directory summaries, in order, or an empty list
+         * if the directories could not be scanned.
+         */
+        std::vector<DirectorySummary>
+        scanDirectories(dimension_size_type threads = 1U) const;
+
         /**
          * Get the currently active IFD.
          *
@@ -264,6 +492,13 @@ namespace ome
          * using IFD::writeImage() prior to calling this method, or
          * else the TIFF tags for strip and tile offsets will be
          * incomplete and the file will fail to read.
+         *
+         * The IFD is linked to the last IFD written in constant
+         * time.  When creating a file, the offset of each IFD is
+         * recorded, and until the file is closed the first IFD links
+         * directly to the last, so that libtiff versions which
+         * search the IFD chain to link each IFD (older than 4.5) do
+         * not need to read every IFD already written.
          */
         void
         writeCurrentDirectory();
@@ -290,6 +525,417 @@ namespace ome
         wrapped_type *
         getWrapped() const;
 
+        /**
+         * Get the mutex serialising libtiff access to this TIFF.
+         *
+         * libtiff handles are not safe for concurrent use, so all
+         * use of the wrapped handle must hold this lock; this is
+         * normally done using a Sentry.  Separate TIFF instances have
+         * separate mutexes and may be used concurrently.
+         *
+         * @returns a reference to the mutex.
+         */
+        std::recursive_mutex&
+        getMutex() const;
+
+        /**
+         * Get the I/O source used for reading.
+         *
+         * @returns the source, or null if the file was opened
+         * directly.
+         */
+        const std::shared_ptr<IOSource>&
+        getSource() const;
+
+        /**
+         * Get the filename.
+         *
+         * @returns the filename, or the source name if opened from
+         * an I/O source.
+         */
+        const boost::filesystem::path&
+        getFilename() const;
+
+        /**
+         * Get the size of the file.
+         *
+         * When writing, this is the size of the image data and IFDs
+         * written so far; image data for the current IFD which is
+         * held in the write cache is not included.
+         *
+         * @returns the size (bytes).
+         */
+        offset_type
+        getFileSize() const;
+
+        /**
+         * Set the decoded tile cache.
+         *
+         * When reading, IFD::readImage() will look up decoded tiles
+         * and strips in this cache, and add newly decoded tiles to
+         * it, rather than decoding them for every read.  The cache
+         * may be shared with other TIFF instances, including other
+         * instances for the same file.  By default there is no cache.
+         * The cache is notified that the file is open with
+         * DecodedTileCache::openFile().
+         *
+         * @param cache the tile cache, or null to disable caching.
+         */
+        void
+        setTileCache(const std::shared_ptr<DecodedTileCache>& cache);
+
+        /**
+         * Get the decoded tile cache.
+         *
+         * @returns the tile cache, or null if not caching.
+         */
+        const std::shared_ptr<DecodedTileCache>&
+        getTileCache() const;
+
+        /**
+         * Set the I/O statistics.
+         *
+         * Reads and writes of this TIFF, and of all its IFDs, will
+         * be counted and timed using these statistics.  The
+         * statistics may be shared with other TIFF instances, or
+         * with a reader or writer, to accumulate totals.  By default,
+         * each TIFF has separate statistics.  If reading from a
+         * source, the statistics are also set on the source (see
+         * IOSource::setStatistics()).
+         *
+         * @param statistics the statistics to use; if null, new
+         * statistics are created.
+         */
+        void
+        setStatistics(const std::shared_ptr<IOStatistics>& statistics);
+
+        /**
+         * Get the I/O statistics.
+         *
+         * @returns the statistics (never null).
+         */
+        const std::shared_ptr<IOStatistics>&
+        getStatistics() const;
+
+        /**
+         * Set the number of threads to use for decoding.
+         *
+         * When reading, IFD::readImage() will decode tiles or strips
+         * using up to this number of threads.  Each additional
+         * thread uses a separate libtiff handle (see
+         * acquireReadHandle()), so that decoding is not serialised by
+         * the lock on this handle.  The default is 1 (decode on the
+         * calling thread only).  This has no effect when writing.
+         *
+         * @param threads the maximum number of decoding threads; 0
+         * is treated as 1.
+         */
+        void
+        setDecodeThreads(dimension_size_type threads);
+
+        /**
+         * Get the number of threads to use for decoding.
+         *
+         * @returns the maximum number of decoding threads.
+         */
+        dimension_size_type
+        getDecodeThreads() const;
+
+        /**
+         * Set the number of threads to use for encoding.
+         *
+         * When writing, IFD::writeImage() will compress completed
+         * tiles or strips using up to this number of threads, and
+         * then write the compressed data in order.  This is only
+         * supported for compression schemes with a registered tile
+         * codec (see registerTileCodec()), and where no predictor is
+         * used; other schemes are encoded by libtiff on the calling
+         * thread.  The default is 1 (encode on the calling
+         * thread only).  This has no effect when reading.
+         *
+         * @param threads the maximum number of encoding threads; 0
+         * is treated as 1.
+         */
+        void
+        setEncodeThreads(dimension_size_type threads);
+
+        /**
+         * Get the number of threads to use for encoding.
+         *
+         * @returns the maximum number of encoding threads.
+         */
+        dimension_size_type
+        getEncodeThreads() const;
+
+        /**
+         * Set the executor for parallel decoding and encoding.
+         *
+         * The additional decoding and encoding threads (see
+         * setDecodeThreads() and setEncodeThreads()) and the threads
+         * used by scanDirectories() are run as tasks on this
+         * executor; the calling thread also takes part.  The default
+         * is to use defaultExecutor().
+         *
+         * @param executor the executor, or null to use the default.
+         */
+        void
+        setExecutor(const std::shared_ptr<Executor>& executor);
+
+        /**
+         * Get the executor for parallel decoding and encoding.
+         *
+         * @returns the executor; null if using the default.
+         */
+        const std::shared_ptr<Executor>&
+        getExecutor() const;
+
+        /**
+         * Set whether to elide empty tiles when writing.
+         *
+         * When writing, IFD::writeImage() will not store tiles or
+         * strips which are entirely zero.  Their offset and byte
+         * count are left as zero in the directory (a sparse TIFF),
+         * saving space and encoding time for images with large
+         * empty areas.  Such tiles are read back as zero by this
+         * library, but may not be supported by other readers.  The
+         * default is @c false.  Sparse tiles are always zero-filled
+         * when reading.
+         *
+         * @param sparse @c true to elide empty tiles, @c false to
+         * store all tiles.
+         */
+        void
+        setSparseTiles(bool sparse);
+
+        /**
+         * Get whether to elide empty tiles when writing.
+         *
+         * @returns @c true if empty tiles are elided, @c false otherwise.
+         */
+        bool
+        getSparseTiles() const;
+
+        /**
+         * Set whether to record tile statistics when writing.
+         *
+         * When writing, IFD::writeImage() computes the minimum,
+         * maximum and mean sample value of each tile or strip as it
+         * is flushed, and the statistics are stored in a private tag
+         * when the directory is written with
+         * writeCurrentDirectory().  Readers may then use
+         * IFD::getTileStatistics() or TileInfo::tileStatistics() to
+         * skip tiles without reading them.  Statistics are not
+         * recorded for tiles copied with IFD::copyRawTiles(), or for
+         * bit and complex pixel types.  The default is @c false.
+         *
+         * @param record @c true to record tile statistics.
+         */
+        void
+        setRecordTileStatistics(bool record);
+
+        /**
+         * Get whether to record tile statistics when writing.
+         *
+         * @returns @c true if tile statistics are recorded, @c false
+         * otherwise.
+         */
+        bool
+        getRecordTileStatistics() const;
+
+        /**
+         * Add the statistics of a tile for the directory being
+         * written.
+         *
+         * Used by IFD::writeImage() when flushing tiles.
+         *
+         * @note Needs wrapping in a sentry by the caller.
+         *
+         * @param tile the tile or strip index.
+         * @param stats the tile statistics.
+         */
+        void
+        addTileStatistics(dimension_size_type   tile,
+                          const TileStatistics& stats);
+
+        /**
+         * Set whether to record tile checksums when writing.
+         *
+         * When writing, the CRC-32C checksum of the compressed data
+         * of each tile or strip is computed as it is written, and the
+         * checksums are stored in a private tag when the directory is
+         * written with writeCurrentDirectory().  Checksums are
+         * recorded for uncompressed tiles, tiles compressed with a
+         * registered tile codec (see registerTileCodec()) and tiles
+         * copied with IFD::copyRawTiles().  Writing tiles compressed
+         * by libtiff, or updating tiles, throws an Exception while
+         * recording is enabled.  The default is @c false.
+         *
+         * @param record @c true to record tile checksums.
+         */
+        void
+        setRecordTileChecksums(bool record);
+
+        /**
+         * Get whether to record tile checksums when writing.
+         *
+         * @returns @c true if tile checksums are recorded, @c false
+         * otherwise.
+         */
+        bool
+        getRecordTileChecksums() const;
+
+        /**
+         * Set whether to verify tile checksums when reading.
+         *
+         * When reading, the compressed data of each tile or strip
+         * with a recorded checksum is checked before decoding, if the
+         * raw data is read separately from decoding (with a
+         * registered tile codec, or with IFD::copyRawTiles()).  A
+         * mismatch throws an Exception.  The default is @c false.
+         *
+         * @param verify @c true to verify tile checksums.
+         */
+        void
+        setVerifyTileChecksums(bool verify);
+
+        /**
+         * Get whether to verify tile checksums when reading.
+         *
+         * @returns @c true if tile checksums are verified, @c false
+         * otherwise.
+         */
+        bool
+        getVerifyTileChecksums() const;
+
+        /**
+         * Add the checksum of a tile for the directory being written.
+         *
+         * Used by IFD::writeImage() and IFD::copyRawTiles().
+         *
+         * @note Needs wrapping in a sentry by the caller.
+         *
+         * @param tile the tile or strip index.
+         * @param checksum the CRC-32C checksum of the compressed data.
+         */
+        void
+        addTileChecksum(dimension_size_type tile,
+                        uint32_t            checksum);
+
+        /**
+         * Set the memory limit for tiles pending write.
+         *
+         * When writing, IFD::writeImage() holds partially written
+         * tiles or strips in memory until they are complete.  If
+         * the total size of these exceeds this limit, the least
+         * recently used tiles are spilled to a temporary scratch
+         * file, and are read back in when next written to.  The
+         * limit applies to each IFD separately.  The default is 0
+         * (no limit).  This has no effect when reading.
+         *
+         * @param limit the memory limit (bytes), or 0 for no limit.
+         */
+        void
+        setWriteCacheLimit(dimension_size_type limit);
+
+        /**
+         * Get the memory limit for tiles pending write.
+         *
+         * @returns the memory limit (bytes), or 0 if there is no limit.
+         */
+        dimension_size_type
+        getWriteCacheLimit() const;
+
+        /**
+         * Set the directory for tile scratch files.
+         *
+         * @param dir the directory in which to create scratch files
+         * for tiles spilled from memory; if empty, the system
+         * temporary directory is used (the default).
+         */
+        void
+        setWriteCacheDirectory(const boost::filesystem::path& dir);
+
+        /**
+         * Get the directory for tile scratch files.
+         *
+         * @returns the directory in which to create scratch files.
+         */
+        const boost::filesystem::path&
+        getWriteCacheDirectory() const;
+
+        /**
+         * Set the memory budget for tiles pending write.
+         *
+         * The tiles held in memory by IFD::writeImage() are
+         * accounted to the budget, and spilled to the scratch file
+         * while it is exceeded, in addition to the limit set with
+         * setWriteCacheLimit().  This has no effect when reading.
+         *
+         * @param budget the memory budget, or null for none (the
+         * default).
+         */
+        void
+        setMemoryBudget(const std::shared_ptr<MemoryBudget>& budget);
+
+        /**
+         * Get the memory budget for tiles pending write.
+         *
+         * @returns the memory budget, or null if none.
+         */
+        const std::shared_ptr<MemoryBudget>&
+        getMemoryBudget() const;
+
+        /**
+         * Advise the expected access pattern when reading.
+         *
+         * For files opened directly, this is passed to the operating
+         * system with @c posix_fadvise, where available, to adjust
+         * readahead for this TIFF and its additional read handles.
+         * Otherwise it is passed to the source with
+         * IOSource::advise().  This is advisory only, and is ignored
+         * if the TIFF is not open read-only.
+         *
+         * @param hint the expected access pattern.
+         * @param ranges the byte ranges to which the advice applies,
+         * or empty for the whole file.  Sequential and random advice
+         * always applies to the whole file.
+         */
+        void
+        adviseAccess(AccessHint                               hint,
+                     const std::vector<IOSource::range_type>& ranges) const;
+
+        /**
+         * Acquire an additional read-only libtiff handle.
+         *
+         * The handle is opened on the same file, and is for the
+         * exclusive use of the caller until returned with
+         * releaseReadHandle().  It is not locked by getMutex(), and
+         * its current directory is undefined.  A limited number of
+         * released handles are retained for reuse until the TIFF is
+         * closed.  Each retained handle keeps its current directory
+         * parsed, so preferring a handle positioned on the wanted
+         * directory avoids re-reading the directory (including its
+         * tile offset and byte count tables) when alternating
+         * between several IFDs.
+         *
+         * @param offset the offset of the preferred directory, or 0
+         * for no preference.
+         * @returns an opaque pointer to the wrapped @c \::TIFF
+         * instance.
+         * @throws an Exception if the TIFF was not opened read-only
+         * or the file could not be opened.
+         */
+        wrapped_type *
+        acquireReadHandle(offset_type offset = 0U) const;
+
+        /**
+         * Release a handle obtained with acquireReadHandle().
+         *
+         * @param handle the handle to release.
+         */
+        void
+        releaseReadHandle(wrapped_type *handle) const;
+
         /// IFD uses internal TIFF state.
         friend class IFD;
 
@@ -331,9 +977,9 @@ namespace ome
         end() const;
 
       private:
-        /// Register ImageJ tags with libtiff for this image.
+        /// Register ImageJ and OME private tags with libtiff for this image.
         void
-        registerImageJTags();
+        registerPrivateTags();
       };
 
     }
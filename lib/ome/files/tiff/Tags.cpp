@@ -52,6 +52,8 @@ namespace ome
       {
         const tag_type TIFFTAG_IMAGEJ_META_DATA_BYTE_COUNTS = 50838;
         const tag_type TIFFTAG_IMAGEJ_META_DATA = 50839;
+        const tag_type TIFFTAG_OME_TILE_STATISTICS = 65420;
+        const tag_type TIFFTAG_OME_TILE_CHECKSUMS = 65421;
       }
 
     // No switch default to avoid -Wunreachable-code errors.
@@ -648,6 +650,12 @@ namespace ome
           case IMAGEJ_META_DATA:
             ret = TIFFTAG_IMAGEJ_META_DATA;
             break;
+          case OME_TILE_STATISTICS:
+            ret = TIFFTAG_OME_TILE_STATISTICS;
+            break;
+          case OME_TILE_CHECKSUMS:
+            ret = TIFFTAG_OME_TILE_CHECKSUMS;
+            break;
           };
         return ret;
       }
@@ -225,11 +225,13 @@ namespace ome
       /// Byte (Unsigned 8-bit integer) fields.
       enum RawDataTag1
         {
-          ICCPROFILE,      ///< ICC profile data.
-          JPEGTABLES,      ///< JPEG quantization and/or Huffman tables (JPEG "abbreviated table specification" datastream).
-          PHOTOSHOP,       ///< Photoshop "Image Resource Blocks".
-          XMLPACKET,       ///< XMP metadata.
-          IMAGEJ_META_DATA ///< Private tag for ImageJ metadata.
+          ICCPROFILE,          ///< ICC profile data.
+          JPEGTABLES,          ///< JPEG quantization and/or Huffman tables (JPEG "abbreviated table specification" datastream).
+          PHOTOSHOP,           ///< Photoshop "Image Resource Blocks".
+          XMLPACKET,           ///< XMP metadata.
+          IMAGEJ_META_DATA,    ///< Private tag for ImageJ metadata.
+          OME_TILE_STATISTICS, ///< Private tag for per-tile summary statistics.
+          OME_TILE_CHECKSUMS   ///< Private tag for per-tile checksums.
         };
 
       /// Floating point fields.
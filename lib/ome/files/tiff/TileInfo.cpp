@@ -35,6 +35,9 @@
  * #L%
  */
 
+#include <cmath>
+
+#include <ome/files/tiff/BitPack.h>
 #include <ome/files/tiff/Field.h>
 #include <ome/files/tiff/IFD.h>
 #include <ome/files/tiff/Tags.h>
@@ -83,6 +86,8 @@ namespace ome
         dimension_size_type ntiles;
         /// Buffer size for a tile.
         tsize_t buffersize;
+        /// Buffer size for a decoded tile.
+        dimension_size_type decodedsize;
 
         /**
          * Constructor.
@@ -99,9 +104,10 @@ namespace ome
           nrows(),
           ncols(),
           ntiles(),
-          buffersize()
+          buffersize(),
+          decodedsize()
         {
-          Sentry sentry;
+          Sentry sentry(*ifd->getTIFF());
           ::TIFF *tiff = getTIFF();
 
           // Get basic image metadata.
@@ -113,6 +119,10 @@ namespace ome
           tileheight = ifd->getTileHeight();
           type = ifd->getTileType();
 
+          // The accessors above may have returned cached values, so
+          // ensure the directory is current before querying libtiff.
+          ifd->makeCurrent();
+
           // Get tile-specific metadata, falling back to
           // strip-specific metadata if not present.
           if (type == TILE)
@@ -134,6 +144,27 @@ namespace ome
           if (imagewidth % tilewidth)
             ++ncols;
           ntiles = nrows * ncols;
+
+          // Packed samples are unpacked into 16-bit samples; each
+          // row of a tile or strip starts on a byte boundary.
+          decodedsize = static_cast<dimension_size_type>(buffersize);
+          uint16_t bits = ifd->getBitsPerSample();
+          if (isPackedSampleDepth(bits))
+            {
+              dimension_size_type rowsamples = static_cast<dimension_size_type>(tilewidth) *
+                (planarconfig == SEPARATE ? 1U : samples);
+              dimension_size_type rowbytes = packedSampleSize(rowsamples, bits);
+              if (rowbytes)
+                decodedsize = (decodedsize / rowbytes) * rowsamples * sizeof(uint16_t);
+            }
+          // Half precision samples are converted into FLOAT samples.
+          else if (bits == 16U)
+            {
+              uint16_t sampleformat = SAMPLEFORMAT_UINT;
+              if (TIFFGetFieldDefaulted(tiff, TIFFTAG_SAMPLEFORMAT, &sampleformat) &&
+                  sampleformat == SAMPLEFORMAT_IEEEFP)
+                decodedsize *= 2U;
+            }
         }
 
         /// Destructor.
@@ -156,6 +187,34 @@ namespace ome
           return sifd;
         }
 
+        /**
+         * Get the range of tiles covering a region.
+         *
+         * @param region the image region to cover.
+         * @param samplestart the first sample.
+         * @param nsamples the number of samples.
+         * @returns the range of tile indexes.
+         */
+        TileRange
+        range(const PlaneRegion&  region,
+              dimension_size_type samplestart,
+              dimension_size_type nsamples) const
+        {
+          if (!region.w || !region.h || !nsamples)
+            return TileRange();
+
+          // Compute row and column subrange for the covered region.
+          dimension_size_type colstart = region.x / tilewidth;
+          dimension_size_type collimit = (region.x + region.w - 1) / tilewidth + 1;
+          dimension_size_type rowstart = region.y / tileheight;
+          dimension_size_type rowlimit = (region.y + region.h - 1) / tileheight + 1;
+
+          return TileRange(ntiles, ncols,
+                           samplestart, nsamples,
+                           rowstart, rowlimit - rowstart,
+                           colstart, collimit - colstart);
+        }
+
         /**
          * Get the TIFF this tile belongs to.
          *
@@ -223,15 +282,23 @@ namespace ome
         return impl->buffersize;
       }
 
+      dimension_size_type
+      TileInfo::decodedBufferSize() const
+      {
+        return impl->decodedsize;
+      }
+
       dimension_size_type
       TileInfo::tileIndex(dimension_size_type x,
                           dimension_size_type y,
                           dimension_size_type s) const
       {
-        Sentry sentry;
-        ::TIFF *tiff = impl->getTIFF();
+        // Equivalent to TIFFComputeTile(), for a depth of 1.
+        dimension_size_type index = ((y / impl->tileheight) * impl->ncols) + (x / impl->tilewidth);
+        if (impl->planarconfig == SEPARATE)
+          index += s * impl->ntiles;
 
-        return TIFFComputeTile(tiff, x, y, 0, s);
+        return index;
       }
 
       dimension_size_type
@@ -284,33 +351,63 @@ namespace ome
       std::vector<dimension_size_type>
       TileInfo::tileCoverage(PlaneRegion region) const
       {
+        const TileRange range(tileRange(region));
+
         std::vector<dimension_size_type> ret;
+        ret.reserve(range.size());
+        for (const auto tile : range)
+          ret.push_back(tile);
 
-        dimension_size_type samplelimit = 1;
+        return ret;
+      }
+
+      TileRange
+      TileInfo::tileRange(const PlaneRegion& region) const
+      {
+        dimension_size_type nsamples = 1;
         if (impl->planarconfig == SEPARATE) // planar
-          samplelimit = impl->samples;
+          nsamples = impl->samples;
+
+        return impl->range(region, 0U, nsamples);
+      }
+
+      TileRange
+      TileInfo::tileRange(const PlaneRegion&  region,
+                          dimension_size_type sample) const
+      {
+        if (impl->planarconfig != SEPARATE) // chunky
+          return impl->range(region, 0U, 1U);
+
+        return impl->range(region, sample, 1U);
+      }
 
-        // Iterate over all samples
-        for (dimension_size_type sample = 0; sample < samplelimit; ++sample)
+      boost::optional<TileStatistics>
+      TileInfo::tileStatistics(dimension_size_type index) const
+      {
+        std::shared_ptr<const std::vector<TileStatistics>> stats(impl->getIFD()->getTileStatistics());
+
+        if (index >= stats->size() || std::isnan(stats->at(index).maximum))
+          return boost::none;
+
+        return stats->at(index);
+      }
+
+      std::vector<dimension_size_type>
+      TileInfo::tileCoverage(PlaneRegion region,
+                             double      threshold) const
+      {
+        std::shared_ptr<const std::vector<TileStatistics>> stats(impl->getIFD()->getTileStatistics());
+        const TileRange range(tileRange(region));
+
+        std::vector<dimension_size_type> ret;
+        ret.reserve(range.size());
+        for (const auto tile : range)
           {
-            // Compute row and column subrange for the covered region
-            dimension_size_type tile1 = tileIndex(region.x,                region.y,                sample);
-            dimension_size_type tile2 = tileIndex(region.x + region.w - 1, region.y,                sample);
-            dimension_size_type tile3 = tileIndex(region.x,                region.y + region.h - 1, sample);
-
-            dimension_size_type colstart = tileColumn(tile1);
-            dimension_size_type collimit = tileColumn(tile2) + 1;
-            dimension_size_type rowstart = tileRow(tile1);
-            dimension_size_type rowlimit = tileRow(tile3) + 1;
-
-            // Iterate over row and column subranges
-            for (dimension_size_type row = rowstart; row < rowlimit; ++row)
-              for (dimension_size_type col = colstart; col < collimit; ++col)
-                {
-                  // Compute tile index for the row/column/sample indexes
-                  dimension_size_type index = (sample * impl->ntiles) + (row * impl->ncols) + col;
-                  ret.push_back(index);
-                }
+            // NaN comparisons are false, so tiles without statistics
+            // are kept.
+            if (tile < stats->size() && stats->at(tile).maximum < threshold)
+              continue;
+            ret.push_back(tile);
           }
 
         return ret;
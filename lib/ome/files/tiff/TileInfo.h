@@ -38,7 +38,12 @@
 #ifndef OME_FILES_TIFF_TILEINFO_H
 #define OME_FILES_TIFF_TILEINFO_H
 
+#include <cstddef>
 #include <memory>
+#include <vector>
+
+#include <boost/iterator/iterator_facade.hpp>
+#include <boost/optional.hpp>
 
 #include <ome/files/PlaneRegion.h>
 #include <ome/files/tiff/Types.h>
@@ -52,11 +57,249 @@ namespace ome
 
       class IFD;
 
+      /**
+       * A range of tile indexes.
+       *
+       * The range is either the tiles covering a region, computed
+       * arithmetically from the tile grid without storing the
+       * indexes, or a list of tile indexes.  In the latter case the
+       * list is not copied, and must outlive the range.  Tiles
+       * covering a region are ordered by sample, then row, then
+       * column.
+       */
+      class TileRange
+      {
+      public:
+        /// Random access to the tile indexes.
+        class const_iterator : public boost::iterator_facade<const_iterator,
+                                                             const dimension_size_type,
+                                                             boost::random_access_traversal_tag,
+                                                             dimension_size_type>
+        {
+        public:
+          /// Default constructor.
+          const_iterator():
+            range(),
+            pos()
+          {}
+
+          /**
+           * Constructor.
+           *
+           * @param range the range to iterate over.
+           * @param pos the initial position.
+           */
+          const_iterator(const TileRange&    range,
+                         dimension_size_type pos):
+            range(&range),
+            pos(pos)
+          {}
+
+        private:
+          friend class boost::iterator_core_access;
+
+          /// Get the tile index at the current position.
+          dimension_size_type
+          dereference() const
+          {
+            return (*range)[pos];
+          }
+
+          /// Compare positions.
+          bool
+          equal(const const_iterator& rhs) const
+          {
+            return pos == rhs.pos;
+          }
+
+          /// Next position.
+          void
+          increment()
+          {
+            ++pos;
+          }
+
+          /// Previous position.
+          void
+          decrement()
+          {
+            --pos;
+          }
+
+          /// Move by @p n positions.
+          void
+          advance(std::ptrdiff_t n)
+          {
+            pos = static_cast<dimension_size_type>(static_cast<std::ptrdiff_t>(pos) + n);
+          }
+
+          /// Distance to @p rhs.
+          std::ptrdiff_t
+          distance_to(const const_iterator& rhs) const
+          {
+            return static_cast<std::ptrdiff_t>(rhs.pos) - static_cast<std::ptrdiff_t>(pos);
+          }
+
+          /// The range.
+          const TileRange *range;
+          /// The current position.
+          dimension_size_type pos;
+        };
+
+        /// Construct an empty range.
+        TileRange():
+          list(),
+          count(),
+          ntiles(),
+          ncols(),
+          samplestart(),
+          rowstart(),
+          colstart(),
+          nrows(),
+          ncolsrange()
+        {}
+
+        /**
+         * Construct from a list of tile indexes.
+         *
+         * @param tiles the tile indexes, which must outlive the
+         * range.
+         */
+        TileRange(const std::vector<dimension_size_type>& tiles):
+          list(tiles.data()),
+          count(tiles.size()),
+          ntiles(),
+          ncols(),
+          samplestart(),
+          rowstart(),
+          colstart(),
+          nrows(),
+          ncolsrange()
+        {}
+
+        /**
+         * Construct from a rectangle of the tile grid.
+         *
+         * @param ntiles the number of tiles per sample.
+         * @param ncols the number of columns in the tile grid.
+         * @param samplestart the first sample.
+         * @param nsamples the number of samples.
+         * @param rowstart the first row.
+         * @param nrows the number of rows.
+         * @param colstart the first column.
+         * @param ncolsrange the number of columns.
+         */
+        TileRange(dimension_size_type ntiles,
+                  dimension_size_type ncols,
+                  dimension_size_type samplestart,
+                  dimension_size_type nsamples,
+                  dimension_size_type rowstart,
+                  dimension_size_type nrows,
+                  dimension_size_type colstart,
+                  dimension_size_type ncolsrange):
+          list(),
+          count(nsamples * nrows * ncolsrange),
+          ntiles(ntiles),
+          ncols(ncols),
+          samplestart(samplestart),
+          rowstart(rowstart),
+          colstart(colstart),
+          nrows(nrows),
+          ncolsrange(ncolsrange)
+        {}
+
+        /**
+         * Get the number of tiles.
+         *
+         * @returns the tile count.
+         */
+        dimension_size_type
+        size() const
+        {
+          return count;
+        }
+
+        /**
+         * Check if the range is empty.
+         *
+         * @returns @c true if empty, @c false otherwise.
+         */
+        bool
+        empty() const
+        {
+          return count == 0U;
+        }
+
+        /**
+         * Get a tile index.
+         *
+         * @param i the position in the range.
+         * @returns the tile index.
+         */
+        dimension_size_type
+        operator[] (dimension_size_type i) const
+        {
+          if (list)
+            return list[i];
+
+          const dimension_size_type rowcol = i % (nrows * ncolsrange);
+          return ((samplestart + (i / (nrows * ncolsrange))) * ntiles) +
+            ((rowstart + (rowcol / ncolsrange)) * ncols) +
+            colstart + (rowcol % ncolsrange);
+        }
+
+        /**
+         * Get an iterator to the first tile.
+         *
+         * @returns the iterator.
+         */
+        const_iterator
+        begin() const
+        {
+          return const_iterator(*this, 0U);
+        }
+
+        /**
+         * Get an iterator past the last tile.
+         *
+         * @returns the iterator.
+         */
+        const_iterator
+        end() const
+        {
+          return const_iterator(*this, count);
+        }
+
+      private:
+        /// Tile index list, or null if computing from the tile grid.
+        const dimension_size_type *list;
+        /// Number of tiles.
+        dimension_size_type count;
+        /// Tiles per sample.
+        dimension_size_type ntiles;
+        /// Columns in the tile grid.
+        dimension_size_type ncols;
+        /// First sample.
+        dimension_size_type samplestart;
+        /// First row.
+        dimension_size_type rowstart;
+        /// First column.
+        dimension_size_type colstart;
+        /// Number of rows.
+        dimension_size_type nrows;
+        /// Number of columns.
+        dimension_size_type ncolsrange;
+      };
+
       /**
        * Tile information for an IFD.
        *
        * @note Strips are considered a special case of tiles where the
        * tile width is the image width.
+       *
+       * The tile geometry is cached on construction; the tile index,
+       * row, column, sample, region and coverage methods are computed
+       * from it, without accessing libtiff or taking the TIFF lock.
        */
       class TileInfo
       {
@@ -131,6 +374,19 @@ namespace ome
         dimension_size_type
         bufferSize() const;
 
+        /**
+         * Get the buffer size needed to contain a single decoded tile.
+         *
+         * This is the same as bufferSize(), other than for packed
+         * samples (see isPackedSampleDepth()), which are unpacked
+         * into 16-bit samples when decoded, and packed again when
+         * encoded.
+         *
+         * @returns the decoded buffer size.
+         */
+        dimension_size_type
+        decodedBufferSize() const;
+
         /**
          * Get the tile index covering the given coordinates.
          *
@@ -225,6 +481,62 @@ namespace ome
         std::vector<dimension_size_type>
         tileCoverage(PlaneRegion region) const;
 
+        /**
+         * Get the range of tiles covering an image region.
+         *
+         * This is equivalent to tileCoverage(), but the tile indexes
+         * are computed on access rather than stored.
+         *
+         * @param region the image region to cover.
+         * @returns the range of tile indexes.
+         */
+        TileRange
+        tileRange(const PlaneRegion& region) const;
+
+        /**
+         * Get the range of tiles covering an image region for a
+         * single sample.
+         *
+         * For planar images, only the tiles for the sample are
+         * included.  For contiguous images, each tile contains all
+         * samples, so this is the same as tileRange(region).
+         *
+         * @param region the image region to cover.
+         * @param sample the sample.
+         * @returns the range of tile indexes.
+         */
+        TileRange
+        tileRange(const PlaneRegion&  region,
+                  dimension_size_type sample) const;
+
+        /**
+         * Get the statistics of a tile.
+         *
+         * The statistics are only available if they were recorded
+         * when the image was written; see IFD::getTileStatistics().
+         *
+         * @param index the tile index.
+         * @returns the tile statistics, or none if not recorded.
+         */
+        boost::optional<TileStatistics>
+        tileStatistics(dimension_size_type index) const;
+
+        /**
+         * Get a list of the tiles covering an image region which
+         * may contain samples of at least a threshold value.
+         *
+         * Tiles whose recorded maximum is below the threshold are
+         * excluded, without reading any pixel data.  Tiles without
+         * recorded statistics are always included.
+         *
+         * @param region the image region to cover.
+         * @param threshold the minimum sample value of interest.
+         * @returns a list of tile indexes.
+         */
+        std::vector<dimension_size_type>
+        tileCoverage(PlaneRegion region,
+                     double      threshold) const;
+
       protected:
         class Impl;
         /// Private implementation details.
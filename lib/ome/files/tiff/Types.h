@@ -220,6 +220,14 @@ namespace ome
           TILE   ///< Tiles.
         };
 
+      /// Summary statistics of the samples in a tile or strip.
+      struct TileStatistics
+      {
+        double minimum; ///< Minimum sample value.
+        double maximum; ///< Maximum sample value.
+        double mean;    ///< Mean sample value.
+      };
+
     }
   }
 }
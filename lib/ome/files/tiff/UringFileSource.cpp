@@ -0,0 +1,610 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+
+#include <ome/files/config-internal.h>
+#include <ome/files/tiff/UringFileSource.h>
+
+#ifdef OME_HAVE_LIBURING
+# include <cerrno>
+# include <fcntl.h>
+# include <liburing.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif // OME_HAVE_LIBURING
+
+namespace ome
+{
+  namespace files
+  {
+    namespace tiff
+    {
+
+      /**
+       * Internal implementation details of UringFileSource.
+       */
+      class UringFileSource::Impl
+      {
+      public:
+        /// The filename.
+        boost::filesystem::path filename;
+        /// Fallback source, if io_uring is not available.
+        std::unique_ptr<MappedFileSource> fallback;
+        /// Number of io_uring submissions made.
+        std::atomic<uint64_t> submissions;
+
+#ifdef OME_HAVE_LIBURING
+        /// A read request.
+        struct Request
+        {
+          /// File offset.
+          uint64_t offset;
+          /// Requested size.
+          std::size_t size;
+          /// Owned data, for prefetched reads.
+          std::vector<char> data;
+          /// Destination buffer.
+          char *buffer;
+          /// Number of bytes read.
+          std::size_t count;
+          /// Set on completion.
+          std::promise<void> promise;
+          /// Completion state.
+          std::shared_future<void> done;
+
+          /**
+           * Constructor.
+           *
+           * @param offset the file offset.
+           * @param size the size to read.
+           * @param buffer the destination buffer, or null to read
+           * into owned data.
+           */
+          Request(uint64_t    offset,
+                  std::size_t size,
+                  void       *buffer):
+            offset(offset),
+            size(size),
+            data(buffer ? 0U : size),
+            buffer(buffer ? static_cast<char *>(buffer) : data.data()),
+            count(0U),
+            promise(),
+            done(promise.get_future().share())
+          {
+          }
+        };
+
+        /// Shared request.
+        typedef std::shared_ptr<Request> request_ptr;
+
+        /// File size.
+        uint64_t filesize;
+        /// Maximum reads in flight.
+        std::size_t queuedepth;
+        /// Maximum size of prefetched data.
+        std::size_t cachesize;
+        /// File descriptor.
+        int fd;
+        /// The ring.
+        io_uring ring;
+        /// Mutex protecting submission, the requests and the cache.
+        std::mutex mutex;
+        /// Prefetched requests, by offset.
+        std::map<uint64_t, request_ptr> prefetched;
+        /// Prefetched offsets, oldest first.
+        std::deque<uint64_t> order;
+        /// Size of the prefetched data.
+        std::size_t cached;
+        /// Requests in flight.
+        std::unordered_map<Request *, request_ptr> inflight;
+        /// Stop the completion thread when no requests are in flight.
+        bool stopping;
+        /// Completion thread.
+        std::thread reaper;
+#endif // OME_HAVE_LIBURING
+
+        /**
+         * Constructor.
+         *
+         * @param filename the file to read.
+         * @param queuedepth the maximum number of reads in flight.
+         * @param cachesize the maximum size of prefetched data.
+         */
+        Impl(const boost::filesystem::path& filename,
+             std::size_t                    queuedepth,
+             std::size_t                    cachesize):
+          filename(filename),
+          fallback(),
+          submissions(0U)
+#ifdef OME_HAVE_LIBURING
+          ,
+          filesize(0U),
+          queuedepth(std::max(queuedepth, static_cast<std::size_t>(1U))),
+          cachesize(cachesize),
+          fd(-1),
+          ring(),
+          mutex(),
+          prefetched(),
+          order(),
+          cached(0U),
+          inflight(),
+          stopping(false),
+          reaper()
+#endif // OME_HAVE_LIBURING
+        {
+#ifdef OME_HAVE_LIBURING
+          fd = ::open(filename.string().c_str(), O_RDONLY);
+          if (fd < 0)
+            throw std::system_error(errno, std::generic_category(),
+                                    "Failed to open file " + filename.string());
+
+          struct stat st;
+          if (::fstat(fd, &st) < 0)
+            {
+              int err = errno;
+              ::close(fd);
+              throw std::system_error(err, std::generic_category(),
+                                      "Failed to get size of file " + filename.string());
+            }
+          filesize = static_cast<uint64_t>(st.st_size);
+
+          // io_uring may be unavailable or disabled by the kernel.
+          if (io_uring_queue_init(static_cast<unsigned int>(std::min(this->queuedepth, static_cast<std::size_t>(4096U))),
+                                  &ring, 0) < 0)
+            {
+              ::close(fd);
+              fd = -1;
+              fallback.reset(new MappedFileSource(filename));
+              return;
+            }
+
+          reaper = std::thread([this](){ reap(); });
+#else // ! OME_HAVE_LIBURING
+          static_cast<void>(queuedepth);
+          static_cast<void>(cachesize);
+          fallback.reset(new MappedFileSource(filename));
+#endif // OME_HAVE_LIBURING
+        }
+
+        /// Destructor.
+        ~Impl()
+        {
+#ifdef OME_HAVE_LIBURING
+          if (fd < 0)
+            return;
+
+          {
+            // Wake the completion thread; it exits once the reads
+            // in flight have completed, since the kernel may write
+            // into their buffers until then.
+            std::lock_guard<std::mutex> lock(mutex);
+            io_uring_sqe *sqe = getSQE();
+            io_uring_prep_nop(sqe);
+            io_uring_sqe_set_data(sqe, nullptr);
+            io_uring_submit(&ring);
+          }
+          reaper.join();
+
+          io_uring_queue_exit(&ring);
+          ::close(fd);
+#endif // OME_HAVE_LIBURING
+        }
+
+#ifdef OME_HAVE_LIBURING
+        /**
+         * Get a submission queue entry.
+         *
+         * If the submission queue is full, the queued entries are
+         * submitted to make space.
+         *
+         * @note The mutex must be held by the caller.
+         *
+         * @returns the entry.
+         */
+        io_uring_sqe *
+        getSQE()
+        {
+          io_uring_sqe *sqe = io_uring_get_sqe(&ring);
+          while (!sqe)
+            {
+              io_uring_submit(&ring);
+              ++submissions;
+              sqe = io_uring_get_sqe(&ring);
+            }
+          return sqe;
+        }
+
+        /**
+         * Queue a read request.
+         *
+         * @note The mutex must be held by the caller.
+         *
+         * @param request the request to queue.
+         */
+        void
+        queue(const request_ptr& request)
+        {
+          io_uring_sqe *sqe = getSQE();
+          io_uring_prep_read(sqe, fd, request->buffer,
+                             static_cast<unsigned int>(request->size),
+                             request->offset);
+          io_uring_sqe_set_data(sqe, request.get());
+          inflight.insert(std::make_pair(request.get(), request));
+        }
+
+        /**
+         * Submit the queued requests.
+         *
+         * @note The mutex must be held by the caller.
+         */
+        void
+        submit()
+        {
+          int ret = io_uring_submit(&ring);
+          ++submissions;
+          if (ret < 0)
+            throw std::system_error(-ret, std::generic_category(),
+                                    "Failed to submit reads for " + filename.string());
+        }
+
+        /**
+         * Read directly, without io_uring.
+         *
+         * @param offset the offset to read from.
+         * @param buffer the buffer to read into.
+         * @param size the number of bytes to read.
+         * @returns the number of bytes read.
+         */
+        std::size_t
+        readDirect(uint64_t    offset,
+                   char       *buffer,
+                   std::size_t size)
+        {
+          std::size_t count = 0U;
+          while (count < size)
+            {
+              ssize_t n = ::pread(fd, buffer + count, size - count,
+                                  static_cast<off_t>(offset + count));
+              if (n < 0 && errno == EINTR)
+                continue;
+              if (n < 0)
+                throw std::system_error(errno, std::generic_category(),
+                                        "Failed to read " + filename.string());
+              if (n == 0)
+                break;
+              count += static_cast<std::size_t>(n);
+            }
+          return count;
+        }
+
+        /**
+         * Complete a read request.
+         *
+         * Short reads before the end of the file are completed
+         * directly.
+         *
+         * @param request the request.
+         * @param result the io_uring result.
+         */
+        void
+        complete(const request_ptr& request,
+                 int                result)
+        {
+          try
+            {
+              if (result < 0)
+                throw std::system_error(-result, std::generic_category(),
+                                        "Failed to read " + filename.string());
+              request->count = static_cast<std::size_t>(result);
+              if (request->count < request->size && result > 0)
+                request->count += readDirect(request->offset + request->count,
+                                             request->buffer + request->count,
+                                             request->size - request->count);
+              request->promise.set_value();
+            }
+          catch (...)
+            {
+              request->promise.set_exception(std::current_exception());
+            }
+        }
+
+        /// Receive completions until stopped.
+        void
+        reap()
+        {
+          while (true)
+            {
+              {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (stopping && inflight.empty())
+                  break;
+              }
+
+              io_uring_cqe *cqe = nullptr;
+              int ret = io_uring_wait_cqe(&ring, &cqe);
+              if (ret == -EINTR)
+                continue;
+              if (ret < 0)
+                break;
+
+              Request *key = static_cast<Request *>(io_uring_cqe_get_data(cqe));
+              int result = cqe->res;
+              io_uring_cqe_seen(&ring, cqe);
+
+              request_ptr request;
+              {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!key)
+                  {
+                    stopping = true;
+                    continue;
+                  }
+                auto found = inflight.find(key);
+                if (found == inflight.end())
+                  continue;
+                request = found->second;
+                inflight.erase(found);
+              }
+              complete(request, result);
+            }
+        }
+
+        /**
+         * Evict completed prefetched data to make space.
+         *
+         * @note The mutex must be held by the caller.
+         *
+         * @param size the space required.
+         * @returns @c true if there is space, or @c false otherwise.
+         */
+        bool
+        makeSpace(std::size_t size)
+        {
+          while (cached + size > cachesize && !order.empty())
+            {
+              auto found = prefetched.find(order.front());
+              if (found != prefetched.end())
+                {
+                  if (found->second->done.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+                    return false;
+                  cached -= found->second->size;
+                  prefetched.erase(found);
+                }
+              order.pop_front();
+            }
+          return cached + size <= cachesize;
+        }
+#endif // OME_HAVE_LIBURING
+      };
+
+      UringFileSource::UringFileSource(const boost::filesystem::path& filename,
+                                       std::size_t                    queuedepth,
+                                       std::size_t                    cachesize):
+        IOSource(),
+        impl(new Impl(filename, queuedepth, cachesize))
+      {
+      }
+
+      UringFileSource::~UringFileSource()
+      {
+      }
+
+      std::string
+      UringFileSource::name() const
+      {
+        return impl->filename.string();
+      }
+
+      uint64_t
+      UringFileSource::size() const
+      {
+        if (impl->fallback)
+          return impl->fallback->size();
+#ifdef OME_HAVE_LIBURING
+        return impl->filesize;
+#else // ! OME_HAVE_LIBURING
+        return 0U;
+#endif // OME_HAVE_LIBURING
+      }
+
+      std::size_t
+      UringFileSource::read(uint64_t    offset,
+                            void       *buffer,
+                            std::size_t size)
+      {
+        if (impl->fallback)
+          return impl->fallback->read(offset, buffer, size);
+
+#ifdef OME_HAVE_LIBURING
+        // Use the prefetched range containing the read, if any.
+        // libtiff may read a large strip in several parts, so the
+        // range is retained until its end has been read.
+        Impl::request_ptr request;
+        {
+          std::lock_guard<std::mutex> lock(impl->mutex);
+          auto found = impl->prefetched.upper_bound(offset);
+          if (found != impl->prefetched.begin())
+            {
+              --found;
+              const Impl::request_ptr& candidate(found->second);
+              if (offset + size <= candidate->offset + candidate->size)
+                {
+                  request = candidate;
+                  if (offset + size == candidate->offset + candidate->size)
+                    {
+                      impl->cached -= candidate->size;
+                      impl->prefetched.erase(found);
+                    }
+                }
+            }
+        }
+
+        if (!request)
+          return impl->readDirect(offset, static_cast<char *>(buffer), size);
+
+        if (request->done.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+          {
+            // Ensure any requests left queued by a failed submission
+            // are submitted before waiting.
+            std::lock_guard<std::mutex> lock(impl->mutex);
+            io_uring_submit(&impl->ring);
+          }
+        request->done.get();
+        std::size_t start = static_cast<std::size_t>(offset - request->offset);
+        if (start >= request->count)
+          return 0U;
+        std::size_t count = std::min(size, request->count - start);
+        std::memcpy(buffer, request->buffer + start, count);
+        return count;
+#else // ! OME_HAVE_LIBURING
+        return 0U;
+#endif // OME_HAVE_LIBURING
+      }
+
+      std::future<std::size_t>
+      UringFileSource::readAsync(uint64_t    offset,
+                                 void       *buffer,
+                                 std::size_t size)
+      {
+        if (impl->fallback)
+          return IOSource::readAsync(offset, buffer, size);
+
+#ifdef OME_HAVE_LIBURING
+        Impl::request_ptr request(std::make_shared<Impl::Request>(offset, size, buffer));
+        {
+          std::lock_guard<std::mutex> lock(impl->mutex);
+          impl->queue(request);
+          impl->submit();
+        }
+        return std::async(std::launch::deferred,
+                          [request]()
+                          {
+                            request->done.get();
+                            return request->count;
+                          });
+#else // ! OME_HAVE_LIBURING
+        return IOSource::readAsync(offset, buffer, size);
+#endif // OME_HAVE_LIBURING
+      }
+
+      void
+      UringFileSource::prefetch(const std::vector<range_type>& ranges)
+      {
+        if (impl->fallback)
+          return;
+
+#ifdef OME_HAVE_LIBURING
+        std::lock_guard<std::mutex> lock(impl->mutex);
+        bool queued = false;
+        for (const auto& range : ranges)
+          {
+            if (!range.second || range.first >= impl->filesize)
+              continue;
+            if (impl->prefetched.find(range.first) != impl->prefetched.end())
+              continue;
+
+            // Prefetching is advisory; stop when full.
+            if (impl->inflight.size() >= impl->queuedepth ||
+                !impl->makeSpace(range.second))
+              break;
+
+            std::size_t size = static_cast<std::size_t>(std::min(static_cast<uint64_t>(range.second),
+                                                                 impl->filesize - range.first));
+            Impl::request_ptr request(std::make_shared<Impl::Request>(range.first, size, nullptr));
+            impl->queue(request);
+            impl->prefetched.insert(std::make_pair(range.first, request));
+            impl->order.push_back(range.first);
+            impl->cached += size;
+            queued = true;
+          }
+
+        // All the ranges are submitted together.  Failure is not
+        // reported here; the requests remain queued and are
+        // submitted again by a subsequent read.
+        if (queued)
+          {
+            try
+              {
+                impl->submit();
+              }
+            catch (const std::exception&)
+              {
+              }
+          }
+#endif // OME_HAVE_LIBURING
+      }
+
+      void
+      UringFileSource::setStatistics(const std::shared_ptr<IOStatistics>& statistics)
+      {
+        if (impl->fallback)
+          impl->fallback->setStatistics(statistics);
+      }
+
+      bool
+      UringFileSource::isBatched() const
+      {
+        return !impl->fallback;
+      }
+
+      uint64_t
+      UringFileSource::getSubmissionCount() const
+      {
+        return impl->submissions;
+      }
+
+    }
+  }
+}
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
@@ -0,0 +1,160 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#ifndef OME_FILES_TIFF_URINGFILESOURCE_H
+#define OME_FILES_TIFF_URINGFILESOURCE_H
+
+#include <memory>
+
+#include <boost/filesystem/path.hpp>
+
+#include <ome/files/tiff/IOSource.h>
+
+namespace ome
+{
+  namespace files
+  {
+    namespace tiff
+    {
+
+      /**
+       * Local file source with batched asynchronous reads.
+       *
+       * On Linux, where built with liburing, reads are made using
+       * io_uring.  prefetch() submits the byte ranges of all the
+       * tiles or strips covering a region (such as a single
+       * IFD::readImage() request) with a single system call, giving
+       * a high queue depth on fast storage without a thread per
+       * request.  Completions are received by a background thread.
+       * A read of a prefetched range waits only for that range, so
+       * each tile may be decoded as soon as its data arrives, while
+       * the remaining reads are still in flight.  Reads which were
+       * not prefetched are made directly.
+       *
+       * Prefetched data is retained until read, bounded by the cache
+       * size; prefetching stops when the cache or the submission
+       * queue is full.
+       *
+       * Where io_uring is not available (other systems, or where
+       * disabled by the kernel), the file is read using a memory
+       * mapping, as for MappedFileSource.
+       *
+       * This class is thread-safe.
+       */
+      class UringFileSource : public IOSource
+      {
+      private:
+        class Impl;
+        /// Private implementation details.
+        std::unique_ptr<Impl> impl;
+
+      public:
+        /**
+         * Constructor.
+         *
+         * @param filename the file to read.
+         * @param queuedepth the maximum number of reads in flight.
+         * @param cachesize the maximum size of prefetched data, in
+         * bytes.
+         * @throws std::exception if the file could not be opened.
+         */
+        explicit
+        UringFileSource(const boost::filesystem::path& filename,
+                        std::size_t                    queuedepth = 256U,
+                        std::size_t                    cachesize = 64U * 1024U * 1024U);
+
+        /// Destructor.
+        virtual
+        ~UringFileSource();
+
+        // Documented in superclass.
+        std::string
+        name() const;
+
+        // Documented in superclass.
+        uint64_t
+        size() const;
+
+        // Documented in superclass.
+        std::size_t
+        read(uint64_t    offset,
+             void       *buffer,
+             std::size_t size);
+
+        // Documented in superclass.
+        std::future<std::size_t>
+        readAsync(uint64_t    offset,
+                  void       *buffer,
+                  std::size_t size);
+
+        // Documented in superclass.
+        void
+        prefetch(const std::vector<range_type>& ranges);
+
+        // Documented in superclass.
+        void
+        setStatistics(const std::shared_ptr<IOStatistics>& statistics);
+
+        /**
+         * Check if reads are made using io_uring.
+         *
+         * @returns @c true if using io_uring, or @c false if using
+         * the fallback memory mapping.
+         */
+        bool
+        isBatched() const;
+
+        /**
+         * Get the number of io_uring submissions made.
+         *
+         * @returns the submission count.
+         */
+        uint64_t
+        getSubmissionCount() const;
+      };
+
+    }
+  }
+}
+
+#endif // OME_FILES_TIFF_URINGFILESOURCE_H
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
@@ -35,8 +35,16 @@
  * #L%
  */
 
+#include <array>
+#include <algorithm>
+#include <limits>
+
+#include <boost/filesystem/fstream.hpp>
+
 #include <ome/files/CoreMetadata.h>
 #include <ome/files/FormatException.h>
+#include <ome/files/PixelProperties.h>
+#include <ome/files/tiff/BitPack.h>
 #include <ome/files/tiff/Field.h>
 #include <ome/files/tiff/IFD.h>
 #include <ome/files/tiff/Tags.h>
@@ -115,12 +123,16 @@ namespace ome
 
           typedef typename ::ome::files::detail::tiff::TagProperties<TagCategory>::value_type value_type;
 
+          // Most tags are absent, so probe without throwing; the
+          // value may still be invalid.
           try
             {
               value_type v;
-              ifd.getField(tag).get(v);
-              setMetadata(core, key, v);
-              set = true;
+              if (ifd.getField(tag).tryGet(v))
+                {
+                  setMetadata(core, key, v);
+                  set = true;
+                }
             }
           catch (...)
             {
@@ -179,8 +191,8 @@ namespace ome
             try
               {
                 std::array<std::vector<uint16_t>, 3> cmap;
-                ifd.getField(tiff::COLORMAP).get(cmap);
-                core.indexed = true;
+                if (ifd.getField(tiff::COLORMAP).tryGet(cmap))
+                  core.indexed = true;
               }
             catch (...)
               {
@@ -193,8 +205,7 @@ namespace ome
             try
               {
                 uint16_t indexed;
-                ifd.getField(tiff::INDEXED).get(indexed);
-                if (indexed)
+                if (ifd.getField(tiff::INDEXED).tryGet(indexed) && indexed)
                   {
                     core.indexed = true;
                   }
@@ -217,16 +228,18 @@ namespace ome
         /// @todo Text stream output for Tag enums.
         /// @todo Metadata type for PhotometricInterpretation.
 
+        setMetadata(ifd, core, "Artist", ARTIST);
         try
           {
-            setMetadata(ifd, core, "Artist", ARTIST);
             Threshholding th;
-            ifd.getField(THRESHHOLDING).get(th);
-            core.seriesMetadata.set("Threshholding", th);
-            if (th == HALFTONE)
+            if (ifd.getField(THRESHHOLDING).tryGet(th))
               {
-                setMetadata(ifd, core, "CellWidth", CELLWIDTH);
-                setMetadata(ifd, core, "CellLength", CELLLENGTH);
+                core.seriesMetadata.set("Threshholding", th);
+                if (th == HALFTONE)
+                  {
+                    setMetadata(ifd, core, "CellWidth", CELLWIDTH);
+                    setMetadata(ifd, core, "CellLength", CELLLENGTH);
+                  }
               }
           }
         catch (...)
@@ -343,8 +356,8 @@ namespace ome
             try
               {
                 std::vector<ExtraSamples> extra;
-                ifd.getField(EXTRASAMPLES).get(extra);
-                samples += static_cast<uint16_t>(extra.size());
+                if (ifd.getField(EXTRASAMPLES).tryGet(extra))
+                  samples += static_cast<uint16_t>(extra.size());
               }
             catch (...)
               {
@@ -386,6 +399,80 @@ namespace ome
         return ifdidx;
       }
 
+      bool
+      isTIFFHeader(const uint8_t *data,
+                   std::size_t    size)
+      {
+        if (size < 8U)
+          return false;
+
+        bool little;
+        if (data[0] == 'I' && data[1] == 'I')
+          little = true;
+        else if (data[0] == 'M' && data[1] == 'M')
+          little = false;
+        else
+          return false;
+
+        // Read an unsigned integer of the specified size in the file
+        // byte order.
+        auto get = [data, little](std::size_t offset, std::size_t bytes) -> uint64_t
+          {
+            uint64_t value = 0U;
+            for (std::size_t i = 0; i < bytes; ++i)
+              {
+                uint64_t byte = data[offset + (little ? bytes - 1U - i : i)];
+                value = (value << 8) | byte;
+              }
+            return value;
+          };
+
+        uint64_t version = get(2U, 2U);
+        if (version == 42U) // Classic TIFF.
+          {
+            return get(4U, 4U) >= 8U;
+          }
+        else if (version == 43U) // BigTIFF.
+          {
+            return size >= header_size &&
+              get(4U, 2U) == 8U && // Offset size.
+              get(6U, 2U) == 0U &&
+              get(8U, 8U) >= header_size;
+          }
+        return false;
+      }
+
+      bool
+      isTIFFHeader(const boost::filesystem::path& filename,
+                   const IOSourceFactory&         factory)
+      {
+        uint8_t header[header_size];
+        std::size_t size = 0U;
+
+        try
+          {
+            if (factory)
+              {
+                std::shared_ptr<IOSource> source(factory(filename));
+                if (!source)
+                  return false;
+                size = source->read(0U, header, sizeof(header));
+              }
+            else
+              {
+                boost::filesystem::ifstream in(filename, std::ios::in | std::ios::binary);
+                in.read(reinterpret_cast<char *>(header), sizeof(header));
+                size = static_cast<std::size_t>(in.gcount());
+              }
+          }
+        catch (const std::exception&)
+          {
+            return false;
+          }
+
+        return isTIFFHeader(header, size);
+      }
+
       bool
       enableBigTIFF(const boost::optional<bool>&   wantBig,
                     storage_size_type              pixelSize,
@@ -439,6 +526,167 @@ namespace ome
         return enable;
       }
 
+      namespace
+      {
+
+        // Cost model for chooseTileGeometry().  The fixed cost of
+        // locating, reading and setting up the codec for a tile or
+        // strip, and the cost of decoding and copying each byte of
+        // uncompressed and compressed data (seconds).
+        const double chunk_cost = 50.0e-6;
+        const double byte_cost = 0.5e-9;
+        const double compressed_byte_cost = 5.0e-9;
+
+        // Typical region sizes for random viewport and Z column
+        // access.
+        const uint32_t viewport_width = 1024U;
+        const uint32_t viewport_height = 768U;
+        const uint32_t column_size = 64U;
+
+        // Candidate tile and strip sizes.  Larger tiles and strips
+        // increase the memory needed to cache partially written
+        // tiles, and the time to first pixel, for little gain.
+        const uint32_t min_tile_size = 64U;
+        const uint32_t max_tile_size = 1024U;
+        const dimension_size_type min_strip_bytes = 16384U;
+        const dimension_size_type max_strip_bytes = 1048576U;
+
+        // Mean number of tiles of the specified size intersected by
+        // a span at a random position within an extent.
+        double
+        meanTileCount(uint32_t span,
+                      uint32_t tile,
+                      uint32_t extent)
+        {
+          span = std::min(span, extent);
+          double tiles = (extent + tile - 1U) / tile;
+          return std::min(tiles, (static_cast<double>(span) - 1.0) / tile + 1.0);
+        }
+
+      }
+
+      uint16_t
+      storedBitsPerSample(::ome::xml::model::enums::PixelType pixeltype,
+                          pixel_size_type                     significant,
+                          bool                                pack)
+      {
+        if (pack && pixeltype == ::ome::xml::model::enums::PixelType::UINT16 &&
+            isPackedSampleDepth(static_cast<uint16_t>(significant)))
+          return static_cast<uint16_t>(significant);
+        if (pack && pixeltype == ::ome::xml::model::enums::PixelType::FLOAT &&
+            significant == 16U)
+          return 16U;
+        return static_cast<uint16_t>(bitsPerPixel(pixeltype));
+      }
+
+      bool
+      setupJPEGYCbCr(IFD& ifd)
+      {
+        // Height of a JPEG block with 2× vertical subsampling.
+        const uint32_t blockheight = 16U;
+
+        if (ifd.getCompression() != COMPRESSION_JPEG ||
+            ifd.getPhotometricInterpretation() != RGB ||
+            ifd.getPixelType() != ::ome::xml::model::enums::PixelType::UINT8 ||
+            ifd.getSamplesPerPixel() != 3U ||
+            ifd.getPlanarConfiguration() != CONTIG)
+          return false;
+
+        uint32_t height = ifd.getTileHeight();
+        if (height % blockheight)
+          {
+            // A single strip may be any height.
+            if (ifd.getTileType() == TILE)
+              return false;
+            if (height < ifd.getImageHeight())
+              ifd.setTileHeight(std::max(height - (height % blockheight), blockheight));
+          }
+
+        ifd.setPhotometricInterpretation(YCBCR);
+        std::array<uint16_t, 2> subsampling{{2U, 2U}};
+        ifd.getField(YCBCRSUBSAMPLING).set(subsampling);
+
+        return true;
+      }
+
+      TileGeometry
+      chooseTileGeometry(AccessProfile                       profile,
+                         uint32_t                            width,
+                         uint32_t                            height,
+                         ::ome::xml::model::enums::PixelType pixeltype,
+                         uint16_t                            samples,
+                         PlanarConfiguration                 planarconfig,
+                         Compression                         compression)
+      {
+        if (!width || !height)
+          throw FormatException("Can't set strip or tile size: image size is 0");
+
+        uint32_t regionwidth = width;
+        uint32_t regionheight = height;
+        switch (profile)
+          {
+          case ACCESS_SEQUENTIAL:
+            break;
+          case ACCESS_RANDOM_VIEWPORT:
+            regionwidth = viewport_width;
+            regionheight = viewport_height;
+            break;
+          case ACCESS_Z_COLUMN:
+            regionwidth = regionheight = column_size;
+            break;
+          }
+
+        // Separate planes store one sample in each tile, with a tile
+        // for each sample.
+        dimension_size_type pixelbytes = bytesPerPixel(pixeltype);
+        double tilesets = 1.0;
+        if (planarconfig == CONTIG)
+          pixelbytes *= samples;
+        else
+          tilesets = samples;
+
+        const double bytecost = compression == COMPRESSION_NONE ? byte_cost : compressed_byte_cost;
+        auto cost = [&](uint32_t tilewidth, uint32_t tileheight)
+          {
+            double tiles = meanTileCount(regionwidth, tilewidth, width) *
+              meanTileCount(regionheight, tileheight, height) * tilesets;
+            double tilebytes = static_cast<double>(tilewidth) * tileheight * pixelbytes;
+            return tiles * (chunk_cost + (tilebytes * bytecost));
+          };
+
+        // Strips.
+        TileGeometry best{STRIP, width, 1U};
+        double bestcost = std::numeric_limits<double>::max();
+        const dimension_size_type rowbytes = width * pixelbytes;
+        for (dimension_size_type stripbytes = min_strip_bytes;
+             stripbytes <= max_strip_bytes;
+             stripbytes *= 4U)
+          {
+            uint32_t rows = static_cast<uint32_t>(std::min(std::max(stripbytes / rowbytes,
+                                                                    dimension_size_type(1U)),
+                                                           dimension_size_type(height)));
+            double c = cost(width, rows);
+            if (c < bestcost)
+              {
+                best = TileGeometry{STRIP, width, rows};
+                bestcost = c;
+              }
+          }
+
+        // Tiles.
+        for (uint32_t size = min_tile_size; size <= max_tile_size; size *= 2U)
+          {
+            double c = cost(size, size);
+            if (c < bestcost)
+              {
+                best = TileGeometry{TILE, size, size};
+                bestcost = c;
+              }
+          }
+
+        return best;
+      }
+
     }
   }
 }
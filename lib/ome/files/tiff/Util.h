@@ -46,6 +46,7 @@
 
 #include <ome/files/CoreMetadata.h>
 #include <ome/files/TileCoverage.h>
+#include <ome/files/tiff/IOSource.h>
 #include <ome/files/tiff/TileInfo.h>
 #include <ome/files/tiff/Types.h>
 #include <ome/files/VariantPixelBuffer.h>
@@ -143,6 +144,131 @@ namespace ome
                     const boost::filesystem::path& filename,
                     ome::common::Logger&           logger);
 
+      /**
+       * Get the bits per sample to store samples of a pixel type.
+       *
+       * Samples are stored whole, unless packing is requested and
+       * the pixel type is @c UINT16 with a significant bit depth
+       * which may be packed (see isPackedSampleDepth()), or @c FLOAT
+       * with 16 significant bits, which is stored in half precision.
+       *
+       * @param pixeltype the pixel type.
+       * @param significant the significant bits per sample, or zero
+       * if unknown.
+       * @param pack @c true if packing is requested, @c false
+       * otherwise.
+       * @returns the bits per sample.
+       */
+      uint16_t
+      storedBitsPerSample(::ome::xml::model::enums::PixelType pixeltype,
+                          pixel_size_type                     significant,
+                          bool                                pack);
+
+      /**
+       * Use YCbCr chrominance subsampling for JPEG-compressed RGB.
+       *
+       * 8-bit RGB images with contiguous samples are stored as YCbCr
+       * with 4:2:0 subsampling when JPEG compression is used, which
+       * is typically two to three times smaller than JPEG-compressed
+       * RGB.  libjpeg converts between RGB and YCbCr, so pixel
+       * buffers remain RGB for both reading and writing.  Strip
+       * heights are rounded down to a multiple of the 16 row JPEG
+       * block height required by subsampling; tiles which are not a
+       * multiple of 16 high are left as RGB.
+       *
+       * The pixel type, samples per pixel, planar configuration,
+       * photometric interpretation, compression and tile geometry
+       * must be set before calling.
+       *
+       * @param ifd the IFD to set up.
+       * @returns @c true if YCbCr subsampling was used, @c false
+       * otherwise.
+       */
+      bool
+      setupJPEGYCbCr(IFD& ifd);
+
+      /// Geometry of the tiles or strips of an image.
+      struct TileGeometry
+      {
+        /// Tile type.
+        TileType type;
+        /// Tile width (the image width for strips).
+        uint32_t width;
+        /// Tile height, or rows per strip.
+        uint32_t height;
+      };
+
+      /**
+       * Choose the tile or strip geometry for an access profile.
+       *
+       * Square tiles from 64 to 1024 pixels, and strips of 16KiB to
+       * 1MiB, are costed using a simple model of the time taken to
+       * read a typical region for the profile: whole planes for
+       * sequential access, 1024×768 viewports for random access and
+       * 64×64 regions for Z columns.  Each tile or strip
+       * intersecting the region has a fixed cost for locating and
+       * reading it, plus a cost for decoding each of its bytes,
+       * which is higher for compressed data.  The geometry with the
+       * lowest cost is chosen, preferring strips where the cost is
+       * equal.  The model constants are approximations from the
+       * read times recorded by the tiling benchmark (see
+       * docs/sphinx/tiling.rst).
+       *
+       * @param profile the expected access profile.
+       * @param width the image width.
+       * @param height the image height.
+       * @param pixeltype the pixel type.
+       * @param samples the number of samples per pixel.
+       * @param planarconfig the planar configuration.
+       * @param compression the compression scheme.
+       * @returns the chosen geometry.
+       */
+      TileGeometry
+      chooseTileGeometry(AccessProfile                       profile,
+                         uint32_t                            width,
+                         uint32_t                            height,
+                         ::ome::xml::model::enums::PixelType pixeltype,
+                         uint16_t                            samples,
+                         PlanarConfiguration                 planarconfig,
+                         Compression                         compression);
+
+      /// Number of bytes required to check a TIFF header.
+      const std::size_t header_size = 16U;
+
+      /**
+       * Check if data starts with a valid TIFF or BigTIFF header.
+       *
+       * The byte order mark, version and offset of the first IFD are
+       * checked.  No directories are read, so this is much cheaper
+       * than opening the file, but does not check that the file is
+       * readable.
+       *
+       * @param data the start of the data.
+       * @param size the size of the data, which should be at least
+       * header_size bytes; smaller sizes are permitted for short
+       * files.
+       * @returns @c true if a TIFF header, @c false otherwise.
+       */
+      bool
+      isTIFFHeader(const uint8_t *data,
+                   std::size_t    size);
+
+      /**
+       * Check if a file starts with a valid TIFF or BigTIFF header.
+       *
+       * Only the header is read, using the I/O source factory if
+       * set.
+       *
+       * @param filename the file to check.
+       * @param factory the I/O source factory, or an empty function
+       * to read the file directly.
+       * @returns @c true if a TIFF header, @c false otherwise
+       * (including if the file could not be read).
+       */
+      bool
+      isTIFFHeader(const boost::filesystem::path& filename,
+                   const IOSourceFactory&         factory = IOSourceFactory());
+
     }
   }
 }
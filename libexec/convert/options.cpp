@@ -0,0 +1,250 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2014 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <convert/options.h>
+
+namespace opt = boost::program_options;
+
+namespace convert
+{
+
+  options::options ():
+    action(ACTION_CONVERT),
+    verbosity(MSG_NORMAL),
+    pixeltype(),
+    scale(1.0),
+    offset(0.0),
+    compression(),
+    tilewidth(),
+    tileheight(),
+    resolutions(1U),
+    readthreads(1U),
+    convertthreads(1U),
+    encodethreads(1U),
+    queuedepth(16U),
+    rawcopy(true),
+    pixeltypeString(),
+    compressionString(),
+    tilewidthValue(0U),
+    tileheightValue(0U),
+    files(),
+    actions("Actions"),
+    general("General options"),
+    conversion("Conversion options"),
+    performance("Performance options"),
+    hidden("Hidden options"),
+    positional(),
+    visible(),
+    global(),
+    vm()
+  {
+  }
+
+  options::~options ()
+  {
+  }
+
+  boost::program_options::options_description const&
+  options::get_visible_options() const
+  {
+    return this->visible;
+  }
+
+  void
+  options::parse (int   argc,
+                  char *argv[])
+  {
+    add_options();
+    add_option_groups();
+
+    opt::store(opt::command_line_parser(argc, argv).
+               options(global).positional(positional).run(), vm);
+    opt::notify(vm);
+
+    check_options();
+    check_actions();
+  }
+
+  void
+  options::add_options ()
+  {
+    actions.add_options()
+      ("usage,u",
+       "Show command usage")
+      ("help,h",
+       "Display manual for this command")
+      ("convert",
+       "Convert the image (default)")
+      ("version,V",
+       "Print version information");
+
+    general.add_options()
+      ("debug",
+       "Show debug output")
+      ("quiet,q",
+       "Show less output")
+      ("verbose,v",
+       "Show more output");
+
+    conversion.add_options()
+      ("pixel-type", opt::value<std::string>(&this->pixeltypeString),
+       "Convert to the specified pixel type")
+      ("scale", opt::value<double>(&this->scale),
+       "Scale pixel values by the specified factor when converting the pixel type")
+      ("offset", opt::value<double>(&this->offset),
+       "Add the specified offset to pixel values when converting the pixel type")
+      ("compression", opt::value<std::string>(&this->compressionString),
+       "Use the specified compression (default: the compression of the input)")
+      ("tile-width", opt::value<ome::files::dimension_size_type>(&this->tilewidthValue),
+       "Write tiles of the specified width (default: the tile size of the input)")
+      ("tile-height", opt::value<ome::files::dimension_size_type>(&this->tileheightValue),
+       "Write tiles or strips of the specified height (default: the tile size of the input)")
+      ("resolutions", opt::value<ome::files::dimension_size_type>(&this->resolutions),
+       "Write a pyramid with the specified number of resolutions");
+
+    performance.add_options()
+      ("read-threads", opt::value<unsigned int>(&this->readthreads),
+       "Read tiles using the specified number of threads (0 for one per CPU)")
+      ("convert-threads", opt::value<unsigned int>(&this->convertthreads),
+       "Convert pixel types using the specified number of threads (0 for one per CPU)")
+      ("encode-threads", opt::value<unsigned int>(&this->encodethreads),
+       "Encode tiles using the specified number of threads (0 for one per CPU)")
+      ("queue-depth", opt::value<ome::files::dimension_size_type>(&this->queuedepth),
+       "Limit the number of tiles in flight between reading and writing")
+      ("raw-copy", "Copy compressed tiles when the layouts are compatible (default)")
+      ("no-raw-copy", "Always decode and encode tiles");
+
+    hidden.add_options()
+      ("files", opt::value<std::vector<std::string>>(&this->files),
+       "Input and output files");
+
+    positional.add("files", -1);
+  }
+
+  void
+  options::add_option_groups ()
+  {
+#ifndef BOOST_PROGRAM_OPTIONS_DESCRIPTION_OLD
+    if (!actions.options().empty())
+#else
+      if (!actions.primary_keys().empty())
+#endif
+        {
+          global.add(actions);
+          visible.add(actions);
+        }
+#ifndef BOOST_PROGRAM_OPTIONS_DESCRIPTION_OLD
+    if (!general.options().empty())
+#else
+      if (!general.primary_keys().empty())
+#endif
+        {
+          global.add(general);
+          visible.add(general);
+        }
+#ifndef BOOST_PROGRAM_OPTIONS_DESCRIPTION_OLD
+    if (!conversion.options().empty())
+#else
+      if (!conversion.primary_keys().empty())
+#endif
+        {
+          global.add(conversion);
+          visible.add(conversion);
+        }
+#ifndef BOOST_PROGRAM_OPTIONS_DESCRIPTION_OLD
+    if (!performance.options().empty())
+#else
+      if (!performance.primary_keys().empty())
+#endif
+        {
+          global.add(performance);
+          visible.add(performance);
+        }
+#ifndef BOOST_PROGRAM_OPTIONS_DESCRIPTION_OLD
+    if (!hidden.options().empty())
+#else
+      if (!hidden.primary_keys().empty())
+#endif
+        global.add(hidden);
+  }
+
+  void
+  options::check_options ()
+  {
+    if (vm.count("usage"))
+      this->action = ACTION_USAGE;
+
+    if (vm.count("help"))
+      this->action = ACTION_HELP;
+
+    if (vm.count("version"))
+      this->action = ACTION_VERSION;
+
+    if (vm.count("quiet"))
+      this->verbosity = MSG_QUIET;
+    if (vm.count("verbose"))
+      this->verbosity = MSG_VERBOSE;
+    if (vm.count("debug"))
+      this->verbosity = MSG_DEBUG;
+
+    if (!this->pixeltypeString.empty())
+      this->pixeltype = ome::xml::model::enums::PixelType(this->pixeltypeString);
+
+    if (!this->compressionString.empty())
+      this->compression = this->compressionString;
+
+    if (vm.count("tile-width"))
+      this->tilewidth = this->tilewidthValue;
+    if (vm.count("tile-height"))
+      this->tileheight = this->tileheightValue;
+    if (this->tilewidth && !this->tileheight)
+      throw std::runtime_error("--tile-width requires --tile-height");
+
+    if (vm.count("raw-copy"))
+      this->rawcopy = true;
+    if (vm.count("no-raw-copy"))
+      this->rawcopy = false;
+  }
+
+  void
+  options::check_actions ()
+  {
+    if (this->action == ACTION_CONVERT && this->files.size() != 2)
+      throw std::runtime_error("An input and an output file must be specified");
+  }
+
+}
@@ -35,6 +35,20 @@
  * #L%
  */
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#include <ome/files/Checksum.h>
+#include <ome/files/PixelCopy.h>
+#include <ome/files/PixelProperties.h>
+#include <ome/files/VariantPixelBuffer.h>
 #include <ome/files/in/TIFFReader.h>
 #include <ome/files/in/OMETIFFReader.h>
 
@@ -119,6 +133,73 @@ namespace info
       readOriginalMetadata(stream);
     if (opts.showomexml)
       readOMEXMLMetadata(stream);
+    if (opts.readpixels)
+      readPixels(stream);
+  }
+
+  void
+  ImageInfo::readRecord(FileRecord& record)
+  {
+    record.file = file;
+
+    try
+      {
+        if (!reader)
+          reader = std::make_shared<in::OMETIFFReader>();
+
+        std::shared_ptr<ome::files::detail::FormatReader> detail = std::dynamic_pointer_cast<ome::files::detail::FormatReader>(reader);
+        if (detail)
+          record.format = detail->getFormat();
+
+        configureReader(*reader);
+        reader->setId(file);
+
+        if (opts.showused)
+          {
+            const std::vector<boost::filesystem::path> used(reader->getUsedFiles());
+            for (std::vector<boost::filesystem::path>::const_iterator i = used.begin();
+                 i != used.end();
+                 ++i)
+              record.usedFiles.push_back(i->string());
+          }
+
+        if (opts.showcore)
+          {
+            dimension_size_type seriesCount(reader->getSeriesCount());
+            for (dimension_size_type s = 0; s < seriesCount; ++s)
+              {
+                reader->setSeries(s);
+
+                SeriesRecord series;
+                series.sizeX = reader->getSizeX();
+                series.sizeY = reader->getSizeY();
+                series.sizeZ = reader->getSizeZ();
+                series.sizeT = reader->getSizeT();
+                series.sizeC = reader->getSizeC();
+                series.effectiveSizeC = reader->getEffectiveSizeC();
+                series.imageCount = reader->getImageCount();
+                series.resolutionCount = opts.flat ? 1U : reader->getResolutionCount();
+                for (dimension_size_type c = 0; c < series.effectiveSizeC; ++c)
+                  series.rgbChannelCount.push_back(reader->getRGBChannelCount(c));
+                std::ostringstream pixeltype;
+                pixeltype << reader->getPixelType();
+                series.pixelType = pixeltype.str();
+                series.bitsPerPixel = reader->getBitsPerPixel();
+                series.dimensionOrder = reader->getDimensionOrder();
+                series.orderCertain = reader->isOrderCertain();
+                series.interleaved = reader->isInterleaved();
+                series.littleEndian = reader->isLittleEndian();
+                record.series.push_back(series);
+              }
+          }
+
+        reader->close();
+      }
+    catch (const std::exception& e)
+      {
+        record.error = e.what();
+        record.series.clear();
+      }
   }
 
   void
@@ -150,12 +231,18 @@ namespace info
     /// @todo MinMaxCalc
     /// @todo BufferedImageReader
 
-    reader->close();
-    reader->setMetadataFiltered(opts.filter);
-    reader->setGroupFiles(opts.group);
+    configureReader(*reader);
+  }
+
+  void
+  ImageInfo::configureReader(FormatReader& reader)
+  {
+    reader.close();
+    reader.setMetadataFiltered(opts.filter);
+    reader.setGroupFiles(opts.group);
     MetadataOptions mopts(opts.showcore ? MetadataOptions::METADATA_ALL : MetadataOptions::METADATA_MINIMUM);
-    reader->setMetadataOptions(mopts);
-    reader->setFlattenedResolutions(opts.flat);
+    reader.setMetadataOptions(mopts);
+    reader.setFlattenedResolutions(opts.flat);
   }
 
   void
@@ -344,6 +431,170 @@ namespace info
       }
   }
 
+  void
+  ImageInfo::readPixels(std::ostream& stream)
+  {
+    // Result of reading a single plane.
+    struct PlaneResult
+    {
+      dimension_size_type series;
+      dimension_size_type plane;
+      dimension_size_type bytes;
+      double              seconds;
+      uint32_t            crc;
+    };
+
+    std::vector<PlaneResult> results;
+    dimension_size_type seriesCount(reader->getSeriesCount());
+    for (dimension_size_type s = 0; s < seriesCount; ++s)
+      {
+        reader->setSeries(s);
+        for (dimension_size_type p = 0; p < reader->getImageCount(); ++p)
+          results.push_back(PlaneResult{s, p, 0U, 0.0, 0U});
+      }
+    reader->setSeries(0);
+
+    std::atomic<std::vector<PlaneResult>::size_type> next(0U);
+    std::mutex errorMutex;
+    std::exception_ptr error;
+
+    // Read planes with a reader until none remain.  Each plane is
+    // assembled in planar order from its tiles, so that the
+    // checksum does not depend upon the storage order of the file,
+    // or the tile size.
+    auto readPlanes = [&](FormatReader& r)
+      {
+        try
+          {
+            VariantPixelBuffer tile;
+            VariantPixelBuffer plane;
+            for (;;)
+              {
+                const std::vector<PlaneResult>::size_type i = next++;
+                if (i >= results.size())
+                  break;
+                PlaneResult& result(results[i]);
+
+                auto start = std::chrono::steady_clock::now();
+
+                r.setSeries(result.series);
+                const dimension_size_type sizeX = r.getSizeX();
+                const dimension_size_type sizeY = r.getSizeY();
+                const dimension_size_type tileX = opts.tilesize ? std::min(opts.tilesize, sizeX) : sizeX;
+                const dimension_size_type tileY = opts.tilesize ? std::min(opts.tilesize, sizeY) : sizeY;
+
+                for (dimension_size_type y = 0; y < sizeY; y += tileY)
+                  for (dimension_size_type x = 0; x < sizeX; x += tileX)
+                    {
+                      const dimension_size_type w = std::min(tileX, sizeX - x);
+                      const dimension_size_type h = std::min(tileY, sizeY - y);
+                      r.openBytes(result.plane, tile, x, y, w, h);
+
+                      const VariantPixelBuffer::size_type *tileShape = tile.shape();
+                      std::array<VariantPixelBuffer::size_type, PixelBufferBase::dimensions> planeShape;
+                      std::copy(tileShape, tileShape + PixelBufferBase::dimensions, planeShape.begin());
+                      planeShape[DIM_SPATIAL_X] = sizeX;
+                      planeShape[DIM_SPATIAL_Y] = sizeY;
+                      if (!plane.valid() || plane.pixelType() != tile.pixelType() ||
+                          !std::equal(planeShape.begin(), planeShape.end(), plane.shape()))
+                        plane.setBuffer(planeShape, tile.pixelType(),
+                                        PixelBufferBase::make_storage_order(ome::xml::model::enums::DimensionOrder::XYZTC, false),
+                                        PIXEL_UNINITIALIZED);
+
+                      PixelBufferBase::indices_type srcorigin;
+                      std::fill(srcorigin.begin(), srcorigin.end(), 0);
+                      PixelBufferBase::indices_type destorigin(srcorigin);
+                      destorigin[DIM_SPATIAL_X] = static_cast<PixelBufferBase::index>(x);
+                      destorigin[DIM_SPATIAL_Y] = static_cast<PixelBufferBase::index>(y);
+                      region_shape_type shape;
+                      std::copy(tileShape, tileShape + PixelBufferBase::dimensions, shape.begin());
+                      copyRegion(tile, srcorigin, plane, destorigin, shape);
+                    }
+
+                result.bytes = plane.num_elements() * bytesPerPixel(plane.pixelType());
+                result.crc = crc32c(plane.data(), result.bytes);
+
+                auto end = std::chrono::steady_clock::now();
+                result.seconds = std::chrono::duration<double>(end - start).count();
+              }
+          }
+        catch (...)
+          {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            if (!error)
+              error = std::current_exception();
+            next = results.size();
+          }
+      };
+
+    // The first thread uses this reader; other threads open the
+    // file with their own reader.
+    const unsigned int threads = static_cast<unsigned int>
+      (std::max(std::vector<PlaneResult>::size_type(1U),
+                std::min(static_cast<std::vector<PlaneResult>::size_type>(opts.readthreads), results.size())));
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> workers;
+    for (unsigned int t = 1U; t < threads; ++t)
+      workers.emplace_back([&]()
+        {
+          try
+            {
+              std::shared_ptr<FormatReader> r(std::make_shared<in::OMETIFFReader>());
+              configureReader(*r);
+              r->setId(file);
+              readPlanes(*r);
+              r->close();
+            }
+          catch (...)
+            {
+              std::lock_guard<std::mutex> lock(errorMutex);
+              if (!error)
+                error = std::current_exception();
+              next = results.size();
+            }
+        });
+    readPlanes(*reader);
+    for (auto& worker : workers)
+      worker.join();
+
+    auto end = std::chrono::steady_clock::now();
+
+    if (error)
+      std::rethrow_exception(error);
+
+    const std::ios::fmtflags flags(stream.flags());
+    const std::streamsize precision(stream.precision());
+
+    stream << "Reading pixel data\n";
+    dimension_size_type bytes = 0U;
+    double planeSeconds = 0.0;
+    for (std::vector<PlaneResult>::const_iterator i = results.begin();
+         i != results.end();
+         ++i)
+      {
+        stream << "\tSeries #" << i->series << " plane #" << i->plane
+               << ": CRC-32C = " << std::hex << std::setfill('0') << std::setw(8) << i->crc
+               << std::dec << std::setfill(' ')
+               << " (" << std::fixed << std::setprecision(3) << i->seconds * 1000.0 << " ms)\n";
+        bytes += i->bytes;
+        planeSeconds += i->seconds;
+      }
+
+    const double seconds = std::chrono::duration<double>(end - start).count();
+    stream << "Planes = " << results.size() << '\n'
+           << "Bytes = " << bytes << '\n'
+           << "Threads = " << threads << '\n'
+           << "Time = " << std::fixed << std::setprecision(3) << seconds << " s\n"
+           << "Time per plane = " << (results.empty() ? 0.0 : (planeSeconds * 1000.0) / static_cast<double>(results.size())) << " ms\n"
+           << "Throughput = " << std::setprecision(1) << (seconds > 0.0 ? (static_cast<double>(bytes) / 1.0e6) / seconds : 0.0) << " MB/s\n"
+           << '\n';
+
+    stream.flags(flags);
+    stream.precision(precision);
+  }
+
   void
   ImageInfo::printDimension(std::ostream&                        stream,
                             const std::string&                   dim,
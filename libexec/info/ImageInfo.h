@@ -50,6 +50,7 @@
 #include <ome/files/Types.h>
 
 #include <info/options.h>
+#include <info/Record.h>
 
 namespace info
 {
@@ -73,7 +74,26 @@ namespace info
     void
     testRead(std::ostream& stream);
 
+    /**
+     * Read the core metadata and used files for machine-readable
+     * output.
+     *
+     * Errors are recorded in the record rather than thrown.
+     *
+     * @param record the record to fill.
+     */
+    void
+    readRecord(FileRecord& record);
+
   private:
+    /**
+     * Apply the reader options before setId.
+     *
+     * @param reader the reader to configure.
+     */
+    void
+    configureReader(ome::files::FormatReader& reader);
+
     /**
      * Set up MetadataStore before setId.
      */
@@ -119,6 +139,13 @@ namespace info
     void
     readOMEXMLMetadata(std::ostream& stream);
 
+    /**
+     * Read all planes, and display their checksums and the read
+     * throughput.
+     */
+    void
+    readPixels(std::ostream& stream);
+
     /**
      * Print a single dimension.
      */
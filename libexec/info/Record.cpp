@@ -0,0 +1,245 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2014 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+
+#include <cstdio>
+
+#include <info/Record.h>
+
+namespace
+{
+
+  // Write a string as a JSON string literal.
+  void
+  jsonString(std::ostream&      stream,
+             const std::string& value)
+  {
+    stream << '"';
+    for (std::string::const_iterator i = value.begin(); i != value.end(); ++i)
+      {
+        const unsigned char c = static_cast<unsigned char>(*i);
+        switch (c)
+          {
+          case '"':
+            stream << "\\\"";
+            break;
+          case '\\':
+            stream << "\\\\";
+            break;
+          case '\n':
+            stream << "\\n";
+            break;
+          case '\r':
+            stream << "\\r";
+            break;
+          case '\t':
+            stream << "\\t";
+            break;
+          default:
+            if (c < 0x20U)
+              {
+                char escape[8];
+                std::snprintf(escape, sizeof(escape), "\\u%04x", static_cast<unsigned int>(c));
+                stream << escape;
+              }
+            else
+              stream << *i;
+            break;
+          }
+      }
+    stream << '"';
+  }
+
+  // Write a string as a CSV field, quoted if required.
+  void
+  csvField(std::ostream&      stream,
+           const std::string& value)
+  {
+    if (value.find_first_of(",\"\r\n") == std::string::npos)
+      {
+        stream << value;
+        return;
+      }
+
+    stream << '"';
+    for (std::string::const_iterator i = value.begin(); i != value.end(); ++i)
+      {
+        if (*i == '"')
+          stream << '"';
+        stream << *i;
+      }
+    stream << '"';
+  }
+
+  const char *
+  boolString(bool value)
+  {
+    return value ? "true" : "false";
+  }
+
+}
+
+namespace info
+{
+
+  void
+  writeJSON(std::ostream&     stream,
+            const FileRecord& record)
+  {
+    stream << "{\"file\":";
+    jsonString(stream, record.file);
+    if (!record.error.empty())
+      {
+        stream << ",\"error\":";
+        jsonString(stream, record.error);
+      }
+    stream << ",\"format\":";
+    jsonString(stream, record.format);
+
+    stream << ",\"usedFiles\":[";
+    for (std::vector<std::string>::size_type i = 0; i < record.usedFiles.size(); ++i)
+      {
+        if (i)
+          stream << ',';
+        jsonString(stream, record.usedFiles[i]);
+      }
+
+    stream << "],\"series\":[";
+    for (std::vector<SeriesRecord>::size_type i = 0; i < record.series.size(); ++i)
+      {
+        const SeriesRecord& s(record.series[i]);
+        if (i)
+          stream << ',';
+        stream << "{\"sizeX\":" << s.sizeX
+               << ",\"sizeY\":" << s.sizeY
+               << ",\"sizeZ\":" << s.sizeZ
+               << ",\"sizeT\":" << s.sizeT
+               << ",\"sizeC\":" << s.sizeC
+               << ",\"effectiveSizeC\":" << s.effectiveSizeC
+               << ",\"imageCount\":" << s.imageCount
+               << ",\"resolutionCount\":" << s.resolutionCount
+               << ",\"rgbChannelCount\":[";
+        for (std::vector<ome::files::dimension_size_type>::size_type c = 0; c < s.rgbChannelCount.size(); ++c)
+          stream << (c ? "," : "") << s.rgbChannelCount[c];
+        stream << "],\"pixelType\":";
+        jsonString(stream, s.pixelType);
+        stream << ",\"bitsPerPixel\":" << s.bitsPerPixel
+               << ",\"dimensionOrder\":";
+        jsonString(stream, s.dimensionOrder);
+        stream << ",\"orderCertain\":" << boolString(s.orderCertain)
+               << ",\"interleaved\":" << boolString(s.interleaved)
+               << ",\"littleEndian\":" << boolString(s.littleEndian)
+               << '}';
+      }
+    stream << "]}\n";
+  }
+
+  void
+  writeCSVHeader(std::ostream& stream)
+  {
+    stream << "file,format,series,sizeX,sizeY,sizeZ,sizeT,sizeC,effectiveSizeC,"
+           << "imageCount,resolutionCount,rgbChannelCount,pixelType,bitsPerPixel,"
+           << "dimensionOrder,orderCertain,interleaved,littleEndian,usedFiles,error\n";
+  }
+
+  void
+  writeCSV(std::ostream&     stream,
+           const FileRecord& record)
+  {
+    // Used files are separated by newlines within a single field.
+    std::string used;
+    for (std::vector<std::string>::size_type i = 0; i < record.usedFiles.size(); ++i)
+      {
+        if (i)
+          used += '\n';
+        used += record.usedFiles[i];
+      }
+
+    if (record.series.empty())
+      {
+        csvField(stream, record.file);
+        stream << ',';
+        csvField(stream, record.format);
+        stream << ",,,,,,,,,,,,,,,,,";
+        csvField(stream, used);
+        stream << ',';
+        csvField(stream, record.error);
+        stream << '\n';
+        return;
+      }
+
+    for (std::vector<SeriesRecord>::size_type i = 0; i < record.series.size(); ++i)
+      {
+        const SeriesRecord& s(record.series[i]);
+
+        std::string rgb;
+        for (std::vector<ome::files::dimension_size_type>::size_type c = 0; c < s.rgbChannelCount.size(); ++c)
+          {
+            if (c)
+              rgb += ' ';
+            rgb += std::to_string(s.rgbChannelCount[c]);
+          }
+
+        csvField(stream, record.file);
+        stream << ',';
+        csvField(stream, record.format);
+        stream << ',' << i
+               << ',' << s.sizeX
+               << ',' << s.sizeY
+               << ',' << s.sizeZ
+               << ',' << s.sizeT
+               << ',' << s.sizeC
+               << ',' << s.effectiveSizeC
+               << ',' << s.imageCount
+               << ',' << s.resolutionCount
+               << ',' << rgb
+               << ',';
+        csvField(stream, s.pixelType);
+        stream << ',' << s.bitsPerPixel << ',';
+        csvField(stream, s.dimensionOrder);
+        stream << ',' << boolString(s.orderCertain)
+               << ',' << boolString(s.interleaved)
+               << ',' << boolString(s.littleEndian)
+               << ',';
+        csvField(stream, used);
+        stream << ',';
+        csvField(stream, record.error);
+        stream << '\n';
+      }
+  }
+
+}
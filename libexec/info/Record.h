@@ -0,0 +1,143 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2014 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#ifndef SHOWINF_RECORD_H
+#define SHOWINF_RECORD_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <ome/files/Types.h>
+
+namespace info
+{
+
+  /**
+   * Core metadata of a series, for machine-readable output.
+   */
+  struct SeriesRecord
+  {
+    /// Image width.
+    ome::files::dimension_size_type sizeX;
+    /// Image height.
+    ome::files::dimension_size_type sizeY;
+    /// Focal planes.
+    ome::files::dimension_size_type sizeZ;
+    /// Time points.
+    ome::files::dimension_size_type sizeT;
+    /// Channels, counting each sample separately.
+    ome::files::dimension_size_type sizeC;
+    /// Channels.
+    ome::files::dimension_size_type effectiveSizeC;
+    /// Number of planes.
+    ome::files::dimension_size_type imageCount;
+    /// Number of resolutions.
+    ome::files::dimension_size_type resolutionCount;
+    /// Samples of each channel.
+    std::vector<ome::files::dimension_size_type> rgbChannelCount;
+    /// Pixel type.
+    std::string pixelType;
+    /// Significant bits per pixel.
+    ome::files::pixel_size_type bitsPerPixel;
+    /// Dimension order.
+    std::string dimensionOrder;
+    /// Dimension order is certain.
+    bool orderCertain;
+    /// Samples are interleaved.
+    bool interleaved;
+    /// Pixel data are little-endian.
+    bool littleEndian;
+  };
+
+  /**
+   * Metadata of a file, for machine-readable output.
+   */
+  struct FileRecord
+  {
+    /// File name.
+    std::string file;
+    /// Reader format name.
+    std::string format;
+    /// Files used by the dataset.
+    std::vector<std::string> usedFiles;
+    /// Core metadata of each series.
+    std::vector<SeriesRecord> series;
+    /// Error message, or empty if the file was read successfully.
+    std::string error;
+  };
+
+  /**
+   * Write a file record as a single-line JSON object.
+   *
+   * @param stream the stream to write to.
+   * @param record the record to write.
+   */
+  void
+  writeJSON(std::ostream&     stream,
+            const FileRecord& record);
+
+  /**
+   * Write the CSV header row.
+   *
+   * @param stream the stream to write to.
+   */
+  void
+  writeCSVHeader(std::ostream& stream);
+
+  /**
+   * Write a file record as CSV, with one row per series.
+   *
+   * A file with no series, or which could not be read, is written
+   * as a single row with empty series fields.
+   *
+   * @param stream the stream to write to.
+   * @param record the record to write.
+   */
+  void
+  writeCSV(std::ostream&     stream,
+           const FileRecord& record);
+
+}
+
+#endif /* SHOWINF_RECORD_H */
+
+/*
+ * Local Variables:
+ * mode:C++
+ * End:
+ */
@@ -35,7 +35,14 @@
  * #L%
  */
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
 
 // Include before boost headers to ensure the MPL limits get defined.
 #include <ome/common/config.h>
@@ -116,18 +123,116 @@ namespace
 #endif
   }
 
+  // Output of a single file.
+  struct FileOutput
+  {
+    std::string out;
+    std::string err;
+    bool        done;
+    bool        failed;
+
+    FileOutput():
+      out(),
+      err(),
+      done(false),
+      failed(false)
+    {}
+  };
+
+  // Read a single file.
   void
+  read_file(const std::string& file,
+            const options&     opts,
+            FileOutput&        output)
+  {
+    std::ostringstream out;
+    ImageInfo info(file, opts);
+
+    if (opts.output == options::OUTPUT_TEXT)
+      {
+        try
+          {
+            out << "Image: " << file << '\n';
+            info.testRead(out);
+          }
+        catch (const std::exception& e)
+          {
+            output.failed = true;
+            output.err = "E: " + file + ": " + e.what() + '\n';
+          }
+      }
+    else
+      {
+        FileRecord record;
+        info.readRecord(record);
+        output.failed = !record.error.empty();
+        if (opts.output == options::OUTPUT_JSON)
+          writeJSON(out, record);
+        else
+          writeCSV(out, record);
+      }
+
+    output.out = out.str();
+  }
+
+  // Read all files, using up to opts.jobs threads.  The output of
+  // each file is written in the order of the files on the command
+  // line, as soon as it and the output of all preceding files is
+  // complete.  Returns false if any file could not be read.
+  bool
   print_metadata(std::ostream& stream,
                  const options& opts)
   {
-    for (std::vector<std::string>::const_iterator i = opts.files.begin();
-         i != opts.files.end();
-         ++i)
+    if (opts.output == options::OUTPUT_CSV)
+      writeCSVHeader(stream);
+
+    std::vector<FileOutput> outputs(opts.files.size());
+    std::atomic<std::vector<std::string>::size_type> next(0U);
+    std::vector<std::string>::size_type written = 0U;
+    bool failed = false;
+    std::mutex mutex;
+
+    auto worker = [&]()
       {
-        stream << "Image: " << *i << '\n';
-        ImageInfo info(*i, opts);
-        info.testRead(stream);
+        for (;;)
+          {
+            const std::vector<std::string>::size_type i = next++;
+            if (i >= opts.files.size())
+              break;
+
+            FileOutput output;
+            read_file(opts.files[i], opts, output);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            outputs[i] = std::move(output);
+            outputs[i].done = true;
+            for (; written < outputs.size() && outputs[written].done; ++written)
+              {
+                FileOutput& w(outputs[written]);
+                stream << w.out << std::flush;
+                std::cerr << w.err << std::flush;
+                failed |= w.failed;
+                w = FileOutput();
+                w.done = true;
+              }
+          }
+      };
+
+    const unsigned int jobs = static_cast<unsigned int>
+      (std::min(static_cast<std::vector<std::string>::size_type>(opts.jobs),
+                std::max(opts.files.size(), std::vector<std::string>::size_type(1U))));
+    if (jobs <= 1U)
+      worker();
+    else
+      {
+        std::vector<std::thread> threads;
+        for (unsigned int j = 0U; j < jobs; ++j)
+          threads.emplace_back(worker);
+        for (auto& thread : threads)
+          thread.join();
       }
+
+    return !failed;
   }
 
 }
@@ -178,7 +283,8 @@ main(int argc, char *argv[])
           display_manpage("ome-files-info", "1");
           break;
         case options::ACTION_METADATA:
-          print_metadata(std::cout, opts);
+          if (!print_metadata(std::cout, opts))
+            status = 1;
           break;
         default:
           print_help(std::cout, opts);
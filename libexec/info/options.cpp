@@ -35,6 +35,9 @@
  * #L%
  */
 
+#include <algorithm>
+#include <thread>
+
 #include <info/options.h>
 
 namespace opt = boost::program_options;
@@ -45,6 +48,8 @@ namespace info
   options::options ():
     action(ACTION_METADATA),
     verbosity(MSG_NORMAL),
+    output(OUTPUT_TEXT),
+    jobs(1U),
     showcore(true),
     showorig(true),
     filter(false),
@@ -57,9 +62,13 @@ namespace info
     stitch(false),
     separate(false),
     flat(false),
+    readpixels(false),
+    tilesize(0),
+    readthreads(1U),
     series(0),
     resolution(0),
     format(),
+    outputString(),
     files(),
     inputOrderString(),
     outputOrderString(),
@@ -121,7 +130,11 @@ namespace info
       ("quiet,q",
        "Show less output")
       ("verbose,v",
-       "Show more output");
+       "Show more output")
+      ("jobs,j", opt::value<unsigned int>(&this->jobs),
+       "Read the specified number of files concurrently (0 for one per CPU)")
+      ("output-format", opt::value<std::string>(&this->outputString),
+       "Output format: text (default), json (one object per file) or csv (one row per series)");
 
     reader.add_options()
       ("format", opt::value<std::string>(&this->format),
@@ -145,7 +158,13 @@ namespace info
        "Override the dimension input order")
       ("output-order",
        opt::value<std::string>(&this->outputOrderString),
-       "Override the dimension output order");
+       "Override the dimension output order")
+      ("pixels", "Read all planes, and display checksums and read throughput")
+      ("no-pixels", "Do not read planes (default)")
+      ("tile-size", opt::value<ome::files::dimension_size_type>(&this->tilesize),
+       "Read planes in square tiles of the specified size (0 for whole planes)")
+      ("read-threads", opt::value<unsigned int>(&this->readthreads),
+       "Read planes using the specified number of threads (0 for one per CPU)");
 
     metadata.add_options()
       ("core", "Display core metadata (default)")
@@ -236,11 +255,31 @@ namespace info
     if (vm.count("debug"))
       this->verbosity = MSG_DEBUG;
 
+    if (this->jobs == 0U)
+      this->jobs = std::max(1U, std::thread::hardware_concurrency());
+
+    if (this->outputString.empty() || this->outputString == "text")
+      this->output = OUTPUT_TEXT;
+    else if (this->outputString == "json")
+      this->output = OUTPUT_JSON;
+    else if (this->outputString == "csv")
+      this->output = OUTPUT_CSV;
+    else
+      throw std::runtime_error("Invalid output format: " + this->outputString);
+
     if (vm.count("flat"))
       this->flat = true;
     if (vm.count("no-flat"))
       this->flat = false;
 
+    if (vm.count("pixels"))
+      this->readpixels = true;
+    if (vm.count("no-pixels"))
+      this->readpixels = false;
+
+    if (this->readthreads == 0U)
+      this->readthreads = std::max(1U, std::thread::hardware_concurrency());
+
     if (vm.count("merge"))
       this->merge = true;
     if (vm.count("no-merge"))
@@ -89,12 +89,25 @@ namespace info
         MSG_DEBUG
       };
 
+    enum outputFormat
+      {
+        OUTPUT_TEXT,
+        OUTPUT_JSON,
+        OUTPUT_CSV
+      };
+
     /// Action list.
     userAction action;
 
     /// Message verbosity.
     messageVerbosity verbosity;
 
+    /// Output format.
+    outputFormat output;
+
+    /// Number of files to read concurrently.
+    unsigned int jobs;
+
     bool showcore;
     bool showorig;
     bool filter;
@@ -107,10 +120,14 @@ namespace info
     bool stitch;
     bool separate;
     bool flat;
+    bool readpixels;
+    ome::files::dimension_size_type tilesize;
+    unsigned int readthreads;
     ome::files::dimension_size_type series;
     ome::files::dimension_size_type resolution;
 
     std::string format;
+    std::string outputString;
     std::vector<std::string> files;
     std::string inputOrderString;
     std::string outputOrderString;
@@ -0,0 +1,322 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2014 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/filesystem/path.hpp>
+
+#include <ome/files/DecodedTileCache.h>
+#include <ome/files/PixelBuffer.h>
+#include <ome/files/VariantPixelBuffer.h>
+#include <ome/files/in/MinimalTIFFReader.h>
+#include <ome/files/in/OMETIFFReader.h>
+#include <ome/files/tiff/IFD.h>
+#include <ome/files/tiff/TIFF.h>
+
+#include <ome/test/test.h>
+
+using ome::files::dimension_size_type;
+using ome::files::DecodedTileCache;
+using ome::files::FormatReader;
+using ome::files::PixelProperties;
+using ome::files::VariantPixelBuffer;
+using ome::files::in::MinimalTIFFReader;
+using ome::files::in::OMETIFFReader;
+using ome::files::tiff::IFD;
+using ome::files::tiff::TIFF;
+typedef ome::xml::model::enums::PixelType PT;
+
+// Allocation-counting harness.  The global operator new is replaced
+// for this test program, so that allocations made by the library
+// while counting are detected.  Allocations made directly with
+// malloc(3), for example by libtiff, are not counted.
+
+namespace
+{
+
+  std::atomic<bool> counting(false);
+  std::atomic<std::size_t> allocations(0U);
+
+  void *
+  allocate(std::size_t size)
+  {
+    if (counting.load(std::memory_order_relaxed))
+      allocations.fetch_add(1U, std::memory_order_relaxed);
+    return std::malloc(size ? size : 1U);
+  }
+
+}
+
+void *
+operator new(std::size_t size)
+{
+  void *ptr = allocate(size);
+  if (!ptr)
+    throw std::bad_alloc();
+  return ptr;
+}
+
+void *
+operator new[](std::size_t size)
+{
+  void *ptr = allocate(size);
+  if (!ptr)
+    throw std::bad_alloc();
+  return ptr;
+}
+
+void *
+operator new(std::size_t size,
+             const std::nothrow_t&) noexcept
+{
+  return allocate(size);
+}
+
+void *
+operator new[](std::size_t size,
+               const std::nothrow_t&) noexcept
+{
+  return allocate(size);
+}
+
+void
+operator delete(void *ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void
+operator delete[](void *ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void
+operator delete(void        *ptr,
+                std::size_t  /* size */) noexcept
+{
+  std::free(ptr);
+}
+
+void
+operator delete[](void        *ptr,
+                  std::size_t  /* size */) noexcept
+{
+  std::free(ptr);
+}
+
+void
+operator delete(void *ptr,
+                const std::nothrow_t&) noexcept
+{
+  std::free(ptr);
+}
+
+void
+operator delete[](void *ptr,
+                  const std::nothrow_t&) noexcept
+{
+  std::free(ptr);
+}
+
+namespace
+{
+
+  // Count the allocations made while calling f.
+  template<typename F>
+  std::size_t
+  countAllocations(const F& f)
+  {
+    allocations = 0U;
+    counting = true;
+    try
+      {
+        f();
+      }
+    catch (...)
+      {
+        counting = false;
+        throw;
+      }
+    counting = false;
+    return allocations;
+  }
+
+  typedef PixelProperties<PT::UINT16>::std_type uint16_pixel;
+
+  const dimension_size_type width = 70U;
+  const dimension_size_type height = 45U;
+  const dimension_size_type planes = 3U;
+
+  VariantPixelBuffer::indices_type
+  makeIndex(dimension_size_type x,
+            dimension_size_type y)
+  {
+    VariantPixelBuffer::indices_type idx;
+    idx.fill(0);
+    idx[ome::files::DIM_SPATIAL_X] = static_cast<VariantPixelBuffer::indices_type::value_type>(x);
+    idx[ome::files::DIM_SPATIAL_Y] = static_cast<VariantPixelBuffer::indices_type::value_type>(y);
+    return idx;
+  }
+
+  boost::filesystem::path
+  writeTIFF(const std::string&        name,
+            ome::files::tiff::TileType type)
+  {
+    boost::filesystem::path path(PROJECT_BINARY_DIR "/test/ome-files/data");
+    path /= name;
+    boost::filesystem::create_directories(path.parent_path());
+
+    std::array<VariantPixelBuffer::size_type, 9> shape;
+    std::fill(shape.begin(), shape.end(), 1U);
+    shape[ome::files::DIM_SPATIAL_X] = width;
+    shape[ome::files::DIM_SPATIAL_Y] = height;
+
+    std::shared_ptr<TIFF> tiff(TIFF::open(path, "w"));
+    for (dimension_size_type p = 0; p < planes; ++p)
+      {
+        VariantPixelBuffer buf(shape, PT::UINT16);
+        for (dimension_size_type y = 0; y < height; ++y)
+          for (dimension_size_type x = 0; x < width; ++x)
+            buf.array<uint16_pixel>()(makeIndex(x, y)) =
+              static_cast<uint16_pixel>((x * 37U) + (y * 11U) + (p * 4099U));
+
+        std::shared_ptr<IFD> ifd(tiff->getCurrentDirectory());
+        ifd->setImageWidth(width);
+        ifd->setImageHeight(height);
+        ifd->setTileType(type);
+        if (type == ome::files::tiff::TILE)
+          {
+            ifd->setTileWidth(16U);
+            ifd->setTileHeight(16U);
+          }
+        else
+          ifd->setTileHeight(8U);
+        ifd->setPixelType(PT::UINT16);
+        ifd->setBitsPerSample(16U);
+        ifd->setSamplesPerPixel(1U);
+        ifd->setPlanarConfiguration(ome::files::tiff::CONTIG);
+        ifd->setPhotometricInterpretation(ome::files::tiff::MIN_IS_BLACK);
+        ifd->writeImage(buf);
+        tiff->writeCurrentDirectory();
+      }
+    tiff->close();
+
+    return path;
+  }
+
+  // Read every plane, whole and as a region straddling several
+  // tiles, into preallocated buffers.
+  void
+  readPlanes(const FormatReader& reader,
+             VariantPixelBuffer& plane,
+             VariantPixelBuffer& region)
+  {
+    const dimension_size_type sizeX = reader.getSizeX();
+    const dimension_size_type sizeY = reader.getSizeY();
+    for (dimension_size_type p = 0; p < reader.getImageCount(); ++p)
+      {
+        reader.openBytes(p, plane);
+        reader.openBytes(p, region, sizeX / 4U, sizeY / 4U, sizeX / 2U, sizeY / 2U);
+      }
+  }
+
+  // Warm the read path, then check that repeated reads do not
+  // allocate.
+  void
+  expectNoAllocations(const FormatReader& reader)
+  {
+    VariantPixelBuffer plane, region;
+    readPlanes(reader, plane, region);
+
+    std::size_t count = countAllocations([&]()
+                                         {
+                                           for (int i = 0; i < 4; ++i)
+                                             readPlanes(reader, plane, region);
+                                         });
+    EXPECT_EQ(0U, count);
+  }
+
+}
+
+TEST(Allocation, Harness)
+{
+  std::size_t count = countAllocations([]()
+                                       {
+                                         // Volatile, so the allocation is not elided.
+                                         int *volatile p = new int(4);
+                                         delete p;
+                                       });
+  EXPECT_EQ(1U, count);
+  EXPECT_EQ(0U, countAllocations([]() {}));
+}
+
+TEST(Allocation, TiledRead)
+{
+  MinimalTIFFReader reader;
+  reader.setId(writeTIFF("allocation-tiled.tiff", ome::files::tiff::TILE));
+  expectNoAllocations(reader);
+}
+
+TEST(Allocation, StripRead)
+{
+  MinimalTIFFReader reader;
+  reader.setId(writeTIFF("allocation-strip.tiff", ome::files::tiff::STRIP));
+  expectNoAllocations(reader);
+}
+
+TEST(Allocation, TileCacheRead)
+{
+  MinimalTIFFReader reader;
+  reader.setTileCache(std::make_shared<DecodedTileCache>());
+  reader.setId(writeTIFF("allocation-cached.tiff", ome::files::tiff::TILE));
+  expectNoAllocations(reader);
+}
+
+TEST(Allocation, OMETIFFRead)
+{
+  OMETIFFReader reader;
+  reader.setId(PROJECT_SOURCE_DIR "/test/ome-files/data/2010-06-18x24y5z1t2c8b-text.ome.tiff");
+  expectNoAllocations(reader);
+}
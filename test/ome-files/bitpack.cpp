@@ -0,0 +1,222 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2014 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <ome/files/Types.h>
+#include <ome/files/tiff/BitPack.h>
+
+#include <ome/test/test.h>
+
+using ome::files::dimension_size_type;
+using ome::files::tiff::isPackedSampleDepth;
+using ome::files::tiff::packBits;
+using ome::files::tiff::packedSampleSize;
+using ome::files::tiff::packSamples;
+using ome::files::tiff::unpackBits;
+using ome::files::tiff::unpackSamples;
+
+namespace
+{
+
+  // Reference implementations, one bit at a time.
+
+  void
+  unpackBitsReference(const uint8_t       *src,
+                      dimension_size_type  srcbit,
+                      bool                *dest,
+                      dimension_size_type  count)
+  {
+    for (dimension_size_type i = 0; i < count; ++i)
+      {
+        dimension_size_type bit = srcbit + i;
+        dest[i] = (src[bit / 8] & static_cast<uint8_t>(1U << (7 - (bit % 8)))) != 0;
+      }
+  }
+
+  void
+  packBitsReference(const bool          *src,
+                    dimension_size_type  count,
+                    uint8_t             *dest,
+                    dimension_size_type  destbit)
+  {
+    for (dimension_size_type i = 0; i < count; ++i)
+      {
+        dimension_size_type bit = destbit + i;
+        dest[bit / 8] |= static_cast<uint8_t>(src[i] << (7 - (bit % 8)));
+      }
+  }
+
+  std::vector<uint8_t>
+  pattern(dimension_size_type size)
+  {
+    std::vector<uint8_t> data(size);
+    uint32_t state = 12345U;
+    for (auto& byte : data)
+      {
+        state = state * 1103515245U + 12345U;
+        byte = static_cast<uint8_t>(state >> 16);
+      }
+    return data;
+  }
+
+}
+
+TEST(BitPack, Unpack)
+{
+  std::vector<uint8_t> src(pattern(16));
+
+  for (dimension_size_type offset = 0; offset < 16; ++offset)
+    for (dimension_size_type count = 0; count <= 100; ++count)
+      {
+        std::vector<char> expected(count + 1, 2);
+        std::vector<char> observed(count + 1, 2);
+        unpackBitsReference(src.data(), offset, reinterpret_cast<bool *>(expected.data()), count);
+        unpackBits(src.data(), offset, reinterpret_cast<bool *>(observed.data()), count);
+        // The sample following the last must not be modified.
+        ASSERT_EQ(expected, observed) << "offset=" << offset << " count=" << count;
+      }
+}
+
+TEST(BitPack, Pack)
+{
+  std::vector<uint8_t> bits(pattern(16));
+  std::unique_ptr<bool[]> samples(new bool[128]);
+  unpackBitsReference(bits.data(), 0, samples.get(), 128);
+
+  for (dimension_size_type offset = 0; offset < 16; ++offset)
+    for (dimension_size_type count = 0; count <= 100; ++count)
+      {
+        std::vector<uint8_t> expected(16, 0);
+        std::vector<uint8_t> observed(16, 0);
+        packBitsReference(samples.get(), count, expected.data(), offset);
+        packBits(samples.get(), count, observed.data(), offset);
+        ASSERT_EQ(expected, observed) << "offset=" << offset << " count=" << count;
+      }
+}
+
+TEST(BitPack, PackPreservesExisting)
+{
+  std::unique_ptr<bool[]> samples(new bool[12]);
+  for (dimension_size_type i = 0; i < 12; ++i)
+    samples[i] = (i % 3) == 0;
+
+  std::vector<uint8_t> expected(3, 0x81);
+  std::vector<uint8_t> observed(3, 0x81);
+  packBitsReference(samples.get(), 12, expected.data(), 5);
+  packBits(samples.get(), 12, observed.data(), 5);
+  EXPECT_EQ(expected, observed);
+}
+
+TEST(BitPack, Samples)
+{
+  EXPECT_FALSE(isPackedSampleDepth(1U));
+  EXPECT_FALSE(isPackedSampleDepth(8U));
+  EXPECT_TRUE(isPackedSampleDepth(10U));
+  EXPECT_TRUE(isPackedSampleDepth(12U));
+  EXPECT_TRUE(isPackedSampleDepth(14U));
+  EXPECT_FALSE(isPackedSampleDepth(16U));
+  EXPECT_EQ(3U, packedSampleSize(2U, 12U));
+  EXPECT_EQ(5U, packedSampleSize(3U, 12U));
+
+  for (uint16_t bits : {uint16_t(10U), uint16_t(12U), uint16_t(14U)})
+    for (dimension_size_type count = 0; count <= 100; ++count)
+      {
+        std::vector<uint16_t> samples(count);
+        for (dimension_size_type i = 0; i < count; ++i)
+          samples[i] = static_cast<uint16_t>(((i * 2654435761U) >> 7U) & ((1U << bits) - 1U));
+
+        // Pack most significant bit first, one bit at a time.
+        std::vector<uint8_t> expected(packedSampleSize(count, bits) + 1U, 0xA5);
+        std::fill(expected.begin(), expected.end() - 1, 0U);
+        for (dimension_size_type i = 0; i < count; ++i)
+          for (dimension_size_type b = 0; b < bits; ++b)
+            if ((samples[i] >> (bits - 1U - b)) & 1U)
+              {
+                dimension_size_type bit = (i * bits) + b;
+                expected[bit / 8U] |= static_cast<uint8_t>(1U << (7U - (bit % 8U)));
+              }
+
+        // The byte following the last must not be modified.
+        std::vector<uint8_t> observed(expected.size(), 0xA5);
+        packSamples(samples.data(), count, observed.data(), bits);
+        ASSERT_EQ(expected, observed) << "bits=" << bits << " count=" << count;
+
+        std::vector<uint16_t> unpacked(count + 1U, 0xFFFFU);
+        unpackSamples(observed.data(), unpacked.data(), count, bits);
+        EXPECT_EQ(0xFFFFU, unpacked.back());
+        unpacked.pop_back();
+        ASSERT_EQ(samples, unpacked) << "bits=" << bits << " count=" << count;
+      }
+
+  // Bits above the bit depth are discarded.
+  const uint16_t wide[2] = {0xFFFFU, 0x1001U};
+  uint8_t packed[3];
+  packSamples(wide, 2U, packed, 12U);
+  EXPECT_EQ(0xFFU, packed[0]);
+  EXPECT_EQ(0xF0U, packed[1]);
+  EXPECT_EQ(0x01U, packed[2]);
+}
+
+TEST(BitPack, WideRows)
+{
+  // Rows of a 50000 pixel wide bilevel image, at every bit offset.
+  const dimension_size_type width = 50000U;
+  std::vector<uint8_t> bits(pattern((width + 7U) / 8U + 1U));
+  std::unique_ptr<bool[]> expected(new bool[width]);
+  std::unique_ptr<bool[]> observed(new bool[width]);
+  std::vector<uint8_t> packedref(bits.size());
+  std::vector<uint8_t> packedfast(bits.size());
+
+  for (dimension_size_type offset = 0; offset < 8U; ++offset)
+    {
+      unpackBitsReference(bits.data(), offset, expected.get(), width);
+      unpackBits(bits.data(), offset, observed.get(), width);
+      ASSERT_TRUE(std::equal(expected.get(), expected.get() + width, observed.get()))
+        << "offset=" << offset;
+
+      std::fill(packedref.begin(), packedref.end(), 0U);
+      std::fill(packedfast.begin(), packedfast.end(), 0U);
+      packBitsReference(observed.get(), width, packedref.data(), offset);
+      packBits(observed.get(), width, packedfast.data(), offset);
+      ASSERT_EQ(packedref, packedfast) << "offset=" << offset;
+    }
+}
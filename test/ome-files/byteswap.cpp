@@ -0,0 +1,163 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <algorithm>
+#include <complex>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include <ome/files/ByteSwap.h>
+#include <ome/files/PixelProperties.h>
+
+#include <ome/test/test.h>
+
+using ome::files::byteswapCopy;
+using ome::files::dimension_size_type;
+
+namespace
+{
+
+  template<typename T>
+  std::vector<T>
+  pattern(dimension_size_type size)
+  {
+    std::vector<T> data(size);
+    uint32_t state = 12345U;
+    uint8_t *bytes = reinterpret_cast<uint8_t *>(data.data());
+    for (dimension_size_type i = 0; i < size * sizeof(T); ++i)
+      {
+        state = state * 1103515245U + 12345U;
+        bytes[i] = static_cast<uint8_t>(state >> 16);
+      }
+    return data;
+  }
+
+  // Compare as bytes, since the patterns may contain NaNs.
+  template<typename T>
+  ::testing::AssertionResult
+  sameBytes(const std::vector<T>& expected,
+            const std::vector<T>& observed)
+  {
+    if (expected.size() == observed.size() &&
+        std::equal(reinterpret_cast<const uint8_t *>(expected.data()),
+                   reinterpret_cast<const uint8_t *>(expected.data() + expected.size()),
+                   reinterpret_cast<const uint8_t *>(observed.data())))
+      return ::testing::AssertionSuccess();
+    return ::testing::AssertionFailure() << "byte content differs";
+  }
+
+  template<typename T>
+  void
+  checkSwap()
+  {
+    const std::vector<T> src(pattern<T>(80));
+
+    // All lengths and alignments around the vector widths.
+    for (dimension_size_type offset = 0; offset < 4; ++offset)
+      for (dimension_size_type count = 0; count <= 72; ++count)
+        {
+          std::vector<T> expected(src.begin() + offset, src.begin() + offset + count);
+          for (auto& v : expected)
+            ome::files::byteswap(v);
+
+          std::vector<T> copied(count);
+          byteswapCopy(src.data() + offset, copied.data(), count);
+          ASSERT_TRUE(sameBytes(expected, copied)) << "offset=" << offset << " count=" << count;
+
+          std::vector<T> inplace(src.begin() + offset, src.begin() + offset + count);
+          ome::files::byteswap(inplace.data(), count);
+          ASSERT_TRUE(sameBytes(expected, inplace)) << "offset=" << offset << " count=" << count;
+        }
+  }
+
+}
+
+TEST(ByteSwap, Int8)
+{
+  checkSwap<int8_t>();
+}
+
+TEST(ByteSwap, UInt16)
+{
+  checkSwap<uint16_t>();
+}
+
+TEST(ByteSwap, Int32)
+{
+  checkSwap<int32_t>();
+}
+
+TEST(ByteSwap, Float)
+{
+  checkSwap<float>();
+}
+
+TEST(ByteSwap, Double)
+{
+  checkSwap<double>();
+}
+
+TEST(ByteSwap, Complex)
+{
+  checkSwap<std::complex<float>>();
+}
+
+TEST(ByteSwap, DoubleComplex)
+{
+  checkSwap<std::complex<double>>();
+}
+
+TEST(ByteSwap, InvalidSize)
+{
+  uint8_t data[3] = {1, 2, 3};
+  EXPECT_THROW(byteswapCopy(data, data, 3U, 1U), std::logic_error);
+}
+
+TEST(ByteSwap, Bulk)
+{
+  // One 256×256 16-bit plane, swapped in bulk and per value.
+  const dimension_size_type count = 256U * 256U;
+  std::vector<uint16_t> data(pattern<uint16_t>(count));
+  std::vector<uint16_t> expected(data);
+
+  for (auto& v : expected)
+    ome::files::byteswap(v);
+  ome::files::byteswap(data.data(), count);
+
+  ASSERT_EQ(expected, data);
+}
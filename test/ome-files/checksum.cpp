@@ -0,0 +1,80 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <ome/files/Checksum.h>
+
+#include <ome/test/test.h>
+
+using ome::files::crc32c;
+
+TEST(Checksum, CRC32CKnownValues)
+{
+  EXPECT_EQ(0x00000000U, crc32c(nullptr, 0U));
+
+  const std::string check("123456789");
+  EXPECT_EQ(0xE3069283U, crc32c(check.data(), check.size()));
+
+  // RFC 3720 (iSCSI) test vectors.
+  std::vector<uint8_t> zeros(32U, 0x00U);
+  EXPECT_EQ(0x8A9136AAU, crc32c(zeros.data(), zeros.size()));
+
+  std::vector<uint8_t> ones(32U, 0xFFU);
+  EXPECT_EQ(0x62A8AB43U, crc32c(ones.data(), ones.size()));
+
+  std::vector<uint8_t> ascending(32U);
+  for (std::size_t i = 0; i < ascending.size(); ++i)
+    ascending[i] = static_cast<uint8_t>(i);
+  EXPECT_EQ(0x46DD794EU, crc32c(ascending.data(), ascending.size()));
+}
+
+TEST(Checksum, CRC32CIncremental)
+{
+  std::vector<uint8_t> data(1000U);
+  for (std::size_t i = 0; i < data.size(); ++i)
+    data[i] = static_cast<uint8_t>((i * 7U) + 3U);
+
+  const uint32_t whole = crc32c(data.data(), data.size());
+
+  // Split at every alignment, so that all tails are covered.
+  for (std::size_t split = 0; split < 17U; ++split)
+    EXPECT_EQ(whole, crc32c(data.data() + split, data.size() - split,
+                            crc32c(data.data(), split)));
+}
@@ -0,0 +1,263 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2014 - 2016 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include <ome/files/PixelProperties.h>
+#include <ome/files/VariantPixelBuffer.h>
+#include <ome/files/tiff/Codec.h>
+#include <ome/files/tiff/IFD.h>
+#include <ome/files/tiff/TIFF.h>
+#include <ome/files/tiff/Types.h>
+
+#include <ome/test/test.h>
+
+#include "pixel.h"
+#include "tiffsamples.h"
+
+// Codec throughput benchmarks.  These are not run as part of the
+// test suite; run the codecbenchmark executable directly (and use
+// --gtest_filter to select images) to compare codecs.
+
+using ome::files::dimension_size_type;
+using ome::files::VariantPixelBuffer;
+using ome::files::tiff::IFD;
+using ome::files::tiff::TIFF;
+
+typedef ome::xml::model::enums::PixelType PT;
+
+namespace
+{
+
+  // Tile size used for all benchmarked images.
+  const dimension_size_type tile_size = 256U;
+
+  // Fill a buffer with a smooth gradient and low-level noise,
+  // roughly approximating the content of a microscopy image.
+  struct SyntheticFillVisitor : public boost::static_visitor<>
+  {
+    template<typename T>
+    void
+    operator() (std::shared_ptr<T>& buf)
+    {
+      const VariantPixelBuffer::size_type *shape = buf->shape();
+      VariantPixelBuffer::size_type w = shape[ome::files::DIM_SPATIAL_X];
+      VariantPixelBuffer::size_type h = shape[ome::files::DIM_SPATIAL_Y];
+      uint32_t state = 12345U;
+
+      typename T::indices_type idx;
+      std::fill(idx.begin(), idx.end(), 0);
+      for (VariantPixelBuffer::size_type y = 0; y < h; ++y)
+        for (VariantPixelBuffer::size_type x = 0; x < w; ++x)
+          {
+            state = state * 1103515245U + 12345U;
+            idx[ome::files::DIM_SPATIAL_X] = x;
+            idx[ome::files::DIM_SPATIAL_Y] = y;
+            uint32_t value = static_cast<uint32_t>(((x + y) * 200U) / (w + h)) + ((state >> 16) & 0x7U);
+            buf->array()(idx) = pixel_value<typename T::value_type>(value);
+          }
+    }
+  };
+
+  // Time a function (seconds).
+  template<typename F>
+  double
+  time(F func)
+  {
+    auto start = std::chrono::steady_clock::now();
+    func();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+  }
+
+  // Encode and decode an image with every codec available for its
+  // pixel type, and report throughput, compression ratio and
+  // per-tile latency.
+  void
+  benchmark(const std::string&                         name,
+            const VariantPixelBuffer&                  pixels,
+            ome::files::tiff::PhotometricInterpretation photometric)
+  {
+    const VariantPixelBuffer::size_type *shape = pixels.shape();
+    dimension_size_type width = shape[ome::files::DIM_SPATIAL_X];
+    dimension_size_type height = shape[ome::files::DIM_SPATIAL_Y];
+    dimension_size_type samples = shape[ome::files::DIM_SUBCHANNEL];
+    PT pixeltype = pixels.pixelType();
+    double rawsize = static_cast<double>(width * height * samples *
+                                         ome::files::bytesPerPixel(pixeltype));
+
+    std::cout << name << ": " << width << "x" << height << " " << samples << " sample(s) "
+              << pixeltype << ", " << tile_size << "x" << tile_size << " tiles\n"
+              << std::left << std::setw(16) << "  codec"
+              << std::right
+              << std::setw(12) << "encode MB/s"
+              << std::setw(12) << "decode MB/s"
+              << std::setw(8) << "ratio"
+              << std::setw(14) << "encode ms/tile"
+              << std::setw(14) << "decode ms/tile"
+              << "  lossless\n";
+
+    boost::filesystem::path dir(PROJECT_BINARY_DIR "/test/ome-files/data");
+
+    std::vector<std::string> codecs(ome::files::tiff::getCodecNames(pixeltype));
+    codecs.insert(codecs.begin(), "None");
+    for (const auto& codec : codecs)
+      {
+        boost::filesystem::path file(dir / (std::string("codecbenchmark-") + name + "-" + codec + ".tiff"));
+        std::cout << "  " << std::left << std::setw(14) << codec << std::right;
+
+        try
+          {
+            dimension_size_type tiles = 0U;
+            double encode = time([&]()
+                                 {
+                                   std::shared_ptr<TIFF> wtiff(TIFF::open(file, "w"));
+                                   std::shared_ptr<IFD> wifd(wtiff->getCurrentDirectory());
+                                   wifd->setImageWidth(width);
+                                   wifd->setImageHeight(height);
+                                   wifd->setTileType(ome::files::tiff::TILE);
+                                   wifd->setTileWidth(tile_size);
+                                   wifd->setTileHeight(tile_size);
+                                   wifd->setPixelType(pixeltype);
+                                   wifd->setBitsPerSample(ome::files::significantBitsPerPixel(pixeltype));
+                                   wifd->setSamplesPerPixel(samples);
+                                   wifd->setPlanarConfiguration(ome::files::tiff::CONTIG);
+                                   wifd->setPhotometricInterpretation(photometric);
+                                   if (codec != "None")
+                                     wifd->setCompression(ome::files::tiff::getCodecScheme(codec));
+                                   tiles = wifd->getTileInfo().tileCount();
+                                   wifd->writeImage(pixels);
+                                   wtiff->writeCurrentDirectory();
+                                   wtiff->close();
+                                 });
+
+            VariantPixelBuffer observed;
+            double decode = time([&]()
+                                 {
+                                   std::shared_ptr<TIFF> tiff(TIFF::open(file, "r"));
+                                   tiff->getDirectoryByIndex(0)->readImage(observed);
+                                 });
+
+            double filesize = static_cast<double>(boost::filesystem::file_size(file));
+
+            std::cout << std::fixed << std::setprecision(1)
+                      << std::setw(12) << (rawsize / 1.0e6) / encode
+                      << std::setw(12) << (rawsize / 1.0e6) / decode
+                      << std::setprecision(2)
+                      << std::setw(8) << rawsize / filesize
+                      << std::setprecision(3)
+                      << std::setw(14) << (encode * 1.0e3) / static_cast<double>(tiles)
+                      << std::setw(14) << (decode * 1.0e3) / static_cast<double>(tiles)
+                      << "  " << (pixels == observed ? "yes" : "no") << '\n';
+          }
+        catch (const std::exception& e)
+          {
+            std::cout << "failed: " << e.what() << '\n';
+          }
+
+        boost::system::error_code ec;
+        boost::filesystem::remove(file, ec);
+      }
+    std::cout << std::endl;
+  }
+
+  void
+  benchmarkSynthetic(PT pixeltype)
+  {
+    std::array<VariantPixelBuffer::size_type, 9> shape;
+    shape[ome::files::DIM_SPATIAL_X] = shape[ome::files::DIM_SPATIAL_Y] = 2048U;
+    shape[ome::files::DIM_SUBCHANNEL] = shape[ome::files::DIM_SPATIAL_Z] = shape[ome::files::DIM_TEMPORAL_T] =
+      shape[ome::files::DIM_CHANNEL] = shape[ome::files::DIM_MODULO_Z] = shape[ome::files::DIM_MODULO_T] =
+      shape[ome::files::DIM_MODULO_C] = 1;
+
+    VariantPixelBuffer pixels(shape, pixeltype);
+    SyntheticFillVisitor fill;
+    boost::apply_visitor(fill, pixels.vbuffer());
+
+    std::ostringstream name;
+    name << "synthetic-" << pixeltype;
+    benchmark(name.str(), pixels, ome::files::tiff::MIN_IS_BLACK);
+  }
+
+}
+
+TEST(CodecBenchmark, SyntheticUInt8)
+{
+  benchmarkSynthetic(PT::UINT8);
+}
+
+TEST(CodecBenchmark, SyntheticUInt16)
+{
+  benchmarkSynthetic(PT::UINT16);
+}
+
+TEST(CodecBenchmark, SyntheticFloat)
+{
+  benchmarkSynthetic(PT::FLOAT);
+}
+
+TEST(CodecBenchmark, Samples)
+{
+  // Each sample image is present in several layouts; only one
+  // layout is needed since all are rewritten with the same tiling.
+  std::vector<TIFFTestParameters> params(find_tiff_tests());
+  for (const auto& p : params)
+    {
+      if (p.imageplanar || p.tile)
+        continue;
+
+      std::shared_ptr<TIFF> tiff(TIFF::open(p.file, "r"));
+      std::shared_ptr<IFD> ifd(tiff->getDirectoryByIndex(0));
+      VariantPixelBuffer pixels;
+      ifd->readImage(pixels);
+
+      benchmark(boost::filesystem::path(p.file).stem().string(), pixels,
+                ifd->getPhotometricInterpretation());
+    }
+}
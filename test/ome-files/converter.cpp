@@ -0,0 +1,250 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem/operations.hpp>
+
+#include <ome/files/Converter.h>
+#include <ome/files/CoreMetadata.h>
+#include <ome/files/FormatException.h>
+#include <ome/files/MetadataTools.h>
+#include <ome/files/VariantPixelBuffer.h>
+#include <ome/files/in/OMETIFFReader.h>
+#include <ome/files/out/OMETIFFWriter.h>
+
+#include <ome/xml/meta/OMEXMLMetadata.h>
+
+#include <ome/test/test.h>
+
+using ome::files::dimension_size_type;
+using ome::files::ConversionStatistics;
+using ome::files::Converter;
+using ome::files::CoreMetadata;
+using ome::files::VariantPixelBuffer;
+using ome::files::in::OMETIFFReader;
+using ome::files::out::OMETIFFWriter;
+using ome::xml::model::enums::PixelType;
+
+using namespace boost::filesystem;
+
+namespace
+{
+
+  // Expected pixel value of a plane.
+  uint16_t
+  pixelValue(dimension_size_type plane,
+             dimension_size_type i)
+  {
+    return static_cast<uint16_t>((i * 7U) + (plane * 1000U));
+  }
+
+  // Write a tiled three-plane dataset.
+  path
+  writeInput(const std::string& name)
+  {
+    path file(path(PROJECT_BINARY_DIR "/test/ome-files/data") / name);
+
+    std::shared_ptr<CoreMetadata> c(std::make_shared<CoreMetadata>());
+    c->sizeX = 64;
+    c->sizeY = 48;
+    c->sizeZ = 3;
+    c->sizeT = 1;
+    c->sizeC.clear();
+    c->sizeC.push_back(1);
+    c->pixelType = PixelType::UINT16;
+    c->imageCount = 3;
+    c->orderCertain = true;
+    c->interleaved = false;
+    c->dimensionOrder = ome::xml::model::enums::DimensionOrder::XYZTC;
+    std::vector<std::shared_ptr<CoreMetadata>> seriesList(1, c);
+
+    std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> meta(std::make_shared<::ome::xml::meta::OMEXMLMetadata>());
+    ome::files::fillMetadata(*meta, seriesList);
+    std::shared_ptr<::ome::xml::meta::MetadataRetrieve> retrieve(meta);
+
+    OMETIFFWriter writer;
+    writer.setMetadataRetrieve(retrieve);
+    writer.setCompression("Deflate");
+    writer.setTileSizeX(16);
+    writer.setTileSizeY(16);
+    writer.setId(file);
+
+    std::array<VariantPixelBuffer::size_type, 9> shape;
+    shape.fill(1U);
+    shape[ome::files::DIM_SPATIAL_X] = 64;
+    shape[ome::files::DIM_SPATIAL_Y] = 48;
+
+    for (dimension_size_type p = 0U; p < 3U; ++p)
+      {
+        VariantPixelBuffer buf(shape, PixelType::UINT16);
+        uint16_t *data = buf.array<uint16_t>().data();
+        for (dimension_size_type i = 0U; i < buf.num_elements(); ++i)
+          data[i] = pixelValue(p, i);
+        writer.saveBytes(p, buf);
+      }
+    writer.close();
+
+    return file;
+  }
+
+  // Check the converted pixel data.
+  template<typename T>
+  void
+  checkOutput(const path& file,
+              PixelType   type)
+  {
+    OMETIFFReader reader;
+    ASSERT_NO_THROW(reader.setId(file));
+    ASSERT_EQ(1U, reader.getSeriesCount());
+    ASSERT_EQ(3U, reader.getImageCount());
+    EXPECT_EQ(64U, reader.getSizeX());
+    EXPECT_EQ(48U, reader.getSizeY());
+    EXPECT_EQ(type, reader.getPixelType());
+
+    for (dimension_size_type p = 0U; p < 3U; ++p)
+      {
+        VariantPixelBuffer buf;
+        ASSERT_NO_THROW(reader.openBytes(p, buf));
+        const T *data = buf.array<T>().data();
+        for (dimension_size_type i = 0U; i < buf.num_elements(); ++i)
+          ASSERT_EQ(static_cast<T>(pixelValue(p, i)), data[i]);
+      }
+  }
+
+}
+
+TEST(Converter, RawCopy)
+{
+  path input(writeInput("converter-input-raw.ome.tiff"));
+  path output(PROJECT_BINARY_DIR "/test/ome-files/data/converter-raw.ome.tiff");
+
+  // The compression and tile size default to those of the input,
+  // so the compressed tiles are copied.
+  Converter converter;
+  ConversionStatistics stats;
+  ASSERT_NO_THROW(stats = converter.convert(input, output));
+  EXPECT_EQ(3U, stats.planes);
+  EXPECT_EQ(3U, stats.copiedPlanes);
+  EXPECT_EQ(0U, stats.tiles);
+
+  checkOutput<uint16_t>(output, PixelType::UINT16);
+}
+
+TEST(Converter, Pipeline)
+{
+  path input(writeInput("converter-input-pipeline.ome.tiff"));
+  path output(PROJECT_BINARY_DIR "/test/ome-files/data/converter-pipeline.ome.tiff");
+
+  // A different compression decodes and encodes every tile, with
+  // more tiles than the queue depth read concurrently.
+  Converter converter;
+  converter.setCompression(std::string("LZW"));
+  converter.setReadThreads(3U);
+  converter.setEncodeThreads(2U);
+  converter.setQueueDepth(2U);
+  ConversionStatistics stats;
+  ASSERT_NO_THROW(stats = converter.convert(input, output));
+  EXPECT_EQ(3U, stats.planes);
+  EXPECT_EQ(0U, stats.copiedPlanes);
+  EXPECT_EQ(36U, stats.tiles);
+  EXPECT_EQ(3U * 64U * 48U * 2U, stats.bytes);
+
+  checkOutput<uint16_t>(output, PixelType::UINT16);
+}
+
+TEST(Converter, NoRawCopy)
+{
+  path input(writeInput("converter-input-noraw.ome.tiff"));
+  path output(PROJECT_BINARY_DIR "/test/ome-files/data/converter-noraw.ome.tiff");
+
+  Converter converter;
+  converter.setRawCopy(false);
+  converter.setTileSize(dimension_size_type(32U), dimension_size_type(16U));
+  ConversionStatistics stats;
+  ASSERT_NO_THROW(stats = converter.convert(input, output));
+  EXPECT_EQ(0U, stats.copiedPlanes);
+  EXPECT_EQ(18U, stats.tiles);
+
+  checkOutput<uint16_t>(output, PixelType::UINT16);
+}
+
+TEST(Converter, PixelType)
+{
+  path input(writeInput("converter-input-pixeltype.ome.tiff"));
+  path output(PROJECT_BINARY_DIR "/test/ome-files/data/converter-pixeltype.ome.tiff");
+
+  Converter converter;
+  converter.setPixelType(PixelType(PixelType::FLOAT));
+  converter.setConvertThreads(2U);
+  ConversionStatistics stats;
+  ASSERT_NO_THROW(stats = converter.convert(input, output));
+  EXPECT_EQ(3U, stats.planes);
+  EXPECT_EQ(0U, stats.copiedPlanes);
+
+  checkOutput<float>(output, PixelType::FLOAT);
+}
+
+TEST(Converter, Pyramid)
+{
+  path input(writeInput("converter-input-pyramid.ome.tiff"));
+  path output(PROJECT_BINARY_DIR "/test/ome-files/data/converter-pyramid.ome.tiff");
+
+  Converter converter;
+  converter.setResolutionCount(3U);
+  ConversionStatistics stats;
+  ASSERT_NO_THROW(stats = converter.convert(input, output));
+  EXPECT_EQ(0U, stats.copiedPlanes);
+
+  checkOutput<uint16_t>(output, PixelType::UINT16);
+
+  OMETIFFReader reader;
+  reader.setFlattenedResolutions(false);
+  ASSERT_NO_THROW(reader.setId(output));
+  EXPECT_EQ(3U, reader.getResolutionCount());
+}
+
+TEST(Converter, MissingInput)
+{
+  Converter converter;
+  EXPECT_THROW(converter.convert(PROJECT_BINARY_DIR "/test/ome-files/data/converter-missing.ome.tiff",
+                                 PROJECT_BINARY_DIR "/test/ome-files/data/converter-missing-output.ome.tiff"),
+               std::exception);
+}
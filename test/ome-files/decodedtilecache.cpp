@@ -0,0 +1,195 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <thread>
+#include <vector>
+
+#include <ome/files/Types.h>
+#include <ome/files/TileBuffer.h>
+#include <ome/files/DecodedTileCache.h>
+#include <ome/files/NUMA.h>
+
+#include <ome/test/test.h>
+
+using ome::files::dimension_size_type;
+using ome::files::DecodedTileCache;
+using ome::files::TileBuffer;
+
+namespace
+{
+
+  DecodedTileCache::key_type
+  key(dimension_size_type tile,
+      const std::string&  file = "test.tiff",
+      uint64_t            offset = 8U)
+  {
+    return DecodedTileCache::key_type(file, offset, tile);
+  }
+
+}
+
+TEST(DecodedTileCache, Construct)
+{
+  DecodedTileCache c;
+  ASSERT_EQ(0U, c.size());
+  ASSERT_EQ(0U, c.byteSize());
+}
+
+TEST(DecodedTileCache, Insert)
+{
+  DecodedTileCache c;
+
+  for (dimension_size_type i = 0; i < 16; ++i)
+    {
+      c.insert(key(i), std::make_shared<TileBuffer>(8192));
+      ASSERT_TRUE(static_cast<bool>(c.find(key(i))));
+      ASSERT_FALSE(static_cast<bool>(c.find(key(i, "other.tiff"))));
+      ASSERT_FALSE(static_cast<bool>(c.find(key(i, "test.tiff", 16U))));
+    }
+
+  ASSERT_EQ(16U, c.size());
+  ASSERT_EQ(16U * 8192U, c.byteSize());
+}
+
+TEST(DecodedTileCache, Replace)
+{
+  DecodedTileCache c;
+
+  c.insert(key(0), std::make_shared<TileBuffer>(8192));
+  std::shared_ptr<TileBuffer> t(std::make_shared<TileBuffer>(4096));
+  c.insert(key(0), t);
+
+  ASSERT_EQ(1U, c.size());
+  ASSERT_EQ(4096U, c.byteSize());
+  ASSERT_EQ(t, c.find(key(0)));
+}
+
+TEST(DecodedTileCache, Evict)
+{
+  DecodedTileCache c(4U * 8192U);
+
+  for (dimension_size_type i = 0; i < 4; ++i)
+    c.insert(key(i), std::make_shared<TileBuffer>(8192));
+  ASSERT_EQ(4U, c.size());
+
+  // Use tile 0, so tile 1 is least recently used.
+  ASSERT_TRUE(static_cast<bool>(c.find(key(0))));
+  c.insert(key(4), std::make_shared<TileBuffer>(8192));
+
+  ASSERT_EQ(4U, c.size());
+  ASSERT_LE(c.byteSize(), c.getMaxByteSize());
+  ASSERT_TRUE(static_cast<bool>(c.find(key(0))));
+  ASSERT_FALSE(static_cast<bool>(c.find(key(1))));
+  ASSERT_TRUE(static_cast<bool>(c.find(key(4))));
+
+  // Tiles exceeding the size limit are not cached.
+  c.insert(key(5), std::make_shared<TileBuffer>(8U * 8192U));
+  ASSERT_FALSE(static_cast<bool>(c.find(key(5))));
+
+  c.setMaxByteSize(8192U);
+  ASSERT_EQ(1U, c.size());
+  ASSERT_TRUE(static_cast<bool>(c.find(key(4))));
+}
+
+TEST(DecodedTileCache, EraseFile)
+{
+  DecodedTileCache c;
+
+  for (dimension_size_type i = 0; i < 8; ++i)
+    {
+      c.insert(key(i, "a.tiff"), std::make_shared<TileBuffer>(1024));
+      c.insert(key(i, "b.tiff"), std::make_shared<TileBuffer>(1024));
+      c.insert(key(i, "c.tiff"), std::make_shared<TileBuffer>(1024));
+    }
+
+  c.erase("b.tiff");
+  ASSERT_EQ(16U, c.size());
+  ASSERT_EQ(16U * 1024U, c.byteSize());
+  for (dimension_size_type i = 0; i < 8; ++i)
+    {
+      ASSERT_TRUE(static_cast<bool>(c.find(key(i, "a.tiff"))));
+      ASSERT_FALSE(static_cast<bool>(c.find(key(i, "b.tiff"))));
+      ASSERT_TRUE(static_cast<bool>(c.find(key(i, "c.tiff"))));
+    }
+}
+
+TEST(DecodedTileCache, Clear)
+{
+  DecodedTileCache c;
+
+  for (dimension_size_type i = 0; i < 16; ++i)
+    c.insert(key(i), std::make_shared<TileBuffer>(8192));
+
+  ASSERT_EQ(16U, c.size());
+
+  c.clear();
+  ASSERT_EQ(0U, c.size());
+  ASSERT_EQ(0U, c.byteSize());
+}
+
+TEST(DecodedTileCache, Partitioned)
+{
+  DecodedTileCache c(16U * 8192U, 4U);
+  ASSERT_EQ(4U, c.getPartitionCount());
+
+  // Tiles inserted by other threads may be in other partitions, but
+  // are found from any thread.
+  std::vector<std::thread> threads;
+  for (dimension_size_type t = 0; t < 4; ++t)
+    threads.emplace_back([&c, t]()
+                         {
+                           ome::files::bindThreadToNUMANode(t);
+                           for (dimension_size_type i = t * 8U; i < (t + 1U) * 8U; ++i)
+                             c.insert(key(i), std::make_shared<TileBuffer>(8192));
+                         });
+  for (auto& thread : threads)
+    thread.join();
+
+  // The size limit applies to all partitions together.
+  ASSERT_LE(c.byteSize(), c.getMaxByteSize());
+  ASSERT_EQ(c.size() * 8192U, c.byteSize());
+
+  dimension_size_type found = 0U;
+  for (dimension_size_type i = 0; i < 32; ++i)
+    if (c.find(key(i)))
+      ++found;
+  ASSERT_EQ(c.size(), found);
+
+  c.erase("test.tiff");
+  ASSERT_EQ(0U, c.size());
+  ASSERT_EQ(0U, c.byteSize());
+}
@@ -0,0 +1,324 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2014 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+
+#include <ome/files/Downsample.h>
+#include <ome/files/PixelBuffer.h>
+#include <ome/files/VariantPixelBuffer.h>
+
+#include <ome/test/test.h>
+
+using ome::files::AreaDownsampler;
+using ome::files::dimension_size_type;
+using ome::files::downsample;
+using ome::files::downsampledSize;
+using ome::files::PixelBuffer;
+using ome::files::PixelProperties;
+using ome::files::VariantPixelBuffer;
+typedef ome::xml::model::enums::PixelType PT;
+
+namespace
+{
+
+  std::array<VariantPixelBuffer::size_type, 9>
+  makeShape(dimension_size_type w,
+            dimension_size_type h,
+            dimension_size_type samples)
+  {
+    std::array<VariantPixelBuffer::size_type, 9> shape;
+    shape[ome::files::DIM_SPATIAL_X] = w;
+    shape[ome::files::DIM_SPATIAL_Y] = h;
+    shape[ome::files::DIM_SUBCHANNEL] = samples;
+    shape[ome::files::DIM_SPATIAL_Z] = shape[ome::files::DIM_TEMPORAL_T] = shape[ome::files::DIM_CHANNEL] =
+      shape[ome::files::DIM_MODULO_Z] = shape[ome::files::DIM_MODULO_T] = shape[ome::files::DIM_MODULO_C] = 1;
+    return shape;
+  }
+
+  VariantPixelBuffer::indices_type
+  makeIndex(dimension_size_type x,
+            dimension_size_type y,
+            dimension_size_type s)
+  {
+    VariantPixelBuffer::indices_type idx;
+    idx.fill(0);
+    idx[ome::files::DIM_SPATIAL_X] = static_cast<VariantPixelBuffer::indices_type::value_type>(x);
+    idx[ome::files::DIM_SPATIAL_Y] = static_cast<VariantPixelBuffer::indices_type::value_type>(y);
+    idx[ome::files::DIM_SUBCHANNEL] = static_cast<VariantPixelBuffer::indices_type::value_type>(s);
+    return idx;
+  }
+
+  typedef PixelProperties<PT::UINT16>::std_type uint16_pixel;
+
+  void
+  fill(VariantPixelBuffer& buf)
+  {
+    const VariantPixelBuffer::size_type *shape = buf.shape();
+    for (dimension_size_type y = 0; y < shape[ome::files::DIM_SPATIAL_Y]; ++y)
+      for (dimension_size_type x = 0; x < shape[ome::files::DIM_SPATIAL_X]; ++x)
+        for (dimension_size_type s = 0; s < shape[ome::files::DIM_SUBCHANNEL]; ++s)
+          buf.array<uint16_pixel>()(makeIndex(x, y, s)) =
+            static_cast<uint16_pixel>((x * 7U) + (y * 31U) + (s * 1000U));
+  }
+
+  // Copy a region of a buffer.
+  void
+  region(const VariantPixelBuffer& buf,
+         dimension_size_type       x,
+         dimension_size_type       y,
+         dimension_size_type       w,
+         dimension_size_type       h,
+         VariantPixelBuffer&       sub)
+  {
+    dimension_size_type samples = buf.shape()[ome::files::DIM_SUBCHANNEL];
+    sub.setBuffer(makeShape(w, h, samples), PT::UINT16);
+    for (dimension_size_type sy = 0; sy < h; ++sy)
+      for (dimension_size_type sx = 0; sx < w; ++sx)
+        for (dimension_size_type s = 0; s < samples; ++s)
+          sub.array<uint16_pixel>()(makeIndex(sx, sy, s)) =
+            buf.array<uint16_pixel>()(makeIndex(x + sx, y + sy, s));
+  }
+
+}
+
+TEST(Downsample, Size)
+{
+  EXPECT_EQ(1U, downsampledSize(1U));
+  EXPECT_EQ(1U, downsampledSize(2U));
+  EXPECT_EQ(2U, downsampledSize(3U));
+  EXPECT_EQ(512U, downsampledSize(1024U));
+}
+
+TEST(Downsample, Mean)
+{
+  const dimension_size_type w = 13U, h = 7U, samples = 3U;
+  VariantPixelBuffer full(makeShape(w, h, samples), PT::UINT16);
+  fill(full);
+
+  VariantPixelBuffer half(makeShape(downsampledSize(w), downsampledSize(h), samples), PT::UINT16);
+  downsample(full, 0, 0, half);
+
+  for (dimension_size_type y = 0; y < downsampledSize(h); ++y)
+    for (dimension_size_type x = 0; x < downsampledSize(w); ++x)
+      for (dimension_size_type s = 0; s < samples; ++s)
+        {
+          double sum = 0.0;
+          dimension_size_type count = 0;
+          for (dimension_size_type by = y * 2U; by < std::min(y * 2U + 2U, h); ++by)
+            for (dimension_size_type bx = x * 2U; bx < std::min(x * 2U + 2U, w); ++bx)
+              {
+                sum += full.array<uint16_pixel>()(makeIndex(bx, by, s));
+                ++count;
+              }
+          EXPECT_EQ(static_cast<uint16_pixel>(std::floor(sum / count + 0.5)),
+                    half.array<uint16_pixel>()(makeIndex(x, y, s)))
+            << "x=" << x << " y=" << y << " s=" << s;
+        }
+}
+
+TEST(Downsample, Incremental)
+{
+  const dimension_size_type w = 37U, h = 29U, tile = 8U;
+  VariantPixelBuffer full(makeShape(w, h, 1U), PT::UINT16);
+  fill(full);
+
+  VariantPixelBuffer expected(makeShape(downsampledSize(w), downsampledSize(h), 1U), PT::UINT16);
+  downsample(full, 0, 0, expected);
+
+  // Regions aligned to even coordinates, downsampled in reverse
+  // order.
+  VariantPixelBuffer observed(makeShape(downsampledSize(w), downsampledSize(h), 1U), PT::UINT16);
+  for (dimension_size_type ty = (h - 1U) / tile + 1U; ty-- > 0;)
+    for (dimension_size_type tx = (w - 1U) / tile + 1U; tx-- > 0;)
+      {
+        dimension_size_type x = tx * tile;
+        dimension_size_type y = ty * tile;
+        VariantPixelBuffer sub;
+        region(full, x, y, std::min(tile, w - x), std::min(tile, h - y), sub);
+        downsample(sub, x, y, observed);
+      }
+
+  EXPECT_EQ(expected, observed);
+}
+
+TEST(Downsample, Bit)
+{
+  typedef PixelProperties<PT::BIT>::std_type bit_pixel;
+
+  VariantPixelBuffer full(makeShape(4U, 2U, 1U), PT::BIT);
+  const bool values[2][4] = {{true, false, false, false},
+                             {true, false, true,  false}};
+  for (dimension_size_type y = 0; y < 2U; ++y)
+    for (dimension_size_type x = 0; x < 4U; ++x)
+      full.array<bit_pixel>()(makeIndex(x, y, 0)) = values[y][x];
+
+  VariantPixelBuffer half(makeShape(2U, 1U, 1U), PT::BIT);
+  downsample(full, 0, 0, half);
+
+  EXPECT_TRUE(half.array<bit_pixel>()(makeIndex(0, 0, 0)));
+  EXPECT_FALSE(half.array<bit_pixel>()(makeIndex(1, 0, 0)));
+}
+
+TEST(Downsample, Float)
+{
+  typedef PixelProperties<PT::FLOAT>::std_type float_pixel;
+
+  VariantPixelBuffer full(makeShape(2U, 2U, 1U), PT::FLOAT);
+  full.array<float_pixel>()(makeIndex(0, 0, 0)) = 1.0f;
+  full.array<float_pixel>()(makeIndex(1, 0, 0)) = 2.0f;
+  full.array<float_pixel>()(makeIndex(0, 1, 0)) = 3.0f;
+  full.array<float_pixel>()(makeIndex(1, 1, 0)) = 4.5f;
+
+  VariantPixelBuffer half(makeShape(1U, 1U, 1U), PT::FLOAT);
+  downsample(full, 0, 0, half);
+
+  EXPECT_FLOAT_EQ(2.625f, half.array<float_pixel>()(makeIndex(0, 0, 0)));
+}
+
+TEST(Downsample, Mismatch)
+{
+  VariantPixelBuffer full(makeShape(4U, 4U, 1U), PT::UINT16);
+  VariantPixelBuffer wrongtype(makeShape(2U, 2U, 1U), PT::UINT8);
+  VariantPixelBuffer wrongsamples(makeShape(2U, 2U, 3U), PT::UINT16);
+
+  EXPECT_THROW(downsample(full, 0, 0, wrongtype), std::logic_error);
+  EXPECT_THROW(downsample(full, 0, 0, wrongsamples), std::logic_error);
+}
+
+TEST(AreaDownsample, Mean)
+{
+  const dimension_size_type w = 100U, h = 75U, dw = 13U, dh = 9U, samples = 2U;
+  VariantPixelBuffer full(makeShape(w, h, samples), PT::UINT16);
+  fill(full);
+
+  AreaDownsampler area(w, h, dw, dh);
+  area.add(full, 0, 0);
+  VariantPixelBuffer thumb;
+  area.get(thumb);
+
+  ASSERT_EQ(PT::UINT16, thumb.pixelType());
+  ASSERT_EQ(dw, thumb.shape()[ome::files::DIM_SPATIAL_X]);
+  ASSERT_EQ(dh, thumb.shape()[ome::files::DIM_SPATIAL_Y]);
+  ASSERT_EQ(samples, thumb.shape()[ome::files::DIM_SUBCHANNEL]);
+
+  for (dimension_size_type y = 0; y < dh; ++y)
+    for (dimension_size_type x = 0; x < dw; ++x)
+      for (dimension_size_type s = 0; s < samples; ++s)
+        {
+          double sum = 0.0;
+          dimension_size_type count = 0;
+          for (dimension_size_type sy = 0; sy < h; ++sy)
+            for (dimension_size_type sx = 0; sx < w; ++sx)
+              if (sx * dw / w == x && sy * dh / h == y)
+                {
+                  sum += full.array<uint16_pixel>()(makeIndex(sx, sy, s));
+                  ++count;
+                }
+          EXPECT_EQ(static_cast<uint16_pixel>(std::floor(sum / count + 0.5)),
+                    thumb.array<uint16_pixel>()(makeIndex(x, y, s)))
+            << "x=" << x << " y=" << y << " s=" << s;
+        }
+}
+
+TEST(AreaDownsample, Incremental)
+{
+  const dimension_size_type w = 61U, h = 47U, tile = 16U, dw = 10U, dh = 7U;
+  VariantPixelBuffer full(makeShape(w, h, 1U), PT::UINT16);
+  fill(full);
+
+  AreaDownsampler whole(w, h, dw, dh);
+  whole.add(full, 0, 0);
+  VariantPixelBuffer expected;
+  whole.get(expected);
+
+  // Unaligned tiles, added in reverse order.
+  AreaDownsampler tiled(w, h, dw, dh);
+  for (dimension_size_type ty = (h - 1U) / tile + 1U; ty-- > 0;)
+    for (dimension_size_type tx = (w - 1U) / tile + 1U; tx-- > 0;)
+      {
+        dimension_size_type x = tx * tile;
+        dimension_size_type y = ty * tile;
+        VariantPixelBuffer sub;
+        region(full, x, y, std::min(tile, w - x), std::min(tile, h - y), sub);
+        tiled.add(sub, x, y);
+      }
+  VariantPixelBuffer observed;
+  tiled.get(observed);
+
+  EXPECT_EQ(expected, observed);
+}
+
+TEST(AreaDownsample, Bit)
+{
+  typedef PixelProperties<PT::BIT>::std_type bit_pixel;
+
+  VariantPixelBuffer full(makeShape(6U, 1U, 1U), PT::BIT);
+  const bool values[6] = {true, true, false, false, false, true};
+  for (dimension_size_type x = 0; x < 6U; ++x)
+    full.array<bit_pixel>()(makeIndex(x, 0, 0)) = values[x];
+
+  AreaDownsampler area(6U, 1U, 2U, 1U);
+  area.add(full, 0, 0);
+  VariantPixelBuffer thumb;
+  area.get(thumb);
+
+  EXPECT_TRUE(thumb.array<bit_pixel>()(makeIndex(0, 0, 0)));
+  EXPECT_FALSE(thumb.array<bit_pixel>()(makeIndex(1, 0, 0)));
+}
+
+TEST(AreaDownsample, Invalid)
+{
+  EXPECT_THROW(AreaDownsampler(0U, 4U, 1U, 1U), std::logic_error);
+  EXPECT_THROW(AreaDownsampler(4U, 4U, 8U, 2U), std::logic_error);
+
+  AreaDownsampler area(4U, 4U, 2U, 2U);
+  VariantPixelBuffer thumb;
+  EXPECT_THROW(area.get(thumb), std::logic_error);
+
+  VariantPixelBuffer tile(makeShape(2U, 2U, 1U), PT::UINT16);
+  VariantPixelBuffer wrongtype(makeShape(2U, 2U, 1U), PT::UINT8);
+  VariantPixelBuffer wrongsamples(makeShape(2U, 2U, 3U), PT::UINT16);
+  EXPECT_THROW(area.add(tile, 3U, 0U), std::logic_error);
+  area.add(tile, 0U, 0U);
+  EXPECT_THROW(area.add(wrongtype, 2U, 0U), std::logic_error);
+  EXPECT_THROW(area.add(wrongsamples, 2U, 0U), std::logic_error);
+}
@@ -0,0 +1,240 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#include <ome/files/Executor.h>
+#include <ome/files/NUMA.h>
+#include <ome/files/Types.h>
+
+#include <ome/test/test.h>
+
+using ome::files::dimension_size_type;
+using ome::files::CancellationToken;
+using ome::files::Executor;
+using ome::files::FunctionExecutor;
+using ome::files::ThreadPoolExecutor;
+using ome::files::runParallel;
+
+TEST(Executor, ThreadPoolConcurrency)
+{
+  ThreadPoolExecutor pool(4U);
+  EXPECT_EQ(4U, pool.concurrency());
+}
+
+TEST(Executor, ThreadPoolDrain)
+{
+  std::atomic<unsigned int> count(0U);
+  {
+    ThreadPoolExecutor pool(2U);
+    for (unsigned int i = 0; i < 1000U; ++i)
+      pool.submit([&count]() { ++count; },
+                  static_cast<Executor::Priority>(i % 3));
+  }
+  // All tasks complete before the pool is destroyed.
+  EXPECT_EQ(1000U, count);
+}
+
+TEST(Executor, ThreadPoolInit)
+{
+  std::mutex mutex;
+  std::vector<dimension_size_type> workers;
+  {
+    ThreadPoolExecutor pool(2U,
+                            [&mutex, &workers](dimension_size_type worker)
+                            {
+                              std::lock_guard<std::mutex> lock(mutex);
+                              workers.push_back(worker);
+                            });
+  }
+  EXPECT_EQ(2U, workers.size());
+}
+
+TEST(Executor, RunParallel)
+{
+  std::shared_ptr<Executor> pool(std::make_shared<ThreadPoolExecutor>(4U));
+  std::vector<std::atomic<unsigned int>> counts(8U);
+  for (auto& count : counts)
+    count = 0U;
+
+  runParallel(pool, counts.size(),
+              [&counts](dimension_size_type worker,
+                        dimension_size_type workers)
+              {
+                EXPECT_EQ(8U, workers);
+                ++counts[worker];
+              });
+
+  // Each worker is run exactly once.
+  for (const auto& count : counts)
+    EXPECT_EQ(1U, count);
+}
+
+TEST(Executor, RunParallelNested)
+{
+  // Nested parallel work must not deadlock, even when every pool
+  // thread is waiting on an outer worker.
+  std::shared_ptr<Executor> pool(std::make_shared<ThreadPoolExecutor>(2U));
+  std::atomic<unsigned int> count(0U);
+
+  runParallel(pool, 8U,
+              [&pool, &count](dimension_size_type, dimension_size_type)
+              {
+                runParallel(pool, 8U,
+                            [&pool, &count](dimension_size_type, dimension_size_type)
+                            {
+                              runParallel(pool, 100U,
+                                          [&count](dimension_size_type, dimension_size_type)
+                                          {
+                                            ++count;
+                                          });
+                            });
+              });
+
+  EXPECT_EQ(6400U, count);
+}
+
+TEST(Executor, RunParallelException)
+{
+  std::shared_ptr<Executor> pool(std::make_shared<ThreadPoolExecutor>(4U));
+  std::atomic<unsigned int> count(0U);
+
+  EXPECT_THROW(runParallel(pool, 4U,
+                           [&count](dimension_size_type worker, dimension_size_type)
+                           {
+                             ++count;
+                             if (worker == 2U)
+                               throw std::runtime_error("worker failed");
+                           }),
+               std::runtime_error);
+
+  // The remaining workers still run to completion.
+  EXPECT_EQ(4U, count);
+}
+
+TEST(Executor, RunParallelInline)
+{
+  // An executor which never runs its tasks; the caller runs all of
+  // the work itself.
+  std::atomic<unsigned int> submitted(0U);
+  std::shared_ptr<Executor> never
+    (std::make_shared<FunctionExecutor>([&submitted](const Executor::task_type&)
+                                        {
+                                          ++submitted;
+                                        }, 4U));
+  std::atomic<unsigned int> count(0U);
+
+  runParallel(never, 4U,
+              [&count](dimension_size_type, dimension_size_type)
+              {
+                ++count;
+              });
+
+  EXPECT_EQ(4U, count);
+  EXPECT_GT(submitted, 0U);
+}
+
+TEST(Executor, FunctionExecutor)
+{
+  unsigned int count = 0U;
+  FunctionExecutor e([](const Executor::task_type& task) { task(); }, 2U);
+  EXPECT_EQ(2U, e.concurrency());
+  e.submit([&count]() { ++count; });
+  e.submit([&count]() { ++count; }, Executor::PRIORITY_HIGH);
+  EXPECT_EQ(2U, count);
+}
+
+TEST(Executor, CancellationToken)
+{
+  CancellationToken token;
+  CancellationToken copy(token);
+  CancellationToken other;
+  EXPECT_FALSE(token.cancelled());
+
+  copy.cancel();
+  EXPECT_TRUE(token.cancelled());
+  EXPECT_TRUE(copy.cancelled());
+  EXPECT_FALSE(other.cancelled());
+}
+
+TEST(Executor, DefaultExecutor)
+{
+  std::shared_ptr<Executor> original(ome::files::defaultExecutor());
+  ASSERT_TRUE(static_cast<bool>(original));
+  EXPECT_GE(original->concurrency(), 2U);
+
+  unsigned int count = 0U;
+  std::shared_ptr<Executor> inline_executor
+    (std::make_shared<FunctionExecutor>([&count](const Executor::task_type& task)
+                                        {
+                                          ++count;
+                                          task();
+                                        }));
+  ome::files::setDefaultExecutor(inline_executor);
+  EXPECT_EQ(inline_executor, ome::files::defaultExecutor());
+
+  // A null executor uses the default.
+  runParallel(std::shared_ptr<Executor>(), 2U,
+              [](dimension_size_type, dimension_size_type) {});
+  EXPECT_GT(count, 0U);
+
+  ome::files::setDefaultExecutor(original);
+  EXPECT_EQ(original, ome::files::defaultExecutor());
+}
+
+TEST(Executor, NUMAThreadInit)
+{
+  ASSERT_GE(ome::files::numaNodeCount(), 1U);
+  EXPECT_LT(ome::files::currentNUMANode(), ome::files::numaNodeCount());
+
+  std::shared_ptr<Executor> pool
+    (std::make_shared<ThreadPoolExecutor>(4U, ome::files::numaThreadInit()));
+  std::vector<dimension_size_type> nodes(4U);
+
+  runParallel(pool, nodes.size(),
+              [&nodes](dimension_size_type worker, dimension_size_type)
+              {
+                nodes[worker] = ome::files::currentNUMANode();
+              });
+
+  for (const auto node : nodes)
+    EXPECT_LT(node, ome::files::numaNodeCount());
+}
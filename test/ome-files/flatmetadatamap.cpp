@@ -0,0 +1,364 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2014 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <ome/files/FlatMetadataMap.h>
+
+#include <sstream>
+#include <stdexcept>
+#include <iostream>
+
+#include <ome/test/test.h>
+
+// Include last due to side effect of MPL vector limit setting which can change the default
+#include <boost/lexical_cast.hpp>
+
+using ome::files::FlatMetadataMap;
+using ome::files::MetadataMap;
+using boost::lexical_cast;
+
+class FlatMetadataMapTest : public ::testing::Test
+{
+public:
+  FlatMetadataMap m;
+  const FlatMetadataMap& cm;
+
+  FlatMetadataMapTest():
+    ::testing::Test(),
+    m(),
+    cm(m)
+  {
+  }
+
+  void SetUp()
+  {
+    FlatMetadataMap::value_type v;
+    m.set("int1", int32_t(82));
+    v = 272;
+    m.set("int2", v);
+
+    std::vector<std::string> vs;
+    vs.push_back("s1");
+    vs.push_back("s2");
+    vs.push_back("s3");
+    m.set("vector<string>1", vs);
+
+    ASSERT_EQ(m.size(), 3U);
+  }
+};
+
+namespace
+{
+
+  MetadataMap
+  largeMap(uint32_t size)
+  {
+    MetadataMap map;
+    for (uint32_t i = 0U; i < size; ++i)
+      {
+        map.set(std::string("key-") + lexical_cast<std::string>(i), i);
+        if (i % 10U == 0U)
+          map.append(std::string("list-") + lexical_cast<std::string>(i), i);
+      }
+    return map;
+  }
+
+}
+
+TEST_F(FlatMetadataMapTest, Copy)
+{
+  FlatMetadataMap m2(m);
+  ASSERT_EQ(m, m2);
+}
+
+TEST_F(FlatMetadataMapTest, SetGet)
+{
+  FlatMetadataMap::value_type vget;
+  ASSERT_TRUE(m.get("int2", vget));
+  ASSERT_EQ(boost::get<int>(vget), 272);
+
+  int32_t iget = 0;
+  ASSERT_TRUE(m.get("int1", iget));
+  ASSERT_EQ(iget, 82);
+
+  std::string sget("invalid");
+  ASSERT_FALSE(m.get("int1", sget));
+  ASSERT_EQ(sget, "invalid");
+  ASSERT_FALSE(m.get("invalid", iget));
+
+  // Replace existing value.
+  m.set("int1", int32_t(83));
+  ASSERT_EQ(m.get<int32_t>("int1"), 83);
+  ASSERT_EQ(m.size(), 3U);
+
+  ASSERT_THROW(m.get<int32_t>("invalid"), boost::bad_get);
+  ASSERT_THROW(cm.get<std::string>("int1"), boost::bad_get);
+}
+
+TEST_F(FlatMetadataMapTest, SetOperator)
+{
+  m["int3"] = uint32_t(23);
+  m["int1"] = int32_t(4);
+
+  ASSERT_EQ(m.size(), 4U);
+  ASSERT_EQ(cm.get<uint32_t>("int3"), 23U);
+  ASSERT_EQ(cm.get<int32_t>("int1"), 4);
+}
+
+TEST_F(FlatMetadataMapTest, Append)
+{
+  m.append("vector<string>1", std::string("s4"));
+  ASSERT_EQ(m.get<std::vector<std::string>>("vector<string>1").size(), 4U);
+
+  // Replaces non-vector value.
+  m.append("int1", int32_t(6));
+  ASSERT_EQ(m.get<std::vector<int32_t>>("int1").size(), 1U);
+}
+
+TEST_F(FlatMetadataMapTest, Find)
+{
+  FlatMetadataMap::iterator it = m.find("int1");
+  ASSERT_TRUE(it != cm.end());
+
+  FlatMetadataMap::const_iterator itf = cm.find("invalid");
+  ASSERT_TRUE(itf == cm.end());
+}
+
+TEST_F(FlatMetadataMapTest, Insert)
+{
+  FlatMetadataMap::map_type::value_type i1("int1", int32_t(4332));
+  std::pair<FlatMetadataMap::iterator, bool> r1 = m.insert(i1);
+
+  ASSERT_FALSE(r1.second);
+  ASSERT_EQ(m.get<int32_t>("int1"), 82);
+
+  FlatMetadataMap::map_type::value_type i2("int3", int32_t(7823));
+  std::pair<FlatMetadataMap::iterator, bool> r2 = m.insert(i2);
+
+  ASSERT_TRUE(r2.first != m.end());
+  ASSERT_TRUE(r2.second);
+  ASSERT_EQ(m.get<int32_t>("int3"), 7823);
+}
+
+TEST_F(FlatMetadataMapTest, InsertRange)
+{
+  FlatMetadataMap::map_type range;
+  range.push_back(FlatMetadataMap::map_type::value_type("z", int32_t(1)));
+  range.push_back(FlatMetadataMap::map_type::value_type("int1", int32_t(2)));
+  range.push_back(FlatMetadataMap::map_type::value_type("a", int32_t(3)));
+  range.push_back(FlatMetadataMap::map_type::value_type("z", int32_t(4)));
+
+  m.insert(range.begin(), range.end());
+
+  ASSERT_EQ(m.size(), 5U);
+  // Existing keys and the first of duplicated keys are retained.
+  ASSERT_EQ(m.get<int32_t>("int1"), 82);
+  ASSERT_EQ(m.get<int32_t>("z"), 1);
+  ASSERT_EQ(m.get<int32_t>("a"), 3);
+
+  std::vector<std::string> keys = m.keys();
+  ASSERT_TRUE(std::is_sorted(keys.begin(), keys.end()));
+}
+
+TEST_F(FlatMetadataMapTest, Erase)
+{
+  m.erase("int1");
+  ASSERT_EQ(m.size(), 2U);
+  m.erase("invalid");
+  ASSERT_EQ(m.size(), 2U);
+  m.erase(m.find("int2"));
+  ASSERT_EQ(m.size(), 1U);
+}
+
+TEST_F(FlatMetadataMapTest, Merge)
+{
+  MetadataMap m2;
+  m2.set("merge1", int32_t(12));
+  m2.set("merge2", int32_t(13));
+  m2.set("int1", int32_t(14));
+
+  m.merge(m2, "merge-");
+  ASSERT_EQ(m.size(), 6U);
+  ASSERT_TRUE(m.find("merge-merge1") != m.end());
+  ASSERT_TRUE(m.find("merge-merge2") != m.end());
+  ASSERT_EQ(m.get<int32_t>("merge-int1"), 14);
+  ASSERT_EQ(m.get<int32_t>("int1"), 82);
+
+  FlatMetadataMap m3;
+  m3.merge(m, "");
+  ASSERT_EQ(m, m3);
+}
+
+TEST_F(FlatMetadataMapTest, Flatten)
+{
+  // Vector flattening with suffix padding.
+
+  for (uint32_t i = 40; i >= 24; --i)
+    m.append("padtest", i);
+
+  ASSERT_EQ(m.size(), 4U);
+
+  FlatMetadataMap flat = m.flatten();
+  ASSERT_EQ(flat.size(), 22U);
+
+  std::ostringstream os;
+  os << flat;
+
+  std::string expected("int1 = 82\n"
+                       "int2 = 272\n"
+                       "padtest #01 = 40\n"
+                       "padtest #02 = 39\n"
+                       "padtest #03 = 38\n"
+                       "padtest #04 = 37\n"
+                       "padtest #05 = 36\n"
+                       "padtest #06 = 35\n"
+                       "padtest #07 = 34\n"
+                       "padtest #08 = 33\n"
+                       "padtest #09 = 32\n"
+                       "padtest #10 = 31\n"
+                       "padtest #11 = 30\n"
+                       "padtest #12 = 29\n"
+                       "padtest #13 = 28\n"
+                       "padtest #14 = 27\n"
+                       "padtest #15 = 26\n"
+                       "padtest #16 = 25\n"
+                       "padtest #17 = 24\n"
+                       "vector<string>1 #1 = s1\n"
+                       "vector<string>1 #2 = s2\n"
+                       "vector<string>1 #3 = s3\n");
+
+  ASSERT_EQ(os.str(), expected);
+}
+
+TEST_F(FlatMetadataMapTest, FlattenDuplicate)
+{
+  // A flattened element duplicating an existing key.
+  m.set("vector<string>1 #2", std::string("dup"));
+  m.append("vector<string>1 #1", std::string("sub"));
+
+  MetadataMap flat(m.toMetadataMap().flatten());
+  ASSERT_EQ(flat, m.flatten().toMetadataMap());
+}
+
+TEST_F(FlatMetadataMapTest, Clear)
+{
+  ASSERT_FALSE(m.empty());
+  m.clear();
+  ASSERT_TRUE(m.empty());
+  ASSERT_EQ(m.size(), 0U);
+}
+
+TEST_F(FlatMetadataMapTest, OperatorCompare)
+{
+  FlatMetadataMap l;
+  l.set("a", 1);
+
+  FlatMetadataMap g;
+  g.set("x", 23);
+
+  ASSERT_NE(l, m);
+  ASSERT_LT(l, m);
+  ASSERT_LE(l, m);
+  ASSERT_GT(m, l);
+  ASSERT_GE(m, l);
+
+  ASSERT_LT(m, g);
+  ASSERT_GT(g, m);
+}
+
+TEST_F(FlatMetadataMapTest, StreamOutput)
+{
+  std::ostringstream os;
+  os << m;
+
+  std::string expected("int1 = 82\n"
+                       "int2 = 272\n"
+                       "vector<string>1 #1 = s1\n"
+                       "vector<string>1 #2 = s2\n"
+                       "vector<string>1 #3 = s3\n");
+
+  ASSERT_EQ(os.str(), expected);
+}
+
+TEST(FlatMetadataMap, Convert)
+{
+  MetadataMap map(largeMap(1000U));
+  FlatMetadataMap flat(map);
+
+  ASSERT_EQ(map.size(), flat.size());
+  ASSERT_EQ(map.keys(), flat.keys());
+  ASSERT_EQ(map, flat.toMetadataMap());
+  ASSERT_EQ(map.flatten(), flat.flatten().toMetadataMap());
+
+  std::ostringstream mos;
+  mos << map;
+  std::ostringstream fos;
+  fos << flat;
+  ASSERT_EQ(mos.str(), fos.str());
+}
+
+TEST(FlatMetadataMap, Index)
+{
+  MetadataMap map(largeMap(1000U));
+  FlatMetadataMap flat(map);
+  ASSERT_TRUE(flat.indexed());
+
+  // Lookups are identical with and without the index.
+  for (int pass = 0; pass < 2; ++pass)
+    {
+      for (const auto& i : map)
+        {
+          FlatMetadataMap::const_iterator f = flat.find(i.first);
+          ASSERT_TRUE(f != flat.end());
+          ASSERT_EQ(i.first, f->first);
+          ASSERT_EQ(i.second, f->second);
+        }
+      ASSERT_TRUE(flat.find("key-1000") == flat.end());
+      ASSERT_TRUE(flat.find("") == flat.end());
+
+      // Replacing a value retains the index; inserting discards it.
+      flat.set("key-10", uint32_t(10));
+      ASSERT_EQ(pass == 0, flat.indexed());
+      flat.set("insert", uint32_t(1));
+      ASSERT_FALSE(flat.indexed());
+      flat.erase("insert");
+    }
+
+  flat.reindex();
+  ASSERT_TRUE(flat.indexed());
+  ASSERT_EQ(flat.get<uint32_t>("key-999"), 999U);
+}
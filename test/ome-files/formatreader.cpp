@@ -36,14 +36,18 @@
  * #L%
  */
 
+#include <algorithm>
+#include <cstring>
 #include <stdexcept>
 
 #include <ome/common/module.h>
 
 #include <ome/files/FormatReader.h>
 #include <ome/files/VariantPixelBuffer.h>
+#include <ome/files/PixelConversion.h>
 #include <ome/files/PixelProperties.h>
 #include <ome/files/detail/FormatReader.h>
+#include <ome/files/tiff/IOSource.h>
 
 #include <ome/xml/meta/MetadataStore.h>
 #include <ome/xml/meta/OMEXMLMetadata.h>
@@ -61,6 +65,7 @@
 using ome::files::CoreMetadata;
 using ome::files::EndianType;
 using ome::files::FormatReader;
+using ome::files::PixelConversion;
 using ome::files::VariantPixelBuffer;
 using ome::files::detail::ReaderProperties;
 using ome::files::MetadataMap;
@@ -269,8 +274,74 @@ public:
     ::ome::files::detail::FormatReader::readPlane(source, dest, x, y, w, h, scanlinePad, samples);
   }
 
+  void
+  readPlane(ome::files::tiff::IOSource& source,
+            uint64_t                    offset,
+            VariantPixelBuffer&         dest,
+            dimension_size_type         x,
+            dimension_size_type         y,
+            dimension_size_type         w,
+            dimension_size_type         h,
+            dimension_size_type         scanlinePad,
+            dimension_size_type         samples)
+  {
+    ::ome::files::detail::FormatReader::readPlane(source, offset, dest, x, y, w, h, scanlinePad, samples);
+  }
+
 };
 
+namespace
+{
+
+  // Source reading from memory, which may be presented as mapped.
+  class MemorySource : public ome::files::tiff::IOSource
+  {
+  public:
+    MemorySource(const std::string& content,
+                 bool               mapped):
+      content(content),
+      mapped(mapped),
+      reads(0U)
+    {}
+
+    std::string
+    name() const
+    {
+      return "memory";
+    }
+
+    uint64_t
+    size() const
+    {
+      return content.size();
+    }
+
+    std::size_t
+    read(uint64_t    offset,
+         void       *buffer,
+         std::size_t size)
+    {
+      ++reads;
+      if (offset >= content.size())
+        return 0U;
+      size = std::min(size, static_cast<std::size_t>(content.size() - offset));
+      std::memcpy(buffer, content.data() + offset, size);
+      return size;
+    }
+
+    const char *
+    data() const
+    {
+      return mapped ? content.data() : nullptr;
+    }
+
+    std::string content;
+    bool        mapped;
+    std::size_t reads;
+  };
+
+}
+
 class FormatReaderTest : public ::testing::TestWithParam<FormatReaderTestParameters>
 {
 public:
@@ -794,6 +865,36 @@ TEST_P(FormatReaderTest, SubresolutionUnflattenedSeries)
   EXPECT_TRUE(modcoords == modncoords);
 }
 
+TEST_P(FormatReaderTest, SubresolutionSeriesIndex)
+{
+  EXPECT_NO_THROW(r.setFlattenedResolutions(false));
+  r.setId("subres");
+
+  const dimension_size_type seriesStart[] = { 0U, 3U, 5U, 6U, 7U };
+  const dimension_size_type coreSeries[] = { 0U, 0U, 0U, 1U, 1U, 2U, 3U, 4U, 4U };
+  const dimension_size_type resolutions[] = { 3U, 2U, 1U, 1U, 2U };
+
+  ASSERT_EQ(5U, r.getSeriesCount());
+  for (dimension_size_type current = 0; current < 5U; ++current)
+    {
+      r.setSeries(current);
+      EXPECT_EQ(seriesStart[current], r.getCoreIndex());
+      EXPECT_EQ(resolutions[current], r.getResolutionCount());
+      for (dimension_size_type s = 0; s < 5U; ++s)
+        EXPECT_EQ(seriesStart[s], r.seriesToCoreIndex(s));
+      for (dimension_size_type c = 0; c < 9U; ++c)
+        EXPECT_EQ(coreSeries[c], r.coreIndexToSeries(c));
+    }
+
+  r.setSeries(1);
+  r.setResolution(1);
+  EXPECT_EQ(4U, r.getCoreIndex());
+  EXPECT_EQ(1U, r.coreIndexToSeries(r.getCoreIndex()));
+
+  EXPECT_THROW(r.seriesToCoreIndex(5U), std::logic_error);
+  EXPECT_THROW(r.coreIndexToSeries(9U), std::logic_error);
+}
+
 TEST_P(FormatReaderTest, DefaultGroupFiles)
 {
   EXPECT_TRUE(r.isGroupFiles());
@@ -947,6 +1048,17 @@ TEST_P(FormatReaderTest, FlatFile)
 
   // Valid but unused file
   EXPECT_FALSE(r.isUsedFile(sample_path / "2012-06/multi-channel-z-series-time-series.ome.xml"));
+
+  // Used files are cached, so repeated calls return the same list.
+  const std::vector<boost::filesystem::path>& used(r.getUsedFiles());
+  ASSERT_EQ(1U, used.size());
+  EXPECT_EQ(&used, &r.getUsedFiles());
+  EXPECT_EQ(used, r.getSeriesUsedFiles());
+  EXPECT_TRUE(r.getUsedFiles(true).empty());
+  EXPECT_TRUE(r.getSeriesUsedFiles(true).empty());
+  ASSERT_EQ(1U, r.getAdvancedUsedFiles().size());
+  EXPECT_EQ(used.front(), r.getAdvancedUsedFiles().front().filename);
+  EXPECT_EQ(1U, r.getAdvancedSeriesUsedFiles().size());
 }
 
 TEST_P(FormatReaderTest, DefaultMetadata)
@@ -1016,6 +1128,8 @@ TEST_P(FormatReaderTest, DefaultPixels)
   EXPECT_THROW(r.openBytes(0, buf), std::logic_error);
   EXPECT_THROW(r.openBytes(0, buf, 0, 0, 512, 512), std::logic_error);
   EXPECT_THROW(r.openThumbBytes(0, buf), std::logic_error);
+  EXPECT_THROW(r.openScaledBytes(0, buf, 0, 0, 512, 512, 64, 64), std::logic_error);
+  EXPECT_THROW(r.openConvertedBytes(0, buf, 0, 0, 512, 512, PT::FLOAT, PixelConversion()), std::logic_error);
 }
 
 namespace
@@ -1069,9 +1183,51 @@ namespace
       for (uint32_t i = 0; i < expected.size(); ++i)
         ASSERT_EQ(expected.at(i), *(buf.data<value_type>()+i));
 
+      // Reading from a positional source matches the stream, for
+      // whole planes and regions, with and without padding.
+      for (const bool mapped : {false, true})
+        {
+          MemorySource source("header" + ss.str(), mapped);
+          VariantPixelBuffer sbuf;
+          EXPECT_NO_THROW(reader.readPlane(source, 6U, sbuf, 0, 0, 512, 512, 0, 1));
+          EXPECT_EQ(buf, sbuf);
+          if (!mapped)
+            {
+              EXPECT_EQ(1U, source.reads);
+            }
+
+          for (dimension_size_type pad = 0; pad < 4; pad += 3)
+            {
+              VariantPixelBuffer region;
+              ss.clear();
+              ss.seekg(0, std::ios::beg);
+              EXPECT_NO_THROW(reader.readPlane(ss, region, 10, 20, 100, 50, pad, 1));
+              EXPECT_NO_THROW(reader.readPlane(source, 6U, sbuf, 10, 20, 100, 50, pad, 1));
+              EXPECT_EQ(region, sbuf);
+            }
+
+          EXPECT_THROW(reader.readPlane(source, 7U, sbuf, 0, 0, 512, 512, 0, 1), std::runtime_error);
+        }
+
       EXPECT_NO_THROW(reader.openBytes(0, buf));
       EXPECT_NO_THROW(reader.openBytes(0, buf, 0, 0, 512, 512));
-      EXPECT_THROW(reader.openThumbBytes(0, buf), std::runtime_error);
+      EXPECT_NO_THROW(reader.openThumbBytes(0, buf));
+      EXPECT_EQ(reader.getThumbSizeX(), buf.shape()[ome::files::DIM_SPATIAL_X]);
+      EXPECT_EQ(reader.getThumbSizeY(), buf.shape()[ome::files::DIM_SPATIAL_Y]);
+
+      EXPECT_NO_THROW(reader.openScaledBytes(0, buf, 0, 0, 512, 512, 64, 32));
+      EXPECT_EQ(64U, buf.shape()[ome::files::DIM_SPATIAL_X]);
+      EXPECT_EQ(32U, buf.shape()[ome::files::DIM_SPATIAL_Y]);
+      EXPECT_NO_THROW(reader.openScaledBytes(0, buf, 10, 20, 100, 50, 100, 50));
+      EXPECT_THROW(reader.openScaledBytes(0, buf, 0, 0, 64, 64, 128, 128), std::logic_error);
+      EXPECT_THROW(reader.openScaledBytes(0, buf, 500, 0, 64, 64, 32, 32), std::logic_error);
+
+      VariantPixelBuffer converted;
+      EXPECT_NO_THROW(reader.openConvertedBytes(0, converted, 0, 0, 512, 512, PT::DOUBLE, PixelConversion(0.5)));
+      EXPECT_EQ(PT::DOUBLE, converted.pixelType());
+      EXPECT_EQ(512U, converted.shape()[ome::files::DIM_SPATIAL_X]);
+      EXPECT_EQ(512U, converted.shape()[ome::files::DIM_SPATIAL_Y]);
+      EXPECT_THROW(reader.openConvertedBytes(0, converted, 500, 0, 64, 64, PT::DOUBLE, PixelConversion()), std::logic_error);
     }
   };
 
@@ -46,6 +46,8 @@
 #include <ome/test/test.h>
 
 using ome::files::dimension_size_type;
+using ome::files::DimensionIndexMapper;
+using ome::files::FixedDimensionIndexMapper;
 using ome::files::getIndex;
 using ome::files::getZCTCoords;
 using ome::xml::model::enums::DimensionOrder;
@@ -187,6 +189,123 @@ TEST_P(DimensionTest, GetModuloIndex)
                      params.modcoords[5]));
 }
 
+TEST_P(DimensionTest, Mapper)
+{
+  const DimensionTestParameters& params = GetParam();
+
+  DimensionIndexMapper mapper(params.order,
+                              params.sizes[0],
+                              params.sizes[1],
+                              params.sizes[2],
+                              params.modsizes[3],
+                              params.modsizes[4],
+                              params.modsizes[5],
+                              params.totalsize);
+
+  ASSERT_TRUE(mapper.matches(params.order,
+                             params.sizes[0],
+                             params.sizes[1],
+                             params.sizes[2],
+                             params.modsizes[3],
+                             params.modsizes[4],
+                             params.modsizes[5],
+                             params.totalsize));
+  ASSERT_FALSE(mapper.matches(params.order,
+                              params.sizes[0],
+                              params.sizes[1],
+                              params.sizes[2],
+                              1U, 1U, 1U,
+                              params.totalsize));
+
+  ASSERT_EQ(params.index,
+            mapper.getIndex(params.coords[0],
+                            params.coords[1],
+                            params.coords[2]));
+  ASSERT_EQ(params.index,
+            mapper.getIndex(params.modcoords[0],
+                            params.modcoords[1],
+                            params.modcoords[2],
+                            params.modcoords[3],
+                            params.modcoords[4],
+                            params.modcoords[5]));
+  ASSERT_EQ(params.coords, mapper.getZCTCoords(params.index));
+  ASSERT_EQ(params.modcoords, mapper.getZCTModuloCoords(params.index));
+
+  ASSERT_THROW(mapper.getIndex(params.sizes[0], 0, 0), std::out_of_range);
+  ASSERT_THROW(mapper.getIndex(0, params.sizes[1], 0), std::out_of_range);
+  ASSERT_THROW(mapper.getIndex(0, 0, params.sizes[2]), std::out_of_range);
+  ASSERT_THROW(mapper.getZCTCoords(params.totalsize), std::out_of_range);
+}
+
+namespace
+{
+
+  template<char D0, char D1, char D2>
+  void
+  checkFixedMapper(const DimensionTestParameters& params)
+  {
+    FixedDimensionIndexMapper<D0, D1, D2> mapper(params.sizes[0],
+                                                 params.sizes[1],
+                                                 params.sizes[2],
+                                                 params.modsizes[3],
+                                                 params.modsizes[4],
+                                                 params.modsizes[5],
+                                                 params.totalsize);
+
+    ASSERT_EQ(params.order, mapper.getMapper().getDimensionOrder());
+    ASSERT_EQ(params.index,
+              mapper.getIndex(params.coords[0],
+                              params.coords[1],
+                              params.coords[2]));
+    ASSERT_EQ(params.index,
+              mapper.getIndex(params.modcoords[0],
+                              params.modcoords[1],
+                              params.modcoords[2],
+                              params.modcoords[3],
+                              params.modcoords[4],
+                              params.modcoords[5]));
+    ASSERT_EQ(params.coords, mapper.getZCTCoords(params.index));
+    ASSERT_EQ(params.modcoords, mapper.getZCTModuloCoords(params.index));
+
+    ASSERT_THROW(mapper.getIndex(params.sizes[0], 0, 0), std::out_of_range);
+    ASSERT_THROW(mapper.getZCTCoords(params.totalsize), std::out_of_range);
+  }
+
+}
+
+TEST_P(DimensionTest, FixedMapper)
+{
+  const DimensionTestParameters& params = GetParam();
+
+  if (params.order == "XYZCT")
+    checkFixedMapper<'Z', 'C', 'T'>(params);
+  else if (params.order == "XYZTC")
+    checkFixedMapper<'Z', 'T', 'C'>(params);
+  else if (params.order == "XYCTZ")
+    checkFixedMapper<'C', 'T', 'Z'>(params);
+  else if (params.order == "XYCZT")
+    checkFixedMapper<'C', 'Z', 'T'>(params);
+  else if (params.order == "XYTCZ")
+    checkFixedMapper<'T', 'C', 'Z'>(params);
+  else if (params.order == "XYTZC")
+    checkFixedMapper<'T', 'Z', 'C'>(params);
+  else
+    FAIL() << "Unknown dimension order " << params.order;
+}
+
+TEST(DimensionIndexMapper, Invalid)
+{
+  DimensionIndexMapper empty;
+  ASSERT_EQ(0U, empty.getImageCount());
+  ASSERT_FALSE(empty.matches("", 0, 0, 0, 1, 1, 1, 0));
+
+  ASSERT_THROW(DimensionIndexMapper("XYZC", 2, 3, 4, 24), std::logic_error);
+  ASSERT_THROW(DimensionIndexMapper("ZCTXY", 2, 3, 4, 24), std::logic_error);
+  ASSERT_THROW(DimensionIndexMapper("XYZCT", 0, 3, 4, 0), std::out_of_range);
+  ASSERT_THROW(DimensionIndexMapper("XYZCT", 2, 3, 4, 25), std::logic_error);
+  ASSERT_THROW(DimensionIndexMapper("XYZCT", 2, 3, 4, 0, 1, 1, 24), std::out_of_range);
+}
+
 namespace
 {
 
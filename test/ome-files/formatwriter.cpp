@@ -514,6 +514,22 @@ TEST_P(FormatWriterTest, OutputCompression)
   EXPECT_EQ(std::string("rle"), w.getCompression().get());
 }
 
+TEST_P(FormatWriterTest, CompressionLevel)
+{
+  EXPECT_FALSE(w.getCompressionLevel());
+  EXPECT_NO_THROW(w.setCompressionLevel(6));
+  EXPECT_TRUE(!!w.getCompressionLevel());
+  EXPECT_EQ(6, w.getCompressionLevel().get());
+}
+
+TEST_P(FormatWriterTest, Predictor)
+{
+  EXPECT_FALSE(w.getPredictor());
+  EXPECT_NO_THROW(w.setPredictor(true));
+  EXPECT_TRUE(!!w.getPredictor());
+  EXPECT_TRUE(w.getPredictor().get());
+}
+
 TEST_P(FormatWriterTest, DefaultChangeOutputFile)
 {
   ASSERT_THROW(w.changeOutputFile("output2.test"), std::logic_error);
@@ -0,0 +1,163 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2014 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include <ome/files/Types.h>
+#include <ome/files/tiff/HalfFloat.h>
+
+#include <ome/test/test.h>
+
+using ome::files::dimension_size_type;
+using ome::files::tiff::floatToHalf;
+using ome::files::tiff::halfToFloat;
+
+namespace
+{
+
+  float
+  toFloat(uint16_t half)
+  {
+    float value;
+    halfToFloat(&half, &value, 1U);
+    return value;
+  }
+
+  uint16_t
+  toHalf(float value)
+  {
+    uint16_t half;
+    floatToHalf(&value, &half, 1U);
+    return half;
+  }
+
+  float
+  fromBits(uint32_t bits)
+  {
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+
+}
+
+TEST(HalfFloat, Values)
+{
+  EXPECT_EQ(0.0f, toFloat(0x0000U));
+  EXPECT_TRUE(std::signbit(toFloat(0x8000U)));
+  EXPECT_EQ(1.0f, toFloat(0x3C00U));
+  EXPECT_EQ(-2.0f, toFloat(0xC000U));
+  EXPECT_EQ(0.5f, toFloat(0x3800U));
+  EXPECT_EQ(65504.0f, toFloat(0x7BFFU));
+  EXPECT_EQ(std::ldexp(1.0f, -14), toFloat(0x0400U));
+  EXPECT_EQ(std::ldexp(1.0f, -24), toFloat(0x0001U));
+  EXPECT_EQ(std::ldexp(1023.0f, -24), toFloat(0x03FFU));
+  EXPECT_EQ(std::numeric_limits<float>::infinity(), toFloat(0x7C00U));
+  EXPECT_EQ(-std::numeric_limits<float>::infinity(), toFloat(0xFC00U));
+  EXPECT_TRUE(std::isnan(toFloat(0x7E00U)));
+  EXPECT_TRUE(std::isnan(toFloat(0x7C01U)));
+}
+
+TEST(HalfFloat, RoundTrip)
+{
+  // Every half precision value other than NaN converts exactly.
+  std::vector<uint16_t> half(65536U);
+  for (dimension_size_type i = 0; i < half.size(); ++i)
+    half[i] = static_cast<uint16_t>(i);
+  std::vector<float> single(half.size());
+  std::vector<uint16_t> observed(half.size());
+  halfToFloat(half.data(), single.data(), half.size());
+  floatToHalf(single.data(), observed.data(), single.size());
+
+  for (dimension_size_type i = 0; i < half.size(); ++i)
+    {
+      if (std::isnan(single[i]))
+        EXPECT_EQ(0x7C00U, observed[i] & 0x7C00U) << "half=" << i;
+      else
+        ASSERT_EQ(half[i], observed[i]) << "half=" << i;
+    }
+}
+
+TEST(HalfFloat, Rounding)
+{
+  // Ties to even.
+  EXPECT_EQ(0x3C00U, toHalf(fromBits(0x3F801000U)));
+  EXPECT_EQ(0x3C02U, toHalf(fromBits(0x3F803000U)));
+  EXPECT_EQ(0x3C01U, toHalf(fromBits(0x3F801001U)));
+  // Mantissa carry into the exponent.
+  EXPECT_EQ(0x4000U, toHalf(fromBits(0x3FFFF000U)));
+  // Overflow to infinity.
+  EXPECT_EQ(0x7BFFU, toHalf(65519.0f));
+  EXPECT_EQ(0x7C00U, toHalf(65520.0f));
+  EXPECT_EQ(0xFC00U, toHalf(-1.0e10f));
+  EXPECT_EQ(0x7C00U, toHalf(std::numeric_limits<float>::infinity()));
+  EXPECT_EQ(0x7E00U, toHalf(std::numeric_limits<float>::quiet_NaN()) & 0x7E00U);
+  // Subnormals and underflow.
+  EXPECT_EQ(0x0001U, toHalf(std::ldexp(1.0f, -24)));
+  EXPECT_EQ(0x0000U, toHalf(std::ldexp(1.0f, -25)));
+  EXPECT_EQ(0x0001U, toHalf(std::ldexp(1.5f, -25)));
+  EXPECT_EQ(0x0002U, toHalf(std::ldexp(3.0f, -25)));
+  EXPECT_EQ(0x0400U, toHalf(std::ldexp(2047.5f, -25)));
+  EXPECT_EQ(0x8000U, toHalf(-1.0e-10f));
+}
+
+TEST(HalfFloat, Counts)
+{
+  // Counts which are not a multiple of the vector width convert
+  // the trailing samples, and no more.
+  for (dimension_size_type count = 0; count <= 40; ++count)
+    {
+      std::vector<uint16_t> half(count + 1U, 0xFFFFU);
+      std::vector<float> single(count + 1U, -1.0f);
+      for (dimension_size_type i = 0; i < count; ++i)
+        single[i] = static_cast<float>(i) * 0.25f;
+
+      floatToHalf(single.data(), half.data(), count);
+      EXPECT_EQ(0xFFFFU, half[count]);
+
+      std::vector<float> observed(count + 1U, -1.0f);
+      halfToFloat(half.data(), observed.data(), count);
+      EXPECT_EQ(-1.0f, observed[count]);
+      for (dimension_size_type i = 0; i < count; ++i)
+        ASSERT_EQ(single[i], observed[i]) << "count=" << count << " i=" << i;
+    }
+}
@@ -0,0 +1,141 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2014 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <algorithm>
+#include <complex>
+#include <cstdint>
+#include <vector>
+
+#include <ome/files/Interleave.h>
+#include <ome/files/Types.h>
+
+#include <ome/test/test.h>
+
+using ome::files::dimension_size_type;
+using ome::files::interleave;
+using ome::files::deinterleave;
+
+namespace
+{
+
+  template<typename T>
+  std::vector<T>
+  pattern(dimension_size_type size)
+  {
+    std::vector<T> data(size);
+    uint32_t state = 12345U;
+    for (auto& value : data)
+      {
+        state = state * 1103515245U + 12345U;
+        value = static_cast<T>(state >> 16);
+      }
+    return data;
+  }
+
+  template<typename T>
+  void
+  check(dimension_size_type samples)
+  {
+    // Padded planes, to check the stride is used.
+    const dimension_size_type count = 67U;
+    const dimension_size_type stride = count + 5U;
+
+    std::vector<T> planar(pattern<T>(stride * samples));
+    std::vector<T> chunky(count * samples);
+    interleave(planar.data(), stride, samples, count, chunky.data());
+
+    for (dimension_size_type i = 0; i < count; ++i)
+      for (dimension_size_type s = 0; s < samples; ++s)
+        ASSERT_EQ(planar[(s * stride) + i], chunky[(i * samples) + s])
+          << "samples=" << samples << " i=" << i << " s=" << s;
+
+    std::vector<T> roundtrip(planar);
+    for (dimension_size_type s = 0; s < samples; ++s)
+      std::fill(roundtrip.begin() + static_cast<std::ptrdiff_t>(s * stride),
+                roundtrip.begin() + static_cast<std::ptrdiff_t>((s * stride) + count), T());
+    deinterleave(chunky.data(), samples, count, roundtrip.data(), stride);
+    ASSERT_EQ(planar, roundtrip) << "samples=" << samples;
+  }
+
+}
+
+TEST(Interleave, UInt8)
+{
+  for (dimension_size_type samples = 1; samples <= 6; ++samples)
+    check<uint8_t>(samples);
+}
+
+TEST(Interleave, UInt16)
+{
+  for (dimension_size_type samples = 1; samples <= 6; ++samples)
+    check<uint16_t>(samples);
+}
+
+TEST(Interleave, UInt32)
+{
+  for (dimension_size_type samples = 1; samples <= 6; ++samples)
+    check<uint32_t>(samples);
+}
+
+TEST(Interleave, Float)
+{
+  for (dimension_size_type samples = 1; samples <= 6; ++samples)
+    check<float>(samples);
+}
+
+TEST(Interleave, ComplexDouble)
+{
+  for (dimension_size_type samples = 1; samples <= 6; ++samples)
+    check<std::complex<double>>(samples);
+}
+
+TEST(Interleave, RoundTrip)
+{
+  // A 16-bit RGB 256×256 image.
+  const dimension_size_type count = 256U * 256U;
+  const dimension_size_type samples = 3U;
+  std::vector<uint16_t> planar(pattern<uint16_t>(count * samples));
+  std::vector<uint16_t> chunky(count * samples);
+  std::vector<uint16_t> roundtrip(count * samples);
+
+  interleave(planar.data(), count, samples, count, chunky.data());
+  for (dimension_size_type s = 0; s < samples; ++s)
+    ASSERT_EQ(planar[(s * count) + 1000U], chunky[(1000U * samples) + s]);
+  deinterleave(chunky.data(), samples, count, roundtrip.data(), count);
+  ASSERT_EQ(planar, roundtrip);
+}
@@ -0,0 +1,123 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <ome/files/IOStatistics.h>
+
+#include <ome/test/test.h>
+
+using ome::files::IOStatistics;
+
+TEST(IOStatistics, Construct)
+{
+  IOStatistics stats;
+
+  for (std::size_t i = 0; i < IOStatistics::counter_count; ++i)
+    EXPECT_EQ(0U, stats.get(static_cast<IOStatistics::Counter>(i)));
+  for (std::size_t i = 0; i < IOStatistics::stage_count; ++i)
+    EXPECT_EQ(0, stats.getTime(static_cast<IOStatistics::Stage>(i)).count());
+}
+
+TEST(IOStatistics, Counters)
+{
+  IOStatistics stats;
+
+  stats.add(IOStatistics::TILES_DECODED);
+  stats.add(IOStatistics::TILES_DECODED);
+  stats.add(IOStatistics::BYTES_READ, 4096U);
+  EXPECT_EQ(2U, stats.get(IOStatistics::TILES_DECODED));
+  EXPECT_EQ(4096U, stats.get(IOStatistics::BYTES_READ));
+  EXPECT_EQ(0U, stats.get(IOStatistics::BYTES_WRITTEN));
+
+  stats.reset();
+  EXPECT_EQ(0U, stats.get(IOStatistics::TILES_DECODED));
+  EXPECT_EQ(0U, stats.get(IOStatistics::BYTES_READ));
+}
+
+TEST(IOStatistics, Times)
+{
+  IOStatistics stats;
+
+  stats.addTime(IOStatistics::STAGE_DECODE, std::chrono::milliseconds(3));
+  stats.addTime(IOStatistics::STAGE_DECODE, std::chrono::milliseconds(2));
+  EXPECT_EQ(std::chrono::milliseconds(5), stats.getTime(IOStatistics::STAGE_DECODE));
+  EXPECT_EQ(0, stats.getTime(IOStatistics::STAGE_ENCODE).count());
+
+  {
+    IOStatistics::Timer timer(stats, IOStatistics::STAGE_READ);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_LE(std::chrono::milliseconds(1), stats.getTime(IOStatistics::STAGE_READ));
+
+  stats.reset();
+  EXPECT_EQ(0, stats.getTime(IOStatistics::STAGE_DECODE).count());
+}
+
+TEST(IOStatistics, Concurrent)
+{
+  IOStatistics stats;
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t)
+    threads.emplace_back([&stats]()
+                         {
+                           for (int i = 0; i < 10000; ++i)
+                             stats.add(IOStatistics::TILE_CACHE_HITS);
+                         });
+  for (auto& thread : threads)
+    thread.join();
+
+  EXPECT_EQ(40000U, stats.get(IOStatistics::TILE_CACHE_HITS));
+}
+
+TEST(IOStatistics, Output)
+{
+  IOStatistics stats;
+  stats.add(IOStatistics::DIRECTORY_SWITCHES, 3U);
+
+  std::ostringstream os;
+  os << stats;
+  for (std::size_t i = 0; i < IOStatistics::counter_count; ++i)
+    EXPECT_NE(std::string::npos, os.str().find(IOStatistics::name(static_cast<IOStatistics::Counter>(i))));
+  for (std::size_t i = 0; i < IOStatistics::stage_count; ++i)
+    EXPECT_NE(std::string::npos, os.str().find(IOStatistics::name(static_cast<IOStatistics::Stage>(i))));
+  EXPECT_NE(std::string::npos, os.str().find("directory switches: 3"));
+}
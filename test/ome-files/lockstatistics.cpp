@@ -0,0 +1,174 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+
+#include <algorithm>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <ome/files/LockStatistics.h>
+
+#include <ome/test/test.h>
+
+using ome::files::LockHistogram;
+using ome::files::LockSite;
+using ome::files::TimedLock;
+
+namespace
+{
+
+  // Enable lock timing for the lifetime of the object.
+  struct EnableTiming
+  {
+    EnableTiming()
+    {
+      LockSite::setEnabled(true);
+    }
+
+    ~EnableTiming()
+    {
+      LockSite::setEnabled(false);
+    }
+  };
+
+}
+
+TEST(LockHistogram, Buckets)
+{
+  LockHistogram histogram;
+  EXPECT_EQ(0U, histogram.count());
+  EXPECT_EQ(LockHistogram::duration_type::zero(), histogram.percentile(50.0));
+
+  histogram.add(LockHistogram::duration_type(0));
+  histogram.add(LockHistogram::duration_type(1));
+  histogram.add(LockHistogram::duration_type(2));
+  histogram.add(LockHistogram::duration_type(3));
+  histogram.add(LockHistogram::duration_type(1000));
+
+  EXPECT_EQ(5U, histogram.count());
+  EXPECT_EQ(LockHistogram::duration_type(1006), histogram.total());
+  EXPECT_EQ(2U, histogram.bucket(0));
+  EXPECT_EQ(2U, histogram.bucket(1));
+  EXPECT_EQ(1U, histogram.bucket(9));
+  EXPECT_EQ(LockHistogram::duration_type(4), histogram.percentile(50.0));
+  EXPECT_EQ(LockHistogram::duration_type(1024), histogram.percentile(99.0));
+
+  histogram.add(std::chrono::hours(10000));
+  EXPECT_EQ(1U, histogram.bucket(LockHistogram::bucket_count - 1U));
+  EXPECT_EQ(LockHistogram::duration_type::max(), histogram.percentile(100.0));
+
+  histogram.reset();
+  EXPECT_EQ(0U, histogram.count());
+  EXPECT_EQ(LockHistogram::duration_type::zero(), histogram.total());
+}
+
+TEST(LockSite, Register)
+{
+  std::vector<const LockSite *> before(LockSite::sites());
+  {
+    LockSite site("test::register");
+    EXPECT_STREQ("test::register", site.getName());
+    std::vector<const LockSite *> sites(LockSite::sites());
+    EXPECT_EQ(before.size() + 1U, sites.size());
+    EXPECT_NE(sites.end(), std::find(sites.begin(), sites.end(), &site));
+  }
+  EXPECT_EQ(before.size(), LockSite::sites().size());
+}
+
+TEST(LockSite, Disabled)
+{
+  LockSite site("test::disabled");
+  std::mutex mutex;
+  ASSERT_FALSE(LockSite::isEnabled());
+  {
+    TimedLock<std::mutex> lock(mutex, site);
+  }
+  EXPECT_EQ(0U, site.wait().count());
+  EXPECT_EQ(0U, site.hold().count());
+}
+
+TEST(LockSite, Contention)
+{
+  EnableTiming timing;
+  LockSite site("test::contention");
+  std::mutex mutex;
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t)
+    threads.emplace_back([&]()
+                         {
+                           for (int i = 0; i < 100; ++i)
+                             {
+                               TimedLock<std::mutex> lock(mutex, site);
+                               std::this_thread::sleep_for(std::chrono::microseconds(10));
+                             }
+                         });
+  for (auto& thread : threads)
+    thread.join();
+
+  EXPECT_EQ(400U, site.wait().count());
+  EXPECT_EQ(400U, site.hold().count());
+  EXPECT_LE(std::chrono::microseconds(4000), site.hold().total());
+  // Threads queue behind the sleeping holder.
+  EXPECT_LT(LockHistogram::duration_type::zero(), site.wait().total());
+
+  std::ostringstream os;
+  os << site;
+  EXPECT_EQ(0U, os.str().find("test::contention: wait count 400"));
+
+  LockSite::resetAll();
+  EXPECT_EQ(0U, site.wait().count());
+  EXPECT_EQ(0U, site.hold().count());
+}
+
+TEST(LockSite, RecursiveUnlock)
+{
+  EnableTiming timing;
+  LockSite site("test::recursive");
+  std::recursive_mutex mutex;
+  {
+    TimedLock<std::recursive_mutex> outer(mutex, site);
+    {
+      TimedLock<std::recursive_mutex> inner(mutex, site);
+    }
+    outer.unlock();
+  }
+  EXPECT_EQ(2U, site.wait().count());
+  EXPECT_EQ(2U, site.hold().count());
+}
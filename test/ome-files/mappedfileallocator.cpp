@@ -0,0 +1,195 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2014 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <array>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <vector>
+
+#include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/operations.hpp>
+
+#include <ome/files/CoreMetadata.h>
+#include <ome/files/MappedFileAllocator.h>
+#include <ome/files/MetadataTools.h>
+#include <ome/files/VariantPixelBuffer.h>
+#include <ome/files/in/OMETIFFReader.h>
+#include <ome/files/out/OMETIFFWriter.h>
+
+#include <ome/xml/meta/OMEXMLMetadata.h>
+
+#include <ome/test/test.h>
+
+using boost::filesystem::path;
+using ome::files::CoreMetadata;
+using ome::files::MappedFileAllocator;
+using ome::files::PixelAllocator;
+using ome::files::VariantPixelBuffer;
+using ome::files::dimension_size_type;
+using ome::files::in::OMETIFFReader;
+using ome::files::out::OMETIFFWriter;
+using ome::xml::model::enums::PixelType;
+
+namespace
+{
+
+  path
+  scratchDirectory()
+  {
+    path dir(PROJECT_BINARY_DIR "/test/ome-files/data/mappedfileallocator");
+    boost::filesystem::remove_all(dir);
+    boost::filesystem::create_directories(dir);
+    return dir;
+  }
+
+}
+
+TEST(MappedFileAllocator, Scratch)
+{
+  const path dir(scratchDirectory());
+  MappedFileAllocator allocator(dir);
+  EXPECT_EQ(MappedFileAllocator::SCRATCH, allocator.getMode());
+  EXPECT_EQ(dir, allocator.getPath());
+  EXPECT_TRUE(allocator.zeroInitialized());
+
+  const std::size_t size = 1024U * 1024U;
+  char *data = static_cast<char *>(allocator.allocate(size, 8U));
+  ASSERT_TRUE(data != nullptr);
+  EXPECT_EQ(0, data[0]);
+  EXPECT_EQ(0, data[size - 1]);
+  std::memset(data, 1, size);
+
+  char *other = static_cast<char *>(allocator.allocate(size, 8U));
+  EXPECT_NE(data, other);
+  EXPECT_EQ(0, other[0]);
+
+  allocator.deallocate(other, size, 8U);
+  allocator.deallocate(data, size, 8U);
+
+  // Scratch files are not retained.
+  EXPECT_TRUE(boost::filesystem::is_empty(dir));
+}
+
+TEST(MappedFileAllocator, Target)
+{
+  const path file(scratchDirectory() / "target.raw");
+  MappedFileAllocator allocator(file, MappedFileAllocator::TARGET);
+
+  const std::size_t size = 4096U;
+  char *data = static_cast<char *>(allocator.allocate(size, 8U));
+  EXPECT_THROW(allocator.allocate(size, 8U), std::logic_error);
+  std::memset(data, 7, size);
+  allocator.deallocate(data, size, 8U);
+
+  // The target file holds the data written.
+  ASSERT_TRUE(boost::filesystem::exists(file));
+  EXPECT_EQ(size, boost::filesystem::file_size(file));
+  boost::filesystem::ifstream in(file, std::ios::in | std::ios::binary);
+  char value = 0;
+  in.seekg(size - 1U);
+  in.get(value);
+  EXPECT_EQ(7, value);
+}
+
+TEST(MappedFileAllocator, Alignment)
+{
+  MappedFileAllocator allocator(scratchDirectory());
+  EXPECT_THROW(allocator.allocate(64U, 1024U * 1024U * 1024U), std::bad_alloc);
+}
+
+TEST(MappedFileAllocator, ReadWrite)
+{
+  const path dir(scratchDirectory());
+  const path file(dir / "mapped.ome.tiff");
+
+  std::shared_ptr<CoreMetadata> c(std::make_shared<CoreMetadata>());
+  c->sizeX = 512;
+  c->sizeY = 384;
+  c->sizeC.clear();
+  c->sizeC.push_back(1);
+  c->pixelType = PixelType::UINT16;
+  c->orderCertain = true;
+  c->interleaved = false;
+  std::vector<std::shared_ptr<CoreMetadata>> seriesList(1, c);
+
+  std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> meta(std::make_shared<::ome::xml::meta::OMEXMLMetadata>());
+  ome::files::fillMetadata(*meta, seriesList);
+
+  std::shared_ptr<PixelAllocator> allocator(std::make_shared<MappedFileAllocator>(dir));
+
+  // Save from a file-backed buffer.
+  {
+    std::array<VariantPixelBuffer::size_type, 9> shape;
+    shape.fill(1U);
+    shape[ome::files::DIM_SPATIAL_X] = 512;
+    shape[ome::files::DIM_SPATIAL_Y] = 384;
+    VariantPixelBuffer buf(allocator, shape, PixelType::UINT16);
+    uint16_t *data = buf.array<uint16_t>().data();
+    for (dimension_size_type i = 0U; i < buf.num_elements(); ++i)
+      ASSERT_EQ(0U, data[i]);
+    for (dimension_size_type i = 0U; i < buf.num_elements(); ++i)
+      data[i] = static_cast<uint16_t>(i * 3U);
+
+    OMETIFFWriter writer;
+    writer.setMetadataRetrieve(meta);
+    writer.setTileSizeX(128);
+    writer.setTileSizeY(128);
+    ASSERT_NO_THROW(writer.setId(file));
+    ASSERT_NO_THROW(writer.saveBytes(0U, buf));
+    ASSERT_NO_THROW(writer.close());
+  }
+
+  // Read into a file-backed buffer.
+  {
+    OMETIFFReader reader;
+    ASSERT_NO_THROW(reader.setId(file));
+    VariantPixelBuffer buf;
+    buf.setAllocator(allocator);
+    ASSERT_NO_THROW(reader.openBytes(0U, buf));
+    const uint16_t *data = buf.array<uint16_t>().data();
+    for (dimension_size_type i = 0U; i < buf.num_elements(); ++i)
+      ASSERT_EQ(static_cast<uint16_t>(i * 3U), data[i]);
+  }
+
+  // Only the OME-TIFF remains.
+  EXPECT_EQ(1, std::distance(boost::filesystem::directory_iterator(dir),
+                             boost::filesystem::directory_iterator()));
+}
@@ -0,0 +1,148 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2014 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <stdexcept>
+#include <string>
+
+#include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/filesystem/path.hpp>
+
+#include <ome/files/Memo.h>
+
+#include <ome/test/test.h>
+
+using boost::filesystem::path;
+using ome::files::MemoReader;
+using ome::files::MemoWriter;
+using ome::files::memoFile;
+
+namespace
+{
+
+  const std::string format("test 1");
+
+  path
+  memoDir()
+  {
+    path dir(PROJECT_BINARY_DIR "/test/ome-files/data/memo");
+    boost::filesystem::create_directories(dir);
+    return dir;
+  }
+
+  path
+  sourceFile(const std::string& content)
+  {
+    path file(memoDir() / "source.txt");
+    boost::filesystem::ofstream out(file);
+    out << content;
+    return file;
+  }
+
+}
+
+TEST(Memo, RoundTrip)
+{
+  path source(sourceFile("source data"));
+  path memo(memoFile(memoDir(), source));
+
+  {
+    MemoWriter writer(format);
+    writer.addSource(source);
+    writer.write(uint64_t(0U));
+    writer.write(uint64_t(18446744073709551615ULL));
+    writer.writeBool(true);
+    writer.writeBool(false);
+    writer.write(0.1);
+    writer.write(std::string());
+    writer.write(std::string("multi\nline\n"));
+    writer.save(memo);
+  }
+
+  MemoReader reader(memo, format);
+  ASSERT_EQ(1U, reader.getSources().size());
+  EXPECT_EQ(source, reader.getSources().at(0));
+  EXPECT_EQ(0U, reader.readUInt());
+  EXPECT_EQ(18446744073709551615ULL, reader.readUInt());
+  EXPECT_TRUE(reader.readBool());
+  EXPECT_FALSE(reader.readBool());
+  EXPECT_EQ(0.1, reader.readDouble());
+  EXPECT_EQ(std::string(), reader.readString());
+  EXPECT_EQ(std::string("multi\nline\n"), reader.readString());
+  EXPECT_THROW(reader.readUInt(), std::runtime_error);
+}
+
+TEST(Memo, WrongFormat)
+{
+  path source(sourceFile("source data"));
+  path memo(memoFile(memoDir(), source));
+
+  MemoWriter writer(format);
+  writer.addSource(source);
+  writer.save(memo);
+
+  EXPECT_NO_THROW(MemoReader(memo, format));
+  EXPECT_THROW(MemoReader(memo, "test 2"), std::runtime_error);
+  EXPECT_THROW(MemoReader(memoDir() / "missing.memo", format), std::runtime_error);
+}
+
+TEST(Memo, ModifiedSource)
+{
+  path source(sourceFile("source data"));
+  path memo(memoFile(memoDir(), source));
+
+  MemoWriter writer(format);
+  writer.addSource(source);
+  writer.save(memo);
+  EXPECT_NO_THROW(MemoReader(memo, format));
+
+  sourceFile("changed source data");
+  EXPECT_THROW(MemoReader(memo, format), std::runtime_error);
+
+  boost::filesystem::remove(source);
+  EXPECT_THROW(MemoReader(memo, format), std::runtime_error);
+}
+
+TEST(Memo, FileName)
+{
+  EXPECT_NE(memoFile("cache", "/a/image.ome.tiff"),
+            memoFile("cache", "/b/image.ome.tiff"));
+  EXPECT_EQ(memoFile("cache", "/a/image.ome.tiff"),
+            memoFile("cache", "/a/image.ome.tiff"));
+  EXPECT_EQ(path("cache"), memoFile("cache", "/a/image.ome.tiff").parent_path());
+}
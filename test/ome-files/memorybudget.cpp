@@ -0,0 +1,230 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+
+#include <algorithm>
+#include <limits>
+#include <map>
+
+#include <ome/files/DecodedTileCache.h>
+#include <ome/files/MemoryBudget.h>
+#include <ome/files/PixelAllocator.h>
+#include <ome/files/TileBuffer.h>
+#include <ome/files/TileCache.h>
+#include <ome/files/Types.h>
+
+#include <ome/test/test.h>
+
+using ome::files::dimension_size_type;
+using ome::files::DecodedTileCache;
+using ome::files::MemoryBudget;
+using ome::files::PixelAllocator;
+using ome::files::TileBuffer;
+using ome::files::TileCache;
+
+namespace
+{
+
+  DecodedTileCache::key_type
+  key(dimension_size_type tile)
+  {
+    return DecodedTileCache::key_type("test.tiff", 8U, tile);
+  }
+
+}
+
+TEST(MemoryBudget, Construct)
+{
+  MemoryBudget b;
+  EXPECT_EQ(0U, b.getLimit());
+  EXPECT_EQ(0U, b.getUsage());
+  EXPECT_FALSE(b.exceeded());
+  EXPECT_EQ(std::numeric_limits<dimension_size_type>::max(), b.available());
+}
+
+TEST(MemoryBudget, Account)
+{
+  MemoryBudget b(4096U);
+
+  std::shared_ptr<MemoryBudget::Account> a1(b.open("a"));
+  std::shared_ptr<MemoryBudget::Account> a2(b.open("a"));
+  std::shared_ptr<MemoryBudget::Account> a3(b.open("b"));
+  EXPECT_EQ(std::string("a"), a1->getComponent());
+
+  a1->increase(1024U);
+  a2->setUsage(512U);
+  a3->increase(2048U);
+  a3->decrease(1024U);
+  EXPECT_EQ(1024U, a3->getUsage());
+  EXPECT_EQ(2560U, b.getUsage());
+  EXPECT_EQ(1536U, b.available());
+
+  std::map<std::string, dimension_size_type> usage(b.getComponentUsage());
+  ASSERT_EQ(2U, usage.size());
+  EXPECT_EQ(1536U, usage["a"]);
+  EXPECT_EQ(1024U, usage["b"]);
+
+  // Use exceeding the limit is permitted but reported.
+  a3->increase(4096U);
+  EXPECT_TRUE(b.exceeded());
+  EXPECT_TRUE(a1->exceeded());
+  EXPECT_EQ(0U, b.available());
+
+  // Closing an account releases its use.
+  a3.reset();
+  EXPECT_EQ(1536U, b.getUsage());
+  EXPECT_FALSE(b.exceeded());
+
+  b.setLimit(0U);
+  EXPECT_EQ(0U, b.getLimit());
+}
+
+TEST(MemoryBudget, Reclaim)
+{
+  MemoryBudget b(4096U);
+
+  std::shared_ptr<MemoryBudget::Account> a1;
+  dimension_size_type calls = 0U;
+  a1 = b.open("reclaimable",
+              [&](dimension_size_type bytes)
+              {
+                ++calls;
+                dimension_size_type released = std::min(bytes, a1->getUsage());
+                a1->decrease(released);
+                return released;
+              });
+  std::shared_ptr<MemoryBudget::Account> a2(b.open("fixed"));
+
+  a1->increase(3072U);
+  EXPECT_EQ(0U, calls);
+
+  // Exceeding the limit reclaims from other accounts.
+  a2->increase(2048U);
+  EXPECT_EQ(1U, calls);
+  EXPECT_EQ(2048U, a1->getUsage());
+  EXPECT_EQ(4096U, b.getUsage());
+  EXPECT_FALSE(b.exceeded());
+
+  // Lowering the limit reclaims the excess.
+  b.setLimit(3072U);
+  EXPECT_EQ(2U, calls);
+  EXPECT_EQ(1024U, a1->getUsage());
+  EXPECT_EQ(3072U, b.getUsage());
+}
+
+TEST(MemoryBudget, Allocator)
+{
+  MemoryBudget b;
+  std::shared_ptr<PixelAllocator> alloc(b.allocator("buffers"));
+
+  void *p1 = alloc->allocate(1000U, 16U);
+  void *p2 = alloc->allocate(24U, 16U);
+  ASSERT_NE(nullptr, p1);
+  ASSERT_NE(nullptr, p2);
+  EXPECT_EQ(1024U, b.getUsage());
+  EXPECT_EQ(1024U, b.getComponentUsage()["buffers"]);
+
+  alloc->deallocate(p1, 1000U, 16U);
+  EXPECT_EQ(24U, b.getUsage());
+  alloc->deallocate(p2, 24U, 16U);
+  EXPECT_EQ(0U, b.getUsage());
+}
+
+TEST(MemoryBudget, DecodedTileCache)
+{
+  std::shared_ptr<MemoryBudget> b(std::make_shared<MemoryBudget>(8U * 8192U));
+  DecodedTileCache c;
+  c.setMemoryBudget(b);
+  EXPECT_EQ(b, c.getMemoryBudget());
+
+  for (dimension_size_type i = 0; i < 6; ++i)
+    c.insert(key(i), std::make_shared<TileBuffer>(8192));
+  EXPECT_EQ(6U * 8192U, b->getUsage());
+  EXPECT_EQ(6U * 8192U, b->getComponentUsage()["decoded tile cache"]);
+
+  // Use by another component reclaims least recently used tiles.
+  std::shared_ptr<MemoryBudget::Account> a(b->open("other"));
+  a->increase(4U * 8192U);
+  EXPECT_FALSE(b->exceeded());
+  EXPECT_EQ(4U, c.size());
+  EXPECT_FALSE(static_cast<bool>(c.find(key(0))));
+  EXPECT_FALSE(static_cast<bool>(c.find(key(1))));
+  EXPECT_TRUE(static_cast<bool>(c.find(key(5))));
+
+  // The cache itself stays within the budget.
+  for (dimension_size_type i = 6; i < 12; ++i)
+    c.insert(key(i), std::make_shared<TileBuffer>(8192));
+  EXPECT_FALSE(b->exceeded());
+  EXPECT_EQ(4U, c.size());
+
+  c.clear();
+  EXPECT_EQ(4U * 8192U, b->getUsage());
+  c.setMemoryBudget(std::shared_ptr<MemoryBudget>());
+  a.reset();
+  EXPECT_EQ(0U, b->getUsage());
+}
+
+TEST(MemoryBudget, TileCache)
+{
+  std::shared_ptr<MemoryBudget> b(std::make_shared<MemoryBudget>(4U * 1024U));
+  TileCache c;
+  c.setMemoryBudget(b);
+  EXPECT_EQ(b, c.getMemoryBudget());
+
+  for (dimension_size_type i = 0; i < 16; ++i)
+    {
+      std::shared_ptr<TileBuffer> buf(std::make_shared<TileBuffer>(1024U));
+      std::fill(buf->data(), buf->data() + buf->size(), static_cast<uint8_t>(i));
+      ASSERT_TRUE(c.insert(i, buf));
+      EXPECT_FALSE(b->exceeded());
+    }
+
+  ASSERT_EQ(16U, c.size());
+  EXPECT_EQ(12U, c.spilled());
+  EXPECT_EQ(c.memory(), b->getComponentUsage()["tile cache"]);
+
+  for (dimension_size_type i = 0; i < 16; ++i)
+    {
+      TileCache::value_type buf(c.find(i));
+      ASSERT_TRUE(static_cast<bool>(buf));
+      EXPECT_EQ(static_cast<uint8_t>(i), buf->data()[0]);
+      EXPECT_FALSE(b->exceeded());
+    }
+
+  c.clear();
+  EXPECT_EQ(0U, b->getUsage());
+}
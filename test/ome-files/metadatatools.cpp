@@ -64,6 +64,9 @@ using ome::files::dimension_size_type;
 using ome::files::createID;
 using ome::files::createDimensionOrder;
 using ome::files::createOMEXMLMetadata;
+using ome::files::createTiffDataMetadata;
+using ome::files::setOMEXMLValidation;
+using ome::files::OMEXMLValidation;
 using ome::files::validateModel;
 using ome::files::FormatException;
 using ome::xml::model::enums::DimensionOrder;
@@ -669,6 +672,130 @@ TEST_P(ModelTest, CreateMetadataFromString)
   ASSERT_NO_THROW(meta = createOMEXMLMetadata(input));
 }
 
+TEST_P(ModelTest, CreateMetadataValidationPolicy)
+{
+  const ModelTestParameters& params = GetParam();
+
+  std::string input;
+  readFile(params.file, input);
+
+  std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> strict;
+  ASSERT_NO_THROW(strict = createOMEXMLMetadata(input));
+
+  const std::vector<OMEXMLValidation> policies
+    {
+      ome::files::VALIDATE_IF_CHEAP,
+      ome::files::VALIDATE_NEVER
+    };
+
+  for (const auto& policy : policies)
+    {
+      setOMEXMLValidation(policy);
+      std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> meta;
+      EXPECT_NO_THROW(meta = createOMEXMLMetadata(input));
+      setOMEXMLValidation(ome::files::VALIDATE_STRICT);
+      ASSERT_TRUE(static_cast<bool>(meta));
+      ASSERT_EQ(strict->getImageCount(), meta->getImageCount());
+      for (dimension_size_type i = 0; i < strict->getImageCount(); ++i)
+        {
+          EXPECT_EQ(strict->getImageID(i), meta->getImageID(i));
+          EXPECT_EQ(strict->getPixelsSizeX(i), meta->getPixelsSizeX(i));
+          EXPECT_EQ(strict->getPixelsSizeY(i), meta->getPixelsSizeY(i));
+        }
+    }
+  ASSERT_EQ(ome::files::VALIDATE_STRICT, ome::files::getOMEXMLValidation());
+}
+
+TEST_P(ModelTest, CreateTiffDataMetadataFromString)
+{
+  const ModelTestParameters& params = GetParam();
+
+  std::string input;
+  readFile(params.file, input);
+
+  std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> partial;
+  ASSERT_NO_THROW(partial = createTiffDataMetadata(input));
+  if (!partial)
+    return; // Complete model required.
+
+  std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> meta;
+  ASSERT_NO_THROW(meta = createOMEXMLMetadata(input));
+
+  ASSERT_EQ(meta->getImageCount(), partial->getImageCount());
+  ASSERT_EQ(meta->getPlateCount(), partial->getPlateCount());
+  for (dimension_size_type i = 0; i < meta->getImageCount(); ++i)
+    {
+      EXPECT_EQ(meta->getImageID(i), partial->getImageID(i));
+      EXPECT_EQ(meta->getPixelsID(i), partial->getPixelsID(i));
+      EXPECT_EQ(meta->getPixelsDimensionOrder(i), partial->getPixelsDimensionOrder(i));
+      EXPECT_EQ(meta->getPixelsType(i), partial->getPixelsType(i));
+      EXPECT_EQ(meta->getPixelsSizeX(i), partial->getPixelsSizeX(i));
+      EXPECT_EQ(meta->getPixelsSizeY(i), partial->getPixelsSizeY(i));
+      EXPECT_EQ(meta->getPixelsSizeZ(i), partial->getPixelsSizeZ(i));
+      EXPECT_EQ(meta->getPixelsSizeC(i), partial->getPixelsSizeC(i));
+      EXPECT_EQ(meta->getPixelsSizeT(i), partial->getPixelsSizeT(i));
+
+      ASSERT_EQ(meta->getChannelCount(i), partial->getChannelCount(i));
+      for (dimension_size_type c = 0; c < meta->getChannelCount(i); ++c)
+        EXPECT_EQ(meta->getChannelID(i, c), partial->getChannelID(i, c));
+
+      ASSERT_EQ(meta->getTiffDataCount(i), partial->getTiffDataCount(i));
+      for (dimension_size_type t = 0; t < meta->getTiffDataCount(i); ++t)
+        {
+          EXPECT_EQ(meta->getTiffDataIFD(i, t), partial->getTiffDataIFD(i, t));
+          try
+            {
+              EXPECT_EQ(meta->getTiffDataPlaneCount(i, t), partial->getTiffDataPlaneCount(i, t));
+            }
+          catch (const std::exception&)
+            {
+              EXPECT_THROW(partial->getTiffDataPlaneCount(i, t), std::exception);
+            }
+        }
+    }
+}
+
+TEST(MetadataToolsTest, CreateTiffDataMetadataOldSchema)
+{
+  std::string xml;
+  boost::filesystem::path sample_path(ome::common::module_runtime_path("ome-xml-sample"));
+
+  readFile(sample_path / "2012-06/multi-channel-z-series-time-series.ome.xml", xml);
+
+  // Requires upgrading, so the partial model can't be used.
+  ASSERT_FALSE(createTiffDataMetadata(xml));
+}
+
+TEST(MetadataToolsTest, CreateTiffDataMetadataAnnotations)
+{
+  std::string xml(std::string("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                              "<OME xmlns=\"http://www.openmicroscopy.org/Schemas/OME/")
+                  + OME_XML_MODEL_VERSION + "\">"
+                  "<Image ID=\"Image:0\"><Pixels ID=\"Pixels:0\" DimensionOrder=\"XYZTC\""
+                  " Type=\"uint8\" SizeX=\"4\" SizeY=\"4\" SizeZ=\"2\" SizeC=\"1\" SizeT=\"1\">"
+                  "<Channel ID=\"Channel:0:0\" SamplesPerPixel=\"1\"/>"
+                  "<TiffData IFD=\"1\" PlaneCount=\"2\"><UUID FileName=\"a.ome.tif\">urn:uuid:1</UUID></TiffData>"
+                  "</Pixels></Image>");
+
+  std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> partial(createTiffDataMetadata(xml + "</OME>"));
+  ASSERT_TRUE(partial);
+  ASSERT_EQ(1U, partial->getImageCount());
+  EXPECT_EQ(PositiveInteger(2U), partial->getPixelsSizeZ(0));
+  ASSERT_EQ(1U, partial->getTiffDataCount(0));
+  EXPECT_EQ(NonNegativeInteger(1U), partial->getTiffDataIFD(0, 0));
+  EXPECT_EQ(NonNegativeInteger(2U), partial->getTiffDataPlaneCount(0, 0));
+  EXPECT_EQ(std::string("a.ome.tif"), partial->getUUIDFileName(0, 0));
+  EXPECT_EQ(std::string("urn:uuid:1"), partial->getUUIDValue(0, 0));
+
+  // XMLAnnotations may contain Modulo annotations and original
+  // metadata, which require the complete model.
+  ASSERT_FALSE(createTiffDataMetadata(xml +
+                                      "<StructuredAnnotations><XMLAnnotation ID=\"Annotation:0\">"
+                                      "<Value/></XMLAnnotation></StructuredAnnotations></OME>"));
+  // Not well formed.
+  ASSERT_FALSE(createTiffDataMetadata(xml));
+}
+
 // Disable missing-prototypes warning for INSTANTIATE_TEST_CASE_P;
 // this is solely to work around a missing prototype in gtest.
 #ifdef __GNUC__
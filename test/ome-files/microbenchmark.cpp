@@ -0,0 +1,660 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2016 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+
+
+// Microbenchmarks of core data structures.  Each benchmark times a
+// single operation on a hot path (pixel buffer access, tile
+// coverage, tile caching, metadata lookup, dimension index
+// conversion, sample packing, interleaving and byte swapping) in
+// isolation.  The iteration count is calibrated to
+// run for a minimum time, and the timing is repeated; the median and
+// minimum time per operation are written as CSV so that runs may be
+// compared between revisions.
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include <ome/files/ByteSwap.h>
+#include <ome/files/FormatTools.h>
+#include <ome/files/Interleave.h>
+#include <ome/files/MetadataMap.h>
+#include <ome/files/PixelBuffer.h>
+#include <ome/files/PlaneRegion.h>
+#include <ome/files/TileBuffer.h>
+#include <ome/files/TileCache.h>
+#include <ome/files/TileCoverage.h>
+#include <ome/files/VariantPixelBuffer.h>
+#include <ome/files/tiff/BitPack.h>
+
+namespace opt = boost::program_options;
+
+using ome::files::dimension_size_type;
+using ome::files::DimensionIndexMapper;
+using ome::files::MetadataMap;
+using ome::files::PixelBuffer;
+using ome::files::PlaneRegion;
+using ome::files::TileBuffer;
+using ome::files::TileCache;
+using ome::files::TileCoverage;
+using ome::files::VariantPixelBuffer;
+using ome::xml::model::enums::PixelType;
+
+namespace
+{
+
+  // Benchmark settings.
+  struct Settings
+  {
+    double             mintime;
+    unsigned int       repetitions;
+    std::string        filter;
+  };
+
+  // Results are accumulated here to prevent the compiler from
+  // removing the benchmarked operations.
+  volatile uint64_t sink = 0U;
+
+  // A benchmark body, which performs an operation the given number
+  // of times.
+  typedef std::function<void (uint64_t iterations)> body_type;
+
+  // Time a number of iterations of a benchmark body, in seconds.
+  double
+  timeIterations(const body_type& body,
+                 uint64_t         iterations)
+  {
+    auto start = std::chrono::steady_clock::now();
+    body(iterations);
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+  }
+
+  // Run a benchmark and write a CSV result row.
+  void
+  benchmark(std::ostream&      csv,
+            const Settings&    settings,
+            const std::string& name,
+            const body_type&   body)
+  {
+    if (!settings.filter.empty() && name.find(settings.filter) == std::string::npos)
+      return;
+
+    // Calibrate the iteration count to run for the minimum time.
+    uint64_t iterations = 1U;
+    for (;;)
+      {
+        double seconds = timeIterations(body, iterations);
+        if (seconds >= settings.mintime || iterations >= (UINT64_C(1) << 40))
+          break;
+        double scale = seconds > 0.0 ? (settings.mintime * 1.2) / seconds : 10.0;
+        iterations = static_cast<uint64_t>(static_cast<double>(iterations) * std::min(std::max(scale, 2.0), 10.0));
+      }
+
+    std::vector<double> nsperop;
+    for (unsigned int r = 0U; r < settings.repetitions; ++r)
+      nsperop.push_back(timeIterations(body, iterations) * 1.0e9 / static_cast<double>(iterations));
+    std::sort(nsperop.begin(), nsperop.end());
+
+    csv << name << ','
+        << iterations << ','
+        << settings.repetitions << ','
+        << nsperop[nsperop.size() / 2U] << ','
+        << nsperop.front() << '\n';
+    csv.flush();
+  }
+
+  std::array<VariantPixelBuffer::size_type, 9>
+  planeShape(dimension_size_type size)
+  {
+    std::array<VariantPixelBuffer::size_type, 9> shape;
+    shape.fill(1U);
+    shape[ome::files::DIM_SPATIAL_X] = shape[ome::files::DIM_SPATIAL_Y] = size;
+    return shape;
+  }
+
+  // Sum all pixel values of a buffer.
+  struct SumVisitor : public boost::static_visitor<uint64_t>
+  {
+    template<typename T>
+    uint64_t
+    operator() (const std::shared_ptr<T>& buf) const
+    {
+      typedef typename T::value_type value_type;
+
+      const value_type *data = buf->data();
+      uint64_t sum = 0U;
+      for (VariantPixelBuffer::size_type i = 0; i < buf->num_elements(); ++i)
+        sum += static_cast<uint64_t>(data[i]);
+      return sum;
+    }
+  };
+
+  void
+  pixelBufferBenchmarks(std::ostream&   csv,
+                        const Settings& settings)
+  {
+    for (const dimension_size_type size : {64U, 512U})
+      {
+        const std::string suffix(std::string("/uint16/") + std::to_string(size));
+
+        benchmark(csv, settings, "PixelBuffer/construct" + suffix,
+                  [size](uint64_t iterations)
+                  {
+                    for (uint64_t i = 0U; i < iterations; ++i)
+                      {
+                        PixelBuffer<uint16_t> buf(planeShape(size), PixelType::UINT16);
+                        sink += buf.num_elements();
+                      }
+                  });
+
+        benchmark(csv, settings, "VariantPixelBuffer/construct" + suffix,
+                  [size](uint64_t iterations)
+                  {
+                    for (uint64_t i = 0U; i < iterations; ++i)
+                      {
+                        VariantPixelBuffer buf(planeShape(size), PixelType::UINT16);
+                        sink += buf.num_elements();
+                      }
+                  });
+
+        VariantPixelBuffer src(planeShape(size), PixelType::UINT16);
+        std::fill(src.array<uint16_t>().data(),
+                  src.array<uint16_t>().data() + src.num_elements(), 7U);
+        VariantPixelBuffer dest(planeShape(size), PixelType::UINT16);
+
+        benchmark(csv, settings, "VariantPixelBuffer/visit" + suffix,
+                  [&src](uint64_t iterations)
+                  {
+                    SumVisitor v;
+                    for (uint64_t i = 0U; i < iterations; ++i)
+                      sink += boost::apply_visitor(v, src.vbuffer());
+                  });
+
+        benchmark(csv, settings, "VariantPixelBuffer/assign" + suffix,
+                  [&src, &dest](uint64_t iterations)
+                  {
+                    for (uint64_t i = 0U; i < iterations; ++i)
+                      {
+                        dest = src;
+                        sink += dest.num_elements();
+                      }
+                  });
+      }
+
+    PixelBuffer<uint16_t> buf(planeShape(256U), PixelType::UINT16);
+    benchmark(csv, settings, "PixelBuffer/at/uint16/256",
+              [&buf](uint64_t iterations)
+              {
+                PixelBuffer<uint16_t>::indices_type idx;
+                idx.fill(0);
+                uint64_t sum = 0U;
+                for (uint64_t i = 0U; i < iterations; ++i)
+                  {
+                    idx[ome::files::DIM_SPATIAL_X] = static_cast<PixelBuffer<uint16_t>::index>(i & 0xFFU);
+                    idx[ome::files::DIM_SPATIAL_Y] = static_cast<PixelBuffer<uint16_t>::index>((i >> 8U) & 0xFFU);
+                    sum += buf.at(idx);
+                  }
+                sink += sum;
+              });
+  }
+
+  void
+  tileCoverageBenchmarks(std::ostream&   csv,
+                         const Settings& settings)
+  {
+    // 16×16 grid of 256×256 tiles.
+    const dimension_size_type tiles = 16U;
+    const dimension_size_type tilesize = 256U;
+
+    benchmark(csv, settings, "TileCoverage/insert",
+              [=](uint64_t iterations)
+              {
+                TileCoverage coverage;
+                coverage.setGrid(tiles * tilesize, tiles * tilesize, tilesize, tilesize);
+                for (uint64_t i = 0U; i < iterations; ++i)
+                  {
+                    const dimension_size_type tile = i % (tiles * tiles);
+                    if (tile == 0U)
+                      coverage.clear();
+                    coverage.insert(PlaneRegion((tile % tiles) * tilesize, (tile / tiles) * tilesize,
+                                                tilesize, tilesize));
+                  }
+                sink += coverage.size();
+              });
+
+    // Half of the tiles, in a checkerboard pattern.
+    TileCoverage checker;
+    checker.setGrid(tiles * tilesize, tiles * tilesize, tilesize, tilesize);
+    for (dimension_size_type tile = 0U; tile < tiles * tiles; ++tile)
+      if (((tile % tiles) + (tile / tiles)) % 2U == 0U)
+        checker.insert(PlaneRegion((tile % tiles) * tilesize, (tile / tiles) * tilesize,
+                                   tilesize, tilesize));
+
+    benchmark(csv, settings, "TileCoverage/covered",
+              [&](uint64_t iterations)
+              {
+                uint64_t count = 0U;
+                for (uint64_t i = 0U; i < iterations; ++i)
+                  {
+                    const dimension_size_type tile = i % (tiles * tiles);
+                    count += checker.covered(PlaneRegion((tile % tiles) * tilesize, (tile / tiles) * tilesize,
+                                                         tilesize, tilesize));
+                  }
+                sink += count;
+              });
+
+    benchmark(csv, settings, "TileCoverage/coverage",
+              [&](uint64_t iterations)
+              {
+                uint64_t area = 0U;
+                for (uint64_t i = 0U; i < iterations; ++i)
+                  {
+                    const dimension_size_type offset = (i % tiles) * (tilesize / 2U);
+                    area += checker.coverage(PlaneRegion(offset, offset, tilesize * 4U, tilesize * 4U));
+                  }
+                sink += area;
+              });
+  }
+
+  void
+  tileCacheBenchmarks(std::ostream&   csv,
+                      const Settings& settings)
+  {
+    const dimension_size_type count = 256U;
+
+    std::vector<std::shared_ptr<TileBuffer>> buffers;
+    for (dimension_size_type t = 0U; t < count; ++t)
+      buffers.push_back(std::make_shared<TileBuffer>(4096U));
+
+    benchmark(csv, settings, "TileCache/insert-erase",
+              [&](uint64_t iterations)
+              {
+                TileCache cache;
+                for (uint64_t i = 0U; i < iterations; ++i)
+                  {
+                    const dimension_size_type tile = i % count;
+                    cache.insert(tile, buffers[tile]);
+                    cache.erase(tile);
+                  }
+                sink += cache.size();
+              });
+
+    TileCache full;
+    for (dimension_size_type t = 0U; t < count; ++t)
+      full.insert(t, buffers[t]);
+
+    benchmark(csv, settings, "TileCache/find",
+              [&](uint64_t iterations)
+              {
+                uint64_t found = 0U;
+                for (uint64_t i = 0U; i < iterations; ++i)
+                  found += static_cast<bool>(full.find((i * 7U) % (count * 2U)));
+                sink += found;
+              });
+
+    // Touch, look up and flush each tile in order, as done by the
+    // writer for a whole image, keeping one row of 512 tiles live;
+    // compared against an ordered map holding the same tiles.
+    const dimension_size_type row = 512U;
+
+    benchmark(csv, settings, "TileCache/write-pattern",
+              [&](uint64_t iterations)
+              {
+                TileCache cache;
+                uint64_t found = 0U;
+                for (uint64_t i = 0U; i < iterations; ++i)
+                  {
+                    if (!cache.find(i))
+                      cache.insert(i, buffers[i % count]);
+                    for (int r = 0; r < 4; ++r)
+                      found += static_cast<bool>(cache.find(i));
+                    if (i >= row)
+                      cache.erase(i - row);
+                  }
+                sink += found + cache.size();
+              });
+
+    typedef std::map<TileCache::key_type, TileCache::value_type> map_type;
+
+    benchmark(csv, settings, "TileCache/write-pattern-std-map",
+              [&](uint64_t iterations)
+              {
+                map_type cache;
+                uint64_t found = 0U;
+                for (uint64_t i = 0U; i < iterations; ++i)
+                  {
+                    if (cache.find(i) == cache.end())
+                      cache.insert(std::make_pair(i, buffers[i % count]));
+                    for (int r = 0; r < 4; ++r)
+                      {
+                        map_type::const_iterator f = cache.find(i);
+                        found += (f != cache.end() && f->second);
+                      }
+                    if (i >= row)
+                      cache.erase(i - row);
+                  }
+                sink += found + cache.size();
+              });
+  }
+
+  void
+  metadataMapBenchmarks(std::ostream&   csv,
+                        const Settings& settings)
+  {
+    const dimension_size_type count = 1024U;
+
+    std::vector<std::string> keys;
+    for (dimension_size_type k = 0U; k < count; ++k)
+      keys.push_back("Series 0 Acquisition Parameter " + std::to_string(k));
+
+    benchmark(csv, settings, "MetadataMap/set",
+              [&](uint64_t iterations)
+              {
+                MetadataMap map;
+                for (uint64_t i = 0U; i < iterations; ++i)
+                  map.set(keys[i % count], static_cast<int32_t>(i));
+                sink += map.size();
+              });
+
+    MetadataMap full;
+    for (dimension_size_type k = 0U; k < count; ++k)
+      full.set(keys[k], static_cast<int32_t>(k));
+
+    benchmark(csv, settings, "MetadataMap/get",
+              [&](uint64_t iterations)
+              {
+                int64_t sum = 0;
+                for (uint64_t i = 0U; i < iterations; ++i)
+                  sum += full.get<int32_t>(keys[(i * 7U) % count]);
+                sink += static_cast<uint64_t>(sum);
+              });
+  }
+
+  void
+  formatToolsBenchmarks(std::ostream&   csv,
+                        const Settings& settings)
+  {
+    const dimension_size_type sizeZ = 16U;
+    const dimension_size_type sizeC = 4U;
+    const dimension_size_type sizeT = 32U;
+    const dimension_size_type planes = sizeZ * sizeC * sizeT;
+
+    benchmark(csv, settings, "FormatTools/getIndex",
+              [=](uint64_t iterations)
+              {
+                uint64_t sum = 0U;
+                for (uint64_t i = 0U; i < iterations; ++i)
+                  {
+                    const dimension_size_type p = i % planes;
+                    sum += ome::files::getIndex("XYZCT", sizeZ, sizeC, sizeT, planes,
+                                                p % sizeZ, (p / sizeZ) % sizeC, p / (sizeZ * sizeC));
+                  }
+                sink += sum;
+              });
+
+    benchmark(csv, settings, "FormatTools/getZCTCoords",
+              [=](uint64_t iterations)
+              {
+                uint64_t sum = 0U;
+                for (uint64_t i = 0U; i < iterations; ++i)
+                  {
+                    std::array<dimension_size_type, 3> zct
+                      (ome::files::getZCTCoords("XYZCT", sizeZ, sizeC, sizeT, planes, i % planes));
+                    sum += zct[0] + zct[1] + zct[2];
+                  }
+                sink += sum;
+              });
+
+    const DimensionIndexMapper mapper("XYZCT", sizeZ, sizeC, sizeT, planes);
+
+    benchmark(csv, settings, "DimensionIndexMapper/getIndex",
+              [&](uint64_t iterations)
+              {
+                uint64_t sum = 0U;
+                for (uint64_t i = 0U; i < iterations; ++i)
+                  {
+                    const dimension_size_type p = i % planes;
+                    sum += mapper.getIndex(p % sizeZ, (p / sizeZ) % sizeC, p / (sizeZ * sizeC));
+                  }
+                sink += sum;
+              });
+
+    benchmark(csv, settings, "DimensionIndexMapper/getZCTCoords",
+              [&](uint64_t iterations)
+              {
+                uint64_t sum = 0U;
+                for (uint64_t i = 0U; i < iterations; ++i)
+                  {
+                    std::array<dimension_size_type, 3> zct(mapper.getZCTCoords(i % planes));
+                    sum += zct[0] + zct[1] + zct[2];
+                  }
+                sink += sum;
+              });
+  }
+
+  // Pseudo-random bytes.
+  std::vector<uint8_t>
+  pattern(dimension_size_type size)
+  {
+    std::vector<uint8_t> data(size);
+    uint32_t state = 12345U;
+    for (auto& byte : data)
+      {
+        state = state * 1103515245U + 12345U;
+        byte = static_cast<uint8_t>(state >> 16);
+      }
+    return data;
+  }
+
+  void
+  bitPackBenchmarks(std::ostream&   csv,
+                    const Settings& settings)
+  {
+    // One row of a 50000 pixel wide bilevel image, at each bit
+    // offset in turn.
+    const dimension_size_type width = 50000U;
+    std::vector<uint8_t> bits(pattern((width + 7U) / 8U + 1U));
+    std::unique_ptr<bool[]> samples(new bool[width]);
+    ome::files::tiff::unpackBits(bits.data(), 0U, samples.get(), width);
+    std::vector<uint8_t> packed(bits.size());
+
+    benchmark(csv, settings, "BitPack/unpackBits/50000",
+              [&](uint64_t iterations)
+              {
+                for (uint64_t i = 0U; i < iterations; ++i)
+                  {
+                    ome::files::tiff::unpackBits(bits.data(), i % 8U, samples.get(), width);
+                    sink += samples[i % width];
+                  }
+              });
+
+    benchmark(csv, settings, "BitPack/packBits/50000",
+              [&](uint64_t iterations)
+              {
+                for (uint64_t i = 0U; i < iterations; ++i)
+                  {
+                    std::fill(packed.begin(), packed.end(), 0U);
+                    ome::files::tiff::packBits(samples.get(), width, packed.data(), i % 8U);
+                    sink += packed[i % packed.size()];
+                  }
+              });
+  }
+
+  void
+  interleaveBenchmarks(std::ostream&   csv,
+                       const Settings& settings)
+  {
+    // A 16-bit RGB 2048×2048 image.
+    const dimension_size_type count = 2048U * 2048U;
+    const dimension_size_type samples = 3U;
+    std::vector<uint16_t> planar(count * samples, 7U);
+    std::vector<uint16_t> chunky(count * samples);
+
+    benchmark(csv, settings, "Interleave/interleave/uint16/rgb/2048",
+              [&](uint64_t iterations)
+              {
+                for (uint64_t i = 0U; i < iterations; ++i)
+                  {
+                    ome::files::interleave(planar.data(), count, samples, count, chunky.data());
+                    sink += chunky[i % chunky.size()];
+                  }
+              });
+
+    benchmark(csv, settings, "Interleave/deinterleave/uint16/rgb/2048",
+              [&](uint64_t iterations)
+              {
+                for (uint64_t i = 0U; i < iterations; ++i)
+                  {
+                    ome::files::deinterleave(chunky.data(), samples, count, planar.data(), count);
+                    sink += planar[i % planar.size()];
+                  }
+              });
+  }
+
+  void
+  byteSwapBenchmarks(std::ostream&   csv,
+                     const Settings& settings)
+  {
+    // One 2048×2048 16-bit plane.
+    const dimension_size_type count = 2048U * 2048U;
+    std::vector<uint16_t> data(count, 0x1234U);
+
+    benchmark(csv, settings, "ByteSwap/value/uint16/2048",
+              [&](uint64_t iterations)
+              {
+                for (uint64_t i = 0U; i < iterations; ++i)
+                  {
+                    for (auto& v : data)
+                      ome::files::byteswap(v);
+                    sink += data[i % count];
+                  }
+              });
+
+    benchmark(csv, settings, "ByteSwap/bulk/uint16/2048",
+              [&](uint64_t iterations)
+              {
+                for (uint64_t i = 0U; i < iterations; ++i)
+                  {
+                    ome::files::byteswap(data.data(), count);
+                    sink += data[i % count];
+                  }
+              });
+  }
+
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  try
+    {
+      Settings settings;
+      std::string output;
+
+      opt::options_description options("Options");
+      options.add_options()
+        ("help,h", "Show help options")
+        ("min-time", opt::value<double>(&settings.mintime)->default_value(0.1), "Minimum time for each repetition (seconds)")
+        ("repetitions", opt::value<unsigned int>(&settings.repetitions)->default_value(5U), "Number of timed repetitions")
+        ("filter", opt::value<std::string>(&settings.filter)->default_value(""), "Only run benchmarks whose name contains this string");
+
+      opt::options_description hidden("Hidden options");
+      hidden.add_options()
+        ("output", opt::value<std::string>(&output), "Output CSV file");
+
+      opt::options_description all("All options");
+      all.add(options).add(hidden);
+
+      opt::positional_options_description positional;
+      positional.add("output", 1);
+
+      opt::variables_map vm;
+      opt::store(opt::command_line_parser(argc, argv).options(all).positional(positional).run(), vm);
+      opt::notify(vm);
+
+      if (vm.count("help"))
+        {
+          std::cout << "Usage: " << argv[0] << " [options] [output.csv]\n\n" << options << '\n';
+          return EXIT_SUCCESS;
+        }
+
+      if (!settings.repetitions)
+        throw std::logic_error("Repetition count must be positive");
+      if (settings.mintime <= 0.0)
+        throw std::logic_error("Minimum time must be positive");
+
+      std::ofstream file;
+      if (!output.empty())
+        {
+          file.open(output.c_str());
+          if (!file)
+            throw std::runtime_error("Failed to open output file " + output);
+        }
+      std::ostream& csv(output.empty() ? std::cout : file);
+
+      csv << "benchmark,iterations,repetitions,ns.per.op.median,ns.per.op.min\n";
+
+      pixelBufferBenchmarks(csv, settings);
+      tileCoverageBenchmarks(csv, settings);
+      tileCacheBenchmarks(csv, settings);
+      metadataMapBenchmarks(csv, settings);
+      formatToolsBenchmarks(csv, settings);
+      bitPackBenchmarks(csv, settings);
+      interleaveBenchmarks(csv, settings);
+      byteSwapBenchmarks(csv, settings);
+    }
+  catch (const std::exception& e)
+    {
+      std::cerr << "Error: " << e.what() << std::endl;
+      return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
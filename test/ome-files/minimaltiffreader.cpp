@@ -36,17 +36,58 @@
  * #L%
  */
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <map>
+#include <memory>
 #include <stdexcept>
+#include <string>
+#include <utility>
 #include <vector>
 
+#include <boost/filesystem/fstream.hpp>
+
+#include <ome/files/CoreMetadata.h>
+#include <ome/files/DecodedTileCache.h>
+#include <ome/files/FormatReader.h>
+#include <ome/files/MetadataTools.h>
+#include <ome/files/PixelBuffer.h>
+#include <ome/files/PixelConversion.h>
+#include <ome/files/PlaneRegion.h>
+#include <ome/files/TileBuffer.h>
 #include <ome/files/VariantPixelBuffer.h>
 #include <ome/files/in/MinimalTIFFReader.h>
+#include <ome/files/out/MinimalTIFFWriter.h>
+#include <ome/files/tiff/Exception.h>
+#include <ome/files/tiff/IFD.h>
+#include <ome/files/tiff/IOSource.h>
+#include <ome/files/tiff/Util.h>
+
+#include <ome/xml/meta/OMEXMLMetadata.h>
 
 #include <ome/test/test.h>
 
 using ome::files::dimension_size_type;
+using ome::files::CancellationToken;
+using ome::files::CancelledException;
+using ome::files::CoreMetadata;
+using ome::files::DecodedTileCache;
+using ome::files::Executor;
+using ome::files::FormatReader;
+using ome::files::PixelBuffer;
+using ome::files::PixelConversion;
+using ome::files::PlaneRegion;
+using ome::files::TileBuffer;
 using ome::files::VariantPixelBuffer;
 using ome::files::in::MinimalTIFFReader;
+using ome::files::out::MinimalTIFFWriter;
+using ome::xml::model::enums::PixelType;
 
 class TIFFTestParameters
 {
@@ -72,6 +113,26 @@ operator<< (std::basic_ostream<charT,traits>& os,
   return os;
 }
 
+// Executor queueing tasks to run later, recording their priority.
+class QueueExecutor : public Executor
+{
+public:
+  std::vector<std::pair<task_type, Priority>> queue;
+
+  void
+  submit(const task_type& task,
+         Priority         priority) override
+  {
+    queue.push_back(std::make_pair(task, priority));
+  }
+
+  dimension_size_type
+  concurrency() const override
+  {
+    return 1U;
+  }
+};
+
 class TIFFTest : public ::testing::TestWithParam<TIFFTestParameters>
 {
 public:
@@ -147,6 +208,494 @@ TEST_P(TIFFTest, openBytes)
     }
 }
 
+TEST_P(TIFFTest, openBytesAsync)
+{
+  const TIFFTestParameters& params = GetParam();
+
+  ASSERT_NO_THROW(tiff.setId(params.file));
+
+  std::vector<VariantPixelBuffer> bufs(tiff.getImageCount());
+  std::vector<std::future<void>> results;
+  for (dimension_size_type p = 0; p < tiff.getImageCount(); ++p)
+    results.push_back(tiff.openBytesAsync(p, bufs[p]));
+  EXPECT_EQ(tiff.getImageCount() - 1, tiff.getPlane());
+
+  for (dimension_size_type p = 0; p < tiff.getImageCount(); ++p)
+    {
+      ASSERT_NO_THROW(results[p].get());
+      VariantPixelBuffer expected;
+      ASSERT_NO_THROW(tiff.openBytes(p, expected));
+      EXPECT_TRUE(expected == bufs[p]);
+    }
+
+  VariantPixelBuffer buf;
+  EXPECT_THROW(tiff.openBytesAsync(tiff.getImageCount(), buf), std::logic_error);
+}
+
+TEST_P(TIFFTest, openBytesAsyncExecutor)
+{
+  const TIFFTestParameters& params = GetParam();
+
+  // Queue tasks to run later, as for an event loop.
+  std::vector<std::function<void ()>> queue;
+  tiff.setExecutor([&queue](const std::function<void ()>& task)
+                   {
+                     queue.push_back(task);
+                   });
+  EXPECT_TRUE(static_cast<bool>(tiff.getExecutor()));
+
+  ASSERT_NO_THROW(tiff.setId(params.file));
+
+  VariantPixelBuffer buf;
+  std::future<void> result(tiff.openBytesAsync(0, buf, 2, 3, 8, 9));
+  ASSERT_EQ(1U, queue.size());
+  EXPECT_EQ(std::future_status::timeout, result.wait_for(std::chrono::seconds(0)));
+
+  queue.front()();
+  ASSERT_EQ(std::future_status::ready, result.wait_for(std::chrono::seconds(0)));
+  ASSERT_NO_THROW(result.get());
+
+  VariantPixelBuffer expected;
+  ASSERT_NO_THROW(tiff.openBytes(0, expected, 2, 3, 8, 9));
+  EXPECT_TRUE(expected == buf);
+}
+
+TEST_P(TIFFTest, openBytesAsyncCancel)
+{
+  const TIFFTestParameters& params = GetParam();
+
+  std::shared_ptr<QueueExecutor> executor(std::make_shared<QueueExecutor>());
+  tiff.setExecutor(executor);
+  ASSERT_NO_THROW(tiff.setId(params.file));
+
+  CancellationToken stale, current;
+  VariantPixelBuffer stalebuf, buf, unchanged;
+  std::future<void> staleresult(tiff.openBytesAsync(0, stalebuf, 2, 3, 8, 9,
+                                                    Executor::PRIORITY_NORMAL, stale));
+  std::future<void> result(tiff.openBytesAsync(0, buf, 2, 3, 8, 9,
+                                               Executor::PRIORITY_HIGH, current));
+  ASSERT_EQ(2U, executor->queue.size());
+  EXPECT_EQ(Executor::PRIORITY_NORMAL, executor->queue[0].second);
+  EXPECT_EQ(Executor::PRIORITY_HIGH, executor->queue[1].second);
+
+  stale.cancel();
+  for (const auto& task : executor->queue)
+    task.first();
+
+  // The cancelled read did not access its buffer.
+  EXPECT_THROW(staleresult.get(), CancelledException);
+  EXPECT_TRUE(unchanged == stalebuf);
+
+  ASSERT_NO_THROW(result.get());
+  VariantPixelBuffer expected;
+  ASSERT_NO_THROW(tiff.openBytes(0, expected, 2, 3, 8, 9));
+  EXPECT_TRUE(expected == buf);
+}
+
+TEST_P(TIFFTest, openBytesBatch)
+{
+  const TIFFTestParameters& params = GetParam();
+
+  ASSERT_NO_THROW(tiff.setId(params.file));
+
+  dimension_size_type sx = tiff.getSizeX();
+  dimension_size_type sy = tiff.getSizeY();
+
+  // Overlapping regions of each plane, in reverse plane order.
+  std::vector<PlaneRegion> regions;
+  regions.push_back(PlaneRegion(0, 0, sx, sy));
+  regions.push_back(PlaneRegion(0, 0, (sx / 2) + 1, (sy / 2) + 1));
+  regions.push_back(PlaneRegion(sx / 4, sy / 4, sx / 2, sy / 2));
+
+  std::vector<FormatReader::ReadRequest> requests;
+  std::vector<VariantPixelBuffer> bufs(tiff.getImageCount() * regions.size());
+  for (dimension_size_type p = tiff.getImageCount(); p-- > 0;)
+    for (dimension_size_type r = 0; r < regions.size(); ++r)
+      {
+        FormatReader::ReadRequest request;
+        request.plane = p;
+        request.region = regions[r];
+        request.buf = &bufs[(p * regions.size()) + r];
+        requests.push_back(request);
+      }
+
+  ASSERT_NO_THROW(tiff.openBytesBatch(requests));
+
+  for (const auto& request : requests)
+    {
+      VariantPixelBuffer expected;
+      ASSERT_NO_THROW(tiff.openBytes(request.plane, expected,
+                                     request.region.x, request.region.y,
+                                     request.region.w, request.region.h));
+      EXPECT_TRUE(expected == *request.buf);
+    }
+
+  requests.resize(1);
+  requests[0].plane = tiff.getImageCount();
+  EXPECT_THROW(tiff.openBytesBatch(requests), std::logic_error);
+}
+
+TEST_P(TIFFTest, openBytesConcurrent)
+{
+  const TIFFTestParameters& params = GetParam();
+
+  ASSERT_NO_THROW(tiff.setId(params.file));
+
+  dimension_size_type sx = tiff.getSizeX();
+  dimension_size_type sy = tiff.getSizeY();
+  dimension_size_type count = tiff.getImageCount();
+
+  std::vector<VariantPixelBuffer> expected(count);
+  for (dimension_size_type p = 0; p < count; ++p)
+    ASSERT_NO_THROW(tiff.openBytes(p, expected[p], 1, 2, sx - 3, sy - 4));
+  ASSERT_NO_THROW(tiff.setPlane(0));
+
+  // Each thread reads every plane, in a different order.
+  const dimension_size_type threads = 4;
+  std::vector<std::vector<VariantPixelBuffer>> bufs(threads, std::vector<VariantPixelBuffer>(count));
+  std::vector<std::future<void>> results;
+  for (dimension_size_type t = 0; t < threads; ++t)
+    results.push_back(std::async(std::launch::async,
+                                 [this, t, count, sx, sy, &bufs]()
+                                 {
+                                   for (dimension_size_type i = 0; i < count; ++i)
+                                     {
+                                       dimension_size_type p = (i + t) % count;
+                                       tiff.openBytesConcurrent(0, 0, p, bufs[t][p],
+                                                                1, 2, sx - 3, sy - 4);
+                                     }
+                                 }));
+  for (auto& result : results)
+    ASSERT_NO_THROW(result.get());
+
+  for (dimension_size_type t = 0; t < threads; ++t)
+    for (dimension_size_type p = 0; p < count; ++p)
+      EXPECT_TRUE(expected[p] == bufs[t][p]);
+
+  // The reader state is unchanged.
+  EXPECT_EQ(0U, tiff.getSeries());
+  EXPECT_EQ(0U, tiff.getPlane());
+
+  VariantPixelBuffer buf;
+  EXPECT_THROW(tiff.openBytesConcurrent(tiff.getSeriesCount(), 0, 0, buf, 0, 0, 1, 1), std::logic_error);
+  EXPECT_THROW(tiff.openBytesConcurrent(0, 1, 0, buf, 0, 0, 1, 1), std::logic_error);
+  EXPECT_THROW(tiff.openBytesConcurrent(0, 0, count, buf, 0, 0, 1, 1), std::logic_error);
+  EXPECT_THROW(tiff.openBytesConcurrent(0, 0, 0, buf, 1, 0, sx, sy), std::logic_error);
+}
+
+TEST_P(TIFFTest, clone)
+{
+  const TIFFTestParameters& params = GetParam();
+
+  EXPECT_THROW(tiff.clone(), std::logic_error);
+
+  ASSERT_NO_THROW(tiff.setId(params.file));
+
+  // Each thread reads every plane using its own clone.
+  const dimension_size_type threads = 4;
+  std::vector<std::shared_ptr<FormatReader>> readers;
+  for (dimension_size_type t = 0; t < threads; ++t)
+    {
+      std::shared_ptr<FormatReader> reader;
+      ASSERT_NO_THROW(reader = tiff.clone());
+      ASSERT_TRUE(static_cast<bool>(std::dynamic_pointer_cast<MinimalTIFFReader>(reader)));
+      EXPECT_EQ(tiff.getSeriesCount(), reader->getSeriesCount());
+      EXPECT_EQ(tiff.getImageCount(), reader->getImageCount());
+      EXPECT_EQ(tiff.getSizeX(), reader->getSizeX());
+      EXPECT_EQ(tiff.getSizeY(), reader->getSizeY());
+      EXPECT_EQ(tiff.getPixelType(), reader->getPixelType());
+      readers.push_back(reader);
+    }
+
+  dimension_size_type count = tiff.getImageCount();
+  std::vector<std::vector<VariantPixelBuffer>> bufs(threads, std::vector<VariantPixelBuffer>(count));
+  std::vector<std::future<void>> results;
+  for (dimension_size_type t = 0; t < threads; ++t)
+    results.push_back(std::async(std::launch::async,
+                                 [t, count, &readers, &bufs]()
+                                 {
+                                   for (dimension_size_type i = 0; i < count; ++i)
+                                     {
+                                       dimension_size_type p = (i + t) % count;
+                                       readers[t]->openBytes(p, bufs[t][p]);
+                                     }
+                                 }));
+  for (auto& result : results)
+    ASSERT_NO_THROW(result.get());
+
+  for (dimension_size_type p = 0; p < count; ++p)
+    {
+      VariantPixelBuffer expected;
+      ASSERT_NO_THROW(tiff.openBytes(p, expected));
+      for (dimension_size_type t = 0; t < threads; ++t)
+        EXPECT_TRUE(expected == bufs[t][p]);
+    }
+
+  // The clones are independent of the source reader.
+  ASSERT_NO_THROW(tiff.setPlane(0));
+  EXPECT_EQ((threads - 1 + count - 1) % count, readers.back()->getPlane());
+  ASSERT_NO_THROW(tiff.close());
+  VariantPixelBuffer buf;
+  EXPECT_NO_THROW(readers.front()->openBytes(0, buf));
+}
+
+TEST_P(TIFFTest, openTile)
+{
+  const TIFFTestParameters& params = GetParam();
+
+  std::shared_ptr<DecodedTileCache> cache(std::make_shared<DecodedTileCache>());
+  ASSERT_NO_THROW(tiff.setTileCache(cache));
+  ASSERT_NO_THROW(tiff.setId(params.file));
+
+  std::shared_ptr<const ome::files::tiff::IFD> ifd;
+  ASSERT_NO_THROW(ifd = tiff.getPlaneIFD(0));
+  ASSERT_TRUE(static_cast<bool>(ifd));
+  ome::files::tiff::TileInfo info = ifd->getTileInfo();
+
+  for (dimension_size_type t = 0; t < info.tileCount(); ++t)
+    {
+      std::shared_ptr<const TileBuffer> tile;
+      ASSERT_NO_THROW(tile = tiff.openTile(0, t));
+      ASSERT_TRUE(static_cast<bool>(tile));
+      EXPECT_EQ(info.bufferSize(), tile->size());
+
+      // Shared with the cache rather than decoded again.
+      std::shared_ptr<const TileBuffer> again;
+      ASSERT_NO_THROW(again = tiff.openTile(0, t));
+      EXPECT_EQ(tile, again);
+    }
+  EXPECT_EQ(info.tileCount(), cache->size());
+
+  EXPECT_THROW(tiff.openTile(0, info.tileCount()), ome::files::tiff::Exception);
+  EXPECT_THROW(tiff.openTile(tiff.getImageCount(), 0), std::logic_error);
+}
+
+TEST_P(TIFFTest, openBytesStreamed)
+{
+  const TIFFTestParameters& params = GetParam();
+
+  ASSERT_NO_THROW(tiff.setId(params.file));
+
+  dimension_size_type x = tiff.getSizeX() / 4;
+  dimension_size_type y = tiff.getSizeY() / 4;
+  dimension_size_type w = tiff.getSizeX() - x;
+  dimension_size_type h = tiff.getSizeY() - y;
+
+  for (dimension_size_type p = 0; p < tiff.getImageCount(); ++p)
+    {
+      dimension_size_type area = 0;
+      ASSERT_NO_THROW(tiff.openBytesStreamed(p,
+                                             [&](const VariantPixelBuffer& buf,
+                                                 const PlaneRegion& region)
+                                             {
+                                               area += region.area();
+                                               EXPECT_GE(region.x, x);
+                                               EXPECT_GE(region.y, y);
+                                               EXPECT_LE(region.x + region.w, x + w);
+                                               EXPECT_LE(region.y + region.h, y + h);
+
+                                               // The buffer is reused, so check each part as it is visited.
+                                               VariantPixelBuffer expected;
+                                               tiff.openBytes(p, expected, region.x, region.y, region.w, region.h);
+                                               EXPECT_TRUE(expected == buf);
+                                             },
+                                             x, y, w, h));
+      EXPECT_EQ(w * h, area);
+      EXPECT_EQ(p, tiff.getPlane());
+    }
+
+  auto ignore = [](const VariantPixelBuffer&, const PlaneRegion&) {};
+  EXPECT_THROW(tiff.openBytesStreamed(tiff.getImageCount(), ignore, 0, 0, 1, 1), std::logic_error);
+  EXPECT_THROW(tiff.openBytesStreamed(0, ignore, 0, 0, tiff.getSizeX() + 1, 1), std::logic_error);
+}
+
+TEST_P(TIFFTest, normalized)
+{
+  const TIFFTestParameters& params = GetParam();
+
+  ASSERT_NO_THROW(tiff.setId(params.file));
+
+  MinimalTIFFReader normalized;
+  EXPECT_FALSE(normalized.isNormalized());
+  normalized.setNormalized(true);
+  EXPECT_TRUE(normalized.isNormalized());
+  ASSERT_NO_THROW(normalized.setId(params.file));
+  EXPECT_THROW(normalized.setNormalized(false), std::logic_error);
+
+  // Integer samples are scaled to [0, 1].
+  const double range = std::ldexp(1.0, static_cast<int>(tiff.getBitsPerPixel())) - 1.0;
+  PixelConversion conversion(1.0 / range);
+
+  dimension_size_type x = tiff.getSizeX() / 4;
+  dimension_size_type y = tiff.getSizeY() / 4;
+  dimension_size_type w = tiff.getSizeX() - x;
+  dimension_size_type h = tiff.getSizeY() - y;
+
+  for (dimension_size_type p = 0; p < tiff.getImageCount(); ++p)
+    {
+      VariantPixelBuffer raw, expected;
+      ASSERT_NO_THROW(tiff.openBytes(p, raw, x, y, w, h));
+      ome::files::convertPixels(raw, expected, ome::xml::model::enums::PixelType::FLOAT, conversion);
+
+      VariantPixelBuffer buf;
+      ASSERT_NO_THROW(normalized.openBytes(p, buf, x, y, w, h));
+      EXPECT_EQ(ome::xml::model::enums::PixelType::FLOAT, buf.pixelType());
+      EXPECT_TRUE(expected == buf);
+
+      VariantPixelBuffer async;
+      ASSERT_NO_THROW(normalized.openBytesAsync(p, async, x, y, w, h).get());
+      EXPECT_TRUE(expected == async);
+
+      VariantPixelBuffer concurrent;
+      ASSERT_NO_THROW(normalized.openBytesConcurrent(0, 0, p, concurrent, x, y, w, h));
+      EXPECT_TRUE(expected == concurrent);
+
+      ASSERT_NO_THROW(normalized.openBytesStreamed(p,
+                                                   [&](const VariantPixelBuffer& region,
+                                                       const PlaneRegion& area)
+                                                   {
+                                                     VariantPixelBuffer part;
+                                                     normalized.openBytes(p, part, area.x, area.y, area.w, area.h);
+                                                     EXPECT_EQ(ome::xml::model::enums::PixelType::FLOAT,
+                                                               region.pixelType());
+                                                     EXPECT_TRUE(part == region);
+                                                   },
+                                                   x, y, w, h));
+    }
+}
+
+TEST_P(TIFFTest, adviseAccess)
+{
+  const TIFFTestParameters& params = GetParam();
+
+  ASSERT_NO_THROW(tiff.setId(params.file));
+  MinimalTIFFReader ref;
+  ASSERT_NO_THROW(ref.setId(params.file));
+
+  for (dimension_size_type p = 0; p < tiff.getImageCount(); ++p)
+    {
+      EXPECT_NO_THROW(tiff.adviseAccess(ome::files::HINT_SEQUENTIAL, p, 0, 0, tiff.getSizeX(), tiff.getSizeY()));
+      EXPECT_NO_THROW(tiff.adviseAccess(ome::files::HINT_WILLNEED, p, 0, 0, tiff.getSizeX(), tiff.getSizeY()));
+      EXPECT_NO_THROW(tiff.adviseAccess(ome::files::HINT_RANDOM, p, 0, 0, 1, 1));
+    }
+  EXPECT_THROW(tiff.adviseAccess(ome::files::HINT_WILLNEED, tiff.getImageCount(), 0, 0, 1, 1), std::logic_error);
+
+  // The current plane is unchanged.
+  EXPECT_EQ(0U, tiff.getPlane());
+
+  // Reading is unaffected.
+  for (dimension_size_type p = 0; p < tiff.getImageCount(); ++p)
+    {
+      VariantPixelBuffer buf, expected;
+      ASSERT_NO_THROW(tiff.openBytes(p, buf));
+      ASSERT_NO_THROW(ref.openBytes(p, expected));
+      EXPECT_TRUE(expected == buf);
+    }
+}
+
+TEST_P(TIFFTest, prefetch)
+{
+  const TIFFTestParameters& params = GetParam();
+
+  std::shared_ptr<DecodedTileCache> cache(std::make_shared<DecodedTileCache>());
+  ASSERT_NO_THROW(tiff.setTileCache(cache));
+  ASSERT_NO_THROW(tiff.setId(params.file));
+  EXPECT_THROW(tiff.setTileCache(cache), std::logic_error);
+
+  for (dimension_size_type p = 0; p < tiff.getImageCount(); ++p)
+    EXPECT_NO_THROW(tiff.prefetch(p, 0, 0, tiff.getSizeX(), tiff.getSizeY()));
+  EXPECT_THROW(tiff.prefetch(tiff.getImageCount(), 0, 0, 1, 1), std::logic_error);
+
+  // The current plane is unchanged.
+  EXPECT_EQ(0U, tiff.getPlane());
+
+  // Waits for pending prefetches.
+  ASSERT_NO_THROW(tiff.close());
+  EXPECT_LT(0U, cache->size());
+  dimension_size_type cached = cache->size();
+
+  // Served from the cache.
+  MinimalTIFFReader ref;
+  ASSERT_NO_THROW(ref.setId(params.file));
+  ASSERT_NO_THROW(tiff.setTileCache(cache));
+  ASSERT_NO_THROW(tiff.setId(params.file));
+  for (dimension_size_type p = 0; p < tiff.getImageCount(); ++p)
+    {
+      VariantPixelBuffer expected, buf;
+      ASSERT_NO_THROW(ref.openBytes(p, expected));
+      ASSERT_NO_THROW(tiff.openBytes(p, buf));
+      EXPECT_TRUE(expected == buf);
+    }
+  EXPECT_EQ(cached, cache->size());
+}
+
+TEST_P(TIFFTest, prefetchCancel)
+{
+  const TIFFTestParameters& params = GetParam();
+
+  std::shared_ptr<QueueExecutor> executor(std::make_shared<QueueExecutor>());
+  std::shared_ptr<DecodedTileCache> cache(std::make_shared<DecodedTileCache>());
+  tiff.setExecutor(executor);
+  ASSERT_NO_THROW(tiff.setTileCache(cache));
+  ASSERT_NO_THROW(tiff.setId(params.file));
+
+  ASSERT_NO_THROW(tiff.prefetch(0, 0, 0, tiff.getSizeX(), tiff.getSizeY()));
+  ASSERT_EQ(1U, executor->queue.size());
+  EXPECT_EQ(Executor::PRIORITY_LOW, executor->queue[0].second);
+
+  // Dropped without decoding.
+  tiff.cancelPrefetch();
+  executor->queue[0].first();
+  EXPECT_EQ(0U, cache->size());
+
+  // Later prefetches are not cancelled.
+  ASSERT_NO_THROW(tiff.prefetch(0, 0, 0, tiff.getSizeX(), tiff.getSizeY()));
+  ASSERT_EQ(2U, executor->queue.size());
+  executor->queue[1].first();
+  EXPECT_LT(0U, cache->size());
+}
+
+TEST_P(TIFFTest, readahead)
+{
+  const TIFFTestParameters& params = GetParam();
+
+  // Tiles cached by reading the first two planes.
+  std::shared_ptr<DecodedTileCache> refcache(std::make_shared<DecodedTileCache>());
+  MinimalTIFFReader ref;
+  ASSERT_NO_THROW(ref.setTileCache(refcache));
+  ASSERT_NO_THROW(ref.setId(params.file));
+  ASSERT_LE(3U, ref.getImageCount());
+  std::vector<VariantPixelBuffer> expected(3);
+  for (dimension_size_type p = 0; p < 3U; ++p)
+    ASSERT_NO_THROW(ref.openBytes(p, expected[p]));
+  ASSERT_NO_THROW(ref.close());
+  dimension_size_type planeTiles = refcache->size() / 3U;
+
+  std::shared_ptr<DecodedTileCache> cache(std::make_shared<DecodedTileCache>());
+  EXPECT_FALSE(tiff.getReadahead());
+  ASSERT_NO_THROW(tiff.setReadahead(true));
+  EXPECT_TRUE(tiff.getReadahead());
+  ASSERT_NO_THROW(tiff.setTileCache(cache));
+  ASSERT_NO_THROW(tiff.setId(params.file));
+
+  // Reading planes 0 and 1 in order prefetches plane 2.
+  for (dimension_size_type p = 0; p < 2U; ++p)
+    {
+      VariantPixelBuffer buf;
+      ASSERT_NO_THROW(tiff.openBytes(p, buf));
+      EXPECT_TRUE(expected[p] == buf);
+    }
+  ASSERT_NO_THROW(tiff.close());
+  EXPECT_EQ(planeTiles * 3U, cache->size());
+
+  // Served from the cache.
+  ASSERT_NO_THROW(tiff.setId(params.file));
+  VariantPixelBuffer buf;
+  ASSERT_NO_THROW(tiff.openBytes(2U, buf));
+  EXPECT_TRUE(expected[2] == buf);
+  EXPECT_EQ(planeTiles * 3U, cache->size());
+}
+
 namespace
 {
 
@@ -166,6 +715,323 @@ namespace
 
 }
 
+TEST_P(TIFFTest, isThisType)
+{
+  const TIFFTestParameters& params = GetParam();
+
+  EXPECT_TRUE(tiff.isThisType(params.file, true));
+}
+
+TEST(TIFFHeaderTest, Header)
+{
+  const uint8_t little[] = {'I', 'I', 42, 0, 8, 0, 0, 0};
+  const uint8_t big[] = {'M', 'M', 0, 42, 0, 0, 0, 8};
+  const uint8_t bigtiff[] = {'I', 'I', 43, 0, 8, 0, 0, 0, 16, 0, 0, 0, 0, 0, 0, 0};
+  const uint8_t noifd[] = {'I', 'I', 42, 0, 0, 0, 0, 0};
+  const uint8_t badversion[] = {'I', 'I', 0, 42, 8, 0, 0, 0};
+  const uint8_t shortbigtiff[] = {'M', 'M', 0, 43, 0, 8, 0, 0};
+  const uint8_t png[] = {0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A};
+
+  EXPECT_TRUE(ome::files::tiff::isTIFFHeader(little, sizeof(little)));
+  EXPECT_TRUE(ome::files::tiff::isTIFFHeader(big, sizeof(big)));
+  EXPECT_TRUE(ome::files::tiff::isTIFFHeader(bigtiff, sizeof(bigtiff)));
+  EXPECT_FALSE(ome::files::tiff::isTIFFHeader(little, 4U));
+  EXPECT_FALSE(ome::files::tiff::isTIFFHeader(noifd, sizeof(noifd)));
+  EXPECT_FALSE(ome::files::tiff::isTIFFHeader(badversion, sizeof(badversion)));
+  EXPECT_FALSE(ome::files::tiff::isTIFFHeader(shortbigtiff, sizeof(shortbigtiff)));
+  EXPECT_FALSE(ome::files::tiff::isTIFFHeader(png, sizeof(png)));
+
+  MinimalTIFFReader reader;
+  EXPECT_TRUE(reader.isThisType(big, sizeof(big)));
+  EXPECT_FALSE(reader.isThisType(png, sizeof(png)));
+}
+
+TEST(MinimalTIFFReaderLive, Refresh)
+{
+  boost::filesystem::path file(boost::filesystem::path(PROJECT_BINARY_DIR "/test/ome-files/data") / "minimaltiffreader-live.tiff");
+
+  std::shared_ptr<CoreMetadata> c(std::make_shared<CoreMetadata>());
+  c->sizeX = 32;
+  c->sizeY = 16;
+  c->sizeZ = 1;
+  c->sizeT = 4;
+  c->sizeC.clear();
+  c->sizeC.push_back(1);
+  c->pixelType = PixelType::UINT8;
+  c->imageCount = 4;
+  c->orderCertain = true;
+  c->interleaved = false;
+  c->dimensionOrder = ome::xml::model::enums::DimensionOrder::XYZTC;
+  std::vector<std::shared_ptr<CoreMetadata>> seriesList(1, c);
+
+  std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> meta(std::make_shared<::ome::xml::meta::OMEXMLMetadata>());
+  ome::files::fillMetadata(*meta, seriesList);
+  std::shared_ptr<::ome::xml::meta::MetadataRetrieve> retrieve(meta);
+
+  std::array<VariantPixelBuffer::size_type, 9> shape;
+  shape.fill(1U);
+  shape[ome::files::DIM_SPATIAL_X] = 32;
+  shape[ome::files::DIM_SPATIAL_Y] = 16;
+
+  auto plane = [&](dimension_size_type p)
+    {
+      VariantPixelBuffer buf(shape, PixelType::UINT8);
+      uint8_t *data = buf.array<uint8_t>().data();
+      for (dimension_size_type i = 0U; i < buf.num_elements(); ++i)
+        data[i] = static_cast<uint8_t>(i + (p * 10U));
+      return buf;
+    };
+
+  MinimalTIFFWriter writer;
+  writer.setMetadataRetrieve(retrieve);
+  writer.setId(file);
+
+  // Each IFD is linked into the chain when the following plane is
+  // started.
+  writer.saveBytes(0U, plane(0U));
+  writer.saveBytes(1U, plane(1U));
+
+  MinimalTIFFReader reader;
+  EXPECT_THROW(reader.refresh(), std::logic_error);
+  reader.setLive(true);
+  EXPECT_TRUE(reader.getLive());
+  ASSERT_NO_THROW(reader.setId(file));
+  EXPECT_THROW(reader.setLive(false), std::logic_error);
+  ASSERT_EQ(1U, reader.getSeriesCount());
+  EXPECT_EQ(1U, reader.getImageCount());
+  EXPECT_EQ(0U, reader.refresh());
+
+  writer.saveBytes(2U, plane(2U));
+  writer.saveBytes(3U, plane(3U));
+  EXPECT_EQ(2U, reader.refresh());
+  EXPECT_EQ(3U, reader.getImageCount());
+  EXPECT_EQ(3U, reader.getSizeT());
+
+  writer.close();
+  EXPECT_EQ(1U, reader.refresh());
+  ASSERT_EQ(1U, reader.getSeriesCount());
+  EXPECT_EQ(4U, reader.getImageCount());
+
+  for (dimension_size_type p = 0U; p < 4U; ++p)
+    {
+      VariantPixelBuffer buf;
+      ASSERT_NO_THROW(reader.openBytes(p, buf));
+      EXPECT_EQ(plane(p), buf);
+    }
+
+  // A reader of the finished file agrees.
+  MinimalTIFFReader complete;
+  ASSERT_NO_THROW(complete.setId(file));
+  EXPECT_EQ(4U, complete.getImageCount());
+
+  // Refresh requires live reading.
+  EXPECT_THROW(complete.refresh(), std::logic_error);
+}
+
+TEST(MinimalTIFFReaderTyped, TypedBytes)
+{
+  boost::filesystem::path file(boost::filesystem::path(PROJECT_BINARY_DIR "/test/ome-files/data") / "minimaltiffreader-typed.tiff");
+
+  std::shared_ptr<CoreMetadata> c(std::make_shared<CoreMetadata>());
+  c->sizeX = 32;
+  c->sizeY = 16;
+  c->sizeZ = 1;
+  c->sizeT = 2;
+  c->sizeC.clear();
+  c->sizeC.push_back(1);
+  c->pixelType = PixelType::UINT16;
+  c->imageCount = 2;
+  c->orderCertain = true;
+  c->interleaved = false;
+  c->dimensionOrder = ome::xml::model::enums::DimensionOrder::XYZTC;
+  std::vector<std::shared_ptr<CoreMetadata>> seriesList(1, c);
+
+  std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> meta(std::make_shared<::ome::xml::meta::OMEXMLMetadata>());
+  ome::files::fillMetadata(*meta, seriesList);
+  std::shared_ptr<::ome::xml::meta::MetadataRetrieve> retrieve(meta);
+
+  std::array<VariantPixelBuffer::size_type, 9> shape;
+  shape.fill(1U);
+  shape[ome::files::DIM_SPATIAL_X] = 32;
+  shape[ome::files::DIM_SPATIAL_Y] = 16;
+
+  std::vector<std::shared_ptr<PixelBuffer<uint16_t>>> planes;
+  for (dimension_size_type p = 0U; p < 2U; ++p)
+    {
+      std::shared_ptr<PixelBuffer<uint16_t>> buf(std::make_shared<PixelBuffer<uint16_t>>(shape, PixelType::UINT16));
+      for (dimension_size_type i = 0U; i < buf->num_elements(); ++i)
+        buf->data()[i] = static_cast<uint16_t>((i * 251U) + (p * 1000U));
+      planes.push_back(buf);
+    }
+
+  {
+    MinimalTIFFWriter writer;
+    writer.setMetadataRetrieve(retrieve);
+    writer.setId(file);
+    ASSERT_NO_THROW(writer.saveBytes(0U, planes[0]));
+    ASSERT_NO_THROW(writer.saveBytes(1U, planes[1], 0U, 0U, 32U, 16U));
+    writer.close();
+  }
+
+  MinimalTIFFReader reader;
+  ASSERT_NO_THROW(reader.setId(file));
+
+  // A null buffer is allocated.
+  std::shared_ptr<PixelBuffer<uint16_t>> buf;
+  ASSERT_NO_THROW(reader.openBytes(0U, buf));
+  ASSERT_TRUE(static_cast<bool>(buf));
+  EXPECT_EQ(*planes[0], *buf);
+
+  // A buffer of the required size is reused.
+  const PixelBuffer<uint16_t> *previous = buf.get();
+  ASSERT_NO_THROW(reader.openBytes(1U, buf));
+  EXPECT_EQ(previous, buf.get());
+  EXPECT_EQ(*planes[1], *buf);
+
+  // Sub-images are read as for VariantPixelBuffer.
+  VariantPixelBuffer expected;
+  ASSERT_NO_THROW(reader.openBytes(1U, expected, 3U, 2U, 20U, 9U));
+  ASSERT_NO_THROW(reader.openBytes(1U, buf, 3U, 2U, 20U, 9U));
+  EXPECT_EQ(expected, VariantPixelBuffer(buf));
+
+  // The buffer type must match the pixel type.
+  std::shared_ptr<PixelBuffer<uint8_t>> wrong;
+  EXPECT_THROW(reader.openBytes(0U, wrong), std::logic_error);
+}
+
+namespace
+{
+
+  // Source reading a file's content from memory.
+  class MemorySource : public ome::files::tiff::IOSource
+  {
+  public:
+    MemorySource(const boost::filesystem::path& file,
+                 const std::string&             content):
+      file(file),
+      content(content)
+    {}
+
+    std::string
+    name() const
+    {
+      return file.string();
+    }
+
+    uint64_t
+    size() const
+    {
+      return content.size();
+    }
+
+    std::size_t
+    read(uint64_t    offset,
+         void       *buffer,
+         std::size_t size)
+    {
+      if (offset >= content.size())
+        return 0U;
+      size = std::min(size, static_cast<std::size_t>(content.size() - offset));
+      std::memcpy(buffer, content.data() + offset, size);
+      return size;
+    }
+
+    boost::filesystem::path file;
+    std::string             content;
+  };
+
+}
+
+TEST(MinimalTIFFReaderSource, SourceFactory)
+{
+  const boost::filesystem::path datadir(PROJECT_BINARY_DIR "/test/ome-files/data");
+  const boost::filesystem::path dir(datadir / "nonexistent");
+  ASSERT_FALSE(boost::filesystem::exists(dir));
+
+  std::shared_ptr<CoreMetadata> c(std::make_shared<CoreMetadata>());
+  c->sizeX = 32;
+  c->sizeY = 16;
+  c->sizeZ = c->sizeT = 1;
+  c->sizeC.clear();
+  c->sizeC.push_back(1);
+  c->pixelType = PixelType::UINT8;
+  c->imageCount = 1;
+  c->orderCertain = true;
+  c->interleaved = false;
+  c->dimensionOrder = ome::xml::model::enums::DimensionOrder::XYZTC;
+  std::vector<std::shared_ptr<CoreMetadata>> seriesList(1, c);
+
+  std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> meta(std::make_shared<::ome::xml::meta::OMEXMLMetadata>());
+  ome::files::fillMetadata(*meta, seriesList);
+  std::shared_ptr<::ome::xml::meta::MetadataRetrieve> retrieve(meta);
+
+  std::array<VariantPixelBuffer::size_type, 9> shape;
+  shape.fill(1U);
+  shape[ome::files::DIM_SPATIAL_X] = 32;
+  shape[ome::files::DIM_SPATIAL_Y] = 16;
+
+  // Write a set of files, and copy them into memory under a
+  // directory which does not exist.
+  const dimension_size_type count = 3U;
+  std::shared_ptr<std::map<boost::filesystem::path, std::string>> content
+    (std::make_shared<std::map<boost::filesystem::path, std::string>>());
+  for (dimension_size_type i = 0U; i < count; ++i)
+    {
+      const boost::filesystem::path file(datadir / ("minimaltiffreader-source-" + std::to_string(i) + ".tiff"));
+      VariantPixelBuffer buf(shape, PixelType::UINT8);
+      std::fill(buf.array<uint8_t>().data(), buf.array<uint8_t>().data() + buf.num_elements(),
+                static_cast<uint8_t>(i + 1U));
+      {
+        MinimalTIFFWriter writer;
+        writer.setMetadataRetrieve(retrieve);
+        writer.setId(file);
+        ASSERT_NO_THROW(writer.saveBytes(0U, buf));
+        writer.close();
+      }
+
+      boost::filesystem::ifstream in(file, std::ios::in | std::ios::binary);
+      (*content)[dir / file.filename()].assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+  std::size_t calls = 0U;
+  MinimalTIFFReader reader;
+  reader.setIOSourceFactory([content, &calls](const boost::filesystem::path& file) -> std::shared_ptr<ome::files::tiff::IOSource>
+    {
+      ++calls;
+      auto i = content->find(file);
+      if (i == content->end())
+        return std::shared_ptr<ome::files::tiff::IOSource>();
+      return std::make_shared<MemorySource>(i->first, i->second);
+    });
+
+  // Each file of the set is opened in turn by name.
+  for (dimension_size_type i = 0U; i < count; ++i)
+    {
+      const boost::filesystem::path file(dir / ("minimaltiffreader-source-" + std::to_string(i) + ".tiff"));
+      const std::size_t before = calls;
+      ASSERT_NO_THROW(reader.setId(file));
+      EXPECT_LT(before, calls);
+      ASSERT_EQ(1U, reader.getSeriesCount());
+      const std::vector<boost::filesystem::path> used(reader.getUsedFiles());
+      ASSERT_EQ(1U, used.size());
+      EXPECT_EQ(file, used[0]);
+
+      VariantPixelBuffer buf;
+      ASSERT_NO_THROW(reader.openBytes(0U, buf));
+      EXPECT_EQ(static_cast<uint8_t>(i + 1U), *buf.array<uint8_t>().data());
+
+      // Clones also read from the factory.
+      std::shared_ptr<FormatReader> clone;
+      ASSERT_NO_THROW(clone = reader.clone());
+      VariantPixelBuffer clonebuf;
+      ASSERT_NO_THROW(clone->openBytes(0U, clonebuf));
+      EXPECT_EQ(buf, clonebuf);
+    }
+
+  // Files missing from the factory are not found locally either.
+  EXPECT_THROW(reader.setId(dir / "missing.tiff"), std::exception);
+}
+
 std::vector<TIFFTestParameters> params(init_params());
 
 // Disable missing-prototypes warning for INSTANTIATE_TEST_CASE_P;
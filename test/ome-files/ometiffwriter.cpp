@@ -36,16 +36,38 @@
  * #L%
  */
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <set>
 #include <stdexcept>
+#include <thread>
 #include <vector>
 
+#include <boost/filesystem/fstream.hpp>
+
 #include <ome/files/CoreMetadata.h>
+#include <ome/files/Downsample.h>
+#include <ome/files/Executor.h>
+#include <ome/files/FormatException.h>
+#include <ome/files/Memo.h>
 #include <ome/files/MetadataTools.h>
+#include <ome/files/TileBuffer.h>
+#include <ome/files/TraceObserver.h>
 #include <ome/files/VariantPixelBuffer.h>
 #include <ome/files/in/OMETIFFReader.h>
 #include <ome/files/out/OMETIFFWriter.h>
+#include <ome/files/tiff/Exception.h>
 #include <ome/files/tiff/Field.h>
 #include <ome/files/tiff/IFD.h>
+#include <ome/files/tiff/IOSource.h>
+#include <ome/files/tiff/StrileReader.h>
 #include <ome/files/tiff/Tags.h>
 #include <ome/files/tiff/TIFF.h>
 #include <ome/files/tiff/Util.h>
@@ -201,6 +223,1726 @@ TEST_P(TIFFWriterTest, setId)
 
 }
 
+TEST_P(TIFFWriterTest, SubResolutions)
+{
+  const TIFFTestParameters& params = GetParam();
+
+  path pyramidfile(testfile.parent_path() / (std::string("pyramid-") + testfile.filename().string()));
+
+  std::vector<std::shared_ptr<CoreMetadata>> seriesList;
+  for (const auto& i : *tiff)
+    {
+      std::shared_ptr<CoreMetadata> c = ome::files::tiff::makeCoreMetadata(*i);
+      seriesList.push_back(c);
+    }
+
+  std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> meta(std::make_shared<::ome::xml::meta::OMEXMLMetadata>());
+  ome::files::fillMetadata(*meta, seriesList);
+  std::shared_ptr<::ome::xml::meta::MetadataRetrieve> retrieve(std::static_pointer_cast<::ome::xml::meta::MetadataRetrieve>(meta));
+
+  tiffwriter.setMetadataRetrieve(retrieve);
+
+  tiffwriter.setInterleaved(!params.imageplanar);
+  tiffwriter.setTileSizeX(params.tilewidth);
+  tiffwriter.setTileSizeY(params.tilelength);
+  tiffwriter.setResolutionCount(3U);
+  EXPECT_EQ(3U, tiffwriter.getResolutionCount());
+
+  ASSERT_NO_THROW(tiffwriter.setId(pyramidfile));
+
+  std::vector<std::shared_ptr<VariantPixelBuffer>> expected;
+  for (dimension_size_type i = 0U; i < seriesList.size(); ++i)
+    {
+      std::shared_ptr<IFD> ifd = tiff->getDirectoryByIndex(i);
+      ASSERT_TRUE(static_cast<bool>(ifd));
+      VariantPixelBuffer buf;
+      ifd->readImage(buf);
+
+      // Expected first sub-resolution.
+      std::array<VariantPixelBuffer::size_type, 9> shape;
+      shape[ome::files::DIM_SPATIAL_X] = ome::files::downsampledSize(ifd->getImageWidth());
+      shape[ome::files::DIM_SPATIAL_Y] = ome::files::downsampledSize(ifd->getImageHeight());
+      shape[ome::files::DIM_SUBCHANNEL] = ifd->getSamplesPerPixel();
+      shape[ome::files::DIM_SPATIAL_Z] = shape[ome::files::DIM_TEMPORAL_T] = shape[ome::files::DIM_CHANNEL] =
+        shape[ome::files::DIM_MODULO_Z] = shape[ome::files::DIM_MODULO_T] = shape[ome::files::DIM_MODULO_C] = 1;
+      std::shared_ptr<VariantPixelBuffer> half(std::make_shared<VariantPixelBuffer>(shape, ifd->getPixelType()));
+      ome::files::downsample(buf, 0, 0, *half);
+      expected.push_back(half);
+
+      ASSERT_NO_THROW(tiffwriter.setSeries(i));
+      ASSERT_NO_THROW(tiffwriter.saveBytes(0, buf));
+    }
+  tiffwriter.close();
+
+  std::shared_ptr<TIFF> written;
+  ASSERT_NO_THROW(written = TIFF::open(pyramidfile, "r"));
+  ASSERT_EQ(seriesList.size(), written->directoryCount());
+
+  for (dimension_size_type i = 0U; i < seriesList.size(); ++i)
+    {
+      std::shared_ptr<IFD> ifd = written->getDirectoryByIndex(i);
+      ASSERT_TRUE(static_cast<bool>(ifd));
+
+      std::vector<uint64_t> subifds;
+      ASSERT_NO_THROW(ifd->getField(ome::files::tiff::SUBIFD).get(subifds));
+      ASSERT_EQ(2U, subifds.size());
+
+      dimension_size_type width = ifd->getImageWidth();
+      dimension_size_type height = ifd->getImageHeight();
+      for (dimension_size_type level = 0U; level < subifds.size(); ++level)
+        {
+          width = ome::files::downsampledSize(width);
+          height = ome::files::downsampledSize(height);
+
+          std::shared_ptr<IFD> subifd = written->getDirectoryByOffset(subifds.at(level));
+          ASSERT_TRUE(static_cast<bool>(subifd));
+          EXPECT_EQ(width, subifd->getImageWidth());
+          EXPECT_EQ(height, subifd->getImageHeight());
+
+          uint32_t subfiletype;
+          ASSERT_NO_THROW(subifd->getField(ome::files::tiff::SUBFILETYPE).get(subfiletype));
+          EXPECT_EQ(1U, subfiletype);
+
+          if (level == 0U)
+            {
+              VariantPixelBuffer vb;
+              subifd->readImage(vb);
+              EXPECT_TRUE(*expected.at(i) == vb);
+            }
+        }
+    }
+}
+
+namespace
+{
+
+  // Write a dataset of single-plane series, each in a separate
+  // file.
+  std::vector<path>
+  writeMultiFile(const std::string&             name,
+                 OMETIFFWriter::MetadataStorage storage,
+                 dimension_size_type            count = 3U,
+                 bool                           concurrent = false)
+  {
+    path dir(PROJECT_BINARY_DIR "/test/ome-files/data");
+
+    std::vector<std::shared_ptr<CoreMetadata>> seriesList;
+    std::vector<path> files;
+    for (dimension_size_type i = 0U; i < count; ++i)
+      {
+        std::shared_ptr<CoreMetadata> c(std::make_shared<CoreMetadata>());
+        c->sizeX = 32;
+        c->sizeY = 16;
+        c->sizeZ = c->sizeT = 1;
+        c->sizeC.clear();
+        c->sizeC.push_back(1);
+        c->pixelType = ome::xml::model::enums::PixelType::UINT8;
+        c->imageCount = 1;
+        c->orderCertain = true;
+        c->interleaved = false;
+        c->dimensionOrder = ome::xml::model::enums::DimensionOrder::XYZTC;
+        seriesList.push_back(c);
+        files.push_back(dir / (name + "-" + std::to_string(i) + ".ome.tiff"));
+      }
+
+    std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> meta(std::make_shared<::ome::xml::meta::OMEXMLMetadata>());
+    ome::files::fillMetadata(*meta, seriesList);
+
+    OMETIFFWriter writer;
+    writer.setMetadataRetrieve(meta);
+    writer.setMetadataStorage(storage);
+    EXPECT_EQ(storage, writer.getMetadataStorage());
+
+    std::array<VariantPixelBuffer::size_type, 9> shape;
+    shape[ome::files::DIM_SPATIAL_X] = 32;
+    shape[ome::files::DIM_SPATIAL_Y] = 16;
+    shape[ome::files::DIM_SUBCHANNEL] = shape[ome::files::DIM_SPATIAL_Z] = shape[ome::files::DIM_TEMPORAL_T] =
+      shape[ome::files::DIM_CHANNEL] = shape[ome::files::DIM_MODULO_Z] = shape[ome::files::DIM_MODULO_T] =
+      shape[ome::files::DIM_MODULO_C] = 1;
+
+    if (concurrent)
+      {
+        // The first series is saved by the writer, and each of the
+        // others by a file writer on a separate thread.
+        writer.setId(files[0]);
+        std::vector<std::shared_ptr<OMETIFFWriter>> fileWriters;
+        for (dimension_size_type i = 1U; i < files.size(); ++i)
+          fileWriters.push_back(writer.createFileWriter(files[i], i));
+
+        std::vector<std::thread> threads;
+        std::vector<std::exception_ptr> errors(files.size());
+        for (dimension_size_type i = 0U; i < files.size(); ++i)
+          threads.emplace_back([&, i]()
+            {
+              try
+                {
+                  OMETIFFWriter& w(i ? *fileWriters[i - 1U] : writer);
+                  VariantPixelBuffer buf(shape, ome::xml::model::enums::PixelType::UINT8);
+                  std::fill(buf.array<uint8_t>().data(), buf.array<uint8_t>().data() + buf.num_elements(),
+                            static_cast<uint8_t>(i + 1U));
+                  w.saveBytes(0, buf);
+                  if (i)
+                    w.close();
+                }
+              catch (...)
+                {
+                  errors[i] = std::current_exception();
+                }
+            });
+        for (auto& thread : threads)
+          thread.join();
+        for (const auto& error : errors)
+          if (error)
+            std::rethrow_exception(error);
+      }
+    else
+      {
+        for (dimension_size_type i = 0U; i < files.size(); ++i)
+          {
+            VariantPixelBuffer buf(shape, ome::xml::model::enums::PixelType::UINT8);
+            std::fill(buf.array<uint8_t>().data(), buf.array<uint8_t>().data() + buf.num_elements(),
+                      static_cast<uint8_t>(i + 1U));
+            writer.setId(files[i]);
+            writer.setSeries(i);
+            writer.saveBytes(0, buf);
+          }
+      }
+    writer.close();
+
+    return files;
+  }
+
+  std::string
+  imageDescription(const path& file)
+  {
+    std::shared_ptr<TIFF> t(TIFF::open(file, "r"));
+    std::string description;
+    t->getDirectoryByIndex(0)->getField(ome::files::tiff::IMAGEDESCRIPTION).get(description);
+    return description;
+  }
+
+  void
+  checkMultiFile(const path&         file,
+                 dimension_size_type count = 3U)
+  {
+    OMETIFFReader reader;
+    ASSERT_NO_THROW(reader.setId(file));
+    ASSERT_EQ(count, reader.getSeriesCount());
+    for (dimension_size_type i = 0U; i < count; ++i)
+      {
+        reader.setSeries(i);
+        EXPECT_EQ(32U, reader.getSizeX());
+        VariantPixelBuffer buf;
+        ASSERT_NO_THROW(reader.openBytes(0, buf));
+        EXPECT_EQ(static_cast<uint8_t>(i + 1U), *buf.array<uint8_t>().data());
+      }
+  }
+
+}
+
+namespace
+{
+
+  // Write a tiled two-plane dataset, copying the planes from a
+  // reader if specified.
+  void
+  writeCopyFile(const path&                            file,
+                const std::string&                     compression,
+                const ome::files::FormatReader        *source,
+                std::vector<bool>                     *copied = nullptr)
+  {
+    std::shared_ptr<CoreMetadata> c(std::make_shared<CoreMetadata>());
+    c->sizeX = 64;
+    c->sizeY = 48;
+    c->sizeZ = 2;
+    c->sizeT = 1;
+    c->sizeC.clear();
+    c->sizeC.push_back(1);
+    c->pixelType = ome::xml::model::enums::PixelType::UINT16;
+    c->imageCount = 2;
+    c->orderCertain = true;
+    c->interleaved = false;
+    c->dimensionOrder = ome::xml::model::enums::DimensionOrder::XYZTC;
+    std::vector<std::shared_ptr<CoreMetadata>> seriesList(1, c);
+
+    std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> meta(std::make_shared<::ome::xml::meta::OMEXMLMetadata>());
+    ome::files::fillMetadata(*meta, seriesList);
+
+    OMETIFFWriter writer;
+    writer.setMetadataRetrieve(meta);
+    writer.setCompression(compression);
+    writer.setTileSizeX(16);
+    writer.setTileSizeY(16);
+    writer.setId(file);
+
+    std::array<VariantPixelBuffer::size_type, 9> shape;
+    shape[ome::files::DIM_SPATIAL_X] = 64;
+    shape[ome::files::DIM_SPATIAL_Y] = 48;
+    shape[ome::files::DIM_SUBCHANNEL] = shape[ome::files::DIM_SPATIAL_Z] = shape[ome::files::DIM_TEMPORAL_T] =
+      shape[ome::files::DIM_CHANNEL] = shape[ome::files::DIM_MODULO_Z] = shape[ome::files::DIM_MODULO_T] =
+      shape[ome::files::DIM_MODULO_C] = 1;
+
+    for (dimension_size_type p = 0U; p < 2U; ++p)
+      {
+        if (source)
+          {
+            bool raw = writer.copyBytes(p, *source, p);
+            if (copied)
+              copied->push_back(raw);
+          }
+        else
+          {
+            VariantPixelBuffer buf(shape, ome::xml::model::enums::PixelType::UINT16);
+            uint16_t *data = buf.array<uint16_t>().data();
+            for (dimension_size_type i = 0U; i < buf.num_elements(); ++i)
+              data[i] = static_cast<uint16_t>((i * 7U) + (p * 1000U));
+            writer.saveBytes(p, buf);
+          }
+      }
+    writer.close();
+  }
+
+}
+
+TEST(OMETIFFWriterCopy, RawTiles)
+{
+  path dir(PROJECT_BINARY_DIR "/test/ome-files/data");
+  path original(dir / "copy-original.ome.tiff");
+  path same(dir / "copy-same.ome.tiff");
+  path different(dir / "copy-different.ome.tiff");
+
+  ASSERT_NO_THROW(writeCopyFile(original, "Deflate", nullptr));
+
+  OMETIFFReader reader;
+  ASSERT_NO_THROW(reader.setId(original));
+  ASSERT_TRUE(static_cast<bool>(reader.getPlaneIFD(0)));
+  EXPECT_THROW(reader.getPlaneIFD(2), std::logic_error);
+
+  // Identical compression and tiling copies the compressed tiles.
+  std::vector<bool> copied;
+  ASSERT_NO_THROW(writeCopyFile(same, "Deflate", &reader, &copied));
+  EXPECT_EQ(std::vector<bool>(2, true), copied);
+
+  // Different compression decodes and encodes again.
+  copied.clear();
+  ASSERT_NO_THROW(writeCopyFile(different, "LZW", &reader, &copied));
+  EXPECT_EQ(std::vector<bool>(2, false), copied);
+
+  for (const auto& file : {same, different})
+    {
+      OMETIFFReader check;
+      ASSERT_NO_THROW(check.setId(file));
+      for (dimension_size_type p = 0U; p < 2U; ++p)
+        {
+          VariantPixelBuffer expected, buf;
+          ASSERT_NO_THROW(reader.openBytes(p, expected));
+          ASSERT_NO_THROW(check.openBytes(p, buf));
+          EXPECT_TRUE(expected == buf);
+        }
+    }
+
+  // The compressed data is identical to the original.
+  std::shared_ptr<TIFF> t(TIFF::open(same, "r"));
+  std::shared_ptr<IFD> ifd(t->getDirectoryByIndex(1));
+  std::shared_ptr<const IFD> source(reader.getPlaneIFD(1));
+  std::vector<char> raw, sourceraw;
+  ASSERT_TRUE(static_cast<bool>(ifd->getStrileReader()));
+  ASSERT_TRUE(static_cast<bool>(source->getStrileReader()));
+  for (dimension_size_type tile = 0U; tile < ifd->getStrileReader()->getStrileCount(); ++tile)
+    {
+      ASSERT_NO_THROW(ifd->getStrileReader()->read(tile, raw));
+      ASSERT_NO_THROW(source->getStrileReader()->read(tile, sourceraw));
+      EXPECT_TRUE(raw == sourceraw);
+    }
+}
+
+namespace
+{
+
+  // Write a preallocated four-plane dataset from several threads,
+  // each saving the top and bottom halves of a plane separately.
+  void
+  writePreallocatedFile(const path&         file,
+                        dimension_size_type tilesize,
+                        bool                directio = false)
+  {
+    std::shared_ptr<CoreMetadata> c(std::make_shared<CoreMetadata>());
+    c->sizeX = 64;
+    c->sizeY = 40;
+    c->sizeZ = 4;
+    c->sizeT = 1;
+    c->sizeC.clear();
+    c->sizeC.push_back(1);
+    c->pixelType = ome::xml::model::enums::PixelType::UINT16;
+    c->imageCount = 4;
+    c->orderCertain = true;
+    c->interleaved = false;
+    c->dimensionOrder = ome::xml::model::enums::DimensionOrder::XYZTC;
+    std::vector<std::shared_ptr<CoreMetadata>> seriesList(1, c);
+
+    std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> meta(std::make_shared<::ome::xml::meta::OMEXMLMetadata>());
+    ome::files::fillMetadata(*meta, seriesList);
+
+    OMETIFFWriter writer;
+    writer.setMetadataRetrieve(meta);
+    if (tilesize)
+      writer.setTileSizeX(tilesize);
+    writer.setTileSizeY(tilesize ? tilesize : 16U);
+    writer.setPreallocated(true);
+    writer.setDirectIO(directio);
+    writer.setId(file);
+
+    std::array<VariantPixelBuffer::size_type, 9> shape;
+    shape[ome::files::DIM_SPATIAL_X] = 64;
+    shape[ome::files::DIM_SPATIAL_Y] = 20;
+    shape[ome::files::DIM_SUBCHANNEL] = shape[ome::files::DIM_SPATIAL_Z] = shape[ome::files::DIM_TEMPORAL_T] =
+      shape[ome::files::DIM_CHANNEL] = shape[ome::files::DIM_MODULO_Z] = shape[ome::files::DIM_MODULO_T] =
+      shape[ome::files::DIM_MODULO_C] = 1;
+
+    std::vector<std::thread> threads;
+    std::vector<std::exception_ptr> errors(8U);
+    // Planes are saved in reverse order.
+    for (dimension_size_type t = 0U; t < 8U; ++t)
+      threads.emplace_back([&, t]()
+        {
+          try
+            {
+              dimension_size_type p = 3U - (t / 2U);
+              dimension_size_type y = (t % 2U) * 20U;
+              VariantPixelBuffer buf(shape, ome::xml::model::enums::PixelType::UINT16);
+              uint16_t *data = buf.array<uint16_t>().data();
+              for (dimension_size_type i = 0U; i < buf.num_elements(); ++i)
+                data[i] = static_cast<uint16_t>(((y * 64U) + i) * 7U + (p * 1000U));
+              writer.saveBytes(p, buf, 0U, y, 64U, 20U);
+            }
+          catch (...)
+            {
+              errors[t] = std::current_exception();
+            }
+        });
+    for (auto& thread : threads)
+      thread.join();
+    for (const auto& error : errors)
+      if (error)
+        std::rethrow_exception(error);
+
+    writer.close();
+  }
+
+}
+
+TEST(OMETIFFWriterPreallocated, ConcurrentPlanes)
+{
+  path dir(PROJECT_BINARY_DIR "/test/ome-files/data");
+
+  // Tiles, and strips with a partial last strip.
+  for (const auto tilesize : {16U, 0U})
+    {
+      path file(dir / (tilesize ? "preallocated-tiles.ome.tiff" : "preallocated-strips.ome.tiff"));
+      ASSERT_NO_THROW(writePreallocatedFile(file, tilesize));
+
+      OMETIFFReader reader;
+      ASSERT_NO_THROW(reader.setId(file));
+      ASSERT_EQ(4U, reader.getImageCount());
+      for (dimension_size_type p = 0U; p < 4U; ++p)
+        {
+          VariantPixelBuffer buf;
+          ASSERT_NO_THROW(reader.openBytes(p, buf));
+          const uint16_t *data = buf.array<uint16_t>().data();
+          for (dimension_size_type i = 0U; i < buf.num_elements(); ++i)
+            ASSERT_EQ(static_cast<uint16_t>(i * 7U + (p * 1000U)), data[i]);
+        }
+    }
+}
+
+TEST(OMETIFFWriterPreallocated, DirectIO)
+{
+  path dir(PROJECT_BINARY_DIR "/test/ome-files/data");
+
+  // Whole tiles and strips are written directly, and the tiles and
+  // strips saved in two parts are written through the mapping.
+  for (const auto tilesize : {16U, 0U})
+    {
+      path file(dir / (tilesize ? "preallocated-direct-tiles.ome.tiff" : "preallocated-direct-strips.ome.tiff"));
+      ASSERT_NO_THROW(writePreallocatedFile(file, tilesize, true));
+
+      OMETIFFReader reader;
+      ASSERT_NO_THROW(reader.setId(file));
+      ASSERT_EQ(4U, reader.getImageCount());
+      for (dimension_size_type p = 0U; p < 4U; ++p)
+        {
+          VariantPixelBuffer buf;
+          ASSERT_NO_THROW(reader.openBytes(p, buf));
+          const uint16_t *data = buf.array<uint16_t>().data();
+          for (dimension_size_type i = 0U; i < buf.num_elements(); ++i)
+            ASSERT_EQ(static_cast<uint16_t>(i * 7U + (p * 1000U)), data[i]);
+        }
+
+      // Every tile or strip is aligned.
+      std::shared_ptr<TIFF> t(TIFF::open(file, "r"));
+      for (ome::files::tiff::directory_index_type d = 0U; d < t->directoryCount(); ++d)
+        {
+          std::shared_ptr<IFD> ifd(t->getDirectoryByIndex(d));
+          ASSERT_TRUE(static_cast<bool>(ifd->getStrileReader()));
+          for (dimension_size_type tile = 0U; tile < ifd->getStrileReader()->getStrileCount(); ++tile)
+            EXPECT_EQ(0U, ifd->getStrileReader()->getRange(tile).first % ome::files::TileBuffer::direct_io_alignment);
+        }
+    }
+
+  // Direct I/O requires preallocation.
+  std::shared_ptr<CoreMetadata> c(std::make_shared<CoreMetadata>());
+  c->sizeX = 64;
+  c->sizeY = 40;
+  c->pixelType = ome::xml::model::enums::PixelType::UINT16;
+  c->orderCertain = true;
+  c->interleaved = false;
+  std::vector<std::shared_ptr<CoreMetadata>> seriesList(1, c);
+
+  std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> meta(std::make_shared<::ome::xml::meta::OMEXMLMetadata>());
+  ome::files::fillMetadata(*meta, seriesList);
+
+  OMETIFFWriter writer;
+  writer.setMetadataRetrieve(meta);
+  writer.setDirectIO(true);
+  EXPECT_TRUE(writer.getDirectIO());
+  EXPECT_THROW(writer.setId(dir / "direct-unallocated.ome.tiff"), ome::files::FormatException);
+}
+
+TEST(OMETIFFWriterPreallocated, Compressed)
+{
+  std::shared_ptr<CoreMetadata> c(std::make_shared<CoreMetadata>());
+  c->sizeX = 64;
+  c->sizeY = 40;
+  c->pixelType = ome::xml::model::enums::PixelType::UINT16;
+  c->orderCertain = true;
+  c->interleaved = false;
+  std::vector<std::shared_ptr<CoreMetadata>> seriesList(1, c);
+
+  std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> meta(std::make_shared<::ome::xml::meta::OMEXMLMetadata>());
+  ome::files::fillMetadata(*meta, seriesList);
+
+  OMETIFFWriter writer;
+  writer.setMetadataRetrieve(meta);
+  writer.setCompression("LZW");
+  writer.setPreallocated(true);
+  EXPECT_THROW(writer.setId(PROJECT_BINARY_DIR "/test/ome-files/data/preallocated-lzw.ome.tiff"),
+               ome::files::FormatException);
+}
+
+namespace
+{
+
+  // Write timepoints of a 64×40 time series, appending to an
+  // existing file if specified.
+  void
+  writeAppendFile(const path&         file,
+                  dimension_size_type sizeT,
+                  dimension_size_type firstT,
+                  bool                append,
+                  dimension_size_type sizeX = 64U,
+                  bool                cluster = false)
+  {
+    std::shared_ptr<CoreMetadata> c(std::make_shared<CoreMetadata>());
+    c->sizeX = sizeX;
+    c->sizeY = 40;
+    c->sizeT = sizeT;
+    c->pixelType = ome::xml::model::enums::PixelType::UINT16;
+    c->imageCount = sizeT;
+    c->orderCertain = true;
+    c->interleaved = false;
+    c->dimensionOrder = ome::xml::model::enums::DimensionOrder::XYZCT;
+    std::vector<std::shared_ptr<CoreMetadata>> seriesList(1, c);
+
+    std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> meta(std::make_shared<::ome::xml::meta::OMEXMLMetadata>());
+    ome::files::fillMetadata(*meta, seriesList);
+
+    OMETIFFWriter writer;
+    writer.setMetadataRetrieve(meta);
+    writer.setCompression("Deflate");
+    writer.setTileSizeX(16);
+    writer.setTileSizeY(16);
+    writer.setAppend(append);
+    writer.setClusteredDirectories(cluster);
+    writer.setId(file);
+
+    std::array<VariantPixelBuffer::size_type, 9> shape;
+    shape.fill(1U);
+    shape[ome::files::DIM_SPATIAL_X] = sizeX;
+    shape[ome::files::DIM_SPATIAL_Y] = 40;
+
+    for (dimension_size_type t = firstT; t < sizeT; ++t)
+      {
+        VariantPixelBuffer buf(shape, ome::xml::model::enums::PixelType::UINT16);
+        uint16_t *data = buf.array<uint16_t>().data();
+        for (dimension_size_type i = 0U; i < buf.num_elements(); ++i)
+          data[i] = static_cast<uint16_t>(i * 7U + (t * 1000U));
+        writer.saveBytes(t, buf);
+      }
+    writer.close();
+  }
+
+}
+
+TEST(OMETIFFWriterAppend, Timepoints)
+{
+  path file(PROJECT_BINARY_DIR "/test/ome-files/data/append-timepoints.ome.tiff");
+  if (exists(file))
+    remove(file);
+
+  // Appending to a missing file creates it.
+  ASSERT_NO_THROW(writeAppendFile(file, 2U, 0U, true));
+
+  std::vector<uint64_t> offsets;
+  {
+    std::shared_ptr<TIFF> t(TIFF::open(file, "r"));
+    ASSERT_EQ(2U, t->directoryCount());
+    offsets = t->getDirectoryOffsets();
+  }
+
+  // Two more timepoints are appended to the existing two.
+  ASSERT_NO_THROW(writeAppendFile(file, 4U, 2U, true));
+
+  {
+    // The existing IFDs are unchanged, and the new IFDs are linked
+    // after them.
+    std::shared_ptr<TIFF> t(TIFF::open(file, "r"));
+    ASSERT_EQ(4U, t->directoryCount());
+    std::vector<uint64_t> appended(t->getDirectoryOffsets());
+    EXPECT_TRUE(std::equal(offsets.begin(), offsets.end(), appended.begin()));
+  }
+
+  OMETIFFReader reader;
+  ASSERT_NO_THROW(reader.setId(file));
+  ASSERT_EQ(1U, reader.getSeriesCount());
+  EXPECT_EQ(4U, reader.getSizeT());
+  ASSERT_EQ(4U, reader.getImageCount());
+  for (dimension_size_type p = 0U; p < 4U; ++p)
+    {
+      VariantPixelBuffer buf;
+      ASSERT_NO_THROW(reader.openBytes(p, buf));
+      const uint16_t *data = buf.array<uint16_t>().data();
+      for (dimension_size_type i = 0U; i < buf.num_elements(); ++i)
+        ASSERT_EQ(static_cast<uint16_t>(i * 7U + (p * 1000U)), data[i]);
+    }
+}
+
+TEST(OMETIFFWriterAppend, Invalid)
+{
+  path file(PROJECT_BINARY_DIR "/test/ome-files/data/append-invalid.ome.tiff");
+  ASSERT_NO_THROW(writeAppendFile(file, 2U, 0U, false));
+
+  // The image size differs.
+  EXPECT_THROW(writeAppendFile(file, 4U, 2U, true, 32U), ome::files::FormatException);
+  // All planes are already present.
+  EXPECT_THROW(writeAppendFile(file, 2U, 2U, true), ome::files::FormatException);
+}
+
+namespace
+{
+
+  // Update a region of the second timepoint of a file written by
+  // writeAppendFile(), setting each pixel with the specified
+  // function of its position.
+  void
+  updateRegion(const path&                                   file,
+               dimension_size_type                           x,
+               dimension_size_type                           y,
+               dimension_size_type                           w,
+               dimension_size_type                           h,
+               std::function<uint16_t (dimension_size_type,
+                                       dimension_size_type)> value)
+  {
+    std::shared_ptr<CoreMetadata> c(std::make_shared<CoreMetadata>());
+    c->sizeX = 64;
+    c->sizeY = 40;
+    c->sizeT = 2;
+    c->pixelType = ome::xml::model::enums::PixelType::UINT16;
+    c->imageCount = 2;
+    c->orderCertain = true;
+    c->interleaved = false;
+    c->dimensionOrder = ome::xml::model::enums::DimensionOrder::XYZCT;
+    std::vector<std::shared_ptr<CoreMetadata>> seriesList(1, c);
+
+    std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> meta(std::make_shared<::ome::xml::meta::OMEXMLMetadata>());
+    ome::files::fillMetadata(*meta, seriesList);
+
+    OMETIFFWriter writer;
+    writer.setMetadataRetrieve(meta);
+    writer.setUpdate(true);
+    EXPECT_TRUE(writer.getUpdate());
+    writer.setId(file);
+
+    std::array<VariantPixelBuffer::size_type, 9> shape;
+    shape.fill(1U);
+    shape[ome::files::DIM_SPATIAL_X] = w;
+    shape[ome::files::DIM_SPATIAL_Y] = h;
+    VariantPixelBuffer buf(shape, ome::xml::model::enums::PixelType::UINT16);
+    uint16_t *data = buf.array<uint16_t>().data();
+    for (dimension_size_type row = 0U; row < h; ++row)
+      for (dimension_size_type col = 0U; col < w; ++col)
+        data[(row * w) + col] = value(x + col, y + row);
+    writer.saveBytes(1U, buf, x, y, w, h);
+    writer.close();
+  }
+
+  // Pseudo-random values, which do not compress.
+  uint16_t
+  noise(dimension_size_type col,
+        dimension_size_type row)
+  {
+    uint32_t v = static_cast<uint32_t>((row * 64U) + col) * 2654435761U;
+    v ^= v >> 13;
+    v *= 0x5bd1e995U;
+    v ^= v >> 15;
+    return static_cast<uint16_t>(v);
+  }
+
+  void
+  getTileLayout(const path&            file,
+                dimension_size_type    index,
+                std::vector<uint64_t>& offsets,
+                std::vector<uint64_t>& bytecounts)
+  {
+    std::shared_ptr<TIFF> t(TIFF::open(file, "r"));
+    std::shared_ptr<IFD> ifd(t->getDirectoryByIndex(index));
+    ifd->getField(ome::files::tiff::TILEOFFSETS).get(offsets);
+    ifd->getField(ome::files::tiff::TILEBYTECOUNTS).get(bytecounts);
+  }
+
+}
+
+TEST(OMETIFFWriterUpdate, Region)
+{
+  path file(PROJECT_BINARY_DIR "/test/ome-files/data/update-region.ome.tiff");
+  ASSERT_NO_THROW(writeAppendFile(file, 2U, 0U, false));
+
+  std::string description;
+  std::vector<uint64_t> offsets0, bytecounts0, offsets, bytecounts;
+  {
+    std::shared_ptr<TIFF> t(TIFF::open(file, "r"));
+    t->getDirectoryByIndex(0)->getField(ome::files::tiff::IMAGEDESCRIPTION).get(description);
+  }
+  getTileLayout(file, 0U, offsets0, bytecounts0);
+  getTileLayout(file, 1U, offsets, bytecounts);
+  const uint64_t size = file_size(file);
+
+  std::vector<uint16_t> expected(64U * 40U);
+  for (dimension_size_type i = 0U; i < expected.size(); ++i)
+    expected[i] = static_cast<uint16_t>(i * 7U + 1000U);
+
+  // The region covers the two upper-left 16×16 tiles, and the top
+  // rows of the two tiles below, which are merged with their
+  // existing content.  Constant values compress better than the
+  // existing data, so the covered tiles are rewritten in place.
+  ASSERT_NO_THROW(updateRegion(file, 0U, 0U, 32U, 18U,
+                               [](dimension_size_type, dimension_size_type)
+                               { return static_cast<uint16_t>(42U); }));
+  for (dimension_size_type row = 0U; row < 18U; ++row)
+    for (dimension_size_type col = 0U; col < 32U; ++col)
+      expected[(row * 64U) + col] = 42U;
+
+  std::vector<uint64_t> inplace, inplacecounts;
+  getTileLayout(file, 1U, inplace, inplacecounts);
+  ASSERT_EQ(offsets.size(), inplace.size());
+  for (dimension_size_type tile = 0U; tile < offsets.size(); ++tile)
+    {
+      if (tile == 4U || tile == 5U)
+        continue;
+      EXPECT_EQ(offsets[tile], inplace[tile]);
+      if (tile < 2U)
+        EXPECT_LT(inplacecounts[tile], bytecounts[tile]);
+      else
+        EXPECT_EQ(bytecounts[tile], inplacecounts[tile]);
+    }
+  const uint64_t inplacesize = file_size(file);
+
+  // Noise does not fit, so the fully covered tile is appended and
+  // repointed.  The partly covered tile to its right is merged.
+  ASSERT_NO_THROW(updateRegion(file, 32U, 16U, 20U, 16U, noise));
+  for (dimension_size_type row = 16U; row < 32U; ++row)
+    for (dimension_size_type col = 32U; col < 52U; ++col)
+      expected[(row * 64U) + col] = noise(col, row);
+
+  std::vector<uint64_t> appended, appendedcounts;
+  getTileLayout(file, 1U, appended, appendedcounts);
+  for (dimension_size_type tile = 0U; tile < offsets.size(); ++tile)
+    {
+      if (tile == 6U)
+        EXPECT_GE(appended[tile], inplacesize);
+      else if (tile != 7U)
+        {
+          EXPECT_EQ(inplace[tile], appended[tile]);
+          EXPECT_EQ(inplacecounts[tile], appendedcounts[tile]);
+        }
+    }
+  EXPECT_GT(file_size(file), size);
+
+  // The first IFD and the metadata are unchanged.
+  std::vector<uint64_t> updated0, updatedcounts0;
+  getTileLayout(file, 0U, updated0, updatedcounts0);
+  EXPECT_EQ(offsets0, updated0);
+  EXPECT_EQ(bytecounts0, updatedcounts0);
+  {
+    std::string text;
+    std::shared_ptr<TIFF> t(TIFF::open(file, "r"));
+    t->getDirectoryByIndex(0)->getField(ome::files::tiff::IMAGEDESCRIPTION).get(text);
+    EXPECT_EQ(description, text);
+  }
+
+  OMETIFFReader reader;
+  ASSERT_NO_THROW(reader.setId(file));
+  ASSERT_EQ(2U, reader.getImageCount());
+  for (dimension_size_type p = 0U; p < 2U; ++p)
+    {
+      VariantPixelBuffer buf;
+      ASSERT_NO_THROW(reader.openBytes(p, buf));
+      const uint16_t *data = buf.array<uint16_t>().data();
+      for (dimension_size_type i = 0U; i < buf.num_elements(); ++i)
+        ASSERT_EQ(p ? expected[i] : static_cast<uint16_t>(i * 7U), data[i]);
+    }
+}
+
+TEST(OMETIFFWriterUpdate, Invalid)
+{
+  const path dir(PROJECT_BINARY_DIR "/test/ome-files/data");
+  if (exists(dir / "update-missing.ome.tiff"))
+    remove(dir / "update-missing.ome.tiff");
+  auto fill = [](dimension_size_type, dimension_size_type)
+    { return static_cast<uint16_t>(0U); };
+
+  // Updating requires an existing file.
+  EXPECT_THROW(updateRegion(dir / "update-missing.ome.tiff", 0U, 0U, 8U, 8U, fill),
+               ome::files::FormatException);
+
+  // The plane being updated is not present.
+  ASSERT_NO_THROW(writeAppendFile(dir / "update-invalid.ome.tiff", 1U, 0U, false));
+  EXPECT_THROW(updateRegion(dir / "update-invalid.ome.tiff", 0U, 0U, 8U, 8U, fill),
+               ome::files::FormatException);
+}
+
+TEST(OMETIFFWriterLayout, ClusteredDirectories)
+{
+  path file(PROJECT_BINARY_DIR "/test/ome-files/data/clustered.ome.tiff");
+  if (exists(file))
+    remove(file);
+
+  // Write two timepoints, and append two more, clustering each time.
+  for (const auto& t : {std::make_pair(2U, 0U), std::make_pair(4U, 2U)})
+    {
+      ASSERT_NO_THROW(writeAppendFile(file, t.first, t.second, t.second != 0U, 64U, true));
+
+      // Every IFD precedes all the tile data.
+      std::shared_ptr<TIFF> tiff(TIFF::open(file, "r"));
+      ASSERT_EQ(t.first, tiff->directoryCount());
+      const std::vector<uint64_t> ifds(tiff->getDirectoryOffsets());
+      uint64_t firstTile = std::numeric_limits<uint64_t>::max();
+      for (dimension_size_type i = 0U; i < t.first; ++i)
+        {
+          std::vector<uint64_t> offsets;
+          ASSERT_NO_THROW(tiff->getDirectoryByIndex(i)->getField(ome::files::tiff::TILEOFFSETS).get(offsets));
+          firstTile = std::min(firstTile, *std::min_element(offsets.begin(), offsets.end()));
+        }
+      for (const auto& offset : ifds)
+        EXPECT_LT(offset, firstTile);
+    }
+
+  OMETIFFReader reader;
+  ASSERT_NO_THROW(reader.setId(file));
+  ASSERT_EQ(4U, reader.getImageCount());
+  for (dimension_size_type p = 0U; p < 4U; ++p)
+    {
+      VariantPixelBuffer buf;
+      ASSERT_NO_THROW(reader.openBytes(p, buf));
+      const uint16_t *data = buf.array<uint16_t>().data();
+      for (dimension_size_type i = 0U; i < buf.num_elements(); ++i)
+        ASSERT_EQ(static_cast<uint16_t>(i * 7U + (p * 1000U)), data[i]);
+    }
+}
+
+TEST(OMETIFFWriterRollover, MaxFileSize)
+{
+  const path dir(PROJECT_BINARY_DIR "/test/ome-files/data");
+  const path file(dir / "rollover.ome.tiff");
+  for (dimension_size_type i = 0U; i < 8U; ++i)
+    {
+      path rolled(dir / ("rollover_" + std::to_string(i) + ".ome.tiff"));
+      if (exists(rolled))
+        remove(rolled);
+    }
+
+  std::shared_ptr<CoreMetadata> c(std::make_shared<CoreMetadata>());
+  c->sizeX = 64;
+  c->sizeY = 40;
+  c->sizeT = 8;
+  c->pixelType = ome::xml::model::enums::PixelType::UINT16;
+  c->imageCount = 8;
+  c->orderCertain = true;
+  c->interleaved = false;
+  c->dimensionOrder = ome::xml::model::enums::DimensionOrder::XYZCT;
+  std::vector<std::shared_ptr<CoreMetadata>> seriesList(1, c);
+
+  std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> meta(std::make_shared<::ome::xml::meta::OMEXMLMetadata>());
+  ome::files::fillMetadata(*meta, seriesList);
+
+  {
+    // Each plane is 5120 bytes, so each file holds three planes.
+    OMETIFFWriter writer;
+    writer.setMetadataRetrieve(meta);
+    writer.setMaxFileSize(12000U);
+    EXPECT_EQ(12000U, writer.getMaxFileSize());
+    ASSERT_NO_THROW(writer.setId(file));
+
+    std::array<VariantPixelBuffer::size_type, 9> shape;
+    shape.fill(1U);
+    shape[ome::files::DIM_SPATIAL_X] = 64;
+    shape[ome::files::DIM_SPATIAL_Y] = 40;
+    for (dimension_size_type t = 0U; t < 8U; ++t)
+      {
+        VariantPixelBuffer buf(shape, ome::xml::model::enums::PixelType::UINT16);
+        uint16_t *data = buf.array<uint16_t>().data();
+        for (dimension_size_type i = 0U; i < buf.num_elements(); ++i)
+          data[i] = static_cast<uint16_t>(i * 7U + (t * 1000U));
+        ASSERT_NO_THROW(writer.saveBytes(t, buf));
+      }
+    ASSERT_NO_THROW(writer.close());
+  }
+
+  EXPECT_TRUE(exists(dir / "rollover_1.ome.tiff"));
+  EXPECT_TRUE(exists(dir / "rollover_2.ome.tiff"));
+  EXPECT_FALSE(exists(dir / "rollover_3.ome.tiff"));
+
+  OMETIFFReader reader;
+  ASSERT_NO_THROW(reader.setId(dir / "rollover_2.ome.tiff"));
+  EXPECT_EQ(3U, reader.getUsedFiles().size());
+  ASSERT_EQ(8U, reader.getImageCount());
+  for (dimension_size_type p = 0U; p < 8U; ++p)
+    {
+      VariantPixelBuffer buf;
+      ASSERT_NO_THROW(reader.openBytes(p, buf));
+      const uint16_t *data = buf.array<uint16_t>().data();
+      for (dimension_size_type i = 0U; i < buf.num_elements(); ++i)
+        ASSERT_EQ(static_cast<uint16_t>(i * 7U + (p * 1000U)), data[i]);
+    }
+
+  // Rollover requires each IFD to be written as its planes are saved.
+  OMETIFFWriter invalid;
+  invalid.setMetadataRetrieve(meta);
+  invalid.setMaxFileSize(12000U);
+  invalid.setAppend(true);
+  EXPECT_THROW(invalid.setId(dir / "rollover-invalid.ome.tiff"), ome::files::FormatException);
+}
+
+TEST(OMETIFFWriterAsync, StagedFrames)
+{
+  const path file(PROJECT_BINARY_DIR "/test/ome-files/data/async-frames.ome.tiff");
+
+  std::shared_ptr<CoreMetadata> c(std::make_shared<CoreMetadata>());
+  c->sizeX = 64;
+  c->sizeY = 40;
+  c->sizeT = 8;
+  c->pixelType = ome::xml::model::enums::PixelType::UINT16;
+  c->imageCount = 8;
+  c->orderCertain = true;
+  c->interleaved = false;
+  c->dimensionOrder = ome::xml::model::enums::DimensionOrder::XYZCT;
+  std::vector<std::shared_ptr<CoreMetadata>> seriesList(1, c);
+
+  std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> meta(std::make_shared<::ome::xml::meta::OMEXMLMetadata>());
+  ome::files::fillMetadata(*meta, seriesList);
+
+  std::array<VariantPixelBuffer::size_type, 9> shape;
+  shape.fill(1U);
+  shape[ome::files::DIM_SPATIAL_X] = 64;
+  shape[ome::files::DIM_SPATIAL_Y] = 20;
+
+  {
+    OMETIFFWriter writer;
+    writer.setMetadataRetrieve(meta);
+    writer.setCompression("Deflate");
+    writer.setAsyncQueueSize(2U);
+    EXPECT_EQ(2U, writer.getAsyncQueueSize());
+    ASSERT_NO_THROW(writer.setId(file));
+
+    // The even timepoints reuse a single buffer, which is copied
+    // into the staging queue; the odd timepoints are adopted.
+    VariantPixelBuffer buf(shape, ome::xml::model::enums::PixelType::UINT16);
+    for (dimension_size_type t = 0U; t < 8U; ++t)
+      {
+        for (dimension_size_type y = 0U; y < 40U; y += 20U)
+          {
+            VariantPixelBuffer adopted(shape, ome::xml::model::enums::PixelType::UINT16);
+            VariantPixelBuffer& frame(t % 2U ? adopted : buf);
+            uint16_t *data = frame.array<uint16_t>().data();
+            for (dimension_size_type i = 0U; i < frame.num_elements(); ++i)
+              data[i] = static_cast<uint16_t>(((y * 64U) + i) * 7U + (t * 1000U));
+            if (t % 2U)
+              ASSERT_NO_THROW(writer.saveBytes(t, std::move(adopted), 0U, y, 64U, 20U));
+            else
+              ASSERT_NO_THROW(writer.saveBytes(t, buf, 0U, y, 64U, 20U));
+          }
+        if (t == 3U)
+          ASSERT_NO_THROW(writer.flush());
+      }
+    ASSERT_NO_THROW(writer.close());
+    EXPECT_EQ(0U, writer.getAsyncQueueSize());
+  }
+
+  OMETIFFReader reader;
+  ASSERT_NO_THROW(reader.setId(file));
+  ASSERT_EQ(8U, reader.getImageCount());
+  for (dimension_size_type p = 0U; p < 8U; ++p)
+    {
+      VariantPixelBuffer buf;
+      ASSERT_NO_THROW(reader.openBytes(p, buf));
+      const uint16_t *data = buf.array<uint16_t>().data();
+      for (dimension_size_type i = 0U; i < buf.num_elements(); ++i)
+        ASSERT_EQ(static_cast<uint16_t>(i * 7U + (p * 1000U)), data[i]);
+    }
+
+  {
+    OMETIFFWriter writer;
+    writer.setMetadataRetrieve(meta);
+    writer.setAsyncQueueSize(2U);
+    ASSERT_NO_THROW(writer.setId(file));
+
+    // The plane is checked when staged.
+    VariantPixelBuffer buf(shape, ome::xml::model::enums::PixelType::UINT16);
+    EXPECT_THROW(writer.saveBytes(8U, buf, 0U, 0U, 64U, 20U), std::logic_error);
+
+    // The pixel type is checked when written, and the error is
+    // raised by the flush.
+    VariantPixelBuffer invalid(shape, ome::xml::model::enums::PixelType::UINT8);
+    ASSERT_NO_THROW(writer.saveBytes(0U, invalid, 0U, 0U, 64U, 20U));
+    EXPECT_THROW(writer.flush(), ome::files::tiff::Exception);
+    EXPECT_THROW(writer.saveBytes(0U, buf, 0U, 20U, 64U, 20U), ome::files::tiff::Exception);
+    EXPECT_THROW(writer.close(), ome::files::tiff::Exception);
+  }
+}
+
+TEST(OMETIFFWriterAsync, Rollover)
+{
+  const path dir(PROJECT_BINARY_DIR "/test/ome-files/data");
+  const path file(dir / "async-rollover.ome.tiff");
+  for (dimension_size_type i = 0U; i < 8U; ++i)
+    {
+      path rolled(dir / ("async-rollover_" + std::to_string(i) + ".ome.tiff"));
+      if (exists(rolled))
+        remove(rolled);
+    }
+
+  std::shared_ptr<CoreMetadata> c(std::make_shared<CoreMetadata>());
+  c->sizeX = 64;
+  c->sizeY = 40;
+  c->sizeT = 8;
+  c->pixelType = ome::xml::model::enums::PixelType::UINT16;
+  c->imageCount = 8;
+  c->orderCertain = true;
+  c->interleaved = false;
+  c->dimensionOrder = ome::xml::model::enums::DimensionOrder::XYZCT;
+  std::vector<std::shared_ptr<CoreMetadata>> seriesList(1, c);
+
+  std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> meta(std::make_shared<::ome::xml::meta::OMEXMLMetadata>());
+  ome::files::fillMetadata(*meta, seriesList);
+
+  {
+    // Each plane is 5120 bytes, so each file holds three planes,
+    // and the files change on the background thread.
+    OMETIFFWriter writer;
+    writer.setMetadataRetrieve(meta);
+    writer.setMaxFileSize(12000U);
+    writer.setAsyncQueueSize(2U);
+    ASSERT_NO_THROW(writer.setId(file));
+
+    std::array<VariantPixelBuffer::size_type, 9> shape;
+    shape.fill(1U);
+    shape[ome::files::DIM_SPATIAL_X] = 64;
+    shape[ome::files::DIM_SPATIAL_Y] = 40;
+
+    // Frames are acquired into a ring buffer of two slots, which is
+    // external storage, so each frame is copied rather than adopted
+    // and the slot may be overwritten as soon as it is saved.
+    std::vector<uint16_t> ring(2U * 64U * 40U);
+    for (dimension_size_type t = 0U; t < 8U; ++t)
+      {
+        uint16_t *data = &ring[(t % 2U) * 64U * 40U];
+        for (dimension_size_type i = 0U; i < 64U * 40U; ++i)
+          data[i] = static_cast<uint16_t>(i * 7U + (t * 1000U));
+        VariantPixelBuffer frame(data, 64U * 40U * sizeof(uint16_t), shape,
+                                 ome::xml::model::enums::PixelType::UINT16);
+        ASSERT_NO_THROW(writer.saveBytes(t, std::move(frame)));
+        std::fill(data, data + 64U * 40U, 0xFFFFU);
+      }
+    ASSERT_NO_THROW(writer.close());
+  }
+
+  EXPECT_TRUE(exists(dir / "async-rollover_1.ome.tiff"));
+  EXPECT_TRUE(exists(dir / "async-rollover_2.ome.tiff"));
+  EXPECT_FALSE(exists(dir / "async-rollover_3.ome.tiff"));
+
+  OMETIFFReader reader;
+  ASSERT_NO_THROW(reader.setId(file));
+  EXPECT_EQ(3U, reader.getUsedFiles().size());
+  ASSERT_EQ(8U, reader.getImageCount());
+  for (dimension_size_type p = 0U; p < 8U; ++p)
+    {
+      VariantPixelBuffer buf;
+      ASSERT_NO_THROW(reader.openBytes(p, buf));
+      const uint16_t *data = buf.array<uint16_t>().data();
+      for (dimension_size_type i = 0U; i < buf.num_elements(); ++i)
+        ASSERT_EQ(static_cast<uint16_t>(i * 7U + (p * 1000U)), data[i]);
+    }
+}
+
+TEST(OMETIFFWriterPlanes, Block)
+{
+  // Planes with a single sample are written directly from the
+  // block; three sample planes are converted from interleaved to
+  // planar storage.
+  for (const dimension_size_type samples : {1U, 3U})
+    {
+      path file(PROJECT_BINARY_DIR "/test/ome-files/data");
+      file /= samples == 1U ? "planes-block-grey.ome.tiff" : "planes-block-rgb.ome.tiff";
+
+      std::shared_ptr<CoreMetadata> c(std::make_shared<CoreMetadata>());
+      c->sizeX = 48;
+      c->sizeY = 24;
+      c->sizeZ = 4;
+      c->sizeT = 2;
+      c->sizeC.clear();
+      c->sizeC.push_back(samples);
+      c->sizeC.push_back(samples);
+      c->pixelType = ome::xml::model::enums::PixelType::UINT16;
+      c->imageCount = 16;
+      c->orderCertain = true;
+      c->interleaved = false;
+      c->dimensionOrder = ome::xml::model::enums::DimensionOrder::XYZCT;
+      std::vector<std::shared_ptr<CoreMetadata>> seriesList(1, c);
+
+      std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> meta(std::make_shared<::ome::xml::meta::OMEXMLMetadata>());
+      ome::files::fillMetadata(*meta, seriesList);
+
+      // A block of Z and C at the second timepoint.
+      std::array<VariantPixelBuffer::size_type, 9> shape;
+      shape[ome::files::DIM_SPATIAL_X] = 48;
+      shape[ome::files::DIM_SPATIAL_Y] = 24;
+      shape[ome::files::DIM_SUBCHANNEL] = samples;
+      shape[ome::files::DIM_SPATIAL_Z] = 4;
+      shape[ome::files::DIM_CHANNEL] = 2;
+      shape[ome::files::DIM_TEMPORAL_T] = shape[ome::files::DIM_MODULO_Z] =
+        shape[ome::files::DIM_MODULO_T] = shape[ome::files::DIM_MODULO_C] = 1;
+      VariantPixelBuffer block(shape, ome::xml::model::enums::PixelType::UINT16);
+      uint16_t *data = block.array<uint16_t>().data();
+      for (dimension_size_type i = 0U; i < block.num_elements(); ++i)
+        data[i] = static_cast<uint16_t>(i);
+
+      {
+        OMETIFFWriter writer;
+        writer.setMetadataRetrieve(meta);
+        writer.setInterleaved(false);
+        writer.setId(file);
+
+        // The first timepoint is written plane by plane.
+        shape[ome::files::DIM_SPATIAL_Z] = shape[ome::files::DIM_CHANNEL] = 1;
+        VariantPixelBuffer buf(shape, ome::xml::model::enums::PixelType::UINT16);
+        for (dimension_size_type p = 0U; p < 8U; ++p)
+          ASSERT_NO_THROW(writer.saveBytes(p, buf));
+
+        ASSERT_NO_THROW(writer.savePlanes(writer.getIndex(0U, 0U, 1U), block));
+        writer.close();
+      }
+
+      OMETIFFReader reader;
+      ASSERT_NO_THROW(reader.setId(file));
+      ASSERT_EQ(16U, reader.getImageCount());
+      for (dimension_size_type z = 0U; z < 4U; ++z)
+        for (dimension_size_type ch = 0U; ch < 2U; ++ch)
+          {
+            VariantPixelBuffer buf;
+            ASSERT_NO_THROW(reader.openBytes(reader.getIndex(z, ch, 1U), buf));
+            VariantPixelBuffer::indices_type idx, blockidx;
+            idx.fill(0);
+            blockidx.fill(0);
+            blockidx[ome::files::DIM_SPATIAL_Z] = static_cast<VariantPixelBuffer::indices_type::value_type>(z);
+            blockidx[ome::files::DIM_CHANNEL] = static_cast<VariantPixelBuffer::indices_type::value_type>(ch);
+            for (dimension_size_type y = 0U; y < 24U; ++y)
+              for (dimension_size_type x = 0U; x < 48U; ++x)
+                for (dimension_size_type s = 0U; s < samples; ++s)
+                  {
+                    idx[ome::files::DIM_SPATIAL_X] = blockidx[ome::files::DIM_SPATIAL_X] =
+                      static_cast<VariantPixelBuffer::indices_type::value_type>(x);
+                    idx[ome::files::DIM_SPATIAL_Y] = blockidx[ome::files::DIM_SPATIAL_Y] =
+                      static_cast<VariantPixelBuffer::indices_type::value_type>(y);
+                    idx[ome::files::DIM_SUBCHANNEL] = blockidx[ome::files::DIM_SUBCHANNEL] =
+                      static_cast<VariantPixelBuffer::indices_type::value_type>(s);
+                    ASSERT_EQ(block.array<uint16_t>()(blockidx), buf.array<uint16_t>()(idx));
+                  }
+          }
+    }
+}
+
+TEST(OMETIFFWriterPlanes, SeparateAndMerge)
+{
+  path file(PROJECT_BINARY_DIR "/test/ome-files/data/planes-separate.ome.tiff");
+
+  std::shared_ptr<CoreMetadata> c(std::make_shared<CoreMetadata>());
+  c->sizeX = 32;
+  c->sizeY = 16;
+  c->sizeZ = 1;
+  c->sizeT = 2;
+  c->sizeC.clear();
+  c->sizeC.push_back(1U);
+  c->sizeC.push_back(1U);
+  c->sizeC.push_back(1U);
+  c->pixelType = ome::xml::model::enums::PixelType::UINT16;
+  c->imageCount = 6;
+  c->orderCertain = true;
+  c->interleaved = false;
+  c->dimensionOrder = ome::xml::model::enums::DimensionOrder::XYZCT;
+  std::vector<std::shared_ptr<CoreMetadata>> seriesList(1, c);
+
+  std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> meta(std::make_shared<::ome::xml::meta::OMEXMLMetadata>());
+  ome::files::fillMetadata(*meta, seriesList);
+
+  std::array<VariantPixelBuffer::size_type, 9> shape;
+  shape[ome::files::DIM_SPATIAL_X] = 32;
+  shape[ome::files::DIM_SPATIAL_Y] = 16;
+  shape[ome::files::DIM_SUBCHANNEL] = 3;
+  shape[ome::files::DIM_SPATIAL_Z] = shape[ome::files::DIM_TEMPORAL_T] = shape[ome::files::DIM_CHANNEL] =
+    shape[ome::files::DIM_MODULO_Z] = shape[ome::files::DIM_MODULO_T] = shape[ome::files::DIM_MODULO_C] = 1;
+
+  // Interleaved subchannels at the first timepoint, and planar
+  // subchannels at the second.
+  std::array<std::shared_ptr<VariantPixelBuffer>, 2> merged;
+  for (dimension_size_type t = 0U; t < 2U; ++t)
+    {
+      merged[t] = std::make_shared<VariantPixelBuffer>
+        (shape, ome::xml::model::enums::PixelType::UINT16,
+         ome::files::PixelBufferBase::make_storage_order(ome::xml::model::enums::DimensionOrder::XYZTC, t == 0U));
+      uint16_t *data = merged[t]->array<uint16_t>().data();
+      for (dimension_size_type i = 0U; i < merged[t]->num_elements(); ++i)
+        data[i] = static_cast<uint16_t>(i + (t * 7U));
+    }
+
+  {
+    OMETIFFWriter writer;
+    writer.setMetadataRetrieve(meta);
+    writer.setInterleaved(false);
+    writer.setId(file);
+
+    for (dimension_size_type t = 0U; t < 2U; ++t)
+      ASSERT_NO_THROW(writer.saveSeparatedBytes(writer.getIndex(0U, 0U, t), *merged[t]));
+
+    // The subchannel count must match the channel count.
+    shape[ome::files::DIM_SUBCHANNEL] = 2;
+    VariantPixelBuffer invalid(shape, ome::xml::model::enums::PixelType::UINT16);
+    EXPECT_THROW(writer.saveSeparatedBytes(0U, invalid), ome::files::FormatException);
+    writer.close();
+  }
+
+  OMETIFFReader reader;
+  ASSERT_NO_THROW(reader.setId(file));
+  ASSERT_EQ(6U, reader.getImageCount());
+  for (dimension_size_type t = 0U; t < 2U; ++t)
+    {
+      for (dimension_size_type ch = 0U; ch < 3U; ++ch)
+        {
+          VariantPixelBuffer buf;
+          ASSERT_NO_THROW(reader.openBytes(reader.getIndex(0U, ch, t), buf));
+          VariantPixelBuffer::indices_type idx, mergedidx;
+          idx.fill(0);
+          mergedidx.fill(0);
+          mergedidx[ome::files::DIM_SUBCHANNEL] = static_cast<VariantPixelBuffer::indices_type::value_type>(ch);
+          for (dimension_size_type y = 0U; y < 16U; ++y)
+            for (dimension_size_type x = 0U; x < 32U; ++x)
+              {
+                idx[ome::files::DIM_SPATIAL_X] = mergedidx[ome::files::DIM_SPATIAL_X] =
+                  static_cast<VariantPixelBuffer::indices_type::value_type>(x);
+                idx[ome::files::DIM_SPATIAL_Y] = mergedidx[ome::files::DIM_SPATIAL_Y] =
+                  static_cast<VariantPixelBuffer::indices_type::value_type>(y);
+                ASSERT_EQ(merged[t]->array<uint16_t>()(mergedidx), buf.array<uint16_t>()(idx));
+              }
+        }
+
+      // Any channel plane at this timepoint selects all channels.
+      VariantPixelBuffer buf;
+      ASSERT_NO_THROW(reader.openMergedBytes(reader.getIndex(0U, 2U, t), buf, 0, 0, 32, 16));
+      EXPECT_EQ(3U, buf.shape()[ome::files::DIM_SUBCHANNEL]);
+      EXPECT_TRUE(*merged[t] == buf);
+    }
+
+  VariantPixelBuffer buf;
+  EXPECT_THROW(reader.openMergedBytes(6U, buf, 0, 0, 32, 16), std::logic_error);
+  EXPECT_THROW(reader.openMergedBytes(0U, buf, 8, 0, 32, 16), std::logic_error);
+}
+
+TEST(OMETIFFWriterPlanes, BlockTooLarge)
+{
+  std::shared_ptr<CoreMetadata> c(std::make_shared<CoreMetadata>());
+  c->sizeX = 16;
+  c->sizeY = 16;
+  c->sizeZ = 4;
+  c->pixelType = ome::xml::model::enums::PixelType::UINT8;
+  c->imageCount = 4;
+  c->orderCertain = true;
+  std::vector<std::shared_ptr<CoreMetadata>> seriesList(1, c);
+
+  std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> meta(std::make_shared<::ome::xml::meta::OMEXMLMetadata>());
+  ome::files::fillMetadata(*meta, seriesList);
+
+  std::array<VariantPixelBuffer::size_type, 9> shape;
+  shape[ome::files::DIM_SPATIAL_X] = shape[ome::files::DIM_SPATIAL_Y] = 16;
+  shape[ome::files::DIM_SPATIAL_Z] = 3;
+  shape[ome::files::DIM_SUBCHANNEL] = shape[ome::files::DIM_TEMPORAL_T] = shape[ome::files::DIM_CHANNEL] =
+    shape[ome::files::DIM_MODULO_Z] = shape[ome::files::DIM_MODULO_T] = shape[ome::files::DIM_MODULO_C] = 1;
+  VariantPixelBuffer block(shape, ome::xml::model::enums::PixelType::UINT8);
+
+  OMETIFFWriter writer;
+  writer.setMetadataRetrieve(meta);
+  writer.setId(PROJECT_BINARY_DIR "/test/ome-files/data/planes-block-large.ome.tiff");
+  EXPECT_THROW(writer.savePlanes(2U, block), ome::files::FormatException);
+  EXPECT_NO_THROW(writer.savePlanes(0U, block));
+}
+
+TEST(OMETIFFWriterMetadata, EveryFile)
+{
+  std::vector<path> files(writeMultiFile("metadata-every", OMETIFFWriter::METADATA_EVERY_FILE));
+
+  std::string first(imageDescription(files[0]));
+  EXPECT_EQ(std::string::npos, first.find("BinaryOnly"));
+  for (const auto& file : files)
+    {
+      std::string description(imageDescription(file));
+      // Identical apart from the root UUID.
+      EXPECT_EQ(first.size(), description.size());
+      EXPECT_EQ(std::string::npos, description.find("BinaryOnly"));
+      checkMultiFile(file);
+    }
+  EXPECT_NE(imageDescription(files[0]), imageDescription(files[1]));
+}
+
+TEST(OMETIFFWriterMetadata, FirstFile)
+{
+  std::vector<path> files(writeMultiFile("metadata-first", OMETIFFWriter::METADATA_FIRST_FILE));
+
+  EXPECT_EQ(std::string::npos, imageDescription(files[0]).find("BinaryOnly"));
+  for (dimension_size_type i = 1U; i < files.size(); ++i)
+    {
+      std::string description(imageDescription(files[i]));
+      EXPECT_NE(std::string::npos, description.find("BinaryOnly"));
+      EXPECT_NE(std::string::npos, description.find(files[0].filename().string()));
+      EXPECT_EQ(std::string::npos, description.find("<Image "));
+    }
+  for (const auto& file : files)
+    checkMultiFile(file);
+}
+
+TEST(OMETIFFWriterMetadata, CompanionFile)
+{
+  std::vector<path> files(writeMultiFile("metadata-companion", OMETIFFWriter::METADATA_COMPANION_FILE));
+
+  path companion(files[0].parent_path() / "metadata-companion-0.companion.ome");
+  ASSERT_TRUE(exists(companion));
+  for (const auto& file : files)
+    {
+      std::string description(imageDescription(file));
+      EXPECT_NE(std::string::npos, description.find("BinaryOnly"));
+      EXPECT_NE(std::string::npos, description.find(companion.filename().string()));
+      checkMultiFile(file);
+    }
+  checkMultiFile(companion);
+}
+
+TEST(OMETIFFWriterMetadata, ConcurrentFinalise)
+{
+  // More files than are finalised concurrently.
+  const dimension_size_type count = 20U;
+  std::vector<path> files(writeMultiFile("metadata-concurrent", OMETIFFWriter::METADATA_EVERY_FILE, count));
+
+  std::set<std::string> descriptions;
+  for (const auto& file : files)
+    descriptions.insert(imageDescription(file));
+  // Each file has a distinct root UUID.
+  EXPECT_EQ(count, descriptions.size());
+  checkMultiFile(files.front(), count);
+  checkMultiFile(files.back(), count);
+}
+
+TEST(OMETIFFWriterMetadata, ConcurrentFileWriters)
+{
+  const dimension_size_type count = 4U;
+  std::vector<path> files(writeMultiFile("file-writers", OMETIFFWriter::METADATA_EVERY_FILE, count, true));
+
+  for (const auto& file : files)
+    checkMultiFile(file, count);
+}
+
+TEST(OMETIFFWriterMetadata, FileWriterDuplicate)
+{
+  std::shared_ptr<CoreMetadata> c(std::make_shared<CoreMetadata>());
+  c->sizeX = 32;
+  c->sizeY = 16;
+  c->pixelType = ome::xml::model::enums::PixelType::UINT8;
+  std::vector<std::shared_ptr<CoreMetadata>> seriesList(2, c);
+
+  std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> meta(std::make_shared<::ome::xml::meta::OMEXMLMetadata>());
+  ome::files::fillMetadata(*meta, seriesList);
+
+  path dir(PROJECT_BINARY_DIR "/test/ome-files/data");
+  OMETIFFWriter writer;
+  writer.setMetadataRetrieve(meta);
+  EXPECT_THROW(writer.createFileWriter(dir / "file-writer-duplicate-1.ome.tiff", 1), std::logic_error);
+  writer.setId(dir / "file-writer-duplicate-0.ome.tiff");
+  EXPECT_THROW(writer.createFileWriter(dir / "file-writer-duplicate-0.ome.tiff", 1), ome::files::FormatException);
+  EXPECT_THROW(writer.createFileWriter(dir / "file-writer-duplicate-1.ome.tiff", 2), std::logic_error);
+
+  std::shared_ptr<OMETIFFWriter> fileWriter(writer.createFileWriter(dir / "file-writer-duplicate-1.ome.tiff", 1));
+  EXPECT_THROW(writer.createFileWriter(dir / "file-writer-duplicate-1.ome.tiff", 1), ome::files::FormatException);
+  EXPECT_THROW(writer.setId(dir / "file-writer-duplicate-1.ome.tiff"), ome::files::FormatException);
+  // The file writer is still open.
+  EXPECT_THROW(writer.close(), ome::files::FormatException);
+}
+
+namespace
+{
+
+  // Count OME-XML parses.
+  class ParseCounter : public ome::files::TraceObserver
+  {
+  public:
+    dimension_size_type parses = 0U;
+
+    void
+    begin(Event          event,
+          const Context& /* context */)
+    {
+      if (event == XML_PARSE)
+        ++parses;
+    }
+
+    void
+    end(Event          /* event */,
+        const Context& /* context */)
+    {
+    }
+  };
+
+}
+
+TEST(OMETIFFReaderMemo, Reopen)
+{
+  std::vector<path> files(writeMultiFile("memo", OMETIFFWriter::METADATA_EVERY_FILE));
+  path memodir(PROJECT_BINARY_DIR "/test/ome-files/data/memo-reader");
+  remove_all(memodir);
+
+  std::shared_ptr<ParseCounter> counter(std::make_shared<ParseCounter>());
+  ome::files::setTraceObserver(counter);
+
+  std::vector<path> usedFiles;
+  {
+    OMETIFFReader reader;
+    reader.setMemoDirectory(memodir);
+    EXPECT_EQ(memodir, reader.getMemoDirectory());
+    ASSERT_NO_THROW(reader.setId(files[0]));
+    usedFiles = reader.getUsedFiles();
+    EXPECT_TRUE(exists(ome::files::memoFile(memodir, canonical(files[0]))));
+  }
+  EXPECT_LT(0U, counter->parses);
+
+  // Reopen from the memo, without parsing.
+  counter->parses = 0U;
+  {
+    OMETIFFReader reader;
+    reader.setMemoDirectory(memodir);
+    ASSERT_NO_THROW(reader.setId(files[0]));
+    EXPECT_EQ(0U, counter->parses);
+    EXPECT_EQ(usedFiles, reader.getUsedFiles());
+    ASSERT_EQ(3U, reader.getSeriesCount());
+    for (dimension_size_type i = 0U; i < 3U; ++i)
+      {
+        reader.setSeries(i);
+        EXPECT_EQ(32U, reader.getSizeX());
+        EXPECT_EQ(16U, reader.getSizeY());
+        EXPECT_EQ(1U, reader.getImageCount());
+        EXPECT_EQ(ome::xml::model::enums::PixelType::UINT8, reader.getPixelType());
+        VariantPixelBuffer buf;
+        ASSERT_NO_THROW(reader.openBytes(0, buf));
+        EXPECT_EQ(static_cast<uint8_t>(i + 1U), *buf.array<uint8_t>().data());
+      }
+  }
+
+  // A memo is not used if a source file is modified.
+  writeMultiFile("memo", OMETIFFWriter::METADATA_FIRST_FILE);
+  counter->parses = 0U;
+  {
+    OMETIFFReader reader;
+    reader.setMemoDirectory(memodir);
+    ASSERT_NO_THROW(reader.setId(files[0]));
+    EXPECT_LT(0U, counter->parses);
+    EXPECT_EQ(3U, reader.getSeriesCount());
+  }
+
+  ome::files::setTraceObserver(std::shared_ptr<ome::files::TraceObserver>());
+}
+
+TEST(OMETIFFReaderFiles, MaxOpenFiles)
+{
+  const dimension_size_type count = 12U;
+  std::vector<path> files(writeMultiFile("max-open", OMETIFFWriter::METADATA_EVERY_FILE, count));
+
+  for (bool validate : {false, true})
+    {
+      OMETIFFReader reader;
+      EXPECT_FALSE(reader.getFileValidation());
+      reader.setFileValidation(validate);
+      EXPECT_EQ(validate, reader.getFileValidation());
+      reader.setMaxOpenFiles(3U);
+      EXPECT_EQ(3U, reader.getMaxOpenFiles());
+      ASSERT_NO_THROW(reader.setId(files[0]));
+      ASSERT_EQ(count, reader.getSeriesCount());
+
+      // Reopen closed files several times.
+      for (dimension_size_type pass = 0U; pass < 2U; ++pass)
+        for (dimension_size_type i = 0U; i < count; ++i)
+          {
+            reader.setSeries((i * 5U) % count);
+            VariantPixelBuffer buf;
+            ASSERT_NO_THROW(reader.openBytes(0, buf));
+            EXPECT_EQ(static_cast<uint8_t>(((i * 5U) % count) + 1U), *buf.array<uint8_t>().data());
+          }
+
+      // Reducing the limit closes files.
+      EXPECT_NO_THROW(reader.setMaxOpenFiles(1U));
+      reader.setSeries(count - 1U);
+      VariantPixelBuffer buf;
+      ASSERT_NO_THROW(reader.openBytes(0, buf));
+      EXPECT_EQ(static_cast<uint8_t>(count), *buf.array<uint8_t>().data());
+    }
+}
+
+TEST(OMETIFFReaderFiles, ConcurrentOpen)
+{
+  const dimension_size_type count = 12U;
+  std::vector<path> files(writeMultiFile("concurrent-open", OMETIFFWriter::METADATA_EVERY_FILE, count));
+
+  for (bool validate : {false, true})
+    {
+      // Workers are submitted to open the files concurrently; the
+      // results do not depend upon the order in which they run.
+      std::atomic<unsigned int> submitted(0U);
+      std::shared_ptr<ome::files::Executor> executor
+        (std::make_shared<ome::files::FunctionExecutor>([&submitted](const ome::files::Executor::task_type& task)
+                                                        {
+                                                          ++submitted;
+                                                          task();
+                                                        }, 4U));
+
+      OMETIFFReader reader;
+      reader.setExecutor(executor);
+      reader.setFileValidation(validate);
+      reader.setMaxOpenFiles(3U);
+      ASSERT_NO_THROW(reader.setId(files[0]));
+      EXPECT_LT(0U, submitted);
+      ASSERT_EQ(count, reader.getSeriesCount());
+
+      for (dimension_size_type i = 0U; i < count; ++i)
+        {
+          reader.setSeries(i);
+          EXPECT_EQ(32U, reader.getSizeX());
+          EXPECT_EQ(16U, reader.getSizeY());
+          EXPECT_EQ(ome::xml::model::enums::PixelType::UINT8, reader.getPixelType());
+          VariantPixelBuffer buf;
+          ASSERT_NO_THROW(reader.openBytes(0, buf));
+          EXPECT_EQ(static_cast<uint8_t>(i + 1U), *buf.array<uint8_t>().data());
+        }
+    }
+}
+
+namespace
+{
+
+  // Source reading a file's content from memory.
+  class MemorySource : public ome::files::tiff::IOSource
+  {
+  public:
+    MemorySource(const path&        file,
+                 const std::string& content):
+      file(file),
+      content(content)
+    {}
+
+    std::string
+    name() const
+    {
+      return file.string();
+    }
+
+    uint64_t
+    size() const
+    {
+      return content.size();
+    }
+
+    std::size_t
+    read(uint64_t    offset,
+         void       *buffer,
+         std::size_t size)
+    {
+      if (offset >= content.size())
+        return 0U;
+      size = std::min(size, static_cast<std::size_t>(content.size() - offset));
+      std::memcpy(buffer, content.data() + offset, size);
+      return size;
+    }
+
+    path        file;
+    std::string content;
+  };
+
+  // Copy files into memory, under a directory which does not
+  // exist, so they may only be read using the returned factory.
+  ome::files::tiff::IOSourceFactory
+  memoryFactory(const std::vector<path>& files,
+                const path&              dir,
+                std::size_t&             calls)
+  {
+    std::shared_ptr<std::map<path, std::string>> content(std::make_shared<std::map<path, std::string>>());
+    for (const auto& file : files)
+      {
+        boost::filesystem::ifstream in(file, std::ios::in | std::ios::binary);
+        (*content)[dir / file.filename()].assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+      }
+
+    return [content, &calls](const path& file) -> std::shared_ptr<ome::files::tiff::IOSource>
+      {
+        ++calls;
+        auto i = content->find(file);
+        if (i == content->end())
+          return std::shared_ptr<ome::files::tiff::IOSource>();
+        return std::make_shared<MemorySource>(i->first, i->second);
+      };
+  }
+
+}
+
+TEST(OMETIFFReaderFiles, SourceFactory)
+{
+  const path dir(PROJECT_BINARY_DIR "/test/ome-files/data/nonexistent");
+  ASSERT_FALSE(exists(dir));
+
+  // BinaryOnly metadata in the first file, and in a companion file.
+  for (const auto storage : {OMETIFFWriter::METADATA_FIRST_FILE, OMETIFFWriter::METADATA_COMPANION_FILE})
+    {
+      const bool companion = storage == OMETIFFWriter::METADATA_COMPANION_FILE;
+      const std::string name(companion ? "source-factory-companion" : "source-factory-first");
+      std::vector<path> files(writeMultiFile(name, storage));
+      if (companion)
+        files.push_back(files[0].parent_path() / (name + "-0.companion.ome"));
+
+      std::size_t calls = 0U;
+      OMETIFFReader reader;
+      reader.setIOSourceFactory(memoryFactory(files, dir, calls));
+      ASSERT_NO_THROW(reader.setId(dir / (companion ? files.back() : files[1]).filename()));
+      EXPECT_LT(0U, calls);
+      ASSERT_EQ(3U, reader.getSeriesCount());
+
+      // All the files were found, by name, in the missing directory.
+      const std::vector<path> used(reader.getUsedFiles());
+      EXPECT_LE(3U, used.size());
+      for (const auto& file : used)
+        EXPECT_EQ(dir, file.parent_path());
+
+      for (dimension_size_type i = 0U; i < 3U; ++i)
+        {
+          reader.setSeries(i);
+          VariantPixelBuffer buf;
+          ASSERT_NO_THROW(reader.openBytes(0, buf));
+          EXPECT_EQ(static_cast<uint8_t>(i + 1U), *buf.array<uint8_t>().data());
+          EXPECT_EQ(1U, reader.getImageMetadata(i)->getImageCount());
+        }
+    }
+}
+
+TEST(OMETIFFReaderMetadata, PixelsOnly)
+{
+  std::vector<path> files(writeMultiFile("pixels-only", OMETIFFWriter::METADATA_EVERY_FILE));
+
+  std::shared_ptr<ome::xml::meta::OMEXMLMetadata> omexml(std::make_shared<ome::xml::meta::OMEXMLMetadata>());
+  std::shared_ptr<ome::xml::meta::MetadataStore> store(omexml);
+
+  OMETIFFReader reader;
+  reader.setMetadataStore(store);
+  reader.setMetadataOptions(ome::files::MetadataOptions(ome::files::MetadataOptions::METADATA_PIXELS));
+  ASSERT_NO_THROW(reader.setId(files[0]));
+
+  // Pixel access does not fill the metadata store.
+  ASSERT_EQ(3U, reader.getSeriesCount());
+  for (dimension_size_type i = 0U; i < 3U; ++i)
+    {
+      reader.setSeries(i);
+      EXPECT_EQ(32U, reader.getSizeX());
+      EXPECT_EQ(16U, reader.getSizeY());
+      VariantPixelBuffer buf;
+      ASSERT_NO_THROW(reader.openBytes(0, buf));
+      EXPECT_EQ(static_cast<uint8_t>(i + 1U), *buf.array<uint8_t>().data());
+    }
+  EXPECT_EQ(0U, omexml->getImageCount());
+
+  // The store is filled on first access, preserving the reader state.
+  reader.setSeries(2U);
+  ASSERT_TRUE(static_cast<bool>(reader.getMetadataStore()));
+  EXPECT_EQ(2U, reader.getSeries());
+  ASSERT_EQ(3U, omexml->getImageCount());
+  for (dimension_size_type i = 0U; i < 3U; ++i)
+    EXPECT_EQ(32U, static_cast<dimension_size_type>(omexml->getPixelsSizeX(i)));
+}
+
+TEST(OMETIFFReaderMetadata, ImageMetadata)
+{
+  std::vector<path> files(writeMultiFile("image-metadata", OMETIFFWriter::METADATA_EVERY_FILE));
+
+  OMETIFFReader reader;
+  reader.setMetadataOptions(ome::files::MetadataOptions(ome::files::MetadataOptions::METADATA_PIXELS));
+  ASSERT_NO_THROW(reader.setId(files[1]));
+  ASSERT_EQ(3U, reader.getSeriesCount());
+
+  for (dimension_size_type i = 0U; i < 3U; ++i)
+    {
+      std::shared_ptr<ome::xml::meta::OMEXMLMetadata> meta;
+      ASSERT_NO_THROW(meta = reader.getImageMetadata(i));
+      ASSERT_EQ(1U, meta->getImageCount());
+      EXPECT_EQ(32U, static_cast<dimension_size_type>(meta->getPixelsSizeX(0)));
+      EXPECT_EQ(16U, static_cast<dimension_size_type>(meta->getPixelsSizeY(0)));
+      EXPECT_EQ(meta, reader.getImageMetadata(i));
+    }
+  EXPECT_THROW(reader.getImageMetadata(3U), std::out_of_range);
+}
+
+TEST(OMETIFFReaderMetadata, SharedCoreMetadata)
+{
+  std::vector<path> files(writeMultiFile("shared-core", OMETIFFWriter::METADATA_EVERY_FILE));
+
+  OMETIFFReader reader;
+  ASSERT_NO_THROW(reader.setId(files[0]));
+  ASSERT_EQ(3U, reader.getSeriesCount());
+
+  // Series with identical geometry share one record.
+  const std::vector<std::shared_ptr<CoreMetadata>>& core(reader.getCoreMetadataList());
+  ASSERT_EQ(3U, core.size());
+  EXPECT_EQ(core[0], core[1]);
+  EXPECT_EQ(core[0], core[2]);
+
+  // The planes of each series are still distinct.
+  for (dimension_size_type i = 0U; i < 3U; ++i)
+    {
+      reader.setSeries(i);
+      EXPECT_EQ(32U, reader.getSizeX());
+      EXPECT_EQ(std::vector<path>(1, canonical(files[i])), reader.getSeriesUsedFiles());
+      VariantPixelBuffer buf;
+      ASSERT_NO_THROW(reader.openBytes(0, buf));
+      EXPECT_EQ(static_cast<uint8_t>(i + 1U), *buf.array<uint8_t>().data());
+    }
+}
+
 std::vector<TIFFTestParameters> params(find_tiff_tests());
 
 // Disable missing-prototypes warning for INSTANTIATE_TEST_CASE_P;
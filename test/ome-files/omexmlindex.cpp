@@ -0,0 +1,147 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2014 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <stdexcept>
+#include <string>
+
+#include <ome/files/MetadataTools.h>
+#include <ome/files/OMEXMLIndex.h>
+
+#include <ome/test/test.h>
+#include <ome/test/io.h>
+
+using ome::files::OMEXMLIndex;
+
+namespace
+{
+
+  const std::string document
+  ("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+   "<!-- <Image ID=\"Image:comment\"/> -->\n"
+   "<OME xmlns=\"http://www.openmicroscopy.org/Schemas/OME/2016-06\">"
+   "<Instrument ID=\"Instrument:0\"><AnnotationRef ID=\"Annotation:Instrument\"/></Instrument>"
+   "<Image ID=\"Image:0\"><Pixels ID=\"Pixels:0\"/>"
+   "<AnnotationRef ID=\"Annotation:0\"/><ROIRef ID=\"ROI:0\"/></Image>"
+   "<Image ID=\"Image:1\"><![CDATA[<Image ID=\"Image:cdata\">]]><Pixels ID=\"Pixels:1\"/>"
+   "<AnnotationRef ID='Annotation:1'/></Image>"
+   "<StructuredAnnotations>"
+   "<CommentAnnotation ID=\"Annotation:0\"><AnnotationRef ID=\"Annotation:Nested\"/></CommentAnnotation>"
+   "<CommentAnnotation ID=\"Annotation:1\"/>"
+   "<CommentAnnotation ID=\"Annotation:Nested\"/>"
+   "<TagAnnotation ID=\"Annotation:Instrument\"/>"
+   "<TagAnnotation ID=\"Annotation:Unused\"/>"
+   "</StructuredAnnotations>"
+   "<ROI ID=\"ROI:0\"><Union/></ROI><ROI ID=\"ROI:1\"><Union/></ROI>"
+   "</OME>\n");
+
+  bool
+  contains(const std::string& text,
+           const std::string& s)
+  {
+    return text.find(s) != std::string::npos;
+  }
+
+}
+
+TEST(OMEXMLIndex, Images)
+{
+  OMEXMLIndex index(document);
+  ASSERT_EQ(2U, index.getImageCount());
+  EXPECT_EQ("Image:0", index.getImageID(0));
+  EXPECT_EQ("Image:1", index.getImageID(1));
+  EXPECT_THROW(index.getImageID(2), std::out_of_range);
+  EXPECT_THROW(index.getImageText(2), std::out_of_range);
+}
+
+TEST(OMEXMLIndex, ImageText)
+{
+  OMEXMLIndex index(document);
+
+  const std::string image0(index.getImageText(0));
+  EXPECT_TRUE(contains(image0, "Instrument:0"));
+  EXPECT_TRUE(contains(image0, "Pixels:0"));
+  EXPECT_FALSE(contains(image0, "Pixels:1"));
+  EXPECT_TRUE(contains(image0, "<CommentAnnotation ID=\"Annotation:0\">"));
+  EXPECT_TRUE(contains(image0, "<CommentAnnotation ID=\"Annotation:Nested\"/>"));
+  EXPECT_TRUE(contains(image0, "<TagAnnotation ID=\"Annotation:Instrument\"/>"));
+  EXPECT_FALSE(contains(image0, "<CommentAnnotation ID=\"Annotation:1\"/>"));
+  EXPECT_FALSE(contains(image0, "Annotation:Unused"));
+  EXPECT_TRUE(contains(image0, "<ROI ID=\"ROI:0\">"));
+  EXPECT_FALSE(contains(image0, "ROI:1"));
+
+  const std::string image1(index.getImageText(1));
+  EXPECT_TRUE(contains(image1, "Pixels:1"));
+  EXPECT_FALSE(contains(image1, "Pixels:0"));
+  EXPECT_TRUE(contains(image1, "<CommentAnnotation ID=\"Annotation:1\"/>"));
+  EXPECT_FALSE(contains(image1, "Annotation:Nested"));
+  EXPECT_FALSE(contains(image1, "<ROI"));
+  EXPECT_TRUE(contains(image1, "</OME>"));
+}
+
+TEST(OMEXMLIndex, Malformed)
+{
+  EXPECT_THROW(OMEXMLIndex("<OME><Image ID=\"Image:0\"></OME>"), std::runtime_error);
+  EXPECT_THROW(OMEXMLIndex("<OME><Image ID=Image:0/></OME>"), std::runtime_error);
+  EXPECT_THROW(OMEXMLIndex("<OME/><OME/>"), std::runtime_error);
+  EXPECT_THROW(OMEXMLIndex(""), std::runtime_error);
+
+  OMEXMLIndex empty("<OME/>");
+  EXPECT_EQ(0U, empty.getImageCount());
+}
+
+TEST(OMEXMLIndex, ImageMetadata)
+{
+  std::string text;
+  readFile(PROJECT_SOURCE_DIR "/test/ome-files/data/validchannels.ome", text);
+
+  std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> complete(ome::files::createOMEXMLMetadata(text));
+
+  OMEXMLIndex index(text);
+  ASSERT_EQ(complete->getImageCount(), index.getImageCount());
+  for (ome::files::dimension_size_type i = 0; i < index.getImageCount(); ++i)
+    {
+      std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> meta(index.getImageMetadata(i));
+      ASSERT_TRUE(static_cast<bool>(meta));
+      ASSERT_EQ(1U, meta->getImageCount());
+      EXPECT_EQ(complete->getImageID(i), meta->getImageID(0));
+      EXPECT_EQ(complete->getPixelsSizeX(i), meta->getPixelsSizeX(0));
+      EXPECT_EQ(complete->getChannelCount(i), meta->getChannelCount(0));
+      // Parsed once, and cached.
+      EXPECT_EQ(meta, index.getImageMetadata(i));
+    }
+}
@@ -0,0 +1,173 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2014 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include <ome/files/MetadataTools.h>
+#include <ome/files/OMEXMLStream.h>
+
+#include <ome/test/test.h>
+#include <ome/test/io.h>
+
+namespace
+{
+
+  const std::string document
+  ("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+   "<OME xmlns=\"http://www.openmicroscopy.org/Schemas/OME/2016-06\""
+   " UUID=\"urn:uuid:2d4b2f4e-8a5c-4a43-9d2c-3f7e0e5c1a10\" Creator=\"test\">"
+   "<Plate ID=\"Plate:0\" Name=\"Plate &amp; &lt;0&gt;\" Rows=\"1\" Columns=\"2\">"
+   "<Description>Two wells</Description>"
+   "<Well ID=\"Well:0\" Column=\"0\" Row=\"0\">"
+   "<WellSample ID=\"WellSample:0\" Index=\"0\" PositionX=\"1.5\" PositionXUnit=\"mm\">"
+   "<ImageRef ID=\"Image:0\"/></WellSample></Well>"
+   "<Well ID=\"Well:1\" Column=\"1\" Row=\"0\">"
+   "<WellSample ID=\"WellSample:1\" Index=\"1\"><ImageRef ID=\"Image:1\"/></WellSample></Well>"
+   "</Plate>"
+   "<Image ID=\"Image:0\" Name=\"&quot;first&quot;\">"
+   "<AcquisitionDate>2016-06-01T12:00:00</AcquisitionDate>"
+   "<Pixels ID=\"Pixels:0\" DimensionOrder=\"XYZCT\" Type=\"uint16\" SignificantBits=\"12\""
+   " BigEndian=\"false\" Interleaved=\"false\""
+   " SizeX=\"4\" SizeY=\"2\" SizeZ=\"1\" SizeC=\"2\" SizeT=\"1\""
+   " PhysicalSizeX=\"0.1\" PhysicalSizeXUnit=\"µm\">"
+   "<Channel ID=\"Channel:0:0\" Name=\"DAPI\" SamplesPerPixel=\"1\" Color=\"-16776961\">"
+   "<AnnotationRef ID=\"Annotation:0\"/></Channel>"
+   "<Channel ID=\"Channel:0:1\" SamplesPerPixel=\"1\"/>"
+   "<TiffData IFD=\"0\" FirstC=\"0\" PlaneCount=\"1\">"
+   "<UUID FileName=\"a.ome.tiff\">urn:uuid:2d4b2f4e-8a5c-4a43-9d2c-3f7e0e5c1a10</UUID></TiffData>"
+   "<TiffData IFD=\"1\" FirstC=\"1\" PlaneCount=\"1\"/>"
+   "<Plane TheZ=\"0\" TheT=\"0\" TheC=\"0\" DeltaT=\"0.25\" DeltaTUnit=\"s\" ExposureTime=\"10\" ExposureTimeUnit=\"ms\"/>"
+   "<Plane TheZ=\"0\" TheT=\"0\" TheC=\"1\"><HashSHA1>0123456789abcdef0123456789abcdef01234567</HashSHA1></Plane>"
+   "</Pixels>"
+   "<AnnotationRef ID=\"Annotation:0\"/>"
+   "</Image>"
+   "<Image ID=\"Image:1\">"
+   "<Pixels ID=\"Pixels:1\" DimensionOrder=\"XYCZT\" Type=\"uint8\""
+   " SizeX=\"1\" SizeY=\"1\" SizeZ=\"1\" SizeC=\"1\" SizeT=\"1\">"
+   "<Channel ID=\"Channel:1:0\" SamplesPerPixel=\"1\"/>"
+   "<TiffData/>"
+   "</Pixels>"
+   "</Image>"
+   "<StructuredAnnotations>"
+   "<XMLAnnotation ID=\"Annotation:0\" Namespace=\"test\">"
+   "<Description>Nested &lt;XML&gt;</Description>"
+   "<Value><Test xmlns=\"urn:test\" Attribute=\"a&amp;b\">Content</Test></Value>"
+   "</XMLAnnotation>"
+   "</StructuredAnnotations>"
+   "</OME>\n");
+
+  bool
+  contains(const std::string& text,
+           const std::string& s)
+  {
+    return text.find(s) != std::string::npos;
+  }
+
+}
+
+TEST(OMEXMLStream, Write)
+{
+  std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> meta(ome::files::createOMEXMLMetadata(document));
+  meta->resolveReferences();
+  ASSERT_TRUE(ome::files::canWriteOMEXML(*meta));
+
+  std::ostringstream stream;
+  ASSERT_NO_THROW(ome::files::writeOMEXML(*meta, stream));
+  const std::string streamed(stream.str());
+  EXPECT_TRUE(ome::files::validateOMEXML(streamed));
+
+  // Equivalent to the metadata serialised with a DOM.
+  std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> reread(ome::files::createOMEXMLMetadata(streamed));
+  EXPECT_EQ(ome::files::getOMEXML(*meta, false), ome::files::getOMEXML(*reread, false));
+
+  EXPECT_TRUE(contains(streamed, "UUID=\"urn:uuid:2d4b2f4e-8a5c-4a43-9d2c-3f7e0e5c1a10\""));
+  EXPECT_TRUE(contains(streamed, "Name=\"Plate &amp; &lt;0&gt;\""));
+  EXPECT_TRUE(contains(streamed, "Name=\"&quot;first&quot;\""));
+  EXPECT_TRUE(contains(streamed, "<TiffData/>"));
+  EXPECT_EQ(2U, reread->getPlaneCount(0));
+  EXPECT_EQ(2U, reread->getTiffDataCount(0));
+  EXPECT_EQ(std::string("Image:1"), reread->getWellSampleImageRef(0, 1, 0));
+}
+
+TEST(OMEXMLStream, WriteUUID)
+{
+  std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> meta(ome::files::createOMEXMLMetadata(document));
+  meta->resolveReferences();
+
+  const std::string uuid("urn:uuid:9a0e6f1c-5b9d-4f0e-8d55-0a2b6c7d8e9f");
+  std::ostringstream stream;
+  ASSERT_NO_THROW(ome::files::writeOMEXML(*meta, stream, uuid));
+  std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> reread(ome::files::createOMEXMLMetadata(stream.str()));
+  EXPECT_EQ(uuid, reread->getUUID());
+  // The metadata is not modified.
+  EXPECT_EQ(std::string("urn:uuid:2d4b2f4e-8a5c-4a43-9d2c-3f7e0e5c1a10"), meta->getUUID());
+}
+
+TEST(OMEXMLStream, Unsupported)
+{
+  std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> meta
+    (ome::files::createOMEXMLMetadata("<OME xmlns=\"http://www.openmicroscopy.org/Schemas/OME/2016-06\">"
+                                      "<Instrument ID=\"Instrument:0\"/>"
+                                      "</OME>"));
+  meta->resolveReferences();
+  EXPECT_FALSE(ome::files::canWriteOMEXML(*meta));
+
+  std::ostringstream stream;
+  EXPECT_THROW(ome::files::writeOMEXML(*meta, stream), std::logic_error);
+  EXPECT_TRUE(stream.str().empty());
+}
+
+TEST(OMEXMLStream, MetadataOnly)
+{
+  std::string text;
+  readFile(PROJECT_SOURCE_DIR "/test/ome-files/data/validchannels.ome", text);
+
+  // MetadataOnly is not written by the streaming serialiser.
+  std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> meta(ome::files::createOMEXMLMetadata(text));
+  meta->resolveReferences();
+  EXPECT_FALSE(ome::files::canWriteOMEXML(*meta));
+
+  ome::files::removeBinData(*meta);
+  EXPECT_TRUE(ome::files::canWriteOMEXML(*meta));
+
+  std::ostringstream stream;
+  ASSERT_NO_THROW(ome::files::writeOMEXML(*meta, stream));
+  std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> reread(ome::files::createOMEXMLMetadata(stream.str()));
+  EXPECT_EQ(ome::files::getOMEXML(*meta, false), ome::files::getOMEXML(*reread, false));
+}
@@ -0,0 +1,419 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2013 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <algorithm>
+#include <array>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/filesystem/operations.hpp>
+
+#include <ome/files/CoreMetadata.h>
+#include <ome/files/FormatException.h>
+#include <ome/files/MetadataTools.h>
+#include <ome/files/VariantPixelBuffer.h>
+#include <ome/files/out/OMEZarrWriter.h>
+#include <ome/files/tiff/Codec.h>
+
+#include <ome/xml/meta/OMEXMLMetadata.h>
+
+#include <ome/test/test.h>
+
+using ome::files::dimension_size_type;
+using ome::files::CoreMetadata;
+using ome::files::FormatException;
+using ome::files::VariantPixelBuffer;
+using ome::files::out::OMEZarrWriter;
+
+using namespace boost::filesystem;
+
+namespace
+{
+
+  // 50×30 UINT16 image with 3 Z, 2 channels (the second RGB) and 2
+  // timepoints; 12 planes in XYZCT order.
+  std::shared_ptr<::ome::xml::meta::OMEXMLMetadata>
+  makeMetadata()
+  {
+    std::shared_ptr<CoreMetadata> c(std::make_shared<CoreMetadata>());
+    c->sizeX = 50;
+    c->sizeY = 30;
+    c->sizeZ = 3;
+    c->sizeT = 2;
+    c->sizeC.clear();
+    c->sizeC.push_back(1);
+    c->sizeC.push_back(3);
+    c->pixelType = ome::xml::model::enums::PixelType::UINT16;
+    c->imageCount = 12;
+    c->orderCertain = true;
+    c->interleaved = false;
+    c->dimensionOrder = ome::xml::model::enums::DimensionOrder::XYZCT;
+    std::vector<std::shared_ptr<CoreMetadata>> seriesList(1, c);
+
+    std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> meta(std::make_shared<::ome::xml::meta::OMEXMLMetadata>());
+    ome::files::fillMetadata(*meta, seriesList);
+    return meta;
+  }
+
+  std::array<VariantPixelBuffer::size_type, 9>
+  regionShape(dimension_size_type w,
+              dimension_size_type h,
+              dimension_size_type samples)
+  {
+    std::array<VariantPixelBuffer::size_type, 9> shape;
+    shape.fill(1U);
+    shape[ome::files::DIM_SPATIAL_X] = w;
+    shape[ome::files::DIM_SPATIAL_Y] = h;
+    shape[ome::files::DIM_SUBCHANNEL] = samples;
+    return shape;
+  }
+
+  // Expected pixel value of a plane sample.
+  uint16_t
+  pixelValue(dimension_size_type plane,
+             dimension_size_type sample,
+             dimension_size_type x,
+             dimension_size_type y)
+  {
+    return static_cast<uint16_t>((plane * 4000U) + (sample * 1500U) + (y * 50U) + x);
+  }
+
+  // Fill a region buffer with expected pixel values.
+  void
+  fillRegion(VariantPixelBuffer& buf,
+             dimension_size_type plane,
+             dimension_size_type x,
+             dimension_size_type y)
+  {
+    auto& array(buf.array<uint16_t>());
+    const VariantPixelBuffer::size_type *shape(buf.shape());
+    VariantPixelBuffer::indices_type idx;
+    std::fill(idx.begin(), idx.end(), 0);
+    for (dimension_size_type s = 0U; s < shape[ome::files::DIM_SUBCHANNEL]; ++s)
+      for (dimension_size_type j = 0U; j < shape[ome::files::DIM_SPATIAL_Y]; ++j)
+        for (dimension_size_type i = 0U; i < shape[ome::files::DIM_SPATIAL_X]; ++i)
+          {
+            idx[ome::files::DIM_SPATIAL_X] = i;
+            idx[ome::files::DIM_SPATIAL_Y] = j;
+            idx[ome::files::DIM_SUBCHANNEL] = s;
+            array(idx) = pixelValue(plane, s, x + i, y + j);
+          }
+  }
+
+  std::string
+  readFile(const path& file)
+  {
+    std::ifstream in(file.string().c_str(), std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in),
+                       std::istreambuf_iterator<char>());
+  }
+
+  // Read a 16×16 chunk, decompressing if compressed with zlib.
+  std::string
+  readChunk(const path& file,
+            bool        compressed)
+  {
+    std::string data(readFile(file));
+    if (!compressed)
+      return data;
+
+    ome::files::tiff::TileCodecParameters params;
+    params.scheme = ome::files::tiff::COMPRESSION_DEFLATE;
+    params.pixeltype = ome::xml::model::enums::PixelType::UINT16;
+    params.width = 16U;
+    params.height = 16U;
+    params.samples = 1U;
+    params.level = -1;
+    std::string decoded(16U * 16U * sizeof(uint16_t), '\0');
+    decoded.resize(ome::files::tiff::getTileCodec(ome::files::tiff::COMPRESSION_DEFLATE)->
+                   decode(params, data.data(), data.size(), &decoded[0], decoded.size()));
+    return decoded;
+  }
+
+  // Check a 16×16 chunk against the expected pixel values.
+  void
+  checkChunk(const path&         root,
+             dimension_size_type t,
+             dimension_size_type c,
+             dimension_size_type z,
+             dimension_size_type cy,
+             dimension_size_type cx,
+             bool                compressed = false)
+  {
+    // XYZCT plane index and sample.
+    const dimension_size_type channel = c ? 1U : 0U;
+    const dimension_size_type sample = c ? c - 1U : 0U;
+    const dimension_size_type plane = z + (channel * 3U) + (t * 6U);
+
+    path file(root / "0" / "0" / std::to_string(t) / std::to_string(c) /
+              std::to_string(z) / std::to_string(cy) / std::to_string(cx));
+    ASSERT_TRUE(exists(file)) << file;
+    std::string data(readChunk(file, compressed));
+    ASSERT_EQ(16U * 16U * sizeof(uint16_t), data.size());
+    const uint16_t *pixels = reinterpret_cast<const uint16_t *>(data.data());
+    for (dimension_size_type j = 0U; j < 16U; ++j)
+      for (dimension_size_type i = 0U; i < 16U; ++i)
+        {
+          const dimension_size_type x = (cx * 16U) + i;
+          const dimension_size_type y = (cy * 16U) + j;
+          const uint16_t expected = (x < 50U && y < 30U) ? pixelValue(plane, sample, x, y) : 0U;
+          ASSERT_EQ(expected, pixels[(j * 16U) + i]) << file << " at " << i << "," << j;
+        }
+  }
+
+}
+
+TEST(OMEZarrWriter, Metadata)
+{
+  path dir(PROJECT_BINARY_DIR "/test/ome-files/data/omezarrwriter-metadata.zarr");
+  remove_all(dir);
+
+  OMEZarrWriter writer;
+  writer.setMetadataRetrieve(makeMetadata());
+  writer.setTileSizeX(16U);
+  writer.setTileSizeY(16U);
+  ASSERT_NO_THROW(writer.setId(dir));
+  EXPECT_EQ(16U, writer.getTileSizeX());
+  EXPECT_EQ(16U, writer.getTileSizeY());
+  writer.close();
+
+  EXPECT_TRUE(exists(dir / ".zgroup"));
+  EXPECT_NE(std::string::npos, readFile(dir / ".zattrs").find("\"bioformats2raw.layout\" : 3"));
+  EXPECT_NE(std::string::npos, readFile(dir / "OME" / "METADATA.ome.xml").find("<OME"));
+  EXPECT_NE(std::string::npos, readFile(dir / "0" / ".zattrs").find("\"multiscales\""));
+
+  std::string zarray(readFile(dir / "0" / "0" / ".zarray"));
+  EXPECT_NE(std::string::npos, zarray.find("\"shape\" : [ 2, 4, 3, 30, 50 ]"));
+  EXPECT_NE(std::string::npos, zarray.find("\"chunks\" : [ 1, 1, 1, 16, 16 ]"));
+  EXPECT_NE(std::string::npos, zarray.find("\"dimension_separator\" : \"/\""));
+  EXPECT_NE(std::string::npos, zarray.find("\"compressor\" : null"));
+}
+
+TEST(OMEZarrWriter, ConcurrentPlanes)
+{
+  path dir(PROJECT_BINARY_DIR "/test/ome-files/data/omezarrwriter-concurrent.zarr");
+  remove_all(dir);
+
+  OMEZarrWriter writer;
+  writer.setMetadataRetrieve(makeMetadata());
+  writer.setTileSizeX(16U);
+  writer.setTileSizeY(16U);
+  ASSERT_NO_THROW(writer.setId(dir));
+
+  // Each plane is saved from its own thread, in reverse order, as
+  // top and bottom halves which do not align with the chunks.
+  std::vector<std::thread> threads;
+  std::vector<std::exception_ptr> errors(12U);
+  for (dimension_size_type t = 0U; t < 12U; ++t)
+    threads.emplace_back([&, t]()
+      {
+        try
+          {
+            const dimension_size_type p = 11U - t;
+            const dimension_size_type samples = ((p / 3U) % 2U) ? 3U : 1U;
+            for (dimension_size_type y : {0U, 13U})
+              {
+                const dimension_size_type h = y ? 17U : 13U;
+                VariantPixelBuffer buf(regionShape(50U, h, samples),
+                                       ome::xml::model::enums::PixelType::UINT16);
+                fillRegion(buf, p, 0U, y);
+                writer.saveRegion(0U, p, buf, 0U, y, 50U, h);
+              }
+          }
+        catch (...)
+          {
+            errors[t] = std::current_exception();
+          }
+      });
+  for (auto& thread : threads)
+    thread.join();
+  for (const auto& error : errors)
+    if (error)
+      std::rethrow_exception(error);
+
+  writer.close();
+
+  for (dimension_size_type t = 0U; t < 2U; ++t)
+    for (dimension_size_type c = 0U; c < 4U; ++c)
+      for (dimension_size_type z = 0U; z < 3U; ++z)
+        for (dimension_size_type cy = 0U; cy < 2U; ++cy)
+          for (dimension_size_type cx = 0U; cx < 4U; ++cx)
+            checkChunk(dir, t, c, z, cy, cx);
+
+  // No temporary files remain.
+  for (recursive_directory_iterator i(dir), end; i != end; ++i)
+    EXPECT_EQ(std::string::npos, i->path().filename().string().find(".partial")) << i->path();
+}
+
+TEST(OMEZarrWriter, SaveBytesAnyOrder)
+{
+  path dir(PROJECT_BINARY_DIR "/test/ome-files/data/omezarrwriter-saveBytes.zarr");
+  remove_all(dir);
+
+  OMEZarrWriter writer;
+  writer.setMetadataRetrieve(makeMetadata());
+  writer.setTileSizeX(16U);
+  writer.setTileSizeY(16U);
+  ASSERT_NO_THROW(writer.setId(dir));
+
+  // Overwrite a region of a previously written plane.
+  for (dimension_size_type p : {5U, 0U, 2U})
+    {
+      const dimension_size_type samples = ((p / 3U) % 2U) ? 3U : 1U;
+      VariantPixelBuffer buf(regionShape(50U, 30U, samples),
+                             ome::xml::model::enums::PixelType::UINT16);
+      fillRegion(buf, p == 2U ? 9U : p, 0U, 0U);
+      ASSERT_NO_THROW(writer.saveBytes(p, buf));
+    }
+  VariantPixelBuffer region(regionShape(20U, 10U, 1U),
+                            ome::xml::model::enums::PixelType::UINT16);
+  fillRegion(region, 2U, 0U, 0U);
+  ASSERT_NO_THROW(writer.setPlane(2U));
+  ASSERT_NO_THROW(writer.saveBytes(2U, region, 0U, 0U, 20U, 10U));
+  writer.close();
+
+  checkChunk(dir, 0U, 0U, 0U, 0U, 0U);
+  checkChunk(dir, 0U, 1U, 2U, 1U, 3U);
+  checkChunk(dir, 0U, 3U, 2U, 1U, 3U);
+
+  // Partly overwritten chunk: the overwritten 16×10 corner, with
+  // the remainder from plane 9.
+  std::string data(readFile(dir / "0" / "0" / "0" / "0" / "2" / "0" / "1"));
+  ASSERT_EQ(16U * 16U * sizeof(uint16_t), data.size());
+  const uint16_t *pixels = reinterpret_cast<const uint16_t *>(data.data());
+  for (dimension_size_type j = 0U; j < 16U; ++j)
+    for (dimension_size_type i = 0U; i < 16U; ++i)
+      {
+        const dimension_size_type x = 16U + i;
+        const uint16_t expected = (x < 20U && j < 10U) ? pixelValue(2U, 0U, x, j) : pixelValue(9U, 0U, x, j);
+        ASSERT_EQ(expected, pixels[(j * 16U) + i]);
+      }
+}
+
+TEST(OMEZarrWriter, ZlibCompression)
+{
+  path dir(PROJECT_BINARY_DIR "/test/ome-files/data/omezarrwriter-zlib.zarr");
+  remove_all(dir);
+
+  OMEZarrWriter writer;
+  writer.setMetadataRetrieve(makeMetadata());
+  writer.setTileSizeX(16U);
+  writer.setTileSizeY(16U);
+  EXPECT_THROW(writer.setCompression("LZW"), std::logic_error);
+  ASSERT_NO_THROW(writer.setCompression("zlib"));
+  writer.setCompressionLevel(4);
+  ASSERT_NO_THROW(writer.setId(dir));
+
+  std::string zarray(readFile(dir / "0" / "0" / ".zarray"));
+  EXPECT_NE(std::string::npos, zarray.find("\"compressor\" : { \"id\" : \"zlib\", \"level\" : 4 }"));
+
+  // Whole planes, then a region merged into the existing
+  // compressed chunks.
+  for (dimension_size_type p : {0U, 2U})
+    {
+      VariantPixelBuffer buf(regionShape(50U, 30U, 1U),
+                             ome::xml::model::enums::PixelType::UINT16);
+      fillRegion(buf, p == 2U ? 9U : p, 0U, 0U);
+      ASSERT_NO_THROW(writer.saveBytes(p, buf));
+    }
+  VariantPixelBuffer region(regionShape(20U, 10U, 1U),
+                            ome::xml::model::enums::PixelType::UINT16);
+  fillRegion(region, 2U, 0U, 0U);
+  ASSERT_NO_THROW(writer.saveRegion(0U, 2U, region, 0U, 0U, 20U, 10U));
+  writer.close();
+
+  // The chunks are smaller than uncompressed.
+  path file(dir / "0" / "0" / "0" / "0" / "0" / "0" / "0");
+  EXPECT_GT(16U * 16U * sizeof(uint16_t), file_size(file));
+  for (dimension_size_type cy = 0U; cy < 2U; ++cy)
+    for (dimension_size_type cx = 0U; cx < 4U; ++cx)
+      checkChunk(dir, 0U, 0U, 0U, cy, cx, true);
+
+  std::string data(readChunk(dir / "0" / "0" / "0" / "0" / "2" / "0" / "1", true));
+  ASSERT_EQ(16U * 16U * sizeof(uint16_t), data.size());
+  const uint16_t *pixels = reinterpret_cast<const uint16_t *>(data.data());
+  for (dimension_size_type j = 0U; j < 16U; ++j)
+    for (dimension_size_type i = 0U; i < 16U; ++i)
+      {
+        const dimension_size_type x = 16U + i;
+        const uint16_t expected = (x < 20U && j < 10U) ? pixelValue(2U, 0U, x, j) : pixelValue(9U, 0U, x, j);
+        ASSERT_EQ(expected, pixels[(j * 16U) + i]);
+      }
+
+  // Invalid levels are rejected.
+  OMEZarrWriter invalid;
+  invalid.setMetadataRetrieve(makeMetadata());
+  invalid.setCompression("zlib");
+  invalid.setCompressionLevel(10);
+  EXPECT_THROW(invalid.setId(PROJECT_BINARY_DIR "/test/ome-files/data/omezarrwriter-zlib-invalid.zarr"),
+               FormatException);
+}
+
+TEST(OMEZarrWriter, InvalidRegion)
+{
+  path dir(PROJECT_BINARY_DIR "/test/ome-files/data/omezarrwriter-invalid.zarr");
+  remove_all(dir);
+
+  OMEZarrWriter writer;
+  writer.setMetadataRetrieve(makeMetadata());
+  ASSERT_NO_THROW(writer.setId(dir));
+
+  // Default chunks cover the whole plane.
+  EXPECT_EQ(50U, writer.getTileSizeX());
+  EXPECT_EQ(30U, writer.getTileSizeY());
+
+  VariantPixelBuffer buf(regionShape(20U, 10U, 1U),
+                         ome::xml::model::enums::PixelType::UINT16);
+  EXPECT_THROW(writer.saveRegion(1U, 0U, buf, 0U, 0U, 20U, 10U), FormatException);
+  EXPECT_THROW(writer.saveRegion(0U, 12U, buf, 0U, 0U, 20U, 10U), FormatException);
+  EXPECT_THROW(writer.saveRegion(0U, 0U, buf, 40U, 0U, 20U, 10U), FormatException);
+  EXPECT_THROW(writer.saveRegion(0U, 0U, buf, 0U, 0U, 20U, 11U), FormatException);
+  // Three samples are required for the second channel.
+  EXPECT_THROW(writer.saveRegion(0U, 3U, buf, 0U, 0U, 20U, 10U), FormatException);
+  VariantPixelBuffer wrongtype(regionShape(20U, 10U, 1U),
+                               ome::xml::model::enums::PixelType::UINT8);
+  EXPECT_THROW(writer.saveRegion(0U, 0U, wrongtype, 0U, 0U, 20U, 10U), FormatException);
+  EXPECT_THROW(writer.setPlane(12U), std::logic_error);
+  EXPECT_THROW(writer.setSeries(1U), std::logic_error);
+  EXPECT_NO_THROW(writer.saveRegion(0U, 0U, buf, 0U, 0U, 20U, 10U));
+}
@@ -0,0 +1,218 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2014 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/filesystem/path.hpp>
+
+#include <ome/files/CoreMetadata.h>
+#include <ome/files/MetadataTools.h>
+#include <ome/files/OrthogonalSlice.h>
+#include <ome/files/PixelBuffer.h>
+#include <ome/files/VariantPixelBuffer.h>
+#include <ome/files/in/OMETIFFReader.h>
+#include <ome/files/out/OMETIFFWriter.h>
+
+#include <ome/xml/meta/OMEXMLMetadata.h>
+
+#include <ome/test/test.h>
+
+using ome::files::dimension_size_type;
+using ome::files::CoreMetadata;
+using ome::files::PixelProperties;
+using ome::files::readOrthogonalSlice;
+using ome::files::VariantPixelBuffer;
+using ome::files::in::OMETIFFReader;
+using ome::files::out::OMETIFFWriter;
+typedef ome::xml::model::enums::PixelType PT;
+
+namespace
+{
+
+  typedef PixelProperties<PT::UINT16>::std_type uint16_pixel;
+
+  const dimension_size_type width = 70U;
+  const dimension_size_type height = 45U;
+  const dimension_size_type depth = 7U;
+  const dimension_size_type timepoints = 2U;
+
+  uint16_pixel
+  value(dimension_size_type x,
+        dimension_size_type y,
+        dimension_size_type z,
+        dimension_size_type t)
+  {
+    return static_cast<uint16_pixel>(((x * 37U) + (y * 11U) + (z * 4099U) + (t * 7919U)) % 60000U);
+  }
+
+  VariantPixelBuffer::indices_type
+  makeIndex(dimension_size_type x,
+            dimension_size_type y)
+  {
+    VariantPixelBuffer::indices_type idx;
+    idx.fill(0);
+    idx[ome::files::DIM_SPATIAL_X] = static_cast<VariantPixelBuffer::indices_type::value_type>(x);
+    idx[ome::files::DIM_SPATIAL_Y] = static_cast<VariantPixelBuffer::indices_type::value_type>(y);
+    return idx;
+  }
+
+}
+
+class OrthogonalSliceTest : public ::testing::TestWithParam<dimension_size_type>
+{
+public:
+  OMETIFFReader reader;
+
+  static void
+  SetUpTestCase()
+  {
+    std::shared_ptr<CoreMetadata> c(std::make_shared<CoreMetadata>());
+    c->sizeX = width;
+    c->sizeY = height;
+    c->sizeZ = depth;
+    c->sizeT = timepoints;
+    c->pixelType = PT::UINT16;
+    c->imageCount = depth * timepoints;
+    c->orderCertain = true;
+    c->interleaved = false;
+    c->dimensionOrder = ome::xml::model::enums::DimensionOrder::XYZCT;
+    std::vector<std::shared_ptr<CoreMetadata>> seriesList(1, c);
+
+    std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> meta(std::make_shared<::ome::xml::meta::OMEXMLMetadata>());
+    ome::files::fillMetadata(*meta, seriesList);
+
+    boost::filesystem::create_directories(path().parent_path());
+
+    // Tiled, with partial edge tiles.
+    OMETIFFWriter writer;
+    writer.setMetadataRetrieve(meta);
+    writer.setTileSizeX(16);
+    writer.setTileSizeY(16);
+    writer.setId(path());
+
+    std::array<VariantPixelBuffer::size_type, 9> shape;
+    std::fill(shape.begin(), shape.end(), 1U);
+    shape[ome::files::DIM_SPATIAL_X] = width;
+    shape[ome::files::DIM_SPATIAL_Y] = height;
+
+    for (dimension_size_type t = 0; t < timepoints; ++t)
+      for (dimension_size_type z = 0; z < depth; ++z)
+        {
+          VariantPixelBuffer buf(shape, PT::UINT16);
+          for (dimension_size_type y = 0; y < height; ++y)
+            for (dimension_size_type x = 0; x < width; ++x)
+              buf.array<uint16_pixel>()(makeIndex(x, y)) = value(x, y, z, t);
+          writer.saveBytes(writer.getIndex(z, 0, t), buf);
+        }
+    writer.close();
+  }
+
+  static boost::filesystem::path
+  path()
+  {
+    return PROJECT_BINARY_DIR "/test/ome-files/data/orthogonal-slice.ome.tiff";
+  }
+
+  void
+  SetUp()
+  {
+    reader.setId(path());
+  }
+};
+
+TEST_P(OrthogonalSliceTest, XZ)
+{
+  for (dimension_size_type t = 0; t < timepoints; ++t)
+    for (const dimension_size_type y : {0U, 17U, 44U})
+      {
+        VariantPixelBuffer dest;
+        ASSERT_NO_THROW(readOrthogonalSlice(reader, ome::files::SLICE_XZ, y, 0, t, dest, GetParam()));
+        ASSERT_EQ(PT::UINT16, dest.pixelType());
+        ASSERT_EQ(width, dest.shape()[ome::files::DIM_SPATIAL_X]);
+        ASSERT_EQ(depth, dest.shape()[ome::files::DIM_SPATIAL_Y]);
+
+        for (dimension_size_type z = 0; z < depth; ++z)
+          for (dimension_size_type x = 0; x < width; ++x)
+            ASSERT_EQ(value(x, y, z, t), dest.array<uint16_pixel>()(makeIndex(x, z)));
+      }
+}
+
+TEST_P(OrthogonalSliceTest, YZ)
+{
+  for (dimension_size_type t = 0; t < timepoints; ++t)
+    for (const dimension_size_type x : {0U, 33U, 69U})
+      {
+        VariantPixelBuffer dest;
+        ASSERT_NO_THROW(readOrthogonalSlice(reader, ome::files::SLICE_YZ, x, 0, t, dest, GetParam()));
+        ASSERT_EQ(PT::UINT16, dest.pixelType());
+        ASSERT_EQ(height, dest.shape()[ome::files::DIM_SPATIAL_X]);
+        ASSERT_EQ(depth, dest.shape()[ome::files::DIM_SPATIAL_Y]);
+
+        for (dimension_size_type z = 0; z < depth; ++z)
+          for (dimension_size_type y = 0; y < height; ++y)
+            ASSERT_EQ(value(x, y, z, t), dest.array<uint16_pixel>()(makeIndex(y, z)));
+      }
+}
+
+TEST_P(OrthogonalSliceTest, Invalid)
+{
+  VariantPixelBuffer dest;
+  EXPECT_THROW(readOrthogonalSlice(reader, ome::files::SLICE_XZ, height, 0, 0, dest, GetParam()), std::logic_error);
+  EXPECT_THROW(readOrthogonalSlice(reader, ome::files::SLICE_YZ, width, 0, 0, dest, GetParam()), std::logic_error);
+  EXPECT_THROW(readOrthogonalSlice(reader, ome::files::SLICE_XZ, 0, 1, 0, dest, GetParam()), std::logic_error);
+  EXPECT_THROW(readOrthogonalSlice(reader, ome::files::SLICE_XZ, 0, 0, timepoints, dest, GetParam()), std::logic_error);
+}
+
+const dimension_size_type thread_counts[] = { 1U, 3U, 16U };
+
+// Disable missing-prototypes warning for INSTANTIATE_TEST_CASE_P;
+// this is solely to work around a missing prototype in gtest.
+#ifdef __GNUC__
+#  if defined __clang__ || defined __APPLE__
+#    pragma GCC diagnostic ignored "-Wmissing-prototypes"
+#  endif
+#  pragma GCC diagnostic ignored "-Wmissing-declarations"
+#endif
+
+INSTANTIATE_TEST_CASE_P(OrthogonalSliceVariants, OrthogonalSliceTest, ::testing::ValuesIn(thread_counts));
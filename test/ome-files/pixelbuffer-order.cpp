@@ -36,6 +36,7 @@
  * #L%
  */
 
+#include <algorithm>
 #include <sstream>
 #include <stdexcept>
 #include <iostream>
@@ -106,6 +107,35 @@ TEST_P(DimensionOrderTest, Default)
     ASSERT_FALSE(PixelBufferBase::default_storage_order() == PixelBufferBase::make_storage_order(params.order, params.interleaved));
 }
 
+TEST_P(DimensionOrderTest, AssignInterleaving)
+{
+  const DimensionOrderTestParameters& params = GetParam();
+
+  for (uint16_t samples = 1; samples <= 5; ++samples)
+    {
+      PixelBuffer<uint16_t> src(boost::extents[7][5][2][1][3][samples][1][1][1],
+                                PT::UINT16, ome::files::ENDIAN_NATIVE,
+                                PixelBufferBase::make_storage_order(params.order, params.interleaved));
+      PixelBuffer<uint16_t> dest(boost::extents[7][5][2][1][3][samples][1][1][1],
+                                 PT::UINT16, ome::files::ENDIAN_NATIVE,
+                                 PixelBufferBase::make_storage_order(params.order, !params.interleaved));
+
+      uint16_t *data = src.data();
+      for (PixelBufferBase::size_type i = 0; i < src.num_elements(); ++i)
+        data[i] = static_cast<uint16_t>(i);
+
+      dest = src;
+      EXPECT_EQ(src, dest);
+
+      PixelBuffer<uint16_t> roundtrip(boost::extents[7][5][2][1][3][samples][1][1][1],
+                                      PT::UINT16, ome::files::ENDIAN_NATIVE,
+                                      PixelBufferBase::make_storage_order(params.order, params.interleaved));
+      roundtrip = dest;
+      EXPECT_EQ(src, roundtrip);
+      EXPECT_TRUE(std::equal(src.data(), src.data() + src.num_elements(), roundtrip.data()));
+    }
+}
+
 namespace
 {
   PixelBufferBase::storage_order_type
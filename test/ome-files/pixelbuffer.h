@@ -45,9 +45,11 @@
 
 #include "pixel.h"
 
+#include <memory>
 #include <sstream>
 #include <stdexcept>
 #include <iostream>
+#include <utility>
 
 using ome::files::Dimensions;
 using ome::files::PixelEndianProperties;
@@ -185,6 +187,37 @@ TYPED_TEST_P(PixelBufferType, ConstructCopy)
   ASSERT_NE(buf1, buf2);
 }
 
+TYPED_TEST_P(PixelBufferType, ConstructMove)
+{
+  std::vector<TypeParam> source;
+  for (uint32_t i = 0; i < 10; ++i)
+    source.push_back(pixel_value<TypeParam>(i));
+
+  PixelBuffer<TypeParam> buf1(boost::extents[5][2][1][1][1][1][1][1][1]);
+  buf1.assign(source.begin(), source.end());
+  const TypeParam *data = buf1.data();
+
+  PixelBuffer<TypeParam> buf2(std::move(buf1));
+  ASSERT_EQ(data, buf2.data());
+  ASSERT_EQ(10U, buf2.num_elements());
+
+  // Move assignment transfers the storage, even if the extents differ.
+  PixelBuffer<TypeParam> buf3(boost::extents[2][2][1][1][1][1][1][1][1]);
+  buf3 = std::move(buf2);
+  ASSERT_EQ(data, buf3.data());
+  ASSERT_EQ(10U, buf3.num_elements());
+  for (uint32_t i = 0; i < 10; ++i)
+    ASSERT_EQ(pixel_value<TypeParam>(i), *(buf3.data()+i));
+
+  // Move assignment to external storage copies into it.
+  std::unique_ptr<TypeParam[]> backing(new TypeParam[10]());
+  PixelBuffer<TypeParam> buf4(backing.get(), boost::extents[5][2][1][1][1][1][1][1][1]);
+  PixelBuffer<TypeParam> buf5(buf3);
+  buf4 = std::move(buf5);
+  ASSERT_EQ(backing.get(), buf4.data());
+  ASSERT_EQ(buf3, buf4);
+}
+
 template<typename T>
 void test_operators(const PixelBuffer<T>& buf1,
                     const PixelBuffer<T>& buf2)
@@ -514,6 +547,7 @@ REGISTER_TYPED_TEST_CASE_P(PixelBufferType,
                            ConstructRange,
                            ConstructRangeRef,
                            ConstructCopy,
+                           ConstructMove,
                            Operators,
                            Array,
                            Data,
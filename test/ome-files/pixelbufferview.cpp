@@ -0,0 +1,124 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <ome/files/PixelBuffer.h>
+#include <ome/files/PixelBufferView.h>
+
+#include <ome/test/test.h>
+
+using ome::files::PixelBuffer;
+using ome::files::PixelBufferBase;
+using ome::files::PixelBufferView;
+typedef ome::xml::model::enums::DimensionOrder DO;
+
+namespace
+{
+
+  PixelBufferBase::indices_type
+  makeIndex(PixelBufferBase::index x,
+            PixelBufferBase::index y,
+            PixelBufferBase::index z,
+            PixelBufferBase::index s)
+  {
+    PixelBufferBase::indices_type idx;
+    idx.fill(0);
+    idx[ome::files::DIM_SPATIAL_X] = x;
+    idx[ome::files::DIM_SPATIAL_Y] = y;
+    idx[ome::files::DIM_SPATIAL_Z] = z;
+    idx[ome::files::DIM_SUBCHANNEL] = s;
+    return idx;
+  }
+
+  class PixelBufferViewTest : public ::testing::TestWithParam<bool>
+  {
+  };
+
+}
+
+TEST_P(PixelBufferViewTest, Access)
+{
+  PixelBuffer<uint16_t> buf(boost::extents[7][5][3][1][1][2][1][1][1],
+                            ome::xml::model::enums::PixelType::UINT16,
+                            ome::files::ENDIAN_NATIVE,
+                            PixelBufferBase::make_storage_order(DO::XYZTC, GetParam()));
+  for (PixelBufferBase::index z = 0; z < 3; ++z)
+    for (PixelBufferBase::index y = 0; y < 5; ++y)
+      for (PixelBufferBase::index x = 0; x < 7; ++x)
+        for (PixelBufferBase::index s = 0; s < 2; ++s)
+          buf.at(makeIndex(x, y, z, s)) = static_cast<uint16_t>(x + (y * 10) + (z * 100) + (s * 1000));
+
+  PixelBufferView<uint16_t> view(buf);
+  EXPECT_EQ(buf.data(), view.data());
+  EXPECT_EQ(7U, view.shape()[ome::files::DIM_SPATIAL_X]);
+  EXPECT_EQ(2U, view.shape()[ome::files::DIM_SUBCHANNEL]);
+
+  for (PixelBufferBase::index z = 0; z < 3; ++z)
+    for (PixelBufferBase::index y = 0; y < 5; ++y)
+      for (PixelBufferBase::index s = 0; s < 2; ++s)
+        {
+          const uint16_t *row = view.row(makeIndex(3, y, z, s));
+          const uint16_t *plane = view.plane(makeIndex(3, y, z, s));
+          for (PixelBufferBase::index x = 0; x < 7; ++x)
+            {
+              const uint16_t expected = buf.at(makeIndex(x, y, z, s));
+              ASSERT_EQ(expected, view(makeIndex(x, y, z, s)));
+              ASSERT_EQ(expected, row[x * view.stride(ome::files::DIM_SPATIAL_X)]);
+              ASSERT_EQ(expected, plane[(x * view.stride(ome::files::DIM_SPATIAL_X)) +
+                                        (y * view.stride(ome::files::DIM_SPATIAL_Y))]);
+            }
+        }
+
+  view(makeIndex(1, 2, 0, 1)) = 42U;
+  EXPECT_EQ(42U, buf.at(makeIndex(1, 2, 0, 1)));
+
+  const PixelBuffer<uint16_t>& cbuf(buf);
+  PixelBufferView<const uint16_t> cview(cbuf);
+  EXPECT_EQ(42U, cview(makeIndex(1, 2, 0, 1)));
+  PixelBufferView<const uint16_t> rview(buf);
+  EXPECT_EQ(cview.pointer(makeIndex(4, 4, 2, 1)), rview.pointer(makeIndex(4, 4, 2, 1)));
+}
+
+// Disable missing-prototypes warning for INSTANTIATE_TEST_CASE_P;
+// this is solely to work around a missing prototype in gtest.
+#ifdef __GNUC__
+#  if defined __clang__ || defined __APPLE__
+#    pragma GCC diagnostic ignored "-Wmissing-prototypes"
+#  endif
+#  pragma GCC diagnostic ignored "-Wmissing-declarations"
+#endif
+
+INSTANTIATE_TEST_CASE_P(PixelBufferViewVariants, PixelBufferViewTest, ::testing::Values(false, true));
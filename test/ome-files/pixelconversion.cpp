@@ -0,0 +1,238 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <array>
+#include <complex>
+#include <cstdint>
+#include <stdexcept>
+
+#include <ome/files/PixelBuffer.h>
+#include <ome/files/PixelConversion.h>
+#include <ome/files/VariantPixelBuffer.h>
+
+#include <ome/test/test.h>
+
+using ome::files::convertPixels;
+using ome::files::dimension_size_type;
+using ome::files::PixelBufferBase;
+using ome::files::PixelConversion;
+using ome::files::PixelProperties;
+using ome::files::VariantPixelBuffer;
+typedef ome::xml::model::enums::PixelType PT;
+
+namespace
+{
+
+  std::array<VariantPixelBuffer::size_type, 9>
+  makeShape(dimension_size_type w,
+            dimension_size_type h,
+            dimension_size_type samples)
+  {
+    std::array<VariantPixelBuffer::size_type, 9> shape;
+    shape.fill(1);
+    shape[ome::files::DIM_SPATIAL_X] = w;
+    shape[ome::files::DIM_SPATIAL_Y] = h;
+    shape[ome::files::DIM_SUBCHANNEL] = samples;
+    return shape;
+  }
+
+  VariantPixelBuffer::indices_type
+  makeIndex(dimension_size_type x,
+            dimension_size_type y,
+            dimension_size_type s)
+  {
+    VariantPixelBuffer::indices_type idx;
+    idx.fill(0);
+    idx[ome::files::DIM_SPATIAL_X] = static_cast<VariantPixelBuffer::indices_type::value_type>(x);
+    idx[ome::files::DIM_SPATIAL_Y] = static_cast<VariantPixelBuffer::indices_type::value_type>(y);
+    idx[ome::files::DIM_SUBCHANNEL] = static_cast<VariantPixelBuffer::indices_type::value_type>(s);
+    return idx;
+  }
+
+  typedef PixelProperties<PT::UINT8>::std_type uint8_pixel;
+  typedef PixelProperties<PT::UINT16>::std_type uint16_pixel;
+  typedef PixelProperties<PT::INT16>::std_type int16_pixel;
+  typedef PixelProperties<PT::FLOAT>::std_type float_pixel;
+  typedef PixelProperties<PT::BIT>::std_type bit_pixel;
+  typedef PixelProperties<PT::COMPLEXFLOAT>::std_type complex_pixel;
+
+}
+
+TEST(PixelConversion, Cast)
+{
+  VariantPixelBuffer src(makeShape(300U, 2U, 3U), PT::UINT8);
+  for (dimension_size_type i = 0; i < src.num_elements(); ++i)
+    src.data<uint8_pixel>()[i] = static_cast<uint8_pixel>(i);
+
+  VariantPixelBuffer dest;
+  convertPixels(src, dest, PT::UINT16);
+
+  ASSERT_EQ(PT::UINT16, dest.pixelType());
+  ASSERT_TRUE(src.storage_order() == dest.storage_order());
+  ASSERT_EQ(src.num_elements(), dest.num_elements());
+  for (dimension_size_type i = 0; i < src.num_elements(); ++i)
+    ASSERT_EQ(static_cast<uint16_pixel>(i % 256U), dest.data<uint16_pixel>()[i]);
+}
+
+TEST(PixelConversion, Scale)
+{
+  VariantPixelBuffer src(makeShape(4U, 1U, 1U), PT::UINT16);
+  src.data<uint16_pixel>()[0] = 0U;
+  src.data<uint16_pixel>()[1] = 1000U;
+  src.data<uint16_pixel>()[2] = 32768U;
+  src.data<uint16_pixel>()[3] = 65535U;
+
+  VariantPixelBuffer dest;
+  convertPixels(src, dest, PT::FLOAT, PixelConversion(1.0 / 65535.0));
+
+  EXPECT_FLOAT_EQ(0.0f, dest.data<float_pixel>()[0]);
+  EXPECT_FLOAT_EQ(1000.0f / 65535.0f, dest.data<float_pixel>()[1]);
+  EXPECT_FLOAT_EQ(32768.0f / 65535.0f, dest.data<float_pixel>()[2]);
+  EXPECT_FLOAT_EQ(1.0f, dest.data<float_pixel>()[3]);
+}
+
+TEST(PixelConversion, ClampAndRound)
+{
+  VariantPixelBuffer src(makeShape(5U, 1U, 1U), PT::FLOAT);
+  src.data<float_pixel>()[0] = -3.0f;
+  src.data<float_pixel>()[1] = 1.4f;
+  src.data<float_pixel>()[2] = 1.6f;
+  src.data<float_pixel>()[3] = 254.5f;
+  src.data<float_pixel>()[4] = 1.0e6f;
+
+  VariantPixelBuffer dest;
+  convertPixels(src, dest, PT::UINT8);
+
+  EXPECT_EQ(0U, dest.data<uint8_pixel>()[0]);
+  EXPECT_EQ(1U, dest.data<uint8_pixel>()[1]);
+  EXPECT_EQ(2U, dest.data<uint8_pixel>()[2]);
+  EXPECT_EQ(255U, dest.data<uint8_pixel>()[3]);
+  EXPECT_EQ(255U, dest.data<uint8_pixel>()[4]);
+
+  PixelConversion window(0.5, 10.0);
+  window.minimum = 20.0;
+  window.maximum = 100.0;
+  convertPixels(src, dest, PT::UINT8, window);
+
+  EXPECT_EQ(20U, dest.data<uint8_pixel>()[0]);
+  EXPECT_EQ(20U, dest.data<uint8_pixel>()[1]);
+  EXPECT_EQ(100U, dest.data<uint8_pixel>()[3]);
+}
+
+TEST(PixelConversion, Signed)
+{
+  VariantPixelBuffer src(makeShape(3U, 1U, 1U), PT::INT16);
+  src.data<int16_pixel>()[0] = -200;
+  src.data<int16_pixel>()[1] = 100;
+  src.data<int16_pixel>()[2] = 300;
+
+  VariantPixelBuffer dest;
+  convertPixels(src, dest, PT::UINT8);
+  EXPECT_EQ(0U, dest.data<uint8_pixel>()[0]);
+  EXPECT_EQ(100U, dest.data<uint8_pixel>()[1]);
+  EXPECT_EQ(255U, dest.data<uint8_pixel>()[2]);
+
+  convertPixels(src, dest, PT::UINT8, PixelConversion(0.5, 128.0));
+  EXPECT_EQ(28U, dest.data<uint8_pixel>()[0]);
+  EXPECT_EQ(178U, dest.data<uint8_pixel>()[1]);
+  EXPECT_EQ(255U, dest.data<uint8_pixel>()[2]);
+}
+
+TEST(PixelConversion, Bit)
+{
+  VariantPixelBuffer src(makeShape(3U, 1U, 1U), PT::UINT8);
+  src.data<uint8_pixel>()[0] = 0U;
+  src.data<uint8_pixel>()[1] = 1U;
+  src.data<uint8_pixel>()[2] = 200U;
+
+  VariantPixelBuffer dest;
+  convertPixels(src, dest, PT::BIT);
+  EXPECT_FALSE(dest.data<bit_pixel>()[0]);
+  EXPECT_TRUE(dest.data<bit_pixel>()[1]);
+  EXPECT_TRUE(dest.data<bit_pixel>()[2]);
+}
+
+TEST(PixelConversion, Complex)
+{
+  VariantPixelBuffer src(makeShape(2U, 1U, 1U), PT::FLOAT);
+  src.data<float_pixel>()[0] = 1.5f;
+  src.data<float_pixel>()[1] = -2.0f;
+
+  VariantPixelBuffer dest;
+  convertPixels(src, dest, PT::COMPLEXFLOAT);
+  EXPECT_EQ(complex_pixel(1.5f, 0.0f), dest.data<complex_pixel>()[0]);
+  EXPECT_EQ(complex_pixel(-2.0f, 0.0f), dest.data<complex_pixel>()[1]);
+
+  VariantPixelBuffer real;
+  EXPECT_THROW(convertPixels(dest, real, PT::FLOAT), std::logic_error);
+}
+
+TEST(PixelConversion, Region)
+{
+  const dimension_size_type w = 5U, h = 3U, samples = 3U;
+
+  // Interleaved source into planar destination.
+  VariantPixelBuffer src(makeShape(w, h, samples), PT::UINT16,
+                         PixelBufferBase::make_storage_order(ome::xml::model::enums::DimensionOrder::XYZTC, true));
+  for (dimension_size_type y = 0; y < h; ++y)
+    for (dimension_size_type x = 0; x < w; ++x)
+      for (dimension_size_type s = 0; s < samples; ++s)
+        src.array<uint16_pixel>()(makeIndex(x, y, s)) =
+          static_cast<uint16_pixel>(x + (y * 10U) + (s * 100U));
+
+  VariantPixelBuffer dest(makeShape(16U, 8U, samples), PT::FLOAT,
+                          PixelBufferBase::make_storage_order(ome::xml::model::enums::DimensionOrder::XYZTC, false));
+  for (dimension_size_type i = 0; i < dest.num_elements(); ++i)
+    dest.data<float_pixel>()[i] = -1.0f;
+
+  convertPixels(src, dest, 7U, 4U, PixelConversion(2.0));
+
+  for (dimension_size_type y = 0; y < 8U; ++y)
+    for (dimension_size_type x = 0; x < 16U; ++x)
+      for (dimension_size_type s = 0; s < samples; ++s)
+        {
+          float expected = -1.0f;
+          if (x >= 7U && x < 7U + w && y >= 4U && y < 4U + h)
+            expected = static_cast<float>(2U * ((x - 7U) + ((y - 4U) * 10U) + (s * 100U)));
+          ASSERT_FLOAT_EQ(expected, dest.array<float_pixel>()(makeIndex(x, y, s)))
+            << "x=" << x << " y=" << y << " s=" << s;
+        }
+
+  EXPECT_THROW(convertPixels(src, dest, 12U, 0U), std::logic_error);
+  VariantPixelBuffer wrongsamples(makeShape(16U, 8U, 1U), PT::FLOAT);
+  EXPECT_THROW(convertPixels(src, wrongsamples, 0U, 0U), std::logic_error);
+}
@@ -0,0 +1,310 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <cstdlib>
+#include <stdexcept>
+#include <tuple>
+
+#include <ome/files/PixelBuffer.h>
+#include <ome/files/PixelCopy.h>
+#include <ome/files/VariantPixelBuffer.h>
+
+#include <ome/test/test.h>
+
+using ome::files::copyRegion;
+using ome::files::copyStrided;
+using ome::files::PixelBuffer;
+using ome::files::PixelBufferBase;
+using ome::files::region_shape_type;
+using ome::files::region_strides_type;
+using ome::files::VariantPixelBuffer;
+typedef ome::xml::model::enums::DimensionOrder DO;
+typedef ome::xml::model::enums::PixelType PT;
+
+namespace
+{
+
+  PixelBufferBase::indices_type
+  makeIndex(PixelBufferBase::index x,
+            PixelBufferBase::index y,
+            PixelBufferBase::index z,
+            PixelBufferBase::index s)
+  {
+    PixelBufferBase::indices_type idx;
+    idx.fill(0);
+    idx[ome::files::DIM_SPATIAL_X] = x;
+    idx[ome::files::DIM_SPATIAL_Y] = y;
+    idx[ome::files::DIM_SPATIAL_Z] = z;
+    idx[ome::files::DIM_SUBCHANNEL] = s;
+    return idx;
+  }
+
+  region_shape_type
+  makeShape(PixelBufferBase::size_type x,
+            PixelBufferBase::size_type y,
+            PixelBufferBase::size_type z,
+            PixelBufferBase::size_type s)
+  {
+    region_shape_type shape;
+    shape.fill(1U);
+    shape[ome::files::DIM_SPATIAL_X] = x;
+    shape[ome::files::DIM_SPATIAL_Y] = y;
+    shape[ome::files::DIM_SPATIAL_Z] = z;
+    shape[ome::files::DIM_SUBCHANNEL] = s;
+    return shape;
+  }
+
+  uint16_t
+  value(PixelBufferBase::index x,
+        PixelBufferBase::index y,
+        PixelBufferBase::index z,
+        PixelBufferBase::index s)
+  {
+    return static_cast<uint16_t>(x + (y * 10) + (z * 100) + (s * 1000));
+  }
+
+  void
+  fill(PixelBuffer<uint16_t>& buf)
+  {
+    const PixelBufferBase::size_type *shape = buf.shape();
+    for (PixelBufferBase::index z = 0; z < static_cast<PixelBufferBase::index>(shape[ome::files::DIM_SPATIAL_Z]); ++z)
+      for (PixelBufferBase::index y = 0; y < static_cast<PixelBufferBase::index>(shape[ome::files::DIM_SPATIAL_Y]); ++y)
+        for (PixelBufferBase::index x = 0; x < static_cast<PixelBufferBase::index>(shape[ome::files::DIM_SPATIAL_X]); ++x)
+          for (PixelBufferBase::index s = 0; s < static_cast<PixelBufferBase::index>(shape[ome::files::DIM_SUBCHANNEL]); ++s)
+            buf.at(makeIndex(x, y, z, s)) = value(x, y, z, s);
+  }
+
+  // Source and destination interleaving.
+  class PixelCopyTest : public ::testing::TestWithParam<std::tuple<bool, bool>>
+  {
+  };
+
+}
+
+TEST_P(PixelCopyTest, Region)
+{
+  PixelBuffer<uint16_t> src(boost::extents[13][11][3][1][1][3][1][1][1],
+                            PT::UINT16, ome::files::ENDIAN_NATIVE,
+                            PixelBufferBase::make_storage_order(DO::XYZTC, std::get<0>(GetParam())));
+  PixelBuffer<uint16_t> dest(boost::extents[9][8][2][1][1][3][1][1][1],
+                             PT::UINT16, ome::files::ENDIAN_NATIVE,
+                             PixelBufferBase::make_storage_order(DO::XYZTC, std::get<1>(GetParam())));
+  fill(src);
+  std::fill(dest.data(), dest.data() + dest.num_elements(), 0xFFFFU);
+
+  copyRegion(src, makeIndex(3, 2, 1, 1), dest, makeIndex(1, 4, 0, 0), makeShape(6, 4, 2, 2));
+
+  for (PixelBufferBase::index z = 0; z < 2; ++z)
+    for (PixelBufferBase::index y = 0; y < 8; ++y)
+      for (PixelBufferBase::index x = 0; x < 9; ++x)
+        for (PixelBufferBase::index s = 0; s < 3; ++s)
+          {
+            const bool inside = x >= 1 && x < 7 && y >= 4 && y < 8 && s < 2;
+            const uint16_t expected = inside ? value(x + 2, y - 2, z + 1, s + 1) : 0xFFFFU;
+            ASSERT_EQ(expected, dest.at(makeIndex(x, y, z, s)));
+          }
+}
+
+TEST_P(PixelCopyTest, Whole)
+{
+  PixelBuffer<uint16_t> src(boost::extents[13][11][3][1][1][3][1][1][1],
+                            PT::UINT16, ome::files::ENDIAN_NATIVE,
+                            PixelBufferBase::make_storage_order(DO::XYZTC, std::get<0>(GetParam())));
+  PixelBuffer<uint16_t> dest(boost::extents[13][11][3][1][1][3][1][1][1],
+                             PT::UINT16, ome::files::ENDIAN_NATIVE,
+                             PixelBufferBase::make_storage_order(DO::XYZTC, std::get<1>(GetParam())));
+  fill(src);
+
+  copyRegion(src, makeIndex(0, 0, 0, 0), dest, makeIndex(0, 0, 0, 0), makeShape(13, 11, 3, 3));
+
+  EXPECT_EQ(src, dest);
+}
+
+TEST_P(PixelCopyTest, Overlap)
+{
+  PixelBuffer<uint16_t> buf(boost::extents[13][11][2][1][1][3][1][1][1],
+                            PT::UINT16, ome::files::ENDIAN_NATIVE,
+                            PixelBufferBase::make_storage_order(DO::XYZTC, std::get<0>(GetParam())));
+
+  // Shift forwards and backwards along each spatial dimension.
+  const PixelBufferBase::index shifts[][2] =
+    {
+      { 2, 0 },
+      { -2, 0 },
+      { 0, 3 },
+      { 0, -3 },
+      { 1, 1 },
+      { -1, -1 }
+    };
+
+  for (const auto& shift : shifts)
+    {
+      fill(buf);
+
+      const PixelBufferBase::index sx = shift[0] < 0 ? -shift[0] : 0;
+      const PixelBufferBase::index sy = shift[1] < 0 ? -shift[1] : 0;
+      const PixelBufferBase::index dx = shift[0] > 0 ? shift[0] : 0;
+      const PixelBufferBase::index dy = shift[1] > 0 ? shift[1] : 0;
+      const PixelBufferBase::size_type w = static_cast<PixelBufferBase::size_type>(13 - std::abs(shift[0]));
+      const PixelBufferBase::size_type h = static_cast<PixelBufferBase::size_type>(11 - std::abs(shift[1]));
+
+      copyRegion(buf, makeIndex(sx, sy, 0, 0), buf, makeIndex(dx, dy, 0, 0), makeShape(w, h, 2, 3));
+
+      for (PixelBufferBase::index z = 0; z < 2; ++z)
+        for (PixelBufferBase::index y = 0; y < 11; ++y)
+          for (PixelBufferBase::index x = 0; x < 13; ++x)
+            for (PixelBufferBase::index s = 0; s < 3; ++s)
+              {
+                const bool inside = x >= dx && x < dx + static_cast<PixelBufferBase::index>(w) &&
+                  y >= dy && y < dy + static_cast<PixelBufferBase::index>(h);
+                const uint16_t expected = inside ? value(x - dx + sx, y - dy + sy, z, s) : value(x, y, z, s);
+                ASSERT_EQ(expected, buf.at(makeIndex(x, y, z, s)));
+              }
+    }
+}
+
+TEST_P(PixelCopyTest, Bounds)
+{
+  PixelBuffer<uint16_t> src(boost::extents[13][11][3][1][1][3][1][1][1],
+                            PT::UINT16, ome::files::ENDIAN_NATIVE,
+                            PixelBufferBase::make_storage_order(DO::XYZTC, std::get<0>(GetParam())));
+  PixelBuffer<uint16_t> dest(boost::extents[9][8][2][1][1][3][1][1][1],
+                             PT::UINT16, ome::files::ENDIAN_NATIVE,
+                             PixelBufferBase::make_storage_order(DO::XYZTC, std::get<1>(GetParam())));
+
+  EXPECT_NO_THROW(copyRegion(src, makeIndex(4, 3, 1, 0), dest, makeIndex(0, 0, 0, 0), makeShape(9, 8, 2, 3)));
+  EXPECT_THROW(copyRegion(src, makeIndex(5, 3, 1, 0), dest, makeIndex(0, 0, 0, 0), makeShape(9, 8, 2, 3)), std::logic_error);
+  EXPECT_THROW(copyRegion(src, makeIndex(0, 0, 0, 0), dest, makeIndex(0, 1, 0, 0), makeShape(9, 8, 2, 3)), std::logic_error);
+  EXPECT_THROW(copyRegion(src, makeIndex(-1, 0, 0, 0), dest, makeIndex(0, 0, 0, 0), makeShape(2, 2, 1, 1)), std::logic_error);
+  EXPECT_THROW(copyRegion(src, makeIndex(0, 0, 0, 0), dest, makeIndex(0, 0, 0, 1), makeShape(2, 2, 1, 3)), std::logic_error);
+}
+
+TEST(PixelCopy, StridedTranspose)
+{
+  // Transpose in place, where source and destination overlap with
+  // differing strides.
+  uint16_t data[4 * 4];
+  for (uint16_t i = 0U; i < 16U; ++i)
+    data[i] = i;
+
+  region_strides_type rowmajor, colmajor;
+  rowmajor.fill(0);
+  colmajor.fill(0);
+  rowmajor[ome::files::DIM_SPATIAL_X] = 1;
+  rowmajor[ome::files::DIM_SPATIAL_Y] = 4;
+  colmajor[ome::files::DIM_SPATIAL_X] = 4;
+  colmajor[ome::files::DIM_SPATIAL_Y] = 1;
+
+  copyStrided(static_cast<const uint16_t *>(data), rowmajor, data, colmajor, makeShape(4, 4, 1, 1));
+
+  for (uint16_t y = 0U; y < 4U; ++y)
+    for (uint16_t x = 0U; x < 4U; ++x)
+      ASSERT_EQ((x * 4U) + y, data[(y * 4U) + x]);
+}
+
+TEST(PixelCopy, StridedReverse)
+{
+  // Reverse a row with a negative source stride.
+  uint16_t src[8], dest[8];
+  for (uint16_t i = 0U; i < 8U; ++i)
+    src[i] = i;
+
+  region_strides_type srcstrides, deststrides;
+  srcstrides.fill(0);
+  deststrides.fill(0);
+  srcstrides[ome::files::DIM_SPATIAL_X] = -1;
+  deststrides[ome::files::DIM_SPATIAL_X] = 1;
+
+  copyStrided(static_cast<const uint16_t *>(src + 7), srcstrides, dest, deststrides, makeShape(8, 1, 1, 1));
+
+  for (uint16_t i = 0U; i < 8U; ++i)
+    ASSERT_EQ(7U - i, dest[i]);
+}
+
+TEST(PixelCopy, Variant)
+{
+  VariantPixelBuffer src(boost::extents[6][5][1][1][1][2][1][1][1], PT::FLOAT);
+  VariantPixelBuffer dest(boost::extents[4][4][1][1][1][2][1][1][1], PT::FLOAT,
+                          PixelBufferBase::make_storage_order(DO::XYZTC, true));
+
+  float *data = src.data<float>();
+  for (PixelBufferBase::size_type i = 0U; i < src.num_elements(); ++i)
+    data[i] = static_cast<float>(i);
+
+  copyRegion(src, makeIndex(2, 1, 0, 0), dest, makeIndex(0, 0, 0, 0), makeShape(4, 4, 1, 2));
+
+  for (PixelBufferBase::index y = 0; y < 4; ++y)
+    for (PixelBufferBase::index x = 0; x < 4; ++x)
+      for (PixelBufferBase::index s = 0; s < 2; ++s)
+        ASSERT_EQ(src.array<float>()(makeIndex(x + 2, y + 1, 0, s)),
+                  dest.array<float>()(makeIndex(x, y, 0, s)));
+}
+
+TEST(PixelCopy, VariantBit)
+{
+  VariantPixelBuffer src(boost::extents[6][5][1][1][1][1][1][1][1], PT::BIT);
+  VariantPixelBuffer dest(boost::extents[6][5][1][1][1][1][1][1][1], PT::BIT);
+
+  bool *data = src.data<bool>();
+  for (PixelBufferBase::size_type i = 0U; i < src.num_elements(); ++i)
+    data[i] = (i % 3U) == 0U;
+
+  copyRegion(src, makeIndex(0, 0, 0, 0), dest, makeIndex(0, 0, 0, 0), makeShape(6, 5, 1, 1));
+
+  EXPECT_EQ(src, dest);
+}
+
+TEST(PixelCopy, VariantTypeMismatch)
+{
+  VariantPixelBuffer src(boost::extents[4][4][1][1][1][1][1][1][1], PT::UINT8);
+  VariantPixelBuffer dest(boost::extents[4][4][1][1][1][1][1][1][1], PT::UINT16);
+
+  EXPECT_THROW(copyRegion(src, makeIndex(0, 0, 0, 0), dest, makeIndex(0, 0, 0, 0), makeShape(4, 4, 1, 1)),
+               std::logic_error);
+}
+
+// Disable missing-prototypes warning for INSTANTIATE_TEST_CASE_P;
+// this is solely to work around a missing prototype in gtest.
+#ifdef __GNUC__
+#  if defined __clang__ || defined __APPLE__
+#    pragma GCC diagnostic ignored "-Wmissing-prototypes"
+#  endif
+#  pragma GCC diagnostic ignored "-Wmissing-declarations"
+#endif
+
+INSTANTIATE_TEST_CASE_P(PixelCopyVariants, PixelCopyTest,
+                        ::testing::Combine(::testing::Bool(), ::testing::Bool()));
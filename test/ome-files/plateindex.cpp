@@ -0,0 +1,181 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2014 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <string>
+
+#include <ome/files/MetadataTools.h>
+#include <ome/files/PlateIndex.h>
+
+#include <ome/test/test.h>
+
+using ome::files::dimension_size_type;
+using ome::files::PlateIndex;
+
+namespace
+{
+
+  const std::string pixels
+  ("<Pixels ID=\"Pixels:%\" DimensionOrder=\"XYZCT\" Type=\"uint8\" "
+   "SizeX=\"1\" SizeY=\"1\" SizeZ=\"1\" SizeC=\"1\" SizeT=\"1\"><MetadataOnly/></Pixels>");
+
+  std::string
+  image(const std::string& id)
+  {
+    std::string p(pixels);
+    p.replace(p.find('%'), 1, id);
+    return "<Image ID=\"Image:" + id + "\">" + p + "</Image>";
+  }
+
+  const std::string document
+  ("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+   "<OME xmlns=\"http://www.openmicroscopy.org/Schemas/OME/2016-06\">"
+   "<Dataset ID=\"Dataset:0\"><ImageRef ID=\"Image:3\"/></Dataset>"
+   "<Plate ID=\"Plate:0\">"
+   "<Well ID=\"Well:0\" Row=\"0\" Column=\"0\">"
+   "<WellSample ID=\"WellSample:0\" Index=\"0\"><ImageRef ID=\"Image:2\"/></WellSample>"
+   "<WellSample ID=\"WellSample:1\" Index=\"1\"><ImageRef ID=\"Image:0\"/></WellSample>"
+   "</Well>"
+   "<Well ID=\"Well:1\" Row=\"1\" Column=\"2\">"
+   "<WellSample ID=\"WellSample:2\" Index=\"2\"><ImageRef ID=\"Image:1\"/></WellSample>"
+   "<WellSample ID=\"WellSample:3\" Index=\"3\"/>"
+   "</Well>"
+   "</Plate>"
+   "<Plate ID=\"Plate:1\">"
+   "<Well ID=\"Well:2\" Row=\"0\" Column=\"0\">"
+   "<WellSample ID=\"WellSample:4\" Index=\"4\"><ImageRef ID=\"Image:4\"/></WellSample>"
+   "</Well>"
+   "</Plate>"
+   + image("0") + image("1") + image("2") + image("3") + image("4") +
+   "</OME>\n");
+
+  void
+  checkIndex(const PlateIndex& index)
+  {
+    EXPECT_EQ(4U, index.size());
+    EXPECT_FALSE(index.empty());
+
+    EXPECT_EQ(2U, index.findSeries(0, 0, 0, 0).get_value_or(99U));
+    EXPECT_EQ(0U, index.findSeries(0, 0, 0, 1).get_value_or(99U));
+    EXPECT_EQ(1U, index.findSeries(0, 1, 2, 0).get_value_or(99U));
+    EXPECT_EQ(4U, index.findSeries(1, 0, 0, 0).get_value_or(99U));
+    EXPECT_FALSE(index.findSeries(0, 1, 2, 1));
+    EXPECT_FALSE(index.findSeries(0, 2, 1, 0));
+    EXPECT_FALSE(index.findSeries(2, 0, 0, 0));
+
+    boost::optional<PlateIndex::Location> location(index.findLocation(1));
+    ASSERT_TRUE(!!location);
+    EXPECT_EQ(0U, location->plate);
+    EXPECT_EQ(1U, location->well);
+    EXPECT_EQ(1U, location->row);
+    EXPECT_EQ(2U, location->column);
+    EXPECT_EQ(0U, location->field);
+
+    location = index.findLocation(4);
+    ASSERT_TRUE(!!location);
+    EXPECT_EQ(1U, location->plate);
+    EXPECT_EQ(0U, location->well);
+
+    // Image:3 is only referenced by a Dataset.
+    EXPECT_FALSE(index.findLocation(3));
+    EXPECT_FALSE(index.findLocation(5));
+  }
+
+}
+
+TEST(PlateIndex, Empty)
+{
+  PlateIndex index;
+  EXPECT_TRUE(index.empty());
+  EXPECT_EQ(0U, index.size());
+  EXPECT_FALSE(index.findSeries(0, 0, 0, 0));
+  EXPECT_FALSE(index.findLocation(0));
+}
+
+TEST(PlateIndex, Add)
+{
+  PlateIndex index;
+  for (dimension_size_type row = 0; row < 8; ++row)
+    for (dimension_size_type column = 0; column < 12; ++column)
+      for (dimension_size_type field = 0; field < 4; ++field)
+        {
+          PlateIndex::Location location = {0U, row * 12 + column, row, column, field};
+          index.add(location, ((row * 12) + column) * 4 + field);
+        }
+
+  ASSERT_EQ(384U, index.size());
+  EXPECT_EQ(((5U * 12U) + 7U) * 4U + 3U, index.findSeries(0, 5, 7, 3).get_value_or(0U));
+  boost::optional<PlateIndex::Location> location(index.findLocation(383));
+  ASSERT_TRUE(!!location);
+  EXPECT_EQ(7U, location->row);
+  EXPECT_EQ(11U, location->column);
+  EXPECT_EQ(3U, location->field);
+  EXPECT_EQ(95U, location->well);
+
+  // Round trip through the entries.
+  PlateIndex copy;
+  for (const auto& entry : index.getEntries())
+    copy.add(entry.location, entry.series);
+  EXPECT_EQ(index.size(), copy.size());
+  EXPECT_EQ(index.findSeries(0, 3, 4, 1).get_value_or(0U), copy.findSeries(0, 3, 4, 1).get_value_or(1U));
+}
+
+TEST(PlateIndex, Replace)
+{
+  PlateIndex index;
+  PlateIndex::Location location = {0U, 0U, 0U, 0U, 0U};
+  index.add(location, 3U);
+  index.add(location, 5U);
+  EXPECT_EQ(1U, index.size());
+  EXPECT_EQ(5U, index.findSeries(0, 0, 0, 0).get_value_or(0U));
+  EXPECT_FALSE(index.findLocation(3));
+  EXPECT_TRUE(!!index.findLocation(5));
+}
+
+TEST(PlateIndex, CompleteMetadata)
+{
+  auto meta = ome::files::createOMEXMLMetadata(document);
+  ASSERT_TRUE(!!meta);
+  checkIndex(PlateIndex(*meta));
+}
+
+TEST(PlateIndex, TiffDataMetadata)
+{
+  auto meta = ome::files::createTiffDataMetadata(document);
+  ASSERT_TRUE(!!meta);
+  checkIndex(PlateIndex(*meta));
+}
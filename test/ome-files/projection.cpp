@@ -0,0 +1,274 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2014 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/filesystem/path.hpp>
+
+#include <ome/files/PixelBuffer.h>
+#include <ome/files/PlaneRegion.h>
+#include <ome/files/Projection.h>
+#include <ome/files/VariantPixelBuffer.h>
+#include <ome/files/in/MinimalTIFFReader.h>
+#include <ome/files/tiff/IFD.h>
+#include <ome/files/tiff/TIFF.h>
+
+#include <ome/test/test.h>
+
+using ome::files::dimension_size_type;
+using ome::files::PixelProperties;
+using ome::files::PlaneRegion;
+using ome::files::project;
+using ome::files::ProjectionMethod;
+using ome::files::VariantPixelBuffer;
+using ome::files::in::MinimalTIFFReader;
+using ome::files::tiff::IFD;
+using ome::files::tiff::TIFF;
+typedef ome::xml::model::enums::PixelType PT;
+
+namespace
+{
+
+  typedef PixelProperties<PT::UINT16>::std_type uint16_pixel;
+  typedef PixelProperties<PT::DOUBLE>::std_type double_pixel;
+
+  const dimension_size_type width = 70U;
+  const dimension_size_type height = 45U;
+  const dimension_size_type planes = 5U;
+
+  uint16_pixel
+  value(dimension_size_type x,
+        dimension_size_type y,
+        dimension_size_type p)
+  {
+    return static_cast<uint16_pixel>(((x * 37U) + (y * 11U) + (p * 4099U)) % 60000U);
+  }
+
+  VariantPixelBuffer::indices_type
+  makeIndex(dimension_size_type x,
+            dimension_size_type y)
+  {
+    VariantPixelBuffer::indices_type idx;
+    idx.fill(0);
+    idx[ome::files::DIM_SPATIAL_X] = static_cast<VariantPixelBuffer::indices_type::value_type>(x);
+    idx[ome::files::DIM_SPATIAL_Y] = static_cast<VariantPixelBuffer::indices_type::value_type>(y);
+    return idx;
+  }
+
+  // Expected projection of a single pixel.
+  double
+  expected(ProjectionMethod    method,
+           dimension_size_type x,
+           dimension_size_type y)
+  {
+    double result = value(x, y, 0);
+    for (dimension_size_type p = 1; p < planes; ++p)
+      {
+        double v = value(x, y, p);
+        switch (method)
+          {
+          case ome::files::PROJECTION_MAXIMUM:
+            result = std::max(result, v);
+            break;
+          case ome::files::PROJECTION_MINIMUM:
+            result = std::min(result, v);
+            break;
+          case ome::files::PROJECTION_SUM:
+          case ome::files::PROJECTION_MEAN:
+            result += v;
+            break;
+          }
+      }
+    if (method == ome::files::PROJECTION_MEAN)
+      result /= static_cast<double>(planes);
+    return result;
+  }
+
+  double
+  get(const VariantPixelBuffer& buf,
+      dimension_size_type       x,
+      dimension_size_type       y)
+  {
+    if (buf.pixelType() == PT::DOUBLE)
+      return buf.array<double_pixel>()(makeIndex(x, y));
+    return buf.array<uint16_pixel>()(makeIndex(x, y));
+  }
+
+}
+
+class ProjectionTest : public ::testing::TestWithParam<dimension_size_type>
+{
+public:
+  MinimalTIFFReader reader;
+
+  static void
+  SetUpTestCase()
+  {
+    std::array<VariantPixelBuffer::size_type, 9> shape;
+    std::fill(shape.begin(), shape.end(), 1U);
+    shape[ome::files::DIM_SPATIAL_X] = width;
+    shape[ome::files::DIM_SPATIAL_Y] = height;
+
+    boost::filesystem::create_directories(path().parent_path());
+
+    // One directory per timepoint, with partial edge tiles.
+    std::shared_ptr<TIFF> tiff(TIFF::open(path(), "w"));
+    for (dimension_size_type p = 0; p < planes; ++p)
+      {
+        VariantPixelBuffer buf(shape, PT::UINT16);
+        for (dimension_size_type y = 0; y < height; ++y)
+          for (dimension_size_type x = 0; x < width; ++x)
+            buf.array<uint16_pixel>()(makeIndex(x, y)) = value(x, y, p);
+
+        std::shared_ptr<IFD> ifd(tiff->getCurrentDirectory());
+        ifd->setImageWidth(width);
+        ifd->setImageHeight(height);
+        ifd->setTileType(ome::files::tiff::TILE);
+        ifd->setTileWidth(16U);
+        ifd->setTileHeight(16U);
+        ifd->setPixelType(PT::UINT16);
+        ifd->setBitsPerSample(16U);
+        ifd->setSamplesPerPixel(1U);
+        ifd->setPlanarConfiguration(ome::files::tiff::CONTIG);
+        ifd->setPhotometricInterpretation(ome::files::tiff::MIN_IS_BLACK);
+        ifd->writeImage(buf);
+        tiff->writeCurrentDirectory();
+      }
+    tiff->close();
+  }
+
+  static boost::filesystem::path
+  path()
+  {
+    return PROJECT_BINARY_DIR "/test/ome-files/data/projection.tiff";
+  }
+
+  void
+  SetUp()
+  {
+    reader.setId(path());
+  }
+};
+
+TEST_P(ProjectionTest, Methods)
+{
+  const ProjectionMethod methods[] =
+    {
+      ome::files::PROJECTION_MAXIMUM,
+      ome::files::PROJECTION_MINIMUM,
+      ome::files::PROJECTION_SUM,
+      ome::files::PROJECTION_MEAN
+    };
+
+  ASSERT_EQ(planes, reader.getSizeT());
+
+  for (const auto method : methods)
+    {
+      VariantPixelBuffer dest;
+      ASSERT_NO_THROW(project(reader, ome::files::PROJECTION_T, method, 0, 0, dest, GetParam()));
+
+      EXPECT_EQ((method == ome::files::PROJECTION_MAXIMUM ||
+                 method == ome::files::PROJECTION_MINIMUM) ? PT::UINT16 : PT::DOUBLE,
+                dest.pixelType());
+      ASSERT_EQ(width, dest.shape()[ome::files::DIM_SPATIAL_X]);
+      ASSERT_EQ(height, dest.shape()[ome::files::DIM_SPATIAL_Y]);
+
+      for (dimension_size_type y = 0; y < height; ++y)
+        for (dimension_size_type x = 0; x < width; ++x)
+          ASSERT_DOUBLE_EQ(expected(method, x, y), get(dest, x, y));
+    }
+}
+
+TEST_P(ProjectionTest, Region)
+{
+  const PlaneRegion region(5, 9, 37, 30);
+
+  VariantPixelBuffer dest;
+  ASSERT_NO_THROW(project(reader, ome::files::PROJECTION_T, ome::files::PROJECTION_MAXIMUM,
+                          0, 0, region, dest, GetParam()));
+  ASSERT_EQ(region.w, dest.shape()[ome::files::DIM_SPATIAL_X]);
+  ASSERT_EQ(region.h, dest.shape()[ome::files::DIM_SPATIAL_Y]);
+
+  for (dimension_size_type y = 0; y < region.h; ++y)
+    for (dimension_size_type x = 0; x < region.w; ++x)
+      ASSERT_DOUBLE_EQ(expected(ome::files::PROJECTION_MAXIMUM, region.x + x, region.y + y),
+                       get(dest, x, y));
+}
+
+TEST_P(ProjectionTest, SinglePlane)
+{
+  // A projection over a single plane is the plane itself.
+  VariantPixelBuffer plane;
+  reader.openBytes(3, plane);
+
+  VariantPixelBuffer dest;
+  ASSERT_NO_THROW(project(reader, ome::files::PROJECTION_Z, ome::files::PROJECTION_MINIMUM,
+                          0, 3, dest, GetParam()));
+  EXPECT_TRUE(plane == dest);
+}
+
+TEST_P(ProjectionTest, Invalid)
+{
+  VariantPixelBuffer dest;
+  EXPECT_THROW(project(reader, ome::files::PROJECTION_T, ome::files::PROJECTION_SUM,
+                       1, 0, dest, GetParam()), std::logic_error);
+  EXPECT_THROW(project(reader, ome::files::PROJECTION_T, ome::files::PROJECTION_SUM,
+                       0, 1, dest, GetParam()), std::logic_error);
+  EXPECT_THROW(project(reader, ome::files::PROJECTION_Z, ome::files::PROJECTION_SUM,
+                       0, planes, dest, GetParam()), std::logic_error);
+  EXPECT_THROW(project(reader, ome::files::PROJECTION_T, ome::files::PROJECTION_SUM,
+                       0, 0, PlaneRegion(60, 0, 20, 10), dest, GetParam()), std::logic_error);
+}
+
+const dimension_size_type thread_counts[] = { 1U, 3U, 16U };
+
+// Disable missing-prototypes warning for INSTANTIATE_TEST_CASE_P;
+// this is solely to work around a missing prototype in gtest.
+#ifdef __GNUC__
+#  if defined __clang__ || defined __APPLE__
+#    pragma GCC diagnostic ignored "-Wmissing-prototypes"
+#  endif
+#  pragma GCC diagnostic ignored "-Wmissing-declarations"
+#endif
+
+INSTANTIATE_TEST_CASE_P(ProjectionVariants, ProjectionTest, ::testing::ValuesIn(thread_counts));
@@ -0,0 +1,392 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2016 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+// Region read benchmark.  This generates tiled and stripped
+// OME-TIFF files with several Z planes, then reads them with
+// OMETIFFReader::openBytes using a number of access patterns, and
+// reports the throughput, latency percentiles and the number of
+// bytes decoded for each byte returned to the caller.  The latter
+// makes visible the overhead of reading regions which are not
+// aligned with the tile or strip layout, since every tile or strip
+// intersecting a region must be decoded in full.
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+
+#include <ome/files/CoreMetadata.h>
+#include <ome/files/MetadataTools.h>
+#include <ome/files/PixelProperties.h>
+#include <ome/files/PlaneRegion.h>
+#include <ome/files/VariantPixelBuffer.h>
+#include <ome/files/in/OMETIFFReader.h>
+#include <ome/files/out/OMETIFFWriter.h>
+
+#include <ome/xml/meta/OMEXMLMetadata.h>
+
+namespace opt = boost::program_options;
+
+using ome::files::dimension_size_type;
+using ome::files::CoreMetadata;
+using ome::files::PlaneRegion;
+using ome::files::VariantPixelBuffer;
+using ome::files::in::OMETIFFReader;
+using ome::files::out::OMETIFFWriter;
+using ome::xml::model::enums::PixelType;
+
+namespace
+{
+
+  // A single read request.
+  struct Read
+  {
+    dimension_size_type plane;
+    PlaneRegion         region;
+  };
+
+  // Benchmark settings.
+  struct Settings
+  {
+    dimension_size_type     size;
+    dimension_size_type     planes;
+    dimension_size_type     tilesize;
+    dimension_size_type     stripsize;
+    dimension_size_type     viewportwidth;
+    dimension_size_type     viewportheight;
+    dimension_size_type     reads;
+    PixelType               pixeltype;
+    boost::filesystem::path dir;
+  };
+
+  // Image layout.
+  struct Layout
+  {
+    std::string             name;
+    bool                    tiled;
+    dimension_size_type     tilewidth;
+    dimension_size_type     tileheight;
+    boost::filesystem::path file;
+  };
+
+  // Fill a plane with a gradient which differs between planes.
+  struct GradientVisitor : public boost::static_visitor<>
+  {
+    dimension_size_type plane;
+
+    GradientVisitor(dimension_size_type plane):
+      plane(plane)
+    {}
+
+    template<typename T>
+    void
+    operator() (std::shared_ptr<T>& buf)
+    {
+      typedef typename T::value_type value_type;
+
+      const VariantPixelBuffer::size_type *shape = buf->shape();
+      value_type *data = buf->data();
+      for (VariantPixelBuffer::size_type i = 0; i < buf->num_elements(); ++i)
+        data[i] = static_cast<value_type>(((i % shape[ome::files::DIM_SPATIAL_X]) +
+                                           (i / shape[ome::files::DIM_SPATIAL_X]) + plane) % 251U);
+    }
+  };
+
+  void
+  writeImage(const Settings& settings,
+             const Layout&   layout)
+  {
+    std::shared_ptr<CoreMetadata> core(std::make_shared<CoreMetadata>());
+    core->sizeX = settings.size;
+    core->sizeY = settings.size;
+    core->sizeZ = settings.planes;
+    core->imageCount = settings.planes;
+    core->pixelType = settings.pixeltype;
+    std::vector<std::shared_ptr<CoreMetadata>> seriesList(1U, core);
+
+    std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> meta(std::make_shared<::ome::xml::meta::OMEXMLMetadata>());
+    ome::files::fillMetadata(*meta, seriesList);
+    std::shared_ptr<::ome::xml::meta::MetadataRetrieve> retrieve(std::static_pointer_cast<::ome::xml::meta::MetadataRetrieve>(meta));
+
+    std::array<VariantPixelBuffer::size_type, 9> shape;
+    shape[ome::files::DIM_SPATIAL_X] = shape[ome::files::DIM_SPATIAL_Y] = settings.size;
+    shape[ome::files::DIM_SUBCHANNEL] = shape[ome::files::DIM_SPATIAL_Z] = shape[ome::files::DIM_TEMPORAL_T] =
+      shape[ome::files::DIM_CHANNEL] = shape[ome::files::DIM_MODULO_Z] = shape[ome::files::DIM_MODULO_T] =
+      shape[ome::files::DIM_MODULO_C] = 1;
+    VariantPixelBuffer pixels(shape, settings.pixeltype);
+
+    if (boost::filesystem::exists(layout.file))
+      boost::filesystem::remove(layout.file);
+
+    OMETIFFWriter writer;
+    writer.setMetadataRetrieve(retrieve);
+    writer.setInterleaved(false);
+    if (layout.tiled)
+      writer.setTileSizeX(layout.tilewidth);
+    writer.setTileSizeY(layout.tileheight);
+    writer.setId(layout.file);
+    for (dimension_size_type p = 0U; p < settings.planes; ++p)
+      {
+        GradientVisitor v(p);
+        boost::apply_visitor(v, pixels.vbuffer());
+        writer.saveBytes(p, pixels);
+      }
+    writer.close();
+  }
+
+  // Bytes decoded to read a region: every tile or strip intersecting
+  // the region is decoded in full.
+  dimension_size_type
+  decodedBytes(const Settings&    settings,
+               const Layout&      layout,
+               const PlaneRegion& region)
+  {
+    dimension_size_type x0 = region.x / layout.tilewidth;
+    dimension_size_type x1 = (region.x + region.w - 1U) / layout.tilewidth;
+    dimension_size_type y0 = region.y / layout.tileheight;
+    dimension_size_type y1 = (region.y + region.h - 1U) / layout.tileheight;
+    return (x1 - x0 + 1U) * (y1 - y0 + 1U) *
+      layout.tilewidth * layout.tileheight * ome::files::bytesPerPixel(settings.pixeltype);
+  }
+
+  // Access patterns.
+
+  std::vector<Read>
+  fullPlanes(const Settings& settings)
+  {
+    std::vector<Read> reads;
+    for (dimension_size_type p = 0U; p < settings.planes; ++p)
+      reads.push_back(Read{p, PlaneRegion(0U, 0U, settings.size, settings.size)});
+    return reads;
+  }
+
+  std::vector<Read>
+  sequentialTiles(const Settings& settings,
+                  dimension_size_type offset)
+  {
+    std::vector<Read> reads;
+    dimension_size_type ts = settings.tilesize;
+    for (dimension_size_type y = offset; y + ts <= settings.size; y += ts)
+      for (dimension_size_type x = offset; x + ts <= settings.size; x += ts)
+        reads.push_back(Read{0U, PlaneRegion(x, y, ts, ts)});
+    return reads;
+  }
+
+  std::vector<Read>
+  randomViewports(const Settings& settings)
+  {
+    std::vector<Read> reads;
+    dimension_size_type w = std::min(settings.viewportwidth, settings.size);
+    dimension_size_type h = std::min(settings.viewportheight, settings.size);
+    // Fixed seed for reproducibility.
+    std::mt19937 generator(42U);
+    std::uniform_int_distribution<dimension_size_type> xpos(0U, settings.size - w);
+    std::uniform_int_distribution<dimension_size_type> ypos(0U, settings.size - h);
+    std::uniform_int_distribution<dimension_size_type> plane(0U, settings.planes - 1U);
+    for (dimension_size_type i = 0U; i < settings.reads; ++i)
+      {
+        dimension_size_type p = plane(generator);
+        dimension_size_type x = xpos(generator);
+        dimension_size_type y = ypos(generator);
+        reads.push_back(Read{p, PlaneRegion(x, y, w, h)});
+      }
+    return reads;
+  }
+
+  std::vector<Read>
+  zColumn(const Settings& settings)
+  {
+    std::vector<Read> reads;
+    dimension_size_type ts = std::min(settings.tilesize, settings.size);
+    dimension_size_type pos = ((settings.size / 2U) / ts) * ts;
+    if (pos + ts > settings.size)
+      pos = settings.size - ts;
+    for (dimension_size_type i = 0U; i < settings.reads; ++i)
+      reads.push_back(Read{i % settings.planes, PlaneRegion(pos, pos, ts, ts)});
+    return reads;
+  }
+
+  // Run a set of reads and report the results.
+  void
+  benchmark(const Settings&          settings,
+            const Layout&            layout,
+            const OMETIFFReader&     reader,
+            const std::string&       pattern,
+            const std::vector<Read>& reads)
+  {
+    std::vector<double> latencies;
+    latencies.reserve(reads.size());
+    dimension_size_type returned = 0U;
+    dimension_size_type decoded = 0U;
+    double total = 0.0;
+
+    VariantPixelBuffer buf;
+    for (const auto& read : reads)
+      {
+        auto start = std::chrono::steady_clock::now();
+        reader.openBytes(read.plane, buf,
+                         read.region.x, read.region.y,
+                         read.region.w, read.region.h);
+        auto end = std::chrono::steady_clock::now();
+
+        double latency = std::chrono::duration<double, std::milli>(end - start).count();
+        latencies.push_back(latency);
+        total += latency;
+        returned += read.region.area() * ome::files::bytesPerPixel(settings.pixeltype);
+        decoded += decodedBytes(settings, layout, read.region);
+      }
+
+    if (latencies.empty())
+      return;
+
+    std::sort(latencies.begin(), latencies.end());
+    double p50 = latencies[(latencies.size() - 1U) / 2U];
+    double p99 = latencies[((latencies.size() - 1U) * 99U) / 100U];
+
+    std::cout << "  " << std::left << std::setw(18) << pattern << std::right
+              << std::fixed
+              << std::setw(8) << reads.size()
+              << std::setprecision(1)
+              << std::setw(12) << (static_cast<double>(returned) / 1.0e6) / (total / 1.0e3)
+              << std::setprecision(3)
+              << std::setw(12) << p50
+              << std::setw(12) << p99
+              << std::setprecision(2)
+              << std::setw(10) << static_cast<double>(decoded) / static_cast<double>(returned)
+              << '\n';
+  }
+
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  try
+    {
+      Settings settings;
+      std::string dir;
+      std::string pixeltype;
+      bool keep;
+
+      opt::options_description options("Options");
+      options.add_options()
+        ("help,h", "Show help options")
+        ("size", opt::value<dimension_size_type>(&settings.size)->default_value(4096U), "Image size (width and height)")
+        ("planes", opt::value<dimension_size_type>(&settings.planes)->default_value(8U), "Number of Z planes")
+        ("pixel-type", opt::value<std::string>(&pixeltype)->default_value("uint16"), "Pixel type")
+        ("tile-size", opt::value<dimension_size_type>(&settings.tilesize)->default_value(256U), "Tile size (multiple of 16)")
+        ("strip-size", opt::value<dimension_size_type>(&settings.stripsize)->default_value(16U), "Strip size (rows)")
+        ("viewport-width", opt::value<dimension_size_type>(&settings.viewportwidth)->default_value(1024U), "Random viewport width")
+        ("viewport-height", opt::value<dimension_size_type>(&settings.viewportheight)->default_value(768U), "Random viewport height")
+        ("reads", opt::value<dimension_size_type>(&settings.reads)->default_value(200U), "Number of random viewport and Z column reads")
+        ("dir", opt::value<std::string>(&dir)->default_value("."), "Directory for generated image files")
+        ("keep", opt::bool_switch(&keep), "Keep generated image files");
+
+      opt::variables_map vm;
+      opt::store(opt::parse_command_line(argc, argv, options), vm);
+      opt::notify(vm);
+
+      if (vm.count("help"))
+        {
+          std::cout << "Usage: " << argv[0] << " [options]\n\n" << options << '\n';
+          return EXIT_SUCCESS;
+        }
+
+      if (!settings.size || !settings.planes || !settings.tilesize || !settings.stripsize)
+        throw std::logic_error("Image size, plane count, tile size and strip size must be positive");
+
+      settings.pixeltype = PixelType(pixeltype);
+      settings.dir = dir;
+
+      std::vector<Layout> layouts;
+      layouts.push_back(Layout{"tiled", true, settings.tilesize, settings.tilesize,
+                               settings.dir / "region-benchmark-tiles.ome.tiff"});
+      layouts.push_back(Layout{"stripped", false, settings.size, settings.stripsize,
+                               settings.dir / "region-benchmark-strips.ome.tiff"});
+
+      for (const auto& layout : layouts)
+        {
+          writeImage(settings, layout);
+
+          std::cout << layout.name << ": " << settings.size << "×" << settings.size
+                    << "×" << settings.planes << ' ' << settings.pixeltype << ", "
+                    << layout.tilewidth << "×" << layout.tileheight
+                    << (layout.tiled ? " tiles\n" : " strips\n")
+                    << "  " << std::left << std::setw(18) << "pattern" << std::right
+                    << std::setw(8) << "reads"
+                    << std::setw(12) << "MB/s"
+                    << std::setw(12) << "p50 ms"
+                    << std::setw(12) << "p99 ms"
+                    << std::setw(10) << "decoded"
+                    << '\n';
+
+          OMETIFFReader reader;
+          reader.setId(layout.file);
+
+          benchmark(settings, layout, reader, "full plane", fullPlanes(settings));
+          benchmark(settings, layout, reader, "sequential tiles", sequentialTiles(settings, 0U));
+          benchmark(settings, layout, reader, "random viewports", randomViewports(settings));
+          benchmark(settings, layout, reader, "z column", zColumn(settings));
+          benchmark(settings, layout, reader, "misaligned tiles", sequentialTiles(settings, settings.tilesize / 2U));
+
+          reader.close();
+          std::cout << std::endl;
+
+          if (!keep)
+            boost::filesystem::remove(layout.file);
+        }
+    }
+  catch (const std::exception& e)
+    {
+      std::cerr << "Error: " << e.what() << std::endl;
+      return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,234 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2014 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <array>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem/path.hpp>
+
+#include <ome/files/CoreMetadata.h>
+#include <ome/files/MetadataTools.h>
+#include <ome/files/RegionMask.h>
+#include <ome/files/VariantPixelBuffer.h>
+#include <ome/files/in/OMETIFFReader.h>
+#include <ome/files/out/OMETIFFWriter.h>
+
+#include <ome/xml/meta/OMEXMLMetadata.h>
+
+#include <ome/test/test.h>
+
+using boost::filesystem::path;
+using ome::files::CoreMetadata;
+using ome::files::MaskedTile;
+using ome::files::PlaneRegion;
+using ome::files::RegionMask;
+using ome::files::VariantPixelBuffer;
+using ome::files::dimension_size_type;
+using ome::files::in::OMETIFFReader;
+using ome::files::out::OMETIFFWriter;
+using ome::xml::model::enums::PixelType;
+
+namespace
+{
+
+  const dimension_size_type sizeX = 512U;
+  const dimension_size_type sizeY = 384U;
+
+  uint16_t
+  expected(dimension_size_type x,
+           dimension_size_type y)
+  {
+    return static_cast<uint16_t>(y * sizeX + x + 1U);
+  }
+
+  // Write a 512×384 image with 64×64 tiles.
+  path
+  writeFile()
+  {
+    const path file(PROJECT_BINARY_DIR "/test/ome-files/data/regionmask.ome.tiff");
+
+    std::shared_ptr<CoreMetadata> c(std::make_shared<CoreMetadata>());
+    c->sizeX = sizeX;
+    c->sizeY = sizeY;
+    c->sizeC.clear();
+    c->sizeC.push_back(1);
+    c->pixelType = PixelType::UINT16;
+    c->imageCount = 1;
+    c->orderCertain = true;
+    c->interleaved = false;
+    std::vector<std::shared_ptr<CoreMetadata>> seriesList(1, c);
+
+    std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> meta(std::make_shared<::ome::xml::meta::OMEXMLMetadata>());
+    ome::files::fillMetadata(*meta, seriesList);
+
+    OMETIFFWriter writer;
+    writer.setMetadataRetrieve(meta);
+    writer.setTileSizeX(64);
+    writer.setTileSizeY(64);
+    writer.setId(file);
+
+    std::array<VariantPixelBuffer::size_type, 9> shape;
+    shape.fill(1U);
+    shape[ome::files::DIM_SPATIAL_X] = sizeX;
+    shape[ome::files::DIM_SPATIAL_Y] = sizeY;
+    VariantPixelBuffer buf(shape, PixelType::UINT16);
+    uint16_t *data = buf.array<uint16_t>().data();
+    for (dimension_size_type y = 0U; y < sizeY; ++y)
+      for (dimension_size_type x = 0U; x < sizeX; ++x)
+        data[y * sizeX + x] = expected(x, y);
+    writer.saveBytes(0, buf);
+    writer.close();
+
+    return file;
+  }
+
+  bool
+  same(const PlaneRegion& a,
+       const PlaneRegion& b)
+  {
+    return a.x == b.x && a.y == b.y && a.w == b.w && a.h == b.h;
+  }
+
+}
+
+TEST(RegionMask, Construct)
+{
+  RegionMask empty;
+  EXPECT_EQ(0U, empty.area());
+  EXPECT_FALSE(empty.contains(0, 0));
+
+  RegionMask rect(PlaneRegion(3, 4, 5, 6));
+  EXPECT_EQ(30U, rect.area());
+  EXPECT_TRUE(rect.contains(3, 4));
+  EXPECT_TRUE(rect.contains(7, 9));
+  EXPECT_FALSE(rect.contains(8, 9));
+  EXPECT_FALSE(rect.contains(7, 10));
+
+  std::vector<bool> bits{true, false, false, true};
+  RegionMask bitmap(PlaneRegion(10, 10, 2, 2), bits);
+  EXPECT_EQ(2U, bitmap.area());
+  EXPECT_TRUE(bitmap.contains(10, 10));
+  EXPECT_FALSE(bitmap.contains(11, 10));
+  EXPECT_TRUE(bitmap.intersects(PlaneRegion(11, 11, 5, 5)));
+  EXPECT_FALSE(bitmap.intersects(PlaneRegion(11, 0, 5, 11)));
+
+  EXPECT_THROW(RegionMask(PlaneRegion(0, 0, 2, 3), bits), std::logic_error);
+}
+
+TEST(RegionMask, Ellipse)
+{
+  RegionMask e(RegionMask::fromEllipse(10.0, 10.0, 3.0, 2.0));
+  EXPECT_TRUE(same(PlaneRegion(7, 8, 6, 4), e.getBounds()));
+  EXPECT_EQ(20U, e.area());
+  EXPECT_TRUE(e.contains(9, 9));
+  EXPECT_FALSE(e.contains(7, 8));
+
+  EXPECT_EQ(0U, RegionMask::fromEllipse(10.0, 10.0, 0.0, 2.0).area());
+}
+
+TEST(RegionMask, Polygon)
+{
+  RegionMask p(RegionMask::fromPolygon(std::string("2,2 12,2 2,12")));
+  EXPECT_TRUE(same(PlaneRegion(2, 2, 10, 10), p.getBounds()));
+  EXPECT_EQ(45U, p.area());
+  EXPECT_TRUE(p.contains(2, 2));
+  EXPECT_TRUE(p.contains(10, 2));
+  EXPECT_FALSE(p.contains(11, 2));
+  EXPECT_FALSE(p.contains(10, 10));
+  EXPECT_FALSE(p.intersects(PlaneRegion(8, 8, 4, 4)));
+
+  EXPECT_EQ(0U, RegionMask::fromPolygon(std::string("1,1 5,5")).area());
+  EXPECT_THROW(RegionMask::fromPolygon(std::string("1,2 3")), std::logic_error);
+  EXPECT_THROW(RegionMask::fromPolygon(std::string("1;2 3,4 5,6")), std::logic_error);
+}
+
+TEST(RegionMask, ReadTiles)
+{
+  const path file(writeFile());
+  OMETIFFReader reader;
+  ASSERT_NO_THROW(reader.setId(file));
+
+  // A triangle spanning 4×4 tiles, of which 10 intersect.
+  RegionMask mask(RegionMask::fromPolygon(std::string("0,0 256,0 0,256")));
+  std::vector<PlaneRegion> regions(getMaskTiles(reader, mask));
+  EXPECT_EQ(10U, regions.size());
+
+  std::vector<MaskedTile> tiles(readMaskedTiles(reader, 0U, mask));
+  ASSERT_EQ(regions.size(), tiles.size());
+  for (std::vector<MaskedTile>::size_type i = 0; i < tiles.size(); ++i)
+    {
+      const MaskedTile& tile(tiles[i]);
+      EXPECT_TRUE(same(regions[i], tile.region));
+      EXPECT_EQ(tile.region.w, tile.buffer.shape()[ome::files::DIM_SPATIAL_X]);
+      EXPECT_EQ(tile.region.h, tile.buffer.shape()[ome::files::DIM_SPATIAL_Y]);
+      const uint16_t *data = tile.buffer.data<uint16_t>();
+      EXPECT_EQ(expected(tile.region.x, tile.region.y), data[0]);
+    }
+
+  EXPECT_THROW(readMaskedTiles(reader, 1U, mask), std::logic_error);
+}
+
+TEST(RegionMask, ReadMasked)
+{
+  const path file(writeFile());
+  OMETIFFReader reader;
+  ASSERT_NO_THROW(reader.setId(file));
+
+  // Partly outside the image.
+  RegionMask mask(RegionMask::fromEllipse(480.0, 200.0, 60.0, 40.0));
+  VariantPixelBuffer buf;
+  PlaneRegion region = readMasked(reader, 0U, mask, buf);
+  EXPECT_TRUE(same(PlaneRegion(420, 160, 92, 80), region));
+  EXPECT_EQ(region.w, buf.shape()[ome::files::DIM_SPATIAL_X]);
+  EXPECT_EQ(region.h, buf.shape()[ome::files::DIM_SPATIAL_Y]);
+
+  const uint16_t *data = buf.data<uint16_t>();
+  for (dimension_size_type y = 0U; y < region.h; ++y)
+    for (dimension_size_type x = 0U; x < region.w; ++x)
+      {
+        const uint16_t value = mask.contains(region.x + x, region.y + y) ?
+          expected(region.x + x, region.y + y) : 0U;
+        ASSERT_EQ(value, data[y * region.w + x]);
+      }
+
+  EXPECT_THROW(readMasked(reader, 0U, RegionMask(PlaneRegion(600, 0, 10, 10)), buf),
+               std::logic_error);
+}
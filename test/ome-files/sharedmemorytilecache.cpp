@@ -0,0 +1,270 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include <boost/filesystem.hpp>
+
+#include <ome/files/SharedMemoryTileCache.h>
+#include <ome/files/TileBuffer.h>
+#include <ome/files/Types.h>
+
+#include <ome/test/config.h>
+#include <ome/test/test.h>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using ome::files::dimension_size_type;
+using ome::files::DecodedTileCache;
+using ome::files::SharedMemoryTileCache;
+using ome::files::TileBuffer;
+
+namespace
+{
+
+  std::shared_ptr<TileBuffer>
+  tile(dimension_size_type size,
+       uint8_t             value)
+  {
+    std::shared_ptr<TileBuffer> buf(std::make_shared<TileBuffer>(size));
+    std::fill(buf->data(), buf->data() + size, value);
+    return buf;
+  }
+
+}
+
+class SharedMemoryTileCacheTest : public ::testing::Test
+{
+public:
+  std::string name;
+  boost::filesystem::path file;
+  std::unique_ptr<SharedMemoryTileCache> cache;
+
+  virtual void
+  SetUp()
+  {
+    name = "/ome-files-test-" + std::to_string(::getpid());
+    SharedMemoryTileCache::remove(name);
+
+    file = boost::filesystem::path(PROJECT_BINARY_DIR "/test/ome-files/data/shared-tile-cache.tiff");
+    boost::filesystem::create_directories(file.parent_path());
+    std::ofstream(file.string()) << "tiles";
+
+    try
+      {
+        cache = std::make_unique<SharedMemoryTileCache>(name, 16U * 4096U, 4096U);
+      }
+    catch (const std::runtime_error&)
+      {
+        // Shared memory not supported.
+      }
+  }
+
+  virtual void
+  TearDown()
+  {
+    cache.reset();
+    SharedMemoryTileCache::remove(name);
+  }
+};
+
+TEST_F(SharedMemoryTileCacheTest, Construct)
+{
+  if (!cache)
+    return;
+
+  EXPECT_EQ(name, cache->getName());
+  EXPECT_EQ(16U, cache->getSlotCount());
+  EXPECT_EQ(4096U, cache->getSlotSize());
+  EXPECT_EQ(16U * 4096U, cache->getMaxByteSize());
+  EXPECT_EQ(0U, cache->size());
+  EXPECT_EQ(0U, cache->byteSize());
+
+  // The geometry of an existing segment is retained.
+  SharedMemoryTileCache other(name, 1024U * 1024U, 1024U);
+  EXPECT_EQ(16U, other.getSlotCount());
+  EXPECT_EQ(4096U, other.getSlotSize());
+
+  // The size is fixed.
+  cache->setMaxByteSize(4096U);
+  EXPECT_EQ(16U * 4096U, cache->getMaxByteSize());
+
+  EXPECT_THROW(SharedMemoryTileCache(name + "-invalid", 1024U, 4096U), std::logic_error);
+}
+
+TEST_F(SharedMemoryTileCacheTest, InsertFind)
+{
+  if (!cache)
+    return;
+
+  cache->insert(DecodedTileCache::key_type(file.string(), 8U, 3U), tile(4000U, 42U));
+  EXPECT_EQ(1U, cache->size());
+  EXPECT_EQ(4000U, cache->byteSize());
+
+  DecodedTileCache::value_type found(cache->find(file.string(), 8U, 3U));
+  ASSERT_TRUE(static_cast<bool>(found));
+  ASSERT_EQ(4000U, found->size());
+  EXPECT_EQ(42U, found->data()[0]);
+  EXPECT_EQ(42U, found->data()[3999]);
+
+  EXPECT_FALSE(static_cast<bool>(cache->find(file.string(), 8U, 4U)));
+  EXPECT_FALSE(static_cast<bool>(cache->find(file.string(), 16U, 3U)));
+  EXPECT_FALSE(static_cast<bool>(cache->find("other.tiff", 8U, 3U)));
+
+  // Replacement.
+  cache->insert(DecodedTileCache::key_type(file.string(), 8U, 3U), tile(100U, 7U));
+  EXPECT_EQ(1U, cache->size());
+  EXPECT_EQ(100U, cache->byteSize());
+  found = cache->find(DecodedTileCache::key_type(file.string(), 8U, 3U));
+  ASSERT_TRUE(static_cast<bool>(found));
+  ASSERT_EQ(100U, found->size());
+  EXPECT_EQ(7U, found->data()[0]);
+
+  // Tiles larger than a slot are not cached.
+  cache->insert(DecodedTileCache::key_type(file.string(), 8U, 5U), tile(8192U, 1U));
+  EXPECT_FALSE(static_cast<bool>(cache->find(file.string(), 8U, 5U)));
+  EXPECT_EQ(1U, cache->size());
+}
+
+TEST_F(SharedMemoryTileCacheTest, FileIdentity)
+{
+  if (!cache)
+    return;
+
+  // The same file by a different path.
+  boost::filesystem::path alias(file.parent_path() / "." / file.filename());
+  cache->insert(DecodedTileCache::key_type(file.string(), 8U, 0U), tile(64U, 9U));
+  EXPECT_TRUE(static_cast<bool>(cache->find(alias.string(), 8U, 0U)));
+
+  // Names which are not files are matched by name.
+  cache->insert(DecodedTileCache::key_type("memory:1", 8U, 0U), tile(64U, 3U));
+  EXPECT_TRUE(static_cast<bool>(cache->find("memory:1", 8U, 0U)));
+  EXPECT_FALSE(static_cast<bool>(cache->find("memory:2", 8U, 0U)));
+  EXPECT_EQ(2U, cache->size());
+
+  // A replaced file does not match once reopened; until then, the
+  // identity found on first use is kept, so that lookups do not
+  // stat the file.
+  boost::filesystem::remove(file);
+  std::ofstream(file.string()) << "replaced tiles";
+  EXPECT_TRUE(static_cast<bool>(cache->find(file.string(), 8U, 0U)));
+  cache->openFile(file.string());
+  EXPECT_FALSE(static_cast<bool>(cache->find(file.string(), 8U, 0U)));
+}
+
+TEST_F(SharedMemoryTileCacheTest, Eviction)
+{
+  if (!cache)
+    return;
+
+  for (dimension_size_type i = 0; i < 64U; ++i)
+    cache->insert(DecodedTileCache::key_type(file.string(), 8U, i), tile(1024U, static_cast<uint8_t>(i)));
+  EXPECT_LE(cache->size(), 16U);
+  EXPECT_GT(cache->size(), 0U);
+  EXPECT_EQ(cache->size() * 1024U, cache->byteSize());
+
+  // The last tile inserted is always present.
+  DecodedTileCache::value_type found(cache->find(file.string(), 8U, 63U));
+  ASSERT_TRUE(static_cast<bool>(found));
+  EXPECT_EQ(63U, found->data()[0]);
+}
+
+TEST_F(SharedMemoryTileCacheTest, EraseClear)
+{
+  if (!cache)
+    return;
+
+  cache->insert(DecodedTileCache::key_type(file.string(), 8U, 0U), tile(64U, 1U));
+  cache->insert(DecodedTileCache::key_type(file.string(), 8U, 1U), tile(64U, 1U));
+  cache->insert(DecodedTileCache::key_type("memory:1", 8U, 0U), tile(64U, 1U));
+  EXPECT_EQ(3U, cache->size());
+
+  cache->erase(file.string());
+  EXPECT_EQ(1U, cache->size());
+  EXPECT_FALSE(static_cast<bool>(cache->find(file.string(), 8U, 0U)));
+  EXPECT_TRUE(static_cast<bool>(cache->find("memory:1", 8U, 0U)));
+
+  cache->clear();
+  EXPECT_EQ(0U, cache->size());
+  EXPECT_EQ(0U, cache->byteSize());
+  EXPECT_FALSE(static_cast<bool>(cache->find("memory:1", 8U, 0U)));
+}
+
+TEST_F(SharedMemoryTileCacheTest, SharedBetweenInstances)
+{
+  if (!cache)
+    return;
+
+  SharedMemoryTileCache other(name);
+  cache->insert(DecodedTileCache::key_type(file.string(), 8U, 2U), tile(512U, 5U));
+  DecodedTileCache::value_type found(other.find(file.string(), 8U, 2U));
+  ASSERT_TRUE(static_cast<bool>(found));
+  EXPECT_EQ(5U, found->data()[511]);
+  EXPECT_EQ(1U, other.size());
+}
+
+TEST_F(SharedMemoryTileCacheTest, SharedBetweenProcesses)
+{
+  if (!cache)
+    return;
+
+  // A tile inserted by a worker process is found by the parent.
+  pid_t pid = ::fork();
+  ASSERT_GE(pid, 0);
+  if (pid == 0)
+    {
+      SharedMemoryTileCache worker(name);
+      worker.insert(DecodedTileCache::key_type(file.string(), 8U, 6U), tile(2048U, 11U));
+      ::_exit(worker.find(file.string(), 8U, 6U) ? 0 : 1);
+    }
+
+  int status = 0;
+  ASSERT_EQ(pid, ::waitpid(pid, &status, 0));
+  ASSERT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(0, WEXITSTATUS(status));
+
+  DecodedTileCache::value_type found(cache->find(file.string(), 8U, 6U));
+  ASSERT_TRUE(static_cast<bool>(found));
+  ASSERT_EQ(2048U, found->size());
+  EXPECT_EQ(11U, found->data()[0]);
+}
@@ -0,0 +1,595 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2016 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+
+
+// Synthetic dataset generator.  This writes OME-TIFF datasets of
+// arbitrary size for benchmarking, such as long time-lapses with
+// many IFDs, large tiled slides, multi-file plates (one series per
+// file) and sparse mosaics.  Pixel content is a deterministic
+// function of its position, so the dataset may be generated in
+// parallel: each plane is divided into bands which are generated by
+// a pool of threads.  Uncompressed single-file datasets are
+// preallocated and the bands are saved concurrently; otherwise the
+// bands of each file are saved in order as they are generated, and
+// encoded by the writer's encoding threads.
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <complex>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+
+#include <ome/files/CoreMetadata.h>
+#include <ome/files/MetadataTools.h>
+#include <ome/files/PixelProperties.h>
+#include <ome/files/VariantPixelBuffer.h>
+#include <ome/files/out/OMETIFFWriter.h>
+
+#include <ome/xml/meta/OMEXMLMetadata.h>
+
+namespace opt = boost::program_options;
+
+using ome::files::dimension_size_type;
+using ome::files::CoreMetadata;
+using ome::files::VariantPixelBuffer;
+using ome::files::out::OMETIFFWriter;
+using ome::xml::model::enums::PixelType;
+
+namespace
+{
+
+  // Pixel content.
+  enum Content
+    {
+      CONTENT_NOISE,
+      CONTENT_GRADIENT,
+      CONTENT_EMPTY
+    };
+
+  // Generator settings.
+  struct Settings
+  {
+    dimension_size_type     sizeX;
+    dimension_size_type     sizeY;
+    dimension_size_type     sizeZ;
+    dimension_size_type     sizeT;
+    dimension_size_type     channels;
+    dimension_size_type     samples;
+    dimension_size_type     series;
+    PixelType               pixeltype;
+    dimension_size_type     tilesize;
+    std::string             compression;
+    bool                    split;
+    Content                 content;
+    double                  fill;
+    dimension_size_type     cellsize;
+    uint64_t                seed;
+    dimension_size_type     threads;
+    boost::filesystem::path file;
+  };
+
+  // Mix bits of a 64-bit value (splitmix64 finaliser).
+  uint64_t
+  mix(uint64_t v)
+  {
+    v ^= v >> 30U;
+    v *= UINT64_C(0xbf58476d1ce4e5b9);
+    v ^= v >> 27U;
+    v *= UINT64_C(0x94d049bb133111eb);
+    v ^= v >> 31U;
+    return v;
+  }
+
+  // Uniform value in [0,1) for a hash.
+  double
+  unit(uint64_t v)
+  {
+    return static_cast<double>(v >> 11U) * (1.0 / 9007199254740992.0);
+  }
+
+  // Convert a value in [0,1) to a pixel value.
+  template<typename T>
+  typename std::enable_if<std::is_same<T, bool>::value, T>::type
+  pixelValue(double v)
+  {
+    return v >= 0.5;
+  }
+
+  template<typename T>
+  typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value, T>::type
+  pixelValue(double v)
+  {
+    return static_cast<T>(static_cast<double>(std::numeric_limits<T>::min()) +
+                          v * (static_cast<double>(std::numeric_limits<T>::max()) -
+                               static_cast<double>(std::numeric_limits<T>::min())));
+  }
+
+  template<typename T>
+  typename std::enable_if<std::is_floating_point<T>::value, T>::type
+  pixelValue(double v)
+  {
+    return static_cast<T>(v);
+  }
+
+  template<typename T>
+  typename std::enable_if<!std::is_arithmetic<T>::value, T>::type
+  pixelValue(double v)
+  {
+    // Complex.
+    return T(static_cast<typename T::value_type>(v), 0);
+  }
+
+  // A band of rows of one plane of one series.
+  struct Band
+  {
+    dimension_size_type series;
+    dimension_size_type plane;
+    dimension_size_type y;
+    dimension_size_type h;
+  };
+
+  // Generate the pixel content of a band.
+  struct GenerateVisitor : public boost::static_visitor<>
+  {
+    const Settings& settings;
+    const Band&     band;
+
+    GenerateVisitor(const Settings& settings,
+                    const Band&     band):
+      settings(settings),
+      band(band)
+    {}
+
+    template<typename T>
+    void
+    operator() (std::shared_ptr<T>& buf)
+    {
+      typedef typename T::value_type value_type;
+
+      // Planar buffer: X varies fastest, then Y, then sample.
+      value_type *data = buf->data();
+      const uint64_t planeseed = mix(settings.seed ^ mix((band.series << 32U) ^ band.plane));
+      const double scale = 1.0 / static_cast<double>(settings.sizeX + settings.sizeY);
+      const double offset = unit(planeseed) * 0.25;
+
+      for (dimension_size_type s = 0U; s < settings.samples; ++s)
+        for (dimension_size_type j = 0U; j < band.h; ++j)
+          {
+            const dimension_size_type y = band.y + j;
+            value_type *row = data + ((s * band.h) + j) * settings.sizeX;
+            for (dimension_size_type x = 0U; x < settings.sizeX; ++x)
+              {
+                double v = 0.0;
+                if (settings.content != CONTENT_EMPTY)
+                  {
+                    // Cells of a sparse mosaic are empty or filled
+                    // as a whole.
+                    const uint64_t cell = mix(planeseed ^ mix(((y / settings.cellsize) << 32U) ^
+                                                              (x / settings.cellsize)));
+                    if (settings.fill >= 1.0 || unit(cell) < settings.fill)
+                      {
+                        if (settings.content == CONTENT_NOISE)
+                          v = unit(mix(planeseed ^ mix((((y << 24U) ^ x) << 8U) ^ s)));
+                        else
+                          {
+                            v = (static_cast<double>(x + y) * scale) * 0.75 + offset;
+                            if (s)
+                              v = 1.0 - v;
+                          }
+                      }
+                  }
+                row[x] = pixelValue<value_type>(v);
+              }
+          }
+    }
+  };
+
+  // Saves the bands of a single file in order.
+  struct OrderedFile
+  {
+    std::shared_ptr<OMETIFFWriter> writer;
+    dimension_size_type            next;
+    dimension_size_type            series;
+    std::mutex                     mutex;
+    std::condition_variable        ready;
+
+    OrderedFile(const std::shared_ptr<OMETIFFWriter>& writer,
+                dimension_size_type                   series):
+      writer(writer),
+      next(0U),
+      series(series),
+      mutex(),
+      ready()
+    {}
+  };
+
+  // Work shared between generator threads.
+  struct Work
+  {
+    std::vector<Band>                         bands;
+    // File and sequence number within the file of each band; unused
+    // when preallocated.
+    std::vector<std::pair<dimension_size_type, dimension_size_type>> order;
+    std::vector<std::unique_ptr<OrderedFile>> files;
+    std::atomic<dimension_size_type>          nextBand;
+    std::atomic<bool>                         failed;
+    std::mutex                                errorMutex;
+    std::exception_ptr                        error;
+
+    Work():
+      bands(),
+      order(),
+      files(),
+      nextBand(0U),
+      failed(false),
+      errorMutex(),
+      error()
+    {}
+  };
+
+  std::array<VariantPixelBuffer::size_type, 9>
+  bandShape(const Settings& settings,
+            dimension_size_type h)
+  {
+    std::array<VariantPixelBuffer::size_type, 9> shape;
+    shape.fill(1U);
+    shape[ome::files::DIM_SPATIAL_X] = settings.sizeX;
+    shape[ome::files::DIM_SPATIAL_Y] = h;
+    shape[ome::files::DIM_SUBCHANNEL] = settings.samples;
+    return shape;
+  }
+
+  // Generate and save bands until none remain.
+  void
+  generate(const Settings& settings,
+           Work&           work,
+           OMETIFFWriter&  preallocated)
+  {
+    try
+      {
+        std::unique_ptr<VariantPixelBuffer> buf;
+        for (;;)
+          {
+            const dimension_size_type b = work.nextBand++;
+            if (b >= work.bands.size() || work.failed)
+              break;
+            const Band& band(work.bands[b]);
+
+            // Reallocate only for a band of a different height.
+            if (!buf || buf->shape()[ome::files::DIM_SPATIAL_Y] != band.h)
+              buf.reset(new VariantPixelBuffer(bandShape(settings, band.h), settings.pixeltype,
+                                               ome::files::PixelBufferBase::make_storage_order(ome::xml::model::enums::DimensionOrder::XYZCT, false),
+                                               ome::files::PIXEL_UNINITIALIZED));
+            GenerateVisitor v(settings, band);
+            boost::apply_visitor(v, buf->vbuffer());
+
+            if (work.files.empty())
+              {
+                preallocated.saveBytes(band.plane, *buf, 0U, band.y, settings.sizeX, band.h);
+                continue;
+              }
+
+            OrderedFile& file(*work.files[work.order[b].first]);
+            const dimension_size_type sequence = work.order[b].second;
+            std::unique_lock<std::mutex> lock(file.mutex);
+            file.ready.wait(lock, [&]{ return file.next == sequence || work.failed; });
+            if (work.failed)
+              break;
+            if (band.series != file.series)
+              {
+                file.writer->setSeries(band.series);
+                file.series = band.series;
+              }
+            file.writer->saveBytes(band.plane, *buf, 0U, band.y, settings.sizeX, band.h);
+            ++file.next;
+            file.ready.notify_all();
+          }
+      }
+    catch (...)
+      {
+        {
+          std::lock_guard<std::mutex> lock(work.errorMutex);
+          if (!work.error)
+            work.error = std::current_exception();
+        }
+        work.failed = true;
+        for (auto& file : work.files)
+          {
+            std::lock_guard<std::mutex> lock(file->mutex);
+            file->ready.notify_all();
+          }
+      }
+  }
+
+  // Run the generator threads over all bands.
+  void
+  runThreads(const Settings& settings,
+             Work&           work,
+             OMETIFFWriter&  preallocated)
+  {
+    std::vector<std::thread> threads;
+    for (dimension_size_type t = 0U; t < settings.threads; ++t)
+      threads.emplace_back([&]{ generate(settings, work, preallocated); });
+    for (auto& thread : threads)
+      thread.join();
+    if (work.error)
+      std::rethrow_exception(work.error);
+  }
+
+  boost::filesystem::path
+  seriesFile(const Settings&     settings,
+             dimension_size_type series)
+  {
+    if (!settings.split || !series)
+      return settings.file;
+
+    // Insert the series number before the .ome.tiff extension.
+    boost::filesystem::path file(settings.file);
+    std::string name(file.filename().string());
+    std::string::size_type pos = name.find('.');
+    if (pos == std::string::npos)
+      pos = name.size();
+    name.insert(pos, "-" + std::to_string(series));
+    return file.parent_path() / name;
+  }
+
+  // Generate the dataset.
+  void
+  run(const Settings& settings)
+  {
+    std::vector<std::shared_ptr<CoreMetadata>> seriesList;
+    for (dimension_size_type s = 0U; s < settings.series; ++s)
+      {
+        std::shared_ptr<CoreMetadata> core(std::make_shared<CoreMetadata>());
+        core->sizeX = settings.sizeX;
+        core->sizeY = settings.sizeY;
+        core->sizeZ = settings.sizeZ;
+        core->sizeT = settings.sizeT;
+        core->sizeC.assign(settings.channels, settings.samples);
+        core->pixelType = settings.pixeltype;
+        core->imageCount = settings.sizeZ * settings.sizeT * settings.channels;
+        core->orderCertain = true;
+        core->interleaved = false;
+        core->dimensionOrder = ome::xml::model::enums::DimensionOrder::XYZCT;
+        seriesList.push_back(core);
+      }
+
+    std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> meta(std::make_shared<::ome::xml::meta::OMEXMLMetadata>());
+    ome::files::fillMetadata(*meta, seriesList);
+    std::shared_ptr<::ome::xml::meta::MetadataRetrieve> retrieve(std::static_pointer_cast<::ome::xml::meta::MetadataRetrieve>(meta));
+
+    const bool preallocate = !settings.split && settings.compression == "none";
+
+    for (dimension_size_type s = 0U; s < settings.series; ++s)
+      if (boost::filesystem::exists(seriesFile(settings, s)))
+        boost::filesystem::remove(seriesFile(settings, s));
+
+    auto start = std::chrono::steady_clock::now();
+
+    OMETIFFWriter writer;
+    writer.setMetadataRetrieve(retrieve);
+    writer.setInterleaved(false);
+    if (settings.tilesize)
+      {
+        writer.setTileSizeX(settings.tilesize);
+        writer.setTileSizeY(settings.tilesize);
+      }
+    if (settings.compression != "none")
+      writer.setCompression(settings.compression);
+    writer.setEncodeThreads(settings.threads);
+    writer.setPreallocated(preallocate);
+    writer.setId(settings.file);
+
+    // Bands are a whole number of tiles high, and otherwise of
+    // around 16MiB.
+    const dimension_size_type rowbytes = settings.sizeX * settings.samples *
+      ome::files::bytesPerPixel(settings.pixeltype);
+    dimension_size_type bandheight = std::max(dimension_size_type(1U),
+                                              std::min(settings.sizeY, (dimension_size_type(16U) << 20U) / rowbytes));
+    if (settings.tilesize)
+      bandheight = std::max(settings.tilesize, (bandheight / settings.tilesize) * settings.tilesize);
+
+    const dimension_size_type planes = seriesList[0]->imageCount;
+
+    if (preallocate)
+      {
+        // Bands of all planes of the current series are saved
+        // concurrently.
+        for (dimension_size_type s = 0U; s < settings.series; ++s)
+          {
+            writer.setSeries(s);
+            Work work;
+            for (dimension_size_type p = 0U; p < planes; ++p)
+              for (dimension_size_type y = 0U; y < settings.sizeY; y += bandheight)
+                work.bands.push_back(Band{s, p, y, std::min(bandheight, settings.sizeY - y)});
+            runThreads(settings, work, writer);
+          }
+      }
+    else
+      {
+        // Each file saves its bands in order.  Bands are interleaved
+        // between files so that the files are written concurrently.
+        Work work;
+        std::shared_ptr<OMETIFFWriter> main(&writer, [](OMETIFFWriter *){});
+        work.files.emplace_back(new OrderedFile(main, 0U));
+        if (settings.split)
+          for (dimension_size_type s = 1U; s < settings.series; ++s)
+            work.files.emplace_back(new OrderedFile(writer.createFileWriter(seriesFile(settings, s), s), s));
+
+        const dimension_size_type seriesBands = planes * ((settings.sizeY + bandheight - 1U) / bandheight);
+        const dimension_size_type groups = settings.split ? 1U : settings.series;
+        const dimension_size_type files = settings.split ? settings.series : 1U;
+        for (dimension_size_type g = 0U; g < groups; ++g)
+          for (dimension_size_type i = 0U; i < seriesBands; ++i)
+            for (dimension_size_type f = 0U; f < files; ++f)
+              {
+                const dimension_size_type series = settings.split ? f : g;
+                const dimension_size_type plane = i / (seriesBands / planes);
+                const dimension_size_type y = (i % (seriesBands / planes)) * bandheight;
+                work.bands.push_back(Band{series, plane, y, std::min(bandheight, settings.sizeY - y)});
+                work.order.push_back(std::make_pair(f, (g * seriesBands) + i));
+              }
+        runThreads(settings, work, writer);
+
+        for (dimension_size_type f = 1U; f < work.files.size(); ++f)
+          work.files[f]->writer->close();
+      }
+
+    writer.close();
+
+    auto end = std::chrono::steady_clock::now();
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    uintmax_t bytes = 0U;
+    for (dimension_size_type s = 0U; s < settings.series; ++s)
+      if (s == 0U || settings.split)
+        bytes += boost::filesystem::file_size(seriesFile(settings, s));
+
+    std::cout << std::fixed
+              << "files:   " << (settings.split ? settings.series : 1U) << '\n'
+              << "series:  " << settings.series << '\n'
+              << "planes:  " << planes * settings.series << '\n'
+              << "bytes:   " << bytes << '\n'
+              << std::setprecision(3)
+              << "seconds: " << seconds << '\n'
+              << std::setprecision(1)
+              << "MB/s:    " << (static_cast<double>(bytes) / 1.0e6) / seconds << '\n';
+  }
+
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  try
+    {
+      Settings settings;
+      std::string pixeltype;
+      std::string content;
+      std::string split;
+      std::string file;
+
+      opt::options_description options("Options");
+      options.add_options()
+        ("help,h", "Show help options")
+        ("size-x", opt::value<dimension_size_type>(&settings.sizeX)->default_value(512U), "Image width")
+        ("size-y", opt::value<dimension_size_type>(&settings.sizeY)->default_value(512U), "Image height")
+        ("size-z", opt::value<dimension_size_type>(&settings.sizeZ)->default_value(1U), "Focal planes")
+        ("size-t", opt::value<dimension_size_type>(&settings.sizeT)->default_value(1U), "Time points")
+        ("channels", opt::value<dimension_size_type>(&settings.channels)->default_value(1U), "Channels")
+        ("samples", opt::value<dimension_size_type>(&settings.samples)->default_value(1U), "Samples per channel")
+        ("series", opt::value<dimension_size_type>(&settings.series)->default_value(1U), "Number of series (images)")
+        ("pixel-type", opt::value<std::string>(&pixeltype)->default_value("uint16"), "Pixel type")
+        ("tile-size", opt::value<dimension_size_type>(&settings.tilesize)->default_value(0U), "Tile width and height (0 for strips)")
+        ("compression", opt::value<std::string>(&settings.compression)->default_value("none"), "Compression type")
+        ("split", opt::value<std::string>(&split)->default_value("none"), "File splitting (none, or series for a file per series)")
+        ("content", opt::value<std::string>(&content)->default_value("noise"), "Pixel content (noise, gradient or empty)")
+        ("fill", opt::value<double>(&settings.fill)->default_value(1.0), "Fraction of cells with content, for sparse mosaics")
+        ("cell-size", opt::value<dimension_size_type>(&settings.cellsize)->default_value(512U), "Width and height of mosaic cells")
+        ("seed", opt::value<uint64_t>(&settings.seed)->default_value(0U), "Random seed")
+        ("threads", opt::value<dimension_size_type>(&settings.threads)->default_value(std::max(1U, std::thread::hardware_concurrency())), "Generator and encoding threads")
+        ("file", opt::value<std::string>(&file), "Output file");
+
+      opt::positional_options_description positional;
+      positional.add("file", 1);
+
+      opt::variables_map vm;
+      opt::store(opt::command_line_parser(argc, argv).options(options).positional(positional).run(), vm);
+      opt::notify(vm);
+
+      if (vm.count("help") || file.empty())
+        {
+          std::cout << "Usage: " << argv[0] << " [options] output.ome.tiff\n\n" << options << '\n';
+          return vm.count("help") ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+
+      if (!settings.sizeX || !settings.sizeY || !settings.sizeZ || !settings.sizeT ||
+          !settings.channels || !settings.samples || !settings.series)
+        throw std::logic_error("Image dimensions must be positive");
+      if (!settings.threads)
+        throw std::logic_error("Thread count must be positive");
+      if (!settings.cellsize)
+        throw std::logic_error("Cell size must be positive");
+      if (settings.fill < 0.0 || settings.fill > 1.0)
+        throw std::logic_error("Fill fraction must be between 0 and 1");
+
+      if (content == "noise")
+        settings.content = CONTENT_NOISE;
+      else if (content == "gradient")
+        settings.content = CONTENT_GRADIENT;
+      else if (content == "empty")
+        settings.content = CONTENT_EMPTY;
+      else
+        throw std::logic_error("Invalid content: " + content);
+
+      if (split == "none")
+        settings.split = false;
+      else if (split == "series")
+        settings.split = true;
+      else
+        throw std::logic_error("Invalid split: " + split);
+
+      settings.pixeltype = PixelType(pixeltype);
+      settings.file = file;
+
+      run(settings);
+    }
+  catch (const std::exception& e)
+    {
+      std::cerr << "Error: " << e.what() << std::endl;
+      return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -36,9 +36,15 @@
  * #L%
  */
 
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
 #include <stdexcept>
+#include <thread>
 #include <tuple>
 #include <type_traits>
 #include <vector>
@@ -46,13 +52,23 @@
 #include <boost/filesystem.hpp>
 #include <boost/optional.hpp>
 
+#include <ome/files/DecodedTileCache.h>
+#include <ome/files/FormatException.h>
+#include <ome/files/PixelAllocator.h>
 #include <ome/files/PixelProperties.h>
+#include <ome/files/PixelStatistics.h>
+#include <ome/files/TraceObserver.h>
 #include <ome/files/tiff/Codec.h>
 #include <ome/files/tiff/TileInfo.h>
 #include <ome/files/tiff/TIFF.h>
 #include <ome/files/tiff/IFD.h>
+#include <ome/files/tiff/IOSource.h>
+#include <ome/files/tiff/RangeSource.h>
+#include <ome/files/tiff/StrileReader.h>
+#include <ome/files/tiff/UringFileSource.h>
 #include <ome/files/tiff/Field.h>
 #include <ome/files/tiff/Exception.h>
+#include <ome/files/tiff/Util.h>
 
 #include <ome/compat/regex.h>
 
@@ -68,8 +84,13 @@ using ome::files::tiff::directory_index_type;
 using ome::files::tiff::TileInfo;
 using ome::files::tiff::TIFF;
 using ome::files::tiff::IFD;
+using ome::files::tiff::IOSource;
+using ome::files::tiff::MappedFileSource;
+using ome::files::tiff::RangeSource;
+using ome::files::tiff::UringFileSource;
 using ome::files::tiff::Codec;
 using ome::files::dimension_size_type;
+using ome::files::DecodedTileCache;
 using ome::files::significantBitsPerPixel;
 using ome::files::VariantPixelBuffer;
 using ome::files::PixelBuffer;
@@ -237,6 +258,359 @@ TEST_F(TIFFTest, ConstructFailFile)
   ASSERT_THROW(TIFF::open(PROJECT_SOURCE_DIR "/CMakeLists.txt", "r"), ome::files::tiff::Exception);
 }
 
+namespace
+{
+
+  // Source counting the reads made through it.
+  class CountingSource : public MappedFileSource
+  {
+  public:
+    std::atomic<std::size_t> reads;
+
+    explicit
+    CountingSource(const boost::filesystem::path& filename):
+      MappedFileSource(filename),
+      reads(0U)
+    {
+    }
+
+    std::size_t
+    read(uint64_t    offset,
+         void       *buffer,
+         std::size_t size)
+    {
+      ++reads;
+      return MappedFileSource::read(offset, buffer, size);
+    }
+
+    const char *
+    data() const
+    {
+      // Force all access through read().
+      return nullptr;
+    }
+  };
+
+  // Source recording the access advice given to it.
+  class AdvisedSource : public MappedFileSource
+  {
+  public:
+    std::vector<std::pair<ome::files::AccessHint, std::vector<range_type>>> advice;
+
+    explicit
+    AdvisedSource(const boost::filesystem::path& filename):
+      MappedFileSource(filename),
+      advice()
+    {
+    }
+
+    void
+    advise(ome::files::AccessHint         hint,
+           const std::vector<range_type>& ranges)
+    {
+      advice.push_back(std::make_pair(hint, ranges));
+      MappedFileSource::advise(hint, ranges);
+    }
+  };
+
+  // Source recording the statistics set on it.
+  class StatisticsSource : public MappedFileSource
+  {
+  public:
+    std::shared_ptr<ome::files::IOStatistics> statistics;
+
+    explicit
+    StatisticsSource(const boost::filesystem::path& filename):
+      MappedFileSource(filename),
+      statistics()
+    {
+    }
+
+    void
+    setStatistics(const std::shared_ptr<ome::files::IOStatistics>& statistics)
+    {
+      this->statistics = statistics;
+      MappedFileSource::setStatistics(statistics);
+    }
+  };
+
+}
+
+TEST_F(TIFFTest, ConstructSource)
+{
+  std::shared_ptr<CountingSource> source(std::make_shared<CountingSource>(tiff_path));
+  std::shared_ptr<TIFF> t;
+  ASSERT_NO_THROW(t = TIFF::open(source, "r"));
+  ASSERT_TRUE(static_cast<bool>(t));
+  EXPECT_LT(0U, source->reads.load());
+
+  std::shared_ptr<TIFF> tp(TIFF::open(tiff_path, "r"));
+  ASSERT_EQ(tp->directoryCount(), t->directoryCount());
+  for (directory_index_type i = 0; i < t->directoryCount(); ++i)
+    EXPECT_EQ(tp->getDirectoryByIndex(i)->getOffset(),
+              t->getDirectoryByIndex(i)->getOffset());
+}
+
+TEST_F(TIFFTest, AdviseAccess)
+{
+  std::shared_ptr<TIFF> ref(TIFF::open(tiff_path, "r"));
+  std::shared_ptr<IFD> refifd(ref->getDirectoryByIndex(0));
+  uint32_t w = refifd->getImageWidth();
+  uint32_t h = refifd->getImageHeight();
+
+  // Files opened directly are advised using the file descriptor.
+  ASSERT_NO_THROW(ref->adviseAccess(ome::files::HINT_SEQUENTIAL, std::vector<IOSource::range_type>()));
+  ASSERT_NO_THROW(refifd->adviseAccess(ome::files::HINT_WILLNEED, 0, 0, w, h));
+  ASSERT_NO_THROW(refifd->adviseAccess(ome::files::HINT_RANDOM, 0, 0, w / 2, h / 2));
+  VariantPixelBuffer expected;
+  ASSERT_NO_THROW(refifd->readImage(expected));
+
+  // Sources are given the byte ranges of the region.
+  std::shared_ptr<AdvisedSource> source(std::make_shared<AdvisedSource>(tiff_path));
+  std::shared_ptr<TIFF> t(TIFF::open(source, "r"));
+  std::shared_ptr<IFD> ifd(t->getDirectoryByIndex(0));
+  ASSERT_NO_THROW(ifd->adviseAccess(ome::files::HINT_WILLNEED, 0, 0, w, h));
+  ASSERT_EQ(1U, source->advice.size());
+  EXPECT_EQ(ome::files::HINT_WILLNEED, source->advice[0].first);
+  EXPECT_FALSE(source->advice[0].second.empty());
+  for (const auto& range : source->advice[0].second)
+    EXPECT_GE(source->size(), range.first + range.second);
+
+  VariantPixelBuffer vb;
+  ASSERT_NO_THROW(ifd->readImage(vb));
+  EXPECT_TRUE(expected == vb);
+}
+
+TEST_F(TIFFTest, ConstructSourceFailMode)
+{
+  std::shared_ptr<IOSource> source(std::make_shared<MappedFileSource>(tiff_path));
+  ASSERT_THROW(TIFF::open(source, "w"), ome::files::tiff::Exception);
+  ASSERT_THROW(TIFF::open(std::shared_ptr<IOSource>(), "r"), ome::files::tiff::Exception);
+}
+
+TEST_F(TIFFTest, ConstructSourceFactory)
+{
+  std::size_t calls = 0U;
+  ome::files::tiff::IOSourceFactory factory =
+    [&calls](const boost::filesystem::path& filename) -> std::shared_ptr<IOSource>
+    {
+      ++calls;
+      return std::make_shared<CountingSource>(filename);
+    };
+
+  ASSERT_NO_THROW(TIFF::open(tiff_path, "r", factory));
+  EXPECT_EQ(1U, calls);
+}
+
+TEST_F(TIFFTest, SourcePageFaults)
+{
+  using ome::files::IOStatistics;
+
+  std::shared_ptr<IOStatistics> stats(std::make_shared<IOStatistics>());
+  std::shared_ptr<MappedFileSource> source(std::make_shared<MappedFileSource>(tiff_path));
+  source->setStatistics(stats);
+
+  // The first copy out of a new mapping faults in its pages.  The
+  // buffer is already zero-filled, so its own faults are not
+  // counted.
+  std::vector<char> buf(static_cast<std::size_t>(source->size()));
+  ASSERT_EQ(buf.size(), source->read(0U, buf.data(), buf.size()));
+#ifdef __linux__
+  EXPECT_LT(0U, stats->get(IOStatistics::MINOR_PAGE_FAULTS) +
+            stats->get(IOStatistics::MAJOR_PAGE_FAULTS));
+#endif
+
+  // Nothing is counted without statistics.
+  source->setStatistics(std::shared_ptr<IOStatistics>());
+  std::shared_ptr<MappedFileSource> unmeasured(std::make_shared<MappedFileSource>(tiff_path));
+  stats->reset();
+  ASSERT_EQ(buf.size(), unmeasured->read(0U, buf.data(), buf.size()));
+  ASSERT_EQ(buf.size(), source->read(0U, buf.data(), buf.size()));
+  EXPECT_EQ(0U, stats->get(IOStatistics::MINOR_PAGE_FAULTS));
+  EXPECT_EQ(0U, stats->get(IOStatistics::MAJOR_PAGE_FAULTS));
+
+  // A TIFF sets its statistics on its source.
+  std::shared_ptr<StatisticsSource> recorded(std::make_shared<StatisticsSource>(tiff_path));
+  std::shared_ptr<TIFF> t(TIFF::open(recorded, "r"));
+  EXPECT_EQ(t->getStatistics(), recorded->statistics);
+  t->setStatistics(stats);
+  EXPECT_EQ(stats, recorded->statistics);
+}
+
+TEST_F(TIFFTest, ConcurrentSeparateFiles)
+{
+  // Separate TIFF instances are locked separately, and errors are
+  // captured per thread; check that concurrent use of separate
+  // handles and concurrent failures work correctly.
+  std::vector<std::thread> threads;
+  std::vector<int> status(8, 0);
+
+  for (std::vector<int>::size_type i = 0; i < status.size(); ++i)
+    {
+      threads.push_back(std::thread([this, i, &status]()
+        {
+          try
+            {
+              if (i % 2)
+                {
+                  std::shared_ptr<TIFF> t(TIFF::open(tiff_path, "r"));
+                  for (directory_index_type d = 0; d < 10; ++d)
+                    {
+                      std::shared_ptr<IFD> ifd(t->getDirectoryByIndex(d));
+                      std::string text;
+                      ifd->getField(ome::files::tiff::IMAGEDESCRIPTION).get(text);
+                    }
+                  status[i] = 1;
+                }
+              else
+                {
+                  TIFF::open(PROJECT_SOURCE_DIR "/CMakeLists.txt", "r");
+                }
+            }
+          catch (const ome::files::tiff::Exception& e)
+            {
+              if (!(i % 2) && std::string(e.what()).find("CMakeLists.txt") != std::string::npos)
+                status[i] = 1;
+            }
+          catch (...)
+            {
+            }
+        }));
+    }
+
+  for (auto& thread : threads)
+    thread.join();
+
+  for (const auto& s : status)
+    EXPECT_EQ(1, s);
+}
+
+TEST_F(TIFFTest, ConstructRangeSource)
+{
+  std::ifstream in(tiff_path.string().c_str(), std::ios::binary);
+  std::vector<char> content((std::istreambuf_iterator<char>(in)),
+                            std::istreambuf_iterator<char>());
+  ASSERT_FALSE(content.empty());
+
+  // Simulated remote store.
+  std::atomic<std::size_t> fetched(0U);
+  RangeSource::fetch_type fetch =
+    [&content, &fetched](uint64_t offset, void *buffer, std::size_t size) -> std::size_t
+    {
+      fetched += size;
+      std::size_t count = std::min(size, static_cast<std::size_t>(content.size() - offset));
+      std::memcpy(buffer, content.data() + offset, count);
+      return count;
+    };
+
+  const std::size_t blocksize = 4096U;
+  const std::size_t cachesize = 16U * blocksize;
+  std::shared_ptr<RangeSource> source(std::make_shared<RangeSource>(tiff_path.string(), content.size(),
+                                                                    fetch, blocksize, cachesize));
+
+  std::shared_ptr<TIFF> t;
+  ASSERT_NO_THROW(t = TIFF::open(source, "r"));
+  ASSERT_TRUE(static_cast<bool>(t));
+  EXPECT_EQ(source, t->getSource());
+
+  std::shared_ptr<TIFF> ref(TIFF::open(tiff_path, "r"));
+  for (directory_index_type i = 0; i < ref->directoryCount(); ++i)
+    {
+      VariantPixelBuffer expected, vb;
+      ASSERT_NO_THROW(ref->getDirectoryByIndex(i)->readImage(expected));
+      ASSERT_NO_THROW(t->getDirectoryByIndex(i)->readImage(vb));
+      EXPECT_TRUE(expected == vb);
+      EXPECT_GE(cachesize, source->getCacheSize());
+    }
+
+  EXPECT_LT(0U, source->getFetchCount());
+  EXPECT_LT(0U, fetched.load());
+}
+
+TEST_F(TIFFTest, ConstructUringSource)
+{
+  std::shared_ptr<UringFileSource> source(std::make_shared<UringFileSource>(tiff_path));
+  std::shared_ptr<TIFF> t;
+  ASSERT_NO_THROW(t = TIFF::open(source, "r"));
+  ASSERT_TRUE(static_cast<bool>(t));
+  EXPECT_EQ(boost::filesystem::file_size(tiff_path), source->size());
+
+  std::shared_ptr<TIFF> ref(TIFF::open(tiff_path, "r"));
+  for (directory_index_type i = 0; i < ref->directoryCount(); ++i)
+    {
+      VariantPixelBuffer expected, vb;
+      ASSERT_NO_THROW(ref->getDirectoryByIndex(i)->readImage(expected));
+      ASSERT_NO_THROW(t->getDirectoryByIndex(i)->readImage(vb));
+      EXPECT_TRUE(expected == vb);
+    }
+
+  // Prefetched ranges are submitted together, and served on read,
+  // including reads of part of a range.
+  std::ifstream in(tiff_path.string().c_str(), std::ios::binary);
+  std::vector<char> content((std::istreambuf_iterator<char>(in)),
+                            std::istreambuf_iterator<char>());
+  ASSERT_LE(4096U, content.size());
+
+  std::vector<UringFileSource::range_type> ranges;
+  for (uint64_t offset = 0U; offset < 4096U; offset += 512U)
+    ranges.push_back(UringFileSource::range_type(offset, 512U));
+  uint64_t submissions = source->getSubmissionCount();
+  source->prefetch(ranges);
+  if (source->isBatched())
+    EXPECT_EQ(submissions + 1U, source->getSubmissionCount());
+
+  std::vector<char> buf(512U);
+  for (uint64_t offset = 0U; offset < 4096U; offset += 256U)
+    {
+      ASSERT_EQ(256U, source->read(offset, buf.data(), 256U));
+      EXPECT_TRUE(std::equal(buf.begin(), buf.begin() + 256, content.begin() + offset));
+    }
+
+  std::future<std::size_t> pending(source->readAsync(1000U, buf.data(), buf.size()));
+  ASSERT_EQ(buf.size(), pending.get());
+  EXPECT_TRUE(std::equal(buf.begin(), buf.end(), content.begin() + 1000));
+}
+
+TEST_F(TIFFTest, RangeSourceCoalescing)
+{
+  std::vector<char> content(64U * 1024U);
+  for (std::size_t i = 0; i < content.size(); ++i)
+    content[i] = static_cast<char>(i % 251);
+
+  std::atomic<std::size_t> requests(0U);
+  RangeSource::fetch_type fetch =
+    [&content, &requests](uint64_t offset, void *buffer, std::size_t size) -> std::size_t
+    {
+      ++requests;
+      std::memcpy(buffer, content.data() + offset, size);
+      return size;
+    };
+
+  RangeSource source("test", content.size(), fetch, 1024U, content.size());
+
+  // Neighbouring ranges are merged into a single request.
+  std::vector<RangeSource::range_type> ranges;
+  for (uint64_t offset = 0U; offset < 16U * 1024U; offset += 512U)
+    ranges.push_back(RangeSource::range_type(offset, 512U));
+  source.prefetch(ranges);
+  EXPECT_EQ(1U, requests.load());
+
+  // Prefetched data is read from the cache.
+  std::vector<char> buf(8000U);
+  ASSERT_EQ(buf.size(), source.read(100U, buf.data(), buf.size()));
+  EXPECT_TRUE(std::equal(buf.begin(), buf.end(), content.begin() + 100));
+  EXPECT_EQ(1U, requests.load());
+
+  // Uncached data is fetched on read.
+  ASSERT_EQ(buf.size(), source.read(40000U, buf.data(), buf.size()));
+  EXPECT_TRUE(std::equal(buf.begin(), buf.end(), content.begin() + 40000));
+  EXPECT_LT(1U, requests.load());
+
+  // Reads are truncated at the end of the source.
+  EXPECT_EQ(100U, source.read(content.size() - 100U, buf.data(), buf.size()));
+  EXPECT_EQ(0U, source.read(content.size(), buf.data(), buf.size()));
+}
+
 TEST_F(TIFFTest, IFDsByIndex)
 {
   std::shared_ptr<TIFF> t;
@@ -252,6 +626,68 @@ TEST_F(TIFFTest, IFDsByIndex)
   ASSERT_THROW(t->getDirectoryByIndex(40), ome::files::tiff::Exception);
 }
 
+TEST_F(TIFFTest, IFDsDiscoveredOnDemand)
+{
+  std::shared_ptr<TIFF> t;
+  ASSERT_NO_THROW(t = TIFF::open(tiff_path, "r"));
+  ASSERT_TRUE(static_cast<bool>(t));
+
+  // Access a later directory before the count is known.
+  std::shared_ptr<IFD> ifd5;
+  ASSERT_NO_THROW(ifd5 = t->getDirectoryByIndex(5));
+  std::shared_ptr<IFD> ifd2;
+  ASSERT_NO_THROW(ifd2 = t->getDirectoryByIndex(2));
+
+  directory_index_type count = t->directoryCount();
+  ASSERT_LT(5U, count);
+
+  // Offsets must match those found by walking the directories.
+  std::shared_ptr<IFD> ifd(t->getDirectoryByIndex(0));
+  for (directory_index_type i = 0; i < count; ++i)
+    {
+      ASSERT_TRUE(static_cast<bool>(ifd));
+      EXPECT_EQ(ifd->getOffset(), t->getDirectoryByIndex(i)->getOffset());
+      ifd = ifd->next();
+    }
+  EXPECT_FALSE(static_cast<bool>(ifd));
+  EXPECT_EQ(ifd5->getOffset(), t->getDirectoryByIndex(5)->getOffset());
+  EXPECT_EQ(ifd2->getOffset(), t->getDirectoryByIndex(2)->getOffset());
+
+  ASSERT_THROW(t->getDirectoryByIndex(count), ome::files::tiff::Exception);
+}
+
+TEST_F(TIFFTest, ScanDirectories)
+{
+  std::shared_ptr<TIFF> t;
+  ASSERT_NO_THROW(t = TIFF::open(tiff_path, "r"));
+  ASSERT_TRUE(static_cast<bool>(t));
+
+  // Summaries must match the IFDs read by libtiff, whether parsed
+  // serially or in parallel.
+  for (dimension_size_type threads : {1U, 4U})
+    {
+      std::vector<ome::files::tiff::DirectorySummary> summaries;
+      ASSERT_NO_THROW(summaries = t->scanDirectories(threads));
+      ASSERT_EQ(t->directoryCount(), summaries.size());
+
+      for (directory_index_type i = 0; i < summaries.size(); ++i)
+        {
+          const ome::files::tiff::DirectorySummary& summary(summaries[i]);
+          std::shared_ptr<IFD> ifd(t->getDirectoryByIndex(i));
+          ASSERT_TRUE(summary.valid);
+          EXPECT_EQ(ifd->getOffset(), summary.offset);
+          EXPECT_EQ(ifd->getImageWidth(), summary.width);
+          EXPECT_EQ(ifd->getImageHeight(), summary.height);
+          EXPECT_EQ(ifd->getBitsPerSample(), summary.bitsPerSample);
+          EXPECT_EQ(ifd->getSamplesPerPixel(), summary.samplesPerPixel);
+          EXPECT_EQ(static_cast<uint16_t>(ifd->getPlanarConfiguration()), summary.planarConfiguration);
+          EXPECT_EQ(static_cast<uint16_t>(ifd->getPhotometricInterpretation()), summary.photometricInterpretation);
+          if (i > 0)
+            EXPECT_TRUE(summaries[i - 1].sameFormat(summary));
+        }
+    }
+}
+
 TEST_F(TIFFTest, IFDsByOffset)
 {
   std::shared_ptr<TIFF> t;
@@ -269,6 +705,89 @@ TEST_F(TIFFTest, IFDsByOffset)
   ASSERT_THROW(t->getDirectoryByOffset(0), ome::files::tiff::Exception);
 }
 
+TEST_F(TIFFTest, IFDsShared)
+{
+  std::shared_ptr<TIFF> t;
+  ASSERT_NO_THROW(t = TIFF::open(tiff_path, "r"));
+  ASSERT_TRUE(static_cast<bool>(t));
+
+  std::shared_ptr<IFD> ifd0(t->getDirectoryByIndex(0));
+  std::shared_ptr<IFD> ifd1(t->getDirectoryByIndex(1));
+  EXPECT_NE(ifd0.get(), ifd1.get());
+  EXPECT_EQ(ifd0.get(), t->getDirectoryByIndex(0).get());
+  EXPECT_EQ(ifd0.get(), t->getDirectoryByOffset(ifd0->getOffset()).get());
+
+  // The IFD keeps the TIFF open.
+  uint32_t width = ifd0->getImageWidth();
+  t.reset();
+  EXPECT_EQ(width, ifd0->getImageWidth());
+  EXPECT_EQ(ifd1.get(), ifd0->getTIFF()->getDirectoryByIndex(1).get());
+}
+
+TEST_F(TIFFTest, IFDsAlternatingRead)
+{
+  std::shared_ptr<TIFF> t;
+  ASSERT_NO_THROW(t = TIFF::open(tiff_path, "r"));
+  ASSERT_TRUE(static_cast<bool>(t));
+
+  // Read each plane from a separate TIFF as a reference.
+  std::vector<std::shared_ptr<IFD>> ifds;
+  std::vector<VariantPixelBuffer> expected(10);
+  for (directory_index_type i = 0; i < expected.size(); ++i)
+    {
+      std::shared_ptr<TIFF> ref(TIFF::open(tiff_path, "r"));
+      ASSERT_NO_THROW(ref->getDirectoryByIndex(i)->readImage(expected[i]));
+      ifds.push_back(t->getDirectoryByIndex(i));
+    }
+
+  // Alternate between planes, going back and forth.
+  for (int pass = 0; pass < 3; ++pass)
+    for (directory_index_type i = 0; i < ifds.size(); ++i)
+      {
+        directory_index_type idx = pass % 2 ? static_cast<directory_index_type>(ifds.size() - i - 1) : i;
+        VariantPixelBuffer vb;
+        ASSERT_NO_THROW(ifds[idx]->readImage(vb));
+        EXPECT_TRUE(expected[idx] == vb);
+      }
+}
+
+TEST_F(TIFFTest, IFDsTileCache)
+{
+  std::shared_ptr<DecodedTileCache> cache(std::make_shared<DecodedTileCache>());
+
+  // Two TIFFs for the same file sharing one cache.
+  std::shared_ptr<TIFF> t1(TIFF::open(tiff_path, "r"));
+  std::shared_ptr<TIFF> t2(TIFF::open(tiff_path, "r"));
+  std::shared_ptr<TIFF> ref(TIFF::open(tiff_path, "r"));
+  t1->setTileCache(cache);
+  t2->setTileCache(cache);
+  EXPECT_EQ(cache, t1->getTileCache());
+
+  for (directory_index_type i = 0; i < 4; ++i)
+    {
+      VariantPixelBuffer expected, vb1, vb2, sub;
+      ASSERT_NO_THROW(ref->getDirectoryByIndex(i)->readImage(expected));
+
+      ASSERT_NO_THROW(t1->getDirectoryByIndex(i)->readImage(vb1));
+      EXPECT_TRUE(expected == vb1);
+      dimension_size_type cached = cache->size();
+      EXPECT_LT(0U, cached);
+
+      // Served from the cache.
+      ASSERT_NO_THROW(t2->getDirectoryByIndex(i)->readImage(vb2));
+      EXPECT_TRUE(expected == vb2);
+      EXPECT_EQ(cached, cache->size());
+
+      // Subregions are also served from the cache.
+      std::shared_ptr<IFD> ifd(t2->getDirectoryByIndex(i));
+      VariantPixelBuffer expectedsub;
+      ASSERT_NO_THROW(ref->getDirectoryByIndex(i)->readImage(expectedsub, 2, 3, ifd->getImageWidth() - 4, ifd->getImageHeight() - 5));
+      ASSERT_NO_THROW(ifd->readImage(sub, 2, 3, ifd->getImageWidth() - 4, ifd->getImageHeight() - 5));
+      EXPECT_TRUE(expectedsub == sub);
+      EXPECT_EQ(cached, cache->size());
+    }
+}
+
 TEST_F(TIFFTest, IFDSimpleIter)
 {
   std::shared_ptr<TIFF> t;
@@ -344,6 +863,81 @@ TEST_F(TIFFTest, RawField0)
   ASSERT_THROW(ifd->getRawField(0, &text), ome::files::tiff::Exception);
 }
 
+TEST_F(TIFFTest, RawFieldSet)
+{
+  std::shared_ptr<TIFF> t;
+  ASSERT_NO_THROW(t = TIFF::open(tiff_path, "r"));
+  ASSERT_TRUE(static_cast<bool>(t));
+
+  std::shared_ptr<IFD> ifd;
+  ASSERT_NO_THROW(ifd = t->getDirectoryByIndex(0));
+  ASSERT_TRUE(static_cast<bool>(ifd));
+
+  EXPECT_TRUE(ifd->hasRawField(270));
+  EXPECT_FALSE(ifd->hasRawField(315));
+  EXPECT_FALSE(ifd->hasRawField(0));
+}
+
+TEST_F(TIFFTest, FieldProbe)
+{
+  std::shared_ptr<TIFF> t;
+  ASSERT_NO_THROW(t = TIFF::open(tiff_path, "r"));
+  ASSERT_TRUE(static_cast<bool>(t));
+
+  std::shared_ptr<IFD> ifd;
+  ASSERT_NO_THROW(ifd = t->getDirectoryByIndex(0));
+  ASSERT_TRUE(static_cast<bool>(ifd));
+
+  EXPECT_TRUE(ifd->hasField(ome::files::tiff::IMAGEDESCRIPTION));
+  EXPECT_TRUE(ifd->hasField(ome::files::tiff::BITSPERSAMPLE));
+  EXPECT_FALSE(ifd->hasField(ome::files::tiff::ARTIST));
+  EXPECT_FALSE(ifd->hasField(ome::files::tiff::INDEXED));
+  EXPECT_FALSE(ifd->hasField(ome::files::tiff::COLORMAP));
+
+  std::string text("unchanged");
+  EXPECT_FALSE(ifd->getField(ome::files::tiff::ARTIST).tryGet(text));
+  EXPECT_EQ(std::string("unchanged"), text);
+  EXPECT_TRUE(ifd->getField(ome::files::tiff::IMAGEDESCRIPTION).tryGet(text));
+  std::string expected;
+  ASSERT_NO_THROW(ifd->getField(ome::files::tiff::IMAGEDESCRIPTION).get(expected));
+  EXPECT_EQ(expected, text);
+
+  uint16_t value = 0U;
+  EXPECT_TRUE(ifd->getField(ome::files::tiff::BITSPERSAMPLE).tryGet(value));
+  EXPECT_EQ(8U, value);
+  EXPECT_FALSE(ifd->getField(ome::files::tiff::INDEXED).tryGet(value));
+}
+
+TEST_F(TIFFTest, FieldVisitText)
+{
+  std::shared_ptr<TIFF> t;
+  ASSERT_NO_THROW(t = TIFF::open(tiff_path, "r"));
+  ASSERT_TRUE(static_cast<bool>(t));
+
+  std::shared_ptr<IFD> ifd;
+  ASSERT_NO_THROW(ifd = t->getDirectoryByIndex(0));
+  ASSERT_TRUE(static_cast<bool>(ifd));
+
+  std::string expected;
+  ASSERT_NO_THROW(ifd->getField(ome::files::tiff::IMAGEDESCRIPTION).get(expected));
+
+  std::string text;
+  EXPECT_TRUE(ifd->visitField(ome::files::tiff::IMAGEDESCRIPTION,
+                              [&text](const char *data, std::size_t size)
+                              {
+                                text.assign(data, size);
+                              }));
+  EXPECT_EQ(expected, text);
+
+  bool visited = false;
+  EXPECT_FALSE(ifd->visitField(ome::files::tiff::ARTIST,
+                               [&visited](const char *, std::size_t)
+                               {
+                                 visited = true;
+                               }));
+  EXPECT_FALSE(visited);
+}
+
 TEST_F(TIFFTest, FieldWrapString)
 {
   std::shared_ptr<TIFF> t;
@@ -737,99 +1331,1959 @@ TEST_F(TIFFTest, FieldWrapByteArray)
 
   std::vector<uint8_t> value;
 
-  ASSERT_THROW(ifd->getField(ome::files::tiff::ICCPROFILE).get(value), ome::files::tiff::Exception);
-  ASSERT_THROW(ifd->getField(ome::files::tiff::JPEGTABLES).get(value), ome::files::tiff::Exception);
-  ASSERT_THROW(ifd->getField(ome::files::tiff::PHOTOSHOP).get(value), ome::files::tiff::Exception);
-  ASSERT_THROW(ifd->getField(ome::files::tiff::XMLPACKET).get(value), ome::files::tiff::Exception);
-  ASSERT_THROW(ifd->getField(ome::files::tiff::IMAGEJ_META_DATA).get(value), ome::files::tiff::Exception);
+  ASSERT_THROW(ifd->getField(ome::files::tiff::ICCPROFILE).get(value), ome::files::tiff::Exception);
+  ASSERT_THROW(ifd->getField(ome::files::tiff::JPEGTABLES).get(value), ome::files::tiff::Exception);
+  ASSERT_THROW(ifd->getField(ome::files::tiff::PHOTOSHOP).get(value), ome::files::tiff::Exception);
+  ASSERT_THROW(ifd->getField(ome::files::tiff::XMLPACKET).get(value), ome::files::tiff::Exception);
+  ASSERT_THROW(ifd->getField(ome::files::tiff::IMAGEJ_META_DATA).get(value), ome::files::tiff::Exception);
+}
+
+TEST_F(TIFFTest, ValueProxy)
+{
+  std::shared_ptr<TIFF> t;
+  ASSERT_NO_THROW(t = TIFF::open(tiff_path, "r"));
+  ASSERT_TRUE(static_cast<bool>(t));
+
+  std::shared_ptr<IFD> ifd;
+  ASSERT_NO_THROW(ifd = t->getDirectoryByIndex(0));
+  ASSERT_TRUE(static_cast<bool>(ifd));
+
+  std::string text;
+  ome::files::tiff::ValueProxy<std::string> d(text);
+  d = ifd->getField(ome::files::tiff::IMAGEDESCRIPTION);
+}
+
+TEST_F(TIFFTest, Value)
+{
+  std::shared_ptr<TIFF> t;
+  ASSERT_NO_THROW(t = TIFF::open(tiff_path, "r"));
+  ASSERT_TRUE(static_cast<bool>(t));
+
+  std::shared_ptr<IFD> ifd;
+  ASSERT_NO_THROW(ifd = t->getDirectoryByIndex(0));
+  ASSERT_TRUE(static_cast<bool>(ifd));
+
+  ome::files::tiff::Value<std::string> text;
+  text = ifd->getField(ome::files::tiff::IMAGEDESCRIPTION);
+}
+
+TEST_F(TIFFTest, FieldName)
+{
+  std::shared_ptr<TIFF> t;
+  ASSERT_NO_THROW(t = TIFF::open(tiff_path, "r"));
+  ASSERT_TRUE(static_cast<bool>(t));
+
+  std::shared_ptr<IFD> ifd;
+  ASSERT_NO_THROW(ifd = t->getDirectoryByIndex(0));
+  ASSERT_TRUE(static_cast<bool>(ifd));
+
+  std::string name;
+  name = ifd->getField(ome::files::tiff::IMAGEDESCRIPTION).name();
+
+  ASSERT_EQ(std::string("ImageDescription"), name);
+}
+
+TEST_F(TIFFTest, FieldCount)
+{
+  std::shared_ptr<TIFF> t;
+  ASSERT_NO_THROW(t = TIFF::open(tiff_path, "r"));
+  ASSERT_TRUE(static_cast<bool>(t));
+
+  std::shared_ptr<IFD> ifd;
+  ASSERT_NO_THROW(ifd = t->getDirectoryByIndex(0));
+  ASSERT_TRUE(static_cast<bool>(ifd));
+
+  std::string name;
+  bool count = ifd->getField(ome::files::tiff::IMAGEDESCRIPTION).passCount();
+
+  ASSERT_FALSE(count);
+}
+
+TEST_F(TIFFTest, PixelType)
+{
+  std::shared_ptr<TIFF> t;
+  ASSERT_NO_THROW(t = TIFF::open(tiff_path, "r"));
+  ASSERT_TRUE(static_cast<bool>(t));
+
+  std::shared_ptr<IFD> ifd;
+  ASSERT_NO_THROW(ifd = t->getDirectoryByIndex(0));
+  ASSERT_TRUE(static_cast<bool>(ifd));
+
+  ASSERT_EQ(PT::UINT8, ifd->getPixelType());
+  ASSERT_EQ(8U, ifd->getBitsPerSample());
+}
+
+TEST(TIFFCodec, ListCodecs)
+{
+  // Note this list depends upon the codecs provided by libtiff, which
+  // can vary, so we don't attempt to validate specific codecs are
+  // present here.
+
+  std::vector<Codec> codecs = ome::files::tiff::getCodecs();
+  for (const auto& c: codecs)
+    {
+      std::cout << c.name << " = " << c.scheme << '\n';
+    }
+}
+
+TEST(TIFFCodec, ConcurrentLookup)
+{
+  // All threads see the same tables, whichever initialises them.
+  std::vector<std::thread> threads;
+  std::vector<const std::vector<std::string> *> names(8U);
+  std::vector<const std::vector<std::string> *> uint8names(8U);
+  std::vector<ome::files::tiff::Compression> schemes(8U);
+  for (std::size_t t = 0U; t < 8U; ++t)
+    threads.emplace_back([&, t]()
+      {
+        uint8names[t] = &ome::files::tiff::getCodecNames(PT::UINT8);
+        names[t] = &ome::files::tiff::getCodecNames();
+        schemes[t] = ome::files::tiff::getCodecScheme("Deflate");
+      });
+  for (auto& thread : threads)
+    thread.join();
+
+  for (std::size_t t = 0U; t < 8U; ++t)
+    {
+      EXPECT_EQ(&ome::files::tiff::getCodecNames(), names[t]);
+      EXPECT_EQ(&ome::files::tiff::getCodecNames(PT::UINT8), uint8names[t]);
+      EXPECT_EQ(ome::files::tiff::getCodecScheme("Deflate"), schemes[t]);
+    }
+  EXPECT_EQ(ome::files::tiff::getCodecs().size(), ome::files::tiff::getCodecNames().size());
+
+  // Bilevel codecs are only offered for BIT.
+  for (const auto& name : ome::files::tiff::getCodecNames(PT::UINT16))
+    EXPECT_NE(ome::files::tiff::COMPRESSION_PACKBITS, ome::files::tiff::getCodecScheme(name));
+}
+
+TEST(TIFFCodec, CompressionLevel)
+{
+  int min, max;
+  EXPECT_FALSE(ome::files::tiff::getCodecLevelRange(ome::files::tiff::COMPRESSION_NONE, min, max));
+  EXPECT_FALSE(ome::files::tiff::getCodecLevelRange(ome::files::tiff::COMPRESSION_LZW, min, max));
+  ASSERT_TRUE(ome::files::tiff::getCodecLevelRange(ome::files::tiff::COMPRESSION_DEFLATE, min, max));
+  EXPECT_EQ(1, min);
+  EXPECT_EQ(9, max);
+}
+
+TEST(TIFFCodec, Predictor)
+{
+  EXPECT_FALSE(ome::files::tiff::codecSupportsPredictor(ome::files::tiff::COMPRESSION_NONE));
+  EXPECT_TRUE(ome::files::tiff::codecSupportsPredictor(ome::files::tiff::COMPRESSION_LZW));
+  EXPECT_TRUE(ome::files::tiff::codecSupportsPredictor(ome::files::tiff::COMPRESSION_DEFLATE));
+
+  EXPECT_EQ(ome::files::tiff::HORIZONTAL, ome::files::tiff::getPixelTypePredictor(PT::UINT16));
+  EXPECT_EQ(ome::files::tiff::FLOATING_POINT, ome::files::tiff::getPixelTypePredictor(PT::FLOAT));
+  EXPECT_EQ(ome::files::tiff::NONE, ome::files::tiff::getPixelTypePredictor(PT::BIT));
+}
+
+TEST(TIFFUtil, ChooseTileGeometry)
+{
+  using ome::files::tiff::chooseTileGeometry;
+  using ome::files::tiff::TileGeometry;
+
+  // Sequential reading of a large image favours large strips.
+  TileGeometry seq = chooseTileGeometry(ome::files::ACCESS_SEQUENTIAL, 4096U, 4096U, PT::UINT8, 1U,
+                                        ome::files::tiff::CONTIG, ome::files::tiff::COMPRESSION_NONE);
+  EXPECT_EQ(ome::files::tiff::STRIP, seq.type);
+  EXPECT_EQ(4096U, seq.width);
+  EXPECT_EQ(256U, seq.height);
+
+  // Viewport access to a large image favours tiles.
+  TileGeometry view = chooseTileGeometry(ome::files::ACCESS_RANDOM_VIEWPORT, 8192U, 8192U, PT::UINT16, 1U,
+                                         ome::files::tiff::CONTIG, ome::files::tiff::COMPRESSION_NONE);
+  EXPECT_EQ(ome::files::tiff::TILE, view.type);
+  EXPECT_EQ(256U, view.width);
+  EXPECT_EQ(256U, view.height);
+
+  // Compression increases the cost of reading unused pixels.
+  TileGeometry cview = chooseTileGeometry(ome::files::ACCESS_RANDOM_VIEWPORT, 8192U, 8192U, PT::UINT16, 1U,
+                                          ome::files::tiff::CONTIG, ome::files::tiff::COMPRESSION_LZW);
+  EXPECT_EQ(ome::files::tiff::TILE, cview.type);
+  EXPECT_LT(cview.width, view.width);
+
+  // Small regions favour small tiles.
+  TileGeometry column = chooseTileGeometry(ome::files::ACCESS_Z_COLUMN, 8192U, 8192U, PT::UINT16, 1U,
+                                           ome::files::tiff::CONTIG, ome::files::tiff::COMPRESSION_NONE);
+  EXPECT_EQ(ome::files::tiff::TILE, column.type);
+  EXPECT_EQ(128U, column.width);
+  EXPECT_EQ(128U, column.height);
+
+  // An image smaller than the viewport is read whole.
+  TileGeometry small = chooseTileGeometry(ome::files::ACCESS_RANDOM_VIEWPORT, 512U, 512U, PT::UINT8, 1U,
+                                          ome::files::tiff::CONTIG, ome::files::tiff::COMPRESSION_NONE);
+  EXPECT_EQ(ome::files::tiff::STRIP, small.type);
+  EXPECT_EQ(512U, small.height);
+
+  EXPECT_THROW(chooseTileGeometry(ome::files::ACCESS_SEQUENTIAL, 0U, 512U, PT::UINT8, 1U,
+                                  ome::files::tiff::CONTIG, ome::files::tiff::COMPRESSION_NONE),
+               ome::files::FormatException);
+}
+
+namespace
+{
+
+  // Count uses of a wrapped tile codec.
+  class CountingTileCodec : public ome::files::tiff::TileCodec
+  {
+  public:
+    std::shared_ptr<ome::files::tiff::TileCodec> codec;
+    mutable std::atomic<unsigned int> encoded;
+    mutable std::atomic<unsigned int> decoded;
+
+    CountingTileCodec(const std::shared_ptr<ome::files::tiff::TileCodec>& codec):
+      codec(codec),
+      encoded(0U),
+      decoded(0U)
+    {}
+
+    void
+    encode(const ome::files::tiff::TileCodecParameters& params,
+           const void                                  *src,
+           std::size_t                                  size,
+           std::vector<char>&                           dest) const
+    {
+      ++encoded;
+      codec->encode(params, src, size, dest);
+    }
+
+    std::size_t
+    decode(const ome::files::tiff::TileCodecParameters& params,
+           const void                                  *src,
+           std::size_t                                  size,
+           void                                        *dest,
+           std::size_t                                  destsize) const
+    {
+      ++decoded;
+      return codec->decode(params, src, size, dest, destsize);
+    }
+  };
+
+}
+
+TEST_F(TIFFTest, TileCodec)
+{
+  const ome::files::tiff::Compression scheme = ome::files::tiff::COMPRESSION_DEFLATE;
+  std::shared_ptr<ome::files::tiff::TileCodec> zlib(ome::files::tiff::getTileCodec(scheme));
+  ASSERT_TRUE(static_cast<bool>(zlib));
+  EXPECT_FALSE(ome::files::tiff::getTileCodec(ome::files::tiff::COMPRESSION_NONE));
+
+  std::shared_ptr<CountingTileCodec> counting(std::make_shared<CountingTileCodec>(zlib));
+  ome::files::tiff::registerTileCodec(scheme, counting);
+  EXPECT_EQ(counting, ome::files::tiff::getTileCodec(scheme));
+
+  VariantPixelBuffer expected;
+  {
+    std::shared_ptr<TIFF> t(TIFF::open(tiff_path, "r"));
+    t->getDirectoryByIndex(0)->readImage(expected);
+  }
+
+  boost::filesystem::path file(PROJECT_BINARY_DIR "/test/ome-files/data/tiff-tilecodec.tiff");
+  {
+    std::shared_ptr<TIFF> t(TIFF::open(tiff_path, "r"));
+    std::shared_ptr<IFD> ifd(t->getDirectoryByIndex(0));
+
+    std::shared_ptr<TIFF> wtiff(TIFF::open(file, "w"));
+    std::shared_ptr<IFD> wifd(wtiff->getCurrentDirectory());
+    wifd->setImageWidth(ifd->getImageWidth());
+    wifd->setImageHeight(ifd->getImageHeight());
+    wifd->setTileType(ome::files::tiff::TILE);
+    wifd->setTileWidth(16U);
+    wifd->setTileHeight(16U);
+    wifd->setPixelType(ifd->getPixelType());
+    wifd->setBitsPerSample(ifd->getBitsPerSample());
+    wifd->setSamplesPerPixel(ifd->getSamplesPerPixel());
+    wifd->setPlanarConfiguration(ifd->getPlanarConfiguration());
+    wifd->setPhotometricInterpretation(ifd->getPhotometricInterpretation());
+    wifd->setCompression(scheme);
+    ASSERT_NO_THROW(wifd->writeImage(expected));
+    wtiff->writeCurrentDirectory();
+    wtiff->close();
+  }
+  EXPECT_EQ(4U, counting->encoded.load());
+
+  VariantPixelBuffer observed;
+  {
+    std::shared_ptr<TIFF> t(TIFF::open(file, "r"));
+    ASSERT_NO_THROW(t->getDirectoryByIndex(0)->readImage(observed));
+  }
+  EXPECT_EQ(4U, counting->decoded.load());
+  EXPECT_TRUE(expected == observed);
+
+  // Revert to libtiff, then restore the default.
+  ome::files::tiff::registerTileCodec(scheme, std::shared_ptr<ome::files::tiff::TileCodec>());
+  EXPECT_FALSE(ome::files::tiff::getTileCodec(scheme));
+  {
+    VariantPixelBuffer libtiff;
+    std::shared_ptr<TIFF> t(TIFF::open(file, "r"));
+    ASSERT_NO_THROW(t->getDirectoryByIndex(0)->readImage(libtiff));
+    EXPECT_TRUE(expected == libtiff);
+  }
+  EXPECT_EQ(4U, counting->decoded.load());
+  ome::files::tiff::registerTileCodec(scheme, zlib);
+}
+
+TEST_F(TIFFTest, StrileReader)
+{
+  const ome::files::tiff::Compression scheme = ome::files::tiff::COMPRESSION_DEFLATE;
+
+  VariantPixelBuffer expected;
+  {
+    std::shared_ptr<TIFF> t(TIFF::open(tiff_path, "r"));
+    t->getDirectoryByIndex(0)->readImage(expected);
+  }
+
+  boost::filesystem::path file(PROJECT_BINARY_DIR "/test/ome-files/data/tiff-strilereader.tiff");
+  {
+    std::shared_ptr<TIFF> t(TIFF::open(tiff_path, "r"));
+    std::shared_ptr<IFD> ifd(t->getDirectoryByIndex(0));
+
+    std::shared_ptr<TIFF> wtiff(TIFF::open(file, "w"));
+    std::shared_ptr<IFD> wifd(wtiff->getCurrentDirectory());
+    wifd->setImageWidth(ifd->getImageWidth());
+    wifd->setImageHeight(ifd->getImageHeight());
+    wifd->setTileType(ome::files::tiff::TILE);
+    wifd->setTileWidth(16U);
+    wifd->setTileHeight(16U);
+    wifd->setPixelType(ifd->getPixelType());
+    wifd->setBitsPerSample(ifd->getBitsPerSample());
+    wifd->setSamplesPerPixel(ifd->getSamplesPerPixel());
+    wifd->setPlanarConfiguration(ifd->getPlanarConfiguration());
+    wifd->setPhotometricInterpretation(ifd->getPhotometricInterpretation());
+    wifd->setCompression(scheme);
+    ASSERT_NO_THROW(wifd->writeImage(expected));
+    // Not available when writing.
+    EXPECT_FALSE(wifd->getStrileReader());
+    wtiff->writeCurrentDirectory();
+    wtiff->close();
+  }
+
+  // Not available without an I/O source.
+  {
+    std::shared_ptr<TIFF> t(TIFF::open(file, "rm"));
+    if (!t->getSource())
+      EXPECT_FALSE(t->getDirectoryByIndex(0)->getStrileReader());
+  }
+
+  std::shared_ptr<TIFF> t(TIFF::open(file, "r"));
+  if (!t->getSource())
+    return;
+  std::shared_ptr<IFD> ifd(t->getDirectoryByIndex(0));
+
+  std::shared_ptr<const ome::files::tiff::StrileReader> striles(ifd->getStrileReader());
+  ASSERT_TRUE(static_cast<bool>(striles));
+  EXPECT_EQ(striles, ifd->getStrileReader());
+  EXPECT_EQ(ome::files::tiff::TILE, striles->getTileType());
+  EXPECT_EQ(4U, striles->getStrileCount());
+  EXPECT_TRUE(striles->isPlainEncoding());
+
+  // Decode each tile from its raw data.
+  std::shared_ptr<ome::files::tiff::TileCodec> codec(ome::files::tiff::getTileCodec(scheme));
+  ASSERT_TRUE(static_cast<bool>(codec));
+  TileInfo info(ifd->getTileInfo());
+  for (dimension_size_type tile = 0; tile < striles->getStrileCount(); ++tile)
+    {
+      IOSource::range_type range(striles->getRange(tile));
+      EXPECT_LT(0U, range.first);
+      EXPECT_LT(0U, range.second);
+
+      std::vector<char> raw;
+      EXPECT_EQ(range.second, striles->read(tile, raw));
+      EXPECT_EQ(range.second, raw.size());
+
+      ome::files::tiff::TileCodecParameters params;
+      params.scheme = scheme;
+      params.pixeltype = ifd->getPixelType();
+      params.width = info.tileWidth();
+      params.height = info.tileHeight();
+      params.samples = ifd->getSamplesPerPixel();
+      params.level = -1;
+
+      std::vector<char> decoded(info.bufferSize());
+      EXPECT_EQ(decoded.size(), codec->decode(params, raw.data(), raw.size(),
+                                              decoded.data(), decoded.size()));
+    }
+
+  EXPECT_EQ(0U, striles->getRange(4U).second);
+  std::vector<char> raw;
+  EXPECT_THROW(striles->read(4U, raw), ome::files::tiff::Exception);
+
+  // Concurrent reads decode without libtiff.
+  std::vector<std::thread> threads;
+  std::atomic<unsigned int> mismatches(0U);
+  for (unsigned int i = 0; i < 4U; ++i)
+    threads.push_back(std::thread([&]()
+                                  {
+                                    for (unsigned int j = 0; j < 8U; ++j)
+                                      {
+                                        VariantPixelBuffer observed;
+                                        ifd->readImage(observed);
+                                        if (!(expected == observed))
+                                          ++mismatches;
+                                      }
+                                  }));
+  for (auto& thread : threads)
+    thread.join();
+  EXPECT_EQ(0U, mismatches.load());
+}
+
+TEST_F(TIFFTest, StrileRun)
+{
+  VariantPixelBuffer expected;
+  {
+    std::shared_ptr<TIFF> t(TIFF::open(tiff_path, "r"));
+    t->getDirectoryByIndex(0)->readImage(expected);
+  }
+
+  boost::filesystem::path file(PROJECT_BINARY_DIR "/test/ome-files/data/tiff-strilerun.tiff");
+  uint32_t height;
+  {
+    std::shared_ptr<TIFF> t(TIFF::open(tiff_path, "r"));
+    std::shared_ptr<IFD> ifd(t->getDirectoryByIndex(0));
+    height = ifd->getImageHeight();
+
+    // One row per strip.
+    std::shared_ptr<TIFF> wtiff(TIFF::open(file, "w"));
+    std::shared_ptr<IFD> wifd(wtiff->getCurrentDirectory());
+    wifd->setImageWidth(ifd->getImageWidth());
+    wifd->setImageHeight(height);
+    wifd->setTileType(ome::files::tiff::STRIP);
+    wifd->setTileHeight(1U);
+    wifd->setPixelType(ifd->getPixelType());
+    wifd->setBitsPerSample(ifd->getBitsPerSample());
+    wifd->setSamplesPerPixel(ifd->getSamplesPerPixel());
+    wifd->setPlanarConfiguration(ifd->getPlanarConfiguration());
+    wifd->setPhotometricInterpretation(ifd->getPhotometricInterpretation());
+    wifd->setCompression(ome::files::tiff::COMPRESSION_DEFLATE);
+    ASSERT_NO_THROW(wifd->writeImage(expected));
+    wtiff->writeCurrentDirectory();
+    wtiff->close();
+  }
+
+  std::shared_ptr<CountingSource> source(std::make_shared<CountingSource>(file));
+  std::shared_ptr<TIFF> t(TIFF::open(source, "r"));
+  t->setDecodeThreads(1U);
+  std::shared_ptr<IFD> ifd(t->getDirectoryByIndex(0));
+  ASSERT_TRUE(static_cast<bool>(ifd->getStrileReader()));
+  EXPECT_EQ(static_cast<dimension_size_type>(height), ifd->getStrileReader()->getStrileCount());
+
+  // Adjacent strips are read together rather than one at a time.
+  const std::size_t before = source->reads.load();
+  VariantPixelBuffer observed;
+  ASSERT_NO_THROW(ifd->readImage(observed));
+  EXPECT_TRUE(expected == observed);
+  EXPECT_GT(static_cast<std::size_t>(height) / 2U, source->reads.load() - before);
+
+  // Regions starting and ending part way through the image.
+  uint32_t width = ifd->getImageWidth();
+  VariantPixelBuffer region;
+  ASSERT_NO_THROW(ifd->readImage(region, 1U, height / 3U, width - 2U, height / 3U));
+  VariantPixelBuffer reference;
+  {
+    std::shared_ptr<TIFF> rt(TIFF::open(tiff_path, "r"));
+    rt->getDirectoryByIndex(0)->readImage(reference, 1U, height / 3U, width - 2U, height / 3U);
+  }
+  EXPECT_TRUE(reference == region);
+}
+
+namespace
+{
+
+  // Host memory treated as device memory.
+  class SimulatedDeviceAllocator : public ome::files::PixelAllocator
+  {
+  public:
+    void *
+    allocate(std::size_t size,
+             std::size_t /* alignment */)
+    {
+      return ::operator new(size);
+    }
+
+    void
+    deallocate(void        *ptr,
+               std::size_t  /* size */,
+               std::size_t  /* alignment */)
+    {
+      ::operator delete(ptr);
+    }
+
+    bool
+    hostAccessible() const
+    {
+      return false;
+    }
+  };
+
+  // Device tile codec decoding on the host with a tile codec.
+  class SimulatedDeviceTileCodec : public ome::files::tiff::DeviceTileCodec
+  {
+  public:
+    std::shared_ptr<ome::files::tiff::TileCodec> codec;
+    mutable std::atomic<unsigned int> batches;
+    mutable std::atomic<unsigned int> tiles;
+
+    SimulatedDeviceTileCodec(const std::shared_ptr<ome::files::tiff::TileCodec>& codec):
+      codec(codec),
+      batches(0U),
+      tiles(0U)
+    {}
+
+    void
+    decodeBatch(const std::vector<ome::files::tiff::DeviceTileRequest>& requests) const
+    {
+      ++batches;
+      for (const auto& request : requests)
+        {
+          ++tiles;
+          const std::size_t pixelbytes = request.params.samples *
+            ome::files::bytesPerPixel(request.params.pixeltype);
+          const std::size_t rowbytes = request.params.width * pixelbytes;
+          std::vector<char> decoded(rowbytes * request.params.height);
+          if (request.src)
+            codec->decode(request.params, request.src, request.size,
+                          decoded.data(), decoded.size());
+          for (dimension_size_type row = 0; row < request.h; ++row)
+            std::memcpy(static_cast<char *>(request.dest) + (row * request.destpitch),
+                        decoded.data() + ((request.y + row) * rowbytes) + (request.x * pixelbytes),
+                        request.w * pixelbytes);
+        }
+    }
+  };
+
+}
+
+TEST_F(TIFFTest, DeviceTileCodec)
+{
+  const ome::files::tiff::Compression scheme = ome::files::tiff::COMPRESSION_DEFLATE;
+
+  VariantPixelBuffer expected;
+  {
+    std::shared_ptr<TIFF> t(TIFF::open(tiff_path, "r"));
+    t->getDirectoryByIndex(0)->readImage(expected);
+  }
+
+  boost::filesystem::path file(PROJECT_BINARY_DIR "/test/ome-files/data/tiff-devicetilecodec.tiff");
+  {
+    std::shared_ptr<TIFF> t(TIFF::open(tiff_path, "r"));
+    std::shared_ptr<IFD> ifd(t->getDirectoryByIndex(0));
+
+    std::shared_ptr<TIFF> wtiff(TIFF::open(file, "w"));
+    std::shared_ptr<IFD> wifd(wtiff->getCurrentDirectory());
+    wifd->setImageWidth(ifd->getImageWidth());
+    wifd->setImageHeight(ifd->getImageHeight());
+    wifd->setTileType(ome::files::tiff::TILE);
+    wifd->setTileWidth(16U);
+    wifd->setTileHeight(16U);
+    wifd->setPixelType(ifd->getPixelType());
+    wifd->setBitsPerSample(ifd->getBitsPerSample());
+    wifd->setSamplesPerPixel(ifd->getSamplesPerPixel());
+    wifd->setPlanarConfiguration(ifd->getPlanarConfiguration());
+    wifd->setPhotometricInterpretation(ifd->getPhotometricInterpretation());
+    wifd->setCompression(scheme);
+    ASSERT_NO_THROW(wifd->writeImage(expected));
+    wtiff->writeCurrentDirectory();
+    wtiff->close();
+  }
+
+  std::shared_ptr<TIFF> t(TIFF::open(file, "r"));
+  if (!t->getSource())
+    return;
+  std::shared_ptr<IFD> ifd(t->getDirectoryByIndex(0));
+
+  std::shared_ptr<ome::files::PixelAllocator> allocator(std::make_shared<SimulatedDeviceAllocator>());
+  EXPECT_FALSE(ome::files::tiff::getDeviceTileCodec(scheme));
+
+  // No device codec registered.
+  {
+    VariantPixelBuffer observed;
+    observed.setAllocator(allocator);
+    EXPECT_THROW(ifd->readImage(observed), ome::files::tiff::Exception);
+  }
+
+  std::shared_ptr<SimulatedDeviceTileCodec> device(std::make_shared<SimulatedDeviceTileCodec>(ome::files::tiff::getTileCodec(scheme)));
+  ome::files::tiff::registerDeviceTileCodec(scheme, device);
+  EXPECT_EQ(device, ome::files::tiff::getDeviceTileCodec(scheme));
+
+  // Whole image, then a region with partial tiles; each is decoded
+  // as a single batch.
+  {
+    VariantPixelBuffer observed;
+    observed.setAllocator(allocator);
+    ASSERT_NO_THROW(ifd->readImage(observed));
+    EXPECT_EQ(1U, device->batches.load());
+    EXPECT_EQ(4U, device->tiles.load());
+    EXPECT_TRUE(expected == observed);
+  }
+  {
+    const dimension_size_type x = 3U, y = 5U;
+    const dimension_size_type w = ifd->getImageWidth() - 9U, h = ifd->getImageHeight() - 7U;
+
+    VariantPixelBuffer region;
+    ifd->readImage(region, x, y, w, h);
+
+    VariantPixelBuffer observed;
+    observed.setAllocator(allocator);
+    ASSERT_NO_THROW(ifd->readImage(observed, x, y, w, h));
+    EXPECT_EQ(2U, device->batches.load());
+    EXPECT_TRUE(region == observed);
+  }
+
+  // Host reads do not use the device codec.
+  {
+    VariantPixelBuffer observed;
+    ASSERT_NO_THROW(ifd->readImage(observed));
+    EXPECT_EQ(2U, device->batches.load());
+  }
+
+  ome::files::tiff::registerDeviceTileCodec(scheme, std::shared_ptr<ome::files::tiff::DeviceTileCodec>());
+  EXPECT_FALSE(ome::files::tiff::getDeviceTileCodec(scheme));
+}
+
+TEST_F(TIFFTest, Statistics)
+{
+  using ome::files::IOStatistics;
+
+  VariantPixelBuffer expected;
+  {
+    std::shared_ptr<TIFF> t(TIFF::open(tiff_path, "r"));
+    t->getDirectoryByIndex(0)->readImage(expected);
+  }
+
+  std::shared_ptr<IOStatistics> stats(std::make_shared<IOStatistics>());
+
+  boost::filesystem::path file(PROJECT_BINARY_DIR "/test/ome-files/data/tiff-statistics.tiff");
+  {
+    std::shared_ptr<TIFF> t(TIFF::open(tiff_path, "r"));
+    std::shared_ptr<IFD> ifd(t->getDirectoryByIndex(0));
+
+    std::shared_ptr<TIFF> wtiff(TIFF::open(file, "w"));
+    wtiff->setStatistics(stats);
+    EXPECT_EQ(stats, wtiff->getStatistics());
+    std::shared_ptr<IFD> wifd(wtiff->getCurrentDirectory());
+    wifd->setImageWidth(ifd->getImageWidth());
+    wifd->setImageHeight(ifd->getImageHeight());
+    wifd->setTileType(ome::files::tiff::TILE);
+    wifd->setTileWidth(16U);
+    wifd->setTileHeight(16U);
+    wifd->setPixelType(ifd->getPixelType());
+    wifd->setBitsPerSample(ifd->getBitsPerSample());
+    wifd->setSamplesPerPixel(ifd->getSamplesPerPixel());
+    wifd->setPlanarConfiguration(ifd->getPlanarConfiguration());
+    wifd->setPhotometricInterpretation(ifd->getPhotometricInterpretation());
+    wifd->setCompression(ome::files::tiff::COMPRESSION_DEFLATE);
+    ASSERT_NO_THROW(wifd->writeImage(expected));
+    wtiff->writeCurrentDirectory();
+    wtiff->close();
+  }
+  EXPECT_EQ(4U, stats->get(IOStatistics::TILES_ENCODED));
+  EXPECT_LT(0U, stats->get(IOStatistics::BYTES_WRITTEN));
+  EXPECT_EQ(0U, stats->get(IOStatistics::TILES_DECODED));
+  EXPECT_EQ(0U, stats->get(IOStatistics::BYTES_READ));
+
+  uint64_t written = stats->get(IOStatistics::BYTES_WRITTEN);
+  stats->reset();
+  EXPECT_EQ(0U, stats->get(IOStatistics::TILES_ENCODED));
+
+  {
+    std::shared_ptr<TIFF> t(TIFF::open(file, "r"));
+    t->setStatistics(stats);
+    t->setTileCache(std::make_shared<DecodedTileCache>());
+    std::shared_ptr<IFD> ifd(t->getDirectoryByIndex(0));
+
+    VariantPixelBuffer observed;
+    ASSERT_NO_THROW(ifd->readImage(observed));
+    EXPECT_TRUE(expected == observed);
+    EXPECT_EQ(4U, stats->get(IOStatistics::TILES_DECODED));
+    EXPECT_EQ(written, stats->get(IOStatistics::BYTES_READ));
+    EXPECT_EQ(4U, stats->get(IOStatistics::TILE_CACHE_MISSES));
+    EXPECT_EQ(0U, stats->get(IOStatistics::TILE_CACHE_HITS));
+
+    // A second read is satisfied from the cache.
+    ASSERT_NO_THROW(ifd->readImage(observed));
+    EXPECT_EQ(4U, stats->get(IOStatistics::TILES_DECODED));
+    EXPECT_EQ(4U, stats->get(IOStatistics::TILE_CACHE_HITS));
+  }
+
+  // Null restores separate statistics.
+  {
+    std::shared_ptr<TIFF> t(TIFF::open(file, "r"));
+    t->setStatistics(stats);
+    t->setStatistics(std::shared_ptr<IOStatistics>());
+    ASSERT_TRUE(static_cast<bool>(t->getStatistics()));
+    EXPECT_NE(stats, t->getStatistics());
+  }
+}
+
+namespace
+{
+
+  // Count begin and end callbacks for each event.
+  class CountingObserver : public ome::files::TraceObserver
+  {
+  public:
+    std::array<std::atomic<unsigned int>, event_count> begun;
+    std::array<std::atomic<unsigned int>, event_count> ended;
+
+    CountingObserver():
+      begun(),
+      ended()
+    {
+      for (std::size_t i = 0; i < event_count; ++i)
+        begun[i] = ended[i] = 0U;
+    }
+
+    void
+    begin(Event          event,
+          const Context& /* context */)
+    {
+      ++begun[event];
+    }
+
+    void
+    end(Event          event,
+        const Context& /* context */)
+    {
+      ++ended[event];
+    }
+  };
+
+}
+
+TEST_F(TIFFTest, LookupTable)
+{
+  boost::filesystem::path file(PROJECT_BINARY_DIR "/test/ome-files/data/tiff-lookuptable.tiff");
+
+  std::array<std::vector<uint16_t>, 3> cmap;
+  for (uint16_t i = 0; i < 256U; ++i)
+    {
+      cmap[0].push_back(static_cast<uint16_t>(i * 256U));
+      cmap[1].push_back(static_cast<uint16_t>((255U - i) * 256U));
+      cmap[2].push_back(static_cast<uint16_t>(i));
+    }
+
+  {
+    std::array<VariantPixelBuffer::size_type, 9> shape;
+    shape[ome::files::DIM_SPATIAL_X] = shape[ome::files::DIM_SPATIAL_Y] = 16;
+    shape[ome::files::DIM_SUBCHANNEL] = shape[ome::files::DIM_SPATIAL_Z] =
+      shape[ome::files::DIM_TEMPORAL_T] = shape[ome::files::DIM_CHANNEL] =
+      shape[ome::files::DIM_MODULO_Z] = shape[ome::files::DIM_MODULO_T] =
+      shape[ome::files::DIM_MODULO_C] = 1;
+    VariantPixelBuffer pixels(shape, PT::UINT8);
+
+    std::shared_ptr<TIFF> wtiff(TIFF::open(file, "w"));
+    std::shared_ptr<IFD> wifd(wtiff->getCurrentDirectory());
+    wifd->setImageWidth(16U);
+    wifd->setImageHeight(16U);
+    wifd->setTileType(ome::files::tiff::STRIP);
+    wifd->setTileWidth(16U);
+    wifd->setTileHeight(16U);
+    wifd->setPixelType(PT::UINT8);
+    wifd->setBitsPerSample(8U);
+    wifd->setSamplesPerPixel(1U);
+    wifd->setPlanarConfiguration(ome::files::tiff::CONTIG);
+    wifd->setPhotometricInterpretation(ome::files::tiff::PALETTE);
+    wifd->getField(ome::files::tiff::COLORMAP).set(cmap);
+    ASSERT_NO_THROW(wifd->writeImage(pixels));
+    wtiff->writeCurrentDirectory();
+    wtiff->close();
+  }
+
+  std::shared_ptr<TIFF> t(TIFF::open(file, "r"));
+  std::shared_ptr<IFD> ifd(t->getDirectoryByIndex(0));
+
+  // The lookup table is read once and shared.
+  std::shared_ptr<const VariantPixelBuffer> lut(ifd->getLookupTable());
+  ASSERT_TRUE(static_cast<bool>(lut));
+  EXPECT_EQ(lut.get(), ifd->getLookupTable().get());
+  EXPECT_EQ(lut.get(), t->getDirectoryByIndex(0)->getLookupTable().get());
+  EXPECT_EQ(256U, lut->shape()[ome::files::DIM_SPATIAL_X]);
+  EXPECT_EQ(3U, lut->shape()[ome::files::DIM_SUBCHANNEL]);
+
+  VariantPixelBuffer copy;
+  ASSERT_NO_THROW(ifd->readLookupTable(copy));
+  EXPECT_TRUE(*lut == copy);
+
+  std::shared_ptr<PixelBuffer<PixelProperties<PT::UINT16>::std_type>>& uint16_copy(boost::get<std::shared_ptr<PixelBuffer<PixelProperties<PT::UINT16>::std_type>>>(copy.vbuffer()));
+  VariantPixelBuffer::indices_type coord;
+  coord[ome::files::DIM_SPATIAL_X] = 10;
+  coord[ome::files::DIM_SPATIAL_Y] = coord[ome::files::DIM_SPATIAL_Z] =
+    coord[ome::files::DIM_TEMPORAL_T] = coord[ome::files::DIM_CHANNEL] =
+    coord[ome::files::DIM_MODULO_Z] = coord[ome::files::DIM_MODULO_T] =
+    coord[ome::files::DIM_MODULO_C] = 0;
+  for (dimension_size_type s = 0; s < 3U; ++s)
+    {
+      coord[ome::files::DIM_SUBCHANNEL] = s;
+      EXPECT_EQ(cmap[s][10], uint16_copy->at(coord));
+    }
+}
+
+TEST_F(TIFFTest, LookupTableRGB)
+{
+  boost::filesystem::path file(PROJECT_BINARY_DIR "/test/ome-files/data/tiff-lookuptable-rgb.tiff");
+
+  std::array<std::vector<uint16_t>, 3> cmap;
+  for (uint16_t i = 0; i < 256U; ++i)
+    {
+      cmap[0].push_back(static_cast<uint16_t>(i * 256U));
+      cmap[1].push_back(static_cast<uint16_t>((255U - i) * 256U));
+      cmap[2].push_back(static_cast<uint16_t>(i));
+    }
+
+  {
+    std::array<VariantPixelBuffer::size_type, 9> shape;
+    shape[ome::files::DIM_SPATIAL_X] = shape[ome::files::DIM_SPATIAL_Y] = 16;
+    shape[ome::files::DIM_SUBCHANNEL] = shape[ome::files::DIM_SPATIAL_Z] =
+      shape[ome::files::DIM_TEMPORAL_T] = shape[ome::files::DIM_CHANNEL] =
+      shape[ome::files::DIM_MODULO_Z] = shape[ome::files::DIM_MODULO_T] =
+      shape[ome::files::DIM_MODULO_C] = 1;
+    VariantPixelBuffer pixels(shape, PT::UINT8);
+    std::shared_ptr<PixelBuffer<PixelProperties<PT::UINT8>::std_type>>& uint8_pixels(boost::get<std::shared_ptr<PixelBuffer<PixelProperties<PT::UINT8>::std_type>>>(pixels.vbuffer()));
+    for (dimension_size_type i = 0; i < 256U; ++i)
+      uint8_pixels->data()[i] = static_cast<uint8_t>(255U - i);
+
+    std::shared_ptr<TIFF> wtiff(TIFF::open(file, "w"));
+    std::shared_ptr<IFD> wifd(wtiff->getCurrentDirectory());
+    wifd->setImageWidth(16U);
+    wifd->setImageHeight(16U);
+    wifd->setTileType(ome::files::tiff::STRIP);
+    // Four strips, so that the region read spans several strips.
+    wifd->setTileHeight(4U);
+    wifd->setPixelType(PT::UINT8);
+    wifd->setBitsPerSample(8U);
+    wifd->setSamplesPerPixel(1U);
+    wifd->setPlanarConfiguration(ome::files::tiff::CONTIG);
+    wifd->setPhotometricInterpretation(ome::files::tiff::PALETTE);
+    wifd->getField(ome::files::tiff::COLORMAP).set(cmap);
+    ASSERT_NO_THROW(wifd->writeImage(pixels));
+    wtiff->writeCurrentDirectory();
+    wtiff->close();
+  }
+
+  std::shared_ptr<TIFF> t(TIFF::open(file, "r"));
+  std::shared_ptr<IFD> ifd(t->getDirectoryByIndex(0));
+
+  VariantPixelBuffer::indices_type coord;
+  coord[ome::files::DIM_SPATIAL_Z] = coord[ome::files::DIM_TEMPORAL_T] =
+    coord[ome::files::DIM_CHANNEL] = coord[ome::files::DIM_MODULO_Z] =
+    coord[ome::files::DIM_MODULO_T] = coord[ome::files::DIM_MODULO_C] = 0;
+
+  // Indices expanded to RGB while reading, for interleaved and
+  // planar destinations.
+  for (bool interleaved : {true, false})
+    {
+      VariantPixelBuffer rgb;
+      ASSERT_NO_THROW(ifd->readImageRGB(rgb, 2, 3, 10, 12, interleaved));
+      EXPECT_EQ(PT::UINT16, rgb.pixelType());
+      EXPECT_EQ(10U, rgb.shape()[ome::files::DIM_SPATIAL_X]);
+      EXPECT_EQ(12U, rgb.shape()[ome::files::DIM_SPATIAL_Y]);
+      EXPECT_EQ(3U, rgb.shape()[ome::files::DIM_SUBCHANNEL]);
+
+      std::shared_ptr<PixelBuffer<PixelProperties<PT::UINT16>::std_type>>& uint16_rgb(boost::get<std::shared_ptr<PixelBuffer<PixelProperties<PT::UINT16>::std_type>>>(rgb.vbuffer()));
+      for (dimension_size_type y = 0; y < 12U; ++y)
+        for (dimension_size_type x = 0; x < 10U; ++x)
+          for (dimension_size_type s = 0; s < 3U; ++s)
+            {
+              coord[ome::files::DIM_SPATIAL_X] = x;
+              coord[ome::files::DIM_SPATIAL_Y] = y;
+              coord[ome::files::DIM_SUBCHANNEL] = s;
+              dimension_size_type index = 255U - (((y + 3U) * 16U) + x + 2U);
+              EXPECT_EQ(cmap[s][index], uint16_rgb->at(coord));
+            }
+    }
+
+  // Non-indexed images may not be expanded.
+  std::shared_ptr<TIFF> grey(TIFF::open(tiff_path, "r"));
+  VariantPixelBuffer rgb;
+  EXPECT_THROW(grey->getDirectoryByIndex(0)->readImageRGB(rgb, 0, 0, 4, 4),
+               ome::files::tiff::Exception);
+}
+
+TEST_F(TIFFTest, SparseTiles)
+{
+  using ome::files::IOStatistics;
+
+  boost::filesystem::path file(PROJECT_BINARY_DIR "/test/ome-files/data/tiff-sparse.tiff");
+
+  std::array<VariantPixelBuffer::size_type, 9> shape;
+  shape[ome::files::DIM_SPATIAL_X] = 64;
+  shape[ome::files::DIM_SPATIAL_Y] = 48;
+  shape[ome::files::DIM_SUBCHANNEL] = 1;
+  shape[ome::files::DIM_SPATIAL_Z] = shape[ome::files::DIM_TEMPORAL_T] =
+    shape[ome::files::DIM_CHANNEL] = shape[ome::files::DIM_MODULO_Z] =
+    shape[ome::files::DIM_MODULO_T] = shape[ome::files::DIM_MODULO_C] = 1;
+
+  // Only tiles 0 and 6 (of 12) contain non-zero pixels.
+  VariantPixelBuffer expected(shape, PT::UINT16);
+  std::shared_ptr<PixelBuffer<PixelProperties<PT::UINT16>::std_type>>& uint16_expected(boost::get<std::shared_ptr<PixelBuffer<PixelProperties<PT::UINT16>::std_type>>>(expected.vbuffer()));
+  std::fill(uint16_expected->data(), uint16_expected->data() + uint16_expected->num_elements(), 0U);
+  for (dimension_size_type y = 0; y < 48U; ++y)
+    for (dimension_size_type x = 0; x < 64U; ++x)
+      if ((x < 16U && y < 16U) ||
+          (x >= 32U && x < 48U && y >= 16U && y < 32U && (x + y) % 3U))
+        uint16_expected->data()[(y * 64U) + x] = static_cast<uint16_t>(x + (y * 64U) + 1U);
+
+  for (auto sparse : {false, true})
+    {
+      std::shared_ptr<IOStatistics> stats(std::make_shared<IOStatistics>());
+      {
+        std::shared_ptr<TIFF> wtiff(TIFF::open(file, "w"));
+        wtiff->setStatistics(stats);
+        wtiff->setSparseTiles(sparse);
+        EXPECT_EQ(sparse, wtiff->getSparseTiles());
+        std::shared_ptr<IFD> wifd(wtiff->getCurrentDirectory());
+        wifd->setImageWidth(64U);
+        wifd->setImageHeight(48U);
+        wifd->setTileType(ome::files::tiff::TILE);
+        wifd->setTileWidth(16U);
+        wifd->setTileHeight(16U);
+        wifd->setPixelType(PT::UINT16);
+        wifd->setBitsPerSample(16U);
+        wifd->setSamplesPerPixel(1U);
+        wifd->setPlanarConfiguration(ome::files::tiff::CONTIG);
+        wifd->setPhotometricInterpretation(ome::files::tiff::MIN_IS_BLACK);
+        wifd->setCompression(ome::files::tiff::COMPRESSION_DEFLATE);
+        ASSERT_NO_THROW(wifd->writeImage(expected));
+        wtiff->writeCurrentDirectory();
+        wtiff->close();
+      }
+      EXPECT_EQ(sparse ? 2U : 12U, stats->get(IOStatistics::TILES_ENCODED));
+      EXPECT_EQ(sparse ? 10U : 0U, stats->get(IOStatistics::SPARSE_TILES));
+
+      stats->reset();
+
+      std::shared_ptr<TIFF> t(TIFF::open(file, "r"));
+      t->setStatistics(stats);
+      std::shared_ptr<IFD> ifd(t->getDirectoryByIndex(0));
+
+      // Sparse tiles are zero-filled without decoding.
+      VariantPixelBuffer observed;
+      ASSERT_NO_THROW(ifd->readImage(observed));
+      EXPECT_TRUE(expected == observed);
+      EXPECT_EQ(sparse ? 2U : 12U, stats->get(IOStatistics::TILES_DECODED));
+      EXPECT_EQ(sparse ? 10U : 0U, stats->get(IOStatistics::SPARSE_TILES));
+
+      // A region within a sparse tile.
+      std::array<VariantPixelBuffer::size_type, 9> regionshape(shape);
+      regionshape[ome::files::DIM_SPATIAL_X] = 8;
+      regionshape[ome::files::DIM_SPATIAL_Y] = 8;
+      VariantPixelBuffer zero(regionshape, PT::UINT16);
+      std::shared_ptr<PixelBuffer<PixelProperties<PT::UINT16>::std_type>>& uint16_zero(boost::get<std::shared_ptr<PixelBuffer<PixelProperties<PT::UINT16>::std_type>>>(zero.vbuffer()));
+      std::fill(uint16_zero->data(), uint16_zero->data() + uint16_zero->num_elements(), 0U);
+      ASSERT_NO_THROW(ifd->readImage(observed, 52U, 36U, 8U, 8U));
+      EXPECT_TRUE(zero == observed);
+    }
+}
+
+TEST_F(TIFFTest, PackedSamples)
+{
+  boost::filesystem::path file(PROJECT_BINARY_DIR "/test/ome-files/data/tiff-packed.tiff");
+
+  // An odd width, so that rows of packed samples are padded.
+  std::array<VariantPixelBuffer::size_type, 9> shape;
+  shape[ome::files::DIM_SPATIAL_X] = 37;
+  shape[ome::files::DIM_SPATIAL_Y] = 23;
+  shape[ome::files::DIM_SUBCHANNEL] = 3;
+  shape[ome::files::DIM_SPATIAL_Z] = shape[ome::files::DIM_TEMPORAL_T] =
+    shape[ome::files::DIM_CHANNEL] = shape[ome::files::DIM_MODULO_Z] =
+    shape[ome::files::DIM_MODULO_T] = shape[ome::files::DIM_MODULO_C] = 1;
+
+  for (uint16_t bits : {uint16_t(10U), uint16_t(12U), uint16_t(14U)})
+    for (auto type : {ome::files::tiff::TILE, ome::files::tiff::STRIP})
+      for (auto planarconfig : {ome::files::tiff::CONTIG, ome::files::tiff::SEPARATE})
+        for (auto compression : {ome::files::tiff::COMPRESSION_NONE, ome::files::tiff::COMPRESSION_DEFLATE})
+          {
+            SCOPED_TRACE(bits);
+
+            VariantPixelBuffer expected(shape, PT::UINT16);
+            std::shared_ptr<PixelBuffer<PixelProperties<PT::UINT16>::std_type>>& uint16_expected(boost::get<std::shared_ptr<PixelBuffer<PixelProperties<PT::UINT16>::std_type>>>(expected.vbuffer()));
+            for (dimension_size_type i = 0; i < uint16_expected->num_elements(); ++i)
+              uint16_expected->data()[i] = static_cast<uint16_t>(((i * 2654435761U) >> 5U) & ((1U << bits) - 1U));
+
+            {
+              std::shared_ptr<TIFF> wtiff(TIFF::open(file, "w"));
+              std::shared_ptr<IFD> wifd(wtiff->getCurrentDirectory());
+              wifd->setImageWidth(37U);
+              wifd->setImageHeight(23U);
+              wifd->setTileType(type);
+              wifd->setTileWidth(type == ome::files::tiff::TILE ? 16U : 37U);
+              wifd->setTileHeight(type == ome::files::tiff::TILE ? 16U : 5U);
+              wifd->setPixelType(PT::UINT16);
+              wifd->setBitsPerSample(bits);
+              wifd->setSamplesPerPixel(3U);
+              wifd->setPlanarConfiguration(planarconfig);
+              wifd->setPhotometricInterpretation(ome::files::tiff::RGB);
+              wifd->setCompression(compression);
+
+              const TileInfo info(wifd->getTileInfo());
+              EXPECT_LT(info.bufferSize(), info.decodedBufferSize());
+
+              ASSERT_NO_THROW(wifd->writeImage(expected));
+              wtiff->writeCurrentDirectory();
+              wtiff->close();
+            }
+
+            std::shared_ptr<TIFF> t(TIFF::open(file, "r"));
+            std::shared_ptr<IFD> ifd(t->getDirectoryByIndex(0));
+            EXPECT_EQ(bits, ifd->getBitsPerSample());
+            EXPECT_EQ(PT::UINT16, ifd->getPixelType());
+
+            VariantPixelBuffer observed;
+            ASSERT_NO_THROW(ifd->readImage(observed));
+            EXPECT_TRUE(expected == observed);
+
+            // A region spanning several tiles or strips.
+            VariantPixelBuffer region;
+            ASSERT_NO_THROW(ifd->readImage(region, 7U, 3U, 20U, 13U));
+            std::shared_ptr<PixelBuffer<PixelProperties<PT::UINT16>::std_type>>& uint16_region(boost::get<std::shared_ptr<PixelBuffer<PixelProperties<PT::UINT16>::std_type>>>(region.vbuffer()));
+            VariantPixelBuffer::indices_type coord, full;
+            std::fill(coord.begin(), coord.end(), 0);
+            std::fill(full.begin(), full.end(), 0);
+            for (dimension_size_type y = 0; y < 13U; ++y)
+              for (dimension_size_type x = 0; x < 20U; ++x)
+                for (dimension_size_type s = 0; s < 3U; ++s)
+                  {
+                    coord[ome::files::DIM_SPATIAL_X] = x;
+                    coord[ome::files::DIM_SPATIAL_Y] = y;
+                    coord[ome::files::DIM_SUBCHANNEL] = full[ome::files::DIM_SUBCHANNEL] = s;
+                    full[ome::files::DIM_SPATIAL_X] = x + 7U;
+                    full[ome::files::DIM_SPATIAL_Y] = y + 3U;
+                    ASSERT_EQ(uint16_expected->at(full), uint16_region->at(coord));
+                  }
+          }
+}
+
+TEST_F(TIFFTest, HalfFloatSamples)
+{
+  boost::filesystem::path file(PROJECT_BINARY_DIR "/test/ome-files/data/tiff-halffloat.tiff");
+
+  std::array<VariantPixelBuffer::size_type, 9> shape;
+  shape[ome::files::DIM_SPATIAL_X] = 37;
+  shape[ome::files::DIM_SPATIAL_Y] = 23;
+  shape[ome::files::DIM_SUBCHANNEL] = 3;
+  shape[ome::files::DIM_SPATIAL_Z] = shape[ome::files::DIM_TEMPORAL_T] =
+    shape[ome::files::DIM_CHANNEL] = shape[ome::files::DIM_MODULO_Z] =
+    shape[ome::files::DIM_MODULO_T] = shape[ome::files::DIM_MODULO_C] = 1;
+
+  // Values exactly representable in half precision.
+  VariantPixelBuffer expected(shape, PT::FLOAT);
+  std::shared_ptr<PixelBuffer<PixelProperties<PT::FLOAT>::std_type>>& float_expected(boost::get<std::shared_ptr<PixelBuffer<PixelProperties<PT::FLOAT>::std_type>>>(expected.vbuffer()));
+  for (dimension_size_type i = 0; i < float_expected->num_elements(); ++i)
+    float_expected->data()[i] = (static_cast<float>(((i * 2654435761U) >> 5U) & 0xFFFU) - 2048.0f) / 8.0f;
+
+  for (auto type : {ome::files::tiff::TILE, ome::files::tiff::STRIP})
+    for (auto planarconfig : {ome::files::tiff::CONTIG, ome::files::tiff::SEPARATE})
+      for (auto compression : {ome::files::tiff::COMPRESSION_NONE, ome::files::tiff::COMPRESSION_DEFLATE})
+        {
+          {
+            std::shared_ptr<TIFF> wtiff(TIFF::open(file, "w"));
+            std::shared_ptr<IFD> wifd(wtiff->getCurrentDirectory());
+            wifd->setImageWidth(37U);
+            wifd->setImageHeight(23U);
+            wifd->setTileType(type);
+            wifd->setTileWidth(type == ome::files::tiff::TILE ? 16U : 37U);
+            wifd->setTileHeight(type == ome::files::tiff::TILE ? 16U : 5U);
+            wifd->setPixelType(PT::FLOAT);
+            wifd->setBitsPerSample(16U);
+            wifd->setSamplesPerPixel(3U);
+            wifd->setPlanarConfiguration(planarconfig);
+            wifd->setPhotometricInterpretation(ome::files::tiff::RGB);
+            wifd->setCompression(compression);
+
+            const TileInfo info(wifd->getTileInfo());
+            EXPECT_EQ(info.bufferSize() * 2U, info.decodedBufferSize());
+
+            ASSERT_NO_THROW(wifd->writeImage(expected));
+            wtiff->writeCurrentDirectory();
+            wtiff->close();
+          }
+
+          std::shared_ptr<TIFF> t(TIFF::open(file, "r"));
+          std::shared_ptr<IFD> ifd(t->getDirectoryByIndex(0));
+          EXPECT_EQ(16U, ifd->getBitsPerSample());
+          EXPECT_EQ(PT::FLOAT, ifd->getPixelType());
+
+          VariantPixelBuffer observed;
+          ASSERT_NO_THROW(ifd->readImage(observed));
+          EXPECT_TRUE(expected == observed);
+
+          // A region spanning several tiles or strips.
+          VariantPixelBuffer region;
+          ASSERT_NO_THROW(ifd->readImage(region, 7U, 3U, 20U, 13U));
+          std::shared_ptr<PixelBuffer<PixelProperties<PT::FLOAT>::std_type>>& float_region(boost::get<std::shared_ptr<PixelBuffer<PixelProperties<PT::FLOAT>::std_type>>>(region.vbuffer()));
+          VariantPixelBuffer::indices_type coord, full;
+          std::fill(coord.begin(), coord.end(), 0);
+          std::fill(full.begin(), full.end(), 0);
+          for (dimension_size_type y = 0; y < 13U; ++y)
+            for (dimension_size_type x = 0; x < 20U; ++x)
+              for (dimension_size_type s = 0; s < 3U; ++s)
+                {
+                  coord[ome::files::DIM_SPATIAL_X] = x;
+                  coord[ome::files::DIM_SPATIAL_Y] = y;
+                  coord[ome::files::DIM_SUBCHANNEL] = full[ome::files::DIM_SUBCHANNEL] = s;
+                  full[ome::files::DIM_SPATIAL_X] = x + 7U;
+                  full[ome::files::DIM_SPATIAL_Y] = y + 3U;
+                  ASSERT_EQ(float_expected->at(full), float_region->at(coord));
+                }
+        }
+}
+
+TEST_F(TIFFTest, JPEGYCbCr)
+{
+  bool jpeg = false;
+  for (const auto& name : ome::files::tiff::getCodecNames(PT::UINT8))
+    if (ome::files::tiff::getCodecScheme(name) == ome::files::tiff::COMPRESSION_JPEG)
+      jpeg = true;
+  if (!jpeg)
+    return; // JPEG support required.
+
+  boost::filesystem::path file(PROJECT_BINARY_DIR "/test/ome-files/data/tiff-jpeg-ycbcr.tiff");
+
+  std::array<VariantPixelBuffer::size_type, 9> shape;
+  shape[ome::files::DIM_SPATIAL_X] = 64;
+  shape[ome::files::DIM_SPATIAL_Y] = 48;
+  shape[ome::files::DIM_SUBCHANNEL] = 3;
+  shape[ome::files::DIM_SPATIAL_Z] = shape[ome::files::DIM_TEMPORAL_T] =
+    shape[ome::files::DIM_CHANNEL] = shape[ome::files::DIM_MODULO_Z] =
+    shape[ome::files::DIM_MODULO_T] = shape[ome::files::DIM_MODULO_C] = 1;
+
+  // Smooth gradients, so that the chrominance subsampling and
+  // quantisation error is small.
+  VariantPixelBuffer expected(shape, PT::UINT8);
+  std::shared_ptr<PixelBuffer<PixelProperties<PT::UINT8>::std_type>>& uint8_expected(boost::get<std::shared_ptr<PixelBuffer<PixelProperties<PT::UINT8>::std_type>>>(expected.vbuffer()));
+  VariantPixelBuffer::indices_type coord;
+  std::fill(coord.begin(), coord.end(), 0);
+  for (dimension_size_type y = 0; y < 48U; ++y)
+    for (dimension_size_type x = 0; x < 64U; ++x)
+      {
+        coord[ome::files::DIM_SPATIAL_X] = x;
+        coord[ome::files::DIM_SPATIAL_Y] = y;
+        coord[ome::files::DIM_SUBCHANNEL] = 0;
+        uint8_expected->at(coord) = static_cast<uint8_t>(64U + x * 2U);
+        coord[ome::files::DIM_SUBCHANNEL] = 1;
+        uint8_expected->at(coord) = static_cast<uint8_t>(64U + y * 2U);
+        coord[ome::files::DIM_SUBCHANNEL] = 2;
+        uint8_expected->at(coord) = static_cast<uint8_t>(160U);
+      }
+
+  for (auto type : {ome::files::tiff::TILE, ome::files::tiff::STRIP})
+    {
+      SCOPED_TRACE(type == ome::files::tiff::TILE ? "tile" : "strip");
+
+      {
+        std::shared_ptr<TIFF> wtiff(TIFF::open(file, "w"));
+        std::shared_ptr<IFD> wifd(wtiff->getCurrentDirectory());
+        wifd->setImageWidth(64U);
+        wifd->setImageHeight(48U);
+        wifd->setTileType(type);
+        wifd->setTileWidth(type == ome::files::tiff::TILE ? 32U : 64U);
+        wifd->setTileHeight(type == ome::files::tiff::TILE ? 32U : 20U);
+        wifd->setPixelType(PT::UINT8);
+        wifd->setBitsPerSample(8U);
+        wifd->setSamplesPerPixel(3U);
+        wifd->setPlanarConfiguration(ome::files::tiff::CONTIG);
+        wifd->setPhotometricInterpretation(ome::files::tiff::RGB);
+        wifd->setCompression(ome::files::tiff::COMPRESSION_JPEG);
+
+        ASSERT_TRUE(ome::files::tiff::setupJPEGYCbCr(*wifd));
+        EXPECT_EQ(ome::files::tiff::YCBCR, wifd->getPhotometricInterpretation());
+        // Strips are rounded down to whole JPEG blocks.
+        EXPECT_EQ(type == ome::files::tiff::TILE ? 32U : 16U, wifd->getTileHeight());
+
+        ASSERT_NO_THROW(wifd->writeImage(expected));
+        wtiff->writeCurrentDirectory();
+        wtiff->close();
+      }
+
+      std::shared_ptr<TIFF> t(TIFF::open(file, "r"));
+      std::shared_ptr<IFD> ifd(t->getDirectoryByIndex(0));
+      EXPECT_EQ(ome::files::tiff::YCBCR, ifd->getPhotometricInterpretation());
+      std::array<uint16_t, 2> subsampling;
+      ifd->getField(ome::files::tiff::YCBCRSUBSAMPLING).get(subsampling);
+      EXPECT_EQ(2U, subsampling[0]);
+      EXPECT_EQ(2U, subsampling[1]);
+
+      // Samples are converted back to RGB.
+      VariantPixelBuffer observed;
+      ASSERT_NO_THROW(ifd->readImage(observed));
+      EXPECT_EQ(PT::UINT8, observed.pixelType());
+      ASSERT_EQ(3U, observed.shape()[ome::files::DIM_SUBCHANNEL]);
+      std::shared_ptr<PixelBuffer<PixelProperties<PT::UINT8>::std_type>>& uint8_observed(boost::get<std::shared_ptr<PixelBuffer<PixelProperties<PT::UINT8>::std_type>>>(observed.vbuffer()));
+      for (dimension_size_type i = 0; i < uint8_expected->num_elements(); ++i)
+        ASSERT_NEAR(uint8_expected->data()[i], uint8_observed->data()[i], 12);
+
+      // Regions decode identically to the full image.
+      VariantPixelBuffer region;
+      ASSERT_NO_THROW(ifd->readImage(region, 5U, 9U, 40U, 30U));
+      std::shared_ptr<PixelBuffer<PixelProperties<PT::UINT8>::std_type>>& uint8_region(boost::get<std::shared_ptr<PixelBuffer<PixelProperties<PT::UINT8>::std_type>>>(region.vbuffer()));
+      VariantPixelBuffer::indices_type full;
+      std::fill(full.begin(), full.end(), 0);
+      for (dimension_size_type y = 0; y < 30U; ++y)
+        for (dimension_size_type x = 0; x < 40U; ++x)
+          for (dimension_size_type s = 0; s < 3U; ++s)
+            {
+              coord[ome::files::DIM_SPATIAL_X] = x;
+              coord[ome::files::DIM_SPATIAL_Y] = y;
+              coord[ome::files::DIM_SUBCHANNEL] = full[ome::files::DIM_SUBCHANNEL] = s;
+              full[ome::files::DIM_SPATIAL_X] = x + 5U;
+              full[ome::files::DIM_SPATIAL_Y] = y + 9U;
+              ASSERT_EQ(uint8_observed->at(full), uint8_region->at(coord));
+            }
+    }
+}
+
+TEST_F(TIFFTest, ReducedRead)
+{
+  bool jpeg = false;
+  for (const auto& name : ome::files::tiff::getCodecNames(PT::UINT8))
+    if (ome::files::tiff::getCodecScheme(name) == ome::files::tiff::COMPRESSION_JPEG)
+      jpeg = true;
+  if (!jpeg)
+    return; // JPEG support required.
+
+  boost::filesystem::path file(PROJECT_BINARY_DIR "/test/ome-files/data/tiff-reduced-read.tiff");
+
+  std::array<VariantPixelBuffer::size_type, 9> shape;
+  shape[ome::files::DIM_SPATIAL_X] = 64;
+  shape[ome::files::DIM_SPATIAL_Y] = 48;
+  shape[ome::files::DIM_SUBCHANNEL] = 1;
+  shape[ome::files::DIM_SPATIAL_Z] = shape[ome::files::DIM_TEMPORAL_T] =
+    shape[ome::files::DIM_CHANNEL] = shape[ome::files::DIM_MODULO_Z] =
+    shape[ome::files::DIM_MODULO_T] = shape[ome::files::DIM_MODULO_C] = 1;
+
+  VariantPixelBuffer expected(shape, PT::UINT8);
+  std::shared_ptr<PixelBuffer<PixelProperties<PT::UINT8>::std_type>>& uint8_expected(boost::get<std::shared_ptr<PixelBuffer<PixelProperties<PT::UINT8>::std_type>>>(expected.vbuffer()));
+  for (dimension_size_type y = 0; y < 48U; ++y)
+    for (dimension_size_type x = 0; x < 64U; ++x)
+      uint8_expected->data()[(y * 64U) + x] = static_cast<uint8_t>(32U + x + (y * 2U));
+
+  {
+    std::shared_ptr<TIFF> wtiff(TIFF::open(file, "w"));
+    std::shared_ptr<IFD> wifd(wtiff->getCurrentDirectory());
+    wifd->setImageWidth(64U);
+    wifd->setImageHeight(48U);
+    wifd->setTileType(ome::files::tiff::TILE);
+    wifd->setTileWidth(16U);
+    wifd->setTileHeight(16U);
+    wifd->setPixelType(PT::UINT8);
+    wifd->setBitsPerSample(8U);
+    wifd->setSamplesPerPixel(1U);
+    wifd->setPlanarConfiguration(ome::files::tiff::CONTIG);
+    wifd->setPhotometricInterpretation(ome::files::tiff::MIN_IS_BLACK);
+    wifd->setCompression(ome::files::tiff::COMPRESSION_JPEG);
+    ASSERT_NO_THROW(wifd->writeImage(expected));
+    wtiff->writeCurrentDirectory();
+    wtiff->close();
+  }
+
+  std::shared_ptr<TIFF> t(TIFF::open(file, "r"));
+  std::shared_ptr<IFD> ifd(t->getDirectoryByIndex(0));
+
+  EXPECT_FALSE(ifd->supportsReducedRead(1U));
+  EXPECT_FALSE(ifd->supportsReducedRead(3U));
+  EXPECT_FALSE(ifd->supportsReducedRead(16U));
+  VariantPixelBuffer reduced;
+  EXPECT_THROW(ifd->readImageReduced(reduced, 0U, 0U, 64U, 48U, 3U), ome::files::tiff::Exception);
+  if (!ifd->supportsReducedRead(2U))
+    return; // libjpeg support required.
+
+  // Unaligned and invalid regions.
+  EXPECT_THROW(ifd->readImageReduced(reduced, 3U, 0U, 32U, 32U, 2U), ome::files::tiff::Exception);
+  EXPECT_THROW(ifd->readImageReduced(reduced, 0U, 0U, 72U, 48U, 2U), ome::files::tiff::Exception);
+
+  VariantPixelBuffer full;
+  ASSERT_NO_THROW(ifd->readImage(full));
+  std::shared_ptr<PixelBuffer<PixelProperties<PT::UINT8>::std_type>>& uint8_full(boost::get<std::shared_ptr<PixelBuffer<PixelProperties<PT::UINT8>::std_type>>>(full.vbuffer()));
+
+  for (dimension_size_type scale : {2U, 4U, 8U})
+    {
+      SCOPED_TRACE(scale);
+
+      // A region spanning several tiles, with partial tiles on
+      // every side.
+      ASSERT_NO_THROW(ifd->readImageReduced(reduced, 8U, 16U, 50U, 30U, scale));
+      EXPECT_EQ(PT::UINT8, reduced.pixelType());
+      const dimension_size_type scaledw = (50U + scale - 1U) / scale;
+      const dimension_size_type scaledh = (30U + scale - 1U) / scale;
+      ASSERT_EQ(scaledw, reduced.shape()[ome::files::DIM_SPATIAL_X]);
+      ASSERT_EQ(scaledh, reduced.shape()[ome::files::DIM_SPATIAL_Y]);
+      ASSERT_EQ(1U, reduced.shape()[ome::files::DIM_SUBCHANNEL]);
+      std::shared_ptr<PixelBuffer<PixelProperties<PT::UINT8>::std_type>>& uint8_reduced(boost::get<std::shared_ptr<PixelBuffer<PixelProperties<PT::UINT8>::std_type>>>(reduced.vbuffer()));
+
+      // Each sample is close to the mean of the full resolution
+      // block it covers.
+      VariantPixelBuffer::indices_type coord;
+      std::fill(coord.begin(), coord.end(), 0);
+      for (dimension_size_type sy = 0; sy < scaledh; ++sy)
+        for (dimension_size_type sx = 0; sx < scaledw; ++sx)
+          {
+            const dimension_size_type x0 = 8U + (sx * scale);
+            const dimension_size_type y0 = 16U + (sy * scale);
+            double sum = 0.0;
+            for (dimension_size_type y = y0; y < y0 + scale; ++y)
+              for (dimension_size_type x = x0; x < x0 + scale; ++x)
+                sum += uint8_full->data()[(y * 64U) + x];
+            coord[ome::files::DIM_SPATIAL_X] = sx;
+            coord[ome::files::DIM_SPATIAL_Y] = sy;
+            ASSERT_NEAR(sum / static_cast<double>(scale * scale), uint8_reduced->at(coord), 6.0);
+          }
+    }
+}
+
+TEST_F(TIFFTest, TileStatistics)
+{
+  using ome::files::IOStatistics;
+  using ome::files::tiff::TileStatistics;
+
+  boost::filesystem::path file(PROJECT_BINARY_DIR "/test/ome-files/data/tiff-tile-statistics.tiff");
+
+  std::array<VariantPixelBuffer::size_type, 9> shape;
+  shape[ome::files::DIM_SPATIAL_X] = 64;
+  shape[ome::files::DIM_SPATIAL_Y] = 48;
+  shape[ome::files::DIM_SUBCHANNEL] = 1;
+  shape[ome::files::DIM_SPATIAL_Z] = shape[ome::files::DIM_TEMPORAL_T] =
+    shape[ome::files::DIM_CHANNEL] = shape[ome::files::DIM_MODULO_Z] =
+    shape[ome::files::DIM_MODULO_T] = shape[ome::files::DIM_MODULO_C] = 1;
+
+  // Tile 0 is a gradient, tile 6 is constant, and the rest are
+  // empty.
+  VariantPixelBuffer expected(shape, PT::UINT16);
+  std::shared_ptr<PixelBuffer<PixelProperties<PT::UINT16>::std_type>>& uint16_expected(boost::get<std::shared_ptr<PixelBuffer<PixelProperties<PT::UINT16>::std_type>>>(expected.vbuffer()));
+  std::fill(uint16_expected->data(), uint16_expected->data() + uint16_expected->num_elements(), 0U);
+  for (dimension_size_type y = 0; y < 48U; ++y)
+    for (dimension_size_type x = 0; x < 64U; ++x)
+      {
+        if (x < 16U && y < 16U)
+          uint16_expected->data()[(y * 64U) + x] = static_cast<uint16_t>(x + y + 1U);
+        else if (x >= 32U && x < 48U && y >= 16U && y < 32U)
+          uint16_expected->data()[(y * 64U) + x] = 7U;
+      }
+
+  {
+    std::shared_ptr<TIFF> wtiff(TIFF::open(file, "w"));
+    wtiff->setSparseTiles(true);
+    wtiff->setRecordTileStatistics(true);
+    EXPECT_TRUE(wtiff->getRecordTileStatistics());
+    std::shared_ptr<IFD> wifd(wtiff->getCurrentDirectory());
+    wifd->setImageWidth(64U);
+    wifd->setImageHeight(48U);
+    wifd->setTileType(ome::files::tiff::TILE);
+    wifd->setTileWidth(16U);
+    wifd->setTileHeight(16U);
+    wifd->setPixelType(PT::UINT16);
+    wifd->setBitsPerSample(16U);
+    wifd->setSamplesPerPixel(1U);
+    wifd->setPlanarConfiguration(ome::files::tiff::CONTIG);
+    wifd->setPhotometricInterpretation(ome::files::tiff::MIN_IS_BLACK);
+    wifd->setCompression(ome::files::tiff::COMPRESSION_DEFLATE);
+    ASSERT_NO_THROW(wifd->writeImage(expected));
+    wtiff->writeCurrentDirectory();
+    wtiff->close();
+  }
+
+  std::shared_ptr<IOStatistics> stats(std::make_shared<IOStatistics>());
+  std::shared_ptr<TIFF> t(TIFF::open(file, "r"));
+  t->setStatistics(stats);
+  std::shared_ptr<IFD> ifd(t->getDirectoryByIndex(0));
+  ome::files::tiff::TileInfo info(ifd->getTileInfo());
+
+  ASSERT_EQ(12U, ifd->getTileStatistics()->size());
+
+  boost::optional<TileStatistics> tile0(info.tileStatistics(0U));
+  ASSERT_TRUE(!!tile0);
+  EXPECT_EQ(1.0, tile0->minimum);
+  EXPECT_EQ(31.0, tile0->maximum);
+  EXPECT_DOUBLE_EQ(16.0, tile0->mean);
+
+  boost::optional<TileStatistics> tile6(info.tileStatistics(6U));
+  ASSERT_TRUE(!!tile6);
+  EXPECT_EQ(7.0, tile6->minimum);
+  EXPECT_EQ(7.0, tile6->maximum);
+  EXPECT_EQ(7.0, tile6->mean);
+
+  // Empty tiles are elided, but still have statistics.
+  boost::optional<TileStatistics> tile11(info.tileStatistics(11U));
+  ASSERT_TRUE(!!tile11);
+  EXPECT_EQ(0.0, tile11->maximum);
+  EXPECT_FALSE(!!info.tileStatistics(12U));
+
+  PlaneRegion full(0, 0, 64, 48);
+  EXPECT_EQ(12U, info.tileCoverage(full, 0.0).size());
+  EXPECT_EQ((std::vector<dimension_size_type>{0U, 6U}), info.tileCoverage(full, 1.0));
+  EXPECT_EQ((std::vector<dimension_size_type>{0U}), info.tileCoverage(full, 8.0));
+  EXPECT_TRUE(info.tileCoverage(full, 32.0).empty());
+
+  // Pruning uses the recorded statistics only.
+  EXPECT_EQ(0U, stats->get(IOStatistics::TILES_DECODED));
+}
+
+TEST_F(TIFFTest, TileChecksums)
+{
+  using ome::files::IOStatistics;
+
+  boost::filesystem::path file(PROJECT_BINARY_DIR "/test/ome-files/data/tiff-tile-checksums.tiff");
+
+  std::array<VariantPixelBuffer::size_type, 9> shape;
+  shape[ome::files::DIM_SPATIAL_X] = 64;
+  shape[ome::files::DIM_SPATIAL_Y] = 48;
+  shape[ome::files::DIM_SUBCHANNEL] = 1;
+  shape[ome::files::DIM_SPATIAL_Z] = shape[ome::files::DIM_TEMPORAL_T] =
+    shape[ome::files::DIM_CHANNEL] = shape[ome::files::DIM_MODULO_Z] =
+    shape[ome::files::DIM_MODULO_T] = shape[ome::files::DIM_MODULO_C] = 1;
+
+  VariantPixelBuffer expected(shape, PT::UINT16);
+  std::shared_ptr<PixelBuffer<PixelProperties<PT::UINT16>::std_type>>& uint16_expected(boost::get<std::shared_ptr<PixelBuffer<PixelProperties<PT::UINT16>::std_type>>>(expected.vbuffer()));
+  for (dimension_size_type i = 0; i < uint16_expected->num_elements(); ++i)
+    uint16_expected->data()[i] = static_cast<uint16_t>((i * 37U) % 1021U);
+
+  // Uncompressed tiles and strips (the last strip is partial),
+  // including byte swapped data, are checksummed as stored.
+  for (const std::string mode : {"w", "wb"})
+    for (const auto type : {ome::files::tiff::TILE, ome::files::tiff::STRIP})
+      {
+        boost::filesystem::path ufile(PROJECT_BINARY_DIR "/test/ome-files/data/tiff-tile-checksums-none-" + mode +
+                                      (type == ome::files::tiff::TILE ? "-tile" : "-strip") + ".tiff");
+        {
+          std::shared_ptr<TIFF> wtiff(TIFF::open(ufile, mode));
+          wtiff->setRecordTileChecksums(true);
+          std::shared_ptr<IFD> wifd(wtiff->getCurrentDirectory());
+          wifd->setImageWidth(64U);
+          wifd->setImageHeight(48U);
+          wifd->setTileType(type);
+          wifd->setTileWidth(type == ome::files::tiff::TILE ? 16U : 64U);
+          wifd->setTileHeight(type == ome::files::tiff::TILE ? 16U : 20U);
+          wifd->setPixelType(PT::UINT16);
+          wifd->setBitsPerSample(16U);
+          wifd->setSamplesPerPixel(1U);
+          wifd->setPlanarConfiguration(ome::files::tiff::CONTIG);
+          wifd->setPhotometricInterpretation(ome::files::tiff::MIN_IS_BLACK);
+          wifd->setCompression(ome::files::tiff::COMPRESSION_NONE);
+          ASSERT_NO_THROW(wifd->writeImage(expected));
+          wtiff->writeCurrentDirectory();
+          wtiff->close();
+        }
+
+        std::shared_ptr<IOStatistics> stats(std::make_shared<IOStatistics>());
+        std::shared_ptr<TIFF> t(TIFF::open(ufile, "r"));
+        t->setStatistics(stats);
+        t->setVerifyTileChecksums(true);
+        std::shared_ptr<IFD> ifd(t->getDirectoryByIndex(0));
+
+        const dimension_size_type count = type == ome::files::tiff::TILE ? 12U : 3U;
+        std::shared_ptr<const std::vector<uint32_t>> checksums(ifd->getTileChecksums());
+        ASSERT_EQ(count, checksums->size());
+        for (const auto checksum : *checksums)
+          EXPECT_NE(0U, checksum);
+
+        VariantPixelBuffer observed;
+        ASSERT_NO_THROW(ifd->readImage(observed));
+        EXPECT_TRUE(expected == observed);
+        EXPECT_EQ(count, stats->get(IOStatistics::CHECKSUMS_VERIFIED));
+      }
+
+  // Tiles compressed by libtiff can not be checksummed.
+  {
+    boost::filesystem::path lfile(PROJECT_BINARY_DIR "/test/ome-files/data/tiff-tile-checksums-lzw.tiff");
+    std::shared_ptr<TIFF> wtiff(TIFF::open(lfile, "w"));
+    wtiff->setRecordTileChecksums(true);
+    std::shared_ptr<IFD> wifd(wtiff->getCurrentDirectory());
+    wifd->setImageWidth(64U);
+    wifd->setImageHeight(48U);
+    wifd->setTileType(ome::files::tiff::TILE);
+    wifd->setTileWidth(16U);
+    wifd->setTileHeight(16U);
+    wifd->setPixelType(PT::UINT16);
+    wifd->setBitsPerSample(16U);
+    wifd->setSamplesPerPixel(1U);
+    wifd->setPlanarConfiguration(ome::files::tiff::CONTIG);
+    wifd->setPhotometricInterpretation(ome::files::tiff::MIN_IS_BLACK);
+    wifd->setCompression(ome::files::tiff::COMPRESSION_LZW);
+    EXPECT_THROW(wifd->writeImage(expected), ome::files::tiff::Exception);
+  }
+
+  {
+    std::shared_ptr<TIFF> wtiff(TIFF::open(file, "w"));
+    wtiff->setRecordTileChecksums(true);
+    EXPECT_TRUE(wtiff->getRecordTileChecksums());
+    wtiff->setEncodeThreads(2U);
+    std::shared_ptr<IFD> wifd(wtiff->getCurrentDirectory());
+    wifd->setImageWidth(64U);
+    wifd->setImageHeight(48U);
+    wifd->setTileType(ome::files::tiff::TILE);
+    wifd->setTileWidth(16U);
+    wifd->setTileHeight(16U);
+    wifd->setPixelType(PT::UINT16);
+    wifd->setBitsPerSample(16U);
+    wifd->setSamplesPerPixel(1U);
+    wifd->setPlanarConfiguration(ome::files::tiff::CONTIG);
+    wifd->setPhotometricInterpretation(ome::files::tiff::MIN_IS_BLACK);
+    wifd->setCompression(ome::files::tiff::COMPRESSION_DEFLATE);
+    ASSERT_NO_THROW(wifd->writeImage(expected));
+    wtiff->writeCurrentDirectory();
+    wtiff->close();
+  }
+
+  ome::files::tiff::IOSource::range_type range;
+  {
+    std::shared_ptr<IOStatistics> stats(std::make_shared<IOStatistics>());
+    std::shared_ptr<TIFF> t(TIFF::open(file, "r"));
+    t->setStatistics(stats);
+    t->setVerifyTileChecksums(true);
+    std::shared_ptr<IFD> ifd(t->getDirectoryByIndex(0));
+
+    std::shared_ptr<const std::vector<uint32_t>> checksums(ifd->getTileChecksums());
+    ASSERT_EQ(12U, checksums->size());
+    for (const auto checksum : *checksums)
+      EXPECT_NE(0U, checksum);
+
+    VariantPixelBuffer observed;
+    ASSERT_NO_THROW(ifd->readImage(observed));
+    EXPECT_TRUE(expected == observed);
+    EXPECT_EQ(12U, stats->get(IOStatistics::CHECKSUMS_VERIFIED));
+
+    // The tile location is only available with an I/O source.
+    if (!ifd->getStrileReader())
+      return;
+    range = ifd->getStrileReader()->getRange(5U);
+    ASSERT_LT(0U, range.second);
+  }
+
+  // Corrupt a byte in the middle of tile 5.
+  {
+    std::fstream corrupt(file.string().c_str(), std::ios::in | std::ios::out | std::ios::binary);
+    corrupt.seekg(static_cast<std::streamoff>(range.first + (range.second / 2U)));
+    char byte = 0;
+    corrupt.read(&byte, 1);
+    byte = static_cast<char>(byte ^ 0x10);
+    corrupt.seekp(static_cast<std::streamoff>(range.first + (range.second / 2U)));
+    corrupt.write(&byte, 1);
+  }
+
+  std::shared_ptr<TIFF> t(TIFF::open(file, "r"));
+  t->setVerifyTileChecksums(true);
+  std::shared_ptr<IFD> ifd(t->getDirectoryByIndex(0));
+  VariantPixelBuffer observed;
+  // Tiles other than tile 5 are intact.
+  ASSERT_NO_THROW(ifd->readImage(observed, 0U, 0U, 16U, 16U));
+  EXPECT_THROW(ifd->readImage(observed, 16U, 16U, 16U, 16U), ome::files::tiff::Exception);
 }
 
-TEST_F(TIFFTest, ValueProxy)
+TEST_F(TIFFTest, WriteStorageOrder)
 {
-  std::shared_ptr<TIFF> t;
-  ASSERT_NO_THROW(t = TIFF::open(tiff_path, "r"));
-  ASSERT_TRUE(static_cast<bool>(t));
+  boost::filesystem::path file(PROJECT_BINARY_DIR "/test/ome-files/data/tiff-write-storage-order.tiff");
+
+  std::array<VariantPixelBuffer::size_type, 9> shape;
+  shape[ome::files::DIM_SPATIAL_X] = 40;
+  shape[ome::files::DIM_SPATIAL_Y] = 30;
+  shape[ome::files::DIM_SUBCHANNEL] = 3;
+  shape[ome::files::DIM_SPATIAL_Z] = shape[ome::files::DIM_TEMPORAL_T] =
+    shape[ome::files::DIM_CHANNEL] = shape[ome::files::DIM_MODULO_Z] =
+    shape[ome::files::DIM_MODULO_T] = shape[ome::files::DIM_MODULO_C] = 1;
+
+  // Interleaved, planar, and planar with Y varying fastest.
+  std::array<ome::files::PixelBufferBase::size_type, ome::files::PixelBufferBase::dimensions> ordering;
+  std::array<bool, ome::files::PixelBufferBase::dimensions> ascending;
+  ome::files::PixelBufferBase::storage_order_type planar(ome::files::PixelBufferBase::make_storage_order(ome::xml::model::enums::DimensionOrder::XYZTC, false));
+  for (ome::files::PixelBufferBase::size_type d = 0; d < ome::files::PixelBufferBase::dimensions; ++d)
+    {
+      ordering[d] = planar.ordering(d);
+      ascending[d] = planar.ascending(d);
+    }
+  std::swap(ordering[0], ordering[1]);
+  const std::array<ome::files::PixelBufferBase::storage_order_type, 3> orders
+    {{ ome::files::PixelBufferBase::make_storage_order(ome::xml::model::enums::DimensionOrder::XYZTC, true),
+       planar,
+       ome::files::PixelBufferBase::storage_order_type(ordering.begin(), ascending.begin()) }};
+
+  for (auto planarconfig : {ome::files::tiff::CONTIG, ome::files::tiff::SEPARATE})
+    for (const auto& order : orders)
+      {
+        VariantPixelBuffer source(shape, PT::UINT8, order);
+        std::shared_ptr<PixelBuffer<PixelProperties<PT::UINT8>::std_type>>& uint8_source(boost::get<std::shared_ptr<PixelBuffer<PixelProperties<PT::UINT8>::std_type>>>(source.vbuffer()));
+        PixelBuffer<PixelProperties<PT::UINT8>::std_type>::indices_type idx;
+        std::fill(idx.begin(), idx.end(), 0);
+        for (dimension_size_type s = 0; s < 3U; ++s)
+          for (dimension_size_type y = 0; y < 30U; ++y)
+            for (dimension_size_type x = 0; x < 40U; ++x)
+              {
+                idx[ome::files::DIM_SPATIAL_X] = x;
+                idx[ome::files::DIM_SPATIAL_Y] = y;
+                idx[ome::files::DIM_SUBCHANNEL] = s;
+                uint8_source->at(idx) = static_cast<uint8_t>((x * 3U) + (y * 7U) + (s * 50U));
+              }
 
-  std::shared_ptr<IFD> ifd;
-  ASSERT_NO_THROW(ifd = t->getDirectoryByIndex(0));
-  ASSERT_TRUE(static_cast<bool>(ifd));
+        {
+          std::shared_ptr<TIFF> wtiff(TIFF::open(file, "w"));
+          std::shared_ptr<IFD> wifd(wtiff->getCurrentDirectory());
+          wifd->setImageWidth(40U);
+          wifd->setImageHeight(30U);
+          wifd->setTileType(ome::files::tiff::TILE);
+          wifd->setTileWidth(16U);
+          wifd->setTileHeight(16U);
+          wifd->setPixelType(PT::UINT8);
+          wifd->setBitsPerSample(8U);
+          wifd->setSamplesPerPixel(3U);
+          wifd->setPlanarConfiguration(planarconfig);
+          wifd->setPhotometricInterpretation(ome::files::tiff::RGB);
+          // Samples are gathered from the source without
+          // reordering it into a temporary buffer.
+          ASSERT_NO_THROW(wifd->writeImage(source));
+          wtiff->writeCurrentDirectory();
+          wtiff->close();
+        }
 
-  std::string text;
-  ome::files::tiff::ValueProxy<std::string> d(text);
-  d = ifd->getField(ome::files::tiff::IMAGEDESCRIPTION);
+        std::shared_ptr<TIFF> t(TIFF::open(file, "r"));
+        std::shared_ptr<IFD> ifd(t->getDirectoryByIndex(0));
+        VariantPixelBuffer observed;
+        ASSERT_NO_THROW(ifd->readImage(observed));
+        EXPECT_TRUE(source == observed);
+      }
 }
 
-TEST_F(TIFFTest, Value)
+TEST_F(TIFFTest, PixelStatistics)
 {
-  std::shared_ptr<TIFF> t;
-  ASSERT_NO_THROW(t = TIFF::open(tiff_path, "r"));
-  ASSERT_TRUE(static_cast<bool>(t));
+  using ome::files::PixelStatistics;
+
+  boost::filesystem::path file(PROJECT_BINARY_DIR "/test/ome-files/data/tiff-pixel-statistics.tiff");
+
+  std::array<VariantPixelBuffer::size_type, 9> shape;
+  shape[ome::files::DIM_SPATIAL_X] = 40;
+  shape[ome::files::DIM_SPATIAL_Y] = 30;
+  shape[ome::files::DIM_SUBCHANNEL] = 2;
+  shape[ome::files::DIM_SPATIAL_Z] = shape[ome::files::DIM_TEMPORAL_T] =
+    shape[ome::files::DIM_CHANNEL] = shape[ome::files::DIM_MODULO_Z] =
+    shape[ome::files::DIM_MODULO_T] = shape[ome::files::DIM_MODULO_C] = 1;
+
+  VariantPixelBuffer source(shape, PT::UINT16);
+  std::shared_ptr<PixelBuffer<PixelProperties<PT::UINT16>::std_type>>& uint16_source(boost::get<std::shared_ptr<PixelBuffer<PixelProperties<PT::UINT16>::std_type>>>(source.vbuffer()));
+  PixelBuffer<PixelProperties<PT::UINT16>::std_type>::indices_type idx;
+  std::fill(idx.begin(), idx.end(), 0);
+  std::array<PixelStatistics::histogram_type, 2> expected;
+  for (auto& histogram : expected)
+    histogram.fill(0U);
+  for (dimension_size_type s = 0; s < 2U; ++s)
+    for (dimension_size_type y = 0; y < 30U; ++y)
+      for (dimension_size_type x = 0; x < 40U; ++x)
+        {
+          idx[ome::files::DIM_SPATIAL_X] = x;
+          idx[ome::files::DIM_SPATIAL_Y] = y;
+          idx[ome::files::DIM_SUBCHANNEL] = s;
+          uint16_t value = static_cast<uint16_t>(100U + (x * 1000U) + (y * 13U) + (s * 7U));
+          uint16_source->at(idx) = value;
+          ++expected[s][value >> 8];
+        }
 
-  std::shared_ptr<IFD> ifd;
-  ASSERT_NO_THROW(ifd = t->getDirectoryByIndex(0));
-  ASSERT_TRUE(static_cast<bool>(ifd));
+  for (auto planarconfig : {ome::files::tiff::CONTIG, ome::files::tiff::SEPARATE})
+    {
+      PixelStatistics written;
+      {
+        std::shared_ptr<TIFF> wtiff(TIFF::open(file, "w"));
+        std::shared_ptr<IFD> wifd(wtiff->getCurrentDirectory());
+        wifd->setImageWidth(40U);
+        wifd->setImageHeight(30U);
+        wifd->setTileType(ome::files::tiff::TILE);
+        wifd->setTileWidth(16U);
+        wifd->setTileHeight(16U);
+        wifd->setPixelType(PT::UINT16);
+        wifd->setBitsPerSample(16U);
+        wifd->setSamplesPerPixel(2U);
+        wifd->setPlanarConfiguration(planarconfig);
+        wifd->setPhotometricInterpretation(ome::files::tiff::MIN_IS_BLACK);
+        ASSERT_NO_THROW(wifd->writeImage(source, 0U, 0U, 40U, 30U, written));
+        wtiff->writeCurrentDirectory();
+        wtiff->close();
+      }
 
-  ome::files::tiff::Value<std::string> text;
-  text = ifd->getField(ome::files::tiff::IMAGEDESCRIPTION);
+      std::shared_ptr<TIFF> t(TIFF::open(file, "r"));
+      std::shared_ptr<IFD> ifd(t->getDirectoryByIndex(0));
+      VariantPixelBuffer observed;
+      PixelStatistics read;
+      ASSERT_NO_THROW(ifd->readImage(observed, 0U, 0U, 40U, 30U, read));
+      EXPECT_TRUE(source == observed);
+
+      for (const PixelStatistics *stats : {&written, &read})
+        {
+          ASSERT_EQ(2U, stats->getSampleCount());
+          ASSERT_TRUE(stats->hasHistogram());
+          for (dimension_size_type s = 0; s < 2U; ++s)
+            {
+              EXPECT_EQ(1200U, stats->getCount(s));
+              EXPECT_EQ(100.0 + (s * 7U), stats->getMinimum(s));
+              EXPECT_EQ(100.0 + 39000.0 + 377.0 + (s * 7U), stats->getMaximum(s));
+              EXPECT_TRUE(expected[s] == stats->getHistogram(s));
+            }
+        }
+    }
 }
 
-TEST_F(TIFFTest, FieldName)
+TEST_F(TIFFTest, ManyDirectories)
 {
-  std::shared_ptr<TIFF> t;
-  ASSERT_NO_THROW(t = TIFF::open(tiff_path, "r"));
-  ASSERT_TRUE(static_cast<bool>(t));
+  using ome::files::IOStatistics;
 
-  std::shared_ptr<IFD> ifd;
-  ASSERT_NO_THROW(ifd = t->getDirectoryByIndex(0));
-  ASSERT_TRUE(static_cast<bool>(ifd));
+  const dimension_size_type count = 500U;
 
-  std::string name;
-  name = ifd->getField(ome::files::tiff::IMAGEDESCRIPTION).name();
+  std::array<VariantPixelBuffer::size_type, 9> shape;
+  shape[ome::files::DIM_SPATIAL_X] = 8;
+  shape[ome::files::DIM_SPATIAL_Y] = 4;
+  shape[ome::files::DIM_SUBCHANNEL] = shape[ome::files::DIM_SPATIAL_Z] = shape[ome::files::DIM_TEMPORAL_T] =
+    shape[ome::files::DIM_CHANNEL] = shape[ome::files::DIM_MODULO_Z] =
+    shape[ome::files::DIM_MODULO_T] = shape[ome::files::DIM_MODULO_C] = 1;
 
-  ASSERT_EQ(std::string("ImageDescription"), name);
+  for (const std::string mode : {"w", "w8", "wb"})
+    {
+      boost::filesystem::path file(PROJECT_BINARY_DIR "/test/ome-files/data/tiff-many-directories-" + mode + ".tiff");
+
+      std::shared_ptr<IOStatistics> stats(std::make_shared<IOStatistics>());
+      {
+        std::shared_ptr<TIFF> wtiff(TIFF::open(file, mode));
+        wtiff->setStatistics(stats);
+        for (dimension_size_type i = 0U; i < count; ++i)
+          {
+            VariantPixelBuffer buf(shape, PT::UINT8);
+            std::fill(buf.array<uint8_t>().data(), buf.array<uint8_t>().data() + buf.num_elements(),
+                      static_cast<uint8_t>(i));
+            std::shared_ptr<IFD> wifd(wtiff->getCurrentDirectory());
+            wifd->setImageWidth(8U);
+            wifd->setImageHeight(4U);
+            wifd->setTileType(ome::files::tiff::STRIP);
+            wifd->setTileWidth(8U);
+            wifd->setTileHeight(4U);
+            wifd->setPixelType(PT::UINT8);
+            wifd->setBitsPerSample(8U);
+            wifd->setSamplesPerPixel(1U);
+            wifd->setPlanarConfiguration(ome::files::tiff::CONTIG);
+            wifd->setPhotometricInterpretation(ome::files::tiff::MIN_IS_BLACK);
+            ASSERT_NO_THROW(wifd->writeImage(buf));
+            ASSERT_NO_THROW(wtiff->writeCurrentDirectory());
+
+            // While writing, the first directory links directly to
+            // the last, so linking the next directory never searches
+            // more than two directories, whatever the libtiff version.
+            if (i == count / 2U)
+              {
+                std::shared_ptr<TIFF> partial(TIFF::open(file, "r"));
+                ASSERT_EQ(2U, partial->directoryCount());
+                VariantPixelBuffer last;
+                ASSERT_NO_THROW(partial->getDirectoryByIndex(1U)->readImage(last));
+                EXPECT_EQ(static_cast<uint8_t>(i), *last.array<uint8_t>().data());
+              }
+          }
+        wtiff->close();
+      }
+      EXPECT_EQ(count, stats->get(IOStatistics::DIRECTORIES_WRITTEN));
+
+      // Closing restores the link to the second directory, so every
+      // directory is linked in order.
+      std::shared_ptr<TIFF> t(TIFF::open(file, "r"));
+      ASSERT_EQ(count, t->directoryCount());
+      std::vector<ome::files::tiff::offset_type> offsets(t->getDirectoryOffsets());
+      EXPECT_TRUE(std::is_sorted(offsets.begin(), offsets.end()));
+      for (dimension_size_type i = 0U; i < count; ++i)
+        {
+          VariantPixelBuffer buf;
+          ASSERT_NO_THROW(t->getDirectoryByIndex(static_cast<directory_index_type>(i))->readImage(buf));
+          EXPECT_EQ(static_cast<uint8_t>(i), *buf.array<uint8_t>().data());
+        }
+    }
 }
 
-TEST_F(TIFFTest, FieldCount)
+TEST_F(TIFFTest, IFDTemplate)
 {
-  std::shared_ptr<TIFF> t;
-  ASSERT_NO_THROW(t = TIFF::open(tiff_path, "r"));
-  ASSERT_TRUE(static_cast<bool>(t));
+  using ome::files::tiff::IFDTemplate;
 
-  std::shared_ptr<IFD> ifd;
-  ASSERT_NO_THROW(ifd = t->getDirectoryByIndex(0));
-  ASSERT_TRUE(static_cast<bool>(ifd));
+  boost::filesystem::path file(PROJECT_BINARY_DIR "/test/ome-files/data/tiff-ifd-template.tiff");
 
-  std::string name;
-  bool count = ifd->getField(ome::files::tiff::IMAGEDESCRIPTION).passCount();
+  std::array<VariantPixelBuffer::size_type, 9> shape;
+  shape[ome::files::DIM_SPATIAL_X] = 48;
+  shape[ome::files::DIM_SPATIAL_Y] = 40;
+  shape[ome::files::DIM_SUBCHANNEL] = 3;
+  shape[ome::files::DIM_SPATIAL_Z] = shape[ome::files::DIM_TEMPORAL_T] =
+    shape[ome::files::DIM_CHANNEL] = shape[ome::files::DIM_MODULO_Z] =
+    shape[ome::files::DIM_MODULO_T] = shape[ome::files::DIM_MODULO_C] = 1;
 
-  ASSERT_FALSE(count);
+  VariantPixelBuffer buf(shape, PT::UINT16);
+  uint16_t *data = buf.array<uint16_t>().data();
+  for (VariantPixelBuffer::size_type i = 0; i < buf.num_elements(); ++i)
+    data[i] = static_cast<uint16_t>(i);
+
+  {
+    std::shared_ptr<TIFF> wtiff(TIFF::open(file, "w"));
+
+    std::shared_ptr<IFD> first(wtiff->getCurrentDirectory());
+    first->setImageWidth(48U);
+    first->setImageHeight(40U);
+    first->setTileType(ome::files::tiff::TILE);
+    first->setTileWidth(16U);
+    first->setTileHeight(16U);
+    first->setPixelType(PT::UINT16);
+    first->setBitsPerSample(16U);
+    first->setSamplesPerPixel(3U);
+    first->setPlanarConfiguration(ome::files::tiff::SEPARATE);
+    first->setPhotometricInterpretation(ome::files::tiff::RGB);
+    first->setCompression(ome::files::tiff::COMPRESSION_ADOBE_DEFLATE);
+    first->setCompressionLevel(1);
+    first->setPredictor(ome::files::tiff::HORIZONTAL);
+
+    IFDTemplate tmpl(first->getTemplate());
+    EXPECT_EQ(48U, tmpl.imageWidth);
+    EXPECT_EQ(40U, tmpl.imageHeight);
+    EXPECT_EQ(ome::files::tiff::TILE, tmpl.tileType);
+    EXPECT_EQ(16U, tmpl.tileWidth);
+    EXPECT_EQ(16U, tmpl.tileHeight);
+    EXPECT_EQ(PT::UINT16, tmpl.pixelType);
+    EXPECT_EQ(16U, tmpl.bitsPerSample);
+    EXPECT_EQ(3U, tmpl.samplesPerPixel);
+    EXPECT_EQ(ome::files::tiff::SEPARATE, tmpl.planarConfiguration);
+    EXPECT_EQ(ome::files::tiff::RGB, tmpl.photometricInterpretation);
+    EXPECT_EQ(ome::files::tiff::COMPRESSION_ADOBE_DEFLATE, tmpl.compression);
+    EXPECT_EQ(1, tmpl.compressionLevel);
+    EXPECT_EQ(ome::files::tiff::HORIZONTAL, tmpl.predictor);
+
+    ASSERT_NO_THROW(first->writeImage(buf));
+    ASSERT_NO_THROW(wtiff->writeCurrentDirectory());
+
+    std::shared_ptr<IFD> second(wtiff->getCurrentDirectory());
+    ASSERT_NO_THROW(second->applyTemplate(tmpl));
+    EXPECT_EQ(48U, second->getImageWidth());
+    EXPECT_EQ(16U, second->getTileHeight());
+    EXPECT_EQ(1, second->getCompressionLevel());
+    ASSERT_NO_THROW(second->writeImage(buf));
+    ASSERT_NO_THROW(wtiff->writeCurrentDirectory());
+    wtiff->close();
+  }
+
+  // Both directories have the same structure and content.
+  std::shared_ptr<TIFF> t(TIFF::open(file, "r"));
+  ASSERT_EQ(2U, t->directoryCount());
+  for (directory_index_type i = 0U; i < 2U; ++i)
+    {
+      std::shared_ptr<IFD> ifd(t->getDirectoryByIndex(i));
+      EXPECT_EQ(48U, ifd->getImageWidth());
+      EXPECT_EQ(40U, ifd->getImageHeight());
+      EXPECT_EQ(ome::files::tiff::TILE, ifd->getTileType());
+      EXPECT_EQ(16U, ifd->getTileWidth());
+      EXPECT_EQ(16U, ifd->getTileHeight());
+      EXPECT_EQ(PT::UINT16, ifd->getPixelType());
+      EXPECT_EQ(3U, ifd->getSamplesPerPixel());
+      EXPECT_EQ(ome::files::tiff::SEPARATE, ifd->getPlanarConfiguration());
+      EXPECT_EQ(ome::files::tiff::RGB, ifd->getPhotometricInterpretation());
+      EXPECT_EQ(ome::files::tiff::COMPRESSION_ADOBE_DEFLATE, ifd->getCompression());
+
+      VariantPixelBuffer rbuf;
+      ASSERT_NO_THROW(ifd->readImage(rbuf));
+      EXPECT_TRUE(buf == rbuf);
+    }
 }
 
-TEST_F(TIFFTest, PixelType)
+TEST_F(TIFFTest, ContiguousRead)
 {
-  std::shared_ptr<TIFF> t;
-  ASSERT_NO_THROW(t = TIFF::open(tiff_path, "r"));
-  ASSERT_TRUE(static_cast<bool>(t));
+  boost::filesystem::path file(PROJECT_BINARY_DIR "/test/ome-files/data/tiff-contiguous.tiff");
 
-  std::shared_ptr<IFD> ifd;
-  ASSERT_NO_THROW(ifd = t->getDirectoryByIndex(0));
-  ASSERT_TRUE(static_cast<bool>(ifd));
+  std::array<VariantPixelBuffer::size_type, 9> shape;
+  shape[ome::files::DIM_SPATIAL_X] = 32;
+  shape[ome::files::DIM_SPATIAL_Y] = 24;
+  shape[ome::files::DIM_SUBCHANNEL] = 3;
+  shape[ome::files::DIM_SPATIAL_Z] = shape[ome::files::DIM_TEMPORAL_T] =
+    shape[ome::files::DIM_CHANNEL] = shape[ome::files::DIM_MODULO_Z] =
+    shape[ome::files::DIM_MODULO_T] = shape[ome::files::DIM_MODULO_C] = 1;
 
-  ASSERT_EQ(PT::UINT8, ifd->getPixelType());
-  ASSERT_EQ(8U, ifd->getBitsPerSample());
+  for (auto planarconfig : {ome::files::tiff::CONTIG, ome::files::tiff::SEPARATE})
+    {
+      VariantPixelBuffer expected(shape, PT::UINT16,
+                                  ome::files::PixelBufferBase::make_storage_order(ome::xml::model::enums::DimensionOrder::XYZTC,
+                                                                                  planarconfig == ome::files::tiff::CONTIG));
+      std::shared_ptr<PixelBuffer<PixelProperties<PT::UINT16>::std_type>>& uint16_expected(boost::get<std::shared_ptr<PixelBuffer<PixelProperties<PT::UINT16>::std_type>>>(expected.vbuffer()));
+      for (dimension_size_type i = 0; i < uint16_expected->num_elements(); ++i)
+        uint16_expected->data()[i] = static_cast<uint16_t>(i * 7U);
+
+      {
+        std::shared_ptr<TIFF> wtiff(TIFF::open(file, "w"));
+        std::shared_ptr<IFD> wifd(wtiff->getCurrentDirectory());
+        wifd->setImageWidth(32U);
+        wifd->setImageHeight(24U);
+        wifd->setTileType(ome::files::tiff::STRIP);
+        wifd->setTileHeight(5U);
+        wifd->setPixelType(PT::UINT16);
+        wifd->setBitsPerSample(16U);
+        wifd->setSamplesPerPixel(3U);
+        wifd->setPlanarConfiguration(planarconfig);
+        wifd->setPhotometricInterpretation(ome::files::tiff::RGB);
+        wifd->setCompression(ome::files::tiff::COMPRESSION_NONE);
+        ASSERT_NO_THROW(wifd->writeImage(expected));
+        wtiff->writeCurrentDirectory();
+        wtiff->close();
+      }
+
+      std::shared_ptr<TIFF> t(TIFF::open(file, "r"));
+      if (!t->getSource())
+        continue; // Direct reads require an I/O source.
+      std::shared_ptr<IFD> ifd(t->getDirectoryByIndex(0));
+
+      // Uncompressed contiguous strips are read directly, without
+      // decoding any strips.
+      VariantPixelBuffer observed;
+      ASSERT_NO_THROW(ifd->readImage(observed));
+      EXPECT_TRUE(expected == observed);
+      EXPECT_EQ(0U, t->getStatistics()->get(ome::files::IOStatistics::TILES_DECODED));
+      EXPECT_LT(0U, t->getStatistics()->get(ome::files::IOStatistics::BYTES_READ));
+
+      // Regions, and single subchannels, from several threads.
+      std::vector<std::thread> readers;
+      std::vector<VariantPixelBuffer> regions(4);
+      std::vector<VariantPixelBuffer> samples(4);
+      for (dimension_size_type i = 0; i < regions.size(); ++i)
+        readers.push_back(std::thread([&, i]() {
+              ifd->readImage(regions[i], i, i * 2U, 20U, 9U);
+              if (planarconfig == ome::files::tiff::SEPARATE)
+                ifd->readImage(samples[i], i, i * 2U, 20U, 9U, i % 3U);
+            }));
+      for (auto& reader : readers)
+        reader.join();
+      EXPECT_EQ(0U, t->getStatistics()->get(ome::files::IOStatistics::TILES_DECODED));
+
+      std::shared_ptr<TIFF> decoded(TIFF::open(file, "rm"));
+      for (dimension_size_type i = 0; i < regions.size(); ++i)
+        {
+          VariantPixelBuffer region;
+          decoded->getDirectoryByIndex(0)->readImage(region, i, i * 2U, 20U, 9U);
+          EXPECT_TRUE(region == regions[i]);
+          if (planarconfig == ome::files::tiff::SEPARATE)
+            {
+              VariantPixelBuffer sample;
+              decoded->getDirectoryByIndex(0)->readImage(sample, i, i * 2U, 20U, 9U, i % 3U);
+              EXPECT_TRUE(sample == samples[i]);
+            }
+        }
+    }
 }
 
-TEST(TIFFCodec, ListCodecs)
+TEST_F(TIFFTest, Trace)
 {
-  // Note this list depends upon the codecs provided by libtiff, which
-  // can vary, so we don't attempt to validate specific codecs are
-  // present here.
+  using ome::files::TraceObserver;
 
-  std::vector<Codec> codecs = ome::files::tiff::getCodecs();
-  for (const auto& c: codecs)
-    {
-      std::cout << c.name << " = " << c.scheme << '\n';
-    }
+  std::shared_ptr<CountingObserver> observer(std::make_shared<CountingObserver>());
+  ome::files::setTraceObserver(observer);
+
+  VariantPixelBuffer buf;
+  {
+    std::shared_ptr<TIFF> t(TIFF::open(tiff_path, "r"));
+    std::shared_ptr<IFD> ifd(t->getDirectoryByIndex(0));
+    ASSERT_NO_THROW(ifd->readImage(buf));
+  }
+  ome::files::setTraceObserver(std::shared_ptr<TraceObserver>());
+
+  EXPECT_EQ(1U, observer->begun[TraceObserver::FILE_OPEN].load());
+  EXPECT_LT(0U, observer->begun[TraceObserver::DIRECTORY_READ].load());
+  EXPECT_LT(0U, observer->begun[TraceObserver::TILE_DECODE].load());
+  for (std::size_t i = 0; i < TraceObserver::event_count; ++i)
+    EXPECT_EQ(observer->begun[i].load(), observer->ended[i].load());
+
+  // No further events once unregistered.
+  {
+    std::shared_ptr<TIFF> t(TIFF::open(tiff_path, "r"));
+    ASSERT_NO_THROW(t->getDirectoryByIndex(0)->readImage(buf));
+  }
+  EXPECT_EQ(1U, observer->begun[TraceObserver::FILE_OPEN].load());
 }
 
 typedef std::tuple<uint32_t,uint32_t,PT,ome::files::tiff::PlanarConfiguration> plane_configuration;
@@ -1061,6 +3515,38 @@ TEST_P(TIFFVariantTest, TileInfo)
     ASSERT_EQ(ome::files::tiff::STRIP, info.tileType());
 }
 
+// Check that core tags are consistent when queried concurrently
+TEST_P(TIFFVariantTest, CoreTagsConcurrent)
+{
+  TileInfo info = ifd->getTileInfo();
+  PT pixeltype = ifd->getPixelType();
+
+  std::vector<std::thread> threads;
+  std::vector<int> ok(4, 0);
+  for (std::size_t t = 0; t < ok.size(); ++t)
+    threads.emplace_back([&, t]()
+      {
+        bool same = true;
+        for (int i = 0; i < 100; ++i)
+          {
+            TileInfo tinfo = ifd->getTileInfo();
+            same = same &&
+              ifd->getImageWidth() == iwidth &&
+              ifd->getImageHeight() == iheight &&
+              ifd->getPlanarConfiguration() == planarconfig &&
+              ifd->getPixelType() == pixeltype &&
+              tinfo.bufferSize() == info.bufferSize() &&
+              tinfo.tileCount() == info.tileCount();
+          }
+        ok[t] = same ? 1 : 0;
+      });
+  for (auto& thread : threads)
+    thread.join();
+
+  for (const auto& result : ok)
+    EXPECT_EQ(1, result);
+}
+
 // Check that the first tile matches the expected tile size
 TEST_P(TIFFVariantTest, TilePlaneRegion0)
 {
@@ -1136,6 +3622,42 @@ TEST_P(TIFFVariantTest, PlaneArea1)
       }
 }
 
+// Check tile ranges match the tile coverage, and tile indexes match
+// the tile regions.
+TEST_P(TIFFVariantTest, TileRange)
+{
+  const TIFFTestParameters& params = GetParam();
+  TileInfo info = ifd->getTileInfo();
+
+  PlaneRegion partial(16U, 16U, iwidth - 32U, iheight - 32U);
+  std::vector<dimension_size_type> tiles = info.tileCoverage(partial);
+  ome::files::tiff::TileRange range = info.tileRange(partial);
+  ASSERT_EQ(tiles.size(), range.size());
+  EXPECT_TRUE(std::equal(tiles.begin(), tiles.end(), range.begin()));
+
+  for (dimension_size_type i = 0; i < range.size(); ++i)
+    {
+      dimension_size_type tile = range[i];
+      PlaneRegion r = info.tileRegion(tile);
+      EXPECT_EQ(tile, info.tileIndex(r.x, r.y, info.tileSample(tile)));
+      EXPECT_EQ(tile, info.tileIndex(r.x + r.w - 1, r.y + r.h - 1, info.tileSample(tile)));
+    }
+
+  for (dimension_size_type s = 0; s < samples; ++s)
+    {
+      std::vector<dimension_size_type> expected;
+      for (const auto tile : tiles)
+        if (!params.imageplanar || info.tileSample(tile) == s)
+          expected.push_back(tile);
+
+      ome::files::tiff::TileRange srange = info.tileRange(partial, s);
+      ASSERT_EQ(expected.size(), srange.size());
+      EXPECT_TRUE(std::equal(expected.begin(), expected.end(), srange.begin()));
+    }
+
+  EXPECT_TRUE(info.tileRange(PlaneRegion(0U, 0U, 0U, 0U)).empty());
+}
+
 // Check tiling of multiple-of-16 subrange including edge overlaps
 // being correctly computed and all tiles being accounted for.
 TEST_P(TIFFVariantTest, PlaneArea2)
@@ -1262,6 +3784,170 @@ TEST_P(TIFFVariantTest, PlaneRead)
   read_test(iwidth, iheight, params.file, buf);
 }
 
+TEST_P(TIFFVariantTest, PlaneReadParallel)
+{
+  VariantPixelBuffer serial;
+  ASSERT_NO_THROW(ifd->readImage(serial));
+
+  tiff->setDecodeThreads(4U);
+  ASSERT_EQ(4U, tiff->getDecodeThreads());
+
+  VariantPixelBuffer parallel;
+  ASSERT_NO_THROW(ifd->readImage(parallel));
+  ASSERT_TRUE(serial == parallel);
+
+  // Repeat to reuse the cached read handles.
+  VariantPixelBuffer parallel2;
+  ASSERT_NO_THROW(ifd->readImage(parallel2, 3, 5, ifd->getImageWidth() - 3, ifd->getImageHeight() - 5));
+  VariantPixelBuffer serial2;
+  tiff->setDecodeThreads(1U);
+  ASSERT_NO_THROW(ifd->readImage(serial2, 3, 5, ifd->getImageWidth() - 3, ifd->getImageHeight() - 5));
+  ASSERT_TRUE(serial2 == parallel2);
+}
+
+TEST_P(TIFFVariantTest, PlaneReadFullWidth)
+{
+  VariantPixelBuffer full;
+  ASSERT_NO_THROW(ifd->readImage(full));
+
+  // Full-width regions allow whole tiles and strips (and truncated
+  // strips) to be decoded directly into the destination buffer.
+  dimension_size_type width = ifd->getImageWidth();
+  dimension_size_type height = ifd->getImageHeight();
+  const std::array<std::pair<dimension_size_type, dimension_size_type>, 3> rows
+    {{ {0U, height / 2U}, {height / 2U, height - (height / 2U)}, {3U, height - 8U} }};
+
+  for (const auto& r : rows)
+    {
+      VariantPixelBuffer vb;
+      ASSERT_NO_THROW(ifd->readImage(vb, 0U, r.first, width, r.second));
+
+      std::array<VariantPixelBuffer::size_type, 9> shape;
+      std::copy(vb.shape(), vb.shape() + shape.size(), shape.begin());
+      VariantPixelBuffer expected;
+      expected.setBuffer(shape, vb.pixelType(), vb.storage_order());
+      PixelSubrangeVisitor sv(0U, r.first);
+      boost::apply_visitor(sv, full.vbuffer(), expected.vbuffer());
+
+      EXPECT_TRUE(expected == vb);
+    }
+}
+
+TEST_P(TIFFVariantTest, PlaneReadStripRows)
+{
+  VariantPixelBuffer full;
+  ASSERT_NO_THROW(ifd->readImage(full));
+
+  // Small regions within strips read only the rows required, and
+  // regions starting within a tile or strip are offset correctly.
+  dimension_size_type width = ifd->getImageWidth();
+  dimension_size_type height = ifd->getImageHeight();
+  const std::array<PlaneRegion, 4> regions
+    {{ PlaneRegion(5U, 3U, 7U, 2U),
+       PlaneRegion(width / 2U, height / 2U, width / 4U, 1U),
+       PlaneRegion(0U, 1U, width, 3U),
+       PlaneRegion(1U, height - 3U, width - 2U, 3U) }};
+
+  for (const auto& r : regions)
+    {
+      VariantPixelBuffer vb;
+      ASSERT_NO_THROW(ifd->readImage(vb, r.x, r.y, r.w, r.h));
+
+      std::array<VariantPixelBuffer::size_type, 9> shape;
+      std::copy(vb.shape(), vb.shape() + shape.size(), shape.begin());
+      VariantPixelBuffer expected;
+      expected.setBuffer(shape, vb.pixelType(), vb.storage_order());
+      PixelSubrangeVisitor sv(r.x, r.y);
+      boost::apply_visitor(sv, full.vbuffer(), expected.vbuffer());
+
+      EXPECT_TRUE(expected == vb);
+    }
+}
+
+TEST_P(TIFFVariantTest, PlaneReadSubchannel)
+{
+  VariantPixelBuffer full;
+  ASSERT_NO_THROW(ifd->readImage(full));
+
+  dimension_size_type width = ifd->getImageWidth();
+  dimension_size_type height = ifd->getImageHeight();
+  PlaneRegion region(width / 4U, height / 3U, width / 2U, height / 2U);
+
+  for (dimension_size_type s = 0; s < ifd->getSamplesPerPixel(); ++s)
+    {
+      VariantPixelBuffer vb;
+      ASSERT_NO_THROW(ifd->readImage(vb, region.x, region.y, region.w, region.h, s));
+      EXPECT_EQ(1U, vb.shape()[ome::files::DIM_SUBCHANNEL]);
+
+      // Expected subchannel from the region of the full plane.
+      std::array<VariantPixelBuffer::size_type, 9> shape;
+      std::copy(full.shape(), full.shape() + shape.size(), shape.begin());
+      shape[ome::files::DIM_SPATIAL_X] = region.w;
+      shape[ome::files::DIM_SPATIAL_Y] = region.h;
+      VariantPixelBuffer subrange;
+      subrange.setBuffer(shape, full.pixelType(), full.storage_order());
+      PixelSubrangeVisitor sv(region.x, region.y);
+      boost::apply_visitor(sv, full.vbuffer(), subrange.vbuffer());
+
+      VariantPixelBuffer expected;
+      ome::files::detail::CopySubchannelVisitor cv(expected, s);
+      boost::apply_visitor(cv, subrange.vbuffer());
+
+      EXPECT_TRUE(expected == vb);
+    }
+
+  VariantPixelBuffer vb;
+  EXPECT_THROW(ifd->readImage(vb, ifd->getSamplesPerPixel()), ome::files::tiff::Exception);
+}
+
+TEST_P(TIFFVariantTest, PlaneReadStorageOrder)
+{
+  VariantPixelBuffer full;
+  ASSERT_NO_THROW(ifd->readImage(full));
+
+  dimension_size_type width = ifd->getImageWidth();
+  dimension_size_type height = ifd->getImageHeight();
+  const std::array<PlaneRegion, 3> regions
+    {{ PlaneRegion(0U, 0U, width, height),
+       PlaneRegion(0U, 3U, width, height / 2U),
+       PlaneRegion(width / 4U, height / 3U, width / 2U, height / 2U) }};
+
+  for (const auto& r : regions)
+    {
+      VariantPixelBuffer native;
+      ASSERT_NO_THROW(ifd->readImage(native, r.x, r.y, r.w, r.h));
+
+      // Interleaved and planar samples, and planar samples with Y
+      // varying fastest (column-major).
+      const std::array<ome::files::PixelBufferBase::storage_order_type, 3> orders
+        {{ ome::files::PixelBufferBase::make_storage_order(ome::xml::model::enums::DimensionOrder::XYZTC, true),
+           ome::files::PixelBufferBase::make_storage_order(ome::xml::model::enums::DimensionOrder::XYZTC, false),
+           ome::files::PixelBufferBase::make_storage_order(ome::xml::model::enums::DimensionOrder::XYZTC, false) }};
+
+      for (dimension_size_type i = 0; i < orders.size(); ++i)
+        {
+          ome::files::PixelBufferBase::storage_order_type order(orders[i]);
+          if (i == 2)
+            {
+              std::array<ome::files::PixelBufferBase::size_type, ome::files::PixelBufferBase::dimensions> ordering;
+              std::array<bool, ome::files::PixelBufferBase::dimensions> ascending;
+              for (ome::files::PixelBufferBase::size_type d = 0; d < ome::files::PixelBufferBase::dimensions; ++d)
+                {
+                  ordering[d] = order.ordering(d);
+                  ascending[d] = order.ascending(d);
+                }
+              std::swap(ordering[0], ordering[1]);
+              order = ome::files::PixelBufferBase::storage_order_type(ordering.begin(), ascending.begin());
+            }
+
+          VariantPixelBuffer vb;
+          ASSERT_NO_THROW(ifd->readImage(vb, r.x, r.y, r.w, r.h, order));
+          EXPECT_TRUE(order == vb.storage_order());
+          EXPECT_TRUE(native == vb);
+        }
+    }
+}
+
 TEST_P(TIFFVariantTest, PlaneReadAlignedTileOrdered)
 {
   TileInfo info = ifd->getTileInfo();
@@ -1503,6 +4189,12 @@ TEST_P(PixelTest, WriteTIFF)
     std::shared_ptr<TIFF> wtiff;
     ASSERT_NO_THROW(wtiff = TIFF::open(params.filename, "w"));
     ASSERT_TRUE(static_cast<bool>(wtiff));
+    // Unordered writes leave many tiles to be flushed together,
+    // so use these to exercise parallel encoding.
+    if (!params.ordered)
+      {
+        ASSERT_NO_THROW(wtiff->setEncodeThreads(4U));
+      }
     std::shared_ptr<IFD> wifd;
     ASSERT_NO_THROW(wifd = wtiff->getCurrentDirectory());
     ASSERT_TRUE(static_cast<bool>(wifd));
@@ -1582,6 +4274,10 @@ TEST_P(PixelTest, WriteTIFF)
         wifd->writeImage(vb, t.x, t.y, t.w, t.h);
       }
 
+    // Tiles are written as soon as covered, irrespective of the
+    // write order, so all tiles must have been written.
+    EXPECT_EQ(wifd->getTileInfo().tileCount(), wifd->getCurrentTile());
+
     wtiff->writeCurrentDirectory();
     wtiff->close();
   }
@@ -1632,6 +4328,124 @@ TEST_P(PixelTest, WriteTIFF)
 
 }
 
+TEST_P(PixelTest, WriteTIFFSubchannels)
+{
+  const PixelTestParameters& params = GetParam();
+  const VariantPixelBuffer& pixels(TIFFVariantTest::getPNGData(params.imagewidth,
+                                                               params.imageheight,
+                                                               params.pixeltype,
+                                                               params.planarconfig));
+  const VariantPixelBuffer::size_type *shape = pixels.shape();
+
+  // Write TIFF
+  {
+    std::shared_ptr<TIFF> wtiff;
+    ASSERT_NO_THROW(wtiff = TIFF::open(params.filename, "w"));
+    ASSERT_TRUE(static_cast<bool>(wtiff));
+    std::shared_ptr<IFD> wifd;
+    ASSERT_NO_THROW(wifd = wtiff->getCurrentDirectory());
+    ASSERT_TRUE(static_cast<bool>(wifd));
+
+    // Set IFD tags
+    ASSERT_NO_THROW(wifd->setImageWidth(shape[ome::files::DIM_SPATIAL_X]));
+    ASSERT_NO_THROW(wifd->setImageHeight(shape[ome::files::DIM_SPATIAL_Y]));
+    ASSERT_NO_THROW(wifd->setTileType(params.tiletype));
+    ASSERT_NO_THROW(wifd->setTileWidth(params.tilewidth));
+    ASSERT_NO_THROW(wifd->setTileHeight(params.tileheight));
+    ASSERT_NO_THROW(wifd->setPixelType(params.pixeltype));
+    ASSERT_NO_THROW(wifd->setBitsPerSample(significantBitsPerPixel(params.pixeltype)));
+    ASSERT_NO_THROW(wifd->setSamplesPerPixel(shape[ome::files::DIM_SUBCHANNEL]));
+    ASSERT_NO_THROW(wifd->setPlanarConfiguration(params.planarconfig));
+    ASSERT_NO_THROW(wifd->setPhotometricInterpretation(params.photometricinterp));
+    if(params.compression)
+      {
+        ASSERT_NO_THROW(wifd->setCompression(ome::files::tiff::getCodecScheme(*params.compression)));
+      }
+
+    PlaneRegion full(0, 0, wifd->getImageWidth(), wifd->getImageHeight());
+
+    dimension_size_type wtilewidth = params.tilewidth;
+    dimension_size_type wtileheight = params.tileheight;
+    if (!params.optimal)
+      {
+        wtilewidth = 5;
+        wtileheight = 7;
+      }
+
+    std::vector<PlaneRegion> tiles;
+    for (dimension_size_type x = 0; x < full.w; x+= wtilewidth)
+      for (dimension_size_type y = 0; y < full.h; y+= wtileheight)
+        {
+          PlaneRegion r = PlaneRegion(x, y, wtilewidth, wtileheight) & full;
+          tiles.push_back(r);
+        }
+
+    if (!params.ordered)
+      std::random_shuffle(tiles.begin(), tiles.end());
+
+    // Write each subchannel separately, last subchannel first.
+    for (dimension_size_type s = shape[ome::files::DIM_SUBCHANNEL]; s-- > 0;)
+      {
+        for (const auto& t : tiles)
+          {
+            std::array<VariantPixelBuffer::size_type, 9> shape;
+            shape[::ome::files::DIM_SPATIAL_X] = t.w;
+            shape[::ome::files::DIM_SPATIAL_Y] = t.h;
+            shape[::ome::files::DIM_SUBCHANNEL] = 3U;
+            shape[::ome::files::DIM_SPATIAL_Z] = shape[::ome::files::DIM_TEMPORAL_T] = shape[::ome::files::DIM_CHANNEL] =
+              shape[::ome::files::DIM_MODULO_Z] = shape[::ome::files::DIM_MODULO_T] = shape[::ome::files::DIM_MODULO_C] = 1;
+
+            ::ome::files::PixelBufferBase::storage_order_type order
+                (::ome::files::PixelBufferBase::make_storage_order(::ome::xml::model::enums::DimensionOrder::XYZTC,
+                                                                   params.planarconfig == ::ome::files::tiff::CONTIG));
+
+            VariantPixelBuffer vb;
+            vb.setBuffer(shape, params.pixeltype, order);
+
+            // Temporary subrange to write into tile
+            PixelSubrangeVisitor sv(t.x, t.y);
+            boost::apply_visitor(sv, pixels.vbuffer(), vb.vbuffer());
+
+            VariantPixelBuffer sb;
+            ome::files::detail::CopySubchannelVisitor cv(sb, s);
+            boost::apply_visitor(cv, vb.vbuffer());
+
+            wifd->writeImage(sb, t.x, t.y, t.w, t.h, s);
+          }
+
+        // Tiles with contiguous samples are incomplete until the
+        // last subchannel is written.
+        if (s && params.planarconfig == ::ome::files::tiff::CONTIG)
+          {
+            EXPECT_EQ(0U, wifd->getCurrentTile());
+          }
+      }
+
+    EXPECT_EQ(wifd->getTileInfo().tileCount(), wifd->getCurrentTile());
+
+    VariantPixelBuffer invalid;
+    EXPECT_THROW(wifd->writeImage(invalid, 0, 0, 1, 1, shape[ome::files::DIM_SUBCHANNEL]),
+                 ome::files::tiff::Exception);
+
+    wtiff->writeCurrentDirectory();
+    wtiff->close();
+  }
+
+  // Read and validate TIFF
+  {
+    std::shared_ptr<TIFF> tiff;
+    ASSERT_NO_THROW(tiff = TIFF::open(params.filename, "r"));
+    ASSERT_TRUE(static_cast<bool>(tiff));
+    std::shared_ptr<IFD> ifd;
+    ASSERT_NO_THROW(ifd = tiff->getDirectoryByIndex(0));
+    ASSERT_TRUE(static_cast<bool>(ifd));
+
+    VariantPixelBuffer vb;
+    ifd->readImage(vb);
+    EXPECT_TRUE(pixels == vb);
+  }
+}
+
 namespace
 {
 
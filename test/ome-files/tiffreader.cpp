@@ -36,9 +36,14 @@
  * #L%
  */
 
+#include <cstdint>
+#include <fstream>
 #include <stdexcept>
+#include <string>
 #include <vector>
 
+#include <boost/filesystem/path.hpp>
+
 #include <ome/files/VariantPixelBuffer.h>
 #include <ome/files/in/TIFFReader.h>
 
@@ -147,6 +152,123 @@ TEST_P(TIFFTest, openBytes)
     }
 }
 
+namespace
+{
+
+  // Write a 16-bit ImageJ stack with a single IFD and all planes
+  // stored contiguously after the image data of the first, as ImageJ
+  // does for stacks larger than 4 GiB.  Pixel values are
+  // (plane × 1000) + (y × width) + x.
+  void
+  writeContiguousStack(const boost::filesystem::path& file,
+                       bool                           bigendian,
+                       uint16_t                       width,
+                       uint16_t                       height)
+  {
+    const std::string desc("ImageJ=1.51s\nimages=6\nchannels=2\nslices=3\n");
+    const uint16_t entries = 10U;
+    const uint32_t descoffset = 8U + 2U + (entries * 12U) + 4U;
+    const uint32_t imageoffset = descoffset + static_cast<uint32_t>(desc.size()) + 1U;
+
+    std::vector<char> data;
+    auto put16 = [&](uint16_t v)
+      {
+        data.push_back(static_cast<char>(bigendian ? v >> 8 : v & 0xFFU));
+        data.push_back(static_cast<char>(bigendian ? v & 0xFFU : v >> 8));
+      };
+    auto put32 = [&](uint32_t v)
+      {
+        put16(static_cast<uint16_t>(bigendian ? v >> 16 : v & 0xFFFFU));
+        put16(static_cast<uint16_t>(bigendian ? v & 0xFFFFU : v >> 16));
+      };
+    auto entry = [&](uint16_t tag, uint16_t type, uint32_t count, uint32_t value)
+      {
+        put16(tag);
+        put16(type);
+        put32(count);
+        // SHORT values are left-justified in the value field.
+        if (type == 3U)
+          {
+            put16(static_cast<uint16_t>(value));
+            put16(0U);
+          }
+        else
+          put32(value);
+      };
+
+    data.push_back(bigendian ? 'M' : 'I');
+    data.push_back(bigendian ? 'M' : 'I');
+    put16(42U);
+    put32(8U);
+
+    put16(entries);
+    entry(256U, 3U, 1U, width);                         // ImageWidth
+    entry(257U, 3U, 1U, height);                        // ImageLength
+    entry(258U, 3U, 1U, 16U);                           // BitsPerSample
+    entry(259U, 3U, 1U, 1U);                            // Compression
+    entry(262U, 3U, 1U, 1U);                            // PhotometricInterpretation
+    entry(270U, 2U, static_cast<uint32_t>(desc.size()) + 1U, descoffset); // ImageDescription
+    entry(273U, 4U, 1U, imageoffset);                   // StripOffsets
+    entry(277U, 3U, 1U, 1U);                            // SamplesPerPixel
+    entry(278U, 3U, 1U, height);                        // RowsPerStrip
+    entry(279U, 4U, 1U, width * height * 2U);           // StripByteCounts
+    put32(0U);
+
+    data.insert(data.end(), desc.begin(), desc.end());
+    data.push_back('\0');
+
+    for (uint16_t p = 0; p < 6U; ++p)
+      for (uint16_t i = 0; i < width * height; ++i)
+        put16(static_cast<uint16_t>((p * 1000U) + i));
+
+    std::ofstream out(file.string().c_str(), std::ios::binary);
+    out.write(data.data(), static_cast<std::streamsize>(data.size()));
+  }
+
+}
+
+TEST(TIFFReaderImageJ, ContiguousStack)
+{
+  const uint16_t width = 7U;
+  const uint16_t height = 5U;
+
+  for (bool bigendian : {false, true})
+    {
+      boost::filesystem::path file(PROJECT_BINARY_DIR "/test/ome-files/data/tiffreader-imagej-contiguous.tiff");
+      writeContiguousStack(file, bigendian, width, height);
+
+      TIFFReader reader;
+      ASSERT_NO_THROW(reader.setId(file));
+
+      EXPECT_EQ(1U, reader.getSeriesCount());
+      EXPECT_EQ(6U, reader.getImageCount());
+      EXPECT_EQ(2U, reader.getSizeC());
+      EXPECT_EQ(3U, reader.getSizeZ());
+      EXPECT_EQ(1U, reader.getSizeT());
+
+      for (dimension_size_type p = 0; p < reader.getImageCount(); ++p)
+        {
+          VariantPixelBuffer buf;
+          ASSERT_NO_THROW(reader.openBytes(p, buf));
+          ASSERT_EQ(static_cast<dimension_size_type>(width * height), buf.num_elements());
+          const uint16_t *pixels = buf.data<uint16_t>();
+          for (dimension_size_type i = 0; i < buf.num_elements(); ++i)
+            EXPECT_EQ((p * 1000U) + i, pixels[i]);
+
+          VariantPixelBuffer region;
+          ASSERT_NO_THROW(reader.openBytes(p, region, 2, 1, 3, 2));
+          ASSERT_EQ(6U, region.num_elements());
+          pixels = region.data<uint16_t>();
+          for (dimension_size_type y = 0; y < 2U; ++y)
+            for (dimension_size_type x = 0; x < 3U; ++x)
+              EXPECT_EQ((p * 1000U) + ((y + 1U) * width) + x + 2U, pixels[(y * 3U) + x]);
+        }
+
+      VariantPixelBuffer buf;
+      EXPECT_THROW(reader.openBytes(6U, buf), std::logic_error);
+    }
+}
+
 namespace
 {
 
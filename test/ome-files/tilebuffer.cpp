@@ -40,7 +40,9 @@
 
 #include <ome/test/test.h>
 
+using ome::files::dimension_size_type;
 using ome::files::TileBuffer;
+using ome::files::TileBufferPool;
 
 TEST(TileBuffer, Construct)
 {
@@ -50,3 +52,80 @@ TEST(TileBuffer, Construct)
   for (int i =0; i < 50; ++i)
     ASSERT_EQ(0U, *(b.data()+i));
 }
+
+TEST(TileBuffer, Aligned)
+{
+  for (dimension_size_type size = 1; size < 4096; size = size * 3 + 1)
+    {
+      TileBuffer b(size);
+      ASSERT_EQ(size, b.size());
+      ASSERT_EQ(0U, reinterpret_cast<uintptr_t>(b.data()) % TileBuffer::alignment);
+    }
+}
+
+TEST(TileBuffer, HugePages)
+{
+  // Small buffers are allocated normally.
+  TileBuffer s(50, true);
+  ASSERT_EQ(50U, s.size());
+  ASSERT_EQ(0U, reinterpret_cast<uintptr_t>(s.data()) % TileBuffer::alignment);
+
+  const dimension_size_type size = 3U * 1024U * 1024U + 17U;
+  TileBuffer b(size, true);
+  ASSERT_EQ(size, b.size());
+  ASSERT_EQ(0U, reinterpret_cast<uintptr_t>(b.data()) % (2U * 1024U * 1024U));
+  for (dimension_size_type i = 0; i < size; i += 4096U)
+    ASSERT_EQ(0U, *(b.data()+i));
+  ASSERT_EQ(0U, *(b.data()+size-1));
+}
+TEST(TileBufferPool, Reuse)
+{
+  TileBufferPool p;
+
+  std::shared_ptr<TileBuffer> b1(p.get(50));
+  ASSERT_EQ(50U, b1->size());
+  const uint8_t *data = b1->data();
+  for (int i = 0; i < 50; ++i)
+    *(b1->data()+i) = 0xFFU;
+  b1.reset();
+  ASSERT_EQ(1U, p.size());
+
+  // Released buffers are reused, and zeroed.
+  std::shared_ptr<TileBuffer> b2(p.get(50));
+  ASSERT_EQ(data, b2->data());
+  ASSERT_EQ(0U, p.size());
+  for (int i = 0; i < 50; ++i)
+    ASSERT_EQ(0U, *(b2->data()+i));
+
+  // Different sizes are not reused.
+  std::shared_ptr<TileBuffer> b3(p.get(60));
+  ASSERT_EQ(60U, b3->size());
+  b2.reset();
+  b3.reset();
+  ASSERT_EQ(2U, p.size());
+
+  p.clear();
+  ASSERT_EQ(0U, p.size());
+}
+
+TEST(TileBufferPool, Limit)
+{
+  TileBufferPool p(100);
+
+  std::shared_ptr<TileBuffer> b1(p.get(60));
+  std::shared_ptr<TileBuffer> b2(p.get(60));
+  b1.reset();
+  b2.reset();
+  ASSERT_EQ(1U, p.size());
+}
+
+TEST(TileBufferPool, OutlivePool)
+{
+  std::shared_ptr<TileBuffer> b;
+  {
+    TileBufferPool p;
+    b = p.get(50);
+  }
+  ASSERT_EQ(50U, b->size());
+  b.reset();
+}
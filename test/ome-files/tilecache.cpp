@@ -133,3 +133,134 @@ TEST(TileCache, Clear)
   c.clear();
   ASSERT_EQ(0U, c.size());
 }
+
+TEST(TileCache, InsertNull)
+{
+  TileCache c;
+
+  ASSERT_FALSE(c.insert(4, std::shared_ptr<TileBuffer>()));
+  ASSERT_EQ(0U, c.size());
+  ASSERT_FALSE(static_cast<bool>(c.find(4)));
+}
+
+TEST(TileCache, Sparse)
+{
+  TileCache c;
+
+  ASSERT_TRUE(c.insert(1000, std::shared_ptr<TileBuffer>(new TileBuffer((64)))));
+  ASSERT_EQ(1U, c.size());
+  for (dimension_size_type i = 0; i < 1000; ++i)
+    ASSERT_FALSE(static_cast<bool>(c.find(i)));
+  ASSERT_TRUE(static_cast<bool>(c.find(1000)));
+  ASSERT_FALSE(static_cast<bool>(c.find(1001)));
+  ASSERT_FALSE(static_cast<bool>(c.find(100000)));
+
+  c.erase(100000);
+  c.erase(999);
+  ASSERT_EQ(1U, c.size());
+  c.erase(1000);
+  ASSERT_EQ(0U, c.size());
+}
+
+TEST(TileCache, LargeTileCount)
+{
+  const dimension_size_type ntiles = 200000;
+
+  // Touch, look up and flush every tile in order, as done by the
+  // writer for a whole image.
+  TileCache c;
+  std::shared_ptr<TileBuffer> buf(new TileBuffer((16)));
+  for (dimension_size_type i = 0; i < ntiles; ++i)
+    {
+      if (!c.find(i))
+        ASSERT_TRUE(c.insert(i, buf));
+      for (int r = 0; r < 4; ++r)
+        ASSERT_TRUE(static_cast<bool>(c.find(i)));
+      // Flush the tile from the previous row of tiles.
+      if (i >= 512)
+        {
+          c.erase(i - 512);
+          ASSERT_FALSE(static_cast<bool>(c.find(i - 512)));
+        }
+    }
+
+  ASSERT_EQ(512U, c.size());
+}
+
+TEST(TileCache, Spill)
+{
+  TileCache c;
+  c.setMaxMemory(4U * 1024U);
+  EXPECT_EQ(4U * 1024U, c.getMaxMemory());
+
+  // Fill each tile with its index, so restored tiles may be checked.
+  for (dimension_size_type i = 0; i < 16; ++i)
+    {
+      std::shared_ptr<TileBuffer> buf(std::make_shared<TileBuffer>(1024U));
+      std::fill(buf->data(), buf->data() + buf->size(), static_cast<uint8_t>(i));
+      ASSERT_TRUE(c.insert(i, buf));
+      EXPECT_LE(c.memory(), c.getMaxMemory());
+    }
+
+  ASSERT_EQ(16U, c.size());
+  EXPECT_EQ(12U, c.spilled());
+
+  for (dimension_size_type i = 0; i < 16; ++i)
+    {
+      const TileCache& cc(c);
+      TileCache::value_type cbuf(cc.find(i));
+      ASSERT_TRUE(static_cast<bool>(cbuf));
+      EXPECT_EQ(static_cast<uint8_t>(i), cbuf->data()[1023]);
+
+      TileCache::value_type buf(c.find(i));
+      ASSERT_TRUE(static_cast<bool>(buf));
+      ASSERT_EQ(1024U, buf->size());
+      EXPECT_EQ(static_cast<uint8_t>(i), buf->data()[0]);
+      EXPECT_EQ(static_cast<uint8_t>(i), buf->data()[1023]);
+      EXPECT_LE(c.memory(), c.getMaxMemory());
+    }
+
+  ASSERT_EQ(16U, c.size());
+  EXPECT_EQ(12U, c.spilled());
+
+  for (dimension_size_type i = 0; i < 16; ++i)
+    c.erase(i);
+  EXPECT_EQ(0U, c.size());
+  EXPECT_EQ(0U, c.spilled());
+  EXPECT_EQ(0U, c.memory());
+}
+
+TEST(TileCache, SpillIndexOperator)
+{
+  TileCache c;
+  c.setMaxMemory(2U * 1024U);
+
+  // Modify tiles in several passes, as for a writer.
+  for (dimension_size_type pass = 0; pass < 4; ++pass)
+    for (dimension_size_type i = 0; i < 8; ++i)
+      {
+        TileCache::value_type& buf(c[i]);
+        if (!buf)
+          {
+            buf = std::make_shared<TileBuffer>(1024U);
+            std::fill(buf->data(), buf->data() + buf->size(), 0U);
+          }
+        buf->data()[pass] = static_cast<uint8_t>(i + pass);
+      }
+
+  EXPECT_EQ(8U, c.size());
+  EXPECT_GT(c.spilled(), 0U);
+  EXPECT_LE(c.memory(), c.getMaxMemory() + 1024U);
+
+  for (dimension_size_type i = 0; i < 8; ++i)
+    {
+      TileCache::value_type buf(c.find(i));
+      ASSERT_TRUE(static_cast<bool>(buf));
+      for (dimension_size_type pass = 0; pass < 4; ++pass)
+        EXPECT_EQ(static_cast<uint8_t>(i + pass), buf->data()[pass]);
+    }
+
+  c.clear();
+  EXPECT_EQ(0U, c.size());
+  EXPECT_EQ(0U, c.spilled());
+}
@@ -207,3 +207,50 @@ TEST(TileCoverage, CoverageIncomplete1)
   ASSERT_EQ(16U * 16U, c.coverage(r));
   ASSERT_TRUE(c.covered(r));
 }
+
+// Tile grid with whole tiles, tile rows and ragged regions
+TEST(TileCoverage, Grid)
+{
+  TileCoverage c;
+  c.setGrid(100, 50, 32, 32);
+
+  // Whole tile
+  PlaneRegion t1(0, 0, 32, 32);
+  ASSERT_TRUE(c.insert(t1));
+  ASSERT_FALSE(c.insert(t1));
+  ASSERT_EQ(1U, c.size());
+  ASSERT_TRUE(c.covered(t1));
+  ASSERT_EQ(32U * 32U, c.coverage(t1));
+
+  // Edge tile, in rows
+  PlaneRegion t2(96, 32, 4, 18);
+  ASSERT_TRUE(c.insert(PlaneRegion(96, 32, 4, 10)));
+  ASSERT_FALSE(c.covered(t2));
+  ASSERT_EQ(4U * 10U, c.coverage(t2));
+  ASSERT_TRUE(c.insert(PlaneRegion(96, 42, 4, 8)));
+  ASSERT_TRUE(c.covered(t2));
+  ASSERT_EQ(2U, c.size());
+
+  // Ragged region overlapping the grid is rejected
+  ASSERT_FALSE(c.insert(PlaneRegion(16, 16, 32, 32)));
+  // Ragged region alongside the grid
+  PlaneRegion r(32, 0, 16, 32);
+  ASSERT_TRUE(c.insert(r));
+  ASSERT_EQ(3U, c.size());
+  PlaneRegion area(0, 0, 64, 32);
+  ASSERT_EQ(48U * 32U, c.coverage(area));
+  ASSERT_FALSE(c.covered(area));
+  ASSERT_TRUE(c.insert(PlaneRegion(48, 0, 16, 32)));
+  ASSERT_TRUE(c.covered(area));
+
+  // Grid rows overlapping ragged regions are rejected
+  ASSERT_FALSE(c.insert(PlaneRegion(32, 0, 32, 4)));
+
+  ASSERT_TRUE(c.remove(t1));
+  ASSERT_FALSE(c.covered(t1));
+  ASSERT_EQ(0U, c.coverage(t1));
+
+  c.clear();
+  ASSERT_EQ(0U, c.size());
+  ASSERT_FALSE(c.covered(t2));
+}
@@ -0,0 +1,191 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2014 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+#include <array>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include <boost/filesystem/path.hpp>
+
+#include <ome/files/CoreMetadata.h>
+#include <ome/files/MetadataTools.h>
+#include <ome/files/TiledPlaneView.h>
+#include <ome/files/VariantPixelBuffer.h>
+#include <ome/files/in/OMETIFFReader.h>
+#include <ome/files/out/OMETIFFWriter.h>
+
+#include <ome/xml/meta/OMEXMLMetadata.h>
+
+#include <ome/test/test.h>
+
+using boost::filesystem::path;
+using ome::files::CoreMetadata;
+using ome::files::TiledPlaneView;
+using ome::files::VariantPixelBuffer;
+using ome::files::dimension_size_type;
+using ome::files::in::OMETIFFReader;
+using ome::files::out::OMETIFFWriter;
+using ome::xml::model::enums::PixelType;
+
+namespace
+{
+
+  const dimension_size_type sizeX = 300U;
+  const dimension_size_type sizeY = 200U;
+
+  uint16_t
+  expected(dimension_size_type x,
+           dimension_size_type y,
+           dimension_size_type plane)
+  {
+    return static_cast<uint16_t>((y * sizeX + x) * 3U + plane * 1000U);
+  }
+
+  // Write a two-plane 300×200 image with 64×64 tiles.
+  path
+  writeFile()
+  {
+    const path file(PROJECT_BINARY_DIR "/test/ome-files/data/tiledplaneview.ome.tiff");
+
+    std::shared_ptr<CoreMetadata> c(std::make_shared<CoreMetadata>());
+    c->sizeX = sizeX;
+    c->sizeY = sizeY;
+    c->sizeZ = 2;
+    c->sizeC.clear();
+    c->sizeC.push_back(1);
+    c->pixelType = PixelType::UINT16;
+    c->imageCount = 2;
+    c->orderCertain = true;
+    c->interleaved = false;
+    std::vector<std::shared_ptr<CoreMetadata>> seriesList(1, c);
+
+    std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> meta(std::make_shared<::ome::xml::meta::OMEXMLMetadata>());
+    ome::files::fillMetadata(*meta, seriesList);
+
+    OMETIFFWriter writer;
+    writer.setMetadataRetrieve(meta);
+    writer.setTileSizeX(64);
+    writer.setTileSizeY(64);
+    writer.setId(file);
+
+    std::array<VariantPixelBuffer::size_type, 9> shape;
+    shape.fill(1U);
+    shape[ome::files::DIM_SPATIAL_X] = sizeX;
+    shape[ome::files::DIM_SPATIAL_Y] = sizeY;
+    for (dimension_size_type p = 0U; p < 2U; ++p)
+      {
+        VariantPixelBuffer buf(shape, PixelType::UINT16);
+        uint16_t *data = buf.array<uint16_t>().data();
+        for (dimension_size_type y = 0U; y < sizeY; ++y)
+          for (dimension_size_type x = 0U; x < sizeX; ++x)
+            data[y * sizeX + x] = expected(x, y, p);
+        writer.saveBytes(p, buf);
+      }
+    writer.close();
+
+    return file;
+  }
+
+}
+
+TEST(TiledPlaneView, SparseAccess)
+{
+  const path file(writeFile());
+  std::shared_ptr<OMETIFFReader> reader(std::make_shared<OMETIFFReader>());
+  ASSERT_NO_THROW(reader->setId(file));
+
+  TiledPlaneView<uint16_t> view(reader, 1U);
+  EXPECT_EQ(sizeX, view.getSizeX());
+  EXPECT_EQ(sizeY, view.getSizeY());
+  EXPECT_EQ(64U, view.getTileWidth());
+  EXPECT_EQ(64U, view.getTileHeight());
+  EXPECT_EQ(0U, view.getDecodedTileCount());
+
+  // Only the tiles visited are decoded.
+  EXPECT_EQ(expected(10, 10, 1), view.at(10, 10));
+  EXPECT_EQ(expected(63, 63, 1), view.at(63, 63));
+  EXPECT_EQ(1U, view.getDecodedTileCount());
+  EXPECT_EQ(expected(299, 199, 1), view.at(299, 199));
+  EXPECT_EQ(2U, view.getDecodedTileCount());
+
+  TiledPlaneView<uint16_t>::indices_type idx;
+  idx.fill(0);
+  idx[ome::files::DIM_SPATIAL_X] = 150;
+  idx[ome::files::DIM_SPATIAL_Y] = 5;
+  EXPECT_EQ(expected(150, 5, 1), view.at(idx));
+  EXPECT_EQ(3U, view.getDecodedTileCount());
+
+  // A row crossing tiles.
+  std::vector<uint16_t> row(100U);
+  view.row(70U, 30U, 100U, row.data());
+  for (dimension_size_type x = 0U; x < 100U; ++x)
+    ASSERT_EQ(expected(x + 30U, 70U, 1), row[x]);
+  EXPECT_EQ(5U, view.getDecodedTileCount());
+
+  EXPECT_THROW(view.at(300, 0), std::out_of_range);
+  EXPECT_THROW(view.at(0, 200), std::out_of_range);
+  EXPECT_THROW(view.row(0U, 250U, 51U, row.data()), std::out_of_range);
+}
+
+TEST(TiledPlaneView, Eviction)
+{
+  const path file(writeFile());
+  std::shared_ptr<OMETIFFReader> reader(std::make_shared<OMETIFFReader>());
+  ASSERT_NO_THROW(reader->setId(file));
+
+  // Retain a single tile.
+  TiledPlaneView<uint16_t> view(reader, 0U, 1U);
+  EXPECT_EQ(expected(0, 0, 0), view.at(0, 0));
+  EXPECT_EQ(expected(100, 0, 0), view.at(100, 0));
+  EXPECT_EQ(expected(1, 1, 0), view.at(1, 1));
+  EXPECT_EQ(3U, view.getDecodedTileCount());
+}
+
+TEST(TiledPlaneView, Invalid)
+{
+  const path file(writeFile());
+  std::shared_ptr<OMETIFFReader> reader(std::make_shared<OMETIFFReader>());
+  ASSERT_NO_THROW(reader->setId(file));
+
+  EXPECT_THROW(TiledPlaneView<uint16_t>(reader, 2U), std::logic_error);
+
+  // Pixel type mismatch.
+  TiledPlaneView<uint8_t> view(reader, 0U);
+  EXPECT_THROW(view.at(0, 0), std::logic_error);
+}
@@ -0,0 +1,313 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2016 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+// Tiling benchmark.  This sweeps the image, pixel and tile (or strip)
+// sizes modelled by docs/sphinx/plots/tiling.R through OMETIFFWriter
+// and OMETIFFReader, and writes the file size, write time, full plane
+// read time and random region read time for each case as CSV, for
+// use by tiling.R.  The sweep is configurable, since the full range
+// of image sizes used by the plots (up to 131072×131072) requires
+// very large amounts of memory and storage.
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+
+#include <ome/files/CoreMetadata.h>
+#include <ome/files/MetadataTools.h>
+#include <ome/files/VariantPixelBuffer.h>
+#include <ome/files/in/OMETIFFReader.h>
+#include <ome/files/out/OMETIFFWriter.h>
+
+#include <ome/xml/meta/OMEXMLMetadata.h>
+
+namespace opt = boost::program_options;
+
+using ome::files::dimension_size_type;
+using ome::files::CoreMetadata;
+using ome::files::VariantPixelBuffer;
+using ome::files::in::OMETIFFReader;
+using ome::files::out::OMETIFFWriter;
+using ome::xml::model::enums::PixelType;
+
+namespace
+{
+
+  // Time a function (milliseconds).
+  template<typename F>
+  double
+  time(F func)
+  {
+    auto start = std::chrono::steady_clock::now();
+    func();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+  }
+
+  // Pixel type for a pixel size (bytes).
+  PixelType
+  pixelTypeForSize(dimension_size_type size)
+  {
+    switch(size)
+      {
+      case 1U:
+        return PixelType::UINT8;
+      case 2U:
+        return PixelType::UINT16;
+      case 4U:
+        return PixelType::FLOAT;
+      case 8U:
+        return PixelType::DOUBLE;
+      case 16U:
+        return PixelType::COMPLEXDOUBLE;
+      default:
+        throw std::logic_error("Invalid pixel size (must be 1, 2, 4, 8 or 16)");
+      }
+  }
+
+  // Sizes from minimum to maximum (inclusive) with the given step.
+  std::vector<dimension_size_type>
+  sizeRange(dimension_size_type minimum,
+            dimension_size_type maximum,
+            dimension_size_type step)
+  {
+    if (!step)
+      throw std::logic_error("Size step must be positive");
+
+    std::vector<dimension_size_type> sizes;
+    for (dimension_size_type size = minimum; size <= maximum; size += step)
+      sizes.push_back(size);
+    return sizes;
+  }
+
+  // Benchmark settings.
+  struct Settings
+  {
+    std::vector<dimension_size_type> imagesizes;
+    std::vector<dimension_size_type> pixelsizes;
+    std::vector<dimension_size_type> tilesizes;
+    std::vector<dimension_size_type> stripsizes;
+    dimension_size_type              regions;
+    dimension_size_type              regionsize;
+    boost::filesystem::path          dir;
+  };
+
+  // Write and read a single image, and write the results as a row of
+  // CSV.
+  void
+  benchmark(std::ostream&             csv,
+            const Settings&           settings,
+            const VariantPixelBuffer& pixels,
+            dimension_size_type       imagesize,
+            dimension_size_type       pixelsize,
+            bool                      tiled,
+            dimension_size_type       tilesize)
+  {
+    boost::filesystem::path file(settings.dir / "tiling-benchmark.ome.tiff");
+    if (boost::filesystem::exists(file))
+      boost::filesystem::remove(file);
+
+    std::shared_ptr<CoreMetadata> core(std::make_shared<CoreMetadata>());
+    core->sizeX = imagesize;
+    core->sizeY = imagesize;
+    core->pixelType = pixels.pixelType();
+    std::vector<std::shared_ptr<CoreMetadata>> seriesList(1U, core);
+
+    std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> meta(std::make_shared<::ome::xml::meta::OMEXMLMetadata>());
+    ome::files::fillMetadata(*meta, seriesList);
+    std::shared_ptr<::ome::xml::meta::MetadataRetrieve> retrieve(std::static_pointer_cast<::ome::xml::meta::MetadataRetrieve>(meta));
+
+    double writetime = time([&]()
+                            {
+                              OMETIFFWriter writer;
+                              writer.setMetadataRetrieve(retrieve);
+                              writer.setInterleaved(false);
+                              if (tiled)
+                                writer.setTileSizeX(tilesize);
+                              writer.setTileSizeY(tilesize);
+                              writer.setId(file);
+                              writer.saveBytes(0U, pixels);
+                              writer.close();
+                            });
+    dimension_size_type tilecount;
+    if (tiled)
+      tilecount = ((imagesize + tilesize - 1U) / tilesize) * ((imagesize + tilesize - 1U) / tilesize);
+    else
+      tilecount = (imagesize + tilesize - 1U) / tilesize;
+
+    OMETIFFReader reader;
+    reader.setId(file);
+
+    VariantPixelBuffer buf;
+    double readtime = time([&]()
+                           {
+                             reader.openBytes(0U, buf);
+                           });
+
+    // Random regions, using a fixed seed for reproducibility.
+    dimension_size_type regionsize = std::min(settings.regionsize, imagesize);
+    std::mt19937 generator(42U);
+    std::uniform_int_distribution<dimension_size_type> position(0U, imagesize - regionsize);
+    double regiontime = 0.0;
+    for (dimension_size_type i = 0U; i < settings.regions; ++i)
+      {
+        dimension_size_type x = position(generator);
+        dimension_size_type y = position(generator);
+        regiontime += time([&]()
+                           {
+                             reader.openBytes(0U, buf, x, y, regionsize, regionsize);
+                           });
+      }
+    if (settings.regions)
+      regiontime /= static_cast<double>(settings.regions);
+
+    reader.close();
+
+    csv << (tiled ? "tile" : "strip") << ','
+        << imagesize << ','
+        << pixelsize << ','
+        << tilesize << ','
+        << tilecount << ','
+        << boost::filesystem::file_size(file) << ','
+        << writetime << ','
+        << readtime << ','
+        << regionsize << ','
+        << regiontime << '\n';
+    csv.flush();
+
+    boost::filesystem::remove(file);
+  }
+
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  try
+    {
+      Settings settings;
+      dimension_size_type tilemin, tilemax, tilestep;
+      dimension_size_type stripmin, stripmax, stripstep;
+      std::string output;
+      std::string dir;
+
+      opt::options_description options("Options");
+      options.add_options()
+        ("help,h", "Show help options")
+        ("image-sizes", opt::value<std::vector<dimension_size_type>>(&settings.imagesizes)->multitoken()->default_value(std::vector<dimension_size_type>(1U, 4096U), "4096"),
+         "Image sizes (width and height)")
+        ("pixel-sizes", opt::value<std::vector<dimension_size_type>>(&settings.pixelsizes)->multitoken()->default_value(std::vector<dimension_size_type>{1U, 2U, 4U, 8U, 16U}, "1 2 4 8 16"),
+         "Pixel sizes (bytes)")
+        ("tile-min", opt::value<dimension_size_type>(&tilemin)->default_value(16U), "Minimum tile size")
+        ("tile-max", opt::value<dimension_size_type>(&tilemax)->default_value(2064U), "Maximum tile size")
+        ("tile-step", opt::value<dimension_size_type>(&tilestep)->default_value(128U), "Tile size step (multiple of 16)")
+        ("strip-min", opt::value<dimension_size_type>(&stripmin)->default_value(1U), "Minimum strip size (rows)")
+        ("strip-max", opt::value<dimension_size_type>(&stripmax)->default_value(257U), "Maximum strip size (rows)")
+        ("strip-step", opt::value<dimension_size_type>(&stripstep)->default_value(16U), "Strip size step (rows)")
+        ("regions", opt::value<dimension_size_type>(&settings.regions)->default_value(20U), "Number of random regions to read")
+        ("region-size", opt::value<dimension_size_type>(&settings.regionsize)->default_value(512U), "Random region size")
+        ("dir", opt::value<std::string>(&dir)->default_value("."), "Directory for temporary image files")
+        ("output", opt::value<std::string>(&output), "Output CSV file");
+
+      opt::positional_options_description positional;
+      positional.add("output", 1);
+
+      opt::variables_map vm;
+      opt::store(opt::command_line_parser(argc, argv).options(options).positional(positional).run(), vm);
+      opt::notify(vm);
+
+      if (vm.count("help") || output.empty())
+        {
+          std::cout << "Usage: " << argv[0] << " [options] output.csv\n\n" << options << '\n';
+          return vm.count("help") ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+
+      settings.tilesizes = sizeRange(tilemin, tilemax, tilestep);
+      settings.stripsizes = sizeRange(stripmin, stripmax, stripstep);
+      settings.dir = dir;
+
+      std::ofstream csv(output.c_str());
+      if (!csv)
+        throw std::runtime_error(std::string("Failed to open ") + output);
+      csv << "layout,image.size,pixel.size,tile.size,tile.count,file.size,"
+          << "write.time,read.time,region.size,region.read.time\n";
+
+      for (const auto imagesize : settings.imagesizes)
+        for (const auto pixelsize : settings.pixelsizes)
+          {
+            std::array<VariantPixelBuffer::size_type, 9> shape;
+            shape[ome::files::DIM_SPATIAL_X] = shape[ome::files::DIM_SPATIAL_Y] = imagesize;
+            shape[ome::files::DIM_SUBCHANNEL] = shape[ome::files::DIM_SPATIAL_Z] = shape[ome::files::DIM_TEMPORAL_T] =
+              shape[ome::files::DIM_CHANNEL] = shape[ome::files::DIM_MODULO_Z] = shape[ome::files::DIM_MODULO_T] =
+              shape[ome::files::DIM_MODULO_C] = 1;
+            VariantPixelBuffer pixels(shape, pixelTypeForSize(pixelsize));
+
+            for (const auto tilesize : settings.tilesizes)
+              {
+                std::cout << imagesize << "×" << imagesize << ' ' << pixelsize * 8U
+                          << "-bit, " << tilesize << "×" << tilesize << " tiles" << std::endl;
+                benchmark(csv, settings, pixels, imagesize, pixelsize, true, tilesize);
+              }
+            for (const auto stripsize : settings.stripsizes)
+              {
+                std::cout << imagesize << "×" << imagesize << ' ' << pixelsize * 8U
+                          << "-bit, " << stripsize << " row strips" << std::endl;
+                benchmark(csv, settings, pixels, imagesize, pixelsize, false, stripsize);
+              }
+          }
+    }
+  catch (const std::exception& e)
+    {
+      std::cerr << "Error: " << e.what() << std::endl;
+      return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,169 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * Copyright © 2006 - 2015 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include <ome/files/TraceObserver.h>
+
+#include <ome/test/test.h>
+
+using ome::files::TraceObserver;
+using ome::files::TraceScope;
+using ome::files::getTraceObserver;
+using ome::files::setTraceObserver;
+
+namespace
+{
+
+  // Record begin (positive) and end (negative) events.
+  class RecordingObserver : public TraceObserver
+  {
+  public:
+    std::vector<int> events;
+    std::vector<uint64_t> tiles;
+
+    void
+    begin(Event          event,
+          const Context& context)
+    {
+      events.push_back(static_cast<int>(event) + 1);
+      tiles.push_back(context.tile);
+    }
+
+    void
+    end(Event          event,
+        const Context& /* context */)
+    {
+      events.push_back(-(static_cast<int>(event) + 1));
+    }
+  };
+
+  // Restore no observer on scope exit.
+  struct ObserverGuard
+  {
+    ~ObserverGuard()
+    {
+      setTraceObserver(std::shared_ptr<TraceObserver>());
+    }
+  };
+
+}
+
+TEST(TraceObserver, Names)
+{
+  for (std::size_t i = 0; i < TraceObserver::event_count; ++i)
+    EXPECT_NE(nullptr, TraceObserver::name(static_cast<TraceObserver::Event>(i)));
+  EXPECT_STREQ("tile decode", TraceObserver::name(TraceObserver::TILE_DECODE));
+}
+
+TEST(TraceObserver, Unregistered)
+{
+  EXPECT_FALSE(getTraceObserver());
+  TraceScope trace(TraceObserver::FILE_OPEN);
+}
+
+TEST(TraceObserver, Nested)
+{
+  ObserverGuard guard;
+  std::shared_ptr<RecordingObserver> observer(std::make_shared<RecordingObserver>());
+  setTraceObserver(observer);
+  EXPECT_EQ(observer, getTraceObserver());
+
+  {
+    TraceScope open(TraceObserver::FILE_OPEN);
+    {
+      TraceScope read(TraceObserver::TILE_READ, nullptr, 8U, 3U);
+    }
+    TraceScope decode(TraceObserver::TILE_DECODE, nullptr, 8U, 4U);
+  }
+
+  std::vector<int> expected{TraceObserver::FILE_OPEN + 1,
+      TraceObserver::TILE_READ + 1, -(TraceObserver::TILE_READ + 1),
+      TraceObserver::TILE_DECODE + 1, -(TraceObserver::TILE_DECODE + 1),
+      -(TraceObserver::FILE_OPEN + 1)};
+  EXPECT_EQ(expected, observer->events);
+  std::vector<uint64_t> tiles{0U, 3U, 4U};
+  EXPECT_EQ(tiles, observer->tiles);
+}
+
+TEST(TraceObserver, EndOnException)
+{
+  ObserverGuard guard;
+  std::shared_ptr<RecordingObserver> observer(std::make_shared<RecordingObserver>());
+  setTraceObserver(observer);
+
+  try
+    {
+      TraceScope parse(TraceObserver::XML_PARSE);
+      throw std::runtime_error("parse failed");
+    }
+  catch (const std::runtime_error&)
+    {
+    }
+
+  std::vector<int> expected{TraceObserver::XML_PARSE + 1, -(TraceObserver::XML_PARSE + 1)};
+  EXPECT_EQ(expected, observer->events);
+}
+
+TEST(TraceObserver, Replace)
+{
+  ObserverGuard guard;
+  std::shared_ptr<RecordingObserver> first(std::make_shared<RecordingObserver>());
+  std::shared_ptr<RecordingObserver> second(std::make_shared<RecordingObserver>());
+  setTraceObserver(first);
+
+  {
+    TraceScope encode(TraceObserver::TILE_ENCODE);
+    // Ends with the observer which began the event.
+    setTraceObserver(second);
+  }
+  {
+    TraceScope serialize(TraceObserver::XML_SERIALIZE);
+  }
+  setTraceObserver(std::shared_ptr<TraceObserver>());
+  {
+    TraceScope serialize(TraceObserver::XML_SERIALIZE);
+  }
+
+  std::vector<int> expected1{TraceObserver::TILE_ENCODE + 1, -(TraceObserver::TILE_ENCODE + 1)};
+  std::vector<int> expected2{TraceObserver::XML_SERIALIZE + 1, -(TraceObserver::XML_SERIALIZE + 1)};
+  EXPECT_EQ(expected1, first->events);
+  EXPECT_EQ(expected2, second->events);
+}
@@ -36,8 +36,10 @@
  * #L%
  */
 
+#include <memory>
 #include <sstream>
 #include <stdexcept>
+#include <utility>
 
 #include <ome/files/VariantPixelBuffer.h>
 
@@ -627,6 +629,235 @@ TEST_P(VariantPixelBufferTest, ConstructRangeRef)
   boost::apply_visitor(v, buf.vbuffer());
 }
 
+TEST_P(VariantPixelBufferTest, ConstructExternal)
+{
+  const VariantPixelBufferTestParameters& params = GetParam();
+  const ome::files::pixel_size_type size = ome::files::bytesPerPixel(params.type);
+
+  // Storage for 10 pixels, aligned for all pixel types.
+  std::vector<double> storage(((10U * size) / sizeof(double)) + 1U);
+  void *pixeldata = storage.data();
+
+  VariantPixelBuffer buf(pixeldata, 10U * size,
+                         boost::extents[5][2][1][1][1][1][1][1][1],
+                         params.type);
+  ASSERT_EQ(buf.num_elements(), 10U);
+  EXPECT_FALSE(buf.managed());
+  EXPECT_EQ(pixeldata, static_cast<const void *>(buf.data()));
+
+  AssignTestVisitor v(buf);
+  boost::apply_visitor(v, buf.vbuffer());
+
+  // Reshaping reuses the external storage.
+  buf.setBuffer(boost::extents[2][4][1][1][1][1][1][1][1], params.type);
+  ASSERT_EQ(buf.num_elements(), 8U);
+  EXPECT_FALSE(buf.managed());
+  EXPECT_EQ(pixeldata, static_cast<const void *>(buf.data()));
+
+  // Too large for the external storage.
+  EXPECT_THROW(buf.setBuffer(boost::extents[4][4][1][1][1][1][1][1][1], params.type),
+               std::logic_error);
+  EXPECT_EQ(buf.num_elements(), 8U);
+  EXPECT_THROW(VariantPixelBuffer(pixeldata, 10U * size,
+                                  boost::extents[11][1][1][1][1][1][1][1][1],
+                                  params.type),
+               std::logic_error);
+
+  // Copies share the external storage.
+  VariantPixelBuffer copy(buf);
+  copy.setBuffer(boost::extents[10][1][1][1][1][1][1][1][1], params.type);
+  EXPECT_EQ(pixeldata, static_cast<const void *>(copy.data()));
+
+  if (size > 1U)
+    {
+      EXPECT_THROW(VariantPixelBuffer(static_cast<uint8_t *>(pixeldata) + 1U, 9U * size,
+                                      boost::extents[2][2][1][1][1][1][1][1][1],
+                                      params.type),
+                   std::logic_error);
+    }
+}
+
+TEST_P(VariantPixelBufferTest, ConstructUninitialized)
+{
+  const VariantPixelBufferTestParameters& params = GetParam();
+
+  ome::files::PixelBufferBase::storage_order_type order
+    (ome::files::PixelBufferBase::make_storage_order(ome::xml::model::enums::DimensionOrder::XYZTC, true));
+
+  VariantPixelBuffer buf(boost::extents[5][2][3][1][1][1][1][1][1],
+                         params.type, order,
+                         ome::files::PIXEL_UNINITIALIZED);
+  ASSERT_EQ(buf.num_elements(), 30U);
+  EXPECT_TRUE(buf.managed());
+  EXPECT_EQ(params.type, buf.pixelType());
+  EXPECT_TRUE(order == buf.storage_order());
+
+  AssignTestVisitor v(buf);
+  boost::apply_visitor(v, buf.vbuffer());
+
+  // Copies share the uninitialized storage.
+  VariantPixelBuffer copy(buf);
+  EXPECT_EQ(buf.data(), copy.data());
+  EXPECT_TRUE(copy.managed());
+
+  // Reallocation from ranges, including non-zero index bases.
+  typedef boost::multi_array_types::extent_range range;
+  buf.setBuffer(boost::extents[range(2,6)][2][1][1][1][1][1][1][1],
+                params.type, order,
+                ome::files::PIXEL_UNINITIALIZED);
+  ASSERT_EQ(buf.num_elements(), 8U);
+  EXPECT_TRUE(buf.managed());
+  EXPECT_EQ(2, *(buf.index_bases()));
+  EXPECT_NE(buf.data(), copy.data());
+
+  AssignTestVisitor v2(buf);
+  boost::apply_visitor(v2, buf.vbuffer());
+
+  // Empty buffers are permitted.
+  buf.setBuffer(boost::extents[0][2][1][1][1][1][1][1][1],
+                params.type, order,
+                ome::files::PIXEL_UNINITIALIZED);
+  EXPECT_EQ(buf.num_elements(), 0U);
+}
+
+namespace
+{
+
+  // Allocator recording outstanding allocations.
+  class CountingAllocator : public ome::files::PixelAllocator
+  {
+  public:
+    std::size_t allocations;
+    std::size_t bytes;
+
+    CountingAllocator():
+      allocations(0U),
+      bytes(0U)
+    {}
+
+    void *
+    allocate(std::size_t size,
+             std::size_t alignment)
+    {
+      EXPECT_GT(size, 0U);
+      EXPECT_GT(alignment, 0U);
+      ++allocations;
+      bytes += size;
+      return ::operator new(size);
+    }
+
+    void
+    deallocate(void        *ptr,
+               std::size_t  size,
+               std::size_t  /* alignment */)
+    {
+      --allocations;
+      bytes -= size;
+      ::operator delete(ptr);
+    }
+  };
+
+}
+
+TEST_P(VariantPixelBufferTest, ConstructAllocator)
+{
+  const VariantPixelBufferTestParameters& params = GetParam();
+  std::shared_ptr<CountingAllocator> alloc(std::make_shared<CountingAllocator>());
+
+  {
+    VariantPixelBuffer buf(alloc, boost::extents[5][2][1][1][1][1][1][1][1],
+                           params.type);
+    ASSERT_EQ(buf.num_elements(), 10U);
+    EXPECT_TRUE(buf.managed());
+    EXPECT_EQ(1U, alloc->allocations);
+    EXPECT_EQ(alloc, buf.getAllocator());
+
+    AssignTestVisitor v(buf);
+    boost::apply_visitor(v, buf.vbuffer());
+
+    // Reallocation uses the same allocator.
+    buf.setBuffer(boost::extents[4][4][1][1][1][1][1][1][1], params.type);
+    ASSERT_EQ(buf.num_elements(), 16U);
+    EXPECT_EQ(1U, alloc->allocations);
+    EXPECT_EQ(16U * ome::files::bytesPerPixel(params.type), alloc->bytes);
+
+    // Copies share the storage.
+    VariantPixelBuffer copy(buf);
+    EXPECT_EQ(buf.data(), copy.data());
+    EXPECT_EQ(alloc, copy.getAllocator());
+
+    // The default allocator may be restored.
+    buf.setAllocator(std::shared_ptr<ome::files::PixelAllocator>());
+    buf.setBuffer(boost::extents[2][2][1][1][1][1][1][1][1], params.type);
+    EXPECT_EQ(1U, alloc->allocations);
+  }
+
+  EXPECT_EQ(0U, alloc->allocations);
+  EXPECT_EQ(0U, alloc->bytes);
+
+  // Setting an allocator on an existing buffer.
+  VariantPixelBuffer buf;
+  buf.setAllocator(alloc);
+  buf.setBuffer(boost::extents[3][3][1][1][1][1][1][1][1], params.type,
+                PixelBufferBase::default_storage_order(),
+                ome::files::PIXEL_UNINITIALIZED);
+  EXPECT_EQ(1U, alloc->allocations);
+  EXPECT_TRUE(buf.managed());
+}
+
+namespace
+{
+
+  VariantPixelBuffer
+  makeMoveBuffer(ome::xml::model::enums::PixelType type,
+                 const void*&                      data)
+  {
+    VariantPixelBuffer buf(boost::extents[4][3][1][1][1][1][1][1][1], type);
+    data = buf.data();
+    return buf;
+  }
+
+}
+
+TEST_P(VariantPixelBufferTest, Move)
+{
+  const VariantPixelBufferTestParameters& params = GetParam();
+
+  // Return by value transfers the storage.
+  const void *data = nullptr;
+  VariantPixelBuffer buf(makeMoveBuffer(params.type, data));
+  ASSERT_EQ(buf.num_elements(), 12U);
+  EXPECT_EQ(data, static_cast<const void *>(buf.data()));
+  AssignTestVisitor v(buf);
+  boost::apply_visitor(v, buf.vbuffer());
+
+  // Move construction.
+  VariantPixelBuffer moved(std::move(buf));
+  EXPECT_EQ(data, static_cast<const void *>(moved.data()));
+  EXPECT_EQ(params.type, moved.pixelType());
+
+  // The moved-from buffer may be reinitialised.
+  buf.setBuffer(boost::extents[2][2][1][1][1][1][1][1][1], params.type);
+  EXPECT_EQ(buf.num_elements(), 4U);
+
+  // Move assignment replaces the storage, even if the extents differ.
+  buf = std::move(moved);
+  ASSERT_EQ(buf.num_elements(), 12U);
+  EXPECT_EQ(data, static_cast<const void *>(buf.data()));
+
+  // Move assignment to external storage copies into it.
+  const ome::files::pixel_size_type size = ome::files::bytesPerPixel(params.type);
+  std::vector<double> storage(((12U * size) / sizeof(double)) + 1U);
+  void *pixeldata = storage.data();
+  VariantPixelBuffer ext(pixeldata, 12U * size,
+                         boost::extents[4][3][1][1][1][1][1][1][1],
+                         params.type);
+  VariantPixelBuffer copy(buf);
+  ext = std::move(copy);
+  EXPECT_EQ(pixeldata, static_cast<const void *>(ext.data()));
+  EXPECT_TRUE(ext == buf);
+}
+
 TEST_P(VariantPixelBufferTest, ConstructCopy)
 {
   const VariantPixelBufferTestParameters& params = GetParam();
@@ -0,0 +1,253 @@
+/*
+ * #%L
+ * OME-FILES C++ library for image IO.
+ * %%
+ * Copyright © 2016 Open Microscopy Environment:
+ *   - Massachusetts Institute of Technology
+ *   - National Institutes of Health
+ *   - University of Dundee
+ *   - Board of Regents of the University of Wisconsin-Madison
+ *   - Glencoe Software, Inc.
+ * %%
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing official
+ * policies, either expressed or implied, of any organization.
+ * #L%
+ */
+
+
+// Small plane write benchmark.  This writes a large number of small
+// planes to an OME-TIFF file with OMETIFFWriter::saveBytes, as
+// produced by high frame rate acquisition, and reports the plane
+// write rate.  For small planes, the cost of setting up and writing
+// each IFD is a large part of the total; the time spent writing
+// directories is reported separately to make this visible.
+
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+
+#include <ome/files/CoreMetadata.h>
+#include <ome/files/IOStatistics.h>
+#include <ome/files/MetadataTools.h>
+#include <ome/files/PixelProperties.h>
+#include <ome/files/VariantPixelBuffer.h>
+#include <ome/files/out/OMETIFFWriter.h>
+
+#include <ome/xml/meta/OMEXMLMetadata.h>
+
+namespace opt = boost::program_options;
+
+using ome::files::dimension_size_type;
+using ome::files::CoreMetadata;
+using ome::files::IOStatistics;
+using ome::files::VariantPixelBuffer;
+using ome::files::out::OMETIFFWriter;
+using ome::xml::model::enums::PixelType;
+
+namespace
+{
+
+  // Benchmark settings.
+  struct Settings
+  {
+    dimension_size_type     size;
+    dimension_size_type     planes;
+    PixelType               pixeltype;
+    std::string             compression;
+    boost::filesystem::path file;
+  };
+
+  // Fill a plane with a value which differs between planes.
+  struct FillVisitor : public boost::static_visitor<>
+  {
+    dimension_size_type plane;
+
+    FillVisitor(dimension_size_type plane):
+      plane(plane)
+    {}
+
+    template<typename T>
+    void
+    operator() (std::shared_ptr<T>& buf)
+    {
+      typedef typename T::value_type value_type;
+
+      value_type *data = buf->data();
+      for (VariantPixelBuffer::size_type i = 0; i < buf->num_elements(); ++i)
+        data[i] = static_cast<value_type>((i + plane) % 251U);
+    }
+  };
+
+  // Write all planes and report the results.
+  void
+  benchmark(const Settings& settings)
+  {
+    std::shared_ptr<CoreMetadata> core(std::make_shared<CoreMetadata>());
+    core->sizeX = settings.size;
+    core->sizeY = settings.size;
+    core->sizeT = settings.planes;
+    core->imageCount = settings.planes;
+    core->pixelType = settings.pixeltype;
+    std::vector<std::shared_ptr<CoreMetadata>> seriesList(1U, core);
+
+    std::shared_ptr<::ome::xml::meta::OMEXMLMetadata> meta(std::make_shared<::ome::xml::meta::OMEXMLMetadata>());
+    ome::files::fillMetadata(*meta, seriesList);
+    std::shared_ptr<::ome::xml::meta::MetadataRetrieve> retrieve(std::static_pointer_cast<::ome::xml::meta::MetadataRetrieve>(meta));
+
+    std::array<VariantPixelBuffer::size_type, 9> shape;
+    shape[ome::files::DIM_SPATIAL_X] = shape[ome::files::DIM_SPATIAL_Y] = settings.size;
+    shape[ome::files::DIM_SUBCHANNEL] = shape[ome::files::DIM_SPATIAL_Z] = shape[ome::files::DIM_TEMPORAL_T] =
+      shape[ome::files::DIM_CHANNEL] = shape[ome::files::DIM_MODULO_Z] = shape[ome::files::DIM_MODULO_T] =
+      shape[ome::files::DIM_MODULO_C] = 1;
+
+    // Generate a few distinct planes up front, so that only the
+    // writing is timed.
+    std::vector<VariantPixelBuffer> pixels;
+    for (dimension_size_type p = 0U; p < 4U; ++p)
+      {
+        pixels.emplace_back(shape, settings.pixeltype);
+        FillVisitor v(p);
+        boost::apply_visitor(v, pixels.back().vbuffer());
+      }
+
+    if (boost::filesystem::exists(settings.file))
+      boost::filesystem::remove(settings.file);
+
+    std::shared_ptr<IOStatistics> statistics(std::make_shared<IOStatistics>());
+
+    auto start = std::chrono::steady_clock::now();
+
+    OMETIFFWriter writer;
+    writer.setMetadataRetrieve(retrieve);
+    writer.setStatistics(statistics);
+    writer.setInterleaved(false);
+    if (settings.compression != "none")
+      writer.setCompression(settings.compression);
+    writer.setId(settings.file);
+    for (dimension_size_type p = 0U; p < settings.planes; ++p)
+      writer.saveBytes(p, pixels[p % pixels.size()]);
+    writer.close();
+
+    auto end = std::chrono::steady_clock::now();
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    dimension_size_type bytes = settings.planes * settings.size * settings.size *
+      ome::files::bytesPerPixel(settings.pixeltype);
+
+    std::cout << std::left << std::setw(12) << settings.size << std::right
+              << std::fixed
+              << std::setw(10) << settings.planes
+              << std::setprecision(3)
+              << std::setw(12) << seconds
+              << std::setprecision(1)
+              << std::setw(12) << static_cast<double>(settings.planes) / seconds
+              << std::setw(12) << (static_cast<double>(bytes) / 1.0e6) / seconds
+              << std::setprecision(3)
+              << std::setw(14) << std::chrono::duration<double>(statistics->getTime(IOStatistics::STAGE_DIRECTORY)).count()
+              << '\n';
+  }
+
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  try
+    {
+      Settings settings;
+      std::vector<dimension_size_type> sizes;
+      std::string dir;
+      std::string pixeltype;
+      bool keep;
+
+      opt::options_description options("Options");
+      options.add_options()
+        ("help,h", "Show help options")
+        ("size", opt::value<std::vector<dimension_size_type>>(&sizes)->multitoken(), "Plane sizes (width and height) [default: 64 256 512]")
+        ("planes", opt::value<dimension_size_type>(&settings.planes)->default_value(10000U), "Number of planes")
+        ("pixel-type", opt::value<std::string>(&pixeltype)->default_value("uint16"), "Pixel type")
+        ("compression", opt::value<std::string>(&settings.compression)->default_value("none"), "Compression type")
+        ("dir", opt::value<std::string>(&dir)->default_value("."), "Directory for generated image files")
+        ("keep", opt::bool_switch(&keep), "Keep generated image files");
+
+      opt::variables_map vm;
+      opt::store(opt::parse_command_line(argc, argv, options), vm);
+      opt::notify(vm);
+
+      if (vm.count("help"))
+        {
+          std::cout << "Usage: " << argv[0] << " [options]\n\n" << options << '\n';
+          return EXIT_SUCCESS;
+        }
+
+      if (sizes.empty())
+        sizes = {64U, 256U, 512U};
+
+      if (!settings.planes)
+        throw std::logic_error("Plane count must be positive");
+
+      settings.pixeltype = PixelType(pixeltype);
+
+      std::cout << settings.pixeltype << ", " << settings.compression << " compression\n"
+                << std::left << std::setw(12) << "size" << std::right
+                << std::setw(10) << "planes"
+                << std::setw(12) << "seconds"
+                << std::setw(12) << "planes/s"
+                << std::setw(12) << "MB/s"
+                << std::setw(14) << "directory s"
+                << '\n';
+
+      for (auto size : sizes)
+        {
+          if (!size)
+            throw std::logic_error("Plane size must be positive");
+
+          settings.size = size;
+          settings.file = boost::filesystem::path(dir) / "write-benchmark.ome.tiff";
+
+          benchmark(settings);
+
+          if (!keep)
+            boost::filesystem::remove(settings.file);
+        }
+    }
+  catch (const std::exception& e)
+    {
+      std::cerr << "Error: " << e.what() << std::endl;
+      return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -37,6 +37,8 @@
  */
 
 #include <fstream>
+#include <thread>
+#include <vector>
 
 #include <ome/files/XMLTools.h>
 
@@ -100,6 +102,30 @@ TEST_P(XMLToolsFileTest, ValidateXML)
     {
       ASSERT_FALSE(ome::files::validateXML(data));
     }
+
+  // The grammar is compiled by the first validation, and reused.
+  ASSERT_TRUE(ome::files::schemaGrammarCached());
+}
+
+TEST_P(XMLToolsFileTest, ValidateXMLConcurrent)
+{
+  const XMLToolsFileTestParameters& params = GetParam();
+
+  std::string data;
+  readFile(params.filename, data);
+
+  std::vector<char> results(8U, 2);
+  std::vector<std::thread> threads;
+  for (auto& result : results)
+    threads.emplace_back([&data, &result]()
+                         {
+                           result = ome::files::validateXML(data);
+                         });
+  for (auto& thread : threads)
+    thread.join();
+
+  for (const auto& result : results)
+    EXPECT_EQ(params.valid, result != 0);
 }
 
 const std::vector<XMLToolsFileTestParameters> params